@@ -4,30 +4,105 @@ namespace {
 
 using namespace Halide;
 
+const int N = 5, CI = 128, CO = 128, W = 100, H = 80;
+
+enum class ConvAlgorithm {
+    Auto,      // Pick one of the below by the shape and the target.
+    Direct,    // The 3x3 stencil, accumulated directly.
+    Winograd,  // Winograd's F(2x2, 3x3): 16 multiplies per 2x2 output tile instead of 36.
+};
+
+std::map<std::string, ConvAlgorithm> convAlgorithmEnumMap() {
+    return {
+        {"auto", ConvAlgorithm::Auto},
+        {"direct", ConvAlgorithm::Direct},
+        {"winograd", ConvAlgorithm::Winograd},
+    };
+}
+
+// The sizes of the accumulator tile of the CPU schedules, in vectors
+// of output channels (tile_w) by output pixels (tile_h).
+void accumulator_tile(const Target &target, int &tile_w, int &tile_h) {
+    if (target.has_feature(Target::AVX512_Skylake) ||
+        (target.arch == Target::ARM &&
+         target.bits == 64)) {
+        // On Skylake we have one load per fma and 32
+        // registers available, so there's considerable
+        // flexibility in the schedule. We'll use 20 accumulator
+        // registers in a 4x5 tile. This is also a reasonable
+        // choice for ARMv8, which also has 32 registers.
+        tile_w = 4;
+        tile_h = 5;
+    } else if (target.arch == Target::X86) {
+        // With 16-register ISAs like x86 with AVX2, we can
+        // only do one load per two fmas, which constrains the
+        // schedule to have to be a squarish 12-register tile
+        // of the output.
+        tile_w = 3;
+        tile_h = 4;
+    } else {
+        // The above should also be reasonable schedule for
+        // ARMv7 and other 16-register machines, but I see
+        // some spills on arm-32, so we use a 2x4 block of 8
+        // accumulators instead. This could probably be better
+        // tuned, because in principle 12 accumulators should
+        // be possible. I believe the issue is that there's no
+        // fused multiply-add instruction, and so we're
+        // fighting llvm's instruction scheduler, which wants
+        // to move the muls well ahead of the adds to cover
+        // instruction latencies.
+        tile_w = 2;
+        tile_h = 4;
+    }
+}
+
+// The filter transform of F(2x2, 3x3), G g G^T, from filter(co, fx,
+// fy, ci) with 3x3 taps to U(co, ex, ey, ci) with 4x4. This only
+// depends on the weights, so it can be done once, ahead of time.
+Func winograd_filter(Func filter) {
+    Var co("co"), ex("ex"), ey("ey"), ci("ci"), fy("fy");
+    auto g = [](const std::function<Expr(int)> &f) {
+        return std::vector<Expr>{f(0),
+                                 (f(0) + f(1) + f(2)) * 0.5f,
+                                 (f(0) - f(1) + f(2)) * 0.5f,
+                                 f(2)};
+    };
+    Func filter_x("winograd_filter_x"), U("winograd_filter");
+    filter_x(co, ex, fy, ci) = mux(ex, g([&](int k) { return filter(co, k, fy, ci); }));
+    U(co, ex, ey, ci) = mux(ey, g([&](int k) { return filter_x(co, ex, k, ci); }));
+    return U;
+}
+
 class ConvolutionLayer : public Halide::Generator<ConvolutionLayer> {
 public:
+    GeneratorParam<ConvAlgorithm> algorithm{"algorithm", ConvAlgorithm::Direct, convAlgorithmEnumMap()};
+    // If true, the Winograd algorithm takes a filter that has already
+    // been through conv_layer_filter_transform, of shape (CO, 4, 4, CI).
+    GeneratorParam<bool> prepacked_filter{"prepacked_filter", false};
+
     Input<Buffer<float, 4>> input{"input"};
     Input<Buffer<float, 4>> filter{"filter"};
     Input<Buffer<float, 1>> bias{"bias"};
     Output<Buffer<float, 4>> relu{"relu"};
 
-    void generate() {
-        const int N = 5, CI = 128, CO = 128, W = 100, H = 80;
-
-        /* THE ALGORITHM */
-
-        Var x("x"), y("y"), c("c"), n("n");
-
-        Func conv("conv");
-        RDom r(0, CI, 0, 3, 0, 3);
-
-        conv(c, x, y, n) = bias(c);
-        conv(c, x, y, n) += filter(c, r.y, r.z, r.x) * input(r.x, x + r.y, y + r.z, n);
-
-        relu(c, x, y, n) = max(0, conv(c, x, y, n));
-
-        /* THE SCHEDULE */
+    bool use_winograd() const {
+        switch ((ConvAlgorithm)algorithm) {
+        case ConvAlgorithm::Winograd:
+            return true;
+        case ConvAlgorithm::Direct:
+            return false;
+        default:
+            // Winograd trades multiplies for loads and adds, which
+            // only pays off with enough channels to amortize the
+            // transforms over. On GPUs the direct schedule already
+            // runs at close to peak flops.
+            return !using_autoscheduler() &&
+                   !get_target().has_gpu_feature() &&
+                   CI >= 32 && CO >= 32;
+        }
+    }
 
+    void constrain_buffers() {
         // MKL JITs code for the specific size and strides, so we'll
         // do the same and ask Halide to compile for this specific
         // size:
@@ -42,12 +117,35 @@ public:
         input.dim(2).set_bounds(0, H + 2).set_stride(CI * (W + 2));
         input.dim(3).set_bounds(0, N).set_stride(CI * (W + 2) * (H + 2));
 
+        const int taps = use_winograd() && prepacked_filter ? 4 : 3;
         filter.dim(0).set_bounds(0, CO).set_stride(1);
-        filter.dim(1).set_bounds(0, 3).set_stride(CO);
-        filter.dim(2).set_bounds(0, 3).set_stride(CO * 3);
-        filter.dim(3).set_bounds(0, CI).set_stride(CO * 3 * 3);
+        filter.dim(1).set_bounds(0, taps).set_stride(CO);
+        filter.dim(2).set_bounds(0, taps).set_stride(CO * taps);
+        filter.dim(3).set_bounds(0, CI).set_stride(CO * taps * taps);
 
         bias.dim(0).set_bounds(0, CO).set_stride(1);
+    }
+
+    void generate() {
+        constrain_buffers();
+        if (use_winograd()) {
+            generate_winograd();
+            return;
+        }
+
+        /* THE ALGORITHM */
+
+        Var x("x"), y("y"), c("c"), n("n");
+
+        Func conv("conv");
+        RDom r(0, CI, 0, 3, 0, 3);
+
+        conv(c, x, y, n) = bias(c);
+        conv(c, x, y, n) += filter(c, r.y, r.z, r.x) * input(r.x, x + r.y, y + r.z, n);
+
+        relu(c, x, y, n) = max(0, conv(c, x, y, n));
+
+        /* THE SCHEDULE */
 
         if (using_autoscheduler()) {
             input.dim(0).set_estimate(0, CI);
@@ -135,38 +233,7 @@ public:
             int tile_w = 1;
             int tile_h = 1;
             const int vec = natural_vector_size<float>();
-
-            if (get_target().has_feature(Target::AVX512_Skylake) ||
-                (get_target().arch == Target::ARM &&
-                 get_target().bits == 64)) {
-                // On Skylake we have one load per fma and 32
-                // registers available, so there's considerable
-                // flexibility in the schedule. We'll use 20 accumulator
-                // registers in a 4x5 tile. This is also a reasonable
-                // choice for ARMv8, which also has 32 registers.
-                tile_w = 4;
-                tile_h = 5;
-            } else if (get_target().arch == Target::X86) {
-                // With 16-register ISAs like x86 with AVX2, we can
-                // only do one load per two fmas, which constrains the
-                // schedule to have to be a squarish 12-register tile
-                // of the output.
-                tile_w = 3;
-                tile_h = 4;
-            } else {
-                // The above should also be reasonable schedule for
-                // ARMv7 and other 16-register machines, but I see
-                // some spills on arm-32, so we use a 2x4 block of 8
-                // accumulators instead. This could probably be better
-                // tuned, because in principle 12 accumulators should
-                // be possible. I believe the issue is that there's no
-                // fused multiply-add instruction, and so we're
-                // fighting llvm's instruction scheduler, which wants
-                // to move the muls well ahead of the adds to cover
-                // instruction latencies.
-                tile_w = 2;
-                tile_h = 4;
-            }
+            accumulator_tile(get_target(), tile_w, tile_h);
 
             Var co, ci, xo, xi, yo, yi, t;
             relu.split(c, co, ci, vec * tile_w)
@@ -200,8 +267,173 @@ public:
                 .unroll(_0);
         }
     }
+
+    void generate_winograd() {
+        /* THE ALGORITHM */
+
+        // Each 2x2 tile (tx, ty) of the output is computed from the
+        // 4x4 tile of the input around it in three steps: transform
+        // the input tile with B^T d B, multiply it elementwise by the
+        // transformed filter and sum over the input channels, then
+        // transform the 4x4 result back to 2x2 with A^T m A.
+
+        Var x("x"), y("y"), c("c"), n("n");
+        Var ci("ci"), co("co"), ex("ex"), ey("ey"), tx("tx"), ty("ty"), px("px"), py("py");
+
+        Func U("U");
+        if (prepacked_filter) {
+            U(co, ex, ey, ci) = filter(co, ex, ey, ci);
+        } else {
+            U = winograd_filter(filter);
+        }
+
+        auto bt = [](const std::function<Expr(int)> &d) {
+            return std::vector<Expr>{d(0) - d(2), d(1) + d(2), d(2) - d(1), d(1) - d(3)};
+        };
+        auto at = [](const std::function<Expr(int)> &m) {
+            return std::vector<Expr>{m(0) + m(1) + m(2), m(1) - m(2) - m(3)};
+        };
+
+        Func V_x("V_x"), V("V");
+        V_x(ci, ex, y, tx, n) = mux(ex, bt([&](int k) { return input(ci, 2 * tx + k, y, n); }));
+        V(ci, ex, ey, tx, ty, n) = mux(ey, bt([&](int k) { return V_x(ci, ex, 2 * ty + k, tx, n); }));
+
+        Func M("M");
+        RDom r(0, CI);
+        M(co, ex, ey, tx, ty, n) = 0.0f;
+        M(co, ex, ey, tx, ty, n) += U(co, ex, ey, r) * V(r, ex, ey, tx, ty, n);
+
+        Func O_x("O_x"), O("O");
+        O_x(co, px, ey, tx, ty, n) = mux(px, at([&](int k) { return M(co, k, ey, tx, ty, n); }));
+        O(co, px, py, tx, ty, n) = mux(py, at([&](int k) { return O_x(co, px, k, tx, ty, n); }));
+
+        relu(c, x, y, n) = max(0, bias(c) + O(c, x % 2, y % 2, x / 2, y / 2, n));
+
+        /* THE SCHEDULE */
+
+        if (get_target().has_gpu_feature()) {
+            // A straightforward GPU schedule, with each stage at
+            // root. The direct schedule is likely faster on GPUs.
+            Var xo, xi, cio, cii;
+            relu.compute_root()
+                .split(x, tx, px, 2)
+                .split(y, ty, py, 2)
+                .reorder(px, py, c, tx, ty, n)
+                .unroll(px)
+                .unroll(py)
+                .gpu_tile(c, tx, cio, xo, cii, xi, 32, 4);
+            M.compute_root()
+                .gpu_tile(co, tx, cio, xo, cii, xi, 32, 4)
+                .update()
+                .gpu_tile(co, tx, cio, xo, cii, xi, 32, 4);
+            V.compute_root()
+                .reorder(ci, tx, ex, ey, ty, n)
+                .unroll(ex)
+                .unroll(ey)
+                .gpu_tile(ci, tx, cio, xo, cii, xi, 32, 4);
+            if (!prepacked_filter) {
+                U.compute_root()
+                    .unroll(ex)
+                    .unroll(ey)
+                    .gpu_tile(co, ci, cio, xo, cii, xi, 32, 4);
+            }
+            return;
+        }
+
+        // The elementwise multiply is a batch of 16 matrix products
+        // over the channels, one per (ex, ey), which we schedule like
+        // the direct convolution: a tile of vectors of output
+        // channels by tiles of the output held in registers.
+        int tile_w = 1;
+        int tile_h = 1;
+        const int vec = natural_vector_size<float>();
+        accumulator_tile(get_target(), tile_w, tile_h);
+
+        Var cio, cii, txo, txi;
+        relu.split(x, tx, px, 2)
+            .split(y, ty, py, 2)
+            .split(c, cio, cii, vec * tile_w)
+            .split(tx, txo, txi, tile_h)
+            .reorder(cii, px, py, txi, txo, ty, n, cio)
+            .vectorize(cii, vec)
+            .unroll(cii)
+            .unroll(px)
+            .unroll(py)
+            .parallel(ty)
+            .parallel(n)
+            .parallel(cio);
+        M.compute_at(relu, txo)
+            .vectorize(co, vec)
+            .unroll(co)
+            .unroll(tx)
+            .unroll(ex)
+            .unroll(ey)
+            .update()
+            .reorder(co, tx, r, ex, ey, ty, n)
+            .vectorize(co, vec)
+            .unroll(co)
+            .unroll(tx)
+            .unroll(r, 2);
+
+        // The transformed input is shared by all the output channels
+        // of a block.
+        V.compute_at(relu, txo)
+            .reorder(ci, ex, ey, tx, ty, n)
+            .vectorize(ci, vec)
+            .unroll(ex)
+            .unroll(ey);
+        V_x.compute_at(V, tx)
+            .vectorize(ci, vec)
+            .unroll(ex)
+            .unroll(y);
+
+        if (!prepacked_filter) {
+            // Only the weights are transformed in the pipeline, so
+            // this is cheap compared to the rest.
+            U.compute_root()
+                .vectorize(co, vec)
+                .unroll(ex)
+                .unroll(ey)
+                .parallel(ci);
+        }
+    }
+};
+
+// Transforms a filter for conv_layer with algorithm=winograd and
+// prepacked_filter=true, so that running the layer many times with the
+// same weights only does the transform once.
+class ConvolutionFilterTransform : public Halide::Generator<ConvolutionFilterTransform> {
+public:
+    Input<Buffer<float, 4>> filter{"filter"};
+    Output<Buffer<float, 4>> packed{"packed"};
+
+    void generate() {
+        Var co("co"), ex("ex"), ey("ey"), ci("ci");
+        packed(co, ex, ey, ci) = winograd_filter(filter)(co, ex, ey, ci);
+
+        filter.dim(0).set_bounds(0, CO).set_stride(1);
+        filter.dim(1).set_bounds(0, 3).set_stride(CO);
+        filter.dim(2).set_bounds(0, 3).set_stride(CO * 3);
+        filter.dim(3).set_bounds(0, CI).set_stride(CO * 3 * 3);
+
+        packed.dim(0).set_bounds(0, CO).set_stride(1);
+        packed.dim(1).set_bounds(0, 4).set_stride(CO);
+        packed.dim(2).set_bounds(0, 4).set_stride(CO * 4);
+        packed.dim(3).set_bounds(0, CI).set_stride(CO * 4 * 4);
+
+        if (get_target().has_gpu_feature()) {
+            Var cio, cii, cjo, cji;
+            packed.gpu_tile(co, ci, cio, cjo, cii, cji, 32, 4);
+        } else {
+            packed.vectorize(co, natural_vector_size<float>())
+                .unroll(ex)
+                .unroll(ey)
+                .parallel(ci);
+        }
+    }
 };
 
 }  // namespace
 
 HALIDE_REGISTER_GENERATOR(ConvolutionLayer, conv_layer)
+HALIDE_REGISTER_GENERATOR(ConvolutionFilterTransform, conv_layer_filter_transform)
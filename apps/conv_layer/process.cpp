@@ -1,8 +1,12 @@
+#include <algorithm>
 #include <chrono>
+#include <cmath>
 #include <cstdio>
 
 #include "conv_layer.h"
 #include "conv_layer_auto_schedule.h"
+#include "conv_layer_filter_transform.h"
+#include "conv_layer_winograd.h"
 
 #include "HalideBuffer.h"
 #include "halide_benchmark.h"
@@ -70,6 +74,32 @@ int main(int argc, char **argv) {
     });
     printf("Auto-scheduled time: %gms\n", min_t_auto * 1e3);
 
+    // Winograd version, with the filter transformed once up front.
+    Buffer<float, 4> packed_filter(CO, 4, 4, CI);
+    conv_layer_filter_transform(filter, packed_filter);
+    Buffer<float, 4> winograd_output(CO, W, H, N);
+    double min_t_winograd = benchmark(10, 10, [&]() {
+        conv_layer_winograd(input, packed_filter, bias, winograd_output);
+        winograd_output.device_sync();
+    });
+    printf("Winograd time: %gms\n", min_t_winograd * 1e3);
+
+    // Winograd rounds differently, so compare relative to the largest
+    // output.
+    conv_layer(input, filter, bias, output);
+    output.copy_to_host();
+    winograd_output.copy_to_host();
+    float max_output = 0.0f, max_error = 0.0f;
+    output.for_each_element([&](int c, int x, int y, int n) {
+        max_output = std::max(max_output, std::abs(output(c, x, y, n)));
+        max_error = std::max(max_error, std::abs(output(c, x, y, n) - winograd_output(c, x, y, n)));
+    });
+    if (max_error > 1e-4f * max_output) {
+        printf("Winograd output differs from the direct convolution by %g (of %g)\n",
+               max_error, max_output);
+        return 1;
+    }
+
     printf("Success!\n");
     return 0;
 }
@@ -9,8 +9,10 @@
 #include <cstddef>
 #include <limits>
 #include <map>
+#include <mutex>
 #include <ostream>
 #include <string>
+#include <tuple>
 
 #include "funct.h"
 
@@ -302,6 +304,7 @@ ComplexFunc fft_dim1(ComplexFunc x,
                      const Target &target,
                      TwiddleFactorSet *twiddle_cache) {
     int N = product(NR);
+    const bool gpu = target.has_gpu_feature();
 
     vector<Var> args = x.args();
     Var n0(args[0]), n1(args[1]);
@@ -382,7 +385,7 @@ ComplexFunc fft_dim1(ComplexFunc x,
 
         // The last stage needs explicit vectorization, because it doesn't get computed
         // at the vectorized context exchange (below).
-        if (S == N / R) {
+        if (S == N / R && !gpu) {
             if (S > 1) {
                 v.vectorize(n0);
             }
@@ -400,6 +403,28 @@ ComplexFunc fft_dim1(ComplexFunc x,
         S *= R;
     }
 
+    if (gpu) {
+        // Each GPU block computes a group of DFTs, with one thread per
+        // DFT. The stages of a group are stored in shared memory, so limit
+        // the size of the group for large DFTs.
+        int threads = 32;
+        while (threads > 1 && threads * N > 4096) {
+            threads /= 2;
+        }
+        threads = gcd(threads, extent_0);
+
+        x.update()
+            .split(n0, group, n0, threads)
+            .reorder(r_, s_, n0, group)
+            .gpu_blocks(group)
+            .gpu_threads(n0);
+        for (size_t i = 0; i + 1 < stages.size(); i++) {
+            Func stage = stages[i].first;
+            stage.compute_at(x, group).update().gpu_threads(n0);
+        }
+        return x;
+    }
+
     // Ensure that the vector width divides the vectorization dimension extent.
     vector_width = gcd(vector_width, extent_0);
 
@@ -438,8 +463,8 @@ std::pair<FuncType, FuncType> tiled_transpose(FuncType f, int max_tile_size,
     // ARM can do loads of up to stride 4. We can use these loads to write a more
     // efficient transpose. The strategy is to break the transpose into 4x4 tiles,
     // transpose the tiles themselves (dense vector load/stores), then transpose
-    // the data within each tile (stride 4 loads).
-    if (target.arch != Target::ARM && !always_tile) {
+    // the data within each tile (stride 4 loads). GPUs don't benefit from this.
+    if (!always_tile && (target.arch != Target::ARM || target.has_gpu_feature())) {
         return {transpose(f), FuncType()};
     }
 
@@ -531,6 +556,10 @@ ComplexFunc fft2d_c2c(ComplexFunc x,
     // Schedule the tiled transposes at each group.
     if (dft1_tiled.defined()) {
         dft1_tiled.compute_at(dft, group);
+    } else if (target.has_gpu_feature()) {
+        Var n0o("n0o"), n1o("n1o"), n0i("n0i"), n1i("n1i");
+        xT.compute_at(dft, outer)
+            .gpu_tile(n0, n1, n0o, n1o, n0i, n1i, 16, 16, TailStrategy::GuardWithIf);
     } else {
         xT.compute_at(dft, outer).vectorize(n0).unroll(n1);
     }
@@ -538,8 +567,9 @@ ComplexFunc fft2d_c2c(ComplexFunc x,
         x_tiled.compute_at(dft1T, group);
     }
 
-    // Schedule the input, if requested.
-    if (desc.schedule_input) {
+    // Schedule the input, if requested. On GPUs, the input is computed
+    // by the threads of the transpose above.
+    if (desc.schedule_input && !target.has_gpu_feature()) {
         x.compute_at(dft1T, group);
     }
 
@@ -694,6 +724,9 @@ ComplexFunc fft2d_r2c(Func r,
     // We also are bad at handling zipping when the zip size is a small non-integer
     // factor of the vector size.
     skip_zip = skip_zip || (N0 < natural_vector_size * 4 && (N0 % (natural_vector_size * 2) != 0));
+    // Zipping requires even sizes, and the zipped schedule below is only
+    // written for CPUs.
+    skip_zip = skip_zip || N0 % 2 != 0 || N1 % 2 != 0 || target.has_gpu_feature();
     if (skip_zip) {
         ComplexFunc r_complex("r_complex");
         r_complex(A({n0, n1}, args)) = ComplexExpr(r(A({n0, n1}, args)), 0.0f);
@@ -705,7 +738,12 @@ ComplexFunc fft2d_r2c(Func r,
         result(A({n0, n1}, args)) = dft(A({n0, n1}, args));
         result.bound(n0, 0, N0);
         result.bound(n1, 0, (N1 + 1) / 2 + 1);
-        result.vectorize(n0, std::min(N0, target.natural_vector_size(result.types()[0])));
+        if (target.has_gpu_feature()) {
+            Var n0o("n0o"), n1o("n1o"), n0i("n0i"), n1i("n1i");
+            result.gpu_tile(n0, n1, n0o, n1o, n0i, n1i, 16, 16, TailStrategy::GuardWithIf);
+        } else {
+            result.vectorize(n0, std::min(N0, target.natural_vector_size(result.types()[0])));
+        }
         dft.compute_at(result, outer);
         return result;
     }
@@ -914,6 +952,7 @@ Func fft2d_c2r(ComplexFunc c,
     const int natural_vector_size = target.natural_vector_size(c.types()[0]);
 
     bool skip_zip = N0 < natural_vector_size * 2;
+    skip_zip = skip_zip || N0 % 2 != 0 || N1 % 2 != 0 || target.has_gpu_feature();
 
     ComplexFunc dft;
     Func unzipped(prefix + "unzipped");
@@ -922,16 +961,19 @@ Func fft2d_c2r(ComplexFunc c,
         // it via conjugate symmetry.
         ComplexFunc c_extended(prefix + "c_extended");
         c_extended(A({n0, n1}, args)) =
-            select(n1 <= (N1 + 1) / 2, c(A({n0, n1}, args)), conj(c(A({(N0 - n0) % N0, (N1 - n1) % N1}, args))));
+            select(n1 <= N1 / 2, c(A({n0, n1}, args)), conj(c(A({(N0 - n0) % N0, (N1 - n1) % N1}, args))));
         dft = fft2d_c2c(c_extended, R0, R1, 1, target, desc);
         unzipped(A({n0, n1}, args)) = re(dft(A({n0, n1}, args)));
 
         dft.compute_at(unzipped, outer);
 
-        // We want to unroll by at least two zip_widths to simplify the zip group
-        // logic.
-        int vector_size = std::min(N0, natural_vector_size);
-        unzipped.vectorize(n0, vector_size);
+        if (target.has_gpu_feature()) {
+            Var n0o("n0o"), n1o("n1o"), n0i("n0i"), n1i("n1i");
+            unzipped.gpu_tile(n0, n1, n0o, n1o, n0i, n1i, 16, 16, TailStrategy::GuardWithIf);
+        } else {
+            int vector_size = std::min(N0, natural_vector_size);
+            unzipped.vectorize(n0, vector_size);
+        }
     } else {
         // Cache of twiddle factors for this FFT.
         TwiddleFactorSet twiddle_cache;
@@ -1088,7 +1130,13 @@ vector<int> radix_factor(int N) {
         }
     }
 
-    // If there are still factors left over, just include them as a radix.
+    // Split what's left into its prime factors, which use the generic DFT.
+    for (int p = 3; p * p <= N; p += 2) {
+        while (N % p == 0) {
+            R.push_back(p);
+            N /= p;
+        }
+    }
     if (N != 1 || R.empty()) {
         R.push_back(N);
     }
@@ -1119,3 +1167,72 @@ Func fft2d_c2r(ComplexFunc c,
                const Fft2dDesc &desc) {
     return fft2d_c2r(c, radix_factor(N0), radix_factor(N1), target, desc);
 }
+
+Callable fft2d_plan(FftType type,
+                    int N0, int N1,
+                    int sign,
+                    float gain,
+                    const Target &target) {
+    if (type == FftType::R2C) {
+        sign = -1;
+    } else if (type == FftType::C2R) {
+        sign = 1;
+    }
+
+    using PlanKey = std::tuple<FftType, int, int, int, float, string>;
+    static std::mutex plans_mutex;
+    static std::map<PlanKey, Callable> plans;
+
+    std::lock_guard<std::mutex> lock(plans_mutex);
+    PlanKey key(type, N0, N1, sign, gain, target.to_string());
+    auto it = plans.find(key);
+    if (it != plans.end()) {
+        return it->second;
+    }
+
+    Fft2dDesc desc;
+    desc.gain = gain;
+
+    Var c("c"), n0("n0"), n1("n1"), b("b");
+    ImageParam input(Float(32), type == FftType::R2C ? 3 : 4, "input");
+    Func output("output");
+
+    // The transform, which is computed once per batch.
+    Func result;
+    if (type == FftType::R2C) {
+        Func in("in");
+        in(n0, n1, b) = input(n0, n1, b);
+        ComplexFunc dft = fft2d_r2c(in, N0, N1, target, desc);
+        output(c, n0, n1, b) = mux(c, {re(dft(n0, n1, b)), im(dft(n0, n1, b))});
+        result = dft;
+    } else {
+        input.dim(0).set_bounds(0, 2);
+        ComplexFunc in("in");
+        in(n0, n1, b) = ComplexExpr(input(0, n0, n1, b), input(1, n0, n1, b));
+        if (type == FftType::C2R) {
+            Func r = fft2d_c2r(in, N0, N1, target, desc);
+            output(n0, n1, b) = r(n0, n1, b);
+            result = r;
+        } else {
+            ComplexFunc dft = fft2d_c2c(in, N0, N1, sign, target, desc);
+            output(c, n0, n1, b) = mux(c, {re(dft(n0, n1, b)), im(dft(n0, n1, b))});
+            result = dft;
+        }
+    }
+
+    if (type != FftType::C2R) {
+        output.output_buffer().dim(0).set_bounds(0, 2);
+        output.bound(c, 0, 2).unroll(c);
+    }
+    result.compute_at(output, b);
+    if (target.has_gpu_feature()) {
+        Var n0o("n0o"), n1o("n1o"), n0i("n0i"), n1i("n1i");
+        output.gpu_tile(n0, n1, n0o, n1o, n0i, n1i, 16, 16, TailStrategy::GuardWithIf);
+    } else {
+        output.parallel(b);
+    }
+
+    Callable plan = output.compile_to_callable({input}, target);
+    plans.emplace(key, plan);
+    return plan;
+}
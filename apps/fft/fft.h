@@ -38,6 +38,12 @@ struct Fft2dDesc {
     std::string name = "";
 };
 
+// The sizes of the FFTs below can be any positive integers. They are factored
+// into radices of 2, 4, 6 and 8 where possible, and prime radices otherwise;
+// sizes with large prime factors are slow. Any dimensions of the input beyond
+// the first 2 are a batch of independent FFTs, with the same dimensions in the
+// result. On targets with a GPU feature, the FFTs are scheduled for the GPU.
+
 // Compute the N0 x N1 2D complex DFT of the first 2 dimensions of a complex
 // valued function x. The first 2 dimensions of x should be defined on at least
 // [0, N0) and [0, N1) for dimensions 0, 1, respectively. sign = -1 indicates a
@@ -66,4 +72,23 @@ Halide::Func fft2d_c2r(ComplexFunc c, int N0, int N1,
                        const Halide::Target &target,
                        const Fft2dDesc &desc = Fft2dDesc());
 
+enum class FftType { C2C,
+                     R2C,
+                     C2R };
+
+// Get a JIT compiled batched N0 x N1 2D FFT of the given type, with the given
+// gain, for target. Plans are cached by type, size, sign, gain and target, so
+// only the first call for each of these compiles anything. sign is ignored for
+// R2C (forward) and C2R (inverse) FFTs. Call the result with an input and an
+// output buffer of floats, whose last dimension is the batch:
+//
+//   C2C: (2, N0, N1, batch) -> (2, N0, N1, batch)
+//   R2C: (N0, N1, batch) -> (2, N0, N1 / 2 + 1, batch)
+//   C2R: (2, N0, N1 / 2 + 1, batch) -> (N0, N1, batch)
+//
+// where the dimension of extent 2 holds the real and imaginary parts of each
+// complex number.
+Halide::Callable fft2d_plan(FftType type, int N0, int N1, int sign, float gain,
+                            const Halide::Target &target);
+
 #endif
@@ -130,6 +130,33 @@ int main(int argc, char **argv) {
         }
     }
 
+    // Check that a batch of FFTs computed with cached plans round trips.
+    {
+        const int batch = 3;
+        Callable forward = fft2d_plan(FftType::C2C, W, H, -1, 1.0f, target);
+        Callable inverse = fft2d_plan(FftType::C2C, W, H, 1, 1.0f / (W * H), target);
+
+        Buffer<float, 4> signal(2, W, H, batch), spectrum(2, W, H, batch), round_trip(2, W, H, batch);
+        signal.for_each_value([](float &v) { v = (float)rand() / (float)RAND_MAX; });
+        if (forward(signal, spectrum) != 0 || inverse(spectrum, round_trip) != 0) {
+            printf("Calling the FFT plans failed\n");
+            return -1;
+        }
+        round_trip.copy_to_host();
+
+        bool ok = true;
+        round_trip.for_each_element([&](int c, int x, int y, int b) {
+            if (ok && fabs(round_trip(c, x, y, b) - signal(c, x, y, b)) > 1e-5f) {
+                printf("round_trip(%d, %d, %d, %d) = %f instead of %f\n",
+                       c, x, y, b, round_trip(c, x, y, b), signal(c, x, y, b));
+                ok = false;
+            }
+        });
+        if (!ok) {
+            return -1;
+        }
+    }
+
     // For a description of the methodology used here, see
     // http://www.fftw.org/speed/method.html
 
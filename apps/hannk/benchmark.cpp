@@ -1,6 +1,8 @@
 #include <chrono>
 #include <fstream>
 #include <iostream>
+#include <string_view>
+#include <thread>
 
 #include "HalideRuntime.h"
 
@@ -12,7 +14,46 @@
 
 namespace hannk {
 
-void run_benchmark(const std::string &filename, const InterpreterOptions &options) {
+// Identify the constant cache of the given model. (The cache keys include the
+// shapes of the tiled filters, which depend on the target.)
+std::string get_constant_cache_tag(const std::vector<char> &buffer) {
+    return std::to_string(std::hash<std::string_view>()(std::string_view(buffer.data(), buffer.size())));
+}
+
+void load_constant_cache(InterpreterOptions &options, const std::string &path, const std::vector<char> &buffer) {
+    options.constant_cache = std::make_shared<ConstantCache>();
+    if (!path.empty()) {
+        (void)options.constant_cache->load(path, get_constant_cache_tag(buffer));
+    }
+}
+
+void save_constant_cache(InterpreterOptions &options, const std::string &path, const std::vector<char> &buffer) {
+    if (!path.empty() && options.constant_cache->modified() &&
+        !options.constant_cache->save(path, get_constant_cache_tag(buffer))) {
+        HLOG(ERROR) << "Unable to save the constant cache to " << path;
+    }
+}
+
+// Measure each op of the prepared model separately, and write a line per op
+// of the form <model> <index> <name> <output bounds> <microseconds>,
+// separated by tabs, to f.
+void write_op_costs(const std::string &filename, Interpreter &interpreter, std::ostream &f) {
+    // Execute the whole model first, so every op's inputs have been computed.
+    interpreter.execute();
+    std::vector<Op *> ops = interpreter.ops();
+    for (int i = 0; i < (int)ops.size(); i++) {
+        Op *op = ops[i];
+        auto result = Halide::Tools::benchmark([op]() { op->execute(); });
+        f << filename << "\t" << i << "\t" << op->name() << "\t";
+        if (op->output_count() > 0) {
+            f << op->output()->bounds();
+        }
+        f << "\t" << result.wall_time * 1e6 << "\n";
+    }
+}
+
+void run_benchmark(const std::string &filename, InterpreterOptions options, const std::string &constant_cache_path,
+                   std::ostream *op_costs) {
     if (!options.trace) {
         // In trace mode, don't send *anything* to stdout
         std::cout << filename;
@@ -20,6 +61,9 @@ void run_benchmark(const std::string &filename, const InterpreterOptions &option
 
     std::vector<char> buffer = read_entire_file(filename);
     std::unique_ptr<OpGroup> model = parse_tflite_model_from_buffer(buffer.data());
+    if (!constant_cache_path.empty()) {
+        load_constant_cache(options, constant_cache_path, buffer);
+    }
 
     if (options.verbosity >= 1) {
         model->dump(std::cout);
@@ -31,19 +75,68 @@ void run_benchmark(const std::string &filename, const InterpreterOptions &option
         // TODO: probably better form to return an error here, but for now, this is fine.
         exit(1);
     }
+    if (!constant_cache_path.empty()) {
+        save_constant_cache(options, constant_cache_path, buffer);
+    }
 
     if (!options.trace) {
         auto result = Halide::Tools::benchmark([&]() { interpreter.execute(); });
-        std::cout << ": " << result.wall_time * 1e6 << " us" << std::endl;
+        std::cout << ": " << result.wall_time * 1e6 << " us, arena " << interpreter.arena_size() << " bytes" << std::endl;
 
         halide_profiler_report(nullptr);
         halide_profiler_reset();
+
+        if (op_costs) {
+            write_op_costs(filename, interpreter, *op_costs);
+        }
     } else {
         std::cout << std::endl;
         interpreter.execute();
     }
 }
 
+// Run streams interpreters of the model at once, sharing their constants,
+// and report the throughput of all of them together.
+void run_throughput_benchmark(const std::string &filename, InterpreterOptions options, int streams,
+                              const std::string &constant_cache_path) {
+    std::cout << filename;
+
+    std::vector<char> buffer = read_entire_file(filename);
+    load_constant_cache(options, constant_cache_path, buffer);
+
+    std::vector<std::unique_ptr<Interpreter>> interpreters;
+    size_t arena_size = 0;
+    for (int i = 0; i < streams; i++) {
+        std::unique_ptr<OpGroup> model = parse_tflite_model_from_buffer(buffer.data());
+        interpreters.emplace_back(new Interpreter(std::move(model), options));
+        if (!interpreters.back()->prepare()) {
+            std::cerr << "hannk::Interpreter::prepare() failed\n";
+            exit(1);
+        }
+        arena_size += interpreters.back()->arena_size();
+    }
+    save_constant_cache(options, constant_cache_path, buffer);
+
+    // Each sample executes every stream the same number of times.
+    constexpr int kRunsPerSample = 10;
+    auto result = Halide::Tools::benchmark([&]() {
+        std::vector<std::thread> threads;
+        for (auto &interpreter : interpreters) {
+            threads.emplace_back([&interpreter]() {
+                for (int i = 0; i < kRunsPerSample; i++) {
+                    interpreter->execute();
+                }
+            });
+        }
+        for (auto &t : threads) {
+            t.join();
+        }
+    });
+    const double inferences_per_second = streams * kRunsPerSample / result.wall_time;
+    std::cout << ": " << streams << " streams, " << inferences_per_second << " inferences/s, arena "
+              << arena_size << " bytes" << std::endl;
+}
+
 }  // namespace hannk
 
 // Change the visibility of the main function to support Hexagon where the
@@ -51,6 +144,9 @@ void run_benchmark(const std::string &filename, const InterpreterOptions &option
 // from other targets where we compile the file into an executable.
 __attribute__((visibility("default"))) int main(int argc, char **argv) {
     hannk::InterpreterOptions options;
+    int streams = 0;
+    std::string constant_cache_path;
+    std::string op_costs_path;
 
     for (int i = 1; i < argc; i++) {
         if (!strcmp(argv[i], "--verbose")) {
@@ -61,6 +157,26 @@ __attribute__((visibility("default"))) int main(int argc, char **argv) {
             options.trace = true;
             continue;
         }
+        if (!strcmp(argv[i], "--parallel_ops")) {
+            options.parallel_ops = true;
+            continue;
+        }
+        if (!strncmp(argv[i], "--strip_bytes=", 14)) {
+            options.strip_bytes = std::stoul(argv[i] + 14);
+            continue;
+        }
+        if (!strncmp(argv[i], "--constant_cache=", 17)) {
+            constant_cache_path = argv[i] + 17;
+            continue;
+        }
+        if (!strncmp(argv[i], "--op_costs=", 11)) {
+            op_costs_path = argv[i] + 11;
+            continue;
+        }
+        if (!strncmp(argv[i], "--streams=", 10)) {
+            streams = std::stoi(argv[i] + 10);
+            continue;
+        }
         if (argv[i][0] == '-') {
             HLOG(ERROR) << "Unknown flag: " << argv[i] << ".\n";
             exit(1);
@@ -72,11 +188,29 @@ __attribute__((visibility("default"))) int main(int argc, char **argv) {
         exit(1);
     }
 
+    if (streams > 0 && options.trace) {
+        HLOG(ERROR) << "You cannot specify --trace and --streams at the same time.\n";
+        exit(1);
+    }
+
+    std::ofstream op_costs;
+    if (!op_costs_path.empty()) {
+        op_costs.open(op_costs_path);
+        if (!op_costs) {
+            HLOG(ERROR) << "Unable to open " << op_costs_path << ".\n";
+            exit(1);
+        }
+    }
+
     for (int i = 1; i < argc; i++) {
         if (!strncmp(argv[i], "--", 2)) {
             continue;
         }
-        hannk::run_benchmark(argv[i], options);
+        if (streams > 0) {
+            hannk::run_throughput_benchmark(argv[i], options, streams, constant_cache_path);
+        } else {
+            hannk::run_benchmark(argv[i], options, constant_cache_path, op_costs.is_open() ? &op_costs : nullptr);
+        }
     }
 
     std::cout << "Done!\n";
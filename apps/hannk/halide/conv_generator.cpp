@@ -1,5 +1,6 @@
 #include "Halide.h"
 #include "halide/common_halide.h"
+#include "halide/constants.h"
 
 using namespace Halide;
 using namespace Halide::BoundaryConditions;
@@ -42,6 +43,11 @@ public:
     // to load vectors, so making this value larger helps for big reductions.
     GeneratorParam<int> unroll_reduction_{"unroll_reduction", 4};
 
+    // If true, add a residual tensor to the (quantized) result of the
+    // convolution before storing it, the same way the Add op would, so
+    // the result of the convolution doesn't need to be stored.
+    GeneratorParam<bool> residual_add_{"residual_add", false};
+
     // Unsigned 8-bit input tensor, indexed by c, x, y, b.
     Input<Buffer<uint8_t, 4>> input_{"input"};
     Input<uint8_t> input_zero_{"input_zero"};
@@ -72,12 +78,32 @@ public:
 
     Output<Buffer<void, 4>> output_{"output"};
 
+    // If residual_add is true, these are appended to the inputs above. The
+    // output_* inputs above then describe the quantization of the result of
+    // the convolution, and sum_* describe that of the output.
+    Input<Buffer<uint8_t, 4>> *residual_ = nullptr;
+    Input<uint8_t> *residual_zero_ = nullptr;
+    Input<int16_t> *residual_multiplier_ = nullptr;
+    Input<int16_t> *conv_multiplier_ = nullptr;
+    Input<uint8_t> *sum_zero_ = nullptr;
+    Input<uint8_t> *sum_min_ = nullptr;
+    Input<uint8_t> *sum_max_ = nullptr;
+
     void configure() {
         if (use_8bit_multiply(target)) {
             filter_.set_type(UInt(8));
         } else {
             filter_.set_type(Int(16));
         }
+        if (residual_add_) {
+            residual_ = add_input<Buffer<uint8_t, 4>>("residual");
+            residual_zero_ = add_input<uint8_t>("residual_zero");
+            residual_multiplier_ = add_input<int16_t>("residual_multiplier");
+            conv_multiplier_ = add_input<int16_t>("conv_multiplier");
+            sum_zero_ = add_input<uint8_t>("sum_zero");
+            sum_min_ = add_input<uint8_t>("sum_min");
+            sum_max_ = add_input<uint8_t>("sum_max");
+        }
     }
 
     void generate() {
@@ -156,6 +182,16 @@ public:
         } else {
             output = quantize_i16(convolved(c, x, y, b), output_multiplier_, output_shift_, target);
         }
+        if (residual_add_) {
+            // This matches the Add generator, with the convolution as input1.
+            Expr conv = (i16(output) - i16(output_zero_)) << add_input_shift;
+            Expr residual = (i16((*residual_)(c, x, y, b)) - i16(*residual_zero_)) << add_input_shift;
+            conv = widening_mul(conv, *conv_multiplier_);
+            residual = widening_mul(residual, *residual_multiplier_);
+            output = i16_sat(rounding_shift_right(conv + residual, add_output_shift));
+            output = u8_sat(saturating_add(output, *sum_zero_));
+            output = clamp(output, *sum_min_, *sum_max_);
+        }
         output_(c, x, y, b) = output;
 
         // Schedule
@@ -164,6 +200,12 @@ public:
         interpret_as_tensor(output_);
         require_same_min_extent(3, input_, output_);
         require_same_min_extent(0, bias_, output_);
+        if (residual_add_) {
+            interpret_as_tensor(*residual_);
+            for (int d = 0; d < 4; d++) {
+                require_same_min_extent(d, *residual_, output_);
+            }
+        }
 
         const int filter_alignment = vector_reduction * accum_vector_size;
         filter_.set_host_alignment(filter_alignment * filter_.type().bytes());
@@ -216,9 +258,11 @@ public:
         }
 
         // In case there are no suitable tile sizes, just make a dummy split so the
-        // rest of the schedule still works.
+        // rest of the schedule still works. The residual must not be read out of
+        // bounds, so it needs its loads predicated too.
+        const TailStrategy tail_c = residual_add_ ? TailStrategy::Predicate : TailStrategy::PredicateStores;
         output_
-            .split(c, co, c, accum_vector_size * min_tile_c, TailStrategy::PredicateStores)
+            .split(c, co, c, accum_vector_size * min_tile_c, tail_c)
             .split(x, xo, x, 1)
             .reorder(c, x, co, xo, y, b)
             .vectorize(c);
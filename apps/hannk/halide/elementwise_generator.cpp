@@ -155,12 +155,14 @@ public:
         Expr arg2 = program_(2, r.y);
         Expr arg3 = cast(intermediate_type, program_(3, r.y));
         Expr arg4 = cast(intermediate_type, program_(4, r.y));
+        Expr arg5 = program_(5, r.y);
 
         Expr slot = r.y + 1;
 
         const int max_input = input_count - 1;
         Expr input1 = scratch(x, y, unsafe_promise_clamped(i32(arg1), -max_input - 1, slot));
         Expr input2 = scratch(x, y, unsafe_promise_clamped(i32(arg2), -max_input - 1, slot));
+        Expr input3 = scratch(x, y, unsafe_promise_clamped(i32(arg5), -max_input - 1, slot));
 
         std::vector<Expr> instructions = {
             scratch(x, y, slot),
@@ -174,6 +176,7 @@ public:
             clamp(input1, arg3, arg4),
             rounding_shift_right(approx_logistic(q, input1, input2 + arg3, intermediate_type), q - arg4),
             rounding_shift_right(approx_tanh(q, input1, input2 + arg3, intermediate_type), q - arg4),
+            saturating_add(rounding_mul_shift_right(input1, input2 + arg3, cast(unsigned_intermediate, arg4)), input3),
         };
         r.where(r.x == op);
         scratch(x, y, slot) = mux(r.x, instructions);
@@ -60,6 +60,30 @@ void AllocationPlanner::commit() {
 
 #else
 
+    // Neither of these heuristics is uniformly better than the other, so
+    // try both, and use whichever needs less memory.
+    plan_greedy_by_size();
+    const size_t by_size_needed = memory_needed();
+    std::vector<size_t> by_size_offsets;
+    for (auto &r : block_requirements_) {
+        by_size_offsets.push_back(r.calculated_offset);
+        r.calculated_offset = kInvalidOffset;
+    }
+
+    plan_greedy_by_breadth();
+    if (memory_needed() > by_size_needed) {
+        for (size_t i = 0; i < block_requirements_.size(); i++) {
+            block_requirements_[i].calculated_offset = by_size_offsets[i];
+        }
+    }
+#endif  // HANNK_USE_TRIVIAL_ALLOCATION_PLANNER
+
+#ifndef NDEBUG
+    check_overlap();
+#endif
+}
+
+void AllocationPlanner::plan_greedy_by_size() {
     // Use a basic greedy algorithm to lay out the buffers;
     // the basic idea here is to start with the largest block,
     // then progress into smaller blocks, picking out the first large-enough
@@ -165,11 +189,95 @@ void AllocationPlanner::commit() {
             offsets.push_back(req);
         }
     }
-#endif  // HANNK_USE_TRIVIAL_ALLOCATION_PLANNER
+}
 
-#ifndef NDEBUG
-    check_overlap();
-#endif
+size_t AllocationPlanner::find_best_fit_offset(const BlockRequirements &req) const {
+    // Find the blocks already placed that are live at the same time as req,
+    // in order of offset.
+    std::vector<const BlockRequirements *> live;
+    for (const auto &r : block_requirements_) {
+        if (r.calculated_offset == kInvalidOffset) {
+            continue;
+        }
+        const bool has_time_overlap = !(r.first_use > req.last_use || req.first_use > r.last_use);
+        if (has_time_overlap) {
+            live.push_back(&r);
+        }
+    }
+    std::sort(live.begin(), live.end(),
+              [](const BlockRequirements *a, const BlockRequirements *b) -> bool {
+                  return a->calculated_offset < b->calculated_offset;
+              });
+
+    // Use the smallest gap between them that fits, or the end of them if
+    // there is none.
+    size_t best_offset = kInvalidOffset;
+    size_t best_gap = std::numeric_limits<size_t>::max();
+    size_t candidate_offset = 0;
+    for (const BlockRequirements *r : live) {
+        if (r->calculated_offset >= candidate_offset) {
+            const size_t gap = r->calculated_offset - candidate_offset;
+            if (gap >= req.size_needed && gap < best_gap) {
+                best_offset = candidate_offset;
+                best_gap = gap;
+            }
+        }
+        candidate_offset = std::max(candidate_offset, align_up(r->calculated_offset + r->size_needed, alignment_));
+    }
+    return best_offset != kInvalidOffset ? best_offset : candidate_offset;
+}
+
+void AllocationPlanner::plan_greedy_by_breadth() {
+    // This is the "greedy by breadth" strategy of TFLite's GPU delegate: find
+    // the total size of the blocks live at each point in time, and place the
+    // blocks live at the busiest times first, as those times determine the
+    // memory needed. Within each time, place the larger blocks first.
+    std::vector<int> times;
+    for (const auto &r : block_requirements_) {
+        times.push_back(r.first_use);
+    }
+    std::sort(times.begin(), times.end());
+    times.erase(std::unique(times.begin(), times.end()), times.end());
+
+    std::vector<std::pair<size_t, int>> breadths;
+    breadths.reserve(times.size());
+    for (int t : times) {
+        size_t breadth = 0;
+        for (const auto &r : block_requirements_) {
+            if (r.first_use <= t && t <= r.last_use) {
+                breadth += r.size_needed;
+            }
+        }
+        breadths.emplace_back(breadth, t);
+    }
+    // Sort in decreasing order of breadth; if equal, by increasing time.
+    std::sort(breadths.begin(), breadths.end(),
+              [](const std::pair<size_t, int> &a, const std::pair<size_t, int> &b) -> bool {
+                  if (a.first != b.first) {
+                      return a.first > b.first;
+                  }
+                  return a.second < b.second;
+              });
+
+    for (const auto &it : breadths) {
+        const int t = it.second;
+        std::vector<BlockRequirements *> unplaced;
+        for (auto &r : block_requirements_) {
+            if (r.calculated_offset == kInvalidOffset && r.first_use <= t && t <= r.last_use) {
+                unplaced.push_back(&r);
+            }
+        }
+        std::sort(unplaced.begin(), unplaced.end(),
+                  [](BlockRequirements *a, BlockRequirements *b) -> bool {
+                      if (a->size_needed != b->size_needed) {
+                          return a->size_needed > b->size_needed;
+                      }
+                      return a->first_use < b->first_use;
+                  });
+        for (BlockRequirements *r : unplaced) {
+            r->calculated_offset = find_best_fit_offset(*r);
+        }
+    }
 }
 
 size_t AllocationPlanner::memory_needed() const {
@@ -16,6 +16,10 @@ public:
     // Specify a block's size and lifetime. Return an id for the block, which will later
     // be used to retrieve the final layout info via get_block_offset(). Note that -- by design! --
     // the same offset may be returned for multiple blocks.
+    //
+    // first_use and last_use are inclusive, and may be in any units of time: blocks
+    // whose lifetimes share any point in time are never overlapped. (If several ops
+    // execute concurrently, their uses must all be given the same time.)
     int add_block(size_t size, int first_use, int last_use);
 
     // How many blocks have been added to the planner.
@@ -57,6 +61,16 @@ private:
 
     bool committed_ = false;
 
+    // Lay out the blocks in decreasing order of size, each at the first gap
+    // it fits in.
+    void plan_greedy_by_size();
+    // Lay out the blocks live at the times with the most memory in use
+    // first, each at the smallest gap it fits in.
+    void plan_greedy_by_breadth();
+    // The offset of the smallest gap that fits req among the blocks that
+    // have been placed already.
+    size_t find_best_fit_offset(const BlockRequirements &req) const;
+
     void check_overlap();
 };
 
@@ -31,6 +31,8 @@ const char *ElementwiseAssembler::to_string(OpCode op) {
         return "Logistic";
     case Tanh:
         return "Tanh";
+    case MulShiftAdd:
+        return "MulShiftAdd";
     default:
         return "Unknown";
     }
@@ -63,6 +65,8 @@ int get_opcode_operand_mask(ElementwiseAssembler::OpCode op) {
         return 0xf;
     case ElementwiseAssembler::Tanh:
         return 0xf;
+    case ElementwiseAssembler::MulShiftAdd:
+        return 0x1f;
     default:
         return 0;
     }
@@ -70,13 +74,14 @@ int get_opcode_operand_mask(ElementwiseAssembler::OpCode op) {
 
 }  // namespace
 
-Slot ElementwiseAssembler::add_instruction(OpCode op, Slot op1, Slot op2, int16_t op3, int16_t op4) {
+Slot ElementwiseAssembler::add_instruction(OpCode op, Slot op1, Slot op2, int16_t op3, int16_t op4, Slot op5) {
     assert(size < instructions.dim(1).extent());
     instructions(0, size) = op;
     instructions(1, size) = op1.index;
     instructions(2, size) = op2.index;
     instructions(3, size) = op3;
     instructions(4, size) = op4;
+    instructions(5, size) = op5.index;
     // Slot 0 is the constant 0, instructions start after that.
     size++;
     return {(int16_t)size};
@@ -112,10 +117,10 @@ void ElementwiseAssembler::disassemble(std::ostream &output) {
             << std::setw(12) << std::left << to_string(op);
 
         int mask = get_opcode_operand_mask(op);
-        for (int j = 0; j < 4; j++) {
+        for (int j = 0; j < InstructionSize - 1; j++) {
             if (mask & (1 << j)) {
                 int16_t operand = instructions(j + 1, i);
-                if (j < 2) {
+                if (j < 2 || j == 4) {
                     if (operand < 0) {
                         output << "input[" << -operand - 1 << "] ";
                     } else if (operand > 0) {
@@ -184,6 +189,14 @@ Slot ElementwiseAssembler::mul_shift(Slot a, int16_t b, int16_t shift) {
     return add_instruction(MulShift, a, constant(0), b, shift);
 }
 
+Slot ElementwiseAssembler::mul_shift_add(Slot a, Slot b, int16_t shift, Slot c) {
+    return add_instruction(MulShiftAdd, a, b, 0, shift, c);
+}
+
+Slot ElementwiseAssembler::mul_shift_add(Slot a, int16_t b, int16_t shift, Slot c) {
+    return add_instruction(MulShiftAdd, a, constant(0), b, shift, c);
+}
+
 Slot ElementwiseAssembler::shift(Slot a, Slot b, int16_t extra_shift) {
     return add_instruction(Shift, a, b, extra_shift);
 }
@@ -11,7 +11,7 @@ namespace hannk {
 
 class ElementwiseAssembler {
 public:
-    // Every instruction can use two memory locations op1 and op2, and immediates op3 and op4.
+    // Every instruction can use three memory locations op1, op2, and op5, and immediates op3 and op4.
     // Memory location 0 is the constant 0.
     enum OpCode {
         // Nothing
@@ -36,13 +36,15 @@ public:
         Logistic,
         // tanh(load(op1) / 2^(load(op2) + op3)) * 2^op4
         Tanh,
+        // saturating_add(rounding_mul_shift_right(load(op1), load(op2) + op3, op4), load(op5))
+        MulShiftAdd,
         OpCodeCount,
     };
     static const char *to_string(OpCode op);
 
     enum {
         // The "width" of each instruction.
-        InstructionSize = 5,
+        InstructionSize = 6,
     };
 
     // Represents a scratch slot. Can't be implicitly converted to an integer to
@@ -55,7 +57,7 @@ private:
     Halide::Runtime::Buffer<int16_t, 2> instructions;
     int size = 0;
 
-    Slot add_instruction(OpCode op, Slot op1, Slot op2, int16_t op3, int16_t op4 = 0);
+    Slot add_instruction(OpCode op, Slot op1, Slot op2, int16_t op3, int16_t op4 = 0, Slot op5 = {0});
 
 public:
     // Create an assembler that builds programs in the given buffer.
@@ -85,6 +87,8 @@ public:
     Slot mul_add(Slot a, int16_t b, int16_t add);
     Slot mul_shift(Slot a, Slot b, int16_t shift);
     Slot mul_shift(Slot a, int16_t b, int16_t shift);
+    Slot mul_shift_add(Slot a, Slot b, int16_t shift, Slot c);
+    Slot mul_shift_add(Slot a, int16_t b, int16_t shift, Slot c);
     Slot shift(Slot a, Slot shift, int16_t extra_shift = 0);
     Slot shift(Slot a, int16_t shift);
     Slot min(Slot a, Slot b, int16_t add_b = 0);
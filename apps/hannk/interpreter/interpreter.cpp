@@ -1,5 +1,6 @@
 #include "interpreter/interpreter.h"
 #include "interpreter/allocation_planner.h"
+#include "interpreter/ops.h"
 #include "interpreter/transforms.h"
 #include "util/error_util.h"
 
@@ -28,8 +29,12 @@ class TensorVisitor : public OpVisitor {
     virtual void visit_tensor(const TensorPtr &t) = 0;
 
     void visit(const OpGroup *g) override {
+        depth_++;
         for (int i = 0; i < g->op_count(); i++) {
             op_index_++;
+            if (depth_ == 1) {
+                root_op_index_++;
+            }
             const Op *op = g->op(i);
             for (int j = 0; j < op->input_count(); j++) {
                 visit_tensor(op->input(j));
@@ -39,14 +44,22 @@ class TensorVisitor : public OpVisitor {
             }
             op->accept(this);
         }
+        depth_--;
     }
 
     int op_index_ = -1;
+    int root_op_index_ = -1;
+    int depth_ = 0;
 
 public:
     int op_index() const {
         return op_index_;
     }
+
+    // The index of the op of the root OpGroup that contains the current op.
+    int root_op_index() const {
+        return root_op_index_;
+    }
 };
 
 struct TensorAllocationInfo {
@@ -65,6 +78,9 @@ bool needs_arena_allocation(const TensorPtr &t) {
 }
 
 class FindAllocatableTensors : public TensorVisitor {
+    // The step in which each op executes, or empty if the ops execute in order.
+    const std::vector<int> &op_steps_;
+
     void visit_tensor(const TensorPtr &t) override {
         if (!needs_arena_allocation(t)) {
             return;
@@ -75,22 +91,30 @@ class FindAllocatableTensors : public TensorVisitor {
         auto &info = tensor_info[storage];
         assert(info.size_needed == 0 || info.size_needed == storage->storage_size());
 
+        // Measure lifetimes in steps, so that tensors used by ops that
+        // execute concurrently are never given overlapping memory.
+        const int use = op_steps_.empty() ? op_index() : op_steps_.at(root_op_index());
         info.size_needed = storage->storage_size();
-        info.first_use = std::min(info.first_use, op_index());
-        info.last_use = std::max(info.last_use, op_index());
+        info.first_use = std::min(info.first_use, use);
+        info.last_use = std::max(info.last_use, use);
         // leave block_index as -1
         info.tensors.insert(t);
     }
 
 public:
+    explicit FindAllocatableTensors(const std::vector<int> &op_steps)
+        : op_steps_(op_steps) {
+    }
+
     // Iteration order matters, so don't use unordered_map without consideration.
     std::map<TensorStoragePtr, TensorAllocationInfo> tensor_info;
 };
 
-std::unique_ptr<char[]> allocate_tensors(const Op *root, const InterpreterOptions &options) {
+std::unique_ptr<char[]> allocate_tensors(const Op *root, const std::vector<int> &op_steps, const InterpreterOptions &options,
+                                         size_t *arena_size) {
     // Find the tensors that we want to allocate in an arena,
     // along the needed storage size and lifetime for each.
-    FindAllocatableTensors find_tensors;
+    FindAllocatableTensors find_tensors(op_steps);
     root->accept(&find_tensors);
 
     if (options.verbosity >= 1) {
@@ -133,6 +157,7 @@ std::unique_ptr<char[]> allocate_tensors(const Op *root, const InterpreterOption
     }
 
     // Allocate the chunk we need. Be sure to over-allocate for alignment.
+    *arena_size = planner.memory_needed();
     std::unique_ptr<char[]> arena(new char[planner.memory_needed() + alignment]);
     assert(arena != nullptr);
 
@@ -153,6 +178,94 @@ std::unique_ptr<char[]> allocate_tensors(const Op *root, const InterpreterOption
     return arena;
 }
 
+// Group the ops of the (flattened) root OpGroup into steps of ops that can
+// execute concurrently, and tell the OpGroup to execute them that way.
+class ScheduleOps : public OpMutator {
+    using OpMutator::visit;
+
+    // Ops communicate through memory, so track accesses by TensorStorage
+    // for tensors that have (or may share) one, so that aliases of a tensor
+    // are treated as the same memory.
+    static const void *memory_key(const TensorPtr &t) {
+        if (t->alias_type() != AliasType::None || needs_arena_allocation(t)) {
+            return t->storage().get();
+        }
+        return t.get();
+    }
+
+    OpPtr visit(std::unique_ptr<OpGroup> op) override {
+        // The last step in which each piece of memory is written and read,
+        // and in which each tensor is written.
+        std::map<const void *, int> last_write, last_read;
+        std::map<const Tensor *, int> last_tensor_write;
+
+        const auto last_step = [](const auto &m, const auto *key) {
+            auto it = m.find(key);
+            return it != m.end() ? it->second : -1;
+        };
+
+        std::vector<std::vector<int>> steps;
+        op_steps.resize(op->op_count());
+        for (int i = 0; i < op->op_count(); i++) {
+            const Op *op_i = op->op(i);
+            // An op must execute after anything that writes memory it
+            // reads (or writes the same tensor it does), and after
+            // anything that reads memory it writes. Distinct tensors that
+            // share memory (e.g. the inputs of a concatenation aliased
+            // to its output) may be written concurrently.
+            int step = 0;
+            for (int j = 0; j < op_i->input_count(); j++) {
+                if (const TensorPtr &t = op_i->input(j)) {
+                    step = std::max(step, last_step(last_write, memory_key(t)) + 1);
+                }
+            }
+            for (int j = 0; j < op_i->output_count(); j++) {
+                if (const TensorPtr &t = op_i->output(j)) {
+                    const void *key = memory_key(t);
+                    step = std::max(step, last_step(last_read, key) + 1);
+                    step = std::max(step, last_step(last_tensor_write, t.get()) + 1);
+                }
+            }
+
+            for (int j = 0; j < op_i->input_count(); j++) {
+                if (const TensorPtr &t = op_i->input(j)) {
+                    int &r = last_read.emplace(memory_key(t), -1).first->second;
+                    r = std::max(r, step);
+                }
+            }
+            for (int j = 0; j < op_i->output_count(); j++) {
+                if (const TensorPtr &t = op_i->output(j)) {
+                    int &w = last_write.emplace(memory_key(t), -1).first->second;
+                    w = std::max(w, step);
+                    last_tensor_write[t.get()] = step;
+                }
+            }
+
+            if (step >= (int)steps.size()) {
+                steps.resize(step + 1);
+            }
+            steps[step].push_back(i);
+            op_steps[i] = step;
+        }
+
+        if (options_.verbosity >= 1) {
+            HLOG(INFO) << "Scheduled " << op->op_count() << " ops in " << steps.size() << " steps";
+        }
+        op->set_steps(std::move(steps));
+        return op;
+    }
+
+    const InterpreterOptions &options_;
+
+public:
+    explicit ScheduleOps(const InterpreterOptions &options)
+        : options_(options) {
+    }
+
+    // The step in which each op of the root OpGroup executes.
+    std::vector<int> op_steps;
+};
+
 class VerifyAllAllocated : public TensorVisitor {
     void visit_tensor(const TensorPtr &t) override {
         if (!needs_arena_allocation(t)) {
@@ -253,10 +366,19 @@ bool Interpreter::prepare() {
     }
     dump_model("Model after pad_for_ops():", 3);
 
+    // Fuse ops before in_place(), which would otherwise alias the
+    // intermediate tensors we want to remove.
+    model_ = fuse_ops(std::move(model_));
+    if (!model_) {
+        HLOG(ERROR) << "fuse_ops() failed.";
+        return false;
+    }
+    dump_model("Model after fuse_ops():", 3);
+
     model_ = in_place(std::move(model_));
     dump_model("Model after in_place():", 3);
 
-    model_ = fold_constants(std::move(model_));
+    model_ = fold_constants(std::move(model_), options_.constant_cache.get());
     dump_model("Model after fold_constants():", 3);
 
     model_ = flatten_groups(std::move(model_));
@@ -275,8 +397,22 @@ bool Interpreter::prepare() {
 #ifndef NDEBUG
     do_check_op_order(model_.get());
 #endif
+
+    if (options_.strip_bytes > 0) {
+        model_ = tile_op_chains(std::move(model_), options_.strip_bytes, options_.verbosity);
+        dump_model("Model after tile_op_chains:", 3);
+    }
+    // Schedule the ops before allocating tensors, since which tensors can
+    // share memory depends on which ops may execute concurrently.
+    std::vector<int> op_steps;
+    if (options_.parallel_ops) {
+        ScheduleOps scheduler(options_);
+        model_ = scheduler.mutate(std::move(model_));
+        op_steps = std::move(scheduler.op_steps);
+    }
+
     assert(tensor_storage_arena_ == nullptr);
-    tensor_storage_arena_ = allocate_tensors(model_.get(), options_);
+    tensor_storage_arena_ = allocate_tensors(model_.get(), op_steps, options_, &tensor_storage_arena_size_);
 
 #ifndef NDEBUG
     VerifyAllAllocated verify_all;
@@ -297,6 +433,132 @@ void Interpreter::execute() {
     model_->execute();
 }
 
+namespace {
+
+class UncropTensors : public TensorVisitor {
+    void visit_tensor(const TensorPtr &t) override {
+        if (t && !t->is_dynamic()) {
+            t->crop(t->uncropped_bounds());
+        }
+    }
+};
+
+// Infer the bounds of the tensors of the ops in the root OpGroup, given the
+// bounds of some of them. TensorVisitor doesn't suffice here, because ops
+// nested within the root OpGroup (e.g. tiled op chains) are opaque.
+class InferTensorBounds : public OpVisitor {
+    using OpVisitor::visit;
+
+    Box get_bounds(const TensorPtr &t) const {
+        auto it = bounds.find(t.get());
+        return it != bounds.end() ? it->second : t->bounds();
+    }
+
+    void infer(const Op *op) {
+        std::vector<Box> input_bounds;
+        bool changed = false;
+        for (int i = 0; i < op->input_count(); i++) {
+            const TensorPtr &t = op->input(i);
+            input_bounds.push_back(t ? get_bounds(t) : Box());
+            changed = changed || (t && input_bounds.back() != t->bounds());
+        }
+        if (!changed || !ok) {
+            return;
+        }
+        if (!op->supports_smaller_bounds()) {
+            HLOG(ERROR) << op->name() << " does not support smaller bounds";
+            ok = false;
+            return;
+        }
+        for (int i = 0; i < op->output_count(); i++) {
+            const TensorPtr &t = op->output(i);
+            if (t->is_dynamic()) {
+                HLOG(ERROR) << op->name() << " has a dynamic output";
+                ok = false;
+                return;
+            }
+            Box b = op->infer_output_bounds(i, input_bounds);
+            if (b[0] != t->bounds(0)) {
+                HLOG(ERROR) << op->name() << " would change the innermost dimension of " << t->name();
+                ok = false;
+                return;
+            }
+            for (const Interval &d : b) {
+                if (d.empty()) {
+                    HLOG(ERROR) << op->name() << " would produce an empty " << t->name();
+                    ok = false;
+                    return;
+                }
+            }
+            bounds[t.get()] = std::move(b);
+        }
+    }
+
+    void visit_leaf(const Op *op) override {
+        infer(op);
+    }
+
+    void visit(const OpGroup *op) override {
+        if (depth_ > 0) {
+            infer(op);
+            return;
+        }
+        depth_++;
+        for (int i = 0; i < op->op_count(); i++) {
+            op->op(i)->accept(this);
+        }
+        depth_--;
+    }
+
+    int depth_ = 0;
+
+public:
+    std::map<Tensor *, Box> bounds;
+    bool ok = true;
+};
+
+}  // namespace
+
+bool Interpreter::set_input_bounds(const std::vector<Box> &bounds) {
+    if (!prepared_) {
+        HLOG(ERROR) << "Must call prepare() before set_input_bounds()";
+        return false;
+    }
+    if ((int)bounds.size() != model_->input_count()) {
+        HLOG(ERROR) << "Expected bounds for " << model_->input_count() << " inputs, got " << bounds.size();
+        return false;
+    }
+
+    UncropTensors uncrop;
+    model_->accept(&uncrop);
+
+    InferTensorBounds infer;
+    for (int i = 0; i < model_->input_count(); i++) {
+        const TensorPtr &t = model_->input(i);
+        const Box full = t->bounds();
+        bool valid = bounds[i].size() == full.size() && !bounds[i].empty() && bounds[i][0] == full[0];
+        for (int d = 0; valid && d < (int)full.size(); d++) {
+            valid = bounds[i][d].min == full[d].min &&
+                    bounds[i][d].max <= full[d].max &&
+                    !bounds[i][d].empty();
+        }
+        if (!valid) {
+            HLOG(ERROR) << "Invalid bounds for input " << t->name();
+            return false;
+        }
+        infer.bounds[t.get()] = bounds[i];
+    }
+    model_->accept(&infer);
+    if (!infer.ok) {
+        return false;
+    }
+
+    for (const auto &i : infer.bounds) {
+        i.first->crop(i.second);
+    }
+    return true;
+}
+
 TensorPtr Interpreter::get_tensor(const std::string &name) {
     HCHECK(prepared_);
 
@@ -359,6 +621,33 @@ std::vector<TensorPtr> Interpreter::inputs() {
     return result;
 }
 
+std::vector<Op *> Interpreter::ops() {
+    HCHECK(prepared_);
+
+    class FindOps : public OpMutator {
+        using OpMutator::visit;
+
+        OpPtr visit_leaf(OpPtr op) override {
+            result.push_back(op.get());
+            return op;
+        }
+
+        OpPtr visit(std::unique_ptr<OpGroup> op) override {
+            for (int i = 0; i < op->op_count(); i++) {
+                result.push_back(op->op(i));
+            }
+            return op;
+        }
+
+    public:
+        std::vector<Op *> result;
+    };
+
+    FindOps finder;
+    model_ = finder.mutate(std::move(model_));
+    return finder.result;
+}
+
 std::vector<TensorPtr> Interpreter::outputs() {
     HCHECK(prepared_);
     std::vector<TensorPtr> result;
@@ -14,11 +14,33 @@ struct InterpreterOptions {
 
     // Whether to enable tracing.
     bool trace = false;
+
+    // Whether to run independent ops concurrently. If true, prepare() groups
+    // the ops into a series of steps, each of which contains ops that don't
+    // depend on each other, and execute() runs the ops of each step in
+    // parallel on the Halide thread pool (which the ops also use for their
+    // own parallelism). Tensors used in the same step can't share arena
+    // memory, so this may need a larger arena.
+    bool parallel_ops = false;
+
+    // If nonzero, chains of convolutions (and pads) that consume each other's
+    // outputs are executed in strips of rows, such that the intermediate
+    // tensors of each strip need at most this many bytes. Choosing this to be
+    // about the size of the L2 cache lets the intermediates stay in cache.
+    size_t strip_bytes = 0;
+
+    // If not null, constant tensors computed by prepare() (such as tiled
+    // filters) are shared with other Interpreters using the same cache,
+    // for models parsed from the same buffer. Each Interpreter still has
+    // its own arena for the other tensors, so the Interpreters can
+    // execute concurrently.
+    std::shared_ptr<ConstantCache> constant_cache;
 };
 
 class Interpreter {
     OpPtr model_;
     std::unique_ptr<char[]> tensor_storage_arena_;
+    size_t tensor_storage_arena_size_ = 0;
     InterpreterOptions options_;
     bool prepared_ = false;
 
@@ -42,12 +64,34 @@ public:
 
     void execute();
 
+    // Set the bounds of the inputs of the model to be used by subsequent calls
+    // to execute(). The bounds must have the same mins as the bounds the model
+    // was prepared for, and may only be smaller than them in dimensions other
+    // than the innermost. The bounds of the other tensors are inferred from
+    // them, so this doesn't need to prepare or allocate anything again.
+    //
+    // Returns false if the model can't execute with these bounds (e.g. if it
+    // has an op that doesn't support smaller bounds that would be affected),
+    // in which case the model still uses the bounds it was prepared for.
+    [[nodiscard]] bool set_input_bounds(const std::vector<Box> &bounds);
+
     // Return the Tensor(s) that are the initial input(s) of the Model.
     std::vector<TensorPtr> inputs();
 
     // Return the Tensor(s) that are the final output(s) of the Model.
     std::vector<TensorPtr> outputs();
 
+    // Return the ops that execute() runs, in order. Ops that prepare() grouped
+    // together (e.g. chains of convolutions executed in strips) are one op.
+    // This is for tools that measure the ops individually; executing an op
+    // is only meaningful after executing the ops before it.
+    std::vector<Op *> ops();
+
+    // The size of the arena prepare() allocated for the model's intermediate tensors.
+    size_t arena_size() const {
+        return tensor_storage_arena_size_;
+    }
+
     // Movable but not copyable.
     Interpreter() = delete;
     Interpreter(const Interpreter &) = delete;
@@ -57,10 +57,8 @@ OpPtr lower_tflite_lstm(TensorPtr data_input, TensorPtr prev_activ_input, Tensor
     auto forget_gate_output = p.logistic(q, forget_gate, q - 3);
     auto output_gate_output = p.logistic(q, output_gate, q - 3);
 
-    auto input_times_input_modulation = p.mul_shift(input_gate_output, input_modulation_gate_output, q + 4);
     auto prev_state_times_forget_state = p.mul(forget_gate_output, prev_state);
-
-    auto state = p.add(input_times_input_modulation, prev_state_times_forget_state);
+    auto state = p.mul_shift_add(input_gate_output, input_modulation_gate_output, q + 4, prev_state_times_forget_state);
     auto activ = p.mul_add(output_gate_output, p.tanh(7, state, q - 4), 128);
     // Reload new_state so it's in the right place for the outputs.
     // TODO: Make the assembler smart enough to do this itself.
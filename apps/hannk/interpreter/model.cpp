@@ -2,6 +2,9 @@
 #include "interpreter/ops.h"
 #include "util/error_util.h"
 
+#include "HalideBuffer.h"  // for HALIDE_RUNTIME_BUFFER_ALLOCATION_ALIGNMENT
+#include "HalideRuntime.h"
+
 #include <cmath>
 #include <list>
 
@@ -95,16 +98,131 @@ bool OpGroup::prepare() {
     return true;
 }
 
+namespace {
+
+struct StepClosure {
+    OpGroup *group;
+    const std::vector<int> *step;
+};
+
+int execute_op_task(void *user_context, int i, uint8_t *closure) {
+    const StepClosure *c = (const StepClosure *)closure;
+    c->group->op((*c->step)[i])->execute();
+    return 0;
+}
+
+}  // namespace
+
 void OpGroup::execute() {
-    for (int i = 0; i < op_count(); i++) {
+    if (steps_.empty()) {
+        for (int i = 0; i < op_count(); i++) {
+#if HANNK_PROFILER
+            HannkOpInvokeStart();
+#endif
+            op(i)->execute();
+#if HANNK_PROFILER
+            HannkOpInvokeEnd(op(i)->name().c_str(), i);
+#endif
+        }
+        return;
+    }
+
+    for (const auto &step : steps_) {
+        if (step.size() == 1) {
 #if HANNK_PROFILER
-        HannkOpInvokeStart();
+            HannkOpInvokeStart();
 #endif
-        op(i)->execute();
+            op(step[0])->execute();
 #if HANNK_PROFILER
-        HannkOpInvokeEnd(op(i)->name().c_str(), i);
+            HannkOpInvokeEnd(op(step[0])->name().c_str(), step[0]);
 #endif
+            continue;
+        }
+        // The profiler hooks assume one op runs at a time, so ops that
+        // run concurrently aren't reported to them.
+        StepClosure closure = {this, &step};
+        int result = halide_do_par_for(nullptr, execute_op_task, 0, (int)step.size(), (uint8_t *)&closure);
+        HCHECK(result == 0) << "halide_do_par_for() failed: " << result;
+    }
+}
+
+TiledOpGroup::TiledOpGroup(std::vector<TensorPtr> inputs, std::vector<TensorPtr> outputs, std::vector<OpPtr> ops,
+                           int strip_dim, std::vector<std::vector<Box>> strip_crops)
+    : OpGroup(std::move(inputs), std::move(outputs), std::move(ops)),
+      strip_dim_(strip_dim), strip_crops_(std::move(strip_crops)) {
+    // Allocate enough memory for the largest strip of each intermediate.
+    // (The strips of a tensor only vary in the strip dimension, and any
+    // dimensions outside it must have extent 1.)
+    constexpr size_t alignment = HALIDE_RUNTIME_BUFFER_ALLOCATION_ALIGNMENT;
+    for (int i = 0; i + 1 < op_count(); i++) {
+        const TensorPtr &t = op(i)->output();
+        assert(t->alias_type() == AliasType::None);
+        assert(!t->is_allocated());
+        int max_extent = 0;
+        for (const auto &crops : strip_crops_) {
+            max_extent = std::max(max_extent, crops[i][strip_dim_].extent());
+        }
+        const halide_buffer_t *buf = t->raw_buffer();
+        for (int d = strip_dim_ + 1; d < buf->dimensions; d++) {
+            assert(buf->dim[d].extent == 1);
+        }
+        const size_t size = (size_t)max_extent * buf->dim[strip_dim_].stride * buf->type.bytes();
+        strip_memory_.emplace_back(new char[size + alignment]);
+        char *host = strip_memory_.back().get();
+        strip_hosts_.push_back((char *)(((uintptr_t)host + alignment - 1) & ~(alignment - 1)));
+        set_strip(0, i);
+    }
+}
+
+void TiledOpGroup::set_strip(int strip, int op_index) {
+    const Interval &rows = strip_crops_[strip][op_index][strip_dim_];
+    op(op_index)->output()->set_window(strip_hosts_[op_index], strip_dim_, rows.min, rows.extent());
+}
+
+void TiledOpGroup::execute() {
+    for (int s = 0; s < strip_count(); s++) {
+        for (int i = 0; i < op_count(); i++) {
+            if (i + 1 < op_count()) {
+                set_strip(s, i);
+            }
+            op(i)->execute_crop(strip_crops_[s][i]);
+        }
+    }
+}
+
+Box Op::infer_output_bounds(int output_idx, const std::vector<Box> &input_bounds) const {
+    Box result = output(output_idx)->bounds();
+    for (int i = 0; i < input_count(); i++) {
+        if (!input(i) || input_bounds[i] == input(i)->bounds()) {
+            continue;
+        }
+        const BoundsMap map = map_bounds(i, output_idx);
+        for (int d = 0; d < (int)result.size(); d++) {
+            for (int j = 0; j < (int)input_bounds[i].size(); j++) {
+                const DimMap &dim_map = map.at(j, d);
+                if (dim_map.is_constant()) {
+                    continue;
+                }
+                // Find the largest max of the output that only requires the
+                // input bounds. (The required bounds grow with the max.)
+                const auto in_bounds = [&](int max) {
+                    return dim_map.evaluate(Interval(result[d].min, max)).max <= input_bounds[i][j].max;
+                };
+                int lo = result[d].min - 1;
+                int hi = result[d].max;
+                while (lo < hi) {
+                    const int mid = lo + (hi - lo + 1) / 2;
+                    if (in_bounds(mid)) {
+                        lo = mid;
+                    } else {
+                        hi = mid - 1;
+                    }
+                }
+                result[d].max = lo;
+            }
+        }
     }
+    return result;
 }
 
 BoundsMap OpGroup::map_bounds(int input_idx, int output_idx) const {
@@ -103,7 +103,7 @@ struct DimMap {
     }
 
     DimMap &elementwise(int offset = 0) {
-        return upsample(1);
+        return upsample(1, Interval(offset));
     }
 
     DimMap &stencil(const Interval &filter) {
@@ -285,9 +285,32 @@ public:
         return true;
     }
 
-    // Execute the op on a given crop.
+    // Execute the op.
     virtual void execute() = 0;
 
+    // Whether execute_crop() is supported.
+    virtual bool supports_crops() const {
+        return false;
+    }
+
+    // Compute only the given crop of the output, which requires only the
+    // region of the input given by map_bounds().
+    virtual void execute_crop(const Box &crop) {
+        HLOG(FATAL) << name() << " does not support execute_crop()";
+    }
+
+    // Whether this op can execute when its tensors are smaller than they
+    // were when it was prepared in any dimension except the innermost.
+    virtual bool supports_smaller_bounds() const {
+        return false;
+    }
+
+    // Compute the bounds of an output of this op, given the bounds of its
+    // inputs, which may be smaller than they were when it was prepared. By
+    // default, this is the largest part of the output's current bounds that
+    // only requires the given bounds of the inputs.
+    virtual Box infer_output_bounds(int output_idx, const std::vector<Box> &input_bounds) const;
+
     // Call the visitor's appropriate methods for this op, and any sub-ops.
     inline void accept(OpVisitor *v) const {
         return accept_impl(v);
@@ -354,6 +377,10 @@ private:
 class OpGroup : public Op {
     std::vector<OpPtr> ops_;
 
+    // The indices of the ops to execute in each step, if set_steps() has
+    // been called; otherwise, the ops are executed one at a time, in order.
+    std::vector<std::vector<int>> steps_;
+
 public:
     OpGroup(std::vector<TensorPtr> inputs, std::vector<TensorPtr> outputs, std::vector<OpPtr> ops = {})
         : Op(std::move(inputs), std::move(outputs)), ops_(std::move(ops)) {
@@ -378,6 +405,14 @@ public:
         return result;
     }
 
+    // Execute the ops in the given series of steps, rather than in order.
+    // Each step is a list of indices of ops that don't depend on each other
+    // (or on the ops of later steps); they are run concurrently on the Halide
+    // thread pool. Every op must be in exactly one step.
+    void set_steps(std::vector<std::vector<int>> steps) {
+        steps_ = std::move(steps);
+    }
+
     // TODO: remove me
     Op *op(int i) {
         return ops_[i].get();
@@ -404,6 +439,42 @@ private:
     OpMutatorFn mutate_impl() const override;
 };
 
+// An OpGroup of a chain of ops, each of which consumes the output of the
+// previous one, that is executed in strips: each op computes one strip of
+// its output, then the next op computes the strip of its output that needs
+// it, and so on. The intermediate tensors only hold the current strip, so
+// they can stay in cache.
+//
+// Visitors see this as an OpGroup; mutators will replace it with one that
+// executes normally, so this should only be introduced after transforms.
+class TiledOpGroup : public OpGroup {
+    // The dimension the strips are taken from.
+    int strip_dim_;
+    // The crop of each op's output to compute, for each strip.
+    std::vector<std::vector<Box>> strip_crops_;
+    // The memory holding the current strip of each intermediate tensor.
+    std::vector<std::unique_ptr<char[]>> strip_memory_;
+    std::vector<void *> strip_hosts_;
+
+    void set_strip(int strip, int op_index);
+
+public:
+    // The output of every op but the last must be used only by the next op,
+    // and must not be aliased; its memory is allocated by this group.
+    TiledOpGroup(std::vector<TensorPtr> inputs, std::vector<TensorPtr> outputs, std::vector<OpPtr> ops,
+                 int strip_dim, std::vector<std::vector<Box>> strip_crops);
+
+    void execute() override;
+
+    int strip_count() const {
+        return strip_crops_.size();
+    }
+
+    std::string name() const override {
+        return "TiledOpGroup";
+    }
+};
+
 }  // namespace hannk
 
 #endif  // HANNK_MODEL_H
@@ -5,9 +5,11 @@
 #include "halide/add_uint8_uint8.h"
 #include "halide/average_pool_uint8.h"
 #include "halide/constants.h"
+#include "halide/conv_add_u8_u8_u8.h"
 #include "halide/conv_u8_u8_i16.h"
 #include "halide/conv_u8_u8_u8.h"
 #ifdef CONV_R16
+#include "halide/conv_r16_add_u8_u8_u8.h"
 #include "halide/conv_r16_u8_u8_i16.h"
 #include "halide/conv_r16_u8_u8_u8.h"
 #endif
@@ -17,6 +19,7 @@
 #include "halide/depthwise_conv_uint8.h"
 #include "halide/elementwise_5xint16_1xuint8int16.h"
 #include "halide/elementwise_5xuint8_1xuint8.h"
+#include "halide/elementwise_8xint16_3xint16.h"
 #include "halide/fill_uint8.h"
 #include "halide/l2_normalization_uint8.h"
 #include "halide/max_pool_uint8.h"
@@ -434,6 +437,13 @@ MultiplyParams get_quantized_multiply_params(const QuantizationInfo &a, const Qu
     return result;
 }
 
+// The multiplier for an input of the add generators with the given quantization.
+int get_add_input_multiplier(const QuantizationInfo &inq, const QuantizationInfo &outq) {
+    const float in_scale = inq.uniform_scale() * (1 << add_output_shift);
+    const float out_scale = outq.uniform_scale() * (1 << add_input_shift);
+    return std::lround(in_scale / out_scale);
+}
+
 void add_uint8(const HalideBuffer<const void> &in1, const QuantizationInfo &in1q, int in1sign,
                const HalideBuffer<const void> &in2, const QuantizationInfo &in2q, int in2sign,
                const HalideBuffer<void> &out, const QuantizationInfo &outq,
@@ -442,12 +452,8 @@ void add_uint8(const HalideBuffer<const void> &in1, const QuantizationInfo &in1q
     const int in2_zero = in2q.uniform_zero();
     const int out_zero = outq.uniform_zero();
 
-    const float in1_scale = in1q.uniform_scale() * (1 << add_output_shift);
-    const float in2_scale = in2q.uniform_scale() * (1 << add_output_shift);
-    const float out_scale = outq.uniform_scale() * (1 << add_input_shift);
-
-    const int in1_multiplier = std::lround(in1_scale / out_scale) * in1sign;
-    const int in2_multiplier = std::lround(in2_scale / out_scale) * in2sign;
+    const int in1_multiplier = get_add_input_multiplier(in1q, outq) * in1sign;
+    const int in2_multiplier = get_add_input_multiplier(in2q, outq) * in2sign;
 
     const auto out_range = get_output_range(activation, outq);
 
@@ -799,9 +805,11 @@ BoundsMap ConvOp::map_bounds(int input_idx, int output_idx) const {
             result.constant(i + 3, filter()->bounds(i));
         }
         return result;
-    } else {
-        assert(input_idx == 2);
+    } else if (input_idx == 2) {
         return BoundsMap(1, output()->rank()).elementwise(0, 0);
+    } else {
+        assert(input_idx == 3);
+        return BoundsMap::elementwise(output()->rank());
     }
 }
 
@@ -831,6 +839,36 @@ void call_conv2d(halide_buffer_t *input, halide_buffer_t *filter, halide_buffer_
        output);
 }
 
+// Parameters for adding a residual to the result of a convolution.
+struct ResidualParams {
+    int residual_zero;
+    int residual_multiplier;
+    int conv_multiplier;
+    int sum_zero;
+    Interval sum_range;
+};
+
+void call_conv2d_add(halide_buffer_t *input, halide_buffer_t *filter, halide_buffer_t *bias,
+                     const MultiplyParams &params, const std::array<int, 2> &stride,
+                     const std::array<int, 2> &dilation, const Interval &output_range,
+                     halide_buffer_t *residual, const ResidualParams &residual_params,
+                     halide_buffer_t *output) {
+    using Conv2DAddFn = decltype(&::hannk::conv_add_u8_u8_u8);
+
+    Conv2DAddFn fn = hannk::conv_add_u8_u8_u8;
+#ifdef CONV_R16
+    if (input->dim[0].extent >= 16) {
+        fn = hannk::conv_r16_add_u8_u8_u8;
+    }
+#endif
+    fn(input, (uint8_t)params.a_zero, filter, (uint8_t)params.b_zero, bias,
+       stride[0], stride[1], dilation[0], dilation[1], params.c.mantissa(),
+       -params.c.exponent(), (uint8_t)params.c_zero, output_range.min, output_range.max,
+       residual, (uint8_t)residual_params.residual_zero, residual_params.residual_multiplier,
+       residual_params.conv_multiplier, (uint8_t)residual_params.sum_zero,
+       residual_params.sum_range.min, residual_params.sum_range.max, output);
+}
+
 }  // namespace
 
 bool ConvOp::prepare() {
@@ -850,6 +888,10 @@ bool ConvOp::prepare() {
 }
 
 void ConvOp::execute() {
+    execute_crop(output()->bounds());
+}
+
+void ConvOp::execute_crop(const Box &crop) {
     const TensorPtr &in = input();
     const TensorPtr &filt = filter();
     const TensorPtr &out = output();
@@ -861,15 +903,39 @@ void ConvOp::execute() {
         auto bias_buf = bias()->buffer();
         auto output_buf = out->buffer();
 
+        // Crop the input too, so the buffers stay compatible for fusing
+        // dimensions below. (The channels are always computed entirely.)
+        const Box input_crop = map_bounds(0, 0).evaluate(crop);
+        for (int d = 1; d < output_buf.dimensions(); d++) {
+            output_buf.crop(d, crop[d].min, crop[d].extent());
+            const Interval input_d = intersect(input_crop[d], in->bounds(d));
+            input_buf.crop(d, input_d.min, input_d.extent());
+        }
+
+        // With a residual, the result of the convolution is only an intermediate
+        // value, quantized as conv_quantization_.
+        const bool fused = has_residual();
+        const QuantizationInfo &conv_q = fused ? conv_quantization_ : out->quantization();
+        HalideBuffer<void> residual_buf;
+        if (fused) {
+            residual_buf = residual()->buffer();
+            for (int d = 1; d < residual_buf.dimensions(); d++) {
+                residual_buf.crop(d, crop[d].min, crop[d].extent());
+            }
+        }
+
         MultiplyParams params =
-            get_quantized_multiply_params(in->quantization(), filt->quantization(), out->quantization());
+            get_quantized_multiply_params(in->quantization(), filt->quantization(), conv_q);
 
-        const auto output_range = get_output_range(activation_, out->quantization());
+        const auto output_range = get_output_range(activation_, conv_q);
 
         // Pad with dummy dimensions up to 2D.
         while (input_buf.dimensions() < 4) {
             input_buf.embed(input_buf.dimensions() - 1, 1);
             output_buf.embed(output_buf.dimensions() - 1, 1);
+            if (fused) {
+                residual_buf.embed(residual_buf.dimensions() - 1, 1);
+            }
             filter_buf.add_dimension();
         }
 
@@ -883,9 +949,13 @@ void ConvOp::execute() {
             // them all where possible, which might be a further improvement.
             while (can_fuse_xy(FuseType::Pad, input_buf) &&
                    can_fuse_xy(FuseType::Pad, output_buf) &&
+                   (!fused || can_fuse_xy(FuseType::Pad, residual_buf)) &&
                    input_buf.dim(1).extent() == output_buf.dim(1).extent()) {
                 fuse_xy(FuseType::Pad, input_buf);
                 fuse_xy(FuseType::Pad, output_buf);
+                if (fused) {
+                    fuse_xy(FuseType::Pad, residual_buf);
+                }
             }
 
             if (output_buf.dim(1).extent() < output_buf.dim(2).extent()) {
@@ -894,10 +964,25 @@ void ConvOp::execute() {
                 // if we tiled y instead. We can do this by just swapping the x and y dimensions.
                 input_buf.transpose(1, 2);
                 output_buf.transpose(1, 2);
+                if (fused) {
+                    residual_buf.transpose(1, 2);
+                }
             }
         }
 
-        call_conv2d(input_buf, filter_buf, bias_buf, params, stride_, dilation_, output_range, output_buf);
+        if (fused) {
+            const QuantizationInfo &residual_q = residual()->quantization();
+            ResidualParams residual_params;
+            residual_params.residual_zero = residual_q.uniform_zero();
+            residual_params.residual_multiplier = get_add_input_multiplier(residual_q, out->quantization());
+            residual_params.conv_multiplier = get_add_input_multiplier(conv_q, out->quantization());
+            residual_params.sum_zero = out->quantization().uniform_zero();
+            residual_params.sum_range = get_output_range(residual_activation_, out->quantization());
+            call_conv2d_add(input_buf, filter_buf, bias_buf, params, stride_, dilation_, output_range,
+                            residual_buf, residual_params, output_buf);
+        } else {
+            call_conv2d(input_buf, filter_buf, bias_buf, params, stride_, dilation_, output_range, output_buf);
+        }
     } else {
         HLOG(FATAL) << "Unsupported type " << out->type() << "\n";
     }
@@ -987,6 +1072,10 @@ bool DepthwiseConv2DOp::prepare() {
 }
 
 void DepthwiseConv2DOp::execute() {
+    execute_crop(output()->bounds());
+}
+
+void DepthwiseConv2DOp::execute_crop(const Box &crop) {
     const TensorPtr &in = input();
     const TensorPtr &filt = filter();
     const TensorPtr &out = output();
@@ -998,6 +1087,10 @@ void DepthwiseConv2DOp::execute() {
         auto filter_buf = filt->buffer().sliced(3, 0);
         auto bias_buf = bias()->buffer();
         auto output_buf = out->buffer();
+        // The channels are always computed entirely.
+        for (int d = 1; d < output_buf.dimensions(); d++) {
+            output_buf.crop(d, crop[d].min, crop[d].extent());
+        }
 
         MultiplyParams params =
             get_quantized_multiply_params(in->quantization(), filt->quantization(), out->quantization());
@@ -1082,8 +1175,12 @@ void ElementwiseProgramOp::execute() {
     const auto &in2 = input(std::min(input_count() - 1, 2))->buffer();
     const auto &in3 = input(std::min(input_count() - 1, 3))->buffer();
     const auto &in4 = input(std::min(input_count() - 1, 4))->buffer();
+    const auto &in5 = input(std::min(input_count() - 1, 5))->buffer();
+    const auto &in6 = input(std::min(input_count() - 1, 6))->buffer();
+    const auto &in7 = input(std::min(input_count() - 1, 7))->buffer();
     const auto &out0 = output(0)->buffer();
     const auto &out1 = output(std::min(output_count() - 1, 1))->buffer();
+    const auto &out2 = output(std::min(output_count() - 1, 2))->buffer();
     using arg_ptr = halide_buffer_t *;
     if (can_use_elementwise_program<TypeArray<5, uint8_t>, TypeArray<1, uint8_t>>(this)) {
         auto rank2 = [&](arg_ptr in0, arg_ptr in1, arg_ptr in2, arg_ptr in3, arg_ptr in4, arg_ptr out0) {
@@ -1097,6 +1194,16 @@ void ElementwiseProgramOp::execute() {
         };
         elementwise_loop_nest<2>(rank2, in0, in1, in2, in3, in4, out0, out1);
         return;
+    } else if (output_count() == 3 &&
+               can_use_elementwise_program<TypeArray<8, int16_t>, TypeArray<3, int16_t>>(this)) {
+        // Unlike unused inputs, unused outputs can't repeat the last one, so
+        // this requires exactly as many outputs as the pipeline has.
+        auto rank2 = [&](arg_ptr in0, arg_ptr in1, arg_ptr in2, arg_ptr in3, arg_ptr in4, arg_ptr in5,
+                         arg_ptr in6, arg_ptr in7, arg_ptr out0, arg_ptr out1, arg_ptr out2) {
+            elementwise_8xint16_3xint16(in0, in1, in2, in3, in4, in5, in6, in7, program_, out0, out1, out2);
+        };
+        elementwise_loop_nest<2>(rank2, in0, in1, in2, in3, in4, in5, in6, in7, out0, out1, out2);
+        return;
     }
     HLOG(FATAL) << "Unsupported elementwise program\n";
 }
@@ -1215,7 +1322,8 @@ BoundsMap PadOp::map_bounds(int input_idx, int output_idx) const {
             BoundsMap result(rank, rank);
             const auto &padding = input(1)->buffer<const int32_t>();
             for (int d = 0; d < output()->rank(); d++) {
-                result.elementwise(d, d, padding(0, d));
+                // The padding is in reverse order of the dimensions.
+                result.elementwise(d, d, -padding(0, rank - d - 1));
             }
             return result;
         } else {
@@ -1227,7 +1335,26 @@ BoundsMap PadOp::map_bounds(int input_idx, int output_idx) const {
     }
 }
 
+Box PadOp::infer_output_bounds(int output_idx, const std::vector<Box> &input_bounds) const {
+    assert(output_idx == 0);
+    // The padding is constant, so the output shrinks by as much as the input.
+    Box result = output()->bounds();
+    const Box in_bounds = input(0)->bounds();
+    for (int d = 0; d < output()->rank(); d++) {
+        result[d].max -= in_bounds[d].max - input_bounds[0][d].max;
+    }
+    return result;
+}
+
 void PadOp::execute() {
+    if (output()->is_dynamic()) {
+        execute_crop(Box());
+    } else {
+        execute_crop(output()->bounds());
+    }
+}
+
+void PadOp::execute_crop(const Box &crop) {
     const TensorPtr &in = input(0);
     const TensorPtr &padding = input(1);
     const TensorPtr &out = output();
@@ -1252,6 +1379,11 @@ void PadOp::execute() {
     if (out->type().bytes() == 1) {
         auto input_buf = in->buffer();
         auto output_buf = out->buffer();
+        if (!out->is_dynamic()) {
+            for (int d = 0; d < output_buf.dimensions(); d++) {
+                output_buf.crop(d, crop[d].min, crop[d].extent());
+            }
+        }
 
         const int dims = input_buf.dimensions();
         for (int d = 0; d < input_buf.dimensions(); d++) {
@@ -1782,60 +1914,61 @@ const char *UnaryOp::to_string(UnaryOp::Operator op) {
     }
 }
 
-void UnaryOp::execute() {
+bool UnaryOp::can_use_program() const {
+    return (op_ == Logistic || op_ == Tanh) &&
+           input()->type() == halide_type_of<uint8_t>() &&
+           output()->type() == halide_type_of<uint8_t>();
+}
+
+ElementwiseAssembler::Slot UnaryOp::append_program(ElementwiseAssembler &p, ElementwiseAssembler::Slot input_slot) const {
+    assert(can_use_program());
     const TensorPtr &in = input();
     const TensorPtr &out = output();
 
-    if (in->type() == halide_type_of<uint8_t>() && out->type() == halide_type_of<uint8_t>()) {
-        auto in_buf = in->buffer();
-        auto out_buf = out->buffer();
+    const int input_zero = in->quantization().uniform_zero();
+    assert(input_zero >= 0 && input_zero <= 255);
+    const float in_scale = in->quantization().uniform_scale();
 
-        const int input_zero = in->quantization().uniform_zero();
-        assert(input_zero >= 0 && input_zero <= 255);
-        const float in_scale = in->quantization().uniform_scale();
+    const int left_shift = 6;
 
-        const int left_shift = 6;
+    IntFloat<int16_t> in_multiplier(in_scale);
+    in_multiplier *= power_of_two(-left_shift);
+    assert(in_multiplier.exponent() <= 0);
 
-        std::array<int16_t, 64> program_buffer;
-        if (op_ == Logistic) {
-            IntFloat<int16_t> in_multiplier(in_scale);
-            in_multiplier *= power_of_two(-left_shift);
-            assert(in_multiplier.exponent() <= 0);
+    auto input_zeroed = p.sub(input_slot, input_zero);
+    auto input_scaled = p.mul_shift(input_zeroed, in_multiplier.mantissa(), 15 - left_shift);
+    if (op_ == Logistic) {
+        assert(out->quantization().uniform_scale() == 1.0f / 256.0f);
+        assert(out->quantization().uniform_zero() == 0);
 
-            assert(out->quantization().uniform_scale() == 1.0f / 256.0f);
-            assert(out->quantization().uniform_zero() == 0);
+        return p.logistic(8, input_scaled, -in_multiplier.exponent());
+    } else {
+        assert(op_ == Tanh);
+        assert(out->quantization().uniform_scale() == 1.0f / 128.0f);
+        assert(out->quantization().uniform_zero() == 128);
 
-            // Build a program to implement the logistic op.
-            ElementwiseAssembler p(program_buffer);
-            auto input_zeroed = p.sub(p.input(0), input_zero);
-            auto input_scaled = p.mul_shift(input_zeroed, in_multiplier.mantissa(), 15 - left_shift);
-            auto result = p.logistic(8, input_scaled, -in_multiplier.exponent());
-            auto program_buf = p.assemble({result});
+        return p.add(p.tanh(7, input_scaled, -in_multiplier.exponent()), 128);
+    }
+}
 
-            auto logistic_rank2 = [&](halide_buffer_t *in_buf, halide_buffer_t *out_buf) {
-                elementwise_5xuint8_1xuint8(in_buf, in_buf, in_buf, in_buf, in_buf, program_buf, out_buf);
-            };
-            elementwise_loop_nest<2>(logistic_rank2, in_buf, out_buf);
-            return;
-        } else if (op_ == Tanh) {
-            IntFloat<int16_t> in_multiplier(in_scale);
-            in_multiplier *= power_of_two(-left_shift);
-            assert(in_multiplier.exponent() <= 0);
+void UnaryOp::execute() {
+    const TensorPtr &in = input();
+    const TensorPtr &out = output();
 
-            assert(out->quantization().uniform_scale() == 1.0f / 128.0f);
-            assert(out->quantization().uniform_zero() == 128);
+    if (in->type() == halide_type_of<uint8_t>() && out->type() == halide_type_of<uint8_t>()) {
+        auto in_buf = in->buffer();
+        auto out_buf = out->buffer();
 
-            // Build a program to implement the tanh op.
+        if (can_use_program()) {
+            // Build a program to implement the op.
+            std::array<int16_t, 64> program_buffer;
             ElementwiseAssembler p(program_buffer);
-            auto input_zeroed = p.sub(p.input(0), input_zero);
-            auto input_scaled = p.mul_shift(input_zeroed, in_multiplier.mantissa(), 15 - left_shift);
-            auto result = p.add(p.tanh(7, input_scaled, -in_multiplier.exponent()), 128);
-            auto program_buf = p.assemble({result});
+            auto program_buf = p.assemble({append_program(p, p.input(0))});
 
-            auto tanh_rank2 = [&](halide_buffer_t *in_buf, halide_buffer_t *out_buf) {
+            auto unary_rank2 = [&](halide_buffer_t *in_buf, halide_buffer_t *out_buf) {
                 elementwise_5xuint8_1xuint8(in_buf, in_buf, in_buf, in_buf, in_buf, program_buf, out_buf);
             };
-            elementwise_loop_nest<2>(tanh_rank2, in_buf, out_buf);
+            elementwise_loop_nest<2>(unary_rank2, in_buf, out_buf);
             return;
         } else if (op_ == Negate) {
             add_uint8(in_buf, in->quantization(), -1, in_buf, in->quantization(), 0, out_buf, out->quantization());
@@ -3,6 +3,7 @@
 
 #include <array>
 
+#include "interpreter/elementwise_program.h"
 #include "interpreter/model.h"
 #include "util/small_vector.h"
 
@@ -30,6 +31,10 @@ public:
     }
 
     BoundsMap map_bounds(int input_idx, int output_idx) const override;
+
+    bool supports_smaller_bounds() const override {
+        return true;
+    }
 };
 
 class BinaryOp : public ElementwiseOp {
@@ -55,6 +60,13 @@ public:
         : ElementwiseOp({a, b}, {output}), op_(op), activation_(activation) {
     }
 
+    Operator op() const {
+        return op_;
+    }
+    ActivationFunction activation() const {
+        return activation_;
+    }
+
     void execute() override;
 
     std::string name() const override {
@@ -101,6 +113,12 @@ class ConvOp : public Op {
     Padding padding_;
     ActivationFunction activation_;
 
+    // If this op has a residual input, the result of the convolution (with
+    // activation_ applied, quantized with conv_quantization_) is added to it,
+    // and the output is the sum, with residual_activation_ applied.
+    QuantizationInfo conv_quantization_;
+    ActivationFunction residual_activation_ = ActivationFunction::None;
+
     // calculated in prepare()
     int vector_reduction_ = 0;
     int vector_tile_ = 0;
@@ -115,6 +133,17 @@ public:
           padding_(padding),
           activation_(activation) {
     }
+    ConvOp(const TensorPtr &input, const TensorPtr &filter, const TensorPtr &bias, const TensorPtr &residual,
+           const TensorPtr &output, std::array<int, 2> stride, std::array<int, 2> dilation, Padding padding,
+           ActivationFunction activation, QuantizationInfo conv_quantization, ActivationFunction residual_activation)
+        : Op({input, filter, bias, residual}, {output}),
+          stride_(stride),
+          dilation_(dilation),
+          padding_(padding),
+          activation_(activation),
+          conv_quantization_(std::move(conv_quantization)),
+          residual_activation_(residual_activation) {
+    }
 
     const TensorPtr &filter() const {
         return Op::input(1);
@@ -122,6 +151,13 @@ public:
     const TensorPtr &bias() const {
         return Op::input(2);
     }
+    bool has_residual() const {
+        return input_count() > 3;
+    }
+    const TensorPtr &residual() const {
+        assert(has_residual());
+        return Op::input(3);
+    }
 
     std::array<int, 2> stride() const {
         return stride_;
@@ -135,12 +171,25 @@ public:
     ActivationFunction activation() const {
         return activation_;
     }
+    const QuantizationInfo &conv_quantization() const {
+        return conv_quantization_;
+    }
+    ActivationFunction residual_activation() const {
+        return residual_activation_;
+    }
 
     halide_type_t filter_type() const;
     BoundsMap map_bounds(int input_idx, int output_idx) const override;
 
     bool prepare() override;
     void execute() override;
+    bool supports_crops() const override {
+        return true;
+    }
+    void execute_crop(const Box &crop) override;
+    bool supports_smaller_bounds() const override {
+        return true;
+    }
 
     std::string name() const override {
         return "ConvOp";
@@ -200,6 +249,13 @@ public:
 
     bool prepare() override;
     void execute() override;
+    bool supports_crops() const override {
+        return true;
+    }
+    void execute_crop(const Box &crop) override;
+    bool supports_smaller_bounds() const override {
+        return true;
+    }
 
     std::string name() const override {
         return "DepthwiseConv2DOp";
@@ -292,6 +348,14 @@ public:
     BoundsMap map_bounds(int input_idx, int output_idx) const override;
 
     void execute() override;
+    bool supports_crops() const override {
+        return !output()->is_dynamic();
+    }
+    void execute_crop(const Box &crop) override;
+    bool supports_smaller_bounds() const override {
+        return !output()->is_dynamic();
+    }
+    Box infer_output_bounds(int output_idx, const std::vector<Box> &input_bounds) const override;
 
     std::string name() const override {
         return "PadOp";
@@ -340,6 +404,10 @@ public:
     BoundsMap map_bounds(int input_idx, int output_idx) const override;
 
     void execute() override;
+    // With same padding, the padding depends on the size of the input.
+    bool supports_smaller_bounds() const override {
+        return padding_ == Padding::Valid;
+    }
 
     std::string name() const override {
         return std::string("Pool2DOp(") + to_string(op_) + ")";
@@ -556,6 +624,17 @@ public:
         : ElementwiseOp({input}, {output}), op_(op) {
     }
 
+    Operator op() const {
+        return op_;
+    }
+
+    // Whether this op can be implemented by an elementwise program.
+    bool can_use_program() const;
+
+    // Add instructions to p that compute the (unsaturated) output of this op
+    // from the input in the given slot.
+    ElementwiseAssembler::Slot append_program(ElementwiseAssembler &p, ElementwiseAssembler::Slot input) const;
+
     void execute() override;
 
     std::string name() const override {
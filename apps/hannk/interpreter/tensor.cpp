@@ -1,5 +1,19 @@
 #include "interpreter/tensor.h"
 
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define HANNK_HAS_MMAP 1
+#else
+#define HANNK_HAS_MMAP 0
+#endif
+
 namespace hannk {
 
 namespace {
@@ -118,6 +132,53 @@ void Tensor::allocate_from_heap() {
     finish_buffer_allocation();
 }
 
+void Tensor::allocate_from_storage(TensorStoragePtr storage) {
+    assert(!is_dynamic());
+    assert(!is_external());
+    assert(!is_allocated());
+    assert(alias_type() == AliasType::None);
+    assert(storage_offset_.empty());
+
+    const halide_buffer_t *raw_storage_buffer = storage->buffer.raw_buffer();
+    assert(raw_storage_buffer->host);
+    assert(raw_storage_buffer->type.bytes() == buffer_.type().bytes());
+    assert(raw_storage_buffer->dimensions == buffer_.dimensions());
+    for (int i = 0; i < buffer_.dimensions(); i++) {
+        assert(raw_storage_buffer->dim[i].min == buffer_.dim(i).min());
+        assert(raw_storage_buffer->dim[i].extent == buffer_.dim(i).extent());
+    }
+    (void)raw_storage_buffer;
+
+    storage_ = std::move(storage);
+    finish_buffer_allocation();
+}
+
+void Tensor::set_window(void *host, int dim, int min, int extent) {
+    assert(alias_type() == AliasType::None);
+    assert(!is_external());
+    assert(!is_dynamic());
+
+    halide_buffer_t *raw_buf = buffer_.raw_buffer();
+    raw_buf->host = (uint8_t *)host;
+    raw_buf->dim[dim].min = min;
+    raw_buf->dim[dim].extent = extent;
+}
+
+void Tensor::crop(const Box &bounds) {
+    assert(!is_dynamic());
+    assert((int)bounds.size() == rank());
+
+    if (uncropped_bounds_.empty()) {
+        uncropped_bounds_ = this->bounds();
+    }
+    halide_buffer_t *raw_buf = buffer_.raw_buffer();
+    for (int d = 0; d < rank(); d++) {
+        assert(bounds[d].min == uncropped_bounds_[d].min);
+        assert(bounds[d].max <= uncropped_bounds_[d].max);
+        raw_buf->dim[d].extent = bounds[d].extent();
+    }
+}
+
 void Tensor::finish_buffer_allocation() {
     auto &storage_buffer = storage()->buffer;
     halide_buffer_t *raw_storage_buffer = storage_buffer.raw_buffer();
@@ -399,4 +460,259 @@ void Tensor::dump(std::ostream &os) const {
     os << std::endl;
 }
 
+std::vector<TensorStoragePtr> ConstantCache::find(const std::string &key) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = storage_.find(key);
+    return it != storage_.end() ? it->second : std::vector<TensorStoragePtr>();
+}
+
+void ConstantCache::insert(const std::string &key, std::vector<TensorStoragePtr> storage) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (storage_.emplace(key, std::move(storage)).second) {
+        modified_ = true;
+    }
+}
+
+bool ConstantCache::modified() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return modified_;
+}
+
+// The contents of a file, memory-mapped if possible, so the pages of
+// constants that are never used are never read.
+class ConstantCache::MappedFile {
+    const char *data_ = nullptr;
+    size_t size_ = 0;
+    std::vector<char> copy_;
+
+public:
+    explicit MappedFile(const std::string &path) {
+#if HANNK_HAS_MMAP
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return;
+        }
+        struct stat st;
+        if (fstat(fd, &st) == 0 && st.st_size > 0) {
+            void *p = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p != MAP_FAILED) {
+                data_ = (const char *)p;
+                size_ = st.st_size;
+            }
+        }
+        close(fd);
+#else
+        std::ifstream f(path, std::ios::in | std::ios::binary);
+        if (!f.is_open()) {
+            return;
+        }
+        copy_.assign(std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>());
+        data_ = copy_.data();
+        size_ = copy_.size();
+#endif
+    }
+
+    ~MappedFile() {
+#if HANNK_HAS_MMAP
+        if (data_) {
+            munmap((void *)data_, size_);
+        }
+#endif
+    }
+
+    const char *data() const {
+        return data_;
+    }
+    size_t size() const {
+        return size_;
+    }
+};
+
+ConstantCache::~ConstantCache() {
+    // The storage may refer to file_, so be sure to destroy it first.
+    storage_.clear();
+}
+
+namespace {
+
+// The file starts with this, followed by the tag, the number of entries, the
+// entries (each a key, the number of storage buffers, and their shape, type,
+// and location in the file), and then the data of the buffers.
+constexpr char kConstantCacheMagic[8] = {'h', 'a', 'n', 'n', 'k', 'C', 'C', '1'};
+
+constexpr size_t kConstantCacheAlignment = HALIDE_RUNTIME_BUFFER_ALLOCATION_ALIGNMENT;
+
+class CacheReader {
+    const char *data_;
+    size_t size_;
+    size_t pos_ = 0;
+
+public:
+    CacheReader(const char *data, size_t size)
+        : data_(data), size_(size) {
+    }
+
+    bool ok = true;
+
+    template<typename T>
+    T read() {
+        T result = T();
+        if (pos_ + sizeof(T) > size_) {
+            ok = false;
+            return result;
+        }
+        memcpy(&result, data_ + pos_, sizeof(T));
+        pos_ += sizeof(T);
+        return result;
+    }
+
+    std::string read_string() {
+        const uint64_t size = read<uint64_t>();
+        if (!ok || size > size_ - pos_) {
+            ok = false;
+            return std::string();
+        }
+        std::string result(data_ + pos_, size);
+        pos_ += size;
+        return result;
+    }
+};
+
+template<typename T>
+void write(std::ostream &os, T x) {
+    os.write((const char *)&x, sizeof(T));
+}
+
+void write_string(std::ostream &os, const std::string &s) {
+    write<uint64_t>(os, s.size());
+    os.write(s.data(), s.size());
+}
+
+size_t align_up(size_t x, size_t alignment) {
+    return (x + alignment - 1) / alignment * alignment;
+}
+
+}  // namespace
+
+bool ConstantCache::load(const std::string &path, const std::string &tag) {
+    auto file = std::make_shared<MappedFile>(path);
+    if (!file->data() || file->size() < sizeof(kConstantCacheMagic) ||
+        memcmp(file->data(), kConstantCacheMagic, sizeof(kConstantCacheMagic)) != 0) {
+        return false;
+    }
+    CacheReader r(file->data() + sizeof(kConstantCacheMagic), file->size() - sizeof(kConstantCacheMagic));
+    if (r.read_string() != tag || !r.ok) {
+        return false;
+    }
+
+    std::map<std::string, std::vector<TensorStoragePtr>> loaded;
+    const uint64_t entries = r.read<uint64_t>();
+    for (uint64_t i = 0; i < entries && r.ok; i++) {
+        std::string key = r.read_string();
+        const uint64_t count = r.read<uint64_t>();
+        std::vector<TensorStoragePtr> storage;
+        for (uint64_t j = 0; j < count && r.ok; j++) {
+            halide_type_t type;
+            type.code = (halide_type_code_t)r.read<uint8_t>();
+            type.bits = r.read<uint8_t>();
+            type.lanes = r.read<uint16_t>();
+            const int32_t rank = r.read<int32_t>();
+            if (rank < 0 || rank > max_rank) {
+                r.ok = false;
+                break;
+            }
+            TensorDimensions dims(rank);
+            for (int d = 0; d < rank; d++) {
+                dims[d].min = r.read<int32_t>();
+                dims[d].extent = r.read<int32_t>();
+                dims[d].stride = r.read<int32_t>();
+            }
+            const uint64_t offset = r.read<uint64_t>();
+            const uint64_t size = r.read<uint64_t>();
+            if (!r.ok || offset > file->size() || size > file->size() - offset) {
+                r.ok = false;
+                break;
+            }
+            auto s = std::make_shared<TensorStorage>(type, rank, dims.data());
+            if (s->buffer.size_in_bytes() != size) {
+                r.ok = false;
+                break;
+            }
+            // The data is read-only; nothing writes to constants.
+            s->buffer.raw_buffer()->host = (uint8_t *)(file->data() + offset);
+            storage.push_back(std::move(s));
+        }
+        loaded.emplace(std::move(key), std::move(storage));
+    }
+    if (!r.ok) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto &i : loaded) {
+        storage_.insert(std::move(i));
+    }
+    // Keep the file mapped as long as the cache exists. (We only
+    // support loading one file.)
+    assert(!file_);
+    file_ = std::move(file);
+    return true;
+}
+
+bool ConstantCache::save(const std::string &path, const std::string &tag) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    // Compute the size of the header, so we know where the data goes.
+    size_t header_size = sizeof(kConstantCacheMagic) + sizeof(uint64_t) + tag.size() + sizeof(uint64_t);
+    for (const auto &i : storage_) {
+        header_size += sizeof(uint64_t) + i.first.size() + sizeof(uint64_t);
+        for (const auto &s : i.second) {
+            const int rank = s->buffer.dimensions();
+            header_size += 4 + sizeof(int32_t) + rank * 3 * sizeof(int32_t) + 2 * sizeof(uint64_t);
+        }
+    }
+
+    std::ofstream f(path, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!f.is_open()) {
+        return false;
+    }
+    f.write(kConstantCacheMagic, sizeof(kConstantCacheMagic));
+    write_string(f, tag);
+    write<uint64_t>(f, storage_.size());
+    size_t offset = align_up(header_size, kConstantCacheAlignment);
+    std::vector<std::pair<size_t, const TensorStorage *>> data;
+    for (const auto &i : storage_) {
+        write_string(f, i.first);
+        write<uint64_t>(f, i.second.size());
+        for (const auto &s : i.second) {
+            const halide_buffer_t *buf = s->buffer.raw_buffer();
+            write<uint8_t>(f, buf->type.code);
+            write<uint8_t>(f, buf->type.bits);
+            write<uint16_t>(f, buf->type.lanes);
+            write<int32_t>(f, buf->dimensions);
+            for (int d = 0; d < buf->dimensions; d++) {
+                write<int32_t>(f, buf->dim[d].min);
+                write<int32_t>(f, buf->dim[d].extent);
+                write<int32_t>(f, buf->dim[d].stride);
+            }
+            write<uint64_t>(f, offset);
+            write<uint64_t>(f, s->storage_size());
+            data.emplace_back(offset, s.get());
+            offset = align_up(offset + s->storage_size(), kConstantCacheAlignment);
+        }
+    }
+    assert((size_t)f.tellp() == header_size);
+    for (const auto &i : data) {
+        const std::vector<char> padding(i.first - f.tellp(), 0);
+        f.write(padding.data(), padding.size());
+        f.write((const char *)i.second->buffer.data(), i.second->storage_size());
+    }
+    f.close();
+    if (!f.good()) {
+        return false;
+    }
+    modified_ = false;
+    return true;
+}
+
 }  // namespace hannk
@@ -3,6 +3,8 @@
 
 #include <iostream>
 #include <list>
+#include <map>
+#include <mutex>
 #include <string>
 #include <vector>
 
@@ -44,6 +46,7 @@ using TensorOffset = SmallVector<int, max_rank>;
 using TensorDimensions = SmallVector<halide_dimension_t, max_rank>;
 
 class TensorStorage {
+    friend class ConstantCache;
     friend class Tensor;
 
     HalideBuffer<void> buffer;
@@ -115,6 +118,9 @@ class Tensor {
     // If storage_offset_.size() < rank(), remaining offset entries are implicitly zero.
     TensorOffset storage_offset_;
 
+    // If this Tensor has been cropped, its bounds before it was cropped.
+    Box uncropped_bounds_;
+
     // A list of ops that use this tensor as an output or an input, respectively.
     std::list<Op *> producers_;
     std::list<Op *> consumers_;
@@ -230,6 +236,24 @@ public:
     }
     void allocate_from_heap();
     void allocate_from_arena_pointer(void *host);
+    // Use the (allocated) storage of another Tensor with the same shape and
+    // type size. This Tensor must not be aliased.
+    void allocate_from_storage(TensorStoragePtr storage);
+
+    // Point this Tensor at memory holding only the elements with coordinates in
+    // [min, min + extent) in dimension dim, with the same strides as before.
+    // This is used to execute ops on strips of a Tensor; it can only be used
+    // if the Tensor isn't aliased, external or dynamic.
+    void set_window(void *host, int dim, int min, int extent);
+
+    // Make this Tensor refer to the part of its uncropped bounds given by
+    // bounds, which must have the same mins. The memory and strides are
+    // unchanged, so this can be used after the Tensor is allocated, and
+    // again with larger bounds to undo a crop.
+    void crop(const Box &bounds);
+    Box uncropped_bounds() const {
+        return uncropped_bounds_.empty() ? bounds() : uncropped_bounds_;
+    }
 
     // HalideBuffer methods for GPU interactions.
     void set_host_dirty(bool dirty = true) {
@@ -278,6 +302,48 @@ public:
     void dump(std::ostream &os) const;
 };
 
+// The storage of constant Tensors computed while preparing a model (e.g. tiled
+// filters), keyed by a description of how they were computed, so that several
+// interpreters of the same model can share them rather than each having a
+// copy. The cache can be saved to a file, so later loads of the model can
+// use its contents without computing them. A cache must only be used with
+// one model. This can be used by several threads at once.
+class ConstantCache {
+    class MappedFile;
+
+    std::mutex mutex_;
+    std::map<std::string, std::vector<TensorStoragePtr>> storage_;
+    // The file the cache was loaded from, which the storage refers to.
+    std::shared_ptr<MappedFile> file_;
+    bool modified_ = false;
+
+public:
+    ConstantCache() = default;
+    ~ConstantCache();
+
+    // Load the contents of a cache saved to path, which must have been saved
+    // with the same tag. The tag should identify the model and the target the
+    // interpreter was compiled for, e.g. a hash of both. Returns false if
+    // the file doesn't exist or doesn't match the tag; the cache is then
+    // unchanged. Any Interpreters using the loaded contents must be destroyed
+    // before the cache.
+    bool load(const std::string &path, const std::string &tag);
+
+    // Save the contents of the cache to path. Returns false on failure.
+    bool save(const std::string &path, const std::string &tag);
+
+    // Whether anything has been added since the cache was made or loaded.
+    bool modified();
+
+    // Return the storage of the Tensors computed as described by key, or an
+    // empty vector if there are none.
+    std::vector<TensorStoragePtr> find(const std::string &key);
+
+    // Add the storage of the Tensors computed as described by key, unless
+    // some have been added for it already.
+    void insert(const std::string &key, std::vector<TensorStoragePtr> storage);
+};
+
 }  // namespace hannk
 
 #endif  // HANNK_TENSOR_H
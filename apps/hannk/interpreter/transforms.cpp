@@ -1,6 +1,8 @@
 #include "interpreter/transforms.h"
 #include "util/small_vector.h"
 
+#include <sstream>
+#include <unordered_map>
 #include <unordered_set>
 
 namespace hannk {
@@ -157,18 +159,48 @@ class InPlaceReshape : public OpMutator {
 class InPlace : public OpMutator {
     using OpMutator::visit;
 
+    // The position of each op in the order of execution.
+    std::unordered_map<const Op *, int> op_order_;
+
+    // Whether op is the only op using t after the ops before it have executed.
+    bool is_last_use(const TensorPtr &t, const Op *op) const {
+        if (t->consumers().size() == 1) {
+            return true;
+        }
+        // If other ops share the memory of t, we don't know when they're
+        // done with it.
+        if (t->alias_type() != AliasType::None) {
+            return false;
+        }
+        const auto order = op_order_.find(op);
+        if (order == op_order_.end()) {
+            return false;
+        }
+        int uses = 0;
+        for (const Op *i : t->consumers()) {
+            if (i == op) {
+                uses++;
+                continue;
+            }
+            const auto i_order = op_order_.find(i);
+            if (i_order == op_order_.end() || i_order->second >= order->second) {
+                return false;
+            }
+        }
+        return uses == 1;
+    }
+
     // We can alias two tensors if the input is not used after the output is written,
     // and we meet a number of other requirements.
-    bool maybe_alias_tensors(TensorPtr input, TensorPtr output, TensorOffset offset = {}) const {
+    bool maybe_alias_tensors(const Op *op, TensorPtr input, TensorPtr output, TensorOffset offset = {}) const {
         // We can't alias an input that is an input or output of the root graph.
         // TODO: We could, if we don't change the shape.
         if (is_root_input_or_output(input)) {
             return false;
         }
 
-        // If the input is used anywhere else, we should not alias it.
-        // TODO: This is conservative, we could alias it if it is the *last* use.
-        if (input->consumers().size() != 1) {
+        // If the input is used after this op, we should not alias it.
+        if (!is_last_use(input, op)) {
             return false;
         }
 
@@ -199,7 +231,7 @@ class InPlace : public OpMutator {
     void maybe_alias_elementwise(const ElementwiseOp *op) const {
         for (int j = 0; j < op->output_count(); j++) {
             for (int i = 0; i < op->input_count(); i++) {
-                if (maybe_alias_tensors(op->input(i), op->output(j))) {
+                if (maybe_alias_tensors(op, op->input(i), op->output(j))) {
                     // We can only alias one of the input to each output.
                     break;
                 }
@@ -226,7 +258,7 @@ class InPlace : public OpMutator {
         bool is_no_op = true;
         TensorOffset offset(op->axis() + 1);
         for (int i = 0; i < op->input_count(); i++) {
-            is_no_op = is_no_op && maybe_alias_tensors(op->input(i), op->output(), offset);
+            is_no_op = is_no_op && maybe_alias_tensors(op.get(), op->input(i), op->output(), offset);
             is_no_op = is_no_op && op->input(i)->quantization() == op->output()->quantization();
             offset[op->axis()] += op->input(i)->extent(op->axis());
         }
@@ -241,7 +273,7 @@ class InPlace : public OpMutator {
         bool is_no_op = true;
         TensorOffset offset(op->axis() + 1);
         for (int i = 0; i < op->output_count(); i++) {
-            is_no_op = is_no_op && maybe_alias_tensors(op->input(), op->output(i), offset);
+            is_no_op = is_no_op && maybe_alias_tensors(op.get(), op->input(), op->output(i), offset);
             is_no_op = is_no_op && op->output(i)->quantization() == op->input()->quantization();
             offset[op->axis()] -= op->output(i)->extent(op->axis());
         }
@@ -265,7 +297,7 @@ class InPlace : public OpMutator {
             offset[d] = padding(0, d);
         }
 
-        maybe_alias_tensors(op->input(), op->output(), offset);
+        maybe_alias_tensors(op.get(), op->input(), op->output(), offset);
         return op;
     }
 
@@ -284,6 +316,22 @@ public:
         for (int i = 0; i < root->output_count(); i++) {
             inputs_and_outputs_.insert(root->output(i).get());
         }
+
+        class FindOpOrder : public OpVisitor {
+        public:
+            std::unordered_map<const Op *, int> &op_order;
+
+            explicit FindOpOrder(std::unordered_map<const Op *, int> &op_order)
+                : op_order(op_order) {
+            }
+
+            void visit_leaf(const Op *op) override {
+                const int index = op_order.size();
+                op_order[op] = index;
+            }
+        };
+        FindOpOrder find_op_order(op_order_);
+        root->accept(&find_op_order);
     }
 };
 
@@ -394,8 +442,14 @@ class PadForOps : public OpMutator {
 
             auto inputs = op->inputs();
             auto outputs = op->outputs();
-            op = make_prepared_op<ConvOp>(conv_input, conv_filter, op->bias(), op->output(),
-                                          op->stride(), op->dilation(), op->padding(), op->activation());
+            if (op->has_residual()) {
+                op = make_prepared_op<ConvOp>(conv_input, conv_filter, op->bias(), op->residual(), op->output(),
+                                              op->stride(), op->dilation(), op->padding(), op->activation(),
+                                              op->conv_quantization(), op->residual_activation());
+            } else {
+                op = make_prepared_op<ConvOp>(conv_input, conv_filter, op->bias(), op->output(),
+                                              op->stride(), op->dilation(), op->padding(), op->activation());
+            }
             new_ops.push_back(std::move(op));
 
             return make_prepared_op<OpGroup>(std::move(inputs), std::move(outputs), std::move(new_ops));
@@ -545,11 +599,76 @@ bool can_execute_with_all_constant_inputs(const Op *op) {
     return true;
 }
 
+// A fingerprint of some of the data of buf, to distinguish tensors that
+// happen to have the same name and shape.
+uint64_t sample_hash(const halide_buffer_t *buf) {
+    const uint8_t *bytes = buf->begin();
+    const size_t size = buf->size_in_bytes();
+    constexpr size_t kSamples = 256;
+    const size_t step = std::max<size_t>(1, size / kSamples);
+    // FNV-1a
+    uint64_t hash = 14695981039346656037ull;
+    for (size_t i = 0; i < size; i += step) {
+        hash = (hash ^ bytes[i]) * 1099511628211ull;
+    }
+    return hash;
+}
+
+void print_dims(std::ostream &os, const halide_buffer_t *buf) {
+    os << buf->type << '[';
+    for (int d = 0; d < buf->dimensions; d++) {
+        os << (d > 0 ? "," : "") << buf->dim[d].min << ':' << buf->dim[d].extent << ':' << buf->dim[d].stride;
+    }
+    os << ']';
+}
+
 class ConstantFolder : public OpMutator {
     using OpMutator::visit;
 
+    ConstantCache *cache_;
+
+    // Describe the computation of op's outputs, if it only depends on the data
+    // of its inputs, which are identified by name (the cache is only used with
+    // one model). Most ops have parameters that aren't described by this, so
+    // this is only done for the tiling of filters, which is most of the memory
+    // (and time) needed to fold constants.
+    static std::string get_cache_key(Op *op) {
+        if (!cast_op<TileConvFilterOp>(op)) {
+            return std::string();
+        }
+        std::ostringstream key;
+        key << op->name();
+        for (int i = 0; i < op->input_count(); i++) {
+            const halide_buffer_t *buf = op->input(i)->raw_buffer();
+            key << ' ' << op->input(i)->name() << '#' << std::hex << sample_hash(buf) << std::dec;
+            print_dims(key, buf);
+        }
+        for (int i = 0; i < op->output_count(); i++) {
+            const TensorPtr &output = op->output(i);
+            if (output->is_allocated() || output->alias_type() != AliasType::None) {
+                return std::string();
+            }
+            key << " -> ";
+            print_dims(key, output->raw_buffer());
+        }
+        return key.str();
+    }
+
     OpPtr visit_leaf(OpPtr op) override {
         if (can_execute_with_all_constant_inputs(op.get())) {
+            const std::string key = cache_ ? get_cache_key(op.get()) : std::string();
+            if (!key.empty()) {
+                std::vector<TensorStoragePtr> storage = cache_->find(key);
+                if (!storage.empty()) {
+                    assert((int)storage.size() == op->output_count());
+                    for (int j = 0; j < op->output_count(); j++) {
+                        op->output(j)->allocate_from_storage(storage[j]);
+                        op->output(j)->set_constant();
+                    }
+                    return nullptr;
+                }
+            }
+
             // Allocate all the outputs.
             // Since we aren't ready for arena allocation,
             // we'll just do these as one-off heap allocs.
@@ -569,17 +688,30 @@ class ConstantFolder : public OpMutator {
                 op->output(j)->set_constant();
             }
 
+            if (!key.empty()) {
+                std::vector<TensorStoragePtr> storage;
+                for (int j = 0; j < op->output_count(); j++) {
+                    storage.push_back(op->output(j)->storage());
+                }
+                cache_->insert(key, std::move(storage));
+            }
+
             return nullptr;
         } else {
             return op;
         }
     }
+
+public:
+    explicit ConstantFolder(ConstantCache *cache)
+        : cache_(cache) {
+    }
 };
 
 }  // namespace
 
-OpPtr fold_constants(OpPtr op) {
-    ConstantFolder folder;
+OpPtr fold_constants(OpPtr op, ConstantCache *cache) {
+    ConstantFolder folder(cache);
     return folder.mutate(std::move(op));
 }
 
@@ -608,4 +740,322 @@ OpPtr flatten_groups(OpPtr op) {
     return make_op<OpGroup>(inputs, outputs, std::move(flattener.flattened));
 }
 
+namespace {
+
+bool has_same_bounds(const TensorPtr &a, const TensorPtr &b) {
+    return is_subset_of(a->bounds(), b->bounds()) && is_subset_of(b->bounds(), a->bounds());
+}
+
+// Fuse ops into the ops that produce their inputs, so the intermediate
+// tensor never needs to be stored. Currently, this fuses a quantized add
+// into a convolution that computes one of its operands (e.g. a residual
+// connection), computing the same result the Add op would.
+class FuseOps : public OpMutator {
+    using OpMutator::visit;
+
+    std::unordered_set<Tensor *> inputs_and_outputs_;
+
+    bool is_root_input_or_output(const TensorPtr &t) const {
+        return inputs_and_outputs_.count(t.get()) > 0;
+    }
+
+    // If t is computed by a ConvOp, and only used by one op, return the ConvOp.
+    const ConvOp *get_fusible_conv(const TensorPtr &t) const {
+        if (t->producers().size() != 1 || t->consumers().size() != 1 ||
+            is_root_input_or_output(t) || t->alias_type() != AliasType::None ||
+            t->type() != halide_type_of<uint8_t>()) {
+            return nullptr;
+        }
+        const ConvOp *conv = cast_op<ConvOp>(t->producers().front());
+        if (!conv || conv->has_residual() || conv->output() != t ||
+            conv->input()->type() != halide_type_of<uint8_t>()) {
+            return nullptr;
+        }
+        return conv;
+    }
+
+    // The most unary ops we'll fuse into one elementwise program.
+    static constexpr int kMaxUnaryChain = 8;
+
+    // If t is computed by a UnaryOp that can use an elementwise program, and is
+    // only used by one op, return the UnaryOp.
+    const UnaryOp *get_fusible_unary(const TensorPtr &t) const {
+        if (t->producers().size() != 1 || t->consumers().size() != 1 ||
+            is_root_input_or_output(t) || t->alias_type() != AliasType::None || t->is_dynamic()) {
+            return nullptr;
+        }
+        const UnaryOp *unary = cast_op<UnaryOp>(t->producers().front());
+        if (!unary || !unary->can_use_program()) {
+            return nullptr;
+        }
+        return unary;
+    }
+
+    OpPtr visit(std::unique_ptr<UnaryOp> op) override {
+        if (!op->can_use_program() || op->output()->is_dynamic() || op->input()->is_dynamic()) {
+            return op;
+        }
+        // Fuse the whole chain into the last op of it; the earlier ops are
+        // left alone, and will be removed once nothing uses them.
+        const TensorPtr &output = op->output();
+        if (get_fusible_unary(output)) {
+            const UnaryOp *next = cast_op<UnaryOp>(output->consumers().front());
+            if (next && next->can_use_program() && !next->output()->is_dynamic()) {
+                return op;
+            }
+        }
+        std::vector<const UnaryOp *> chain = {op.get()};
+        while ((int)chain.size() < kMaxUnaryChain) {
+            const UnaryOp *prev = get_fusible_unary(chain.back()->input());
+            if (!prev || prev->input()->is_dynamic()) {
+                break;
+            }
+            chain.push_back(prev);
+        }
+
+        // Build one program that computes the whole chain. The intermediate
+        // values are saturated to uint8, as storing them would.
+        std::array<int16_t, 256> program_buffer;
+        ElementwiseAssembler p(program_buffer);
+        ElementwiseAssembler::Slot value = p.input(0);
+        for (int i = (int)chain.size() - 1; i >= 0; i--) {
+            value = chain[i]->append_program(p, value);
+            if (i > 0) {
+                value = p.clamp(value, 0, 255);
+            }
+        }
+        auto program_buf = p.assemble({value});
+        program_buf = program_buf.copy();
+
+        return make_prepared_op<ElementwiseProgramOp>(std::vector<TensorPtr>{chain.back()->input()}, output, program_buf);
+    }
+
+    OpPtr visit(std::unique_ptr<BinaryOp> op) override {
+        const TensorPtr &output = op->output();
+        if (op->op() != BinaryOp::Add || output->type() != halide_type_of<uint8_t>() || output->is_dynamic()) {
+            return op;
+        }
+        for (int i = 0; i < 2; i++) {
+            const TensorPtr &conv_output = op->input(i);
+            const TensorPtr &residual = op->input(1 - i);
+            const ConvOp *conv = get_fusible_conv(conv_output);
+            // The fused op doesn't support broadcasting.
+            if (!conv || residual->type() != halide_type_of<uint8_t>() || residual->is_dynamic() ||
+                !has_same_bounds(conv_output, output) || !has_same_bounds(residual, output)) {
+                continue;
+            }
+            // The fused op replaces the add, rather than the conv, since the residual
+            // may be computed after the conv. (We'll rely on remove_dead_ops to get rid
+            // of the conv.)
+            return make_prepared_op<ConvOp>(conv->input(), conv->filter(), conv->bias(), residual, output,
+                                            conv->stride(), conv->dilation(), conv->padding(), conv->activation(),
+                                            conv_output->quantization(), op->activation());
+        }
+        return op;
+    }
+
+    template<class T, class... Args>
+    std::unique_ptr<T> make_prepared_op(Args &&...args) {
+        auto op = std::make_unique<T>(std::forward<Args>(args)...);
+        if (!op->prepare()) {
+            HLOG(ERROR) << "fuse_ops: new_op " << op->name() << " failed prepare()";
+            prepare_failed = true;
+        }
+        return op;
+    }
+
+public:
+    explicit FuseOps(const Op *root) {
+        for (int i = 0; i < root->input_count(); i++) {
+            inputs_and_outputs_.insert(root->input(i).get());
+        }
+        for (int i = 0; i < root->output_count(); i++) {
+            inputs_and_outputs_.insert(root->output(i).get());
+        }
+    }
+
+    bool prepare_failed = false;
+};
+
+}  // namespace
+
+OpPtr fuse_ops(OpPtr op) {
+    FuseOps fuser(op.get());
+    op = fuser.mutate(std::move(op));
+    if (fuser.prepare_failed) {
+        return nullptr;
+    }
+    // Remove the ops that were fused into their consumers now, so that
+    // later transforms don't see them.
+    return remove_dead_ops(std::move(op));
+}
+
+namespace {
+
+// Tensors are indexed by c, x, y, b; chains are executed in strips of y.
+constexpr int kStripDim = 2;
+
+class TileOpChains : public OpMutator {
+    using OpMutator::visit;
+
+    size_t strip_bytes_;
+    int verbosity_;
+
+    std::unordered_set<Tensor *> inputs_and_outputs_;
+
+    bool is_root_input_or_output(const TensorPtr &t) const {
+        return inputs_and_outputs_.count(t.get()) > 0;
+    }
+
+    // Whether the output of op can be an intermediate tensor of a chain,
+    // computed a strip at a time for the op `next`.
+    bool can_be_intermediate(const Op *op, const Op *next) const {
+        if (op->output_count() != 1 || next->input_count() < 1) {
+            return false;
+        }
+        const TensorPtr &t = op->output();
+        if (next->input(0) != t ||
+            t->producers().size() != 1 || t->consumers().size() != 1 ||
+            is_root_input_or_output(t) || t->alias_type() != AliasType::None ||
+            t->is_constant() || t->is_dynamic() || t->is_external() || t->is_allocated() ||
+            t->rank() <= kStripDim) {
+            return false;
+        }
+        for (int d = kStripDim + 1; d < t->rank(); d++) {
+            if (t->extent(d) != 1) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Compute the crops of each op's output needed to compute the given
+    // rows of the last op's output.
+    static std::vector<Box> get_strip_crops(const std::vector<OpPtr> &chain, const Interval &rows) {
+        std::vector<Box> crops(chain.size());
+        Box crop = chain.back()->output()->bounds();
+        crop[kStripDim] = intersect(crop[kStripDim], rows);
+        for (int i = (int)chain.size() - 1; i >= 0; i--) {
+            crops[i] = crop;
+            if (i > 0) {
+                const Box required = chain[i]->map_bounds(0, 0).evaluate(crop);
+                crop = chain[i - 1]->output()->bounds();
+                crop[kStripDim] = intersect(crop[kStripDim], required[kStripDim]);
+            }
+        }
+        return crops;
+    }
+
+    // The memory needed for the intermediate tensors of one strip.
+    static size_t get_strip_bytes(const std::vector<OpPtr> &chain, const std::vector<Box> &crops) {
+        size_t result = 0;
+        for (int i = 0; i + 1 < (int)chain.size(); i++) {
+            const TensorPtr &t = chain[i]->output();
+            result += (size_t)crops[i][kStripDim].extent() * t->buffer().dim(kStripDim).stride() * t->type().bytes();
+        }
+        return result;
+    }
+
+    // Make a TiledOpGroup of the chain, if it has strips with intermediates
+    // that fit in strip_bytes_ (and that don't fit otherwise).
+    OpPtr make_tiled_group(std::vector<OpPtr> &chain) {
+        const int height = chain.back()->output()->extent(kStripDim);
+        const int min_y = chain.back()->output()->bounds(kStripDim).min;
+        std::vector<std::vector<Box>> strip_crops;
+        for (int strip_height = height / 2; strip_height >= 1; strip_height--) {
+            strip_crops.clear();
+            size_t max_bytes = 0;
+            for (int y = 0; y < height; y += strip_height) {
+                strip_crops.push_back(get_strip_crops(chain, Interval(min_y + y, min_y + y + strip_height - 1)));
+                max_bytes = std::max(max_bytes, get_strip_bytes(chain, strip_crops.back()));
+            }
+            if (max_bytes <= strip_bytes_) {
+                break;
+            }
+            strip_crops.clear();
+        }
+        if (strip_crops.empty()) {
+            return nullptr;
+        }
+        const std::vector<Box> whole = get_strip_crops(chain, chain.back()->output()->bounds(kStripDim));
+        if (get_strip_bytes(chain, whole) <= strip_bytes_) {
+            // The intermediates fit already.
+            return nullptr;
+        }
+
+        // The inputs of the group are the inputs of the ops that aren't
+        // intermediates.
+        std::vector<TensorPtr> inputs;
+        for (size_t i = 0; i < chain.size(); i++) {
+            for (int j = (i == 0 ? 0 : 1); j < chain[i]->input_count(); j++) {
+                if (chain[i]->input(j)) {
+                    inputs.push_back(chain[i]->input(j));
+                }
+            }
+        }
+        std::vector<TensorPtr> outputs = {chain.back()->output()};
+
+        if (verbosity_ >= 1) {
+            HLOG(INFO) << "Executing a chain of " << chain.size() << " ops, ending with "
+                       << chain.back()->name() << ", in " << strip_crops.size() << " strips";
+        }
+        return make_op<TiledOpGroup>(std::move(inputs), std::move(outputs), std::move(chain),
+                                     kStripDim, std::move(strip_crops));
+    }
+
+    void finish_chain(std::vector<OpPtr> &chain, std::vector<OpPtr> &ops_new) {
+        if (chain.size() >= 2) {
+            if (OpPtr group = make_tiled_group(chain)) {
+                ops_new.push_back(std::move(group));
+                chain.clear();
+                return;
+            }
+        }
+        for (auto &i : chain) {
+            ops_new.push_back(std::move(i));
+        }
+        chain.clear();
+    }
+
+    OpPtr visit(std::unique_ptr<OpGroup> op) override {
+        // Find runs of consecutive ops that support crops, where each op
+        // consumes the output of the previous one and nothing else does.
+        std::vector<OpPtr> ops_new;
+        std::vector<OpPtr> chain;
+        for (int i = 0; i < op->op_count(); i++) {
+            OpPtr op_i = op->take_op(i);
+            if (!op_i->supports_crops()) {
+                finish_chain(chain, ops_new);
+                ops_new.push_back(std::move(op_i));
+                continue;
+            }
+            if (!chain.empty() && !can_be_intermediate(chain.back().get(), op_i.get())) {
+                finish_chain(chain, ops_new);
+            }
+            chain.push_back(std::move(op_i));
+        }
+        finish_chain(chain, ops_new);
+
+        return make_op<OpGroup>(op->inputs(), op->outputs(), std::move(ops_new));
+    }
+
+public:
+    TileOpChains(const Op *root, size_t strip_bytes, int verbosity)
+        : strip_bytes_(strip_bytes), verbosity_(verbosity) {
+        for (int i = 0; i < root->input_count(); i++) {
+            inputs_and_outputs_.insert(root->input(i).get());
+        }
+        for (int i = 0; i < root->output_count(); i++) {
+            inputs_and_outputs_.insert(root->output(i).get());
+        }
+    }
+};
+
+}  // namespace
+
+OpPtr tile_op_chains(OpPtr op, size_t strip_bytes, int verbosity) {
+    TileOpChains tiler(op.get(), strip_bytes, verbosity);
+    return tiler.mutate(std::move(op));
+}
+
 }  // namespace hannk
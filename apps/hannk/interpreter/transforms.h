@@ -18,19 +18,35 @@ namespace hannk {
 [[nodiscard]] OpPtr pad_for_ops(OpPtr op);
 
 // Execute ops that are constant, and mark the results
-// constant as well.
-[[nodiscard]] OpPtr fold_constants(OpPtr op);
+// constant as well. If cache is not null, the results of
+// ops that depend only on their inputs' data are taken
+// from the cache if possible, and added to it otherwise.
+[[nodiscard]] OpPtr fold_constants(OpPtr op, ConstantCache *cache = nullptr);
 
 // Flatten all nested OpGroups into a single OpGroup.
 // TODO: OpGroups that represent subgraphs shouldn't be flattened;
 // this will need smartening when we represent subgraphs in hannk.
 [[nodiscard]] OpPtr flatten_groups(OpPtr op);
 
+// Fuse ops that can be computed as part of the op producing their input,
+// e.g. a quantized add of the result of a convolution (as in residual
+// connections), so the intermediate result is never stored. Chains of unary
+// ops are similarly replaced by one elementwise program. This should
+// be run before in_place(). New ops will have prepare() called on them;
+// this will return nullptr if any of those calls fail.
+[[nodiscard]] OpPtr fuse_ops(OpPtr op);
+
 // Some networks use padding already for other reasons, so
 // we might have introduced two paddings in a row, which is
 // a waste; this combines them. (This should be run after flatten_groups().)
 [[nodiscard]] OpPtr fuse_pad_ops(OpPtr op);
 
+// Replace chains of ops that can execute on strips of their outputs, each
+// consuming the output of the previous one, with TiledOpGroups, so the
+// intermediate tensors of each strip need at most strip_bytes of memory.
+// This should be run after all other transforms, on a flattened OpGroup.
+[[nodiscard]] OpPtr tile_op_chains(OpPtr op, size_t strip_bytes, int verbosity = 0);
+
 }  // namespace hannk
 
 #endif  // HANNK_TRANSFORMS_H
@@ -406,6 +406,8 @@ ModelRunner::RunResult ModelRunner::run_in_hannk(const std::vector<char> &buffer
 
     InterpreterOptions options;
     options.verbosity = verbosity;
+    options.parallel_ops = parallel_ops;
+    options.strip_bytes = strip_bytes;
     Interpreter interpreter(std::move(model), std::move(options));
     if (!interpreter.prepare()) {
         std::cerr << "hannk::Interpreter::prepare() failed\n";
@@ -572,10 +574,18 @@ int ModelRunner::parse_flags(int argc, char **argv, std::vector<std::string> &fi
              this->keep_going = std::stoi(value) != 0;
              return 0;
          }},
+        {"parallel_ops", [this](const std::string &value) {
+             this->parallel_ops = std::stoi(value) != 0;
+             return 0;
+         }},
         {"seed", [&seed](const std::string &value) {
              seed = std::stoi(value);
              return 0;
          }},
+        {"strip_bytes", [this](const std::string &value) {
+             this->strip_bytes = std::stoul(value);
+             return 0;
+         }},
         {"threads", [this](const std::string &value) {
              this->threads = std::stoi(value);
              return 0;
@@ -106,6 +106,8 @@ struct ModelRunner {
     bool do_benchmark = true;
     bool do_compare_results = true;
     bool keep_going = false;
+    bool parallel_ops = false;
+    size_t strip_bytes = 0;
     double tolerance;
     bool csv_output = false;
     int run_count = 0;
@@ -159,6 +159,24 @@ public:
     }
 };
 
+template<typename T, size_t Capacity>
+inline bool operator==(const SmallVector<T, Capacity> &a, const SmallVector<T, Capacity> &b) {
+    if (a.size() != b.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < a.size(); ++i) {
+        if (!(a[i] == b[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+template<typename T, size_t Capacity>
+inline bool operator!=(const SmallVector<T, Capacity> &a, const SmallVector<T, Capacity> &b) {
+    return !(a == b);
+}
+
 template<typename T, size_t Capacity>
 inline std::ostream &operator<<(std::ostream &s, const SmallVector<T, Capacity> &v) {
     s << "{";
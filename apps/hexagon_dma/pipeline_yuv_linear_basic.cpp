@@ -16,7 +16,8 @@ public:
                           Fold,
                           Async,
                           Split,
-                          Split_Async };
+                          Split_Async,
+                          Stream };
     GeneratorParam<Schedule> schedule{"schedule",
                                       /* default value */
                                       Schedule::Basic,
@@ -25,7 +26,8 @@ public:
                                        {"fold", Schedule::Fold},
                                        {"async", Schedule::Async},
                                        {"split", Schedule::Split},
-                                       {"split_async", Schedule::Split_Async}}};
+                                       {"split_async", Schedule::Split_Async},
+                                       {"stream", Schedule::Stream}}};
 
     GeneratorParam<bool> use_dma_for_output{"use_dma_for_output", true};
 
@@ -191,6 +193,20 @@ public:
                 .reorder_storage(c, x, y)
                 .fold_storage(x, tile_width * 2);
         } break;
+        case Schedule::Stream:
+            output_y
+                .tile(x, y, tx, ty, x, y, tile_width, tile_height, TailStrategy::RoundUp);
+
+            output_uv
+                .tile(x, y, tx, ty, x, y, tile_width, tile_height, TailStrategy::RoundUp);
+
+            input_y_copy
+                .stream_via_dma(LoopLevel(output_y, tx), LoopLevel(output_y, ty), x, tile_width);
+
+            input_uv_copy
+                .stream_via_dma(LoopLevel(output_uv, tx), LoopLevel(output_uv, ty), x, tile_width)
+                .reorder_storage(c, x, y);
+            break;
         }
 
         // async tiled output
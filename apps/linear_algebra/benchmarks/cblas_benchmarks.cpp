@@ -7,7 +7,7 @@
 // Accepted values for subroutine are:
 //    L1: scal, copy, axpy, dot, nrm2
 //    L2: gemv_notrans, gemv_trans
-//    L3: gemm_notrans, gemm_transA, gemm_transB, gemm_transAB
+//    L3: gemm_notrans, gemm_transA, gemm_transB, gemm_transAB, gemm_batched
 //
 
 #include "cblas.h"
@@ -27,6 +27,7 @@ struct BenchmarksBase {
     typedef T Scalar;
     typedef std::vector<T> Vector;
     typedef std::vector<T> Matrix;
+    typedef std::vector<T> Batch;
 
     std::random_device rand_dev;
     std::default_random_engine rand_eng{rand_dev()};
@@ -54,6 +55,14 @@ struct BenchmarksBase {
         return buff;
     }
 
+    Batch random_batch(int N, int count) {
+        Batch buff(N * N * count);
+        for (int i = 0; i < N * N * count; ++i) {
+            buff[i] = random_scalar();
+        }
+        return buff;
+    }
+
     BenchmarksBase(std::string n)
         : name(n) {
     }
@@ -83,6 +92,8 @@ struct BenchmarksBase {
             this->bench_gemm_transB(size);
         } else if (benchmark == "gemm_transAB") {
             this->bench_gemm_transAB(size);
+        } else if (benchmark == "gemm_batched") {
+            this->bench_gemm_batched(size);
         }
     }
 
@@ -98,6 +109,7 @@ struct BenchmarksBase {
     virtual void bench_gemm_transA(int N) = 0;
     virtual void bench_gemm_transB(int N) = 0;
     virtual void bench_gemm_transAB(int N) = 0;
+    virtual void bench_gemm_batched(int N) = 0;
 };
 
 struct BenchmarksFloat : public BenchmarksBase<float> {
@@ -126,6 +138,10 @@ struct BenchmarksFloat : public BenchmarksBase<float> {
     L3Benchmark(gemm_transB, "s", cblas_sgemm(CblasColMajor, CblasNoTrans, CblasTrans, N, N, N, alpha, &(A[0]), N, &(B[0]), N, beta, &(C[0]), N));
 
     L3Benchmark(gemm_transAB, "s", cblas_sgemm(CblasColMajor, CblasTrans, CblasTrans, N, N, N, alpha, &(A[0]), N, &(B[0]), N, beta, &(C[0]), N));
+
+    L3BatchedBenchmark(gemm_batched, "s", for (int b = 0; b < count; b++) {
+        cblas_sgemm(CblasColMajor, CblasNoTrans, CblasNoTrans, N, N, N, alpha, &(A[b * N * N]), N, &(B[b * N * N]), N, beta, &(C[b * N * N]), N);
+    });
 };
 
 struct BenchmarksDouble : public BenchmarksBase<double> {
@@ -154,6 +170,10 @@ struct BenchmarksDouble : public BenchmarksBase<double> {
     L3Benchmark(gemm_transB, "d", cblas_dgemm(CblasColMajor, CblasNoTrans, CblasTrans, N, N, N, alpha, &(A[0]), N, &(B[0]), N, beta, &(C[0]), N));
 
     L3Benchmark(gemm_transAB, "d", cblas_dgemm(CblasColMajor, CblasTrans, CblasTrans, N, N, N, alpha, &(A[0]), N, &(B[0]), N, beta, &(C[0]), N));
+
+    L3BatchedBenchmark(gemm_batched, "d", for (int b = 0; b < count; b++) {
+        cblas_dgemm(CblasColMajor, CblasNoTrans, CblasNoTrans, N, N, N, alpha, &(A[b * N * N]), N, &(B[b * N * N]), N, beta, &(C[b * N * N]), N);
+    });
 };
 
 int main(int argc, char *argv[]) {
@@ -7,7 +7,7 @@
 // Accepted values for subroutine are:
 //    L1: scal, copy, axpy, dot, nrm2
 //    L2: gemv_notrans, gemv_trans
-//    L3: gemm_notrans, gemm_trans_A, gemm_trans_B, gemm_trans_AB
+//    L3: gemm_notrans, gemm_trans_A, gemm_trans_B, gemm_trans_AB, gemm_batched
 //
 
 #include "clock.h"
@@ -16,6 +16,7 @@
 #include <iomanip>
 #include <iostream>
 #include <string>
+#include <vector>
 
 template<class T>
 std::string type_name();
@@ -43,6 +44,7 @@ struct BenchmarksBase {
     virtual void bench_gemm_transA(int N) = 0;
     virtual void bench_gemm_transB(int N) = 0;
     virtual void bench_gemm_transAB(int N) = 0;
+    virtual void bench_gemm_batched(int N) = 0;
 };
 
 template<class T>
@@ -50,6 +52,7 @@ struct Benchmarks : BenchmarksBase {
     typedef T Scalar;
     typedef Eigen::Matrix<T, Eigen::Dynamic, 1> Vector;
     typedef Eigen::Matrix<T, Eigen::Dynamic, Eigen::Dynamic> Matrix;
+    typedef std::vector<Matrix> Batch;
 
     Scalar random_scalar() {
         Vector x(1);
@@ -69,6 +72,14 @@ struct Benchmarks : BenchmarksBase {
         return A;
     }
 
+    Batch random_batch(int N, int count) {
+        Batch batch;
+        for (int i = 0; i < count; i++) {
+            batch.push_back(random_matrix(N));
+        }
+        return batch;
+    }
+
     Benchmarks(std::string n)
         : name(n) {
     }
@@ -98,6 +109,8 @@ struct Benchmarks : BenchmarksBase {
             bench_gemm_transB(size);
         } else if (benchmark == "gemm_transAB") {
             bench_gemm_transAB(size);
+        } else if (benchmark == "gemm_batched") {
+            bench_gemm_batched(size);
         }
     }
 
@@ -117,6 +130,9 @@ struct Benchmarks : BenchmarksBase {
     L3Benchmark(gemm_transA, type_name<T>(), C = alpha * A.transpose() * B + beta * C);
     L3Benchmark(gemm_transB, type_name<T>(), C = alpha * A * B.transpose() + beta * C);
     L3Benchmark(gemm_transAB, type_name<T>(), C = alpha * A.transpose() * B.transpose() + beta * C);
+    L3BatchedBenchmark(gemm_batched, type_name<T>(), for (int b = 0; b < count; b++) {
+        C[b] = alpha * A[b] * B[b] + beta * C[b];
+    });
 
 private:
     std::string name;
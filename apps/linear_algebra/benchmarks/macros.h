@@ -121,3 +121,26 @@ inline void set_math_flags() {
             << std::setw(20) << L3GFLOPS(N)             \
             << "\n";                                    \
     }
+
+// Batches of small matrices are benchmarked with about a million
+// elements per operand.
+#define L3_BATCH_COUNT(N) ((N) * (N) < (1 << 20) ? (1 << 20) / ((N) * (N)) : 1)
+#define L3BatchedBenchmark(benchmark, type, code)             \
+    virtual void bench_##benchmark(int N) override {          \
+        Scalar alpha = random_scalar();                       \
+        Scalar beta = random_scalar();                        \
+        const int count = L3_BATCH_COUNT(N);                  \
+        Batch A(random_batch(N, count));                      \
+        Batch B(random_batch(N, count));                      \
+        Batch C(random_batch(N, count));                      \
+                                                              \
+        time_it(code)                                         \
+                                                              \
+                std::cout                                     \
+            << std::setw(8) << name                           \
+            << std::setw(15) << type << #benchmark            \
+            << std::setw(8) << std::to_string(N)              \
+            << std::setw(20) << std::to_string(elapsed)       \
+            << std::setw(20) << count * L3GFLOPS(N)           \
+            << "\n";                                          \
+    }
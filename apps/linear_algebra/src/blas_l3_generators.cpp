@@ -172,7 +172,121 @@ public:
     }
 };
 
+// The shape of the block of the result a micro-kernel keeps in
+// registers: a number of vectors in each column, and a number of
+// columns. These leave room in the vector register file for a column of
+// A and a broadcast element of B.
+struct MicroKernel {
+    int vectors, columns;
+};
+
+MicroKernel micro_kernel_shape(const Target &target) {
+    if (target.has_feature(Target::AVX512)) {
+        // 32 zmm registers.
+        return {2, 12};
+    } else if (target.arch == Target::ARM && target.bits == 64) {
+        // 32 NEON (or SVE) registers.
+        return {2, 12};
+    } else if (target.has_feature(Target::AVX2) || target.has_feature(Target::AVX)) {
+        // 16 ymm registers.
+        return {2, 6};
+    }
+    return {2, 4};
+}
+
+// Generator class for batches of small gemm operations, on column-major
+// matrices stacked along the last dimension.
+template<class T>
+class GEMMBatchedGenerator : public Generator<GEMMBatchedGenerator<T>> {
+public:
+    typedef Generator<GEMMBatchedGenerator<T>> Base;
+    using Base::get_target;
+    using Base::natural_vector_size;
+    using Base::target;
+    template<typename T2>
+    using Input = typename Base::template Input<T2>;
+    template<typename T2>
+    using Output = typename Base::template Output<T2>;
+
+    Input<T> a_{"a_", 1};
+    Input<Buffer<T, 3>> A_{"A_"};
+    Input<Buffer<T, 3>> B_{"B_"};
+    Input<T> b_{"b_", 1};
+    Input<Buffer<T, 3>> C_{"C_"};
+
+    Output<Buffer<T, 3>> result_{"result"};
+
+    void generate() {
+        const Expr num_rows = A_.width();
+        const Expr num_cols = B_.height();
+        const Expr sum_size = A_.height();
+
+        const int vec = natural_vector_size(a_.type());
+        const MicroKernel kernel = micro_kernel_shape(get_target());
+        const int mr = kernel.vectors * vec;
+        const int nr = kernel.columns;
+
+        Var i("i"), j("j"), k("k"), n("n");
+        Var ii("ii"), ji("ji"), io("io"), jo("jo");
+
+        // Pack A into panels of mr rows, and B into panels of nr
+        // columns, so that the micro-kernel reads both densely along
+        // k. The panels are padded with zeros to whole panels.
+        Func A_pad = BoundaryConditions::constant_exterior(A_, cast<T>(0), 0, num_rows, 0, sum_size);
+        Func B_pad = BoundaryConditions::constant_exterior(B_, cast<T>(0), 0, sum_size, 0, num_cols);
+        Func A_packed("A_packed"), B_packed("B_packed");
+        A_packed(ii, k, io, n) = A_pad(io * mr + ii, k, n);
+        B_packed(ji, k, jo, n) = B_pad(k, jo * nr + ji, n);
+
+        Func AB("AB");
+        RDom rv(0, sum_size);
+        AB(i, j, n) += A_packed(i % mr, rv, i / mr, n) * B_packed(j % nr, rv, j / nr, n);
+
+        result_(i, j, n) = a_ * AB(i, j, n) + b_ * C_(i, j, n);
+
+        // The macro-kernel walks the micro-tiles of each matrix, and the
+        // matrices of the batch are spread across threads.
+        result_.tile(i, j, io, jo, i, j, mr, nr, TailStrategy::GuardWithIf)
+            .vectorize(i, vec)
+            .unroll(i)
+            .unroll(j)
+            .reorder(i, j, io, jo, n)
+            .parallel(n);
+
+        // The micro-kernel: an mr x nr block of accumulators, updated
+        // with one column of A and one row of B per step along k.
+        AB.compute_at(result_, io)
+            .bound_extent(i, mr)
+            .bound_extent(j, nr)
+            .vectorize(i, vec)
+            .unroll(i)
+            .unroll(j)
+            .update()
+            .reorder(i, j, rv)
+            .vectorize(i, vec)
+            .unroll(i)
+            .unroll(j);
+
+        A_packed.compute_at(result_, n)
+            .vectorize(ii, vec)
+            .unroll(ii);
+        B_packed.compute_at(result_, n)
+            .unroll(ji);
+
+        const Expr batch_size = C_.dim(2).extent();
+        A_.dim(0).set_min(0).dim(1).set_min(0).dim(2).set_bounds(0, batch_size);
+        B_.dim(0).set_bounds(0, sum_size).dim(1).set_min(0).dim(2).set_bounds(0, batch_size);
+        C_.dim(0).set_bounds(0, num_rows);
+        C_.dim(1).set_bounds(0, num_cols);
+        C_.dim(2).set_min(0);
+        result_.dim(0).set_bounds(0, num_rows).dim(1).set_bounds(0, num_cols);
+        result_.dim(2).set_bounds(0, batch_size);
+    }
+};
+
 }  // namespace
 
 HALIDE_REGISTER_GENERATOR(GEMMGenerator<float>, sgemm)
 HALIDE_REGISTER_GENERATOR(GEMMGenerator<double>, dgemm)
+HALIDE_REGISTER_GENERATOR(GEMMBatchedGenerator<float>, sgemm_batched)
+HALIDE_REGISTER_GENERATOR(GEMMBatchedGenerator<double>, dgemm_batched)
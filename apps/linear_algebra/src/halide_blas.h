@@ -8,6 +8,7 @@
 #include "halide_daxpy_impl.h"
 #include "halide_dcopy_impl.h"
 #include "halide_ddot.h"
+#include "halide_dgemm_batched.h"
 #include "halide_dgemm_notrans.h"
 #include "halide_dgemm_transA.h"
 #include "halide_dgemm_transAB.h"
@@ -20,6 +21,7 @@
 #include "halide_saxpy_impl.h"
 #include "halide_scopy_impl.h"
 #include "halide_sdot.h"
+#include "halide_sgemm_batched.h"
 #include "halide_sgemm_notrans.h"
 #include "halide_sgemm_transA.h"
 #include "halide_sgemm_transAB.h"
@@ -246,6 +248,23 @@ void hblas_dgemm(const enum HBLAS_ORDER Order, const enum HBLAS_TRANSPOSE TransA
                  const int lda, const double *B, const int ldb,
                  const double beta, double *C, const int ldc);
 
+/*
+ * Batches of column-major gemms without transposes, for many small
+ * matrices. Matrix b of each batch starts stride elements after matrix
+ * b - 1.
+ */
+void hblas_sgemm_batched(const int M, const int N, const int K, const float alpha,
+                         const float *A, const int lda, const int strideA,
+                         const float *B, const int ldb, const int strideB,
+                         const float beta, float *C, const int ldc, const int strideC,
+                         const int batch_count);
+
+void hblas_dgemm_batched(const int M, const int N, const int K, const double alpha,
+                         const double *A, const int lda, const int strideA,
+                         const double *B, const int ldb, const int strideB,
+                         const double beta, double *C, const int ldc, const int strideC,
+                         const int batch_count);
+
 #ifdef __cplusplus
 }
 #endif
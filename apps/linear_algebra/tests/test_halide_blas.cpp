@@ -113,6 +113,35 @@
         return compareMatrices(N, eC, aC);      \
     }
 
+// Batches of small matrices, with sizes that don't fill whole
+// micro-kernel tiles.
+#define L3_BATCHED_TEST(method, cblas_code, hblas_code)             \
+    bool test_##method(int N) {                                     \
+        const int M = 13, n = 7, K = 11, count = 5;                 \
+        Scalar alpha = random_scalar();                             \
+        Scalar beta = random_scalar();                              \
+        Matrix eA(random_matrix_elements(M * K * count));           \
+        Matrix eB(random_matrix_elements(K * n * count));           \
+        Matrix eC(random_matrix_elements(M * n * count));           \
+        Matrix aA(eA), aB(eB), aC(eC);                              \
+                                                                    \
+        for (int b = 0; b < count; b++) {                           \
+            Scalar *A = &(eA[b * M * K]);                           \
+            Scalar *B = &(eB[b * K * n]);                           \
+            Scalar *C = &(eC[b * M * n]);                           \
+            cblas_code;                                             \
+        }                                                           \
+                                                                    \
+        {                                                           \
+            Scalar *A = &(aA[0]);                                   \
+            Scalar *B = &(aB[0]);                                   \
+            Scalar *C = &(aC[0]);                                   \
+            hblas_code;                                             \
+        }                                                           \
+                                                                    \
+        return compareVectors(M * n * count, eC, aC);               \
+    }
+
 template<class T>
 struct BLASTestBase {
     typedef T Scalar;
@@ -140,8 +169,12 @@ struct BLASTestBase {
     }
 
     Matrix random_matrix(int N) {
-        Matrix buff(N * N);
-        for (int i = 0; i < N * N; ++i) {
+        return random_matrix_elements(N * N);
+    }
+
+    Matrix random_matrix_elements(int size) {
+        Matrix buff(size);
+        for (int i = 0; i < size; ++i) {
             buff[i] = random_scalar();
         }
         return buff;
@@ -213,6 +246,7 @@ struct BLASFloatTests : public BLASTestBase<float> {
         RUN_TEST(sgemm_transA);
         RUN_TEST(sgemm_transB);
         RUN_TEST(sgemm_transAB);
+        RUN_TEST(sgemm_batched);
     }
 
     L1_VECTOR_TEST(scopy, scopy(N, x, 1, y, 1))
@@ -244,6 +278,9 @@ struct BLASFloatTests : public BLASTestBase<float> {
     L3_TEST(sgemm_transAB,
             cblas_sgemm(CblasColMajor, CblasTrans, CblasTrans, N, N, N, alpha, A, N, B, N, beta, C, N),
             hblas_sgemm(HblasColMajor, HblasTrans, HblasTrans, N, N, N, alpha, A, N, B, N, beta, C, N));
+    L3_BATCHED_TEST(sgemm_batched,
+                    cblas_sgemm(CblasColMajor, CblasNoTrans, CblasNoTrans, M, n, K, alpha, A, M, B, K, beta, C, M),
+                    hblas_sgemm_batched(M, n, K, alpha, A, M, M * K, B, K, K * n, beta, C, M, M * n, count));
 };
 
 struct BLASDoubleTests : public BLASTestBase<double> {
@@ -260,6 +297,7 @@ struct BLASDoubleTests : public BLASTestBase<double> {
         RUN_TEST(dgemm_transA);
         RUN_TEST(dgemm_transB);
         RUN_TEST(dgemm_transAB);
+        RUN_TEST(dgemm_batched);
     }
 
     L1_VECTOR_TEST(dcopy, dcopy(N, x, 1, y, 1))
@@ -291,6 +329,9 @@ struct BLASDoubleTests : public BLASTestBase<double> {
     L3_TEST(dgemm_transAB,
             cblas_dgemm(CblasColMajor, CblasTrans, CblasTrans, N, N, N, alpha, A, N, B, N, beta, C, N),
             hblas_dgemm(HblasColMajor, HblasTrans, HblasTrans, N, N, N, alpha, A, N, B, N, beta, C, N));
+    L3_BATCHED_TEST(dgemm_batched,
+                    cblas_dgemm(CblasColMajor, CblasNoTrans, CblasNoTrans, M, n, K, alpha, A, M, B, K, beta, C, M),
+                    hblas_dgemm_batched(M, n, K, alpha, A, M, M * K, B, K, K * n, beta, C, M, M * n, count));
 };
 
 int main(int argc, char *argv[]) {
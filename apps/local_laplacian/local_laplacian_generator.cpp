@@ -3,6 +3,8 @@
 
 namespace {
 
+using Halide::ImagePyramid;
+
 constexpr int maxJ = 20;
 
 class LocalLaplacian : public Halide::Generator<LocalLaplacian> {
@@ -36,47 +38,34 @@ public:
         gray(x, y) = 0.299f * floating(x, y, 0) + 0.587f * floating(x, y, 1) + 0.114f * floating(x, y, 2);
 
         // Make the processed Gaussian pyramid.
-        Func gPyramid[maxJ];
+        Func processed;
         // Do a lookup into a lut with 256 entires per intensity level
         Expr level = k * (1.0f / (levels - 1));
         Expr idx = gray(x, y) * cast<float>(levels - 1) * 256.0f;
         idx = clamp(cast<int>(idx), 0, (levels - 1) * 256);
-        gPyramid[0](x, y, k) = beta * (gray(x, y) - level) + level + remap(idx - 256 * k);
-        for (int j = 1; j < J; j++) {
-            gPyramid[j](x, y, k) = downsample(gPyramid[j - 1])(x, y, k);
-        }
+        processed(x, y, k) = beta * (gray(x, y) - level) + level + remap(idx - 256 * k);
+        ImagePyramid gPyramid = ImagePyramid::gaussian(processed, J, "gPyramid");
 
         // Get its laplacian pyramid
-        Func lPyramid[maxJ];
-        lPyramid[J - 1](x, y, k) = gPyramid[J - 1](x, y, k);
-        for (int j = J - 2; j >= 0; j--) {
-            lPyramid[j](x, y, k) = gPyramid[j](x, y, k) - upsample(gPyramid[j + 1])(x, y, k);
-        }
+        ImagePyramid lPyramid = gPyramid.laplacian("lPyramid");
 
         // Make the Gaussian pyramid of the input
-        Func inGPyramid[maxJ];
-        inGPyramid[0](x, y) = gray(x, y);
-        for (int j = 1; j < J; j++) {
-            inGPyramid[j](x, y) = downsample(inGPyramid[j - 1])(x, y);
-        }
+        ImagePyramid inGPyramid = ImagePyramid::gaussian(gray, J, "inGPyramid");
 
         // Make the laplacian pyramid of the output
-        Func outLPyramid[maxJ];
-        for (int j = 0; j < J; j++) {
+        ImagePyramid outLPyramid = inGPyramid.map([&](const Func &in, int j) {
             // Split input pyramid value into integer and floating parts
-            Expr level = inGPyramid[j](x, y) * cast<float>(levels - 1);
+            Expr level = in(x, y) * cast<float>(levels - 1);
             Expr li = clamp(cast<int>(level), 0, levels - 2);
             Expr lf = level - cast<float>(li);
             // Linearly interpolate between the nearest processed pyramid levels
-            outLPyramid[j](x, y) = (1.0f - lf) * lPyramid[j](x, y, li) + lf * lPyramid[j](x, y, li + 1);
-        }
+            Func out("outLPyramid_" + std::to_string(j));
+            out(x, y) = (1.0f - lf) * lPyramid[j](x, y, li) + lf * lPyramid[j](x, y, li + 1);
+            return out;
+        });
 
         // Make the Gaussian pyramid of the output
-        Func outGPyramid[maxJ];
-        outGPyramid[J - 1](x, y) = outLPyramid[J - 1](x, y);
-        for (int j = J - 2; j >= 0; j--) {
-            outGPyramid[j](x, y) = upsample(outGPyramid[j + 1])(x, y) + outLPyramid[j](x, y);
-        }
+        ImagePyramid outGPyramid = outLPyramid.collapse("outGPyramid");
 
         // Reintroduce color (Connelly: use eps to avoid scaling up noise w/ apollo3.png input)
         Func color;
@@ -255,24 +244,6 @@ public:
 
 private:
     Var x, y, c, k;
-
-    // Downsample with a 1 3 3 1 filter
-    Func downsample(Func f) {
-        using Halide::_;
-        Func downx, downy;
-        downy(x, y, _) = (f(x, 2 * y - 1, _) + 3.0f * (f(x, 2 * y, _) + f(x, 2 * y + 1, _)) + f(x, 2 * y + 2, _)) / 8.0f;
-        downx(x, y, _) = (downy(2 * x - 1, y, _) + 3.0f * (downy(2 * x, y, _) + downy(2 * x + 1, y, _)) + downy(2 * x + 2, y, _)) / 8.0f;
-        return downx;
-    }
-
-    // Upsample using bilinear interpolation
-    Func upsample(Func f) {
-        using Halide::_;
-        Func upx, upy;
-        upx(x, y, _) = lerp(f((x + 1) / 2, y, _), f((x - 1) / 2, y, _), ((x % 2) * 2 + 1) / 4.0f);
-        upy(x, y, _) = lerp(upx(x, (y + 1) / 2, _), upx(x, (y - 1) / 2, _), ((y % 2) * 2 + 1) / 4.0f);
-        return upy;
-    }
 };
 
 }  // namespace
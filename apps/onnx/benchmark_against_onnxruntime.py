@@ -0,0 +1,71 @@
+"""Compare the runtime of an ONNX model under Halide and under onnxruntime.
+
+Usage: python benchmark_against_onnxruntime.py model.onnx [num_iters]
+
+The Halide pipeline is autoscheduled as a whole before being timed.
+Symbolic dimensions of the inputs are assumed to be 1. The caches are
+flushed before each Halide run but not before each onnxruntime one, so
+the comparison errs in favor of onnxruntime.
+"""
+import sys
+import timeit
+
+import numpy as np
+import onnx
+from onnx import mapping
+
+from model import Model
+
+
+def random_inputs(onnx_model):
+    initializers = {t.name for t in onnx_model.graph.initializer}
+    inputs = {}
+    for i in onnx_model.graph.input:
+        if i.name in initializers:
+            continue
+        tensor_type = i.type.tensor_type
+        shape = [d.dim_value if d.HasField('dim_value') else 1
+                 for d in tensor_type.shape.dim]
+        dtype = mapping.TENSOR_TYPE_TO_NP_TYPE[tensor_type.elem_type]
+        inputs[i.name] = np.random.uniform(-1.0, 1.0, shape).astype(dtype)
+    return inputs
+
+
+def benchmark_halide(onnx_model, num_iters):
+    model = Model()
+    model.BuildFromOnnxModel(onnx_model)
+    model.OptimizeSchedule()
+    # Benchmark returns nanoseconds.
+    return model.Benchmark(num_iters) / 1e6
+
+
+def benchmark_onnxruntime(onnx_model, num_iters):
+    import onnxruntime
+    session = onnxruntime.InferenceSession(onnx_model.SerializeToString())
+    inputs = random_inputs(onnx_model)
+    # Warm up
+    session.run(None, inputs)
+    seconds = timeit.timeit(lambda: session.run(None, inputs), number=num_iters)
+    return seconds * 1e3 / num_iters
+
+
+def main():
+    if len(sys.argv) < 2:
+        print(__doc__)
+        sys.exit(1)
+    onnx_model = onnx.load(sys.argv[1])
+    num_iters = int(sys.argv[2]) if len(sys.argv) > 2 else 10
+
+    halide_ms = benchmark_halide(onnx_model, num_iters)
+    print('Halide:      %.3f ms' % halide_ms)
+    try:
+        ort_ms = benchmark_onnxruntime(onnx_model, num_iters)
+    except ImportError:
+        print('onnxruntime isn\'t installed, skipping it')
+        return
+    print('onnxruntime: %.3f ms' % ort_ms)
+    print('Halide / onnxruntime: %.2fx' % (halide_ms / ort_ms))
+
+
+if __name__ == '__main__':
+    main()
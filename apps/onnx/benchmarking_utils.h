@@ -1,6 +1,9 @@
 #ifndef BENCHMARKING_UTILS_H_
 #define BENCHMARKING_UTILS_H_
 
+#include <time.h>
+#include <vector>
+
 // Flush the content of all the CPU caches by updating more data than what would fit in cache. This is simply needed when benchmarking in order to get more reliable performance numbers.
 class CacheEvictor {
 public:
@@ -19,4 +22,34 @@ private:
     std::vector<int> buffer_;
 };
 
+// Return the average runtime in nanoseconds of num_iters calls to f, with the
+// caches flushed before each call. The time spent flushing isn't counted.
+template<typename F>
+double time_iterations(CacheEvictor &cache_evictor, int num_iters, F f) {
+    struct timespec start;
+    struct timespec end;
+    clock_gettime(CLOCK_REALTIME, &start);
+    for (int i = 0; i < num_iters; ++i) {
+        // Increment the coefficients store in the cache evictor: this ensures that
+        // all the data left in caches from the previous iteration is flushed out.
+        cache_evictor.flush_caches();
+        f();
+    }
+    clock_gettime(CLOCK_REALTIME, &end);
+    double total_runtime =
+        (end.tv_sec - start.tv_sec) * 1e9 + end.tv_nsec - start.tv_nsec;
+
+    // Figure out how long the flushing took and adjust the runtime accordingly.
+    clock_gettime(CLOCK_REALTIME, &start);
+    for (int i = 0; i < num_iters; ++i) {
+        cache_evictor.flush_caches();
+    }
+    clock_gettime(CLOCK_REALTIME, &end);
+    double flush_time =
+        (end.tv_sec - start.tv_sec) * 1e9 + end.tv_nsec - start.tv_nsec;
+
+    // TODO: filter the outliers if any.
+    return (total_runtime - flush_time) / num_iters;
+}
+
 #endif
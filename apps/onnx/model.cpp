@@ -469,34 +469,9 @@ double benchmark(
     pipeline.rep->realize(real, tgt);
 
     // Now benchmark by computing the value of the outputs num_iter times
-    struct timespec start;
-    struct timespec end;
-    clock_gettime(CLOCK_REALTIME, &start);
-    for (int i = 0; i < num_iters; ++i) {
-        // Increment the coefficients store in the cache evictor: this ensures that
-        // all the data left in caches from the previous iteration is flushed out.
-        cache_evictor.flush_caches();
+    return time_iterations(cache_evictor, num_iters, [&]() {
         pipeline.rep->realize(real, tgt);
-    }
-    clock_gettime(CLOCK_REALTIME, &end);
-
-    double total_runtime =
-        (end.tv_sec - start.tv_sec) * 1e9 + end.tv_nsec - start.tv_nsec;
-
-    // Figure out how long it took to generate new inputs at every iteration
-    // and adjust the runtime accordingly.
-    clock_gettime(CLOCK_REALTIME, &start);
-    for (int i = 0; i < num_iters; ++i) {
-        cache_evictor.flush_caches();
-    }
-    clock_gettime(CLOCK_REALTIME, &end);
-    double input_gen_time =
-        (end.tv_sec - start.tv_sec) * 1e9 + end.tv_nsec - start.tv_nsec;
-
-    total_runtime -= input_gen_time;
-
-    // Return the average runtime. TODO: filter the outliers if any.
-    return total_runtime / num_iters;
+    });
 }
 
 void compile(
@@ -1,5 +1,6 @@
 #include "onnx_converter.h"
 #include <climits>
+#include <cstring>
 #include <exception>
 #include <math.h>
 #include <unordered_set>
@@ -88,22 +89,37 @@ Halide::Func func_for_node_output(const onnx::NodeProto &node, int output_id) {
     return Halide::Func(sanitize_name(node.output(output_id)));
 }
 
+static bool fold_constant_outputs(const onnx::NodeProto &node, Node &n);
+
+// Convert the nodes of a graph. If constants is set, it holds the names
+// of the tensors known to be constant, and the nodes that only depend on
+// them are evaluated right away.
 static void convert_subgraph(
     const onnx::GraphProto &graph,
     std::unordered_map<std::string, Tensor> &reps,
-    std::vector<Halide::Expr> &requirements) {
+    std::vector<Halide::Expr> &requirements,
+    std::unordered_set<std::string> *constants = nullptr) {
     // The nodes are always stored in topological order in the ONNX model.
     for (const onnx::NodeProto &node : graph.node()) {
         std::vector<Tensor> inputs;
+        bool constant_inputs = (constants != nullptr) &&
+                               (node.op_type().compare(0, 6, "Random") != 0);
         for (const std::string &input_name : node.input()) {
             if (input_name.empty()) {
                 inputs.push_back(Tensor());
             } else {
                 inputs.push_back(reps.at(input_name));
+                constant_inputs = constant_inputs && constants->count(input_name);
             }
         }
         Node n = convert_node(node, inputs);
 
+        if (constant_inputs && fold_constant_outputs(node, n)) {
+            for (const std::string &output_name : node.output()) {
+                constants->insert(output_name);
+            }
+        }
+
         for (int i = 0; i < node.output_size(); ++i) {
             const std::string &output_name = node.output(i);
             if (!output_name.empty()) {
@@ -212,6 +228,67 @@ Halide::Func encode_buffer_as_func(
     result.rep = encode_buffer_as_func(val, dims, NodeName);               \
     static_cast<void>(0)
 
+// Don't fold outputs larger than this, to keep the size of the folded
+// constants in check.
+static constexpr int64_t kMaxFoldedElements = 1 << 20;
+
+static Halide::Func encode_folded_buffer(
+    const Halide::Buffer<> &vals,
+    const std::vector<int> &dims,
+    const std::string &name) {
+#define ENCODE_FOLDED_BUFFER(DataType)                                            \
+    if (vals.type() == Halide::type_of<DataType>()) {                             \
+        return encode_buffer_as_func(Halide::Buffer<DataType>(vals), dims, name); \
+    }
+    ENCODE_FOLDED_BUFFER(float);
+    ENCODE_FOLDED_BUFFER(double);
+    ENCODE_FOLDED_BUFFER(int8_t);
+    ENCODE_FOLDED_BUFFER(int16_t);
+    ENCODE_FOLDED_BUFFER(int32_t);
+    ENCODE_FOLDED_BUFFER(int64_t);
+    ENCODE_FOLDED_BUFFER(uint8_t);
+    ENCODE_FOLDED_BUFFER(uint16_t);
+    ENCODE_FOLDED_BUFFER(uint32_t);
+    ENCODE_FOLDED_BUFFER(uint64_t);
+    ENCODE_FOLDED_BUFFER(bool);
+#undef ENCODE_FOLDED_BUFFER
+    throw std::domain_error("Unsupported type for constant " + name);
+}
+
+// Evaluate the outputs of a node whose inputs are all constant, and
+// replace them with the resulting values. Returns false, leaving the
+// node untouched, if the shape of an output isn't known or is too large.
+static bool fold_constant_outputs(const onnx::NodeProto &node, Node &n) {
+    std::vector<std::vector<int>> shapes(n.outputs.size());
+    for (int i = 0; i < node.output_size(); ++i) {
+        if (node.output(i).empty()) {
+            continue;
+        }
+        int64_t num_elements = 1;
+        for (const Halide::Expr &dim : n.outputs[i].shape) {
+            auto dim_value = Halide::Internal::as_const_int(
+                Halide::Internal::simplify(dim));
+            if (!dim_value || *dim_value < 0) {
+                return false;
+            }
+            shapes[i].push_back(static_cast<int>(*dim_value));
+            num_elements *= *dim_value;
+        }
+        if (num_elements > kMaxFoldedElements) {
+            return false;
+        }
+    }
+    for (int i = 0; i < node.output_size(); ++i) {
+        if (node.output(i).empty()) {
+            continue;
+        }
+        Tensor &t = n.outputs[i];
+        Halide::Buffer<> vals = t.rep.realize(shapes[i]);
+        t.rep = encode_folded_buffer(vals, shapes[i], t.rep.name() + "_folded");
+    }
+    return true;
+}
+
 Tensor build_from_constant(
     const onnx::TensorProto &value,
     const std::string &name) {
@@ -4635,6 +4712,191 @@ std::vector<Halide::Expr> finalize_type_info(
     return result;
 }
 
+// Read the values of a float tensor, whichever field holds them.
+static bool read_float_tensor(const onnx::TensorProto &t, std::vector<float> *vals) {
+    if (t.data_type() != onnx::TensorProto_DataType_FLOAT) {
+        return false;
+    }
+    int64_t num_elements = 1;
+    for (int64_t dim : t.dims()) {
+        num_elements *= dim;
+    }
+    if (t.float_data_size() > 0) {
+        vals->assign(t.float_data().begin(), t.float_data().end());
+    } else {
+        vals->resize(t.raw_data().size() / sizeof(float));
+        memcpy(vals->data(), t.raw_data().data(), vals->size() * sizeof(float));
+    }
+    return vals->size() == num_elements;
+}
+
+static void add_float_initializer(
+    onnx::GraphProto *graph,
+    const std::string &name,
+    const std::vector<int64_t> &dims,
+    const std::vector<float> &vals) {
+    onnx::TensorProto *t = graph->add_initializer();
+    t->set_name(name);
+    t->set_data_type(onnx::TensorProto_DataType_FLOAT);
+    for (int64_t dim : dims) {
+        t->add_dims(dim);
+    }
+    for (float v : vals) {
+        t->add_float_data(v);
+    }
+}
+
+static void keep_nodes(onnx::GraphProto *graph, const std::vector<bool> &removed) {
+    google::protobuf::RepeatedPtrField<onnx::NodeProto> kept;
+    for (int i = 0; i < graph->node_size(); ++i) {
+        if (!removed[i]) {
+            kept.Add()->Swap(graph->mutable_node(i));
+        }
+    }
+    graph->mutable_node()->Swap(&kept);
+}
+
+// Identity nodes only rename a tensor: make their consumers read their
+// input directly instead. The ones producing outputs of the graph stay,
+// so that the output keeps its name.
+static void remove_identity_nodes(onnx::GraphProto *graph) {
+    std::unordered_set<std::string> graph_outputs;
+    for (const auto &output : graph->output()) {
+        graph_outputs.insert(output.name());
+    }
+    std::unordered_map<std::string, std::string> renamed;
+    std::vector<bool> removed(graph->node_size(), false);
+    for (int i = 0; i < graph->node_size(); ++i) {
+        onnx::NodeProto *node = graph->mutable_node(i);
+        for (int j = 0; j < node->input_size(); ++j) {
+            auto it = renamed.find(node->input(j));
+            if (it != renamed.end()) {
+                node->set_input(j, it->second);
+            }
+        }
+        if (node->op_type() == "Identity" && node->input_size() == 1 &&
+            node->output_size() == 1 && !graph_outputs.count(node->output(0))) {
+            renamed[node->output(0)] = node->input(0);
+            removed[i] = true;
+        }
+    }
+    keep_nodes(graph, removed);
+}
+
+// Fold a BatchNormalization that follows a Conv into the weights and
+// bias of the Conv, when they are all constant and the output of the
+// Conv isn't used anywhere else:
+//   W' = W * scale / sqrt(var + epsilon)
+//   B' = (B - mean) * scale / sqrt(var + epsilon) + shift
+static void fold_batchnorm_into_conv(onnx::GraphProto *graph) {
+    std::unordered_map<std::string, int> initializers;
+    for (int i = 0; i < graph->initializer_size(); ++i) {
+        initializers[graph->initializer(i).name()] = i;
+    }
+    std::unordered_map<std::string, int> producers;
+    std::unordered_map<std::string, int> num_uses;
+    for (int i = 0; i < graph->node_size(); ++i) {
+        for (const std::string &output_name : graph->node(i).output()) {
+            producers[output_name] = i;
+        }
+        for (const std::string &input_name : graph->node(i).input()) {
+            num_uses[input_name]++;
+        }
+    }
+    for (const auto &output : graph->output()) {
+        num_uses[output.name()]++;
+    }
+    auto read = [&](const std::string &name, std::vector<float> *vals) {
+        auto it = initializers.find(name);
+        return it != initializers.end() &&
+               read_float_tensor(graph->initializer(it->second), vals);
+    };
+
+    std::vector<bool> removed(graph->node_size(), false);
+    for (int i = 0; i < graph->node_size(); ++i) {
+        const onnx::NodeProto &bn = graph->node(i);
+        if (bn.op_type() != "BatchNormalization" || bn.input_size() != 5 ||
+            bn.output_size() != 1) {
+            continue;
+        }
+        auto producer = producers.find(bn.input(0));
+        if (producer == producers.end() || num_uses[bn.input(0)] != 1) {
+            continue;
+        }
+        onnx::NodeProto *conv = graph->mutable_node(producer->second);
+        if (conv->op_type() != "Conv" || conv->output_size() != 1 ||
+            conv->input_size() < 2) {
+            continue;
+        }
+
+        bool spatial = true;
+        float epsilon = 1e-5f;
+        for (const auto &attr : bn.attribute()) {
+            if (attr.name() == "spatial") {
+                spatial = static_cast<bool>(attr.i());
+            } else if (attr.name() == "epsilon") {
+                epsilon = attr.f();
+            }
+        }
+        if (!spatial) {
+            continue;
+        }
+
+        std::vector<float> weights, bias, scale, shift, mean, variance;
+        if (!read(conv->input(1), &weights) || !read(bn.input(1), &scale) ||
+            !read(bn.input(2), &shift) || !read(bn.input(3), &mean) ||
+            !read(bn.input(4), &variance)) {
+            continue;
+        }
+        const onnx::TensorProto &w = graph->initializer(initializers.at(conv->input(1)));
+        std::vector<int64_t> weight_dims(w.dims().begin(), w.dims().end());
+        if (weight_dims.empty() || weight_dims[0] <= 0) {
+            continue;
+        }
+        // The output channels are the outermost dimension of the weights.
+        const int64_t channels = weight_dims[0];
+        if (scale.size() != channels || shift.size() != channels ||
+            mean.size() != channels || variance.size() != channels) {
+            continue;
+        }
+        const bool has_bias = conv->input_size() > 2 && !conv->input(2).empty();
+        if (has_bias) {
+            if (!read(conv->input(2), &bias) || bias.size() != channels) {
+                continue;
+            }
+        } else {
+            bias.assign(channels, 0.0f);
+        }
+
+        const int64_t channel_size = weights.size() / channels;
+        for (int64_t c = 0; c < channels; ++c) {
+            const float s = scale[c] / std::sqrt(variance[c] + epsilon);
+            for (int64_t j = 0; j < channel_size; ++j) {
+                weights[c * channel_size + j] *= s;
+            }
+            bias[c] = (bias[c] - mean[c]) * s + shift[c];
+        }
+
+        const std::string &output_name = bn.output(0);
+        add_float_initializer(graph, output_name + "_folded_weights", weight_dims, weights);
+        add_float_initializer(graph, output_name + "_folded_bias", {channels}, bias);
+        conv->set_input(1, output_name + "_folded_weights");
+        if (conv->input_size() > 2) {
+            conv->set_input(2, output_name + "_folded_bias");
+        } else {
+            conv->add_input(output_name + "_folded_bias");
+        }
+        conv->set_output(0, output_name);
+        removed[i] = true;
+    }
+    keep_nodes(graph, removed);
+}
+
+void optimize_graph(onnx::GraphProto *graph) {
+    remove_identity_nodes(graph);
+    fold_batchnorm_into_conv(graph);
+}
+
 Model convert_model(
     const onnx::ModelProto &model,
     const std::unordered_map<std::string, int> &expected_dim_sizes,
@@ -4643,15 +4905,20 @@ Model convert_model(
     std::unordered_map<std::string, Tensor> &reps = result.tensors;
     std::unordered_map<std::string, Halide::Internal::Dimension> symbolic_dims;
 
+    onnx::GraphProto graph = model.graph();
+    optimize_graph(&graph);
+
     // Encode the constants inputs.
-    for (const auto &constant : model.graph().initializer()) {
+    std::unordered_set<std::string> constants;
+    for (const auto &constant : graph.initializer()) {
         Tensor t = build_from_constant(constant, sanitize_name(constant.name()));
         reps[constant.name()] = t;
+        constants.insert(constant.name());
     }
 
     // Encode the variable inputs as Halide ImageParam. Note that constant inputs
     // can be listed here as well, so we need to filter them out.
-    for (const auto &input : model.graph().input()) {
+    for (const auto &input : graph.input()) {
         if (reps.find(input.name()) != reps.end()) {
             continue;
         }
@@ -4671,14 +4938,14 @@ Model convert_model(
                                     p};
     }
 
-    convert_subgraph(model.graph(), reps, result.requirements);
+    convert_subgraph(graph, reps, result.requirements, &constants);
 
     // Check if output tensors are also used as inputs to other nodes.
     std::unordered_map<std::string, bool> output_types;
-    for (const auto &output : model.graph().output()) {
+    for (const auto &output : graph.output()) {
         output_types.emplace(output.name(), false);
     }
-    for (const auto &node : model.graph().node()) {
+    for (const auto &node : graph.node()) {
         for (const auto &input_name : node.input()) {
             if (output_types.find(input_name) != output_types.end()) {
                 output_types[input_name] = true;
@@ -4687,7 +4954,7 @@ Model convert_model(
     }
 
     // Last but not least, extract the model outputs.
-    for (const auto &output : model.graph().output()) {
+    for (const auto &output : graph.output()) {
         if (reps.find(output.name()) == reps.end()) {
             throw std::invalid_argument(
                 "Output " + output.name() +
@@ -38,6 +38,13 @@ enum IOLayout {
     Native = 0,
     NumPy = 1,
 };
+// Rewrite the graph into an equivalent one that is cheaper to run:
+// Identity nodes are removed, and BatchNormalization nodes are folded
+// into the Conv nodes feeding them when their parameters are constant.
+// convert_model calls this before converting the nodes, and evaluates
+// the nodes whose inputs are all constant as it goes.
+void optimize_graph(onnx::GraphProto *graph);
+
 Model convert_model(const onnx::ModelProto &model, const std::unordered_map<std::string, int> &expected_dim_sizes, IOLayout layout);
 
 Halide::Type get_halide_type(const Tensor &tensor);
@@ -498,6 +498,122 @@ static void test_model() {
     EXPECT_EQ(7, output_shape(1));
 }
 
+static void add_initializer(
+    onnx::GraphProto *graph,
+    const std::string &name,
+    const std::vector<int64_t> &dims,
+    const std::vector<float> &vals) {
+    onnx::TensorProto *t = graph->add_initializer();
+    t->set_name(name);
+    t->set_data_type(onnx::TensorProto_DataType_FLOAT);
+    for (int64_t dim : dims) {
+        t->add_dims(dim);
+    }
+    for (float v : vals) {
+        t->add_float_data(v);
+    }
+}
+
+static void test_graph_optimization() {
+    onnx::ModelProto model;
+    onnx::GraphProto *graph = model.mutable_graph();
+    onnx::ValueInfoProto *input_def = graph->add_input();
+    input_def->set_name("model_input");
+    input_def->mutable_type()->mutable_tensor_type()->set_elem_type(
+        onnx::TensorProto_DataType_FLOAT);
+    for (int dim : {1, 2, 4, 4}) {
+        input_def->mutable_type()
+            ->mutable_tensor_type()
+            ->mutable_shape()
+            ->add_dim()
+            ->set_dim_value(dim);
+    }
+    graph->add_output()->set_name("model_output");
+
+    const std::vector<float> weights = {0.5f, -1.0f, 2.0f, 0.25f, -0.75f, 1.5f};
+    const std::vector<float> scale = {1.0f, 2.0f, -0.5f};
+    const std::vector<float> shift = {0.1f, -0.2f, 0.3f};
+    const std::vector<float> mean = {0.5f, -0.5f, 1.0f};
+    const std::vector<float> variance = {1.0f, 4.0f, 0.25f};
+    add_initializer(graph, "w", {3, 2, 1, 1}, weights);
+    add_initializer(graph, "half_bias", {3}, {0.5f, 1.0f, -1.0f});
+    add_initializer(graph, "scale", {3}, scale);
+    add_initializer(graph, "shift", {3}, shift);
+    add_initializer(graph, "mean", {3}, mean);
+    add_initializer(graph, "variance", {3}, variance);
+
+    // The bias is computed from constants, so it's evaluated during the
+    // conversion.
+    onnx::NodeProto *bias_node = graph->add_node();
+    bias_node->set_op_type("Add");
+    bias_node->add_input("half_bias");
+    bias_node->add_input("half_bias");
+    bias_node->add_output("bias");
+
+    onnx::NodeProto *conv_node = graph->add_node();
+    conv_node->set_op_type("Conv");
+    conv_node->add_input("model_input");
+    conv_node->add_input("w");
+    conv_node->add_input("bias");
+    conv_node->add_output("conv");
+
+    onnx::NodeProto *identity_node = graph->add_node();
+    identity_node->set_op_type("Identity");
+    identity_node->add_input("conv");
+    identity_node->add_output("conv_copy");
+
+    onnx::NodeProto *bn_node = graph->add_node();
+    bn_node->set_op_type("BatchNormalization");
+    for (const char *input : {"conv_copy", "scale", "shift", "mean", "variance"}) {
+        bn_node->add_input(input);
+    }
+    bn_node->add_output("model_output");
+
+    Halide::Buffer<float, 4> input_values(1, 2, 4, 4);
+    std::uniform_real_distribution<float> dis(-1.0, 1.0);
+    std::mt19937 rnd;
+    input_values.for_each_value([&](float &f) { f = dis(rnd); });
+
+    auto check = [&](const std::vector<float> &bias) {
+        std::unordered_map<std::string, int> dummy;
+        Model converted = convert_model(model, dummy, IOLayout::Native);
+        converted.inputs.at("model_input").set(input_values);
+        Tensor node = converted.outputs.at("model_output");
+        Halide::Buffer<float, 4> output_values = node.rep.realize({1, 3, 4, 4});
+
+        for (int m = 0; m < 3; ++m) {
+            for (int h = 0; h < 4; ++h) {
+                for (int w = 0; w < 4; ++w) {
+                    float conv = bias[m];
+                    for (int c = 0; c < 2; ++c) {
+                        conv += weights[m * 2 + c] * input_values(0, c, h, w);
+                    }
+                    float expected =
+                        (conv - mean[m]) / std::sqrt(variance[m] + 1e-5f) * scale[m] + shift[m];
+                    EXPECT_NEAR(output_values(0, m, h, w), expected, 1e-5f);
+                }
+            }
+        }
+    };
+
+    // The bias isn't an initializer, so the BatchNormalization can't be
+    // folded into the Conv, but the Identity goes away.
+    onnx::GraphProto optimized = *graph;
+    optimize_graph(&optimized);
+    EXPECT_EQ(3, optimized.node_size());
+    check({1.0f, 2.0f, -2.0f});
+
+    // Once it is, the BatchNormalization is folded too.
+    graph->mutable_node()->DeleteSubrange(0, 1);
+    graph->mutable_initializer(1)->set_name("bias");
+    optimized = *graph;
+    optimize_graph(&optimized);
+    EXPECT_EQ(1, optimized.node_size());
+    EXPECT_EQ("Conv", optimized.node(0).op_type());
+    EXPECT_EQ("model_output", optimized.node(0).output(0));
+    check({0.5f, 1.0f, -1.0f});
+}
+
 int main() {
     test_abs();
     test_activation_function();
@@ -511,6 +627,7 @@ int main() {
     test_concat();
     test_constant_fill();
     test_model();
+    test_graph_optimization();
     printf("Success!\n");
     return 0;
 }
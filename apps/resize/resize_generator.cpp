@@ -79,7 +79,27 @@ public:
         kernel_x{"kernel_x"},
         kernel_y{"kernel_y"},
         kernel_sum_x{"kernel_sum_x"},
-        kernel_sum_y{"kernel_sum_y"};
+        kernel_sum_y{"kernel_sum_y"},
+        as_int16{"as_int16"},
+        kernel_x_fixed{"kernel_x_fixed"},
+        kernel_y_fixed{"kernel_y_fixed"};
+
+    // uint8 images are resized in fixed point. The weights have
+    // kernel_bits fractional bits, and the result of the first pass has
+    // intermediate_bits, which leaves room in an int16 for the overshoot
+    // of the cubic and lanczos kernels.
+    static constexpr int kernel_bits = 14;
+    static constexpr int intermediate_bits = 6;
+
+    // The scale factors we specialize for. Their inverses are exact, so
+    // within these specializations the number of taps is a constant.
+    float integer_scale_factor() const {
+        return upsample ? 2.0f : 0.5f;
+    }
+
+    bool fixed_point() const {
+        return input.type() == UInt(8);
+    }
 
     void generate() {
 
@@ -92,7 +112,9 @@ public:
         // Invert the scale factor in a single place and do it
         // strictly, to avoid getting different ratios showing up in
         // different places.
-        Expr inverse_scale_factor = strict_float(1.0f / scale_factor);
+        Expr inverse_scale_factor = select(scale_factor == integer_scale_factor(),
+                                           1.0f / integer_scale_factor(),
+                                           strict_float(1.0f / scale_factor));
 
         Expr kernel_scaling = upsample ? Expr(1.0f) : scale_factor;
         Expr inverse_kernel_scaling = upsample ? Expr(1.0f) : inverse_scale_factor;
@@ -130,7 +152,29 @@ public:
         // poorly compared to the resize in y, so do it first if we're
         // upsampling, and do it second if we're downsampling.
         Func resized;
-        if (upsample) {
+        if (fixed_point()) {
+            as_int16(x, y, c) = cast<int16_t>(input(x, y, c));
+            kernel_x_fixed(x, k) = cast<int16_t>(round(kernel_x(x, k) * (1 << kernel_bits)));
+            kernel_y_fixed(y, k) = cast<int16_t>(round(kernel_y(y, k) * (1 << kernel_bits)));
+
+            // The first pass rounds away all but intermediate_bits of the
+            // fraction, and the second pass rounds away the rest.
+            const int first_shift = kernel_bits - intermediate_bits;
+            const int second_shift = kernel_bits + intermediate_bits;
+            if (upsample) {
+                resized_x(x, y, c) = saturating_cast<int16_t>(rounding_shift_right(
+                    sum(widening_mul(kernel_x_fixed(x, r), as_int16(r + beginx, y, c)), "resized_x_sum"), first_shift));
+                resized_y(x, y, c) = rounding_shift_right(
+                    sum(widening_mul(kernel_y_fixed(y, r), resized_x(x, r + beginy, c)), "resized_y_sum"), second_shift);
+                resized = resized_y;
+            } else {
+                resized_y(x, y, c) = saturating_cast<int16_t>(rounding_shift_right(
+                    sum(widening_mul(kernel_y_fixed(y, r), as_int16(x, r + beginy, c)), "resized_y_sum"), first_shift));
+                resized_x(x, y, c) = rounding_shift_right(
+                    sum(widening_mul(kernel_x_fixed(x, r), resized_y(r + beginx, y, c)), "resized_x_sum"), second_shift);
+                resized = resized_x;
+            }
+        } else if (upsample) {
             resized_x(x, y, c) = sum(kernel_x(x, r) * as_float(r + beginx, y, c), "resized_x");
             resized_y(x, y, c) = sum(kernel_y(y, r) * resized_x(x, r + beginy, c), "resized_y");
             resized = resized_y;
@@ -149,6 +193,8 @@ public:
 
     void schedule() {
         const int vec = natural_vector_size<float>();
+        // The vector width of the passes over the image.
+        const int image_vec = fixed_point() ? natural_vector_size<int16_t>() : vec;
 
         Var xi("xi"), yi("yi");
         unnormalized_kernel_x
@@ -170,10 +216,21 @@ public:
             .compute_at(kernel_y, y)
             .vectorize(y);
         kernel_y
-            .compute_at(output, y)
+            .compute_root()
             .reorder(k, y)
             .vectorize(y, vec);
 
+        if (fixed_point()) {
+            kernel_x_fixed
+                .compute_root()
+                .reorder(k, x)
+                .vectorize(x, vec);
+            kernel_y_fixed
+                .compute_root()
+                .reorder(k, y)
+                .vectorize(y, vec);
+        }
+
         if (upsample) {
             output
                 .tile(x, y, xi, yi, 16, 64)
@@ -193,7 +250,7 @@ public:
                 .vectorize(xi);
             resized_y
                 .compute_at(output, y)
-                .vectorize(x, vec);
+                .vectorize(x, image_vec);
             resized_x
                 .compute_at(output, xi)
                 .unroll(c);
@@ -225,13 +282,23 @@ public:
                             input.dim(2).min() == 0 &&
                             input.dim(2).extent() == 4);
 
-        output.specialize(planar);
+        // The common integer scale factor gets its own copy of each
+        // layout specialization, in which the loops over the taps have
+        // constant extents.
+        Stage integer_scale = output.specialize(scale_factor == integer_scale_factor());
+        specialize_layouts(integer_scale, planar, packed_rgb, packed_rgba, xi, yi);
+        specialize_layouts(output, planar, packed_rgb, packed_rgba, xi, yi);
+    }
+
+    void specialize_layouts(Stage s, const Expr &planar, const Expr &packed_rgb,
+                            const Expr &packed_rgba, const Var &xi, const Var &yi) {
+        s.specialize(planar);
 
-        output.specialize(packed_rgb)
+        s.specialize(packed_rgb)
             .reorder(c, xi, yi, x, y)
             .unroll(c);
 
-        output.specialize(packed_rgba)
+        s.specialize(packed_rgba)
             .reorder(c, xi, yi, x, y)
             .unroll(c);
     }
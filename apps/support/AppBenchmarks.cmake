@@ -0,0 +1,89 @@
+##
+# Benchmarks of the apps, run through RunGen, with their results compared
+# against stored baselines.
+#
+# Each app calls add_app_benchmark() for the libraries worth tracking. Then
+#
+#   benchmark_apps                  runs all the benchmarks, one at a time,
+#                                   writing <build>/benchmarks/<lib>.json
+#   check_app_benchmarks            also compares the results against the
+#                                   baselines, and fails on a regression
+#   update_app_benchmark_baselines  also replaces the baselines with the
+#                                   results
+#
+# Timings are only comparable on the same machine, so the baselines are not
+# checked in; point APPS_BENCHMARK_BASELINES at a directory kept by the
+# machine that runs the benchmarks.
+##
+
+include_guard(GLOBAL)
+
+set(APPS_BENCHMARK_BASELINES "${CMAKE_BINARY_DIR}/benchmark_baselines"
+    CACHE PATH "Directory of the baseline results that check_app_benchmarks compares against")
+set(APPS_BENCHMARK_TOLERANCE 0.05
+    CACHE STRING "Relative slowdown of the median time, beyond its noise, that check_app_benchmarks treats as a regression")
+set(APPS_BENCHMARK_MIN_TIME 1
+    CACHE STRING "Minimum time (in seconds) to spend benchmarking each app")
+
+find_package(Python3 COMPONENTS Interpreter)
+
+add_custom_target(benchmark_apps)
+
+if (Python3_Interpreter_FOUND)
+    set(_app_benchmarks_compare
+        "${Python3_EXECUTABLE}" "${CMAKE_CURRENT_LIST_DIR}/compare_benchmarks.py"
+        --tolerance "${APPS_BENCHMARK_TOLERANCE}"
+        "${CMAKE_BINARY_DIR}/benchmarks" "${APPS_BENCHMARK_BASELINES}")
+
+    add_custom_target(check_app_benchmarks
+                      COMMAND ${_app_benchmarks_compare}
+                      COMMENT "Comparing app benchmarks against ${APPS_BENCHMARK_BASELINES}"
+                      VERBATIM)
+    add_dependencies(check_app_benchmarks benchmark_apps)
+
+    add_custom_target(update_app_benchmark_baselines
+                      COMMAND ${_app_benchmarks_compare} --update
+                      COMMENT "Updating the app benchmark baselines in ${APPS_BENCHMARK_BASELINES}"
+                      VERBATIM)
+    add_dependencies(update_app_benchmark_baselines benchmark_apps)
+else ()
+    message(STATUS "Python 3 not found: check_app_benchmarks will be unavailable")
+endif ()
+
+# add_app_benchmark(<lib> REGISTRATION <file> [ARGS <args>...])
+#
+# Benchmark the Halide library <lib>, which must have been made by
+# add_halide_library with REGISTRATION <file>. ARGS are passed to RunGen to
+# choose the inputs and outputs, and default to --estimate_all.
+function(add_app_benchmark lib)
+    cmake_parse_arguments(PARSE_ARGV 1 ARG "" "REGISTRATION" "ARGS")
+    if (NOT ARG_REGISTRATION)
+        message(FATAL_ERROR "add_app_benchmark(${lib}) requires a REGISTRATION file")
+    endif ()
+    if (NOT ARG_ARGS)
+        set(ARG_ARGS --estimate_all)
+    endif ()
+
+    add_executable(${lib}.rungen EXCLUDE_FROM_ALL ${ARG_REGISTRATION})
+    target_link_libraries(${lib}.rungen PRIVATE Halide::RunGenMain ${lib})
+
+    set(dir "${CMAKE_BINARY_DIR}/benchmarks")
+    add_custom_target(${lib}_benchmark
+                      COMMAND ${CMAKE_COMMAND} -E make_directory "${dir}"
+                      COMMAND ${lib}.rungen
+                              --benchmark_statistics
+                              "--benchmark_min_time=${APPS_BENCHMARK_MIN_TIME}"
+                              "--benchmark_json=${dir}/${lib}.json"
+                              ${ARG_ARGS}
+                      COMMENT "Benchmarking ${lib}"
+                      VERBATIM)
+    add_dependencies(benchmark_apps ${lib}_benchmark)
+
+    # Benchmarks running side by side would slow each other down, so make
+    # each one wait for the last, even in a parallel build.
+    get_property(previous GLOBAL PROPERTY _app_benchmarks_last)
+    if (previous)
+        add_dependencies(${lib}_benchmark ${previous})
+    endif ()
+    set_property(GLOBAL PROPERTY _app_benchmarks_last ${lib}_benchmark)
+endfunction()
@@ -0,0 +1,96 @@
+#!/usr/bin/env python3
+"""
+Compare the JSON results of RunGen --benchmark_json against baselines.
+
+Usage: compare_benchmarks.py [--tolerance T] [--update] RESULTS_DIR BASELINES_DIR
+
+Each RESULTS_DIR/<name>.json is compared to BASELINES_DIR/<name>.json, run by
+run (i.e. by thread count). A run has regressed if its median is more than
+the tolerance slower than the baseline's, and the change isn't explained by
+noise: the lower end of its median's confidence interval must also be above
+the upper end of the baseline's, scaled by the tolerance. Exits with a
+nonzero status if anything regressed.
+
+With --update, the results are copied over the baselines instead.
+"""
+
+import argparse
+import json
+import os
+import shutil
+import sys
+
+
+def load(path):
+    with open(path) as f:
+        result = json.load(f)
+    return {run["num_threads"]: run for run in result["runs"]}, result
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--tolerance", type=float, default=0.05)
+    parser.add_argument("--update", action="store_true")
+    parser.add_argument("results")
+    parser.add_argument("baselines")
+    args = parser.parse_args()
+
+    names = sorted(
+        f[: -len(".json")] for f in os.listdir(args.results) if f.endswith(".json")
+    )
+    if not names:
+        print(f"No benchmark results in {args.results}")
+        return 1
+
+    if args.update:
+        os.makedirs(args.baselines, exist_ok=True)
+        for name in names:
+            shutil.copy(
+                os.path.join(args.results, name + ".json"),
+                os.path.join(args.baselines, name + ".json"),
+            )
+        print(f"Updated {len(names)} baselines in {args.baselines}")
+        return 0
+
+    regressions = 0
+    scale = 1 + args.tolerance
+    for name in names:
+        runs, result = load(os.path.join(args.results, name + ".json"))
+        baseline_path = os.path.join(args.baselines, name + ".json")
+        if not os.path.exists(baseline_path):
+            print(f"{name}: no baseline")
+            continue
+        baseline_runs, baseline = load(baseline_path)
+        if baseline["target"] != result["target"] or baseline["cache"] != result["cache"]:
+            print(f"{name}: baseline is for a different target or cache state")
+            continue
+        for threads, run in sorted(runs.items()):
+            base = baseline_runs.get(threads)
+            if base is None:
+                print(f"{name} ({threads} threads): no baseline")
+                continue
+            ratio = run["median_sec"] / base["median_sec"]
+            regressed = (
+                run["median_sec"] > base["median_sec"] * scale
+                and run["median_ci_sec"][0] > base["median_ci_sec"][1] * scale
+            )
+            improved = (
+                run["median_sec"] * scale < base["median_sec"]
+                and run["median_ci_sec"][1] * scale < base["median_ci_sec"][0]
+            )
+            status = "REGRESSED" if regressed else "improved" if improved else "ok"
+            print(
+                f"{name} ({threads} threads): median {run['median_sec'] * 1000:.4g} ms "
+                f"vs {base['median_sec'] * 1000:.4g} ms ({ratio:.3f}x), "
+                f"p99 {run['p99_sec'] * 1000:.4g} ms vs {base['p99_sec'] * 1000:.4g} ms: {status}"
+            )
+            regressions += regressed
+
+    if regressions:
+        print(f"{regressions} benchmark(s) regressed by more than {args.tolerance:.0%}")
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
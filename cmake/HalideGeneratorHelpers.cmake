@@ -258,6 +258,7 @@ function(_Halide_library_from_generator TARGET)
         -e "$<LOWER_CASE:$<JOIN:$<REMOVE_DUPLICATES:${outputs}>,$<COMMA>>>"
         ${plugins_args}
         -o .
+        -c 1
         "target=$<JOIN:${ARG_TARGETS},$<COMMA>>"
         ${ARG_PARAMS}
         DEPENDS ${ARG_DEPENDS} ${ARG_PLUGINS}
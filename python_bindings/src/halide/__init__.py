@@ -20,6 +20,10 @@ def install_dir():
     return os.path.dirname(__file__)
 
 
+from ._async_helpers import (
+    call_async,
+    set_async_executor,
+)
 from ._generator_helpers import (
     _create_python_generator,
     _generatorcontext_enter,
@@ -0,0 +1,62 @@
+import asyncio
+import concurrent.futures
+import functools
+import threading
+
+from .halide_ import Callable, Func, Pipeline, Target
+
+# Calling a Callable, or realizing a Pipeline or Func, releases the GIL
+# for as long as the compiled code runs, so running calls from a pool of
+# threads lets them (and the event loop) proceed concurrently. The
+# parallel loops within each call share the Halide runtime's thread pool.
+_executor = None
+_executor_lock = threading.Lock()
+
+# Realizing a Pipeline or Func JIT-compiles it first if needed, which
+# isn't safe to do concurrently; this serializes that step of
+# realize_async().
+_compile_lock = threading.Lock()
+
+
+def _get_executor():
+    global _executor
+    with _executor_lock:
+        if _executor is None:
+            _executor = concurrent.futures.ThreadPoolExecutor(thread_name_prefix="halide_async")
+        return _executor
+
+
+def set_async_executor(executor: concurrent.futures.Executor):
+    """Use executor to run the calls made by call_async() and
+    realize_async(), instead of the default ThreadPoolExecutor. It
+    must run them on threads of this process."""
+    global _executor
+    with _executor_lock:
+        _executor = executor
+
+
+async def _run(fn, *args, **kwargs):
+    loop = asyncio.get_running_loop()
+    return await loop.run_in_executor(_get_executor(), functools.partial(fn, *args, **kwargs))
+
+
+async def call_async(callable: Callable, *args, **kwargs):
+    """Call callable with the given arguments without blocking the event
+    loop. Don't modify the buffers passed until the call completes."""
+    return await _run(callable, *args, **kwargs)
+
+
+def _realize_compiled(p, *args, target: Target = Target(), **kwargs):
+    with _compile_lock:
+        p.compile_jit(target)
+    return p.realize(*args, target=target, **kwargs)
+
+
+async def _realize_async(self, *args, **kwargs):
+    """Like realize(), but without blocking the event loop."""
+    return await _run(_realize_compiled, self, *args, **kwargs)
+
+
+Callable.call_async = call_async
+Pipeline.realize_async = _realize_async
+Func.realize_async = _realize_async
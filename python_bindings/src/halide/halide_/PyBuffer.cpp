@@ -2,6 +2,7 @@
 
 #include <utility>
 
+#include "PyDLPack.h"
 #include "PyFunc.h"
 #include "PyType.h"
 
@@ -605,6 +606,15 @@ void define_buffer(py::module &m) {
             },
                  py::arg("device_api"), py::arg("target") = Target())
 
+            // DLPack support, for sharing memory (including CUDA device memory)
+            // with other libraries without copying it.
+            .def("__dlpack__", [](const py::object &self, const py::object &stream) -> py::capsule {  //
+                return buffer_to_dlpack(self, stream);
+            },
+                 py::kw_only(), py::arg("stream") = py::none())
+            .def("__dlpack_device__", &buffer_dlpack_device)
+            .def_static("from_dlpack", &buffer_from_dlpack, py::arg("obj"), py::arg("name") = "", py::arg("reverse_axes") = true)
+
             .def(           //
                 "set_min",  //
                 [](Buffer<> &b, const std::vector<int> &mins) -> void {
@@ -654,6 +664,8 @@ void define_buffer(py::module &m) {
                 }
                 return o.str();  //
             });
+
+    m.def("from_dlpack", &buffer_from_dlpack, py::arg("obj"), py::arg("name") = "", py::arg("reverse_axes") = true);
 }
 
 }  // namespace PythonBindings
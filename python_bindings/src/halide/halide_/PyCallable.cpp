@@ -1,6 +1,7 @@
 #include "PyCallable.h"
 
 #include "PyBuffer.h"
+#include "PyError.h"
 
 #define TYPED_ALLOCA(TYPE, COUNT) ((TYPE *)alloca(sizeof(TYPE) * (COUNT)))
 
@@ -76,8 +77,8 @@ public:
             << "Expected at most " << (argc - 1) << " positional arguments, but saw " << args.size() << ".";
 
         // args
-        JITUserContext empty_jit_user_context;
-        scalar_storage[0].u.u64 = (uintptr_t)&empty_jit_user_context;
+        PyJITUserContext jit_user_context;
+        scalar_storage[0].u.u64 = (uintptr_t)&jit_user_context;
         argv[0] = &scalar_storage[0];
         cci[0] = Callable::make_ucon_qcci();
 
@@ -192,6 +193,12 @@ public:
                 << "Expected exactly " << (argc - 1) << " positional arguments, but saw " << args.size() << ".";
         }
 
+        // Everything the call uses has been converted out of Python objects
+        // (which the caller keeps alive), so let other Python threads run
+        // while it does. The handlers in PyJITUserContext that call back
+        // into Python reacquire the GIL.
+        py::gil_scoped_release release;
+
         int result = c.call_argv_checked(argc, argv, cci);
         _halide_user_assert(result == 0) << "Halide Runtime Error: " << result;
 
@@ -205,7 +212,7 @@ public:
             if (c_arg.kind == Argument::OutputBuffer) {
                 auto *buf = (halide_buffer_t *)argv[slot];
                 if (buf->device_dirty()) {
-                    int result = buf->device_interface->copy_to_host(&empty_jit_user_context, buf);
+                    int result = buf->device_interface->copy_to_host(&jit_user_context, buf);
                     _halide_user_assert(result == 0) << "Halide Runtime Error: " << result;
                 }
             }
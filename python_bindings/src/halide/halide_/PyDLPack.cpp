@@ -0,0 +1,304 @@
+#include "PyDLPack.h"
+
+#include <cstdlib>
+#include <memory>
+
+namespace Halide {
+namespace PythonBindings {
+
+namespace {
+
+// These match the definitions in dlpack.h, which we don't depend on;
+// the layout of these structs is the stable ABI of the protocol.
+enum DLDeviceType : int32_t {
+    kDLCPU = 1,
+    kDLCUDA = 2,
+    kDLCUDAHost = 3,
+    kDLCUDAManaged = 13,
+};
+
+enum DLDataTypeCode : uint8_t {
+    kDLInt = 0,
+    kDLUInt = 1,
+    kDLFloat = 2,
+    kDLBfloat = 4,
+    kDLBool = 6,
+};
+
+struct DLDevice {
+    int32_t device_type;
+    int32_t device_id;
+};
+
+struct DLDataType {
+    uint8_t code;
+    uint8_t bits;
+    uint16_t lanes;
+};
+
+struct DLTensor {
+    void *data;
+    DLDevice device;
+    int32_t ndim;
+    DLDataType dtype;
+    int64_t *shape;
+    int64_t *strides;
+    uint64_t byte_offset;
+};
+
+struct DLManagedTensor {
+    DLTensor dl_tensor;
+    void *manager_ctx;
+    void (*deleter)(DLManagedTensor *self);
+};
+
+constexpr const char *kTensorCapsuleName = "dltensor";
+constexpr const char *kUsedTensorCapsuleName = "used_dltensor";
+
+// The CUDA device the Halide runtime uses. Like the runtime, this
+// assumes device 0 unless HL_GPU_DEVICE says otherwise; on a machine
+// with several GPUs, set HL_GPU_DEVICE to be sure they agree.
+int halide_cuda_device_id() {
+    const char *s = getenv("HL_GPU_DEVICE");
+    return s ? atoi(s) : 0;
+}
+
+bool is_cuda_allocation(const Buffer<> &b) {
+    const halide_device_interface_t *interface = b.raw_buffer()->device_interface;
+    if (!interface) {
+        return false;
+    }
+    const Target t = get_jit_target_from_environment().with_feature(Target::CUDA);
+    return interface == get_device_interface_for_device_api(DeviceAPI::CUDA, t, nullptr);
+}
+
+// Whether a Buffer's current data is in a CUDA device allocation, and so
+// should be shared as one.
+bool exports_cuda_memory(const Buffer<> &b) {
+    return is_cuda_allocation(b) && (b.device_dirty() || b.data() == nullptr);
+}
+
+DLDataType type_to_dldatatype(const Type &t) {
+    if (t.lanes() != 1) {
+        throw py::value_error("DLPack export of vector types is not supported.");
+    }
+    if (t.is_bool()) {
+        return {kDLBool, 8, 1};
+    } else if (t.is_int()) {
+        return {kDLInt, (uint8_t)t.bits(), 1};
+    } else if (t.is_uint()) {
+        return {kDLUInt, (uint8_t)t.bits(), 1};
+    } else if (t.is_float()) {
+        return {kDLFloat, (uint8_t)t.bits(), 1};
+    } else if (t.is_bfloat()) {
+        return {kDLBfloat, (uint8_t)t.bits(), 1};
+    }
+    throw py::value_error("DLPack export of handle types is not supported.");
+}
+
+Type dldatatype_to_type(const DLDataType &t) {
+    if (t.lanes != 1) {
+        throw py::value_error("DLPack import of vector types is not supported.");
+    }
+    switch (t.code) {
+    case kDLBool:
+        if (t.bits == 8) {
+            return Bool();
+        }
+        break;
+    case kDLInt:
+        if (t.bits == 8 || t.bits == 16 || t.bits == 32 || t.bits == 64) {
+            return Int(t.bits);
+        }
+        break;
+    case kDLUInt:
+        if (t.bits == 8 || t.bits == 16 || t.bits == 32 || t.bits == 64) {
+            return UInt(t.bits);
+        }
+        break;
+    case kDLFloat:
+        if (t.bits == 16 || t.bits == 32 || t.bits == 64) {
+            return Float(t.bits);
+        }
+        break;
+    case kDLBfloat:
+        if (t.bits == 16) {
+            return BFloat(16);
+        }
+        break;
+    default:
+        break;
+    }
+    throw py::value_error("Unsupported DLPack data type: code " + std::to_string((int)t.code) +
+                          ", " + std::to_string((int)t.bits) + " bits.");
+}
+
+// What a DLManagedTensor we export keeps alive: a reference to the
+// Python Buffer it views (which may in turn keep a numpy array alive),
+// and the storage for its shape and strides.
+struct ExportedTensor {
+    DLManagedTensor tensor;
+    py::object owner;
+    std::vector<int64_t> shape, strides;
+};
+
+void delete_exported_tensor(DLManagedTensor *self) {
+    // Consumers may call this from any thread, without holding the GIL.
+    py::gil_scoped_acquire gil;
+    delete (ExportedTensor *)self->manager_ctx;
+}
+
+void tensor_capsule_destructor(PyObject *capsule) {
+    // A consumer renames the capsule when it takes ownership of the
+    // tensor, so if it still has its original name, nothing did.
+    if (PyCapsule_IsValid(capsule, kTensorCapsuleName)) {
+        DLManagedTensor *t = (DLManagedTensor *)PyCapsule_GetPointer(capsule, kTensorCapsuleName);
+        if (t && t->deleter) {
+            t->deleter(t);
+        }
+    }
+}
+
+void release_imported_tensor(void *context) {
+    DLManagedTensor *t = (DLManagedTensor *)context;
+    if (t->deleter && Py_IsInitialized()) {
+        py::gil_scoped_acquire gil;
+        t->deleter(t);
+    }
+}
+
+}  // namespace
+
+py::capsule buffer_to_dlpack(const py::object &self, const py::object &stream) {
+    Buffer<> &b = self.cast<Buffer<> &>();
+    if (!b.defined()) {
+        throw py::value_error("Cannot export an undefined Buffer<> via DLPack.");
+    }
+
+    auto exported = std::make_unique<ExportedTensor>();
+    DLTensor &t = exported->tensor.dl_tensor;
+    t.dtype = type_to_dldatatype(b.type());
+    t.byte_offset = 0;
+
+    if (exports_cuda_memory(b)) {
+        // We don't know which of the consumer's streams will use the
+        // memory, so wait for all of the work that writes it. (A stream
+        // of -1 means the consumer doesn't need that.)
+        if (stream.is_none() || stream.cast<int64_t>() != -1) {
+            if (b.device_sync(nullptr) != halide_error_code_success) {
+                throw std::runtime_error("DLPack export: device_sync failed.");
+            }
+        }
+        t.data = (void *)(uintptr_t)b.raw_buffer()->device;
+        t.device = {kDLCUDA, halide_cuda_device_id()};
+    } else {
+        if (b.device_dirty() && b.copy_to_host(nullptr) != halide_error_code_success) {
+            throw std::runtime_error("DLPack export: copy_to_host failed.");
+        }
+        if (b.data() == nullptr) {
+            throw py::value_error("Cannot export a Buffer<> with null host ptr via DLPack.");
+        }
+        t.data = b.data();
+        t.device = {kDLCPU, 0};
+    }
+
+    // As with the buffer protocol, reverse the axes, so that the
+    // innermost Halide dimension is the last one of the tensor.
+    const int d = b.dimensions();
+    exported->shape.resize(d);
+    exported->strides.resize(d);
+    for (int i = 0; i < d; i++) {
+        exported->shape[d - i - 1] = b.raw_buffer()->dim[i].extent;
+        exported->strides[d - i - 1] = b.raw_buffer()->dim[i].stride;
+    }
+    t.ndim = d;
+    t.shape = exported->shape.data();
+    t.strides = exported->strides.data();
+
+    exported->owner = self;
+    exported->tensor.manager_ctx = exported.get();
+    exported->tensor.deleter = delete_exported_tensor;
+
+    DLManagedTensor *tensor = &exported.release()->tensor;
+    PyObject *capsule = PyCapsule_New(tensor, kTensorCapsuleName, tensor_capsule_destructor);
+    if (!capsule) {
+        tensor->deleter(tensor);
+        throw py::error_already_set();
+    }
+    return py::reinterpret_steal<py::capsule>(capsule);
+}
+
+py::tuple buffer_dlpack_device(const Buffer<> &b) {
+    if (b.defined() && exports_cuda_memory(b)) {
+        return py::make_tuple((int)kDLCUDA, halide_cuda_device_id());
+    }
+    return py::make_tuple((int)kDLCPU, 0);
+}
+
+Buffer<> buffer_from_dlpack(const py::object &obj, const std::string &name, bool reverse_axes) {
+    py::object capsule = obj;
+    if (py::hasattr(obj, "__dlpack__")) {
+        capsule = obj.attr("__dlpack__")();
+    }
+    if (!PyCapsule_IsValid(capsule.ptr(), kTensorCapsuleName)) {
+        throw py::value_error("Expected an object with a __dlpack__ method, or an unconsumed DLPack capsule.");
+    }
+    DLManagedTensor *managed = (DLManagedTensor *)PyCapsule_GetPointer(capsule.ptr(), kTensorCapsuleName);
+    const DLTensor &t = managed->dl_tensor;
+
+    const Type type = dldatatype_to_type(t.dtype);
+    if (t.ndim < 0) {
+        throw py::value_error("Out of range dimensions in DLPack conversion.");
+    }
+    std::vector<halide_dimension_t> dims(t.ndim);
+    // Null strides mean the tensor is compact and row-major.
+    int64_t compact_stride = 1;
+    for (int i = t.ndim - 1; i >= 0; i--) {
+        const int64_t extent = t.shape[i];
+        const int64_t stride = t.strides ? t.strides[i] : compact_stride;
+        compact_stride *= extent;
+        if (extent < 0 || extent > INT_MAX || stride < INT_MIN || stride > INT_MAX) {
+            throw py::value_error("Out of range dimensions in DLPack conversion.");
+        }
+        const int dst_axis = reverse_axes ? (t.ndim - i - 1) : i;
+        dims[dst_axis] = {0, (int32_t)extent, (int32_t)stride};
+    }
+
+    char *data = (char *)t.data + t.byte_offset;
+    Buffer<> b;
+    switch (t.device.device_type) {
+    case kDLCPU:
+    case kDLCUDAHost:
+    case kDLCUDAManaged:
+        b = Buffer<>(type, data, t.ndim, dims.data(), name);
+        // As with Buffers made from a Python buffer, the data may have
+        // been written by its producer.
+        b.set_host_dirty();
+        break;
+    case kDLCUDA: {
+        if (t.device.device_id != halide_cuda_device_id()) {
+            throw py::value_error("DLPack tensor is on CUDA device " + std::to_string(t.device.device_id) +
+                                  ", but Halide uses device " + std::to_string(halide_cuda_device_id()) +
+                                  "; set HL_GPU_DEVICE to use it.");
+        }
+        b = Buffer<>(type, nullptr, t.ndim, dims.data(), name);
+        if (b.device_wrap_native(DeviceAPI::CUDA, (uint64_t)(uintptr_t)data) != halide_error_code_success) {
+            throw std::runtime_error("DLPack import: device_wrap_native failed.");
+        }
+        b.set_device_dirty();
+        break;
+    }
+    default:
+        throw py::value_error("Unsupported DLPack device type: " + std::to_string(t.device.device_type));
+    }
+
+    // The Buffer now owns the tensor: mark the capsule as consumed, so
+    // that it doesn't free the tensor too, and free it when the last
+    // reference to the Buffer's memory goes away.
+    b.take_ownership_of_host(release_imported_tensor, managed);
+    PyCapsule_SetName(capsule.ptr(), kUsedTensorCapsuleName);
+    return b;
+}
+
+}  // namespace PythonBindings
+}  // namespace Halide
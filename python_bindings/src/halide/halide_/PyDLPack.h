@@ -0,0 +1,30 @@
+#ifndef HALIDE_PYTHON_BINDINGS_PYDLPACK_H
+#define HALIDE_PYTHON_BINDINGS_PYDLPACK_H
+
+#include "PyHalide.h"
+
+namespace Halide {
+namespace PythonBindings {
+
+// Support for the DLPack protocol (https://dmlc.github.io/dlpack/latest/),
+// which lets Buffers share memory, including CUDA device memory, with
+// other Python libraries without copying it.
+
+// Implements Buffer.__dlpack__(): returns a capsule holding a
+// DLManagedTensor that views the memory of the Buffer self, and keeps
+// self alive. If its current data is in a CUDA device allocation, the
+// tensor is the device allocation; otherwise it's the host memory.
+py::capsule buffer_to_dlpack(const py::object &self, const py::object &stream);
+
+// Implements Buffer.__dlpack_device__().
+py::tuple buffer_dlpack_device(const Buffer<> &b);
+
+// Make a Buffer that views the memory of obj, which is either an object
+// with a __dlpack__ method or a capsule returned by one. The Buffer
+// keeps the memory alive for as long as it exists.
+Buffer<> buffer_from_dlpack(const py::object &obj, const std::string &name, bool reverse_axes);
+
+}  // namespace PythonBindings
+}  // namespace Halide
+
+#endif  // HALIDE_PYTHON_BINDINGS_PYDLPACK_H
@@ -40,6 +40,11 @@ void define_enums(py::module &m) {
         .value("NoAlign", LoopAlignStrategy::NoAlign)
         .value("Auto", LoopAlignStrategy::Auto);
 
+    py::enum_<TraceSampling>(m, "TraceSampling")
+        .value("EveryNth", TraceSampling::EveryNth)
+        .value("FirstN", TraceSampling::FirstN)
+        .value("Random", TraceSampling::Random);
+
     py::enum_<MemoryType>(m, "MemoryType")
         .value("Auto", MemoryType::Auto)
         .value("Heap", MemoryType::Heap)
@@ -48,7 +53,10 @@ void define_enums(py::module &m) {
         .value("GPUShared", MemoryType::GPUShared)
         .value("GPUTexture", MemoryType::GPUTexture)
         .value("LockedCache", MemoryType::LockedCache)
-        .value("VTCM", MemoryType::VTCM);
+        .value("VTCM", MemoryType::VTCM)
+        .value("Streaming", MemoryType::Streaming)
+        .value("WMMAAccumulator", MemoryType::WMMAAccumulator)
+        .value("SimdgroupMatrix", MemoryType::SimdgroupMatrix);
 
     py::enum_<NameMangling>(m, "NameMangling")
         .value("Default", NameMangling::Default)
@@ -204,6 +212,23 @@ void define_enums(py::module &m) {
         .value("Semihosting", Target::Feature::Semihosting)
         .value("AVX10_1", Target::Feature::AVX10_1)
         .value("X86APX", Target::Feature::X86APX)
+        .value("ARMSME", Target::Feature::ARMSME)
+        .value("Float16Compute", Target::Feature::Float16Compute)
+        .value("AutoPrefetch", Target::Feature::AutoPrefetch)
+        .value("ProfileLight", Target::Feature::ProfileLight)
+        .value("TrackAllocations", Target::Feature::TrackAllocations)
+        .value("ArenaAllocations", Target::Feature::ArenaAllocations)
+        .value("AutoRFactor", Target::Feature::AutoRFactor)
+        .value("SpecializationDispatch", Target::Feature::SpecializationDispatch)
+        .value("WasmRelaxedSimd", Target::Feature::WasmRelaxedSimd)
+        .value("HVXAutoVTCM", Target::Feature::HVXAutoVTCM)
+        .value("StripUnusedRuntime", Target::Feature::StripUnusedRuntime)
+        .value("LLVMFastCompile", Target::Feature::LLVMFastCompile)
+        .value("AutoStorageOrder", Target::Feature::AutoStorageOrder)
+        .value("JITInterp", Target::Feature::JITInterp)
+        .value("TrustedEntry", Target::Feature::TrustedEntry)
+        .value("LoopInterchange", Target::Feature::LoopInterchange)
+        .value("DeviceResident", Target::Feature::DeviceResident)
         .value("FeatureEnd", Target::Feature::FeatureEnd);
 
     py::enum_<halide_type_code_t>(m, "TypeCode")
@@ -207,6 +207,7 @@ void define_func(py::module &m) {
             .def("compute_at", (Func & (Func::*)(const Func &, const Var &)) & Func::compute_at, py::arg("f"), py::arg("var"))
             .def("compute_at", (Func & (Func::*)(const Func &, const RVar &)) & Func::compute_at, py::arg("f"), py::arg("rvar"))
             .def("compute_at", (Func & (Func::*)(LoopLevel)) & Func::compute_at, py::arg("loop_level"))
+            .def("compute_at_gpu_blocks", &Func::compute_at_gpu_blocks, py::arg("f"))
 
             .def("store_at", (Func & (Func::*)(const Func &, const Var &)) & Func::store_at, py::arg("f"), py::arg("var"))
             .def("store_at", (Func & (Func::*)(const Func &, const RVar &)) & Func::store_at, py::arg("f"), py::arg("rvar"))
@@ -214,6 +215,9 @@ void define_func(py::module &m) {
 
             .def("async_", &Func::async)
             .def("ring_buffer", &Func::ring_buffer)
+            .def("pipeline_across", (Func & (Func::*)(const Func &, const Var &, int)) & Func::pipeline_across, py::arg("f"), py::arg("var"), py::arg("depth") = 2)
+            .def("pipeline_across", (Func & (Func::*)(LoopLevel, int)) & Func::pipeline_across, py::arg("loop_level"), py::arg("depth") = 2)
+            .def("stream_via_dma", &Func::stream_via_dma, py::arg("tiles"), py::arg("rows"), py::arg("dim"), py::arg("tile_extent"), py::arg("depth") = 2)
             .def("bound_storage", &Func::bound_storage)
             .def("memoize", &Func::memoize)
             .def("compute_inline", &Func::compute_inline)
@@ -344,6 +348,7 @@ void define_func(py::module &m) {
             .def("trace_realizations", &Func::trace_realizations)
             .def("print_loop_nest", &Func::print_loop_nest)
             .def("add_trace_tag", &Func::add_trace_tag, py::arg("trace_tag"))
+            .def("sample_tracing", &Func::sample_tracing, py::arg("var"), py::arg("sampling"), py::arg("n"))
 
             // TODO: also provide to-array versions to avoid requiring filesystem usage
             .def("debug_to_file", &Func::debug_to_file)
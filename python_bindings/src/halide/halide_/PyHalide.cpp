@@ -42,6 +42,17 @@
 PYBIND11_MODULE(HALIDE_PYBIND_MODULE_NAME, m) {
     using namespace Halide::PythonBindings;
 
+    // Most Python libraries that use CUDA use the primary context of the
+    // device, and so must we, for DLPack to be able to share device
+    // memory with them. (Set HL_CUDA_PRIMARY_CONTEXT=0 to opt out.)
+#ifdef _WIN32
+    if (!getenv("HL_CUDA_PRIMARY_CONTEXT")) {
+        _putenv_s("HL_CUDA_PRIMARY_CONTEXT", "1");
+    }
+#else
+    setenv("HL_CUDA_PRIMARY_CONTEXT", "1", /*overwrite*/ 0);
+#endif
+
     // Order of definitions matters somewhat:
     // things used for default arguments must be registered
     // prior to that usage.
@@ -192,6 +192,8 @@ void define_operators(py::module &m) {
     m.def("random_float", (Expr(*)(Expr))&random_float, py::arg("seed"));
     m.def("random_uint", (Expr(*)(Expr))&random_uint, py::arg("seed"));
     m.def("random_int", (Expr(*)(Expr))&random_int, py::arg("seed"));
+    m.def("philox4x32", &philox4x32, py::arg("counter"), py::arg("key") = std::vector<Expr>{}, py::arg("rounds") = 10);
+    m.def("random_bits_to_float", &random_bits_to_float);
     m.def("undef", (Expr(*)(Type))&undef);
     m.def(
         "memoize_tag", [](const Expr &result, const py::args &cache_key_values) -> Expr {
@@ -202,6 +204,7 @@ void define_operators(py::module &m) {
     m.def("likely_if_innermost", &likely_if_innermost);
     m.def("saturating_cast", (Expr(*)(Type, Expr))&saturating_cast);
     m.def("strict_float", &strict_float);
+    m.def("float16_compute", &float16_compute);
     m.def("target_arch_is", &target_arch_is);
     m.def("target_bits", &target_bits);
     m.def("target_has_feature", &target_has_feature);
@@ -77,6 +77,9 @@ void define_pipeline(py::module &m) {
             .def("get_func", &Pipeline::get_func,
                  py::arg("index"))
             .def("print_loop_nest", &Pipeline::print_loop_nest)
+            .def("compile_to_roofline_html", &Pipeline::compile_to_roofline_html,
+                 py::arg("filename"), py::arg("profiler_report") = "",
+                 py::arg("peak_ops_per_second") = 0.0, py::arg("peak_bytes_per_second") = 0.0)
 
             .def(
                 "compile_to", [](Pipeline &p, const std::map<OutputFileType, std::string> &output_files, const std::vector<Argument> &args, const std::string &fn_name, const Target &target) {
@@ -26,6 +26,10 @@ HALIDE_NEVER_INLINE void add_schedule_methods(PythonClass &class_instance) {
              py::arg("var"))
         .def("unroll", (T & (T::*)(const VarOrRVar &, const Expr &, TailStrategy)) & T::unroll,
              py::arg("var"), py::arg("factor"), py::arg("tail") = TailStrategy::Auto)
+        .def("unroll_and_jam", (T & (T::*)(const Var &, const Var &, const Expr &, TailStrategy)) & T::unroll_and_jam,
+             py::arg("var"), py::arg("jam"), py::arg("factor"), py::arg("tail") = TailStrategy::Auto)
+        .def("unroll_and_jam", (T & (T::*)(const Var &, const Var &, const Target &, TailStrategy)) & T::unroll_and_jam,
+             py::arg("var"), py::arg("jam"), py::arg("target"), py::arg("tail") = TailStrategy::Auto)
 
         .def("split", (T & (T::*)(const VarOrRVar &, const VarOrRVar &, const VarOrRVar &, const Expr &, TailStrategy)) & T::split,
              py::arg("old"), py::arg("outer"), py::arg("inner"), py::arg("factor"), py::arg("tail") = TailStrategy::Auto)
@@ -76,6 +80,8 @@ HALIDE_NEVER_INLINE void add_schedule_methods(PythonClass &class_instance) {
         .def("gpu_threads", (T & (T::*)(const VarOrRVar &, const VarOrRVar &, DeviceAPI)) & T::gpu_threads, py::arg("thread_x"), py::arg("thread_y"), py::arg("device_api") = DeviceAPI::Default_GPU)
         .def("gpu_threads", (T & (T::*)(const VarOrRVar &, const VarOrRVar &, const VarOrRVar &, DeviceAPI)) & T::gpu_threads, py::arg("thread_x"), py::arg("thread_y"), py::arg("thread_z"), py::arg("device_api") = DeviceAPI::Default_GPU)
         .def("gpu_single_thread", (T & (T::*)(DeviceAPI)) & T::gpu_single_thread, py::arg("device_api") = DeviceAPI::Default_GPU)
+        .def("gpu_persistent_blocks", (T & (T::*)(const VarOrRVar &, const VarOrRVar &, const Expr &, DeviceAPI)) & T::gpu_persistent_blocks, py::arg("x"), py::arg("block"), py::arg("num_blocks"), py::arg("device_api") = DeviceAPI::Default_GPU)
+        .def("distribute", &T::distribute, py::arg("x"), py::arg("num_devices"))
 
         .def("gpu_lanes", (T & (T::*)(const VarOrRVar &, DeviceAPI)) & T::gpu_lanes, py::arg("thread_x"), py::arg("device_api") = DeviceAPI::Default_GPU)
 
@@ -93,6 +99,8 @@ HALIDE_NEVER_INLINE void add_schedule_methods(PythonClass &class_instance) {
         .def("rename", &T::rename, py::arg("old_name"), py::arg("new_name"))
 
         .def("specialize", &T::specialize, py::arg("condition"))
+        .def("specialize_target_features", &T::specialize_target_features, py::arg("features"))
+        .def("specialize_tuned", &T::specialize_tuned, py::arg("variant"), py::arg("num_variants"))
         .def("specialize_fail", &T::specialize_fail, py::arg("message"))
 
         .def("allow_race_conditions", &T::allow_race_conditions)
@@ -18,6 +18,8 @@ void define_stage(py::module &m) {
                  py::arg("preserved"))
             .def("rfactor", (Func(Stage::*)(const RVar &, const Var &))&Stage::rfactor,
                  py::arg("r"), py::arg("v"))
+            .def("parallel_scan", &Stage::parallel_scan,
+                 py::arg("r"), py::arg("factor"))
 
             .def("unscheduled", &Stage::unscheduled);
 
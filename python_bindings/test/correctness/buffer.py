@@ -382,6 +382,47 @@ def test_oob():
         assert "index 6 is out of bounds for axis 1 with min=0, extent=6" in str(e)
 
 
+def test_dlpack():
+    # Buffer -> ndarray, without a copy.
+    b = hl.Buffer(hl.Int(16), [4, 3])
+    for y in range(3):
+        for x in range(4):
+            b[x, y] = x + 10 * y
+
+    assert b.__dlpack_device__() == (1, 0)
+    if hasattr(np, "from_dlpack"):
+        a = np.from_dlpack(b)
+        assert a.shape == (3, 4)
+        assert a.dtype == np.int16
+        assert a[2, 1] == 21
+        b[1, 2] = 99
+        assert a[2, 1] == 99
+
+    # ndarray -> Buffer, without a copy.
+    if hasattr(np.ndarray, "__dlpack__"):
+        a = np.arange(24, dtype=np.float32).reshape((2, 3, 4))
+        b = hl.Buffer.from_dlpack(a)
+        assert b.type() == hl.Float(32)
+        assert b.dimensions() == 3
+        assert b.dim(0).extent() == 4
+        assert b.dim(2).extent() == 2
+        assert b[3, 2, 1] == a[1, 2, 3]
+        a[1, 2, 3] = -1
+        assert b[3, 2, 1] == -1
+
+        # Non-compact strides are preserved.
+        t = hl.from_dlpack(a[:, ::2, 1:], reverse_axes=False)
+        assert t.dim(0).extent() == 2
+        assert t.dim(1).extent() == 2
+        assert t.dim(2).extent() == 3
+        assert t[1, 1, 2] == a[1, 2, 3]
+
+        # The Buffer keeps the memory alive.
+        del a
+        gc.collect()
+        assert b[3, 2, 1] == -1
+
+
 if __name__ == "__main__":
     test_make_interleaved()
     test_interleaved_ndarray()
@@ -401,3 +442,4 @@ if __name__ == "__main__":
     test_buffer_to_str()
     test_scalar_buffers()
     test_oob()
+    test_dlpack()
@@ -1,5 +1,7 @@
+import asyncio
 import halide as hl
 import numpy as np
+import threading
 
 from simplepy_generator import SimplePy
 import simplecpp_pystub  # Needed for create_callable_from_generator("simplecpp") to work
@@ -171,6 +173,38 @@ def test_simple(callable_factory):
         assert False, "Did not see expected exception!"
 
 
+def test_concurrent_calls():
+    p_offset = hl.Param(hl.Int(32))
+    x = hl.Var("x")
+    f = hl.Func("f")
+    f[x] = x + p_offset
+    c = f.compile_to_callable([p_offset])
+
+    # Calls release the GIL, so these run concurrently.
+    outs = [hl.Buffer(hl.Int(32), [1000]) for i in range(8)]
+    threads = [threading.Thread(target=c, args=(i, outs[i])) for i in range(8)]
+    for t in threads:
+        t.start()
+    for t in threads:
+        t.join()
+    for i in range(8):
+        assert outs[i][999] == 999 + i
+
+    async def run_async():
+        outs = [hl.Buffer(hl.Int(32), [100]) for i in range(4)]
+        await asyncio.gather(*[c.call_async(i, outs[i]) for i in range(4)])
+        for i in range(4):
+            assert outs[i][50] == 50 + i
+
+        g = hl.Func("g")
+        g[x] = x * 2
+        results = await asyncio.gather(g.realize_async([10]), hl.Pipeline(g).realize_async([20]))
+        assert results[0][9] == 18
+        assert results[1][19] == 38
+
+    asyncio.run(run_async())
+
+
 if __name__ == "__main__":
     # test_callable()
 
@@ -184,3 +218,4 @@ if __name__ == "__main__":
 
     test_simple(via_simplecpp_pystub)
     test_simple(via_simplepy)
+    test_concurrent_calls()
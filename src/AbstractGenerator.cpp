@@ -1,4 +1,8 @@
 #include "AbstractGenerator.h"
+
+#include <algorithm>
+#include <cmath>
+
 #include "BoundaryConditions.h"
 #include "Derivative.h"
 #include "Generator.h"
@@ -16,16 +20,61 @@ Argument to_argument(const Parameter &param) {
                     param.get_argument_estimates());
 }
 
+// Scale an estimated extent for a size variant.
+Expr scale_estimated_extent(const Expr &extent, float scale) {
+    auto e = as_const_int(extent);
+    if (!e || *e < 16) {
+        return extent;
+    }
+    return (int)std::max<int64_t>(1, std::llround(*e * (double)scale));
+}
+
+void scale_estimated_extents(Parameter p, float scale) {
+    if (!p.is_buffer()) {
+        return;
+    }
+    for (int d = 0; d < p.dimensions(); d++) {
+        Expr extent = p.extent_constraint_estimate(d);
+        if (extent.defined()) {
+            p.set_extent_constraint_estimate(d, scale_estimated_extent(extent, scale));
+        }
+    }
+}
+
 }  // namespace
 
 Module AbstractGenerator::build_module(const std::string &function_name) {
-    const LinkageType linkage_type = LinkageType::ExternalPlusMetadata;
+    return build_module(function_name, 1.0f, LinkageType::ExternalPlusMetadata);
+}
 
+Module AbstractGenerator::build_module(const std::string &function_name, float estimate_scale, LinkageType linkage_type) {
     Pipeline pipeline = build_pipeline();
 
     AutoSchedulerResults auto_schedule_results;
     const auto context = this->context();
     const auto &asp = context.autoscheduler_params();
+    const auto arg_infos = arginfos();
+    if (estimate_scale != 1.0f) {
+        user_assert(!asp.name.empty())
+            << "Generator " << name() << " can only be built with size variants if an autoscheduler is specified.\n";
+        for (const auto &a : arg_infos) {
+            if (a.dir == ArgInfoDirection::Input) {
+                for (const auto &p : input_parameter(a.name)) {
+                    scale_estimated_extents(p, estimate_scale);
+                }
+            } else {
+                for (const Func &f : output_func(a.name)) {
+                    Function fn = f.function();
+                    for (Bound &b : fn.schedule().estimates()) {
+                        b.extent = scale_estimated_extent(b.extent, estimate_scale);
+                    }
+                    for (const auto &p : fn.output_buffers()) {
+                        scale_estimated_extents(p, estimate_scale);
+                    }
+                }
+            }
+        }
+    }
     if (!asp.name.empty()) {
         debug(1) << "Applying autoscheduler " << asp.name << " to Generator " << name() << " ...\n";
         auto_schedule_results = pipeline.apply_autoscheduler(context.target(), asp);
@@ -34,7 +83,6 @@ Module AbstractGenerator::build_module(const std::string &function_name) {
     }
 
     std::vector<Argument> filter_arguments;
-    const auto arg_infos = arginfos();
     for (const auto &a : arg_infos) {
         if (a.dir != ArgInfoDirection::Input) {
             continue;
@@ -208,6 +208,13 @@ public:
      *If function_name is empty, generator_name() will be used for the function. */
     Module build_module(const std::string &function_name = "");
 
+    /** As build_module(), but with the estimated extents of the inputs and
+     * outputs scaled by estimate_scale before autoscheduling, and with the
+     * given linkage. This builds the variants of a pipeline generated with
+     * size variants (see ExecuteGeneratorArgs::size_variants). Estimated
+     * extents smaller than 16 (e.g. color channels) are left alone. */
+    Module build_module(const std::string &function_name, float estimate_scale, LinkageType linkage_type);
+
     /**
      * Build a module that is suitable for using for gradient descent calculation in TensorFlow or PyTorch.
      *
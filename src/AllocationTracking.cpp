@@ -0,0 +1,304 @@
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "AllocationTracking.h"
+#include "CodeGen_Internal.h"
+#include "Function.h"
+#include "IRMutator.h"
+#include "IROperator.h"
+#include "IRVisitor.h"
+#include "Scope.h"
+#include "Simplify.h"
+#include "Util.h"
+
+namespace Halide {
+namespace Internal {
+
+using std::map;
+using std::pair;
+using std::string;
+using std::vector;
+
+namespace {
+
+// These must match halide_allocation_kind_t in HalideRuntime.h.
+enum AllocationKind {
+    HeapAllocation = 0,
+    StackAllocation = 1,
+    DeviceAllocation = 2,
+};
+
+// Find the outermost loop, within the storage of a Func, that its
+// producer is inside of. Storage spanning such a loop holds more of the
+// Func than one iteration of it computes.
+class FindLoopAroundProducer : public IRVisitor {
+    using IRVisitor::visit;
+
+    const string &func;
+    vector<string> loops;
+
+    void visit(const For *op) override {
+        loops.push_back(op->name);
+        IRVisitor::visit(op);
+        loops.pop_back();
+    }
+
+    void visit(const ProducerConsumer *op) override {
+        if (op->is_producer && op->name == func && !loops.empty() && result.empty()) {
+            result = loops[0];
+        }
+        IRVisitor::visit(op);
+    }
+
+public:
+    string result;
+
+    FindLoopAroundProducer(const string &func)
+        : func(func) {
+    }
+};
+
+class InjectAllocationTracking : public IRMutator {
+public:
+    // The name, hint and kind of each allocation site, by id.
+    vector<string> site_names, site_hints;
+    vector<int> site_kinds;
+
+    bool found_marker = false;
+
+    InjectAllocationTracking(const string &pipeline_name, const map<string, Function> &env, bool keep_marker)
+        : pipeline_name(pipeline_name), env(env), keep_marker(keep_marker),
+          run_name(unique_name("allocation_tracker_run")) {
+    }
+
+private:
+    using IRMutator::visit;
+
+    const string &pipeline_name;
+    const map<string, Function> &env;
+    const bool keep_marker;
+    const string run_name;
+
+    map<pair<string, int>, int> site_ids;
+
+    // Whether we're past the bounds queries, where the run state is in
+    // scope.
+    bool in_pipeline = false;
+
+    // The serial and parallel loops enclosing the current statement.
+    vector<string> loops;
+
+    struct AllocationInfo {
+        int site;
+        Expr size;
+        bool freed;
+    };
+    Scope<AllocationInfo> allocations;
+
+    Expr run() const {
+        return Variable::make(Handle(), run_name);
+    }
+
+    // The Func an allocation belongs to. Tuple-valued Funcs have an
+    // allocation per element, suffixed with its index.
+    string func_of(const string &name) const {
+        if (env.count(name)) {
+            return name;
+        }
+        size_t dot = name.rfind('.');
+        if (dot != string::npos && env.count(name.substr(0, dot))) {
+            return name.substr(0, dot);
+        }
+        return "";
+    }
+
+    // A suggestion of how to make the storage of a Func smaller, from
+    // where it's stored. around_producer is the outermost loop that the
+    // storage spans and the Func is computed inside of, if any.
+    string hint(const string &func, const string &around_producer) const {
+        if (func.empty()) {
+            return "";
+        } else if (!around_producer.empty()) {
+            return "stored outside loop " + around_producer + ", inside which it is computed: " +
+                   "fold_storage() it along the dimension that loop walks, or store_at() that loop";
+        } else if (loops.empty()) {
+            return "computed and stored at root: compute_at() and store_at() a loop of its consumer, "
+                   "so that only part of it is live at once";
+        } else {
+            return "stored inside loop " + loops.back() + ": store_at() an inner loop, " +
+                   "or split that loop into smaller tiles";
+        }
+    }
+
+    int get_site(const string &name, int kind, const string &hint) {
+        auto [it, inserted] = site_ids.emplace(std::make_pair(name, kind), (int)site_names.size());
+        if (inserted) {
+            site_names.push_back(name);
+            site_hints.push_back(hint);
+            site_kinds.push_back(kind);
+        }
+        return it->second;
+    }
+
+    Stmt track(const string &fn, const vector<Expr> &args) const {
+        return Evaluate::make(Call::make(Int(32), fn, args, Call::Extern));
+    }
+
+    static Expr make_array(const vector<Expr> &elements) {
+        return elements.empty() ?
+                   reinterpret(Handle(), cast<uint64_t>(0)) :
+                   Call::make(Handle(), Call::make_struct, elements, Call::Intrinsic);
+    }
+
+    Stmt visit(const Block *op) override {
+        const Evaluate *e = op->first.as<Evaluate>();
+        if (!e || !Call::as_intrinsic(e->value, {Call::profiling_enable_instance_marker})) {
+            return IRMutator::visit(op);
+        }
+
+        // We're out of the bounds query code, so this is a run of the
+        // pipeline.
+        found_marker = true;
+        Stmt rest;
+        {
+            ScopedValue<bool> bind(in_pipeline, true);
+            rest = mutate(op->rest);
+        }
+
+        vector<Expr> names, hints, kinds;
+        for (size_t i = 0; i < site_names.size(); i++) {
+            names.emplace_back(site_names[i]);
+            hints.emplace_back(site_hints[i]);
+            kinds.emplace_back(site_kinds[i]);
+        }
+        Expr start = Call::make(Handle(), "halide_allocation_tracker_pipeline_start",
+                                {pipeline_name, (int)site_names.size(),
+                                 make_array(names), make_array(hints), make_array(kinds)},
+                                Call::Extern);
+        Expr end = Call::make(Handle(), Call::register_destructor,
+                              {Expr("halide_allocation_tracker_pipeline_end"), run()}, Call::Intrinsic);
+        Stmt s = LetStmt::make(run_name, start, Block::make(Evaluate::make(end), rest));
+        // The profilers need the marker too.
+        return keep_marker ? Block::make(op->first, s) : s;
+    }
+
+    Stmt visit(const For *op) override {
+        if (is_gpu(op->for_type) ||
+            (op->device_api != DeviceAPI::Host && op->device_api != DeviceAPI::None)) {
+            // This runs on a device, which can't call the tracker.
+            return op;
+        }
+        loops.push_back(op->name);
+        Stmt s = IRMutator::visit(op);
+        loops.pop_back();
+        return s;
+    }
+
+    Stmt visit(const Allocate *op) override {
+        if (!in_pipeline ||
+            (op->memory_type != MemoryType::Auto &&
+             op->memory_type != MemoryType::Heap &&
+             op->memory_type != MemoryType::Stack)) {
+            return IRMutator::visit(op);
+        }
+
+        // Allocations that codegen puts on the stack are those that
+        // inject_profiling counts as stack allocations.
+        const int64_t constant_size = Allocate::constant_allocation_size(op->extents, op->name);
+        const bool on_stack = op->memory_type == MemoryType::Stack ||
+                              (op->memory_type == MemoryType::Auto && !op->new_expr.defined() &&
+                               constant_size > 0 &&
+                               can_allocation_fit_on_stack(constant_size * op->type.bytes()));
+
+        Expr size = make_const(UInt(64), op->type.bytes());
+        for (const Expr &e : op->extents) {
+            size *= cast<uint64_t>(e);
+        }
+        size = simplify(Select::make(op->condition, size, make_zero(UInt(64))));
+        if (is_const_zero(size)) {
+            return IRMutator::visit(op);
+        }
+
+        const string func = func_of(op->name);
+        FindLoopAroundProducer finder(func);
+        if (!func.empty()) {
+            op->body.accept(&finder);
+        }
+        const int site = get_site(op->name, on_stack ? StackAllocation : HeapAllocation,
+                                  hint(func, finder.result));
+
+        Stmt body;
+        bool freed;
+        {
+            ScopedBinding<AllocationInfo> bind(allocations, op->name, {site, size, false});
+            body = mutate(op->body);
+            freed = allocations.get(op->name).freed;
+        }
+        if (!freed) {
+            // It's freed at the end of its scope.
+            body = Block::make(body, track("halide_allocation_tracker_free", {run(), site, size}));
+        }
+        Stmt s = Allocate::make(op->name, op->type, op->memory_type, op->extents, op->condition,
+                                body, op->new_expr, op->free_function, op->padding);
+        return Block::make(track("halide_allocation_tracker_allocate", {run(), site, size}), s);
+    }
+
+    Stmt visit(const Free *op) override {
+        AllocationInfo *info = allocations.shallow_find(op->name);
+        if (!info) {
+            return op;
+        }
+        info->freed = true;
+        return Block::make(track("halide_allocation_tracker_free", {run(), info->site, info->size}), op);
+    }
+
+    Stmt visit(const LetStmt *op) override {
+        // The device allocations and frees of Funcs' storage are made by
+        // inject_host_dev_buffer_copies, as lets of the results of these
+        // calls, on the Func's .buffer.
+        const Call *c = op->value.as<Call>();
+        if (!in_pipeline || !c || c->call_type != Call::Extern || c->args.empty()) {
+            return IRMutator::visit(op);
+        }
+        const Variable *buf = c->args[0].as<Variable>();
+        if (!buf || !ends_with(buf->name, ".buffer")) {
+            return IRMutator::visit(op);
+        }
+        Stmt tracking;
+        if (c->name == "halide_device_malloc" || c->name == "halide_device_and_host_malloc") {
+            const string name = buf->name.substr(0, buf->name.size() - 7);
+            const int site = get_site(name, DeviceAllocation, hint(func_of(name), ""));
+            tracking = track("halide_allocation_tracker_device_malloc", {run(), site, buf});
+        } else if (c->name == "halide_device_free" || c->name == "halide_device_and_host_free") {
+            tracking = track("halide_allocation_tracker_device_free", {run(), buf});
+        } else {
+            return IRMutator::visit(op);
+        }
+        Stmt body = mutate(op->body);
+        return LetStmt::make(op->name, op->value, Block::make(tracking, body));
+    }
+
+    Expr visit(const Call *op) override {
+        if (op->is_intrinsic(Call::profiling_enable_instance_marker) && !keep_marker) {
+            return make_zero(Int(32));
+        } else {
+            return IRMutator::visit(op);
+        }
+    }
+};
+
+}  // namespace
+
+Stmt inject_allocation_tracking(const Stmt &s, const string &pipeline_name,
+                                const map<string, Function> &env, bool keep_profiling_marker) {
+    InjectAllocationTracking tracking(pipeline_name, env, keep_profiling_marker);
+    Stmt result = tracking.mutate(s);
+    internal_assert(tracking.found_marker)
+        << "No profiling marker found in " << pipeline_name << "\n";
+    return result;
+}
+
+}  // namespace Internal
+}  // namespace Halide
@@ -0,0 +1,32 @@
+#ifndef HALIDE_ALLOCATION_TRACKING_H
+#define HALIDE_ALLOCATION_TRACKING_H
+
+/** \file
+ * Defines the lowering pass that records every allocation and free of
+ * the storage of each Func, for Target::TrackAllocations.
+ */
+
+#include <map>
+#include <string>
+
+#include "Expr.h"
+
+namespace Halide {
+namespace Internal {
+
+class Function;
+
+/** Take a statement representing a halide pipeline and insert calls to
+ * the runtime's allocation tracker around every heap, stack and device
+ * allocation of a Func's storage. The runtime reports the peak memory
+ * use of the pipeline, what was live at the peak, and a hint of how each
+ * of those allocations could be made smaller, chosen here from the loop
+ * level the Func is stored at and the one it's computed at. Should be
+ * done at the same point as inject_profiling. */
+Stmt inject_allocation_tracking(const Stmt &s, const std::string &pipeline_name,
+                                const std::map<std::string, Function> &env, bool keep_profiling_marker);
+
+}  // namespace Internal
+}  // namespace Halide
+
+#endif
@@ -0,0 +1,175 @@
+#include "AutoRFactor.h"
+
+#include <optional>
+
+#include "Associativity.h"
+#include "Func.h"
+#include "Function.h"
+#include "IROperator.h"
+#include "Simplify.h"
+#include "Target.h"
+
+namespace Halide {
+namespace Internal {
+
+using std::map;
+using std::string;
+using std::vector;
+
+namespace {
+
+// Reductions over a constant domain smaller than this aren't worth
+// parallelizing.
+constexpr int64_t min_reduction_size = 1 << 16;
+
+// A reduction is split only if its domain is at least this many times
+// larger than the pure domain it reduces into, so that there is more
+// parallelism to find in the former than in the latter.
+constexpr int64_t min_reduction_ratio = 1024;
+
+// A reduction over a domain whose size isn't known at compile time, e.g.
+// one over the whole of an input image, is split only if the pure domain
+// has a known size no larger than this.
+constexpr int64_t max_unknown_reduction_pure_size = 16;
+
+// The number of sites of a one-dimensional reduction each parallel task
+// reduces.
+constexpr int block_size = 8192;
+
+// The size of the pure domain of f, from its bounds or estimates, or -1
+// if that isn't known.
+int64_t pure_domain_size(const Function &f) {
+    auto constant_extent = [](const vector<Bound> &bounds, const string &var) -> std::optional<int64_t> {
+        for (const Bound &b : bounds) {
+            if (b.var == var && b.extent.defined()) {
+                return as_const_int(b.extent);
+            }
+        }
+        return std::nullopt;
+    };
+
+    int64_t size = 1;
+    for (const string &arg : f.args()) {
+        std::optional<int64_t> extent = constant_extent(f.schedule().bounds(), arg);
+        if (!extent) {
+            extent = constant_extent(f.schedule().estimates(), arg);
+        }
+        if (!extent) {
+            return -1;
+        }
+        size *= *extent;
+    }
+    return size;
+}
+
+// Whether update 'idx' of f is a reduction worth splitting.
+bool should_rfactor(const Function &f, int idx) {
+    const Definition &def = f.update(idx);
+    const vector<ReductionVariable> &rvars = def.schedule().rvars();
+    if (def.schedule().touched() || rvars.empty() || !def.specializations().empty()) {
+        return false;
+    }
+
+    // Each site of the pure domain must reduce the whole of the reduction
+    // domain, i.e. the update must be to f(x, y, ...).
+    for (size_t i = 0; i < def.args().size(); i++) {
+        const Variable *v = def.args()[i].as<Variable>();
+        if (!v || v->name != f.args()[i]) {
+            return false;
+        }
+    }
+
+    const AssociativeOp op = prove_associativity(f.name(), def.args(), def.values());
+    if (!op.associative() || !op.commutative()) {
+        return false;
+    }
+    for (size_t i = 0; i < op.size(); i++) {
+        if (op.xs[i].var.empty()) {
+            return false;
+        }
+    }
+
+    const int64_t pure_size = pure_domain_size(f);
+    if (pure_size < 0) {
+        return false;
+    }
+    Expr reduction_size = make_const(Int(64), 1);
+    for (const ReductionVariable &rv : rvars) {
+        reduction_size *= cast<int64_t>(rv.extent);
+    }
+    reduction_size = simplify(reduction_size);
+    if (auto size = as_const_int(reduction_size)) {
+        return *size >= min_reduction_size && *size >= pure_size * min_reduction_ratio;
+    }
+    return pure_size <= max_unknown_reduction_pure_size;
+}
+
+// The pattern of test/performance/rfactor.cpp: factor the outermost
+// dimension of the reduction out into a Func that is parallel over it,
+// and within that, factor out a vector of the innermost dimension.
+vector<Function> rfactor_update(const Function &f, int idx, const Target &t) {
+    Definition def = f.update(idx);
+    Stage update(f, def, idx + 1);
+    const vector<ReductionVariable> &rvars = def.schedule().rvars();
+
+    RVar outer(rvars.back().var), inner(rvars.front().var);
+    if (rvars.size() == 1) {
+        outer = RVar(rvars[0].var + "_par");
+        inner = RVar(rvars[0].var + "_in");
+        update.split(RVar(rvars[0].var), outer, inner, block_size);
+    }
+
+    Var u(f.name() + "_par"), v(f.name() + "_vec");
+    Func intm = update.rfactor(outer, u);
+    intm.compute_root().update().parallel(u);
+
+    vector<Function> result = {intm.function()};
+    const int vector_size = t.natural_vector_size(intm.types()[0]);
+    if (vector_size > 1) {
+        RVar inner_o(inner.name() + "_vo"), inner_i(inner.name() + "_vi");
+        Func vec = intm.update()
+                       .split(inner, inner_o, inner_i, vector_size)
+                       .rfactor(inner_i, v);
+        vec.compute_at(intm, u).vectorize(v).update().vectorize(v);
+        result.push_back(vec.function());
+    }
+    return result;
+}
+
+}  // namespace
+
+void auto_rfactor(map<string, Function> &env, const Target &t) {
+    if (!t.has_feature(Target::AutoRFactor)) {
+        return;
+    }
+
+    vector<Function> funcs;
+    for (const auto &iter : env) {
+        funcs.push_back(iter.second);
+    }
+
+    for (Function &f : funcs) {
+        if (f.has_extern_definition() || !f.schedule().compute_level().is_root()) {
+            continue;
+        }
+        // The intermediate Funcs are named after f, so only the first
+        // update that qualifies is split.
+        if (env.count(f.name() + "_intm") || env.count(f.name() + "_intm_intm")) {
+            continue;
+        }
+        for (int i = 0; i < (int)f.updates().size(); i++) {
+            if (!should_rfactor(f, i)) {
+                continue;
+            }
+            debug(1) << "Splitting update " << i << " of " << f.name() << " with rfactor\n";
+            for (Function &intm : rfactor_update(f, i, t)) {
+                intm.lock_loop_levels();
+                env.emplace(intm.name(), intm);
+            }
+            break;
+        }
+    }
+}
+
+}  // namespace Internal
+}  // namespace Halide
@@ -0,0 +1,31 @@
+#ifndef HALIDE_AUTO_RFACTOR_H
+#define HALIDE_AUTO_RFACTOR_H
+
+/** \file
+ * Defines a lowering pass that parallelizes large unscheduled reductions
+ * with rfactor().
+ */
+
+#include <map>
+#include <string>
+
+namespace Halide {
+
+struct Target;
+
+namespace Internal {
+
+class Function;
+
+/** If Target::AutoRFactor is set, find the update definitions of Funcs
+ * computed at root that reduce a large domain into a small one with an
+ * associative and commutative operator, and which have not been
+ * scheduled, and rewrite each with rfactor() into a reduction that is
+ * parallel over blocks of the domain and vectorized within them. The
+ * intermediate Funcs this creates are added to env. */
+void auto_rfactor(std::map<std::string, Function> &env, const Target &t);
+
+}  // namespace Internal
+}  // namespace Halide
+
+#endif
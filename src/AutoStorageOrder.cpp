@@ -0,0 +1,166 @@
+#include "AutoStorageOrder.h"
+
+#include <set>
+
+#include "ExprUsesVar.h"
+#include "Function.h"
+#include "IROperator.h"
+#include "IRVisitor.h"
+#include "Simplify.h"
+#include "Substitute.h"
+#include "Target.h"
+
+namespace Halide {
+namespace Internal {
+
+using std::map;
+using std::string;
+using std::vector;
+
+namespace {
+
+// The var of a definition that its innermost vectorized or GPU thread
+// loop iterates over, or the empty string if there is no such loop. Dims
+// made by splits are named after the var they were split from.
+string vector_var(const Definition &def) {
+    for (const Dim &d : def.schedule().dims()) {
+        if (d.for_type == ForType::Vectorized ||
+            d.for_type == ForType::GPUThread ||
+            d.for_type == ForType::GPULane) {
+            return d.var.substr(0, d.var.find('.'));
+        }
+    }
+    return "";
+}
+
+// Whether consecutive values of var step through e by one.
+bool is_dense_in(const Expr &e, const string &var) {
+    if (!expr_uses_var(e, var)) {
+        return false;
+    }
+    Expr step = simplify(substitute(var, Variable::make(Int(32), var) + 1, e) - e);
+    return is_const_one(step) || is_const(step, -1);
+}
+
+class FindCallArgs : public IRVisitor {
+    using IRVisitor::visit;
+
+    void visit(const Call *op) override {
+        IRVisitor::visit(op);
+        if (op->call_type == Call::Halide && op->name == name) {
+            calls.push_back(op->args);
+        }
+    }
+
+    const string &name;
+
+public:
+    vector<vector<Expr>> calls;
+
+    explicit FindCallArgs(const string &name)
+        : name(name) {
+    }
+};
+
+// Add a vote for each dimension of f that the vectorized loop of def
+// accesses densely.
+void vote(const Function &f, const Definition &def, const Function &stage_func,
+          map<int, int> &votes) {
+    string var = vector_var(def);
+    if (var.empty()) {
+        return;
+    }
+    auto vote_for_args = [&](const vector<Expr> &args) {
+        for (size_t i = 0; i < args.size(); i++) {
+            if (is_dense_in(args[i], var)) {
+                votes[(int)i]++;
+            }
+        }
+    };
+    if (stage_func.same_as(f)) {
+        vote_for_args(def.args());
+    }
+    FindCallArgs finder(f.name());
+    for (const Expr &e : def.args()) {
+        e.accept(&finder);
+    }
+    for (const Expr &e : def.values()) {
+        e.accept(&finder);
+    }
+    for (const vector<Expr> &args : finder.calls) {
+        vote_for_args(args);
+    }
+}
+
+// Whether the storage of f is in the order of its pure args, and isn't
+// folded.
+bool has_default_storage(const Function &f) {
+    const vector<StorageDim> &dims = f.schedule().storage_dims();
+    if (dims.size() != f.args().size()) {
+        return false;
+    }
+    for (size_t i = 0; i < dims.size(); i++) {
+        if (dims[i].var != f.args()[i] || dims[i].fold_factor.defined()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+}  // namespace
+
+void auto_storage_order(map<string, Function> &env, const vector<Function> &outputs, const Target &t) {
+    if (!t.has_feature(Target::AutoStorageOrder)) {
+        return;
+    }
+
+    std::set<string> output_names;
+    for (const Function &f : outputs) {
+        output_names.insert(f.name());
+    }
+
+    for (auto &iter : env) {
+        Function &f = iter.second;
+        if (output_names.count(f.name()) ||
+            f.has_extern_definition() ||
+            f.schedule().compute_level().is_inlined() ||
+            f.dimensions() < 2 ||
+            !has_default_storage(f)) {
+            continue;
+        }
+
+        map<int, int> votes;
+        for (const auto &it : env) {
+            const Function &g = it.second;
+            if (g.has_extern_definition()) {
+                continue;
+            }
+            vote(f, g.definition(), g, votes);
+            for (const Definition &def : g.updates()) {
+                vote(f, def, g, votes);
+            }
+        }
+
+        // Only move a dimension in front of the innermost one if more of
+        // the vectorized accesses are dense in it.
+        int best = 0, best_votes = votes[0];
+        for (const auto &v : votes) {
+            if (v.second > best_votes) {
+                best = v.first;
+                best_votes = v.second;
+            }
+        }
+        if (best == 0) {
+            continue;
+        }
+
+        debug(1) << "Storing " << f.name() << " with " << f.args()[best] << " innermost\n";
+        vector<StorageDim> &dims = f.schedule().storage_dims();
+        StorageDim innermost = dims[best];
+        dims.erase(dims.begin() + best);
+        dims.insert(dims.begin(), innermost);
+    }
+}
+
+}  // namespace Internal
+}  // namespace Halide
@@ -0,0 +1,37 @@
+#ifndef HALIDE_AUTO_STORAGE_ORDER_H
+#define HALIDE_AUTO_STORAGE_ORDER_H
+
+/** \file
+ * Defines a lowering pass that picks the storage order of intermediate
+ * Funcs from the way they are accessed.
+ */
+
+#include <map>
+#include <string>
+#include <vector>
+
+namespace Halide {
+
+struct Target;
+
+namespace Internal {
+
+class Function;
+
+/** If Target::AutoStorageOrder is set, pick the innermost storage
+ * dimension of each intermediate Func whose storage order has not been
+ * scheduled, to be the one its vectorized (or GPU thread) loops store to
+ * and load from densely most often: by its own stages, and by the
+ * stages that call it. For example, an RGBA image vectorized across
+ * channels is stored interleaved, and one vectorized across x planar.
+ * The strided accesses left on the other side of such a boundary become
+ * dense vector loads and stores with shuffles, as they do for strided
+ * accesses to inputs and outputs. */
+void auto_storage_order(std::map<std::string, Function> &env,
+                        const std::vector<Function> &outputs,
+                        const Target &t);
+
+}  // namespace Internal
+}  // namespace Halide
+
+#endif
@@ -0,0 +1,94 @@
+#include "BitPacking.h"
+
+#include "Error.h"
+#include "IROperator.h"
+
+namespace Halide {
+
+using std::string;
+using std::vector;
+
+namespace {
+
+// The number of elements of the given number of bits in a byte.
+int elements_per_byte(int bits) {
+    user_assert(bits == 1 || bits == 2 || bits == 4)
+        << "Can only pack elements of 1, 2 or 4 bits, not " << bits << ".\n";
+    return 8 / bits;
+}
+
+vector<Var> packing_args(const Func &f) {
+    user_assert(f.defined() && f.outputs() == 1)
+        << "Can only pack or unpack a defined Func with a single output.\n";
+    vector<Var> args = f.args();
+    user_assert(!args.empty())
+        << "Func " << f.name() << " must have a dimension to pack or unpack.\n";
+    return args;
+}
+
+}  // namespace
+
+Func unpack_bits(const Func &packed, int bits, Type t, const string &name) {
+    const int k = elements_per_byte(bits);
+    vector<Var> args = packing_args(packed);
+    user_assert(packed.type() == UInt(8))
+        << "Func " << packed.name() << " has type " << packed.type()
+        << ", but packed elements must be stored as uint8.\n";
+    user_assert(t.is_scalar() && (t.is_int() || t.is_uint() || t.is_bool()))
+        << "Can't unpack elements to type " << t << ".\n";
+    user_assert(!t.is_bool() || bits == 1)
+        << "Only one-bit elements can be unpacked to bools.\n";
+
+    Var x = args[0];
+    vector<Expr> byte_args(args.begin(), args.end());
+    byte_args[0] = x / k;
+    Expr byte = packed(byte_args);
+    Expr value = (byte >> cast<uint8_t>((x % k) * bits)) & ((1 << bits) - 1);
+    if (t.is_int()) {
+        // Sign-extend the element from its top bit.
+        value = cast<int8_t>(value << (8 - bits)) >> (8 - bits);
+    }
+
+    Func unpacked(name);
+    unpacked(args) = t.is_bool() ? value != 0 : cast(t, value);
+    return unpacked;
+}
+
+Func pack_bits(const Func &unpacked, int bits, const string &name) {
+    const int k = elements_per_byte(bits);
+    vector<Var> args = packing_args(unpacked);
+    user_assert(unpacked.type().is_int() || unpacked.type().is_uint() || unpacked.type().is_bool())
+        << "Can't pack elements of type " << unpacked.type() << ".\n";
+
+    Var x = args[0];
+    Expr result;
+    for (int j = 0; j < k; j++) {
+        vector<Expr> element_args(args.begin(), args.end());
+        element_args[0] = x * k + j;
+        Expr e = cast<uint8_t>(unpacked(element_args)) & ((1 << bits) - 1);
+        e = j == 0 ? e : (e << (j * bits));
+        result = result.defined() ? (result | e) : e;
+    }
+
+    Func packed(name);
+    packed(args) = result;
+    return packed;
+}
+
+Func &schedule_unpacked_bits(Func &unpacked, int bits, int vector_size) {
+    const int k = elements_per_byte(bits);
+    vector<Var> args = packing_args(unpacked);
+    Var x = args[0], element;
+
+    // The elements of each byte are computed by an unrolled loop, inside
+    // the vectorized loop over the bytes. When the computed region starts
+    // at a byte, x / k and x % k are a dense vector of bytes and a
+    // constant.
+    unpacked.align_bounds(x, k)
+        .split(x, x, element, k)
+        .unroll(element)
+        .vectorize(x, vector_size, TailStrategy::GuardWithIf);
+    return unpacked;
+}
+
+}  // namespace Halide
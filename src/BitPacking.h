@@ -0,0 +1,46 @@
+#ifndef HALIDE_BIT_PACKING_H
+#define HALIDE_BIT_PACKING_H
+
+/** \file
+ * Support for sub-byte integer data (e.g. int4 weights, or bitmasks),
+ * stored packed into bytes.
+ */
+
+#include <string>
+
+#include "Func.h"
+
+namespace Halide {
+
+/** Unpack the elements of a Func of bytes that each hold 8 / bits
+ * elements of the given number of bits (1, 2 or 4), with the first
+ * element in the low bits. The first dimension of the result indexes the
+ * elements: unpacked(x, ...) is element x % (8 / bits) of byte
+ * packed(x / (8 / bits), ...). The elements are sign-extended if t is
+ * signed, and t may be Bool() for one-bit elements, e.g. for masks:
+ \code
+ ImageParam int4_weights(UInt(8), 2), mask_bits(UInt(8), 2);
+ Func weights = unpack_bits(int4_weights, 4, Int(8));
+ Func mask = unpack_bits(mask_bits, 1, Bool());
+ \endcode
+ * The result is best computed at some loop level, and scheduled with
+ * schedule_unpacked_bits, rather than inlined. */
+Func unpack_bits(const Func &packed, int bits, Type t, const std::string &name = "unpacked");
+
+/** Pack the low bits of the elements of a Func (of an integer or bool
+ * type) into bytes, 8 / bits to a byte. This is the inverse of
+ * unpack_bits: element x of the first dimension goes to byte x / (8 /
+ * bits). Vectorizing the result loads all of the elements of each
+ * vector of bytes with dense loads and deinterleaving shuffles. */
+Func pack_bits(const Func &unpacked, int bits, const std::string &name = "packed");
+
+/** Vectorize the first dimension of a Func unpacked with unpack_bits,
+ * with vectors of the given number of bytes. Each vector of bytes is
+ * loaded densely, and its elements are extracted with constant shifts
+ * and masks, and stored with interleaving stores. The Func must not
+ * be inlined. */
+Func &schedule_unpacked_bits(Func &unpacked, int bits, int vector_size);
+
+}  // namespace Halide
+
+#endif
@@ -1,6 +1,7 @@
 #include "BoundSmallAllocations.h"
 #include "Bounds.h"
 #include "CodeGen_Internal.h"
+#include "ExprUsesVar.h"
 #include "IRMutator.h"
 #include "IROperator.h"
 #include "Simplify.h"
@@ -147,9 +148,274 @@ class BoundSmallAllocations : public IRMutator {
                 << "Allocation " << op->name << " has a size greater than 2^31: " << bound << "\n";
             return Allocate::make(op->name, op->type, op->memory_type, {(int32_t)size}, op->condition,
                                   mutate(op->body), op->new_expr, op->free_function, op->padding);
+        } else if (size_ptr && size > 0 &&
+                   op->memory_type == MemoryType::Auto &&
+                   device_api == DeviceAPI::None &&
+                   !op->new_expr.defined() &&
+                   can_allocation_fit_on_stack(size * op->type.bytes())) {
+            // The size is dynamic, but bounded by something that fits
+            // on the stack, so it's not worth calling halide_malloc
+            // (or rounding it up to the bound). Stack allocations of
+            // dynamic size go on the pseudostack, which allocas just
+            // the size needed, and falls back to the heap if a
+            // function's stack use keeps growing.
+            return Allocate::make(op->name, op->type, MemoryType::Stack, op->extents, op->condition,
+                                  mutate(op->body), op->new_expr, op->free_function, op->padding);
+        } else {
+            return IRMutator::visit(op);
+        }
+    }
+};
+
+// Carve the heap allocations of a thread out of arenas, each made by a
+// single allocation up front. Each allocation's offset is the end of
+// the allocations enclosing it in the same arena, so allocations with
+// disjoint scopes share memory, and the arena is as large as the
+// deepest nest of allocations in it.
+//
+// Nested allocations can also have disjoint lifetimes: a chain of
+// compute_root Funcs is a deep nest, but each one is freed early, after
+// its last use. The region of an allocation freed at the same level of
+// control flow it was made at is a hole, which a later allocation in
+// the same arena reuses if it provably fits, like registers are reused
+// once the value in them is dead.
+class PlaceAllocationsInArenas : public IRMutator {
+    using IRMutator::visit;
+
+    // Allocations are aligned to this many bytes within an arena, which
+    // is at least the alignment of halide_malloc on all targets.
+    static constexpr int arena_alignment = 128;
+
+    struct Arena {
+        std::string name;
+        // Bounds of the lets and loop variables defined inside the
+        // arena, in terms of those defined outside of it.
+        Scope<Interval> scope;
+        // An upper bound on the end of the allocations in it so far.
+        Expr size;
+
+        struct Region {
+            Expr begin, end;
+            // The control flow depth the region was allocated at.
+            int depth;
+        };
+        // The regions of the allocations in the arena, by name.
+        std::map<std::string, Region> regions;
+        // The regions of allocations that have been freed, but whose
+        // scope hasn't ended, which later allocations can reuse.
+        std::vector<Region> holes;
+    };
+
+    // The arena the current statement can allocate from, if any.
+    Arena *arena = nullptr;
+
+    // The offset in the arena after the allocations enclosing the
+    // current statement.
+    Expr offset;
+
+    bool in_device_code = false;
+
+    // The number of loops and ifs around the current statement. A free
+    // inside control flow the allocation isn't in may not happen, or may
+    // be followed by another use in a later iteration.
+    int control_depth = 0;
+
+    // Lets outside of any arena are bound here, and ignored.
+    Scope<Interval> no_scope;
+
+    // The values of all the enclosing lets. The bounds of allocations
+    // in an arena are in terms of the lets outside of it, such as the
+    // extents of the Funcs computed at root, so these are needed to
+    // tell whether one fits in the region of another.
+    Scope<Expr> let_values;
+
+    bool fits_in(const Expr &bound, const Arena::Region &hole) {
+        class ExpandLets : public IRMutator {
+            using IRMutator::visit;
+            const Scope<Expr> &lets;
+            Expr visit(const Variable *op) override {
+                if (const Expr *value = lets.find(op->name)) {
+                    return mutate(*value);
+                }
+                return op;
+            }
+
+        public:
+            ExpandLets(const Scope<Expr> &lets)
+                : lets(lets) {
+            }
+        } expand(let_values);
+        Expr size = hole.end - hole.begin;
+        return (can_prove(bound <= size) ||
+                can_prove(expand.mutate(bound) <= expand.mutate(size)));
+    }
+
+    template<typename LetOrLetStmt>
+    auto visit_let(const LetOrLetStmt *op) -> decltype(op->body) {
+        struct Frame {
+            const LetOrLetStmt *op;
+            ScopedBinding<Interval> binding;
+            ScopedBinding<Expr> value;
+            Frame(const LetOrLetStmt *op, Arena *arena, Scope<Interval> &no_scope, Scope<Expr> &let_values)
+                : op(op),
+                  binding(arena ? arena->scope : no_scope, op->name,
+                          arena ? bounds_of_expr_in_scope(op->value, arena->scope) : Interval()),
+                  value(let_values, op->name, op->value) {
+            }
+        };
+        std::vector<Frame> frames;
+        decltype(op->body) result;
+
+        do {
+            result = op->body;
+            frames.emplace_back(op, arena, no_scope, let_values);
+        } while ((op = result.template as<LetOrLetStmt>()));
+
+        result = mutate(result);
+
+        for (const auto &frame : reverse_view(frames)) {
+            result = LetOrLetStmt::make(frame.op->name, frame.op->value, result);
+        }
+
+        return result;
+    }
+
+    Stmt visit(const LetStmt *op) override {
+        return visit_let(op);
+    }
+
+    Expr visit(const Let *op) override {
+        return visit_let(op);
+    }
+
+    Stmt visit(const For *op) override {
+        if (is_gpu(op->for_type) ||
+            (op->device_api != DeviceAPI::Host && op->device_api != DeviceAPI::None)) {
+            ScopedValue<Arena *> no_arena(arena, nullptr);
+            ScopedValue<bool> in_device(in_device_code, true);
+            return IRMutator::visit(op);
+        } else if (op->for_type == ForType::Parallel) {
+            // Each task gets its own arenas.
+            ScopedValue<Arena *> no_arena(arena, nullptr);
+            return IRMutator::visit(op);
+        } else if (arena) {
+            Interval b = bounds_of_expr_in_scope(op->min + op->extent - 1, arena->scope);
+            b.include(bounds_of_expr_in_scope(op->min, arena->scope));
+            ScopedBinding<Interval> bind(arena->scope, op->name, b);
+            ScopedValue<int> deeper(control_depth, control_depth + 1);
+            return IRMutator::visit(op);
         } else {
+            ScopedValue<int> deeper(control_depth, control_depth + 1);
+            return IRMutator::visit(op);
+        }
+    }
+
+    Stmt visit(const IfThenElse *op) override {
+        ScopedValue<int> deeper(control_depth, control_depth + 1);
+        return IRMutator::visit(op);
+    }
+
+    Stmt visit(const Free *op) override {
+        if (arena) {
+            auto it = arena->regions.find(op->name);
+            if (it != arena->regions.end() && it->second.depth == control_depth) {
+                arena->holes.push_back(it->second);
+            }
+        }
+        return op;
+    }
+
+    Stmt visit(const Fork *op) override {
+        // The two sides of a fork run at the same time.
+        ScopedValue<Arena *> no_arena(arena, nullptr);
+        return IRMutator::visit(op);
+    }
+
+    Stmt visit(const Allocate *op) override {
+        const int64_t constant_size = Allocate::constant_allocation_size(op->extents, op->name);
+        if (in_device_code ||
+            op->new_expr.defined() ||
+            op->extents.empty() ||
+            (op->memory_type != MemoryType::Auto && op->memory_type != MemoryType::Heap) ||
+            (op->memory_type == MemoryType::Auto && constant_size > 0 &&
+             can_allocation_fit_on_stack(constant_size * op->type.bytes()))) {
+            // This isn't a heap allocation.
             return IRMutator::visit(op);
         }
+
+        Expr bytes = make_const(UInt(64), op->type.bytes());
+        for (const Expr &e : op->extents) {
+            bytes *= cast<uint64_t>(max(e, 0));
+        }
+        bytes += op->padding * op->type.bytes();
+        bytes = (bytes + (arena_alignment - 1)) / arena_alignment * arena_alignment;
+
+        if (arena) {
+            Expr bound = bounds_of_expr_in_scope(bytes, arena->scope).max;
+            if (bound.defined() && !expr_uses_vars(bound, arena->scope)) {
+                bound = simplify(bound);
+
+                // Reuse the first hole this fits in, or else put it
+                // after the allocations enclosing it.
+                Arena::Region region{offset, simplify(offset + bound), control_depth};
+                Expr body_offset = region.end;
+                bool in_hole = false;
+                for (size_t i = 0; i < arena->holes.size(); i++) {
+                    const Arena::Region &hole = arena->holes[i];
+                    if (fits_in(bound, hole)) {
+                        region.begin = hole.begin;
+                        region.end = simplify(hole.begin + bound);
+                        body_offset = offset;
+                        in_hole = true;
+                        arena->holes.erase(arena->holes.begin() + i);
+                        break;
+                    }
+                }
+                arena->size = Max::make(arena->size, region.end);
+
+                Expr base = reinterpret(UInt(64), Variable::make(Handle(), arena->name));
+                Expr ptr = reinterpret(Handle(), base + region.begin);
+                Stmt body;
+                {
+                    ScopedValue<Expr> bind(offset, body_offset);
+                    std::vector<Arena::Region> holes = arena->holes;
+                    arena->regions[op->name] = region;
+                    body = mutate(op->body);
+                    arena->regions.erase(op->name);
+                    // Holes made inside the scope may be above the
+                    // offset it ends at, so forget them...
+                    arena->holes = std::move(holes);
+                }
+                if (in_hole) {
+                    // ...but a region taken from a hole is free again.
+                    arena->holes.push_back(region);
+                }
+                return Allocate::make(op->name, op->type, op->memory_type, op->extents, op->condition,
+                                      body, ptr, "halide_arena_nop_free", op->padding);
+            }
+        }
+
+        // Start a new arena, with this allocation at the start of it.
+        Arena new_arena;
+        new_arena.name = op->name + ".arena";
+        new_arena.size = bytes;
+        new_arena.regions[op->name] = {make_zero(UInt(64)), bytes, control_depth};
+        Stmt body;
+        {
+            ScopedValue<Arena *> bind_arena(arena, &new_arena);
+            ScopedValue<Expr> bind_offset(offset, bytes);
+            body = mutate(op->body);
+        }
+        Expr size = simplify(new_arena.size);
+        Stmt s = Allocate::make(op->name, op->type, op->memory_type, op->extents, op->condition,
+                                body, Variable::make(Handle(), new_arena.name),
+                                "halide_arena_nop_free", op->padding);
+        // The arena is allocated as bytes, in rows of its alignment, so
+        // that codegen checks its total size for overflow.
+        Expr new_expr = Call::make(Handle(), "halide_arena_malloc", {size}, Call::Extern);
+        return Allocate::make(new_arena.name, UInt(8), MemoryType::Heap,
+                              {arena_alignment, cast<int32_t>(size / arena_alignment)},
+                              const_true(), s, new_expr, "halide_arena_free");
     }
 };
 
@@ -159,5 +425,9 @@ Stmt bound_small_allocations(const Stmt &s) {
     return BoundSmallAllocations().mutate(s);
 }
 
+Stmt place_allocations_in_arenas(const Stmt &s) {
+    return PlaceAllocationsInArenas().mutate(s);
+}
+
 }  // namespace Internal
 }  // namespace Halide
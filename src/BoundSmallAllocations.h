@@ -16,9 +16,22 @@ namespace Internal {
  * Use bounds analysis to attempt to bound the sizes of small
  * allocations. Inside GPU kernels this is necessary in order to
  * compile. On the CPU this is also useful, because it prevents malloc
- * calls for (provably) tiny allocations. */
+ * calls for (provably) tiny allocations. Allocations of dynamic size
+ * that are bounded by something that fits on the stack, and that
+ * aren't explicitly placed elsewhere, are moved to the stack, where
+ * they're allocated with the size they need at runtime. */
 Stmt bound_small_allocations(const Stmt &s);
 
+/** Use bounds analysis to find an upper bound on the total size of
+ * nested heap allocations, and carve them out of a single allocation
+ * made up front by halide_arena_malloc, instead of calling halide_malloc
+ * and halide_free for each. Allocations that don't overlap in lifetime
+ * share memory, including nested ones, if the first is freed early and
+ * the second provably fits in its place. Each parallel task gets its own arenas. Allocations with
+ * no upper bound in terms of things defined outside an arena get their
+ * own. Used for Target::ArenaAllocations. */
+Stmt place_allocations_in_arenas(const Stmt &s);
+
 }  // namespace Internal
 }  // namespace Halide
 
@@ -1,4 +1,5 @@
 #include <iostream>
+#include <unordered_map>
 #include <utility>
 
 #include "Bounds.h"
@@ -3071,8 +3072,8 @@ private:
     }
 };
 
-map<string, Box> boxes_touched(const Expr &e, Stmt s, bool consider_calls, bool consider_provides,
-                               const string &fn, const Scope<Interval> &scope, const FuncValueBounds &fb) {
+map<string, Box> boxes_touched_uncached(const Expr &e, Stmt s, bool consider_calls, bool consider_provides,
+                                        const string &fn, const Scope<Interval> &scope, const FuncValueBounds &fb) {
     if (!fn.empty() && s.defined()) {
         // Filter things down to the relevant sub-Stmts, so we don't spend a
         // long time reasoning about lets and ifs that don't surround an
@@ -3253,6 +3254,119 @@ map<string, Box> boxes_touched(const Expr &e, Stmt s, bool consider_calls, bool
     return calls.boxes;
 }
 
+thread_local ScopedBoxesCache::Contents *active_boxes_cache = nullptr;
+
+// The intervals of all the names visible in a scope, including those of
+// its containing scopes, in name order.
+vector<pair<string, Interval>> flatten_scope(const Scope<Interval> &scope) {
+    map<string, Interval> visible;
+    for (const Scope<Interval> *s = &scope; s; s = s->get_containing_scope()) {
+        for (auto it = s->cbegin(); it != s->cend(); ++it) {
+            visible.emplace(it.name(), it.value());
+        }
+    }
+    return vector<pair<string, Interval>>(visible.begin(), visible.end());
+}
+
+bool same_interval(const Interval &a, const Interval &b) {
+    auto same = [](const Expr &x, const Expr &y) {
+        return x.same_as(y) || (x.defined() && y.defined() && equal(x, y));
+    };
+    return same(a.min, b.min) && same(a.max, b.max);
+}
+
+}  // namespace
+
+struct ScopedBoxesCache::Contents {
+    struct Entry {
+        // The Expr or Stmt queried. Holding a reference keeps the node
+        // alive, so its address can't be reused by another one.
+        IRHandle node;
+        bool consider_calls, consider_provides;
+        string fn;
+        const FuncValueBounds *fb;
+        vector<pair<string, Interval>> scope;
+        map<string, Box> result;
+    };
+
+    // Bucketed by a hash of everything but the intervals of the scope.
+    std::unordered_map<uint64_t, vector<Entry>> entries;
+    size_t size = 0;
+    uint64_t hits = 0, misses = 0;
+    Contents *enclosing = nullptr;
+
+    // Bound the memory a single lowering can hold onto.
+    static constexpr size_t max_size = 1 << 16;
+};
+
+ScopedBoxesCache::ScopedBoxesCache()
+    : contents(std::make_unique<Contents>()) {
+    contents->enclosing = active_boxes_cache;
+    active_boxes_cache = contents.get();
+}
+
+ScopedBoxesCache::~ScopedBoxesCache() {
+    internal_assert(active_boxes_cache == contents.get())
+        << "ScopedBoxesCache objects must be destroyed in the reverse order of creation\n";
+    active_boxes_cache = contents->enclosing;
+}
+
+uint64_t ScopedBoxesCache::hits() const {
+    return contents->hits;
+}
+
+uint64_t ScopedBoxesCache::misses() const {
+    return contents->misses;
+}
+
+namespace {
+
+map<string, Box> boxes_touched(const Expr &e, Stmt s, bool consider_calls, bool consider_provides,
+                               const string &fn, const Scope<Interval> &scope, const FuncValueBounds &fb) {
+    ScopedBoxesCache::Contents *cache = active_boxes_cache;
+    if (!cache) {
+        return boxes_touched_uncached(e, std::move(s), consider_calls, consider_provides, fn, scope, fb);
+    }
+
+    const IRHandle node = e.defined() ? IRHandle(e) : IRHandle(s);
+    vector<pair<string, Interval>> flat_scope = flatten_scope(scope);
+
+    uint64_t key = (uint64_t)(uintptr_t)node.get();
+    key = key * 31 + (uint64_t)(uintptr_t)&fb;
+    key = key * 31 + std::hash<string>()(fn);
+    key = key * 4 + (consider_calls ? 2 : 0) + (consider_provides ? 1 : 0);
+    for (const auto &p : flat_scope) {
+        key = key * 31 + std::hash<string>()(p.first);
+    }
+
+    vector<ScopedBoxesCache::Contents::Entry> &bucket = cache->entries[key];
+    for (const auto &entry : bucket) {
+        if (entry.node.same_as(node) &&
+            entry.consider_calls == consider_calls &&
+            entry.consider_provides == consider_provides &&
+            entry.fn == fn &&
+            entry.fb == &fb &&
+            entry.scope.size() == flat_scope.size() &&
+            std::equal(entry.scope.begin(), entry.scope.end(), flat_scope.begin(),
+                       [](const auto &a, const auto &b) {
+                           return a.first == b.first && same_interval(a.second, b.second);
+                       })) {
+            cache->hits++;
+            return entry.result;
+        }
+    }
+
+    map<string, Box> result = boxes_touched_uncached(e, std::move(s), consider_calls, consider_provides, fn, scope, fb);
+    cache->misses++;
+    if (cache->size >= ScopedBoxesCache::Contents::max_size) {
+        cache->entries.clear();
+        cache->size = 0;
+    }
+    cache->entries[key].push_back({node, consider_calls, consider_provides, fn, &fb, std::move(flat_scope), result});
+    cache->size++;
+    return result;
+}
+
 Box box_touched(const Expr &e, Stmt s, bool consider_calls, bool consider_provides,
                 const string &fn, const Scope<Interval> &scope, const FuncValueBounds &fb) {
     map<string, Box> boxes = boxes_touched(e, std::move(s), consider_calls, consider_provides, fn, scope, fb);
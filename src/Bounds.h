@@ -6,6 +6,8 @@
  * and the regions of a function read or written by a statement.
  */
 
+#include <memory>
+
 #include "Interval.h"
 #include "Scope.h"
 
@@ -168,6 +170,36 @@ Box box_touched(Stmt s, const std::string &fn,
                 const FuncValueBounds &func_bounds = empty_func_value_bounds());
 // @}
 
+/** While an object of this type is alive, the box queries above made on
+ * the same thread are memoized. Results are keyed on the identity of the
+ * Expr or Stmt and of the FuncValueBounds, the function name, and the
+ * intervals visible in the scope (compared structurally, as scopes are
+ * usually rebuilt for each query). The FuncValueBounds passed must not
+ * change while it is alive. Scopes may nest; the innermost one is used.
+ * lower() opens one for the passes from bounds inference through storage
+ * folding. */
+class ScopedBoxesCache {
+public:
+    ScopedBoxesCache();
+    ~ScopedBoxesCache();
+
+    ScopedBoxesCache(const ScopedBoxesCache &) = delete;
+    ScopedBoxesCache &operator=(const ScopedBoxesCache &) = delete;
+    ScopedBoxesCache(ScopedBoxesCache &&) = delete;
+    ScopedBoxesCache &operator=(ScopedBoxesCache &&) = delete;
+
+    /** The number of box queries answered from, or added to, the cache. */
+    // @{
+    uint64_t hits() const;
+    uint64_t misses() const;
+    // @}
+
+    struct Contents;
+
+private:
+    std::unique_ptr<Contents> contents;
+};
+
 /** Compute the maximum and minimum possible value for each function
  * in an environment. */
 FuncValueBounds compute_function_value_bounds(const std::vector<std::string> &order,
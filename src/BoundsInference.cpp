@@ -188,12 +188,16 @@ bool is_fused_with_others(const vector<vector<Function>> &fused_groups,
     for (const auto &pair : fused_pairs_in_groups[index]) {
         if (((pair.func_1 == consumer_name) && ((int)pair.stage_1 == consumer_stage)) ||
             ((pair.func_2 == consumer_name) && ((int)pair.stage_2 == consumer_stage))) {
-            const auto &iter = std::find_if(dims.begin(), dims.end(),
-                                            [&pair](const Dim &d) { return var_name_match(d.var, pair.var_name); });
-            if (iter == dims.end()) {
+            // The var of the pair is one of the parent's dims, which may
+            // be fused with a dim of another name of the child.
+            const auto &parent = std::find_if(fused_groups[index].begin(), fused_groups[index].end(),
+                                              [&pair](const Function &f) { return f.name() == pair.func_1; });
+            internal_assert(parent != fused_groups[index].end());
+            const vector<Dim> &parent_dims = (pair.stage_1 == 0) ? parent->definition().schedule().dims() : parent->update((int)pair.stage_1 - 1).schedule().dims();
+            size_t idx = find_fused_dim(dims, parent_dims, pair.var_name);
+            if (idx == dims.size()) {
                 continue;
             }
-            size_t idx = iter - dims.begin();
             if (var_index >= idx) {
                 return true;
             }
@@ -1378,7 +1382,8 @@ Stmt bounds_inference(Stmt s,
     Expr marker = Call::make(Int(32), Call::skip_stages_marker, {}, Call::Intrinsic);
     s = Block::make(Evaluate::make(marker), s);
 
-    if (target.has_feature(Target::Profile) || target.has_feature(Target::ProfileByTimer)) {
+    if (target.has_feature(Target::Profile) || target.has_feature(Target::ProfileByTimer) ||
+        target.has_feature(Target::ProfileLight) || target.has_feature(Target::TrackAllocations)) {
         // Add a note in the IR for what profiling should cover, so that it doesn't
         // include bounds queries as pipeline executions.
         marker = Call::make(Int(32), Call::profiling_enable_instance_marker, {}, Call::Intrinsic);
@@ -1,4 +1,5 @@
 #include <map>
+#include <unordered_map>
 
 #include "CSE.h"
 #include "IREquality.h"
@@ -68,25 +69,100 @@ bool should_extract(const Expr &e, bool lift_all) {
     return true;
 }
 
+// Hash and equality functors for keying hash tables on the identity of
+// an Expr node.
+struct ExprPtrHash {
+    size_t operator()(const Expr &e) const {
+        return std::hash<const IRNode *>()(e.get());
+    }
+};
+
+struct ExprPtrEqual {
+    bool operator()(const Expr &a, const Expr &b) const {
+        return a.same_as(b);
+    }
+};
+
+uint64_t hash_combine(uint64_t h, uint64_t v) {
+    return (h ^ v) * 0x100000001b3ULL;
+}
+
+// A hash of an Expr whose children have already been numbered, from
+// its own fields and the numbers of its children. Two Exprs with equal
+// fields and the same numbered children are equal, so together with
+// the children this distinguishes everything that equal() does.
+uint64_t shallow_hash(const Expr &e, const vector<int> &children) {
+    uint64_t h = 0xcbf29ce484222325ULL;
+    h = hash_combine(h, (uint64_t)e->node_type);
+    h = hash_combine(h, ((uint64_t)e.type().code() << 48) |
+                            ((uint64_t)e.type().bits() << 32) |
+                            (uint64_t)e.type().lanes());
+    for (int c : children) {
+        h = hash_combine(h, (uint64_t)c);
+    }
+    std::hash<string> hash_string;
+    switch (e->node_type) {
+    case IRNodeType::IntImm:
+        h = hash_combine(h, (uint64_t)e.as<IntImm>()->value);
+        break;
+    case IRNodeType::UIntImm:
+        h = hash_combine(h, e.as<UIntImm>()->value);
+        break;
+    case IRNodeType::FloatImm:
+        h = hash_combine(h, reinterpret_bits<uint64_t>(e.as<FloatImm>()->value));
+        break;
+    case IRNodeType::StringImm:
+        h = hash_combine(h, hash_string(e.as<StringImm>()->value));
+        break;
+    case IRNodeType::Variable:
+        h = hash_combine(h, hash_string(e.as<Variable>()->name));
+        break;
+    case IRNodeType::Call:
+        h = hash_combine(h, hash_string(e.as<Call>()->name));
+        break;
+    case IRNodeType::Load:
+        h = hash_combine(h, hash_string(e.as<Load>()->name));
+        break;
+    case IRNodeType::Shuffle:
+        for (int i : e.as<Shuffle>()->indices) {
+            h = hash_combine(h, (uint64_t)i);
+        }
+        break;
+    case IRNodeType::VectorReduce:
+        h = hash_combine(h, (uint64_t)e.as<VectorReduce>()->op);
+        break;
+    default:
+        break;
+    }
+    return h;
+}
+
 // A global-value-numbering of expressions. Returns canonical form of
 // the Expr and writes out a global value numbering as a side-effect.
+// The numbering is built by hash-consing: each Expr is rebuilt from
+// the canonical forms of its children, and then looked up in a hash
+// table keyed on its own fields and the numbers of those children, so
+// each distinct node costs a constant amount of work, rather than a
+// walk down a search tree of deep comparisons.
 class GVN : public IRMutator {
 public:
     struct Entry {
         Expr expr;
         int use_count = 0;
-        // All consumer Exprs for which this is the last child Expr.
-        map<Expr, int, IRGraphDeepCompare> uses;
         Entry(const Expr &e)
             : expr(e) {
         }
     };
     vector<std::unique_ptr<Entry>> entries;
 
-    map<Expr, int, ExprCompare> shallow_numbering, output_numbering;
-    map<Expr, int, IRGraphDeepCompare> leaves;
+    std::unordered_map<Expr, int, ExprPtrHash, ExprPtrEqual> shallow_numbering, output_numbering;
+
+    // The canonical Exprs, by shallow hash.
+    std::unordered_multimap<uint64_t, int> canonical;
 
-    int number = 0;
+    // Where to record the number of each child of the Expr being
+    // rebuilt, in order.
+    vector<int> *children = nullptr;
 
     Stmt mutate(const Stmt &s) override {
         internal_error << "Can't call GVN on a Stmt: " << s << "\n";
@@ -95,41 +171,49 @@ public:
 
     Expr mutate(const Expr &e) override {
         // Early out if we've already seen this exact Expr.
-        {
-            auto iter = shallow_numbering.find(e);
-            if (iter != shallow_numbering.end()) {
-                number = iter->second;
-                return entries[number]->expr;
+        int number = -1;
+        if (auto iter = shallow_numbering.find(e); iter != shallow_numbering.end()) {
+            number = iter->second;
+            if (children) {
+                children->push_back(number);
             }
+            return entries[number]->expr;
         }
 
         // We haven't seen this exact Expr before. Rebuild it using
         // things already in the numbering.
-        number = -1;
+        vector<int> *parent_children = children;
+        vector<int> my_children;
+        children = &my_children;
         Expr new_e = IRMutator::mutate(e);
-
-        // 'number' is now set to the numbering for the last child of
-        // this Expr (or -1 if there are no children). Next we see if
-        // that child has an identical parent to this one.
-
-        auto &use_map = number == -1 ? leaves : entries[number]->uses;
-        auto p = use_map.emplace(new_e, (int)entries.size());
-        auto iter = p.first;
-        bool novel = p.second;
-        if (novel) {
+        children = parent_children;
+
+        // The children of new_e are all canonical, so it's equal to
+        // an existing entry only if that entry has the same fields and
+        // the very same children, which makes the comparison shallow.
+        const uint64_t h = shallow_hash(new_e, my_children);
+        auto range = canonical.equal_range(h);
+        for (auto it = range.first; it != range.second; ++it) {
+            if (equal(entries[it->second]->expr, new_e)) {
+                number = it->second;
+                break;
+            }
+        }
+        if (number == -1) {
             // This is a never-before-seen Expr
             number = (int)entries.size();
-            iter->second = number;
             entries.emplace_back(new Entry(new_e));
+            canonical.emplace(h, number);
         } else {
-            // This child already has a syntactically-equal parent
-            number = iter->second;
             new_e = entries[number]->expr;
         }
 
         // Memorize this numbering for the old and new forms of this Expr
         shallow_numbering[e] = number;
         output_numbering[new_e] = number;
+        if (children) {
+            children->push_back(number);
+        }
         return new_e;
     }
 };
@@ -1,3 +1,4 @@
+#include <limits>
 #include <map>
 
 #include "Argument.h"
@@ -30,8 +31,21 @@ struct CallableContents {
     std::vector<Callable::QuickCallCheckInfo> quick_call_check_info;
 
     // Encoded values for complete runtime type checking, used
-    // only for make_std_function. Lazily created.
+    // only for make_std_function and bind. Lazily created.
     std::vector<Callable::FullCallCheckInfo> full_call_check_info;
+
+    // The argv entry point of the jitted code, looked up once so that
+    // calls can go straight to it, or null if it must be called via
+    // jit_cache.call_jit_code() (as for WebAssembly).
+    int (*argv_function)(const void *const *) = nullptr;
+
+    // halide_do_batch_argv in the runtime the jitted code uses, or null
+    // if batches must be called one item at a time.
+    int (*batch_function)(int (*)(void **), int, int, void **, bool) = nullptr;
+
+    // Whether each call must report and reset profiling or allocation
+    // tracking state.
+    bool needs_finish_profiling = false;
 };
 
 namespace Internal {
@@ -73,6 +87,17 @@ Callable::Callable(const std::string &name,
     }
 
     // Don't create full_call_check_info yet.
+
+    const Target &t = contents->jit_cache.jit_target;
+    if (t.arch != Target::WebAssembly && contents->jit_cache.jit_module.compiled()) {
+        contents->argv_function = contents->jit_cache.jit_module.argv_function();
+        contents->batch_function =
+            reinterpret_bits<int (*)(int (*)(void **), int, int, void **, bool)>(
+                contents->jit_cache.jit_module.find_symbol_by_name("halide_do_batch_argv").address);
+    }
+    contents->needs_finish_profiling = t.has_feature(Target::Profile) ||
+                                       t.has_feature(Target::ProfileByTimer) ||
+                                       t.has_feature(Target::TrackAllocations);
 }
 
 const std::vector<Argument> &Callable::arguments() const {
@@ -177,7 +202,7 @@ Callable::FailureFn Callable::check_fcci(size_t argc, const FullCallCheckInfo *a
     return failure_fn;
 }
 
-// Entry point used from the std::function<> variant; we can skip the check_qcci() stuff
+// Entry point used from the std::function<> and Bound variants; we can skip the check_qcci() stuff
 // since we verified the signature when we created the std::function, so incorrect types or counts
 // should be impossible.
 /*static*/ int Callable::call_argv_fast(size_t argc, const void *const *argv) const {
@@ -192,10 +217,46 @@ Callable::FailureFn Callable::check_fcci(size_t argc, const FullCallCheckInfo *a
 
     JITFuncCallContext jit_call_context(context, contents->saved_jit_handlers);
 
-    int exit_status = contents->jit_cache.call_jit_code(argv);
+    int exit_status = contents->argv_function ?
+                          contents->argv_function(argv) :
+                          contents->jit_cache.call_jit_code(argv);
 
     // If we're profiling, report runtimes and reset profiler stats.
-    contents->jit_cache.finish_profiling(context);
+    if (contents->needs_finish_profiling) {
+        contents->jit_cache.finish_profiling(context);
+    }
+
+    jit_call_context.finalize(exit_status);
+
+    return exit_status;
+}
+
+int Callable::call_batch_argv_fast(size_t batch_size, size_t argc, const void *const *argvs) const {
+    assert(contents->jit_cache.arguments.size() == argc);
+    user_assert(batch_size <= (size_t)std::numeric_limits<int>::max())
+        << "Batch of " << batch_size << " calls to '" << contents->name << "' is too large.\n";
+    if (batch_size == 0) {
+        return halide_error_code_success;
+    }
+
+    JITUserContext *context = *(JITUserContext **)const_cast<void *>(argvs[0]);
+    assert(context != nullptr);
+
+    JITFuncCallContext jit_call_context(context, contents->saved_jit_handlers);
+
+    int exit_status = 0;
+    if (contents->argv_function && contents->batch_function) {
+        exit_status = contents->batch_function((int (*)(void **))contents->argv_function,
+                                               (int)batch_size, (int)argc, const_cast<void **>(argvs), true);
+    } else {
+        for (size_t i = 0; i < batch_size && exit_status == 0; i++) {
+            exit_status = contents->jit_cache.call_jit_code(argvs + i * argc);
+        }
+    }
+
+    if (contents->needs_finish_profiling) {
+        contents->jit_cache.finish_profiling(context);
+    }
 
     jit_call_context.finalize(exit_status);
 
@@ -6,8 +6,11 @@
  * Defines the front-end class representing a jitted, callable Halide pipeline.
  */
 
+#include <algorithm>
 #include <array>
 #include <map>
+#include <tuple>
+#include <vector>
 
 #include "Buffer.h"
 #include "IntrusivePtr.h"
@@ -386,6 +389,31 @@ public:
         }
     }
 
+    /** A Callable whose signature has been checked once, ahead of time,
+     * against a list of C++ argument types. Calling it packs the arguments
+     * directly into an argv array on the stack and calls the jitted code,
+     * with no per-call type checks or heap allocations. Obtain one with
+     * Callable::bind(). */
+    template<typename... Args>
+    class Bound;
+
+    /** Check the signature of this Callable against the given argument
+     * types (not including the JITUserContext), as for make_std_function(),
+     * and return an object that calls it with arguments of those types
+     * with as little overhead as possible. Useful for small pipelines that
+     * are called very many times, e.g.:
+     \code
+     auto f = callable.bind<Buffer<uint8_t, 3>, float, Buffer<float, 2>>();
+     for (auto &tile : tiles) {
+         f(tile.input, gain, tile.output);
+     }
+     \endcode
+     */
+    template<typename... Args>
+    Bound<Args...> bind() const {
+        return Bound<Args...>(*this);
+    }
+
     /** Unsafe low-overhead way of invoking the Callable.
      *
      * This function relies on the same calling convention as the argv-based
@@ -403,6 +431,78 @@ public:
      *
      */
     int call_argv_fast(size_t argc, const void *const *argv) const;
+
+    /** Unsafe low-overhead way of invoking the Callable on a batch of
+     * arguments. argvs holds batch_size groups of argc arguments, each as
+     * for call_argv_fast(); they must all have the same JITUserContext.
+     * The calls are made as the tasks of a single parallel loop on the
+     * Halide thread pool, and the context's handlers are set up once for
+     * all of them. Returns zero if all the calls succeed, or the result of
+     * one that failed otherwise. */
+    int call_batch_argv_fast(size_t batch_size, size_t argc, const void *const *argvs) const;
+};
+
+template<typename... Args>
+class Callable::Bound {
+    friend class Callable;
+
+    Callable callable;
+    // Non-null if the signature doesn't match, in which case every
+    // call fails with the error it reports.
+    FailureFn failure_fn;
+
+    explicit Bound(const Callable &c)
+        : callable(c) {
+        constexpr auto actual_arg_types = make_fcci_array<JITUserContext *, Args...>();
+        failure_fn = callable.check_fcci(actual_arg_types.size(), actual_arg_types.data());
+    }
+
+public:
+    Bound() = default;
+
+    HALIDE_FUNCTION_ATTRS int
+    operator()(JITUserContext *context, const Args &...args) const {
+        if (failure_fn) {
+            return failure_fn(context);
+        }
+        constexpr size_t count = 1 + sizeof...(Args);
+        ArgvStorage<count> argv(context, args...);
+        return callable.call_argv_fast(count, &argv.argv[0]);
+    }
+
+    HALIDE_FUNCTION_ATTRS int
+    operator()(const Args &...args) const {
+        JITUserContext empty;
+        return (*this)(&empty, args...);
+    }
+
+    /** Make one call for each tuple of arguments in items, distributed
+     * across the Halide thread pool, with all of them sharing the given
+     * JITUserContext. This is cheaper than calling once per item when
+     * the pipeline is small, as it sets up the call and wakes the thread
+     * pool once. The calls run concurrently, so they must not write to
+     * the same buffers. */
+    int call_batch(JITUserContext *context, const std::vector<std::tuple<Args...>> &items) const {
+        if (failure_fn) {
+            return failure_fn(context);
+        }
+        constexpr size_t count = 1 + sizeof...(Args);
+        // The argv arrays point into the storage, which mustn't move once
+        // it's filled.
+        std::vector<ArgvStorage<count>> storage;
+        storage.reserve(items.size());
+        std::vector<const void *> argvs(items.size() * count);
+        for (size_t i = 0; i < items.size(); i++) {
+            std::apply([&](const Args &...args) { storage.emplace_back(context, args...); }, items[i]);
+            std::copy(storage[i].argv, storage[i].argv + count, argvs.begin() + i * count);
+        }
+        return callable.call_batch_argv_fast(items.size(), count, argvs.data());
+    }
+
+    int call_batch(const std::vector<std::tuple<Args...>> &items) const {
+        JITUserContext empty;
+        return call_batch(&empty, items);
+    }
 };
 
 }  // namespace Halide
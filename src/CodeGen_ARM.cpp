@@ -13,6 +13,7 @@
 #include "IROperator.h"
 #include "IRPrinter.h"
 #include "LLVM_Headers.h"
+#include "OptimizeShuffles.h"
 #include "Simplify.h"
 #include "Substitute.h"
 #include "Util.h"
@@ -164,6 +165,9 @@ protected:
     void begin_func(LinkageType linkage, const std::string &simple_name,
                     const std::string &extern_name, const std::vector<LoweredArgument> &args) override;
 
+    /** Gather bytes from a table of up to 256 entries using tbl/tbx. */
+    llvm::Value *table_lookup(llvm::Value *lut, llvm::Value *idx, int lut_size);
+
     /** Nodes for which we want to emit specific ARM vector intrinsics */
     // @{
     void visit(const Cast *) override;
@@ -1145,9 +1149,53 @@ void CodeGen_ARM::compile_func(const LoweredFunc &f,
     // and a - (b << c) into umlsl/smlsl.
     func.body = distribute_shifts(func.body, /* multiply_adds */ true);
 
+    if (target.bits == 64 && !target.has_feature(Target::SVE2)) {
+        // Byte lookups into tables of up to 256 entries (e.g. gamma curves
+        // indexed by a uint8) are a few tbl/tbx instructions instead of a
+        // scalarized gather.
+        func.body = optimize_shuffles(func.body, 1, [](const Type &t) {
+            return t.bits() == 8 && t.is_int_or_uint() ? 256 : 0;
+        });
+    }
+
     CodeGen_Posix::compile_func(func, simple_name, extern_name);
 }
 
+Value *CodeGen_ARM::table_lookup(Value *lut, Value *idx, int lut_size) {
+    const int lanes = get_vector_num_elements(idx->getType());
+    const int chunk = lanes <= 8 ? 8 : 16;
+    llvm::Type *chunk_t = get_vector_type(i8_t, chunk);
+
+    // tbl takes up to four 16-byte table registers. Larger tables are
+    // handled 64 bytes at a time with tbx, which leaves lanes whose index
+    // is out of range alone. Indices below the current window wrap around
+    // to at least 64, so they are out of range too.
+    vector<Value *> regs;
+    for (int i = 0; i < lut_size; i += 16) {
+        regs.push_back(slice_vector(lut, i, 16));
+    }
+
+    vector<Value *> results;
+    for (int start = 0; start < lanes; start += chunk) {
+        Value *i = slice_vector(idx, start, chunk);
+        Value *result = nullptr;
+        for (int r = 0; r < (int)regs.size(); r += 4) {
+            const int n = std::min(4, (int)regs.size() - r);
+            vector<Value *> args;
+            if (result) {
+                args.push_back(result);
+            }
+            args.insert(args.end(), regs.begin() + r, regs.begin() + r + n);
+            args.push_back(r == 0 ? i : builder->CreateSub(i, ConstantInt::get(chunk_t, r * 16)));
+            string name = (result ? "llvm.aarch64.neon.tbx" : "llvm.aarch64.neon.tbl") +
+                          std::to_string(n) + (chunk == 8 ? ".v8i8" : ".v16i8");
+            result = call_intrin(chunk_t, chunk, name, args);
+        }
+        results.push_back(result);
+    }
+    return slice_vector(concat_vectors(results), 0, lanes);
+}
+
 void CodeGen_ARM::begin_func(LinkageType linkage, const std::string &simple_name,
                              const std::string &extern_name, const std::vector<LoweredArgument> &args) {
     CodeGen_Posix::begin_func(linkage, simple_name, extern_name, args);
@@ -1978,6 +2026,16 @@ void CodeGen_ARM::visit(const Call *op) {
         return;
     }
 
+    if (op->is_intrinsic(Call::dynamic_shuffle)) {
+        internal_assert(op->args.size() == 4);
+        auto max_index = as_const_int(op->args[3]);
+        internal_assert(max_index);
+        Value *lut = codegen(op->args[0]);
+        Value *idx = codegen(op->args[1]);
+        value = table_lookup(lut, idx, *max_index + 1);
+        return;
+    }
+
     if (op->is_intrinsic(Call::rounding_shift_right)) {
         // LLVM wants these as rounding_shift_left with a negative b instead.
         Expr b = op->args[1];
@@ -2543,6 +2601,11 @@ string CodeGen_ARM::mattrs() const {
         } else if (target.has_feature(Target::SVE)) {
             attrs.emplace_back("+sve");
         }
+        if (target.has_feature(Target::ARMSME)) {
+            // Only makes the instructions available to LLVM. Halide doesn't
+            // yet emit streaming-mode functions, so nothing uses the ZA tiles.
+            attrs.emplace_back("+sme");
+        }
         if (target.os == Target::IOS || target.os == Target::OSX) {
             attrs.emplace_back("+reserve-x18");
         }
@@ -620,6 +620,22 @@ void CodeGen_C::emit_argv_wrapper(const std::string &function_name,
     stream << "}";
 }
 
+void CodeGen_C::emit_batch_wrapper(const std::string &function_name,
+                                   const std::vector<LoweredArgument> &args) {
+    if (is_header_or_extern_decl()) {
+        stream << "\nHALIDE_FUNCTION_ATTRS\nint " << function_name << "_batch(int batch_size, void **argvs);\n";
+        return;
+    }
+
+    const bool has_user_context = !args.empty() && args[0].name == "__user_context";
+    stream << "\nHALIDE_FUNCTION_ATTRS\nint " << function_name << "_batch(int batch_size, void **argvs) {\n";
+    indent += 1;
+    stream << get_indent() << "return halide_do_batch_argv(" << function_name << "_argv, batch_size, "
+           << args.size() << ", argvs, " << (has_user_context ? "true" : "false") << ");\n";
+    indent -= 1;
+    stream << "}";
+}
+
 void CodeGen_C::emit_metadata_getter(const std::string &function_name,
                                      const std::vector<LoweredArgument> &args,
                                      const MetadataNameMap &metadata_name_map) {
@@ -651,6 +667,13 @@ void CodeGen_C::emit_metadata_getter(const std::string &function_name,
         "halide_type_bfloat",
     };
 
+    static const char *const layout_names[] = {
+        "halide_buffer_layout_unknown",
+        "halide_buffer_layout_planar",
+        "halide_buffer_layout_interleaved",
+        "halide_buffer_layout_other",
+    };
+
     std::set<int64_t> constant_int64_in_use;
     const auto emit_constant_int64 = [this, &constant_int64_in_use](Expr e) -> std::string {
         if (!e.defined()) {
@@ -803,6 +826,11 @@ void CodeGen_C::emit_metadata_getter(const std::string &function_name,
         stream << get_indent() << "scalar_max_" << legalized_name << ",\n";
         stream << get_indent() << "scalar_estimate_" << legalized_name << ",\n";
         stream << get_indent() << "buffer_estimates_" << legalized_name << ",\n";
+        stream << get_indent() << arg.host_alignment << ",\n";
+        internal_assert(arg.layout < sizeof(layout_names) / sizeof(layout_names[0]));
+        stream << get_indent() << layout_names[arg.layout] << ",\n";
+        stream << get_indent() << arg.padding << ",\n";
+        stream << get_indent() << "0,\n";
         stream << get_indent() << "},\n";
         indent -= 1;
     }
@@ -1112,8 +1140,9 @@ void CodeGen_C::compile(const LoweredFunc &f, const MetadataNameMap &metadata_na
         }
 
         if (f.linkage == LinkageType::ExternalPlusMetadata) {
-            // Emit the metadata.
+            // Emit the metadata, and the batched version.
             emit_metadata_getter(simple_name, args, metadata_name_map);
+            emit_batch_wrapper(simple_name, args);
         }
     } else {
         if (f.linkage != LinkageType::Internal) {
@@ -1839,6 +1868,24 @@ void CodeGen_C::visit(const Call *op) {
         internal_assert(op->args.size() == 1);
         string arg0 = print_expr(op->args[0]);
         rhs << "(" << arg0 << ")";
+    } else if (op->is_intrinsic(Call::nontemporal_store)) {
+        // The C backend emits regular stores, which need no fence.
+        internal_assert(op->args.size() == 1);
+        string arg0 = print_expr(op->args[0]);
+        rhs << "(" << arg0 << ")";
+    } else if (op->is_intrinsic(Call::store_fence)) {
+        rhs << "0";
+    } else if (const char *vector_op = vector_intrinsic_op(op)) {
+        // The vector ops implement these with target intrinsics
+        // where the compiler has them.
+        internal_assert(op->args.size() == 2);
+        string a0 = print_expr(op->args[0]);
+        string a1 = print_expr(op->is_intrinsic(Call::rounding_shift_right) ? cast(op->type, op->args[1]) : op->args[1]);
+        rhs << print_type(op->type) << "_ops::" << vector_op;
+        if (op->is_intrinsic(Call::widening_mul)) {
+            rhs << "<" << print_type(op->args[0].type().element_of()) << ">";
+        }
+        rhs << "(" << a0 << ", " << a1 << ")";
     } else if (op->is_intrinsic()) {
         Expr lowered = lower_intrinsic(op);
         if (lowered.defined()) {
@@ -1865,6 +1912,44 @@ void CodeGen_C::visit(const Call *op) {
     }
 }
 
+const char *CodeGen_C::vector_intrinsic_op(const Call *op) const {
+    const Type &t = op->type;
+    if (!using_vector_typedefs || !t.is_vector() || !t.is_int_or_uint() || t.bits() < 8 || op->args.size() != 2) {
+        return nullptr;
+    }
+    if (op->is_intrinsic(Call::widening_mul)) {
+        const Type &arg_t = op->args[0].type();
+        return (arg_t == op->args[1].type() && arg_t.bits() <= 32 && t == arg_t.widen()) ? "widening_mul" : nullptr;
+    }
+    if (t.bits() > 32 || op->args[0].type() != t) {
+        return nullptr;
+    }
+    if (op->is_intrinsic(Call::rounding_shift_right)) {
+        // Only constant shifts that neither round away the whole value
+        // nor shift left, of either signedness.
+        const Broadcast *shift = op->args[1].as<Broadcast>();
+        std::optional<int64_t> amount;
+        if (shift) {
+            if (auto s = as_const_int(shift->value)) {
+                amount = *s;
+            } else if (auto u = as_const_uint(shift->value)) {
+                amount = (int64_t)std::min<uint64_t>(*u, t.bits());
+            }
+        }
+        return (amount && *amount >= 1 && *amount < t.bits()) ? "rounding_shift_right" : nullptr;
+    }
+    if (op->args[1].type() != t) {
+        return nullptr;
+    }
+    for (Call::IntrinsicOp i : {Call::saturating_add, Call::saturating_sub, Call::halving_add,
+                                Call::rounding_halving_add, Call::halving_sub}) {
+        if (op->is_intrinsic(i)) {
+            return Call::get_intrinsic_name(i);
+        }
+    }
+    return nullptr;
+}
+
 string CodeGen_C::print_scalarized_expr(const Expr &e) {
     Type t = e.type();
     internal_assert(t.is_vector());
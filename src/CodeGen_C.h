@@ -140,6 +140,12 @@ protected:
     /** Convert a vector Expr into a series of scalar Exprs, then reassemble into vector of original type.  */
     std::string print_scalarized_expr(const Expr &e);
 
+    /** The name of the method of the vector ops that implements a
+     * vector intrinsic such as saturating_add directly (with target
+     * intrinsics, when the compiler has them), or nullptr if the
+     * intrinsic should be lowered instead. */
+    const char *vector_intrinsic_op(const Call *op) const;
+
     /** Emit an SSA-style assignment, and set id to the freshly generated name. Return id. */
     virtual std::string print_assignment(Type t, const std::string &rhs);
 
@@ -294,6 +300,8 @@ protected:
 
     void emit_argv_wrapper(const std::string &function_name,
                            const std::vector<LoweredArgument> &args);
+    void emit_batch_wrapper(const std::string &function_name,
+                            const std::vector<LoweredArgument> &args);
     void emit_metadata_getter(const std::string &function_name,
                               const std::vector<LoweredArgument> &args,
                               const MetadataNameMap &metadata_name_map);
@@ -12,6 +12,7 @@
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
+#include <limits>
 #include <type_traits>
 
 extern "C" {
@@ -6,8 +6,94 @@
 #define __has_builtin(x) 0
 #endif
 
+// NativeVectors use target intrinsics for the saturating, halving and
+// widening arithmetic and rounding shifts that FindIntrinsics finds,
+// where they exist. Define HALIDE_CPP_NO_TARGET_INTRINSICS to use
+// portable code instead.
+#if !defined(HALIDE_CPP_NO_TARGET_INTRINSICS) && !defined(__EMSCRIPTEN__) && \
+    (__has_attribute(ext_vector_type) || __has_attribute(vector_size))
+#if defined(__ARM_NEON)
+// arm_neon.h uses the same names for its vector types as our vector
+// typedefs (e.g. uint8x16_t), so keep it in a namespace of its own.
+namespace halide_cpp_neon {
+#include <arm_neon.h>
+}  // namespace halide_cpp_neon
+#define HALIDE_CPP_USE_NEON 1
+#elif defined(__SSE2__)
+#include <immintrin.h>
+#define HALIDE_CPP_USE_SSE2 1
+#endif
+#endif
+
 namespace {
 
+// Scalar versions of the intrinsics that the vector ops below implement.
+template<typename T, bool is_unsigned = std::is_unsigned<T>::value>
+struct HalideCppSaturatingOps {
+    static T add(const T a, const T b) {
+        const T r = (T)(a + b);
+        return r < a ? std::numeric_limits<T>::max() : r;
+    }
+
+    static T sub(const T a, const T b) {
+        return a > b ? (T)(a - b) : (T)0;
+    }
+};
+
+template<typename T>
+struct HalideCppSaturatingOps<T, false> {
+    static T add(const T a, const T b) {
+        if (b > 0 && a > std::numeric_limits<T>::max() - b) {
+            return std::numeric_limits<T>::max();
+        } else if (b < 0 && a < std::numeric_limits<T>::min() - b) {
+            return std::numeric_limits<T>::min();
+        }
+        return (T)(a + b);
+    }
+
+    static T sub(const T a, const T b) {
+        if (b < 0 && a > std::numeric_limits<T>::max() + b) {
+            return std::numeric_limits<T>::max();
+        } else if (b > 0 && a < std::numeric_limits<T>::min() + b) {
+            return std::numeric_limits<T>::min();
+        }
+        return (T)(a - b);
+    }
+};
+
+template<typename T>
+HALIDE_ALWAYS_INLINE T halide_cpp_saturating_add(const T a, const T b) {
+    return HalideCppSaturatingOps<T>::add(a, b);
+}
+
+template<typename T>
+HALIDE_ALWAYS_INLINE T halide_cpp_saturating_sub(const T a, const T b) {
+    return HalideCppSaturatingOps<T>::sub(a, b);
+}
+
+// These three round the exact result down, up and down respectively,
+// without overflowing.
+template<typename T>
+HALIDE_ALWAYS_INLINE T halide_cpp_halving_add(const T a, const T b) {
+    return (T)((a & b) + ((a ^ b) >> 1));
+}
+
+template<typename T>
+HALIDE_ALWAYS_INLINE T halide_cpp_rounding_halving_add(const T a, const T b) {
+    return (T)((a | b) - ((a ^ b) >> 1));
+}
+
+template<typename T>
+HALIDE_ALWAYS_INLINE T halide_cpp_halving_sub(const T a, const T b) {
+    return (T)((a >> 1) - (b >> 1) - ((~a & b) & 1));
+}
+
+// Only used for shifts in [1, bits - 1].
+template<typename T>
+HALIDE_ALWAYS_INLINE T halide_cpp_rounding_shift_right(const T a, const T b) {
+    return (T)((a >> b) + ((a >> (b - 1)) & 1));
+}
+
 // We can't use std::array because that has its own overload of operator<, etc,
 // which will interfere with ours.
 template<typename ElementType, size_t Lanes>
@@ -213,6 +299,33 @@ public:
         }
         return r;
     }
+
+#define HALIDE_CPP_VECTOR_BINARY_OP(NAME)                      \
+    static Vec NAME(const Vec &a, const Vec &b) {               \
+        Vec r;                                                  \
+        for (size_t i = 0; i < Lanes; i++) {                    \
+            r[i] = halide_cpp_##NAME<ElementType>(a[i], b[i]);  \
+        }                                                       \
+        return r;                                               \
+    }
+
+    HALIDE_CPP_VECTOR_BINARY_OP(saturating_add)
+    HALIDE_CPP_VECTOR_BINARY_OP(saturating_sub)
+    HALIDE_CPP_VECTOR_BINARY_OP(halving_add)
+    HALIDE_CPP_VECTOR_BINARY_OP(rounding_halving_add)
+    HALIDE_CPP_VECTOR_BINARY_OP(halving_sub)
+    HALIDE_CPP_VECTOR_BINARY_OP(rounding_shift_right)
+
+#undef HALIDE_CPP_VECTOR_BINARY_OP
+
+    template<typename NarrowElementType>
+    static Vec widening_mul(const CppVector<NarrowElementType, Lanes> &a, const CppVector<NarrowElementType, Lanes> &b) {
+        Vec r;
+        for (size_t i = 0; i < Lanes; i++) {
+            r[i] = (ElementType)a[i] * (ElementType)b[i];
+        }
+        return r;
+    }
 };
 
 template<typename ElementType, size_t Lanes>
@@ -572,6 +685,12 @@ struct NativeVectorComparisonType<double> {
     using type = int64_t;
 };
 
+template<typename ElementType, size_t Lanes>
+struct NativeVectorTargetOps;
+
+template<typename WideElementType, typename NarrowElementType, size_t Lanes>
+struct NativeVectorWideningMul;
+
 template<typename ElementType_, size_t Lanes_>
 class NativeVectorOps {
 public:
@@ -782,8 +901,287 @@ public:
         const NativeVector<T, Lanes> r = a != b;
         return NativeVectorOps<uint8_t, Lanes>::convert_from(r);
     }
+
+    // The ops below use target intrinsics for each 128-bit piece of
+    // the vector, where they exist.
+    static constexpr size_t PieceLanes = 16 / sizeof(ElementType);
+    using Piece = NativeVector<ElementType, PieceLanes>;
+    using PieceOps = NativeVectorTargetOps<ElementType, PieceLanes>;
+
+    static constexpr bool use_pieces() {
+        return PieceOps::has_intrinsics && Lanes > PieceLanes && Lanes % PieceLanes == 0;
+    }
+
+    static Vec by_pieces(const Vec a, const Vec b, Piece (*op)(const Piece, const Piece)) {
+        Vec r;
+        for (size_t i = 0; i < Lanes; i += PieceLanes) {
+            Piece pa, pb;
+            memcpy(&pa, (const ElementType *)&a + i, sizeof(Piece));
+            memcpy(&pb, (const ElementType *)&b + i, sizeof(Piece));
+            const Piece pr = op(pa, pb);
+            memcpy((ElementType *)&r + i, &pr, sizeof(Piece));
+        }
+        return r;
+    }
+
+#define HALIDE_CPP_VECTOR_BINARY_OP(NAME)                                        \
+    static Vec NAME(const Vec a, const Vec b) {                                   \
+        return use_pieces() ? by_pieces(a, b, PieceOps::NAME) :                   \
+                            NativeVectorTargetOps<ElementType, Lanes>::NAME(a, b); \
+    }
+
+    HALIDE_CPP_VECTOR_BINARY_OP(saturating_add)
+    HALIDE_CPP_VECTOR_BINARY_OP(saturating_sub)
+    HALIDE_CPP_VECTOR_BINARY_OP(halving_add)
+    HALIDE_CPP_VECTOR_BINARY_OP(rounding_halving_add)
+    HALIDE_CPP_VECTOR_BINARY_OP(halving_sub)
+    HALIDE_CPP_VECTOR_BINARY_OP(rounding_shift_right)
+
+#undef HALIDE_CPP_VECTOR_BINARY_OP
+
+    template<typename NarrowElementType>
+    static Vec widening_mul(const NativeVector<NarrowElementType, Lanes> a, const NativeVector<NarrowElementType, Lanes> b) {
+        using PieceMul = NativeVectorWideningMul<ElementType, NarrowElementType, PieceLanes>;
+        using NarrowPiece = NativeVector<NarrowElementType, PieceLanes>;
+        if (!PieceMul::has_intrinsics || Lanes % PieceLanes != 0) {
+            return NativeVectorWideningMul<ElementType, NarrowElementType, Lanes>::widening_mul(a, b);
+        }
+        Vec r;
+        for (size_t i = 0; i < Lanes; i += PieceLanes) {
+            NarrowPiece pa, pb;
+            memcpy(&pa, (const NarrowElementType *)&a + i, sizeof(NarrowPiece));
+            memcpy(&pb, (const NarrowElementType *)&b + i, sizeof(NarrowPiece));
+            const Piece pr = PieceMul::widening_mul(pa, pb);
+            memcpy((ElementType *)&r + i, &pr, sizeof(Piece));
+        }
+        return r;
+    }
 };
 
+template<typename T>
+struct HalideCppWider;
+
+template<>
+struct HalideCppWider<int8_t> {
+    using type = int16_t;
+};
+
+template<>
+struct HalideCppWider<uint8_t> {
+    using type = uint16_t;
+};
+
+template<>
+struct HalideCppWider<int16_t> {
+    using type = int32_t;
+};
+
+template<>
+struct HalideCppWider<uint16_t> {
+    using type = uint32_t;
+};
+
+template<>
+struct HalideCppWider<int32_t> {
+    using type = int64_t;
+};
+
+template<>
+struct HalideCppWider<uint32_t> {
+    using type = uint64_t;
+};
+
+// Portable versions of the ops that NativeVectorOps implements with
+// target intrinsics, using the same vector arithmetic as the lowered
+// intrinsics would.
+template<typename ElementType, size_t Lanes>
+struct NativeVectorPortableOps {
+    using Vec = NativeVector<ElementType, Lanes>;
+    using Ops = NativeVectorOps<ElementType, Lanes>;
+
+    static Vec saturating_add(const Vec a, const Vec b) {
+        using Wide = typename std::make_signed<typename HalideCppWider<ElementType>::type>::type;
+        using WideOps = NativeVectorOps<Wide, Lanes>;
+        const auto lo = WideOps::broadcast(std::numeric_limits<ElementType>::min());
+        const auto hi = WideOps::broadcast(std::numeric_limits<ElementType>::max());
+        const auto r = WideOps::convert_from(a) + WideOps::convert_from(b);
+        return Ops::convert_from(WideOps::min(WideOps::max(r, lo), hi));
+    }
+
+    static Vec saturating_sub(const Vec a, const Vec b) {
+        using Wide = typename std::make_signed<typename HalideCppWider<ElementType>::type>::type;
+        using WideOps = NativeVectorOps<Wide, Lanes>;
+        const auto lo = WideOps::broadcast(std::numeric_limits<ElementType>::min());
+        const auto hi = WideOps::broadcast(std::numeric_limits<ElementType>::max());
+        const auto r = WideOps::convert_from(a) - WideOps::convert_from(b);
+        return Ops::convert_from(WideOps::min(WideOps::max(r, lo), hi));
+    }
+
+    static Vec halving_add(const Vec a, const Vec b) {
+        return (a & b) + ((a ^ b) >> Ops::broadcast(1));
+    }
+
+    static Vec rounding_halving_add(const Vec a, const Vec b) {
+        return (a | b) - ((a ^ b) >> Ops::broadcast(1));
+    }
+
+    static Vec halving_sub(const Vec a, const Vec b) {
+        const Vec one = Ops::broadcast(1);
+        return (a >> one) - (b >> one) - ((~a & b) & one);
+    }
+
+    static Vec rounding_shift_right(const Vec a, const Vec b) {
+        const Vec one = Ops::broadcast(1);
+        return (a >> b) + ((a >> (b - one)) & one);
+    }
+};
+
+template<typename ElementType, size_t Lanes>
+struct NativeVectorTargetOps : NativeVectorPortableOps<ElementType, Lanes> {
+    static constexpr bool has_intrinsics = false;
+};
+
+template<typename WideElementType, typename NarrowElementType, size_t Lanes>
+struct NativeVectorWideningMul {
+    static constexpr bool has_intrinsics = false;
+
+    static NativeVector<WideElementType, Lanes> widening_mul(const NativeVector<NarrowElementType, Lanes> a,
+                                                             const NativeVector<NarrowElementType, Lanes> b) {
+        using WideOps = NativeVectorOps<WideElementType, Lanes>;
+        return WideOps::convert_from(a) * WideOps::convert_from(b);
+    }
+};
+
+#if HALIDE_CPP_USE_NEON || HALIDE_CPP_USE_SSE2
+template<typename To, typename From>
+HALIDE_ALWAYS_INLINE To halide_cpp_bitcast(const From &from) {
+    static_assert(sizeof(To) == sizeof(From), "halide_cpp_bitcast requires types of the same size");
+    To to;
+    memcpy(&to, &from, sizeof(To));
+    return to;
+}
+#endif
+
+#if HALIDE_CPP_USE_NEON
+
+#define HALIDE_CPP_NEON_BINARY_OP(NAME, INTRIN)                                                          \
+    static Vec NAME(const Vec a, const Vec b) {                                                          \
+        return halide_cpp_bitcast<Vec>(halide_cpp_neon::INTRIN(halide_cpp_bitcast<N>(a), halide_cpp_bitcast<N>(b))); \
+    }
+
+#define HALIDE_CPP_NEON_TARGET_OPS(T, LANES, S, SIGNED_S)                                                    \
+    template<>                                                                                               \
+    struct NativeVectorTargetOps<T, LANES> : NativeVectorPortableOps<T, LANES> {                             \
+        static constexpr bool has_intrinsics = true;                                                         \
+        using Vec = NativeVector<T, LANES>;                                                                  \
+        using N = decltype(halide_cpp_neon::vdupq_n_##S(0));                                                 \
+        using SignedN = decltype(halide_cpp_neon::vdupq_n_##SIGNED_S(0));                                    \
+        HALIDE_CPP_NEON_BINARY_OP(saturating_add, vqaddq_##S)                                                \
+        HALIDE_CPP_NEON_BINARY_OP(saturating_sub, vqsubq_##S)                                                \
+        HALIDE_CPP_NEON_BINARY_OP(halving_add, vhaddq_##S)                                                   \
+        HALIDE_CPP_NEON_BINARY_OP(rounding_halving_add, vrhaddq_##S)                                         \
+        HALIDE_CPP_NEON_BINARY_OP(halving_sub, vhsubq_##S)                                                   \
+        static Vec rounding_shift_right(const Vec a, const Vec b) {                                          \
+            const SignedN shift = halide_cpp_neon::vnegq_##SIGNED_S(halide_cpp_bitcast<SignedN>(b));          \
+            return halide_cpp_bitcast<Vec>(halide_cpp_neon::vrshlq_##S(halide_cpp_bitcast<N>(a), shift));    \
+        }                                                                                                    \
+    };
+
+HALIDE_CPP_NEON_TARGET_OPS(uint8_t, 16, u8, s8)
+HALIDE_CPP_NEON_TARGET_OPS(int8_t, 16, s8, s8)
+HALIDE_CPP_NEON_TARGET_OPS(uint16_t, 8, u16, s16)
+HALIDE_CPP_NEON_TARGET_OPS(int16_t, 8, s16, s16)
+HALIDE_CPP_NEON_TARGET_OPS(uint32_t, 4, u32, s32)
+HALIDE_CPP_NEON_TARGET_OPS(int32_t, 4, s32, s32)
+
+#undef HALIDE_CPP_NEON_TARGET_OPS
+#undef HALIDE_CPP_NEON_BINARY_OP
+
+#define HALIDE_CPP_NEON_WIDENING_MUL(WIDE_T, NARROW_T, LANES, NARROW_S)                            \
+    template<>                                                                                     \
+    struct NativeVectorWideningMul<WIDE_T, NARROW_T, LANES> {                                      \
+        static constexpr bool has_intrinsics = true;                                               \
+        using NarrowN = decltype(halide_cpp_neon::vdup_n_##NARROW_S(0));                           \
+        static NativeVector<WIDE_T, LANES> widening_mul(const NativeVector<NARROW_T, LANES> a,     \
+                                                        const NativeVector<NARROW_T, LANES> b) {   \
+            return halide_cpp_bitcast<NativeVector<WIDE_T, LANES>>(                                \
+                halide_cpp_neon::vmull_##NARROW_S(halide_cpp_bitcast<NarrowN>(a),                  \
+                                                  halide_cpp_bitcast<NarrowN>(b)));                \
+        }                                                                                          \
+    };
+
+HALIDE_CPP_NEON_WIDENING_MUL(uint16_t, uint8_t, 8, u8)
+HALIDE_CPP_NEON_WIDENING_MUL(int16_t, int8_t, 8, s8)
+HALIDE_CPP_NEON_WIDENING_MUL(uint32_t, uint16_t, 4, u16)
+HALIDE_CPP_NEON_WIDENING_MUL(int32_t, int16_t, 4, s16)
+HALIDE_CPP_NEON_WIDENING_MUL(uint64_t, uint32_t, 2, u32)
+HALIDE_CPP_NEON_WIDENING_MUL(int64_t, int32_t, 2, s32)
+
+#undef HALIDE_CPP_NEON_WIDENING_MUL
+
+#elif HALIDE_CPP_USE_SSE2
+
+#define HALIDE_CPP_SSE2_BINARY_OP(NAME, INTRIN)                                                        \
+    static Vec NAME(const Vec a, const Vec b) {                                                        \
+        return halide_cpp_bitcast<Vec>(INTRIN(halide_cpp_bitcast<__m128i>(a), halide_cpp_bitcast<__m128i>(b))); \
+    }
+
+#define HALIDE_CPP_SSE2_SIGNED_TARGET_OPS(T, LANES, EP)                            \
+    template<>                                                                     \
+    struct NativeVectorTargetOps<T, LANES> : NativeVectorPortableOps<T, LANES> {   \
+        static constexpr bool has_intrinsics = true;                               \
+        using Vec = NativeVector<T, LANES>;                                        \
+        HALIDE_CPP_SSE2_BINARY_OP(saturating_add, _mm_adds_##EP)                   \
+        HALIDE_CPP_SSE2_BINARY_OP(saturating_sub, _mm_subs_##EP)                   \
+    };
+
+// The unsigned ones also have a rounding average, which gives us the
+// halving add too.
+#define HALIDE_CPP_SSE2_UNSIGNED_TARGET_OPS(T, LANES, EP, BITS)                                       \
+    template<>                                                                                        \
+    struct NativeVectorTargetOps<T, LANES> : NativeVectorPortableOps<T, LANES> {                      \
+        static constexpr bool has_intrinsics = true;                                                  \
+        using Vec = NativeVector<T, LANES>;                                                           \
+        HALIDE_CPP_SSE2_BINARY_OP(saturating_add, _mm_adds_##EP)                                      \
+        HALIDE_CPP_SSE2_BINARY_OP(saturating_sub, _mm_subs_##EP)                                      \
+        HALIDE_CPP_SSE2_BINARY_OP(rounding_halving_add, _mm_avg_##EP)                                 \
+        static Vec halving_add(const Vec a, const Vec b) {                                            \
+            const __m128i va = halide_cpp_bitcast<__m128i>(a), vb = halide_cpp_bitcast<__m128i>(b);  \
+            const __m128i odd = _mm_and_si128(_mm_xor_si128(va, vb), _mm_set1_epi##BITS(1));          \
+            return halide_cpp_bitcast<Vec>(_mm_sub_epi##BITS(_mm_avg_##EP(va, vb), odd));             \
+        }                                                                                             \
+    };
+
+HALIDE_CPP_SSE2_UNSIGNED_TARGET_OPS(uint8_t, 16, epu8, 8)
+HALIDE_CPP_SSE2_SIGNED_TARGET_OPS(int8_t, 16, epi8)
+HALIDE_CPP_SSE2_UNSIGNED_TARGET_OPS(uint16_t, 8, epu16, 16)
+HALIDE_CPP_SSE2_SIGNED_TARGET_OPS(int16_t, 8, epi16)
+
+#undef HALIDE_CPP_SSE2_UNSIGNED_TARGET_OPS
+#undef HALIDE_CPP_SSE2_SIGNED_TARGET_OPS
+#undef HALIDE_CPP_SSE2_BINARY_OP
+
+#define HALIDE_CPP_SSE2_WIDENING_MUL(WIDE_T, NARROW_T, MULHI)                                      \
+    template<>                                                                                     \
+    struct NativeVectorWideningMul<WIDE_T, NARROW_T, 4> {                                          \
+        static constexpr bool has_intrinsics = true;                                               \
+        static NativeVector<WIDE_T, 4> widening_mul(const NativeVector<NARROW_T, 4> a,             \
+                                                    const NativeVector<NARROW_T, 4> b) {           \
+            __m128i va = _mm_setzero_si128(), vb = _mm_setzero_si128();                            \
+            memcpy(&va, &a, sizeof(a));                                                            \
+            memcpy(&vb, &b, sizeof(b));                                                            \
+            const __m128i lo = _mm_mullo_epi16(va, vb), hi = MULHI(va, vb);                        \
+            return halide_cpp_bitcast<NativeVector<WIDE_T, 4>>(_mm_unpacklo_epi16(lo, hi));        \
+        }                                                                                          \
+    };
+
+HALIDE_CPP_SSE2_WIDENING_MUL(uint32_t, uint16_t, _mm_mulhi_epu16)
+HALIDE_CPP_SSE2_WIDENING_MUL(int32_t, int16_t, _mm_mulhi_epi16)
+
+#undef HALIDE_CPP_SSE2_WIDENING_MUL
+
+#endif  // HALIDE_CPP_USE_NEON
+
 #endif  // __has_attribute(ext_vector_type) || __has_attribute(vector_size)
 
 }  // namespace
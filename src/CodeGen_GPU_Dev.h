@@ -4,6 +4,7 @@
 /** \file
  * Defines the code-generator interface for producing GPU device code
  */
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -55,6 +56,21 @@ struct CodeGen_GPU_Dev {
         return false;
     }
 
+    /** Backends whose kernels are independent of each other can compile
+     * them concurrently: this returns a new code generator for the same
+     * target, on which add_kernel may be called from another thread, or
+     * nullptr if the backend doesn't support this. Kernels compiled this
+     * way must keep the names passed to add_kernel. */
+    virtual std::unique_ptr<CodeGen_GPU_Dev> new_kernel_compiler() {
+        return nullptr;
+    }
+
+    /** Append the kernels compiled by a code generator returned by
+     * new_kernel_compiler() to this module. */
+    virtual void append_kernels(CodeGen_GPU_Dev &kernel_compiler) {
+        internal_error << "append_kernels not implemented for " << api_unique_name() << "\n";
+    }
+
     /** Checks if expr is block uniform, i.e. does not depend on a thread
      * var. */
     static bool is_block_uniform(const Expr &expr);
@@ -65,6 +81,11 @@ struct CodeGen_GPU_Dev {
      * uniform within the workgroup. */
     static bool is_buffer_constant(const Stmt &kernel, const std::string &buffer);
 
+    /** Checks if the kernel shuffles values across a subgroup, via the
+     * halide_gpu_shuffle_* calls that lower_warp_shuffles makes for
+     * GPULane loops in the Metal, OpenCL and Vulkan apis. */
+    static bool uses_subgroup_shuffles(const Stmt &kernel);
+
     /** Modifies predicated loads and stores to be non-predicated, since most
      * GPU backends do not support predication. */
     static Stmt scalarize_predicated_loads_stores(Stmt &s);
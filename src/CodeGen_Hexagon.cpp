@@ -58,6 +58,22 @@ protected:
         return (isa_version >= 65);
     }
 
+    int is_hvx_v68_or_later() const {
+        return (isa_version >= 68);
+    }
+
+    /** Whether there is HVX arithmetic for vectors of the given type,
+     * which is only true of floats from v68 on. */
+    bool is_hvx_float(Type t) const {
+        return is_hvx_v68_or_later() && t.is_vector() && t.is_float() &&
+               (t.bits() == 16 || t.bits() == 32);
+    }
+
+    /** Compute a * b + c, or a * b - c, where mul is a * b, keeping the
+     * product in qfloat format rather than converting it back to IEEE
+     * in between. Returns null if that isn't possible. */
+    llvm::Value *qfloat_mul_add(const Mul *mul, const Expr &c, bool subtract);
+
     using CodeGen_Posix::visit;
 
     /** Nodes for which we want to emit specific hexagon intrinsics */
@@ -65,6 +81,8 @@ protected:
     void visit(const Max *) override;
     void visit(const Min *) override;
     void visit(const Call *) override;
+    void visit(const Add *) override;
+    void visit(const Sub *) override;
     void visit(const Mul *) override;
     void visit(const Select *) override;
     void visit(const Allocate *) override;
@@ -486,6 +504,17 @@ void CodeGen_Hexagon::compile_func(const LoweredFunc &f,
     debug(2) << "Hexagon: Lowering after unpredicating loads/stores:\n"
              << body << "\n\n";
 
+    if (target.has_feature(Target::HVXAutoVTCM)) {
+        user_assert(is_hvx_v65_or_later())
+            << "hvx_auto_vtcm requires HVX_v65 or later.\n";
+        // Do this first, so that vgathers can use the lookup tables
+        // it places in VTCM.
+        debug(1) << "Hexagon: Placing reused allocations in VTCM...\n";
+        body = place_allocations_in_vtcm(body, target);
+        debug(2) << "Hexagon: Lowering after placing allocations in VTCM:\n"
+                 << body << "\n\n";
+    }
+
     if (is_hvx_v65_or_later()) {
         // Generate vscatter-vgathers before optimize_hexagon_shuffles.
         debug(1) << "Hexagon: Looking for vscatter-vgather...\n";
@@ -510,8 +539,9 @@ void CodeGen_Hexagon::compile_func(const LoweredFunc &f,
              << body << "\n\n";
 
     debug(1) << "Hexagon: Carrying values across loop iterations...\n";
-    // Use at most 16 vector registers for carrying values.
-    body = loop_carry(body, 16);
+    // Use at most 16 vector registers for carrying values, and cache at
+    // most 8 rows for stencils.
+    body = loop_carry(body, 16, 8);
     body = simplify(body);
     debug(2) << "Hexagon: Lowering after forwarding stores:\n"
              << body << "\n\n";
@@ -540,6 +570,7 @@ struct HvxIntrinsic {
         BroadcastScalarsToWords = 1 << 0,  // Some intrinsics need scalar arguments
                                            // broadcasted up to 32 bits.
         v65OrLater = 1 << 1,
+        v68OrLater = 1 << 2,
     };
     llvm::Intrinsic::ID id;
     halide_type_t ret_type;
@@ -559,6 +590,8 @@ halide_type_t i32 = halide_type_t(halide_type_int, 32);
 halide_type_t u8 = halide_type_t(halide_type_uint, 8);
 halide_type_t u16 = halide_type_t(halide_type_uint, 16);
 halide_type_t u32 = halide_type_t(halide_type_uint, 32);
+halide_type_t f16 = halide_type_t(halide_type_float, 16);
+halide_type_t f32 = halide_type_t(halide_type_float, 32);
 
 // Define vectors that are 1x and 2x the Hexagon HVX width --
 // Note that we use placeholders here (which we fix up when processing
@@ -573,6 +606,8 @@ halide_type_t i32v1 = i32.with_lanes(kOneX / 32);
 halide_type_t u8v1 = u8.with_lanes(kOneX / 8);
 halide_type_t u16v1 = u16.with_lanes(kOneX / 16);
 halide_type_t u32v1 = u32.with_lanes(kOneX / 32);
+halide_type_t f16v1 = f16.with_lanes(kOneX / 16);
+halide_type_t f32v1 = f32.with_lanes(kOneX / 32);
 
 halide_type_t i8v2 = i8v1.with_lanes(i8v1.lanes * 2);
 halide_type_t i16v2 = i16v1.with_lanes(i16v1.lanes * 2);
@@ -840,6 +875,24 @@ const HvxIntrinsic intrinsic_wrappers[] = {
     // Bit counting
     {INTRINSIC_128B(vnormamth), u16v1, "cls.vh", {u16v1}},
     {INTRINSIC_128B(vnormamtw), u32v1, "cls.vw", {u32v1}},
+
+    // Float arithmetic. v68 computes in the qf32 and qf16 formats, which
+    // have to be converted back to IEEE before anything else uses them.
+    // Halide has no types for them, so the vqf32 and vqf16 arguments
+    // here are float vectors that actually hold qfloat values.
+    {INTRINSIC_128B(vmpy_qf32_sf), f32v1, "mpy_qf32.vsf.vsf", {f32v1, f32v1}, HvxIntrinsic::v68OrLater},
+    {INTRINSIC_128B(vadd_qf32_mix), f32v1, "add_qf32.vqf32.vsf", {f32v1, f32v1}, HvxIntrinsic::v68OrLater},
+    {INTRINSIC_128B(vsub_qf32_mix), f32v1, "sub_qf32.vqf32.vsf", {f32v1, f32v1}, HvxIntrinsic::v68OrLater},
+    {INTRINSIC_128B(vconv_sf_qf32), f32v1, "conv_sf.vqf32", {f32v1}, HvxIntrinsic::v68OrLater},
+    {INTRINSIC_128B(vmpy_qf16_hf), f16v1, "mpy_qf16.vhf.vhf", {f16v1, f16v1}, HvxIntrinsic::v68OrLater},
+    {INTRINSIC_128B(vadd_qf16_mix), f16v1, "add_qf16.vqf16.vhf", {f16v1, f16v1}, HvxIntrinsic::v68OrLater},
+    {INTRINSIC_128B(vsub_qf16_mix), f16v1, "sub_qf16.vqf16.vhf", {f16v1, f16v1}, HvxIntrinsic::v68OrLater},
+    {INTRINSIC_128B(vconv_hf_qf16), f16v1, "conv_hf.vqf16", {f16v1}, HvxIntrinsic::v68OrLater},
+
+    {INTRINSIC_128B(vfmax_sf), f32v1, "max.vsf.vsf", {f32v1, f32v1}, HvxIntrinsic::v68OrLater},
+    {INTRINSIC_128B(vfmin_sf), f32v1, "min.vsf.vsf", {f32v1, f32v1}, HvxIntrinsic::v68OrLater},
+    {INTRINSIC_128B(vfmax_hf), f16v1, "max.vhf.vhf", {f16v1, f16v1}, HvxIntrinsic::v68OrLater},
+    {INTRINSIC_128B(vfmin_hf), f16v1, "min.vhf.vhf", {f16v1, f16v1}, HvxIntrinsic::v68OrLater},
 };
 // clang-format on
 
@@ -893,10 +946,14 @@ llvm::Function *CodeGen_Hexagon::define_hvx_intrinsic(llvm::Function *intrin,
     llvm::FunctionType *intrin_ty = intrin->getFunctionType();
     bool broadcast_scalar_word = flags & HvxIntrinsic::BroadcastScalarsToWords;
     bool v65OrLater = flags & HvxIntrinsic::v65OrLater;
+    bool v68OrLater = flags & HvxIntrinsic::v68OrLater;
 
     if (v65OrLater && !is_hvx_v65_or_later()) {
         return nullptr;
     }
+    if (v68OrLater && !is_hvx_v68_or_later()) {
+        return nullptr;
+    }
 
     // Get the types of the arguments we want to pass.
     vector<llvm::Type *> llvm_arg_types;
@@ -1821,6 +1878,11 @@ string CodeGen_Hexagon::mattrs() const {
     if (target.has_feature(Target::HVX)) {
         attrs.push_back("+hvxv" + std::to_string(isa_version));
     }
+    if (is_hvx_v68_or_later()) {
+        // Let LLVM lower vector float arithmetic to the qfloat
+        // instructions, instead of scalarizing it.
+        attrs.push_back("+hvx-qfloat");
+    }
     return join_strings(attrs, ",");
 }
 
@@ -1869,9 +1931,9 @@ void CodeGen_Hexagon::visit(const Mul *op) {
             return;
         }
 
-        // v68 has vector support for single-precision float.
-        if (target.has_feature(Halide::Target::HVX_v68) &&
-            op->type.is_float() && op->type.bits() == 32) {
+        // v68 has vector support for float, which LLVM lowers to
+        // qfloat instructions.
+        if (is_hvx_float(op->type)) {
             CodeGen_Posix::visit(op);
             return;
         }
@@ -1883,6 +1945,49 @@ void CodeGen_Hexagon::visit(const Mul *op) {
     }
 }
 
+Value *CodeGen_Hexagon::qfloat_mul_add(const Mul *mul, const Expr &c, bool subtract) {
+    // Fusing the operations changes the rounding, so only do it where
+    // LLVM would be allowed to contract them too.
+    if (!mul || !is_hvx_float(mul->type) ||
+        !builder->getFastMathFlags().allowContract()) {
+        return nullptr;
+    }
+    const string ieee = mul->type.bits() == 32 ? "sf" : "hf";
+    const string qf = mul->type.bits() == 32 ? "qf32" : "qf16";
+    llvm::Type *t = llvm_type_of(mul->type);
+    Value *product = call_intrin(t, "halide.hexagon.mpy_" + qf + ".v" + ieee + ".v" + ieee,
+                                 {codegen(mul->a), codegen(mul->b)}, true /*maybe*/);
+    if (!product) {
+        return nullptr;
+    }
+    Value *sum = call_intrin(t, string("halide.hexagon.") + (subtract ? "sub_" : "add_") + qf + ".v" + qf + ".v" + ieee,
+                             {product, codegen(c)});
+    return call_intrin(t, "halide.hexagon.conv_" + ieee + ".v" + qf, {sum});
+}
+
+void CodeGen_Hexagon::visit(const Add *op) {
+    if (is_hvx_float(op->type)) {
+        value = qfloat_mul_add(op->a.as<Mul>(), op->b, false);
+        if (!value) {
+            value = qfloat_mul_add(op->b.as<Mul>(), op->a, false);
+        }
+        if (value) {
+            return;
+        }
+    }
+    CodeGen_Posix::visit(op);
+}
+
+void CodeGen_Hexagon::visit(const Sub *op) {
+    if (is_hvx_float(op->type)) {
+        value = qfloat_mul_add(op->a.as<Mul>(), op->b, true);
+        if (value) {
+            return;
+        }
+    }
+    CodeGen_Posix::visit(op);
+}
+
 void CodeGen_Hexagon::visit(const Call *op) {
     internal_assert(op->is_extern() || op->is_intrinsic())
         << "Can only codegen extern calls and intrinsics\n";
@@ -28,8 +28,13 @@ llvm::Type *get_vector_element_type(llvm::Type *t) {
 bool function_takes_user_context(const std::string &name) {
     static const char *user_context_runtime_funcs[] = {
         "halide_buffer_copy",
+        "halide_arena_malloc",
+        "halide_arena_free",
+        "halide_arena_nop_free",
         "halide_copy_to_host",
         "halide_copy_to_device",
+        "halide_choose_size_variant",
+        "halide_get_size_variant",
         "halide_current_time_ns",
         "halide_debug_to_file",
         "halide_device_free",
@@ -49,11 +54,18 @@ bool function_takes_user_context(const std::string &name) {
         "halide_free",
         "halide_malloc",
         "halide_print",
+        "halide_report_size_variant_time",
         "halide_profiler_memory_allocate",
         "halide_profiler_memory_free",
         "halide_profiler_instance_start",
         "halide_profiler_instance_end",
         "halide_profiler_stack_peak_update",
+        "halide_profiler_light_pipeline_start",
+        "halide_allocation_tracker_pipeline_start",
+        "halide_allocation_tracker_allocate",
+        "halide_allocation_tracker_free",
+        "halide_allocation_tracker_device_malloc",
+        "halide_allocation_tracker_device_free",
         "halide_spawn_thread",
         "halide_device_release",
         "halide_start_clock",
@@ -62,7 +74,10 @@ bool function_takes_user_context(const std::string &name) {
         "halide_memoization_cache_lookup",
         "halide_memoization_cache_store",
         "halide_memoization_cache_release",
+        "halide_memoization_hash_buffer",
         "halide_cuda_run",
+        "halide_cuda_kernel_timer_start",
+        "halide_cuda_kernel_timer_end",
         "halide_opencl_run",
         "halide_metal_run",
         "halide_d3d12compute_run",
@@ -600,6 +615,8 @@ void get_target_options(const llvm::Module &module, llvm::TargetOptions &options
     bool per_instruction_fast_math_flags =
         get_md_bool(module.getModuleFlag("halide_per_instruction_fast_math_flags")).value_or(false);
 
+    bool fast_compile = llvm_fast_compile(module);
+
     options = llvm::TargetOptions();
     options.AllowFPOpFusion = per_instruction_fast_math_flags ? llvm::FPOpFusion::Strict : llvm::FPOpFusion::Fast;
     options.UnsafeFPMath = !per_instruction_fast_math_flags;
@@ -618,6 +635,13 @@ void get_target_options(const llvm::Module &module, llvm::TargetOptions &options
     options.RelaxELFRelocations = false;
 #endif
     options.MCOptions.ABIName = mabi;
+    // FastISel falls back to SelectionDAG for anything it can't
+    // handle, which includes most vector code.
+    options.EnableFastISel = fast_compile;
+}
+
+bool llvm_fast_compile(const llvm::Module &module) {
+    return get_md_bool(module.getModuleFlag("halide_llvm_fast_compile")).value_or(false);
 }
 
 void clone_target_options(const llvm::Module &from, llvm::Module &to) {
@@ -676,7 +700,7 @@ std::unique_ptr<llvm::TargetMachine> make_target_machine(const llvm::Module &mod
                                                 options,
                                                 use_pic ? llvm::Reloc::PIC_ : llvm::Reloc::Static,
                                                 use_large_code_model ? llvm::CodeModel::Large : llvm::CodeModel::Small,
-                                                CodeGenOptLevel::Aggressive);
+                                                llvm_fast_compile(module) ? CodeGenOptLevel::Less : CodeGenOptLevel::Aggressive);
     return std::unique_ptr<llvm::TargetMachine>(tm);
 }
 
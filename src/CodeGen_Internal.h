@@ -94,6 +94,10 @@ Expr lower_round_to_nearest_ties_to_even(const Expr &);
 /** Given an llvm::Module, set llvm:TargetOptions information */
 void get_target_options(const llvm::Module &module, llvm::TargetOptions &options);
 
+/** Whether an llvm::Module was compiled for a Target with
+ * LLVMFastCompile, which should use a cheaper code generator. */
+bool llvm_fast_compile(const llvm::Module &module);
+
 /** Given two llvm::Modules, clone target options from one to the other */
 void clone_target_options(const llvm::Module &from, llvm::Module &to);
 
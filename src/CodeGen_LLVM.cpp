@@ -1,5 +1,6 @@
 #include <limits>
 #include <memory>
+#include <set>
 #include <sstream>
 
 #include "CPlusPlusMangle.h"
@@ -309,6 +310,7 @@ struct MangledNames {
     string simple_name;
     string extern_name;
     string argv_name;
+    string batch_name;
     string metadata_name;
 };
 
@@ -322,6 +324,7 @@ MangledNames get_mangled_names(const std::string &name,
     names.simple_name = extract_namespaces(name, namespaces);
     names.extern_name = names.simple_name;
     names.argv_name = names.simple_name + "_argv";
+    names.batch_name = names.simple_name + "_batch";
     names.metadata_name = names.simple_name + "_metadata";
 
     if (linkage != LinkageType::Internal &&
@@ -342,6 +345,8 @@ MangledNames get_mangled_names(const std::string &name,
                                                 {halide_handle_cplusplus_type::Pointer, halide_handle_cplusplus_type::Pointer});
         Type void_star_star(Handle(1, &inner_type));
         names.argv_name = cplusplus_function_mangled_name(names.argv_name, namespaces, type_of<int>(), {ExternFuncArgument(make_zero(void_star_star))}, target);
+        names.batch_name = cplusplus_function_mangled_name(names.batch_name, namespaces, type_of<int>(),
+                                                           {ExternFuncArgument(make_zero(Int(32))), ExternFuncArgument(make_zero(void_star_star))}, target);
         names.metadata_name = cplusplus_function_mangled_name(names.metadata_name, namespaces, type_of<const struct halide_filter_metadata_t *>(), {}, target);
     }
     return names;
@@ -416,6 +421,7 @@ void CodeGen_LLVM::init_codegen(const std::string &name, bool any_strict_float)
     module->addModuleFlag(llvm::Module::Warning, "halide_use_pic", use_pic() ? 1 : 0);
     module->addModuleFlag(llvm::Module::Warning, "halide_use_large_code_model", llvm_large_code_model ? 1 : 0);
     module->addModuleFlag(llvm::Module::Warning, "halide_per_instruction_fast_math_flags", any_strict_float);
+    module->addModuleFlag(llvm::Module::Warning, "halide_llvm_fast_compile", get_target().has_feature(Target::LLVMFastCompile) ? 1 : 0);
     if (effective_vscale != 0) {
         module->addModuleFlag(llvm::Module::Warning, "halide_effective_vscale", effective_vscale);
     }
@@ -451,10 +457,19 @@ void CodeGen_LLVM::init_codegen(const std::string &name, bool any_strict_float)
 
 std::unique_ptr<llvm::Module> CodeGen_LLVM::compile(const Module &input) {
     init_codegen(input.name(), input.any_strict_float());
+    skip_llvm_optimization = input.skip_llvm_optimization();
 
     internal_assert(module && context && builder)
         << "The CodeGen_LLVM subclass should have made an initial module before calling CodeGen_LLVM::compile\n";
 
+    // The module only holds the runtime so far.
+    std::set<std::string> runtime_functions;
+    for (const llvm::Function &f : *module) {
+        if (!f.isDeclaration()) {
+            runtime_functions.insert(get_llvm_function_name(f));
+        }
+    }
+
     // Generate the code for this module.
     debug(1) << "Generating llvm bitcode...\n";
     for (const auto &b : input.buffers()) {
@@ -497,10 +512,11 @@ std::unique_ptr<llvm::Module> CodeGen_LLVM::compile(const Module &input) {
         // If the Func is externally visible, also create the argv wrapper and metadata.
         // (useful for calling from JIT and other machine interfaces).
         if (f.linkage == LinkageType::ExternalPlusArgv || f.linkage == LinkageType::ExternalPlusMetadata) {
-            add_argv_wrapper(function, names.argv_name, false, buffer_args);
+            llvm::Function *argv_fn = add_argv_wrapper(function, names.argv_name, false, buffer_args);
             if (f.linkage == LinkageType::ExternalPlusMetadata) {
                 embed_metadata_getter(names.metadata_name,
                                       names.simple_name, f.args, input.get_metadata_name_map());
+                add_batch_wrapper(argv_fn, names.batch_name, f.args);
             }
         }
 
@@ -568,6 +584,14 @@ std::unique_ptr<llvm::Module> CodeGen_LLVM::compile(const Module &input) {
     for (const auto &f : input.functions()) {
         const auto &names = function_names[idx++];
 
+        // Functions outlined for Stage::specialize_target_features are
+        // compiled for a target with more features than the module.
+        ScopedValue<Target> old_target(target);
+        if (!f.target_features.empty()) {
+            target = Target(target.to_string() + "-" + f.target_features);
+            function_target_attributes[module->getFunction(names.extern_name)] = {mcpu_target(), mattrs()};
+        }
+
         run_with_large_stack([&]() {
             compile_func(f, names.simple_name, names.extern_name);
         });
@@ -575,11 +599,39 @@ std::unique_ptr<llvm::Module> CodeGen_LLVM::compile(const Module &input) {
 
     debug(2) << "llvm::Module pointer: " << module.get() << "\n";
 
-    return finish_codegen();
+    // A standalone runtime has no functions of its own, and keeps all of
+    // the runtime.
+    if (target.has_feature(Target::StripUnusedRuntime) &&
+        !target.has_feature(Target::JIT) &&
+        !input.functions().empty()) {
+        strip_unused_runtime(*module, runtime_functions);
+    }
+
+    std::unique_ptr<llvm::Module> result = finish_codegen();
+
+    uint64_t functions = 0, instructions = 0;
+    for (const llvm::Function &f : *result) {
+        if (!f.isDeclaration() && runtime_functions.count(get_llvm_function_name(f))) {
+            functions++;
+            instructions += f.getInstructionCount();
+        }
+    }
+    debug(1) << "Runtime left in module " << input.name() << ": "
+             << functions << " functions, " << instructions << " instructions\n";
+    if (auto *logger = get_compiler_logger()) {
+        logger->record_runtime_size(functions, instructions);
+    }
+
+    return result;
 }
 
 std::unique_ptr<llvm::Module> CodeGen_LLVM::finish_codegen() {
     llvm::for_each(*module, set_function_attributes_from_halide_target_options);
+    for (const auto &it : function_target_attributes) {
+        it.first->addFnAttr("target-cpu", it.second.first);
+        it.first->addFnAttr("target-features", it.second.second);
+    }
+    function_target_attributes.clear();
 
     // Verify the module is ok
     internal_assert(!verifyModule(*module, &llvm::errs()));
@@ -986,6 +1038,43 @@ llvm::Function *CodeGen_LLVM::add_argv_wrapper(llvm::Function *fn,
     return wrapper_func;
 }
 
+// Make a wrapper that takes a batch size and an array of that many
+// groups of argv-style arguments, and makes all the calls as the tasks
+// of one parallel loop.
+llvm::Function *CodeGen_LLVM::add_batch_wrapper(llvm::Function *argv_fn,
+                                                const std::string &name,
+                                                const std::vector<LoweredArgument> &args) {
+    llvm::Type *argv_t = PointerType::get(PointerType::get(i8_t, 0), 0);
+    llvm::Type *wrapper_args_t[] = {i32_t, argv_t};
+    llvm::FunctionType *wrapper_func_t = llvm::FunctionType::get(i32_t, wrapper_args_t, false);
+    llvm::Function *wrapper_func = llvm::Function::Create(wrapper_func_t, llvm::GlobalValue::ExternalLinkage, name, module.get());
+    llvm::BasicBlock *wrapper_block = llvm::BasicBlock::Create(module->getContext(), "entry", wrapper_func);
+    builder->SetInsertPoint(wrapper_block);
+
+    llvm::Function *batch_fn = module->getFunction("halide_do_batch_argv");
+    if (!batch_fn) {
+        // There's no runtime in this module, so declare it.
+        llvm::Type *batch_args_t[] = {argv_fn->getType(), i32_t, i32_t, argv_t, i1_t};
+        llvm::FunctionType *batch_func_t = llvm::FunctionType::get(i32_t, batch_args_t, false);
+        batch_fn = llvm::Function::Create(batch_func_t, llvm::GlobalValue::ExternalLinkage, "halide_do_batch_argv", module.get());
+    }
+    llvm::FunctionType *batch_func_t = batch_fn->getFunctionType();
+    internal_assert(batch_func_t->getNumParams() == 5);
+
+    const bool has_user_context = !args.empty() && args[0].name == "__user_context";
+    llvm::Value *batch_args[] = {
+        builder->CreatePointerCast(argv_fn, batch_func_t->getParamType(0)),
+        wrapper_func->getArg(0),
+        ConstantInt::get(batch_func_t->getParamType(2), args.size()),
+        builder->CreatePointerCast(wrapper_func->getArg(1), batch_func_t->getParamType(3)),
+        ConstantInt::get(batch_func_t->getParamType(4), has_user_context ? 1 : 0),
+    };
+    llvm::CallInst *result = builder->CreateCall(batch_fn, batch_args);
+    builder->CreateRet(result);
+    internal_assert(!verifyFunction(*wrapper_func, &llvm::errs()));
+    return wrapper_func;
+}
+
 llvm::Function *CodeGen_LLVM::embed_metadata_getter(const std::string &metadata_name,
                                                     const std::string &function_name, const std::vector<LoweredArgument> &args,
                                                     const MetadataNameMap &metadata_name_map) {
@@ -1057,7 +1146,11 @@ llvm::Function *CodeGen_LLVM::embed_metadata_getter(const std::string &metadata_
             embed_constant_scalar_value_t(argument_estimates.scalar_min),
             embed_constant_scalar_value_t(argument_estimates.scalar_max),
             embed_constant_scalar_value_t(argument_estimates.scalar_estimate),
-            buffer_estimates_array_ptr};
+            buffer_estimates_array_ptr,
+            ConstantInt::get(i32_t, args[arg].host_alignment),
+            ConstantInt::get(i32_t, args[arg].layout),
+            ConstantInt::get(i32_t, args[arg].padding),
+            /* reserved */ zero};
         arguments_array_entries.push_back(ConstantStruct::get(argument_t_type, argument_fields));
     }
     llvm::ArrayType *arguments_array = ArrayType::get(argument_t_type, num_args);
@@ -1111,12 +1204,15 @@ void CodeGen_LLVM::optimize_module() {
 
     std::unique_ptr<TargetMachine> tm = make_target_machine(*module);
 
-    const bool do_loop_opt = get_target().has_feature(Target::EnableLLVMLoopOpt);
+    // The fast tier skips the loop optimizations, as they are the
+    // passes that take the longest on Halide's large loop bodies.
+    const bool fast_compile = get_target().has_feature(Target::LLVMFastCompile);
+    const bool do_loop_opt = get_target().has_feature(Target::EnableLLVMLoopOpt) && !fast_compile;
 
     PipelineTuningOptions pto;
     pto.LoopInterleaving = do_loop_opt;
     pto.LoopVectorization = do_loop_opt;
-    pto.SLPVectorization = true;
+    pto.SLPVectorization = !fast_compile;
     pto.LoopUnrolling = do_loop_opt;
     // Clear ScEv info for all loops. Certain Halide applications spend a very
     // long time compiling in forgetLoop, and prefer to forget everything
@@ -1142,7 +1238,9 @@ void CodeGen_LLVM::optimize_module() {
     ModulePassManager mpm;
 
     using OptimizationLevel = llvm::OptimizationLevel;
-    OptimizationLevel level = OptimizationLevel::O3;
+    OptimizationLevel level = skip_llvm_optimization ? OptimizationLevel::O0 :
+                              fast_compile           ? OptimizationLevel::O1 :
+                                                       OptimizationLevel::O3;
 
     if (tm->isPositionIndependent()) {
         // Add a pass that converts lookup tables to relative lookup tables to make them PIC-friendly.
@@ -2499,9 +2597,6 @@ void CodeGen_LLVM::codegen_predicated_load(const Load *op) {
 }
 
 void CodeGen_LLVM::codegen_atomic_rmw(const Store *op) {
-    // TODO: predicated store (see https://github.com/halide/Halide/issues/4298).
-    user_assert(is_const_one(op->predicate)) << "Atomic predicated store is not supported.\n";
-
     // Detect whether we can describe this as an atomic-read-modify-write,
     // otherwise fallback to a compare-and-swap loop.
     // Currently we only test for atomicAdd.
@@ -2518,7 +2613,35 @@ void CodeGen_LLVM::codegen_atomic_rmw(const Store *op) {
                                  op->alignment);
     Expr delta = simplify(common_subexpression_elimination(op->value - equiv_load));
     bool is_atomic_add = supports_atomic_add(value_type) && !expr_uses_var(delta, op->name);
-    if (is_atomic_add) {
+    if (is_atomic_add && !is_const_one(op->predicate)) {
+        // Do the atomic add for each lane separately, if its predicate
+        // is true. (Vectorized atomic scatter-adds are predicated on
+        // which lanes have the last of each index.)
+        Value *val = codegen(delta);
+        Value *pred = codegen(op->predicate);
+        Value *index = codegen(op->index);
+        for (int i = 0; i < value_type.lanes(); i++) {
+            Value *p = pred, *idx = index, *v = val;
+            if (!value_type.is_scalar()) {
+                Value *lane = ConstantInt::get(i32_t, i);
+                p = builder->CreateExtractElement(pred, lane);
+                idx = builder->CreateExtractElement(index, lane);
+                v = builder->CreateExtractElement(val, lane);
+            }
+            BasicBlock *add_bb = BasicBlock::Create(*context, "atomic_add", function);
+            BasicBlock *after_bb = BasicBlock::Create(*context, "after_atomic_add", function);
+            builder->CreateCondBr(p, add_bb, after_bb);
+            builder->SetInsertPoint(add_bb);
+            Value *ptr = codegen_buffer_pointer(op->name, value_type.element_of(), idx);
+            if (value_type.is_float()) {
+                builder->CreateAtomicRMW(AtomicRMWInst::FAdd, ptr, v, llvm::MaybeAlign(), AtomicOrdering::Monotonic);
+            } else {
+                builder->CreateAtomicRMW(AtomicRMWInst::Add, ptr, v, llvm::MaybeAlign(), AtomicOrdering::Monotonic);
+            }
+            builder->CreateBr(after_bb);
+            builder->SetInsertPoint(after_bb);
+        }
+    } else if (is_atomic_add) {
         Value *val = codegen(delta);
         if (value_type.is_scalar()) {
             Value *ptr = codegen_buffer_pointer(op->name,
@@ -2545,6 +2668,9 @@ void CodeGen_LLVM::codegen_atomic_rmw(const Store *op) {
             }
         }
     } else {
+        // TODO: predicated store (see https://github.com/halide/Halide/issues/4298).
+        user_assert(is_const_one(op->predicate)) << "Atomic predicated store is not supported.\n";
+
         // We want to create the following CAS loop:
         // entry:
         //   %orig = load atomic op->name[op->index]
@@ -3300,6 +3426,14 @@ void CodeGen_LLVM::visit(const Call *op) {
     } else if (op->is_intrinsic(Call::size_of_halide_buffer_t)) {
         const llvm::DataLayout &d = module->getDataLayout();
         value = ConstantInt::get(i32_t, (int)d.getTypeAllocSize(halide_buffer_t_type));
+    } else if (op->is_intrinsic(Call::nontemporal_store)) {
+        // Only meaningful as the value of a Store.
+        value = codegen(op->args[0]);
+    } else if (op->is_intrinsic(Call::store_fence)) {
+        // A full fence, because on x86 release fences don't order
+        // non-temporal stores.
+        builder->CreateFence(AtomicOrdering::SequentiallyConsistent);
+        value = ConstantInt::get(i32_t, 0);
     } else if (op->is_intrinsic(Call::strict_float)) {
         IRBuilder<llvm::ConstantFolder, llvm::IRBuilderDefaultInserter>::FastMathFlagGuard guard(*builder);
         llvm::FastMathFlags safe_flags;
@@ -3730,6 +3864,12 @@ void CodeGen_LLVM::visit(const For *op) {
 }
 
 void CodeGen_LLVM::visit(const Store *op) {
+    if (const Call *nontemporal = Call::as_intrinsic(op->value, {Call::nontemporal_store})) {
+        ScopedValue<bool> old_emit_nontemporal_stores(emit_nontemporal_stores, true);
+        codegen(Store::make(op->name, nontemporal->args[0], op->index, op->param, op->predicate, op->alignment));
+        return;
+    }
+
     if (!emit_atomic_stores) {
         // Peel lets off the index to make us more likely to pattern
         // match a ramp.
@@ -3773,6 +3913,11 @@ void CodeGen_LLVM::visit(const Store *op) {
         add_tbaa_metadata(store, op->name, index);
         if (emit_atomic_stores) {
             store->setAtomic(AtomicOrdering::Monotonic);
+        } else if (emit_nontemporal_stores) {
+            // LLVM only emits a non-temporal store instruction if the
+            // store is suitably aligned, and a regular store otherwise.
+            llvm::Metadata *one = ConstantAsMetadata::get(ConstantInt::get(i32_t, 1));
+            store->setMetadata(LLVMContext::MD_nontemporal, MDNode::get(*context, {one}));
         }
     };
 
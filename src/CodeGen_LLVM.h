@@ -174,6 +174,10 @@ protected:
     /** The target we're generating code for */
     Halide::Target target;
 
+    /** The target-cpu and target-features attributes of functions
+     * compiled for more target features than the rest of the module. */
+    std::map<llvm::Function *, std::pair<std::string, std::string>> function_target_attributes;
+
     /** Grab all the context specific internal state. */
     virtual void init_context();
     /** Initialize the CodeGen_LLVM internal state to compile a fresh
@@ -531,6 +535,12 @@ protected:
     /** Emit atomic store instructions? */
     bool emit_atomic_stores = false;
 
+    /** Emit non-temporal store instructions? */
+    bool emit_nontemporal_stores = false;
+
+    /** Skip LLVM's optimization passes? Set from the Module being compiled. */
+    bool skip_llvm_optimization = false;
+
     /** Can we call this operation with float16 type?
         This is used to avoid "emulated" equivalent code-gen in case target has FP16 feature **/
     virtual bool supports_call_as_float16(const Call *op) const;
@@ -706,6 +716,11 @@ private:
     llvm::Function *add_argv_wrapper(llvm::Function *fn, const std::string &name,
                                      bool result_in_argv, std::vector<bool> &arg_is_buffer);
 
+    /** Add a function with the given name that makes a batch of calls to
+     * the given argv wrapper via halide_do_batch_argv. */
+    llvm::Function *add_batch_wrapper(llvm::Function *argv_fn, const std::string &name,
+                                      const std::vector<LoweredArgument> &args);
+
     llvm::Value *codegen_vector_load(const Type &type, const std::string &name, const Expr &base,
                                      const Buffer<> &image, const Parameter &param, const ModulusRemainder &alignment,
                                      llvm::Value *vpred = nullptr, bool slice_to_native = true, llvm::Value *stride = nullptr);
@@ -1,4 +1,5 @@
 #include <algorithm>
+#include <set>
 #include <sstream>
 #include <utility>
 
@@ -7,6 +8,7 @@
 #include "CodeGen_Internal.h"
 #include "CodeGen_Metal_Dev.h"
 #include "Debug.h"
+#include "ExtractTileOperations.h"
 #include "IROperator.h"
 
 namespace Halide {
@@ -49,6 +51,10 @@ public:
         return "metal";
     }
 
+    std::unique_ptr<CodeGen_GPU_Dev> new_kernel_compiler() override;
+
+    void append_kernels(CodeGen_GPU_Dev &kernel_compiler) override;
+
     bool kernel_run_takes_types() const override {
         return true;
     }
@@ -80,6 +86,12 @@ protected:
 
         std::string get_memory_space(const std::string &);
 
+        // Helpers for the halide_metal_simdgroup_* calls: declare a
+        // SIMD-group matrix of the given element type, and make a
+        // pointer to an operand tile.
+        std::string print_simdgroup_matrix(Type t);
+        std::string print_simdgroup_pointer(Type t, const Expr &buffer, const Expr &base);
+
         std::string shared_name;
 
         void visit(const Min *) override;
@@ -265,9 +277,6 @@ void CodeGen_Metal_Dev::CodeGen_Metal_C::visit(const Mod *op) {
 }
 
 void CodeGen_Metal_Dev::CodeGen_Metal_C::visit(const For *loop) {
-    user_assert(loop->for_type != ForType::GPULane)
-        << "The Metal backend does not support the gpu_lanes() scheduling directive.";
-
     if (is_gpu(loop->for_type)) {
         internal_assert(is_const_zero(loop->min));
 
@@ -331,6 +340,56 @@ void CodeGen_Metal_Dev::CodeGen_Metal_C::visit(const Call *op) {
         }
         stream << ");\n";
         print_assignment(op->type, "0");
+    } else if (starts_with(op->name, "halide_gpu_shuffle_")) {
+        // Shuffles across the lanes of a gpu_lanes() loop, which is a
+        // contiguous, aligned part of a SIMD-group.
+        internal_assert(op->args.size() == 3);
+        string value = print_expr(op->args[0]);
+        string arg = print_expr(op->args[1]);
+        ostringstream rhs;
+        if (op->name == "halide_gpu_shuffle_down") {
+            rhs << "simd_shuffle_down(" << value << ", (ushort)" << arg << ")";
+        } else if (op->name == "halide_gpu_shuffle_up") {
+            rhs << "simd_shuffle_up(" << value << ", (ushort)" << arg << ")";
+        } else {
+            internal_assert(op->name == "halide_gpu_shuffle_idx");
+            auto warp_size = as_const_int(op->args[2]);
+            internal_assert(warp_size);
+            rhs << "simd_shuffle(" << value << ", (ushort)((_halide_simd_lane & ~"
+                << (*warp_size - 1) << "u) + " << arg << "))";
+        }
+        print_assignment(op->type, rhs.str());
+    } else if (op->name == "halide_metal_simdgroup_mma") {
+        // See extract_warp_tile_operations
+        internal_assert(op->args.size() == 10);
+        const Type t = op->args[8].type();
+        string a = print_simdgroup_matrix(t);
+        string b = print_simdgroup_matrix(t);
+        string c = print_simdgroup_matrix(op->type.element_of());
+        stream << get_indent() << "simdgroup_load(" << a << ", "
+               << print_simdgroup_pointer(t, op->args[0], op->args[1]) << ", "
+               << print_expr(op->args[2]) << ", ulong2(0, 0), "
+               << (is_const_one(op->args[3]) ? "true" : "false") << ");\n";
+        stream << get_indent() << "simdgroup_load(" << b << ", "
+               << print_simdgroup_pointer(t, op->args[4], op->args[5]) << ", "
+               << print_expr(op->args[6]) << ", ulong2(0, 0), "
+               << (is_const_one(op->args[7]) ? "true" : "false") << ");\n";
+        string fragment = print_expr(op->args[9]);
+        stream << get_indent() << c << ".thread_elements() = " << fragment << ";\n";
+        stream << get_indent() << "simdgroup_multiply_accumulate("
+               << c << ", " << a << ", " << b << ", " << c << ");\n";
+        print_assignment(op->type, c + ".thread_elements()");
+    } else if (op->name == "halide_metal_simdgroup_store") {
+        internal_assert(op->args.size() == 5);
+        const Type t = op->args[4].type().element_of();
+        string c = print_simdgroup_matrix(t);
+        string fragment = print_expr(op->args[4]);
+        stream << get_indent() << c << ".thread_elements() = " << fragment << ";\n";
+        stream << get_indent() << "simdgroup_store(" << c << ", "
+               << print_simdgroup_pointer(t, op->args[0], op->args[1]) << ", "
+               << print_expr(op->args[2]) << ", ulong2(0, 0), "
+               << (is_const_one(op->args[3]) ? "true" : "false") << ");\n";
+        print_assignment(op->type, "0");
     } else {
         CodeGen_GPU_C::visit(op);
     }
@@ -353,6 +412,20 @@ Expr is_ramp_one(const Expr &e) {
 }
 }  // namespace
 
+string CodeGen_Metal_Dev::CodeGen_Metal_C::print_simdgroup_matrix(Type t) {
+    string id = unique_name('_');
+    stream << get_indent() << "simdgroup_" << (t.bits() == 16 ? "half" : "float") << "8x8 " << id << ";\n";
+    return id;
+}
+
+string CodeGen_Metal_Dev::CodeGen_Metal_C::print_simdgroup_pointer(Type t, const Expr &buffer, const Expr &base) {
+    const StringImm *name = buffer.as<StringImm>();
+    internal_assert(name);
+    string id_base = print_expr(base);
+    return "(" + get_memory_space(name->value) + " " + print_type(t) + " *)" +
+           print_name(name->value) + " + " + id_base;
+}
+
 string CodeGen_Metal_Dev::CodeGen_Metal_C::get_memory_space(const string &buf) {
     if (buf == shared_name) {
         return "threadgroup";
@@ -600,6 +673,54 @@ void CodeGen_Metal_Dev::CodeGen_Metal_C::visit(const FloatImm *op) {
         }
     }
 }
+namespace {
+
+// The SIMD-group matrix instructions that MemoryType::SimdgroupMatrix
+// tiles are computed with: 8x8x8 matrix multiply-accumulates.
+WarpTileInfo simdgroup_matrix_tile_info() {
+    WarpTileInfo info;
+    info.memory_type = MemoryType::SimdgroupMatrix;
+    info.tile_size = 8;
+    // Each thread of the SIMD-group holds two elements of each matrix
+    // (see simdgroup_matrix::thread_elements()).
+    info.fragment_lanes = 2;
+    info.accumulator_types = {Float(32), Float(16)};
+    info.operand_types = "float32 or float16";
+    info.check_types = [](const string &acc_name, const Type &t, const Type &acc_type) {
+        if (t != Float(32) && t != Float(16)) {
+            return false;
+        }
+        user_assert(t == acc_type)
+            << "SimdgroupMatrix " << acc_name << " of " << t
+            << " products must accumulate in " << t << ", not " << acc_type << "\n";
+        return true;
+    };
+    info.intrinsic_prefix = "halide_metal_simdgroup";
+    return info;
+}
+
+// The buffers the SIMD-group matrix instructions access, which can't
+// be in the constant address space.
+class FindSimdgroupMatrixBuffers : public IRVisitor {
+    using IRVisitor::visit;
+
+    void visit(const Call *op) override {
+        if (starts_with(op->name, "halide_metal_simdgroup_")) {
+            for (const Expr &arg : op->args) {
+                if (const StringImm *name = arg.as<StringImm>()) {
+                    buffers.insert(name->value);
+                }
+            }
+        }
+        IRVisitor::visit(op);
+    }
+
+public:
+    std::set<string> buffers;
+};
+
+}  // namespace
+
 void CodeGen_Metal_Dev::add_kernel(Stmt s,
                                    const string &name,
                                    const vector<DeviceArgument> &args) {
@@ -609,6 +730,8 @@ void CodeGen_Metal_Dev::add_kernel(Stmt s,
     // support predication.
     s = scalarize_predicated_loads_stores(s);
 
+    s = extract_warp_tile_operations(s, simdgroup_matrix_tile_info());
+
     debug(2) << "CodeGen_Metal_Dev: after removing predication: \n"
              << s;
 
@@ -648,10 +771,13 @@ void CodeGen_Metal_Dev::CodeGen_Metal_C::add_kernel(const Stmt &s,
     //   buffer size given by CL_DEVICE_MAX_CONSTANT_BUFFER_SIZE.
     // The last condition is handled via the preprocessor in the kernel
     // declaration.
+    FindSimdgroupMatrixBuffers simdgroup_matrix_buffers;
+    s.accept(&simdgroup_matrix_buffers);
     vector<BufferSize> constants;
     for (const auto &arg : args) {
         if (arg.is_buffer &&
             CodeGen_GPU_Dev::is_buffer_constant(s, arg.name) &&
+            !simdgroup_matrix_buffers.buffers.count(arg.name) &&
             arg.size > 0) {
             constants.emplace_back(arg.name, arg.size);
         }
@@ -713,6 +839,9 @@ void CodeGen_Metal_Dev::CodeGen_Metal_C::add_kernel(const Stmt &s,
     stream << "kernel void " << name << "(\n";
     stream << "uint3 tgroup_index [[ threadgroup_position_in_grid ]],\n"
            << "uint3 tid_in_tgroup [[ thread_position_in_threadgroup ]]";
+    if (CodeGen_GPU_Dev::uses_subgroup_shuffles(s)) {
+        stream << ",\nuint _halide_simd_lane [[ thread_index_in_simdgroup ]]";
+    }
     size_t buffer_index = 0;
     if (any_scalar_args) {
         stream << ",\nconst device " << name << "_args *_scalar_args [[ buffer(0) ]]";
@@ -901,6 +1030,16 @@ std::string CodeGen_Metal_Dev::print_gpu_name(const std::string &name) {
     return name;
 }
 
+std::unique_ptr<CodeGen_GPU_Dev> CodeGen_Metal_Dev::new_kernel_compiler() {
+    // Each kernel's source is self-contained, so kernels can be printed
+    // into separate streams and concatenated after the module preamble.
+    return std::make_unique<CodeGen_Metal_Dev>(metal_c.get_target());
+}
+
+void CodeGen_Metal_Dev::append_kernels(CodeGen_GPU_Dev &kernel_compiler) {
+    src_stream << static_cast<CodeGen_Metal_Dev &>(kernel_compiler).src_stream.str();
+}
+
 }  // namespace
 
 std::unique_ptr<CodeGen_GPU_Dev> new_CodeGen_Metal_Dev(const Target &target) {
@@ -55,6 +55,10 @@ public:
         return "opencl";
     }
 
+    std::unique_ptr<CodeGen_GPU_Dev> new_kernel_compiler() override;
+
+    void append_kernels(CodeGen_GPU_Dev &kernel_compiler) override;
+
 protected:
     class CodeGen_OpenCL_C : public CodeGen_GPU_C {
     public:
@@ -205,9 +209,6 @@ string simt_intrinsic(const string &name) {
 }  // namespace
 
 void CodeGen_OpenCL_Dev::CodeGen_OpenCL_C::visit(const For *loop) {
-    user_assert(loop->for_type != ForType::GPULane)
-        << "The OpenCL backend does not support the gpu_lanes() scheduling directive.";
-
     if (is_gpu(loop->for_type)) {
         internal_assert(is_const_zero(loop->min));
 
@@ -314,6 +315,26 @@ void CodeGen_OpenCL_Dev::CodeGen_OpenCL_C::visit(const Call *op) {
         ostringstream rhs;
         rhs << "abs_diff(" << print_expr(op->args[0]) << ", " << print_expr(op->args[1]) << ")";
         print_assignment(op->type, rhs.str());
+    } else if (starts_with(op->name, "halide_gpu_shuffle_")) {
+        // Shuffles across the lanes of a gpu_lanes() loop, which is a
+        // contiguous, aligned part of a subgroup. These need the
+        // cl_khr_subgroup_shuffle(_relative) extensions.
+        internal_assert(op->args.size() == 3);
+        string value = print_expr(op->args[0]);
+        string arg = print_expr(op->args[1]);
+        ostringstream rhs;
+        if (op->name == "halide_gpu_shuffle_down") {
+            rhs << "sub_group_shuffle_down(" << value << ", (uint)" << arg << ")";
+        } else if (op->name == "halide_gpu_shuffle_up") {
+            rhs << "sub_group_shuffle_up(" << value << ", (uint)" << arg << ")";
+        } else {
+            internal_assert(op->name == "halide_gpu_shuffle_idx");
+            auto warp_size = as_const_int(op->args[2]);
+            internal_assert(warp_size);
+            rhs << "sub_group_shuffle(" << value << ", (get_sub_group_local_id() & ~"
+                << (*warp_size - 1) << "u) + (uint)" << arg << ")";
+        }
+        print_assignment(op->type, rhs.str());
     } else if (op->is_intrinsic(Call::gpu_thread_barrier)) {
         internal_assert(op->args.size() == 1) << "gpu_thread_barrier() intrinsic must specify memory fence type.\n";
 
@@ -1224,6 +1245,14 @@ void CodeGen_OpenCL_Dev::init_module() {
         src_stream << "#pragma OPENCL EXTENSION cl_khr_int64_extended_atomics : enable\n";
     }
 
+    // Used by kernels with gpu_lanes() loops, if the device has them.
+    src_stream << "#ifdef cl_khr_subgroup_shuffle\n"
+               << "#pragma OPENCL EXTENSION cl_khr_subgroup_shuffle : enable\n"
+               << "#endif\n"
+               << "#ifdef cl_khr_subgroup_shuffle_relative\n"
+               << "#pragma OPENCL EXTENSION cl_khr_subgroup_shuffle_relative : enable\n"
+               << "#endif\n";
+
     src_stream << "\n";
 
     // Add at least one kernel to avoid errors on some implementations for functions
@@ -1254,6 +1283,16 @@ std::string CodeGen_OpenCL_Dev::print_gpu_name(const std::string &name) {
     return name;
 }
 
+std::unique_ptr<CodeGen_GPU_Dev> CodeGen_OpenCL_Dev::new_kernel_compiler() {
+    // Each kernel's source is self-contained, so kernels can be printed
+    // into separate streams and concatenated after the module preamble.
+    return std::make_unique<CodeGen_OpenCL_Dev>(clc.get_target());
+}
+
+void CodeGen_OpenCL_Dev::append_kernels(CodeGen_GPU_Dev &kernel_compiler) {
+    src_stream << static_cast<CodeGen_OpenCL_Dev &>(kernel_compiler).src_stream.str();
+}
+
 }  // namespace
 
 std::unique_ptr<CodeGen_GPU_Dev> new_CodeGen_OpenCL_Dev(const Target &target) {
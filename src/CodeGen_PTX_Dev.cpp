@@ -7,11 +7,13 @@
 #include "ConciseCasts.h"
 #include "Debug.h"
 #include "ExprUsesVar.h"
+#include "ExtractTileOperations.h"
 #include "IREquality.h"
 #include "IRMatch.h"
 #include "IRMutator.h"
 #include "IROperator.h"
 #include "IRPrinter.h"
+#include "IRVisitor.h"
 #include "LLVM_Headers.h"
 #include "LLVM_Runtime_Linker.h"
 #include "Simplify.h"
@@ -19,6 +21,7 @@
 #include "Target.h"
 
 #include <fstream>
+#include <set>
 
 namespace Halide {
 namespace Internal {
@@ -83,6 +86,11 @@ protected:
     void codegen_vector_reduce(const VectorReduce *op, const Expr &init) override;
     // @}
 
+    /** Load a fragment of an operand of a WMMA matrix multiply, as the
+     * values of its registers. */
+    std::vector<llvm::Value *> codegen_wmma_load(const std::string &frag, const Type &t, bool col_major,
+                                                 const std::string &buffer, const Expr &index, const Expr &stride);
+
     std::string march() const;
     std::string mcpu_target() const override;
     std::string mcpu_tune() const override;
@@ -127,6 +135,260 @@ Type CodeGen_PTX_Dev::upgrade_type_for_storage(const Type &t) const {
     return CodeGen_LLVM::upgrade_type_for_storage(t);
 }
 
+// The buffers loaded from and stored to, and the functions called, by
+// some IR.
+class FindBufferUses : public IRVisitor {
+    using IRVisitor::visit;
+
+    void visit(const Load *op) override {
+        loads.insert(op->name);
+        IRVisitor::visit(op);
+    }
+
+    void visit(const Store *op) override {
+        stores.insert(op->name);
+        IRVisitor::visit(op);
+    }
+
+    void visit(const Call *op) override {
+        calls.insert(op->name);
+        IRVisitor::visit(op);
+    }
+
+public:
+    std::set<std::string> loads, stores, calls;
+};
+
+// On sm_80 and up, copies from global to shared memory can be done with
+// cp.async, which skips the registers and doesn't stall the thread until
+// the data is needed. Stores to shared memory of values loaded straight
+// from global memory (e.g. the tiles of the inputs that a schedule stages
+// in shared memory) are turned into calls to halide_ptx_cp_async.
+class UseAsyncCopies : public IRMutator {
+    using IRMutator::visit;
+
+    Stmt visit(const Allocate *op) override {
+        allocated.insert(op->name);
+        if (op->memory_type == MemoryType::GPUShared) {
+            shared.insert(op->name);
+        }
+        return IRMutator::visit(op);
+    }
+
+    Stmt visit(const Atomic *op) override {
+        return op;
+    }
+
+    Stmt visit(const Store *op) override {
+        const Load *load = op->value.as<Load>();
+        if (!shared.count(op->name) ||
+            !load ||
+            allocated.count(load->name) ||
+            written.count(load->name) ||
+            !is_const_one(op->predicate) ||
+            !is_const_one(load->predicate)) {
+            return op;
+        }
+
+        // cp.async copies 4, 8, or 16 bytes, which must be aligned to
+        // the size of the copy.
+        const Type t = load->type;
+        const int bytes = t.bytes() * t.lanes();
+        if (bytes != 4 && bytes != 8 && bytes != 16) {
+            return op;
+        }
+        Expr dst_index = op->index, src_index = load->index;
+        if (t.is_vector()) {
+            const Ramp *dst_ramp = op->index.as<Ramp>();
+            const Ramp *src_ramp = load->index.as<Ramp>();
+            if (!dst_ramp || !src_ramp ||
+                !is_const_one(dst_ramp->stride) || !is_const_one(src_ramp->stride) ||
+                op->alignment.modulus % t.lanes() != 0 || op->alignment.remainder % t.lanes() != 0 ||
+                load->alignment.modulus % t.lanes() != 0 || load->alignment.remainder % t.lanes() != 0) {
+                return op;
+            }
+            dst_index = dst_ramp->base;
+            src_index = src_ramp->base;
+        }
+
+        return Evaluate::make(Call::make(Int(32), "halide_ptx_cp_async",
+                                         {StringImm::make(op->name), dst_index,
+                                          StringImm::make(load->name), src_index,
+                                          make_zero(t.element_of()), bytes},
+                                         Call::Extern));
+    }
+
+    std::set<std::string> allocated, shared, written;
+
+public:
+    UseAsyncCopies(const Stmt &s) {
+        // Don't copy asynchronously from buffers the kernel also writes to.
+        FindBufferUses uses;
+        s.accept(&uses);
+        written = std::move(uses.stores);
+    }
+
+    const std::set<std::string> &shared_allocations() const {
+        return shared;
+    }
+};
+
+// Wait for the copies in flight (with cp.async.wait_all) before the
+// shared memory they write can be read: before each barrier, for the
+// other threads, and before each read of shared memory by the thread
+// itself. This is a conservative dataflow analysis of whether there may
+// be copies in flight at each point.
+class InsertAsyncCopyWaits : public IRMutator {
+    using IRMutator::visit;
+
+    const std::set<std::string> &shared;
+    bool in_flight = false;
+
+    static bool is_call_to(const Stmt &s, const std::string &name) {
+        const Evaluate *e = s.as<Evaluate>();
+        const Call *c = e ? e->value.as<Call>() : nullptr;
+        return c && c->name == name;
+    }
+
+    template<typename T>
+    bool reads_shared(const T &node) const {
+        FindBufferUses uses;
+        node.accept(&uses);
+        for (const auto &name : uses.loads) {
+            if (shared.count(name)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    static Stmt wait(const Stmt &s) {
+        Stmt w = Evaluate::make(Call::make(Int(32), "halide_ptx_cp_async_wait_all", {}, Call::Extern));
+        return Block::make(w, s);
+    }
+
+    Stmt visit(const Evaluate *op) override {
+        if (is_call_to(op, "halide_ptx_cp_async")) {
+            in_flight = true;
+            return op;
+        }
+        const Call *c = op->value.as<Call>();
+        if (in_flight && ((c && c->is_intrinsic(Call::gpu_thread_barrier)) || reads_shared(op->value))) {
+            in_flight = false;
+            return wait(op);
+        }
+        return op;
+    }
+
+    Stmt visit(const Store *op) override {
+        if (in_flight && (reads_shared(op->value) || reads_shared(op->index) || reads_shared(op->predicate))) {
+            in_flight = false;
+            return wait(op);
+        }
+        return op;
+    }
+
+    Stmt visit(const LetStmt *op) override {
+        bool wait_first = in_flight && reads_shared(op->value);
+        if (wait_first) {
+            in_flight = false;
+        }
+        Stmt s = IRMutator::visit(op);
+        return wait_first ? wait(s) : s;
+    }
+
+    Stmt visit(const AssertStmt *op) override {
+        if (in_flight && reads_shared(op->condition)) {
+            in_flight = false;
+            return wait(op);
+        }
+        return op;
+    }
+
+    Stmt visit(const IfThenElse *op) override {
+        bool wait_first = in_flight && reads_shared(op->condition);
+        if (wait_first) {
+            in_flight = false;
+        }
+        const bool before = in_flight;
+        Stmt then_case = mutate(op->then_case);
+        const bool after_then = in_flight;
+        in_flight = before;
+        Stmt else_case = op->else_case.defined() ? mutate(op->else_case) : Stmt();
+        in_flight = in_flight || after_then;
+        Stmt s = IfThenElse::make(op->condition, then_case, else_case);
+        return wait_first ? wait(s) : s;
+    }
+
+    Stmt visit(const For *op) override {
+        bool wait_first = in_flight && (reads_shared(op->min) || reads_shared(op->extent));
+        if (wait_first) {
+            in_flight = false;
+        }
+        // Copies started by one iteration may still be in flight at the
+        // start of the next.
+        FindBufferUses uses;
+        op->body.accept(&uses);
+        const bool copies_in_body = uses.calls.count("halide_ptx_cp_async");
+        const bool before = in_flight;
+        in_flight = in_flight || copies_in_body;
+        Stmt body = mutate(op->body);
+        in_flight = in_flight || before || copies_in_body;
+        Stmt s = For::make(op->name, op->min, op->extent, op->for_type, op->partition_policy, op->device_api, body);
+        return wait_first ? wait(s) : s;
+    }
+
+public:
+    InsertAsyncCopyWaits(const std::set<std::string> &shared)
+        : shared(shared) {
+    }
+
+    Stmt insert(const Stmt &s) {
+        Stmt result = mutate(s);
+        if (in_flight) {
+            // Don't exit the kernel with copies in flight.
+            result = Block::make(result, Evaluate::make(Call::make(Int(32), "halide_ptx_cp_async_wait_all", {}, Call::Extern)));
+        }
+        return result;
+    }
+};
+
+// The tensor core (WMMA) instructions that MemoryType::WMMAAccumulator
+// tiles are computed with: m16n16k16 matrix multiply-accumulates.
+WarpTileInfo wmma_tile_info(const Target &target) {
+    WarpTileInfo info;
+    info.memory_type = MemoryType::WMMAAccumulator;
+    info.tile_size = 16;
+    // The accumulator fragment of each thread of the warp, for all of
+    // the input types we support.
+    info.fragment_lanes = 8;
+    info.accumulator_types = {Float(32), Int(32)};
+    info.operand_types = "f16, bf16, or (u)int8";
+    info.check_types = [&target](const std::string &acc_name, const Type &t, const Type &acc_type) {
+        if (t == Float(16) || t == BFloat(16)) {
+            user_assert(acc_type == Float(32))
+                << "WMMAAccumulator " << acc_name << " of " << t
+                << " products must accumulate in float32, not " << acc_type << "\n";
+            const int capability = t == Float(16) ? 70 : 80;
+            user_assert(target.get_cuda_capability_lower_bound() >= capability)
+                << "WMMAAccumulator " << acc_name << " of " << t
+                << " products requires cuda_capability_" << capability << " or later.\n";
+            return true;
+        } else if (t == Int(8) || t == UInt(8)) {
+            user_assert(acc_type == Int(32))
+                << "WMMAAccumulator " << acc_name << " of " << t
+                << " products must accumulate in int32, not " << acc_type << "\n";
+            user_assert(target.get_cuda_capability_lower_bound() >= 75)
+                << "WMMAAccumulator " << acc_name << " of " << t
+                << " products requires cuda_capability_75 or later.\n";
+            return true;
+        }
+        return false;
+    };
+    info.intrinsic_prefix = "halide_ptx_wmma";
+    return info;
+}
+
 void CodeGen_PTX_Dev::add_kernel(Stmt stmt,
                                  const std::string &name,
                                  const std::vector<DeviceArgument> &args) {
@@ -149,10 +411,15 @@ void CodeGen_PTX_Dev::add_kernel(Stmt stmt,
     function = llvm::Function::Create(func_t, llvm::Function::ExternalLinkage, name, module.get());
     set_function_attributes_from_halide_target_options(*function);
 
-    // Mark the buffer args as no alias
+    // Mark the buffer args as no alias, and the ones the kernel only
+    // reads as read-only, which lets LLVM load them with ld.global.nc,
+    // through the read-only (texture) cache.
     for (size_t i = 0; i < args.size(); i++) {
         if (args[i].is_buffer) {
             function->addParamAttr(i, Attribute::NoAlias);
+            if (!args[i].write) {
+                function->addParamAttr(i, Attribute::ReadOnly);
+            }
         }
     }
 
@@ -181,6 +448,14 @@ void CodeGen_PTX_Dev::add_kernel(Stmt stmt,
     BasicBlock *body_block = BasicBlock::Create(*context, "body", function);
     builder->SetInsertPoint(body_block);
 
+    stmt = extract_warp_tile_operations(stmt, wmma_tile_info(target));
+
+    if (target.has_feature(Target::CUDACapability80)) {
+        UseAsyncCopies use_async_copies(stmt);
+        stmt = use_async_copies.mutate(stmt);
+        stmt = InsertAsyncCopyWaits(use_async_copies.shared_allocations()).insert(stmt);
+    }
+
     debug(1) << "Generating llvm bitcode for kernel...\n";
     // Ok, we have a module, function, context, and a builder
     // pointing at a brand new basic block. We're good to go.
@@ -265,6 +540,101 @@ void CodeGen_PTX_Dev::visit(const Call *op) {
         builder->CreateCall(barrier0);
         value = ConstantInt::get(i32_t, 0);
         return;
+    } else if (op->name == "halide_ptx_cp_async") {
+        // See UseAsyncCopies
+        internal_assert(op->args.size() == 6);
+        const StringImm *dst = op->args[0].as<StringImm>();
+        const StringImm *src = op->args[2].as<StringImm>();
+        const int64_t *bytes = as_const_int(op->args[5]);
+        internal_assert(dst && src && bytes);
+        Type t = op->args[4].type();
+        Value *dst_ptr = codegen_buffer_pointer(dst->value, t, op->args[1]);
+        Value *src_ptr = codegen_buffer_pointer(src->value, t, op->args[3]);
+        llvm::Type *shared_ptr_t = PointerType::get(*context, 3);
+        llvm::Type *global_ptr_t = PointerType::get(*context, 1);
+        internal_assert(dst_ptr->getType() == shared_ptr_t);
+        src_ptr = builder->CreateAddrSpaceCast(src_ptr, global_ptr_t);
+        FunctionType *fn_t = FunctionType::get(void_t, {shared_ptr_t, global_ptr_t}, false);
+        std::string name = "llvm.nvvm.cp.async.ca.shared.global." + std::to_string(*bytes);
+        builder->CreateCall(module->getOrInsertFunction(name, fn_t), {dst_ptr, src_ptr});
+        value = ConstantInt::get(i32_t, 0);
+        return;
+    } else if (op->name == "halide_ptx_cp_async_wait_all") {
+        FunctionType *fn_t = FunctionType::get(void_t, {}, false);
+        builder->CreateCall(module->getOrInsertFunction("llvm.nvvm.cp.async.wait.all", fn_t));
+        value = ConstantInt::get(i32_t, 0);
+        return;
+    } else if (op->name == "halide_ptx_wmma_mma") {
+        // See extract_warp_tile_operations
+        internal_assert(op->args.size() == 10);
+        const StringImm *a = op->args[0].as<StringImm>();
+        const StringImm *b = op->args[4].as<StringImm>();
+        internal_assert(a && b);
+        const Type t = op->args[8].type();
+        const bool a_col = is_const_one(op->args[3]);
+        const bool b_col = is_const_one(op->args[7]);
+        std::vector<Value *> args = codegen_wmma_load("a", t, a_col, a->value, op->args[1], op->args[2]);
+        std::vector<Value *> b_regs = codegen_wmma_load("b", t, b_col, b->value, op->args[5], op->args[6]);
+        args.insert(args.end(), b_regs.begin(), b_regs.end());
+        Value *c = codegen(op->args[9]);
+        for (int i = 0; i < op->type.lanes(); i++) {
+            args.push_back(builder->CreateExtractElement(c, ConstantInt::get(i32_t, i)));
+        }
+
+        std::string types;
+        if (t == Float(16)) {
+            // The types of d and c
+            types = "f32.f32";
+        } else if (t == BFloat(16)) {
+            types = "bf16";
+        } else if (t == Int(8)) {
+            types = "s8";
+        } else {
+            internal_assert(t == UInt(8));
+            types = "u8";
+        }
+        std::string name = std::string("llvm.nvvm.wmma.m16n16k16.mma.") +
+                           (a_col ? "col." : "row.") + (b_col ? "col." : "row.") + types;
+        llvm::Type *elem_t = llvm_type_of(op->type.element_of());
+        std::vector<llvm::Type *> arg_types;
+        for (Value *v : args) {
+            arg_types.push_back(v->getType());
+        }
+        llvm::Type *ret_t = StructType::get(*context, std::vector<llvm::Type *>(op->type.lanes(), elem_t));
+        FunctionType *fn_t = FunctionType::get(ret_t, arg_types, false);
+        Value *d = builder->CreateCall(module->getOrInsertFunction(name, fn_t), args);
+        value = UndefValue::get(llvm_type_of(op->type));
+        for (int i = 0; i < op->type.lanes(); i++) {
+            Value *v = builder->CreateExtractValue(d, {(unsigned)i});
+            value = builder->CreateInsertElement(value, v, ConstantInt::get(i32_t, i));
+        }
+        return;
+    } else if (op->name == "halide_ptx_wmma_store") {
+        // See extract_warp_tile_operations
+        internal_assert(op->args.size() == 5);
+        const StringImm *dst = op->args[0].as<StringImm>();
+        internal_assert(dst);
+        const Type t = op->args[4].type();
+        const bool col = is_const_one(op->args[3]);
+        Value *ptr = codegen_buffer_pointer(dst->value, t.element_of(), op->args[1]);
+        std::vector<Value *> args = {ptr};
+        Value *d = codegen(op->args[4]);
+        for (int i = 0; i < t.lanes(); i++) {
+            args.push_back(builder->CreateExtractElement(d, ConstantInt::get(i32_t, i)));
+        }
+        args.push_back(codegen(op->args[2]));
+        std::vector<llvm::Type *> arg_types;
+        for (Value *v : args) {
+            arg_types.push_back(v->getType());
+        }
+        std::string name = std::string("llvm.nvvm.wmma.m16n16k16.store.d.") +
+                           (col ? "col" : "row") + ".stride." +
+                           (t.is_float() ? "f32" : "s32") +
+                           ".p" + std::to_string(ptr->getType()->getPointerAddressSpace());
+        FunctionType *fn_t = FunctionType::get(void_t, arg_types, false);
+        builder->CreateCall(module->getOrInsertFunction(name, fn_t), args);
+        value = ConstantInt::get(i32_t, 0);
+        return;
     }
 
     // TODO: It would be better if CodeGen_LLVM could handle overloaded intrin calls by default.
@@ -274,6 +644,41 @@ void CodeGen_PTX_Dev::visit(const Call *op) {
     }
 }
 
+std::vector<Value *> CodeGen_PTX_Dev::codegen_wmma_load(const std::string &frag, const Type &t, bool col_major,
+                                                        const std::string &buffer, const Expr &index, const Expr &stride) {
+    // The registers of the fragments of the m16n16k16 shape.
+    int regs;
+    llvm::Type *reg_t;
+    std::string type_name;
+    if (t == Float(16)) {
+        regs = 8;
+        reg_t = get_vector_type(llvm_type_of(Float(16)), 2);
+        type_name = "f16";
+    } else if (t == BFloat(16)) {
+        regs = 4;
+        reg_t = i32_t;
+        type_name = "bf16";
+    } else {
+        internal_assert(t == Int(8) || t == UInt(8));
+        regs = 2;
+        reg_t = i32_t;
+        type_name = t.is_int() ? "s8" : "u8";
+    }
+
+    Value *ptr = codegen_buffer_pointer(buffer, t, index);
+    std::string name = "llvm.nvvm.wmma.m16n16k16.load." + frag +
+                       (col_major ? ".col" : ".row") + ".stride." + type_name +
+                       ".p" + std::to_string(ptr->getType()->getPointerAddressSpace());
+    llvm::Type *ret_t = StructType::get(*context, std::vector<llvm::Type *>(regs, reg_t));
+    FunctionType *fn_t = FunctionType::get(ret_t, {ptr->getType(), i32_t}, false);
+    Value *f = builder->CreateCall(module->getOrInsertFunction(name, fn_t), {ptr, codegen(stride)});
+    std::vector<Value *> result(regs);
+    for (int i = 0; i < regs; i++) {
+        result[i] = builder->CreateExtractValue(f, {(unsigned)i});
+    }
+    return result;
+}
+
 string CodeGen_PTX_Dev::simt_intrinsic(const string &name) {
     if (ends_with(name, gpu_thread_name(0))) {
         return "llvm.nvvm.read.ptx.sreg.tid.x";
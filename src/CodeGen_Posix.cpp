@@ -88,6 +88,7 @@ CodeGen_Posix::Allocation CodeGen_Posix::create_allocation(const std::string &na
             const string str_max_size = target.has_large_buffers() ? "2^63 - 1" : "2^31 - 1";
             user_error << "Total size for allocation " << name << " is constant but exceeds " << str_max_size << ".";
         } else if (memory_type == MemoryType::Heap ||
+                   memory_type == MemoryType::Streaming ||
                    (memory_type != MemoryType::Register &&
                     !can_allocation_fit_on_stack(stack_bytes))) {
             // We should put the allocation on the heap if it's
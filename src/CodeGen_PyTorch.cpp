@@ -1,3 +1,4 @@
+#include <cstring>
 #include <iostream>
 
 #include "CodeGen_C.h"
@@ -105,27 +106,29 @@ void CodeGen_PyTorch::compile(const LoweredFunc &f, bool is_cuda) {
         stream << get_indent() << "user_ctx.cuda_context = &ctx;\n";
         stream << get_indent() << "user_ctx.stream = &stream;\n";
         stream << get_indent() << "void* __user_context = (void*) &user_ctx;\n\n";
+        stream << get_indent() << "// Pool freed device allocations for reuse, since allocating and\n";
+        stream << get_indent() << "// freeing CUDA memory synchronizes with the device.\n";
+        stream << get_indent() << "static const bool reuse_device_allocations =\n";
+        stream << get_indent() << "    (halide_reuse_device_allocations(nullptr, true), true);\n";
+        stream << get_indent() << "(void)reuse_device_allocations;\n\n";
     } else {
         stream << get_indent() << "void* __user_context = nullptr;\n\n";
     }
 
-    stream << get_indent() << "// Check tensors have contiguous memory and are on the correct device\n";
-    for (auto &buffer_arg : buffer_args) {
-        stream << get_indent();
-        stream
-            << "HLPT_CHECK_CONTIGUOUS("
-            << c_print_name(buffer_arg.name)
-            << ");\n";
-
-        if (is_cuda) {
+    // Tensors are wrapped with their strides, so they don't need to be
+    // contiguous; the pipeline checks them against its own stride
+    // constraints.
+    if (is_cuda) {
+        stream << get_indent() << "// Check tensors are on the correct device\n";
+        for (auto &buffer_arg : buffer_args) {
             stream << get_indent();
             stream
                 << "HLPT_CHECK_DEVICE("
                 << c_print_name(buffer_arg.name)
                 << ", device_id);\n";
         }
+        stream << "\n";
     }
-    stream << "\n";
 
     stream << get_indent() << "// Wrap tensors in Halide buffers\n";
     for (auto &buffer_arg : buffer_args) {
@@ -208,6 +211,8 @@ void CodeGen_PyTorch::compile(const LoweredFunc &f, bool is_cuda) {
     indent -= 4;
     stream << "}\n";
 
+    compile_autograd(f, simple_name);
+
     if (!namespaces.empty()) {
         stream << "\n";
         for (const auto &ns : reverse_view(namespaces)) {
@@ -217,5 +222,230 @@ void CodeGen_PyTorch::compile(const LoweredFunc &f, bool is_cuda) {
     }
 }
 
+namespace {
+
+// The names build_gradient_module gives the arguments of a gradient
+// pipeline.
+const char *const grad_input_prefix = "_grad_loss_for_";
+const char *const grad_output_prefix = "_grad_loss_";
+const char *const dummy_prefix = "_dummy";
+
+// How to save a scalar in an AutogradContext's saved_data, and read it
+// back.
+std::string ivalue_type(const Type &t) {
+    if (t.is_bool()) {
+        return "bool";
+    } else if (t.is_float()) {
+        return "double";
+    } else {
+        return "int64_t";
+    }
+}
+
+std::string ivalue_getter(const Type &t) {
+    if (t.is_bool()) {
+        return "toBool()";
+    } else if (t.is_float()) {
+        return "toDouble()";
+    } else {
+        return "toInt()";
+    }
+}
+
+}  // namespace
+
+void CodeGen_PyTorch::compile_autograd(const LoweredFunc &f, const std::string &simple_name) {
+    // Recognize a pipeline made by build_gradient_module: its inputs
+    // are the inputs of the original pipeline, followed by the
+    // gradients of the loss with respect to each original output, and
+    // its outputs are the gradients with respect to each pairing of
+    // original output and input buffer.
+    std::vector<LoweredArgument> forward_inputs;
+    std::vector<std::string> forward_outputs;
+    std::vector<LoweredArgument> grad_outputs;
+    for (const auto &arg : f.args) {
+        if (arg.name == "__user_context") {
+            continue;
+        } else if (arg.is_output()) {
+            grad_outputs.push_back(arg);
+        } else if (arg.is_buffer() && starts_with(arg.name, grad_input_prefix)) {
+            forward_outputs.push_back(arg.name.substr(strlen(grad_input_prefix)));
+        } else if (forward_outputs.empty()) {
+            if (!arg.is_buffer() && arg.type.is_handle()) {
+                return;
+            }
+            forward_inputs.push_back(arg);
+        } else {
+            return;
+        }
+    }
+    if (forward_outputs.empty() || grad_outputs.empty()) {
+        return;
+    }
+
+    // Map each gradient output to the original output and input it's
+    // the gradient of.
+    std::vector<std::pair<size_t, size_t>> grad_output_of;
+    for (const auto &arg : grad_outputs) {
+        std::string name = arg.name;
+        if (starts_with(name, dummy_prefix)) {
+            name = name.substr(strlen(dummy_prefix));
+        }
+        bool found = false;
+        for (size_t o = 0; o < forward_outputs.size() && !found; o++) {
+            const std::string prefix = grad_output_prefix + forward_outputs[o] + "_wrt_";
+            if (!starts_with(name, prefix)) {
+                continue;
+            }
+            const std::string input_name = name.substr(prefix.size());
+            for (size_t i = 0; i < forward_inputs.size(); i++) {
+                if (forward_inputs[i].is_buffer() && forward_inputs[i].name == input_name) {
+                    grad_output_of.emplace_back(o, i);
+                    found = true;
+                    break;
+                }
+            }
+        }
+        if (!found) {
+            return;
+        }
+    }
+
+    // The forward op's wrapper takes the original inputs and then
+    // the original outputs.
+    stream << "\n";
+    stream << "// A torch::autograd::Function that runs the op this pipeline is the\n";
+    stream << "// gradient of, Forward (the _th_ wrapper of that op), as its\n";
+    stream << "// forward pass, and this pipeline as its backward pass. apply() takes\n";
+    stream << "// the op's arguments, including its preallocated outputs, and returns\n";
+    stream << "// the outputs.\n";
+    stream << "template<int (*Forward)(";
+    for (size_t i = 0; i < forward_inputs.size(); i++) {
+        if (forward_inputs[i].is_buffer()) {
+            stream << "at::Tensor &, ";
+        } else {
+            stream << type_to_c_type(forward_inputs[i].type, false) << ", ";
+        }
+    }
+    for (size_t o = 0; o < forward_outputs.size(); o++) {
+        stream << "at::Tensor &" << (o + 1 < forward_outputs.size() ? ", " : "");
+    }
+    stream << ")>\n";
+    stream << "struct " << simple_name << "_autograd : public torch::autograd::Function<"
+           << simple_name << "_autograd<Forward>> {\n";
+    indent += 4;
+
+    // forward()
+    stream << get_indent() << "static torch::autograd::variable_list forward(torch::autograd::AutogradContext *ctx";
+    for (const auto &arg : forward_inputs) {
+        stream << ", ";
+        if (arg.is_buffer()) {
+            stream << "at::Tensor " << c_print_name(arg.name);
+        } else {
+            stream << type_to_c_type(arg.type, true) << c_print_name(arg.name);
+        }
+    }
+    for (const auto &name : forward_outputs) {
+        stream << ", at::Tensor " << c_print_name(name);
+    }
+    stream << ") {\n";
+    indent += 4;
+    stream << get_indent() << "ctx->save_for_backward({";
+    bool first = true;
+    for (const auto &arg : forward_inputs) {
+        if (arg.is_buffer()) {
+            stream << (first ? "" : ", ") << c_print_name(arg.name);
+            first = false;
+        }
+    }
+    stream << "});\n";
+    for (const auto &arg : forward_inputs) {
+        if (!arg.is_buffer()) {
+            stream << get_indent() << "ctx->saved_data[\"" << arg.name << "\"] = ("
+                   << ivalue_type(arg.type) << ")" << c_print_name(arg.name) << ";\n";
+        }
+    }
+    stream << get_indent() << "int err = Forward(";
+    for (const auto &arg : forward_inputs) {
+        stream << c_print_name(arg.name) << ", ";
+    }
+    for (size_t o = 0; o < forward_outputs.size(); o++) {
+        stream << c_print_name(forward_outputs[o]) << (o + 1 < forward_outputs.size() ? ", " : "");
+    }
+    stream << ");\n";
+    stream << get_indent() << "AT_ASSERTM(err == 0, \"Halide call failed\");\n";
+    stream << get_indent() << "ctx->mark_dirty({";
+    for (size_t o = 0; o < forward_outputs.size(); o++) {
+        stream << c_print_name(forward_outputs[o]) << (o + 1 < forward_outputs.size() ? ", " : "");
+    }
+    stream << "});\n";
+    stream << get_indent() << "return {";
+    for (size_t o = 0; o < forward_outputs.size(); o++) {
+        stream << c_print_name(forward_outputs[o]) << (o + 1 < forward_outputs.size() ? ", " : "");
+    }
+    stream << "};\n";
+    indent -= 4;
+    stream << get_indent() << "}\n\n";
+
+    // backward()
+    stream << get_indent() << "static torch::autograd::variable_list backward(torch::autograd::AutogradContext *ctx, "
+           << "torch::autograd::variable_list grad_outputs) {\n";
+    indent += 4;
+    stream << get_indent() << "auto saved = ctx->get_saved_variables();\n";
+    int saved_index = 0;
+    for (const auto &arg : forward_inputs) {
+        if (arg.is_buffer()) {
+            stream << get_indent() << "at::Tensor " << c_print_name(arg.name)
+                   << " = saved[" << saved_index++ << "];\n";
+        } else {
+            stream << get_indent() << type_to_c_type(arg.type, true) << c_print_name(arg.name)
+                   << " = (" << type_to_c_type(arg.type, false) << ")ctx->saved_data[\""
+                   << arg.name << "\"]." << ivalue_getter(arg.type) << ";\n";
+        }
+    }
+    for (size_t o = 0; o < forward_outputs.size(); o++) {
+        stream << get_indent() << "at::Tensor " << c_print_name(grad_input_prefix + forward_outputs[o])
+               << " = grad_outputs[" << o << "];\n";
+    }
+    for (size_t g = 0; g < grad_outputs.size(); g++) {
+        const LoweredArgument &input = forward_inputs[grad_output_of[g].second];
+        stream << get_indent() << "at::Tensor " << c_print_name(grad_outputs[g].name)
+               << " = at::empty_like(" << c_print_name(input.name) << ", "
+               << c_print_name(input.name) << ".options().dtype<"
+               << type_to_c_type(grad_outputs[g].type, false) << ">());\n";
+    }
+    stream << get_indent() << "int err = " << simple_name << "_th_(";
+    first = true;
+    for (const auto &arg : f.args) {
+        if (arg.name == "__user_context") {
+            continue;
+        }
+        stream << (first ? "" : ", ") << c_print_name(arg.name);
+        first = false;
+    }
+    stream << ");\n";
+    stream << get_indent() << "AT_ASSERTM(err == 0, \"Halide call failed\");\n";
+
+    // The gradient with respect to each input is the sum over the
+    // outputs; scalar inputs and the outputs themselves get none.
+    stream << get_indent() << "torch::autograd::variable_list grad_inputs(" << forward_inputs.size() + forward_outputs.size() << ");\n";
+    for (size_t i = 0; i < forward_inputs.size(); i++) {
+        for (size_t g = 0; g < grad_outputs.size(); g++) {
+            if (grad_output_of[g].second != i) {
+                continue;
+            }
+            stream << get_indent() << "grad_inputs[" << i << "] = grad_inputs[" << i << "].defined() ? "
+                   << "grad_inputs[" << i << "] + " << c_print_name(grad_outputs[g].name) << " : "
+                   << c_print_name(grad_outputs[g].name) << ";\n";
+        }
+    }
+    stream << get_indent() << "return grad_inputs;\n";
+    indent -= 4;
+    stream << get_indent() << "}\n";
+
+    indent -= 4;
+    stream << "};\n";
+}
+
 }  // namespace Internal
 }  // namespace Halide
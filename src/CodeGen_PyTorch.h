@@ -11,6 +11,10 @@
  * The generated code checks for runtime errors and raises PyTorch exception
  * accordingly. It also makes sure the GPU device and stream are consistent when
  * the PyTorch input, when applicable.
+ *
+ * For a pipeline built by Generator::build_gradient_module, it also emits a
+ * torch::autograd::Function that uses the pipeline as the backward pass of
+ * the op it is the gradient of.
  */
 
 #include "IRPrinter.h"
@@ -36,6 +40,11 @@ public:
 
 private:
     void compile(const LoweredFunc &func, bool is_cuda);
+
+    /** If func was made by build_gradient_module, emit an autograd
+     * Function that uses it as the backward pass of the op it's the
+     * gradient of. */
+    void compile_autograd(const LoweredFunc &func, const std::string &simple_name);
 };
 
 }  // namespace Internal
@@ -405,9 +405,6 @@ private:
 struct FindWorkGroupSize : public IRVisitor {
     using IRVisitor::visit;
     void visit(const For *loop) override {
-        user_assert(loop->for_type != ForType::GPULane)
-            << "The Vulkan backend does not support the gpu_lanes() scheduling directive.";
-
         if (is_gpu(loop->for_type)) {
 
             // This should always be true at this point in codegen
@@ -1073,6 +1070,61 @@ void CodeGen_Vulkan_Dev::SPIRV_Emitter::visit(const Call *op) {
         SpvId result_id = builder.declare_null_constant(op->type);
         builder.update_id(result_id);
 
+    } else if (starts_with(op->name, "halide_gpu_shuffle_")) {
+        // Shuffles across the lanes of a gpu_lanes() loop, which is a
+        // contiguous, aligned part of a subgroup.
+        internal_assert(op->args.size() == 3);
+        user_assert(target.has_feature(Target::VulkanV13))
+            << "The Vulkan backend requires the vulkan_v13 target feature to shuffle values "
+            << "between the lanes of a gpu_lanes() loop.\n";
+
+        // The non-uniform group operations need SPIR-V v1.3 (which Vulkan v1.1+ supports)
+        builder.set_version_format(0x00010300);
+        builder.require_capability(SpvCapabilityGroupNonUniform);
+
+        Type lane_type = UInt(32);
+        SpvId lane_type_id = builder.declare_type(lane_type);
+        op->args[1].accept(this);
+        SpvId arg_id = cast_type(lane_type, op->args[1].type(), builder.current_id());
+
+        SpvOp op_code = SpvOpNop;
+        SpvId lane_id = SpvInvalidId;
+        if (op->name == "halide_gpu_shuffle_down") {
+            builder.require_capability(SpvCapabilityGroupNonUniformShuffleRelative);
+            op_code = SpvOpGroupNonUniformShuffleDown;
+            lane_id = arg_id;
+        } else if (op->name == "halide_gpu_shuffle_up") {
+            builder.require_capability(SpvCapabilityGroupNonUniformShuffleRelative);
+            op_code = SpvOpGroupNonUniformShuffleUp;
+            lane_id = arg_id;
+        } else {
+            internal_assert(op->name == "halide_gpu_shuffle_idx");
+            builder.require_capability(SpvCapabilityGroupNonUniformShuffle);
+            op_code = SpvOpGroupNonUniformShuffle;
+
+            // The lane is relative to the start of the warp within the subgroup
+            auto warp_size = as_const_int(op->args[2]);
+            internal_assert(warp_size);
+            const std::string subgroup_lane_var_name = std::string("k") + std::to_string(kernel_index) + std::string("_SubgroupLocalInvocationId");
+            const auto *subgroup_lane = symbol_table.find(subgroup_lane_var_name);
+            internal_assert(subgroup_lane);
+            uint32_t warp_mask = ~(uint32_t)(*warp_size - 1);
+            SpvId warp_mask_id = builder.declare_constant(lane_type, &warp_mask);
+            SpvId warp_base_id = builder.reserve_id(SpvResultId);
+            builder.append(SpvFactory::bitwise_and(lane_type_id, warp_base_id, subgroup_lane->first, warp_mask_id));
+            lane_id = builder.reserve_id(SpvResultId);
+            builder.append(SpvFactory::integer_add(lane_type_id, lane_id, warp_base_id, arg_id));
+        }
+
+        op->args[0].accept(this);
+        SpvId value_id = builder.current_id();
+        uint32_t execution_scope = SpvScopeSubgroup;
+        SpvId exec_scope_id = builder.declare_constant(UInt(32), &execution_scope);
+        SpvId type_id = builder.declare_type(op->type);
+        SpvId result_id = builder.reserve_id(SpvResultId);
+        builder.append(SpvFactory::group_non_uniform_shuffle(op_code, type_id, result_id, exec_scope_id, value_id, lane_id));
+        builder.update_id(result_id);
+
     } else if (op->is_intrinsic(Call::abs)) {
         internal_assert(op->args.size() == 1);
 
@@ -2548,6 +2600,14 @@ class FindIntrinsicsUsed : public IRVisitor {
         op->body.accept(this);
     }
 
+    void visit(const Call *op) override {
+        if (op->name == "halide_gpu_shuffle_idx") {
+            // Shuffles of arbitrary lanes are relative to the subgroup lane
+            intrinsics_used.insert("SubgroupLocalInvocationId");
+        }
+        IRVisitor::visit(op);
+    }
+
 public:
     std::unordered_set<std::string> intrinsics_used;
     FindIntrinsicsUsed() = default;
@@ -2555,7 +2615,9 @@ public:
 
 // Map the SPIR-V builtin intrinsic name to its corresponding enum value
 SpvBuiltIn map_simt_builtin(const std::string &intrinsic_name) {
-    if (starts_with(intrinsic_name, "Workgroup")) {
+    if (starts_with(intrinsic_name, "Subgroup")) {
+        return SpvBuiltInSubgroupLocalInvocationId;
+    } else if (starts_with(intrinsic_name, "Workgroup")) {
         return SpvBuiltInWorkgroupId;
     } else if (starts_with(intrinsic_name, "Local")) {
         return SpvBuiltInLocalInvocationId;
@@ -2575,9 +2637,11 @@ void CodeGen_Vulkan_Dev::SPIRV_Emitter::declare_entry_point(const Stmt &s, SpvId
     SpvFactory::Variables entry_point_variables;
     for (const std::string &used_intrinsic : find_intrinsics.intrinsics_used) {
 
-        // The builtins are pointers to vec3 and can only be declared once per kernel entrypoint
+        // The builtins are pointers to vec3 (except for the scalar subgroup lane)
+        // and can only be declared once per kernel entrypoint
         SpvStorageClass storage_class = SpvStorageClassInput;
-        SpvId intrinsic_type_id = builder.declare_type(Type(Type::UInt, 32, 3));
+        const int intrinsic_lanes = starts_with(used_intrinsic, "Subgroup") ? 1 : 3;
+        SpvId intrinsic_type_id = builder.declare_type(Type(Type::UInt, 32, intrinsic_lanes));
         SpvId intrinsic_ptr_type_id = builder.declare_pointer_type(intrinsic_type_id, storage_class);
         const std::string intrinsic_var_name = std::string("k") + std::to_string(kernel_index) + std::string("_") + used_intrinsic;
         SpvId intrinsic_var_id = builder.declare_global_variable(intrinsic_var_name, intrinsic_ptr_type_id, storage_class);
@@ -2761,8 +2825,9 @@ void CodeGen_Vulkan_Dev::SPIRV_Emitter::encode_spirv_module(std::vector<char> &m
     SpvBinary spirv_header;
     encode_header(spirv_header);
 
-    // Finalize the SPIR-V module
+    // Finalize the SPIR-V module, and strip out what it doesn't need
     builder.finalize();
+    builder.current_module().optimize();
 
     // Validate the SPIR-V for the target
     if (builder.is_capability_required(SpvCapabilityInt8) && !target.has_feature(Target::VulkanInt8)) {
@@ -7,6 +7,7 @@
 #include "IRMatch.h"
 #include "IROperator.h"
 #include "LLVM_Headers.h"
+#include "OptimizeShuffles.h"
 #include "Substitute.h"
 
 namespace Halide {
@@ -32,6 +33,9 @@ protected:
 
     void init_module() override;
 
+    void compile_func(const LoweredFunc &f,
+                      const std::string &simple_name, const std::string &extern_name) override;
+
     string mcpu_target() const override;
     string mcpu_tune() const override;
     string mattrs() const override;
@@ -41,7 +45,13 @@ protected:
 
     void visit(const Cast *) override;
     void visit(const Call *) override;
+    void visit(const Add *) override;
+    void visit(const Sub *) override;
     void codegen_vector_reduce(const VectorReduce *, const Expr &) override;
+
+    /** Whether a float vector multiply-add of type t may use relaxed
+     * madd, which may or may not round the product. */
+    bool use_relaxed_madd(const Type &t) const;
 };
 
 CodeGen_WebAssembly::CodeGen_WebAssembly(const Target &t)
@@ -114,6 +124,15 @@ const WasmIntrinsic intrinsic_defs[] = {
     {"extend_i32x4_to_i64x4", Int(64, 4), "widen_integer", {Int(32, 4)}, Target::WasmSimd128},
     {"extend_u32x4_to_u64x4", UInt(64, 4), "widen_integer", {UInt(32, 4)}, Target::WasmSimd128},
 
+    {"llvm.wasm.relaxed.madd.v4f32", Float(32, 4), "relaxed_madd", {Float(32, 4), Float(32, 4), Float(32, 4)}, Target::WasmRelaxedSimd},
+    {"llvm.wasm.relaxed.madd.v2f64", Float(64, 2), "relaxed_madd", {Float(64, 2), Float(64, 2), Float(64, 2)}, Target::WasmRelaxedSimd},
+    {"llvm.wasm.relaxed.nmadd.v4f32", Float(32, 4), "relaxed_nmadd", {Float(32, 4), Float(32, 4), Float(32, 4)}, Target::WasmRelaxedSimd},
+    {"llvm.wasm.relaxed.nmadd.v2f64", Float(64, 2), "relaxed_nmadd", {Float(64, 2), Float(64, 2), Float(64, 2)}, Target::WasmRelaxedSimd},
+
+    // The second operand of these is only well-defined in [0, 127].
+    {"llvm.wasm.relaxed.dot.i8x16.i7x16.signed", Int(16, 8), "relaxed_dot_i7", {Int(8, 16), Int(8, 16)}, Target::WasmRelaxedSimd},
+    {"llvm.wasm.relaxed.dot.i8x16.i7x16.add.signed", Int(32, 4), "relaxed_dot_i7_add", {Int(8, 16), Int(8, 16), Int(32, 4)}, Target::WasmRelaxedSimd},
+
     {"llvm.nearbyint.v4f32", Float(32, 4), "nearbyint", {Float(32, 4)}, Target::WasmSimd128},
     {"llvm.nearbyint.v2f64", Float(64, 2), "nearbyint", {Float(64, 2)}, Target::WasmSimd128},
     {"llvm.nearbyint.f32", Float(32), "nearbyint", {Float(32)}},
@@ -145,6 +164,22 @@ void CodeGen_WebAssembly::init_module() {
     }
 }
 
+void CodeGen_WebAssembly::compile_func(const LoweredFunc &f,
+                                       const std::string &simple_name,
+                                       const std::string &extern_name) {
+    LoweredFunc func = f;
+
+    if (target.has_feature(Target::WasmSimd128)) {
+        // Byte lookups into tables of up to 16 entries are a single
+        // i8x16.swizzle instead of a scalarized gather.
+        func.body = optimize_shuffles(func.body, 1, [](const Type &t) {
+            return t.bits() == 8 && t.is_int_or_uint() ? 16 : 0;
+        });
+    }
+
+    CodeGen_Posix::compile_func(func, simple_name, extern_name);
+}
+
 void CodeGen_WebAssembly::visit(const Cast *op) {
     struct Pattern {
         std::string intrin;  ///< Name of the intrinsic
@@ -276,6 +311,24 @@ void CodeGen_WebAssembly::visit(const Call *op) {
         }
     }
 
+    if (op->is_intrinsic(Call::dynamic_shuffle)) {
+        internal_assert(op->args.size() == 4);
+        internal_assert(op->type.bits() == 8);
+        // The indices are known to be in range, so it doesn't matter that
+        // relaxed swizzle leaves the result for other indices unspecified.
+        const char *intrin = target.has_feature(Target::WasmRelaxedSimd) ? "llvm.wasm.relaxed.swizzle" : "llvm.wasm.swizzle";
+        llvm::Type *vec_t = get_vector_type(i8_t, 16);
+        llvm::Value *lut = slice_vector(codegen(op->args[0]), 0, 16);
+        llvm::Value *idx = codegen(op->args[1]);
+        const int lanes = op->type.lanes();
+        vector<llvm::Value *> results;
+        for (int start = 0; start < lanes; start += 16) {
+            results.push_back(call_intrin(vec_t, 16, intrin, {lut, slice_vector(idx, start, 16)}));
+        }
+        value = slice_vector(concat_vectors(results), 0, lanes);
+        return;
+    }
+
     if (op->is_intrinsic(Call::round)) {
         // For webassembly, llvm.nearbyint compiles to f32.nearest, which gives us the semantics we want.
         value = call_overloaded_intrin(op->type, "nearbyint", op->args);
@@ -287,6 +340,47 @@ void CodeGen_WebAssembly::visit(const Call *op) {
     CodeGen_Posix::visit(op);
 }
 
+bool CodeGen_WebAssembly::use_relaxed_madd(const Type &t) const {
+    // Only where contracting a * b + c is allowed anyway, which rules out
+    // strict_float.
+    return target.has_feature(Target::WasmRelaxedSimd) &&
+           t.is_float() && t.is_vector() && (t.bits() == 32 || t.bits() == 64) &&
+           builder->getFastMathFlags().allowContract();
+}
+
+void CodeGen_WebAssembly::visit(const Add *op) {
+    if (use_relaxed_madd(op->type)) {
+        const Mul *mul = op->a.as<Mul>();
+        Expr c = op->b;
+        if (!mul) {
+            mul = op->b.as<Mul>();
+            c = op->a;
+        }
+        if (mul) {
+            value = call_overloaded_intrin(op->type, "relaxed_madd", {mul->a, mul->b, c});
+            if (value) {
+                return;
+            }
+        }
+    }
+
+    CodeGen_Posix::visit(op);
+}
+
+void CodeGen_WebAssembly::visit(const Sub *op) {
+    if (use_relaxed_madd(op->type)) {
+        if (const Mul *mul = op->b.as<Mul>()) {
+            // relaxed_nmadd(a, b, c) is -(a * b) + c
+            value = call_overloaded_intrin(op->type, "relaxed_nmadd", {mul->a, mul->b, op->a});
+            if (value) {
+                return;
+            }
+        }
+    }
+
+    CodeGen_Posix::visit(op);
+}
+
 void CodeGen_WebAssembly::codegen_vector_reduce(const VectorReduce *op, const Expr &init) {
     struct Pattern {
         VectorReduce::Operator reduce_op;
@@ -321,6 +415,48 @@ void CodeGen_WebAssembly::codegen_vector_reduce(const VectorReduce *op, const Ex
     }
 
     const int factor = op->value.type().lanes() / op->type.lanes();
+
+    // The relaxed dot products multiply signed 8-bit values by 7-bit ones,
+    // so use them when one side of an 8-bit widening multiply is known to
+    // be in [0, 127], and the other can be treated as signed.
+    if (target.has_feature(Target::WasmRelaxedSimd) && op->op == VectorReduce::Add &&
+        ((factor == 2 && op->type.element_of() == Int(16)) ||
+         (factor == 4 && op->type.element_of() == Int(32)))) {
+        Expr value = op->value;
+        if (const Cast *c = value.as<Cast>()) {
+            if (factor == 4 && c->value.type().bits() == 16) {
+                value = c->value;
+            }
+        }
+        const Call *mul = Call::as_intrinsic(value, {Call::widening_mul});
+        if (mul && mul->type.bits() == 16 && (factor == 2 || value.type().bits() == 16)) {
+            auto fits_i7 = [](const Expr &e) {
+                const ConstantInterval b = constant_integer_bounds(e);
+                return b.is_bounded() && b.min >= 0 && b.max <= 127;
+            };
+            Expr a = mul->args[0], b = mul->args[1];
+            if (!fits_i7(b)) {
+                std::swap(a, b);
+            }
+            if (fits_i7(b) && (a.type().is_int() || fits_i7(a))) {
+                const Type i8_t = Int(8, a.type().lanes());
+                vector<Expr> args = {cast(i8_t, a), cast(i8_t, b)};
+                if (factor == 2) {
+                    this->value = call_overloaded_intrin(op->type, "relaxed_dot_i7", args);
+                    if (this->value && init.defined()) {
+                        this->value = builder->CreateAdd(this->value, codegen(init));
+                    }
+                } else {
+                    args.push_back(init.defined() ? init : make_zero(op->type));
+                    this->value = call_overloaded_intrin(op->type, "relaxed_dot_i7_add", args);
+                }
+                if (this->value) {
+                    return;
+                }
+            }
+        }
+    }
+
     vector<Expr> matches;
     for (const Pattern &p : patterns) {
         if (op->op != p.reduce_op || (factor % p.factor) != 0) {
@@ -381,6 +517,11 @@ string CodeGen_WebAssembly::mattrs() const {
     if (target.has_feature(Target::WasmSimd128)) {
         attrs.emplace_back("+simd128");
     }
+    if (target.has_feature(Target::WasmRelaxedSimd)) {
+        user_assert(target.has_feature(Target::WasmSimd128))
+            << "wasm_relaxed_simd requires wasm_simd128.";
+        attrs.emplace_back("+relaxed-simd");
+    }
     if (target.has_feature(Target::WasmThreads)) {
         // "WasmThreads" doesn't directly affect LLVM codegen,
         // but it does end up requiring atomics, so be sure to enable them.
@@ -7,6 +7,7 @@
 #include "IRMutator.h"
 #include "IROperator.h"
 #include "LLVM_Headers.h"
+#include "OptimizeShuffles.h"
 #include "Simplify.h"
 #include "Substitute.h"
 #include "Util.h"
@@ -87,6 +88,17 @@ protected:
 
     void init_module() override;
 
+    /** Declare the overloads of the x86 intrinsics the target has. If
+     * only_available is true, skip those implemented by runtime modules
+     * that aren't linked in. */
+    void declare_intrinsics(bool only_available);
+
+    void compile_func(const LoweredFunc &f,
+                      const string &simple_name, const string &extern_name) override;
+
+    /** Gather from a small table using in-register permutes. */
+    Value *dynamic_shuffle(const Type &t, Value *lut, Value *idx, int lut_size);
+
     /** Nodes for which we want to emit specific sse/avx intrinsics */
     // @{
     void visit(const Add *) override;
@@ -300,11 +312,22 @@ const x86Intrinsic intrinsic_defs[] = {
 
 void CodeGen_X86::init_module() {
     CodeGen_Posix::init_module();
+    declare_intrinsics(false);
+}
 
+void CodeGen_X86::declare_intrinsics(bool only_available) {
     for (const x86Intrinsic &i : intrinsic_defs) {
         if (i.feature != Target::FeatureEnd && !target.has_feature(i.feature)) {
             continue;
         }
+        // The runtime modules that implement some of these are only
+        // linked in for the features of the module's target.
+        if (only_available && !starts_with(i.intrin_name, "llvm.")) {
+            llvm::Function *impl = module->getFunction(i.intrin_name);
+            if (!impl || impl->isDeclaration()) {
+                continue;
+            }
+        }
 
         Type ret_type = i.ret_type;
         vector<Type> arg_types;
@@ -324,6 +347,130 @@ void CodeGen_X86::init_module() {
     }
 }
 
+// Permutes that can serve a dynamic_shuffle from a small table. Sorted by
+// element size, then from cheapest to most expensive.
+struct x86TableLookup {
+    int bits;
+    int max_lut_size;
+    Target::Feature feature;
+    int lanes;
+    const char *intrin_name;
+    int tables = 1;
+    enum {
+        // pshufb only indexes within each 128-bit lane, so the table is
+        // repeated in every lane.
+        Replicate = -1,
+    };
+};
+
+// clang-format off
+const x86TableLookup table_lookup_defs[] = {
+    {8, 16, Target::AVX512_Skylake, 64, "llvm.x86.avx512.pshuf.b.512", x86TableLookup::Replicate},
+    {8, 16, Target::AVX2, 32, "llvm.x86.avx2.pshuf.b", x86TableLookup::Replicate},
+    {8, 16, Target::SSE41, 16, "llvm.x86.ssse3.pshuf.b.128", x86TableLookup::Replicate},
+    {8, 64, Target::AVX512_Cannonlake, 64, "llvm.x86.avx512.permvar.qi.512"},
+    {8, 128, Target::AVX512_Cannonlake, 64, "llvm.x86.avx512.vpermi2var.qi.512", 2},
+    // Two vpermi2b and a blend on the top bit of the index.
+    {8, 256, Target::AVX512_Cannonlake, 64, "llvm.x86.avx512.vpermi2var.qi.512", 4},
+    {16, 32, Target::AVX512_Skylake, 32, "llvm.x86.avx512.permvar.hi.512"},
+    {16, 64, Target::AVX512_Skylake, 32, "llvm.x86.avx512.vpermi2var.hi.512", 2},
+    {32, 8, Target::AVX2, 8, "llvm.x86.avx2.permd"},
+    {32, 16, Target::AVX512_Skylake, 16, "llvm.x86.avx512.permvar.si.512"},
+    {32, 32, Target::AVX512_Skylake, 16, "llvm.x86.avx512.vpermi2var.d.512", 2},
+};
+// clang-format on
+
+const x86TableLookup *find_table_lookup(const Target &target, int bits, int lut_size) {
+    for (const x86TableLookup &i : table_lookup_defs) {
+        if (i.bits == bits && lut_size <= i.max_lut_size && target.has_feature(i.feature)) {
+            return &i;
+        }
+    }
+    return nullptr;
+}
+
+void CodeGen_X86::compile_func(const LoweredFunc &f,
+                               const string &simple_name,
+                               const string &extern_name) {
+    LoweredFunc func = f;
+
+    // Turn gathers from small tables (e.g. gamma curves indexed by a uint8)
+    // into permutes. LLVM would otherwise emit a gather instruction, or
+    // scalarize the load entirely.
+    auto max_lut_size = [&](const Type &t) {
+        int max_size = 0;
+        if (t.is_int_or_uint() || t.is_float()) {
+            for (const x86TableLookup &i : table_lookup_defs) {
+                if (i.bits == t.bits() && target.has_feature(i.feature)) {
+                    max_size = std::max(max_size, i.max_lut_size);
+                }
+            }
+        }
+        return max_size;
+    };
+    func.body = optimize_shuffles(func.body, 1, max_lut_size);
+
+    // Functions outlined for Stage::specialize_target_features are
+    // compiled with more features than the module, and may use the
+    // intrinsics for those too.
+    ScopedValue<std::map<std::string, std::vector<Intrinsic>>> old_intrinsics(intrinsics);
+    if (!f.target_features.empty()) {
+        declare_intrinsics(true);
+    }
+
+    CodeGen_Posix::compile_func(func, simple_name, extern_name);
+}
+
+Value *CodeGen_X86::dynamic_shuffle(const Type &t, Value *lut, Value *idx, int lut_size) {
+    const x86TableLookup *lookup = find_table_lookup(target, t.bits(), lut_size);
+    internal_assert(lookup) << "No table lookup for " << lut_size << " x " << t << "\n";
+
+    const int lanes = t.lanes();
+    const int L = lookup->lanes;
+    llvm::Type *elt_t = llvm::Type::getIntNTy(*context, t.bits());
+    llvm::Type *vec_t = get_vector_type(elt_t, L);
+
+    // Everything is done on integers of the element size.
+    lut = builder->CreateBitCast(lut, get_vector_type(elt_t, get_vector_num_elements(lut->getType())));
+    if (t.bits() > 8) {
+        idx = builder->CreateZExt(idx, get_vector_type(elt_t, lanes));
+    }
+
+    vector<Value *> tables;
+    if (lookup->tables == x86TableLookup::Replicate) {
+        vector<int> indices(L);
+        for (int i = 0; i < L; i++) {
+            indices[i] = i % 16;
+        }
+        tables.push_back(shuffle_vectors(slice_vector(lut, 0, 16), indices));
+    } else {
+        for (int i = 0; i < lookup->tables; i++) {
+            tables.push_back(slice_vector(lut, i * L, L));
+        }
+    }
+
+    vector<Value *> results;
+    for (int start = 0; start < lanes; start += L) {
+        Value *i = slice_vector(idx, start, L);
+        Value *result;
+        if (lookup->tables == 4) {
+            // vpermi2b ignores the top bit of the index, so use it to pick
+            // between the low and high halves of the table.
+            Value *lo = call_intrin(vec_t, L, lookup->intrin_name, {tables[0], i, tables[1]});
+            Value *hi = call_intrin(vec_t, L, lookup->intrin_name, {tables[2], i, tables[3]});
+            Value *use_hi = builder->CreateICmpSLT(i, ConstantInt::get(vec_t, 0));
+            result = builder->CreateSelect(use_hi, hi, lo);
+        } else if (lookup->tables == 2) {
+            result = call_intrin(vec_t, L, lookup->intrin_name, {tables[0], i, tables[1]});
+        } else {
+            result = call_intrin(vec_t, L, lookup->intrin_name, {tables[0], i});
+        }
+        results.push_back(result);
+    }
+    Value *result = slice_vector(concat_vectors(results), 0, lanes);
+    return builder->CreateBitCast(result, llvm_type_of(t));
+}
+
 // i32(i16_a)*i32(i16_b) +/- i32(i16_c)*i32(i16_d) can be done by
 // interleaving a, c, and b, d, and then using dot_product.
 bool should_use_dot_product(const Expr &a, const Expr &b, vector<Expr> &result) {
@@ -585,6 +732,16 @@ void CodeGen_X86::visit(const Call *op) {
         return;
     }
 
+    if (op->is_intrinsic(Call::dynamic_shuffle)) {
+        internal_assert(op->args.size() == 4);
+        auto max_index = as_const_int(op->args[3]);
+        internal_assert(max_index);
+        Value *lut = codegen(op->args[0]);
+        Value *idx = codegen(op->args[1]);
+        value = dynamic_shuffle(op->type, lut, idx, *max_index + 1);
+        return;
+    }
+
     // A 16-bit mul-shift-right of less than 16 can sometimes be rounded up to a
     // full 16 to use pmulh(u)w by left-shifting one of the operands. This is
     // handled here instead of in the lowering of mul_shift_right because it's
@@ -875,6 +1032,65 @@ void CodeGen_X86::codegen_vector_reduce(const VectorReduce *op, const Expr &init
         }
     }
 
+    // vpdpbusd only takes unsigned x signed bytes. For 4-way dot products of
+    // two signed or two unsigned byte vectors, flip the sign bit of one
+    // operand to make the types line up, and subtract off the bias with a
+    // second dot product against it. This is what quantized matrix
+    // multiplies with symmetric (or zero-point-free) quantization produce.
+    if (op->op == VectorReduce::Add && factor == 4) {
+        static const Expr signed_pattern = i32(widening_mul(wild_i8x_, wild_i8x_));
+        static const Expr unsigned_pattern = i32(widening_mul(wild_u8x_, wild_u8x_));
+        const int lanes = op->value.type().lanes();
+        Expr zero = make_zero(op->type);
+        Expr acc = init.defined() ? init : zero;
+        if (expr_match(signed_pattern, op->value, matches)) {
+            // a * b == (a + 128) * b - 128 * b
+            Expr a = reinterpret(UInt(8, lanes), matches[0]) ^ make_const(UInt(8, lanes), 128);
+            Expr b = matches[1];
+            Value *dot = call_overloaded_intrin(op->type, "dot_product", {acc, a, b});
+            if (dot) {
+                Value *bias = call_overloaded_intrin(op->type, "dot_product", {zero, make_const(UInt(8, lanes), 128), b});
+                internal_assert(bias);
+                value = builder->CreateSub(dot, bias);
+                return;
+            }
+        } else if (expr_match(unsigned_pattern, op->value, matches)) {
+            // a * b == a * (b - 128) + 128 * a
+            Expr a = matches[0];
+            Expr b = reinterpret(Int(8, lanes), matches[1] ^ make_const(UInt(8, lanes), 128));
+            Value *dot = call_overloaded_intrin(op->type, "dot_product", {acc, a, b});
+            if (dot) {
+                Value *sum = call_overloaded_intrin(op->type, "dot_product", {zero, a, make_one(Int(8, lanes))});
+                internal_assert(sum);
+                Value *bias = builder->CreateShl(sum, ConstantInt::get(sum->getType(), 7));
+                value = builder->CreateAdd(dot, bias);
+                return;
+            }
+        }
+    }
+
+    // Wider byte dot products (e.g. a k-loop of an int8 matrix multiply
+    // vectorized by 8 or 16) are two reductions: a 4-way one that maps to
+    // vpdpbusd, followed by a regular horizontal add of the 32-bit partial
+    // sums.
+    if (op->op == VectorReduce::Add &&
+        factor > 4 && factor % 4 == 0 &&
+        op->type.element_of() == Int(32) &&
+        (target.has_feature(Target::AVX512_SapphireRapids) ||
+         target.has_feature(Target::AVX512_Zen4))) {
+        const Cast *cast = op->value.as<Cast>();
+        const Call *mul = cast ? Call::as_intrinsic(cast->value, {Call::widening_mul}) : nullptr;
+        if (mul && mul->args[0].type().bits() == 8 && mul->args[1].type().bits() == 8) {
+            Expr equiv = VectorReduce::make(VectorReduce::Add, op->value, op->value.type().lanes() / 4);
+            equiv = VectorReduce::make(VectorReduce::Add, equiv, op->type.lanes());
+            if (init.defined()) {
+                equiv = equiv + init;
+            }
+            codegen(equiv);
+            return;
+        }
+    }
+
     // Rewrite non-native sum-of-absolute-difference variants to the native
     // op. We support reducing to various types. We could consider supporting
     // multiple reduction factors too, but in general we don't handle non-native
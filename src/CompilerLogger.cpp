@@ -17,7 +17,10 @@ namespace {
 // TODO: for now we are just going to ignore potential issues with
 // static-initialization-order-fiasco, as CompilerLogger isn't currently used
 // from any static-initialization execution scope.
-std::unique_ptr<CompilerLogger> active_compiler_logger;
+//
+// Thread-local so that compile_multitarget() can hand each sub-target's
+// logger to the thread doing its code generation.
+thread_local std::unique_ptr<CompilerLogger> active_compiler_logger;
 
 class ObfuscateNames : public IRMutator {
     using IRMutator::visit;
@@ -112,10 +115,31 @@ void JSONCompilerLogger::record_object_code_size(uint64_t bytes) {
     object_code_size += bytes;
 }
 
+void JSONCompilerLogger::record_runtime_size(uint64_t functions, uint64_t instructions) {
+    runtime_functions += functions;
+    runtime_instructions += instructions;
+}
+
 void JSONCompilerLogger::record_compilation_time(Phase phase, double duration) {
     compilation_time[phase] += duration;
 }
 
+void JSONCompilerLogger::record_lowering_pass(const LoweringPassStats &stats) {
+    lowering_passes.push_back(stats);
+}
+
+void JSONCompilerLogger::record_storage_folding_rejection(const std::string &func, const std::string &dim,
+                                                          const std::string &loop_var, const std::string &reason) {
+    storage_folding_rejections[func].push_back(dim + " over " + loop_var + ": " + reason);
+}
+
+void JSONCompilerLogger::record_loop_interchange(const std::string &func, const std::string &old_loop_var,
+                                                 const std::string &loop_var, int strided_before, int strided_after) {
+    loop_interchanges[func].push_back(loop_var + " innermost instead of " + old_loop_var + ": " +
+                                      std::to_string(strided_before) + " strided accesses -> " +
+                                      std::to_string(strided_after));
+}
+
 void JSONCompilerLogger::obfuscate() {
     {
         std::map<std::string, std::vector<Expr>> n;
@@ -269,6 +293,10 @@ std::ostream &JSONCompilerLogger::emit_to_stream(std::ostream &o) {
     if (object_code_size) {
         emit_key_value(o, indent, "object_code_size", object_code_size);
     }
+    if (runtime_functions) {
+        emit_key_value(o, indent, "runtime_functions", runtime_functions);
+        emit_key_value(o, indent, "runtime_instructions", runtime_instructions);
+    }
 
     // If these are present, emit them, even if value is zero
     if (compilation_time.count(Phase::HalideLowering)) {
@@ -278,6 +306,25 @@ std::ostream &JSONCompilerLogger::emit_to_stream(std::ostream &o) {
         emit_key_value(o, indent, "compilation_time_llvm", compilation_time[Phase::LLVM]);
     }
 
+    if (!lowering_passes.empty()) {
+        std::string spaces(indent + 1, ' ');
+        emit_key(o, indent, "lowering_passes");
+        o << "[\n";
+        int commas_to_emit = (int)lowering_passes.size() - 1;
+        for (const auto &it : lowering_passes) {
+            o << spaces << "{\n";
+            emit_key_value(o, indent + 2, "name", it.name);
+            emit_key_value(o, indent + 2, "duration", it.duration);
+            emit_key_value(o, indent + 2, "peak_memory", it.peak_memory);
+            emit_key_value(o, indent + 2, "ir_nodes_before", it.ir_nodes_before);
+            emit_key_value(o, indent + 2, "ir_nodes_after", it.ir_nodes_after, false);
+            o << spaces << "}";
+            emit_eol(o, commas_to_emit-- > 0);
+        }
+        o << std::string(indent, ' ') << "]";
+        emit_eol(o);
+    }
+
     if (!matched_simplifier_rules.empty()) {
         emit_object_key_open(o, indent, "matched_simplifier_rules");
 
@@ -306,6 +353,32 @@ std::ostream &JSONCompilerLogger::emit_to_stream(std::ostream &o) {
         emit_object_key_close(o, indent);
     }
 
+    if (!storage_folding_rejections.empty()) {
+        emit_object_key_open(o, indent, "storage_folding_rejections");
+
+        int commas_to_emit = (int)storage_folding_rejections.size() - 1;
+        for (const auto &it : storage_folding_rejections) {
+            emit_key(o, indent + 1, it.first);
+            emit_eol(o, false);
+            emit_list(o, indent + 1, it.second, (commas_to_emit-- > 0));
+        }
+
+        emit_object_key_close(o, indent);
+    }
+
+    if (!loop_interchanges.empty()) {
+        emit_object_key_open(o, indent, "loop_interchanges");
+
+        int commas_to_emit = (int)loop_interchanges.size() - 1;
+        for (const auto &it : loop_interchanges) {
+            emit_key(o, indent + 1, it.first);
+            emit_eol(o, false);
+            emit_list(o, indent + 1, it.second, (commas_to_emit-- > 0));
+        }
+
+        emit_object_key_close(o, indent);
+    }
+
     if (!failed_to_prove_exprs.empty()) {
         emit_object_key_open(o, indent, "failed_to_prove");
 
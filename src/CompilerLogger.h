@@ -15,6 +15,7 @@
 #include <memory>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include "Expr.h"
 #include "Target.h"
@@ -30,6 +31,18 @@ public:
         LLVM,
     };
 
+    /** Statistics for a single lowering pass. */
+    struct LoweringPassStats {
+        std::string name;
+        // Wall time taken by the pass, in seconds.
+        double duration{0};
+        // Peak resident memory of the process after the pass, in bytes (zero if unknown).
+        uint64_t peak_memory{0};
+        // Number of distinct IR nodes in the Stmt before and after the pass.
+        uint64_t ir_nodes_before{0};
+        uint64_t ir_nodes_after{0};
+    };
+
     CompilerLogger() = default;
     virtual ~CompilerLogger() = default;
 
@@ -49,19 +62,50 @@ public:
      */
     virtual void record_object_code_size(uint64_t bytes) = 0;
 
+    /** Record how much of the runtime is left in a module after LLVM
+     * optimization, as a number of functions and of LLVM instructions in
+     * them. The default implementation discards it.
+     */
+    virtual void record_runtime_size(uint64_t /* functions */, uint64_t /* instructions */) {
+    }
+
     /** Record the compilation time (in seconds) for a given phase.
      */
     virtual void record_compilation_time(Phase phase, double duration) = 0;
 
+    /** Record statistics for one lowering pass. These are gathered only
+     * while a CompilerLogger is active. The default implementation
+     * discards them.
+     */
+    virtual void record_lowering_pass(const LoweringPassStats &) {
+    }
+
+    /** Record why storage folding did not fold a dimension of a Func
+     * over a loop. The default implementation discards it.
+     */
+    virtual void record_storage_folding_rejection(const std::string & /* func */, const std::string & /* dim */,
+                                                  const std::string & /* loop_var */, const std::string & /* reason */) {
+    }
+
+    /** Record that the loops of a Func's pure definition were reordered
+     * to put loop_var innermost, instead of old_loop_var, because it
+     * made fewer of the definition's accesses strided. The default
+     * implementation discards it.
+     */
+    virtual void record_loop_interchange(const std::string & /* func */, const std::string & /* old_loop_var */,
+                                         const std::string & /* loop_var */, int /* strided_before */,
+                                         int /* strided_after */) {
+    }
+
     /**
      * Emit all the gathered data to the given stream. This may be called multiple times.
      */
     virtual std::ostream &emit_to_stream(std::ostream &o) = 0;
 };
 
-/** Set the active CompilerLogger object, replacing any existing one.
- * It is legal to pass in a nullptr (which means "don't do any compiler logging").
- * Returns the previous CompilerLogger (if any). */
+/** Set the active CompilerLogger object for the calling thread, replacing any
+ * existing one. It is legal to pass in a nullptr (which means "don't do any
+ * compiler logging"). Returns the previous CompilerLogger (if any). */
 std::unique_ptr<CompilerLogger> set_compiler_logger(std::unique_ptr<CompilerLogger> compiler_logger);
 
 /** Return the currently active CompilerLogger object. If set_compiler_logger()
@@ -89,7 +133,13 @@ public:
     void record_non_monotonic_loop_var(const std::string &loop_var, Expr expr) override;
     void record_failed_to_prove(Expr failed_to_prove, Expr original_expr) override;
     void record_object_code_size(uint64_t bytes) override;
+    void record_runtime_size(uint64_t functions, uint64_t instructions) override;
     void record_compilation_time(Phase phase, double duration) override;
+    void record_lowering_pass(const LoweringPassStats &stats) override;
+    void record_storage_folding_rejection(const std::string &func, const std::string &dim,
+                                          const std::string &loop_var, const std::string &reason) override;
+    void record_loop_interchange(const std::string &func, const std::string &old_loop_var,
+                                 const std::string &loop_var, int strided_before, int strided_after) override;
 
     std::ostream &emit_to_stream(std::ostream &o) override;
 
@@ -113,9 +163,21 @@ protected:
     // Total code size generated, in bytes.
     uint64_t object_code_size{0};
 
+    // Functions and instructions of the runtime left in the modules compiled.
+    uint64_t runtime_functions{0}, runtime_instructions{0};
+
     // Map of the time take for each phase of compilation.
     std::map<Phase, double> compilation_time;
 
+    // Statistics for each lowering pass, in the order they ran.
+    std::vector<LoweringPassStats> lowering_passes;
+
+    // Maps func -> list of "dim over loop_var: reason" for each dimension not folded
+    std::map<std::string, std::vector<std::string>> storage_folding_rejections;
+
+    // Maps func -> "old_loop_var -> loop_var" description of the loops interchanged
+    std::map<std::string, std::vector<std::string>> loop_interchanges;
+
     void obfuscate();
     void emit();
 };
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <cmath>
 #include <iostream>
 #include <set>
@@ -43,12 +44,17 @@ class ReverseAccumulationVisitor : public IRVisitor {
 public:
     void propagate_adjoints(const Func &output,
                             const Func &adjoint,
-                            const Region &output_bounds);
+                            const Region &output_bounds,
+                            const Checkpointing &checkpointing);
 
     map<FuncKey, Func> get_adjoint_funcs() const {
         return adjoint_funcs;
     }
 
+    map<string, Func> get_recomputed_funcs() const {
+        return recomputed_funcs;
+    }
+
 protected:
     void visit(const IntImm *) override;
     void visit(const UIntImm *) override;
@@ -146,6 +152,14 @@ protected:
 private:
     void accumulate(const Expr &stub, Expr adjoint);
 
+    // The size in bytes of the region of func the gradient needs, or -1
+    // if it isn't known at compile time.
+    int64_t footprint(const Func &func) const;
+
+    // Make the adjoint Funcs read clones of the Funcs to recompute.
+    void recompute_in_adjoints(const vector<Func> &funcs,
+                               const Checkpointing &checkpointing);
+
     void propagate_halide_function_call(
         Expr adjoint,
         const std::string &name,             // called function name
@@ -159,6 +173,8 @@ private:
     map<const BaseExprNode *, Expr> expr_adjoints;
     // For each function and each update, we store the accumulated adjoints func
     map<FuncKey, Func> adjoint_funcs;
+    // The clones of the forward functions the adjoints recompute
+    map<string, Func> recomputed_funcs;
     // Let variables and their mapping
     map<string, Expr> let_var_mapping;
     vector<string> let_variables;
@@ -184,7 +200,8 @@ private:
 void ReverseAccumulationVisitor::propagate_adjoints(
     const Func &output,
     const Func &adjoint,
-    const Region &output_bounds) {
+    const Region &output_bounds,
+    const Checkpointing &checkpointing) {
     // Topologically sort the functions
     map<string, Function> env = find_transitive_calls(output.function());
     vector<string> order =
@@ -749,6 +766,117 @@ void ReverseAccumulationVisitor::propagate_adjoints(
             }
         }
     }
+
+    recompute_in_adjoints(funcs, checkpointing);
+}
+
+int64_t ReverseAccumulationVisitor::footprint(const Func &func) const {
+    auto it = func_bounds.find(func.name());
+    if (it == func_bounds.end()) {
+        return -1;
+    }
+    int64_t size = 0;
+    for (const Type &t : func.types()) {
+        size += t.bytes();
+    }
+    for (int d = 0; d < (int)it->second.size(); d++) {
+        const Interval &interval = it->second[d];
+        auto extent = as_const_int(simplify(interval.max - interval.min + 1));
+        if (!extent) {
+            return -1;
+        }
+        size *= std::max(*extent, (int64_t)0);
+    }
+    return size;
+}
+
+void ReverseAccumulationVisitor::recompute_in_adjoints(
+    const vector<Func> &funcs,
+    const Checkpointing &checkpointing) {
+    set<string> forward, recompute;
+    for (const Func &f : funcs) {
+        forward.insert(f.name());
+    }
+    for (const Func &f : checkpointing.recompute) {
+        user_assert(forward.count(f.name()))
+            << "Can't recompute " << f.name() << " in the adjoints of "
+            << funcs.back().name() << ", which doesn't depend on it.\n";
+        recompute.insert(f.name());
+    }
+
+    if (checkpointing.memory_budget > 0) {
+        // Funcs without updates are the cheap ones to recompute: each
+        // value costs one evaluation of the pure definition, where
+        // recomputing a reduction would redo the whole of it. The
+        // output (last in the realization order) is realized anyway.
+        int64_t stored = 0;
+        vector<std::pair<int64_t, string>> candidates;
+        for (int i = 0; i < (int)funcs.size() - 1; i++) {
+            const Func &f = funcs[i];
+            int64_t size = footprint(f);
+            if (size < 0 || recompute.count(f.name())) {
+                continue;
+            }
+            stored += size;
+            if (!f.has_update_definition() && !f.is_extern()) {
+                candidates.emplace_back(size, f.name());
+            }
+        }
+        std::sort(candidates.begin(), candidates.end(),
+                  [](const std::pair<int64_t, string> &a, const std::pair<int64_t, string> &b) {
+                      return a.first > b.first;
+                  });
+        for (const auto &c : candidates) {
+            if (stored <= checkpointing.memory_budget) {
+                break;
+            }
+            debug(1) << "Recomputing " << c.second << " (" << c.first << " bytes) in the adjoints\n";
+            recompute.insert(c.second);
+            stored -= c.first;
+        }
+        if (stored > checkpointing.memory_budget) {
+            debug(1) << "The stored Funcs still need " << stored << " bytes, which is over the budget of "
+                     << checkpointing.memory_budget << " bytes\n";
+        }
+    }
+    if (recompute.empty()) {
+        return;
+    }
+
+    // The Functions of the backward pass are the ones the adjoints call
+    // that aren't part of the forward pass.
+    vector<Function> adjoints;
+    adjoints.reserve(adjoint_funcs.size());
+    for (const auto &it : adjoint_funcs) {
+        adjoints.push_back(it.second.function());
+    }
+    vector<Function> consumers;
+    for (const auto &it : build_environment(adjoints)) {
+        if (!forward.count(it.first)) {
+            consumers.push_back(it.second);
+        }
+    }
+
+    // Go from consumers to producers, so that the clones of the
+    // consumers call the clones of the producers.
+    for (const Func &f : reverse_view(funcs)) {
+        if (!recompute.count(f.name())) {
+            continue;
+        }
+        vector<Func> callers;
+        for (const Function &c : consumers) {
+            if (find_direct_calls(c).count(f.name())) {
+                callers.emplace_back(c);
+            }
+        }
+        if (callers.empty()) {
+            // The adjoints don't read this Func.
+            continue;
+        }
+        Func clone = Func(f).clone_in(callers);
+        recomputed_funcs[f.name()] = clone;
+        consumers.push_back(clone.function());
+    }
 }
 
 void ReverseAccumulationVisitor::accumulate(const Expr &stub, Expr adjoint) {
@@ -1952,19 +2080,35 @@ Func Derivative::operator()(const std::string &name) const {
     return it->second;
 }
 
+Func Derivative::recomputed(const Func &func) const {
+    auto it = recomputed_funcs.find(func.name());
+    if (it == recomputed_funcs.end()) {
+        Internal::debug(1) << "Func " << func.name() << " is not recomputed\n";
+        return Func();
+    }
+    return it->second;
+}
+
 Derivative propagate_adjoints(const Func &output,
                               const Func &adjoint,
                               const Region &output_bounds) {
+    return propagate_adjoints(output, adjoint, output_bounds, Checkpointing());
+}
+
+Derivative propagate_adjoints(const Func &output,
+                              const Func &adjoint,
+                              const Region &output_bounds,
+                              const Checkpointing &checkpointing) {
     user_assert(output.dimensions() == adjoint.dimensions())
         << "output dimensions and adjoint dimensions must match\n";
     user_assert((int)output_bounds.size() == adjoint.dimensions())
         << "output_bounds and adjoint dimensions must match\n";
 
     Internal::ReverseAccumulationVisitor visitor;
-    visitor.propagate_adjoints(output, adjoint, output_bounds);
-    // Since the return value of get_adjoint_funcs() is a temporary,
-    // we should *not* use std::move.
-    return Derivative{visitor.get_adjoint_funcs()};
+    visitor.propagate_adjoints(output, adjoint, output_bounds, checkpointing);
+    // Since the return values of get_adjoint_funcs() and
+    // get_recomputed_funcs() are temporaries, we should *not* use std::move.
+    return Derivative{visitor.get_adjoint_funcs(), visitor.get_recomputed_funcs()};
 }
 
 Derivative propagate_adjoints(const Func &output,
@@ -1979,6 +2123,11 @@ Derivative propagate_adjoints(const Func &output,
 }
 
 Derivative propagate_adjoints(const Func &output) {
+    return propagate_adjoints(output, Checkpointing());
+}
+
+Derivative propagate_adjoints(const Func &output,
+                              const Checkpointing &checkpointing) {
     Func adjoint("adjoint");
     adjoint(output.args()) = Internal::make_one(output.value().type());
     Region output_bounds;
@@ -1986,7 +2135,7 @@ Derivative propagate_adjoints(const Func &output) {
     for (int i = 0; i < output.dimensions(); i++) {
         output_bounds.emplace_back(0, 0);
     }
-    return propagate_adjoints(output, adjoint, output_bounds);
+    return propagate_adjoints(output, adjoint, output_bounds, checkpointing);
 }
 
 }  // namespace Halide
@@ -29,6 +29,10 @@ public:
     explicit Derivative(std::map<FuncKey, Func> &&adjoints_in)
         : adjoints(std::move(adjoints_in)) {
     }
+    Derivative(std::map<FuncKey, Func> adjoints_in,
+               std::map<std::string, Func> recomputed_in)
+        : adjoints(std::move(adjoints_in)), recomputed_funcs(std::move(recomputed_in)) {
+    }
 
     // These all return an undefined Func if no derivative is found
     // (typically, if the input Funcs aren't differentiable)
@@ -37,8 +41,36 @@ public:
     Func operator()(const Param<> &param) const;
     Func operator()(const std::string &name) const;
 
+    /** The clone of a forward Func that the derivative Funcs read
+     * instead of it, if it was chosen for recomputation (see
+     * Checkpointing). Returns an undefined Func otherwise. The clone
+     * is computed inline unless it is scheduled. */
+    Func recomputed(const Func &func) const;
+
 private:
     const std::map<FuncKey, Func> adjoints;
+    const std::map<std::string, Func> recomputed_funcs;
+};
+
+/**
+ *  Which of the Funcs the output depends on the derivative Funcs
+ *  recompute, instead of reading the values the forward pass stored.
+ *  The derivative Funcs read a clone (see Func::clone_in) of each such
+ *  Func, so the forward Func can be scheduled for the forward pass, and
+ *  its storage freed once its forward consumers are done, while the
+ *  clone is recomputed at whatever granularity the backward pass is
+ *  scheduled at. A recomputed Func's clone calls the clones of the Funcs
+ *  it depends on that are also recomputed.
+ */
+struct Checkpointing {
+    /** Funcs to recompute. */
+    std::vector<Func> recompute;
+
+    /** If positive, also recompute Funcs without update definitions,
+     * largest first, until the rest fit into this many bytes. The size
+     * of a Func is that of the region the gradient needs, which must
+     * be known at compile time to be counted. */
+    int64_t memory_budget = 0;
 };
 
 /**
@@ -52,6 +84,14 @@ private:
 Derivative propagate_adjoints(const Func &output,
                               const Func &adjoint,
                               const Region &output_bounds);
+/**
+ *  As above, with the given Checkpointing of the Funcs the output
+ *  depends on.
+ */
+Derivative propagate_adjoints(const Func &output,
+                              const Func &adjoint,
+                              const Region &output_bounds,
+                              const Checkpointing &checkpointing);
 /**
  *  Given a Func and a corresponding adjoint buffer, (back)propagate the
  *  adjoint to all dependent Funcs, buffers, and parameters.
@@ -69,6 +109,12 @@ Derivative propagate_adjoints(const Func &output,
  *  the Derivative.
  */
 Derivative propagate_adjoints(const Func &output);
+/**
+ *  As above, with the given Checkpointing of the Funcs the output
+ *  depends on.
+ */
+Derivative propagate_adjoints(const Func &output,
+                              const Checkpointing &checkpointing);
 
 }  // namespace Halide
 
@@ -6,19 +6,106 @@
 #include "Func.h"
 #include "Function.h"
 #include "IR.h"
+#include "Module.h"
 #include "Schedule.h"
 #include "halide_ir.fbs.h"
 
 #include <fstream>
 #include <functional>
 #include <iostream>
+#include <memory>
 #include <string>
 #include <unordered_map>
 #include <vector>
 
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 namespace Halide {
 namespace Internal {
 
+namespace {
+
+// The contents of a serialized pipeline file. Where possible the file is
+// memory-mapped, so that the buffers embedded in it can alias the mapping
+// instead of being copied out of it.
+class MappedFile {
+    uint8_t *mapping = nullptr;
+    size_t length = 0;
+    std::vector<uint8_t> contents;
+
+public:
+    MappedFile() = default;
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    ~MappedFile() {
+#ifndef _WIN32
+        if (mapping) {
+            munmap(mapping, length);
+        }
+#endif
+    }
+
+    // Returns nullptr if the file can't be read.
+    static std::shared_ptr<MappedFile> open(const std::string &filename) {
+        auto result = std::make_shared<MappedFile>();
+#ifndef _WIN32
+        int fd = ::open(filename.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return nullptr;
+        }
+        struct stat st;
+        if (fstat(fd, &st) == 0 && st.st_size > 0) {
+            // A private mapping never writes back to the file, and its pages
+            // are shared with the page cache until something writes to them.
+            void *p = mmap(nullptr, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+            if (p != MAP_FAILED) {
+                result->mapping = (uint8_t *)p;
+                result->length = st.st_size;
+            }
+        }
+        ::close(fd);
+        if (result->mapping) {
+            return result;
+        }
+#endif
+        std::ifstream in(filename, std::ios::binary | std::ios::in);
+        if (!in) {
+            return nullptr;
+        }
+        in.seekg(0, std::ios::end);
+        result->contents.resize(in.tellg());
+        in.seekg(0, std::ios::beg);
+        in.read((char *)result->contents.data(), result->contents.size());
+        if (!in.good()) {
+            return nullptr;
+        }
+        return result;
+    }
+
+    const uint8_t *data() const {
+        return mapping ? mapping : contents.data();
+    }
+
+    // Whether the data stays where it is for the lifetime of this object,
+    // and is aligned like the start of the file. Heap storage is only
+    // guaranteed the alignment of malloc.
+    bool is_mapped() const {
+        return mapping != nullptr;
+    }
+};
+
+void release_mapped_file(void *context) {
+    delete (std::shared_ptr<MappedFile> *)context;
+}
+
+}  // namespace
+
 class Deserializer {
 public:
     Deserializer() = default;
@@ -46,6 +133,15 @@ public:
     // Deserialize just the unbound external parameters that need to be defined for the pipeline from the given buffer of bytes
     std::map<std::string, Parameter> deserialize_parameters(const std::vector<uint8_t> &data);
 
+    // Deserialize the lowered modules stored with the pipeline from the given filename
+    std::vector<Module> deserialize_modules(const std::string &filename, std::vector<Buffer<uint8_t>> *object_code);
+
+    // Deserialize the lowered modules stored with the pipeline from the given input stream
+    std::vector<Module> deserialize_modules(std::istream &in, std::vector<Buffer<uint8_t>> *object_code);
+
+    // Deserialize the lowered modules stored with the pipeline from the given buffer of bytes
+    std::vector<Module> deserialize_modules(const std::vector<uint8_t> &data, std::vector<Buffer<uint8_t>> *object_code);
+
 private:
     // Helper function to deserialize a homogenous vector from a flatbuffer vector,
     // does not apply to union types like Stmt and Expr or enum types like MemoryType
@@ -78,6 +174,14 @@ private:
     // Default external parameters that were created during deserialization
     std::map<std::string, Parameter> external_params;
 
+    // The memory-mapped file being deserialized, if any. Dense buffers
+    // embedded in it alias it rather than being copied, and keep it alive.
+    std::shared_ptr<MappedFile> mapped_file;
+
+    Pipeline deserialize_from(const uint8_t *data);
+
+    std::vector<Module> deserialize_modules_from(const uint8_t *data, std::vector<Buffer<uint8_t>> *object_code);
+
     MemoryType deserialize_memory_type(Serialize::MemoryType memory_type);
 
     ForType deserialize_for_type(Serialize::ForType for_type);
@@ -94,6 +198,8 @@ private:
 
     NameMangling deserialize_name_mangling(Serialize::NameMangling name_mangling);
 
+    TraceSampling deserialize_trace_sampling(Serialize::TraceSampling trace_sampling);
+
     TailStrategy deserialize_tail_strategy(Serialize::TailStrategy tail_strategy);
 
     Split::SplitType deserialize_split_type(Serialize::SplitType split_type);
@@ -104,6 +210,10 @@ private:
 
     ExternFuncArgument::ArgType deserialize_extern_func_argument_type(Serialize::ExternFuncArgumentType extern_func_argument_type);
 
+    Argument::Kind deserialize_argument_kind(Serialize::ArgumentKind argument_kind);
+
+    LinkageType deserialize_linkage_type(Serialize::LinkageType linkage_type);
+
     std::string deserialize_string(const flatbuffers::String *str);
 
     Type deserialize_type(const Serialize::Type *type);
@@ -160,6 +270,14 @@ private:
 
     Buffer<> deserialize_buffer(const Serialize::Buffer *buffer);
 
+    ArgumentEstimates deserialize_argument_estimates(const Serialize::ArgumentEstimates *argument_estimates);
+
+    LoweredArgument deserialize_lowered_argument(const Serialize::LoweredArgument *lowered_argument);
+
+    LoweredFunc deserialize_lowered_func(const Serialize::LoweredFunc *lowered_func);
+
+    Module deserialize_module(const Serialize::Module *module);
+
     void build_reverse_function_mappings(const std::vector<Function> &functions);
 };
 
@@ -188,6 +306,12 @@ MemoryType Deserializer::deserialize_memory_type(Serialize::MemoryType memory_ty
         return MemoryType::VTCM;
     case Serialize::MemoryType::AMXTile:
         return MemoryType::AMXTile;
+    case Serialize::MemoryType::Streaming:
+        return MemoryType::Streaming;
+    case Serialize::MemoryType::WMMAAccumulator:
+        return MemoryType::WMMAAccumulator;
+    case Serialize::MemoryType::SimdgroupMatrix:
+        return MemoryType::SimdgroupMatrix;
     default:
         user_error << "unknown memory type " << (int)memory_type << "\n";
         return MemoryType::Auto;
@@ -334,6 +458,20 @@ NameMangling Deserializer::deserialize_name_mangling(Serialize::NameMangling nam
     }
 }
 
+TraceSampling Deserializer::deserialize_trace_sampling(Serialize::TraceSampling trace_sampling) {
+    switch (trace_sampling) {
+    case Serialize::TraceSampling::EveryNth:
+        return TraceSampling::EveryNth;
+    case Serialize::TraceSampling::FirstN:
+        return TraceSampling::FirstN;
+    case Serialize::TraceSampling::Random:
+        return TraceSampling::Random;
+    default:
+        user_error << "unknown trace sampling " << (int)trace_sampling << "\n";
+        return TraceSampling::EveryNth;
+    }
+}
+
 TailStrategy Deserializer::deserialize_tail_strategy(Serialize::TailStrategy tail_strategy) {
     switch (tail_strategy) {
     case Serialize::TailStrategy::RoundUp:
@@ -422,6 +560,36 @@ ExternFuncArgument::ArgType Deserializer::deserialize_extern_func_argument_type(
     }
 }
 
+Argument::Kind Deserializer::deserialize_argument_kind(Serialize::ArgumentKind argument_kind) {
+    switch (argument_kind) {
+    case Serialize::ArgumentKind::InputScalar:
+        return Argument::Kind::InputScalar;
+    case Serialize::ArgumentKind::InputBuffer:
+        return Argument::Kind::InputBuffer;
+    case Serialize::ArgumentKind::OutputBuffer:
+        return Argument::Kind::OutputBuffer;
+    default:
+        user_error << "unknown argument kind " << (int)argument_kind << "\n";
+        return Argument::Kind::InputScalar;
+    }
+}
+
+LinkageType Deserializer::deserialize_linkage_type(Serialize::LinkageType linkage_type) {
+    switch (linkage_type) {
+    case Serialize::LinkageType::External:
+        return LinkageType::External;
+    case Serialize::LinkageType::ExternalPlusMetadata:
+        return LinkageType::ExternalPlusMetadata;
+    case Serialize::LinkageType::ExternalPlusArgv:
+        return LinkageType::ExternalPlusArgv;
+    case Serialize::LinkageType::Internal:
+        return LinkageType::Internal;
+    default:
+        user_error << "unknown linkage type " << (int)linkage_type << "\n";
+        return LinkageType::External;
+    }
+}
+
 Type Deserializer::deserialize_type(const Serialize::Type *type) {
     user_assert(type != nullptr) << "deserializing a null Type\n";
     using Serialize::TypeCode;
@@ -502,6 +670,9 @@ void Deserializer::deserialize_function(const Serialize::Func *function, Functio
     const std::vector<std::string> trace_tags =
         deserialize_vector<flatbuffers::String, std::string>(function->trace_tags(),
                                                              &Deserializer::deserialize_string);
+    const std::string trace_sampling_var = deserialize_string(function->trace_sampling_var());
+    const auto trace_sampling = deserialize_trace_sampling(function->trace_sampling());
+    const int trace_sampling_n = function->trace_sampling_n();
     const bool no_profiling = function->no_profiling();
     const bool frozen = function->frozen();
     hl_function.update_with_deserialization(name, origin_name, output_types, required_types,
@@ -509,6 +680,7 @@ void Deserializer::deserialize_function(const Serialize::Func *function, Functio
                                             debug_file, output_buffers, extern_arguments, extern_function_name,
                                             name_mangling, extern_function_device_api, extern_proxy_expr,
                                             trace_loads, trace_stores, trace_realizations, trace_tags,
+                                            trace_sampling_var, trace_sampling, trace_sampling_n,
                                             no_profiling, frozen);
 }
 
@@ -1017,6 +1189,7 @@ FuncSchedule Deserializer::deserialize_func_schedule(const Serialize::FuncSchedu
     const auto async = func_schedule->async();
     const auto ring_buffer = deserialize_expr(func_schedule->ring_buffer_type(), func_schedule->ring_buffer());
     const auto memoize_eviction_key = deserialize_expr(func_schedule->memoize_eviction_key_type(), func_schedule->memoize_eviction_key());
+    const auto memoize_hash_buffer_contents = func_schedule->memoize_hash_buffer_contents();
     auto hl_func_schedule = FuncSchedule();
     hl_func_schedule.store_level() = store_level;
     hl_func_schedule.compute_level() = compute_level;
@@ -1030,6 +1203,7 @@ FuncSchedule Deserializer::deserialize_func_schedule(const Serialize::FuncSchedu
     hl_func_schedule.async() = async;
     hl_func_schedule.ring_buffer() = ring_buffer;
     hl_func_schedule.memoize_eviction_key() = memoize_eviction_key;
+    hl_func_schedule.memoize_hash_buffer_contents() = memoize_hash_buffer_contents;
     return hl_func_schedule;
 }
 
@@ -1333,11 +1507,28 @@ Buffer<> Deserializer::deserialize_buffer(const Serialize::Buffer *buffer) {
         }
         dense_buffer_dimensions.push_back(dense_dim);
     }
+    const uint8_t *data = buffer->data()->data();
+    const size_t size = buffer->data()->size();
+    // The serializer aligns the contents of buffers, so a dense buffer
+    // in a memory-mapped file can use its contents in place.
+    bool is_dense = true;
+    for (int i = 0; i < dimensions; ++i) {
+        is_dense &= hl_buffer_dimensions[i].stride == dense_buffer_dimensions[i].stride;
+    }
+    is_dense &= dimensions == 0 || hl_buffer_dimensions[0].stride == 1;
+    if (mapped_file && mapped_file->is_mapped() && is_dense && size > 0 &&
+        ((uintptr_t)data % FLATBUFFERS_MAX_ALIGNMENT) == 0) {
+        auto hl_buffer = Buffer<>(type, (void *)data, dimensions, hl_buffer_dimensions.data(), name);
+        if (hl_buffer.size_in_bytes() == size) {
+            hl_buffer.take_ownership_of_host(release_mapped_file, new std::shared_ptr<MappedFile>(mapped_file));
+            return hl_buffer;
+        }
+    }
     // To handle cropped buffer, we create a dense buffer and serialize into it,
     // then create a (potential sparse) buffer with orignal dimension infos and copy from the dense buffer
     auto fake_dense_buffer = Buffer<>(type, nullptr, dimensions, dense_buffer_dimensions.data(), name + "_dense_fake");
     auto dense_buffer = Buffer<>::make_with_shape_of(fake_dense_buffer, nullptr, nullptr, name + "_dense_tmp");
-    memcpy(dense_buffer.data(), buffer->data()->data(), buffer->data()->size());
+    memcpy(dense_buffer.data(), data, size);
     auto fake_buffer = Buffer<>(type, nullptr, dimensions, hl_buffer_dimensions.data(), name + "_fake");
     auto hl_buffer = Buffer<>::make_with_shape_of(fake_buffer, nullptr, nullptr, name);
     hl_buffer.copy_from(dense_buffer);
@@ -1359,6 +1550,72 @@ std::map<std::string, FunctionPtr> Deserializer::deserialize_wrapper_refs(const
     return result;
 }
 
+ArgumentEstimates Deserializer::deserialize_argument_estimates(const Serialize::ArgumentEstimates *argument_estimates) {
+    user_assert(argument_estimates != nullptr) << "deserializing a null ArgumentEstimates\n";
+    ArgumentEstimates result;
+    result.scalar_def = deserialize_expr(argument_estimates->scalar_def_type(), argument_estimates->scalar_def());
+    result.scalar_min = deserialize_expr(argument_estimates->scalar_min_type(), argument_estimates->scalar_min());
+    result.scalar_max = deserialize_expr(argument_estimates->scalar_max_type(), argument_estimates->scalar_max());
+    result.scalar_estimate = deserialize_expr(argument_estimates->scalar_estimate_type(), argument_estimates->scalar_estimate());
+    result.buffer_estimates =
+        deserialize_vector<Serialize::Range, Range>(argument_estimates->buffer_estimates(),
+                                                    &Deserializer::deserialize_range);
+    return result;
+}
+
+LoweredArgument Deserializer::deserialize_lowered_argument(const Serialize::LoweredArgument *lowered_argument) {
+    user_assert(lowered_argument != nullptr) << "deserializing a null LoweredArgument\n";
+    const std::string name = deserialize_string(lowered_argument->name());
+    const auto kind = deserialize_argument_kind(lowered_argument->kind());
+    const auto type = deserialize_type(lowered_argument->type());
+    const int dimensions = lowered_argument->dimensions();
+    const auto argument_estimates = deserialize_argument_estimates(lowered_argument->argument_estimates());
+    LoweredArgument result(name, kind, type, (uint8_t)dimensions, argument_estimates);
+    result.alignment = deserialize_modulus_remainder(lowered_argument->alignment());
+    return result;
+}
+
+LoweredFunc Deserializer::deserialize_lowered_func(const Serialize::LoweredFunc *lowered_func) {
+    user_assert(lowered_func != nullptr) << "deserializing a null LoweredFunc\n";
+    const std::string name = deserialize_string(lowered_func->name());
+    const std::vector<LoweredArgument> args =
+        deserialize_vector<Serialize::LoweredArgument, LoweredArgument>(lowered_func->args(),
+                                                                        &Deserializer::deserialize_lowered_argument);
+    const auto body = deserialize_stmt(lowered_func->body_type(), lowered_func->body());
+    const auto linkage = deserialize_linkage_type(lowered_func->linkage());
+    const auto name_mangling = deserialize_name_mangling(lowered_func->name_mangling());
+    LoweredFunc result(name, args, body, linkage, name_mangling);
+    result.target_features = deserialize_string(lowered_func->target_features());
+    return result;
+}
+
+Module Deserializer::deserialize_module(const Serialize::Module *module) {
+    user_assert(module != nullptr) << "deserializing a null Module\n";
+    const std::string name = deserialize_string(module->name());
+    const Target target(deserialize_string(module->target()));
+    MetadataNameMap metadata_name_map;
+    for (const auto &entry : *module->metadata_name_map()) {
+        metadata_name_map[deserialize_string(entry->from_name())] = deserialize_string(entry->to_name());
+    }
+    Module result(name, target, metadata_name_map);
+    const std::vector<std::string> buffer_names =
+        deserialize_vector<flatbuffers::String, std::string>(module->buffer_names(),
+                                                             &Deserializer::deserialize_string);
+    for (const auto &buffer_name : buffer_names) {
+        user_assert(buffers_in_pipeline.count(buffer_name)) << "buffer " << buffer_name << " not found in pipeline\n";
+        result.append(buffers_in_pipeline[buffer_name]);
+    }
+    for (const auto &function : *module->functions()) {
+        result.append(deserialize_lowered_func(function));
+    }
+    for (const auto &submodule : *module->submodules()) {
+        result.append(deserialize_module(submodule));
+    }
+    result.set_any_strict_float(module->any_strict_float());
+    result.set_skip_llvm_optimization(module->skip_llvm_optimization());
+    return result;
+}
+
 void Deserializer::build_reverse_function_mappings(const std::vector<Function> &functions) {
     if (!this->reverse_function_mappings.empty()) {
         this->reverse_function_mappings.clear();
@@ -1375,18 +1632,12 @@ void Deserializer::build_reverse_function_mappings(const std::vector<Function> &
 }
 
 Pipeline Deserializer::deserialize(const std::string &filename) {
-    std::ifstream in(filename, std::ios::binary | std::ios::in);
-    if (!in) {
+    mapped_file = MappedFile::open(filename);
+    if (!mapped_file) {
         user_error << "failed to open file " << filename << "\n";
         return Pipeline();
     }
-    Pipeline result = deserialize(in);
-    if (!in.good()) {
-        user_error << "failed to deserialize from file " << filename << " properly\n";
-        return Pipeline();
-    }
-    in.close();
-    return result;
+    return deserialize_from(mapped_file->data());
 }
 
 Pipeline Deserializer::deserialize(std::istream &in) {
@@ -1403,7 +1654,11 @@ Pipeline Deserializer::deserialize(std::istream &in) {
 }
 
 Pipeline Deserializer::deserialize(const std::vector<uint8_t> &data) {
-    const auto *pipeline_obj = Serialize::GetPipeline(data.data());
+    return deserialize_from(data.data());
+}
+
+Pipeline Deserializer::deserialize_from(const uint8_t *data) {
+    const auto *pipeline_obj = Serialize::GetPipeline(data);
     if (pipeline_obj == nullptr) {
         user_warning << "deserialized pipeline is empty\n";
         return Pipeline();
@@ -1544,6 +1799,59 @@ std::map<std::string, Parameter> Deserializer::deserialize_parameters(const std:
     return external_parameters_by_name;
 }
 
+std::vector<Module> Deserializer::deserialize_modules(const std::string &filename, std::vector<Buffer<uint8_t>> *object_code) {
+    mapped_file = MappedFile::open(filename);
+    if (!mapped_file) {
+        user_error << "failed to open file " << filename << "\n";
+        return {};
+    }
+    return deserialize_modules_from(mapped_file->data(), object_code);
+}
+
+std::vector<Module> Deserializer::deserialize_modules(std::istream &in, std::vector<Buffer<uint8_t>> *object_code) {
+    if (!in) {
+        user_error << "failed to open input stream\n";
+        return {};
+    }
+    in.seekg(0, std::ios::end);
+    int size = in.tellg();
+    in.seekg(0, std::ios::beg);
+    std::vector<uint8_t> data(size);
+    in.read((char *)data.data(), size);
+    return deserialize_modules(data, object_code);
+}
+
+std::vector<Module> Deserializer::deserialize_modules(const std::vector<uint8_t> &data, std::vector<Buffer<uint8_t>> *object_code) {
+    return deserialize_modules_from(data.data(), object_code);
+}
+
+std::vector<Module> Deserializer::deserialize_modules_from(const uint8_t *data, std::vector<Buffer<uint8_t>> *object_code) {
+    std::vector<Module> result;
+    if (object_code) {
+        object_code->clear();
+    }
+    // The lowered bodies refer to the buffers and parameters of the pipeline,
+    // so deserialize it first to populate the lookup tables
+    deserialize_from(data);
+    const auto *pipeline_obj = Serialize::GetPipeline(data);
+    if (pipeline_obj == nullptr || pipeline_obj->modules() == nullptr) {
+        return result;
+    }
+    for (const auto &module_obj : *pipeline_obj->modules()) {
+        result.push_back(deserialize_module(module_obj));
+        if (object_code) {
+            Buffer<uint8_t> code;
+            const auto *code_obj = module_obj->object_code();
+            if (code_obj != nullptr && code_obj->size() > 0) {
+                code = Buffer<uint8_t>((int)code_obj->size());
+                memcpy(code.data(), code_obj->data(), code_obj->size());
+            }
+            object_code->push_back(code);
+        }
+    }
+    return result;
+}
+
 }  // namespace Internal
 
 Pipeline deserialize_pipeline(const std::string &filename, const std::map<std::string, Parameter> &user_params) {
@@ -1576,6 +1884,24 @@ std::map<std::string, Parameter> deserialize_parameters(const std::vector<uint8_
     return deserializer.deserialize_parameters(buffer);
 }
 
+std::vector<Module> deserialize_modules(const std::string &filename, const std::map<std::string, Parameter> &user_params,
+                                        std::vector<Buffer<uint8_t>> *object_code) {
+    Internal::Deserializer deserializer(user_params);
+    return deserializer.deserialize_modules(filename, object_code);
+}
+
+std::vector<Module> deserialize_modules(std::istream &in, const std::map<std::string, Parameter> &user_params,
+                                        std::vector<Buffer<uint8_t>> *object_code) {
+    Internal::Deserializer deserializer(user_params);
+    return deserializer.deserialize_modules(in, object_code);
+}
+
+std::vector<Module> deserialize_modules(const std::vector<uint8_t> &buffer, const std::map<std::string, Parameter> &user_params,
+                                        std::vector<Buffer<uint8_t>> *object_code) {
+    Internal::Deserializer deserializer(user_params);
+    return deserializer.deserialize_modules(buffer, object_code);
+}
+
 }  // namespace Halide
 
 #else  // WITH_SERIALIZATION
@@ -1612,6 +1938,24 @@ std::map<std::string, Parameter> deserialize_parameters(const std::vector<uint8_
     return {};
 }
 
+std::vector<Module> deserialize_modules(const std::string &filename, const std::map<std::string, Parameter> &user_params,
+                                        std::vector<Buffer<uint8_t>> *object_code) {
+    user_error << "Deserialization is not supported in this build of Halide; try rebuilding with WITH_SERIALIZATION=ON.";
+    return {};
+}
+
+std::vector<Module> deserialize_modules(std::istream &in, const std::map<std::string, Parameter> &user_params,
+                                        std::vector<Buffer<uint8_t>> *object_code) {
+    user_error << "Deserialization is not supported in this build of Halide; try rebuilding with WITH_SERIALIZATION=ON.";
+    return {};
+}
+
+std::vector<Module> deserialize_modules(const std::vector<uint8_t> &buffer, const std::map<std::string, Parameter> &user_params,
+                                        std::vector<Buffer<uint8_t>> *object_code) {
+    user_error << "Deserialization is not supported in this build of Halide; try rebuilding with WITH_SERIALIZATION=ON.";
+    return {};
+}
+
 }  // namespace Halide
 
 #endif  // WITH_SERIALIZATION
@@ -47,6 +47,31 @@ std::map<std::string, Parameter> deserialize_parameters(std::istream &in);
 /// @return Returns a map containing the names and description of external parameters referenced in the pipeline
 std::map<std::string, Parameter> deserialize_parameters(const std::vector<uint8_t> &data);
 
+/// @brief Deserialize the lowered Modules stored with a Halide pipeline in a file.
+/// @param filename The location of the file to deserialize.  Must use .hlpipe extension.
+/// @param user_params Map of named input/output parameters to bind with the resulting modules (used to avoid deserializing specific objects and enable the use of externally defined ones instead).
+/// @param object_code If non-null, populated with the object code stored for each returned Module, or an undefined Buffer for those stored without it.
+/// @return Returns the deserialized Modules, in the order they were serialized
+std::vector<Module> deserialize_modules(const std::string &filename, const std::map<std::string, Parameter> &user_params,
+                                        std::vector<Buffer<uint8_t>> *object_code = nullptr);
+
+/// @brief Deserialize the lowered Modules stored with a Halide pipeline from an input stream.
+/// @param in The input stream to read from containing a serialized Halide pipeline
+/// @param user_params Map of named input/output parameters to bind with the resulting modules (used to avoid deserializing specific objects and enable the use of externally defined ones instead).
+/// @param object_code If non-null, populated with the object code stored for each returned Module, or an undefined Buffer for those stored without it.
+/// @return Returns the deserialized Modules, in the order they were serialized
+std::vector<Module> deserialize_modules(std::istream &in, const std::map<std::string, Parameter> &user_params,
+                                        std::vector<Buffer<uint8_t>> *object_code = nullptr);
+
+/// @brief Deserialize the lowered Modules stored with a Halide pipeline from a byte buffer containing a serialized
+///        pipeline in binary format.
+/// @param data The data buffer containing a serialized Halide pipeline
+/// @param user_params Map of named input/output parameters to bind with the resulting modules (used to avoid deserializing specific objects and enable the use of externally defined ones instead).
+/// @param object_code If non-null, populated with the object code stored for each returned Module, or an undefined Buffer for those stored without it.
+/// @return Returns the deserialized Modules, in the order they were serialized
+std::vector<Module> deserialize_modules(const std::vector<uint8_t> &data, const std::map<std::string, Parameter> &user_params,
+                                        std::vector<Buffer<uint8_t>> *object_code = nullptr);
+
 }  // namespace Halide
 
 #endif
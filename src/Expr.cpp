@@ -4,6 +4,46 @@
 namespace Halide {
 namespace Internal {
 
+namespace {
+
+// Small integer constants and booleans are the most common nodes in
+// the IR (loop mins, strides, offsets, predicates, ...), so we make
+// each of them once and share it, instead of allocating a new node
+// every time. The shared nodes hold a reference of their own, so they
+// are never destroyed.
+constexpr int64_t min_shared_int = -16, max_shared_int = 64;
+
+template<typename T, typename V>
+const T *make_shared_imm(Type t, V value) {
+    T *node = new T;
+    node->type = t;
+    node->value = value;
+    node->ref_count.increment();
+    return node;
+}
+
+struct SharedImms {
+    const IntImm *int32s[max_shared_int - min_shared_int];
+    const UIntImm *bools[2];
+
+    SharedImms() {
+        for (int64_t i = min_shared_int; i < max_shared_int; i++) {
+            int32s[i - min_shared_int] = make_shared_imm<IntImm>(Int(32), i);
+        }
+        bools[0] = make_shared_imm<UIntImm>(UInt(1), (uint64_t)0);
+        bools[1] = make_shared_imm<UIntImm>(UInt(1), (uint64_t)1);
+    }
+};
+
+const SharedImms &shared_imms() {
+    // Deliberately leaked, so that Exprs in other static objects can
+    // still refer to these while the program exits.
+    static const SharedImms *imms = new SharedImms;
+    return *imms;
+}
+
+}  // namespace
+
 const IntImm *IntImm::make(Type t, int64_t value) {
     internal_assert(t.is_int() && t.is_scalar())
         << "IntImm must be a scalar Int\n";
@@ -18,6 +58,10 @@ const IntImm *IntImm::make(Type t, int64_t value) {
     // Then sign-extending to get them back
     value >>= (64 - t.bits());
 
+    if (t == Int(32) && value >= min_shared_int && value < max_shared_int) {
+        return shared_imms().int32s[value - min_shared_int];
+    }
+
     IntImm *node = new IntImm;
     node->type = t;
     node->value = value;
@@ -34,6 +78,10 @@ const UIntImm *UIntImm::make(Type t, uint64_t value) {
     value <<= (64 - t.bits());
     value >>= (64 - t.bits());
 
+    if (t == UInt(1)) {
+        return shared_imms().bools[value];
+    }
+
     UIntImm *node = new UIntImm;
     node->type = t;
     node->value = value;
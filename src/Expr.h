@@ -376,7 +376,10 @@ enum class MemoryType {
     GPUShared,
 
     /** Allocation is stored in GPU texture memory and accessed through
-     * hardware sampler */
+     * hardware sampler. Only OpenCL has texture (image object) support
+     * at present. Other GPU APIs store these like Heap allocations; CUDA
+     * kernels load any buffer they don't write through the read-only
+     * data cache, which is the texture cache on most GPUs. */
     GPUTexture,
 
     /** Allocate Locked Cache Memory to act as local memory */
@@ -390,6 +393,37 @@ enum class MemoryType {
     /** AMX Tile register for X86. Any data that would be used in an AMX matrix
      * multiplication must first be loaded into an AMX tile register. */
     AMXTile,
+
+    /** Heap memory written with non-temporal (streaming) stores that
+     * bypass the cache, followed by a fence at the end of the
+     * producer. Good for large write-once outputs that won't be read
+     * again soon. Use with OutputImageParam::store_in for pipeline
+     * outputs. Dense vector stores are only streaming on the CPU if
+     * they are aligned, so align the output buffer too. */
+    Streaming,
+
+    /** A tensor core accumulator for CUDA. The allocation is a 16x16
+     * tile of a matrix multiply, held in the registers of a warp, and
+     * must be computed at the level of a GPU block, with its pure and
+     * update definitions and its consumer each vectorized over the whole
+     * tile, and the update reduction vectorized over 16 elements, as
+     * for MemoryType::AMXTile. It is then computed with WMMA
+     * instructions, loading its inputs straight from their buffers:
+     * f16 or bf16 inputs accumulated in f32, or (u)int8 inputs
+     * accumulated in int32. The input tiles and output tile must be
+     * 32-byte aligned, so their row strides should be multiples of 32
+     * bytes. */
+    WMMAAccumulator,
+
+    /** A SIMD-group matrix for Metal on Apple GPUs. The allocation is
+     * an 8x8 tile of a matrix multiply, held in the registers of a
+     * SIMD-group, and is scheduled like MemoryType::WMMAAccumulator,
+     * with the update reduction vectorized over 8 elements. It is then
+     * computed with simdgroup_multiply_accumulate, loading its inputs
+     * straight from their buffers (which may be staged in GPUShared
+     * memory by the schedule): float32 or float16 inputs, accumulated
+     * in the same type. Needs an Apple7 (A14 or M1) or later GPU. */
+    SimdgroupMatrix,
 };
 
 namespace Internal {
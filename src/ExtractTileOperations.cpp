@@ -1,11 +1,21 @@
 #include "ExtractTileOperations.h"
 
+#include "CanonicalizeGPUVars.h"
+#include "Deinterleave.h"
+#include "FindIntrinsics.h"
+#include "IREquality.h"
 #include "IRMatch.h"
 #include "IRMutator.h"
 #include "IROperator.h"
+#include "IRPrinter.h"
+#include "Simplify.h"
+#include "Substitute.h"
 #include "Util.h"
 
-/** \file Support extraction of AMX instructions. */
+#include <algorithm>
+
+/** \file Support extraction of AMX instructions, and of the tile
+ * operations of CUDA tensor cores (WMMA) and Metal SIMD-group matrices. */
 
 /**
  * https://asciiflow.com/#/share/eJyVUkFugzAQ%2FMrKxwoRhdAkza23SmlySHvogQsBp7FkbGSbAoryiz6nr%2BlLugZDk6ghKvJhbXZmd2b3QEScUbIQBece4XFNFVmQQ0SqiCwegtCLSI1RMBtjZGhl8BIRAHh%2BeoFVbBSr4Pq36ZOiSOBpX5cDCEikSGhuipjzun0pmdnD4%2BqtwX9%2Ffg2cLmUcTML76WyO4VAtWJ%2Ff7kIkWMEJ6gbBae2%2F3q53OHBuFBz3TS1HodPqfvUO3%2F4wO7gQag07IXqVkCuZU4VzyApuWI5BAJkdZ0K1B2ZP2%2BwJ%2FEs%2BjhKY0EYViWFSaMAaO6kypBY1hLCtDRIvMTvsekmlsc2kiGgKMw2cxqkGIyEGjn%2FlzonoIMjPUibeQX5Q1bHGisbav%2FBh2kHW2ESzdlaZkqUltaFd9UZ25TnIrIOg%2Bb7vQykLnv661GysRSaSF1k78HkHcaSbntSReLAtTL%2FscOlaI9rxYaRzzgwUOTrZeOCokLzN0TDqRYvUqtFwB6Fvqco9S5r%2BBCiqsWmNLHabzny2Y7E4PyJHcvwBx0t%2BJw%3D%3D)
@@ -669,10 +679,383 @@ class ExtractTileOperations : public IRMutator {
     }
 };
 
+class InjectTileWarps : public IRMutator {
+    using IRMutator::visit;
+
+    bool in_blocks = false, in_threads = false;
+    DeviceAPI device_api = DeviceAPI::None;
+
+    Stmt visit(const For *op) override {
+        ScopedValue<bool> old_in_blocks(in_blocks, in_blocks || op->for_type == ForType::GPUBlock);
+        ScopedValue<bool> old_in_threads(in_threads, in_threads ||
+                                                         op->for_type == ForType::GPUThread ||
+                                                         op->for_type == ForType::GPULane);
+        ScopedValue<DeviceAPI> old_device_api(device_api, op->for_type == ForType::GPUBlock ? op->device_api : device_api);
+        return IRMutator::visit(op);
+    }
+
+    Stmt visit(const Allocate *op) override {
+        DeviceAPI api;
+        int tile_size;
+        if (op->memory_type == MemoryType::WMMAAccumulator) {
+            api = DeviceAPI::CUDA;
+            tile_size = 16;
+        } else if (op->memory_type == MemoryType::SimdgroupMatrix) {
+            api = DeviceAPI::Metal;
+            tile_size = 8;
+        } else {
+            return IRMutator::visit(op);
+        }
+
+        user_assert(in_blocks && !in_threads && device_api == api)
+            << op->memory_type << " allocation " << op->name
+            << " must be computed within a loop over " << (api == DeviceAPI::CUDA ? "CUDA" : "Metal")
+            << " blocks, outside of any loop over GPU threads.\n";
+        user_assert(op->constant_allocation_size() == tile_size * tile_size)
+            << op->memory_type << " allocation " << op->name << " must be a "
+            << tile_size << "x" << tile_size << " tile.\n";
+
+        // The rest of the kernel runs on these threads too, redundantly
+        // if it doesn't have loops over threads of its own.
+        Stmt body = mutate(op->body);
+        Stmt s = Allocate::make(op->name, op->type, op->memory_type, op->extents,
+                                op->condition, body, op->new_expr, op->free_function, op->padding);
+        return For::make(op->name + ".warp." + gpu_thread_name(0), 0, 32,
+                         ForType::GPULane, Partition::Never, device_api, s);
+    }
+};
+
+// See extract_warp_tile_operations.
+class ExtractWarpTileOperations : public IRMutator {
+    using IRMutator::visit;
+
+    const WarpTileInfo &info;
+    const int n, fragment_lanes;
+    std::string acc_name;
+    Type acc_type;
+
+    struct TileIndex {
+        bool result = false;
+        Expr base;
+        std::vector<Expr> stride;
+    };
+
+    // Decompose a vector index whose lanes traverse a tile of the given
+    // extents, the first varying fastest, into a base and a stride for
+    // each dimension. This only looks at some of the lanes, so it relies
+    // on the index being affine in the coordinates of the tile, which it
+    // is for the accesses in a matrix multiply.
+    static TileIndex tile_index(const Expr &index, const std::vector<int> &extents) {
+        TileIndex t;
+        t.base = simplify(extract_lane(index, 0));
+        int unit = 1;
+        std::vector<int> units;
+        for (int e : extents) {
+            t.stride.push_back(simplify(extract_lane(index, unit) - t.base));
+            units.push_back(unit);
+            unit *= e;
+        }
+        internal_assert(unit == index.type().lanes());
+        auto check = [&](const std::vector<int> &coords) {
+            int lane = 0;
+            Expr expected = t.base;
+            for (size_t d = 0; d < coords.size(); d++) {
+                lane += coords[d] * units[d];
+                expected += coords[d] * t.stride[d];
+            }
+            return is_const_zero(simplify(extract_lane(index, lane) - expected));
+        };
+        std::vector<int> last;
+        for (size_t d = 0; d < extents.size(); d++) {
+            std::vector<int> coords(extents.size(), 0);
+            coords[d] = extents[d] - 1;
+            if (!check(coords)) {
+                return t;
+            }
+            last.push_back(extents[d] - 1);
+        }
+        t.result = check(last);
+        return t;
+    }
+
+    static bool is_widening(const Cast *c) {
+        return c->type.bits() > c->value.type().bits() &&
+               c->type.can_represent(c->value.type());
+    }
+
+    static Expr strip_widening_casts(Expr e) {
+        while (const Cast *c = e.as<Cast>()) {
+            if (!is_widening(c)) {
+                break;
+            }
+            e = c->value;
+        }
+        return e;
+    }
+
+    // Find the load of a tile used (possibly widened) as an operand, and
+    // its index in the lanes of the operand.
+    static const Load *tile_load(const Expr &e, Expr *index) {
+        if (const Load *load = e.as<Load>()) {
+            *index = load->index;
+            return is_const_one(load->predicate) ? load : nullptr;
+        } else if (const Cast *c = e.as<Cast>()) {
+            return is_widening(c) ? tile_load(c->value, index) : nullptr;
+        } else if (const Broadcast *b = e.as<Broadcast>()) {
+            const Load *load = tile_load(b->value, index);
+            *index = Broadcast::make(*index, b->lanes);
+            return load;
+        } else if (const Shuffle *s = e.as<Shuffle>()) {
+            if (s->vectors.size() == 1) {
+                const Load *load = tile_load(s->vectors[0], index);
+                *index = Shuffle::make({*index}, s->indices);
+                return load;
+            }
+        }
+        return nullptr;
+    }
+
+    // Whether an access to the accumulator covers the whole tile, with
+    // its lanes in row-major order (n fastest) or column-major order.
+    // We store the accumulator tile row-major: its m coordinate is the
+    // outer dimension of the allocation.
+    bool accumulator_lanes(const Expr &index, bool *row_major) const {
+        TileIndex i = tile_index(index, {n, n});
+        if (!i.result || !is_const_zero(i.base)) {
+            return false;
+        }
+        *row_major = is_const_one(i.stride[0]) && is_const(i.stride[1], n);
+        return *row_major || (is_const(i.stride[0], n) && is_const_one(i.stride[1]));
+    }
+
+    Expr fragment() const {
+        return Load::make(acc_type.with_lanes(fragment_lanes), acc_name,
+                          Ramp::make(0, 1, fragment_lanes), Buffer<>(), Parameter(),
+                          const_true(fragment_lanes), ModulusRemainder());
+    }
+
+    Stmt store_fragment(const Expr &value) const {
+        return Store::make(acc_name, value, Ramp::make(0, 1, fragment_lanes), Parameter(),
+                           const_true(fragment_lanes), ModulusRemainder());
+    }
+
+    // The matrix multiply-accumulate of an nxnxn tile, of the form
+    // acc[tile] = VectorReduce(Add, widen(a) * widen(b)) + acc[tile],
+    // where the widening is optional for floats.
+    Stmt convert_to_mma(const Store *op) {
+        const Add *add = op->value.as<Add>();
+        if (!add) {
+            return Stmt();
+        }
+        const VectorReduce *reduce = add->a.as<VectorReduce>();
+        const Load *acc = add->b.as<Load>();
+        if (!reduce) {
+            reduce = add->b.as<VectorReduce>();
+            acc = add->a.as<Load>();
+        }
+        bool row_major;
+        if (!reduce || !acc ||
+            reduce->op != VectorReduce::Add ||
+            reduce->value.type().lanes() != n * reduce->type.lanes() ||
+            acc->name != acc_name ||
+            !equal(acc->index, op->index) ||
+            !accumulator_lanes(op->index, &row_major)) {
+            return Stmt();
+        }
+
+        // Products of integers are usually widened only as far as they
+        // need to be (see find_intrinsics).
+        Expr product = lower_intrinsics(reduce->value);
+        if (const Cast *c = product.as<Cast>()) {
+            if (c->value.as<Mul>()) {
+                product = strip_widening_casts(product);
+            }
+        }
+        const Mul *mul = product.as<Mul>();
+        if (!mul) {
+            return Stmt();
+        }
+        // The operands' lanes are in the order (k, n, m) if the
+        // accumulator's are row-major, or (k, m, n).
+        Expr a_index, b_index;
+        const Load *a = tile_load(mul->a, &a_index);
+        const Load *b = tile_load(mul->b, &b_index);
+        if (!a || !b || a->type.element_of() != b->type.element_of()) {
+            return Stmt();
+        }
+        const Type t = a->type.element_of();
+        if (!t.is_float() && mul->type.bits() < 2 * t.bits()) {
+            // The products may overflow, and in the matrix instructions
+            // they won't.
+            return Stmt();
+        }
+        if (!info.check_types(acc_name, t, acc_type)) {
+            return Stmt();
+        }
+
+        TileIndex ai = tile_index(a_index, {n, n, n});
+        TileIndex bi = tile_index(b_index, {n, n, n});
+        if (!ai.result || !bi.result) {
+            return Stmt();
+        }
+        const int m_dim = row_major ? 2 : 1, n_dim = row_major ? 1 : 2;
+        if (!is_const_zero(ai.stride[n_dim])) {
+            // The operands are the other way around.
+            std::swap(a, b);
+            std::swap(ai, bi);
+        }
+        if (!is_const_zero(ai.stride[n_dim]) || !is_const_zero(bi.stride[m_dim])) {
+            return Stmt();
+        }
+
+        // The layout of each operand, and the stride between its rows
+        // (or columns).
+        Expr a_stride, b_stride;
+        bool a_col, b_col;
+        if (is_const_one(ai.stride[0])) {
+            a_col = false;
+            a_stride = ai.stride[m_dim];
+        } else if (is_const_one(ai.stride[m_dim])) {
+            a_col = true;
+            a_stride = ai.stride[0];
+        } else {
+            return Stmt();
+        }
+        if (is_const_one(bi.stride[n_dim])) {
+            b_col = false;
+            b_stride = bi.stride[0];
+        } else if (is_const_one(bi.stride[0])) {
+            b_col = true;
+            b_stride = bi.stride[n_dim];
+        } else {
+            return Stmt();
+        }
+
+        Expr mma = Call::make(acc_type.with_lanes(fragment_lanes), info.intrinsic_prefix + "_mma",
+                              {StringImm::make(a->name), ai.base, a_stride, make_bool(a_col),
+                               StringImm::make(b->name), bi.base, b_stride, make_bool(b_col),
+                               make_zero(t), fragment()},
+                              Call::Extern);
+        return store_fragment(mma);
+    }
+
+    // A store of the accumulator tile to memory.
+    Stmt convert_to_store(const Store *op) {
+        const Load *acc = op->value.as<Load>();
+        bool row_major;
+        if (!acc || acc->name != acc_name ||
+            op->value.type() != acc_type.with_lanes(n * n) ||
+            !is_const_one(op->predicate) ||
+            !accumulator_lanes(acc->index, &row_major)) {
+            return Stmt();
+        }
+        TileIndex i = tile_index(op->index, {n, n});
+        if (!i.result) {
+            return Stmt();
+        }
+        const Expr &m_stride = i.stride[row_major ? 1 : 0];
+        const Expr &n_stride = i.stride[row_major ? 0 : 1];
+        Expr stride;
+        bool col;
+        if (is_const_one(n_stride)) {
+            col = false;
+            stride = m_stride;
+        } else if (is_const_one(m_stride)) {
+            col = true;
+            stride = n_stride;
+        } else {
+            return Stmt();
+        }
+        return Evaluate::make(Call::make(Int(32), info.intrinsic_prefix + "_store",
+                                         {StringImm::make(op->name), i.base, stride, make_bool(col), fragment()},
+                                         Call::Extern));
+    }
+
+    Stmt visit(const Allocate *op) override {
+        if (op->memory_type != info.memory_type) {
+            return IRMutator::visit(op);
+        }
+        internal_assert(acc_name.empty());
+        ScopedValue<std::string> old_acc_name(acc_name, op->name);
+        ScopedValue<Type> old_acc_type(acc_type, op->type);
+        user_assert(std::find(info.accumulator_types.begin(), info.accumulator_types.end(), op->type) !=
+                    info.accumulator_types.end())
+            << info.memory_type << " allocation " << op->name << " can't have type " << op->type << "\n";
+
+        // Look through any lets, to see the vectors in each tile operation.
+        Stmt body = mutate(substitute_in_all_lets(op->body));
+        return Allocate::make(op->name, op->type, MemoryType::Register, {fragment_lanes},
+                              op->condition, body);
+    }
+
+    Stmt visit(const Atomic *op) override {
+        // The (vectorized) reduction into the accumulator is atomic,
+        // but its fragments aren't shared.
+        Stmt body = mutate(op->body);
+        if (!acc_name.empty() && op->producer_name == acc_name) {
+            return body;
+        }
+        return body.same_as(op->body) ? op : Atomic::make(op->producer_name, op->mutex_name, body);
+    }
+
+    Stmt visit(const Store *op) override {
+        if (acc_name.empty()) {
+            return IRMutator::visit(op);
+        }
+        Stmt s;
+        if (op->name == acc_name) {
+            const Broadcast *b = op->value.as<Broadcast>();
+            bool row_major;
+            user_assert(is_const_one(op->predicate) && accumulator_lanes(op->index, &row_major))
+                << "Store to part of the " << info.memory_type << " allocation " << acc_name << ": " << Stmt(op)
+                << "Its definitions must be vectorized over the whole " << n << "x" << n << " tile.\n";
+            if (b && b->value.type().is_scalar()) {
+                // All the elements of each fragment are equal.
+                s = store_fragment(Broadcast::make(b->value, fragment_lanes));
+            } else {
+                s = convert_to_mma(op);
+            }
+            user_assert(s.defined())
+                << info.memory_type << " allocation " << acc_name << " is computed by an operation that is not a "
+                << n << "x" << n << "x" << n << " matrix multiply-accumulate of " << info.operand_types
+                << " tiles, or a broadcast: " << Stmt(op);
+        } else {
+            s = convert_to_store(op);
+        }
+        if (s.defined()) {
+            return s;
+        }
+        return IRMutator::visit(op);
+    }
+
+    Expr visit(const Load *op) override {
+        // Tile loads have all been matched elsewhere.
+        user_assert(op->name != acc_name)
+            << info.memory_type << " allocation " << acc_name << " is used by an operation that is not a "
+            << n << "x" << n << "x" << n << " matrix multiply-accumulate of " << info.operand_types
+            << " tiles, or a store of the tile to memory: " << Expr(op) << "\n";
+        return IRMutator::visit(op);
+    }
+
+public:
+    ExtractWarpTileOperations(const WarpTileInfo &info)
+        : info(info), n(info.tile_size), fragment_lanes(info.fragment_lanes) {
+    }
+};
+
 }  // namespace
 
 Stmt extract_tile_operations(const Stmt &s) {
     return ExtractTileOperations().mutate(s);
 }
+
+Stmt inject_tile_warps(const Stmt &s) {
+    return InjectTileWarps().mutate(s);
+}
+
+Stmt extract_warp_tile_operations(const Stmt &s, const WarpTileInfo &info) {
+    return ExtractWarpTileOperations(info).mutate(s);
+}
+
 }  // namespace Internal
 }  // namespace Halide
@@ -2,10 +2,14 @@
 #define HALIDE_EXTRACT_TILE_OPERATIONS_H
 
 /** \file
- * Defines the lowering pass that injects calls to tile intrinsics that support
- * AMX instructions.
+ * Defines the lowering passes that prepare tile operations for AMX, for
+ * CUDA tensor cores, and for Metal SIMD-group matrices.
  */
 
+#include <functional>
+#include <string>
+#include <vector>
+
 #include "Expr.h"
 
 namespace Halide {
@@ -15,6 +19,49 @@ namespace Internal {
  * type as intrinsic calls, to be used in the X86 backend. */
 Stmt extract_tile_operations(const Stmt &s);
 
+/** Wrap the computation of each WMMAAccumulator or SimdgroupMatrix
+ * allocation, which must be at the level of a GPU block, in a loop over
+ * the 32 lanes of a warp (or SIMD-group), since the matrix instructions
+ * the PTX and Metal backends compute it with are executed by a whole
+ * warp together. Must be run before fuse_gpu_thread_loops. */
+Stmt inject_tile_warps(const Stmt &s);
+
+/** The matrix instructions a GPU backend computes the tiles of a
+ * memory type with (see inject_tile_warps). */
+struct WarpTileInfo {
+    MemoryType memory_type;
+    /** The m, n and k extents of each matrix multiply-accumulate. */
+    int tile_size;
+    /** The number of elements of the accumulator tile each lane holds. */
+    int fragment_lanes;
+    /** The supported types of the accumulator. */
+    std::vector<Type> accumulator_types;
+    /** A description of the supported operand types, for errors. */
+    std::string operand_types;
+    /** Whether an accumulator of the given name and type can accumulate
+     * products of operands of the given type. May raise a user error
+     * for operations the target can't compute. */
+    std::function<bool(const std::string &, const Type &, const Type &)> check_types;
+    /** The calls made are named <intrinsic_prefix>_mma and
+     * <intrinsic_prefix>_store. */
+    std::string intrinsic_prefix;
+};
+
+/** Rewrite the computation of each allocation of the memory type of
+ * info, vectorized over its tile, into calls on the fragment of the
+ * tile each lane of the warp holds, which replaces the allocation:
+ *  - <prefix>_mma(a, a_base, a_stride, a_col, b, b_base, b_stride, b_col,
+ *    zero of the operand type, fragment) for a matrix
+ *    multiply-accumulate: the names of the operands' buffers, the index
+ *    of their first elements, the stride between their rows (or columns
+ *    if *_col is true) and the fragment to accumulate into. Returns the
+ *    new fragment.
+ *  - <prefix>_store(buffer, base, stride, col, fragment) for a store of
+ *    the tile.
+ * This is for use in add_kernel of the backends, after the closure of
+ * the kernel has been found. */
+Stmt extract_warp_tile_operations(const Stmt &s, const WarpTileInfo &info);
+
 }  // namespace Internal
 }  // namespace Halide
 
@@ -100,6 +100,17 @@ std::map<std::string, Function> build_environment(const std::vector<Function> &f
     return env;
 }
 
+std::map<std::string, Function> add_wrappers_to_environment(const std::map<std::string, Function> &env) {
+    std::map<std::string, Function> result = env;
+    std::vector<Function> order;
+    for (const auto &it : env) {
+        for (const auto &w : it.second.schedule().wrappers()) {
+            populate_environment_helper(Function{w.second}, &result, &order, true, true);
+        }
+    }
+    return result;
+}
+
 std::vector<Function> called_funcs_in_order_found(const std::vector<Function> &funcs) {
     std::map<std::string, Function> env;
     std::vector<Function> order;
@@ -36,6 +36,12 @@ std::map<std::string, Function> find_transitive_calls(const Function &f);
  * a map of them. */
 std::map<std::string, Function> build_environment(const std::vector<Function> &funcs);
 
+/** Given the union of find_transitive_calls over some Functions, return
+ * what build_environment would for those Functions, which also follows the
+ * wrappers introduced by Func::in(). Only the wrappers are walked, so this
+ * is cheap when the wrapper-free environment can be reused across calls. */
+std::map<std::string, Function> add_wrappers_to_environment(const std::map<std::string, Function> &env);
+
 /** Returns the same Functions as build_environment, but returns a vector of
  * Functions instead, where the order is the order in which the Functions were
  * first encountered. This is stable to changes in the names of the Functions. */
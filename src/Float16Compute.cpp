@@ -0,0 +1,219 @@
+#include "Float16Compute.h"
+
+#include <cmath>
+
+#include "Function.h"
+#include "IRMutator.h"
+#include "IROperator.h"
+#include "Target.h"
+#include "Util.h"
+
+namespace Halide {
+namespace Internal {
+
+namespace {
+
+// The largest relative error of a single float16 rounding.
+constexpr double float16_unit_roundoff = 1.0 / 2048;
+
+// The tolerance used by Target::Float16Compute for exprs without an
+// explicit float16_compute wrapper. Enough for a handful of roundings.
+constexpr double default_float16_tolerance = 8 * float16_unit_roundoff;
+
+bool host_has_native_float16(const Target &t) {
+    return t.arch == Target::ARM && t.has_feature(Target::ARMFp16);
+}
+
+bool gpu_has_native_float16(const Target &t) {
+    return (t.has_feature(Target::CUDA) && t.get_cuda_capability_lower_bound() >= 53) ||
+           (t.has_feature(Target::OpenCL) && t.has_feature(Target::CLHalf)) ||
+           t.has_feature(Target::Metal) ||
+           (t.has_feature(Target::Vulkan) && t.has_feature(Target::VulkanFloat16));
+}
+
+bool is_scheduled_on_gpu(const Function &f) {
+    auto on_gpu = [](const Definition &def) {
+        for (const Dim &d : def.schedule().dims()) {
+            if (is_gpu(d.for_type)) {
+                return true;
+            }
+        }
+        return false;
+    };
+    if (f.has_pure_definition() && on_gpu(f.definition())) {
+        return true;
+    }
+    for (const Definition &def : f.updates()) {
+        if (on_gpu(def)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Compute a float32 Expr in float16 instead, or return an undefined Expr
+// if some part of it can't be. Counts the roundings float16 adds, which
+// bounds the relative error to first order. Cancellation in sums can make
+// the real error larger, and float16 overflows above 65504, which is why
+// this is opt-in.
+Expr narrow_to_float16(const Expr &e, int &roundings) {
+    const Type f16 = Float(16, e.type().lanes());
+    if (const Cast *op = e.as<Cast>()) {
+        const Type &from = op->value.type();
+        if (from.element_of() == Float(16)) {
+            return op->value;
+        } else if (from.is_int_or_uint() && from.bits() <= 8) {
+            // Exactly representable
+            return Cast::make(f16, op->value);
+        }
+    } else if (const FloatImm *op = e.as<FloatImm>()) {
+        if (std::abs(op->value) > 65504) {
+            return Expr();
+        }
+        Expr c = FloatImm::make(Float(16), op->value);
+        if (c.as<FloatImm>()->value != op->value) {
+            roundings++;
+        }
+        return c;
+    } else if (const Broadcast *op = e.as<Broadcast>()) {
+        Expr value = narrow_to_float16(op->value, roundings);
+        if (value.defined()) {
+            return Broadcast::make(value, op->lanes);
+        }
+    } else if (const Select *op = e.as<Select>()) {
+        Expr t = narrow_to_float16(op->true_value, roundings);
+        Expr f = narrow_to_float16(op->false_value, roundings);
+        if (t.defined() && f.defined()) {
+            return Select::make(op->condition, t, f);
+        }
+    } else if (const Add *op = e.as<Add>()) {
+        Expr a = narrow_to_float16(op->a, roundings);
+        Expr b = narrow_to_float16(op->b, roundings);
+        if (a.defined() && b.defined()) {
+            roundings++;
+            return Add::make(a, b);
+        }
+    } else if (const Sub *op = e.as<Sub>()) {
+        Expr a = narrow_to_float16(op->a, roundings);
+        Expr b = narrow_to_float16(op->b, roundings);
+        if (a.defined() && b.defined()) {
+            roundings++;
+            return Sub::make(a, b);
+        }
+    } else if (const Mul *op = e.as<Mul>()) {
+        Expr a = narrow_to_float16(op->a, roundings);
+        Expr b = narrow_to_float16(op->b, roundings);
+        if (a.defined() && b.defined()) {
+            roundings++;
+            return Mul::make(a, b);
+        }
+    } else if (const Div *op = e.as<Div>()) {
+        Expr a = narrow_to_float16(op->a, roundings);
+        Expr b = narrow_to_float16(op->b, roundings);
+        if (a.defined() && b.defined()) {
+            roundings++;
+            return Div::make(a, b);
+        }
+    } else if (const Min *op = e.as<Min>()) {
+        Expr a = narrow_to_float16(op->a, roundings);
+        Expr b = narrow_to_float16(op->b, roundings);
+        if (a.defined() && b.defined()) {
+            return Min::make(a, b);
+        }
+    } else if (const Max *op = e.as<Max>()) {
+        Expr a = narrow_to_float16(op->a, roundings);
+        Expr b = narrow_to_float16(op->b, roundings);
+        if (a.defined() && b.defined()) {
+            return Max::make(a, b);
+        }
+    }
+    return Expr();
+}
+
+class Float16Compute : public IRMutator {
+    // Whether float16 arithmetic is native where this Func is computed.
+    bool native;
+
+    // The relative error we may add. Zero means leave things alone.
+    double tolerance;
+
+    using IRMutator::visit;
+
+    Expr visit(const Call *op) override {
+        if (op->is_intrinsic(Call::float16_compute)) {
+            auto tol = as_const_float(op->args[1]);
+            internal_assert(tol) << "float16_compute tolerance must be a constant\n";
+            ScopedValue<double> bind(tolerance, *tol);
+            return mutate(op->args[0]);
+        } else if (op->is_intrinsic(Call::strict_float)) {
+            return op;
+        }
+        return IRMutator::visit(op);
+    }
+
+    Expr try_narrow(const Expr &e, int min_roundings) {
+        if (!native || tolerance <= 0) {
+            return Expr();
+        }
+        int roundings = 0;
+        Expr narrow = narrow_to_float16(e, roundings);
+        if (narrow.defined() &&
+            roundings >= min_roundings &&
+            roundings * float16_unit_roundoff <= tolerance) {
+            return narrow;
+        }
+        return Expr();
+    }
+
+    Expr visit(const Cast *op) override {
+        if (op->type.element_of() == Float(16) &&
+            op->value.type().element_of() == Float(32)) {
+            // The result gets rounded to float16 anyway, so only the
+            // intermediate roundings count.
+            Expr narrow = try_narrow(mutate(op->value), 0);
+            if (narrow.defined()) {
+                return narrow;
+            }
+        }
+        return IRMutator::visit(op);
+    }
+
+public:
+    using IRMutator::mutate;
+
+    Expr mutate(const Expr &e) override {
+        // In a float32 context (e.g. the accumulator of a reduction),
+        // arithmetic on float16 values can still be done in float16 and
+        // widened afterwards. Only worth it if there's some arithmetic.
+        if (e.defined() &&
+            e.type().element_of() == Float(32) &&
+            !e.as<Cast>()) {
+            Expr narrow = try_narrow(e, 1);
+            if (narrow.defined()) {
+                return Cast::make(e.type(), narrow);
+            }
+        }
+        return IRMutator::mutate(e);
+    }
+
+    Float16Compute(bool native, double tolerance)
+        : native(native), tolerance(tolerance) {
+    }
+};
+
+}  // namespace
+
+void lower_float16_compute(std::map<std::string, Function> &env, const Target &t) {
+    const double tolerance = t.has_feature(Target::Float16Compute) ? default_float16_tolerance : 0;
+    for (auto &iter : env) {
+        Function &func = iter.second;
+        const bool native = is_scheduled_on_gpu(func) ?
+                                gpu_has_native_float16(t) :
+                                host_has_native_float16(t);
+        Float16Compute mutator(native, tolerance);
+        func.mutate(&mutator);
+    }
+}
+
+}  // namespace Internal
+}  // namespace Halide
@@ -0,0 +1,34 @@
+#ifndef HALIDE_FLOAT16_COMPUTE_H
+#define HALIDE_FLOAT16_COMPUTE_H
+
+/** \file
+ * Defines a lowering pass that computes float32 arithmetic on float16
+ * values in native float16 where the target supports it.
+ */
+
+#include <map>
+#include <string>
+
+namespace Halide {
+
+struct Target;
+
+namespace Internal {
+
+class Function;
+
+/** Rewrite float32 arithmetic whose inputs are all float16 values, narrow
+ * integers, or constants to use float16 arithmetic instead, when the
+ * target can do float16 math natively for the place the Func is computed
+ * (ARM with arm_fp16 on the host, or a GPU API with half-precision
+ * support). Rewrites stop at the largest subexpression whose estimated
+ * relative error stays within tolerance, so reductions still accumulate in
+ * float32. The tolerance comes from float16_compute() wrappers in the
+ * definitions, or from a default if Target::Float16Compute is set. Removes
+ * all float16_compute wrappers, whether or not anything was rewritten. */
+void lower_float16_compute(std::map<std::string, Function> &env, const Target &t);
+
+}  // namespace Internal
+}  // namespace Halide
+
+#endif
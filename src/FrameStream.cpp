@@ -0,0 +1,338 @@
+#include "FrameStream.h"
+
+#include <cstdlib>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <set>
+#include <unordered_map>
+
+#include "FindCalls.h"
+#include "Func.h"
+#include "Function.h"
+#include "IRVisitor.h"
+#include "JITModule.h"
+
+namespace Halide {
+
+using std::map;
+using std::set;
+using std::string;
+using std::vector;
+
+namespace {
+
+// The allocations the pipeline frees are kept here, by size, for the
+// next allocation of the same size.
+//
+// Blocks use the layout of halide_default_malloc, with the pointer
+// malloc returned just before the aligned one, because the memoization
+// cache may hold on to one and free it later without the stream's
+// context. For the same reason, a block the stream didn't allocate may
+// be freed through it. Blocks are aligned one alignment further into
+// their allocation than halide_default_malloc would align them, so a
+// block it allocates at the same address as a block of ours that it
+// freed never has the same pointer before it, and can be told apart.
+class AllocationCache {
+    static constexpr size_t alignment = 128;
+
+    struct Block {
+        void *base;
+        size_t size;
+    };
+
+    mutable std::mutex mutex;
+    std::multimap<size_t, void *> free_blocks;
+    std::unordered_map<void *, Block> blocks;
+    size_t free_bytes = 0;
+
+    static void *&base_of(void *p) {
+        return ((void **)p)[-1];
+    }
+
+public:
+    void *allocate(size_t size) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            auto it = free_blocks.find(size);
+            if (it != free_blocks.end()) {
+                void *p = it->second;
+                free_blocks.erase(it);
+                free_bytes -= size;
+                return p;
+            }
+        }
+        // Room to align, to skip one more alignment, and to read a
+        // little out of bounds at the end (see JITHandlers::custom_malloc).
+        void *base = std::malloc(size + alignment * 2 + sizeof(void *) * 2);
+        if (!base) {
+            return nullptr;
+        }
+        void *p = (void *)((((uintptr_t)base + sizeof(void *) + alignment * 2 - 1) & ~(uintptr_t)(alignment - 1)));
+        base_of(p) = base;
+        std::lock_guard<std::mutex> lock(mutex);
+        blocks[p] = {base, size};
+        return p;
+    }
+
+    void release(void *p) {
+        std::unique_lock<std::mutex> lock(mutex);
+        auto it = blocks.find(p);
+        if (it != blocks.end() && base_of(p) == it->second.base) {
+            free_blocks.emplace(it->second.size, p);
+            free_bytes += it->second.size;
+            return;
+        }
+        if (it != blocks.end()) {
+            // Ours once, but freed elsewhere since.
+            blocks.erase(it);
+        }
+        lock.unlock();
+        // Allocated by halide_default_malloc.
+        std::free(base_of(p));
+    }
+
+    // Free the blocks not in use.
+    void trim() {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (const auto &it : free_blocks) {
+            auto b = blocks.find(it.second);
+            std::free(b->second.base);
+            blocks.erase(b);
+        }
+        free_blocks.clear();
+        free_bytes = 0;
+    }
+
+    size_t cached_bytes() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return free_bytes;
+    }
+
+    ~AllocationCache() {
+        trim();
+    }
+};
+
+// Find the Params and ImageParams a Function refers to, and the
+// Functions it calls.
+class FindDependencies : public Internal::IRGraphVisitor {
+    using Internal::IRGraphVisitor::visit;
+
+    void visit(const Internal::Variable *op) override {
+        if (op->param.defined()) {
+            params.insert(op->param.name());
+        }
+    }
+
+    void visit(const Internal::Call *op) override {
+        Internal::IRGraphVisitor::visit(op);
+        if (op->param.defined()) {
+            params.insert(op->param.name());
+        }
+        if (op->call_type == Internal::Call::Halide) {
+            funcs.insert(op->name);
+        }
+    }
+
+public:
+    set<string> params, funcs;
+};
+
+}  // namespace
+
+struct FrameStreamContents {
+    // The context passed to the pipeline, through which the cache is
+    // found in the malloc and free handlers.
+    struct Context : JITUserContext {
+        FrameStreamContents *stream = nullptr;
+    } context;
+
+    Pipeline pipeline;
+    Target target;
+    vector<FrameStream::History> histories;
+    // The past frames of each history, most recent first.
+    vector<vector<Buffer<>>> past_frames;
+    AllocationCache allocations;
+    int frames = 0;
+
+    static void *stream_malloc(JITUserContext *ctx, size_t size) {
+        return static_cast<Context *>(ctx)->stream->allocations.allocate(size);
+    }
+
+    static void stream_free(JITUserContext *ctx, void *p) {
+        static_cast<Context *>(ctx)->stream->allocations.release(p);
+    }
+};
+
+namespace {
+
+// Memoize the compute_root Funcs that depend on none of the per-frame
+// inputs.
+void memoize_static_funcs(const Pipeline &pipeline, const set<string> &per_frame) {
+    vector<Internal::Function> outputs;
+    for (const Func &f : pipeline.outputs()) {
+        outputs.push_back(f.function());
+    }
+    map<string, Internal::Function> env = Internal::build_environment(outputs);
+
+    map<string, bool> varies;
+    std::function<bool(const string &)> depends_on_frame = [&](const string &name) -> bool {
+        auto it = varies.find(name);
+        if (it != varies.end()) {
+            return it->second;
+        }
+        // Guard against cycles while this one is being worked out.
+        varies[name] = true;
+        const Internal::Function &f = env.at(name);
+        bool result = f.has_extern_definition();
+        if (!result) {
+            FindDependencies deps;
+            f.accept(&deps);
+            for (const string &p : deps.params) {
+                result = result || per_frame.count(p);
+            }
+            for (const string &g : deps.funcs) {
+                result = result || (g != name && env.count(g) && depends_on_frame(g));
+            }
+        }
+        varies[name] = result;
+        return result;
+    };
+
+    set<string> output_names;
+    for (const auto &f : outputs) {
+        output_names.insert(f.name());
+    }
+    for (auto &it : env) {
+        Internal::Function &f = it.second;
+        if (output_names.count(f.name()) ||
+            !f.schedule().compute_level().is_root() ||
+            f.schedule().memoized() ||
+            depends_on_frame(f.name())) {
+            continue;
+        }
+        Internal::debug(1) << "FrameStream: memoizing " << f.name() << "\n";
+        Func(f).memoize(EvictionKey(), true);
+    }
+}
+
+}  // namespace
+
+FrameStream::FrameStream(const Pipeline &pipeline,
+                         const vector<Argument> &per_frame,
+                         const vector<History> &histories,
+                         bool memoize_static,
+                         const Target &target)
+    : contents(new FrameStreamContents) {
+    contents->pipeline = pipeline;
+    contents->target = target;
+    contents->histories = histories;
+    contents->past_frames.resize(histories.size());
+    contents->context.stream = contents.get();
+    contents->context.handlers.custom_malloc = FrameStreamContents::stream_malloc;
+    contents->context.handlers.custom_free = FrameStreamContents::stream_free;
+
+    set<string> per_frame_names;
+    for (const Argument &a : per_frame) {
+        per_frame_names.insert(a.name);
+    }
+    for (const History &h : histories) {
+        user_assert(h.frame.defined()) << "FrameStream: History with an undefined frame\n";
+        per_frame_names.insert(h.frame.name());
+        for (const ImageParam &p : h.past) {
+            user_assert(p.type() == h.frame.type() && p.dimensions() == h.frame.dimensions())
+                << "FrameStream: past frame " << p.name() << " doesn't have the type and dimensionality of "
+                << h.frame.name() << "\n";
+            per_frame_names.insert(p.name());
+        }
+    }
+
+    if (memoize_static) {
+        memoize_static_funcs(pipeline, per_frame_names);
+    }
+    contents->pipeline.compile_jit(target);
+}
+
+FrameStream::FrameStream(FrameStream &&) noexcept = default;
+FrameStream &FrameStream::operator=(FrameStream &&) noexcept = default;
+FrameStream::~FrameStream() = default;
+
+void FrameStream::before_frame() {
+    for (size_t i = 0; i < contents->histories.size(); i++) {
+        const History &h = contents->histories[i];
+        const vector<Buffer<>> &past = contents->past_frames[i];
+        user_assert(h.frame.get().defined())
+            << "FrameStream: no frame bound to " << h.frame.name() << "\n";
+        for (size_t j = 0; j < h.past.size(); j++) {
+            ImageParam p = h.past[j];
+            if (past.empty()) {
+                p.set(h.frame.get());
+            } else {
+                p.set(past[std::min(j, past.size() - 1)]);
+            }
+        }
+    }
+}
+
+void FrameStream::after_frame() {
+    contents->frames++;
+    for (size_t i = 0; i < contents->histories.size(); i++) {
+        const History &h = contents->histories[i];
+        vector<Buffer<>> &past = contents->past_frames[i];
+        if (h.past.empty()) {
+            continue;
+        }
+        Buffer<> frame = h.frame.get();
+        frame.copy_to_host();
+
+        // Recycle the oldest past frame if it has the right shape.
+        Buffer<> slot;
+        if (past.size() == h.past.size()) {
+            slot = past.back();
+            past.pop_back();
+        }
+        bool same_shape = slot.defined() && slot.dimensions() == frame.dimensions();
+        for (int d = 0; same_shape && d < frame.dimensions(); d++) {
+            same_shape = slot.dim(d).min() == frame.dim(d).min() &&
+                         slot.dim(d).extent() == frame.dim(d).extent();
+        }
+        if (same_shape) {
+            slot.copy_from(frame);
+        } else {
+            slot = frame.copy();
+        }
+        past.insert(past.begin(), slot);
+    }
+}
+
+void FrameStream::realize(Pipeline::RealizationArg outputs) {
+    before_frame();
+    contents->pipeline.realize(&contents->context, std::move(outputs), contents->target);
+    after_frame();
+}
+
+Realization FrameStream::realize(const vector<int32_t> &sizes) {
+    before_frame();
+    Realization r = contents->pipeline.realize(&contents->context, sizes, contents->target);
+    after_frame();
+    return r;
+}
+
+int FrameStream::frames() const {
+    return contents->frames;
+}
+
+void FrameStream::reset() {
+    for (auto &past : contents->past_frames) {
+        past.clear();
+    }
+    contents->frames = 0;
+    contents->allocations.trim();
+}
+
+size_t FrameStream::cached_bytes() const {
+    return contents->allocations.cached_bytes();
+}
+
+}  // namespace Halide
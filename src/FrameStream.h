@@ -0,0 +1,95 @@
+#ifndef HALIDE_FRAME_STREAM_H
+#define HALIDE_FRAME_STREAM_H
+
+/** \file
+ * Defines FrameStream, which runs a JIT-compiled pipeline once per frame
+ * of a video and carries state from one frame to the next.
+ */
+
+#include <memory>
+#include <vector>
+
+#include "Argument.h"
+#include "ImageParam.h"
+#include "Pipeline.h"
+#include "Target.h"
+
+namespace Halide {
+
+struct FrameStreamContents;
+
+/** Runs a Pipeline on a sequence of frames, keeping what can be kept
+ * from one frame to the next:
+ *
+ * - Memory the pipeline allocates is returned to a cache owned by the
+ *   stream instead of being freed, and handed out again to allocations
+ *   of the same size, so the intermediates of later frames reuse the
+ *   memory of earlier ones.
+ *
+ * - If memoize_static is true, every compute_root Func that doesn't
+ *   depend on any of the per-frame inputs, directly or through other
+ *   Funcs, and isn't already memoized or an output, is memoized, keyed
+ *   on its scalar Params and on the contents of the buffers it reads
+ *   (see Func::memoize). Things like lookup tables and pyramids of a
+ *   reference frame are then only recomputed when what they depend on
+ *   changes. This schedules the Funcs of the pipeline.
+ *
+ * - Each History makes the past frames of an input available as inputs
+ *   too. Past frames are copied into buffers owned by the stream after
+ *   each frame runs, so the caller can reuse the buffer it passed in.
+ *   Until enough frames have been seen, the missing past frames are the
+ *   oldest frame there is.
+ *
+ * Bind the inputs for a frame with ImageParam::set and Param::set, as
+ * for Pipeline::realize, then call realize(). Extern stages, and Funcs
+ * that depend on them, are treated as changing every frame.
+ */
+class FrameStream {
+    std::unique_ptr<FrameStreamContents> contents;
+
+    void before_frame();
+    void after_frame();
+
+public:
+    /** An input, and the inputs that get its values from past frames:
+     * past[0] the previous frame, past[1] the one before that, and so
+     * on. */
+    struct History {
+        ImageParam frame;
+        std::vector<ImageParam> past;
+    };
+
+    /** Compile the pipeline for the given target. per_frame lists the
+     * Params and ImageParams that change every frame; the inputs of
+     * the histories, and their past frames, always do. */
+    FrameStream(const Pipeline &pipeline,
+                const std::vector<Argument> &per_frame,
+                const std::vector<History> &histories = {},
+                bool memoize_static = true,
+                const Target &target = get_jit_target_from_environment());
+
+    FrameStream(FrameStream &&) noexcept;
+    FrameStream &operator=(FrameStream &&) noexcept;
+    ~FrameStream();
+
+    /** Run the pipeline on the next frame, into existing buffers. */
+    void realize(Pipeline::RealizationArg outputs);
+
+    /** Run the pipeline on the next frame, into new buffers of the
+     * given size. */
+    Realization realize(const std::vector<int32_t> &sizes);
+
+    /** The number of frames run so far. */
+    int frames() const;
+
+    /** Forget the past frames, and free the memory cached for
+     * intermediates. Memoized Funcs stay in the memoization cache. */
+    void reset();
+
+    /** The number of bytes of memory currently cached for reuse. */
+    size_t cached_bytes() const;
+};
+
+}  // namespace Halide
+
+#endif
@@ -31,6 +31,7 @@
 #include "Simplify.h"
 #include "Solve.h"
 #include "Substitute.h"
+#include "UnrollLoops.h"
 #include "Util.h"
 
 namespace Halide {
@@ -1030,6 +1031,203 @@ Func Stage::rfactor(const vector<pair<RVar, Var>> &preserved) {
     return intm;
 }
 
+namespace {
+
+// The values of each Tuple element of an output of a Func at some site.
+vector<Expr> tuple_elements(const Func &f, const vector<Expr> &args) {
+    FuncRef ref = f(args);
+    vector<Expr> result;
+    if (f.outputs() == 1) {
+        result.emplace_back(ref);
+    } else {
+        for (int i = 0; i < f.outputs(); i++) {
+            result.emplace_back(ref[i]);
+        }
+    }
+    return result;
+}
+
+// Replace the calls in the update of a scan over dimension 'dim' to the
+// previous site of the scan with calls to the site being updated, so that
+// the associativity prover recognizes them as the self-reference. Any
+// other self-reference means the update isn't a scan.
+class ReplacePreviousSite : public IRMutator {
+    using IRMutator::visit;
+
+    const string &func;
+    const vector<Expr> &args;
+    const vector<Expr> &prev_args;
+
+    Expr visit(const Call *c) override {
+        Expr expr = IRMutator::visit(c);
+        c = expr.as<Call>();
+        if (c && c->call_type == Call::Halide && c->name == func) {
+            bool is_prev = c->args.size() == prev_args.size();
+            for (size_t i = 0; is_prev && i < prev_args.size(); i++) {
+                is_prev = can_prove(c->args[i] == prev_args[i]);
+            }
+            if (is_prev) {
+                expr = Call::make(c->type, c->name, args, c->call_type,
+                                  c->func, c->value_index, c->image, c->param);
+            } else {
+                other_self_reference = true;
+            }
+        }
+        return expr;
+    }
+
+public:
+    bool other_self_reference = false;
+
+    ReplacePreviousSite(const string &func, const vector<Expr> &args, const vector<Expr> &prev_args)
+        : func(func), args(args), prev_args(prev_args) {
+    }
+};
+
+}  // namespace
+
+Func Stage::parallel_scan(const RVar &r, int factor) {
+    user_assert(!definition.is_init()) << "parallel_scan() must be called on an update definition\n";
+    user_assert(factor >= 2) << "The block size of parallel_scan() of " << name()
+                             << " must be at least 2\n";
+
+    definition.schedule().touched() = true;
+
+    const vector<ReductionVariable> &rvars = definition.schedule().rvars();
+    user_assert(rvars.size() == 1 && var_name_match(rvars[0].var, r.name()))
+        << "In parallel_scan() of " << name() << ", the update must be a scan over "
+        << r.name() << " alone\n";
+    user_assert(is_const_one(definition.predicate()))
+        << "In parallel_scan() of " << name() << ", the scan must not have a predicate\n";
+    user_assert(definition.schedule().splits().empty())
+        << "In parallel_scan() of " << name() << ", the update must not have been split\n";
+
+    // The scan must update f(..., r, ...), with the pure vars in every
+    // other dimension.
+    const vector<Expr> &args = definition.args();
+    int dim = -1;
+    for (size_t i = 0; i < args.size(); i++) {
+        const Variable *v = args[i].as<Variable>();
+        if (v && v->name == rvars[0].var) {
+            user_assert(dim < 0)
+                << "In parallel_scan() of " << name() << ", " << r.name()
+                << " may only be used as one argument of the update\n";
+            dim = (int)i;
+        } else {
+            user_assert(v && v->name == dim_vars[i].name())
+                << "In parallel_scan() of " << name() << ", argument " << i
+                << " of the update must be " << dim_vars[i].name() << "\n";
+        }
+    }
+    user_assert(dim >= 0)
+        << "In parallel_scan() of " << name() << ", " << r.name()
+        << " must be an argument of the update\n";
+
+    const Expr rv = args[dim];
+    const Expr rmin = rvars[0].min;
+    const Expr rmax = rvars[0].min + rvars[0].extent - 1;
+
+    auto with_arg = [&](vector<Expr> a, const Expr &e) {
+        a[dim] = e;
+        return a;
+    };
+
+    // Check the update is op(f(..., r - 1, ...), y(r)), with op associative.
+    ReplacePreviousSite replacer(function.name(), args, with_arg(args, rv - 1));
+    vector<Expr> values;
+    for (const Expr &v : definition.values()) {
+        values.push_back(replacer.mutate(v));
+    }
+    user_assert(!replacer.other_self_reference)
+        << "In parallel_scan() of " << name() << ", the update may only refer to "
+        << "the previous site of the scan\n";
+    const auto &prover_result = prove_associativity(function.name(), args, values);
+    user_assert(prover_result.associative())
+        << "In parallel_scan() of " << name() << ", failed to prove the associativity "
+        << "of the operator of the scan\n";
+    for (size_t i = 0; i < prover_result.size(); i++) {
+        user_assert(!prover_result.xs[i].var.empty() && !prover_result.ys[i].var.empty())
+            << "In parallel_scan() of " << name() << ", value " << i << " of the update "
+            << "must combine the previous site of the scan with a new value\n";
+    }
+
+    auto apply_op = [&](const vector<Expr> &a, const vector<Expr> &b) {
+        SubstitutionMap subst;
+        for (size_t i = 0; i < prover_result.size(); i++) {
+            subst[prover_result.xs[i].var] = a[i];
+            subst[prover_result.ys[i].var] = b[i];
+        }
+        vector<Expr> result;
+        for (const Expr &op : prover_result.pattern.ops) {
+            result.push_back(substitute(subst, op));
+        }
+        return result;
+    };
+
+    const vector<Expr> dim_vars_exprs(dim_vars.begin(), dim_vars.end());
+    const Expr num_blocks = (rvars[0].extent + factor - 1) / factor;
+    Var b("b");
+
+    // Phase 1: scan each block of 'factor' sites independently. In the
+    // local func, dimension 'dim' is the offset within the block, and
+    // the block index is added as the outermost dimension.
+    Func local(function.name() + "_scan_local");
+    {
+        vector<Expr> local_args = dim_vars_exprs;
+        local_args.push_back(b);
+        const Expr site = rmin + b * factor + dim_vars[dim];
+        Tuple init(prover_result.pattern.identities);
+        for (size_t i = 0; i < prover_result.size(); i++) {
+            Expr y = substitute(rvars[0].var, min(site, rmax), prover_result.ys[i].expr);
+            init[i] = select(site <= rmax, y, prover_result.pattern.identities[i]);
+        }
+        local(local_args) = init;
+
+        RDom ri(1, factor - 1, function.name() + "_scan_ri");
+        vector<Expr> lhs = with_arg(dim_vars_exprs, ri);
+        lhs.push_back(b);
+        vector<Expr> prev = with_arg(dim_vars_exprs, ri - 1);
+        prev.push_back(b);
+        local(lhs) = Tuple(apply_op(tuple_elements(local, prev), tuple_elements(local, lhs)));
+
+        local.compute_root().parallel(b);
+        local.update().parallel(b);
+    }
+
+    // Phase 2: the exclusive scan of the totals of the blocks. In the
+    // carry func, dimension 'dim' is the block index.
+    Func carry(function.name() + "_scan_carry");
+    {
+        carry(dim_vars_exprs) = Tuple(prover_result.pattern.identities);
+
+        RDom rb(1, num_blocks - 1, function.name() + "_scan_rb");
+        vector<Expr> block_total = with_arg(dim_vars_exprs, factor - 1);
+        block_total.push_back(rb - 1);
+        carry(with_arg(dim_vars_exprs, rb)) =
+            Tuple(apply_op(tuple_elements(carry, with_arg(dim_vars_exprs, rb - 1)),
+                           tuple_elements(local, block_total)));
+
+        carry.compute_root();
+    }
+
+    // Phase 3: each site of the scan combines the value before the scan,
+    // the carry into its block, and its scan within the block. No site
+    // depends on another one written by this update, so it may be run
+    // in parallel.
+    {
+        const Expr offset = rv - rmin;
+        vector<Expr> block_args = with_arg(dim_vars_exprs, offset / factor);
+        vector<Expr> local_args = with_arg(dim_vars_exprs, offset % factor);
+        local_args.push_back(offset / factor);
+        vector<Expr> before = tuple_elements(Func(function), with_arg(args, rmin - 1));
+        definition.values() = apply_op(apply_op(before, tuple_elements(carry, block_args)),
+                                       tuple_elements(local, local_args));
+        definition.schedule().allow_race_conditions() = true;
+    }
+
+    return local;
+}
+
 void Stage::split(const string &old, const string &outer, const string &inner, const Expr &factor, bool exact, TailStrategy tail) {
     debug(4) << "In schedule for " << name() << ", split " << old << " into "
              << outer << " and " << inner << " with factor of " << factor << "\n";
@@ -1369,6 +1567,37 @@ Stage Stage::specialize(const Expr &condition) {
     return Stage(function, s.definition, stage_index);
 }
 
+Stage Stage::specialize_target_features(const std::vector<Target::Feature> &features) {
+    user_assert(!features.empty()) << "specialize_target_features() of " << name()
+                                   << " needs at least one feature.\n";
+
+    // Sort the features, so that retrieving an existing specialization
+    // doesn't depend on the order they are listed in.
+    vector<Target::Feature> sorted = features;
+    std::sort(sorted.begin(), sorted.end());
+    sorted.erase(std::unique(sorted.begin(), sorted.end()), sorted.end());
+    std::string names;
+    for (Target::Feature f : sorted) {
+        if (!names.empty()) {
+            names += "-";
+        }
+        names += Target::feature_to_name(f);
+    }
+    Expr condition = Call::make(Bool(), Call::can_use_target_features,
+                                {StringImm::make(names)}, Call::Intrinsic);
+    return specialize(condition);
+}
+
+Stage Stage::specialize_tuned(int variant, int num_variants) {
+    user_assert(num_variants > 1 && variant >= 0 && variant < num_variants - 1)
+        << "specialize_tuned(" << variant << ", " << num_variants << ") of " << name()
+        << " must be for one of the first " << num_variants - 1
+        << " variants; the last is the schedule of the Func itself.\n";
+    Expr condition = Call::make(Bool(), Call::use_tuned_variant,
+                                {StringImm::make(function.name()), variant, num_variants}, Call::Intrinsic);
+    return specialize(condition);
+}
+
 void Stage::specialize_fail(const std::string &message) {
     user_assert(!message.empty()) << "Argument passed to specialize_fail() must not be empty.\n";
     const vector<Specialization> &specializations = definition.specializations();
@@ -1648,6 +1877,58 @@ Stage &Stage::unroll(const VarOrRVar &var, const Expr &factor, TailStrategy tail
     return *this;
 }
 
+Stage &Stage::unroll_and_jam(const Var &var, const Var &jam, const Expr &factor, TailStrategy tail) {
+    split(var, var, jam, factor, tail);
+    unroll(jam);
+
+    // Move the unrolled loop inside all the others but the vectorized
+    // ones at the innermost level. The loops it crosses are either
+    // reductions or over other pure vars, so this is always legal.
+    vector<Dim> &dims = definition.schedule().dims();
+    size_t from = 0;
+    while (from < dims.size() && !dim_match(dims[from], jam)) {
+        from++;
+    }
+    internal_assert(from < dims.size());
+    size_t to = 0;
+    while (to < from && dims[to].for_type == ForType::Vectorized) {
+        to++;
+    }
+    Dim d = dims[from];
+    dims.erase(dims.begin() + from);
+    dims.insert(dims.begin() + to, d);
+    return *this;
+}
+
+Stage &Stage::unroll_and_jam(const Var &var, const Var &jam, const Target &target, TailStrategy tail) {
+    // Each jammed iteration keeps its values live across the loops it's
+    // jammed into, in as many vector registers as they need.
+    const vector<Dim> &dims = definition.schedule().dims();
+    const vector<Split> &splits = definition.schedule().splits();
+    int lanes = 1;
+    for (const Dim &d : dims) {
+        if (d.for_type != ForType::Vectorized) {
+            continue;
+        }
+        for (const Split &s : splits) {
+            if (s.split_type == Split::SplitVar && s.inner == d.var) {
+                if (auto f = as_const_int(s.factor)) {
+                    lanes *= (int)*f;
+                }
+            }
+        }
+    }
+    const int vector_bytes = target.natural_vector_size(UInt(8));
+    int registers = 0;
+    for (const Expr &v : definition.values()) {
+        registers += std::max(1, (v.type().bytes() * lanes + vector_bytes - 1) / vector_bytes);
+    }
+    const int factor = unroll_and_jam_factor(target, registers);
+    debug(2) << "Jamming " << factor << " iterations of " << var.name() << " in " << name()
+             << ", for " << registers << " vector registers per iteration\n";
+    return unroll_and_jam(var, jam, factor, tail);
+}
+
 Stage &Stage::partition(const VarOrRVar &var, Partition policy) {
     definition.schedule().touched() = true;
     bool found = false;
@@ -1885,6 +2166,30 @@ Stage &Stage::gpu_blocks(const VarOrRVar &bx, const VarOrRVar &by, const VarOrRV
     return *this;
 }
 
+Stage &Stage::gpu_persistent_blocks(const VarOrRVar &x, const VarOrRVar &block, const Expr &num_blocks,
+                                    DeviceAPI device_api) {
+    // x = x * num_blocks + block, with block outside x
+    split(x, x, block, num_blocks, TailStrategy::GuardWithIf);
+    reorder(x, block);
+    set_dim_device_api(block, device_api);
+    set_dim_type(block, ForType::GPUBlock);
+    return *this;
+}
+
+Stage &Stage::distribute(const VarOrRVar &x, int num_devices) {
+    user_assert(num_devices > 0)
+        << "In schedule for " << name() << ", can't distribute " << x.name()
+        << " across " << num_devices << " devices.\n";
+    // x = x * num_devices + device, with device outside x. Lowering
+    // recognizes the loop over device by its name, and selects the GPU
+    // device for each of its iterations (see OffloadGPULoops.cpp).
+    const string device_name = "__gpu_device_" + x.name();
+    VarOrRVar device(device_name, x.is_rvar);
+    split(x, x, device, num_devices, TailStrategy::GuardWithIf);
+    reorder(x, device);
+    return *this;
+}
+
 Stage &Stage::gpu_single_thread(DeviceAPI device_api) {
     Var block, thread;
     split(Var::outermost(), Var::outermost(), thread, 1);
@@ -2278,9 +2583,10 @@ Func &Func::atomic(bool override_associativity_test) {
     return *this;
 }
 
-Func &Func::memoize(const EvictionKey &eviction_key) {
+Func &Func::memoize(const EvictionKey &eviction_key, bool hash_buffer_contents) {
     invalidate_cache();
     func.schedule().memoized() = true;
+    func.schedule().memoize_hash_buffer_contents() = hash_buffer_contents;
     if (eviction_key.key.defined()) {
         Expr new_eviction_key;
         const Type &t(eviction_key.key.type());
@@ -2336,11 +2642,58 @@ Func &Func::ring_buffer(Expr extent) {
     return *this;
 }
 
+Func &Func::pipeline_across(LoopLevel loop_level, int depth) {
+    user_assert(depth >= 2)
+        << "Func " << name() << " is pipelined with a depth of " << depth
+        << ", but pipeline_across requires a depth of at least 2.\n";
+    return compute_at(std::move(loop_level)).hoist_storage_root().ring_buffer(depth).async();
+}
+
+Func &Func::pipeline_across(const Func &f, const Var &var, int depth) {
+    return pipeline_across(LoopLevel(f, var), depth);
+}
+
+Func &Func::stream_via_dma(LoopLevel tiles, LoopLevel rows, const Var &dim, const Expr &tile_extent, int depth) {
+    user_assert(depth >= 2)
+        << "Func " << name() << " is streamed via DMA with a depth of " << depth
+        << ", but stream_via_dma requires a depth of at least 2.\n";
+    copy_to_host();
+    return compute_at(std::move(tiles))
+        .store_at(std::move(rows))
+        .store_in(MemoryType::VTCM)
+        .fold_storage(dim, tile_extent * depth)
+        .async();
+}
+
 Stage Func::specialize(const Expr &c) {
     invalidate_cache();
     return Stage(func, func.definition(), 0).specialize(c);
 }
 
+Stage Func::specialize_target_features(const std::vector<Target::Feature> &features) {
+    invalidate_cache();
+    return Stage(func, func.definition(), 0).specialize_target_features(features);
+}
+
+Stage Func::specialize_tuned(int variant, int num_variants) {
+    invalidate_cache();
+    return Stage(func, func.definition(), 0).specialize_tuned(variant, num_variants);
+}
+
+Func &Func::gpu_tile_variants(const VarOrRVar &x, const VarOrRVar &y,
+                              const VarOrRVar &bx, const VarOrRVar &by,
+                              const VarOrRVar &tx, const VarOrRVar &ty,
+                              const std::vector<std::pair<int, int>> &sizes,
+                              TailStrategy tail,
+                              DeviceAPI device_api) {
+    user_assert(!sizes.empty()) << "gpu_tile_variants of " << name() << " needs at least one tile size.\n";
+    const int n = (int)sizes.size();
+    for (int i = 0; i < n - 1; i++) {
+        specialize_tuned(i, n).gpu_tile(x, y, bx, by, tx, ty, sizes[i].first, sizes[i].second, tail, device_api);
+    }
+    return gpu_tile(x, y, bx, by, tx, ty, sizes.back().first, sizes.back().second, tail, device_api);
+}
+
 void Func::specialize_fail(const std::string &message) {
     invalidate_cache();
     Stage(func, func.definition(), 0).specialize_fail(message);
@@ -2388,6 +2741,18 @@ Func &Func::unroll(const VarOrRVar &var, const Expr &factor, TailStrategy tail)
     return *this;
 }
 
+Func &Func::unroll_and_jam(const Var &var, const Var &jam, const Expr &factor, TailStrategy tail) {
+    invalidate_cache();
+    Stage(func, func.definition(), 0).unroll_and_jam(var, jam, factor, tail);
+    return *this;
+}
+
+Func &Func::unroll_and_jam(const Var &var, const Var &jam, const Target &target, TailStrategy tail) {
+    invalidate_cache();
+    Stage(func, func.definition(), 0).unroll_and_jam(var, jam, target, tail);
+    return *this;
+}
+
 Func &Func::partition(const VarOrRVar &var, Partition policy) {
     invalidate_cache();
     Stage(func, func.definition(), 0).partition(var, policy);
@@ -2639,6 +3004,19 @@ Func &Func::gpu_blocks(const VarOrRVar &bx, const VarOrRVar &by, const VarOrRVar
     return *this;
 }
 
+Func &Func::gpu_persistent_blocks(const VarOrRVar &x, const VarOrRVar &block, const Expr &num_blocks,
+                                  DeviceAPI device_api) {
+    invalidate_cache();
+    Stage(func, func.definition(), 0).gpu_persistent_blocks(x, block, num_blocks, device_api);
+    return *this;
+}
+
+Func &Func::distribute(const VarOrRVar &x, int num_devices) {
+    invalidate_cache();
+    Stage(func, func.definition(), 0).distribute(x, num_devices);
+    return *this;
+}
+
 Func &Func::gpu_single_thread(DeviceAPI device_api) {
     invalidate_cache();
     Stage(func, func.definition(), 0).gpu_single_thread(device_api);
@@ -2857,6 +3235,50 @@ Func &Func::compute_at(const Func &f, const Var &var) {
     return compute_at(LoopLevel(f, var));
 }
 
+Func &Func::compute_at_gpu_blocks(const Func &f) {
+    // Find f's innermost loop over GPU blocks, and the loop just
+    // outside of its loops over GPU threads, which may be a serial loop
+    // within the blocks (e.g. the one made by gpu_persistent_blocks).
+    const vector<Dim> &dims = f.function().definition().schedule().dims();
+    int innermost_block = -1, outermost_thread = -1;
+    for (int i = 0; i < (int)dims.size(); i++) {
+        if (dims[i].for_type == ForType::GPUBlock && innermost_block < 0) {
+            innermost_block = i;
+        } else if (dims[i].for_type == ForType::GPUThread ||
+                   dims[i].for_type == ForType::GPULane) {
+            outermost_thread = i;
+        }
+    }
+    user_assert(innermost_block >= 0)
+        << "In schedule for " << name() << ", can't compute_at_gpu_blocks of "
+        << f.name() << ", which has no loops over GPU blocks.\n";
+    const int level = outermost_thread >= 0 && outermost_thread < innermost_block ? outermost_thread + 1 : innermost_block;
+    const DeviceAPI device_api = dims[innermost_block].device_api;
+    compute_at(LoopLevel(f, Var(dims[level].var)));
+    store_in(MemoryType::GPUShared);
+
+    for (int i = 0; i <= (int)num_update_definitions(); i++) {
+        Stage s = (i == 0) ? Stage(func, func.definition(), 0) : update(i - 1);
+        vector<VarOrRVar> threads;
+        for (const Dim &d : s.get_schedule().dims()) {
+            if (threads.size() < 3 &&
+                d.is_pure() &&
+                d.for_type == ForType::Serial &&
+                d.var != Var::outermost().name()) {
+                threads.emplace_back(Var(d.var));
+            }
+        }
+        if (threads.size() == 1) {
+            s.gpu_threads(threads[0], device_api);
+        } else if (threads.size() == 2) {
+            s.gpu_threads(threads[0], threads[1], device_api);
+        } else if (threads.size() == 3) {
+            s.gpu_threads(threads[0], threads[1], threads[2], device_api);
+        }
+    }
+    return *this;
+}
+
 Func &Func::compute_with(const Stage &s, const VarOrRVar &var, const vector<pair<VarOrRVar, LoopAlignStrategy>> &align) {
     invalidate_cache();
     Stage(func, func.definition(), 0).compute_with(s, var, align);
@@ -2881,6 +3303,42 @@ Func &Func::compute_with(LoopLevel loop_level, LoopAlignStrategy align) {
     return *this;
 }
 
+Func &Func::fuse_reductions(const vector<Func> &siblings) {
+    invalidate_cache();
+    user_assert(has_update_definition())
+        << "Can't fuse reductions with Func " << name() << ", which has no update definitions.\n";
+    Stage parent = update(num_update_definitions() - 1);
+    const vector<ReductionVariable> &rvars = parent.get_schedule().rvars();
+    user_assert(!rvars.empty())
+        << "Can't fuse reductions with Func " << name() << ", whose last update is not a reduction.\n";
+
+    // Fuse all the way in, at the innermost loop of the parent. Dims
+    // made by splits are qualified by the dims they were split from.
+    const Dim &innermost = parent.get_schedule().dims()[0];
+    string var_name = innermost.var.substr(innermost.var.rfind('.') + 1);
+    VarOrRVar var = innermost.is_rvar() ? VarOrRVar(RVar(var_name)) : VarOrRVar(Var(var_name));
+
+    for (const Func &f : siblings) {
+        user_assert(f.name() != name())
+            << "Can't fuse the reduction of Func " << name() << " with itself.\n";
+        user_assert(f.has_update_definition())
+            << "Can't fuse the reduction of Func " << f.name() << ", which has no update definitions, with "
+            << name() << ".\n";
+        Stage s = Func(f).update(f.num_update_definitions() - 1);
+        const vector<ReductionVariable> &s_rvars = s.get_schedule().rvars();
+        bool same_domain = s_rvars.size() == rvars.size();
+        for (size_t i = 0; same_domain && i < rvars.size(); i++) {
+            same_domain = can_prove(rvars[i].min == s_rvars[i].min &&
+                                    rvars[i].extent == s_rvars[i].extent);
+        }
+        user_assert(same_domain)
+            << "Can't fuse the reduction of Func " << f.name() << " with that of " << name()
+            << ", as their reduction domains have different bounds.\n";
+        s.compute_with(parent, var);
+    }
+    return *this;
+}
+
 Func &Func::compute_root() {
     return compute_at(LoopLevel::root());
 }
@@ -2949,6 +3407,14 @@ Func &Func::add_trace_tag(const std::string &trace_tag) {
     return *this;
 }
 
+Func &Func::sample_tracing(const VarOrRVar &var, TraceSampling sampling, int n) {
+    user_assert(n > 0) << "Func " << name() << " can't sample tracing with parameter " << n
+                       << ": it must be positive.\n";
+    invalidate_cache();
+    func.sample_tracing(var.name(), sampling, n);
+    return *this;
+}
+
 Func &Func::no_profiling() {
     func.do_not_profile();
     return *this;
@@ -191,6 +191,60 @@ public:
     Func rfactor(const RVar &r, const Var &v);
     // @}
 
+    /** Calling parallel_scan() on an update definition of a Func that is
+     * a scan along an RVar 'r', i.e. one of the form
+     * f(..., r, ...) = op(f(..., r - 1, ...), y(r)) with an associative
+     * 'op', rewrites the scan so that it can be computed in parallel, by
+     * splitting the domain of 'r' into blocks of 'factor' sites and
+     * computing it in three phases:
+     *
+     * 1. each block is scanned independently, in a new Func that is
+     * returned. Its dimension in place of 'r' is the offset within the
+     * block, and it has an extra outermost dimension for the block
+     * index. It is computed at root and is parallel over the blocks;
+     * this may be changed by scheduling it as any other Func.
+     *
+     * 2. the totals of the blocks are scanned serially, in another Func
+     * computed at root, to find the carry into each block.
+     *
+     * 3. this update is replaced by one that combines the value before
+     * the scan, the carry into the block, and the scan within the block.
+     * No site depends on another, so this update may then be scheduled
+     * in parallel over 'r', e.g. with parallel(r, factor).
+     *
+     * The operator is inferred from the update definition as it is for
+     * rfactor(), but it needn't be commutative. The update must not use
+     * any RVar other than 'r', must not have a predicate, and must not
+     * have been split. If any of these doesn't hold, this throws an
+     * error. For example, a cumulative sum:
+     \code
+     f(x) = 0;
+     RDom r(1, 1023);
+     f(r) = f(r - 1) + g(r);
+     f.update().parallel_scan(r, 64);
+     f.update().parallel(r, 64);
+     \endcode
+     *
+     *, is equivalent to:
+     \code
+     parallel for b in [0, 15]:
+       for x in [0, 63]:
+         f_scan_local(x, b) = select(1 + 64*b + x <= 1023, g(min(1 + 64*b + x, 1023)), 0)
+       for ri in [1, 63]:
+         f_scan_local(ri, b) = f_scan_local(ri - 1, b) + f_scan_local(ri, b)
+     for x in [0, 15]:
+       f_scan_carry(x) = 0
+     for rb in [1, 15]:
+       f_scan_carry(rb) = f_scan_carry(rb - 1) + f_scan_local(63, rb - 1)
+     for x:
+       f(x) = 0
+     parallel for r.o in [0, 15]:
+       for r.i in [0, 63]:
+         f(r) = f(0) + f_scan_carry((r - 1) / 64) + f_scan_local((r - 1) % 64, (r - 1) / 64)
+     \endcode
+     */
+    Func parallel_scan(const RVar &r, int factor);
+
     /** Schedule the iteration over this stage to be fused with another
      * stage 's' from outermost loop to a given LoopLevel. 'this' stage will
      * be computed AFTER 's' in the innermost fused dimension. There should not
@@ -198,9 +252,15 @@ public:
      * stages being fused is a stage of an extern Func, this will throw an error.
      *
      * Note that the two stages that are fused together should have the same
-     * exact schedule from the outermost to the innermost fused dimension, and
-     * the stage we are calling compute_with on should not have specializations,
-     * e.g. f2.compute_with(f1, x) is allowed only if f2 has no specializations.
+     * number of loops from the outermost to the innermost fused dimension,
+     * with the same loop types, and the stage we are calling compute_with on
+     * should not have specializations, e.g. f2.compute_with(f1, x) is
+     * allowed only if f2 has no specializations. The fused loops are
+     * matched up by their depth, so they don't need to have the same
+     * names: for example, an update over an RDom r can be computed with a
+     * pure stage at y, which fuses its loop over r.y with the loop over y.
+     * The fused loops run over the union of the bounds of the stages, and
+     * each stage is guarded to only run over its own bounds.
      *
      * Also, if a producer is desired to be computed at the fused loop level,
      * the function passed to the compute_at() needs to be the "parent". Consider
@@ -351,6 +411,8 @@ public:
     Stage &parallel(const VarOrRVar &var, const Expr &task_size, TailStrategy tail = TailStrategy::Auto);
     Stage &vectorize(const VarOrRVar &var, const Expr &factor, TailStrategy tail = TailStrategy::Auto);
     Stage &unroll(const VarOrRVar &var, const Expr &factor, TailStrategy tail = TailStrategy::Auto);
+    Stage &unroll_and_jam(const Var &var, const Var &jam, const Expr &factor, TailStrategy tail = TailStrategy::Auto);
+    Stage &unroll_and_jam(const Var &var, const Var &jam, const Target &target, TailStrategy tail = TailStrategy::Auto);
     Stage &partition(const VarOrRVar &var, Partition partition_policy);
     Stage &never_partition_all();
     Stage &never_partition(const std::vector<VarOrRVar> &vars);
@@ -404,6 +466,8 @@ public:
 
     Stage &rename(const VarOrRVar &old_name, const VarOrRVar &new_name);
     Stage specialize(const Expr &condition);
+    Stage specialize_target_features(const std::vector<Target::Feature> &features);
+    Stage specialize_tuned(int variant, int num_variants);
     void specialize_fail(const std::string &message);
 
     Stage &gpu_threads(const VarOrRVar &thread_x, DeviceAPI device_api = DeviceAPI::Default_GPU);
@@ -418,6 +482,11 @@ public:
     Stage &gpu_blocks(const VarOrRVar &block_x, const VarOrRVar &block_y, DeviceAPI device_api = DeviceAPI::Default_GPU);
     Stage &gpu_blocks(const VarOrRVar &block_x, const VarOrRVar &block_y, const VarOrRVar &block_z, DeviceAPI device_api = DeviceAPI::Default_GPU);
 
+    Stage &gpu_persistent_blocks(const VarOrRVar &x, const VarOrRVar &block, const Expr &num_blocks,
+                                 DeviceAPI device_api = DeviceAPI::Default_GPU);
+
+    Stage &distribute(const VarOrRVar &x, int num_devices);
+
     Stage &gpu(const VarOrRVar &block_x, const VarOrRVar &thread_x, DeviceAPI device_api = DeviceAPI::Default_GPU);
     Stage &gpu(const VarOrRVar &block_x, const VarOrRVar &block_y,
                const VarOrRVar &thread_x, const VarOrRVar &thread_y,
@@ -1467,6 +1536,37 @@ public:
      * dimension of the split. 'factor' must be an integer. */
     Func &unroll(const VarOrRVar &var, const Expr &factor, TailStrategy tail = TailStrategy::Auto);
 
+    /** Split a dimension by the given factor, unroll the inner
+     * dimension, and move it inside all the other loops of the
+     * definition except the vectorized ones, so the unrolled copies of
+     * the body are jammed together inside the loops they would
+     * otherwise each run. On an update definition this is register
+     * blocking: each copy keeps its own accumulators in registers
+     * across the reduction loops, and reuses the values loaded for the
+     * others. Vectorize before calling this. E.g. for a matrix
+     * multiply:
+     \code
+     Func c;
+     RDom k(0, size);
+     c(x, y) = 0.0f;
+     c(x, y) += a(k, y) * b(x, k);
+     c.update()
+         .split(x, x, xi, 8)
+         .reorder(xi, k, x, y)
+         .vectorize(xi)
+         .unroll_and_jam(y, yi, 4);
+     \endcode
+     * jams four rows of c into the loop over k, for a block of 4x8
+     * accumulators. var must be a pure Var, so moving its loop inward
+     * is always legal. After this call, var refers to the outer
+     * dimension of the split. The second form picks the factor from
+     * the number of vector registers of the target, and the registers
+     * the definition's vectorized values need per iteration. */
+    // @{
+    Func &unroll_and_jam(const Var &var, const Var &jam, const Expr &factor, TailStrategy tail = TailStrategy::Auto);
+    Func &unroll_and_jam(const Var &var, const Var &jam, const Target &target, TailStrategy tail = TailStrategy::Auto);
+    // @}
+
     /** Set the loop partition policy. Loop partitioning can be useful to
      * optimize boundary conditions (such as clamp_edge). Loop partitioning
      * splits a for loop into three for loops: a prologue, a steady-state,
@@ -1665,7 +1765,23 @@ public:
      * deadlock.
      * Vectorization of predicated RVars (through rdom.where()) on CPU
      * is also unsupported yet (see https://github.com/halide/Halide/issues/4298).
-     * 8-bit and 16-bit atomics on GPU are also not supported. */
+     * 8-bit and 16-bit atomics on GPU are also not supported.
+     *
+     * On GPUs, atomics to global memory are slow when many threads
+     * update the same locations. If the locations a block updates fit
+     * in shared memory, give each block a private copy to update
+     * with shared-memory atomics, and merge those into the result
+     * with one global atomic per location:
+     *
+     * hist(x) = 0;
+     * hist(im(r)) += 1;
+     * hist.compute_root();
+     * hist.update().split(r, ro, ri, 256, TailStrategy::GuardWithIf);
+     * Func partial = hist.update().rfactor(ro, u);
+     * hist.update().atomic().gpu_blocks(ro).gpu_threads(x);
+     * partial.compute_at(hist, ro).store_in(MemoryType::GPUShared).gpu_threads(x);
+     * partial.update().atomic().gpu_threads(ri);
+     */
     Func &atomic(bool override_associativity_test = false);
 
     /** Specialize a Func. This creates a special-case version of the
@@ -1831,9 +1947,72 @@ public:
      \endcode
      * When cond is true, this is equivalent to g.compute_at(f,y).
      * When it is false, this is equivalent to g.compute_at(f,x).
+     *
+     * By default the conditions are tested one after another. With
+     * Target::SpecializationDispatch, a stage with several
+     * specializations instead evaluates all of their conditions once,
+     * and branches on the index of the first that holds, which can be
+     * compiled to a jump table. Either way, a specialization that can't
+     * be reached because the conditions of earlier ones are false is
+     * removed.
      */
     Stage specialize(const Expr &condition);
 
+    /** Add a specialization to a Func that is compiled with the given
+     * target features added to the pipeline's target, and used when
+     * the CPU running the pipeline supports them. For instance, to
+     * use AVX2 and FMA where available, with wider vectors, in a
+     * pipeline otherwise compiled for SSE4.1:
+     \code
+     f.vectorize(x, 4);
+     f.specialize_target_features({Target::AVX2, Target::FMA}).vectorize(x, 8);
+     \endcode
+     * The specialized loop nest is compiled into its own function,
+     * and the choice between versions is made once per pipeline
+     * invocation using halide_can_use_target_features(). This is a
+     * much smaller alternative to compiling the whole pipeline for
+     * several targets with compile_to_multitarget_static_library when
+     * only a few loop nests benefit from the newer instructions. If
+     * the pipeline's target already has the features, the
+     * specialization is always used. Specializations are tried in the
+     * order they are added, so add the most demanding one first.
+     */
+    Stage specialize_target_features(const std::vector<Target::Feature> &features);
+
+    /** Add a specialization to a Func that is one of num_variants ways
+     * of scheduling it, numbered from zero, of which the runtime picks
+     * the fastest. The Func's own schedule is the last variant, so
+     * add the specializations for variants 0 to num_variants - 2 as
+     * the last scheduling calls, after anything shared by all of them.
+     * For instance, to try three GPU tile sizes:
+     \code
+     f.specialize_tuned(0, 3).gpu_tile(x, y, xo, yo, xi, yi, 8, 8);
+     f.specialize_tuned(1, 3).gpu_tile(x, y, xo, yo, xi, yi, 16, 16);
+     f.gpu_tile(x, y, xo, yo, xi, yi, 32, 8);
+     \endcode
+     * The variant is chosen once per pipeline invocation, by
+     * halide_choose_size_variant(). The first invocations try each
+     * variant a few times, timing the producer of the Func (waiting
+     * for its kernels to finish on GPUs), and then the runtime sticks
+     * with the fastest, under the name of the pipeline and the Func.
+     * Other stages of the Func that are tuned must use the same number
+     * of variants, and get the same choice. This is useful when the
+     * best schedule depends on the hardware, e.g. when register
+     * pressure or shared memory use limits how many GPU blocks can run
+     * at once.
+     */
+    Stage specialize_tuned(int variant, int num_variants);
+
+    /** Try each of the given tile sizes for gpu_tile, and pick the
+     * fastest at runtime, using specialize_tuned. This should be the
+     * last scheduling call for the Func. */
+    Func &gpu_tile_variants(const VarOrRVar &x, const VarOrRVar &y,
+                            const VarOrRVar &bx, const VarOrRVar &by,
+                            const VarOrRVar &tx, const VarOrRVar &ty,
+                            const std::vector<std::pair<int, int>> &sizes,
+                            TailStrategy tail = TailStrategy::Auto,
+                            DeviceAPI device_api = DeviceAPI::Default_GPU);
+
     /** Add a specialization to a Func that always terminates execution
      * with a call to halide_error(). By itself, this is of limited use,
      * but can be useful to terminate chains of specialize() calls where
@@ -1892,7 +2071,12 @@ public:
      * warp. GPU warp lanes are distinguished from GPU threads by the
      * fact that all warp lanes run together in lockstep, which
      * permits lightweight communication of data from one lane to
-     * another. */
+     * another. In Metal, OpenCL and Vulkan the warp is part of a
+     * subgroup (SIMD-group), so the lanes must be the innermost thread
+     * dimension, and the device's subgroup size must be a multiple of
+     * the number of lanes (rounded up to a power of two). Shuffles need
+     * Metal 2, the cl_khr_subgroup_shuffle(_relative) extensions, or
+     * vulkan_v13, respectively. */
     Func &gpu_lanes(const VarOrRVar &thread_x, DeviceAPI device_api = DeviceAPI::Default_GPU);
 
     /** Tell Halide to run this stage using a single gpu thread and
@@ -1911,6 +2095,35 @@ public:
     Func &gpu_blocks(const VarOrRVar &block_x, const VarOrRVar &block_y, const VarOrRVar &block_z, DeviceAPI device_api = DeviceAPI::Default_GPU);
     // @}
 
+    /** Run the loop over x, typically the loop over tiles made by a
+     * split or tile, on a fixed number of persistent GPU blocks: the
+     * loop over the new variable block (of extent num_blocks) is a
+     * loop over GPU blocks, and each block then iterates over the
+     * values of x block, block + num_blocks, block + 2 * num_blocks,
+     * and so on, in a serial loop that keeps the name x. Set num_blocks
+     * to a small multiple of the number of multiprocessors of the
+     * device, so that all the blocks are resident at once, to amortize
+     * the cost of starting blocks over many small tiles. Other Funcs
+     * can be computed at the loop over x (see compute_at_gpu_blocks) to
+     * run several stages per tile within the one kernel. */
+    Func &gpu_persistent_blocks(const VarOrRVar &x, const VarOrRVar &block, const Expr &num_blocks,
+                                DeviceAPI device_api = DeviceAPI::Default_GPU);
+
+    /** Spread the iterations of the loop over x, typically an outer
+     * loop over tiles or strips, across num_devices GPUs in the same
+     * process: iteration i runs its kernels and device allocations on
+     * GPU device i % num_devices (in the numbering used by
+     * halide_set_gpu_device), in a serial loop that keeps the name x
+     * within a loop over devices. Kernel launches are asynchronous, so
+     * the devices run concurrently. Producers stay on the device that
+     * computed them: a consumer on another device reads them, including
+     * the halo of a stencil, directly over peer-to-peer access rather
+     * than by copying. Compute producers within the loop over x to
+     * keep each device's work on its own memory. Only the CUDA runtime
+     * keeps a context per device; other GPU APIs run every iteration on
+     * the one device they use. */
+    Func &distribute(const VarOrRVar &x, int num_devices);
+
     /** Tell Halide that the following dimensions correspond to GPU
      * block indices and thread indices. If the selected target is not
      * ptx, these just mark the given dimensions as parallel. The
@@ -2208,6 +2421,20 @@ public:
      * a given LoopLevel. */
     Func &compute_at(LoopLevel loop_level);
 
+    /** Fuse the computation of this function into the GPU kernel of f:
+     * compute it at f's innermost loop over GPU blocks (or the serial
+     * loop within it just outside its loops over GPU threads, such as
+     * the one made by gpu_persistent_blocks), in shared memory, with up to three of the innermost pure loops of each of
+     * its definitions as loops over GPU threads. Each block then
+     * computes just the part of this function it needs, followed by a
+     * barrier, instead of launching a kernel of its own and passing the
+     * values to f through global memory. This suits producers that f
+     * reads within a small neighborhood of each point, such as a chain
+     * of compute_root stages with the same gpu_tile. Call this after
+     * scheduling f's loops over GPU blocks, and after any splits of this
+     * function's loops you want the threads to be. */
+    Func &compute_at_gpu_blocks(const Func &f);
+
     /** Schedule the iteration over the initial definition of this function
      *  to be fused with another stage 's' from outermost loop to a
      * given LoopLevel. */
@@ -2217,6 +2444,19 @@ public:
     Func &compute_with(LoopLevel loop_level, const std::vector<std::pair<VarOrRVar, LoopAlignStrategy>> &align);
     Func &compute_with(LoopLevel loop_level, LoopAlignStrategy align = LoopAlignStrategy::Auto);
 
+    /** Fuse the last update of each of the siblings into the loops of the
+     * last update of this function, from the outermost loop to the
+     * innermost, so that reductions over the same domain (for example
+     * the sum, the sum of squares, and the maximum of an image) read it
+     * in one traversal instead of one each. The last updates must all
+     * be reductions over domains of the same bounds, with loop nests of
+     * the same shape, and the Funcs must be computed at the same
+     * LoopLevel. The siblings' reductions are computed after this one's
+     * at each point of the domain. This is shorthand for a compute_with
+     * of each sibling's last update at the innermost loop of this one,
+     * so the siblings remain separate Funcs. */
+    Func &fuse_reductions(const std::vector<Func> &siblings);
+
     /** Compute all of this function once ahead of time. Reusing
      * the example in \ref Func::compute_at :
      *
@@ -2264,8 +2504,17 @@ public:
      * to remove memoized entries using this eviction key from the
      * cache. Memoized computations that do not provide an eviction
      * key will never be evicted by this mechanism.
+     *
+     * Computations that read buffer inputs normally need memoize_tag
+     * to say what to key them on. If hash_buffer_contents is true,
+     * they are instead keyed on a hash of the shape and contents of
+     * each buffer they read. The same data passed in a new allocation
+     * is then a cache hit, and data modified in place is a miss. The
+     * buffers are hashed in full each time the Func is realized, so
+     * this suits Funcs that are much more expensive to compute than
+     * to hash their inputs, computed at the root level.
      */
-    Func &memoize(const EvictionKey &eviction_key = EvictionKey());
+    Func &memoize(const EvictionKey &eviction_key = EvictionKey(), bool hash_buffer_contents = false);
 
     /** Produce this Func asynchronously in a separate
      * thread. Consumers will be run by the task system when the
@@ -2301,6 +2550,45 @@ public:
      */
     Func &ring_buffer(Expr extent);
 
+    /** Compute this Func within the given loop of one of its consumers
+     * (typically a loop over tiles), and overlap computing it for each
+     * iteration of the loop with the work of the consumer for the previous
+     * iterations. This is shorthand for:
+     \code
+     f.compute_at(loop_level).hoist_storage_root().ring_buffer(depth).async();
+     \endcode
+     * The producer runs in its own thread, one iteration ahead of the
+     * consumer, using a ring buffer with depth copies of its
+     * storage for one iteration, so depth must be at least 2. Larger
+     * depths let the producer run further ahead, which can smooth out
+     * iterations that take different amounts of time. The semaphores
+     * that synchronize the producer with its consumers and the ring
+     * buffer's indexing are derived automatically.
+     *
+     * The size of the storage for one iteration must be bounded, because
+     * the storage is hoisted outside of all the loops.
+     */
+    Func &pipeline_across(LoopLevel loop_level, int depth = 2);
+
+    /** Equivalent to the version of pipeline_across that takes a LoopLevel,
+     * but pipelines across f's loop over var. */
+    Func &pipeline_across(const Func &f, const Var &var, int depth = 2);
+
+    /** Stream this Func, which must be a wrapper of an input that has
+     * been prepared for DMA (see HalideRuntimeHexagonDma.h), into VTCM
+     * one tile at a time, overlapping the transfer of each tile with
+     * the consumer's work on the previous ones. tiles is the consumer's
+     * loop over tiles, and rows an enclosing loop (typically over rows
+     * of tiles) at which the storage is allocated. The storage is
+     * folded along dim into a ring of depth tiles of the given extent,
+     * so depth must be at least 2. This is shorthand for:
+     \code
+     f.copy_to_host().compute_at(tiles).store_at(rows)
+      .store_in(MemoryType::VTCM).fold_storage(dim, tile_extent * depth).async();
+     \endcode
+     * It requires a Hexagon target with the hexagon_dma feature. */
+    Func &stream_via_dma(LoopLevel tiles, LoopLevel rows, const Var &dim, const Expr &tile_extent, int depth = 2);
+
     /** Bound the extent of a Func's storage, but not extent of its
      * compute. This can be useful for forcing a function's allocation
      * to be a fixed size, which often means it can go on the stack.
@@ -2564,8 +2852,17 @@ public:
      */
     Func &add_trace_tag(const std::string &trace_tag);
 
+    /** Only trace the loads and stores done in some of the iterations of
+     * the loops over var in this Func's definitions, chosen by sampling
+     * with parameter n (see TraceSampling). Tracing a tile loop this way
+     * captures representative access patterns of a large pipeline
+     * without tracing every access. Realizations are still all traced.
+     * The loop over var may not be vectorized. Calling this again
+     * replaces the previous sampling. */
+    Func &sample_tracing(const VarOrRVar &var, TraceSampling sampling, int n);
+
     /** Marks this function as a function that should not be profiled
-     * when using the target feature Profile or ProfileByTimer.
+     * when using the target feature Profile, ProfileByTimer or ProfileLight.
      * This is useful when this function is does too little work at once
      * such that the overhead of setting the profiling token might
      * become significant, or that the measured time is not representative
@@ -1,4 +1,3 @@
-#include <atomic>
 #include <cstdlib>
 #include <memory>
 #include <set>
@@ -109,6 +108,11 @@ struct FunctionContents {
 
     bool trace_loads = false, trace_stores = false, trace_realizations = false;
     std::vector<string> trace_tags;
+    // If trace_sampling_n is nonzero, loads and stores are only traced in
+    // some iterations of the loops over trace_sampling_var.
+    string trace_sampling_var;
+    TraceSampling trace_sampling = TraceSampling::EveryNth;
+    int trace_sampling_n = 0;
 
     bool no_profiling = false;
 
@@ -305,7 +309,8 @@ public:
 
 // A counter to use in tagging random variables.
 // Note that this will be reset by Internal::reset_random_counters().
-std::atomic<int> random_variable_counter = 0;
+// Thread-local, like the one in IROperator.cpp.
+thread_local int random_variable_counter = 0;
 
 Function::Function(const FunctionPtr &ptr)
     : contents(ptr) {
@@ -354,6 +359,9 @@ void Function::update_with_deserialization(const std::string &name,
                                            bool trace_stores,
                                            bool trace_realizations,
                                            const std::vector<std::string> &trace_tags,
+                                           const std::string &trace_sampling_var,
+                                           TraceSampling trace_sampling,
+                                           int trace_sampling_n,
                                            bool no_profiling,
                                            bool frozen) {
     contents->name = name;
@@ -376,6 +384,9 @@ void Function::update_with_deserialization(const std::string &name,
     contents->trace_stores = trace_stores;
     contents->trace_realizations = trace_realizations;
     contents->trace_tags = trace_tags;
+    contents->trace_sampling_var = trace_sampling_var;
+    contents->trace_sampling = trace_sampling;
+    contents->trace_sampling_n = trace_sampling_n;
     contents->no_profiling = no_profiling;
     contents->frozen = frozen;
 }
@@ -515,6 +526,9 @@ void Function::deep_copy(const FunctionPtr &copy, DeepCopyMap &copied_map) const
     copy->trace_stores = contents->trace_stores;
     copy->trace_realizations = contents->trace_realizations;
     copy->trace_tags = contents->trace_tags;
+    copy->trace_sampling_var = contents->trace_sampling_var;
+    copy->trace_sampling = contents->trace_sampling;
+    copy->trace_sampling_n = contents->trace_sampling_n;
     copy->no_profiling = contents->no_profiling;
     copy->frozen = contents->frozen;
     copy->output_buffers = contents->output_buffers;
@@ -1162,6 +1176,20 @@ bool Function::is_tracing_realizations() const {
 const std::vector<std::string> &Function::get_trace_tags() const {
     return contents->trace_tags;
 }
+void Function::sample_tracing(const std::string &var, TraceSampling sampling, int n) {
+    contents->trace_sampling_var = var;
+    contents->trace_sampling = sampling;
+    contents->trace_sampling_n = n;
+}
+const std::string &Function::trace_sampling_var() const {
+    return contents->trace_sampling_var;
+}
+TraceSampling Function::trace_sampling() const {
+    return contents->trace_sampling;
+}
+int Function::trace_sampling_n() const {
+    return contents->trace_sampling_n;
+}
 
 void Function::lock_loop_levels() {
     auto &schedule = contents->func_schedule;
@@ -89,6 +89,9 @@ public:
                                      bool trace_stores,
                                      bool trace_realizations,
                                      const std::vector<std::string> &trace_tags,
+                                     const std::string &trace_sampling_var,
+                                     TraceSampling trace_sampling,
+                                     int trace_sampling_n,
                                      bool no_profiling,
                                      bool frozen);
 
@@ -286,6 +289,10 @@ public:
     bool is_tracing_stores() const;
     bool is_tracing_realizations() const;
     const std::vector<std::string> &get_trace_tags() const;
+    void sample_tracing(const std::string &var, TraceSampling sampling, int n);
+    const std::string &trace_sampling_var() const;
+    TraceSampling trace_sampling() const;
+    int trace_sampling_n() const;
     // @}
 
     /** Replace this Function's LoopLevels with locked copies that
@@ -362,7 +369,7 @@ std::pair<std::vector<Function>, std::map<std::string, Function>> deep_copy(
     const std::vector<Function> &outputs,
     const std::map<std::string, Function> &env);
 
-extern std::atomic<int> random_variable_counter;
+extern thread_local int random_variable_counter;
 
 }  // namespace Internal
 }  // namespace Halide
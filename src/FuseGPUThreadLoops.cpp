@@ -1275,6 +1275,7 @@ class InjectThreadBarriers : public IRMutator {
             break;
         case MemoryType::Auto:
         case MemoryType::Heap:
+        case MemoryType::Streaming:
         case MemoryType::GPUTexture:
             debug(4) << "   memory type is heap or auto\n";
             device_stores.insert(op->name);
@@ -1284,6 +1285,8 @@ class InjectThreadBarriers : public IRMutator {
         case MemoryType::LockedCache:
         case MemoryType::VTCM:
         case MemoryType::AMXTile:
+        case MemoryType::WMMAAccumulator:
+        case MemoryType::SimdgroupMatrix:
             break;
         }
 
@@ -1300,6 +1303,7 @@ class InjectThreadBarriers : public IRMutator {
             break;
         case MemoryType::Auto:
         case MemoryType::Heap:
+        case MemoryType::Streaming:
         case MemoryType::GPUTexture:
             debug(4) << "   memory type is heap or auto\n";
             device_loads.insert(op->name);
@@ -1309,6 +1313,8 @@ class InjectThreadBarriers : public IRMutator {
         case MemoryType::LockedCache:
         case MemoryType::VTCM:
         case MemoryType::AMXTile:
+        case MemoryType::WMMAAccumulator:
+        case MemoryType::SimdgroupMatrix:
             break;
         }
 
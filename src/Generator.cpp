@@ -1,8 +1,11 @@
 #include <atomic>
 #include <cmath>
 #include <condition_variable>
+#include <deque>
 #include <fstream>
+#include <future>
 #include <memory>
+#include <thread>
 #include <unordered_map>
 #include <utility>
 
@@ -12,6 +15,7 @@
 #include "Module.h"
 #include "Serialization.h"
 #include "Simplify.h"
+#include "SizeVariants.h"
 
 #ifdef HALIDE_ALLOW_GENERATOR_BUILD_METHOD
 #pragma message "Support for Generator build() methods has been removed in Halide version 15."
@@ -90,6 +94,44 @@ std::map<OutputFileType, std::string> compute_output_files(const Target &target,
     return output_files;
 }
 
+// Print everything in a Module that can affect the files compiled from
+// it, for hashing.
+void print_module_for_hash(std::ostream &stream, const Module &m) {
+    for (const auto &sub : m.submodules()) {
+        print_module_for_hash(stream, sub);
+    }
+    stream << "module name=" << m.name() << ", target=" << m.target().to_string() << "\n";
+    for (const Buffer<> &b : m.buffers()) {
+        stream << "buffer " << b.name() << " " << b.type() << " " << b.dimensions() << ":";
+        for (int i = 0; i < b.dimensions(); i++) {
+            stream << " " << b.dim(i).min() << "," << b.dim(i).extent() << "," << b.dim(i).stride();
+        }
+        stream << "\n";
+        stream.write((const char *)b.data(), (std::streamsize)b.size_in_bytes());
+        stream << "\n";
+    }
+    for (const auto &f : m.functions()) {
+        stream << "linkage=" << (int)f.linkage << " " << f << "\n";
+    }
+    if (const AutoSchedulerResults *r = m.get_auto_scheduler_results()) {
+        stream << r->schedule_source << "\n";
+        stream.write((const char *)r->featurization.data(), (std::streamsize)r->featurization.size());
+        stream << "\n";
+    }
+    if (m.get_conceptual_stmt().defined()) {
+        stream << m.get_conceptual_stmt() << "\n";
+    }
+}
+
+// 64-bit FNV-1a.
+uint64_t content_hash(const std::string &s) {
+    uint64_t h = 0xcbf29ce484222325ULL;
+    for (char c : s) {
+        h = (h ^ (uint8_t)c) * 0x100000001b3ULL;
+    }
+    return h;
+}
+
 Func make_param_func(const Parameter &p, const std::string &name) {
     internal_assert(p.is_buffer());
     Func f(p.type(), p.dimensions(), name + "_im");
@@ -644,7 +686,7 @@ int generate_filter_main_inner(int argc,
 gengen
   [-g GENERATOR_NAME] [-f FUNCTION_NAME] [-o OUTPUT_DIR] [-r RUNTIME_NAME]
   [-d 1|0] [-e EMIT_OPTIONS] [-n FILE_BASE_NAME] [-p PLUGIN_NAME]
-  [-s AUTOSCHEDULER_NAME] [-t TIMEOUT]
+  [-s AUTOSCHEDULER_NAME] [-t TIMEOUT] [-j THREADS]
   target=target-string[,target-string...]
   [generator_param=value [...]]
 
@@ -676,14 +718,30 @@ gengen
      bugs and/or degenerate cases don't stall build systems. Specify 0 to allow
      infinite time. Defaults to infinite.
 
+ -c  If 1, skip code generation when the lowered pipeline, targets and
+     GeneratorParams are the same as in the last run that produced the
+     outputs, which are then left as they are. A hash of these is kept in
+     OUTPUT_DIR/FILE_BASE_NAME.generator_cache. Defaults to 0.
+
+ -j  The number of targets to lower and compile at once when several are
+     given. Specify 0 to use one thread per core. Lowering happens one target
+     at a time when compiler_log is emitted. Defaults to 1.
+
  -v  If nonzero, log the path to all generated files to stdout.
+
+ size_variants=scale[,scale...]
+     Build one variant of the pipeline per scale factor, each autoscheduled with
+     the estimated extents scaled by that factor, and a wrapper that learns
+     which is fastest for each size of output at runtime. Requires -s.
 )INLINE_CODE";
 
     std::map<std::string, std::string> flags_info = {
+        {"-c", "0"},
         {"-d", "0"},
         {"-e", ""},
         {"-f", ""},
         {"-g", ""},
+        {"-j", "1"},
         {"-n", ""},
         {"-o", ""},
         {"-p", ""},
@@ -735,10 +793,19 @@ gengen
     user_assert(d_val == "1" || d_val == "0") << "-d must be 0 or 1\n"
                                               << kUsage;
 
+    const auto &c_val = flags_info["-c"];
+    user_assert(c_val == "1" || c_val == "0") << "-c must be 0 or 1\n"
+                                              << kUsage;
+
     const auto &v_val = flags_info["-v"];
     user_assert(v_val == "1" || v_val == "0") << "-v must be 0 or 1\n"
                                               << kUsage;
 
+    const auto &j_val = flags_info["-j"];
+    user_assert(!j_val.empty() && j_val.find_first_not_of("0123456789") == std::string::npos)
+        << "-j must be a nonnegative integer\n"
+        << kUsage;
+
     const std::vector<std::string> generator_names = generator_factory_provider.enumerate();
 
     const auto create_generator = [&](const std::string &generator_name, const Halide::GeneratorContext &context) -> AbstractGeneratorPtr {
@@ -765,6 +832,21 @@ gengen
         return target_strings;
     };
 
+    const auto build_size_variants = [](GeneratorParamsMap *gp) {
+        std::vector<float> size_variants;
+        if (gp->find("size_variants") != gp->end()) {
+            for (const auto &s : split_string((*gp)["size_variants"], ",")) {
+                char *end = nullptr;
+                float scale = std::strtof(s.c_str(), &end);
+                user_assert(!s.empty() && *end == 0 && scale > 0)
+                    << "size_variants must be a comma-separated list of positive scale factors, but saw '" << s << "'.\n";
+                size_variants.push_back(scale);
+            }
+            gp->erase("size_variants");
+        }
+        return size_variants;
+    };
+
     const auto build_targets = [](const std::vector<std::string> &target_strings) {
         std::vector<Target> targets;
         for (const auto &s : target_strings) {
@@ -841,6 +923,7 @@ gengen
     // and if we don't use those, the output filenames might not match what the caller expects.
     args.suffixes = build_target_strings(&args.generator_params);
     args.targets = build_targets(args.suffixes);
+    args.size_variants = build_size_variants(&args.generator_params);
     args.output_dir = flags_info["-o"];
     args.output_types = build_output_types();
     args.generator_name = flags_info["-g"];
@@ -852,6 +935,8 @@ gengen
     // args.generator_params is already set
     // If true, log the path of all output files to stdout.
     args.log_outputs = (v_val == "1");
+    args.use_build_cache = (c_val == "1");
+    args.num_threads = std::atoi(j_val.c_str());
 
     // Allow quick-n-dirty use of compiler logging via HL_DEBUG_COMPILER_LOGGER env var
     const bool do_compiler_logging = args.output_types.count(OutputFileType::compiler_log) ||
@@ -1097,12 +1182,129 @@ void execute_generator(const ExecuteGeneratorArgs &args_in) {
         if (!cpp_stub_only) {
             auto output_files = compute_output_files(args.targets[0], base_path, args.output_types);
             auto module_factory = [&](const std::string &function_name, const Target &target) -> Module {
+                if (!args.size_variants.empty()) {
+                    user_assert(args.build_mode == ExecuteGeneratorArgs::Default)
+                        << "size_variants can't be used with -d 1.\n";
+                    auto build_variant = [&](const std::string &variant_name, float scale) -> Module {
+                        auto gen = generator_factory(variant_name, target);
+                        return gen->build_module(variant_name, scale, LinkageType::Internal);
+                    };
+                    return build_size_variants_module(function_name, target, args.size_variants, build_variant);
+                }
                 auto gen = generator_factory(function_name, target);
                 return args.build_mode == ExecuteGeneratorArgs::Gradient ?
                            gen->build_gradient_module(function_name) :
                            gen->build_module(function_name);
             };
-            compile_multitarget(args.function_name, output_files, args.targets, args.suffixes, module_factory, args.compiler_logger_factory);
+
+            // Lowering is cheap next to code generation, so to use the build
+            // cache, build the modules first (named and targeted the way
+            // compile_multitarget will ask for them), and hash them along
+            // with everything else that goes into the outputs. Compiler
+            // logging happens while the modules are built, so it disables
+            // the cache.
+            const bool use_build_cache = args.use_build_cache && !args_in.compiler_logger_factory;
+            const std::string cache_path = base_path + ".generator_cache";
+            std::map<std::pair<std::string, std::string>, Module> prebuilt_modules;
+            std::string cache_key;
+            bool up_to_date = false;
+
+            // With several targets and threads, lower the targets
+            // concurrently up front, the same way as for the build cache.
+            // Each one gets a Generator of its own, so they share no
+            // pipeline state. Compiler logging is attached to the thread
+            // that builds the module, so it keeps lowering serial.
+            const int num_threads = args.num_threads > 0 ?
+                                        args.num_threads :
+                                        (int)std::max(1u, std::thread::hardware_concurrency());
+            const bool parallel_lowering = args.targets.size() > 1 && num_threads > 1 && !args_in.compiler_logger_factory;
+            std::vector<std::pair<std::string, Target>> sub_targets;
+            std::vector<Module> sub_modules;
+            if (use_build_cache || parallel_lowering) {
+                for (size_t i = 0; i < args.targets.size(); i++) {
+                    std::string name = args.function_name;
+                    Target target = args.targets[i];
+                    if (args.targets.size() > 1) {
+                        name += "-" + (args.suffixes.empty() ? target.to_string() : args.suffixes[i]);
+                        target = target.with_feature(Target::NoRuntime);
+                    }
+                    sub_targets.emplace_back(name, target);
+                }
+                const auto build = [&](size_t i) -> Module {
+                    reset_random_counters();
+                    return module_factory(sub_targets[i].first, sub_targets[i].second);
+                };
+                if (parallel_lowering) {
+                    std::deque<std::future<Module>> pending;
+                    for (size_t i = 0; i < sub_targets.size(); i++) {
+                        while (pending.size() >= (size_t)num_threads) {
+                            sub_modules.push_back(pending.front().get());
+                            pending.pop_front();
+                        }
+                        pending.push_back(std::async(std::launch::async, build, i));
+                    }
+                    for (auto &p : pending) {
+                        sub_modules.push_back(p.get());
+                    }
+                } else {
+                    for (size_t i = 0; i < sub_targets.size(); i++) {
+                        sub_modules.push_back(build(i));
+                    }
+                }
+                for (size_t i = 0; i < sub_targets.size(); i++) {
+                    prebuilt_modules.emplace(std::make_pair(sub_targets[i].first, sub_targets[i].second.to_string()), sub_modules[i]);
+                }
+            }
+
+            if (use_build_cache) {
+                std::ostringstream key;
+                key << "halide " << HALIDE_VERSION_MAJOR << "." << HALIDE_VERSION_MINOR << "." << HALIDE_VERSION_PATCH
+#ifdef LLVM_VERSION
+                    << " llvm " << LLVM_VERSION
+#endif
+                    << "\nmode " << (int)args.build_mode << "\n";
+                for (const auto &o : output_files) {
+                    key << "output " << (int)o.first << " " << o.second << "\n";
+                }
+                for (const Module &m : sub_modules) {
+                    print_module_for_hash(key, m);
+                }
+                const std::string key_str = key.str();
+                std::ostringstream hash;
+                hash << std::hex << content_hash(key_str) << " " << std::dec << key_str.size() << "\n";
+                cache_key = hash.str();
+
+                up_to_date = file_exists(cache_path);
+                for (const auto &o : output_files) {
+                    up_to_date = up_to_date && file_exists(o.second);
+                }
+                if (up_to_date) {
+                    std::vector<char> cached = read_entire_file(cache_path);
+                    up_to_date = std::string(cached.begin(), cached.end()) == cache_key;
+                }
+                // Don't leave a stale hash behind if compilation fails.
+                if (!up_to_date && file_exists(cache_path)) {
+                    file_unlink(cache_path);
+                }
+            }
+
+            if (up_to_date) {
+                debug(1) << "Outputs of " << args.function_name << " are up to date; skipping code generation.\n";
+            } else {
+                auto cached_module_factory = [&](const std::string &function_name, const Target &target) -> Module {
+                    auto it = prebuilt_modules.find({function_name, target.to_string()});
+                    if (it == prebuilt_modules.end()) {
+                        return module_factory(function_name, target);
+                    }
+                    Module m = it->second;
+                    prebuilt_modules.erase(it);
+                    return m;
+                };
+                compile_multitarget(args.function_name, output_files, args.targets, args.suffixes, cached_module_factory, args.compiler_logger_factory, num_threads);
+                if (use_build_cache) {
+                    write_entire_file(cache_path, cache_key.data(), cache_key.size());
+                }
+            }
             if (args.log_outputs) {
                 for (const auto &o : output_files) {
                     std::cout << "Generated file: " << o.second << "\n";
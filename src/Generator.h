@@ -3949,11 +3949,32 @@ struct ExecuteGeneratorArgs {
     // to the Generator created, an error will occur.
     GeneratorParamsMap generator_params;
 
+    // If nonempty, build several variants of the pipeline, each autoscheduled
+    // with the estimated extents of the inputs and outputs scaled by one of
+    // these factors, along with a wrapper that runs the one that's fastest
+    // for calls of about the same size at runtime (see
+    // halide_choose_size_variant()). Requires an autoscheduler. On the
+    // command line, this is the size_variants GeneratorParam, e.g.
+    // size_variants=0.25,1,4.
+    std::vector<float> size_variants;
+
     // Compiler Logger to use, for diagnostic work. If null, don't do any logging.
     CompilerLoggerFactory compiler_logger_factory = nullptr;
 
     // If true, log the path of all output files to stdout.
     bool log_outputs = false;
+
+    // If true, skip code generation when the lowered modules, targets and
+    // other inputs hash to the same value as in the last run that produced
+    // all of the outputs, leaving the outputs untouched. The hash is kept
+    // next to the outputs, in FILE_BASE_NAME.generator_cache. Ignored if
+    // compiler_logger_factory is set.
+    bool use_build_cache = false;
+
+    // When there are several targets, the number of them to lower and
+    // compile at once, or 0 to use one thread per core. Lowering stays on
+    // the calling thread when compiler_logger_factory is set.
+    int num_threads = 1;
 };
 
 /**
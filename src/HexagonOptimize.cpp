@@ -12,11 +12,14 @@
 #include "IRMatch.h"
 #include "IRMutator.h"
 #include "IROperator.h"
+#include "IRVisitor.h"
 #include "Lerp.h"
 #include "OptimizeShuffles.h"
 #include "Scope.h"
 #include "Simplify.h"
 #include "Substitute.h"
+#include <algorithm>
+#include <limits>
 #include <unordered_map>
 #include <utility>
 
@@ -110,6 +113,8 @@ string type_suffix(Type type, bool signed_variants) {
         }
     } else if (type.is_float()) {
         switch (type.bits()) {
+        case 16:
+            return prefix + "hf";
         case 32:
             return prefix + "sf";
         default:
@@ -2281,7 +2286,7 @@ public:
 Stmt optimize_hexagon_shuffles(const Stmt &s, int lut_alignment) {
     // Replace indirect and other complicated loads with
     // dynamic_shuffle (vlut) calls.
-    return optimize_shuffles(s, lut_alignment);
+    return optimize_shuffles(s, lut_alignment, [](const Type &) { return 256; });
 }
 
 Stmt scatter_gather_generator(Stmt s) {
@@ -2293,6 +2298,246 @@ Stmt scatter_gather_generator(Stmt s) {
     return s;
 }
 
+namespace {
+
+// The VTCM that place_allocations_in_vtcm may use, for each
+// allocation live at once. We leave half of the smallest VTCM of each
+// architecture for explicit store_in(MemoryType::VTCM) and for other
+// clients of VTCM.
+int64_t auto_vtcm_budget(const Target &t) {
+    if (t.has_feature(Target::HVX_v68)) {
+        return 2 * 1024 * 1024;
+    }
+    return 128 * 1024;
+}
+
+// Each VTCM allocation is requested as a single page, so don't place
+// anything larger than the smallest VTCM in it.
+const int64_t max_auto_vtcm_allocation_size = 256 * 1024;
+
+// The number of HVX contexts that might each have a copy of an
+// allocation inside a parallel loop.
+const int64_t max_hvx_threads = 4;
+
+// Only place allocations in VTCM whose bytes are on average loaded at
+// least this many times for each time they are stored, as requesting
+// VTCM costs more than heap memory, and data that is only streamed
+// through gains little from it.
+const double min_auto_vtcm_reuse = 2.0;
+
+// Count the bytes of an allocation that are loaded and stored over
+// one instance of it, and check that it's only used by loads and
+// stores. Loops of unknown extent are counted as running once, which
+// usually affects the loads and the stores alike.
+class CountAllocationAccesses : public IRVisitor {
+    const string &name;
+    double trips = 1;
+
+    using IRVisitor::visit;
+
+    void visit(const For *op) override {
+        op->min.accept(this);
+        op->extent.accept(this);
+        double old_trips = trips;
+        if (auto extent = as_const_int(op->extent)) {
+            trips *= std::max<int64_t>(*extent, 0);
+        }
+        op->body.accept(this);
+        trips = old_trips;
+    }
+
+    void visit(const Load *op) override {
+        if (op->name == name) {
+            loaded_bytes += trips * op->type.bytes() * op->type.lanes();
+        }
+        IRVisitor::visit(op);
+    }
+
+    void visit(const Store *op) override {
+        if (op->name == name) {
+            stored_bytes += trips * op->value.type().bytes() * op->value.type().lanes();
+        }
+        IRVisitor::visit(op);
+    }
+
+    void visit(const Variable *op) override {
+        // The allocation is passed to something as a pointer or a
+        // buffer (e.g. an extern stage or a DMA copy).
+        if (op->name == name || op->name == name + ".buffer") {
+            escapes = true;
+        }
+    }
+
+public:
+    double loaded_bytes = 0, stored_bytes = 0;
+    bool escapes = false;
+
+    CountAllocationAccesses(const string &name)
+        : name(name) {
+    }
+};
+
+// The size in bytes of an allocation, or 0 if it isn't constant.
+int64_t constant_allocation_bytes(const Allocate *op) {
+    int64_t elements = 1;
+    for (const Expr &e : op->extents) {
+        auto extent = as_const_int(e);
+        if (!extent || *extent <= 0) {
+            return 0;
+        }
+        elements *= *extent;
+        if (elements > std::numeric_limits<int32_t>::max()) {
+            return 0;
+        }
+    }
+    return (elements + op->padding) * op->type.bytes();
+}
+
+struct VTCMCandidate {
+    string name;
+    int64_t bytes;
+    double reuse;
+};
+
+class FindVTCMCandidates : public IRVisitor {
+    using IRVisitor::visit;
+
+    void visit(const Allocate *op) override {
+        if ((op->memory_type == MemoryType::Auto || op->memory_type == MemoryType::Heap) &&
+            !op->new_expr.defined()) {
+            int64_t bytes = constant_allocation_bytes(op);
+            if (bytes > 0 && bytes <= max_auto_vtcm_allocation_size) {
+                CountAllocationAccesses counter(op->name);
+                op->body.accept(&counter);
+                if (!counter.escapes && counter.stored_bytes > 0 &&
+                    counter.loaded_bytes >= min_auto_vtcm_reuse * counter.stored_bytes) {
+                    double reuse = counter.loaded_bytes / counter.stored_bytes;
+                    candidates.push_back({op->name, bytes, reuse});
+                }
+            }
+        }
+        IRVisitor::visit(op);
+    }
+
+public:
+    vector<VTCMCandidate> candidates;
+};
+
+// Compute the peak VTCM in use at once if the given allocations are
+// placed in it, along with those already stored in VTCM. Allocations
+// are live for their whole scope, so siblings share VTCM; the two
+// sides of a Fork run concurrently, and each thread of a parallel loop
+// has its own copies of the allocations inside it.
+class PeakVTCMUsage : public IRVisitor {
+    const set<string> &placed;
+    int64_t copies = 1;
+    int64_t current = 0;
+
+    using IRVisitor::visit;
+
+    void visit(const Allocate *op) override {
+        int64_t bytes = 0;
+        if (placed.count(op->name) ||
+            (op->memory_type == MemoryType::VTCM && !op->new_expr.defined())) {
+            // Explicit VTCM allocations of non-constant size aren't
+            // accounted for.
+            bytes = constant_allocation_bytes(op) * copies;
+        }
+        current += bytes;
+        peak = std::max(peak, current);
+        IRVisitor::visit(op);
+        current -= bytes;
+    }
+
+    void visit(const For *op) override {
+        int64_t old_copies = copies;
+        if (op->is_parallel()) {
+            int64_t threads = max_hvx_threads;
+            if (auto extent = as_const_int(op->extent)) {
+                threads = std::min(threads, std::max<int64_t>(*extent, 1));
+            }
+            copies *= threads;
+        }
+        IRVisitor::visit(op);
+        copies = old_copies;
+    }
+
+    void visit(const Fork *op) override {
+        const int64_t old_peak = peak;
+        peak = current;
+        op->first.accept(this);
+        const int64_t first = peak - current;
+        peak = current;
+        op->rest.accept(this);
+        const int64_t rest = peak - current;
+        peak = std::max(old_peak, current + first + rest);
+    }
+
+public:
+    int64_t peak = 0;
+
+    PeakVTCMUsage(const set<string> &placed)
+        : placed(placed) {
+    }
+};
+
+class PlaceInVTCM : public IRMutator {
+    const set<string> &placed;
+
+    using IRMutator::visit;
+
+    Stmt visit(const Allocate *op) override {
+        Stmt s = IRMutator::visit(op);
+        if (!placed.count(op->name)) {
+            return s;
+        }
+        op = s.as<Allocate>();
+        internal_assert(op);
+        debug(2) << "Hexagon: placing " << op->name << " in VTCM\n";
+        return Allocate::make(op->name, op->type, MemoryType::VTCM, op->extents,
+                              op->condition, op->body, op->new_expr, op->free_function,
+                              op->padding);
+    }
+
+public:
+    PlaceInVTCM(const set<string> &placed)
+        : placed(placed) {
+    }
+};
+
+}  // namespace
+
+Stmt place_allocations_in_vtcm(const Stmt &s, const Target &t) {
+    FindVTCMCandidates finder;
+    s.accept(&finder);
+    vector<VTCMCandidate> &candidates = finder.candidates;
+    if (candidates.empty()) {
+        return s;
+    }
+
+    // Greedily place the allocations with the most reuse first, as long
+    // as the VTCM in use at once stays within the budget.
+    std::stable_sort(candidates.begin(), candidates.end(),
+                     [](const VTCMCandidate &a, const VTCMCandidate &b) {
+                         return a.reuse > b.reuse;
+                     });
+    const int64_t budget = auto_vtcm_budget(t);
+    set<string> placed;
+    for (const VTCMCandidate &c : candidates) {
+        placed.insert(c.name);
+        PeakVTCMUsage usage(placed);
+        s.accept(&usage);
+        if (usage.peak > budget) {
+            placed.erase(c.name);
+        }
+    }
+
+    if (placed.empty()) {
+        return s;
+    }
+    return PlaceInVTCM(placed).mutate(s);
+}
+
 Stmt optimize_hexagon_instructions(Stmt s, const Target &t) {
     debug(4) << "Hexagon: lowering before find_intrinsics\n"
              << s << "\n";
@@ -24,6 +24,13 @@ Stmt optimize_hexagon_shuffles(const Stmt &s, int lut_alignment);
  *     2. out(idx(x)) = foo(x) -> vscatter */
 Stmt scatter_gather_generator(Stmt s);
 
+/** Store heap allocations of constant size whose contents are loaded
+ * several times per store in VTCM, most reused first, while the VTCM
+ * live at any one time (counting each thread's copies of allocations
+ * in parallel loops) fits in a budget for the target. Used for targets
+ * with the hvx_auto_vtcm feature. */
+Stmt place_allocations_in_vtcm(const Stmt &s, const Target &t);
+
 /** Hexagon deinterleaves when performing widening operations, and
  * interleaves when performing narrowing operations. This pass
  * rewrites widenings/narrowings to be explicit in the IR, and
@@ -619,6 +619,7 @@ const char *const intrinsic_op_names[] = {
     "bool_to_mask",
     "bundle",
     "call_cached_indirect_function",
+    "can_use_target_features",
     "cast_mask",
     "concat_bits",
     "count_leading_zeros",
@@ -629,6 +630,7 @@ const char *const intrinsic_op_names[] = {
     "dynamic_shuffle",
     "extract_bits",
     "extract_mask_element",
+    "float16_compute",
     "get_user_context",
     "gpu_thread_barrier",
     "halving_add",
@@ -650,6 +652,7 @@ const char *const intrinsic_op_names[] = {
     "mod_round_to_zero",
     "mul_shift_right",
     "mux",
+    "nontemporal_store",
     "popcount",
     "prefetch",
     "profiling_enable_instance_marker",
@@ -677,6 +680,7 @@ const char *const intrinsic_op_names[] = {
     "skip_stages_marker",
     "sliding_window_marker",
     "sorted_avg",
+    "store_fence",
     "strict_float",
     "stringify",
     "target_arch_is",
@@ -687,6 +691,7 @@ const char *const intrinsic_op_names[] = {
     "undef",
     "unreachable",
     "unsafe_promise_clamped",
+    "use_tuned_variant",
     "widen_right_add",
     "widen_right_mul",
     "widen_right_sub",
@@ -529,6 +529,12 @@ struct Call : public ExprNode<Call> {
         // Bundle multiple exprs together temporarily for analysis (e.g. CSE)
         bundle,
         call_cached_indirect_function,
+
+        // True if the CPU running the code has all of the target features
+        // named by the string argument (in the '-'-separated form used by
+        // Target strings). Created by Stage::specialize_target_features and
+        // removed by outline_target_feature_specializations.
+        can_use_target_features,
         cast_mask,
 
         // Concatenate bits of the args, with least significant bits as the
@@ -546,6 +552,7 @@ struct Call : public ExprNode<Call> {
         // of bits determined by the return type.
         extract_bits,
         extract_mask_element,
+        float16_compute,
         get_user_context,
         gpu_thread_barrier,
         halving_add,
@@ -567,6 +574,11 @@ struct Call : public ExprNode<Call> {
         mod_round_to_zero,
         mul_shift_right,
         mux,
+
+        // Wraps the value of a Store to have it bypass the cache. Only
+        // valid as the outermost node of a Store value.
+        nontemporal_store,
+
         popcount,
         prefetch,
         profiling_enable_instance_marker,
@@ -610,6 +622,11 @@ struct Call : public ExprNode<Call> {
 
         // Compute (arg[0] + arg[1]) / 2, assuming arg[0] < arg[1].
         sorted_avg,
+
+        // Makes all earlier stores by this thread, including non-temporal
+        // ones, visible before any later stores.
+        store_fence,
+
         strict_float,
         stringify,
 
@@ -623,6 +640,12 @@ struct Call : public ExprNode<Call> {
         unreachable,
         unsafe_promise_clamped,
 
+        // True if the variant of the Func named by the first arg that
+        // runs is the second arg, out of the number of variants in the
+        // third. Created by Stage::specialize_tuned and removed by
+        // lower_tuned_variants.
+        use_tuned_variant,
+
         // One-sided variants of widening_add, widening_mul, and widening_sub.
         // arg[0] + widen(arg[1])
         widen_right_add,
@@ -0,0 +1,1876 @@
+#include "IRInterpreter.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <new>
+#include <set>
+#include <sstream>
+#include <unordered_map>
+#include <utility>
+
+#include "Buffer.h"
+#include "CodeGen_Internal.h"
+#include "Error.h"
+#include "FindIntrinsics.h"
+#include "Float16.h"
+#include "IRMutator.h"
+#include "IROperator.h"
+#include "IRPrinter.h"
+#include "IRVisitor.h"
+#include "JITModule.h"
+#include "Lerp.h"
+#include "Module.h"
+#include "Scope.h"
+#include "Util.h"
+
+namespace Halide {
+namespace Internal {
+
+using std::map;
+using std::string;
+using std::vector;
+
+namespace {
+
+// Heap allocations are aligned like those of halide_malloc, and get some
+// slack at the end, so that vector loads may safely read a little past
+// the end of a buffer, as they may in compiled code.
+constexpr size_t kAllocationAlignment = 128;
+constexpr size_t kAllocationSlack = 64;
+
+// A lane of a value. Integers are kept sign- or zero-extended to 64 bits,
+// floats as doubles rounded to the precision of their type, and bools and
+// handles as unsigned integers.
+union Lane {
+    int64_t i;
+    uint64_t u;
+    double f;
+};
+
+// The value of an Expr. The interpreter applies each op to all the lanes
+// of its operands in one go, so a vectorized schedule runs in fewer,
+// larger steps than a scalar one.
+struct Value {
+    Type type;
+    vector<Lane> lanes;
+
+    Value() = default;
+    explicit Value(Type t)
+        : type(t), lanes(t.lanes()) {
+    }
+
+    int64_t as_int() const {
+        return type.is_float() ? (int64_t)lanes[0].f : lanes[0].i;
+    }
+
+    void *as_pointer() const {
+        return (void *)(uintptr_t)lanes[0].u;
+    }
+};
+
+// Wrap a lane into the range of a scalar type.
+Lane fix(const Type &t, Lane l) {
+    if (t.is_float()) {
+        if (t.bits() == 32) {
+            l.f = (float)l.f;
+        } else if (t.is_bfloat()) {
+            l.f = (double)bfloat16_t(l.f);
+        } else if (t.bits() == 16) {
+            l.f = (double)float16_t(l.f);
+        }
+    } else if (t.is_bool()) {
+        l.u = (l.u != 0);
+    } else if (t.bits() < 64) {
+        const int shift = 64 - t.bits();
+        if (t.is_int()) {
+            l.i = (int64_t)(l.u << shift) >> shift;
+        } else {
+            l.u = (l.u << shift) >> shift;
+        }
+    }
+    return l;
+}
+
+Value make_scalar(Type t, uint64_t bits) {
+    Value v(t);
+    v.lanes[0].u = bits;
+    v.lanes[0] = fix(t, v.lanes[0]);
+    return v;
+}
+
+Value make_pointer(Type t, const void *p) {
+    return make_scalar(t, (uint64_t)(uintptr_t)p);
+}
+
+Lane load_lane(const void *p, const Type &t) {
+    Lane l;
+    if (t.is_float()) {
+        if (t.bits() == 64) {
+            double d;
+            memcpy(&d, p, sizeof(d));
+            l.f = d;
+        } else if (t.bits() == 32) {
+            float f;
+            memcpy(&f, p, sizeof(f));
+            l.f = f;
+        } else {
+            uint16_t bits;
+            memcpy(&bits, p, sizeof(bits));
+            l.f = t.is_bfloat() ? (double)bfloat16_t::make_from_bits(bits) : (double)float16_t::make_from_bits(bits);
+        }
+        return l;
+    }
+    switch (t.bytes()) {
+    case 1: {
+        uint8_t x;
+        memcpy(&x, p, 1);
+        l.u = x;
+        break;
+    }
+    case 2: {
+        uint16_t x;
+        memcpy(&x, p, 2);
+        l.u = x;
+        break;
+    }
+    case 4: {
+        uint32_t x;
+        memcpy(&x, p, 4);
+        l.u = x;
+        break;
+    }
+    default:
+        internal_assert(t.bytes() == 8) << "Can't load a value of type " << t << "\n";
+        memcpy(&l.u, p, 8);
+    }
+    return fix(t, l);
+}
+
+void store_lane(void *p, const Type &t, Lane l) {
+    if (t.is_float()) {
+        if (t.bits() == 64) {
+            double d = l.f;
+            memcpy(p, &d, sizeof(d));
+        } else if (t.bits() == 32) {
+            float f = (float)l.f;
+            memcpy(p, &f, sizeof(f));
+        } else {
+            uint16_t bits = t.is_bfloat() ? bfloat16_t(l.f).to_bits() : float16_t(l.f).to_bits();
+            memcpy(p, &bits, sizeof(bits));
+        }
+        return;
+    }
+    switch (t.bytes()) {
+    case 1: {
+        uint8_t x = (uint8_t)l.u;
+        memcpy(p, &x, 1);
+        break;
+    }
+    case 2: {
+        uint16_t x = (uint16_t)l.u;
+        memcpy(p, &x, 2);
+        break;
+    }
+    case 4: {
+        uint32_t x = (uint32_t)l.u;
+        memcpy(p, &x, 4);
+        break;
+    }
+    default:
+        internal_assert(t.bytes() == 8) << "Can't store a value of type " << t << "\n";
+        memcpy(p, &l.u, 8);
+    }
+}
+
+Lane cast_lane(const Type &from, const Type &to, Lane l) {
+    Lane r;
+    if (to.is_float()) {
+        r.f = from.is_float() ? l.f : from.is_int() ? (double)l.i : (double)l.u;
+    } else if (from.is_float()) {
+        // Out-of-range conversions are undefined in Halide. Saturate them
+        // rather than invoking undefined behavior here too.
+        if (to.is_bool()) {
+            r.u = (l.f != 0);
+        } else if (std::isnan(l.f)) {
+            r.u = 0;
+        } else if (to.is_int()) {
+            r.i = l.f <= -0x1p63 ? INT64_MIN : l.f >= 0x1p63 ? INT64_MAX : (int64_t)l.f;
+        } else {
+            r.u = l.f <= -0x1p63 ? 0 : l.f < 0 ? (uint64_t)(int64_t)l.f : l.f >= 0x1p64 ? UINT64_MAX : (uint64_t)l.f;
+        }
+    } else if (to.is_bool()) {
+        r.u = (l.u != 0);
+    } else {
+        r = l;
+    }
+    return fix(to, r);
+}
+
+int64_t div_int(int64_t a, int64_t b) {
+    if (b == -1) {
+        return (int64_t)(0 - (uint64_t)a);
+    }
+    return div_imp(a, b);
+}
+
+int64_t mod_int(int64_t a, int64_t b) {
+    return b == -1 ? 0 : mod_imp(a, b);
+}
+
+int count_leading_zeros(uint64_t x, int bits) {
+    int n = 0;
+    for (int i = bits - 1; i >= 0 && !((x >> i) & 1); i--) {
+        n++;
+    }
+    return n;
+}
+
+int count_trailing_zeros(uint64_t x, int bits) {
+    int n = 0;
+    while (n < bits && !((x >> n) & 1)) {
+        n++;
+    }
+    return n;
+}
+
+int popcount(uint64_t x) {
+    int n = 0;
+    for (; x; x &= x - 1) {
+        n++;
+    }
+    return n;
+}
+
+// The arguments of a call to one of the halide_error_ functions of the
+// runtime, not counting the user_context.
+struct ErrorArgs {
+    const vector<Value> &args;
+
+    const char *s(int i) const {
+        return (const char *)args[i].as_pointer();
+    }
+    int64_t i(int i) const {
+        return args[i].lanes[0].i;
+    }
+    uint64_t u(int i) const {
+        return args[i].lanes[0].u;
+    }
+    double f(int i) const {
+        return args[i].lanes[0].f;
+    }
+    Type type(int i) const {
+        // Unpacks halide_type_t::as_u32()
+        const uint32_t bits = (uint32_t)args[i].lanes[0].u;
+        return Type((halide_type_code_t)(bits & 0xff), (bits >> 8) & 0xff, bits >> 16);
+    }
+};
+
+// Writes the message of the error and returns its error code, as the
+// function of the same name in runtime/errors.cpp does.
+using ErrorFormatter = int (*)(std::ostream &, const ErrorArgs &);
+
+const map<string, ErrorFormatter> &error_formatters() {
+    // clang-format off
+    static const map<string, ErrorFormatter> formatters = {
+        {"halide_error_bounds_inference_call_failed", [](std::ostream &s, const ErrorArgs &a) {
+            s << "Bounds inference call to external stage " << a.s(0) << " returned non-zero value: " << a.i(1);
+            return (int)a.i(1);
+        }},
+        {"halide_error_extern_stage_failed", [](std::ostream &s, const ErrorArgs &a) {
+            s << "Call to external stage " << a.s(0) << " returned non-zero value: " << a.i(1);
+            return (int)a.i(1);
+        }},
+        {"halide_error_explicit_bounds_too_small", [](std::ostream &s, const ErrorArgs &a) {
+            s << "Bounds given for " << a.s(1) << " in " << a.s(0)
+              << " (from " << a.i(2) << " to " << a.i(3)
+              << ") do not cover required region (from " << a.i(4) << " to " << a.i(5) << ")";
+            return (int)halide_error_code_explicit_bounds_too_small;
+        }},
+        {"halide_error_bad_type", [](std::ostream &s, const ErrorArgs &a) {
+            s << a.s(0) << " has type " << a.type(2) << " but type of the buffer passed in is " << a.type(1);
+            return (int)halide_error_code_bad_type;
+        }},
+        {"halide_error_bad_dimensions", [](std::ostream &s, const ErrorArgs &a) {
+            s << a.s(0) << " requires a buffer of exactly " << a.i(2)
+              << " dimensions, but the buffer passed in has " << a.i(1) << " dimensions";
+            return (int)halide_error_code_bad_dimensions;
+        }},
+        {"halide_error_access_out_of_bounds", [](std::ostream &s, const ErrorArgs &a) {
+            if (a.i(2) < a.i(4)) {
+                s << a.s(0) << " is accessed at " << a.i(2) << ", which is before the min ("
+                  << a.i(4) << ") in dimension " << a.i(1);
+            } else {
+                s << a.s(0) << " is accessed at " << a.i(3) << ", which is beyond the max ("
+                  << a.i(5) << ") in dimension " << a.i(1);
+            }
+            return (int)halide_error_code_access_out_of_bounds;
+        }},
+        {"halide_error_buffer_allocation_too_large", [](std::ostream &s, const ErrorArgs &a) {
+            s << "Total allocation for buffer " << a.s(0) << " is " << a.u(1)
+              << ", which exceeds the maximum size of " << a.u(2);
+            return (int)halide_error_code_buffer_allocation_too_large;
+        }},
+        {"halide_error_buffer_extents_negative", [](std::ostream &s, const ErrorArgs &a) {
+            s << "The extents for buffer " << a.s(0) << " dimension " << a.i(1)
+              << " is negative (" << a.i(2) << ")";
+            return (int)halide_error_code_buffer_extents_negative;
+        }},
+        {"halide_error_buffer_extents_too_large", [](std::ostream &s, const ErrorArgs &a) {
+            s << "Product of extents for buffer " << a.s(0) << " is " << a.i(1)
+              << ", which exceeds the maximum size of " << a.i(2);
+            return (int)halide_error_code_buffer_extents_too_large;
+        }},
+        {"halide_error_constraints_make_required_region_smaller", [](std::ostream &s, const ErrorArgs &a) {
+            s << "Applying the constraints on " << a.s(0)
+              << " to the required region made it smaller in dimension " << a.i(1) << ". "
+              << "Required size: " << a.i(4) << " to " << a.i(4) + a.i(5) - 1 << ". "
+              << "Constrained size: " << a.i(2) << " to " << a.i(2) + a.i(3) - 1 << ".";
+            return (int)halide_error_code_constraints_make_required_region_smaller;
+        }},
+        {"halide_error_constraint_violated", [](std::ostream &s, const ErrorArgs &a) {
+            s << "Constraint violated: " << a.s(0) << " (" << a.i(1) << ") == " << a.s(2) << " (" << a.i(3) << ")";
+            return (int)halide_error_code_constraint_violated;
+        }},
+        {"halide_error_param_too_small_i64", [](std::ostream &s, const ErrorArgs &a) {
+            s << "Parameter " << a.s(0) << " is " << a.i(1) << " but must be at least " << a.i(2);
+            return (int)halide_error_code_param_too_small;
+        }},
+        {"halide_error_param_too_small_u64", [](std::ostream &s, const ErrorArgs &a) {
+            s << "Parameter " << a.s(0) << " is " << a.u(1) << " but must be at least " << a.u(2);
+            return (int)halide_error_code_param_too_small;
+        }},
+        {"halide_error_param_too_small_f64", [](std::ostream &s, const ErrorArgs &a) {
+            s << "Parameter " << a.s(0) << " is " << a.f(1) << " but must be at least " << a.f(2);
+            return (int)halide_error_code_param_too_small;
+        }},
+        {"halide_error_param_too_large_i64", [](std::ostream &s, const ErrorArgs &a) {
+            s << "Parameter " << a.s(0) << " is " << a.i(1) << " but must be at most " << a.i(2);
+            return (int)halide_error_code_param_too_large;
+        }},
+        {"halide_error_param_too_large_u64", [](std::ostream &s, const ErrorArgs &a) {
+            s << "Parameter " << a.s(0) << " is " << a.u(1) << " but must be at most " << a.u(2);
+            return (int)halide_error_code_param_too_large;
+        }},
+        {"halide_error_param_too_large_f64", [](std::ostream &s, const ErrorArgs &a) {
+            s << "Parameter " << a.s(0) << " is " << a.f(1) << " but must be at most " << a.f(2);
+            return (int)halide_error_code_param_too_large;
+        }},
+        {"halide_error_out_of_memory", [](std::ostream &s, const ErrorArgs &a) {
+            s << "Out of memory (halide_malloc returned nullptr)";
+            return (int)halide_error_code_out_of_memory;
+        }},
+        {"halide_error_buffer_argument_is_null", [](std::ostream &s, const ErrorArgs &a) {
+            s << "Buffer argument " << a.s(0) << " is nullptr";
+            return (int)halide_error_code_buffer_argument_is_null;
+        }},
+        {"halide_error_unaligned_host_ptr", [](std::ostream &s, const ErrorArgs &a) {
+            s << "The host pointer of " << a.s(0) << " is not aligned to a " << a.i(1) << " bytes boundary.";
+            return (int)halide_error_code_unaligned_host_ptr;
+        }},
+        {"halide_error_device_dirty_with_no_device_support", [](std::ostream &s, const ErrorArgs &a) {
+            s << "The buffer " << a.s(0) << " is dirty on device, but this pipeline was compiled "
+              << "with no support for device to host copies.";
+            return (int)halide_error_code_device_dirty_with_no_device_support;
+        }},
+        {"halide_error_host_is_null", [](std::ostream &s, const ErrorArgs &a) {
+            s << "The host pointer of " << a.s(0) << " is null, but the pipeline will access it on the host.";
+            return (int)halide_error_code_host_is_null;
+        }},
+        {"halide_error_bad_fold", [](std::ostream &s, const ErrorArgs &a) {
+            s << "The folded storage dimension " << a.s(1) << " of " << a.s(0)
+              << " was accessed out of order by loop " << a.s(2) << ".";
+            return (int)halide_error_code_bad_fold;
+        }},
+        {"halide_error_fold_factor_too_small", [](std::ostream &s, const ErrorArgs &a) {
+            s << "The fold factor (" << a.i(2) << ") of dimension " << a.s(1) << " of " << a.s(0)
+              << " is too small to store the required region accessed by loop "
+              << a.s(3) << " (" << a.i(4) << ").";
+            return (int)halide_error_code_fold_factor_too_small;
+        }},
+        {"halide_error_requirement_failed", [](std::ostream &s, const ErrorArgs &a) {
+            s << "Requirement Failed: (" << a.s(0) << ") " << a.s(1);
+            return (int)halide_error_code_requirement_failed;
+        }},
+        {"halide_error_specialize_fail", [](std::ostream &s, const ErrorArgs &a) {
+            s << "A schedule specialized with specialize_fail() was chosen: " << a.s(0);
+            return (int)halide_error_code_specialize_fail;
+        }},
+        {"halide_error_storage_bound_too_small", [](std::ostream &s, const ErrorArgs &a) {
+            s << "The explicit allocation bound (" << a.i(2) << ") of dimension " << a.s(1) << " of " << a.s(0)
+              << " is too small to store the required region (" << a.i(3) << ").";
+            return (int)halide_error_code_storage_bound_too_small;
+        }},
+        {"halide_error_split_factor_not_positive", [](std::ostream &s, const ErrorArgs &a) {
+            s << "In schedule for func " << a.s(0) << ", the factor used to split the variable " << a.s(1)
+              << " into " << a.s(2) << " and " << a.s(3) << " is " << a.s(4)
+              << ". This evaluated to " << a.i(5) << ", which is not strictly positive. "
+              << "Consider using max(" << a.s(4) << ", 1) instead.";
+            return (int)halide_error_code_split_factor_not_positive;
+        }},
+    };
+    // clang-format on
+    return formatters;
+}
+
+// The functions of the runtime the interpreter implements itself.
+const std::set<string> &runtime_functions() {
+    static const std::set<string> names = {
+        "halide_arena_free",
+        "halide_arena_malloc",
+        "halide_can_use_target_features",
+        "halide_choose_size_variant",
+        "halide_current_time_ns",
+        "halide_do_par_for",
+        "halide_error",
+        "halide_free",
+        "halide_get_num_threads",
+        "halide_get_size_variant",
+        "halide_malloc",
+        "halide_mutex_array_create",
+        "halide_mutex_array_lock",
+        "halide_mutex_array_unlock",
+        "halide_print",
+        "halide_report_size_variant_time",
+    };
+    return names;
+}
+
+// The helpers for halide_buffer_t in runtime/halide_buffer_t.cpp, which
+// the interpreter also implements itself.
+const std::set<string> &buffer_helpers() {
+    static const std::set<string> names = {
+        Call::buffer_get_dimensions,
+        Call::buffer_get_host,
+        Call::buffer_get_device,
+        Call::buffer_get_device_interface,
+        Call::buffer_get_min,
+        Call::buffer_get_max,
+        Call::buffer_get_extent,
+        Call::buffer_get_stride,
+        Call::buffer_get_host_dirty,
+        Call::buffer_get_device_dirty,
+        Call::buffer_get_shape,
+        Call::buffer_get_type,
+        Call::buffer_set_host_dirty,
+        Call::buffer_set_device_dirty,
+        Call::buffer_is_bounds_query,
+        Call::buffer_init,
+        Call::buffer_init_from_buffer,
+        Call::buffer_crop,
+        Call::buffer_set_bounds,
+        "_halide_buffer_retire_crop_after_extern_stage",
+        "_halide_buffer_retire_crops_after_extern_stage",
+    };
+    return names;
+}
+
+// The math functions of IROperator.h, which are PureExtern calls
+// suffixed with the type they operate on.
+struct MathFunction {
+    double (*unary)(double) = nullptr;
+    double (*binary)(double, double) = nullptr;
+    bool (*test)(double) = nullptr;
+    double (*constant)() = nullptr;
+};
+
+const map<string, MathFunction> &math_functions() {
+    auto unary = [](double (*f)(double)) {
+        MathFunction m;
+        m.unary = f;
+        return m;
+    };
+    auto binary = [](double (*f)(double, double)) {
+        MathFunction m;
+        m.binary = f;
+        return m;
+    };
+    auto test = [](bool (*f)(double)) {
+        MathFunction m;
+        m.test = f;
+        return m;
+    };
+    auto constant = [](double (*f)()) {
+        MathFunction m;
+        m.constant = f;
+        return m;
+    };
+    // clang-format off
+    static const map<string, MathFunction> functions = {
+        {"sqrt", unary([](double x) { return std::sqrt(x); })},
+        {"sin", unary([](double x) { return std::sin(x); })},
+        {"cos", unary([](double x) { return std::cos(x); })},
+        {"tan", unary([](double x) { return std::tan(x); })},
+        {"asin", unary([](double x) { return std::asin(x); })},
+        {"acos", unary([](double x) { return std::acos(x); })},
+        {"atan", unary([](double x) { return std::atan(x); })},
+        {"sinh", unary([](double x) { return std::sinh(x); })},
+        {"cosh", unary([](double x) { return std::cosh(x); })},
+        {"tanh", unary([](double x) { return std::tanh(x); })},
+        {"asinh", unary([](double x) { return std::asinh(x); })},
+        {"acosh", unary([](double x) { return std::acosh(x); })},
+        {"atanh", unary([](double x) { return std::atanh(x); })},
+        {"exp", unary([](double x) { return std::exp(x); })},
+        {"log", unary([](double x) { return std::log(x); })},
+        {"floor", unary([](double x) { return std::floor(x); })},
+        {"ceil", unary([](double x) { return std::ceil(x); })},
+        {"trunc", unary([](double x) { return std::trunc(x); })},
+        {"fast_inverse", unary([](double x) { return 1 / x; })},
+        {"fast_inverse_sqrt", unary([](double x) { return 1 / std::sqrt(x); })},
+        {"pow", binary([](double x, double y) { return std::pow(x, y); })},
+        {"atan2", binary([](double y, double x) { return std::atan2(y, x); })},
+        {"is_nan", test([](double x) -> bool { return std::isnan(x); })},
+        {"is_inf", test([](double x) -> bool { return std::isinf(x); })},
+        {"is_finite", test([](double x) -> bool { return std::isfinite(x); })},
+        {"inf", constant([]() { return (double)INFINITY; })},
+        {"neg_inf", constant([]() { return -(double)INFINITY; })},
+        {"nan", constant([]() { return (double)NAN; })},
+    };
+    // clang-format on
+    return functions;
+}
+
+const MathFunction *find_math_function(const string &name) {
+    for (const char *suffix : {"_f16", "_f32", "_f64"}) {
+        if (ends_with(name, suffix)) {
+            const auto &functions = math_functions();
+            auto it = functions.find(name.substr(0, name.size() - 4));
+            return it == functions.end() ? nullptr : &it->second;
+        }
+    }
+    return nullptr;
+}
+
+// What a call to something other than an intrinsic does, worked out
+// once when the module is compiled rather than on each call.
+struct ExternCall {
+    enum Kind {
+        BufferHelper,
+        Error,
+        Math,
+        Runtime,
+        Function,
+    } kind;
+    ErrorFormatter error = nullptr;
+    const MathFunction *math = nullptr;
+    // The function called, for calls to functions in the module and to
+    // halide_do_par_for.
+    const LoweredFunc *function = nullptr;
+};
+
+// Lower the intrinsics that aren't worth implementing directly to
+// simpler IR, the same way the code generators do, and strip those that
+// only matter to optimization.
+class LowerForInterpreter : public IRMutator {
+    using IRMutator::visit;
+
+    const Target &target;
+
+    Expr visit(const Call *op) override {
+        if (op->is_intrinsic({Call::likely,
+                              Call::likely_if_innermost,
+                              Call::promise_clamped,
+                              Call::unsafe_promise_clamped,
+                              Call::strict_float,
+                              Call::nontemporal_store})) {
+            return mutate(op->args[0]);
+        } else if (op->is_intrinsic(Call::lerp)) {
+            internal_assert(op->args.size() == 3);
+            return mutate(lower_lerp(op->type, op->args[0], op->args[1], op->args[2], target));
+        } else if (op->is_intrinsic(Call::mux)) {
+            return mutate(lower_mux(op));
+        } else if (op->is_intrinsic(Call::extract_bits)) {
+            return mutate(lower_extract_bits(op));
+        } else if (op->is_intrinsic(Call::concat_bits)) {
+            return mutate(lower_concat_bits(op));
+        } else if (op->is_intrinsic()) {
+            Expr lowered = lower_intrinsic(op);
+            if (lowered.defined()) {
+                return mutate(lowered);
+            }
+        }
+        return IRMutator::visit(op);
+    }
+
+public:
+    LowerForInterpreter(const Target &target)
+        : target(target) {
+    }
+};
+
+}  // namespace
+
+struct InterpretedModuleContents {
+    mutable RefCount ref_count;
+
+    // The buffers embedded in the module, bound for all its functions.
+    vector<Buffer<>> buffers;
+    map<string, LoweredFunc> functions;
+    const LoweredFunc *main = nullptr;
+    vector<Argument> arguments;
+    std::unordered_map<const Call *, ExternCall> extern_calls;
+};
+
+template<>
+RefCount &ref_count<InterpretedModuleContents>(const InterpretedModuleContents *p) noexcept {
+    return p->ref_count;
+}
+
+template<>
+void destroy<InterpretedModuleContents>(const InterpretedModuleContents *p) {
+    delete p;
+}
+
+namespace {
+
+void unsupported(const string &what) {
+    user_error << "The IR interpreter (Target::JITInterp) can't run " << what
+               << ". Remove jit_interp from the target to JIT-compile the pipeline instead.\n";
+}
+
+// Works out what each call to something other than an intrinsic does,
+// and rejects anything in the module the interpreter can't run.
+class ResolveCalls : public IRVisitor {
+    using IRVisitor::visit;
+
+    const map<string, LoweredFunc> &functions;
+    std::unordered_map<const Call *, ExternCall> &extern_calls;
+
+    void visit(const Call *op) override {
+        IRVisitor::visit(op);
+        if (op->is_intrinsic()) {
+            if (!op->is_intrinsic({Call::abs,
+                                   Call::absd,
+                                   Call::alloca,
+                                   Call::bitwise_and,
+                                   Call::bitwise_not,
+                                   Call::bitwise_or,
+                                   Call::bitwise_xor,
+                                   Call::count_leading_zeros,
+                                   Call::count_trailing_zeros,
+                                   Call::div_round_to_zero,
+                                   Call::dynamic_shuffle,
+                                   Call::get_user_context,
+                                   Call::if_then_else,
+                                   Call::load_typed_struct_member,
+                                   Call::make_struct,
+                                   Call::mod_round_to_zero,
+                                   Call::popcount,
+                                   Call::prefetch,
+                                   Call::require,
+                                   Call::return_second,
+                                   Call::round,
+                                   Call::shift_left,
+                                   Call::shift_right,
+                                   Call::signed_integer_overflow,
+                                   Call::size_of_halide_buffer_t,
+                                   Call::store_fence,
+                                   Call::stringify,
+                                   Call::undef})) {
+                unsupported("the intrinsic " + op->name);
+            }
+            return;
+        }
+        internal_assert(op->call_type == Call::Extern ||
+                        op->call_type == Call::ExternCPlusPlus ||
+                        op->call_type == Call::PureExtern)
+            << "Unexpected call to " << op->name << " in lowered code\n";
+
+        ExternCall c;
+        auto error = error_formatters().find(op->name);
+        if (buffer_helpers().count(op->name)) {
+            c.kind = ExternCall::BufferHelper;
+        } else if (error != error_formatters().end()) {
+            c.kind = ExternCall::Error;
+            c.error = error->second;
+        } else if ((c.math = find_math_function(op->name))) {
+            c.kind = ExternCall::Math;
+        } else if (runtime_functions().count(op->name)) {
+            c.kind = ExternCall::Runtime;
+            if (op->name == "halide_do_par_for") {
+                const Variable *task = op->args[0].as<Variable>();
+                internal_assert(task && starts_with(task->name, "::"));
+                auto it = functions.find(task->name.substr(2));
+                internal_assert(it != functions.end()) << "Closure " << task->name << " not found\n";
+                c.function = &it->second;
+            }
+        } else if (functions.count(op->name)) {
+            c.kind = ExternCall::Function;
+            c.function = &functions.at(op->name);
+            internal_assert(c.function->args.size() == op->args.size());
+        } else {
+            unsupported("calls to the extern function " + op->name);
+        }
+        extern_calls[op] = c;
+    }
+
+    void visit(const For *op) override {
+        if (op->device_api != DeviceAPI::None && op->device_api != DeviceAPI::Host) {
+            unsupported("loops on the device API " + std::to_string((int)op->device_api));
+        }
+        IRVisitor::visit(op);
+    }
+
+    void visit(const Allocate *op) override {
+        if (!op->free_function.empty() &&
+            op->free_function != "halide_free" &&
+            op->free_function != "halide_arena_free" &&
+            op->free_function != "halide_mutex_array_destroy" &&
+            !ends_with(op->free_function, "_nop_free")) {
+            unsupported("allocations freed with " + op->free_function);
+        }
+        IRVisitor::visit(op);
+    }
+
+    void visit(const Fork *op) override {
+        unsupported("async producers");
+    }
+
+    void visit(const Acquire *op) override {
+        unsupported("async producers");
+    }
+
+public:
+    ResolveCalls(const map<string, LoweredFunc> &functions,
+                 std::unordered_map<const Call *, ExternCall> &extern_calls)
+        : functions(functions), extern_calls(extern_calls) {
+    }
+};
+
+class Interpreter : public IRVisitor {
+    using IRVisitor::visit;
+
+    const InterpretedModuleContents &module;
+
+    // The buffers embedded in the module, visible from all its functions.
+    Scope<Value> globals;
+    // The bindings of the function running.
+    Scope<Value> *scope = nullptr;
+
+    // The value of the Expr visited last.
+    Value value;
+
+    // The error code of the first failure in the function running,
+    // after which it does nothing more.
+    int exit_status = 0;
+
+    JITUserContext *user_context = nullptr;
+
+    // The memory for make_struct, alloca and stringify, which compiled
+    // code takes from the stack. Each iteration of a loop gives back
+    // what it took.
+    vector<std::unique_ptr<uint8_t[]>> stack;
+    // The fields of the structs made by make_struct, by address, for
+    // load_typed_struct_member.
+    std::unordered_map<const void *, vector<std::pair<size_t, Type>>> struct_layouts;
+
+    Value eval(const Expr &e) {
+        e.accept(this);
+        return std::move(value);
+    }
+
+    const Value &lookup(const string &name) const {
+        const Value *v = scope->find(name);
+        internal_assert(v) << "Symbol not found: " << name << "\n";
+        return *v;
+    }
+
+    void fail(int code) {
+        if (exit_status == 0) {
+            exit_status = code ? code : (int)halide_error_code_generic_error;
+        }
+    }
+
+    void report_error(const string &message) {
+        if (user_context && user_context->handlers.custom_error) {
+            user_context->handlers.custom_error(user_context, message.c_str());
+        } else {
+            std::cerr << "Error: " << message << "\n";
+        }
+    }
+
+    void print(const char *message) {
+        if (user_context && user_context->handlers.custom_print) {
+            user_context->handlers.custom_print(user_context, message);
+        } else {
+            std::cerr << message;
+        }
+    }
+
+    void *allocate(size_t bytes) {
+        bytes += kAllocationSlack;
+        if (user_context && user_context->handlers.custom_malloc) {
+            return user_context->handlers.custom_malloc(user_context, bytes);
+        }
+        return ::operator new(bytes, std::align_val_t(kAllocationAlignment), std::nothrow);
+    }
+
+    void deallocate(void *p) {
+        if (!p) {
+            return;
+        }
+        if (user_context && user_context->handlers.custom_malloc) {
+            if (user_context->handlers.custom_free) {
+                user_context->handlers.custom_free(user_context, p);
+            }
+        } else {
+            ::operator delete(p, std::align_val_t(kAllocationAlignment));
+        }
+    }
+
+    uint8_t *allocate_on_stack(size_t bytes) {
+        stack.emplace_back(new uint8_t[std::max<size_t>(bytes, 1)]());
+        return stack.back().get();
+    }
+
+    static bool all_true(const Value &v) {
+        for (const Lane &l : v.lanes) {
+            if (!l.u) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    static bool all_false(const Value &v) {
+        for (const Lane &l : v.lanes) {
+            if (l.u) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Apply an op to corresponding lanes of values of the same type, with
+    // separate versions for signed and unsigned ints and floats.
+    template<typename IntOp, typename UIntOp, typename FloatOp>
+    void arith(const Expr &a_expr, const Expr &b_expr, IntOp int_op, UIntOp uint_op, FloatOp float_op) {
+        Value a = eval(a_expr);
+        Value b = eval(b_expr);
+        const Type t = a.type.element_of();
+        for (size_t i = 0; i < a.lanes.size(); i++) {
+            Lane &x = a.lanes[i];
+            const Lane &y = b.lanes[i];
+            if (t.is_float()) {
+                x.f = float_op(x.f, y.f);
+            } else if (t.is_int()) {
+                x.i = int_op(x.i, y.i);
+            } else {
+                x.u = uint_op(x.u, y.u);
+            }
+            x = fix(t, x);
+        }
+        value = std::move(a);
+    }
+
+    template<typename Cmp>
+    void compare(const Expr &a_expr, const Expr &b_expr, const Type &type, Cmp cmp) {
+        Value a = eval(a_expr);
+        Value b = eval(b_expr);
+        const Type t = a.type.element_of();
+        Value r(type);
+        for (size_t i = 0; i < r.lanes.size(); i++) {
+            const Lane &x = a.lanes[i], &y = b.lanes[i];
+            r.lanes[i].u = (t.is_float() ? cmp(x.f, y.f) :
+                            t.is_int()   ? cmp(x.i, y.i) :
+                                           cmp(x.u, y.u));
+        }
+        value = std::move(r);
+    }
+
+    // Apply a function of lanes to each lane of a value, and wrap the
+    // results to the given type.
+    template<typename F>
+    static Value map_lanes(const Type &type, const Value &a, F f) {
+        const Type t = type.element_of();
+        Value r(type);
+        for (size_t i = 0; i < r.lanes.size(); i++) {
+            r.lanes[i] = fix(t, f(a.lanes[i]));
+        }
+        return r;
+    }
+
+    template<typename F>
+    static Value zip_lanes(const Type &type, const Value &a, const Value &b, F f) {
+        const Type t = type.element_of();
+        Value r(type);
+        for (size_t i = 0; i < r.lanes.size(); i++) {
+            r.lanes[i] = fix(t, f(a.lanes[i], b.lanes[i]));
+        }
+        return r;
+    }
+
+    static Lane combine(VectorReduce::Operator op, const Type &t, Lane a, Lane b) {
+        Lane r;
+        switch (op) {
+        case VectorReduce::Add:
+            if (t.is_float()) {
+                r.f = a.f + b.f;
+            } else {
+                r.u = a.u + b.u;
+            }
+            break;
+        case VectorReduce::SaturatingAdd:
+            if (t.is_float()) {
+                r.f = a.f + b.f;
+            } else if (t.is_int()) {
+                const int64_t max = t.bits() == 64 ? INT64_MAX : ((int64_t)1 << (t.bits() - 1)) - 1;
+                const int64_t min = -max - 1;
+                if (b.i > 0 && a.i > max - b.i) {
+                    r.i = max;
+                } else if (b.i < 0 && a.i < min - b.i) {
+                    r.i = min;
+                } else {
+                    r.i = a.i + b.i;
+                }
+            } else {
+                const uint64_t max = t.bits() == 64 ? UINT64_MAX : ((uint64_t)1 << t.bits()) - 1;
+                r.u = (a.u > max - b.u) ? max : a.u + b.u;
+            }
+            break;
+        case VectorReduce::Mul:
+            if (t.is_float()) {
+                r.f = a.f * b.f;
+            } else {
+                r.u = a.u * b.u;
+            }
+            break;
+        case VectorReduce::Min:
+            r = (t.is_float() ? a.f < b.f : t.is_int() ? a.i < b.i : a.u < b.u) ? a : b;
+            break;
+        case VectorReduce::Max:
+            r = (t.is_float() ? a.f > b.f : t.is_int() ? a.i > b.i : a.u > b.u) ? a : b;
+            break;
+        case VectorReduce::And:
+            r.u = a.u & b.u;
+            break;
+        case VectorReduce::Or:
+            r.u = a.u | b.u;
+            break;
+        }
+        return fix(t, r);
+    }
+
+    void visit(const IntImm *op) override {
+        value = make_scalar(op->type, (uint64_t)op->value);
+    }
+
+    void visit(const UIntImm *op) override {
+        value = make_scalar(op->type, op->value);
+    }
+
+    void visit(const FloatImm *op) override {
+        value = Value(op->type);
+        value.lanes[0].f = op->value;
+    }
+
+    void visit(const StringImm *op) override {
+        value = make_pointer(op->type, op->value.c_str());
+    }
+
+    void visit(const Cast *op) override {
+        Value a = eval(op->value);
+        const Type from = a.type.element_of(), to = op->type.element_of();
+        for (Lane &l : a.lanes) {
+            l = cast_lane(from, to, l);
+        }
+        a.type = op->type;
+        value = std::move(a);
+    }
+
+    void visit(const Reinterpret *op) override {
+        Value a = eval(op->value);
+        const Type from = a.type.element_of(), to = op->type.element_of();
+        vector<uint8_t> bytes(a.lanes.size() * from.bytes());
+        for (size_t i = 0; i < a.lanes.size(); i++) {
+            store_lane(bytes.data() + i * from.bytes(), from, a.lanes[i]);
+        }
+        Value r(op->type);
+        for (size_t i = 0; i < r.lanes.size(); i++) {
+            r.lanes[i] = load_lane(bytes.data() + i * to.bytes(), to);
+        }
+        value = std::move(r);
+    }
+
+    void visit(const Variable *op) override {
+        value = lookup(op->name);
+    }
+
+    void visit(const Add *op) override {
+        arith(
+            op->a, op->b,
+            [](int64_t a, int64_t b) { return (int64_t)((uint64_t)a + (uint64_t)b); },
+            [](uint64_t a, uint64_t b) { return a + b; },
+            [](double a, double b) { return a + b; });
+    }
+
+    void visit(const Sub *op) override {
+        arith(
+            op->a, op->b,
+            [](int64_t a, int64_t b) { return (int64_t)((uint64_t)a - (uint64_t)b); },
+            [](uint64_t a, uint64_t b) { return a - b; },
+            [](double a, double b) { return a - b; });
+    }
+
+    void visit(const Mul *op) override {
+        arith(
+            op->a, op->b,
+            [](int64_t a, int64_t b) { return (int64_t)((uint64_t)a * (uint64_t)b); },
+            [](uint64_t a, uint64_t b) { return a * b; },
+            [](double a, double b) { return a * b; });
+    }
+
+    void visit(const Div *op) override {
+        arith(
+            op->a, op->b,
+            div_int,
+            [](uint64_t a, uint64_t b) { return b ? a / b : 0; },
+            [](double a, double b) { return a / b; });
+    }
+
+    void visit(const Mod *op) override {
+        const bool is_f32 = op->type.is_float() && op->type.bits() <= 32;
+        arith(
+            op->a, op->b,
+            mod_int,
+            [](uint64_t a, uint64_t b) { return b ? a % b : 0; },
+            [=](double a, double b) { return is_f32 ? (double)mod_imp((float)a, (float)b) : mod_imp(a, b); });
+    }
+
+    void visit(const Min *op) override {
+        auto min = [](auto a, auto b) { return a < b ? a : b; };
+        arith(op->a, op->b, min, min, min);
+    }
+
+    void visit(const Max *op) override {
+        auto max = [](auto a, auto b) { return a > b ? a : b; };
+        arith(op->a, op->b, max, max, max);
+    }
+
+    void visit(const EQ *op) override {
+        compare(op->a, op->b, op->type, [](auto a, auto b) { return a == b; });
+    }
+
+    void visit(const NE *op) override {
+        compare(op->a, op->b, op->type, [](auto a, auto b) { return a != b; });
+    }
+
+    void visit(const LT *op) override {
+        compare(op->a, op->b, op->type, [](auto a, auto b) { return a < b; });
+    }
+
+    void visit(const LE *op) override {
+        compare(op->a, op->b, op->type, [](auto a, auto b) { return a <= b; });
+    }
+
+    void visit(const GT *op) override {
+        compare(op->a, op->b, op->type, [](auto a, auto b) { return a > b; });
+    }
+
+    void visit(const GE *op) override {
+        compare(op->a, op->b, op->type, [](auto a, auto b) { return a >= b; });
+    }
+
+    void visit(const And *op) override {
+        compare(op->a, op->b, op->type, [](auto a, auto b) { return a && b; });
+    }
+
+    void visit(const Or *op) override {
+        compare(op->a, op->b, op->type, [](auto a, auto b) { return a || b; });
+    }
+
+    void visit(const Not *op) override {
+        Value a = eval(op->a);
+        for (Lane &l : a.lanes) {
+            l.u = !l.u;
+        }
+        value = std::move(a);
+    }
+
+    void visit(const Select *op) override {
+        Value c = eval(op->condition);
+        Value t = eval(op->true_value);
+        Value f = eval(op->false_value);
+        for (size_t i = 0; i < t.lanes.size(); i++) {
+            if (!c.lanes[c.lanes.size() == 1 ? 0 : i].u) {
+                t.lanes[i] = f.lanes[i];
+            }
+        }
+        value = std::move(t);
+    }
+
+    void visit(const Load *op) override {
+        Value index = eval(op->index);
+        Value predicate = eval(op->predicate);
+        const Type t = op->type.element_of();
+        const uint8_t *base = (const uint8_t *)lookup(op->name).as_pointer();
+        Value r(op->type);
+        for (size_t i = 0; i < r.lanes.size(); i++) {
+            if (predicate.lanes[i].u) {
+                r.lanes[i] = load_lane(base + index.lanes[i].i * t.bytes(), t);
+            } else {
+                r.lanes[i].u = 0;
+            }
+        }
+        value = std::move(r);
+    }
+
+    void visit(const Ramp *op) override {
+        Value base = eval(op->base);
+        Value stride = eval(op->stride);
+        const Type t = op->type.element_of();
+        const size_t n = base.lanes.size();
+        Value r(op->type);
+        for (int j = 0; j < op->lanes; j++) {
+            for (size_t k = 0; k < n; k++) {
+                Lane l;
+                if (t.is_float()) {
+                    Lane step;
+                    step.f = j * stride.lanes[k].f;
+                    l.f = base.lanes[k].f + fix(t, step).f;
+                } else {
+                    l.u = base.lanes[k].u + (uint64_t)j * stride.lanes[k].u;
+                }
+                r.lanes[j * n + k] = fix(t, l);
+            }
+        }
+        value = std::move(r);
+    }
+
+    void visit(const Broadcast *op) override {
+        Value a = eval(op->value);
+        Value r(op->type);
+        const size_t n = a.lanes.size();
+        for (size_t i = 0; i < r.lanes.size(); i++) {
+            r.lanes[i] = a.lanes[i % n];
+        }
+        value = std::move(r);
+    }
+
+    void visit(const Shuffle *op) override {
+        vector<Lane> lanes;
+        for (const Expr &e : op->vectors) {
+            Value v = eval(e);
+            lanes.insert(lanes.end(), v.lanes.begin(), v.lanes.end());
+        }
+        Value r(op->type);
+        for (size_t i = 0; i < op->indices.size(); i++) {
+            r.lanes[i] = lanes[op->indices[i]];
+        }
+        value = std::move(r);
+    }
+
+    void visit(const VectorReduce *op) override {
+        Value a = eval(op->value);
+        const Type t = op->type.element_of();
+        Value r(op->type);
+        const size_t factor = a.lanes.size() / r.lanes.size();
+        for (size_t i = 0; i < r.lanes.size(); i++) {
+            Lane acc = a.lanes[i * factor];
+            for (size_t j = 1; j < factor; j++) {
+                acc = combine(op->op, t, acc, a.lanes[i * factor + j]);
+            }
+            r.lanes[i] = acc;
+        }
+        value = std::move(r);
+    }
+
+    void visit(const Let *op) override {
+        ScopedBinding<Value> bind(*scope, op->name, eval(op->value));
+        op->body.accept(this);
+    }
+
+    void visit(const Call *op) override {
+        if (op->is_intrinsic()) {
+            visit_intrinsic(op);
+        } else {
+            visit_extern(op);
+        }
+    }
+
+    void visit_intrinsic(const Call *op) {
+        if (op->is_intrinsic(Call::abs)) {
+            Value a = eval(op->args[0]);
+            const Type t = a.type.element_of();
+            value = map_lanes(op->type, a, [&](Lane l) {
+                if (t.is_float()) {
+                    l.f = std::fabs(l.f);
+                } else if (t.is_int() && l.i < 0) {
+                    l.u = 0 - l.u;
+                }
+                return l;
+            });
+        } else if (op->is_intrinsic(Call::absd)) {
+            Value a = eval(op->args[0]);
+            Value b = eval(op->args[1]);
+            const Type t = a.type.element_of();
+            value = zip_lanes(op->type, a, b, [&](Lane x, Lane y) {
+                Lane l;
+                if (t.is_float()) {
+                    l.f = std::fabs(x.f - y.f);
+                } else {
+                    const bool less = t.is_int() ? x.i < y.i : x.u < y.u;
+                    l.u = less ? y.u - x.u : x.u - y.u;
+                }
+                return l;
+            });
+        } else if (op->is_intrinsic({Call::bitwise_and, Call::bitwise_or, Call::bitwise_xor})) {
+            Value a = eval(op->args[0]);
+            Value b = eval(op->args[1]);
+            const bool is_and = op->is_intrinsic(Call::bitwise_and);
+            const bool is_or = op->is_intrinsic(Call::bitwise_or);
+            value = zip_lanes(op->type, a, b, [&](Lane x, Lane y) {
+                x.u = is_and ? x.u & y.u : is_or ? x.u | y.u : x.u ^ y.u;
+                return x;
+            });
+        } else if (op->is_intrinsic(Call::bitwise_not)) {
+            value = map_lanes(op->type, eval(op->args[0]), [](Lane l) {
+                l.u = ~l.u;
+                return l;
+            });
+        } else if (op->is_intrinsic({Call::shift_left, Call::shift_right})) {
+            // A negative shift goes the other way.
+            Value a = eval(op->args[0]);
+            Value b = eval(op->args[1]);
+            const Type t = a.type.element_of();
+            const bool signed_shift = b.type.is_int();
+            const bool shift_left = op->is_intrinsic(Call::shift_left);
+            value = zip_lanes(op->type, a, b, [&](Lane x, Lane y) {
+                int64_t s = signed_shift ? y.i : (int64_t)std::min<uint64_t>(y.u, 64);
+                bool left = shift_left;
+                if (s < 0) {
+                    left = !left;
+                    s = -s;
+                }
+                if (left) {
+                    x.u = s >= 64 ? 0 : x.u << s;
+                } else if (t.is_int()) {
+                    x.i = x.i >> std::min<int64_t>(s, 63);
+                } else {
+                    x.u = s >= 64 ? 0 : x.u >> s;
+                }
+                return x;
+            });
+        } else if (op->is_intrinsic({Call::count_leading_zeros, Call::count_trailing_zeros, Call::popcount})) {
+            Value a = eval(op->args[0]);
+            const int bits = a.type.bits();
+            const uint64_t mask = bits == 64 ? UINT64_MAX : ((uint64_t)1 << bits) - 1;
+            value = map_lanes(op->type, a, [&](Lane l) {
+                const uint64_t x = l.u & mask;
+                l.u = (op->is_intrinsic(Call::count_leading_zeros)  ? count_leading_zeros(x, bits) :
+                       op->is_intrinsic(Call::count_trailing_zeros) ? count_trailing_zeros(x, bits) :
+                                                                      popcount(x));
+                return l;
+            });
+        } else if (op->is_intrinsic({Call::div_round_to_zero, Call::mod_round_to_zero})) {
+            Value a = eval(op->args[0]);
+            Value b = eval(op->args[1]);
+            const bool is_int = a.type.is_int();
+            const bool div = op->is_intrinsic(Call::div_round_to_zero);
+            value = zip_lanes(op->type, a, b, [&](Lane x, Lane y) {
+                Lane l;
+                if (y.u == 0) {
+                    l.u = 0;
+                } else if (is_int && y.i == -1) {
+                    l.u = div ? 0 - x.u : 0;
+                } else if (is_int) {
+                    l.i = div ? x.i / y.i : x.i % y.i;
+                } else {
+                    l.u = div ? x.u / y.u : x.u % y.u;
+                }
+                return l;
+            });
+        } else if (op->is_intrinsic(Call::if_then_else)) {
+            // Only evaluate the side that's needed, as the other may load
+            // out of bounds.
+            Value c = eval(op->args[0]);
+            auto otherwise = [&]() {
+                return op->args.size() > 2 ? eval(op->args[2]) : Value(op->type);
+            };
+            if (all_true(c)) {
+                value = eval(op->args[1]);
+            } else if (all_false(c)) {
+                value = otherwise();
+            } else {
+                Value t = eval(op->args[1]);
+                Value f = otherwise();
+                for (size_t i = 0; i < t.lanes.size(); i++) {
+                    if (!c.lanes[i].u) {
+                        t.lanes[i] = f.lanes[i];
+                    }
+                }
+                value = std::move(t);
+            }
+        } else if (op->is_intrinsic(Call::return_second)) {
+            eval(op->args[0]);
+            value = eval(op->args[1]);
+        } else if (op->is_intrinsic(Call::require)) {
+            Value c = eval(op->args[0]);
+            Value v = eval(op->args[1]);
+            if (!all_true(c)) {
+                fail((int)eval(op->args[2]).as_int());
+            }
+            value = std::move(v);
+        } else if (op->is_intrinsic(Call::round)) {
+            value = map_lanes(op->type, eval(op->args[0]), [](Lane l) {
+                l.f = std::nearbyint(l.f);
+                return l;
+            });
+        } else if (op->is_intrinsic(Call::dynamic_shuffle)) {
+            Value v = eval(op->args[0]);
+            Value idx = eval(op->args[1]);
+            Value r(op->type);
+            for (size_t i = 0; i < r.lanes.size(); i++) {
+                int64_t j = std::min<int64_t>(std::max<int64_t>(idx.lanes[i].i, 0), v.lanes.size() - 1);
+                r.lanes[i] = v.lanes[j];
+            }
+            value = std::move(r);
+        } else if (op->is_intrinsic(Call::make_struct)) {
+            internal_assert(op->type.is_scalar()) << "The interpreter can't make vectors of structs\n";
+            vector<Value> fields;
+            for (const Expr &e : op->args) {
+                fields.push_back(eval(e));
+            }
+            value = make_pointer(op->type, fields.empty() ? nullptr : make_struct(fields));
+        } else if (op->is_intrinsic(Call::load_typed_struct_member)) {
+            internal_assert(op->args.size() == 3);
+            const uint8_t *instance = (const uint8_t *)eval(op->args[0]).as_pointer();
+            const void *prototype = eval(op->args[1]).as_pointer();
+            const int64_t idx = eval(op->args[2]).as_int();
+            size_t offset = 0;
+            auto it = struct_layouts.find(prototype);
+            if (it != struct_layouts.end()) {
+                internal_assert(idx >= 0 && idx < (int64_t)it->second.size());
+                offset = it->second[idx].first;
+            } else {
+                // The struct is actually just a scalar
+                internal_assert(idx == 0);
+            }
+            const Type t = op->type.element_of();
+            Value r(op->type);
+            for (size_t i = 0; i < r.lanes.size(); i++) {
+                r.lanes[i] = load_lane(instance + offset + i * t.bytes(), t);
+            }
+            value = std::move(r);
+        } else if (op->is_intrinsic(Call::alloca)) {
+            value = make_pointer(op->type, allocate_on_stack(eval(op->args[0]).as_int()));
+        } else if (op->is_intrinsic(Call::size_of_halide_buffer_t)) {
+            value = make_scalar(op->type, sizeof(halide_buffer_t));
+        } else if (op->is_intrinsic(Call::get_user_context)) {
+            value = make_pointer(op->type, user_context);
+        } else if (op->is_intrinsic(Call::stringify)) {
+            const string s = stringify(op->args);
+            uint8_t *buf = allocate_on_stack(s.size() + 1);
+            memcpy(buf, s.c_str(), s.size() + 1);
+            value = make_pointer(op->type, buf);
+        } else if (op->is_intrinsic({Call::prefetch, Call::store_fence, Call::signed_integer_overflow, Call::undef})) {
+            // Prefetches and fences do nothing here, and undefined values
+            // may as well be zero.
+            value = Value(op->type);
+        } else {
+            internal_error << "Unsupported intrinsic " << op->name << "\n";
+        }
+    }
+
+    uint8_t *make_struct(const vector<Value> &fields) {
+        // Lay the fields out as a C compiler would.
+        vector<std::pair<size_t, Type>> layout;
+        size_t size = 0;
+        for (const Value &f : fields) {
+            const size_t alignment = f.type.bytes();
+            size = (size + alignment - 1) / alignment * alignment;
+            layout.emplace_back(size, f.type);
+            size += f.type.bytes() * f.type.lanes();
+        }
+        uint8_t *p = allocate_on_stack(size);
+        for (size_t i = 0; i < fields.size(); i++) {
+            const Type t = fields[i].type.element_of();
+            for (size_t j = 0; j < fields[i].lanes.size(); j++) {
+                store_lane(p + layout[i].first + j * t.bytes(), t, fields[i].lanes[j]);
+            }
+        }
+        struct_layouts[p] = std::move(layout);
+        return p;
+    }
+
+    string stringify(const vector<Expr> &args) {
+        std::ostringstream s;
+        for (const Expr &e : args) {
+            if (const StringImm *str = e.as<StringImm>()) {
+                s << str->value;
+                continue;
+            }
+            Value v = eval(e);
+            internal_assert(v.type.is_scalar()) << "The interpreter can't stringify vectors\n";
+            const Lane &l = v.lanes[0];
+            if (v.type.is_bool()) {
+                s << (l.u ? "true" : "false");
+            } else if (v.type.is_int()) {
+                s << l.i;
+            } else if (v.type.is_uint()) {
+                s << l.u;
+            } else if (v.type.is_float()) {
+                // Doubles are printed in scientific notation, as by codegen.
+                char buf[64];
+                snprintf(buf, sizeof(buf), v.type.bits() == 64 ? "%e" : "%f", l.f);
+                s << buf;
+            } else {
+                s << v.as_pointer();
+            }
+        }
+        return s.str();
+    }
+
+    void visit_extern(const Call *op) {
+        auto it = module.extern_calls.find(op);
+        internal_assert(it != module.extern_calls.end()) << "Unresolved call to " << op->name << "\n";
+        const ExternCall &c = it->second;
+        if (c.kind == ExternCall::Math) {
+            math(op, *c.math);
+            return;
+        } else if (op->name == "halide_do_par_for") {
+            par_for(op, *c.function);
+            return;
+        }
+
+        vector<Value> args;
+        for (const Expr &e : op->args) {
+            args.push_back(eval(e));
+        }
+        switch (c.kind) {
+        case ExternCall::BufferHelper:
+            value = buffer_helper(op, args);
+            break;
+        case ExternCall::Error: {
+            std::ostringstream message;
+            const int code = c.error(message, ErrorArgs{args});
+            report_error(message.str());
+            value = make_scalar(op->type, (uint64_t)(int64_t)code);
+            break;
+        }
+        case ExternCall::Runtime:
+            value = runtime_function(op, args);
+            break;
+        case ExternCall::Function:
+            value = make_scalar(op->type, (uint64_t)(int64_t)call(*c.function, args));
+            break;
+        case ExternCall::Math:
+            break;
+        }
+    }
+
+    void math(const Call *op, const MathFunction &f) {
+        const Type t = op->type.element_of();
+        Value r(op->type);
+        if (f.constant) {
+            for (Lane &l : r.lanes) {
+                l.f = f.constant();
+            }
+        } else {
+            Value a = eval(op->args[0]);
+            Value b;
+            if (f.binary) {
+                b = eval(op->args[1]);
+            }
+            for (size_t i = 0; i < r.lanes.size(); i++) {
+                Lane &l = r.lanes[i];
+                const double x = a.lanes[i].f;
+                if (f.test) {
+                    l.u = f.test(x);
+                } else if (f.unary) {
+                    l.f = f.unary(x);
+                } else {
+                    l.f = f.binary(x, b.lanes[i].f);
+                }
+            }
+        }
+        for (Lane &l : r.lanes) {
+            l = fix(t, l);
+        }
+        value = std::move(r);
+    }
+
+    void par_for(const Call *op, const LoweredFunc &task) {
+        // Parallel loops run serially, in order.
+        internal_assert(op->args.size() == 4);
+        const int64_t min = eval(op->args[1]).as_int();
+        const int64_t extent = eval(op->args[2]).as_int();
+        vector<Value> args = {make_pointer(Handle(), user_context),
+                              make_scalar(Int(32), 0),
+                              eval(op->args[3])};
+        int result = 0;
+        for (int64_t i = min; i < min + extent && result == 0; i++) {
+            args[1].lanes[0].i = i;
+            result = call(task, args);
+        }
+        value = make_scalar(op->type, (uint64_t)(int64_t)result);
+    }
+
+    Value runtime_function(const Call *op, const vector<Value> &args) {
+        const string &name = op->name;
+        int64_t result = 0;
+        if (name == "halide_print") {
+            print((const char *)args[0].as_pointer());
+        } else if (name == "halide_error") {
+            report_error((const char *)args[0].as_pointer());
+            result = halide_error_code_generic_error;
+        } else if (name == "halide_malloc" || name == "halide_arena_malloc") {
+            return make_pointer(op->type, allocate(args[0].lanes[0].u));
+        } else if (name == "halide_free" || name == "halide_arena_free") {
+            deallocate(args[0].as_pointer());
+        } else if (name == "halide_current_time_ns") {
+            result = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                         std::chrono::steady_clock::now().time_since_epoch())
+                         .count();
+        } else if (name == "halide_get_num_threads") {
+            result = 1;
+        } else if (name == "halide_mutex_array_create") {
+            // Everything runs on one thread, so locks do nothing, and a
+            // mutex array only needs to be non-null.
+            static uint8_t mutexes;
+            return make_pointer(op->type, &mutexes);
+        }
+        // The rest are halide_mutex_array_lock and _unlock, and the
+        // functions that choose variants: the interpreter always picks
+        // the first size variant, and the fallback of target feature
+        // specializations.
+        return make_scalar(op->type, (uint64_t)result);
+    }
+
+    Value buffer_helper(const Call *op, const vector<Value> &args) {
+        const string &name = op->name;
+        halide_buffer_t *buf = (halide_buffer_t *)args[0].as_pointer();
+        auto arg = [&](int i) { return args[i].lanes[0].i; };
+        auto ptr = [&](int i) { return args[i].as_pointer(); };
+        uint64_t result = 0;
+        if (name == Call::buffer_get_dimensions) {
+            result = buf->dimensions;
+        } else if (name == Call::buffer_get_host) {
+            result = (uintptr_t)buf->host;
+        } else if (name == Call::buffer_get_device) {
+            result = buf->device;
+        } else if (name == Call::buffer_get_device_interface) {
+            result = (uintptr_t)buf->device_interface;
+        } else if (name == Call::buffer_get_min) {
+            result = (int64_t)buf->dim[arg(1)].min;
+        } else if (name == Call::buffer_get_max) {
+            result = (int64_t)buf->dim[arg(1)].min + buf->dim[arg(1)].extent - 1;
+        } else if (name == Call::buffer_get_extent) {
+            result = (int64_t)buf->dim[arg(1)].extent;
+        } else if (name == Call::buffer_get_stride) {
+            result = (int64_t)buf->dim[arg(1)].stride;
+        } else if (name == Call::buffer_get_host_dirty) {
+            result = buf->host_dirty();
+        } else if (name == Call::buffer_get_device_dirty) {
+            result = buf->device_dirty();
+        } else if (name == Call::buffer_get_shape) {
+            result = (uintptr_t)buf->dim;
+        } else if (name == Call::buffer_get_type) {
+            result = buf->type.as_u32();
+        } else if (name == Call::buffer_set_host_dirty) {
+            buf->set_host_dirty(arg(1) != 0);
+        } else if (name == Call::buffer_set_device_dirty) {
+            buf->set_device_dirty(arg(1) != 0);
+        } else if (name == Call::buffer_is_bounds_query) {
+            result = buf->is_bounds_query();
+        } else if (name == Call::buffer_init) {
+            const int dimensions = (int)arg(7);
+            const halide_dimension_t *shape = (const halide_dimension_t *)ptr(8);
+            buf->host = (uint8_t *)ptr(2);
+            buf->device = args[3].lanes[0].u;
+            buf->device_interface = (const halide_device_interface_t *)ptr(4);
+            buf->type.code = (halide_type_code_t)arg(5);
+            buf->type.bits = (uint8_t)arg(6);
+            buf->type.lanes = 1;
+            buf->dimensions = dimensions;
+            buf->dim = (halide_dimension_t *)ptr(1);
+            if (shape != buf->dim) {
+                for (int i = 0; i < dimensions; i++) {
+                    buf->dim[i] = shape[i];
+                }
+            }
+            buf->flags = args[9].lanes[0].u;
+            result = (uintptr_t)buf;
+        } else if (name == Call::buffer_init_from_buffer) {
+            const halide_buffer_t *src = (const halide_buffer_t *)ptr(2);
+            halide_dimension_t *shape = (halide_dimension_t *)ptr(1);
+            *buf = *src;
+            buf->dim = shape;
+            for (int i = 0; i < src->dimensions; i++) {
+                buf->dim[i] = src->dim[i];
+            }
+            result = (uintptr_t)buf;
+        } else if (name == Call::buffer_crop) {
+            const halide_buffer_t *src = (const halide_buffer_t *)ptr(2);
+            const int *min = (const int *)ptr(3);
+            const int *extent = (const int *)ptr(4);
+            if (src->device_interface) {
+                unsupported("crops of buffers on a device");
+            }
+            *buf = *src;
+            buf->dim = (halide_dimension_t *)ptr(1);
+            int64_t offset = 0;
+            for (int i = 0; i < buf->dimensions; i++) {
+                buf->dim[i] = src->dim[i];
+                buf->dim[i].min = min[i];
+                buf->dim[i].extent = extent[i];
+                offset += (min[i] - src->dim[i].min) * (int64_t)src->dim[i].stride;
+            }
+            if (buf->host) {
+                buf->host += offset * src->type.bytes();
+            }
+            result = (uintptr_t)buf;
+        } else if (name == Call::buffer_set_bounds) {
+            if (buf) {
+                buf->dim[arg(1)].min = (int32_t)arg(2);
+                buf->dim[arg(1)].extent = (int32_t)arg(3);
+            }
+            result = (uintptr_t)buf;
+        } else {
+            // Retiring crops made for extern stages. Without devices, all
+            // that's left to do is to pass on the host dirty bits.
+            halide_buffer_t **buffers = (halide_buffer_t **)ptr(0);
+            const bool all = name == "_halide_buffer_retire_crops_after_extern_stage";
+            for (; buffers[0]; buffers += 2) {
+                if (buffers[0]->host_dirty()) {
+                    buffers[1]->set_host_dirty();
+                }
+                if (!all) {
+                    break;
+                }
+            }
+        }
+        return make_scalar(op->type, result);
+    }
+
+    void visit(const LetStmt *op) override {
+        if (exit_status) {
+            return;
+        }
+        ScopedBinding<Value> bind(*scope, op->name, eval(op->value));
+        op->body.accept(this);
+    }
+
+    void visit(const AssertStmt *op) override {
+        if (exit_status) {
+            return;
+        }
+        if (!all_true(eval(op->condition))) {
+            fail((int)eval(op->message).as_int());
+        }
+    }
+
+    void visit(const ProducerConsumer *op) override {
+        op->body.accept(this);
+    }
+
+    void visit(const For *op) override {
+        if (exit_status) {
+            return;
+        }
+        const int64_t min = eval(op->min).as_int();
+        const int64_t extent = eval(op->extent).as_int();
+        ScopedBinding<Value> bind(*scope, op->name, make_scalar(op->min.type(), 0));
+        Value *loop_var = scope->shallow_find(op->name);
+        const size_t stack_size = stack.size();
+        for (int64_t i = min; i < min + extent && !exit_status; i++) {
+            loop_var->lanes[0].i = i;
+            op->body.accept(this);
+            stack.resize(stack_size);
+        }
+    }
+
+    void visit(const Store *op) override {
+        if (exit_status) {
+            return;
+        }
+        Value v = eval(op->value);
+        Value index = eval(op->index);
+        Value predicate = eval(op->predicate);
+        const Type t = v.type.element_of();
+        uint8_t *base = (uint8_t *)lookup(op->name).as_pointer();
+        for (size_t i = 0; i < v.lanes.size(); i++) {
+            if (predicate.lanes[i].u) {
+                store_lane(base + index.lanes[i].i * t.bytes(), t, v.lanes[i]);
+            }
+        }
+    }
+
+    void visit(const Provide *op) override {
+        internal_error << "Provide in lowered code\n";
+    }
+
+    void visit(const Allocate *op) override {
+        if (exit_status) {
+            return;
+        }
+        int64_t elements = 1;
+        for (const Expr &e : op->extents) {
+            elements *= eval(e).as_int();
+        }
+        void *ptr = nullptr;
+        bool owned = false;
+        if (op->new_expr.defined()) {
+            ptr = eval(op->new_expr).as_pointer();
+        } else if (all_true(eval(op->condition))) {
+            ptr = allocate((elements + op->padding) * op->type.bytes());
+            owned = true;
+            if (!ptr) {
+                report_error("Out of memory (halide_malloc returned nullptr)");
+                fail(halide_error_code_out_of_memory);
+                return;
+            }
+        }
+        {
+            ScopedBinding<Value> bind(*scope, op->name, make_pointer(Handle(), ptr));
+            op->body.accept(this);
+        }
+        if (owned || op->free_function == "halide_free" || op->free_function == "halide_arena_free") {
+            deallocate(ptr);
+        }
+    }
+
+    void visit(const Free *op) override {
+        // Memory is given back at the end of the Allocate node instead.
+    }
+
+    void visit(const Realize *op) override {
+        internal_error << "Realize in lowered code\n";
+    }
+
+    void visit(const Block *op) override {
+        if (exit_status) {
+            return;
+        }
+        op->first.accept(this);
+        if (!exit_status) {
+            op->rest.accept(this);
+        }
+    }
+
+    void visit(const IfThenElse *op) override {
+        if (exit_status) {
+            return;
+        }
+        if (eval(op->condition).lanes[0].u) {
+            op->then_case.accept(this);
+        } else if (op->else_case.defined()) {
+            op->else_case.accept(this);
+        }
+    }
+
+    void visit(const Evaluate *op) override {
+        if (exit_status) {
+            return;
+        }
+        eval(op->value);
+    }
+
+    void visit(const Prefetch *op) override {
+        op->body.accept(this);
+    }
+
+    void visit(const Fork *op) override {
+        internal_error << "Fork in interpreted code\n";
+    }
+
+    void visit(const Acquire *op) override {
+        internal_error << "Acquire in interpreted code\n";
+    }
+
+    void visit(const Atomic *op) override {
+        // Everything runs on one thread, so atomics need nothing more.
+        op->body.accept(this);
+    }
+
+    void visit(const HoistedStorage *op) override {
+        op->body.accept(this);
+    }
+
+public:
+    // Run a function of the module with the given arguments, in its own
+    // scope. Returns its exit status.
+    int call(const LoweredFunc &f, const vector<Value> &args) {
+        internal_assert(f.args.size() == args.size());
+        Scope<Value> frame;
+        frame.set_containing_scope(&globals);
+        for (size_t i = 0; i < args.size(); i++) {
+            const LoweredArgument &a = f.args[i];
+            frame.push(a.is_buffer() ? a.name + ".buffer" : a.name, args[i]);
+        }
+        ScopedValue<Scope<Value> *> bind_frame(scope, &frame);
+        ScopedValue<int> bind_status(exit_status, 0);
+        const size_t stack_size = stack.size();
+        f.body.accept(this);
+        stack.resize(stack_size);
+        return exit_status;
+    }
+
+    int run(const void *const *argv) {
+        for (const Buffer<> &b : module.buffers) {
+            globals.push(b.name() + ".buffer", make_pointer(type_of<halide_buffer_t *>(), b.raw_buffer()));
+        }
+        vector<Value> args;
+        for (size_t i = 0; i < module.arguments.size(); i++) {
+            const Argument &a = module.arguments[i];
+            if (a.is_buffer()) {
+                args.push_back(make_pointer(type_of<halide_buffer_t *>(), argv[i]));
+            } else {
+                Value v(a.type);
+                v.lanes[0] = load_lane(argv[i], a.type);
+                if (a.name == "__user_context") {
+                    user_context = (JITUserContext *)v.as_pointer();
+                }
+                args.push_back(std::move(v));
+            }
+        }
+        return call(*module.main, args);
+    }
+
+    Interpreter(const InterpretedModuleContents &module)
+        : module(module) {
+    }
+};
+
+}  // namespace
+
+/*static*/
+InterpretedModule InterpretedModule::compile(const Module &module,
+                                             const vector<Argument> &arguments,
+                                             const string &fn_name) {
+    InterpretedModule result;
+    result.contents = new InterpretedModuleContents;
+    InterpretedModuleContents &contents = *result.contents;
+    contents.buffers = module.buffers();
+    contents.arguments = arguments;
+
+    LowerForInterpreter lower(module.target());
+    for (const LoweredFunc &f : module.functions()) {
+        LoweredFunc lowered = f;
+        lowered.body = lower.mutate(f.body);
+        contents.functions.emplace(f.name, std::move(lowered));
+    }
+    auto it = contents.functions.find(fn_name);
+    internal_assert(it != contents.functions.end())
+        << "Function " << fn_name << " not found in module " << module.name() << "\n";
+    internal_assert(it->second.args.size() == arguments.size());
+    contents.main = &it->second;
+
+    ResolveCalls resolve(contents.functions, contents.extern_calls);
+    for (const auto &f : contents.functions) {
+        f.second.body.accept(&resolve);
+    }
+    return result;
+}
+
+int InterpretedModule::run(const void *const *args) {
+    internal_assert(contents.defined());
+    Interpreter interpreter(*contents);
+    return interpreter.run(args);
+}
+
+}  // namespace Internal
+}  // namespace Halide
@@ -0,0 +1,48 @@
+#ifndef HALIDE_IR_INTERPRETER_H
+#define HALIDE_IR_INTERPRETER_H
+
+/** \file
+ *
+ * Support for running JIT-compiled pipelines by evaluating their lowered
+ * IR directly, instead of compiling it to machine code. Selected with
+ * Target::JITInterp. Starting up takes no time beyond lowering, at the
+ * cost of running much more slowly, which suits correctness checks of
+ * schedules on small inputs.
+ */
+
+#include "Argument.h"
+#include "IntrusivePtr.h"
+
+#include <string>
+#include <vector>
+
+namespace Halide {
+
+class Module;
+
+namespace Internal {
+
+struct InterpretedModuleContents;
+
+/** Handle to a lowered module that can be run by interpreting it. */
+struct InterpretedModule {
+    Internal::IntrusivePtr<InterpretedModuleContents> contents;
+
+    /** Prepare the function with the given name in a lowered module to
+     * be run with the given arguments. Fails with a user error if the
+     * module does something the interpreter doesn't support, such as
+     * running on a device, tracing, or calling extern functions. */
+    static InterpretedModule compile(const Module &module,
+                                     const std::vector<Argument> &arguments,
+                                     const std::string &fn_name);
+
+    /** Run the function with a set of arguments, passed in the same way
+     * as to the argv function of JIT-compiled code. Returns the exit
+     * status of the pipeline. */
+    int run(const void *const *args);
+};
+
+}  // namespace Internal
+}  // namespace Halide
+
+#endif  // HALIDE_IR_INTERPRETER_H
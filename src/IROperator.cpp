@@ -14,6 +14,7 @@
 #include "IROperator.h"
 #include "IRPrinter.h"
 #include "Interval.h"
+#include "Random.h"
 #include "Util.h"
 #include "Var.h"
 
@@ -1440,6 +1441,167 @@ Expr fast_exp(const Expr &x_full) {
     return result;
 }
 
+namespace {
+
+// A minimax polynomial for one of the functions below on its reduced
+// range (highest order coefficient first), and the errors of the whole
+// approximation, including range reduction, measured in Float(32) with
+// and without fused multiply-adds.
+struct Approximation {
+    double max_abs_error;
+    double max_ulp_error;
+    std::vector<float> coeff;
+};
+
+// The terms past x of sin(x) = x + x^3 * P(x^2) on [-pi/4, pi/4].
+const Approximation sin_approximations[] = {
+    {1.4e-5, 26, {8.163281716e-03f, -1.666339040e-01f}},
+    {1.3e-7, 0.75, {-1.951528247e-04f, 8.332160302e-03f, -1.666665524e-01f}},
+    {9.6e-8, 0.75, {2.718121550e-06f, -1.983931288e-04f, 8.333329111e-03f, -1.666666716e-01f}},
+};
+
+// The terms past 1 of cos(x) = 1 + x^2 * P(x^2) on [-pi/4, pi/4], of the
+// same degrees as those of sin.
+const Approximation cos_approximations[] = {
+    {1.4e-5, 232, {4.045845196e-02f, -4.997605681e-01f}},
+    {1.3e-7, 1.9, {-1.359185320e-03f, 4.165577888e-02f, -4.999988377e-01f}},
+    {9.6e-8, 1.4, {2.438356751e-05f, -1.388668199e-03f, 4.166661948e-02f, -5.000000000e-01f}},
+};
+
+// The terms past 1 + x of exp(x) = 1 + x + x^2 * P(x) on [-ln(2)/2, ln(2)/2].
+const Approximation exp_approximations[] = {
+    {9.8e-5, 1700, {1.666281074e-01f, 5.039409995e-01f}},
+    {4.2e-6, 71, {4.127774760e-02f, 1.675351411e-01f, 5.000511408e-01f}},
+    {1.3e-7, 2.3, {8.312525228e-03f, 4.189011455e-02f, 1.666711420e-01f, 4.999923110e-01f}},
+    {5.0e-8, 1.1, {1.381461276e-03f, 8.368710056e-03f, 4.166838899e-02f, 1.666652113e-01f, 4.999999404e-01f}},
+};
+
+// The terms past x of log(1 + x) = x + x^2 * P(x) on [-0.25, 0.5].
+const Approximation log_approximations[] = {
+    {2.8e-5, 910, {1.401491612e-01f, -2.571728230e-01f, 3.374478519e-01f, -4.999805987e-01f}},
+    {3.4e-6, 132, {-1.065477729e-01f, 2.049292475e-01f, -2.558811009e-01f, 3.334999084e-01f, -4.998895228e-01f}},
+    {5.8e-7, 23, {8.324466646e-02f, -1.676487774e-01f, 2.062634230e-01f, -2.505930364e-01f, 3.331873715e-01f, -4.999891520e-01f}},
+    {1.4e-7, 4.1, {-6.720374525e-02f, 1.415362060e-01f, -1.733713001e-01f, 2.009534240e-01f, -2.497926950e-01f, 3.333070576e-01f, -5.000016689e-01f}},
+    {6.9e-8, 1.5, {5.413248390e-02f, -1.206736788e-01f, 1.498391628e-01f, -1.682281196e-01f, 1.997707784e-01f, -2.499344200e-01f, 3.333354890e-01f, -5.000005960e-01f}},
+    {6.2e-8, 1.2, {-4.490961507e-02f, 1.044833213e-01f, -1.316223294e-01f, 1.448206156e-01f, -1.664776653e-01f, 1.999060661e-01f, -2.500005364e-01f, 3.333345354e-01f, -5.000000000e-01f}},
+};
+
+// The index of the cheapest approximation in the table that meets the
+// precision, or of the most accurate (the last) if none do.
+template<size_t N>
+int pick_approximation(const Approximation (&table)[N], const ApproximationPrecision &precision) {
+    for (size_t i = 0; i < N; i++) {
+        if ((precision.max_ulp_error <= 0 || table[i].max_ulp_error <= precision.max_ulp_error) &&
+            (precision.max_absolute_error <= 0 || table[i].max_abs_error <= precision.max_absolute_error)) {
+            return (int)i;
+        }
+    }
+    return (int)N - 1;
+}
+
+Expr evaluate_polynomial(const Expr &x, const Approximation &a, float scale = 1.0f) {
+    std::vector<float> coeff = a.coeff;
+    for (float &c : coeff) {
+        c *= scale;
+    }
+    return evaluate_polynomial(x, coeff.data(), (int)coeff.size());
+}
+
+Expr fast_sin_cos(const Expr &x_full, bool is_sin, const ApproximationPrecision &precision) {
+    Type type = x_full.type();
+    user_assert(type.element_of() == Float(32)) << (is_sin ? "fast_sin" : "fast_cos") << " only works for Float(32)";
+
+    const int i = is_sin ? pick_approximation(sin_approximations, precision) : pick_approximation(cos_approximations, precision);
+
+    // Reduce the angle to [-pi/4, pi/4], subtracting the multiple of
+    // pi/2 in three parts, the first two of which have enough trailing
+    // zeros to be exact when multiplied by k.
+    Expr k_real = round(x_full * 0.636619772367581343f);
+    Expr x = x_full - k_real * 1.5703125f;
+    x -= k_real * 4.837512969970703125e-4f;
+    x -= k_real * 7.54978995489188216e-8f;
+
+    Expr k = cast(Int(32, type.lanes()), k_real);
+    Expr quadrant = is_sin ? k : k + 1;
+
+    Expr x2 = x * x;
+    Expr sin_x = x + (x * x2) * evaluate_polynomial(x2, sin_approximations[i]);
+    Expr cos_x = 1.0f + x2 * evaluate_polynomial(x2, cos_approximations[i]);
+    Expr result = select((quadrant & 1) == 0, sin_x, cos_x);
+    result = select((quadrant & 2) == 0, result, -result);
+    return common_subexpression_elimination(result);
+}
+
+}  // namespace
+
+Expr fast_sin(const Expr &x, ApproximationPrecision precision) {
+    return fast_sin_cos(x, true, precision);
+}
+
+Expr fast_cos(const Expr &x, ApproximationPrecision precision) {
+    return fast_sin_cos(x, false, precision);
+}
+
+Expr fast_log(const Expr &x_full, ApproximationPrecision precision) {
+    Type type = x_full.type();
+    user_assert(type.element_of() == Float(32)) << "fast_log only works for Float(32)";
+
+    const Approximation &a = log_approximations[pick_approximation(log_approximations, precision)];
+
+    Expr nan = Call::make(type, "nan_f32", {}, Call::PureExtern);
+    Expr neg_inf = Call::make(type, "neg_inf_f32", {}, Call::PureExtern);
+    Expr use_nan = x_full < 0.0f;
+    Expr use_neg_inf = x_full == 0.0f;
+    Expr exceptional = use_nan | use_neg_inf;
+
+    Expr reduced, exponent;
+    range_reduce_log(select(exceptional, make_one(type), x_full), &reduced, &exponent);
+
+    // Add exponent * log(2) in two parts, the first of which is exact.
+    Expr x = reduced - 1.0f;
+    Expr e = cast(type, exponent);
+    Expr result = x + ((x * x) * evaluate_polynomial(x, a) + e * -2.12194440e-4f);
+    result += e * 0.693359375f;
+
+    result = select(exceptional, select(use_nan, nan, neg_inf), result);
+    return common_subexpression_elimination(result);
+}
+
+Expr fast_exp(const Expr &x_full, ApproximationPrecision precision) {
+    Type type = x_full.type();
+    user_assert(type.element_of() == Float(32)) << "fast_exp only works for Float(32)";
+
+    const Approximation &a = exp_approximations[pick_approximation(exp_approximations, precision)];
+
+    // Reduce to [-ln(2)/2, ln(2)/2], subtracting the multiple of ln(2)
+    // in two parts, the first of which is exact.
+    Expr k_real = round(x_full * 1.44269504088896341f);
+    Expr x = x_full - k_real * 0.693359375f;
+    x -= k_real * -2.12194440e-4f;
+
+    // Compute 2 * exp(x) (doubling the coefficients is exact), and
+    // scale it by 2^(k - 1), so that k can be as large as 128.
+    Expr result = 2.0f + (2.0f * x + (x * x) * evaluate_polynomial(x, a, 2.0f));
+    Expr biased = cast(Int(32, type.lanes()), clamp(k_real, -256.0f, 256.0f)) + 126;
+    result *= reinterpret(type, biased << 23);
+
+    // Catch overflow and underflow
+    Expr inf = Call::make(type, "inf_f32", {}, Call::PureExtern);
+    result = select(biased < 255, result, inf);
+    result = select(biased > 0, result, make_zero(type));
+    return common_subexpression_elimination(result);
+}
+
+Expr fast_pow(Expr x, Expr y, ApproximationPrecision precision) {
+    if (auto i = as_const_int(y)) {
+        return raise_to_integer_power(std::move(x), *i);
+    }
+
+    x = cast<float>(std::move(x));
+    y = cast<float>(std::move(y));
+    return select(x == 0.0f, 0.0f, fast_exp(fast_log(x, precision) * std::move(y), precision));
+}
+
 Expr print(const std::vector<Expr> &args) {
     Expr combined_string = combine_strings(args);
 
@@ -2615,7 +2777,10 @@ Expr mod_round_to_zero(Expr x, Expr y) {
 
 namespace {
 
-std::atomic<int> random_number_counter = 0;
+// Thread-local, so that pipelines defined on different threads at once
+// (e.g. the sub-targets of a multitarget build) each see the sequence
+// they would see alone.
+thread_local int random_number_counter = 0;
 
 }  // namespace
 
@@ -2666,6 +2831,40 @@ Expr random_int(Expr seed) {
     return reinterpret<int32_t>(random_uint(std::move(seed)));
 }
 
+namespace {
+
+std::vector<Expr> philox_words(const std::vector<Expr> &words, size_t size, const char *what) {
+    user_assert(words.size() <= size)
+        << "The " << what << " passed to philox4x32 has " << words.size()
+        << " words, but may have at most " << size << "\n";
+    std::vector<Expr> result(size, make_zero(UInt(32)));
+    for (size_t i = 0; i < words.size(); i++) {
+        user_assert(words[i].defined())
+            << "The " << what << " passed to philox4x32 has an undefined word\n";
+        user_assert(words[i].type() == Int(32) || words[i].type() == UInt(32))
+            << "The " << what << " passed to philox4x32 must have type Int(32) or UInt(32), but word "
+            << i << " is " << words[i] << " of type " << words[i].type() << "\n";
+        result[i] = cast(UInt(32), words[i]);
+    }
+    return result;
+}
+
+}  // namespace
+
+Tuple philox4x32(const std::vector<Expr> &counter, const std::vector<Expr> &key, int rounds) {
+    user_assert(rounds > 0)
+        << "philox4x32 needs at least one round, but was given " << rounds << "\n";
+    return Tuple(Internal::philox4x32(philox_words(counter, 4, "counter"),
+                                      philox_words(key, 2, "key"),
+                                      rounds));
+}
+
+Expr random_bits_to_float(Expr bits) {
+    user_assert(bits.defined() && (bits.type() == UInt(32) || bits.type() == Int(32)))
+        << "random_bits_to_float takes an Int(32) or UInt(32), but was given " << bits << "\n";
+    return Internal::random_float_from_bits(cast(UInt(32), bits));
+}
+
 Expr likely(Expr e) {
     Type t = e.type();
     return Call::make(t, Call::likely,
@@ -2684,6 +2883,14 @@ Expr strict_float(Expr e) {
                       {std::move(e)}, Call::PureIntrinsic);
 }
 
+Expr float16_compute(Expr e, float max_relative_error) {
+    user_assert(max_relative_error >= 0) << "float16_compute tolerance must be non-negative\n";
+    Type t = e.type();
+    return Call::make(t, Call::float16_compute,
+                      {std::move(e), make_const(Float(32), max_relative_error)},
+                      Call::PureIntrinsic);
+}
+
 Expr undef(Type t) {
     return Call::make(t, Call::undef,
                       std::vector<Expr>(),
@@ -372,7 +372,8 @@ Expr memoize_tag_helper(Expr result, const std::vector<Expr> &cache_key_values);
 /** Reset the counters used for random-number seeds in random_float/int/uint.
  * (Note that the counters are incremented for each call, even if a seed is passed in.)
  * This is used for multitarget compilation to ensure that each subtarget gets
- * the same sequence of random numbers. */
+ * the same sequence of random numbers. The counters are per-thread, and only
+ * the calling thread's are reset. */
 void reset_random_counters();
 
 }  // namespace Internal
@@ -1003,6 +1004,53 @@ Expr fast_exp(const Expr &x);
  * have at least sse 4.1. */
 Expr fast_pow(Expr x, Expr y);
 
+/** The accuracy asked of the fast_sin, fast_cos, fast_log, fast_exp and
+ * fast_pow overloads that take one: a bound on the error in units in
+ * the last place (ULPs) of the result, a bound on the absolute error,
+ * or both. A bound of zero means no bound. They use the cheapest of
+ * their polynomial approximations that meets the bounds, or the most
+ * accurate one if none does.
+ *
+ * The errors are as measured for Float(32) with and without fused
+ * multiply-adds. Absolute errors are measured where the result is at
+ * most about one in magnitude: |x| <= 100 for fast_sin and fast_cos,
+ * x <= 0 for fast_exp, and 1/e <= x <= e for fast_log. ULP errors are
+ * measured over all the inputs that don't overflow or underflow,
+ * except for fast_sin and fast_cos, where they hold for |x| <= pi/4:
+ * beyond that, results near the roots have just the absolute error
+ * bound. */
+struct ApproximationPrecision {
+    int max_ulp_error = 0;
+    double max_absolute_error = 0.0;
+
+    static ApproximationPrecision ulp(int max_ulp_error) {
+        ApproximationPrecision p;
+        p.max_ulp_error = max_ulp_error;
+        return p;
+    }
+
+    static ApproximationPrecision absolute(double max_absolute_error) {
+        ApproximationPrecision p;
+        p.max_absolute_error = max_absolute_error;
+        return p;
+    }
+};
+
+/** Fast vectorizable approximations to sin, cos, log, exp and pow for
+ * Float(32) with a given accuracy. The most accurate are within about
+ * 1.5 ULPs. fast_log returns nan for x < 0 and -inf for x == 0.
+ * fast_exp returns inf and zero where the result would overflow or
+ * (without denormals) underflow. The error of fast_pow also grows
+ * with |y * log(x)|, as it's fast_exp(fast_log(x) * y) with the given
+ * accuracy. Slow on x86 if you don't have at least sse 4.1. */
+// @{
+Expr fast_sin(const Expr &x, ApproximationPrecision precision);
+Expr fast_cos(const Expr &x, ApproximationPrecision precision);
+Expr fast_log(const Expr &x, ApproximationPrecision precision);
+Expr fast_exp(const Expr &x, ApproximationPrecision precision);
+Expr fast_pow(Expr x, Expr y, ApproximationPrecision precision);
+// @}
+
 /** Fast approximate inverse for Float(32). Corresponds to the rcpps
  * instruction on x86, and the vrecpe instruction on ARM. Vectorizes
  * cleanly. Note that this can produce slightly different results
@@ -1273,6 +1321,34 @@ Expr random_uint(Expr seed = Expr());
  * 32-bit integer. See \ref random_float. Vectorizes cleanly. */
 Expr random_int(Expr seed = Expr());
 
+/** Return the four 32-bit words of the Philox-4x32 counter-based
+ * random number generator (Salmon et al., "Parallel random numbers:
+ * as easy as 1, 2, 3"), for the given counter and key. Each counter
+ * and key is a different, statistically independent block of random
+ * bits, which passes the BigCrush test suite with the default of 10
+ * rounds.
+ *
+ * Unlike random_float, the result depends only on the arguments, and
+ * not on the Func it is used in or how it is scheduled, so using the
+ * pure vars of a Func as the counter gives each pixel a stream that is
+ * reproducible across pipelines, schedules and targets:
+ \code
+ Func noise;
+ Tuple bits = philox4x32({x, y, frame}, {seed});
+ noise(x, y) = random_bits_to_float(bits[0]);
+ \endcode
+ *
+ * The counter has at most four words, and the key at most two, of type
+ * Int(32) or UInt(32). Missing words are zero. The results have type
+ * UInt(32). This only uses 32-bit adds and xors and 32x32 -> 64 bit
+ * multiplies, so it vectorizes cleanly. */
+Tuple philox4x32(const std::vector<Expr> &counter, const std::vector<Expr> &key = {}, int rounds = 10);
+
+/** Convert a uniformly distributed unsigned 32-bit integer to a
+ * uniformly distributed float in the half-open interval [0.0f, 1.0f),
+ * as random_float does. */
+Expr random_bits_to_float(Expr bits);
+
 /** Create an Expr that prints out its value whenever it is
  * evaluated. It also prints out everything else in the arguments
  * list, separated by spaces. This can include string literals. */
@@ -1445,6 +1521,14 @@ Expr saturating_cast(Type t, Expr e);
  * generated code. */
 Expr strict_float(Expr e);
 
+/** Allow float32 arithmetic on float16 values in an expression to be
+ * done in float16 on targets with native float16 math, as long as the
+ * estimated relative error added stays below max_relative_error. A
+ * single float16 rounding has a relative error of up to 2^-11. Values
+ * must stay within the float16 range. Overrides the default tolerance
+ * set by Target::Float16Compute; a tolerance of zero disables it. */
+Expr float16_compute(Expr e, float max_relative_error);
+
 /** Create an Expr that that promises another Expr is clamped but do
  * not generate code to check the assertion or modify the value. No
  * attempt is made to prove the bound at compile time. (If it is
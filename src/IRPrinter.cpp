@@ -153,6 +153,15 @@ std::ostream &operator<<(std::ostream &out, const MemoryType &t) {
     case MemoryType::AMXTile:
         out << "AMXTile";
         break;
+    case MemoryType::Streaming:
+        out << "Streaming";
+        break;
+    case MemoryType::WMMAAccumulator:
+        out << "WMMAAccumulator";
+        break;
+    case MemoryType::SimdgroupMatrix:
+        out << "SimdgroupMatrix";
+        break;
     }
     return out;
 }
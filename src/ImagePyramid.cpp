@@ -0,0 +1,174 @@
+#include "ImagePyramid.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "Error.h"
+#include "IROperator.h"
+
+namespace Halide {
+
+using std::string;
+using std::vector;
+
+namespace {
+
+// The args of a Func, with the first two replaced by x and y.
+vector<Expr> with_xy(const Expr &x, const Expr &y, const vector<Var> &args) {
+    vector<Expr> result = {x, y};
+    result.insert(result.end(), args.begin() + 2, args.end());
+    return result;
+}
+
+vector<Var> pyramid_args(const Func &f) {
+    vector<Var> args = f.args();
+    user_assert(args.size() >= 2)
+        << "Func " << f.name() << " has " << args.size()
+        << " dimensions, but image pyramids need at least two.\n";
+    return args;
+}
+
+}  // namespace
+
+ImagePyramid::ImagePyramid(vector<Func> levels)
+    : levels(std::move(levels)) {
+}
+
+Func &ImagePyramid::operator[](int j) {
+    user_assert(j >= 0 && j < size())
+        << "Level " << j << " is out of range for a pyramid of " << size() << " levels.\n";
+    return levels[j];
+}
+
+const Func &ImagePyramid::operator[](int j) const {
+    user_assert(j >= 0 && j < size())
+        << "Level " << j << " is out of range for a pyramid of " << size() << " levels.\n";
+    return levels[j];
+}
+
+Func ImagePyramid::downsample(const Func &f) {
+    vector<Var> args = pyramid_args(f);
+    Var x = args[0], y = args[1];
+
+    Func down_y(f.name() + "_down_y"), down(f.name() + "_down");
+    down_y(args) = (f(with_xy(x, 2 * y - 1, args)) +
+                    3.0f * (f(with_xy(x, 2 * y, args)) + f(with_xy(x, 2 * y + 1, args))) +
+                    f(with_xy(x, 2 * y + 2, args))) /
+                   8.0f;
+    down(args) = (down_y(with_xy(2 * x - 1, y, args)) +
+                  3.0f * (down_y(with_xy(2 * x, y, args)) + down_y(with_xy(2 * x + 1, y, args))) +
+                  down_y(with_xy(2 * x + 2, y, args))) /
+                 8.0f;
+    return down;
+}
+
+Func ImagePyramid::upsample(const Func &f) {
+    vector<Var> args = pyramid_args(f);
+    Var x = args[0], y = args[1];
+
+    Func up_x(f.name() + "_up_x"), up(f.name() + "_up");
+    up_x(args) = lerp(f(with_xy((x + 1) / 2, y, args)),
+                      f(with_xy((x - 1) / 2, y, args)),
+                      ((x % 2) * 2 + 1) / 4.0f);
+    up(args) = lerp(up_x(with_xy(x, (y + 1) / 2, args)),
+                    up_x(with_xy(x, (y - 1) / 2, args)),
+                    ((y % 2) * 2 + 1) / 4.0f);
+    return up;
+}
+
+ImagePyramid ImagePyramid::gaussian(const Func &f, int num_levels, const string &name) {
+    user_assert(num_levels > 0) << "A pyramid must have at least one level.\n";
+    vector<Var> args = pyramid_args(f);
+
+    vector<Func> levels;
+    levels.emplace_back(name + "_0");
+    levels[0](args) = f(args);
+    for (int j = 1; j < num_levels; j++) {
+        levels.emplace_back(name + "_" + std::to_string(j));
+        levels[j](args) = downsample(levels[j - 1])(args);
+    }
+    return ImagePyramid(std::move(levels));
+}
+
+ImagePyramid ImagePyramid::laplacian(const string &name) const {
+    user_assert(!levels.empty()) << "Can't take the Laplacian pyramid of an empty pyramid.\n";
+
+    const int n = size();
+    vector<Func> result(n);
+    for (int j = 0; j < n; j++) {
+        vector<Var> args = pyramid_args(levels[j]);
+        result[j] = Func(name + "_" + std::to_string(j));
+        if (j == n - 1) {
+            result[j](args) = levels[j](args);
+        } else {
+            result[j](args) = levels[j](args) - upsample(levels[j + 1])(args);
+        }
+    }
+    return ImagePyramid(std::move(result));
+}
+
+ImagePyramid ImagePyramid::collapse(const string &name) const {
+    user_assert(!levels.empty()) << "Can't collapse an empty pyramid.\n";
+
+    const int n = size();
+    vector<Func> result(n);
+    for (int j = n - 1; j >= 0; j--) {
+        vector<Var> args = pyramid_args(levels[j]);
+        result[j] = Func(name + "_" + std::to_string(j));
+        if (j == n - 1) {
+            result[j](args) = levels[j](args);
+        } else {
+            result[j](args) = upsample(result[j + 1])(args) + levels[j](args);
+        }
+    }
+    return ImagePyramid(std::move(result));
+}
+
+ImagePyramid ImagePyramid::map(const std::function<Func(const Func &, int)> &op) const {
+    vector<Func> result;
+    for (int j = 0; j < size(); j++) {
+        result.push_back(op(levels[j], j));
+    }
+    return ImagePyramid(std::move(result));
+}
+
+ImagePyramid &ImagePyramid::schedule(const Target &target, int width, int height,
+                                     int first_level, int small_level_pixels) {
+    for (int j = std::max(first_level, 0); j < size(); j++) {
+        Func f = levels[j];
+        vector<Var> args = pyramid_args(f);
+        Var x = args[0], y = args[1];
+        const int w = std::max(width >> j, 1);
+        const int h = std::max(height >> j, 1);
+
+        f.compute_root();
+        if (target.has_gpu_feature()) {
+            // Shrink the tiles of the smaller levels, so that they still
+            // have enough blocks to fill the GPU.
+            int tile_w = 16, tile_h = 8;
+            while (tile_w > 2 && (w / tile_w) * (h / tile_h) < 256) {
+                tile_w /= 2;
+                tile_h = std::max(tile_h / 2, 2);
+            }
+            Var xi, yi;
+            f.gpu_tile(x, y, xi, yi, tile_w, tile_h, TailStrategy::GuardWithIf);
+            continue;
+        }
+
+        const int vector_size = target.natural_vector_size(f.types()[0]);
+        if (w >= vector_size) {
+            f.vectorize(x, vector_size, TailStrategy::GuardWithIf);
+        }
+        if (w * h >= small_level_pixels) {
+            // Make the rows the outermost loop, and compute strips of
+            // them in parallel.
+            vector<VarOrRVar> order(args.begin(), args.end());
+            std::rotate(order.begin() + 1, order.begin() + 2, order.end());
+            f.reorder(order)
+                .parallel(y, 8, TailStrategy::GuardWithIf);
+        }
+    }
+    return *this;
+}
+
+}  // namespace Halide
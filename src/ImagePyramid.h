@@ -0,0 +1,101 @@
+#ifndef HALIDE_IMAGE_PYRAMID_H
+#define HALIDE_IMAGE_PYRAMID_H
+
+/** \file
+ * Support for multi-scale pipelines built out of image pyramids.
+ */
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "Func.h"
+#include "Target.h"
+
+namespace Halide {
+
+/** A list of Funcs, one per level of a pyramid. Each level has half
+ * the resolution of the one before it in its first two dimensions,
+ * which are the x and y coordinates. Any other dimensions (e.g. color
+ * channels) are carried through from level to level.
+ *
+ * The Funcs of the levels have the same pure arguments as the Func
+ * the pyramid was built from, so they can be scheduled with the same
+ * Vars. For example, a Laplacian pyramid that is processed and then
+ * collapsed:
+ \code
+ Func input_gray = ...;
+ ImagePyramid gaussian = ImagePyramid::gaussian(input_gray, 8);
+ ImagePyramid laplacian = gaussian.laplacian();
+ ImagePyramid processed = laplacian.map([&](const Func &level, int j) {
+     Func f;
+     f(x, y) = level(x, y) * gain[j];
+     return f;
+ });
+ ImagePyramid collapsed = processed.collapse();
+ collapsed.schedule(target, 1920, 1080);
+ Func output = collapsed[0];
+ \endcode
+ */
+class ImagePyramid {
+    std::vector<Func> levels;
+
+public:
+    ImagePyramid() = default;
+    explicit ImagePyramid(std::vector<Func> levels);
+
+    /** The Gaussian pyramid of f, with the given number of levels.
+     * Level 0 is f, and each following level is the one before it
+     * filtered with downsample. f should be floating point, and
+     * defined everywhere the levels need it, e.g. by using a boundary
+     * condition. */
+    static ImagePyramid gaussian(const Func &f, int num_levels,
+                                 const std::string &name = "gaussian");
+
+    /** The Laplacian pyramid of this Gaussian pyramid. Each level is
+     * the difference between this level and the upsampled next level,
+     * except for the last, which is the last level of this pyramid. */
+    ImagePyramid laplacian(const std::string &name = "laplacian") const;
+
+    /** The Gaussian pyramid reconstructed from this Laplacian pyramid,
+     * by adding each level to the upsampled reconstruction of the next
+     * one. Level 0 of the result is the collapsed image. */
+    ImagePyramid collapse(const std::string &name = "collapse") const;
+
+    /** A pyramid whose level j is op(level j of this pyramid, j). */
+    ImagePyramid map(const std::function<Func(const Func &, int)> &op) const;
+
+    /** The number of levels. */
+    int size() const {
+        return (int)levels.size();
+    }
+
+    /** Get a level of the pyramid. */
+    // @{
+    Func &operator[](int j);
+    const Func &operator[](int j) const;
+    // @}
+
+    /** Schedule the levels from first_level onwards, given an estimate
+     * of the width and height of level 0. Each level is computed at
+     * root, and its schedule is picked by its size: levels of less
+     * than small_level_pixels are computed serially, larger levels in
+     * parallel strips of rows, and on targets with a GPU feature, all
+     * levels run on the GPU, in tiles that shrink with the level.
+     * Level 0 is usually best scheduled along with its consumer, so it
+     * is left alone by default. Returns a reference to this pyramid. */
+    ImagePyramid &schedule(const Target &target, int width, int height,
+                           int first_level = 1, int small_level_pixels = 64 * 64);
+
+    /** Filter the first two dimensions of f with a [1 3 3 1] / 8
+     * kernel, and subsample them by a factor of two. */
+    static Func downsample(const Func &f);
+
+    /** Upsample the first two dimensions of f by a factor of two, with
+     * bilinear interpolation. */
+    static Func upsample(const Func &f);
+};
+
+}  // namespace Halide
+
+#endif
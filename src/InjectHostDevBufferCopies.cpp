@@ -151,6 +151,11 @@ class InjectBufferCopiesForSingleBuffer : public IRMutator {
 
     MemoryType memory_type;
 
+    // If true, check the dirty bits inline before calling into the
+    // runtime to copy, so that buffers which are already where they
+    // need to be don't pay for the call (and its lock) at all.
+    const bool check_dirty_inline;
+
     enum FlagState {
         Unknown,
         False,
@@ -192,12 +197,29 @@ class InjectBufferCopiesForSingleBuffer : public IRMutator {
     }
 
     Stmt make_copy_to_host() {
-        return call_extern_and_assert("halide_copy_to_host", {buffer_var()});
+        Stmt copy = call_extern_and_assert("halide_copy_to_host", {buffer_var()});
+        if (check_dirty_inline) {
+            Expr device_dirty = Call::make(Bool(), Call::buffer_get_device_dirty,
+                                           {buffer_var()}, Call::Extern);
+            copy = IfThenElse::make(device_dirty, copy);
+        }
+        return copy;
     }
 
     Stmt make_copy_to_device(DeviceAPI target_device_api) {
         Expr device_interface = make_device_interface_call(target_device_api, memory_type);
-        return call_extern_and_assert("halide_copy_to_device", {buffer_var(), device_interface});
+        Stmt copy = call_extern_and_assert("halide_copy_to_device", {buffer_var(), device_interface});
+        if (check_dirty_inline) {
+            // A device allocation is assumed to belong to the device
+            // interface in use, which halide_copy_to_device would
+            // otherwise have checked.
+            Expr host_dirty = Call::make(Bool(), Call::buffer_get_host_dirty,
+                                         {buffer_var()}, Call::Extern);
+            Expr device = Call::make(type_of<uint64_t>(), Call::buffer_get_device,
+                                     {buffer_var()}, Call::Extern);
+            copy = IfThenElse::make(host_dirty || device == make_zero(device.type()), copy);
+        }
+        return copy;
     }
 
     Stmt make_host_dirty() {
@@ -422,8 +444,8 @@ class InjectBufferCopiesForSingleBuffer : public IRMutator {
     }
 
 public:
-    InjectBufferCopiesForSingleBuffer(const std::string &b, bool e, MemoryType m)
-        : buffer(b), is_external(e), memory_type(m) {
+    InjectBufferCopiesForSingleBuffer(const std::string &b, bool e, MemoryType m, bool check_dirty_inline = false)
+        : buffer(b), is_external(e), memory_type(m), check_dirty_inline(check_dirty_inline) {
         if (is_external) {
             // The state of the buffer is totally unknown, which is
             // the default constructor for this->state
@@ -737,6 +759,7 @@ public:
 // appropriate site.
 class InjectBufferCopiesForInputsAndOutputs : public IRMutator {
     Stmt site;
+    bool device_resident;
 
     // Find all references to external buffers.
     class FindInputsAndOutputs : public IRVisitor {
@@ -796,7 +819,7 @@ public:
             s.accept(&finder);
             Stmt new_stmt = s;
             for (const string &buf : finder.result) {
-                new_stmt = InjectBufferCopiesForSingleBuffer(buf, true, finder.result_storage.at(buf)).mutate(new_stmt);
+                new_stmt = InjectBufferCopiesForSingleBuffer(buf, true, finder.result_storage.at(buf), device_resident).mutate(new_stmt);
             }
             return new_stmt;
         } else {
@@ -804,8 +827,8 @@ public:
         }
     }
 
-    InjectBufferCopiesForInputsAndOutputs(Stmt s)
-        : site(std::move(s)) {
+    InjectBufferCopiesForInputsAndOutputs(Stmt s, bool device_resident)
+        : site(std::move(s)), device_resident(device_resident) {
     }
 };
 
@@ -831,7 +854,7 @@ Stmt inject_host_dev_buffer_copies(Stmt s, const Target &t) {
     if (outermost.result.defined()) {
         // If the entire pipeline simplified away, or just dispatches
         // to another pipeline, there may be no outermost produce.
-        s = InjectBufferCopiesForInputsAndOutputs(outermost.result).mutate(s);
+        s = InjectBufferCopiesForInputsAndOutputs(outermost.result, t.has_feature(Target::DeviceResident)).mutate(s);
     }
 
     return s;
@@ -21,7 +21,10 @@ namespace Internal {
 Stmt call_extern_and_assert(const std::string &name, const std::vector<Expr> &args);
 
 /** Inject calls to halide_device_malloc, halide_copy_to_device, and
- * halide_copy_to_host as needed. */
+ * halide_copy_to_host as needed. With Target::DeviceResident, the copies
+ * of the pipeline's inputs and outputs are skipped inline when their
+ * dirty bits say nothing needs to move, so pipelines chained on a device
+ * don't call into the runtime at their boundaries. */
 Stmt inject_host_dev_buffer_copies(Stmt s, const Target &t);
 
 }  // namespace Internal
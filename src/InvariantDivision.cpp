@@ -0,0 +1,234 @@
+#include "InvariantDivision.h"
+#include "IRMutator.h"
+#include "IROperator.h"
+#include "Scope.h"
+
+#include <map>
+
+namespace Halide {
+namespace Internal {
+
+namespace {
+
+// The magic numbers for dividing N-bit unsigned integers by d > 0 with a
+// multiply-high and shifts, using Granlund and Montgomery's method in the
+// branch-free form libdivide uses:
+//
+//   t = mulhi(n, m)
+//   n / d = (t + ((n - t) >> shift1)) >> shift2
+//
+// where l = ceil(log2(d)), m = 2^N * (2^l - d) / d + 1, shift1 = min(l, 1)
+// and shift2 = max(l - 1, 0). This is exact for all n, and all d,
+// including one.
+struct DivisionMagic {
+    Expr multiplier, shift1, shift2;
+    // All ones, or zero for division by zero, to give Halide's result.
+    Expr mask;
+    // For signed division, all ones if the divisor is negative.
+    Expr negative;
+};
+
+class LowerInvariantDivision : public IRMutator {
+    using IRMutator::visit;
+
+    const Target &target;
+
+    struct Loop {
+        // The lets to wrap around the loop, outermost first.
+        std::vector<std::pair<std::string, Expr>> lets;
+        std::map<std::string, DivisionMagic> magic;
+    };
+    std::vector<Loop> loops;
+
+    // The number of loops enclosing the definition of each variable.
+    Scope<int> depth;
+
+    Expr define(Loop &loop, const std::string &name, const Expr &value) {
+        std::string unique = unique_name(name);
+        loop.lets.emplace_back(unique, value);
+        return Variable::make(value.type(), unique);
+    }
+
+    // Get the magic numbers for dividing by a scalar variable, computed
+    // before the outermost loop it is invariant in. Returns nullptr if it
+    // varies in the innermost loop, or isn't a variable.
+    const DivisionMagic *magic_for(const Expr &divisor) {
+        const Variable *var = divisor.as<Variable>();
+        if (!var) {
+            return nullptr;
+        }
+        const int d = depth.contains(var->name) ? depth.get(var->name) : 0;
+        if (d >= (int)loops.size()) {
+            return nullptr;
+        }
+        Loop &loop = loops[d];
+        auto it = loop.magic.find(var->name);
+        if (it != loop.magic.end()) {
+            return &it->second;
+        }
+
+        const Type t = divisor.type();
+        const Type ut = t.with_code(Type::UInt), wide = ut.widen();
+        const int bits = t.bits();
+
+        // Halide's abs returns an unsigned type, so this works for the most
+        // negative value too.
+        Expr magnitude = t.is_int() ? abs(divisor) : divisor;
+        Expr is_zero = magnitude == make_zero(ut);
+        // Divide by one instead of zero, and mask off the result.
+        Expr d1 = define(loop, var->name + "_divisor", magnitude | cast(ut, is_zero));
+        Expr l = define(loop, var->name + "_log2",
+                        make_const(ut, bits) - count_leading_zeros(d1 - make_one(ut)));
+        Expr wide_d = cast(wide, d1);
+        Expr m = ((make_one(wide) << cast(wide, l)) - wide_d) << make_const(wide, bits);
+        m = cast(ut, m / wide_d + make_one(wide));
+
+        DivisionMagic magic;
+        magic.multiplier = define(loop, var->name + "_multiplier", m);
+        magic.shift1 = define(loop, var->name + "_shift1", min(l, make_one(ut)));
+        magic.shift2 = define(loop, var->name + "_shift2", l - magic.shift1);
+        magic.mask = define(loop, var->name + "_mask",
+                            select(is_zero, make_zero(ut), ut.max()));
+        if (t.is_int()) {
+            magic.negative = define(loop, var->name + "_negative",
+                                    divisor >> make_const(t, bits - 1));
+        }
+        return &(loop.magic[var->name] = magic);
+    }
+
+    // Get the magic numbers for the divisor of a Div or Mod, if it is
+    // worth using them.
+    const DivisionMagic *magic_for_op(const Expr &a, const Expr &b) {
+        const Type t = a.type();
+        if (!(t.is_int() || t.is_uint()) ||
+            !(t.bits() == 8 || t.bits() == 16 || t.bits() == 32) ||
+            // Computing a 32-bit multiplier needs a 64-bit division,
+            // which 32-bit targets don't have.
+            (t.bits() == 32 && target.bits == 32)) {
+            return nullptr;
+        }
+        const Broadcast *broadcast = b.as<Broadcast>();
+        return magic_for(broadcast ? broadcast->value : b);
+    }
+
+    // The quotient a / b (rounding as Halide does), without the mask for
+    // division by zero.
+    Expr quotient(const Expr &a, const DivisionMagic &magic) {
+        const Type t = a.type();
+        const Type ut = t.with_code(Type::UInt);
+        auto lanes = [&](const Expr &e) {
+            return t.is_vector() ? Broadcast::make(e, t.lanes()) : e;
+        };
+
+        // Flip the bits of negative numerators, which turns rounding down
+        // into rounding towards zero. Then divide by the magnitude, and
+        // negate the result for negative divisors.
+        Expr sign, n = a;
+        if (t.is_int()) {
+            sign = a >> make_const(t, t.bits() - 1);
+            n = cast(ut, a) ^ cast(ut, sign);
+        }
+        Expr high = mul_shift_right(n, lanes(magic.multiplier), t.bits());
+        Expr q = (high + ((n - high) >> lanes(magic.shift1))) >> lanes(magic.shift2);
+        if (t.is_int()) {
+            q = cast(t, q) ^ sign;
+            q = (q ^ lanes(magic.negative)) - lanes(magic.negative);
+        }
+        return q;
+    }
+
+    template<typename T>
+    Expr visit_division(const T *op, bool is_mod) {
+        Expr a = mutate(op->a), b = mutate(op->b);
+        const DivisionMagic *magic = magic_for_op(a, b);
+        if (!magic) {
+            return T::make(a, b);
+        }
+
+        // a appears several times below.
+        std::string name;
+        Expr value;
+        if (!a.as<Variable>() && !is_const(a)) {
+            name = unique_name('t');
+            value = a;
+            a = Variable::make(a.type(), name);
+        }
+
+        Expr result = quotient(a, *magic);
+        if (is_mod) {
+            result = a - result * b;
+        }
+        Expr mask = cast(a.type().element_of(), magic->mask);
+        result = result & (a.type().is_vector() ? Broadcast::make(mask, a.type().lanes()) : mask);
+
+        if (value.defined()) {
+            result = Let::make(name, value, result);
+        }
+        return result;
+    }
+
+    Expr visit(const Div *op) override {
+        return visit_division(op, false);
+    }
+
+    Expr visit(const Mod *op) override {
+        return visit_division(op, true);
+    }
+
+    template<typename LetOrLetStmt>
+    auto visit_let(const LetOrLetStmt *op) -> decltype(op->body) {
+        Expr value = mutate(op->value);
+        decltype(op->body) body;
+        {
+            ScopedBinding<int> bind(depth, op->name, (int)loops.size());
+            body = mutate(op->body);
+        }
+        return LetOrLetStmt::make(op->name, value, body);
+    }
+
+    Expr visit(const Let *op) override {
+        return visit_let(op);
+    }
+
+    Stmt visit(const LetStmt *op) override {
+        return visit_let(op);
+    }
+
+    Stmt visit(const For *op) override {
+        // Loops that run on other devices compile their own divisions.
+        if (is_gpu(op->for_type) || op->device_api == DeviceAPI::Hexagon) {
+            return op;
+        }
+
+        Expr min = mutate(op->min), extent = mutate(op->extent);
+        loops.emplace_back();
+        Stmt body;
+        {
+            ScopedBinding<int> bind(depth, op->name, (int)loops.size());
+            body = mutate(op->body);
+        }
+        Loop loop = std::move(loops.back());
+        loops.pop_back();
+
+        Stmt result = For::make(op->name, min, extent, op->for_type,
+                                op->partition_policy, op->device_api, body);
+        for (auto it = loop.lets.rbegin(); it != loop.lets.rend(); it++) {
+            result = LetStmt::make(it->first, it->second, result);
+        }
+        return result;
+    }
+
+public:
+    explicit LowerInvariantDivision(const Target &target)
+        : target(target) {
+    }
+};
+
+}  // namespace
+
+Stmt lower_invariant_division(const Stmt &s, const Target &t) {
+    return LowerInvariantDivision(t).mutate(s);
+}
+
+}  // namespace Internal
+}  // namespace Halide
@@ -0,0 +1,25 @@
+#ifndef HALIDE_INVARIANT_DIVISION_H
+#define HALIDE_INVARIANT_DIVISION_H
+
+/** \file
+ * Defines the lowering pass that turns divisions by loop invariant values
+ * into multiplies and shifts.
+ */
+
+#include "Expr.h"
+#include "Target.h"
+
+namespace Halide {
+namespace Internal {
+
+/** Replace integer divisions and modulos inside loops by a variable that
+ * is invariant in them (e.g. a Param) with a multiply-high and shifts by
+ * magic numbers, which are computed once, before the outermost loop the
+ * divisor is invariant in. Division by constants is left alone, as the
+ * code generators already handle it with tables of magic numbers. */
+Stmt lower_invariant_division(const Stmt &s, const Target &t);
+
+}  // namespace Internal
+}  // namespace Halide
+
+#endif
@@ -1,7 +1,10 @@
+#include <atomic>
 #include <cstdint>
 #include <mutex>
 #include <set>
+#include <sstream>
 #include <string>
+#include <vector>
 
 #ifdef _WIN32
 #ifdef _MSC_VER
@@ -16,11 +19,13 @@
 #include "CodeGen_Internal.h"
 #include "CodeGen_LLVM.h"
 #include "Debug.h"
+#include "IRPrinter.h"
 #include "JITModule.h"
 #include "LLVM_Headers.h"
 #include "LLVM_Output.h"
 #include "LLVM_Runtime_Linker.h"
 #include "Pipeline.h"
+#include "Util.h"
 #include "WasmExecutor.h"
 
 namespace Halide {
@@ -139,6 +144,173 @@ void load_webgpu() {
 
 using namespace llvm;
 
+namespace {
+
+// An opt-in persistent cache of JIT-compiled object code, enabled by
+// setting HL_JIT_CACHE_DIR to a writable directory. Entries are keyed
+// on a hash of the lowered Module, the Target, and the Halide and LLVM
+// versions. Each entry is a pair of files: <hash>.o holds the object
+// code, and <hash>.bc holds an empty llvm::Module with the triple, data
+// layout and module flags that compile_module and the shared runtime
+// read from the real one. Failing to read or write the cache is never
+// an error; it just means compiling from scratch.
+class JITDiskCache : public llvm::ObjectCache {
+    std::string path;
+    bool storing = false;
+
+    static uint64_t fnv1a(const std::string &s, uint64_t h) {
+        for (char c : s) {
+            h = (h ^ (uint8_t)c) * 0x100000001b3ULL;
+        }
+        return h;
+    }
+
+    // Write a file so that concurrent readers never see it partially
+    // written: write a temporary file next to it, then rename.
+    static void write_file_atomically(const std::string &name, llvm::StringRef contents) {
+        int fd;
+        llvm::SmallString<128> temp_name;
+        if (llvm::sys::fs::createUniqueFile(name + "-%%%%%%%%.tmp", fd, temp_name)) {
+            debug(1) << "JIT cache: unable to create a temporary file for " << name << "\n";
+            return;
+        }
+        {
+            llvm::raw_fd_ostream out(fd, /* shouldClose */ true);
+            out << contents;
+            out.close();
+            if (out.has_error()) {
+                out.clear_error();
+                llvm::sys::fs::remove(temp_name);
+                debug(1) << "JIT cache: unable to write " << name << "\n";
+                return;
+            }
+        }
+        if (llvm::sys::fs::rename(temp_name, name)) {
+            llvm::sys::fs::remove(temp_name);
+            debug(1) << "JIT cache: unable to rename " << temp_name.str().str() << " to " << name << "\n";
+        }
+    }
+
+public:
+    // Set when the entry was found.
+    std::unique_ptr<llvm::MemoryBuffer> cached_object;
+
+    JITDiskCache(const std::string &dir, const Module &m, const std::string &function_name) {
+        std::ostringstream key;
+        key << "halide " << HALIDE_VERSION_MAJOR << "." << HALIDE_VERSION_MINOR << "." << HALIDE_VERSION_PATCH
+            << " llvm " << LLVM_VERSION_STRING
+            << " llvm_args " << get_env_variable("HL_LLVM_ARGS")
+            << " function " << function_name
+            << " strict_float " << m.any_strict_float()
+            << " skip_llvm_optimization " << m.skip_llvm_optimization() << "\n";
+        for (const auto &it : m.get_metadata_name_map()) {
+            key << "metadata " << it.first << " " << it.second << "\n";
+        }
+        // The IR printer doesn't print buffer contents.
+        for (const auto &b : m.buffers()) {
+            std::string contents;
+            if (b.data() != nullptr) {
+                contents.assign((const char *)b.data(), b.size_in_bytes());
+            }
+            key << "buffer " << b.name() << " " << std::hex << fnv1a(contents, 0xcbf29ce484222325ULL) << std::dec << "\n";
+        }
+        key << m;
+
+        // Two 64-bit hashes with different offsets, to make collisions
+        // between entries vanishingly unlikely.
+        std::string k = key.str();
+        std::ostringstream name;
+        name << std::hex << fnv1a(k, 0xcbf29ce484222325ULL) << fnv1a(k, 0x84222325cbf29ce4ULL);
+        path = dir + "/" + name.str();
+    }
+
+    // Look the entry up. On a hit, returns the stub module to compile
+    // with, and sets cached_object.
+    std::unique_ptr<llvm::Module> load(llvm::LLVMContext &context) {
+        auto object = llvm::MemoryBuffer::getFile(path + ".o", /* IsText */ false, /* RequiresNullTerminator */ false);
+        auto bitcode = llvm::MemoryBuffer::getFile(path + ".bc", /* IsText */ false, /* RequiresNullTerminator */ false);
+        if (!object || !bitcode) {
+            debug(1) << "JIT cache miss: " << path << "\n";
+            return nullptr;
+        }
+        auto stub = llvm::parseBitcodeFile((*bitcode)->getMemBufferRef(), context);
+        if (!stub) {
+            llvm::consumeError(stub.takeError());
+            debug(1) << "JIT cache: ignoring unreadable entry " << path << "\n";
+            return nullptr;
+        }
+        debug(1) << "JIT cache hit: " << path << "\n";
+        cached_object = std::move(*object);
+        return std::move(*stub);
+    }
+
+    // Prepare to store the object code compiled from a module. Modules
+    // with static constructors or destructors aren't cached, because
+    // running those requires the IR.
+    void begin_store(const llvm::Module &m) {
+        if (!llvm::orc::getConstructors(m).empty() || !llvm::orc::getDestructors(m).empty()) {
+            debug(1) << "JIT cache: not caching " << path << ", which has static constructors or destructors\n";
+            return;
+        }
+
+        llvm::Module stub(m.getModuleIdentifier(), m.getContext());
+        stub.setTargetTriple(m.getTargetTriple());
+        stub.setDataLayout(m.getDataLayout());
+        llvm::SmallVector<llvm::Module::ModuleFlagEntry, 16> flags;
+        m.getModuleFlagsMetadata(flags);
+        for (const auto &flag : flags) {
+            stub.addModuleFlag(flag.Behavior, flag.Key->getString(), flag.Val);
+        }
+
+        llvm::SmallVector<char, 1024> bitcode;
+        llvm::raw_svector_ostream out(bitcode);
+        WriteBitcodeToFile(stub, out);
+        write_file_atomically(path + ".bc", llvm::StringRef(bitcode.data(), bitcode.size()));
+        storing = true;
+    }
+
+    // Whether the object code should be passed to notifyObjectCompiled.
+    bool is_storing() const {
+        return storing;
+    }
+
+    void notifyObjectCompiled(const llvm::Module *, llvm::MemoryBufferRef object) override {
+        write_file_atomically(path + ".o", object.getBuffer());
+    }
+
+    std::unique_ptr<llvm::MemoryBuffer> getObject(const llvm::Module *) override {
+        // Hits are loaded as object files directly; see compile_module.
+        return nullptr;
+    }
+};
+
+// The bytes of shared runtime object code linked into the live
+// modules that use it, summed over those modules.
+std::atomic<size_t> shared_runtime_bytes_linked{0};
+std::atomic<int> shared_runtime_users{0};
+
+// Wraps the compiler of an LLJIT to count the bytes of object code it
+// produces.
+class ObjectSizeRecordingCompiler : public llvm::orc::IRCompileLayer::IRCompiler {
+    std::unique_ptr<llvm::orc::IRCompileLayer::IRCompiler> compiler;
+    size_t *object_bytes;
+
+public:
+    ObjectSizeRecordingCompiler(std::unique_ptr<llvm::orc::IRCompileLayer::IRCompiler> compiler, size_t *object_bytes)
+        : IRCompiler(compiler->getManglingOptions()), compiler(std::move(compiler)), object_bytes(object_bytes) {
+    }
+
+    llvm::Expected<std::unique_ptr<llvm::MemoryBuffer>> operator()(llvm::Module &m) override {
+        auto object = (*compiler)(m);
+        if (object) {
+            *object_bytes += (*object)->getBufferSize();
+        }
+        return object;
+    }
+};
+
+}  // namespace
+
 class JITModuleContents {
 public:
     mutable RefCount ref_count;
@@ -151,6 +323,10 @@ public:
             auto err = dtorRunner->run();
             internal_assert(!err) << llvm::toString(std::move(err)) << "\n";
         }
+        if (shared_runtime_bytes) {
+            shared_runtime_bytes_linked -= shared_runtime_bytes;
+            shared_runtime_users--;
+        }
     }
 
     std::map<std::string, JITModule::Symbol> exports;
@@ -161,7 +337,17 @@ public:
     JITModule::Symbol entrypoint;
     JITModule::Symbol argv_entrypoint;
 
+    // Only set while compiling a module with HL_JIT_CACHE_DIR set.
+    std::unique_ptr<JITDiskCache> disk_cache;
+
     std::string name;
+
+    // The bytes of object code this module was compiled to.
+    size_t object_bytes = 0;
+
+    // The bytes of object code of the shared runtime modules this
+    // module was linked against, if any.
+    size_t shared_runtime_bytes = 0;
 };
 
 template<>
@@ -256,11 +442,33 @@ JITModule::JITModule() {
 JITModule::JITModule(const Module &m, const LoweredFunc &fn,
                      const std::vector<JITModule> &dependencies) {
     jit_module = new JITModuleContents();
-    std::unique_ptr<llvm::Module> llvm_module(compile_module_to_llvm_module(m, *jit_module->context));
+    std::unique_ptr<llvm::Module> llvm_module;
+    std::string cache_dir = get_env_variable("HL_JIT_CACHE_DIR");
+    if (!cache_dir.empty()) {
+        jit_module->disk_cache = std::make_unique<JITDiskCache>(cache_dir, m, fn.name);
+        llvm_module = jit_module->disk_cache->load(*jit_module->context);
+    }
+    if (!llvm_module) {
+        llvm_module = compile_module_to_llvm_module(m, *jit_module->context);
+        if (jit_module->disk_cache) {
+            jit_module->disk_cache->begin_store(*llvm_module);
+        }
+    }
     std::vector<JITModule> deps_with_runtime = dependencies;
     std::vector<JITModule> shared_runtime = JITSharedRuntime::get(llvm_module.get(), m.target());
     deps_with_runtime.insert(deps_with_runtime.end(), shared_runtime.begin(), shared_runtime.end());
     compile_module(std::move(llvm_module), fn.name, m.target(), deps_with_runtime);
+    for (const JITModule &runtime : shared_runtime) {
+        jit_module->shared_runtime_bytes += runtime.jit_module->object_bytes;
+    }
+    if (jit_module->shared_runtime_bytes) {
+        shared_runtime_bytes_linked += jit_module->shared_runtime_bytes;
+        shared_runtime_users++;
+        debug(1) << "JIT compiled " << fn.name << " to " << jit_module->object_bytes
+                 << " bytes, linked against " << jit_module->shared_runtime_bytes
+                 << " bytes of shared runtime\n";
+    }
+    jit_module->disk_cache.reset();
     // If -time-passes is in HL_LLVM_ARGS, this will print llvm passes time statstics otherwise its no-op.
     llvm::reportAndResetTimings();
 }
@@ -288,7 +496,7 @@ void JITModule::compile_module(std::unique_ptr<llvm::Module> m, const string &fu
     // Build TargetMachine
     llvm::orc::JITTargetMachineBuilder tm_builder(llvm::Triple(m->getTargetTriple()));
     tm_builder.setOptions(options);
-    tm_builder.setCodeGenOptLevel(CodeGenOptLevel::Aggressive);
+    tm_builder.setCodeGenOptLevel(llvm_fast_compile(*m) ? CodeGenOptLevel::Less : CodeGenOptLevel::Aggressive);
     if (target.arch == Target::Arch::RISCV) {
         tm_builder.setCodeModel(llvm::CodeModel::Medium);
     }
@@ -305,9 +513,14 @@ void JITModule::compile_module(std::unique_ptr<llvm::Module> m, const string &fu
     }
 
     // Create LLJIT
+    JITDiskCache *disk_cache = jit_module->disk_cache.get();
+    size_t *object_bytes = &jit_module->object_bytes;
     const auto compilerBuilder = [&](const llvm::orc::JITTargetMachineBuilder & /*jtmb*/)
         -> llvm::Expected<std::unique_ptr<llvm::orc::IRCompileLayer::IRCompiler>> {
-        return std::make_unique<llvm::orc::TMOwningSimpleCompiler>(std::move(*tm));
+        llvm::ObjectCache *object_cache = (disk_cache && disk_cache->is_storing()) ? disk_cache : nullptr;
+        return std::make_unique<ObjectSizeRecordingCompiler>(
+            std::make_unique<llvm::orc::TMOwningSimpleCompiler>(std::move(*tm), object_cache),
+            object_bytes);
     };
 
     llvm::orc::LLJITBuilderState::ObjectLinkingLayerCreator linkerBuilder;
@@ -346,8 +559,15 @@ void JITModule::compile_module(std::unique_ptr<llvm::Module> m, const string &fu
     internal_assert(gen) << llvm::toString(gen.takeError()) << "\n";
     JIT->getMainJITDylib().addGenerator(std::move(gen.get()));
 
-    llvm::orc::ThreadSafeModule tsm(std::move(m), std::move(jit_module->context));
-    auto err = JIT->addIRModule(std::move(tsm));
+    auto err = [&]() {
+        if (disk_cache && disk_cache->cached_object) {
+            // m is just a stub carrying the target options.
+            *object_bytes += disk_cache->cached_object->getBufferSize();
+            return JIT->addObjectFile(std::move(disk_cache->cached_object));
+        }
+        llvm::orc::ThreadSafeModule tsm(std::move(m), std::move(jit_module->context));
+        return JIT->addIRModule(std::move(tsm));
+    }();
     internal_assert(!err) << llvm::toString(std::move(err)) << "\n";
 
     // Resolve symbol dependencies
@@ -509,6 +729,25 @@ void JITModule::memoization_cache_set_size(int64_t size) const {
     }
 }
 
+void JITModule::memoization_cache_set_site_size(const std::string &pipeline_name, const std::string &func_name, int64_t size) const {
+    std::map<std::string, Symbol>::const_iterator f =
+        exports().find("halide_memoization_cache_set_site_size");
+    if (f != exports().end()) {
+        int result = (reinterpret_bits<int (*)(const char *, const char *, int64_t)>(f->second.address))(
+            pipeline_name.c_str(), func_name.empty() ? nullptr : func_name.c_str(), size);
+        user_assert(result == 0) << "Could not set a memoization cache budget for "
+                                 << pipeline_name << (func_name.empty() ? "" : ".") << func_name << "\n";
+    }
+}
+
+void JITModule::memoization_cache_set_eviction_policy(halide_memoization_cache_eviction_policy_t policy) const {
+    std::map<std::string, Symbol>::const_iterator f =
+        exports().find("halide_memoization_cache_set_eviction_policy");
+    if (f != exports().end()) {
+        (reinterpret_bits<int (*)(halide_memoization_cache_eviction_policy_t)>(f->second.address))(policy);
+    }
+}
+
 void JITModule::memoization_cache_evict(uint64_t eviction_key) const {
     std::map<std::string, Symbol>::const_iterator f =
         exports().find("halide_memoization_cache_evict");
@@ -517,6 +756,22 @@ void JITModule::memoization_cache_evict(uint64_t eviction_key) const {
     }
 }
 
+std::vector<halide_memoization_cache_stats_t> JITModule::memoization_cache_stats() const {
+    std::vector<halide_memoization_cache_stats_t> result;
+    std::map<std::string, Symbol>::const_iterator count =
+        exports().find("halide_memoization_cache_shard_count");
+    std::map<std::string, Symbol>::const_iterator get =
+        exports().find("halide_memoization_cache_get_stats");
+    if (count != exports().end() && get != exports().end()) {
+        int shards = (reinterpret_bits<int (*)()>(count->second.address))();
+        result.resize(shards);
+        for (int i = 0; i < shards; i++) {
+            (reinterpret_bits<int (*)(int, halide_memoization_cache_stats_t *)>(get->second.address))(i, &result[i]);
+        }
+    }
+    return result;
+}
+
 void JITModule::reuse_device_allocations(bool b) const {
     std::map<std::string, Symbol>::const_iterator f =
         exports().find("halide_reuse_device_allocations");
@@ -543,6 +798,51 @@ int JITModule::set_num_threads(int n) const {
     return 1;
 }
 
+halide_thread_pool_spin_t JITModule::set_thread_pool_spin_policy(halide_thread_pool_spin_t policy, int spin_us) const {
+    std::map<std::string, Symbol>::const_iterator f =
+        exports().find("halide_set_thread_pool_spin_policy");
+    if (f != exports().end()) {
+        return (reinterpret_bits<halide_thread_pool_spin_t (*)(halide_thread_pool_spin_t, int)>(f->second.address))(policy, spin_us);
+    }
+    return halide_thread_pool_spin_default;
+}
+
+halide_thread_pool_chunking_t JITModule::set_thread_pool_chunking(halide_thread_pool_chunking_t chunking) const {
+    std::map<std::string, Symbol>::const_iterator f =
+        exports().find("halide_set_thread_pool_chunking");
+    if (f != exports().end()) {
+        return (reinterpret_bits<halide_thread_pool_chunking_t (*)(halide_thread_pool_chunking_t)>(f->second.address))(chunking);
+    }
+    return halide_thread_pool_chunking_static;
+}
+
+int JITModule::set_thread_pool_qos(JITUserContext *context, int max_threads, int priority) const {
+    std::map<std::string, Symbol>::const_iterator f =
+        exports().find("halide_set_thread_pool_qos");
+    if (f != exports().end()) {
+        return (reinterpret_bits<int (*)(void *, int, int)>(f->second.address))(context, max_threads, priority);
+    }
+    return 0;
+}
+
+halide_thread_pool_creation_t JITModule::set_thread_pool_creation_policy(halide_thread_pool_creation_t policy) const {
+    std::map<std::string, Symbol>::const_iterator f =
+        exports().find("halide_set_thread_pool_creation_policy");
+    if (f != exports().end()) {
+        return (reinterpret_bits<halide_thread_pool_creation_t (*)(halide_thread_pool_creation_t)>(f->second.address))(policy);
+    }
+    return halide_thread_pool_create_eager;
+}
+
+int JITModule::thread_pool_prewarm() const {
+    std::map<std::string, Symbol>::const_iterator f =
+        exports().find("halide_thread_pool_prewarm");
+    if (f != exports().end()) {
+        return (reinterpret_bits<int (*)(void *)>(f->second.address))(nullptr);
+    }
+    return 0;
+}
+
 bool JITModule::compiled() const {
     return jit_module->JIT != nullptr;
 }
@@ -551,8 +851,9 @@ namespace {
 
 JITHandlers runtime_internal_handlers;
 JITHandlers default_handlers;
-JITHandlers active_handlers;
 int64_t default_cache_size;
+bool default_use_caching_allocator = false;
+
 
 void merge_handlers(JITHandlers &base, const JITHandlers &addins) {
     if (addins.custom_print) {
@@ -596,11 +897,34 @@ void merge_handlers(JITHandlers &base, const JITHandlers &addins) {
     }
 }
 
+// The runtime's handlers with the default handlers merged in. They're
+// read on every call, from any number of threads at once, so rather
+// than being guarded by a lock they're published as immutable
+// snapshots. Snapshots are only ever replaced, under
+// shared_runtimes_mutex, and never freed, as a call that's in flight
+// may still be reading the old one. Handlers are set rarely enough
+// that this doesn't add up to much.
+JITHandlers empty_handlers;
+std::atomic<const JITHandlers *> active_handlers_snapshot{&empty_handlers};
+
+const JITHandlers &active_handlers() {
+    return *active_handlers_snapshot.load(std::memory_order_acquire);
+}
+
+// Must be called with shared_runtimes_mutex held. The snapshot is
+// deliberately leaked, including at exit, as the runtime may still call
+// the handlers while static objects are being destroyed.
+void publish_active_handlers() {
+    JITHandlers *snapshot = new JITHandlers(runtime_internal_handlers);
+    merge_handlers(*snapshot, default_handlers);
+    active_handlers_snapshot.store(snapshot, std::memory_order_release);
+}
+
 void print_handler(JITUserContext *context, const char *msg) {
     if (context && context->handlers.custom_print) {
         context->handlers.custom_print(context, msg);
     } else {
-        active_handlers.custom_print(context, msg);
+        active_handlers().custom_print(context, msg);
     }
 }
 
@@ -608,7 +932,7 @@ void *malloc_handler(JITUserContext *context, size_t x) {
     if (context && context->handlers.custom_malloc) {
         return context->handlers.custom_malloc(context, x);
     } else {
-        return active_handlers.custom_malloc(context, x);
+        return active_handlers().custom_malloc(context, x);
     }
 }
 
@@ -616,7 +940,7 @@ void free_handler(JITUserContext *context, void *ptr) {
     if (context && context->handlers.custom_free) {
         context->handlers.custom_free(context, ptr);
     } else {
-        active_handlers.custom_free(context, ptr);
+        active_handlers().custom_free(context, ptr);
     }
 }
 
@@ -625,7 +949,7 @@ int do_task_handler(JITUserContext *context, int (*f)(JITUserContext *, int, uin
     if (context && context->handlers.custom_do_task) {
         return context->handlers.custom_do_task(context, f, idx, closure);
     } else {
-        return active_handlers.custom_do_task(context, f, idx, closure);
+        return active_handlers().custom_do_task(context, f, idx, closure);
     }
 }
 
@@ -634,7 +958,7 @@ int do_par_for_handler(JITUserContext *context, int (*f)(JITUserContext *, int,
     if (context && context->handlers.custom_do_par_for) {
         return context->handlers.custom_do_par_for(context, f, min, size, closure);
     } else {
-        return active_handlers.custom_do_par_for(context, f, min, size, closure);
+        return active_handlers().custom_do_par_for(context, f, min, size, closure);
     }
 }
 
@@ -642,7 +966,7 @@ void error_handler_handler(JITUserContext *context, const char *msg) {
     if (context && context->handlers.custom_error) {
         context->handlers.custom_error(context, msg);
     } else {
-        active_handlers.custom_error(context, msg);
+        active_handlers().custom_error(context, msg);
     }
 }
 
@@ -650,27 +974,27 @@ int32_t trace_handler(JITUserContext *context, const halide_trace_event_t *e) {
     if (context && context->handlers.custom_trace) {
         return context->handlers.custom_trace(context, e);
     } else {
-        return active_handlers.custom_trace(context, e);
+        return active_handlers().custom_trace(context, e);
     }
 }
 
 void *get_symbol_handler(const char *name) {
-    return (*active_handlers.custom_get_symbol)(name);
+    return (*active_handlers().custom_get_symbol)(name);
 }
 
 void *load_library_handler(const char *name) {
-    return (*active_handlers.custom_load_library)(name);
+    return (*active_handlers().custom_load_library)(name);
 }
 
 void *get_library_symbol_handler(void *lib, const char *name) {
-    return (*active_handlers.custom_get_library_symbol)(lib, name);
+    return (*active_handlers().custom_get_library_symbol)(lib, name);
 }
 
 int cuda_acquire_context_handler(JITUserContext *context, void **cuda_context_ptr, bool create) {
     if (context && context->handlers.custom_cuda_acquire_context) {
         return context->handlers.custom_cuda_acquire_context(context, cuda_context_ptr, create);
     } else {
-        return active_handlers.custom_cuda_acquire_context(context, cuda_context_ptr, create);
+        return active_handlers().custom_cuda_acquire_context(context, cuda_context_ptr, create);
     }
 }
 
@@ -678,7 +1002,7 @@ int cuda_release_context_handler(JITUserContext *context) {
     if (context && context->handlers.custom_cuda_release_context) {
         return context->handlers.custom_cuda_release_context(context);
     } else {
-        return active_handlers.custom_cuda_release_context(context);
+        return active_handlers().custom_cuda_release_context(context);
     }
 }
 
@@ -686,7 +1010,7 @@ int cuda_get_stream_handler(JITUserContext *context, void *cuda_context, void **
     if (context && context->handlers.custom_cuda_get_stream) {
         return context->handlers.custom_cuda_get_stream(context, cuda_context, cuda_stream_ptr);
     } else {
-        return active_handlers.custom_cuda_get_stream(context, cuda_context, cuda_stream_ptr);
+        return active_handlers().custom_cuda_get_stream(context, cuda_context, cuda_stream_ptr);
     }
 }
 
@@ -742,6 +1066,19 @@ enum RuntimeKind {
     MaxRuntimeKind
 };
 
+// Make the caching allocator of the runtime the one used when no custom
+// allocator is set. It isn't available on all platforms.
+void use_caching_allocator_handlers(const JITModule &runtime) {
+    auto m = runtime.exports().find("halide_caching_malloc");
+    auto f = runtime.exports().find("halide_caching_free");
+    if (m != runtime.exports().end() && f != runtime.exports().end()) {
+        runtime_internal_handlers.custom_malloc =
+            reinterpret_bits<void *(*)(JITUserContext *, size_t)>(m->second.address);
+        runtime_internal_handlers.custom_free =
+            reinterpret_bits<void (*)(JITUserContext *, void *)>(f->second.address);
+    }
+}
+
 JITModule &shared_runtimes(RuntimeKind k) {
     // We're already guarded by the shared_runtimes_mutex
     static JITModule *m = nullptr;
@@ -910,8 +1247,11 @@ JITModule &make_module(llvm::Module *for_module, Target target,
             runtime_internal_handlers.custom_get_library_symbol =
                 hook_function(runtime.exports(), "halide_set_custom_get_library_symbol", get_library_symbol_handler);
 
-            active_handlers = runtime_internal_handlers;
-            merge_handlers(active_handlers, default_handlers);
+            if (default_use_caching_allocator) {
+                use_caching_allocator_handlers(runtime);
+            }
+
+            publish_active_handlers();
 
             if (default_cache_size != 0) {
                 runtime.memoization_cache_set_size(default_cache_size);
@@ -943,8 +1283,7 @@ JITModule &make_module(llvm::Module *for_module, Target target,
                     runtime_internal_handlers.custom_cuda_get_stream =
                         hook_function(runtime.exports(), "halide_set_cuda_get_stream", cuda_get_stream_handler);
 
-                    active_handlers = runtime_internal_handlers;
-                    merge_handlers(active_handlers, default_handlers);
+                    publish_active_handlers();
                 } else if (runtime_kind == CUDA) {
                     // The CUDADebug module has already been created.
                     // Use the context in the CUDADebug module and add
@@ -1046,7 +1385,7 @@ std::vector<JITModule> JITSharedRuntime::get(llvm::Module *for_module, const Tar
 
 void JITSharedRuntime::populate_jit_handlers(JITUserContext *jit_user_context, const JITHandlers &handlers) {
     // Take the active global handlers
-    JITHandlers merged = active_handlers;
+    JITHandlers merged = active_handlers();
     // Clobber with any custom handlers set on the pipeline
     merge_handlers(merged, handlers);
     // Clobber with any custom handlers set on the call
@@ -1062,11 +1401,28 @@ void JITSharedRuntime::release_all() {
     }
 }
 
+JITSharedRuntimeStats JITSharedRuntime::stats() {
+    std::lock_guard<std::mutex> lock(shared_runtimes_mutex);
+
+    JITSharedRuntimeStats result;
+    for (int i = 0; i < MaxRuntimeKind; i++) {
+        const JITModule &runtime = shared_runtimes((RuntimeKind)i);
+        if (runtime.compiled()) {
+            result.runtime_modules++;
+            result.runtime_bytes += runtime.jit_module->object_bytes;
+        }
+    }
+    result.pipelines = shared_runtime_users;
+    const size_t linked = shared_runtime_bytes_linked;
+    result.bytes_saved = linked > result.runtime_bytes ? linked - result.runtime_bytes : 0;
+    return result;
+}
+
 JITHandlers JITSharedRuntime::set_default_handlers(const JITHandlers &handlers) {
+    std::lock_guard<std::mutex> lock(shared_runtimes_mutex);
     JITHandlers result = default_handlers;
     default_handlers = handlers;
-    active_handlers = runtime_internal_handlers;
-    merge_handlers(active_handlers, default_handlers);
+    publish_active_handlers();
     return result;
 }
 
@@ -1079,16 +1435,40 @@ void JITSharedRuntime::memoization_cache_set_size(int64_t size) {
     }
 }
 
+void JITSharedRuntime::memoization_cache_set_site_size(const std::string &pipeline_name, const std::string &func_name, int64_t size) {
+    std::lock_guard<std::mutex> lock(shared_runtimes_mutex);
+    shared_runtimes(MainShared).memoization_cache_set_site_size(pipeline_name, func_name, size);
+}
+
+void JITSharedRuntime::memoization_cache_set_eviction_policy(halide_memoization_cache_eviction_policy_t policy) {
+    std::lock_guard<std::mutex> lock(shared_runtimes_mutex);
+    shared_runtimes(MainShared).memoization_cache_set_eviction_policy(policy);
+}
+
 void JITSharedRuntime::memoization_cache_evict(uint64_t eviction_key) {
     std::lock_guard<std::mutex> lock(shared_runtimes_mutex);
     shared_runtimes(MainShared).memoization_cache_evict(eviction_key);
 }
 
+std::vector<halide_memoization_cache_stats_t> JITSharedRuntime::memoization_cache_stats() {
+    std::lock_guard<std::mutex> lock(shared_runtimes_mutex);
+    return shared_runtimes(MainShared).memoization_cache_stats();
+}
+
 void JITSharedRuntime::reuse_device_allocations(bool b) {
     std::lock_guard<std::mutex> lock(shared_runtimes_mutex);
     shared_runtimes(MainShared).reuse_device_allocations(b);
 }
 
+void JITSharedRuntime::use_caching_allocator() {
+    std::lock_guard<std::mutex> lock(shared_runtimes_mutex);
+    default_use_caching_allocator = true;
+    if (shared_runtimes(MainShared).compiled()) {
+        use_caching_allocator_handlers(shared_runtimes(MainShared));
+        publish_active_handlers();
+    }
+}
+
 int JITSharedRuntime::get_num_threads() {
     std::lock_guard<std::mutex> lock(shared_runtimes_mutex);
     return shared_runtimes(MainShared).get_num_threads();
@@ -1099,16 +1479,43 @@ int JITSharedRuntime::set_num_threads(int n) {
     return shared_runtimes(MainShared).set_num_threads(n);
 }
 
+halide_thread_pool_spin_t JITSharedRuntime::set_thread_pool_spin_policy(halide_thread_pool_spin_t policy, int spin_us) {
+    std::lock_guard<std::mutex> lock(shared_runtimes_mutex);
+    return shared_runtimes(MainShared).set_thread_pool_spin_policy(policy, spin_us);
+}
+
+halide_thread_pool_chunking_t JITSharedRuntime::set_thread_pool_chunking(halide_thread_pool_chunking_t chunking) {
+    std::lock_guard<std::mutex> lock(shared_runtimes_mutex);
+    return shared_runtimes(MainShared).set_thread_pool_chunking(chunking);
+}
+
+int JITSharedRuntime::set_thread_pool_qos(JITUserContext *context, int max_threads, int priority) {
+    std::lock_guard<std::mutex> lock(shared_runtimes_mutex);
+    return shared_runtimes(MainShared).set_thread_pool_qos(context, max_threads, priority);
+}
+
+halide_thread_pool_creation_t JITSharedRuntime::set_thread_pool_creation_policy(halide_thread_pool_creation_t policy) {
+    std::lock_guard<std::mutex> lock(shared_runtimes_mutex);
+    return shared_runtimes(MainShared).set_thread_pool_creation_policy(policy);
+}
+
+int JITSharedRuntime::thread_pool_prewarm() {
+    std::lock_guard<std::mutex> lock(shared_runtimes_mutex);
+    return shared_runtimes(MainShared).thread_pool_prewarm();
+}
+
 JITCache::JITCache(Target jit_target,
                    std::vector<Argument> arguments,
                    std::map<std::string, JITExtern> jit_externs,
                    JITModule jit_module,
-                   WasmModule wasm_module)
+                   WasmModule wasm_module,
+                   InterpretedModule interpreted_module)
     : jit_target(jit_target),  // clang-tidy complains that this is "trivially copyable" and std::move shouldn't be here, grr
       arguments(std::move(arguments)),
       jit_externs(std::move(jit_externs)),
       jit_module(std::move(jit_module)),
-      wasm_module(std::move(wasm_module)) {
+      wasm_module(std::move(wasm_module)),
+      interpreted_module(std::move(interpreted_module)) {
 }
 
 Target JITCache::get_compiled_jit_target() const {
@@ -1117,7 +1524,10 @@ Target JITCache::get_compiled_jit_target() const {
     // match what we expect.
     const bool has_wasm = wasm_module.contents.defined();
     const bool has_native = jit_module.compiled();
-    if (jit_target.arch == Target::WebAssembly) {
+    const bool has_interpreted = interpreted_module.contents.defined();
+    if (jit_target.has_feature(Target::JITInterp)) {
+        internal_assert(has_interpreted && !has_wasm && !has_native);
+    } else if (jit_target.arch == Target::WebAssembly) {
         internal_assert(has_wasm && !has_native);
     } else if (!jit_target.has_unknowns()) {
         internal_assert(!has_wasm && has_native);
@@ -1136,7 +1546,9 @@ int JITCache::call_jit_code(const void *const *args) {
                     "compilation for Halide code.";
 #endif
 #endif
-    if (get_compiled_jit_target().arch == Target::WebAssembly) {
+    if (get_compiled_jit_target().has_feature(Target::JITInterp)) {
+        return interpreted_module.run(args);
+    } else if (get_compiled_jit_target().arch == Target::WebAssembly) {
         internal_assert(wasm_module.contents.defined());
         return wasm_module.run(args);
     } else {
@@ -1155,6 +1567,17 @@ void JITCache::finish_profiling(JITUserContext *context) {
             void (*report_fn_ptr)(JITUserContext *) = (void (*)(JITUserContext *))(report_sym.address);
             report_fn_ptr(context);
 
+            void (*reset_fn_ptr)() = (void (*)())(reset_sym.address);
+            reset_fn_ptr();
+        }
+    }
+    if (jit_target.has_feature(Target::TrackAllocations)) {
+        JITModule::Symbol report_sym = jit_module.find_symbol_by_name("halide_allocation_tracker_report");
+        JITModule::Symbol reset_sym = jit_module.find_symbol_by_name("halide_allocation_tracker_reset");
+        if (report_sym.address && reset_sym.address) {
+            void (*report_fn_ptr)(JITUserContext *) = (void (*)(JITUserContext *))(report_sym.address);
+            report_fn_ptr(context);
+
             void (*reset_fn_ptr)() = (void (*)())(reset_sym.address);
             reset_fn_ptr();
         }
@@ -1211,13 +1634,17 @@ JITFuncCallContext::JITFuncCallContext(JITUserContext *context, const JITHandler
     JITSharedRuntime::populate_jit_handlers(context, pipeline_handlers);
     context->error_buffer = &error_buffer;
 
-    debug(2) << "custom_print: " << (void *)context->handlers.custom_print << "\n"
-             << "custom_malloc: " << (void *)context->handlers.custom_malloc << "\n"
-             << "custom_free: " << (void *)context->handlers.custom_free << "\n"
-             << "custom_do_task: " << (void *)context->handlers.custom_do_task << "\n"
-             << "custom_do_par_for: " << (void *)context->handlers.custom_do_par_for << "\n"
-             << "custom_error: " << (void *)context->handlers.custom_error << "\n"
-             << "custom_trace: " << (void *)context->handlers.custom_trace << "\n";
+    // This runs on every call, so skip formatting the handlers unless
+    // they're going to be printed.
+    if (debug::debug_level() >= 2) {
+        debug(2) << "custom_print: " << (void *)context->handlers.custom_print << "\n"
+                 << "custom_malloc: " << (void *)context->handlers.custom_malloc << "\n"
+                 << "custom_free: " << (void *)context->handlers.custom_free << "\n"
+                 << "custom_do_task: " << (void *)context->handlers.custom_do_task << "\n"
+                 << "custom_do_par_for: " << (void *)context->handlers.custom_do_par_for << "\n"
+                 << "custom_error: " << (void *)context->handlers.custom_error << "\n"
+                 << "custom_trace: " << (void *)context->handlers.custom_trace << "\n";
+    }
 }
 
 void JITFuncCallContext::finalize(int exit_status) {
@@ -10,6 +10,7 @@
 #include <memory>
 #include <vector>
 
+#include "IRInterpreter.h"
 #include "IntrusivePtr.h"
 #include "Target.h"
 #include "Type.h"
@@ -241,9 +242,18 @@ struct JITModule {
     /** See JITSharedRuntime::memoization_cache_set_size */
     void memoization_cache_set_size(int64_t size) const;
 
+    /** See JITSharedRuntime::memoization_cache_set_site_size */
+    void memoization_cache_set_site_size(const std::string &pipeline_name, const std::string &func_name, int64_t size) const;
+
+    /** See JITSharedRuntime::memoization_cache_set_eviction_policy */
+    void memoization_cache_set_eviction_policy(halide_memoization_cache_eviction_policy_t policy) const;
+
     /** See JITSharedRuntime::memoization_cache_evict */
     void memoization_cache_evict(uint64_t eviction_key) const;
 
+    /** See JITSharedRuntime::memoization_cache_stats */
+    std::vector<halide_memoization_cache_stats_t> memoization_cache_stats() const;
+
     /** See JITSharedRuntime::reuse_device_allocations */
     void reuse_device_allocations(bool) const;
 
@@ -253,10 +263,46 @@ struct JITModule {
     /** See JITSharedRuntime::set_num_threads */
     int set_num_threads(int) const;
 
+    /** See JITSharedRuntime::set_thread_pool_spin_policy */
+    halide_thread_pool_spin_t set_thread_pool_spin_policy(halide_thread_pool_spin_t policy, int spin_us) const;
+
+    /** See JITSharedRuntime::set_thread_pool_chunking */
+    halide_thread_pool_chunking_t set_thread_pool_chunking(halide_thread_pool_chunking_t chunking) const;
+
+    /** See JITSharedRuntime::set_thread_pool_qos */
+    int set_thread_pool_qos(JITUserContext *context, int max_threads, int priority) const;
+
+    /** See JITSharedRuntime::set_thread_pool_creation_policy */
+    halide_thread_pool_creation_t set_thread_pool_creation_policy(halide_thread_pool_creation_t policy) const;
+
+    /** See JITSharedRuntime::thread_pool_prewarm */
+    int thread_pool_prewarm() const;
+
     /** Return true if compile_module has been called on this module. */
     bool compiled() const;
 };
 
+/** Statistics for the runtime shared by JIT-compiled pipelines. See
+ * JITSharedRuntime::stats. */
+struct JITSharedRuntimeStats {
+    /** The number of shared runtime modules: the main one, plus one
+     * for each GPU API in use. */
+    int runtime_modules = 0;
+
+    /** The bytes of object code the shared runtime modules were
+     * compiled to. */
+    size_t runtime_bytes = 0;
+
+    /** The number of live JIT-compiled pipelines that link against the
+     * shared runtime. */
+    int pipelines = 0;
+
+    /** How many more bytes of object code there would be if each of
+     * those pipelines had its own copy of the runtime modules it
+     * uses. */
+    size_t bytes_saved = 0;
+};
+
 class JITSharedRuntime {
 public:
     // Note only the first llvm::Module passed in here is used. The same shared runtime is used for all JIT.
@@ -270,6 +316,22 @@ public:
      */
     static void memoization_cache_set_size(int64_t size);
 
+    /** Give the memoized Funcs of one pipeline, or a single memoized
+     * Func in it if func_name is non-empty, their own cache budget in
+     * bytes. The pipeline name is the name of its (first) output
+     * Func. Has no effect until the first pipeline has been JIT
+     * compiled. If you are compiling statically, you should include
+     * HalideRuntime.h and call halide_memoization_cache_set_site_size()
+     * instead.
+     */
+    static void memoization_cache_set_site_size(const std::string &pipeline_name, const std::string &func_name, int64_t size);
+
+    /** Choose how the memoization cache picks entries to evict. If you
+     * are compiling statically, you should include HalideRuntime.h and
+     * call halide_memoization_cache_set_eviction_policy() instead.
+     */
+    static void memoization_cache_set_eviction_policy(halide_memoization_cache_eviction_policy_t policy);
+
     /** Evict all cache entries that were tagged with the given
      * eviction_key in the memoize scheduling directive. If you are
      * compiling statically, you should include HalideRuntime.h and
@@ -277,6 +339,13 @@ public:
      */
     static void memoization_cache_evict(uint64_t eviction_key);
 
+    /** Get the hit, miss, and eviction statistics for each shard of
+     * the memoization cache. If you are compiling statically, you
+     * should include HalideRuntime.h and call
+     * halide_memoization_cache_get_stats() instead.
+     */
+    static std::vector<halide_memoization_cache_stats_t> memoization_cache_stats();
+
     /** Set whether or not Halide may hold onto and reuse device
      * allocations to avoid calling expensive device API allocation
      * functions. If you are compiling statically, you should include
@@ -284,6 +353,19 @@ public:
      * instead. */
     static void reuse_device_allocations(bool);
 
+    /** Make JIT-compiled pipelines that don't have a custom allocator
+     * use halide_caching_malloc and halide_caching_free instead of the
+     * default allocator, where the runtime provides them. Memory
+     * allocated by one can't be freed by the other, so call this
+     * before realizing anything. If you are compiling statically, you
+     * should include HalideRuntime.h and call
+     * halide_use_caching_allocator() instead. */
+    static void use_caching_allocator();
+
+    /** Get the size of the runtime shared by JIT-compiled pipelines,
+     * and how much memory sharing it saves. */
+    static JITSharedRuntimeStats stats();
+
     static void release_all();
 
     /** Get the number of threads in the Halide thread pool. Includes the
@@ -297,6 +379,45 @@ public:
      * avoid deadlock when using the async scheduling directive. Returns the old
      * number. */
     static int set_num_threads(int);
+
+    /** Set how idle threads of the Halide thread pool spin before they
+     * sleep. Has no effect until the first pipeline has been JIT
+     * compiled. If you are compiling statically, you should include
+     * HalideRuntime.h and call halide_set_thread_pool_spin_policy()
+     * instead. Returns the old policy. */
+    static halide_thread_pool_spin_t set_thread_pool_spin_policy(halide_thread_pool_spin_t policy, int spin_us);
+
+    /** Set how the threads of the Halide thread pool claim the
+     * iterations of parallel loops. Has no effect until the first
+     * pipeline has been JIT compiled. If you are compiling statically,
+     * you should include HalideRuntime.h and call
+     * halide_set_thread_pool_chunking() instead. Returns the old
+     * setting. */
+    static halide_thread_pool_chunking_t set_thread_pool_chunking(halide_thread_pool_chunking_t chunking);
+
+    /** Limit the threads of the Halide thread pool that the pipelines
+     * realized with this JITUserContext use at once, and set their
+     * priority over other pipelines. See halide_set_thread_pool_qos
+     * in HalideRuntime.h. Has no effect until the first pipeline has
+     * been JIT compiled. Returns zero on success. */
+    static int set_thread_pool_qos(JITUserContext *context, int max_threads, int priority);
+
+    /** Set when the Halide thread pool creates its worker threads:
+     * all of them when the first parallel loop runs, or as parallel
+     * loops need them. Has no effect until the first pipeline has been
+     * JIT compiled. If you are compiling statically, you should
+     * include HalideRuntime.h and call
+     * halide_set_thread_pool_creation_policy() instead. Returns the old
+     * setting. */
+    static halide_thread_pool_creation_t set_thread_pool_creation_policy(halide_thread_pool_creation_t policy);
+
+    /** Create all the worker threads of the Halide thread pool now,
+     * so that the first parallel loop doesn't pay for it. Has no
+     * effect until the first pipeline has been JIT compiled. If you
+     * are compiling statically, you should include HalideRuntime.h and
+     * call halide_thread_pool_prewarm() instead. Returns zero on
+     * success. */
+    static int thread_pool_prewarm();
 };
 
 void *get_symbol_address(const char *s);
@@ -308,13 +429,15 @@ struct JITCache {
     std::map<std::string, JITExtern> jit_externs;
     JITModule jit_module;
     WasmModule wasm_module;
+    InterpretedModule interpreted_module;
 
     JITCache() = default;
     JITCache(Target jit_target,
              std::vector<Argument> arguments,
              std::map<std::string, JITExtern> jit_externs,
              JITModule jit_module,
-             WasmModule wasm_module);
+             WasmModule wasm_module,
+             InterpretedModule interpreted_module = InterpretedModule());
 
     Target get_compiled_jit_target() const;
 
@@ -93,6 +93,7 @@ std::unique_ptr<llvm::Module> parse_bitcode_file(llvm::StringRef buf, llvm::LLVM
 DECLARE_CPP_INITMOD(alignment_128)
 DECLARE_CPP_INITMOD(alignment_32)
 DECLARE_CPP_INITMOD(alignment_64)
+DECLARE_CPP_INITMOD(allocation_tracker)
 DECLARE_CPP_INITMOD(allocation_cache)
 DECLARE_CPP_INITMOD(android_clock)
 DECLARE_CPP_INITMOD(android_host_cpu_count)
@@ -104,6 +105,9 @@ DECLARE_CPP_INITMOD(destructors)
 DECLARE_CPP_INITMOD(device_interface)
 DECLARE_CPP_INITMOD(errors)
 DECLARE_CPP_INITMOD(fake_get_symbol)
+DECLARE_CPP_INITMOD(fake_huge_pages)
+DECLARE_CPP_INITMOD(fake_numa)
+DECLARE_CPP_INITMOD(fake_perf_counters)
 DECLARE_CPP_INITMOD(fake_thread_pool)
 DECLARE_CPP_INITMOD(float16_t)
 DECLARE_CPP_INITMOD(fopen)
@@ -121,6 +125,9 @@ DECLARE_CPP_INITMOD(hexagon_host)
 DECLARE_CPP_INITMOD(ios_io)
 DECLARE_CPP_INITMOD(linux_clock)
 DECLARE_CPP_INITMOD(linux_host_cpu_count)
+DECLARE_CPP_INITMOD(linux_huge_pages)
+DECLARE_CPP_INITMOD(linux_numa)
+DECLARE_CPP_INITMOD(linux_perf_counters)
 DECLARE_CPP_INITMOD(linux_yield)
 DECLARE_CPP_INITMOD(module_aot_ref_count)
 DECLARE_CPP_INITMOD(module_jit_ref_count)
@@ -133,6 +140,7 @@ DECLARE_CPP_INITMOD(osx_host_cpu_count)
 DECLARE_CPP_INITMOD(osx_yield)
 DECLARE_CPP_INITMOD(posix_aligned_alloc)
 DECLARE_CPP_INITMOD(posix_allocator)
+DECLARE_CPP_INITMOD(posix_caching_allocator)
 DECLARE_CPP_INITMOD(posix_clock)
 DECLARE_CPP_INITMOD(posix_error_handler)
 DECLARE_CPP_INITMOD(posix_get_symbol)
@@ -144,6 +152,7 @@ DECLARE_CPP_INITMOD(posix_timer_profiler)
 DECLARE_CPP_INITMOD(prefetch)
 DECLARE_CPP_INITMOD(profiler)
 DECLARE_CPP_INITMOD(profiler_inlined)
+DECLARE_CPP_INITMOD(profiler_light)
 DECLARE_CPP_INITMOD(pseudostack)
 DECLARE_CPP_INITMOD(qurt_allocator)
 DECLARE_CPP_INITMOD(qurt_hvx)
@@ -152,6 +161,7 @@ DECLARE_CPP_INITMOD(qurt_threads)
 DECLARE_CPP_INITMOD(qurt_threads_tsan)
 DECLARE_CPP_INITMOD(qurt_yield)
 DECLARE_CPP_INITMOD(runtime_api)
+DECLARE_CPP_INITMOD(size_variants)
 DECLARE_CPP_INITMOD(timer_profiler)
 DECLARE_CPP_INITMOD(to_string)
 DECLARE_CPP_INITMOD(trace_helper)
@@ -199,6 +209,7 @@ DECLARE_NO_INITMOD(metal_objc_x86)
 DECLARE_LL_INITMOD(arm)
 DECLARE_LL_INITMOD(arm_no_neon)
 DECLARE_CPP_INITMOD(arm_cpu_features)
+DECLARE_CPP_INITMOD(batch)
 DECLARE_CPP_INITMOD(linux_arm_cpu_features)
 DECLARE_CPP_INITMOD(osx_arm_cpu_features)
 #else
@@ -899,6 +910,7 @@ std::unique_ptr<llvm::Module> get_initial_module_for_target(Target t, llvm::LLVM
             // OS-dependent modules
             if (t.os == Target::Linux) {
                 add_allocator();
+                modules.push_back(get_initmod_posix_caching_allocator(c, bits_64, debug));
                 modules.push_back(get_initmod_posix_allocator(c, bits_64, debug));
                 modules.push_back(get_initmod_posix_error_handler(c, bits_64, debug));
                 modules.push_back(get_initmod_posix_print(c, bits_64, debug));
@@ -909,6 +921,8 @@ std::unique_ptr<llvm::Module> get_initial_module_for_target(Target t, llvm::LLVM
                 }
                 modules.push_back(get_initmod_posix_io(c, bits_64, debug));
                 modules.push_back(get_initmod_linux_host_cpu_count(c, bits_64, debug));
+                modules.push_back(get_initmod_linux_numa(c, bits_64, debug));
+                modules.push_back(get_initmod_linux_huge_pages(c, bits_64, debug));
                 modules.push_back(get_initmod_linux_yield(c, bits_64, debug));
                 if (tsan) {
                     modules.push_back(get_initmod_posix_threads_tsan(c, bits_64, debug));
@@ -926,6 +940,8 @@ std::unique_ptr<llvm::Module> get_initial_module_for_target(Target t, llvm::LLVM
                 modules.push_back(get_initmod_linux_yield(c, bits_64, debug));
                 if (t.has_feature(Target::WasmThreads)) {
                     // Assume that the wasm libc will be providing pthreads
+                    modules.push_back(get_initmod_fake_numa(c, bits_64, debug));
+                    modules.push_back(get_initmod_fake_huge_pages(c, bits_64, debug));
                     modules.push_back(get_initmod_posix_threads(c, bits_64, debug));
                 } else {
                     modules.push_back(get_initmod_fake_thread_pool(c, bits_64, debug));
@@ -933,11 +949,14 @@ std::unique_ptr<llvm::Module> get_initial_module_for_target(Target t, llvm::LLVM
                 modules.push_back(get_initmod_fake_get_symbol(c, bits_64, debug));
             } else if (t.os == Target::OSX) {
                 add_allocator();
+                modules.push_back(get_initmod_posix_caching_allocator(c, bits_64, debug));
                 modules.push_back(get_initmod_posix_error_handler(c, bits_64, debug));
                 modules.push_back(get_initmod_posix_print(c, bits_64, debug));
                 modules.push_back(get_initmod_osx_clock(c, bits_64, debug));
                 modules.push_back(get_initmod_posix_io(c, bits_64, debug));
                 modules.push_back(get_initmod_osx_host_cpu_count(c, bits_64, debug));
+                modules.push_back(get_initmod_fake_numa(c, bits_64, debug));
+                modules.push_back(get_initmod_fake_huge_pages(c, bits_64, debug));
                 modules.push_back(get_initmod_osx_yield(c, bits_64, debug));
                 if (tsan) {
                     modules.push_back(get_initmod_posix_threads_tsan(c, bits_64, debug));
@@ -948,6 +967,7 @@ std::unique_ptr<llvm::Module> get_initial_module_for_target(Target t, llvm::LLVM
                 modules.push_back(get_initmod_osx_host_cpu_count(c, bits_64, debug));
             } else if (t.os == Target::Android) {
                 add_allocator();
+                modules.push_back(get_initmod_posix_caching_allocator(c, bits_64, debug));
                 modules.push_back(get_initmod_posix_error_handler(c, bits_64, debug));
                 modules.push_back(get_initmod_posix_print(c, bits_64, debug));
                 if (t.arch == Target::ARM || t.arch == Target::RISCV) {
@@ -957,6 +977,8 @@ std::unique_ptr<llvm::Module> get_initial_module_for_target(Target t, llvm::LLVM
                 }
                 modules.push_back(get_initmod_android_io(c, bits_64, debug));
                 modules.push_back(get_initmod_android_host_cpu_count(c, bits_64, debug));
+                modules.push_back(get_initmod_linux_numa(c, bits_64, debug));
+                modules.push_back(get_initmod_linux_huge_pages(c, bits_64, debug));
                 modules.push_back(get_initmod_linux_yield(c, bits_64, debug));  // TODO: verify
                 if (tsan) {
                     modules.push_back(get_initmod_posix_threads_tsan(c, bits_64, debug));
@@ -972,6 +994,8 @@ std::unique_ptr<llvm::Module> get_initial_module_for_target(Target t, llvm::LLVM
                 modules.push_back(get_initmod_windows_clock(c, bits_64, debug));
                 modules.push_back(get_initmod_windows_io(c, bits_64, debug));
                 modules.push_back(get_initmod_windows_yield(c, bits_64, debug));
+                modules.push_back(get_initmod_fake_numa(c, bits_64, debug));
+                modules.push_back(get_initmod_fake_huge_pages(c, bits_64, debug));
                 if (tsan) {
                     modules.push_back(get_initmod_windows_threads_tsan(c, bits_64, debug));
                 } else {
@@ -980,11 +1004,14 @@ std::unique_ptr<llvm::Module> get_initial_module_for_target(Target t, llvm::LLVM
                 modules.push_back(get_initmod_windows_get_symbol(c, bits_64, debug));
             } else if (t.os == Target::IOS) {
                 add_allocator();
+                modules.push_back(get_initmod_posix_caching_allocator(c, bits_64, debug));
                 modules.push_back(get_initmod_posix_error_handler(c, bits_64, debug));
                 modules.push_back(get_initmod_posix_print(c, bits_64, debug));
                 modules.push_back(get_initmod_posix_clock(c, bits_64, debug));
                 modules.push_back(get_initmod_ios_io(c, bits_64, debug));
                 modules.push_back(get_initmod_osx_host_cpu_count(c, bits_64, debug));
+                modules.push_back(get_initmod_fake_numa(c, bits_64, debug));
+                modules.push_back(get_initmod_fake_huge_pages(c, bits_64, debug));
                 modules.push_back(get_initmod_osx_yield(c, bits_64, debug));
                 if (tsan) {
                     modules.push_back(get_initmod_posix_threads_tsan(c, bits_64, debug));
@@ -995,6 +1022,8 @@ std::unique_ptr<llvm::Module> get_initial_module_for_target(Target t, llvm::LLVM
                 modules.push_back(get_initmod_posix_aligned_alloc(c, bits_64, debug));
                 modules.push_back(get_initmod_qurt_allocator(c, bits_64, debug));
                 modules.push_back(get_initmod_qurt_yield(c, bits_64, debug));
+                modules.push_back(get_initmod_fake_numa(c, bits_64, debug));
+                modules.push_back(get_initmod_fake_huge_pages(c, bits_64, debug));
                 if (tsan) {
                     modules.push_back(get_initmod_qurt_threads_tsan(c, bits_64, debug));
                 } else {
@@ -1019,12 +1048,15 @@ std::unique_ptr<llvm::Module> get_initial_module_for_target(Target t, llvm::LLVM
                 modules.push_back(get_initmod_fake_thread_pool(c, bits_64, debug));
             } else if (t.os == Target::Fuchsia) {
                 add_allocator();
+                modules.push_back(get_initmod_posix_caching_allocator(c, bits_64, debug));
                 modules.push_back(get_initmod_posix_error_handler(c, bits_64, debug));
                 modules.push_back(get_initmod_posix_print(c, bits_64, debug));
                 modules.push_back(get_initmod_fuchsia_clock(c, bits_64, debug));
                 modules.push_back(get_initmod_posix_io(c, bits_64, debug));
                 modules.push_back(get_initmod_fuchsia_host_cpu_count(c, bits_64, debug));
                 modules.push_back(get_initmod_fuchsia_yield(c, bits_64, debug));
+                modules.push_back(get_initmod_fake_numa(c, bits_64, debug));
+                modules.push_back(get_initmod_fake_huge_pages(c, bits_64, debug));
                 if (tsan) {
                     modules.push_back(get_initmod_posix_threads_tsan(c, bits_64, debug));
                 } else {
@@ -1068,6 +1100,7 @@ std::unique_ptr<llvm::Module> get_initial_module_for_target(Target t, llvm::LLVM
                 modules.push_back(get_initmod_cache(c, bits_64, debug));
             }
             modules.push_back(get_initmod_to_string(c, bits_64, debug));
+            modules.push_back(get_initmod_batch(c, bits_64, debug));
 
             if (t.arch == Target::Hexagon ||
                 t.has_feature(Target::HVX)) {
@@ -1100,6 +1133,14 @@ std::unique_ptr<llvm::Module> get_initial_module_for_target(Target t, llvm::LLVM
 
             // Some environments don't support the atomics the profiler requires.
             if (t.os != Target::NoOS && t.os != Target::QuRT) {
+                // Like the profiler, the light profiler is included even
+                // if this target doesn't use it, as pipelines using it may
+                // be linked against this runtime.
+                user_assert(!t.has_feature(Target::ProfileLight) ||
+                            (!t.has_feature(Target::Profile) && !t.has_feature(Target::ProfileByTimer)))
+                    << "Can only use one of Target::Profile, Target::ProfileByTimer and Target::ProfileLight.";
+                modules.push_back(get_initmod_profiler_light(c, bits_64, debug));
+                modules.push_back(get_initmod_allocation_tracker(c, bits_64, debug));
                 if (t.has_feature(Target::ProfileByTimer)) {
                     user_assert(!t.has_feature(Target::Profile)) << "Can only use one of Target::Profile and Target::ProfileByTimer.";
                     // TODO(zvookin): This should work on all Posix like systems, but needs to be tested.
@@ -1114,6 +1155,14 @@ std::unique_ptr<llvm::Module> get_initial_module_for_target(Target t, llvm::LLVM
                         modules.push_back(get_initmod_profiler(c, bits_64, debug));
                     }
                 }
+                // Reading the hardware performance counters uses the
+                // perf_event_open syscall, whose number is only hard-coded
+                // for x86.
+                if (t.os == Target::Linux && t.arch == Target::X86) {
+                    modules.push_back(get_initmod_linux_perf_counters(c, bits_64, debug));
+                } else {
+                    modules.push_back(get_initmod_fake_perf_counters(c, bits_64, debug));
+                }
             }
 
 #ifdef HALIDE_INTERNAL_USING_MSAN
@@ -1198,9 +1247,12 @@ std::unique_ptr<llvm::Module> get_initial_module_for_target(Target t, llvm::LLVM
             }
         }
 
-        if (module_type == ModuleAOT) {
-            // These modules are only used for AOT compilation
+        if (module_type == ModuleAOT || module_type == ModuleJITShared) {
+            // These modules are used by multitarget wrappers, and by the
+            // checks for Stage::specialize_target_features.
             modules.push_back(get_initmod_can_use_target(c, bits_64, debug));
+            // Used by the wrappers of pipelines built with size variants.
+            modules.push_back(get_initmod_size_variants(c, bits_64, debug));
             if (t.arch == Target::X86) {
                 modules.push_back(get_initmod_x86_cpu_features(c, bits_64, debug));
             }
@@ -1389,6 +1441,192 @@ std::unique_ptr<llvm::Module> get_initial_module_for_ptx_device(Target target, l
 }
 #endif
 
+namespace {
+
+// The functions and global variables reachable from a set of roots,
+// through the instructions of functions and the initializers of
+// globals.
+class GlobalReferences {
+    std::set<const llvm::GlobalValue *> reached;
+    std::vector<const llvm::GlobalValue *> pending;
+    std::set<const llvm::Constant *> visited;
+
+    void visit(const llvm::Constant *c) {
+        if (const auto *gv = llvm::dyn_cast<llvm::GlobalValue>(c)) {
+            add(gv);
+        } else if (visited.insert(c).second) {
+            for (const llvm::Use &op : c->operands()) {
+                if (const auto *k = llvm::dyn_cast<llvm::Constant>(op.get())) {
+                    visit(k);
+                }
+            }
+        }
+    }
+
+public:
+    void add(const llvm::GlobalValue *gv) {
+        if (reached.insert(gv).second) {
+            pending.push_back(gv);
+        }
+    }
+
+    // Follow the references of everything added so far.
+    void propagate() {
+        while (!pending.empty()) {
+            const llvm::GlobalValue *gv = pending.back();
+            pending.pop_back();
+            if (const auto *f = llvm::dyn_cast<llvm::Function>(gv)) {
+                for (const llvm::BasicBlock &b : *f) {
+                    for (const llvm::Instruction &i : b) {
+                        for (const llvm::Use &op : i.operands()) {
+                            if (const auto *k = llvm::dyn_cast<llvm::Constant>(op.get())) {
+                                visit(k);
+                            }
+                        }
+                    }
+                }
+            } else if (const auto *var = llvm::dyn_cast<llvm::GlobalVariable>(gv)) {
+                if (var->hasInitializer()) {
+                    visit(var->getInitializer());
+                }
+            } else if (const auto *alias = llvm::dyn_cast<llvm::GlobalAlias>(gv)) {
+                visit(alias->getAliasee());
+            }
+        }
+    }
+
+    bool reaches(const llvm::GlobalValue *gv) const {
+        return reached.count(gv) != 0;
+    }
+
+    // Whether this reaches any mutable global variable that other does.
+    bool shares_state_with(const GlobalReferences &other) const {
+        for (const llvm::GlobalValue *gv : reached) {
+            const auto *var = llvm::dyn_cast<llvm::GlobalVariable>(gv);
+            if (var && !var->isConstant() && other.reaches(var)) {
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
+// The functions in the entries of llvm.global_ctors or llvm.global_dtors.
+vector<llvm::Function *> get_structors(llvm::Module &module, const char *name) {
+    vector<llvm::Function *> result;
+    llvm::GlobalVariable *structors = module.getNamedGlobal(name);
+    if (!structors || !structors->hasInitializer()) {
+        return result;
+    }
+    if (auto *entries = llvm::dyn_cast<llvm::ConstantArray>(structors->getInitializer())) {
+        for (const llvm::Use &entry : entries->operands()) {
+            auto *fields = llvm::cast<llvm::ConstantStruct>(entry.get());
+            result.push_back(llvm::dyn_cast<llvm::Function>(fields->getOperand(1)->stripPointerCasts()));
+        }
+    }
+    return result;
+}
+
+// Remove the entries of llvm.global_ctors or llvm.global_dtors whose
+// functions are in dropped.
+void remove_structors(llvm::Module &module, const char *name, const std::set<llvm::Function *> &dropped) {
+    llvm::GlobalVariable *structors = module.getNamedGlobal(name);
+    if (!structors || !structors->hasInitializer()) {
+        return;
+    }
+    auto *entries = llvm::dyn_cast<llvm::ConstantArray>(structors->getInitializer());
+    if (!entries) {
+        return;
+    }
+    vector<llvm::Constant *> kept;
+    for (const llvm::Use &entry : entries->operands()) {
+        auto *fields = llvm::cast<llvm::ConstantStruct>(entry.get());
+        auto *f = llvm::dyn_cast<llvm::Function>(fields->getOperand(1)->stripPointerCasts());
+        if (!dropped.count(f)) {
+            kept.push_back(fields);
+        }
+    }
+    if (kept.size() == entries->getNumOperands()) {
+        return;
+    }
+    if (!kept.empty()) {
+        llvm::ArrayType *type = llvm::ArrayType::get(entries->getType()->getElementType(), kept.size());
+        auto *replacement = new llvm::GlobalVariable(module, type, structors->isConstant(),
+                                                     structors->getLinkage(),
+                                                     llvm::ConstantArray::get(type, kept));
+        replacement->takeName(structors);
+    }
+    structors->eraseFromParent();
+}
+
+}  // namespace
+
+void strip_unused_runtime(llvm::Module &module, const std::set<std::string> &runtime_functions) {
+    const auto is_runtime = [&](const llvm::Function &f) {
+        return runtime_functions.count(get_llvm_function_name(f)) != 0;
+    };
+
+    GlobalReferences used;
+    for (const llvm::Function &f : module) {
+        if (!f.isDeclaration() && !is_runtime(f)) {
+            used.add(&f);
+        }
+    }
+    for (const llvm::GlobalVariable &gv : module.globals()) {
+        // The globals the module itself defines, e.g. embedded buffers.
+        if (!gv.isDeclaration() && !gv.isDiscardableIfUnused() &&
+            !gv.getName().starts_with("llvm.")) {
+            used.add(&gv);
+        }
+    }
+    used.propagate();
+
+    // A constructor or destructor of the runtime that touches state that
+    // is used stays, along with everything it uses. This may make others
+    // touch state that is used, so repeat until nothing changes.
+    vector<llvm::Function *> structors = get_structors(module, "llvm.global_ctors");
+    vector<llvm::Function *> dtors = get_structors(module, "llvm.global_dtors");
+    structors.insert(structors.end(), dtors.begin(), dtors.end());
+    std::set<llvm::Function *> dropped;
+    for (llvm::Function *f : structors) {
+        if (f && is_runtime(*f)) {
+            dropped.insert(f);
+        }
+    }
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (auto it = dropped.begin(); it != dropped.end();) {
+            GlobalReferences refs;
+            refs.add(*it);
+            refs.propagate();
+            if (used.reaches(*it) || refs.shares_state_with(used)) {
+                used.add(*it);
+                used.propagate();
+                it = dropped.erase(it);
+                changed = true;
+            } else {
+                ++it;
+            }
+        }
+    }
+    remove_structors(module, "llvm.global_ctors", dropped);
+    remove_structors(module, "llvm.global_dtors", dropped);
+
+    // Everything else of the runtime may now be dropped by LLVM, if
+    // nothing refers to it.
+    for (llvm::Function &f : module) {
+        if (!f.isDeclaration() && is_runtime(f) && !used.reaches(&f)) {
+            convert_weak_to_linkonce(f);
+        }
+    }
+    for (llvm::GlobalVariable &gv : module.globals()) {
+        if (!used.reaches(&gv)) {
+            convert_weak_to_linkonce(gv);
+        }
+    }
+}
+
 void add_bitcode_to_module(llvm::LLVMContext *context, llvm::Module &module,
                            const std::vector<uint8_t> &bitcode, const std::string &name) {
     llvm::StringRef sb = llvm::StringRef((const char *)&bitcode[0], bitcode.size());
@@ -6,6 +6,7 @@
  */
 
 #include <memory>
+#include <set>
 #include <string>
 #include <vector>
 
@@ -31,6 +32,15 @@ std::unique_ptr<llvm::Module> get_initial_module_for_target(Target, llvm::LLVMCo
 /** Create an llvm module containing the support code for ptx device. */
 std::unique_ptr<llvm::Module> get_initial_module_for_ptx_device(Target, llvm::LLVMContext *c);
 
+/** For Target::StripUnusedRuntime: let LLVM drop the parts of the
+ * runtime the code generated for a module doesn't use, including the
+ * public halide_ functions, which are otherwise always kept. The
+ * runtime is the functions named in runtime_functions; every other
+ * function defined in the module uses what it refers to, directly or
+ * not. Constructors and destructors of the runtime are kept only if they
+ * touch the state of something that is used. */
+void strip_unused_runtime(llvm::Module &module, const std::set<std::string> &runtime_functions);
+
 /** Link a block of llvm bitcode into an llvm module. */
 void add_bitcode_to_module(llvm::LLVMContext *context, llvm::Module &module,
                            const std::vector<uint8_t> &bitcode, const std::string &name);
@@ -180,6 +180,185 @@ Expr step_forwards(Expr e, const Scope<Expr> &linear) {
     }
 }
 
+/** Loads in a Stmt that are safe to carry, grouped into sets of equal
+ * loads, and chains of indices into those sets where each load will be
+ * the next one's value on the next step of the variables in the linear
+ * scope. */
+struct CarryChains {
+    vector<vector<const Load *>> loads;
+    vector<vector<int>> chains;
+};
+
+/** Find the chains of carried loads in a Stmt with lets substituted
+ * in. Keeps at most max_carried_values loads across all chains, longest
+ * chains first. */
+CarryChains find_carry_chains(const Stmt &graph_stmt, const Scope<Expr> &linear,
+                              const Scope<> &in_consume, int max_carried_values) {
+    // Find all the loads in these stmts.
+    FindLoads find_loads;
+    graph_stmt.accept(&find_loads);
+
+    debug(4) << "Found " << find_loads.result.size() << " loads\n";
+
+    // Group equal loads
+    vector<vector<const Load *>> loads;
+    for (const Load *load : find_loads.result) {
+        // Check if it's safe to lift out.
+        bool safe = (load->image.defined() ||
+                     load->param.defined() ||
+                     in_consume.contains(load->name));
+        if (!safe) {
+            continue;
+        }
+
+        bool represented = false;
+        for (vector<const Load *> &v : loads) {
+            if (graph_equal(Expr(load), Expr(v[0]))) {
+                v.push_back(load);
+                represented = true;
+            }
+        }
+        if (!represented) {
+            loads.push_back({load});
+        }
+    }
+
+    // For each load, move the load index forwards by one loop iteration
+    vector<Expr> indices, next_indices, predicates, next_predicates;
+    // CSE-d versions of the above, so can_prove can be safely used on them.
+    vector<Expr> indices_csed, next_indices_csed, predicates_csed, next_predicates_csed;
+    for (const vector<const Load *> &v : loads) {
+        indices.push_back(v[0]->index);
+        next_indices.push_back(step_forwards(v[0]->index, linear));
+        predicates.push_back(v[0]->predicate);
+        next_predicates.push_back(step_forwards(v[0]->predicate, linear));
+
+        if (indices.back().defined()) {
+            indices_csed.push_back(common_subexpression_elimination(indices.back()));
+        } else {
+            indices_csed.emplace_back();
+        }
+        if (next_indices.back().defined()) {
+            next_indices_csed.push_back(common_subexpression_elimination(next_indices.back()));
+        } else {
+            next_indices_csed.emplace_back();
+        }
+        if (predicates.back().defined()) {
+            predicates_csed.push_back(common_subexpression_elimination(predicates.back()));
+        } else {
+            predicates_csed.emplace_back();
+        }
+        if (next_predicates.back().defined()) {
+            next_predicates_csed.push_back(common_subexpression_elimination(next_predicates.back()));
+        } else {
+            next_predicates_csed.emplace_back();
+        }
+    }
+
+    // Find loads done on this loop iteration that will be
+    // reusable as some other Expr on the next loop iteration.
+    vector<vector<int>> chains;
+    for (int i = 0; i < (int)indices.size(); i++) {
+        for (int j = 0; j < (int)indices.size(); j++) {
+            // Don't catch loop invariants here.
+            if (i == j) {
+                continue;
+            }
+            // can_prove is stronger than graph_equal, because it doesn't require index expressions to be
+            // exactly the same, but evaluate to the same value. We keep the graph_equal check, because
+            // it's faster and should be executed before the more expensive check.
+            if (loads[i][0]->name == loads[j][0]->name &&
+                next_indices[j].defined() &&
+                (graph_equal(indices[i], next_indices[j]) ||
+                 ((indices[i].type() == next_indices[j].type()) && can_prove(indices_csed[i] == next_indices_csed[j]))) &&
+                next_predicates[j].defined() &&
+                (graph_equal(predicates[i], next_predicates[j]) ||
+                 ((predicates[i].type() == next_predicates[j].type()) && can_prove(predicates_csed[i] == next_predicates_csed[j])))) {
+                chains.push_back({j, i});
+                debug(3) << "Found carried value:\n"
+                         << i << ":  -> " << Expr(loads[i][0]) << "\n"
+                         << j << ":  -> " << Expr(loads[j][0]) << "\n";
+            }
+        }
+    }
+
+    if (chains.empty()) {
+        return {};
+    }
+
+    // Agglomerate chains of carries
+    bool done = false;
+    while (!done) {
+        done = true;
+        for (size_t i = 0; i < chains.size(); i++) {
+            if (chains[i].empty()) {
+                continue;
+            }
+            for (size_t j = 0; j < chains.size(); j++) {
+                if (chains[j].empty()) {
+                    continue;
+                }
+                if (chains[i].back() == chains[j].front()) {
+                    chains[i].insert(chains[i].end(), chains[j].begin() + 1, chains[j].end());
+                    chains[j].clear();
+                    done = false;
+                }
+            }
+        }
+
+        for (size_t i = 0; i < chains.size(); i++) {
+            while (i < chains.size() && chains[i].empty()) {
+                chains[i].swap(chains.back());
+                chains.pop_back();
+            }
+        }
+    }
+
+    // Sort the carry chains by decreasing order of size. The
+    // longest ones get the most reuse of each value.
+    //
+    // Use of stable_sort is just so that IR generated by different C++ compilers
+    // is identical; it doesn't appear to make any meaningful difference
+    // in code output, but makes debugging IR output easier to deal with.
+    std::stable_sort(chains.begin(), chains.end(),
+                     [&](const vector<int> &c1, const vector<int> &c2) { return c1.size() > c2.size(); });
+
+    for (const vector<int> &c : chains) {
+        debug(3) << "Found chain of carried values:\n";
+        for (int i : c) {
+            debug(3) << i << ":  <- " << indices[i] << "\n";
+        }
+    }
+
+    // Only keep the top N carried values. Otherwise we'll just
+    // spray stack spills everywhere. This is ugly, because we're
+    // relying on a heuristic.
+    vector<vector<int>> trimmed;
+    size_t sz = 0;
+    for (const vector<int> &c : chains) {
+        if (sz + c.size() > (size_t)max_carried_values) {
+            if (sz < (size_t)max_carried_values - 1) {
+                // Take a partial chain
+                trimmed.emplace_back(c.begin(), c.begin() + max_carried_values - sz);
+            }
+            break;
+        }
+        trimmed.push_back(c);
+        sz += c.size();
+    }
+    return {std::move(loads), std::move(trimmed)};
+}
+
+/** A scratch buffer holding carried values, and the stores that
+ * populate it before the first loop iteration. */
+struct ScratchAllocation {
+    string name;
+    Type type;
+    MemoryType memory_type;
+    Expr size;
+    Stmt initial_stores;
+};
+
 /** Carry loads over a single For loop body. */
 class LoopCarryOverLoop : public IRMutator {
     // Track vars that step linearly with loop iterations
@@ -251,159 +430,12 @@ class LoopCarryOverLoop : public IRMutator {
         // exponential runtime.
         Stmt graph_stmt = substitute_in_all_lets(orig_stmt);
 
-        // Find all the loads in these stmts.
-        FindLoads find_loads;
-        graph_stmt.accept(&find_loads);
-
-        debug(4) << "Found " << find_loads.result.size() << " loads\n";
-
-        // Group equal loads
-        vector<vector<const Load *>> loads;
-        for (const Load *load : find_loads.result) {
-            // Check if it's safe to lift out.
-            bool safe = (load->image.defined() ||
-                         load->param.defined() ||
-                         in_consume.contains(load->name));
-            if (!safe) {
-                continue;
-            }
-
-            bool represented = false;
-            for (vector<const Load *> &v : loads) {
-                if (graph_equal(Expr(load), Expr(v[0]))) {
-                    v.push_back(load);
-                    represented = true;
-                }
-            }
-            if (!represented) {
-                loads.push_back({load});
-            }
-        }
-
-        // For each load, move the load index forwards by one loop iteration
-        vector<Expr> indices, next_indices, predicates, next_predicates;
-        // CSE-d versions of the above, so can_prove can be safely used on them.
-        vector<Expr> indices_csed, next_indices_csed, predicates_csed, next_predicates_csed;
-        for (const vector<const Load *> &v : loads) {
-            indices.push_back(v[0]->index);
-            next_indices.push_back(step_forwards(v[0]->index, linear));
-            predicates.push_back(v[0]->predicate);
-            next_predicates.push_back(step_forwards(v[0]->predicate, linear));
-
-            if (indices.back().defined()) {
-                indices_csed.push_back(common_subexpression_elimination(indices.back()));
-            } else {
-                indices_csed.emplace_back();
-            }
-            if (next_indices.back().defined()) {
-                next_indices_csed.push_back(common_subexpression_elimination(next_indices.back()));
-            } else {
-                next_indices_csed.emplace_back();
-            }
-            if (predicates.back().defined()) {
-                predicates_csed.push_back(common_subexpression_elimination(predicates.back()));
-            } else {
-                predicates_csed.emplace_back();
-            }
-            if (next_predicates.back().defined()) {
-                next_predicates_csed.push_back(common_subexpression_elimination(next_predicates.back()));
-            } else {
-                next_predicates_csed.emplace_back();
-            }
-        }
-
-        // Find loads done on this loop iteration that will be
-        // reusable as some other Expr on the next loop iteration.
-        vector<vector<int>> chains;
-        for (int i = 0; i < (int)indices.size(); i++) {
-            for (int j = 0; j < (int)indices.size(); j++) {
-                // Don't catch loop invariants here.
-                if (i == j) {
-                    continue;
-                }
-                // can_prove is stronger than graph_equal, because it doesn't require index expressions to be
-                // exactly the same, but evaluate to the same value. We keep the graph_equal check, because
-                // it's faster and should be executed before the more expensive check.
-                if (loads[i][0]->name == loads[j][0]->name &&
-                    next_indices[j].defined() &&
-                    (graph_equal(indices[i], next_indices[j]) ||
-                     ((indices[i].type() == next_indices[j].type()) && can_prove(indices_csed[i] == next_indices_csed[j]))) &&
-                    next_predicates[j].defined() &&
-                    (graph_equal(predicates[i], next_predicates[j]) ||
-                     ((predicates[i].type() == next_predicates[j].type()) && can_prove(predicates_csed[i] == next_predicates_csed[j])))) {
-                    chains.push_back({j, i});
-                    debug(3) << "Found carried value:\n"
-                             << i << ":  -> " << Expr(loads[i][0]) << "\n"
-                             << j << ":  -> " << Expr(loads[j][0]) << "\n";
-                }
-            }
-        }
-
-        if (chains.empty()) {
+        CarryChains carry = find_carry_chains(graph_stmt, linear, in_consume, max_carried_values);
+        if (carry.chains.empty()) {
             return orig_stmt;
         }
-
-        // Agglomerate chains of carries
-        bool done = false;
-        while (!done) {
-            done = true;
-            for (size_t i = 0; i < chains.size(); i++) {
-                if (chains[i].empty()) {
-                    continue;
-                }
-                for (size_t j = 0; j < chains.size(); j++) {
-                    if (chains[j].empty()) {
-                        continue;
-                    }
-                    if (chains[i].back() == chains[j].front()) {
-                        chains[i].insert(chains[i].end(), chains[j].begin() + 1, chains[j].end());
-                        chains[j].clear();
-                        done = false;
-                    }
-                }
-            }
-
-            for (size_t i = 0; i < chains.size(); i++) {
-                while (i < chains.size() && chains[i].empty()) {
-                    chains[i].swap(chains.back());
-                    chains.pop_back();
-                }
-            }
-        }
-
-        // Sort the carry chains by decreasing order of size. The
-        // longest ones get the most reuse of each value.
-        //
-        // Use of stable_sort is just so that IR generated by different C++ compilers
-        // is identical; it doesn't appear to make any meaningful difference
-        // in code output, but makes debugging IR output easier to deal with.
-        std::stable_sort(chains.begin(), chains.end(),
-                         [&](const vector<int> &c1, const vector<int> &c2) { return c1.size() > c2.size(); });
-
-        for (const vector<int> &c : chains) {
-            debug(3) << "Found chain of carried values:\n";
-            for (int i : c) {
-                debug(3) << i << ":  <- " << indices[i] << "\n";
-            }
-        }
-
-        // Only keep the top N carried values. Otherwise we'll just
-        // spray stack spills everywhere. This is ugly, because we're
-        // relying on a heuristic.
-        vector<vector<int>> trimmed;
-        size_t sz = 0;
-        for (const vector<int> &c : chains) {
-            if (sz + c.size() > (size_t)max_carried_values) {
-                if (sz < (size_t)max_carried_values - 1) {
-                    // Take a partial chain
-                    trimmed.emplace_back(c.begin(), c.begin() + max_carried_values - sz);
-                }
-                break;
-            }
-            trimmed.push_back(c);
-            sz += c.size();
-        }
-        chains.swap(trimmed);
+        const vector<vector<const Load *>> &loads = carry.loads;
+        const vector<vector<int>> &chains = carry.chains;
 
         // We now have chains of the form:
         // f[x] <- f[x+1] <- ... <- f[x+N-1]
@@ -494,6 +526,7 @@ class LoopCarryOverLoop : public IRMutator {
 
             allocs.push_back({scratch,
                               loads[c.front()][0]->type.element_of(),
+                              MemoryType::Stack,
                               (int)c.size() * loads[c.front()][0]->type.lanes(),
                               initial_stores});
         }
@@ -523,20 +556,156 @@ public:
         linear.push(var, 1);
     }
 
-    struct ScratchAllocation {
-        string name;
-        Type type;
-        int size;
-        Stmt initial_stores;
-    };
-
     vector<ScratchAllocation> allocs;
 };
 
+/** Carry loads over iterations of a loop whose body is a single inner
+ * loop, by caching the rows of values the inner loop loads. This is
+ * the sliding window optimization applied to loads from inputs: a 3x3
+ * stencil vectorized across the inner loop loads one new row per outer
+ * iteration instead of three. A chain of N carried loads gets a scratch
+ * buffer of N rows, each as long as the inner loop, used as a ring
+ * buffer indexed by the outer loop variable. Returns the loop with its
+ * body rewritten, or the original loop if there's nothing to carry. */
+Stmt carry_rows_over_loop(const For *op, const Scope<> &in_consume,
+                          int max_carried_rows, vector<ScratchAllocation> &allocs) {
+    // Peel off the lets between the two loops, tracking how they vary
+    // with the outer loop variable.
+    Scope<Expr> linear;
+    linear.push(op->name, 1);
+    Scope<> outer_vars;
+    outer_vars.push(op->name);
+    vector<pair<string, Expr>> containing_lets;
+    Stmt body = op->body;
+    while (const LetStmt *let = body.as<LetStmt>()) {
+        linear.push(let->name, is_linear(let->value, linear));
+        outer_vars.push(let->name);
+        containing_lets.emplace_back(let->name, let->value);
+        body = let->body;
+    }
+
+    // The inner loop must cover the same range on every outer iteration,
+    // so that the rows line up, and the range must be computable outside
+    // the outer loop, to size the scratch buffer.
+    const For *inner = body.as<For>();
+    if (!inner ||
+        inner->for_type != ForType::Serial ||
+        expr_uses_vars(inner->min, outer_vars) ||
+        expr_uses_vars(inner->extent, outer_vars)) {
+        return op;
+    }
+
+    // Only straight-line inner loop bodies, so that every load runs on
+    // every inner iteration.
+    Stmt graph_stmt = substitute_in_all_lets(inner->body);
+    set<string> stored;
+    for (const Stmt &s : block_to_vector(graph_stmt)) {
+        if (const Store *store = s.as<Store>()) {
+            stored.insert(store->name);
+        } else {
+            return op;
+        }
+    }
+
+    // The inner loop variable doesn't change from one outer iteration to
+    // the next.
+    linear.push(inner->name, 0);
+    CarryChains carry = find_carry_chains(graph_stmt, linear, in_consume, max_carried_rows);
+    if (carry.chains.empty()) {
+        return op;
+    }
+    // Rows stay cached for several outer iterations, so they must not be
+    // rows the loop writes to.
+    for (const vector<int> &c : carry.chains) {
+        if (stored.count(carry.loads[c.front()][0]->name)) {
+            return op;
+        }
+    }
+
+    Expr outer_var = Variable::make(Int(32), op->name);
+    Expr inner_var = Variable::make(Int(32), inner->name);
+    Expr inner_offset = inner_var - inner->min;
+
+    vector<Stmt> leading_edge_stores;
+    vector<pair<string, Expr>> row_lets;
+    Stmt core = graph_stmt;
+
+    for (const vector<int> &c : carry.chains) {
+        const Type t = carry.loads[c.front()][0]->type;
+        const int rows = (int)c.size();
+        string scratch = unique_name('c');
+        Expr row_size = inner->extent * t.lanes();
+
+        // Value i of the chain on this outer iteration is value i + 1 on
+        // the previous one, so rotating the row it lives in by one each
+        // outer iteration means nothing has to move.
+        auto row_start = [&](int i) {
+            return ((outer_var - op->min + i) % rows) * row_size;
+        };
+        auto scratch_idx = [&](const Expr &row) {
+            Expr base = row + inner_offset * t.lanes();
+            return t.is_scalar() ? base : Ramp::make(base, 1, t.lanes());
+        };
+
+        vector<Stmt> initial_scratch_stores;
+        for (int i = 0; i < rows; i++) {
+            const Load *orig_load = carry.loads[c[i]][0];
+            string row_name = scratch + ".row." + std::to_string(i);
+            row_lets.emplace_back(row_name, row_start(i));
+            Expr idx = scratch_idx(Variable::make(Int(32), row_name));
+
+            Expr load_from_scratch = Load::make(t, scratch, idx, Buffer<>(), Parameter(),
+                                                const_true(t.lanes()), ModulusRemainder());
+            for (const Load *l : carry.loads[c[i]]) {
+                core = graph_substitute(l, load_from_scratch, core);
+            }
+
+            if (i == rows - 1) {
+                leading_edge_stores.push_back(Store::make(scratch, orig_load, idx, Parameter(),
+                                                          const_true(t.lanes()), ModulusRemainder()));
+            } else {
+                initial_scratch_stores.push_back(Store::make(scratch, orig_load, scratch_idx(row_start(i)),
+                                                             Parameter(), const_true(t.lanes()),
+                                                             ModulusRemainder()));
+            }
+        }
+
+        // Fill in all but the leading row before the first outer
+        // iteration. These are all loads the first iteration would have
+        // done anyway.
+        Stmt initial_stores = common_subexpression_elimination(Block::make(initial_scratch_stores));
+        for (const auto &[var, value] : reverse_view(containing_lets)) {
+            if (stmt_uses_var(initial_stores, var)) {
+                initial_stores = LetStmt::make(var, value, initial_stores);
+            }
+        }
+        string initial_var = unique_name(inner->name);
+        initial_stores = substitute(inner->name, Variable::make(Int(32), initial_var), initial_stores);
+        initial_stores = For::make(initial_var, inner->min, inner->extent, ForType::Serial,
+                                   Partition::Never, inner->device_api, initial_stores);
+
+        allocs.push_back({scratch, t.element_of(), MemoryType::Auto, rows * row_size, initial_stores});
+    }
+
+    Stmt inner_body = Block::make(Block::make(leading_edge_stores), core);
+    inner_body = common_subexpression_elimination(inner_body);
+    Stmt stmt = For::make(inner->name, inner->min, inner->extent, inner->for_type,
+                          inner->partition_policy, inner->device_api, inner_body);
+    for (const auto &[var, value] : reverse_view(row_lets)) {
+        stmt = LetStmt::make(var, value, stmt);
+    }
+    for (const auto &[var, value] : reverse_view(containing_lets)) {
+        stmt = LetStmt::make(var, value, stmt);
+    }
+    return For::make(op->name, op->min, op->extent, op->for_type,
+                     op->partition_policy, op->device_api, stmt);
+}
+
 class LoopCarry : public IRMutator {
     using IRMutator::visit;
 
     int max_carried_values;
+    int max_carried_rows;
     Scope<> in_consume;
 
     Stmt visit(const ProducerConsumer *op) override {
@@ -549,8 +718,15 @@ class LoopCarry : public IRMutator {
         }
     }
 
-    Stmt visit(const For *op) override {
-        if (op->for_type == ForType::Serial && !is_const_one(op->extent)) {
+    Stmt visit(const For *loop) override {
+        if (loop->for_type == ForType::Serial && !is_const_one(loop->extent)) {
+            vector<ScratchAllocation> row_allocs;
+            Stmt carried = loop;
+            if (max_carried_rows > 0) {
+                carried = carry_rows_over_loop(loop, in_consume, max_carried_rows, row_allocs);
+            }
+            const For *op = carried.as<For>();
+
             Stmt stmt;
             Stmt body = mutate(op->body);
             LoopCarryOverLoop carry(op->name, in_consume, max_carried_values);
@@ -562,29 +738,30 @@ class LoopCarry : public IRMutator {
             }
 
             // Inject the scratch buffer allocations.
-            for (const auto &alloc : carry.allocs) {
+            row_allocs.insert(row_allocs.end(), carry.allocs.begin(), carry.allocs.end());
+            for (const auto &alloc : row_allocs) {
                 stmt = Block::make(substitute(op->name, op->min, alloc.initial_stores), stmt);
-                stmt = Allocate::make(alloc.name, alloc.type, MemoryType::Stack, {alloc.size}, const_true(), stmt);
+                stmt = Allocate::make(alloc.name, alloc.type, alloc.memory_type, {alloc.size}, const_true(), stmt);
             }
-            if (!carry.allocs.empty()) {
+            if (!row_allocs.empty()) {
                 stmt = IfThenElse::make(op->extent > 0, stmt);
             }
             return stmt;
         } else {
-            return IRMutator::visit(op);
+            return IRMutator::visit(loop);
         }
     }
 
 public:
-    LoopCarry(int max_carried_values)
-        : max_carried_values(max_carried_values) {
+    LoopCarry(int max_carried_values, int max_carried_rows)
+        : max_carried_values(max_carried_values), max_carried_rows(max_carried_rows) {
     }
 };
 
 }  // namespace
 
-Stmt loop_carry(Stmt s, int max_carried_values) {
-    s = LoopCarry(max_carried_values).mutate(s);
+Stmt loop_carry(Stmt s, int max_carried_values, int max_carried_rows) {
+    s = LoopCarry(max_carried_values, max_carried_rows).mutate(s);
     return s;
 }
 
@@ -11,8 +11,14 @@ namespace Internal {
  * predicated, the predicates need to match. Can be an optimization or
  * pessimization depending on how good the L1 cache is on the architecture
  * and how many memory issue slots there are. Currently only intended
- * for Hexagon. */
-Stmt loop_carry(Stmt, int max_carried_values = 8);
+ * for Hexagon.
+ *
+ * If max_carried_rows is positive, loops whose body is a single inner
+ * loop also reuse the rows of values loaded by the inner loop on
+ * previous iterations, by caching up to that many rows in scratch
+ * buffers. This turns the N row loads per iteration of an NxN stencil
+ * into one. */
+Stmt loop_carry(Stmt, int max_carried_values = 8, int max_carried_rows = 0);
 
 }  // namespace Internal
 }  // namespace Halide
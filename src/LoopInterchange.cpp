@@ -0,0 +1,174 @@
+#include "LoopInterchange.h"
+
+#include <set>
+
+#include "CompilerLogger.h"
+#include "Debug.h"
+#include "ExprUsesVar.h"
+#include "Function.h"
+#include "IREquality.h"
+#include "IRVisitor.h"
+#include "Target.h"
+
+namespace Halide {
+namespace Internal {
+
+using std::map;
+using std::set;
+using std::string;
+using std::vector;
+
+namespace {
+
+// A load or store, as the coordinates it accesses and which of them
+// is innermost in memory.
+struct Access {
+    vector<Expr> args;
+    int innermost;
+};
+
+// The index of the arg of f that is stored innermost.
+int innermost_storage_arg(const Function &f) {
+    const vector<StorageDim> &dims = f.schedule().storage_dims();
+    if (!dims.empty()) {
+        for (size_t i = 0; i < f.args().size(); i++) {
+            if (f.args()[i] == dims[0].var) {
+                return (int)i;
+            }
+        }
+    }
+    return 0;
+}
+
+// Find the distinct loads that a definition makes from memory: from
+// input buffers, and from Funcs that aren't inlined.
+class FindLoads : public IRVisitor {
+    using IRVisitor::visit;
+
+    void visit(const Call *op) override {
+        IRVisitor::visit(op);
+        int innermost = 0;
+        if (op->call_type == Call::Halide) {
+            auto it = env.find(op->name);
+            if (it == env.end() ||
+                it->second.schedule().compute_level().is_inlined()) {
+                // Inlined Funcs don't touch memory themselves. The
+                // loads inside them aren't counted.
+                return;
+            }
+            innermost = innermost_storage_arg(it->second);
+        } else if (op->call_type != Call::Image) {
+            return;
+        }
+        for (const Access &a : loads) {
+            if (a.args.size() == op->args.size() &&
+                std::equal(a.args.begin(), a.args.end(), op->args.begin(),
+                           [](const Expr &x, const Expr &y) { return equal(x, y); })) {
+                return;
+            }
+        }
+        loads.push_back({op->args, innermost});
+    }
+
+    const map<string, Function> &env;
+
+public:
+    vector<Access> loads;
+
+    explicit FindLoads(const map<string, Function> &env)
+        : env(env) {
+    }
+};
+
+// The number of accesses that are strided in var: those that use it in
+// a coordinate that isn't innermost in memory.
+int strided_accesses(const vector<Access> &accesses, const string &var) {
+    int count = 0;
+    for (const Access &a : accesses) {
+        for (size_t i = 0; i < a.args.size(); i++) {
+            if ((int)i != a.innermost && expr_uses_var(a.args[i], var)) {
+                count++;
+                break;
+            }
+        }
+    }
+    return count;
+}
+
+}  // namespace
+
+void loop_interchange(map<string, Function> &env, const Target &t) {
+    if (!t.has_feature(Target::LoopInterchange)) {
+        return;
+    }
+
+    // Funcs that other Funcs are computed or stored inside of. Moving
+    // their loops would move those Funcs too.
+    set<string> hosts;
+    for (const auto &it : env) {
+        const FuncSchedule &s = it.second.schedule();
+        for (const LoopLevel *l : {&s.compute_level(), &s.store_level(), &s.hoist_storage_level()}) {
+            if (!l->is_inlined() && !l->is_root()) {
+                hosts.insert(l->func());
+            }
+        }
+    }
+
+    for (auto &iter : env) {
+        Function &f = iter.second;
+        if (f.has_extern_definition() ||
+            f.schedule().compute_level().is_inlined() ||
+            f.dimensions() < 2 ||
+            hosts.count(f.name())) {
+            continue;
+        }
+
+        Definition &def = f.definition();
+        StageSchedule &s = def.schedule();
+        if (s.touched() ||
+            !def.specializations().empty() ||
+            !s.fused_pairs().empty() ||
+            !s.fuse_level().level.is_inlined() ||
+            s.dims().size() != f.args().size() + 1) {
+            // It has been scheduled, so its loop order was chosen.
+            continue;
+        }
+
+        FindLoads finder(env);
+        for (const Expr &e : def.values()) {
+            e.accept(&finder);
+        }
+        vector<Access> accesses = std::move(finder.loads);
+        accesses.push_back({def.args(), innermost_storage_arg(f)});
+
+        // dims()[0] is the innermost loop. The last one is the
+        // outermost placeholder.
+        vector<Dim> &dims = s.dims();
+        const string &old_var = dims[0].var;
+        int best = 0;
+        int best_strided = strided_accesses(accesses, old_var);
+        const int old_strided = best_strided;
+        for (size_t i = 1; i + 1 < dims.size(); i++) {
+            int strided = strided_accesses(accesses, dims[i].var);
+            if (strided < best_strided) {
+                best = (int)i;
+                best_strided = strided;
+            }
+        }
+        if (best == 0) {
+            continue;
+        }
+
+        debug(1) << "Interchanging loops of " << f.name() << " to put "
+                 << dims[best].var << " innermost instead of " << old_var << "\n";
+        if (auto *logger = get_compiler_logger()) {
+            logger->record_loop_interchange(f.name(), old_var, dims[best].var, old_strided, best_strided);
+        }
+        Dim innermost = dims[best];
+        dims.erase(dims.begin() + best);
+        dims.insert(dims.begin(), innermost);
+    }
+}
+
+}  // namespace Internal
+}  // namespace Halide
@@ -0,0 +1,37 @@
+#ifndef HALIDE_LOOP_INTERCHANGE_H
+#define HALIDE_LOOP_INTERCHANGE_H
+
+/** \file
+ * Defines a lowering pass that reorders the loops of unscheduled pure
+ * definitions to walk memory densely.
+ */
+
+#include <map>
+#include <string>
+
+namespace Halide {
+
+struct Target;
+
+namespace Internal {
+
+class Function;
+
+/** If Target::LoopInterchange is set, reorder the loops of each pure
+ * definition that hasn't been scheduled at all, so that the loop
+ * innermost is over the var that the fewest of its accesses are
+ * strided in. An access is strided in a var if the var appears in any
+ * of its coordinates other than the innermost one of the storage it
+ * reads or writes, which includes the definition's own store. For
+ * example, g(x, y) = f(y, x) + f(y, x + 1) runs with y innermost
+ * instead of x. The loops are only reordered if that makes strictly
+ * fewer accesses strided, and only for Funcs that no other Func is
+ * computed or stored inside of, so the placement of other Funcs
+ * doesn't change. Each interchange is reported to the active
+ * CompilerLogger. */
+void loop_interchange(std::map<std::string, Function> &env, const Target &t);
+
+}  // namespace Internal
+}  // namespace Halide
+
+#endif
@@ -1,6 +1,9 @@
 #include <algorithm>
 #include <chrono>
+#include <cstdlib>
 #include <iostream>
+#include <map>
+#include <optional>
 #include <set>
 #include <sstream>
 
@@ -11,7 +14,10 @@
 #include "AddParameterChecks.h"
 #include "AddSplitFactorChecks.h"
 #include "AllocationBoundsInference.h"
+#include "AllocationTracking.h"
 #include "AsyncProducers.h"
+#include "AutoRFactor.h"
+#include "AutoStorageOrder.h"
 #include "BoundConstantExtentLoops.h"
 #include "BoundSmallAllocations.h"
 #include "Bounds.h"
@@ -29,6 +35,7 @@
 #include "FindCalls.h"
 #include "FindIntrinsics.h"
 #include "FlattenNestedRamps.h"
+#include "Float16Compute.h"
 #include "Func.h"
 #include "Function.h"
 #include "FuseGPUThreadLoops.h"
@@ -40,8 +47,10 @@
 #include "InferArguments.h"
 #include "InjectHostDevBufferCopies.h"
 #include "Inline.h"
+#include "InvariantDivision.h"
 #include "LICM.h"
 #include "LoopCarry.h"
+#include "LoopInterchange.h"
 #include "LowerParallelTasks.h"
 #include "LowerWarpShuffles.h"
 #include "Memoization.h"
@@ -67,12 +76,15 @@
 #include "StageStridedLoads.h"
 #include "StorageFlattening.h"
 #include "StorageFolding.h"
+#include "StreamingStores.h"
 #include "StrictifyFloat.h"
 #include "StripAsserts.h"
 #include "Substitute.h"
+#include "TargetFeatureSpecializations.h"
 #include "TargetQueryOps.h"
 #include "Tracing.h"
 #include "TrimNoOps.h"
+#include "TunedVariants.h"
 #include "UnifyDuplicateLets.h"
 #include "UniquifyVariableNames.h"
 #include "UnpackBuffers.h"
@@ -90,17 +102,80 @@ using std::vector;
 
 namespace {
 
+// Count the distinct IR nodes reachable from a Stmt.
+class CountIRNodes : public IRGraphVisitor {
+    std::set<const IRNode *> seen;
+
+    using IRGraphVisitor::include;
+
+    void include(const Expr &e) override {
+        if (seen.insert(e.get()).second) {
+            e.accept(this);
+        }
+    }
+
+    void include(const Stmt &s) override {
+        if (seen.insert(s.get()).second) {
+            s.accept(this);
+        }
+    }
+
+public:
+    uint64_t count(const Stmt &s) {
+        include(s);
+        return seen.size();
+    }
+};
+
+// Record the layout the schedule wants for a buffer argument, for the
+// metadata. Callers can use it to allocate buffers that pass the
+// pipeline's checks and take its fastest paths.
+void set_preferred_layout(LoweredArgument &arg, const Parameter &param, const Target &t) {
+    const int dims = param.dimensions();
+    arg.host_alignment = param.host_alignment();
+
+    int dense_dim = -1;
+    bool other_strides = false;
+    for (int i = 0; i < dims; i++) {
+        const Expr &stride = param.stride_constraint(i);
+        if (dense_dim < 0 && is_const_one(stride)) {
+            dense_dim = i;
+        } else if (stride.defined()) {
+            other_strides = true;
+        }
+    }
+    if (dense_dim == 0) {
+        arg.layout = halide_buffer_layout_planar;
+    } else if (dense_dim > 0 && dense_dim == dims - 1) {
+        arg.layout = halide_buffer_layout_interleaved;
+    } else if (dense_dim > 0) {
+        arg.layout = halide_buffer_layout_other;
+    }
+
+    // Padding the rows changes the strides of the other dimensions,
+    // so only suggest it when they're unconstrained.
+    if (dense_dim == 0 && dims > 1 && !other_strides) {
+        const int bytes = std::max(param.type().bytes(), 1);
+        arg.padding = std::max(t.natural_vector_size(param.type()),
+                               arg.host_alignment / bytes);
+    }
+}
+
 class LoweringLogger {
     Stmt last_written;
     std::chrono::time_point<std::chrono::high_resolution_clock> last_time;
     std::vector<std::pair<double, std::string>> timings;
     bool time_lowering_passes = false;
+    double pass_time_budget = 0;
+    uint64_t last_ir_nodes = 0;
 
 public:
     LoweringLogger() {
         last_time = std::chrono::high_resolution_clock::now();
         static bool should_time = !get_env_variable("HL_TIME_LOWERING_PASSES").empty();
         time_lowering_passes = should_time;
+        static double budget = std::atof(get_env_variable("HL_LOWERING_PASS_TIME_BUDGET").c_str());
+        pass_time_budget = budget;
     }
 
     void operator()(const string &message, const Stmt &s) {
@@ -110,12 +185,27 @@ public:
             debug(2) << message << "\n"
                      << s << "\n";
             last_written = s;
-            last_time = t;
         } else {
             debug(2) << message << " (unchanged)\n\n";
-            last_time = t;
         }
         timings.emplace_back(diff.count() * 1000, message);
+
+        if (auto *logger = get_compiler_logger()) {
+            CompilerLogger::LoweringPassStats stats;
+            stats.name = message;
+            stats.duration = diff.count();
+            stats.peak_memory = get_peak_memory_usage();
+            stats.ir_nodes_before = last_ir_nodes;
+            stats.ir_nodes_after = last_ir_nodes = CountIRNodes().count(s);
+            logger->record_lowering_pass(stats);
+        }
+
+        user_assert(pass_time_budget <= 0 || diff.count() <= pass_time_budget)
+            << "Lowering pass \"" << message << "\" took " << diff.count()
+            << " seconds, which exceeds HL_LOWERING_PASS_TIME_BUDGET=" << pass_time_budget << "\n";
+
+        // Don't charge the bookkeeping above to the next pass.
+        last_time = std::chrono::high_resolution_clock::now();
     }
 
     ~LoweringLogger() {
@@ -137,19 +227,32 @@ void lower_impl(const vector<Function> &output_funcs,
                 const vector<Stmt> &requirements,
                 bool trace_pipeline,
                 const vector<IRMutator *> &custom_passes,
+                const std::map<string, Function> *env_without_wrappers,
                 Module &result_module) {
     auto time_start = std::chrono::high_resolution_clock::now();
 
+    // Optionally memoize context-free simplify() calls for the rest of lowering.
+    static bool use_simplifier_cache = !get_env_variable("HL_SIMPLIFIER_CACHE").empty();
+    std::unique_ptr<ScopedSimplifierCache> simplifier_cache;
+    if (use_simplifier_cache) {
+        simplifier_cache = std::make_unique<ScopedSimplifierCache>();
+    }
+
     size_t initial_lowered_function_count = result_module.functions().size();
 
     // Create a deep-copy of the entire graph of Funcs.
-    auto [outputs, env] = deep_copy(output_funcs, build_environment(output_funcs));
+    auto [outputs, env] = deep_copy(output_funcs,
+                                    env_without_wrappers ?
+                                        add_wrappers_to_environment(*env_without_wrappers) :
+                                        build_environment(output_funcs));
 
     lower_target_query_ops(env, t);
 
     bool any_strict_float = strictify_float(env, t);
     result_module.set_any_strict_float(any_strict_float);
 
+    lower_float16_compute(env, t);
+
     // Output functions should all be computed and stored at root.
     for (const Function &f : outputs) {
         Func(f).compute_root().store_root();
@@ -160,9 +263,15 @@ void lower_impl(const vector<Function> &output_funcs,
         iter.second.lock_loop_levels();
     }
 
+    auto_rfactor(env, t);
+
     // Substitute in wrapper Funcs
     env = wrap_func_calls(env);
 
+    auto_storage_order(env, outputs, t);
+
+    loop_interchange(env, t);
+
     // Compute a realization order and determine group of functions which loops
     // are to be fused together
     auto [order, fused_groups] = realization_order(outputs, env);
@@ -207,6 +316,11 @@ void lower_impl(const vector<Function> &output_funcs,
     // This pass injects nested definitions of variable names, so we
     // can't simplify statements from here until we fix them up. (We
     // can still simplify Exprs).
+    // The passes from here through storage folding make many box queries,
+    // often repeatedly of the same parts of the Stmt.
+    std::optional<ScopedBoxesCache> boxes_cache;
+    boxes_cache.emplace();
+
     debug(1) << "Performing computation bounds inference...\n";
     s = bounds_inference(s, outputs, order, fused_groups, env, func_bounds, t);
     log("Lowering after computation bounds inference:", s);
@@ -259,10 +373,20 @@ void lower_impl(const vector<Function> &output_funcs,
     s = storage_folding(s, env);
     log("Lowering after storage folding:", s);
 
+    debug(1) << "Box query cache: " << boxes_cache->hits() << " hits, "
+             << boxes_cache->misses() << " misses\n";
+    boxes_cache.reset();
+
     debug(1) << "Injecting debug_to_file calls...\n";
     s = debug_to_file(s, outputs, env);
     log("Lowering after injecting debug_to_file calls:", s);
 
+    if (t.has_feature(Target::AutoPrefetch)) {
+        debug(1) << "Injecting automatic prefetches...\n";
+        s = inject_auto_prefetch(s, env, t);
+        log("Lowering after injecting automatic prefetches:", s);
+    }
+
     debug(1) << "Injecting prefetches...\n";
     s = inject_prefetch(s, env);
     log("Lowering after injecting prefetches:", s);
@@ -350,10 +474,16 @@ void lower_impl(const vector<Function> &output_funcs,
     log("Lowering after unrolling:", s);
 
     debug(1) << "Vectorizing...\n";
-    s = vectorize_loops(s, env);
+    s = vectorize_loops(s, env, t);
     s = simplify(s);
     log("Lowering after vectorizing:", s);
 
+    if (t.features_any_of({Target::CUDA, Target::Metal})) {
+        debug(1) << "Injecting warps for matrix tiles...\n";
+        s = inject_tile_warps(s);
+        log("Lowering after injecting warps for matrix tiles:", s);
+    }
+
     if (t.has_gpu_feature() ||
         t.has_feature(Target::Vulkan)) {
         debug(1) << "Injecting per-block gpu synchronization...\n";
@@ -372,7 +502,7 @@ void lower_impl(const vector<Function> &output_funcs,
     log("Lowering after partitioning loops:", s);
 
     debug(1) << "Staging strided loads...\n";
-    s = stage_strided_loads(s);
+    s = stage_strided_loads(s, t);
     log("Lowering after staging strided loads:", s);
 
     debug(1) << "Trimming loops to the region over which they do something...\n";
@@ -406,13 +536,33 @@ void lower_impl(const vector<Function> &output_funcs,
     s = bound_small_allocations(s);
     log("Lowering after bounding small allocations:", s);
 
+    if (t.has_feature(Target::TrackAllocations)) {
+        debug(1) << "Injecting allocation tracking...\n";
+        const bool profiling = t.has_feature(Target::Profile) || t.has_feature(Target::ProfileByTimer) ||
+                               t.has_feature(Target::ProfileLight);
+        s = inject_allocation_tracking(s, pipeline_name, env, profiling);
+        log("Lowering after injecting allocation tracking:", s);
+    }
+
     if (t.has_feature(Target::Profile) || t.has_feature(Target::ProfileByTimer)) {
         debug(1) << "Injecting profiling...\n";
         s = inject_profiling(s, pipeline_name, env);
         log("Lowering after injecting profiling:", s);
     }
 
-    if (t.has_feature(Target::CUDA)) {
+    if (t.has_feature(Target::ProfileLight)) {
+        debug(1) << "Injecting light profiling...\n";
+        s = inject_light_profiling(s, pipeline_name, env, t);
+        log("Lowering after injecting light profiling:", s);
+    }
+
+    if (t.has_feature(Target::ArenaAllocations)) {
+        debug(1) << "Placing allocations in arenas...\n";
+        s = place_allocations_in_arenas(s);
+        log("Lowering after placing allocations in arenas:", s);
+    }
+
+    if (t.features_any_of({Target::CUDA, Target::Metal, Target::OpenCL, Target::Vulkan})) {
         debug(1) << "Injecting warp shuffles...\n";
         s = lower_warp_shuffles(s, t);
         log("Lowering after injecting warp shuffles:", s);
@@ -435,6 +585,10 @@ void lower_impl(const vector<Function> &output_funcs,
     s = flatten_nested_ramps(s);
     log("Lowering after flattening nested ramps:", s);
 
+    debug(1) << "Promoting small allocations to registers...\n";
+    s = promote_small_allocations_to_registers(s);
+    log("Lowering after promoting small allocations to registers:", s);
+
     debug(1) << "Removing dead allocations and moving loop invariant code...\n";
     s = remove_dead_allocations(s);
     s = simplify(s);
@@ -442,12 +596,20 @@ void lower_impl(const vector<Function> &output_funcs,
     s = hoist_loop_invariant_if_statements(s);
     log("Lowering after removing dead allocations and hoisting loop invariants:", s);
 
+    debug(1) << "Lowering divisions by loop invariants...\n";
+    s = lower_invariant_division(s, t);
+    log("Lowering after lowering divisions by loop invariants:", s);
+
     debug(1) << "Finding intrinsics...\n";
     // Must be run after the last simplification, because it turns
     // divisions into shifts, which the simplifier reverses.
     s = find_intrinsics(s);
     log("Lowering after finding intrinsics:", s);
 
+    debug(1) << "Injecting streaming stores...\n";
+    s = inject_streaming_stores(s);
+    log("Lowering after injecting streaming stores:", s);
+
     debug(1) << "Hoisting prefetches...\n";
     s = hoist_prefetches(s);
     log("Lowering after hoisting prefetches:", s);
@@ -500,9 +662,34 @@ void lower_impl(const vector<Function> &output_funcs,
     // so they don't add overhead to the closure.
     vector<InferredArgument> inferred_args = infer_arguments(s, outputs);
 
+    // This must also happen before lowering parallel tasks, so that the
+    // closures made for parallel loops inside the outlined specializations
+    // get their target features.
+    // This must happen before outlining specializations and lowering
+    // parallel tasks, so the variants chosen at the top of the pipeline
+    // are captured by the closures.
+    debug(1) << "Lowering tuned variants...\n";
+    s = lower_tuned_variants(s, pipeline_name);
+    log("Lowering after lowering tuned variants:", s);
+
+    std::vector<LoweredFunc> target_specializations;
+    debug(1) << "Outlining target feature specializations...\n";
+    s = outline_target_feature_specializations(s, target_specializations, pipeline_name, t);
+    log("Lowering after outlining target feature specializations:", s);
+
     std::vector<LoweredFunc> closure_implementations;
     debug(1) << "Lowering Parallel Tasks...\n";
     s = lower_parallel_tasks(s, closure_implementations, pipeline_name, t);
+    for (LoweredFunc &f : target_specializations) {
+        size_t first_closure = closure_implementations.size();
+        f.body = lower_parallel_tasks(f.body, closure_implementations, f.name, t);
+        for (size_t i = first_closure; i < closure_implementations.size(); i++) {
+            closure_implementations[i].target_features = f.target_features;
+        }
+    }
+    closure_implementations.insert(closure_implementations.end(),
+                                   target_specializations.begin(),
+                                   target_specializations.end());
     // Process any LoweredFunctions added by other passes. In practice, this
     // will likely not work well enough due to ordering issues with
     // closure generating passes and instead all such passes will need to
@@ -594,6 +781,24 @@ void lower_impl(const vector<Function> &output_funcs,
 
     LoweredFunc main_func(pipeline_name, public_args, s, linkage_type);
 
+    std::map<string, Parameter> buffer_params;
+    for (const InferredArgument &arg : inferred_args) {
+        if (arg.param.defined() && arg.param.is_buffer()) {
+            buffer_params[arg.param.name()] = arg.param;
+        }
+    }
+    for (const auto &out : outputs) {
+        for (const Parameter &buf : out.output_buffers()) {
+            buffer_params[buf.name()] = buf;
+        }
+    }
+    for (LoweredArgument &arg : main_func.args) {
+        auto it = buffer_params.find(arg.name);
+        if (arg.is_buffer() && it != buffer_params.end()) {
+            set_preferred_layout(arg, it->second, t);
+        }
+    }
+
     // If we're in debug mode, add code that prints the args.
     if (t.has_feature(Target::Debug)) {
         debug_arguments(&main_func, t);
@@ -601,6 +806,31 @@ void lower_impl(const vector<Function> &output_funcs,
 
     result_module.append(main_func);
 
+    if (t.has_feature(Target::TrustedEntry)) {
+        // Callers that call a pipeline many times with the same
+        // arguments can validate them once with <name>_check, and then
+        // skip the checks with <name>_unchecked. The argv wrapper and
+        // metadata remain those of the checked entry point.
+        const LinkageType linkage = linkage_type == LinkageType::Internal ?
+                                        LinkageType::Internal :
+                                        LinkageType::External;
+        LoweredFunc check(main_func.name + "_check", main_func.args,
+                          extract_entry_checks(main_func.body), linkage);
+        LoweredFunc unchecked(main_func.name + "_unchecked", main_func.args,
+                              strip_entry_asserts(main_func.body), linkage);
+        debug(2) << "Entry checks:\n"
+                 << check.body << "\n\n"
+                 << "Unchecked entry point:\n"
+                 << unchecked.body << "\n\n";
+        result_module.append(check);
+        result_module.append(unchecked);
+    }
+
+    if (simplifier_cache) {
+        debug(1) << "Simplifier cache: " << simplifier_cache->hits() << " hits, "
+                 << simplifier_cache->misses() << " misses\n";
+    }
+
     auto *logger = get_compiler_logger();
     if (logger) {
         auto time_end = std::chrono::high_resolution_clock::now();
@@ -618,10 +848,11 @@ Module lower(const vector<Function> &output_funcs,
              const LinkageType linkage_type,
              const vector<Stmt> &requirements,
              bool trace_pipeline,
-             const vector<IRMutator *> &custom_passes) {
+             const vector<IRMutator *> &custom_passes,
+             const std::map<string, Function> *env_without_wrappers) {
     Module result_module{strip_namespaces(pipeline_name), t};
     run_with_large_stack([&]() {
-        lower_impl(output_funcs, pipeline_name, t, args, linkage_type, requirements, trace_pipeline, custom_passes, result_module);
+        lower_impl(output_funcs, pipeline_name, t, args, linkage_type, requirements, trace_pipeline, custom_passes, env_without_wrappers, result_module);
     });
     return result_module;
 }
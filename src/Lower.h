@@ -7,6 +7,7 @@
  * Halide function using its schedule.
  */
 
+#include <map>
 #include <string>
 #include <vector>
 
@@ -28,7 +29,9 @@ class IRMutator;
  * on. Some stages of lowering may be target-specific. The Module may
  * contain submodules for computation offloaded to another execution
  * engine or API as well as buffers that are used in the passed in
- * Stmt. */
+ * Stmt. If env_without_wrappers is given, it must be the union of
+ * find_transitive_calls over output_funcs; callers that lower the same
+ * frozen Funcs repeatedly can compute it once. */
 Module lower(const std::vector<Function> &output_funcs,
              const std::string &pipeline_name,
              const Target &t,
@@ -36,7 +39,8 @@ Module lower(const std::vector<Function> &output_funcs,
              LinkageType linkage_type,
              const std::vector<Stmt> &requirements = std::vector<Stmt>(),
              bool trace_pipeline = false,
-             const std::vector<IRMutator *> &custom_passes = std::vector<IRMutator *>());
+             const std::vector<IRMutator *> &custom_passes = std::vector<IRMutator *>(),
+             const std::map<std::string, Function> *env_without_wrappers = nullptr);
 
 /** Given a halide function with a schedule, create a statement that
  * evaluates it. Automatically pulls in all the functions f depends
@@ -1,5 +1,6 @@
 #include "LowerWarpShuffles.h"
 
+#include "Deinterleave.h"
 #include "ExprUsesVar.h"
 #include "IREquality.h"
 #include "IRMatch.h"
@@ -20,6 +21,15 @@
 // storage across the lanes (think RAID 0). This is basically the
 // opposite of RewriteAccessToVectorAlloc in Vectorize.cpp.
 //
+// The same is true of subgroups in Metal (SIMD-groups), OpenCL and
+// Vulkan, so we lower lane loops for those APIs too. There the
+// shuffles become calls to halide_gpu_shuffle_{down,up,idx}, which
+// each backend maps to its own subgroup shuffle builtins. This
+// assumes that the warp built from a lane loop is a contiguous run of
+// lanes of a single subgroup, i.e. that the subgroup size is a
+// multiple of the warp size and that the lane loop is the innermost
+// gpu thread dimension.
+//
 // If there were no constraints, we could just arbitrarily slice
 // things up, e.g. on a per-element basis (stride one), but we have
 // the added wrinkle that while threads can load from anywhere, they
@@ -369,6 +379,7 @@ class LowerWarpShuffles : public IRMutator {
     Scope<AllocInfo> allocation_info;
     Scope<Interval> bounds;
     int cuda_cap;
+    DeviceAPI device_api;
 
     Stmt visit(const For *op) override {
         ScopedBinding<Interval>
@@ -516,6 +527,23 @@ class LowerWarpShuffles : public IRMutator {
         }
     }
 
+    // Shuffle a 32-bit value across the lanes of a subgroup, for the
+    // non-CUDA apis. The subgroup builtins the backends use are scalar,
+    // so vectors get one shuffle per lane. For the idx variant arg is
+    // the lane within the warp, rather than within the subgroup.
+    Expr make_subgroup_shuffle(const string &kind, const Expr &val, const Expr &arg) {
+        if (val.type().is_vector()) {
+            vector<Expr> lanes;
+            for (int i = 0; i < val.type().lanes(); i++) {
+                lanes.push_back(make_subgroup_shuffle(kind, extract_lane(val, i),
+                                                      arg.type().is_vector() ? extract_lane(arg, i) : arg));
+            }
+            return Shuffle::make_concat(lanes);
+        }
+        return Call::make(val.type(), "halide_gpu_shuffle_" + kind,
+                          {val, arg, warp_size}, Call::PureExtern);
+    }
+
     Expr make_warp_load(Type type, const string &name, const Expr &idx, Expr lane) {
         // idx: The index of the value within the local allocation
         // lane: Which thread's value we want. If it's our own, we can just use a load.
@@ -585,6 +613,15 @@ class LowerWarpShuffles : public IRMutator {
             intrin_suffix = ".i32";
         }
 
+        Expr membermask = (int)0xffffffff;
+        auto shfl = [&](const string &kind, const Expr &arg, const Expr &c) {
+            if (device_api != DeviceAPI::CUDA) {
+                return make_subgroup_shuffle(kind, base_val, arg);
+            }
+            return Call::make(shuffle_type, "llvm.nvvm.shfl" + sync_suffix + "." + kind + intrin_suffix,
+                              shfl_args({membermask, base_val, arg, c}), Call::PureExtern);
+        };
+
         Expr wild = Variable::make(Int(32), "*");
         vector<Expr> result;
         std::optional<int> bits;
@@ -594,13 +631,10 @@ class LowerWarpShuffles : public IRMutator {
         lane = solve_expression(lane, this_lane_name).result;
 
         Expr shuffled;
-        Expr membermask = (int)0xffffffff;
         if (expr_match(this_lane + wild, lane, result)) {
             // We know that 0 <= lane + wild < warp_size by how we
             // constructed it, so we can just do a shuffle down.
-            Expr down = Call::make(shuffle_type, "llvm.nvvm.shfl" + sync_suffix + ".down" + intrin_suffix,
-                                   shfl_args({membermask, base_val, result[0], 31}), Call::PureExtern);
-            shuffled = down;
+            shuffled = shfl("down", result[0], 31);
         } else if (expr_match((this_lane + wild) % wild, lane, result) &&
                    (bits = is_const_power_of_two_integer(result[1])) &&
                    *bits <= 5) {
@@ -609,10 +643,8 @@ class LowerWarpShuffles : public IRMutator {
             // intermediate registers than using a general gather for
             // this.
             Expr mask = (1 << *bits) - 1;
-            Expr down = Call::make(shuffle_type, "llvm.nvvm.shfl" + sync_suffix + ".down" + intrin_suffix,
-                                   shfl_args({membermask, base_val, result[0], mask}), Call::PureExtern);
-            Expr up = Call::make(shuffle_type, "llvm.nvvm.shfl" + sync_suffix + ".up" + intrin_suffix,
-                                 shfl_args({membermask, base_val, (1 << *bits) - result[0], 0}), Call::PureExtern);
+            Expr down = shfl("down", result[0], mask);
+            Expr up = shfl("up", (1 << *bits) - result[0], 0);
             Expr cond = (this_lane >= (1 << *bits) - result[0]);
             Expr equiv = select(cond, up, down);
             shuffled = simplify(equiv, true, bounds);
@@ -625,8 +657,7 @@ class LowerWarpShuffles : public IRMutator {
             // could hypothetically be used for boundary conditions.
             Expr mask = simplify(((31 & ~(warp_size - 1)) << 8) | 31);
             // The idx variant can do a general gather. Use it for all other cases.
-            shuffled = Call::make(shuffle_type, "llvm.nvvm.shfl" + sync_suffix + ".idx" + intrin_suffix,
-                                  shfl_args({membermask, base_val, lane, mask}), Call::PureExtern);
+            shuffled = shfl("idx", lane, mask);
         }
         // TODO: There are other forms, like butterfly and clamp, that
         // don't need to use the general gather
@@ -656,8 +687,12 @@ class LowerWarpShuffles : public IRMutator {
     }
 
     Stmt visit(const Allocate *op) override {
-        if (this_lane.defined() || op->memory_type == MemoryType::GPUShared) {
-            // Not a warp-level allocation
+        if (this_lane.defined() ||
+            op->memory_type == MemoryType::GPUShared ||
+            op->memory_type == MemoryType::WMMAAccumulator ||
+            op->memory_type == MemoryType::SimdgroupMatrix) {
+            // Not a warp-level allocation (matrix tiles are striped
+            // across the warp by the matrix instructions instead)
             return IRMutator::visit(op);
         } else {
             // Pick up this allocation and deposit it inside the loop over lanes at reduced size.
@@ -667,8 +702,8 @@ class LowerWarpShuffles : public IRMutator {
     }
 
 public:
-    LowerWarpShuffles(int cuda_cap)
-        : cuda_cap(cuda_cap) {
+    LowerWarpShuffles(int cuda_cap, DeviceAPI device_api)
+        : cuda_cap(cuda_cap), device_api(device_api) {
     }
 };
 
@@ -681,7 +716,8 @@ class HoistWarpShufflesFromSingleIfStmt : public IRMutator {
     Expr visit(const Call *op) override {
         // If it was written outside this if clause but read inside of
         // it, we need to hoist it.
-        if (starts_with(op->name, "llvm.nvvm.shfl.") &&
+        if ((starts_with(op->name, "llvm.nvvm.shfl.") ||
+             starts_with(op->name, "halide_gpu_shuffle_")) &&
             !expr_uses_vars(op, stored_to)) {
             string name = unique_name('t');
             lifted_lets.emplace_back(name, op);
@@ -820,9 +856,13 @@ class LowerWarpShufflesInEachKernel : public IRMutator {
     using IRMutator::visit;
 
     Stmt visit(const For *op) override {
-        if (op->device_api == DeviceAPI::CUDA && has_lane_loop(op)) {
+        if ((op->device_api == DeviceAPI::CUDA ||
+             op->device_api == DeviceAPI::Metal ||
+             op->device_api == DeviceAPI::OpenCL ||
+             op->device_api == DeviceAPI::Vulkan) &&
+            has_lane_loop(op)) {
             Stmt s = op;
-            s = LowerWarpShuffles(cuda_cap).mutate(s);
+            s = LowerWarpShuffles(cuda_cap, op->device_api).mutate(s);
             s = HoistWarpShuffles().mutate(s);
             return simplify(s);
         } else {
@@ -3,7 +3,8 @@
 
 /** \file
  * Defines the lowering pass that injects CUDA warp shuffle
- * instructions to access storage outside of a GPULane loop.
+ * instructions (or subgroup shuffles, for Metal, OpenCL and Vulkan) to
+ * access storage outside of a GPULane loop.
  */
 
 #include "Expr.h"
@@ -12,7 +13,9 @@ namespace Halide {
 namespace Internal {
 
 /** Rewrite access to things stored outside the loop over GPU lanes to
- * use nvidia's warp shuffle instructions. */
+ * use nvidia's warp shuffle instructions, or, for the Metal, OpenCL and
+ * Vulkan apis, calls to halide_gpu_shuffle_{down,up,idx}(value, arg,
+ * warp_size) that their backends lower to subgroup shuffles. */
 Stmt lower_warp_shuffles(Stmt s, const Target &t);
 
 }  // namespace Internal
@@ -21,6 +21,10 @@ public:
     FindParameterDependencies() = default;
     ~FindParameterDependencies() override = default;
 
+    // If true, buffers are keyed on a hash of their contents, instead
+    // of being an error.
+    bool hash_buffer_contents = false;
+
     void visit_function(const Function &function) {
         function.accept(this);
 
@@ -28,7 +32,10 @@ public:
             const std::vector<ExternFuncArgument> &extern_args =
                 function.extern_arguments();
             for (const auto &extern_arg : extern_args) {
-                if (extern_arg.is_buffer()) {
+                if (extern_arg.is_buffer() && hash_buffer_contents) {
+                    const Buffer<> &b = extern_arg.buffer;
+                    record_contents_hash(b.name(), Variable::make(type_of<halide_buffer_t *>(), b.name() + ".buffer", b));
+                } else if (extern_arg.is_buffer()) {
                     // Function with an extern definition
                     record(Halide::Parameter(extern_arg.buffer.type(), true,
                                              extern_arg.buffer.dimensions(),
@@ -91,7 +98,11 @@ public:
 
         info.type = parameter.type();
 
-        if (parameter.is_buffer()) {
+        if (parameter.is_buffer() && hash_buffer_contents) {
+            record_contents_hash(parameter.name(),
+                                 Variable::make(type_of<halide_buffer_t *>(), parameter.name() + ".buffer", parameter));
+            return;
+        } else if (parameter.is_buffer()) {
             internal_error
                 << "Buffer parameter " << parameter.name()
                 << " encountered in computed_cached computation.\n"
@@ -121,6 +132,18 @@ public:
         dependency_info[DependencyKey(info.type.bytes(), unique_name("memoize_tag"))] = info;
     }
 
+    // Key on a hash, computed by the runtime each time the key is
+    // built, of the shape and contents of a buffer. Unlike its
+    // address, this doesn't change if the same data is passed in a new
+    // allocation, and does change if the data is modified in place.
+    void record_contents_hash(const std::string &name, const Expr &buffer) {
+        struct DependencyInfo info;
+        info.type = UInt(64);
+        info.size_expr = info.type.bytes();
+        info.value_expr = Call::make(UInt(64), "halide_memoization_hash_buffer", {buffer}, Call::Extern);
+        dependency_info[DependencyKey(info.type.bytes(), name + ".contents_hash")] = info;
+    }
+
     // Used to make sure larger parameters come before smaller ones
     // for alignment reasons.
     struct DependencyKey {
@@ -194,6 +217,7 @@ public:
         : top_level_name(name),
           function_name(function.origin_name()),
           memoize_instance(memoize_instance) {
+        dependencies.hash_buffer_contents = function.schedule().memoize_hash_buffer_contents();
         dependencies.visit_function(function);
         size_t size_so_far = 0;
         size_so_far += Handle().bytes() + 4;
@@ -226,6 +250,9 @@ public:
         // function. Assume this will be unique due to CSE. This can
         // break with loading and unloading of code, though the name
         // mechanism can also break in those conditions.
+        // The runtime parses this string to find the budget set by
+        // halide_memoization_cache_set_site_size, so the format must
+        // stay in sync with partition_for_key in runtime/cache.cpp.
         writes.push_back(Store::make(key_name,
                                      StringImm::make(std::to_string(top_level_name.size()) + ":" + top_level_name +
                                                      std::to_string(function_name.size()) + ":" + function_name),
@@ -1,9 +1,13 @@
 #include "Module.h"
 
+#include <algorithm>
 #include <array>
+#include <cstdlib>
+#include <deque>
 #include <fstream>
 #include <future>
 #include <memory>
+#include <thread>
 #include <utility>
 
 #include "CodeGen_C.h"
@@ -327,6 +331,7 @@ struct ModuleContents {
     std::vector<Module> submodules;
     MetadataNameMap metadata_name_map;
     bool any_strict_float{false};
+    bool skip_llvm_optimization{false};
     std::unique_ptr<AutoSchedulerResults> auto_scheduler_results;
 
     /** This is a copy of the code throughout the lowering process, which
@@ -386,6 +391,10 @@ void Module::set_any_strict_float(bool any_strict_float) {
     contents->any_strict_float = any_strict_float;
 }
 
+void Module::set_skip_llvm_optimization(bool skip) {
+    contents->skip_llvm_optimization = skip;
+}
+
 const Target &Module::target() const {
     return contents->target;
 }
@@ -402,6 +411,10 @@ bool Module::any_strict_float() const {
     return contents->any_strict_float;
 }
 
+bool Module::skip_llvm_optimization() const {
+    return contents->skip_llvm_optimization;
+}
+
 const std::vector<Buffer<>> &Module::buffers() const {
     return contents->buffers;
 }
@@ -837,7 +850,8 @@ void compile_multitarget(const std::string &fn_name,
                          const std::vector<Target> &targets,
                          const std::vector<std::string> &suffixes,
                          const ModuleFactory &module_factory,
-                         const CompilerLoggerFactory &compiler_logger_factory) {
+                         const CompilerLoggerFactory &compiler_logger_factory,
+                         int num_threads) {
     validate_outputs(output_files);
 
     user_assert(!fn_name.empty()) << "Function name must be specified.\n";
@@ -913,6 +927,17 @@ void compile_multitarget(const std::string &fn_name,
     constexpr int kFeaturesWordCount = (Target::FeatureEnd + 63) / (sizeof(uint64_t) * 8);
     uint64_t runtime_features[kFeaturesWordCount] = {(uint64_t)-1LL};
 
+    // Lowering always happens on this thread, but code generation for the
+    // sub-targets can be spread across several. This is off by default:
+    // unique_name() counters are shared by all threads, so concurrent code
+    // generation makes some local symbol names vary from run to run.
+    std::string compile_threads_str = get_env_variable("HL_MULTITARGET_COMPILE_THREADS");
+    if (!compile_threads_str.empty()) {
+        num_threads = std::atoi(compile_threads_str.c_str());
+    }
+    const size_t compile_threads = num_threads > 0 ? (size_t)num_threads : std::max(1u, std::thread::hardware_concurrency());
+    std::deque<std::future<void>> pending_compiles;
+
     TemporaryFileDir temp_obj_dir, temp_compiler_log_dir;
     std::vector<Expr> wrapper_args;
     std::vector<LoweredArgument> base_target_args;
@@ -976,7 +1001,21 @@ void compile_multitarget(const std::string &fn_name,
                 sub_out[OutputFileType::compiler_log] = temp_compiler_log_dir.add_temp_file(output_files.at(OutputFileType::compiler_log), suffix, target);
             }
             debug(1) << "compile_multitarget: compile_sub_target " << sub_out[OutputFileType::object] << "\n";
-            sub_module.compile(sub_out);
+            if (compile_threads > 1) {
+                while (pending_compiles.size() >= compile_threads) {
+                    pending_compiles.front().get();
+                    pending_compiles.pop_front();
+                }
+                pending_compiles.push_back(std::async(
+                    std::launch::async,
+                    [sub_module, sub_out, logger = set_compiler_logger(nullptr)]() mutable {
+                        set_compiler_logger(std::move(logger));
+                        sub_module.compile(sub_out);
+                        set_compiler_logger(nullptr);
+                    }));
+            } else {
+                sub_module.compile(sub_out);
+            }
             const auto *r = sub_module.get_auto_scheduler_results();
             auto_scheduler_results.push_back(r ? *r : AutoSchedulerResults());
             if (target == base_target) {
@@ -1000,6 +1039,17 @@ void compile_multitarget(const std::string &fn_name,
             can_use = Call::make(Int(32), "halide_can_use_target_features",
                                  {kFeaturesWordCount, Call::make(type_of<uint64_t *>(), Call::make_struct, features_struct_args, Call::Intrinsic)},
                                  Call::Extern);
+            // Code for scalable vectors is compiled for one fixed vector
+            // width, so sub-targets that differ only in vector_bits (e.g.
+            // sve2-vector_bits_256 and sve2-vector_bits_128) must also match
+            // the width of the hardware running them.
+            if (target.arch == Target::ARM &&
+                target.features_any_of({Target::SVE, Target::SVE2}) &&
+                target.vector_bits != 0) {
+                Expr vector_bits_match = Call::make(Int(32), "halide_can_use_target_vector_bits",
+                                                    {target.vector_bits}, Call::Extern);
+                can_use = can_use != 0 && vector_bits_match != 0;
+            }
         } else {
             can_use = IntImm::make(Int(32), 1);
         }
@@ -1008,10 +1058,15 @@ void compile_multitarget(const std::string &fn_name,
             runtime_features[i] &= cur_target_features[i];
         }
 
-        wrapper_args.push_back(can_use != 0);
+        wrapper_args.push_back(can_use.type().is_bool() ? can_use : can_use != 0);
         wrapper_args.emplace_back(sub_fn_name);
     }
 
+    while (!pending_compiles.empty()) {
+        pending_compiles.front().get();
+        pending_compiles.pop_front();
+    }
+
     // If we haven't specified "no runtime", build a runtime with the base target
     // and add that to the result.
     if (!base_target.has_feature(Target::NoRuntime)) {
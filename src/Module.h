@@ -86,6 +86,17 @@ struct LoweredArgument : public Argument {
      * argument. */
     ModulusRemainder alignment;
 
+    /** For buffer arguments, the layout the pipeline prefers, as
+     * reported in the metadata: the alignment in bytes it requires
+     * of the host pointer, a halide_buffer_layout_t, and the multiple
+     * of elements to pad the first dimension to (see
+     * halide_filter_argument_t). */
+    // @{
+    int host_alignment = 0;
+    halide_buffer_layout_t layout = halide_buffer_layout_unknown;
+    int padding = 0;
+    // @}
+
     LoweredArgument() = default;
     explicit LoweredArgument(const Argument &arg)
         : Argument(arg) {
@@ -114,6 +125,12 @@ struct LoweredFunc {
      * the Target. */
     NameMangling name_mangling;
 
+    /** Target features, in the '-'-separated form used by Target
+     * strings, that code generation may use for this function on top
+     * of those of the Module's target. Set on the loop nests outlined
+     * for Stage::specialize_target_features. */
+    std::string target_features;
+
     LoweredFunc(const std::string &name,
                 const std::vector<LoweredArgument> &args,
                 Stmt body,
@@ -159,6 +176,10 @@ public:
     /** Return whether this module uses strict floating-point anywhere. */
     bool any_strict_float() const;
 
+    /** Return whether LLVM's optimization passes should be skipped when
+     * compiling this module. */
+    bool skip_llvm_optimization() const;
+
     /** The declarations contained in this module. */
     // @{
     const std::vector<Buffer<void>> &buffers() const;
@@ -216,6 +237,10 @@ public:
     /** Set whether this module uses strict floating-point directives anywhere. */
     void set_any_strict_float(bool any_strict_float);
 
+    /** Set whether LLVM's optimization passes should be skipped when
+     * compiling this module. Used for quickly-compiled fallback code. */
+    void set_skip_llvm_optimization(bool skip);
+
     /** Remember the Stmt during lowing before device-specific offloading. */
     void set_conceptual_code_stmt(const Internal::Stmt &stmt);
 
@@ -242,12 +267,18 @@ std::map<OutputFileType, std::string> compile_standalone_runtime(const std::map<
 using ModuleFactory = std::function<Module(const std::string &fn_name, const Target &target)>;
 using CompilerLoggerFactory = std::function<std::unique_ptr<Internal::CompilerLogger>(const std::string &fn_name, const Target &target)>;
 
+/** Compile the modules that module_factory makes for each of the targets,
+ * along with a wrapper that picks one of them at runtime. Code generation
+ * for up to num_threads of the targets runs at once (0 means one per
+ * core), unless HL_MULTITARGET_COMPILE_THREADS is set, which overrides it.
+ * module_factory is always called on the calling thread. */
 void compile_multitarget(const std::string &fn_name,
                          const std::map<OutputFileType, std::string> &output_files,
                          const std::vector<Target> &targets,
                          const std::vector<std::string> &suffixes,
                          const ModuleFactory &module_factory,
-                         const CompilerLoggerFactory &compiler_logger_factory = nullptr);
+                         const CompilerLoggerFactory &compiler_logger_factory = nullptr,
+                         int num_threads = 1);
 
 }  // namespace Halide
 
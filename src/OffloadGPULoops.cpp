@@ -1,4 +1,7 @@
+#include <deque>
+#include <future>
 #include <memory>
+#include <thread>
 
 #include "CanonicalizeGPUVars.h"
 #include "Closure.h"
@@ -85,6 +88,44 @@ private:
     }
 };
 
+// Run each iteration of the loops over devices made by
+// Stage::distribute on its own GPU device: select the device, and
+// initialize the kernels (which compiles them for that device's context
+// the first time) before running the iteration. Afterwards, put back
+// the device that was selected before the loop.
+class InjectDeviceSelection : public IRMutator {
+    const vector<Stmt> &init_kernels;
+
+    using IRMutator::visit;
+
+    Stmt visit(const For *op) override {
+        Stmt stmt = IRMutator::visit(op);
+        if (op->name.find(".__gpu_device_") == string::npos) {
+            return stmt;
+        }
+        op = stmt.as<For>();
+        internal_assert(op);
+
+        Expr device = Variable::make(Int(32), op->name) - op->min;
+        vector<Stmt> body = {Evaluate::make(Call::make(Int(32), "halide_set_gpu_device", {device}, Call::Extern))};
+        body.insert(body.end(), init_kernels.begin(), init_kernels.end());
+        body.push_back(op->body);
+        stmt = For::make(op->name, op->min, op->extent, op->for_type, op->partition_policy,
+                         op->device_api, Block::make(body));
+
+        string prev_device = op->name + ".prev_gpu_device";
+        Expr prev_device_var = Variable::make(Int(32), prev_device);
+        Stmt restore = Evaluate::make(Call::make(Int(32), "halide_set_gpu_device", {prev_device_var}, Call::Extern));
+        return LetStmt::make(prev_device, Call::make(Int(32), "halide_get_gpu_device", {}, Call::Extern),
+                             Block::make(stmt, restore));
+    }
+
+public:
+    InjectDeviceSelection(const vector<Stmt> &init_kernels)
+        : init_kernels(init_kernels) {
+    }
+};
+
 class InjectGpuOffload : public IRMutator {
     /** Child code generator for device kernels. */
     map<DeviceAPI, unique_ptr<CodeGen_GPU_Dev>> cgdev;
@@ -93,6 +134,61 @@ class InjectGpuOffload : public IRMutator {
 
     const Target &target;
 
+    // How many kernels to compile at once, for backends that support
+    // it. Kernels still appear in each device module in program order,
+    // but this is off by default: unique_name() counters are shared by
+    // all threads, so concurrent code generation makes some names in the
+    // kernel sources vary from run to run.
+    size_t compile_threads = 1;
+
+    // The kernels being compiled concurrently on code generators from
+    // new_kernel_compiler(), in the order they should appear in each
+    // device module.
+    struct PendingKernel {
+        unique_ptr<CodeGen_GPU_Dev> compiler;
+        std::shared_future<void> done;
+    };
+    map<DeviceAPI, vector<PendingKernel>> pending_kernels;
+    std::deque<std::shared_future<void>> running_compiles;
+
+    // Compile a kernel, possibly on another thread, and return its name.
+    string add_kernel(CodeGen_GPU_Dev *gpu_codegen, DeviceAPI device_api, const Stmt &loop,
+                      const string &kernel_name, const vector<DeviceArgument> &closure_args) {
+        unique_ptr<CodeGen_GPU_Dev> compiler;
+        if (compile_threads > 1) {
+            compiler = gpu_codegen->new_kernel_compiler();
+        }
+        if (!compiler) {
+            gpu_codegen->add_kernel(loop, kernel_name, closure_args);
+            return gpu_codegen->get_current_kernel_name();
+        }
+        while (running_compiles.size() >= compile_threads) {
+            running_compiles.front().wait();
+            running_compiles.pop_front();
+        }
+        CodeGen_GPU_Dev *c = compiler.get();
+        std::shared_future<void> done =
+            std::async(std::launch::async, [=]() {
+                c->add_kernel(loop, kernel_name, closure_args);
+            }).share();
+        running_compiles.push_back(done);
+        pending_kernels[device_api].push_back({std::move(compiler), done});
+        return kernel_name;
+    }
+
+    // Append the kernels compiled concurrently to their device modules,
+    // rethrowing any error from compiling them.
+    void finish_pending_kernels() {
+        for (auto &p : pending_kernels) {
+            for (auto &k : p.second) {
+                k.done.get();
+                cgdev[p.first]->append_kernels(*k.compiler);
+            }
+        }
+        pending_kernels.clear();
+        running_compiles.clear();
+    }
+
     Expr get_state_var(const string &name) {
         // Expr v = Variable::make(type_of<void *>(), name);
         state_needed[name] = true;
@@ -173,10 +269,8 @@ class InjectGpuOffload : public IRMutator {
         user_assert(gpu_codegen != nullptr)
             << "Loop is scheduled on device " << loop->device_api
             << " which does not appear in target " << target.to_string() << "\n";
-        gpu_codegen->add_kernel(loop, kernel_name, closure_args);
-
         // get the actual name of the generated kernel for this loop
-        kernel_name = gpu_codegen->get_current_kernel_name();
+        kernel_name = add_kernel(gpu_codegen, loop->device_api, loop, kernel_name, closure_args);
         debug(2) << "Compiled launch to kernel \"" << kernel_name << "\"\n";
 
         bool runtime_run_takes_types = gpu_codegen->kernel_run_takes_types();
@@ -272,6 +366,12 @@ public:
         }
 
         internal_assert(!cgdev.empty()) << "Requested unknown GPU target: " << target.to_string() << "\n";
+
+        std::string compile_threads_str = get_env_variable("HL_GPU_KERNEL_COMPILE_THREADS");
+        if (!compile_threads_str.empty()) {
+            int n = std::atoi(compile_threads_str.c_str());
+            compile_threads = n > 0 ? (size_t)n : std::max(1u, std::thread::hardware_concurrency());
+        }
     }
 
     Stmt inject(const Stmt &s) {
@@ -281,7 +381,10 @@ public:
         }
 
         Stmt result = mutate(s);
+        finish_pending_kernels();
 
+        vector<string> state_names;
+        vector<Stmt> init_kernels, register_destructors;
         for (auto &i : cgdev) {
             string api_unique_name = i.second->api_unique_name();
 
@@ -290,7 +393,6 @@ public:
             if (!state_needed[api_unique_name]) {
                 continue;
             }
-            Expr state_ptr = make_state_var(api_unique_name);
             Expr state_ptr_var = Variable::make(type_of<void *>(), api_unique_name);
 
             debug(2) << "Generating init_kernels for " << api_unique_name << "\n";
@@ -299,14 +401,22 @@ public:
 
             string init_kernels_name = "halide_" + api_unique_name + "_initialize_kernels";
             vector<Expr> init_args = {state_ptr_var, kernel_src_buf, Expr((int)kernel_src.size())};
-            Stmt init_kernels = call_extern_and_assert(init_kernels_name, init_args);
+            init_kernels.push_back(call_extern_and_assert(init_kernels_name, init_args));
 
             string destructor_name = "halide_" + api_unique_name + "_finalize_kernels";
             vector<Expr> finalize_args = {Expr(destructor_name), get_state_var(api_unique_name)};
-            Stmt register_destructor = Evaluate::make(
-                Call::make(Handle(), Call::register_destructor, finalize_args, Call::Intrinsic));
+            register_destructors.push_back(Evaluate::make(
+                Call::make(Handle(), Call::register_destructor, finalize_args, Call::Intrinsic)));
+
+            state_names.push_back(api_unique_name);
+        }
+
+        result = InjectDeviceSelection(init_kernels).mutate(result);
 
-            result = LetStmt::make(api_unique_name, state_ptr, Block::make({init_kernels, register_destructor, result}));
+        for (size_t i = 0; i < state_names.size(); i++) {
+            Expr state_ptr = make_state_var(state_names[i]);
+            result = LetStmt::make(state_names[i], state_ptr,
+                                   Block::make({init_kernels[i], register_destructors[i], result}));
         }
         return result;
     }
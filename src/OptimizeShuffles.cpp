@@ -23,6 +23,7 @@ namespace {
 
 class OptimizeShuffles : public IRMutator {
     int lut_alignment;
+    const std::function<int(const Type &)> &max_lut_size;
     Scope<Interval> bounds;
     std::vector<std::pair<std::string, Expr>> lets;
 
@@ -88,12 +89,13 @@ class OptimizeShuffles : public IRMutator {
         }
 
         Expr index = mutate(op->index);
+        const int max_size = max_lut_size(op->type.element_of());
         Interval unaligned_index_bounds = bounds_of_expr_in_scope(index, bounds);
-        if (unaligned_index_bounds.is_bounded()) {
+        if (max_size > 0 && unaligned_index_bounds.is_bounded()) {
             // We want to try both the unaligned and aligned
-            // bounds. The unaligned bounds might fit in 256 elements,
+            // bounds. The unaligned bounds might fit in the LUT,
             // while the aligned bounds do not.
-            int align = lut_alignment / op->type.bytes();
+            int align = std::max(1, lut_alignment / op->type.bytes());
             Interval aligned_index_bounds = {
                 (unaligned_index_bounds.min / align) * align,
                 ((unaligned_index_bounds.max + align) / align) * align - 1};
@@ -104,17 +106,24 @@ class OptimizeShuffles : public IRMutator {
                 index_span = common_subexpression_elimination(index_span);
                 index_span = simplify(index_span);
 
-                if (can_prove(index_span < 256)) {
-                    // This is a lookup within an up to 256 element array. We
-                    // can use dynamic_shuffle for this.
-                    int const_extent = as_const_int(index_span) ? *as_const_int(index_span) + 1 : 256;
+                if (can_prove(index_span < max_size)) {
+                    // This is a lookup within an up to max_size element
+                    // array. We can use dynamic_shuffle for this.
+                    if (!as_const_int(index_span) && align == 1) {
+                        // Without alignment padding, a LUT longer than the
+                        // span could read past the end of the buffer.
+                        continue;
+                    }
+                    int const_extent = as_const_int(index_span) ? *as_const_int(index_span) + 1 : max_size;
                     Expr base = simplify(index_bounds.min);
 
                     // Load all of the possible indices loaded from the
                     // LUT. Note that for clamped ramps, this loads up to 1
                     // vector past the max, so we will add padding to the
                     // allocation accordingly (if we're the one that made it).
-                    allocations_to_pad.insert(op->name);
+                    if (align > 1) {
+                        allocations_to_pad.insert(op->name);
+                    }
                     Expr lut = Load::make(op->type.with_lanes(const_extent), op->name,
                                           Ramp::make(base, 1, const_extent),
                                           op->image, op->param, const_true(const_extent), alignment);
@@ -137,14 +146,14 @@ class OptimizeShuffles : public IRMutator {
     }
 
 public:
-    OptimizeShuffles(int lut_alignment)
-        : lut_alignment(lut_alignment) {
+    OptimizeShuffles(int lut_alignment, const std::function<int(const Type &)> &max_lut_size)
+        : lut_alignment(lut_alignment), max_lut_size(max_lut_size) {
     }
 };
 }  // namespace
 
-Stmt optimize_shuffles(Stmt s, int lut_alignment) {
-    s = OptimizeShuffles(lut_alignment).mutate(s);
+Stmt optimize_shuffles(Stmt s, int lut_alignment, const std::function<int(const Type &)> &max_lut_size) {
+    s = OptimizeShuffles(lut_alignment, max_lut_size).mutate(s);
     return s;
 }
 
@@ -8,12 +8,19 @@
 
 #include "Expr.h"
 
+#include <functional>
+
 namespace Halide {
 namespace Internal {
 
 /* Replace indirect loads with dynamic_shuffle intrinsics where
-possible. */
-Stmt optimize_shuffles(Stmt s, int lut_alignment);
+possible. max_lut_size gives the largest table the target can shuffle
+from for a given element type, or zero if it can't. LUT loads are
+rounded out to lut_alignment bytes, padding allocations to match; with
+an alignment of one element they never read outside the range the
+original load could touch. */
+Stmt optimize_shuffles(Stmt s, int lut_alignment,
+                       const std::function<int(const Type &)> &max_lut_size);
 
 }  // namespace Internal
 }  // namespace Halide
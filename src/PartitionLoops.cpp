@@ -324,6 +324,7 @@ class FindSimplifications : public IRVisitor {
     void visit(const Max *op) override {
         bool likely_a = has_uncaptured_likely(op->a);
         bool likely_b = has_uncaptured_likely(op->b);
+        bool visited_neither = likely_a && likely_b;
 
         if (!likely_a) {
             op->b.accept(this);
@@ -341,6 +342,11 @@ class FindSimplifications : public IRVisitor {
             new_simplification(op->b >= op->a, op, op->b, op->a);
         } else if (likely_a && !likely_b) {
             new_simplification(op->a >= op->b, op, op->a, op->b);
+        } else if (visited_neither) {
+            // Uncaptured likelies on both sides, so we haven't looked
+            // inside either of them yet. Continue inwards, to find
+            // nested mins and maxes.
+            IRVisitor::visit(op);
         }
     }
 
@@ -537,7 +543,7 @@ bool contains_warp_synchronous_logic(const Stmt &s) {
 class PartitionLoops : public IRMutator {
     using IRMutator::visit;
 
-    bool in_gpu_loop = false;
+    bool in_gpu_thread_loop = false;
     bool in_tail = false;
 
     Stmt visit(const For *op) override {
@@ -567,11 +573,20 @@ class PartitionLoops : public IRMutator {
             }
         } mutation_checker{op, op->partition_policy == Partition::Always};
 
-        ScopedValue<bool> old_in_gpu_loop(in_gpu_loop, in_gpu_loop || is_gpu(op->for_type));
-
-        // If we're inside GPU kernel, and the body contains thread
-        // barriers or warp shuffles, it's not safe to partition loops.
-        if (in_gpu_loop && contains_warp_synchronous_logic(op)) {
+        ScopedValue<bool> old_in_gpu_thread_loop(in_gpu_thread_loop,
+                                                 in_gpu_thread_loop ||
+                                                     op->for_type == ForType::GPUThread ||
+                                                     op->for_type == ForType::GPULane);
+
+        // If we're inside the thread loops of a GPU kernel, and the
+        // body contains thread barriers or warp shuffles, it's not safe
+        // to partition loops, as the threads of a block may take
+        // different branches. Partitioning a block loop (or a serial
+        // loop outside of the thread loops) is fine: the condition
+        // can't depend on the thread index, so every thread of a block
+        // takes the same branch. This is what lets interior tiles run
+        // without the clamps of a boundary condition.
+        if (in_gpu_thread_loop && contains_warp_synchronous_logic(op)) {
             return IRMutator::visit(op);
         }
 
@@ -1,4 +1,7 @@
 #include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <future>
 #include <utility>
 
 #include "Argument.h"
@@ -7,6 +10,7 @@
 #include "Deserialization.h"
 #include "FindCalls.h"
 #include "Func.h"
+#include "IRInterpreter.h"
 #include "IRVisitor.h"
 #include "InferArguments.h"
 #include "LLVM_Output.h"
@@ -15,6 +19,7 @@
 #include "Pipeline.h"
 #include "PrintLoopNest.h"
 #include "RealizationOrder.h"
+#include "Roofline.h"
 #include "Serialization.h"
 #include "WasmExecutor.h"
 
@@ -116,15 +121,53 @@ struct PipelineContents {
     // Cached jit-compiled code
     JITCache jit_cache;
 
+    // A jit compile started by Pipeline::compile_jit_async that has not
+    // yet been moved into jit_cache. The result is only valid once
+    // async_jit_done is ready.
+    std::shared_future<void> async_jit_done;
+    std::shared_ptr<JITCache> async_jit_cache;
+    Target async_jit_target;
+
     /** Clear all cached state */
     void invalidate_cache() {
         module = Module("", Target());
         jit_cache = JITCache();
+        // A background compile still running owns everything it
+        // touches, so it's safe to just drop our reference to it.
+        async_jit_done = std::shared_future<void>();
+        async_jit_cache.reset();
+        async_jit_target = Target();
+        last_realize_shapes = RealizeShapes();
+    }
+
+    /** Move the result of a background jit compile into jit_cache, if
+     * it's done. If wait is true, block until it is. Rethrows any
+     * error from the compile. */
+    void install_async_jit_cache(bool wait) {
+        if (!async_jit_done.valid()) {
+            return;
+        }
+        if (!wait && async_jit_done.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+            return;
+        }
+        std::shared_future<void> done = std::move(async_jit_done);
+        std::shared_ptr<JITCache> result = std::move(async_jit_cache);
+        async_jit_done = std::shared_future<void>();
+        async_jit_target = Target();
+        jit_cache = JITCache();
+        last_realize_shapes = RealizeShapes();
+        done.get();
+        jit_cache = std::move(*result);
     }
 
     // The outputs
     vector<Function> outputs;
 
+    // Every Function the outputs call, ignoring wrappers. Definitions can't
+    // change once frozen, so this survives invalidate_cache(); anything a
+    // schedule changes, including Func::in(), is picked up during lowering.
+    std::map<string, Function> env_without_wrappers;
+
     // JIT custom overrides
     JITHandlers jit_handlers;
 
@@ -151,6 +194,17 @@ struct PipelineContents {
 
     bool trace_pipeline = false;
 
+    /** The shapes of the outputs found by the last bounds query made
+     * by realize(sizes), along with what they depend on: the requested
+     * sizes, and the values of the scalar arguments and the shapes of
+     * the buffer arguments. A call that matches all of these can skip
+     * the query. */
+    struct RealizeShapes {
+        vector<int32_t> sizes;
+        vector<uint8_t> arg_signature;
+        vector<vector<halide_dimension_t>> output_dims;
+    } last_realize_shapes;
+
     PipelineContents()
         : module("", Target()) {
         user_context_arg.arg = Argument("__user_context", Argument::InputScalar, type_of<const void *>(), 0, ArgumentEstimates{});
@@ -348,6 +402,17 @@ void Pipeline::print_loop_nest() {
     debug(0) << Halide::Internal::print_loop_nest(contents->outputs);
 }
 
+void Pipeline::compile_to_roofline_html(const string &filename,
+                                        const string &profiler_report,
+                                        double peak_ops_per_second,
+                                        double peak_bytes_per_second) {
+    user_assert(defined()) << "Can't write the roofline of undefined Pipeline.\n";
+    std::ofstream file(filename);
+    user_assert(file.is_open()) << "Unable to open " << filename << " for writing.\n";
+    file << Halide::Internal::print_roofline_html(contents->outputs, contents->outputs[0].name(),
+                                                  profiler_report, peak_ops_per_second, peak_bytes_per_second);
+}
+
 void Pipeline::compile_to_lowered_stmt(const string &filename,
                                        const vector<Argument> &args,
                                        StmtOutputFormat fmt,
@@ -555,9 +620,27 @@ Module Pipeline::compile_to_module(const vector<Argument> &args,
             custom_passes.push_back(p.pass);
         }
 
+        if (contents->env_without_wrappers.empty()) {
+            std::map<string, Function> env;
+            for (const Function &f : contents->outputs) {
+                std::map<string, Function> more_funcs = find_transitive_calls(f);
+                env.insert(more_funcs.begin(), more_funcs.end());
+            }
+            // Funcs only used as extern arguments aren't frozen, so they could
+            // still gain definitions that call new Funcs.
+            bool all_frozen = true;
+            for (const auto &it : env) {
+                all_frozen &= it.second.frozen();
+            }
+            if (all_frozen) {
+                contents->env_without_wrappers = std::move(env);
+            }
+        }
+
         contents->module = lower(contents->outputs, new_fn_name, target, lowering_args,
                                  linkage_type, contents->requirements, contents->trace_pipeline,
-                                 custom_passes);
+                                 custom_passes,
+                                 contents->env_without_wrappers.empty() ? nullptr : &contents->env_without_wrappers);
     }
 
     return contents->module;
@@ -575,6 +658,64 @@ Target Pipeline::get_compiled_jit_target() const {
     return contents->jit_cache.get_compiled_jit_target();
 }
 
+namespace {
+
+void add_output_arguments(std::vector<Argument> &args, const std::vector<Internal::Function> &outputs) {
+    for (const auto &out : outputs) {
+        for (Type t : out.output_types()) {
+            // Note carefully: out.name() could well be a uniquified name with "$6" or similar tacked onto the end.
+            // For most downstream purposes, this is irrelevant, but for at least one case (parsing kwargs
+            // from Python) these will have to be stripped. We're deliberately *not* stripping here, to avoid
+            // injecting possible hard-to-debug issues from name collisions with "creative" uses; the downstream
+            // code must take care to strip any suffixes as needed.
+            args.emplace_back(out.name(), Argument::OutputBuffer, t, out.dimensions(), ArgumentEstimates{});
+        }
+    }
+}
+
+// The part of jit compilation that happens after lowering and after
+// any extern Funcs have been compiled. It touches no Pipeline state,
+// so it can safely run on another thread.
+JITCache compile_lowered_jit_cache(const Module &module,
+                                   std::vector<Argument> args,
+                                   const std::string &output_name,
+                                   std::map<std::string, JITExtern> jit_externs,
+                                   const std::vector<JITModule> &externs_jit_module,
+                                   const Target &jit_target) {
+    JITModule jit_module;
+    WasmModule wasm_module;
+    InterpretedModule interpreted_module;
+
+    if (jit_target.has_feature(Target::JITInterp)) {
+        user_assert(jit_externs.empty())
+            << "The IR interpreter (Target::JITInterp) can't call JIT externs. "
+            << "Remove jit_interp from the target to JIT-compile the pipeline instead.\n";
+        interpreted_module = InterpretedModule::compile(module, args, sanitize_function_name(output_name));
+    } else if (jit_target.arch == Target::WebAssembly) {
+        FindExterns find_externs(jit_externs);
+        for (const LoweredFunc &f : module.functions()) {
+            f.body.accept(&find_externs);
+        }
+        if (debug::debug_level() >= 1) {
+            for (const auto &p : jit_externs) {
+                debug(1) << "Found extern: " << p.first << "\n";
+            }
+        }
+
+        wasm_module = WasmModule::compile(module, args,
+                                          module.name(), jit_externs, externs_jit_module);
+    } else {
+        std::string name = sanitize_function_name(output_name);
+        auto f = module.get_function_by_name(name);
+        jit_module = JITModule(module, f, externs_jit_module);
+    }
+
+    return JITCache(jit_target, std::move(args), std::move(jit_externs), std::move(jit_module), std::move(wasm_module),
+                    std::move(interpreted_module));
+}
+
+}  // namespace
+
 void Pipeline::compile_jit(const Target &target_arg) {
     user_assert(defined()) << "Pipeline is undefined\n";
 
@@ -591,6 +732,13 @@ void Pipeline::compile_jit(const Target &target_arg) {
 
     target.set_features({Target::JIT, Target::UserContext});
 
+    // Pick up the result of compile_jit_async, if there is one for this
+    // target. Keep using the fallback code until it is ready, or wait
+    // for it if there is no fallback.
+    if (contents->async_jit_done.valid() && contents->async_jit_target == target) {
+        contents->install_async_jit_cache(get_compiled_jit_target() != target);
+    }
+
     // If we're re-jitting for the same target, we can just keep the old jit module.
     if (get_compiled_jit_target() == target) {
         debug(2) << "Reusing old jit module compiled for :\n"
@@ -678,44 +826,85 @@ Callable Pipeline::compile_to_callable(const std::vector<Argument> &args_in, con
 
     debug(2) << "jit-compiling for: " << target_arg << "\n";
 
-    for (const auto &out : outputs) {
-        for (Type t : out.output_types()) {
-            // Note carefully: out.name() could well be a uniquified name with "$6" or similar tacked onto the end.
-            // For most downstream purposes, this is irrelevant, but for at least one case (parsing kwargs
-            // from Python) these will have to be stripped. We're deliberately *not* stripping here, to avoid
-            // injecting possible hard-to-debug issues from name collisions with "creative" uses; the downstream
-            // code must take care to strip any suffixes as needed.
-            args.emplace_back(out.name(), Argument::OutputBuffer, t, out.dimensions(), ArgumentEstimates{});
-        }
-    }
-
-    JITModule jit_module;
-    WasmModule wasm_module;
+    add_output_arguments(args, outputs);
 
     // Note that make_externs_jit_module() mutates the jit_externs, so we keep a copy
     // TODO: it fills in the value side with JITExtern values, but does anything actually use those?
     auto jit_externs = jit_externs_in;
     std::vector<JITModule> externs_jit_module = Pipeline::make_externs_jit_module(jit_target, jit_externs);
-    if (jit_target.arch == Target::WebAssembly) {
-        FindExterns find_externs(jit_externs);
+    return compile_lowered_jit_cache(module, std::move(args), outputs[0].name(),
+                                     std::move(jit_externs), externs_jit_module, jit_target);
+}
+
+std::shared_future<void> Pipeline::compile_jit_async(const Target &target_arg, bool use_fallback) {
+    user_assert(defined()) << "Pipeline is undefined\n";
+
+    Target target = target_arg;
+    if (target.has_unknowns()) {
+        target = get_compiled_jit_target();
+        if (target.has_unknowns()) {
+            target = get_jit_target_from_environment();
+        }
+    }
+    target.set_features({Target::JIT, Target::UserContext});
+    user_assert(!target.has_unknowns()) << "Cannot jit-compile for target '" << target << "'\n";
+
+    if (contents->async_jit_done.valid() && contents->async_jit_target == target) {
+        return contents->async_jit_done;
+    }
+    if (get_compiled_jit_target() == target) {
+        std::promise<void> already_compiled;
+        already_compiled.set_value();
+        return already_compiled.get_future().share();
+    }
+    contents->invalidate_cache();
+
+    // Lowering reads (and caches things on) the Funcs in the pipeline,
+    // so it stays on this thread. So does compiling any extern Funcs,
+    // which mutates their Pipelines. All that's left for the
+    // background thread is LLVM optimization and code generation.
+    infer_arguments();
+    vector<Argument> args;
+    for (const InferredArgument &arg : contents->inferred_args) {
+        args.push_back(arg.arg);
+    }
+    Module module = compile_to_module(args, generate_function_name(), target).resolve_submodules();
+    add_output_arguments(args, contents->outputs);
+    std::map<std::string, JITExtern> jit_externs = contents->jit_externs;
+    std::vector<JITModule> externs_jit_module = make_externs_jit_module(target, jit_externs);
+    const std::string output_name = contents->outputs[0].name();
+
+    if (use_fallback) {
+        // Same lowered code, but skip LLVM's optimization passes, which
+        // is where most of the time goes for large pipelines.
+        Module unoptimized(module.name(), module.target(), module.get_metadata_name_map());
+        for (const Buffer<> &b : module.buffers()) {
+            unoptimized.append(b);
+        }
         for (const LoweredFunc &f : module.functions()) {
-            f.body.accept(&find_externs);
+            unoptimized.append(f);
         }
-        if (debug::debug_level() >= 1) {
-            for (const auto &p : jit_externs) {
-                debug(1) << "Found extern: " << p.first << "\n";
-            }
+        for (const Module &m : module.submodules()) {
+            unoptimized.append(m);
         }
-
-        wasm_module = WasmModule::compile(module, args,
-                                          module.name(), jit_externs, externs_jit_module);
-    } else {
-        std::string name = sanitize_function_name(outputs[0].name());
-        auto f = module.get_function_by_name(name);
-        jit_module = JITModule(module, f, externs_jit_module);
+        unoptimized.set_any_strict_float(module.any_strict_float());
+        unoptimized.set_skip_llvm_optimization(true);
+        contents->jit_cache = compile_lowered_jit_cache(unoptimized, args, output_name,
+                                                        jit_externs, externs_jit_module, target);
     }
 
-    return JITCache(jit_target, std::move(args), std::move(jit_externs), std::move(jit_module), std::move(wasm_module));
+    auto result = std::make_shared<JITCache>();
+    contents->async_jit_cache = result;
+    contents->async_jit_target = target;
+    contents->async_jit_done =
+        std::async(std::launch::async,
+                   [=, args = std::move(args), jit_externs = std::move(jit_externs),
+                    externs_jit_module = std::move(externs_jit_module)]() {
+                       *result = compile_lowered_jit_cache(module, args, output_name,
+                                                           jit_externs, externs_jit_module, target);
+                   })
+            .share();
+    return contents->async_jit_done;
 }
 
 void Pipeline::set_jit_externs(const std::map<std::string, JITExtern> &externs) {
@@ -753,6 +942,44 @@ JITHandlers &Pipeline::jit_handlers() {
     return contents->jit_handlers;
 }
 
+namespace {
+
+// The values of the scalar arguments, and the types and shapes of the
+// buffer arguments, which is everything an output bounds query depends
+// on. Returns false if an input buffer isn't bound, as then the query
+// is going to fail anyway.
+bool realize_arg_signature(const vector<InferredArgument> &inferred_args,
+                           const Parameter &user_context_param,
+                           const JITCallArgs &args, vector<uint8_t> &signature) {
+    auto append = [&](const void *data, size_t size) {
+        const uint8_t *bytes = (const uint8_t *)data;
+        signature.insert(signature.end(), bytes, bytes + size);
+    };
+    signature.clear();
+    for (size_t i = 0; i < inferred_args.size(); i++) {
+        const Parameter &p = inferred_args[i].param;
+        if (!p.defined() || p.same_as(user_context_param)) {
+            // Constant images can't change, and the user context isn't
+            // used by the query.
+            continue;
+        }
+        const void *arg = args.store[i];
+        if (p.is_buffer()) {
+            const halide_buffer_t *buf = (const halide_buffer_t *)arg;
+            if (!buf) {
+                return false;
+            }
+            append(&buf->type, sizeof(buf->type));
+            append(buf->dim, buf->dimensions * sizeof(halide_dimension_t));
+        } else {
+            append(arg, p.type().bytes());
+        }
+    }
+    return true;
+}
+
+}  // namespace
+
 Realization Pipeline::realize(vector<int32_t> sizes, const Target &target) {
     return realize(nullptr, std::move(sizes), target);
 }
@@ -784,10 +1011,33 @@ Realization Pipeline::realize(JITUserContext *context,
                                &context, true, args);
 
     // Do an output bounds query if we can. Otherwise just assume the
-    // output size is good.
+    // output size is good. Calling with the same sizes and arguments as
+    // last time gives the same answer, so reuse it for those.
     int exit_status = 0;
     if (!target.has_feature(Target::NoBoundsQuery)) {
-        exit_status = call_jit_code(args);
+        PipelineContents::RealizeShapes &cached = contents->last_realize_shapes;
+        vector<uint8_t> signature;
+        const bool cacheable = realize_arg_signature(contents->inferred_args, contents->user_context_arg.param,
+                                                     args, signature);
+        if (cacheable &&
+            cached.output_dims.size() == r.size() &&
+            cached.sizes == sizes &&
+            cached.arg_signature == signature) {
+            for (size_t i = 0; i < r.size(); i++) {
+                std::copy(cached.output_dims[i].begin(), cached.output_dims[i].end(), r[i].raw_buffer()->dim);
+            }
+        } else {
+            exit_status = call_jit_code(args);
+            if (exit_status == 0 && cacheable) {
+                cached.sizes = sizes;
+                cached.arg_signature = std::move(signature);
+                cached.output_dims.clear();
+                for (size_t i = 0; i < r.size(); i++) {
+                    const halide_buffer_t *buf = r[i].raw_buffer();
+                    cached.output_dims.emplace_back(buf->dim, buf->dim + buf->dimensions);
+                }
+            }
+        }
     }
     if (exit_status == 0) {
         // Make the output allocations
@@ -880,7 +1130,8 @@ void Pipeline::prepare_jit_call_arguments(RealizationArg &outputs, const Target
 
     JITModule &compiled_module = contents->jit_cache.jit_module;
     internal_assert(compiled_module.argv_function() ||
-                    contents->jit_cache.wasm_module.contents.defined());
+                    contents->jit_cache.wasm_module.contents.defined() ||
+                    contents->jit_cache.interpreted_module.contents.defined());
 
     // Come up with the void * arguments to pass to the argv function
     size_t arg_index = 0;
@@ -1210,6 +1461,116 @@ void Pipeline::infer_input_bounds(JITUserContext *context,
     infer_input_bounds(context, r, target);
 }
 
+void Pipeline::realize_streaming(const std::vector<int32_t> &sizes,
+                                 const std::vector<int32_t> &tile_sizes,
+                                 const std::function<void(const std::string &, Buffer<> &)> &read_input,
+                                 const std::function<void(Realization &)> &write_output,
+                                 const Target &target) {
+    user_assert(defined()) << "Can't realize an undefined Pipeline\n";
+    user_assert(tile_sizes.size() <= sizes.size())
+        << "realize_streaming() was given " << tile_sizes.size() << " tile sizes for a "
+        << sizes.size() << "-dimensional output.\n";
+
+    // The output tile, which every tile reuses.
+    vector<int> extents(sizes.begin(), sizes.end());
+    for (size_t d = 0; d < tile_sizes.size(); d++) {
+        user_assert(tile_sizes[d] > 0) << "realize_streaming() tile sizes must be positive.\n";
+        extents[d] = std::min(tile_sizes[d], sizes[d]);
+    }
+    vector<Buffer<>> bufs;
+    for (auto &out : contents->outputs) {
+        user_assert((int)sizes.size() == out.dimensions())
+            << "Func " << out.name() << " is defined with " << out.dimensions()
+            << " dimensions, but realize_streaming() is requesting a realization with "
+            << sizes.size() << " dimensions.\n";
+        for (Type t : out.output_types()) {
+            bufs.emplace_back(t, extents);
+        }
+    }
+    Realization tile(std::move(bufs));
+
+    // The mins of each tile, in order, with the first dimension
+    // innermost.
+    vector<vector<int>> tile_mins;
+    vector<int> mins(sizes.size(), 0);
+    while (true) {
+        tile_mins.push_back(mins);
+        size_t d = 0;
+        for (; d < tile_sizes.size(); d++) {
+            if (mins[d] + extents[d] < sizes[d]) {
+                mins[d] = std::min(mins[d] + extents[d], sizes[d] - extents[d]);
+                break;
+            }
+            mins[d] = 0;
+        }
+        if (d == tile_sizes.size()) {
+            break;
+        }
+    }
+
+    // The inputs to stream are the ones we'd infer the bounds of.
+    compile_jit(target);
+    vector<Parameter> streamed;
+    for (const InferredArgument &ia : contents->inferred_args) {
+        if (ia.param.defined() && ia.param.is_buffer() && !ia.param.buffer().defined()) {
+            streamed.push_back(ia.param);
+        }
+    }
+
+    // Bind the streamed inputs to buffers of the regions tile i needs,
+    // and return them.
+    auto query_inputs = [&](size_t i) {
+        for (Parameter &p : streamed) {
+            p.set_buffer(Buffer<>());
+        }
+        for (size_t j = 0; j < tile.size(); j++) {
+            tile[j].set_min(tile_mins[i]);
+        }
+        infer_input_bounds(tile, target);
+        vector<Buffer<>> inputs;
+        for (Parameter &p : streamed) {
+            inputs.push_back(p.buffer());
+        }
+        return inputs;
+    };
+    auto read_inputs = [&](vector<Buffer<>> inputs) {
+        for (size_t j = 0; j < streamed.size(); j++) {
+            read_input(streamed[j].name(), inputs[j]);
+            inputs[j].set_host_dirty();
+        }
+    };
+
+    vector<Buffer<>> inputs = query_inputs(0);
+    read_inputs(inputs);
+    for (size_t i = 0; i < tile_mins.size(); i++) {
+        std::future<void> next_read;
+        vector<Buffer<>> next_inputs;
+        if (i + 1 < tile_mins.size()) {
+            next_inputs = query_inputs(i + 1);
+            next_read = std::async(std::launch::async, read_inputs, next_inputs);
+            for (size_t j = 0; j < streamed.size(); j++) {
+                streamed[j].set_buffer(inputs[j]);
+            }
+            for (size_t j = 0; j < tile.size(); j++) {
+                tile[j].set_min(tile_mins[i]);
+            }
+        }
+        realize(tile, target);
+        for (size_t j = 0; j < tile.size(); j++) {
+            tile[j].copy_to_host();
+        }
+        write_output(tile);
+        if (next_read.valid()) {
+            next_read.get();
+        }
+        inputs = std::move(next_inputs);
+    }
+
+    for (Parameter &p : streamed) {
+        p.set_buffer(Buffer<>());
+    }
+}
+
 void Pipeline::invalidate_cache() {
     if (defined()) {
         contents->invalidate_cache();
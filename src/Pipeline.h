@@ -7,6 +7,7 @@
  * pipeline.
  */
 
+#include <future>
 #include <initializer_list>
 #include <map>
 #include <memory>
@@ -294,6 +295,20 @@ public:
      * doing. */
     void print_loop_nest();
 
+    /** Write out an HTML roofline report for this Pipeline. The
+     * arithmetic and the bytes loaded and stored by each stage are
+     * estimated at compile time from the estimates of the outputs, which
+     * must be set. If profiler_report has the text printed by a run with
+     * the profiler on, each stage is plotted at the throughput it
+     * achieved, relative to the roofline of a machine with the given
+     * peak arithmetic throughput (in ops per second) and memory
+     * bandwidth (in bytes per second). If a peak isn't given, the best
+     * achieved by any stage is used. */
+    void compile_to_roofline_html(const std::string &filename,
+                                  const std::string &profiler_report = "",
+                                  double peak_ops_per_second = 0,
+                                  double peak_bytes_per_second = 0);
+
     /** Compile to object file and header pair, with the given
      * arguments. */
     void compile_to_file(const std::string &filename_prefix,
@@ -353,6 +368,22 @@ public:
      */
     void compile_jit(const Target &target = get_jit_target_from_environment());
 
+    /** Start jit compiling the pipeline in the background, and return
+     * a future that becomes ready once the optimized machine code is
+     * available. Lowering still happens on the calling thread; LLVM's
+     * optimization and code generation run on another thread.
+     *
+     * If use_fallback is true, a version of the same lowered code
+     * compiled without LLVM optimizations is built before this
+     * returns, and calls to realize made before the background
+     * compile finishes run it instead of blocking. The optimized code
+     * is swapped in on the first call after it is ready. If
+     * use_fallback is false, realize waits for the background compile.
+     * Errors from the background compile are rethrown by the future,
+     * and by the next call that needs the compiled code. */
+    std::shared_future<void> compile_jit_async(const Target &target = get_jit_target_from_environment(),
+                                               bool use_fallback = true);
+
     /** Eagerly jit compile the function to machine code and return a callable
      * struct that behaves like a function pointer. The calling convention
      * will exactly match that of an AOT-compiled version of this Func
@@ -454,6 +485,25 @@ public:
                             const Target &target = get_jit_target_from_environment());
     // @}
 
+    /** Compute an output of the given sizes a tile at a time, for
+     * images too large to hold in memory at once. The first
+     * tile_sizes.size() dimensions are cut into tiles of tile_sizes
+     * (as many of the others as there are are realized whole); tiles
+     * at the far edges are shifted inwards to stay the same size, so
+     * they overlap their neighbors. Every ImageParam that isn't bound
+     * to a Buffer is streamed: bounds inference finds the region of it
+     * each tile needs, and read_input is called with its name and a
+     * Buffer of that shape to fill in. The inputs of the next tile are
+     * read on another thread while the current one is computed. Once
+     * computed, each tile is passed to write_output. Its Buffers are
+     * reused for the next tile, so copy what you want to keep. The
+     * streamed ImageParams are left unbound. */
+    void realize_streaming(const std::vector<int32_t> &sizes,
+                           const std::vector<int32_t> &tile_sizes,
+                           const std::function<void(const std::string &, Buffer<> &)> &read_input,
+                           const std::function<void(Realization &)> &write_output,
+                           const Target &target = get_jit_target_from_environment());
+
     /** Infer the arguments to the Pipeline, sorted into a canonical order:
      * all buffers (sorted alphabetically by name), followed by all non-buffers
      * (sorted alphabetically by name).
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <map>
 #include <string>
 #include <utility>
@@ -10,6 +11,7 @@
 #include "Prefetch.h"
 #include "Scope.h"
 #include "Simplify.h"
+#include "Substitute.h"
 #include "Target.h"
 #include "Util.h"
 
@@ -257,6 +259,229 @@ private:
     }
 };
 
+// The size of the chunks prefetches are split into, and the cache line
+// size we assume when deciding whether accesses are strided. Hexagon
+// prefetches whole ranges of addresses instead.
+Expr prefetch_max_byte_size(const Target &t) {
+    if (t.has_feature(Target::HVX)) {
+        return Expr();
+    } else if (t.arch == Target::ARM) {
+        // ARM's cache line size can be 32 or 64 bytes and it can switch the
+        // size at runtime. To be safe, we just use 32 bytes.
+        return 32;
+    } else {
+        return 64;
+    }
+}
+
+// Roughly how many operations of a loop body it takes to cover the
+// latency of a prefetch from main memory.
+constexpr int prefetch_latency_in_ops = 256;
+
+// Never prefetch further ahead than this many loop iterations, so
+// that the prefetched lines are still in cache when we get there.
+constexpr int max_auto_prefetch_distance = 16;
+
+// Summarize a candidate loop body for automatic prefetching: whether
+// it's innermost, whether the schedule already prefetches in it, a rough
+// count of the operations in one iteration, and the external buffers it
+// reads.
+class AnalyzeLoopBody : public IRVisitor {
+    using IRVisitor::visit;
+
+    int unroll_factor = 1;
+
+    void count() {
+        cost += unroll_factor;
+    }
+
+    void visit(const For *op) override {
+        if (op->for_type == ForType::Serial || op->for_type == ForType::Parallel) {
+            has_serial_loop = true;
+        }
+        op->min.accept(this);
+        op->extent.accept(this);
+        auto extent = as_const_int(op->extent);
+        ScopedValue<int> bind(unroll_factor, unroll_factor);
+        if (op->for_type == ForType::Unrolled && extent) {
+            unroll_factor *= (int)*extent;
+        }
+        op->body.accept(this);
+    }
+
+    void visit(const Prefetch *op) override {
+        has_prefetch = true;
+        IRVisitor::visit(op);
+    }
+
+    void visit(const Call *op) override {
+        count();
+        if (op->call_type == Call::Image && op->param.defined()) {
+            params.emplace(op->name, op->param);
+        }
+        IRVisitor::visit(op);
+    }
+
+    void visit(const Provide *op) override {
+        count();
+        IRVisitor::visit(op);
+    }
+
+    void visit(const Add *op) override {
+        count();
+        IRVisitor::visit(op);
+    }
+
+    void visit(const Sub *op) override {
+        count();
+        IRVisitor::visit(op);
+    }
+
+    void visit(const Mul *op) override {
+        count();
+        IRVisitor::visit(op);
+    }
+
+    void visit(const Div *op) override {
+        count();
+        IRVisitor::visit(op);
+    }
+
+    void visit(const Min *op) override {
+        count();
+        IRVisitor::visit(op);
+    }
+
+    void visit(const Max *op) override {
+        count();
+        IRVisitor::visit(op);
+    }
+
+    void visit(const Select *op) override {
+        count();
+        IRVisitor::visit(op);
+    }
+
+    void visit(const Cast *op) override {
+        count();
+        IRVisitor::visit(op);
+    }
+
+public:
+    bool has_serial_loop = false;
+    bool has_prefetch = false;
+    int cost = 0;
+    map<string, Parameter> params;
+};
+
+// Add prefetches to innermost loops that walk through memory with a
+// stride of at least a cache line, which hardware prefetchers tend to
+// miss. The access pattern comes from the bounds of what one loop
+// iteration reads, and the prefetch distance from an estimate of how
+// long an iteration takes. This injects the same placeholder Prefetch
+// nodes as the prefetch() schedule directive.
+class InjectAutoPrefetch : public IRMutator {
+public:
+    InjectAutoPrefetch(const map<string, Function> &e, const Target &t)
+        : env(e), line_bytes(prefetch_max_byte_size(t)) {
+    }
+
+private:
+    const map<string, Function> &env;
+    const Expr line_bytes;
+    Scope<> realizations;
+    bool in_device_code = false;
+
+    using IRMutator::visit;
+
+    Stmt visit(const Realize *op) override {
+        ScopedBinding<> bind(realizations, op->name);
+        return IRMutator::visit(op);
+    }
+
+    // Whether one iteration of the loop reads far enough from where the
+    // previous one did to be worth prefetching.
+    bool is_strided(const string &loop_var, const Box &box, int elem_bytes) {
+        Expr next = Variable::make(Int(32), loop_var) + 1;
+        bool strided = false;
+        for (size_t i = 0; i < box.size(); i++) {
+            if (!box[i].is_bounded()) {
+                return false;
+            }
+            Expr delta = simplify(substitute(loop_var, next, box[i].min) - box[i].min);
+            if (expr_uses_var(delta, loop_var)) {
+                // Not an affine access.
+                return false;
+            } else if (is_const_zero(delta)) {
+                continue;
+            } else if (i > 0) {
+                // Stepping in an outer dimension of storage.
+                strided = true;
+            } else if (!can_prove(abs(delta) * elem_bytes < line_bytes)) {
+                strided = true;
+            }
+        }
+        return strided;
+    }
+
+    Stmt visit(const For *op) override {
+        ScopedValue<bool> old_in_device_code(in_device_code,
+                                             in_device_code ||
+                                                 is_gpu(op->for_type) ||
+                                                 (op->device_api != DeviceAPI::None &&
+                                                  op->device_api != DeviceAPI::Host));
+        Stmt body = mutate(op->body);
+
+        AnalyzeLoopBody analysis;
+        body.accept(&analysis);
+
+        if (in_device_code ||
+            op->for_type != ForType::Serial ||
+            is_const_one(op->extent) ||
+            analysis.has_serial_loop ||
+            analysis.has_prefetch) {
+            if (body.same_as(op->body)) {
+                return op;
+            }
+            return For::make(op->name, op->min, op->extent, op->for_type, op->partition_policy, op->device_api, std::move(body));
+        }
+
+        const int distance = std::clamp((prefetch_latency_in_ops + analysis.cost - 1) / std::max(analysis.cost, 1),
+                                        1, max_auto_prefetch_distance);
+
+        map<string, Box> required = boxes_required(body);
+        map<string, Box> provided = boxes_provided(body);
+        for (const auto &[name, box] : required) {
+            if (provided.count(name)) {
+                continue;
+            }
+            PrefetchDirective p = {name, op->name, op->name, distance, PrefetchBoundStrategy::NonFaulting, Parameter()};
+            vector<Type> types;
+            if (auto param = analysis.params.find(name); param != analysis.params.end()) {
+                p.param = param->second;
+                types = {p.param.type()};
+            } else if (auto func = env.find(name); func != env.end() && realizations.contains(name)) {
+                types = func->second.output_types();
+            } else {
+                // Not allocated outside this loop, or a buffer the
+                // prefetch directive doesn't handle (e.g. an embedded image).
+                continue;
+            }
+            if (!is_strided(op->name, box, types[0].bytes())) {
+                continue;
+            }
+            debug(3) << "Automatically prefetching " << name << " at loop " << op->name
+                     << " with distance " << distance << "\n";
+            body = Prefetch::make(name, types, Region(), p, const_true(), std::move(body));
+        }
+
+        if (body.same_as(op->body)) {
+            return op;
+        }
+        return For::make(op->name, op->min, op->extent, op->for_type, op->partition_policy, op->device_api, std::move(body));
+    }
+};
+
 // Reduce the prefetch dimension if bigger than 'max_dim'. It keeps the 'max_dim'
 // innermost dimensions and replaces the rests with for-loops.
 class ReducePrefetchDimension : public IRMutator {
@@ -436,6 +661,15 @@ Stmt inject_placeholder_prefetch(const Stmt &s, const map<string, Function> &env
     return stmt;
 }
 
+Stmt inject_auto_prefetch(const Stmt &s, const map<string, Function> &env, const Target &t) {
+    if (t.arch == Target::Hexagon || t.has_feature(Target::HVX)) {
+        // Hexagon prefetches ranges, and wants to be told about them by
+        // the schedule.
+        return s;
+    }
+    return InjectAutoPrefetch(env, t).mutate(s);
+}
+
 Stmt inject_prefetch(const Stmt &s, const map<string, Function> &env) {
     CollectExternalBufferBounds finder;
     s.accept(&finder);
@@ -443,23 +677,10 @@ Stmt inject_prefetch(const Stmt &s, const map<string, Function> &env) {
 }
 
 Stmt reduce_prefetch_dimension(Stmt stmt, const Target &t) {
-    size_t max_dim = 0;
-    Expr max_byte_size;
-
     // Hexagon's prefetch takes in a range of address and can be maximum of
     // two dimension. Other architectures generate one prefetch per cache line.
-    if (t.has_feature(Target::HVX)) {
-        max_dim = 2;
-    } else if (t.arch == Target::ARM) {
-        // ARM's cache line size can be 32 or 64 bytes and it can switch the
-        // size at runtime. To be safe, we just use 32 bytes.
-        max_dim = 1;
-        max_byte_size = 32;
-    } else {
-        max_dim = 1;
-        max_byte_size = 64;
-    }
-    internal_assert(max_dim > 0);
+    const size_t max_dim = t.has_feature(Target::HVX) ? 2 : 1;
+    const Expr max_byte_size = prefetch_max_byte_size(t);
 
     stmt = ReducePrefetchDimension(max_dim).mutate(stmt);
     if (max_byte_size.defined()) {
@@ -26,6 +26,12 @@ struct Stmt;
 Stmt inject_placeholder_prefetch(const Stmt &s, const std::map<std::string, Function> &env,
                                  const std::string &prefix,
                                  const std::vector<PrefetchDirective> &prefetches);
+/** Inject placeholder prefetches for strided reads in innermost loops,
+ * choosing the prefetch distance from a rough estimate of the cost of a
+ * loop iteration. Used when Target::AutoPrefetch is set. Loops that the
+ * schedule already prefetches in are left alone. */
+Stmt inject_auto_prefetch(const Stmt &s, const std::map<std::string, Function> &env, const Target &t);
+
 /** Compute the actual region to be prefetched and place it to the
  * placholder prefetch. Wrap the prefetch call with condition when
  * applicable. */
@@ -11,6 +11,7 @@
 #include "Scope.h"
 #include "Simplify.h"
 #include "Substitute.h"
+#include "Target.h"
 #include "UniquifyVariableNames.h"
 #include "Util.h"
 
@@ -218,6 +219,22 @@ private:
         return s;
     }
 
+    // Bill the device time taken by the kernels of a GPU loop to the
+    // current func. The host time also includes the launch and the wait
+    // for the kernels to finish. Only CUDA has device timers so far.
+    Stmt time_gpu_kernels(const Stmt &s, DeviceAPI device_api) {
+        if (device_api != DeviceAPI::CUDA) {
+            return s;
+        }
+        const string timer_name = unique_name("profiler_gpu_timer");
+        Expr start = Call::make(Handle(), "halide_cuda_kernel_timer_start", {}, Call::Extern);
+        Expr time = Call::make(UInt(64), "halide_cuda_kernel_timer_end",
+                               {Variable::make(Handle(), timer_name)}, Call::Extern);
+        Stmt record = Evaluate::make(Call::make(Int(32), "halide_profiler_gpu_time",
+                                                {profiler_instance, stack.back(), time}, Call::Extern));
+        return LetStmt::make(timer_name, start, Block::make(s, record));
+    }
+
     Expr compute_allocation_size(const vector<Expr> &extents,
                                  const Expr &condition,
                                  const Type &type,
@@ -506,6 +523,7 @@ private:
 
         if (update_active_threads) {
             if (Internal::is_gpu(op->for_type)) {
+                stmt = time_gpu_kernels(stmt, op->device_api);
                 stmt = suspend_thread_but_keep_task_id(stmt);
             } else {
                 stmt = suspend_thread(stmt);
@@ -605,8 +623,126 @@ private:
     }
 };
 
+class InjectLightProfiling : public IRMutator {
+public:
+    // The names of the Funcs timed, by id.
+    vector<string> func_names;
+    map<string, int> func_ids;
+
+    bool found_marker = false;
+
+    InjectLightProfiling(const string &pipeline_name, const map<string, Function> &env, const Target &target)
+        : pipeline_name(pipeline_name), env(env), target(target),
+          stats_name(unique_name("profiler_light_stats")) {
+    }
+
+private:
+    using IRMutator::visit;
+
+    const string &pipeline_name;
+    const map<string, Function> &env;
+    const Target &target;
+    const string stats_name;
+
+    // The number of loops we're in. Funcs computed outside of any loop
+    // are the ones computed at root.
+    int loop_depth = 0;
+
+    Expr ticks() const {
+        if (target.arch == Target::X86 || (target.arch == Target::ARM && target.bits == 64)) {
+            // Defined in x86.ll and aarch64.ll.
+            return Call::make(UInt(64), "halide_profiler_light_ticks", {}, Call::Extern);
+        } else {
+            return cast<uint64_t>(Call::make(Int(64), "halide_current_time_ns", {}, Call::Extern));
+        }
+    }
+
+    // Wrap s in reads of the cycle counter, and call f with the number of
+    // ticks it took.
+    Stmt time(const Stmt &s, const string &f, vector<Expr> args) {
+        const string start_name = unique_name("profiler_light_start");
+        args.push_back(ticks() - Variable::make(UInt(64), start_name));
+        Stmt record = Evaluate::make(Call::make(Int(32), f, args, Call::Extern));
+        return LetStmt::make(start_name, ticks(), Block::make(s, record));
+    }
+
+    Stmt visit(const Block *op) override {
+        const Evaluate *e = op->first.as<Evaluate>();
+        if (!e || !Call::as_intrinsic(e->value, {Call::profiling_enable_instance_marker})) {
+            return IRMutator::visit(op);
+        }
+
+        // We're out of the bounds query code, so this is a run of the
+        // pipeline.
+        found_marker = true;
+        Expr stats = Variable::make(Handle(), stats_name);
+        Stmt s = time(mutate(op->rest), "halide_profiler_light_pipeline_end", {stats});
+
+        // The runtime uses the ticks passed when it finds the stats to
+        // calibrate the cycle counter. Getting them before the start of
+        // the run also makes sure the clock has been started, if
+        // halide_current_time_ns is the counter.
+        vector<Expr> names;
+        for (const auto &n : func_names) {
+            names.emplace_back(n);
+        }
+        Expr names_struct = names.empty() ?
+                                reinterpret(Handle(), cast<uint64_t>(0)) :
+                                Call::make(Handle(), Call::make_struct, names, Call::Intrinsic);
+        Expr start = Call::make(Handle(), "halide_profiler_light_pipeline_start",
+                                {pipeline_name, (int)func_names.size(), names_struct, ticks()},
+                                Call::Extern);
+        return LetStmt::make(stats_name, start, s);
+    }
+
+    Expr visit(const Call *op) override {
+        if (op->is_intrinsic(Call::profiling_enable_instance_marker)) {
+            return make_zero(Int(32));
+        } else {
+            return IRMutator::visit(op);
+        }
+    }
+
+    Stmt visit(const For *op) override {
+        ScopedValue<int> bind(loop_depth, loop_depth + 1);
+        return IRMutator::visit(op);
+    }
+
+    Stmt visit(const ProducerConsumer *op) override {
+        Stmt s = IRMutator::visit(op);
+        if (!op->is_producer || loop_depth > 0) {
+            return s;
+        }
+        auto it = env.find(op->name);
+        if (it == env.end() || it->second.should_not_profile()) {
+            return s;
+        }
+        op = s.as<ProducerConsumer>();
+        internal_assert(op);
+        // A Func can be computed in more than one place at root, for
+        // example in different specializations of its consumer.
+        auto [id_it, inserted] = func_ids.emplace(op->name, (int)func_names.size());
+        if (inserted) {
+            func_names.push_back(op->name);
+        }
+        const int id = id_it->second;
+        Stmt body = time(op->body, "halide_profiler_light_record_func",
+                         {Variable::make(Handle(), stats_name), id});
+        return ProducerConsumer::make_produce(op->name, body);
+    }
+};
+
 }  // namespace
 
+Stmt inject_light_profiling(const Stmt &stmt, const string &pipeline_name,
+                            const map<string, Function> &env, const Target &target) {
+    InjectLightProfiling profiling(pipeline_name, env, target);
+    Stmt s = profiling.mutate(stmt);
+    internal_assert(profiling.found_marker)
+        << "No profiling marker found in " << pipeline_name << "\n";
+    return s;
+}
+
 Stmt inject_profiling(const Stmt &stmt, const string &pipeline_name, const std::map<string, Function> &env) {
     Names names(pipeline_name);
 
@@ -29,6 +29,9 @@
 #include "Expr.h"
 
 namespace Halide {
+
+struct Target;
+
 namespace Internal {
 
 class Function;
@@ -42,6 +45,16 @@ class Function;
  */
 Stmt inject_profiling(const Stmt &, const std::string &, const std::map<std::string, Function> &env);
 
+/** Take a statement representing a halide pipeline and time it, and
+ * each Func computed at root, with a cycle counter (rdtsc on x86, the
+ * virtual counter on 64-bit ARM, and halide_current_time_ns
+ * elsewhere). The times are added to the stats the runtime keeps for
+ * the pipeline (see halide_profiler_light_pipeline_stats) with atomics,
+ * so this is cheap enough to leave on in production. Used for
+ * Target::ProfileLight, at the same point as inject_profiling. */
+Stmt inject_light_profiling(const Stmt &, const std::string &pipeline_name,
+                            const std::map<std::string, Function> &env, const Target &target);
+
 }  // namespace Internal
 }  // namespace Halide
 
@@ -1,6 +1,7 @@
 #include <array>
 #include <utility>
 
+#include "Buffer.h"
 #include "IREquality.h"
 #include "IROperator.h"
 #include "IRPrinter.h"
@@ -252,6 +253,65 @@ void RDom::where(Expr predicate) {
     dom.where(std::move(predicate));
 }
 
+void SparseRDom::init(const std::vector<Expr> &columns, const Region &bounds) {
+    Expr in_bounds = const_true();
+    for (size_t d = 0; d < bounds.size(); d++) {
+        user_assert(bounds[d].min.defined() && bounds[d].extent.defined())
+            << "The bounds of the SparseRDom " << dom.x.name()
+            << " may not be undefined Exprs.\n";
+        const Expr &c = columns[d];
+        user_assert(c.type().is_int() || c.type().is_uint())
+            << "The coordinates of the SparseRDom " << dom.x.name()
+            << " must be integers, but are " << c.type() << "\n";
+        Expr lo = cast<int32_t>(bounds[d].min);
+        Expr hi = cast<int32_t>(bounds[d].min + bounds[d].extent - 1);
+        Expr v = cast<int32_t>(c);
+        in_bounds = in_bounds && v >= lo && v <= hi;
+        // The predicate means this clamp never changes the value, but
+        // it tells bounds inference where the coordinates lie.
+        coords.push_back(clamp(v, lo, hi));
+    }
+    dom.where(simplify(in_bounds));
+}
+
+SparseRDom::SparseRDom(const ImageParam &c, const Region &bounds, const std::string &name) {
+    user_assert(c.dimensions() == 2)
+        << "The coordinates of a SparseRDom must be a two-dimensional buffer, but "
+        << c.name() << " has " << c.dimensions() << " dimensions.\n";
+    dom = RDom(c.dim(1).min(), c.dim(1).extent(), name.empty() ? unique_name('r') : name);
+    std::vector<Expr> columns;
+    for (size_t d = 0; d < bounds.size(); d++) {
+        columns.push_back(c(c.dim(0).min() + (int)d, dom.x));
+    }
+    init(columns, bounds);
+}
+
+SparseRDom::SparseRDom(const Buffer<> &c, const Region &bounds, const std::string &name) {
+    user_assert(c.dimensions() == 2)
+        << "The coordinates of a SparseRDom must be a two-dimensional buffer, but "
+        << c.name() << " has " << c.dimensions() << " dimensions.\n";
+    user_assert((int)bounds.size() <= c.dim(0).extent())
+        << "The SparseRDom has " << bounds.size() << " coordinates per point, but "
+        << c.name() << " only has " << c.dim(0).extent() << " rows.\n";
+    dom = RDom(c.dim(1).min(), c.dim(1).extent(), name.empty() ? unique_name('r') : name);
+    std::vector<Expr> columns;
+    for (size_t d = 0; d < bounds.size(); d++) {
+        columns.push_back(c(c.dim(0).min() + (int)d, dom.x));
+    }
+    init(columns, bounds);
+}
+
+Expr SparseRDom::operator[](int d) const {
+    user_assert(d >= 0 && d < dimensions())
+        << "SparseRDom coordinate index out of bounds: " << d << "\n";
+    return coords[d];
+}
+
+void SparseRDom::where(Expr predicate) {
+    user_assert(defined()) << "Error: Can't add predicate to undefined SparseRDom.\n";
+    dom.where(std::move(predicate));
+}
+
 /** Emit an RVar in a human-readable form */
 std::ostream &operator<<(std::ostream &stream, const RVar &v) {
     stream << v.name() << "(" << v.min() << ", " << v.extent() << ")";
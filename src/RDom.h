@@ -19,6 +19,7 @@ namespace Halide {
 
 template<typename T, int Dims>
 class Buffer;
+class ImageParam;
 class OutputImageParam;
 
 /** A reduction variable represents a single dimension of a reduction
@@ -340,6 +341,79 @@ public:
     // @}
 };
 
+/** A one-dimensional reduction domain over a list of points, for
+ * update definitions whose cost should be proportional to the number
+ * of points rather than to the size of their bounding box (scattering
+ * the active pixels of a mask, splatting points, sparse
+ * convolution). The points are the columns of a two-dimensional
+ * integer buffer: coords(d, i) is coordinate d of point i. Each
+ * coordinate is promised to lie within the given bounds, which lets
+ * bounds inference handle gathers and scatters through it; points
+ * outside the bounds are skipped. For example, this counts the
+ * number of times each pixel is listed:
+ *
+ \code
+ ImageParam coords(Int(32), 2);
+ SparseRDom p(coords, {{0, 640}, {0, 480}});
+ Func count;
+ count(x, y) = 0;
+ count(p[0], p[1]) += 1;
+ \endcode
+ *
+ * Ragged domains, such as the rows of a CSR matrix, don't need this:
+ * a predicate that bounds an RVar by an expression in outer Vars, as
+ * in r.where(r < row_end(y) - row_start(y)), is turned into loop
+ * bounds, so only the entries of each row are visited.
+ */
+class SparseRDom {
+    RDom dom;
+    std::vector<Expr> coords;
+
+    void init(const std::vector<Expr> &columns, const Region &bounds);
+
+public:
+    /** Construct an undefined sparse reduction domain. */
+    SparseRDom() = default;
+
+    /** Construct a sparse reduction domain over the points in the
+     * columns of coords, with bounds.size() coordinates per point. */
+    // @{
+    SparseRDom(const ImageParam &coords, const Region &bounds, const std::string &name = "");
+    SparseRDom(const Buffer<void, -1> &coords, const Region &bounds, const std::string &name = "");
+    template<typename T, int Dims>
+    HALIDE_NO_USER_CODE_INLINE SparseRDom(const Buffer<T, Dims> &coords, const Region &bounds, const std::string &name = "")
+        : SparseRDom(Buffer<void, -1>(coords), bounds, name) {
+    }
+    // @}
+
+    /** Get at the one-dimensional RDom over the index of each point. */
+    RDom domain() const {
+        return dom;
+    }
+
+    /** Check if this sparse reduction domain is non-null */
+    bool defined() const {
+        return dom.defined();
+    }
+
+    /** Get the number of coordinates of each point. */
+    int dimensions() const {
+        return (int)coords.size();
+    }
+
+    /** Get coordinate d of the current point. */
+    Expr operator[](int d) const;
+
+    /** Add a predicate to the domain. See RDom::where. */
+    void where(Expr predicate);
+
+    /** The index of the current point can be used as an RVar, e.g. to
+     * schedule the update definition. */
+    operator RVar() const {
+        return dom;
+    }
+};
+
 /** Emit an RVar in a human-readable form */
 std::ostream &operator<<(std::ostream &stream, const RVar &);
 
@@ -89,14 +89,46 @@ Expr random_int(const vector<Expr> &e) {
     return result;
 }
 
-Expr random_float(const vector<Expr> &e) {
-    Expr result = random_int(e);
+Expr random_float_from_bits(const Expr &bits) {
+    internal_assert(bits.type() == UInt(32));
     // Set the exponent to one, and fill the mantissa with 23 random bits.
-    result = (127 << 23) | (cast<uint32_t>(result) >> 9);
+    Expr result = (127 << 23) | (bits >> 9);
     // The clamp is purely for the benefit of bounds inference.
     return clamp(reinterpret(Float(32), result) - 1.0f, 0.0f, 1.0f);
 }
 
+Expr random_float(const vector<Expr> &e) {
+    return random_float_from_bits(random_int(e));
+}
+
+vector<Expr> philox4x32(const vector<Expr> &counter, const vector<Expr> &key, int rounds) {
+    internal_assert(counter.size() == 4 && key.size() == 2);
+
+    // The multipliers and the Weyl sequence that bumps the key are
+    // those of Salmon et al., "Parallel random numbers: as easy as 1,
+    // 2, 3" (SC '11), so the results match their reference
+    // implementation, Random123.
+    const uint64_t M0 = 0xD2511F53, M1 = 0xCD9E8D57;
+    const uint32_t W0 = 0x9E3779B9, W1 = 0xBB67AE85;
+
+    vector<Expr> c = counter, k = key;
+    for (int i = 0; i < rounds; i++) {
+        if (i > 0) {
+            k[0] = k[0] + make_const(UInt(32), W0);
+            k[1] = k[1] + make_const(UInt(32), W1);
+        }
+        // The 32x32 -> 64 bit multiplies vectorize as widening
+        // multiplies, e.g. pmuludq on x86 and umull on ARM, and are
+        // mul.wide or mul.hi on GPUs.
+        Expr p0 = cast<uint64_t>(c[0]) * make_const(UInt(64), M0);
+        Expr p1 = cast<uint64_t>(c[2]) * make_const(UInt(64), M1);
+        Expr hi0 = cast<uint32_t>(p0 >> 32), lo0 = cast<uint32_t>(p0);
+        Expr hi1 = cast<uint32_t>(p1 >> 32), lo1 = cast<uint32_t>(p1);
+        c = {hi1 ^ c[1] ^ k[0], lo1, hi0 ^ c[3] ^ k[1], lo0};
+    }
+    return c;
+}
+
 namespace {
 
 class LowerRandom : public IRMutator {
@@ -23,6 +23,15 @@ Expr random_float(const std::vector<Expr> &);
  * be integers or unsigned integers). */
 Expr random_int(const std::vector<Expr> &);
 
+/** Return the four words of the Philox-4x32 counter-based generator
+ * for the given four counter words and two key words, all of type
+ * UInt(32), after the given number of rounds. */
+std::vector<Expr> philox4x32(const std::vector<Expr> &counter, const std::vector<Expr> &key, int rounds);
+
+/** Return a floating-point number between zero and one made from the
+ * top 23 bits of a random unsigned integer. */
+Expr random_float_from_bits(const Expr &bits);
+
 /** Convert calls to random() to IR generated by random_float and
  * random_int. Tags all calls with the variables in free_vars, and the
  * integer given as the last argument. */
@@ -87,7 +87,7 @@ void realization_order_dfs(const string &current,
 // Check the validity of a pair of fused stages.
 void validate_fused_pair(const string &fn, size_t stage_index,
                          const map<string, Function> &env,
-                         const map<string, map<string, Function>> &indirect_calls,
+                         map<string, map<string, Function>> &indirect_calls,
                          const FusedPair &p,
                          const vector<FusedPair> &func_fused_pairs) {
     internal_assert((p.func_1 == fn) && (p.stage_1 == stage_index));
@@ -107,18 +107,19 @@ void validate_fused_pair(const string &fn, size_t stage_index,
     }
 
     // Assert no dependencies among the functions that are computed_with.
-    const auto &callees_1 = indirect_calls.find(p.func_1);
-    if (callees_1 != indirect_calls.end()) {
-        user_assert(callees_1->second.find(p.func_2) == callees_1->second.end())
-            << "Invalid compute_with: there is dependency between "
-            << p.func_1 << " and " << p.func_2 << "\n";
-    }
-    const auto &callees_2 = indirect_calls.find(p.func_2);
-    if (callees_2 != indirect_calls.end()) {
-        user_assert(callees_2->second.find(p.func_1) == callees_2->second.end())
-            << "Invalid compute_with: there is dependency between "
-            << p.func_1 << " and " << p.func_2 << "\n";
-    }
+    const auto transitive_calls = [&](const string &f) -> const map<string, Function> & {
+        auto iter = indirect_calls.find(f);
+        if (iter == indirect_calls.end()) {
+            iter = indirect_calls.emplace(f, find_transitive_calls(env.at(f))).first;
+        }
+        return iter->second;
+    };
+    user_assert(transitive_calls(p.func_1).count(p.func_2) == 0)
+        << "Invalid compute_with: there is dependency between "
+        << p.func_1 << " and " << p.func_2 << "\n";
+    user_assert(transitive_calls(p.func_2).count(p.func_1) == 0)
+        << "Invalid compute_with: there is dependency between "
+        << p.func_1 << " and " << p.func_2 << "\n";
 }
 
 // Populate 'func_fused_pairs' and 'fuse_adjacency_list': a directed and
@@ -312,12 +313,10 @@ pair<vector<string>, vector<vector<string>>> realization_order(
         }
     }
 
-    // Collect all indirect calls made by all the functions in "env".
+    // The indirect calls made by functions in "env". Only needed to validate
+    // compute_with, so it's filled in on demand for the functions involved
+    // rather than walking the whole pipeline once per function.
     map<string, map<string, Function>> indirect_calls;
-    for (const pair<const string, Function> &caller : env) {
-        map<string, Function> more_funcs = find_transitive_calls(caller.second);
-        indirect_calls.emplace(caller.first, more_funcs);
-    }
 
     // 'graph' is a DAG representing the pipeline. Each function maps to the
     // set describing its inputs.
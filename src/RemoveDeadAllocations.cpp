@@ -1,4 +1,5 @@
 #include "RemoveDeadAllocations.h"
+#include "ExprUsesVar.h"
 #include "IRMutator.h"
 #include "IROperator.h"
 #include "Scope.h"
@@ -85,11 +86,249 @@ class RemoveDeadAllocations : public IRMutator {
     }
 };
 
+// The largest allocation kept in registers: four of the widest vectors
+// of any target.
+const int max_register_bytes = 4 * 64;
+
+// Whether a Stmt stores to an allocation, or uses it in any way other
+// than by loading from it.
+class FindNonLoadUses : public IRVisitor {
+    using IRVisitor::visit;
+
+    void visit(const Store *op) override {
+        if (op->name == name) {
+            stores = true;
+        }
+        IRVisitor::visit(op);
+    }
+
+    void visit(const Variable *op) override {
+        if (op->name == name || op->name == name + ".buffer") {
+            other_uses = true;
+        }
+    }
+
+    void visit(const Atomic *op) override {
+        if (op->mutex_name == name) {
+            other_uses = true;
+        }
+        IRVisitor::visit(op);
+    }
+
+    const std::string &name;
+
+public:
+    bool stores = false, other_uses = false;
+
+    explicit FindNonLoadUses(const std::string &name)
+        : name(name) {
+    }
+};
+
+// Forward the values stored to one allocation to the loads of them.
+class ForwardStores : public IRMutator {
+    using IRMutator::visit;
+
+    const Allocate *alloc;
+
+    // The let and lane holding the current value of each element of the
+    // allocation, or an empty name if it hasn't been stored to yet.
+    std::vector<std::pair<std::string, int>> elements;
+    std::map<std::string, Type> let_types;
+
+    // The elements accessed by an index, or an empty vector if they
+    // aren't all known.
+    std::vector<int> positions(const Expr &index) const {
+        std::vector<int> result;
+        auto add = [&](int64_t p) {
+            if (p >= 0 && p < (int64_t)elements.size()) {
+                result.push_back((int)p);
+            }
+        };
+        if (auto c = as_const_int(index)) {
+            add(*c);
+            return result.size() == 1 ? result : std::vector<int>();
+        }
+        const Ramp *r = index.as<Ramp>();
+        auto base = r ? as_const_int(r->base) : std::nullopt;
+        auto stride = r ? as_const_int(r->stride) : std::nullopt;
+        if (!base || !stride) {
+            return {};
+        }
+        for (int i = 0; i < r->lanes; i++) {
+            add(*base + i * *stride);
+        }
+        return (int)result.size() == r->lanes ? result : std::vector<int>();
+    }
+
+    Expr visit(const Load *op) override {
+        if (op->name != alloc->name) {
+            return IRMutator::visit(op);
+        }
+        std::vector<int> pos = positions(op->index);
+        if (pos.empty() || !is_const_one(op->predicate) ||
+            op->type.element_of() != alloc->type) {
+            failed = true;
+            return op;
+        }
+
+        // Gather the elements from the lets holding them.
+        std::vector<Expr> vectors;
+        std::map<std::string, int> offsets;
+        std::vector<int> indices;
+        int total_lanes = 0;
+        for (int p : pos) {
+            const auto &[let_name, lane] = elements[p];
+            if (let_name.empty()) {
+                failed = true;
+                return op;
+            }
+            auto it = offsets.find(let_name);
+            if (it == offsets.end()) {
+                Type t = let_types.at(let_name);
+                it = offsets.emplace(let_name, total_lanes).first;
+                vectors.push_back(Variable::make(t, let_name));
+                total_lanes += t.lanes();
+            }
+            indices.push_back(it->second + lane);
+        }
+        if (vectors.size() == 1 && vectors[0].type() == op->type) {
+            bool in_order = true;
+            for (size_t i = 0; i < indices.size(); i++) {
+                in_order &= indices[i] == (int)i;
+            }
+            if (in_order) {
+                return vectors[0];
+            }
+        }
+        return Shuffle::make(vectors, indices);
+    }
+
+    Stmt forward(std::vector<Stmt> &todo) {
+        if (todo.empty() || failed) {
+            return Stmt();
+        }
+        Stmt s = todo.back();
+        todo.pop_back();
+
+        if (const Block *op = s.as<Block>()) {
+            todo.push_back(op->rest);
+            todo.push_back(op->first);
+            return forward(todo);
+        } else if (const ProducerConsumer *op = s.as<ProducerConsumer>();
+                   op && op->name == alloc->name) {
+            todo.push_back(op->body);
+            return forward(todo);
+        } else if (const Free *op = s.as<Free>(); op && op->name == alloc->name) {
+            return forward(todo);
+        } else if (const LetStmt *op = s.as<LetStmt>()) {
+            // Moving the rest of the statements into the let must not
+            // shadow any uses of an outer variable of the same name.
+            for (const Stmt &t : todo) {
+                if (stmt_uses_var(t, op->name)) {
+                    failed = true;
+                    return Stmt();
+                }
+            }
+            Expr value = mutate(op->value);
+            todo.push_back(op->body);
+            Stmt body = forward(todo);
+            return body.defined() ? LetStmt::make(op->name, value, body) : body;
+        } else if (const Store *op = s.as<Store>(); op && op->name == alloc->name) {
+            std::vector<int> pos = positions(op->index);
+            if (pos.empty() || !is_const_one(op->predicate) ||
+                op->value.type().element_of() != alloc->type) {
+                failed = true;
+                return Stmt();
+            }
+            Expr value = mutate(op->value);
+            std::string let_name = unique_name(alloc->name);
+            let_types[let_name] = value.type();
+            for (size_t i = 0; i < pos.size(); i++) {
+                elements[pos[i]] = {let_name, (int)i};
+            }
+            Stmt rest = forward(todo);
+            return rest.defined() ? LetStmt::make(let_name, value, rest) : rest;
+        }
+
+        FindNonLoadUses uses(alloc->name);
+        s.accept(&uses);
+        if (uses.stores) {
+            // Stores inside loops or conditionals aren't forwarded.
+            failed = true;
+            return Stmt();
+        }
+        s = mutate(s);
+        Stmt rest = forward(todo);
+        return rest.defined() ? Block::make(s, rest) : s;
+    }
+
+public:
+    bool failed = false;
+
+    explicit ForwardStores(const Allocate *alloc, int size)
+        : alloc(alloc), elements(size) {
+    }
+
+    Stmt forward(const Stmt &s) {
+        std::vector<Stmt> todo = {s};
+        Stmt result = forward(todo);
+        return result.defined() ? result : Evaluate::make(0);
+    }
+};
+
+class PromoteSmallAllocations : public IRMutator {
+    using IRMutator::visit;
+
+    int in_gpu_loop = 0;
+
+    Stmt visit(const For *op) override {
+        ScopedValue<int> old(in_gpu_loop, in_gpu_loop + (is_gpu(op->for_type) ? 1 : 0));
+        return IRMutator::visit(op);
+    }
+
+    Stmt visit(const Allocate *op) override {
+        Stmt body = mutate(op->body);
+
+        int32_t size = op->constant_allocation_size();
+        bool small = (size > 0 && (int64_t)size * op->type.bytes() <= max_register_bytes &&
+                      op->padding == 0 && is_const_one(op->condition) &&
+                      !op->new_expr.defined() && op->free_function.empty() &&
+                      (op->memory_type == MemoryType::Auto ||
+                       op->memory_type == MemoryType::Stack ||
+                       op->memory_type == MemoryType::Register) &&
+                      !in_gpu_loop);
+        if (small) {
+            FindNonLoadUses uses(op->name);
+            body.accept(&uses);
+            if (!uses.other_uses) {
+                ForwardStores forwarder(op, size);
+                Stmt promoted = forwarder.forward(body);
+                if (!forwarder.failed) {
+                    debug(3) << "Keeping " << op->name << " in registers\n";
+                    return promoted;
+                }
+            }
+        }
+
+        if (body.same_as(op->body)) {
+            return op;
+        } else {
+            return Allocate::make(op->name, op->type, op->memory_type, op->extents, op->condition,
+                                  body, op->new_expr, op->free_function, op->padding);
+        }
+    }
+};
+
 }  // namespace
 
 Stmt remove_dead_allocations(const Stmt &s) {
     return RemoveDeadAllocations().mutate(s);
 }
 
+Stmt promote_small_allocations_to_registers(const Stmt &s) {
+    return PromoteSmallAllocations().mutate(s);
+}
+
 }  // namespace Internal
 }  // namespace Halide
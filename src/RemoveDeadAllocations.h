@@ -2,8 +2,8 @@
 #define HALIDE_REMOVE_DEAD_ALLOCATIONS_H
 
 /** \file
- * Defines the lowering pass that removes allocate and free nodes that
- * are not used.
+ * Defines the lowering passes that remove allocate and free nodes that
+ * are not used, or that are small enough to keep in registers.
  */
 
 #include "Expr.h"
@@ -17,6 +17,15 @@ namespace Internal {
  */
 Stmt remove_dead_allocations(const Stmt &s);
 
+/** Replace small, constant-sized allocations that are only stored to
+ * and loaded from at constant indices, e.g. those of producers computed
+ * at the innermost (unrolled or vectorized) loop of their consumer,
+ * with lets of the values stored. The stores to them must be in straight-line
+ * code, before any loads of the values. Must be called after
+ * vectorization and loop unrolling, and is best followed by
+ * remove_dead_allocations, which removes the allocations left unused. */
+Stmt promote_small_allocations_to_registers(const Stmt &s);
+
 }  // namespace Internal
 }  // namespace Halide
 
@@ -0,0 +1,460 @@
+#include "Roofline.h"
+
+#include <cmath>
+#include <iomanip>
+#include <set>
+#include <sstream>
+
+#include "AutoScheduleUtils.h"
+#include "Bounds.h"
+#include "FindCalls.h"
+#include "Function.h"
+#include "IROperator.h"
+#include "RealizationOrder.h"
+#include "RegionCosts.h"
+#include "Simplify.h"
+
+namespace Halide {
+namespace Internal {
+
+using std::map;
+using std::set;
+using std::string;
+using std::vector;
+
+namespace {
+
+// The value of e with the estimates substituted in, or -1 if it isn't
+// a constant.
+double estimated_value(const Expr &e) {
+    if (!e.defined()) {
+        return -1;
+    }
+    Expr value = simplify(substitute_var_estimates(e));
+    if (auto i = as_const_int(value)) {
+        return (double)*i;
+    } else if (auto u = as_const_uint(value)) {
+        return (double)*u;
+    } else if (auto f = as_const_float(value)) {
+        return *f;
+    }
+    return -1;
+}
+
+double estimated_size(const Box &b) {
+    for (const Interval &i : b.bounds) {
+        if (!i.is_bounded()) {
+            return -1;
+        }
+    }
+    return estimated_value(box_size(b));
+}
+
+int element_bytes(const Function &f) {
+    int bytes = 0;
+    for (const Type &t : f.output_types()) {
+        bytes += t.bytes();
+    }
+    return bytes;
+}
+
+string escape_html(const string &s) {
+    string result;
+    for (char c : s) {
+        switch (c) {
+        case '&':
+            result += "&amp;";
+            break;
+        case '<':
+            result += "&lt;";
+            break;
+        case '>':
+            result += "&gt;";
+            break;
+        case '"':
+            result += "&quot;";
+            break;
+        default:
+            result += c;
+        }
+    }
+    return result;
+}
+
+// Format a quantity with an SI prefix, or a dash if it's unknown.
+string si(double value, const char *unit) {
+    if (value < 0) {
+        return "-";
+    }
+    const char *prefixes[] = {"n", "u", "m", "", "K", "M", "G", "T", "P"};
+    int p = 3;
+    while (value >= 1000 && p < 8) {
+        value /= 1000;
+        p++;
+    }
+    while (value > 0 && value < 1 && p > 0) {
+        value *= 1000;
+        p--;
+    }
+    std::ostringstream s;
+    s << std::setprecision(3) << value << " " << prefixes[p] << unit;
+    return s.str();
+}
+
+const char *roofline_css = R"(
+body { font-family: sans-serif; margin: 20px; }
+table { border-collapse: collapse; margin-top: 20px; }
+th, td { border: 1px solid #ccc; padding: 4px 8px; text-align: right; }
+th { background: #eee; }
+td.name { text-align: left; font-family: monospace; }
+tr.low td { background: #fdd; }
+svg text { font-size: 12px; }
+)";
+
+}  // namespace
+
+vector<StageRoofline> estimate_roofline(const vector<Function> &outputs) {
+    map<string, Function> env = build_environment(outputs);
+    vector<string> order = realization_order(outputs, env).first;
+    RegionCosts costs(env, order);
+
+    // The Funcs computed inline are accounted for in their consumers.
+    set<string> output_names, inlines;
+    for (const Function &f : outputs) {
+        output_names.insert(f.name());
+    }
+    for (const auto &p : env) {
+        const Function &f = p.second;
+        if (!output_names.count(f.name()) && f.can_be_inlined() &&
+            f.schedule().compute_level().is_inlined()) {
+            inlines.insert(f.name());
+        }
+    }
+
+    // The regions of each Func that are required, starting from the
+    // estimates of the outputs.
+    map<string, Box> regions;
+    for (const Function &f : outputs) {
+        Box region;
+        for (const string &arg : f.args()) {
+            const Bound *estimate = nullptr;
+            for (const Bound &b : f.schedule().estimates()) {
+                if (b.var == arg) {
+                    estimate = &b;
+                }
+            }
+            user_assert(estimate && estimate->min.defined() && estimate->extent.defined())
+                << "The roofline report needs an estimate of dimension " << arg
+                << " of the output " << f.name() << ".\n";
+            region.push_back(Interval(estimate->min, simplify(estimate->min + estimate->extent - 1)));
+        }
+        regions[f.name()] = region;
+    }
+
+    vector<StageRoofline> stages;
+    // Consumers are visited before their producers, so that all the
+    // regions of a Func required are known when it's visited.
+    for (auto it = order.rbegin(); it != order.rend(); it++) {
+        const Function &f = env.at(*it);
+        auto region = regions.find(f.name());
+        if (inlines.count(f.name()) || region == regions.end()) {
+            continue;
+        }
+
+        DimBounds pure_bounds;
+        for (size_t d = 0; d < f.args().size(); d++) {
+            pure_bounds.emplace(f.args()[d], region->second[d]);
+        }
+
+        for (int s = 0; s < (int)f.updates().size() + 1; s++) {
+            StageRoofline stage;
+            stage.func = f.name();
+            stage.stage = s;
+            if (f.has_extern_definition()) {
+                stages.push_back(stage);
+                continue;
+            }
+
+            const DimBounds bounds = get_stage_bounds(f, s, pure_bounds);
+            const Definition def = get_stage_definition(f, s);
+            Box domain;
+            for (const string &arg : f.args()) {
+                domain.push_back(bounds.at(arg));
+            }
+            for (const ReductionVariable &rv : def.schedule().rvars()) {
+                domain.push_back(bounds.at(rv.var));
+            }
+            stage.points = estimated_size(domain);
+
+            if (stage.points >= 0) {
+                Cost cost = costs.get_func_stage_cost(f, s, inlines);
+                if (cost.defined()) {
+                    double arith = estimated_value(cost.arith);
+                    double memory = estimated_value(cost.memory);
+                    stage.arith = arith < 0 ? -1 : arith * stage.points;
+                    stage.bytes_accessed = memory < 0 ? -1 : memory * stage.points;
+                }
+                stage.bytes_stored = stage.points * element_bytes(f);
+            }
+
+            // Find the regions of the producers this stage reads, with
+            // the inlined Funcs substituted in.
+            Scope<Interval> scope;
+            for (const auto &b : bounds) {
+                scope.push(b.first, b.second);
+            }
+            vector<Expr> exprs = def.values();
+            if (s > 0) {
+                exprs.insert(exprs.end(), def.args().begin(), def.args().end());
+            }
+            map<string, Box> required;
+            for (const Expr &e : exprs) {
+                for (const auto &b : boxes_required(perform_inline(e, env, inlines, order), scope)) {
+                    if (b.first == f.name()) {
+                        continue;
+                    }
+                    auto r = required.find(b.first);
+                    if (r == required.end()) {
+                        required.emplace(b.first, b.second);
+                    } else {
+                        merge_boxes(r->second, b.second);
+                    }
+                }
+            }
+
+            stage.bytes_loaded = 0;
+            for (const auto &r : required) {
+                int bytes = 0;
+                auto producer = env.find(r.first);
+                if (producer != env.end()) {
+                    bytes = element_bytes(producer->second);
+                    auto existing = regions.find(r.first);
+                    if (existing == regions.end()) {
+                        regions.emplace(r.first, r.second);
+                    } else {
+                        merge_boxes(existing->second, r.second);
+                    }
+                } else if (costs.inputs.count(r.first)) {
+                    bytes = costs.inputs.at(r.first).bytes();
+                }
+                double size = estimated_size(r.second);
+                if (size < 0 || stage.bytes_loaded < 0) {
+                    stage.bytes_loaded = -1;
+                } else {
+                    stage.bytes_loaded += size * bytes;
+                }
+            }
+            stages.push_back(stage);
+        }
+    }
+
+    // Put the stages in realization order.
+    vector<StageRoofline> result;
+    for (auto it = order.begin(); it != order.end(); it++) {
+        for (const StageRoofline &stage : stages) {
+            if (stage.func == *it) {
+                result.push_back(stage);
+            }
+        }
+    }
+    return result;
+}
+
+map<string, double> parse_profiler_func_times(const string &report) {
+    // The report has a line per Func like "    f: 1.23ms (45.6%) ...".
+    map<string, double> times;
+    std::istringstream lines(report);
+    string line;
+    while (std::getline(lines, line)) {
+        if (line.compare(0, 4, "    ") != 0 || line.size() < 5 || line[4] == ' ') {
+            continue;
+        }
+        size_t colon = line.find(": ", 4);
+        if (colon == string::npos) {
+            continue;
+        }
+        string name = line.substr(4, colon - 4);
+        if (name.find(" (copy to ") != string::npos) {
+            continue;
+        }
+        std::istringstream rest(line.substr(colon + 2));
+        double ms;
+        string unit;
+        if (!(rest >> ms) || !(rest >> unit) || unit.compare(0, 2, "ms") != 0) {
+            continue;
+        }
+        times[name] = ms * 1e-3;
+    }
+    return times;
+}
+
+string print_roofline_html(const vector<Function> &outputs,
+                           const string &title,
+                           const string &profiler_report,
+                           double peak_ops_per_second,
+                           double peak_bytes_per_second) {
+    const vector<StageRoofline> stages = estimate_roofline(outputs);
+    const map<string, double> func_times = parse_profiler_func_times(profiler_report);
+
+    // Split the time of each Func between its stages by their
+    // arithmetic, as the profiler doesn't time stages separately.
+    map<string, double> func_arith;
+    for (const StageRoofline &s : stages) {
+        func_arith[s.func] += std::max(s.arith, 0.0);
+    }
+    vector<double> seconds(stages.size(), -1);
+    double best_ops = 0, best_bytes = 0;
+    for (size_t i = 0; i < stages.size(); i++) {
+        const StageRoofline &s = stages[i];
+        auto t = func_times.find(s.func);
+        if (t == func_times.end() || t->second <= 0 || s.arith < 0) {
+            continue;
+        }
+        const double total = func_arith[s.func];
+        seconds[i] = total > 0 ? t->second * s.arith / total : t->second;
+        if (seconds[i] > 0) {
+            best_ops = std::max(best_ops, s.arith / seconds[i]);
+            if (s.bytes_loaded >= 0) {
+                best_bytes = std::max(best_bytes, (s.bytes_loaded + s.bytes_stored) / seconds[i]);
+            }
+        }
+    }
+    const bool observed_roofs = peak_ops_per_second <= 0 || peak_bytes_per_second <= 0;
+    const double peak_ops = peak_ops_per_second > 0 ? peak_ops_per_second : best_ops;
+    const double peak_bytes = peak_bytes_per_second > 0 ? peak_bytes_per_second : best_bytes;
+    const auto roof = [&](double intensity) {
+        return std::min(peak_ops, peak_bytes * intensity);
+    };
+
+    std::ostringstream html;
+    html << "<!DOCTYPE html>\n<html>\n<head>\n"
+         << "<title>Roofline: " << escape_html(title) << "</title>\n"
+         << "<style type='text/css'>" << roofline_css << "</style>\n"
+         << "</head>\n<body>\n"
+         << "<h2>Roofline of " << escape_html(title) << "</h2>\n"
+         << "<p>Arithmetic and memory traffic are compile-time estimates over the region "
+         << "of each stage required by the output estimates. Times are per run, from the profiler, "
+         << "split between the stages of a Func by their arithmetic.";
+    if (peak_ops > 0 && peak_bytes > 0) {
+        html << " Roofs: " << si(peak_ops, "op/s") << " and " << si(peak_bytes, "B/s")
+             << (observed_roofs ? " (the best achieved by any stage)" : "") << ".";
+    }
+    html << "</p>\n";
+
+    // The plot, on log-log axes of ops/byte against ops/s.
+    const int width = 640, height = 420, margin = 60;
+    double min_x = 1.0 / 16, max_x = 64, min_y = 1e6, max_y = 1e9;
+    for (size_t i = 0; i < stages.size(); i++) {
+        const double x = stages[i].intensity();
+        if (x > 0) {
+            min_x = std::min(min_x, x / 2);
+            max_x = std::max(max_x, x * 2);
+        }
+        if (seconds[i] > 0 && stages[i].arith > 0) {
+            const double y = stages[i].arith / seconds[i];
+            min_y = std::min(min_y, y / 2);
+            max_y = std::max(max_y, y * 2);
+        }
+    }
+    if (peak_ops > 0) {
+        max_y = std::max(max_y, peak_ops * 2);
+    }
+    const auto px = [&](double x) {
+        return margin + (width - 2 * margin) * std::log(x / min_x) / std::log(max_x / min_x);
+    };
+    const auto py = [&](double y) {
+        return height - margin - (height - 2 * margin) * std::log(y / min_y) / std::log(max_y / min_y);
+    };
+
+    html << "<svg width='" << width << "' height='" << height << "'>\n"
+         << "<rect x='" << margin << "' y='" << margin << "' width='" << width - 2 * margin
+         << "' height='" << height - 2 * margin << "' fill='none' stroke='#888'/>\n"
+         << "<text x='" << width / 2 << "' y='" << height - 15 << "' text-anchor='middle'>"
+         << "arithmetic intensity (op/B)</text>\n"
+         << "<text x='15' y='" << height / 2 << "' text-anchor='middle' transform='rotate(-90 15 "
+         << height / 2 << ")'>throughput (op/s)</text>\n";
+    for (double x = std::pow(2.0, std::ceil(std::log2(min_x))); x <= max_x; x *= 4) {
+        html << "<text x='" << px(x) << "' y='" << height - margin + 15 << "' text-anchor='middle'>" << x << "</text>\n";
+    }
+    for (double y = std::pow(10.0, std::ceil(std::log10(min_y))); y <= max_y; y *= 10) {
+        html << "<text x='" << margin - 5 << "' y='" << py(y) + 4 << "' text-anchor='end'>" << si(y, "") << "</text>\n";
+    }
+    if (peak_ops > 0 && peak_bytes > 0) {
+        // The memory roof, up to the ridge point, and then the compute roof.
+        const double ridge = peak_ops / peak_bytes;
+        const double start = std::max(min_x, min_y / peak_bytes);
+        html << "<polyline fill='none' stroke='#c00' stroke-width='2' points='"
+             << px(start) << "," << py(roof(start)) << " ";
+        if (ridge > min_x && ridge < max_x) {
+            html << px(ridge) << "," << py(peak_ops) << " ";
+        }
+        html << px(max_x) << "," << py(roof(max_x)) << "'/>\n";
+    }
+    for (size_t i = 0; i < stages.size(); i++) {
+        const StageRoofline &s = stages[i];
+        const double x = s.intensity();
+        const string label = escape_html(s.func) + ".s" + std::to_string(s.stage);
+        if (x <= 0) {
+            continue;
+        }
+        if (seconds[i] > 0) {
+            const double y = s.arith / seconds[i];
+            html << "<circle cx='" << px(x) << "' cy='" << py(y) << "' r='5' fill='#06c'>"
+                 << "<title>" << label << ": " << si(y, "op/s") << "</title></circle>\n"
+                 << "<text x='" << px(x) + 7 << "' y='" << py(y) - 7 << "'>" << label << "</text>\n";
+        } else {
+            // Without a time, just mark the intensity on the axis.
+            html << "<line x1='" << px(x) << "' y1='" << height - margin << "' x2='" << px(x)
+                 << "' y2='" << height - margin - 10 << "' stroke='#06c'><title>" << label << "</title></line>\n";
+        }
+    }
+    html << "</svg>\n";
+
+    html << "<table>\n<tr><th>Stage</th><th>Points</th><th>Arithmetic</th><th>Loaded</th>"
+         << "<th>Accessed</th><th>Stored</th><th>Intensity (op/B)</th><th>Time</th>"
+         << "<th>Throughput</th><th>Bandwidth</th><th>Of roof</th></tr>\n";
+    for (size_t i = 0; i < stages.size(); i++) {
+        const StageRoofline &s = stages[i];
+        const double intensity = s.intensity();
+        double achieved = -1, bandwidth = -1, fraction = -1;
+        if (seconds[i] > 0) {
+            achieved = s.arith / seconds[i];
+            if (s.bytes_loaded >= 0) {
+                bandwidth = (s.bytes_loaded + s.bytes_stored) / seconds[i];
+            }
+            if (intensity > 0 && roof(intensity) > 0) {
+                fraction = achieved / roof(intensity);
+            }
+        }
+        // Highlight the stages that are far from their roof.
+        html << "<tr" << (fraction >= 0 && fraction < 0.25 ? " class='low'" : "") << ">"
+             << "<td class='name'>" << escape_html(s.func) << ".s" << s.stage << "</td>"
+             << "<td>" << si(s.points, "") << "</td>"
+             << "<td>" << si(s.arith, "op") << "</td>"
+             << "<td>" << si(s.bytes_loaded, "B") << "</td>"
+             << "<td>" << si(s.bytes_accessed, "B") << "</td>"
+             << "<td>" << si(s.bytes_stored, "B") << "</td>"
+             << "<td>";
+        if (intensity >= 0) {
+            html << std::setprecision(3) << intensity;
+        } else {
+            html << "-";
+        }
+        html << "</td>"
+             << "<td>" << si(seconds[i], "s") << "</td>"
+             << "<td>" << si(achieved, "op/s") << "</td>"
+             << "<td>" << si(bandwidth, "B/s") << "</td>"
+             << "<td>";
+        if (fraction >= 0) {
+            html << (int)std::round(fraction * 100) << "%";
+        } else {
+            html << "-";
+        }
+        html << "</td></tr>\n";
+    }
+    html << "</table>\n</body>\n</html>\n";
+    return html.str();
+}
+
+}  // namespace Internal
+}  // namespace Halide
@@ -0,0 +1,73 @@
+#ifndef HALIDE_INTERNAL_ROOFLINE_H
+#define HALIDE_INTERNAL_ROOFLINE_H
+
+/** \file
+ *
+ * Defines a compile-time estimate of the arithmetic intensity of each
+ * stage of a pipeline, and a roofline report that overlays it with
+ * measured profiler times.
+ */
+
+#include <algorithm>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace Halide {
+namespace Internal {
+
+class Function;
+
+/** The estimated work done by one stage of a Func, computed over the
+ * region of it required by the estimates of the pipeline outputs. Any
+ * quantity that couldn't be estimated is negative. */
+struct StageRoofline {
+    std::string func;
+    int stage = 0;
+    /** The number of points the stage computes. */
+    double points = -1;
+    /** The arithmetic cost, as estimated by RegionCosts. */
+    double arith = -1;
+    /** The size of the regions of the other Funcs and inputs the stage
+     * reads, i.e. the data it has to load at least once. */
+    double bytes_loaded = -1;
+    /** The bytes read by all the loads the stage does, counting repeated
+     * loads of the same value. */
+    double bytes_accessed = -1;
+    /** The bytes stored by the stage. */
+    double bytes_stored = -1;
+
+    /** Arithmetic per byte loaded and stored. */
+    double intensity() const {
+        return (arith >= 0 && bytes_loaded >= 0 && bytes_stored >= 0) ?
+                   arith / std::max(1.0, bytes_loaded + bytes_stored) :
+                   -1;
+    }
+};
+
+/** Estimate the work done by each stage of the non-inlined Funcs of the
+ * pipeline with the given outputs, from the estimates of the outputs.
+ * The stages are in realization order. */
+std::vector<StageRoofline> estimate_roofline(const std::vector<Function> &outputs);
+
+/** Parse the time per run of each Func (in seconds) out of the report
+ * printed by the profiler. */
+std::map<std::string, double> parse_profiler_func_times(const std::string &report);
+
+/** Return an HTML page with the estimated arithmetic intensity of each
+ * stage of the pipeline with the given outputs, plotted against the
+ * roofline of a machine with the given peak arithmetic throughput (in
+ * ops per second) and memory bandwidth (in bytes per second). The
+ * stages with a time in profiler_report are plotted at the throughput
+ * they achieved. If a peak isn't positive, the best achieved by any
+ * stage is used instead. */
+std::string print_roofline_html(const std::vector<Function> &outputs,
+                                const std::string &title,
+                                const std::string &profiler_report,
+                                double peak_ops_per_second,
+                                double peak_bytes_per_second);
+
+}  // namespace Internal
+}  // namespace Halide
+
+#endif
@@ -1,8 +1,11 @@
+#include <algorithm>
+
 #include "Schedule.h"
 #include "Func.h"
 #include "Function.h"
 #include "IR.h"
 #include "IRMutator.h"
+#include "Util.h"
 #include "Var.h"
 
 namespace {
@@ -244,6 +247,7 @@ struct FuncScheduleContents {
     // This is an extent of the ring buffer and expected to be a positive integer.
     Expr ring_buffer;
     Expr memoize_eviction_key;
+    bool memoize_hash_buffer_contents = false;
 
     FuncScheduleContents()
         : store_level(LoopLevel::inlined()), compute_level(LoopLevel::inlined()), hoist_storage_level(LoopLevel::inlined()) {
@@ -363,6 +367,7 @@ FuncSchedule FuncSchedule::deep_copy(
     copy.contents->memory_type = contents->memory_type;
     copy.contents->memoized = contents->memoized;
     copy.contents->memoize_eviction_key = contents->memoize_eviction_key;
+    copy.contents->memoize_hash_buffer_contents = contents->memoize_hash_buffer_contents;
     copy.contents->async = contents->async;
     copy.contents->ring_buffer = contents->ring_buffer;
 
@@ -400,6 +405,14 @@ Expr FuncSchedule::memoize_eviction_key() const {
     return contents->memoize_eviction_key;
 }
 
+bool &FuncSchedule::memoize_hash_buffer_contents() {
+    return contents->memoize_hash_buffer_contents;
+}
+
+bool FuncSchedule::memoize_hash_buffer_contents() const {
+    return contents->memoize_hash_buffer_contents;
+}
+
 bool &FuncSchedule::async() {
     return contents->async;
 }
@@ -669,5 +682,26 @@ void StageSchedule::mutate(IRMutator *mutator) {
     }
 }
 
+size_t find_fused_dim(const std::vector<Dim> &dims,
+                      const std::vector<Dim> &parent_dims,
+                      const std::string &var) {
+    auto name_matches = [&](const Dim &d) {
+        return d.var == var || ends_with(d.var, "." + var) || ends_with(var, "." + d.var);
+    };
+    const auto &iter = std::find_if(dims.begin(), dims.end(), name_matches);
+    if (iter != dims.end()) {
+        return (size_t)(iter - dims.begin());
+    }
+    const auto &parent_iter = std::find_if(parent_dims.begin(), parent_dims.end(), name_matches);
+    if (parent_iter == parent_dims.end()) {
+        return dims.size();
+    }
+    size_t depth = parent_dims.end() - parent_iter;
+    if (depth > dims.size()) {
+        return dims.size();
+    }
+    return dims.size() - depth;
+}
+
 }  // namespace Internal
 }  // namespace Halide
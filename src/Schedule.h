@@ -149,6 +149,20 @@ enum class LoopAlignStrategy {
     Auto
 };
 
+/** Different ways to choose the iterations of a loop in which loads
+ * and stores are traced. See Func::sample_tracing. */
+enum class TraceSampling {
+    /** Trace every Nth iteration, starting with the first. */
+    EveryNth,
+
+    /** Trace only the first N iterations each time the loop runs. */
+    FirstN,
+
+    /** Trace a pseudo-random one in N of the iterations. The choice is
+     * a hash of the loop variable, so it's the same from run to run. */
+    Random
+};
+
 /** A reference to a site in a Halide statement at the top of the
  * body of a particular for loop. Evaluating a region of a halide
  * function is done by generating a loop nest that spans its
@@ -561,6 +575,16 @@ struct FusedPair {
     }
 };
 
+/** Find the index in 'dims' of the dim of a stage that is fused with
+ * the dim 'var' of the stage it is computed with, whose dims are
+ * 'parent_dims'. This is the dim of the same name if there is one, and
+ * otherwise the dim at the same depth from the outermost, e.g. the
+ * r.y of an update over an RDom fused with the y of a pure stage.
+ * Returns dims.size() if there is neither. */
+size_t find_fused_dim(const std::vector<Dim> &dims,
+                      const std::vector<Dim> &parent_dims,
+                      const std::string &var);
+
 struct FuncScheduleContents;
 struct StageScheduleContents;
 struct FunctionContents;
@@ -602,6 +626,14 @@ public:
     Expr memoize_eviction_key() const;
     // @}
 
+    /** This flag is set to true if the schedule is memoized, and keyed
+     * on the contents of the buffers it reads, instead of requiring
+     * memoize_tag for them. */
+    // @{
+    bool &memoize_hash_buffer_contents();
+    bool memoize_hash_buffer_contents() const;
+    // @}
+
     /** Is the production of this Function done asynchronously */
     bool &async();
     bool async() const;
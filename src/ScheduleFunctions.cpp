@@ -460,7 +460,8 @@ Stmt build_provide_loop_nest(const map<string, Function> &env,
                              const Function &func,
                              const Definition &def,
                              int start_fuse,
-                             bool is_update) {
+                             bool is_update,
+                             const Target &target) {
 
     internal_assert(!is_update == def.is_init());
 
@@ -509,11 +510,26 @@ Stmt build_provide_loop_nest(const map<string, Function> &env,
 
     // Make any specialized copies
     const vector<Specialization> &specializations = def.specializations();
+
+    // With Target::SpecializationDispatch, evaluate all the conditions up
+    // front into a bitmask, with a sentinel bit for the default case, and
+    // select the copy to run by the index of its lowest set bit. The chain
+    // of comparisons against a single index can then be compiled to a
+    // jump table.
+    const bool dispatch = target.has_feature(Target::SpecializationDispatch) &&
+                          specializations.size() >= 2 && specializations.size() < 32;
+    const string index_name = unique_name(prefix + "specialization");
+    const Expr index = Variable::make(Int(32), index_name);
+    Expr mask = make_const(UInt(32), (uint64_t)1 << specializations.size());
+
     for (size_t i = specializations.size(); i > 0; i--) {
         const Specialization &s = specializations[i - 1];
+        if (dispatch) {
+            mask = select(s.condition, make_const(UInt(32), (uint64_t)1 << (i - 1)), make_zero(UInt(32))) | mask;
+        }
         if (s.failure_message.empty()) {
-            Stmt then_case = build_provide_loop_nest(env, prefix, func, s.definition, start_fuse, is_update);
-            stmt = IfThenElse::make(s.condition, then_case, stmt);
+            Stmt then_case = build_provide_loop_nest(env, prefix, func, s.definition, start_fuse, is_update, target);
+            stmt = IfThenElse::make(dispatch ? index == (int)(i - 1) : s.condition, then_case, stmt);
         } else {
             internal_assert(is_const_one(s.condition));
             // specialize_fail() should only be possible on the final specialization
@@ -529,6 +545,10 @@ Stmt build_provide_loop_nest(const map<string, Function> &env,
         }
     }
 
+    if (dispatch) {
+        stmt = LetStmt::make(index_name, cast<int>(count_trailing_zeros(mask)), stmt);
+    }
+
     return stmt;
 }
 
@@ -1443,18 +1463,6 @@ private:
             return;
         }
 
-        int start_fuse;
-        {
-            const auto &iter = std::find_if(dims.begin(), dims.end(),
-                                            [&fuse_level](const Dim &d) {
-                                                return var_name_match(d.var, fuse_level.var().name());
-                                            });
-            internal_assert(iter != dims.end());
-            start_fuse = (int)(iter - dims.begin());
-        }
-
-        int fused_vars_num = dims.size() - start_fuse - 1;
-
         const auto &env_iter = env.find(fuse_level.func());
         internal_assert(env_iter != env.end());
         const auto &parent_func = env_iter->second;
@@ -1462,15 +1470,40 @@ private:
         const auto &parent_def = (fuse_level.stage_index() == 0) ? parent_func.definition() : parent_func.update(fuse_level.stage_index() - 1);
         const vector<Dim> &parent_dims = parent_def.schedule().dims();
 
+        int start_fuse = (int)find_fused_dim(dims, parent_dims, fuse_level.var().name());
+        internal_assert(start_fuse < (int)dims.size());
+
+        int fused_vars_num = dims.size() - start_fuse - 1;
+
         for (int i = start_fuse; i < (int)dims.size() - 1; ++i) {
             const string &var = dims[i].var;
             Expr shift_val;
+
+            string parent_prefix = fuse_level.func() + ".s" + std::to_string(fuse_level.stage_index()) + ".";
+            int parent_var_index = (i - start_fuse) + (int)parent_dims.size() - 1 - fused_vars_num;
+            internal_assert(parent_var_index >= 0);
+            string parent_var = parent_dims[parent_var_index].var;
+
+            // The alignment may name either this stage's var, or the
+            // parent's var it's fused with, if that's not one of the
+            // vars of this stage.
             auto iter = align_strategy.begin();
             for (; iter != align_strategy.end(); ++iter) {
                 if (var_name_match(var, iter->first)) {
                     break;
                 }
             }
+            if (iter == align_strategy.end()) {
+                for (iter = align_strategy.begin(); iter != align_strategy.end(); ++iter) {
+                    const string &align_var = iter->first;
+                    bool names_own_var = std::any_of(dims.begin(), dims.end(), [&](const Dim &d) {
+                        return var_name_match(d.var, align_var);
+                    });
+                    if (!names_own_var && var_name_match(parent_var, align_var)) {
+                        break;
+                    }
+                }
+            }
 
             if ((iter == align_strategy.end()) ||
                 (iter->second == LoopAlignStrategy::NoAlign) ||
@@ -1478,11 +1511,6 @@ private:
                 continue;
             }
 
-            string parent_prefix = fuse_level.func() + ".s" + std::to_string(fuse_level.stage_index()) + ".";
-            int parent_var_index = (i - start_fuse) + (int)parent_dims.size() - 1 - fused_vars_num;
-            internal_assert(parent_var_index >= 0);
-            string parent_var = parent_dims[parent_var_index].var;
-
             auto it_min = bounds.find(prefix + var + ".loop_min");
             auto it_max = bounds.find(prefix + var + ".loop_max");
             internal_assert((it_min != bounds.end()) && (it_max != bounds.end()));
@@ -1513,12 +1541,12 @@ private:
 
         size_t start_fuse = dims.size();
         if (!fuse_level.is_inlined() && !fuse_level.is_root()) {
-            const auto &iter = std::find_if(dims.begin(), dims.end(),
-                                            [&fuse_level](const Dim &d) {
-                                                return var_name_match(d.var, fuse_level.var().name());
-                                            });
-            internal_assert(iter != dims.end());
-            start_fuse = (size_t)(iter - dims.begin());
+            const auto &env_iter = env.find(fuse_level.func());
+            internal_assert(env_iter != env.end());
+            const Function &parent_func = env_iter->second;
+            const Definition &parent_def = (fuse_level.stage_index() == 0) ? parent_func.definition() : parent_func.update(fuse_level.stage_index() - 1);
+            start_fuse = find_fused_dim(dims, parent_def.schedule().dims(), fuse_level.var().name());
+            internal_assert(start_fuse < dims.size());
         }
 
         // The bounds of the child fused loops should be replaced to refer to the
@@ -1553,7 +1581,7 @@ private:
             }
         }
 
-        Stmt produce = build_provide_loop_nest(env, prefix, f, def, (int)(start_fuse), is_update);
+        Stmt produce = build_provide_loop_nest(env, prefix, f, def, (int)(start_fuse), is_update, target);
 
         // Strip off the containing lets. The bounds of the parent fused loop
         // (i.e. the union bounds) might refer to them, so we need to move them
@@ -2455,31 +2483,29 @@ void validate_fused_group_schedule_helper(const string &fn,
             << "Invalid compute_with: cannot find " << p.var_name << " in "
             << p.func_1 << ".s" << p.stage_1 << "\n";
 
-        const auto &iter_2 =
-            std::find_if(dims_2.begin(), dims_2.end(),
-                         [&p](const Dim &d) {
-                             return var_name_match(d.var, p.var_name);
-                         });
-        user_assert(iter_2 != dims_2.end())
+        // The stage computed with may fuse a dim of another name at the
+        // same depth, e.g. an RVar of an update over a different domain.
+        size_t start_fuse_2 = find_fused_dim(dims_2, dims_1, p.var_name);
+        user_assert(start_fuse_2 < dims_2.size())
             << "Invalid compute_with: cannot find " << p.var_name << " in "
             << p.func_2 << ".s" << p.stage_2 << "\n";
 
-        // Verify that their dimensions up to "var_name" are the same.
+        // Verify that their dimensions up to "var_name" are compatible.
         size_t start_fuse_1 = (size_t)(iter_1 - dims_1.begin());
-        size_t start_fuse_2 = (size_t)(iter_2 - dims_2.begin());
 
         int n_fused = (int)(dims_1.size() - start_fuse_1 - 1);  // Ignore __outermost
         user_assert(n_fused == (int)(dims_2.size() - start_fuse_2 - 1))
             << "Invalid compute_with: # of fused dims of " << p.func_1 << ".s"
             << p.stage_1 << " and " << p.func_2 << ".s" << p.stage_2 << " do not match.\n";
 
+        // The fused dims are matched by depth, so they may have different
+        // names, and a pure var may be fused with an RVar: there are no
+        // dependencies between the stages, and the fused loop still visits
+        // each dim of each stage in order. The loops just need to run the
+        // same way.
         for (int i = 0; i < n_fused; ++i) {
             const Dim &d1 = dims_1[start_fuse_1 + i];
             const Dim &d2 = dims_2[start_fuse_2 + i];
-            user_assert(var_name_match(d1.var, d2.var)) << "Invalid compute_with: names of dim "
-                                                        << i << " of " << p.func_1 << ".s"
-                                                        << p.stage_1 << "(" << d1.var << ") and " << p.func_2
-                                                        << ".s" << p.stage_2 << "(" << d2.var << ") do not match.\n";
             user_assert(d1.for_type == d2.for_type) << "Invalid compute_with: for types of dim "
                                                     << i << " of " << p.func_1 << ".s" << p.stage_1 << "("
                                                     << d1.var << " is " << d1.for_type << ") and " << p.func_2
@@ -2490,11 +2516,6 @@ void validate_fused_group_schedule_helper(const string &fn,
                                                         << d1.var << " is " << d1.device_api << ") and " << p.func_2
                                                         << ".s" << p.stage_2 << "(" << d2.var << " is " << d2.device_api
                                                         << ") do not match.\n";
-            user_assert(d1.dim_type == d2.dim_type) << "Invalid compute_with: types of dim "
-                                                    << i << " of " << p.func_1 << ".s" << p.stage_1 << "("
-                                                    << d1.var << " is " << d1.dim_type << ") and " << p.func_2
-                                                    << ".s" << p.stage_2 << "(" << d2.var << " is " << d2.dim_type
-                                                    << ") do not match.\n";
         }
     }
 }
@@ -6,6 +6,7 @@
 #include "Func.h"
 #include "Function.h"
 #include "IR.h"
+#include "Module.h"
 #include "RealizationOrder.h"
 #include "Schedule.h"
 #include "halide_ir.fbs.h"
@@ -34,6 +35,14 @@ public:
     // Serialize the given pipeline into given the data buffer
     void serialize(const Pipeline &pipeline, std::vector<uint8_t> &data);
 
+    // Serialize the given pipeline along with modules lowered from it into the given filename,
+    // optionally including the object code compiled for each module
+    void serialize(const Pipeline &pipeline, const std::vector<Module> &modules, bool include_object_code, const std::string &filename);
+
+    // Serialize the given pipeline along with modules lowered from it into the given data buffer,
+    // optionally including the object code compiled for each module
+    void serialize(const Pipeline &pipeline, const std::vector<Module> &modules, bool include_object_code, std::vector<uint8_t> &data);
+
     const std::map<std::string, Parameter> &get_external_parameters() const {
         return external_parameters;
     }
@@ -70,6 +79,8 @@ private:
 
     Serialize::NameMangling serialize_name_mangling(const NameMangling &name_mangling);
 
+    Serialize::TraceSampling serialize_trace_sampling(const TraceSampling &trace_sampling);
+
     Serialize::TailStrategy serialize_tail_strategy(const TailStrategy &tail_strategy);
 
     Serialize::SplitType serialize_split_type(const Split::SplitType &split_type);
@@ -80,6 +91,10 @@ private:
 
     Serialize::ExternFuncArgumentType serialize_extern_func_argument_type(const ExternFuncArgument::ArgType &extern_func_argument_type);
 
+    Serialize::ArgumentKind serialize_argument_kind(const Argument::Kind &argument_kind);
+
+    Serialize::LinkageType serialize_linkage_type(const LinkageType &linkage_type);
+
     Offset<String> serialize_string(FlatBufferBuilder &builder, const std::string &str);
 
     Offset<Serialize::Type> serialize_type(FlatBufferBuilder &builder, const Type &type);
@@ -135,6 +150,14 @@ private:
 
     std::vector<Offset<Serialize::WrapperRef>> serialize_wrapper_refs(FlatBufferBuilder &builder, const std::map<std::string, FunctionPtr> &wrappers);
 
+    Offset<Serialize::ArgumentEstimates> serialize_argument_estimates(FlatBufferBuilder &builder, const ArgumentEstimates &argument_estimates);
+
+    Offset<Serialize::LoweredArgument> serialize_lowered_argument(FlatBufferBuilder &builder, const LoweredArgument &lowered_argument);
+
+    Offset<Serialize::LoweredFunc> serialize_lowered_func(FlatBufferBuilder &builder, const LoweredFunc &lowered_func);
+
+    Offset<Serialize::Module> serialize_module(FlatBufferBuilder &builder, const Module &module, bool include_object_code);
+
     void build_function_mappings(const std::map<std::string, Function> &env);
 };
 
@@ -158,6 +181,12 @@ Serialize::MemoryType Serializer::serialize_memory_type(const MemoryType &memory
         return Serialize::MemoryType::VTCM;
     case MemoryType::AMXTile:
         return Serialize::MemoryType::AMXTile;
+    case MemoryType::Streaming:
+        return Serialize::MemoryType::Streaming;
+    case MemoryType::WMMAAccumulator:
+        return Serialize::MemoryType::WMMAAccumulator;
+    case MemoryType::SimdgroupMatrix:
+        return Serialize::MemoryType::SimdgroupMatrix;
     default:
         user_error << "Unsupported memory type\n";
         return Serialize::MemoryType::Auto;
@@ -304,6 +333,20 @@ Serialize::NameMangling Serializer::serialize_name_mangling(const NameMangling &
     }
 }
 
+Serialize::TraceSampling Serializer::serialize_trace_sampling(const TraceSampling &trace_sampling) {
+    switch (trace_sampling) {
+    case TraceSampling::EveryNth:
+        return Serialize::TraceSampling::EveryNth;
+    case TraceSampling::FirstN:
+        return Serialize::TraceSampling::FirstN;
+    case TraceSampling::Random:
+        return Serialize::TraceSampling::Random;
+    default:
+        user_error << "Unsupported trace sampling\n";
+        return Serialize::TraceSampling::EveryNth;
+    }
+}
+
 Serialize::TailStrategy Serializer::serialize_tail_strategy(const TailStrategy &tail_strategy) {
     switch (tail_strategy) {
     case TailStrategy::RoundUp:
@@ -392,6 +435,36 @@ Serialize::ExternFuncArgumentType Serializer::serialize_extern_func_argument_typ
     }
 }
 
+Serialize::ArgumentKind Serializer::serialize_argument_kind(const Argument::Kind &argument_kind) {
+    switch (argument_kind) {
+    case Argument::Kind::InputScalar:
+        return Serialize::ArgumentKind::InputScalar;
+    case Argument::Kind::InputBuffer:
+        return Serialize::ArgumentKind::InputBuffer;
+    case Argument::Kind::OutputBuffer:
+        return Serialize::ArgumentKind::OutputBuffer;
+    default:
+        user_error << "Unsupported argument kind\n";
+        return Serialize::ArgumentKind::InputScalar;
+    }
+}
+
+Serialize::LinkageType Serializer::serialize_linkage_type(const LinkageType &linkage_type) {
+    switch (linkage_type) {
+    case LinkageType::External:
+        return Serialize::LinkageType::External;
+    case LinkageType::ExternalPlusMetadata:
+        return Serialize::LinkageType::ExternalPlusMetadata;
+    case LinkageType::ExternalPlusArgv:
+        return Serialize::LinkageType::ExternalPlusArgv;
+    case LinkageType::Internal:
+        return Serialize::LinkageType::Internal;
+    default:
+        user_error << "Unsupported linkage type\n";
+        return Serialize::LinkageType::External;
+    }
+}
+
 Offset<String> Serializer::serialize_string(FlatBufferBuilder &builder, const std::string &str) {
     return builder.CreateString(str);
 }
@@ -1029,6 +1102,9 @@ Offset<Serialize::Func> Serializer::serialize_function(FlatBufferBuilder &builde
     }
     const bool no_profiling = function.should_not_profile();
     const bool frozen = function.frozen();
+    const auto trace_sampling_var_serialized = serialize_string(builder, function.trace_sampling_var());
+    const auto trace_sampling_serialized = serialize_trace_sampling(function.trace_sampling());
+    const int trace_sampling_n = function.trace_sampling_n();
     auto func = Serialize::CreateFunc(builder,
                                       name_serialized,
                                       origin_name_serialized,
@@ -1051,7 +1127,10 @@ Offset<Serialize::Func> Serializer::serialize_function(FlatBufferBuilder &builde
                                       trace_realizations,
                                       builder.CreateVector(trace_tags_serialized),
                                       no_profiling,
-                                      frozen);
+                                      frozen,
+                                      trace_sampling_var_serialized,
+                                      trace_sampling_serialized,
+                                      trace_sampling_n);
     return func;
 }
 
@@ -1118,6 +1197,7 @@ Offset<Serialize::FuncSchedule> Serializer::serialize_func_schedule(FlatBufferBu
     const auto async = func_schedule.async();
     const auto ring_buffer = serialize_expr(builder, func_schedule.ring_buffer());
     const auto memoize_eviction_key_serialized = serialize_expr(builder, func_schedule.memoize_eviction_key());
+    const auto memoize_hash_buffer_contents = func_schedule.memoize_hash_buffer_contents();
     return Serialize::CreateFuncSchedule(builder, store_level_serialized, compute_level_serialized,
                                          hoist_storage_level_serialized,
                                          builder.CreateVector(storage_dims_serialized),
@@ -1125,7 +1205,8 @@ Offset<Serialize::FuncSchedule> Serializer::serialize_func_schedule(FlatBufferBu
                                          builder.CreateVector(estimates_serialized),
                                          builder.CreateVector(wrappers_serialized),
                                          memory_type, memoized, async, ring_buffer.first, ring_buffer.second,
-                                         memoize_eviction_key_serialized.first, memoize_eviction_key_serialized.second);
+                                         memoize_eviction_key_serialized.first, memoize_eviction_key_serialized.second,
+                                         memoize_hash_buffer_contents);
 }
 
 Offset<Serialize::Specialization> Serializer::serialize_specialization(FlatBufferBuilder &builder, const Specialization &specialization) {
@@ -1416,11 +1497,12 @@ Offset<Serialize::Buffer> Serializer::serialize_buffer(FlatBufferBuilder &builde
         int32_t stride = buffer.dim(i).stride();
         buffer_dimensions_serialized.push_back(Serialize::CreateBufferDimension(builder, min, extent, stride));
     }
+    const auto dims_serialized = builder.CreateVector(buffer_dimensions_serialized);
     auto copy = buffer.copy();  // compact in memory
-    std::vector<uint8_t> data;
-    data.resize(copy.size_in_bytes());
-    memcpy(data.data(), copy.data(), copy.size_in_bytes());
-    return Serialize::CreateBuffer(builder, true, name_serialized, type_serialized, dimensions, builder.CreateVector(buffer_dimensions_serialized), builder.CreateVector(data));
+    // Align the contents, so that deserializing from a memory-mapped file can use them in place
+    builder.ForceVectorAlignment(copy.size_in_bytes(), sizeof(uint8_t), FLATBUFFERS_MAX_ALIGNMENT);
+    const auto data_serialized = builder.CreateVector((const uint8_t *)copy.data(), copy.size_in_bytes());
+    return Serialize::CreateBuffer(builder, true, name_serialized, type_serialized, dimensions, dims_serialized, data_serialized);
 }
 
 std::vector<Offset<Serialize::WrapperRef>> Serializer::serialize_wrapper_refs(FlatBufferBuilder &builder, const std::map<std::string, FunctionPtr> &wrappers) {
@@ -1437,6 +1519,94 @@ std::vector<Offset<Serialize::WrapperRef>> Serializer::serialize_wrapper_refs(Fl
     return wrapper_refs_serialized;
 }
 
+Offset<Serialize::ArgumentEstimates> Serializer::serialize_argument_estimates(FlatBufferBuilder &builder, const ArgumentEstimates &argument_estimates) {
+    const auto scalar_def_serialized = serialize_expr(builder, argument_estimates.scalar_def);
+    const auto scalar_min_serialized = serialize_expr(builder, argument_estimates.scalar_min);
+    const auto scalar_max_serialized = serialize_expr(builder, argument_estimates.scalar_max);
+    const auto scalar_estimate_serialized = serialize_expr(builder, argument_estimates.scalar_estimate);
+    std::vector<Offset<Serialize::Range>> buffer_estimates_serialized;
+    buffer_estimates_serialized.reserve(argument_estimates.buffer_estimates.size());
+    for (const auto &buffer_estimate : argument_estimates.buffer_estimates) {
+        buffer_estimates_serialized.push_back(serialize_range(builder, buffer_estimate));
+    }
+    return Serialize::CreateArgumentEstimates(builder,
+                                              scalar_def_serialized.first, scalar_def_serialized.second,
+                                              scalar_min_serialized.first, scalar_min_serialized.second,
+                                              scalar_max_serialized.first, scalar_max_serialized.second,
+                                              scalar_estimate_serialized.first, scalar_estimate_serialized.second,
+                                              builder.CreateVector(buffer_estimates_serialized));
+}
+
+Offset<Serialize::LoweredArgument> Serializer::serialize_lowered_argument(FlatBufferBuilder &builder, const LoweredArgument &lowered_argument) {
+    const auto name_serialized = serialize_string(builder, lowered_argument.name);
+    const auto kind_serialized = serialize_argument_kind(lowered_argument.kind);
+    const auto type_serialized = serialize_type(builder, lowered_argument.type);
+    const int32_t dimensions = lowered_argument.dimensions;
+    const auto argument_estimates_serialized = serialize_argument_estimates(builder, lowered_argument.argument_estimates);
+    const auto alignment_serialized = serialize_modulus_remainder(builder, lowered_argument.alignment);
+    return Serialize::CreateLoweredArgument(builder, name_serialized, kind_serialized, type_serialized, dimensions,
+                                            argument_estimates_serialized, alignment_serialized);
+}
+
+Offset<Serialize::LoweredFunc> Serializer::serialize_lowered_func(FlatBufferBuilder &builder, const LoweredFunc &lowered_func) {
+    const auto name_serialized = serialize_string(builder, lowered_func.name);
+    std::vector<Offset<Serialize::LoweredArgument>> args_serialized;
+    args_serialized.reserve(lowered_func.args.size());
+    for (const auto &arg : lowered_func.args) {
+        args_serialized.push_back(serialize_lowered_argument(builder, arg));
+    }
+    const auto body_serialized = serialize_stmt(builder, lowered_func.body);
+    const auto linkage_serialized = serialize_linkage_type(lowered_func.linkage);
+    const auto name_mangling_serialized = serialize_name_mangling(lowered_func.name_mangling);
+    const auto target_features_serialized = serialize_string(builder, lowered_func.target_features);
+    return Serialize::CreateLoweredFunc(builder, name_serialized, builder.CreateVector(args_serialized),
+                                        body_serialized.first, body_serialized.second,
+                                        linkage_serialized, name_mangling_serialized, target_features_serialized);
+}
+
+Offset<Serialize::Module> Serializer::serialize_module(FlatBufferBuilder &builder, const Module &module, bool include_object_code) {
+    const auto name_serialized = serialize_string(builder, module.name());
+    const auto target_serialized = serialize_string(builder, module.target().to_string());
+    std::vector<Offset<Serialize::LoweredFunc>> functions_serialized;
+    functions_serialized.reserve(module.functions().size());
+    for (const auto &function : module.functions()) {
+        functions_serialized.push_back(serialize_lowered_func(builder, function));
+    }
+    // Like the buffers used in the IR, the module's buffers are serialized once with the pipeline
+    // and referred to by name here
+    std::vector<Offset<String>> buffer_names_serialized;
+    buffer_names_serialized.reserve(module.buffers().size());
+    for (const auto &buffer : module.buffers()) {
+        buffers_in_pipeline[buffer.name()] = buffer;
+        buffer_names_serialized.push_back(serialize_string(builder, buffer.name()));
+    }
+    std::vector<Offset<Serialize::Module>> submodules_serialized;
+    submodules_serialized.reserve(module.submodules().size());
+    for (const auto &submodule : module.submodules()) {
+        submodules_serialized.push_back(serialize_module(builder, submodule, false));
+    }
+    std::vector<Offset<Serialize::MetadataName>> metadata_name_map_serialized;
+    for (const auto &entry : module.get_metadata_name_map()) {
+        metadata_name_map_serialized.push_back(Serialize::CreateMetadataName(builder,
+                                                                             serialize_string(builder, entry.first),
+                                                                             serialize_string(builder, entry.second)));
+    }
+    Offset<flatbuffers::Vector<uint8_t>> object_code_serialized;
+    if (include_object_code) {
+        // The object code of the whole module, with its submodules compiled in
+        const Buffer<uint8_t> object_code = module.submodules().empty() ? module.compile_to_buffer() : module.resolve_submodules().compile_to_buffer();
+        object_code_serialized = builder.CreateVector(object_code.data(), object_code.size_in_bytes());
+    }
+    return Serialize::CreateModule(builder, name_serialized, target_serialized,
+                                   builder.CreateVector(functions_serialized),
+                                   builder.CreateVector(buffer_names_serialized),
+                                   builder.CreateVector(submodules_serialized),
+                                   builder.CreateVector(metadata_name_map_serialized),
+                                   module.any_strict_float(),
+                                   module.skip_llvm_optimization(),
+                                   object_code_serialized);
+}
+
 void Serializer::build_function_mappings(const std::map<std::string, Function> &env) {
     if (!this->func_mappings.empty()) {
         this->func_mappings.clear();
@@ -1449,6 +1619,10 @@ void Serializer::build_function_mappings(const std::map<std::string, Function> &
 }
 
 void Serializer::serialize(const Pipeline &pipeline, std::vector<uint8_t> &result) {
+    serialize(pipeline, {}, false, result);
+}
+
+void Serializer::serialize(const Pipeline &pipeline, const std::vector<Module> &modules, bool include_object_code, std::vector<uint8_t> &result) {
     FlatBufferBuilder builder(1024);
 
     // extract the DAG, unwrap function from Funcs
@@ -1483,6 +1657,13 @@ void Serializer::serialize(const Pipeline &pipeline, std::vector<uint8_t> &resul
         requirements_types.push_back(stmt_serialized.first);
     }
 
+    // Modules are serialized before the parameters and buffers, since their bodies refer to them too
+    std::vector<Offset<Serialize::Module>> modules_serialized;
+    modules_serialized.reserve(modules.size());
+    for (const auto &module : modules) {
+        modules_serialized.push_back(serialize_module(builder, module, include_object_code));
+    }
+
     // For Parameters and buffers, to avoid serializing the same object multiple times, we use a map to store the unique
     // objects seen in the whole pipeline and only serialize their names (strings) at the use sites,
     // then we do the actual serialization of the unique objects once
@@ -1526,7 +1707,8 @@ void Serializer::serialize(const Pipeline &pipeline, std::vector<uint8_t> &resul
                                                   builder.CreateVector(external_parameters_serialized),
                                                   builder.CreateVector(buffers_serialized),
                                                   serialize_string(builder, halide_version),
-                                                  serialize_string(builder, serialization_version));
+                                                  serialize_string(builder, serialization_version),
+                                                  builder.CreateVector(modules_serialized));
     builder.Finish(pipeline_obj);
 
     uint8_t *buf = builder.GetBufferPointer();
@@ -1542,8 +1724,12 @@ void Serializer::serialize(const Pipeline &pipeline, std::vector<uint8_t> &resul
 }
 
 void Serializer::serialize(const Pipeline &pipeline, const std::string &filename) {
+    serialize(pipeline, {}, false, filename);
+}
+
+void Serializer::serialize(const Pipeline &pipeline, const std::vector<Module> &modules, bool include_object_code, const std::string &filename) {
     std::vector<uint8_t> data;
-    serialize(pipeline, data);
+    serialize(pipeline, modules, include_object_code, data);
     std::ofstream out(filename, std::ios::out | std::ios::binary);
     if (!out) {
         user_error << "failed to open file " << filename << "\n";
@@ -1577,6 +1763,16 @@ void serialize_pipeline(const Pipeline &pipeline, const std::string &filename, s
     params = serializer.get_external_parameters();
 }
 
+void serialize_pipeline(const Pipeline &pipeline, const std::vector<Module> &modules, std::vector<uint8_t> &data, bool include_object_code) {
+    Internal::Serializer serializer;
+    serializer.serialize(pipeline, modules, include_object_code, data);
+}
+
+void serialize_pipeline(const Pipeline &pipeline, const std::vector<Module> &modules, const std::string &filename, bool include_object_code) {
+    Internal::Serializer serializer;
+    serializer.serialize(pipeline, modules, include_object_code, filename);
+}
+
 }  // namespace Halide
 
 #else  // WITH_SERIALIZATION
@@ -1599,6 +1795,14 @@ void serialize_pipeline(const Pipeline &pipeline, const std::string &filename, s
     user_error << "Serialization is not supported in this build of Halide; try rebuilding with WITH_SERIALIZATION=ON.";
 }
 
+void serialize_pipeline(const Pipeline &pipeline, const std::vector<Module> &modules, std::vector<uint8_t> &data, bool include_object_code) {
+    user_error << "Serialization is not supported in this build of Halide; try rebuilding with WITH_SERIALIZATION=ON.";
+}
+
+void serialize_pipeline(const Pipeline &pipeline, const std::vector<Module> &modules, const std::string &filename, bool include_object_code) {
+    user_error << "Serialization is not supported in this build of Halide; try rebuilding with WITH_SERIALIZATION=ON.";
+}
+
 }  // namespace Halide
 
 #endif  // WITH_SERIALIZATION
@@ -27,6 +27,20 @@ void serialize_pipeline(const Pipeline &pipeline, const std::string &filename);
 /// @param params Map of named parameters which will get populated during serialization (can be used to bind external parameters to objects in the pipeline by name).
 void serialize_pipeline(const Pipeline &pipeline, const std::string &filename, std::map<std::string, Parameter> &params);
 
+/// @brief Serialize a Halide pipeline along with Modules lowered from it (e.g. by Pipeline::compile_to_module) into the given data buffer.
+/// @param pipeline The Halide pipeline to serialize.
+/// @param modules The lowered Modules to serialize with the pipeline, including the bodies of their LoweredFuncs.
+/// @param data The data buffer to store the serialized Halide pipeline into. Any existing contents will be destroyed.
+/// @param include_object_code Whether to also store the object code compiled for each Module's Target (see Module::compile_to_buffer).
+void serialize_pipeline(const Pipeline &pipeline, const std::vector<Module> &modules, std::vector<uint8_t> &data, bool include_object_code = false);
+
+/// @brief Serialize a Halide pipeline along with Modules lowered from it (e.g. by Pipeline::compile_to_module) into the given filename.
+/// @param pipeline The Halide pipeline to serialize.
+/// @param modules The lowered Modules to serialize with the pipeline, including the bodies of their LoweredFuncs.
+/// @param filename The location of the file to write into to store the serialized pipeline.  Any existing contents will be destroyed.
+/// @param include_object_code Whether to also store the object code compiled for each Module's Target (see Module::compile_to_buffer).
+void serialize_pipeline(const Pipeline &pipeline, const std::vector<Module> &modules, const std::string &filename, bool include_object_code = false);
+
 }  // namespace Halide
 
 #endif
@@ -3,6 +3,7 @@
 
 #include "CSE.h"
 #include "CompilerLogger.h"
+#include "IREquality.h"
 #include "IRMutator.h"
 #include "Substitute.h"
 
@@ -375,10 +376,143 @@ Simplify::ScopedFact::~ScopedFact() {
     }
 }
 
+namespace {
+
+// A structural hash of an Expr. Exprs that are equal() hash the same as long
+// as they share subexpressions the same way, which they nearly always do; a
+// mismatch only costs a cache miss.
+class HashExpr : public IRGraphVisitor {
+    using IRGraphVisitor::visit;
+
+    void mix(uint64_t x) {
+        h = (h ^ x) * 1099511628211ULL;
+    }
+
+    void mix(const std::string &s) {
+        mix(std::hash<std::string>()(s));
+    }
+
+    void mix(const Type &t) {
+        mix(((uint64_t)t.code() << 32) | ((uint64_t)t.bits() << 16) | (uint64_t)t.lanes());
+    }
+
+    void visit(const IntImm *op) override {
+        mix(op->type);
+        mix((uint64_t)op->value);
+    }
+
+    void visit(const UIntImm *op) override {
+        mix(op->type);
+        mix(op->value);
+    }
+
+    void visit(const FloatImm *op) override {
+        mix(op->type);
+        mix(reinterpret_bits<uint64_t>(op->value));
+    }
+
+    void visit(const StringImm *op) override {
+        mix(op->value);
+    }
+
+    void visit(const Variable *op) override {
+        mix(op->type);
+        mix(op->name);
+    }
+
+    void visit(const Cast *op) override {
+        mix(op->type);
+        IRGraphVisitor::visit(op);
+    }
+
+    void visit(const Call *op) override {
+        mix(op->type);
+        mix(op->name);
+        IRGraphVisitor::visit(op);
+    }
+
+    void visit(const Load *op) override {
+        mix(op->type);
+        mix(op->name);
+        IRGraphVisitor::visit(op);
+    }
+
+    void visit(const Let *op) override {
+        mix(op->name);
+        IRGraphVisitor::visit(op);
+    }
+
+public:
+    uint64_t h = 14695981039346656037ULL;
+
+    uint64_t hash(const Expr &e) {
+        mix(e.type());
+        mix((uint64_t)e->node_type);
+        include(e);
+        return h;
+    }
+};
+
+thread_local ScopedSimplifierCache::Contents *active_simplifier_cache = nullptr;
+
+}  // namespace
+
+struct ScopedSimplifierCache::Contents {
+    // Bucketed by hash. Each entry maps an input Expr to its simplified
+    // form. Lookups confirm a match with graph_equal.
+    std::map<uint64_t, std::vector<std::pair<Expr, Expr>>> entries;
+    size_t size = 0;
+    uint64_t hits = 0, misses = 0;
+    Contents *enclosing = nullptr;
+
+    // Bound the memory a single lowering can hold onto.
+    static constexpr size_t max_size = 1 << 16;
+};
+
+ScopedSimplifierCache::ScopedSimplifierCache()
+    : contents(std::make_unique<Contents>()) {
+    contents->enclosing = active_simplifier_cache;
+    active_simplifier_cache = contents.get();
+}
+
+ScopedSimplifierCache::~ScopedSimplifierCache() {
+    internal_assert(active_simplifier_cache == contents.get())
+        << "ScopedSimplifierCache objects must be destroyed in the reverse order of creation\n";
+    active_simplifier_cache = contents->enclosing;
+}
+
+uint64_t ScopedSimplifierCache::hits() const {
+    return contents->hits;
+}
+
+uint64_t ScopedSimplifierCache::misses() const {
+    return contents->misses;
+}
+
 Expr simplify(const Expr &e, bool remove_dead_let_stmts,
               const Scope<Interval> &bounds,
               const Scope<ModulusRemainder> &alignment,
               const std::vector<Expr> &assumptions) {
+    ScopedSimplifierCache::Contents *cache = active_simplifier_cache;
+    uint64_t key = 0;
+    if (cache && e.defined() &&
+        &bounds == &Scope<Interval>::empty_scope() &&
+        &alignment == &Scope<ModulusRemainder>::empty_scope() &&
+        assumptions.empty()) {
+        key = HashExpr().hash(e) ^ (uint64_t)remove_dead_let_stmts;
+        auto it = cache->entries.find(key);
+        if (it != cache->entries.end()) {
+            for (const auto &entry : it->second) {
+                if (entry.first.same_as(e) || graph_equal(entry.first, e)) {
+                    cache->hits++;
+                    return entry.second;
+                }
+            }
+        }
+    } else {
+        cache = nullptr;
+    }
+
     Simplify m(remove_dead_let_stmts, &bounds, &alignment);
     std::vector<Simplify::ScopedFact> facts;
     for (const Expr &a : assumptions) {
@@ -386,7 +520,16 @@ Expr simplify(const Expr &e, bool remove_dead_let_stmts,
     }
     Expr result = m.mutate(e, nullptr);
     if (m.in_unreachable) {
-        return unreachable(e.type());
+        result = unreachable(e.type());
+    }
+    if (cache) {
+        cache->misses++;
+        if (cache->size >= ScopedSimplifierCache::Contents::max_size) {
+            cache->entries.clear();
+            cache->size = 0;
+        }
+        cache->entries[key].emplace_back(e, result);
+        cache->size++;
     }
     return result;
 }
@@ -5,6 +5,8 @@
  * Methods for simplifying halide statements and expressions
  */
 
+#include <memory>
+
 #include "Expr.h"
 #include "Interval.h"
 #include "ModulusRemainder.h"
@@ -33,6 +35,35 @@ Expr simplify(const Expr &,
               const std::vector<Expr> &assumptions = std::vector<Expr>());
 // @}
 
+/** While an object of this type is alive, calls to simplify(Expr) on the
+ * same thread that pass no bounds, alignment, or assumptions are memoized.
+ * Results are keyed on the structure of the Expr, so structurally identical
+ * Exprs built independently share a cache entry. Scopes may nest; the
+ * innermost one is used. lower() opens one for the whole of lowering when
+ * the HL_SIMPLIFIER_CACHE environment variable is set. */
+class ScopedSimplifierCache {
+public:
+    ScopedSimplifierCache();
+    ~ScopedSimplifierCache();
+
+    ScopedSimplifierCache(const ScopedSimplifierCache &) = delete;
+    ScopedSimplifierCache &operator=(const ScopedSimplifierCache &) = delete;
+    ScopedSimplifierCache(ScopedSimplifierCache &&) = delete;
+    ScopedSimplifierCache &operator=(ScopedSimplifierCache &&) = delete;
+
+    /** The number of simplify calls answered from, or added to, the cache. */
+    // @{
+    uint64_t hits() const;
+    uint64_t misses() const;
+    // @}
+
+    struct Contents;
+
+private:
+    std::unique_ptr<Contents> contents;
+    ScopedSimplifierCache *enclosing;
+};
+
 /** Attempt to statically prove an expression is true using the simplifier. */
 bool can_prove(Expr e, const Scope<Interval> &bounds = Scope<Interval>::empty_scope());
 
@@ -81,20 +81,28 @@ vector<Definition> propagate_specialization_in_definition(Definition &def, const
     // -- Once we encounter a Specialization that is const-true, no subsequent
     // Specializations can ever trigger (since we evaluate them in order),
     // so erase them.
+    // -- More generally, a Specialization is only reached if the conditions
+    // of all the ones before it are false. If that makes its own condition
+    // false, e.g. because it implies an earlier one, it can never trigger;
+    // if that makes its condition true, no subsequent ones can.
     bool seen_const_true = false;
+    Expr none_before = const_true();
     for (auto it = specializations.begin(); it != specializations.end(); /*no-increment*/) {
         Expr old_c = it->condition;
         Expr c = simplify(it->condition);
         // Go ahead and save the simplified condition now
         it->condition = c;
-        if (is_const_zero(c) || seen_const_true) {
+        if (is_const_zero(c) || seen_const_true ||
+            (!is_const_one(none_before) && can_prove(!(none_before && c)))) {
             debug(1) << "Erasing unreachable specialization ("
                      << old_c << ") -> (" << c << ") for function \"" << name << "\"\n";
             it = specializations.erase(it);
         } else {
             it++;
+            seen_const_true |= is_const_one(c) ||
+                               (!is_const_one(none_before) && can_prove(!none_before || c));
+            none_before = simplify(none_before && !c);
         }
-        seen_const_true |= is_const_one(c);
     }
 
     // If the final Specialization is const-true, then the default schedule
@@ -0,0 +1,172 @@
+#include "SizeVariants.h"
+
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+
+#include "IR.h"
+#include "IROperator.h"
+#include "Pipeline.h"
+#include "Target.h"
+#include "Util.h"
+
+namespace Halide {
+namespace Internal {
+
+namespace {
+
+Expr buffer_var(const std::string &name) {
+    return Variable::make(type_of<halide_buffer_t *>(), name + ".buffer");
+}
+
+}  // namespace
+
+Module build_size_variants_module(const std::string &fn_name, const Target &target,
+                                  const std::vector<float> &scales_in,
+                                  const std::function<Module(const std::string &, float)> &build_variant) {
+    // The variants are in order of increasing size, so the buckets are too.
+    std::vector<float> scales = scales_in;
+    std::sort(scales.begin(), scales.end());
+    scales.erase(std::unique(scales.begin(), scales.end()), scales.end());
+    user_assert(!scales.empty() && scales[0] > 0)
+        << "The size variants of " << fn_name << " must be a list of positive scale factors.\n";
+
+    const std::string base_name = strip_namespaces(fn_name);
+    std::vector<Module> variants;
+    std::vector<std::string> variant_names;
+    std::vector<LoweredArgument> args;
+    std::string output_name;
+    // The estimated number of elements of the first output of each variant.
+    std::vector<double> output_sizes;
+    for (size_t i = 0; i < scales.size(); i++) {
+        std::string name = base_name + "_size_variant_" + std::to_string(i);
+        debug(1) << "Building size variant " << name << " with estimates scaled by " << scales[i] << "\n";
+        Module m = build_variant(name, scales[i]);
+        const LoweredFunc f = m.get_function_by_name(name);
+        internal_assert(f.linkage == LinkageType::Internal);
+        args = f.args;
+
+        const LoweredArgument *output = nullptr;
+        for (const auto &arg : f.args) {
+            if (arg.kind == Argument::OutputBuffer) {
+                output = &arg;
+                break;
+            }
+        }
+        internal_assert(output);
+        output_name = output->name;
+
+        double size = 1;
+        const Region &estimates = output->argument_estimates.buffer_estimates;
+        user_assert(estimates.size() == (size_t)output->dimensions)
+            << "Output " << output->name << " of " << fn_name << " needs estimates to be built with size variants.\n";
+        for (const Range &r : estimates) {
+            auto extent = as_const_int(r.extent);
+            user_assert(extent)
+                << "Output " << output->name << " of " << fn_name << " needs constant estimates to be built with size variants.\n";
+            size *= (double)*extent;
+        }
+        output_sizes.push_back(size);
+
+        variants.push_back(m);
+        variant_names.push_back(name);
+    }
+    const int num_variants = (int)variants.size();
+
+    // Put the call in the bucket of the variant whose estimated output size
+    // is closest to the actual one (by ratio).
+    Expr actual_size = make_const(Float(64), 1.0);
+    for (const auto &arg : args) {
+        if (arg.name != output_name) {
+            continue;
+        }
+        for (int d = 0; d < arg.dimensions; d++) {
+            Expr extent = Call::make(Int(32), Call::buffer_get_extent, {buffer_var(arg.name), d}, Call::Extern);
+            actual_size *= cast<double>(extent);
+        }
+    }
+    Expr bucket = make_zero(Int(32));
+    for (int i = 0; i + 1 < num_variants; i++) {
+        double threshold = std::sqrt(output_sizes[i] * output_sizes[i + 1]);
+        bucket += select(actual_size > make_const(Float(64), threshold), 1, 0);
+    }
+    const std::string bucket_name = unique_name(base_name + "_bucket");
+    Expr bucket_var = Variable::make(Int(32), bucket_name);
+
+    std::vector<Expr> call_args;
+    Expr is_bounds_query = const_false();
+    for (const auto &arg : args) {
+        if (arg.is_buffer()) {
+            call_args.push_back(buffer_var(arg.name));
+            is_bounds_query = is_bounds_query || Call::make(Bool(), Call::buffer_is_bounds_query, {buffer_var(arg.name)}, Call::Extern);
+        } else {
+            call_args.push_back(Variable::make(arg.type, arg.name));
+        }
+    }
+
+    const std::string start_name = unique_name(base_name + "_start_time");
+    Expr start_var = Variable::make(Int(64), start_name);
+    const auto call_variant = [&](int i, bool timed) {
+        Expr result = Call::make(Int(32), variant_names[i], call_args, Call::Extern);
+        const std::string result_name = unique_name(base_name + "_result");
+        Expr result_var = Variable::make(Int(32), result_name);
+        Stmt s = AssertStmt::make(result_var == 0, result_var);
+        if (timed) {
+            Expr now = Call::make(Int(64), "halide_current_time_ns", {}, Call::Extern);
+            Expr report = Call::make(Int(32), "halide_report_size_variant_time",
+                                     {fn_name, bucket_var, i, now - start_var}, Call::Extern);
+            s = Block::make(Evaluate::make(report), s);
+        }
+        return LetStmt::make(result_name, result, s);
+    };
+    const auto dispatch = [&](const Expr &variant, bool timed) {
+        Stmt s = call_variant(num_variants - 1, timed);
+        for (int i = num_variants - 2; i >= 0; i--) {
+            s = IfThenElse::make(variant == i, call_variant(i, timed), s);
+        }
+        return s;
+    };
+
+    // Bounds queries just use the variant for the bucket, and aren't timed.
+    const std::string variant_name = unique_name(base_name + "_variant");
+    Expr variant_var = Variable::make(Int(32), variant_name);
+    Expr choose = Call::make(Int(32), "halide_choose_size_variant",
+                             {fn_name, bucket_var, num_variants}, Call::Extern);
+    Stmt timed_call = dispatch(variant_var, true);
+    timed_call = LetStmt::make(start_name, Call::make(Int(64), "halide_current_time_ns", {}, Call::Extern), timed_call);
+    timed_call = LetStmt::make(variant_name, choose, timed_call);
+    Stmt body = IfThenElse::make(is_bounds_query, dispatch(bucket_var, false), timed_call);
+    body = LetStmt::make(bucket_name, bucket, body);
+
+    Module result(fn_name, target, variants[0].get_metadata_name_map());
+    std::ostringstream schedule_source;
+    for (size_t i = 0; i < variants.size(); i++) {
+        for (const auto &b : variants[i].buffers()) {
+            result.append(b);
+        }
+        for (const auto &f : variants[i].functions()) {
+            result.append(f);
+        }
+        if (const auto *r = variants[i].get_auto_scheduler_results()) {
+            schedule_source << "// Size variant " << i << ", with the estimates scaled by " << scales[i] << "\n"
+                            << r->schedule_source << "\n";
+        }
+        if (variants[i].any_strict_float()) {
+            result.set_any_strict_float(true);
+        }
+    }
+    result.append(LoweredFunc(fn_name, args, body, LinkageType::ExternalPlusMetadata));
+
+    // There's only room for one featurization, so it's the one of the
+    // smallest variant.
+    if (const auto *r = variants[0].get_auto_scheduler_results()) {
+        AutoSchedulerResults results = *r;
+        results.schedule_source = schedule_source.str();
+        result.set_auto_scheduler_results(results);
+    }
+
+    return result;
+}
+
+}  // namespace Internal
+}  // namespace Halide
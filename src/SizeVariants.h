@@ -0,0 +1,37 @@
+#ifndef HALIDE_SIZE_VARIANTS_H
+#define HALIDE_SIZE_VARIANTS_H
+
+/** \file
+ * Defines the wrapper that dispatches between variants of a pipeline
+ * autoscheduled for different input sizes.
+ */
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "Module.h"
+
+namespace Halide {
+
+struct Target;
+
+namespace Internal {
+
+/** Build a Module with a function fn_name that runs one of several
+ * variants of a pipeline. build_variant(name, scale) must return a
+ * Module containing the variant autoscheduled with its estimates scaled
+ * by scale, as a function with internal linkage called name. Each call
+ * is put in the bucket of the variant whose estimated output size is
+ * closest to the actual size of the first output, and the variant run
+ * is chosen by halide_choose_size_variant(), which learns the fastest
+ * variant for each bucket from the times reported to
+ * halide_report_size_variant_time(). */
+Module build_size_variants_module(const std::string &fn_name, const Target &target,
+                                  const std::vector<float> &scales,
+                                  const std::function<Module(const std::string &, float)> &build_variant);
+
+}  // namespace Internal
+}  // namespace Halide
+
+#endif
@@ -408,6 +408,82 @@ protected:
         }
     }
 
+    // The values of the liftable lets that enclose the node being mutated,
+    // outermost first.
+    std::vector<std::pair<std::string, Expr>> enclosing_lets;
+
+    // Come up with an upper bound for the truth value of an expression over
+    // all iterations of a loop. Unlike relax_over_var, this makes use of the
+    // loop bounds, so that a condition that only varies at a coarser
+    // granularity than the loop (e.g. a per-tile mask, where the loop is
+    // over the pixels of a tile) stays exact.
+    Expr relax_over_loop(const Expr &e, const For *op) {
+        Expr cond = substitute_in_all_lets(e);
+        Expr min = op->min, extent = op->extent;
+        for (const auto &[var, value] : reverse_view(enclosing_lets)) {
+            if (expr_uses_var(cond, var)) {
+                cond = substitute(var, value, cond);
+            }
+            if (expr_uses_var(min, var) || expr_uses_var(extent, var)) {
+                min = substitute(var, value, min);
+                extent = substitute(var, value, extent);
+            }
+        }
+        Scope<Interval> domain;
+        domain.push(op->name, Interval(min, simplify(min + extent - 1)));
+
+        // Calls to Funcs that are at the same site on every iteration of
+        // the loop have the same value throughout it, unless the Func is
+        // being produced around the loop (any Func produced within the
+        // loop has already been relaxed away). Replace them with vars so
+        // that bounds inference doesn't lose them.
+        class ReplaceInvariantCalls : public IRMutator {
+            const std::string &loop_var;
+            const Scope<Interval> &domain;
+            const Scope<> &in_produce;
+
+            using IRMutator::visit;
+
+            Expr visit(const Call *op) override {
+                if ((op->call_type != Call::Halide && op->call_type != Call::Image) ||
+                    in_produce.contains(op->name)) {
+                    return IRMutator::visit(op);
+                }
+                std::vector<Expr> args;
+                for (const Expr &arg : op->args) {
+                    if (!expr_uses_var(arg, loop_var)) {
+                        args.push_back(arg);
+                        continue;
+                    }
+                    Interval in = bounds_of_expr_in_scope(arg, domain);
+                    if (!in.is_bounded() || !equal(simplify(in.min), simplify(in.max))) {
+                        return IRMutator::visit(op);
+                    }
+                    args.push_back(simplify(in.min));
+                }
+                std::string name = unique_name('t');
+                replacements[name] = Call::make(op->type, op->name, args, op->call_type,
+                                                op->func, op->value_index, op->image, op->param);
+                return Variable::make(op->type, name);
+            }
+
+        public:
+            std::map<std::string, Expr> replacements;
+
+            ReplaceInvariantCalls(const std::string &loop_var, const Scope<Interval> &domain,
+                                  const Scope<> &in_produce)
+                : loop_var(loop_var), domain(domain), in_produce(in_produce) {
+            }
+        } replacer(op->name, domain, in_produce);
+
+        Interval in = bounds_of_expr_in_scope(replacer.mutate(cond), domain);
+        if (!in.has_upper_bound()) {
+            return const_true();
+        } else {
+            return simplify(substitute(replacer.replacements, in.max));
+        }
+    }
+
     // Come up with an upper bound for the truth value of an expression with any
     // calls to the given func eliminated.
     Expr relax_over_calls(const Expr &e, const std::string &func) {
@@ -501,9 +577,16 @@ protected:
         if (op) {
             std::map<size_t, FuncInfo> old;
             old.swap(func_info);
+            const bool liftable = may_lift(op->value);
+            if (liftable) {
+                enclosing_lets.emplace_back(op->name, op->value);
+            }
             body = mutate(op->body);
+            if (liftable) {
+                enclosing_lets.pop_back();
+            }
             internal_assert(body.defined());
-            if (may_lift(op->value)) {
+            if (liftable) {
                 for (auto &it : func_info) {
                     if (expr_uses_var(it.second.used, op->name)) {
                         it.second.used = Let::make(op->name, op->value, it.second.used);
@@ -584,10 +667,13 @@ protected:
 
     Scope<> in_realize;
     Scope<> in_realize_and_produce_or_consume;
+    // The Funcs with an enclosing produce node.
+    Scope<> in_produce;
 
     Stmt visit(const ProducerConsumer *op) override {
         size_t id = analysis.func_id.at(op->name);
         const bool unconditionally_used = analysis.unconditionally_used_funcs.count(id);
+        ScopedBinding<> bind_produce(op->is_producer, in_produce, op->name);
 
         if (op->is_producer && !unconditionally_used) {
             // The body of this is conditional, based on a yet-to-be defined symbolic value.
@@ -695,11 +781,11 @@ protected:
         bool anything_depended_on_loop_var = false;
         for (auto &p : func_info) {
             if (expr_uses_var(p.second.used, op->name)) {
-                p.second.used = relax_over_var(p.second.used, op->name);
+                p.second.used = relax_over_loop(p.second.used, op);
                 anything_depended_on_loop_var = true;
             }
             if (expr_uses_var(p.second.loaded, op->name)) {
-                p.second.loaded = relax_over_var(p.second.loaded, op->name);
+                p.second.loaded = relax_over_loop(p.second.loaded, op);
                 anything_depended_on_loop_var = true;
             }
         }
@@ -20,7 +20,11 @@ class Function;
  * to check that tells us they won't be used. Does this by analyzing
  * all reads of each buffer allocated, and inferring some condition
  * that tells us if the reads occur. If the condition is non-trivial,
- * inject ifs that guard the production. */
+ * inject ifs that guard the production. Conditions are relaxed over
+ * each loop using its bounds, so a producer computed per tile of its
+ * consumer can be skipped on the tiles where a condition that is
+ * constant over the tile (e.g. a lookup into a per-tile mask) is
+ * false. */
 Stmt skip_stages(const Stmt &s,
                  const std::vector<Function> &outputs,
                  const std::vector<std::vector<std::string>> &order,
@@ -905,6 +905,178 @@ public:
     }
 };
 
+// Find the parallel loop that a Func stored outside of it must be
+// realized in for the Func to slide over it, if there is one: the Func's
+// compute_at loop, if it is a parallel loop on the host that contains all
+// of the uses of the Func.
+class FindParallelLoopToSplit : public IRVisitor {
+    using IRVisitor::visit;
+
+    const Function &func;
+    const For *current = nullptr;
+
+    void use() {
+        if (!current || (result && result != current)) {
+            used_elsewhere = true;
+        } else {
+            result = current;
+        }
+    }
+
+    void visit(const For *op) override {
+        if (current || op->for_type != ForType::Parallel ||
+            (op->device_api != DeviceAPI::None && op->device_api != DeviceAPI::Host) ||
+            !func.schedule().compute_level().match(op->name)) {
+            IRVisitor::visit(op);
+            return;
+        }
+        ScopedValue<const For *> old_current(current, op);
+        IRVisitor::visit(op);
+    }
+
+    void visit(const ProducerConsumer *op) override {
+        if (op->name == func.name()) {
+            use();
+        }
+        IRVisitor::visit(op);
+    }
+
+    void visit(const Call *op) override {
+        if (op->call_type == Call::Halide && op->name == func.name()) {
+            use();
+        }
+        IRVisitor::visit(op);
+    }
+
+    void visit(const Provide *op) override {
+        if (op->name == func.name()) {
+            use();
+        }
+        IRVisitor::visit(op);
+    }
+
+public:
+    const For *result = nullptr;
+    bool used_elsewhere = false;
+
+    FindParallelLoopToSplit(const Function &func)
+        : func(func) {
+    }
+};
+
+// Sliding window doesn't apply to parallel loops, because each iteration
+// would depend on the previous one. To get both the parallelism and the
+// reuse, split parallel loops that a Func stored outside of them is
+// computed at into one strip per thread. Each strip is a parallel
+// iteration that realizes its own copy of the Func and has a serial loop
+// over the iterations of the strip, which sliding window can then slide
+// over, warming up at the start of each strip.
+class SplitParallelLoopsForSliding : public IRMutator {
+    using IRMutator::visit;
+
+    const map<string, Function> &env;
+
+    // The realizations to move into each loop to split, from outermost to
+    // innermost. Their bounds are replaced by lets from their original
+    // location, so they can't refer to anything else in between.
+    map<const For *, vector<const Realize *>> realizations;
+
+    bool can_split_for(const Function &f, const Realize *op) {
+        const FuncSchedule &sched = f.schedule();
+        if (sched.compute_level() == sched.store_level() ||
+            sched.hoist_storage_level() != sched.store_level() ||
+            sched.async() || sched.ring_buffer().defined() || sched.memoized() ||
+            !is_const_one(op->condition)) {
+            return false;
+        }
+        for (const StorageDim &d : sched.storage_dims()) {
+            if (d.fold_factor.defined()) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    static string bound_name(const string &func, size_t i, const char *suffix) {
+        return func + ".strip_realize." + std::to_string(i) + suffix;
+    }
+
+    Stmt visit(const Realize *op) override {
+        auto iter = env.find(op->name);
+        if (iter == env.end() || !can_split_for(iter->second, op)) {
+            return IRMutator::visit(op);
+        }
+
+        FindParallelLoopToSplit finder(iter->second);
+        op->body.accept(&finder);
+        if (!finder.result || finder.used_elsewhere) {
+            return IRMutator::visit(op);
+        }
+
+        debug(3) << "Splitting parallel loop " << finder.result->name
+                 << " into strips to slide " << op->name << " over it\n";
+        realizations[finder.result].push_back(op);
+        Stmt body = mutate(op->body);
+        for (size_t i = op->bounds.size(); i > 0; i--) {
+            body = LetStmt::make(bound_name(op->name, i - 1, ".extent"), op->bounds[i - 1].extent, body);
+            body = LetStmt::make(bound_name(op->name, i - 1, ".min"), op->bounds[i - 1].min, body);
+        }
+        return body;
+    }
+
+    Stmt visit(const For *op) override {
+        auto iter = realizations.find(op);
+        if (iter == realizations.end()) {
+            return IRMutator::visit(op);
+        }
+        const vector<const Realize *> &to_realize = iter->second;
+
+        Stmt body = mutate(op->body);
+        body = For::make(op->name, Variable::make(Int(32), op->name + ".loop_min"),
+                         Variable::make(Int(32), op->name + ".loop_extent"),
+                         ForType::Serial, op->partition_policy, op->device_api, body);
+        for (size_t i = to_realize.size(); i > 0; i--) {
+            const Realize *r = to_realize[i - 1];
+            Region bounds;
+            for (size_t j = 0; j < r->bounds.size(); j++) {
+                bounds.emplace_back(Variable::make(Int(32), bound_name(r->name, j, ".min")),
+                                    Variable::make(Int(32), bound_name(r->name, j, ".extent")));
+            }
+            body = Realize::make(r->name, r->types, r->memory_type, bounds, r->condition, body);
+        }
+
+        // Give each thread one strip of the loop, and make every strip
+        // non-empty. The bounds of the serial loop over each strip shadow
+        // the bounds of the whole loop, which op's bounds may refer to.
+        const string strip_name = op->name + ".strip";
+        Expr strip = Variable::make(Int(32), strip_name);
+        Expr strip_size = Variable::make(Int(32), strip_name + ".size");
+        Expr whole_min = Variable::make(Int(32), strip_name + ".whole_min");
+        Expr whole_extent = Variable::make(Int(32), strip_name + ".whole_extent");
+        Expr loop_min = Variable::make(Int(32), op->name + ".loop_min");
+        Expr loop_extent = Variable::make(Int(32), op->name + ".loop_extent");
+        Expr threads = Call::make(Int(32), "halide_get_num_threads", {}, Call::Extern);
+        Expr strips = max(1, min(whole_extent, threads));
+
+        body = LetStmt::make(op->name + ".loop_max", loop_min + loop_extent - 1, body);
+        body = LetStmt::make(op->name + ".loop_extent", min(strip_size, whole_min + whole_extent - loop_min), body);
+        body = LetStmt::make(op->name + ".loop_min", whole_min + strip * strip_size, body);
+        Expr strip_count = Variable::make(Int(32), strip_name + ".loop_extent");
+        Stmt result = For::make(strip_name, 0, strip_count, ForType::Parallel, op->partition_policy, op->device_api, body);
+        result = LetStmt::make(strip_name + ".loop_max", strip_count - 1, result);
+        result = LetStmt::make(strip_name + ".loop_min", 0, result);
+        result = LetStmt::make(strip_name + ".loop_extent", (whole_extent + strip_size - 1) / strip_size, result);
+        result = LetStmt::make(strip_name + ".size", max(1, (whole_extent + strips - 1) / strips), result);
+        result = LetStmt::make(strip_name + ".whole_extent", op->extent, result);
+        return LetStmt::make(strip_name + ".whole_min", op->min, result);
+    }
+
+public:
+    SplitParallelLoopsForSliding(const map<string, Function> &env)
+        : env(env) {
+    }
+};
+
 // It is convenient to be able to assume that loops have a .loop_min.orig
 // let in addition to .loop_min. Most of these will get simplified away.
 class AddLoopMinOrig : public IRMutator {
@@ -928,7 +1100,8 @@ class AddLoopMinOrig : public IRMutator {
 }  // namespace
 
 Stmt sliding_window(const Stmt &s, const map<string, Function> &env) {
-    return SlidingWindow(env).mutate(AddLoopMinOrig().mutate(s));
+    Stmt result = SplitParallelLoopsForSliding(env).mutate(s);
+    return SlidingWindow(env).mutate(AddLoopMinOrig().mutate(result));
 }
 
 }  // namespace Internal
@@ -20,6 +20,9 @@ class Function;
 /** Perform sliding window optimizations on a halide
  * statement. I.e. don't bother computing points in a function that
  * have provably already been computed by a previous iteration.
+ * Parallel loops that a Func stored outside of them is computed at are
+ * first split into one strip per thread, each with its own storage for
+ * the Func, so that it can slide over the serial loop within each strip.
  */
 Stmt sliding_window(const Stmt &s, const std::map<std::string, Function> &env);
 
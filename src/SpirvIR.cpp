@@ -1,6 +1,7 @@
 #include "SpirvIR.h"
 #include <iostream>
 #include <type_traits>
+#include <unordered_set>
 
 #ifdef WITH_SPIRV
 
@@ -170,6 +171,12 @@ void SpvInstruction::set_op_code(SpvOp op_code) {
     contents->op_code = op_code;
 }
 
+void SpvInstruction::set_operand(uint32_t index, SpvId id) {
+    check_defined();
+    internal_assert(index < contents->operands.size() && !is_immediate(index));
+    contents->operands[index] = id;
+}
+
 void SpvInstruction::add_operand(SpvId id) {
     check_defined();
     contents->operands.push_back(id);
@@ -366,6 +373,16 @@ void SpvBlock::add_variable(SpvInstruction var) {
     contents->variables.emplace_back(std::move(var));
 }
 
+void SpvBlock::set_instructions(Instructions insts) {
+    check_defined();
+    contents->instructions = std::move(insts);
+}
+
+void SpvBlock::set_variables(Variables vars) {
+    check_defined();
+    contents->variables = std::move(vars);
+}
+
 const SpvBlock::Instructions &SpvBlock::instructions() const {
     check_defined();
     return contents->instructions;
@@ -893,6 +910,332 @@ void SpvModule::check_defined() const {
     user_assert(is_defined()) << "An SpvModule must be defined before accessing its properties\n";
 }
 
+namespace {
+
+// Call f on each id an instruction refers to, including its type.
+template<typename Fn>
+void for_each_id_used(const SpvInstruction &inst, Fn f) {
+    if (inst.has_type()) {
+        f(inst.type_id());
+    }
+    for (uint32_t i = 0; i < inst.length(); i++) {
+        if (!inst.is_immediate(i)) {
+            f(inst.operand(i));
+        }
+    }
+}
+
+bool is_volatile_load(const SpvInstruction &inst) {
+    // The optional memory access mask follows the pointer
+    return (inst.op_code() == SpvOpLoad) && (inst.length() > 1) && inst.is_immediate(1) &&
+           (inst.operand(1) & SpvMemoryAccessVolatileMask);
+}
+
+// Instructions that only compute their result, and may be removed if
+// nothing uses it.
+bool is_pure(const SpvInstruction &inst) {
+    switch (inst.op_code()) {
+    case SpvOpLoad:
+        return !is_volatile_load(inst);
+    case SpvOpUndef:
+    case SpvOpCopyObject:
+    case SpvOpAccessChain:
+    case SpvOpInBoundsAccessChain:
+    case SpvOpPtrAccessChain:
+    case SpvOpVectorExtractDynamic:
+    case SpvOpVectorInsertDynamic:
+    case SpvOpVectorShuffle:
+    case SpvOpCompositeConstruct:
+    case SpvOpCompositeExtract:
+    case SpvOpCompositeInsert:
+    case SpvOpConvertFToU:
+    case SpvOpConvertFToS:
+    case SpvOpConvertSToF:
+    case SpvOpConvertUToF:
+    case SpvOpUConvert:
+    case SpvOpSConvert:
+    case SpvOpFConvert:
+    case SpvOpBitcast:
+    case SpvOpSNegate:
+    case SpvOpFNegate:
+    case SpvOpIAdd:
+    case SpvOpFAdd:
+    case SpvOpISub:
+    case SpvOpFSub:
+    case SpvOpIMul:
+    case SpvOpFMul:
+    case SpvOpUDiv:
+    case SpvOpSDiv:
+    case SpvOpFDiv:
+    case SpvOpUMod:
+    case SpvOpSRem:
+    case SpvOpSMod:
+    case SpvOpFRem:
+    case SpvOpFMod:
+    case SpvOpVectorTimesScalar:
+    case SpvOpDot:
+    case SpvOpIsNan:
+    case SpvOpIsInf:
+    case SpvOpLogicalEqual:
+    case SpvOpLogicalNotEqual:
+    case SpvOpLogicalOr:
+    case SpvOpLogicalAnd:
+    case SpvOpLogicalNot:
+    case SpvOpSelect:
+    case SpvOpIEqual:
+    case SpvOpINotEqual:
+    case SpvOpUGreaterThan:
+    case SpvOpSGreaterThan:
+    case SpvOpUGreaterThanEqual:
+    case SpvOpSGreaterThanEqual:
+    case SpvOpULessThan:
+    case SpvOpSLessThan:
+    case SpvOpULessThanEqual:
+    case SpvOpSLessThanEqual:
+    case SpvOpFOrdEqual:
+    case SpvOpFUnordEqual:
+    case SpvOpFOrdNotEqual:
+    case SpvOpFUnordNotEqual:
+    case SpvOpFOrdLessThan:
+    case SpvOpFUnordLessThan:
+    case SpvOpFOrdGreaterThan:
+    case SpvOpFUnordGreaterThan:
+    case SpvOpFOrdLessThanEqual:
+    case SpvOpFUnordLessThanEqual:
+    case SpvOpFOrdGreaterThanEqual:
+    case SpvOpFUnordGreaterThanEqual:
+    case SpvOpShiftRightLogical:
+    case SpvOpShiftRightArithmetic:
+    case SpvOpShiftLeftLogical:
+    case SpvOpBitwiseOr:
+    case SpvOpBitwiseXor:
+    case SpvOpBitwiseAnd:
+    case SpvOpNot:
+    case SpvOpBitCount:
+    case SpvOpPhi:
+    // The only extended instruction set we import is GLSL.std.450,
+    // which is all math
+    case SpvOpExtInst:
+        return true;
+    default:
+        return false;
+    }
+}
+
+void optimize_function(SpvFunction &func) {
+    const SpvFunction::Blocks &blocks = func.blocks();
+
+    // Find the function variables that are only loaded from and stored
+    // to directly, so that we know every access to them.
+    std::unordered_set<SpvId> simple_vars;
+    for (const SpvBlock &block : blocks) {
+        for (const SpvInstruction &var : block.variables()) {
+            simple_vars.insert(var.result_id());
+        }
+    }
+    for (const SpvBlock &block : blocks) {
+        for (const SpvInstruction &inst : block.instructions()) {
+            for (uint32_t i = 0; i < inst.length(); i++) {
+                bool direct = (i == 0) && ((inst.op_code() == SpvOpStore) ||
+                                           (inst.op_code() == SpvOpLoad && !is_volatile_load(inst)));
+                if (!direct && !inst.is_immediate(i)) {
+                    simple_vars.erase(inst.operand(i));
+                }
+            }
+        }
+    }
+
+    // Within each block, forward the last value stored to or loaded
+    // from a variable to the loads of it that follow.
+    std::unordered_map<SpvId, SpvId> renamed;
+    std::unordered_set<SpvId> loaded;
+    for (SpvBlock block : blocks) {
+        std::unordered_map<SpvId, SpvId> known;
+        SpvBlock::Instructions kept;
+        for (const SpvInstruction &inst : block.instructions()) {
+            if (inst.op_code() == SpvOpLoad && simple_vars.count(inst.operand(0))) {
+                auto it = known.find(inst.operand(0));
+                if (it != known.end()) {
+                    renamed[inst.result_id()] = it->second;
+                    continue;
+                }
+                known[inst.operand(0)] = inst.result_id();
+                loaded.insert(inst.operand(0));
+            } else if (inst.op_code() == SpvOpStore && simple_vars.count(inst.operand(0))) {
+                known[inst.operand(0)] = inst.operand(1);
+            }
+            kept.push_back(inst);
+        }
+        block.set_instructions(std::move(kept));
+    }
+
+    // Drop the stores to variables that are never loaded
+    for (SpvBlock block : blocks) {
+        SpvBlock::Instructions kept;
+        for (const SpvInstruction &inst : block.instructions()) {
+            if (inst.op_code() == SpvOpStore && simple_vars.count(inst.operand(0)) &&
+                !loaded.count(inst.operand(0))) {
+                continue;
+            }
+            kept.push_back(inst);
+        }
+        block.set_instructions(std::move(kept));
+    }
+
+    // Rewrite the uses of the forwarded loads. A value may itself have
+    // been forwarded, so follow the chain to its end.
+    auto resolve = [&](SpvId id) {
+        auto it = renamed.find(id);
+        while (it != renamed.end()) {
+            id = it->second;
+            it = renamed.find(id);
+        }
+        return id;
+    };
+    if (!renamed.empty()) {
+        for (const SpvBlock &block : blocks) {
+            for (SpvInstruction inst : block.instructions()) {
+                for (uint32_t i = 0; i < inst.length(); i++) {
+                    if (!inst.is_immediate(i)) {
+                        SpvId id = resolve(inst.operand(i));
+                        if (id != inst.operand(i)) {
+                            inst.set_operand(i, id);
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    // Remove the pure instructions and variables whose results are
+    // unused, until there are none left.
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        std::unordered_set<SpvId> used;
+        auto mark = [&](SpvId id) { used.insert(id); };
+        for (const SpvBlock &block : blocks) {
+            for (const SpvInstruction &var : block.variables()) {
+                for_each_id_used(var, mark);
+            }
+            for (const SpvInstruction &inst : block.instructions()) {
+                for_each_id_used(inst, mark);
+            }
+        }
+        for (SpvBlock block : blocks) {
+            SpvBlock::Instructions kept;
+            for (const SpvInstruction &inst : block.instructions()) {
+                if (inst.has_result() && !used.count(inst.result_id()) && is_pure(inst)) {
+                    changed = true;
+                    continue;
+                }
+                kept.push_back(inst);
+            }
+            block.set_instructions(std::move(kept));
+
+            SpvBlock::Variables kept_vars;
+            for (const SpvInstruction &var : block.variables()) {
+                if (!used.count(var.result_id())) {
+                    changed = true;
+                    continue;
+                }
+                kept_vars.push_back(var);
+            }
+            block.set_variables(std::move(kept_vars));
+        }
+    }
+}
+
+// Keep the instructions in a module section that satisfy the predicate
+template<typename Fn>
+void filter_instructions(SpvModuleContents::Instructions &insts, Fn keep) {
+    SpvModuleContents::Instructions kept;
+    kept.reserve(insts.size());
+    for (const SpvInstruction &inst : insts) {
+        if (keep(inst)) {
+            kept.push_back(inst);
+        }
+    }
+    insts = std::move(kept);
+}
+
+}  // namespace
+
+void SpvModule::optimize() {
+    check_defined();
+
+    for (SpvFunction &func : contents->functions) {
+        optimize_function(func);
+    }
+
+    // Everything reachable from the entry points and the code is live
+    std::unordered_set<SpvId> live;
+    auto mark = [&](const SpvInstruction &inst) {
+        if (inst.has_result()) {
+            live.insert(inst.result_id());
+        }
+        for_each_id_used(inst, [&](SpvId id) { live.insert(id); });
+    };
+    for (const SpvModuleContents::EntryPoints::value_type &v : contents->entry_points) {
+        mark(v.second);
+    }
+    for (const SpvInstruction &inst : contents->execution_modes) {
+        mark(inst);
+    }
+    for (const SpvInstruction &inst : contents->instructions) {
+        mark(inst);
+    }
+    for (const SpvFunction &func : contents->functions) {
+        mark(func.declaration());
+        for (const SpvInstruction &param : func.parameters()) {
+            mark(param);
+        }
+        for (const SpvBlock &block : func.blocks()) {
+            live.insert(block.id());
+            for (const SpvInstruction &var : block.variables()) {
+                mark(var);
+            }
+            for (const SpvInstruction &inst : block.instructions()) {
+                mark(inst);
+            }
+        }
+    }
+
+    // ... as are the declarations the live declarations refer to
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (const SpvModuleContents::Instructions *section : {&contents->types, &contents->constants, &contents->globals}) {
+            for (const SpvInstruction &inst : *section) {
+                if (live.count(inst.result_id())) {
+                    for_each_id_used(inst, [&](SpvId id) {
+                        changed |= live.insert(id).second;
+                    });
+                }
+            }
+        }
+    }
+
+    size_t before = contents->types.size() + contents->constants.size() + contents->globals.size();
+    auto is_live = [&](const SpvInstruction &inst) { return live.count(inst.result_id()) > 0; };
+    filter_instructions(contents->types, is_live);
+    filter_instructions(contents->constants, is_live);
+    filter_instructions(contents->globals, is_live);
+
+    // Names are keyed by the id they name, and decorations target
+    // their first operand
+    filter_instructions(contents->debug_symbols, [&](const SpvInstruction &inst) {
+        return !inst.has_result() || live.count(inst.result_id()) > 0;
+    });
+    filter_instructions(contents->annotations, [&](const SpvInstruction &inst) {
+        return inst.length() == 0 || inst.is_immediate(0) || live.count(inst.operand(0)) > 0;
+    });
+
+    debug(2) << "    SpvModule::optimize removed "
+             << (before - contents->types.size() - contents->constants.size() - contents->globals.size())
+             << " unused declarations\n";
+}
+
 void SpvModule::encode(SpvBinary &binary) const {
     check_defined();
 
@@ -2869,6 +3212,14 @@ SpvInstruction SpvFactory::extended(SpvId instruction_set_id, SpvId instruction_
     return inst;
 }
 
+SpvInstruction SpvFactory::group_non_uniform_shuffle(SpvOp op_code, SpvId type_id, SpvId result_id, SpvId execution_scope_id, SpvId value_id, SpvId lane_id) {
+    SpvInstruction inst = SpvInstruction::make(op_code);
+    inst.set_type_id(type_id);
+    inst.set_result_id(result_id);
+    inst.add_operands({execution_scope_id, value_id, lane_id});
+    return inst;
+}
+
 /** GLSL extended instruction utility methods */
 
 bool is_glsl_unary_op(SpvId glsl_op_code) {
@@ -3960,6 +4311,21 @@ void spirv_ir_test() {
     builder.append(SpvFactory::store(output_id, converted_value_id));
     builder.leave_function();
 
+    // Types nothing refers to are removed by the optimizer
+    SpvId unused_type_id = builder.declare_type(Type(Type::Int, 32, 4));
+    builder.finalize();
+    builder.current_module().optimize();
+    auto is_declared = [&](SpvId type_id) {
+        for (const SpvInstruction &inst : builder.current_module().type_definitions()) {
+            if (inst.result_id() == type_id) {
+                return true;
+            }
+        }
+        return false;
+    };
+    assert(!is_declared(unused_type_id));
+    assert(is_declared(uint_type_id));
+
     binary.clear();
     builder.encode(binary);
 
@@ -149,6 +149,7 @@ public:
     void set_op_code(SpvOp opcode);
     void add_operand(SpvId id);
     void add_operands(const Operands &operands);
+    void set_operand(uint32_t index, SpvId id);
     void add_immediate(SpvId id, SpvValueType type);
     void add_immediates(const Immediates &Immediates);
     void add_data(uint32_t bytes, const void *data, SpvValueType type);
@@ -198,6 +199,8 @@ public:
 
     void add_instruction(SpvInstruction inst);
     void add_variable(SpvInstruction var);
+    void set_instructions(Instructions insts);
+    void set_variables(Variables vars);
     const Instructions &instructions() const;
     const Variables &variables() const;
     bool is_reachable() const;
@@ -300,6 +303,17 @@ public:
     void set_memory_model(SpvMemoryModel val);
     void set_binding_count(SpvId count);
 
+    /** Run the built-in optimization passes over the module, once it
+     * is complete. Within each block, loads of function variables that
+     * are only loaded and stored are replaced by the last value stored
+     * or loaded, and stores to variables that are never loaded are
+     * removed. Then instructions without side effects whose results
+     * are unused are removed, and finally the types, constants and
+     * global variables that nothing live refers to, with their names
+     * and decorations. This makes the binary smaller, and less work
+     * for the driver's compiler when a pipeline is created. */
+    void optimize();
+
     uint32_t version_format() const;
     SpvSourceLanguage source_language() const;
     SpvAddressingModel addressing_model() const;
@@ -711,6 +725,7 @@ struct SpvFactory {
     static SpvInstruction binary_op(SpvOp op_code, SpvId type_id, SpvId result_id, SpvId src_a_id, SpvId src_b_id);
     static SpvInstruction convert(SpvOp op_code, SpvId type_id, SpvId result_id, SpvId src_id);
     static SpvInstruction extended(SpvId instruction_set_id, SpvId instruction_number, SpvId type_id, SpvId result_id, const SpvFactory::Operands &operands);
+    static SpvInstruction group_non_uniform_shuffle(SpvOp op_code, SpvId type_id, SpvId result_id, SpvId execution_scope_id, SpvId value_id, SpvId lane_id);  // only avail in 1.3
 };
 
 /** Contents of a SPIR-V Instruction */
@@ -13,6 +13,49 @@ namespace Internal {
 
 namespace {
 
+// Does the target have gather instructions that beat loading each lane
+// separately?
+bool has_fast_gathers(const Target &t, const Type &type) {
+    if (t.has_feature(Target::SVE2)) {
+        return true;
+    }
+    if (t.arch != Target::X86 || !t.has_feature(Target::AVX2) || type.bits() < 32) {
+        return false;
+    }
+    // Intel cores between Broadwell and Tiger Lake have a microcode
+    // mitigation that makes gathers very slow.
+    switch (t.processor_tune) {
+    case Target::Processor::ZnVer1:
+    case Target::Processor::ZnVer2:
+    case Target::Processor::ZnVer3:
+    case Target::Processor::ZnVer4:
+        return true;
+    default:
+        return t.has_feature(Target::AVX512_Zen4);
+    }
+}
+
+// Is a strided load cheaper as a dense load of the whole span followed by a
+// shuffle than as a gather? Strides smaller than the vector width always
+// are. Beyond that, the dense load has to touch more than one element per
+// lane, so it only wins when the whole span is a handful of native vectors,
+// e.g. a narrow vector of bytes with a large stride.
+bool should_stage(const Target &t, const Type &type, int64_t stride, int lanes) {
+    if (stride < 2) {
+        return false;
+    } else if (stride < lanes) {
+        return true;
+    }
+    const int64_t vector_bytes = t.natural_vector_size(UInt(8));
+    const int64_t dense_vectors = (stride * lanes * type.bytes() + vector_bytes - 1) / vector_bytes;
+    // Each dense vector costs a load and at least one shuffle. A software
+    // gather is a scalar load and an insert per lane. A hardware gather is
+    // cheaper, but still issues one load per lane.
+    const int64_t dense_cost = 2 * dense_vectors;
+    const int64_t gather_cost = has_fast_gathers(t, type) ? lanes : 2 * lanes;
+    return dense_cost < gather_cost;
+}
+
 class FindStridedLoads : public IRVisitor {
 public:
     struct Key {
@@ -78,6 +121,16 @@ public:
 
     std::map<const IRNode *, const IRNode *> parent_scope;
 
+    const Target &target;
+
+    // Offloaded device code has different vector costs, so only the
+    // long-standing stride < lanes rule applies there.
+    bool in_device_code = false;
+
+    FindStridedLoads(const Target &target)
+        : target(target) {
+    }
+
 protected:
     void visit(const Load *op) override {
         if (is_const_one(op->predicate)) {
@@ -100,7 +153,10 @@ protected:
                 // TODO: We do not yet handle nested vectorization here for
                 // ramps which have not already collapsed. We could potentially
                 // handle more interesting types of shuffle than simple flat slices.
-                if (stride >= 2 && stride < r->lanes && r->stride.type().is_scalar()) {
+                const bool profitable = in_device_code ?
+                                            (stride >= 2 && stride < r->lanes) :
+                                            should_stage(target, op->type, stride, r->lanes);
+                if (profitable && r->stride.type().is_scalar()) {
                     const IRNode *s = scope;
                     const Allocate *a = nullptr;
                     if (const Allocate *const *a_ptr = allocation_scope.find(op->name)) {
@@ -114,6 +170,10 @@ protected:
     }
 
     void visit(const For *op) override {
+        ScopedValue<bool> bind_device(in_device_code,
+                                      in_device_code ||
+                                          (op->device_api != DeviceAPI::None &&
+                                           op->device_api != DeviceAPI::Host));
         if (can_prove(op->extent > 0)) {
             // The loop body definitely runs
             IRVisitor::visit(op);
@@ -193,8 +253,8 @@ protected:
 
 }  // namespace
 
-Stmt stage_strided_loads(const Stmt &s) {
-    FindStridedLoads finder;
+Stmt stage_strided_loads(const Stmt &s, const Target &t) {
+    FindStridedLoads finder(t);
     ReplaceStridedLoads replacer;
 
     // Find related clusters of strided loads anywhere in the stmt. While this
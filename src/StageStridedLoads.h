@@ -8,6 +8,7 @@
  */
 
 #include "Expr.h"
+#include "Target.h"
 
 namespace Halide {
 namespace Internal {
@@ -36,8 +37,12 @@ namespace Internal {
  * half-sized dense loads and shuffles out the desired lanes, and for loads from
  * internal allocations it adds padding to the allocation explicitly, by setting
  * the padding field on Allocate nodes.
+ *
+ * Strides smaller than the vector width are always staged. Larger strides
+ * are staged only if the target's cost of a dense load plus shuffle over the
+ * whole span beats a gather (hardware or one lane at a time).
  */
-Stmt stage_strided_loads(const Stmt &s);
+Stmt stage_strided_loads(const Stmt &s, const Target &t);
 
 }  // namespace Internal
 }  // namespace Halide
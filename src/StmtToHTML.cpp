@@ -9,8 +9,10 @@
 #include "Substitute.h"
 #include "Util.h"
 
+#include <algorithm>
 #include <cstdio>
 #include <fstream>
+#include <iomanip>
 #include <iostream>
 #include <iterator>
 #include <regex>
@@ -38,6 +40,7 @@ extern "C" unsigned char halide_html_template_StmtToHTML_js[];
 // Classes defined within this file
 class CostModel;
 class AssemblyInfo;
+class ProfileInfo;
 template<typename T>
 class HTMLCodePrinter;
 class PipelineHTMLInspector;
@@ -527,6 +530,191 @@ private:
     }
 };
 
+/** ProfileInfo
+ * Measured runtime data for each Func, loaded from the output of
+ * halide_profiler_report, or from a trace written by the profiler's
+ * timeline mode, so that it can be shown next to the produce node of
+ * the Func.
+ */
+class ProfileInfo {
+public:
+    struct FuncProfile {
+        // Per run for a report. For a timeline, the total over the trace.
+        double time_ms = 0;
+        // Negative if not known
+        double percent = -1;
+        double threads = -1;
+        int64_t heap_peak = 0, heap_allocs = 0, heap_avg = 0, stack_peak = 0;
+    };
+
+    void load(const std::string &filename) {
+        std::ifstream file(filename);
+        user_assert(file) << "Unable to open profile file: " << filename << "\n";
+        std::string text{std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+        size_t first = text.find_first_not_of(" \t\r\n");
+        if (first != std::string::npos && text[first] == '{') {
+            load_timeline(text);
+        } else {
+            load_report(text);
+        }
+        debug(1) << "Loaded profile data for " << funcs.size() << " Funcs from " << filename << "\n";
+    }
+
+    const FuncProfile *find(const std::string &name) const {
+        auto it = funcs.find(name);
+        return it == funcs.end() ? nullptr : &it->second;
+    }
+
+    bool empty() const {
+        return funcs.empty();
+    }
+
+private:
+    std::map<std::string, FuncProfile> funcs;
+
+    // Parse the per-Func lines of halide_profiler_report, e.g.
+    //     blur_x:    1.234ms   (45.6%)   threads: 7.9  peak: 1024  num: 16  avg: 512 stack: 64
+    void load_report(const std::string &text) {
+        static const std::regex color_code("\x1b\\[[0-9;]*m");
+        static const std::regex func_line(R"(^\s+(.+?):\s+([0-9.]+)ms\s+\(\s*([0-9.]+)%\)(.*)$)");
+        static const std::regex threads(R"(threads: ([0-9.]+))");
+        static const std::regex peak(R"(peak: ([0-9]+))");
+        static const std::regex num(R"(num: ([0-9]+))");
+        static const std::regex avg(R"(avg: ([0-9]+))");
+        static const std::regex stack(R"(stack: ([0-9]+))");
+
+        std::istringstream lines(text);
+        for (std::string line; std::getline(lines, line);) {
+            line = std::regex_replace(line, color_code, "");
+            std::smatch m;
+            if (!std::regex_match(line, m, func_line)) {
+                continue;
+            }
+            FuncProfile &f = funcs[m[1].str()];
+            f = FuncProfile();
+            f.time_ms = std::stod(m[2].str());
+            f.percent = std::stod(m[3].str());
+            const std::string rest = m[4].str();
+            std::smatch field;
+            if (std::regex_search(rest, field, threads)) {
+                f.threads = std::stod(field[1].str());
+            }
+            if (std::regex_search(rest, field, peak)) {
+                f.heap_peak = std::stoll(field[1].str());
+            }
+            if (std::regex_search(rest, field, num)) {
+                f.heap_allocs = std::stoll(field[1].str());
+            }
+            if (std::regex_search(rest, field, avg)) {
+                f.heap_avg = std::stoll(field[1].str());
+            }
+            if (std::regex_search(rest, field, stack)) {
+                f.stack_peak = std::stoll(field[1].str());
+            }
+        }
+    }
+
+    // Sum up the Func slices of a timeline trace. The number of threads
+    // is the total time in slices of the Func divided by the time during
+    // which at least one thread was in one.
+    void load_timeline(const std::string &text) {
+        static const std::regex func_slice(R"re(\{"name":"([^"]*)","cat":"func","ph":"X","ts":([0-9.]+),"dur":([0-9.]+))re");
+
+        std::map<std::string, std::vector<std::pair<double, double>>> slices;
+        for (auto it = std::sregex_iterator(text.begin(), text.end(), func_slice);
+             it != std::sregex_iterator(); ++it) {
+            double start = std::stod((*it)[2].str());
+            slices[(*it)[1].str()].emplace_back(start, start + std::stod((*it)[3].str()));
+        }
+
+        double total = 0;
+        for (auto &[name, intervals] : slices) {
+            std::sort(intervals.begin(), intervals.end());
+            double busy = 0, covered = 0, end = -1;
+            for (const auto &[lo, hi] : intervals) {
+                busy += hi - lo;
+                if (lo >= end) {
+                    covered += hi - lo;
+                    end = hi;
+                } else if (hi > end) {
+                    covered += hi - end;
+                    end = hi;
+                }
+            }
+            FuncProfile &f = funcs[name];
+            // Chrome traces are in microseconds.
+            f.time_ms = busy / 1000;
+            f.threads = covered > 0 ? busy / covered : 0;
+            total += busy;
+        }
+        for (auto &[name, f] : funcs) {
+            f.percent = total > 0 ? 100 * f.time_ms * 1000 / total : 0;
+        }
+    }
+};
+
+/** VectorCoverage
+ * Counts the operations of a produce node, other than those of the
+ * Funcs computed within it, to find how much of the arithmetic and
+ * memory traffic is vectorized, and how wide the vectors are.
+ */
+class VectorCoverage : public IRVisitor {
+public:
+    int64_t scalar_ops = 0, vector_ops = 0;
+    int widest = 1;
+
+    explicit VectorCoverage(const ProducerConsumer *op) {
+        op->body.accept(this);
+    }
+
+    // The fraction of element operations done in vectors
+    double fraction() const {
+        int64_t total = scalar_ops + vector_ops;
+        return total == 0 ? 0 : (double)vector_ops / total;
+    }
+
+private:
+    using IRVisitor::visit;
+
+    void count(Type t) {
+        if (t.is_vector()) {
+            vector_ops += t.lanes();
+            widest = std::max(widest, t.lanes());
+        } else {
+            scalar_ops++;
+        }
+    }
+
+#define HALIDE_COUNT_OP(T)             \
+    void visit(const T *op) override { \
+        count(op->type);               \
+        IRVisitor::visit(op);          \
+    }
+    HALIDE_COUNT_OP(Add)
+    HALIDE_COUNT_OP(Sub)
+    HALIDE_COUNT_OP(Mul)
+    HALIDE_COUNT_OP(Div)
+    HALIDE_COUNT_OP(Mod)
+    HALIDE_COUNT_OP(Min)
+    HALIDE_COUNT_OP(Max)
+    HALIDE_COUNT_OP(Cast)
+    HALIDE_COUNT_OP(Select)
+    HALIDE_COUNT_OP(Load)
+#undef HALIDE_COUNT_OP
+
+    void visit(const Store *op) override {
+        count(op->value.type());
+        IRVisitor::visit(op);
+    }
+
+    void visit(const ProducerConsumer *op) override {
+        // Funcs computed inside this one get their own numbers.
+        if (!op->is_producer) {
+            IRVisitor::visit(op);
+        }
+    }
+};
+
 /** GetAssemblyInfo
  * Used to map some Halide IR nodes to line-numbers in the
  * assembly file containing the corresponding generated code.
@@ -683,6 +871,10 @@ public:
         cost_model = std::move(cm);
     }
 
+    void init_profile_info(const ProfileInfo *p) {
+        profile_info = p;
+    }
+
     void print_conceptual_stmt(const Module &m, AssemblyInfo host_asm_info, AssemblyInfo device_asm_info) {
         host_assembly_info = std::move(host_asm_info);
         device_assembly_info = std::move(device_asm_info);
@@ -969,6 +1161,9 @@ private:
     // Handle to output file stream
     T &stream;
 
+    // Measured runtime data, if any was given
+    const ProfileInfo *profile_info = nullptr;
+
     // Used to generate unique ids
     int id = 0;
     std::map<const IRNode *, int> &node_ids;
@@ -1620,6 +1815,9 @@ private:
         print_html_element("span", "keyword", op->is_producer ? "produce " : "consume ");
         stream << variable(op->name, "");
         print_closing_tag("span");
+        if (op->is_producer) {
+            print_profile_stats(op);
+        }
 
         // Open code block to hold function body
         print_opening_brace();
@@ -1646,6 +1844,53 @@ private:
         scope.pop(op->name);
     }
 
+    // Show the measured time, threads and allocations of a Func next to
+    // its produce node, along with how much of its code is vectorized.
+    void print_profile_stats(const ProducerConsumer *op) {
+        if (!profile_info || profile_info->empty()) {
+            return;
+        }
+        const ProfileInfo::FuncProfile *f = profile_info->find(op->name);
+        VectorCoverage vectors(op);
+
+        std::ostringstream text, tooltip;
+        text << std::fixed << std::setprecision(3);
+        tooltip << std::fixed << std::setprecision(3);
+        if (f) {
+            text << f->time_ms << "ms";
+            tooltip << "Time: " << f->time_ms << "ms";
+            if (f->percent >= 0) {
+                text << " (" << std::setprecision(1) << f->percent << "%)" << std::setprecision(3);
+                tooltip << " (" << std::setprecision(1) << f->percent << "% of the pipeline)" << std::setprecision(3);
+            }
+            if (f->threads >= 0) {
+                text << " | " << std::setprecision(1) << f->threads << " threads" << std::setprecision(3);
+                tooltip << "&#10;Average threads: " << std::setprecision(1) << f->threads << std::setprecision(3);
+            }
+            if (f->heap_allocs > 0) {
+                text << " | heap peak " << f->heap_peak << "B";
+                tooltip << "&#10;Heap: peak " << f->heap_peak << " bytes, "
+                        << f->heap_allocs << " allocations of " << f->heap_avg << " bytes on average";
+            }
+            if (f->stack_peak > 0) {
+                text << " | stack " << f->stack_peak << "B";
+                tooltip << "&#10;Stack: peak " << f->stack_peak << " bytes";
+            }
+        } else {
+            text << "not in profile";
+            tooltip << "The profile has no data for " << op->name;
+        }
+        int percent = (int)(100 * vectors.fraction() + 0.5);
+        text << " | " << percent << "% vector";
+        tooltip << "&#10;" << percent << "% of the element operations in the code are vectorized";
+        if (vectors.widest > 1) {
+            text << " (" << vectors.widest << " lanes)";
+            tooltip << ", in vectors of up to " << vectors.widest << " lanes";
+        }
+        stream << " ";
+        print_html_element("span", "ProfileStats", escape_html(text.str()), tooltip.str());
+    }
+
     std::string ForType_to_string(ForType type) {
         std::ostringstream ss;
         ss << type;
@@ -2274,12 +2519,23 @@ public:
     explicit PipelineHTMLInspector(const std::string &html_output_filename,
                                    const Module &m,
                                    const std::string &assembly_input_filename,
+                                   const std::string &profile_input_filename,
                                    bool use_conceptual_stmt_ir)
         : use_conceptual_stmt_ir(use_conceptual_stmt_ir),
           html_code_printer(stream, node_ids, true) {
         // Open output file
         stream.open(html_output_filename.c_str());
 
+        // Load the runtime data to show, if there is any
+        std::string profile_file = profile_input_filename;
+        if (profile_file.empty()) {
+            profile_file = get_env_variable("HL_STMT_HTML_PROFILE");
+        }
+        if (!profile_file.empty()) {
+            profile_info.load(profile_file);
+            html_code_printer.init_profile_info(&profile_info);
+        }
+
         // Load assembly code -- if not explicit specified, assume it will have matching pathname
         // as our output file, with a different extension.
         if (assembly_input_filename.empty()) {
@@ -2349,6 +2605,9 @@ private:
     // Holds cost information for visualized program
     IRCostModel cost_model;
 
+    // Measured runtime data for the Funcs, if any was given
+    ProfileInfo profile_info;
+
     // Annotate AST nodes with unique IDs
     std::map<const IRNode *, int> node_ids;
 
@@ -2541,16 +2800,18 @@ private:
 // The external interface to this module
 void print_to_stmt_html(const std::string &html_output_filename,
                         const Module &m,
-                        const std::string &assembly_input_filename) {
-    PipelineHTMLInspector inspector(html_output_filename, m, assembly_input_filename, false);
+                        const std::string &assembly_input_filename,
+                        const std::string &profile_input_filename) {
+    PipelineHTMLInspector inspector(html_output_filename, m, assembly_input_filename, profile_input_filename, false);
     inspector.generate_html(m);
     debug(1) << "Done generating HTML IR Inspector - printed to: " << html_output_filename << "\n";
 }
 
 void print_to_conceptual_stmt_html(const std::string &html_output_filename,
                                    const Module &m,
-                                   const std::string &assembly_input_filename) {
-    PipelineHTMLInspector inspector(html_output_filename, m, assembly_input_filename, true);
+                                   const std::string &assembly_input_filename,
+                                   const std::string &profile_input_filename) {
+    PipelineHTMLInspector inspector(html_output_filename, m, assembly_input_filename, profile_input_filename, true);
     inspector.generate_html(m);
     debug(1) << "Done generating HTML Conceptual IR Inspector - printed to: " << html_output_filename << "\n";
 }
@@ -19,19 +19,30 @@ struct Stmt;
  * If assembly_input_filename is not empty, it is expected to be the path
  * to assembly output. If empty, the code will attempt to find such a
  * file based on output_filename (replacing ".stmt.html" with ".s"),
- * and will assert-fail if no such file is found. */
+ * and will assert-fail if no such file is found.
+ *
+ * If profile_input_filename is not empty, or else if the environment
+ * variable HL_STMT_HTML_PROFILE is set, it is expected to be the path
+ * to the output of halide_profiler_report, or to a trace written by
+ * the profiler's timeline mode (HL_PROFILER_TIMELINE), from a run of
+ * the same pipeline. The produce node of each Func then shows its
+ * measured time, the average number of threads it used, its heap and
+ * stack allocations, and how much of its code is vectorized. */
 void print_to_stmt_html(const std::string &html_output_filename,
                         const Module &m,
-                        const std::string &assembly_input_filename = "");
+                        const std::string &assembly_input_filename = "",
+                        const std::string &profile_input_filename = "");
 
 /** Dump an HTML-formatted visualization of a Module's conceptual Stmt code to filename.
  * If assembly_input_filename is not empty, it is expected to be the path
  * to assembly output. If empty, the code will attempt to find such a
  * file based on output_filename (replacing ".stmt.html" with ".s"),
- * and will assert-fail if no such file is found. */
+ * and will assert-fail if no such file is found. The profile is used as
+ * by print_to_stmt_html. */
 void print_to_conceptual_stmt_html(const std::string &html_output_filename,
                                    const Module &m,
-                                   const std::string &assembly_input_filename = "");
+                                   const std::string &assembly_input_filename = "",
+                                   const std::string &profile_input_filename = "");
 
 }  // namespace Internal
 }  // namespace Halide
@@ -2,6 +2,7 @@
 
 #include "Bounds.h"
 #include "CSE.h"
+#include "DeviceInterface.h"
 #include "Function.h"
 #include "FuseGPUThreadLoops.h"
 #include "IRMutator.h"
@@ -102,9 +103,16 @@ private:
     const Target &target;
     Scope<> realizations;
     bool in_gpu = false;
+    DeviceAPI gpu_device_api = DeviceAPI::None;
     vector<HoistedStorageData> hoisted_storages;
     map<string, int> hoisted_storages_map;
 
+    // Only OpenCL kernels access textures through image objects. The
+    // other device APIs load and store them like any other buffer.
+    bool use_image_access(const string &name) const {
+        return in_gpu && gpu_device_api == DeviceAPI::OpenCL && textures.count(name);
+    }
+
     Expr make_shape_var(string name, const string &field, size_t dim,
                         const Buffer<> &buf, const Parameter &param) {
         ReductionDomain rdom;
@@ -395,7 +403,7 @@ private:
 
         Expr value = mutate(op->values[0]);
         Expr predicate = mutate(op->predicate);
-        if (in_gpu && textures.count(op->name)) {
+        if (use_image_access(op->name)) {
             Expr buffer_var =
                 Variable::make(type_of<halide_buffer_t *>(), op->name + ".buffer", output_buf);
             vector<Expr> args(2);
@@ -436,7 +444,7 @@ private:
 
             internal_assert(op->value_index == 0);
 
-            if (in_gpu && textures.count(op->name)) {
+            if (use_image_access(op->name)) {
                 ReductionDomain rdom;
                 Expr buffer_var =
                     Variable::make(type_of<halide_buffer_t *>(), op->name + ".buffer",
@@ -545,6 +553,14 @@ private:
             storage.loop_vars.emplace_back(op->name, loop_bounds);
         }
 
+        DeviceAPI device_api = gpu_device_api;
+        if (!in_gpu && is_gpu(op->for_type)) {
+            // GPU APIs haven't been selected yet.
+            device_api = op->device_api == DeviceAPI::Default_GPU ?
+                             get_default_device_api_for_target(target) :
+                             op->device_api;
+        }
+        ScopedValue<DeviceAPI> old_gpu_device_api(gpu_device_api, device_api);
         ScopedValue<bool> old_in_gpu(in_gpu, in_gpu || is_gpu(op->for_type));
         Stmt stmt = IRMutator::visit(op);
 
@@ -2,6 +2,7 @@
 
 #include "Bounds.h"
 #include "CSE.h"
+#include "CompilerLogger.h"
 #include "Debug.h"
 #include "ExprUsesVar.h"
 #include "IRMutator.h"
@@ -478,12 +479,75 @@ public:
 };
 
 // Attempt to fold the storage of a particular function in a statement
+// Report to the active CompilerLogger, if any, why a dimension of a
+// Func wasn't folded over a loop.
+void record_storage_folding_rejection(const Function &func, int dim,
+                                      const string &loop_var, const string &reason) {
+    debug(3) << "Not folding " << func.name() << " dimension " << dim
+             << " over " << loop_var << " because " << reason << "\n";
+    if (auto *logger = get_compiler_logger()) {
+        logger->record_storage_folding_rejection(func.name(), func.args()[dim], loop_var, reason);
+    }
+}
+
+// Round a positive int32 up to a power of two at runtime, without
+// exceeding limit.
+Expr next_power_of_two_at_most(const Expr &e, const Expr &limit) {
+    Expr e_minus_one = cast<uint32_t>(max(e, 1) - 1);
+    Expr rounded = make_const(UInt(32), 1) << (32 - count_leading_zeros(e_minus_one));
+    return cast<int32_t>(min(rounded, cast<uint32_t>(limit)));
+}
+
 class AttemptStorageFoldingOfFunction : public IRMutator {
     Function func;
     bool explicit_only;
+    const Region &realize_bounds;
+
+    // The lets and serial loops between the realization and the
+    // current node, outermost first. A let has a value, and a loop
+    // has the bounds of its loop variable.
+    struct Enclosing {
+        string name;
+        Expr value;
+        Interval bounds;
+    };
+    vector<Enclosing> enclosing;
 
     using IRMutator::visit;
 
+    // Find an upper bound for e that only depends on the variables in
+    // scope at the realization, or return an undefined Expr.
+    Expr hoist_upper_bound(Expr e) const {
+        for (auto it = enclosing.rbegin(); it != enclosing.rend() && e.defined(); it++) {
+            if (!expr_uses_var(e, it->name)) {
+                continue;
+            }
+            if (it->value.defined()) {
+                e = substitute(it->name, it->value, e);
+            } else {
+                Scope<Interval> scope;
+                scope.push(it->name, it->bounds);
+                Interval in = bounds_of_expr_in_scope(e, scope);
+                e = in.has_upper_bound() ? in.max : Expr();
+            }
+        }
+        if (!e.defined() || !is_pure(e)) {
+            return Expr();
+        }
+        return simplify(common_subexpression_elimination(e));
+    }
+
+    Stmt visit(const LetStmt *op) override {
+        enclosing.push_back({op->name, op->value, Interval()});
+        Stmt body = mutate(op->body);
+        enclosing.pop_back();
+        if (body.same_as(op->body)) {
+            return op;
+        } else {
+            return LetStmt::make(op->name, op->value, body);
+        }
+    }
+
     Stmt visit(const ProducerConsumer *op) override {
         if (op->name == func.name()) {
             // Can't proceed into the pipeline for this func
@@ -568,6 +632,7 @@ class AttemptStorageFoldingOfFunction : public IRMutator {
                          << " because the min or max are constants."
                          << "Min: " << min << "\n"
                          << "Max: " << max << "\n";
+                record_storage_folding_rejection(func, dim, op->name, "the min or max of the footprint is constant");
                 continue;
             }
 
@@ -709,8 +774,12 @@ class AttemptStorageFoldingOfFunction : public IRMutator {
                                  << "min_steady = " << min_steady << "\n"
                                  << "max_initial = " << max_initial << "\n"
                                  << "max_steady = " << max_steady << "\n";
+                        record_storage_folding_rejection(func, dim, op->name,
+                                                         "the min or max of the footprint is not monotonic in the loop variable");
                     } else {
                         debug(3) << "Not folding because there is no explicit storage folding factor\n";
+                        record_storage_folding_rejection(func, dim, op->name,
+                                                         "the Func has several producers and no explicit fold factor");
                     }
                     continue;
                 }
@@ -719,6 +788,10 @@ class AttemptStorageFoldingOfFunction : public IRMutator {
             internal_assert(can_fold_forwards || can_fold_backwards);
 
             Expr factor;
+            // A fold factor that isn't a constant is computed when the
+            // realization is entered, and bound to this name.
+            string runtime_factor_name;
+            Expr runtime_factor_value;
             if (explicit_factor.defined()) {
                 if (dynamic_footprint.empty() && !func.schedule().async()) {
                     // We were able to prove monotonicity
@@ -753,12 +826,44 @@ class AttemptStorageFoldingOfFunction : public IRMutator {
                     }
                     if (success) {
                         factor = e;
-                    } else {
+                    } else if (func.schedule().async()) {
                         debug(3) << "Not folding because extent not bounded by a constant not greater than " << max_fold << "\n"
                                  << "extent = " << extent << "\n"
                                  << "max extent = " << max_extent << "\n";
+                        record_storage_folding_rejection(func, dim, op->name,
+                                                         "the producer is async, and the extent of the footprint is not "
+                                                         "bounded by a constant no greater than " +
+                                                             std::to_string(max_fold));
                         // Try the next dimension
                         continue;
+                    } else {
+                        // Fold by the max extent over the loop, computed
+                        // at the realization, rounded up to a power of
+                        // two. This requires a bound that we can
+                        // evaluate there.
+                        Interval extent_bounds = bounds_of_expr_in_scope(extent, bounds);
+                        Expr bound;
+                        if (extent_bounds.has_upper_bound()) {
+                            bound = hoist_upper_bound(extent_bounds.max);
+                        }
+                        if (!bound.defined()) {
+                            debug(3) << "Not folding because extent not bounded at the realization\n"
+                                     << "extent = " << extent << "\n";
+                            record_storage_folding_rejection(func, dim, op->name,
+                                                             "the extent of the footprint has no upper bound that "
+                                                             "can be computed where the Func is realized");
+                            continue;
+                        }
+                        internal_assert(dim < (int)realize_bounds.size());
+                        Expr realized_extent = realize_bounds[dim].extent;
+                        if (can_prove(bound >= realized_extent)) {
+                            record_storage_folding_rejection(func, dim, op->name,
+                                                             "the footprint over the loop is no smaller than the realization");
+                            continue;
+                        }
+                        runtime_factor_name = unique_name(func.name() + ".fold_factor." + std::to_string(dim));
+                        runtime_factor_value = next_power_of_two_at_most(bound, realized_extent);
+                        factor = Variable::make(Int(32), runtime_factor_name);
                     }
                 }
             }
@@ -769,6 +874,13 @@ class AttemptStorageFoldingOfFunction : public IRMutator {
                 VectorAccessOfFoldedDim vector_access_of_folded_dim{func.name(), dim};
                 body.accept(&vector_access_of_folded_dim);
                 if (vector_access_of_folded_dim.result) {
+                    record_storage_folding_rejection(func, dim, op->name,
+                                                     "there is vectorized access to the Func in that dimension");
+                    if (runtime_factor_value.defined()) {
+                        // This never folded in previous versions of
+                        // Halide, so there's nothing to warn about.
+                        continue;
+                    }
                     user_warning
                         << "Not folding Func " << func.name() << " along dimension " << func.args()[dim]
                         << " because there is vectorized access to that Func in that dimension and "
@@ -785,6 +897,8 @@ class AttemptStorageFoldingOfFunction : public IRMutator {
             debug(3) << "Proceeding with factor " << factor << "\n";
 
             Fold fold = {(int)i - 1, factor};
+            fold.factor_name = runtime_factor_name;
+            fold.factor_value = runtime_factor_value;
             dims_folded.push_back(fold);
             {
                 string head;
@@ -888,6 +1002,8 @@ class AttemptStorageFoldingOfFunction : public IRMutator {
                 debug(3) << "Not folding because loop min or max not monotonic in the loop variable\n"
                          << "min = " << min << "\n"
                          << "max = " << max << "\n";
+                record_storage_folding_rejection(func, dim, op->name,
+                                                 "the min or max of the footprint is not monotonic in the loop variable");
                 break;
             }
         }
@@ -895,7 +1011,9 @@ class AttemptStorageFoldingOfFunction : public IRMutator {
         // Attempt to fold an inner loop. This will bail out if it encounters a
         // ProducerConsumer node for the func, or if it hits a sliding window
         // marker.
+        enclosing.push_back({op->name, Expr(), Interval(op->min, simplify(op->min + op->extent - 1))});
         body = mutate(body);
+        enclosing.pop_back();
 
         if (body.same_as(op->body)) {
             stmt = op;
@@ -932,11 +1050,15 @@ public:
         Semaphore semaphore;
         string head, tail;
         bool fold_forward;
+        // If the factor isn't known at compile time, the name of the
+        // Var it is bound to at the realization, and its value.
+        string factor_name;
+        Expr factor_value;
     };
     vector<Fold> dims_folded;
 
-    AttemptStorageFoldingOfFunction(Function f, bool explicit_only)
-        : func(std::move(f)), explicit_only(explicit_only) {
+    AttemptStorageFoldingOfFunction(Function f, bool explicit_only, const Region &realize_bounds)
+        : func(std::move(f)), explicit_only(explicit_only), realize_bounds(realize_bounds) {
     }
 };
 
@@ -957,7 +1079,7 @@ class StorageFolding : public IRMutator {
         // Don't attempt automatic storage folding if there is
         // more than one produce node for this func.
         bool explicit_only = count_producers(body, op->name) != 1;
-        AttemptStorageFoldingOfFunction folder(func, explicit_only);
+        AttemptStorageFoldingOfFunction folder(func, explicit_only, op->bounds);
         if (explicit_only) {
             debug(3) << "Attempting to fold " << op->name << " explicitly\n";
         } else {
@@ -1012,6 +1134,12 @@ class StorageFolding : public IRMutator {
                 }
             }
 
+            for (const auto &fold : folder.dims_folded) {
+                if (fold.factor_value.defined()) {
+                    stmt = LetStmt::make(fold.factor_name, fold.factor_value, stmt);
+                }
+            }
+
             return stmt;
         }
     }
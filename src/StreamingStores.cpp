@@ -0,0 +1,87 @@
+#include "StreamingStores.h"
+
+#include "IRMutator.h"
+#include "IROperator.h"
+#include "Scope.h"
+
+namespace Halide {
+namespace Internal {
+
+namespace {
+
+class InjectStreamingStores : public IRMutator {
+    using IRMutator::visit;
+
+    Scope<> streaming_allocations;
+    bool in_device_code = false;
+
+    // Whether there were any streaming stores in the code mutated so
+    // far since the innermost enclosing fence site.
+    bool found_streaming_store = false;
+
+    Stmt add_fence(const Stmt &s) {
+        Expr fence = Call::make(Int(32), Call::store_fence, {}, Call::Intrinsic);
+        return Block::make(s, Evaluate::make(fence));
+    }
+
+    // Mutate a Stmt, and fence it if it does streaming stores.
+    Stmt mutate_and_fence(const Stmt &s) {
+        bool outer_found = found_streaming_store;
+        found_streaming_store = false;
+        Stmt result = mutate(s);
+        if (found_streaming_store) {
+            result = add_fence(result);
+        }
+        found_streaming_store |= outer_found;
+        return result;
+    }
+
+    Stmt visit(const Allocate *op) override {
+        ScopedBinding<> bind(op->memory_type == MemoryType::Streaming, streaming_allocations, op->name);
+        return IRMutator::visit(op);
+    }
+
+    Stmt visit(const Store *op) override {
+        bool streaming = streaming_allocations.contains(op->name) ||
+                         (op->param.defined() && op->param.memory_type() == MemoryType::Streaming);
+        if (!streaming || in_device_code) {
+            return IRMutator::visit(op);
+        }
+        found_streaming_store = true;
+        Expr value = mutate(op->value);
+        value = Call::make(value.type(), Call::nontemporal_store, {value}, Call::PureIntrinsic);
+        return Store::make(op->name, value, mutate(op->index), op->param,
+                           mutate(op->predicate), op->alignment);
+    }
+
+    Stmt visit(const ProducerConsumer *op) override {
+        if (op->is_producer) {
+            Stmt body = mutate_and_fence(op->body);
+            return ProducerConsumer::make(op->name, op->is_producer, body);
+        }
+        return IRMutator::visit(op);
+    }
+
+    Stmt visit(const For *op) override {
+        ScopedValue<bool> old_in_device_code(in_device_code,
+                                             in_device_code ||
+                                                 (op->device_api != DeviceAPI::None &&
+                                                  op->device_api != DeviceAPI::Host));
+        if (op->for_type == ForType::Parallel && !in_device_code) {
+            // Each task must fence its own stores.
+            Stmt body = mutate_and_fence(op->body);
+            return For::make(op->name, op->min, op->extent, op->for_type,
+                             op->partition_policy, op->device_api, body);
+        }
+        return IRMutator::visit(op);
+    }
+};
+
+}  // namespace
+
+Stmt inject_streaming_stores(const Stmt &s) {
+    return InjectStreamingStores().mutate(s);
+}
+
+}  // namespace Internal
+}  // namespace Halide
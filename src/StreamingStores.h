@@ -0,0 +1,24 @@
+#ifndef HALIDE_STREAMING_STORES_H
+#define HALIDE_STREAMING_STORES_H
+
+/** \file
+ * Defines a lowering pass that marks stores to MemoryType::Streaming
+ * buffers as non-temporal.
+ */
+
+#include "Expr.h"
+
+namespace Halide {
+namespace Internal {
+
+/** Wrap the values of stores in host code to allocations or output
+ * buffers with MemoryType::Streaming in the nontemporal_store
+ * intrinsic. Non-temporal stores are weakly ordered, so a store_fence is
+ * also added at the end of each producer and each parallel loop body
+ * that does them, before anything else can read the results. */
+Stmt inject_streaming_stores(const Stmt &s);
+
+}  // namespace Internal
+}  // namespace Halide
+
+#endif
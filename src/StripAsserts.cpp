@@ -2,6 +2,7 @@
 #include "IRMutator.h"
 #include "IROperator.h"
 #include "IRVisitor.h"
+#include "Util.h"
 #include <set>
 
 namespace Halide {
@@ -52,12 +53,30 @@ class StripAsserts : public IRMutator {
     // don't need after removing the asserts.
     std::set<std::string> used;
 
+    // If set, only the asserts on entry to the pipeline are dropped.
+    bool entry_only;
+    // How many producers and allocations we're inside of.
+    int depth = 0;
+
     // Drop all assert stmts. Assumes that you don't want any side-effects from
     // the condition.
     Stmt visit(const AssertStmt *op) override {
+        if (entry_only && (depth > 0 || !may_discard(op->condition))) {
+            return IRMutator::visit(op);
+        }
         return Evaluate::make(0);
     }
 
+    Stmt visit(const ProducerConsumer *op) override {
+        ScopedValue<int> bind(depth, depth + 1);
+        return IRMutator::visit(op);
+    }
+
+    Stmt visit(const Allocate *op) override {
+        ScopedValue<int> bind(depth, depth + 1);
+        return IRMutator::visit(op);
+    }
+
     Expr visit(const Variable *op) override {
         used.insert(op->name);
         return op;
@@ -109,12 +128,37 @@ class StripAsserts : public IRMutator {
             return Block::make(first, rest);
         }
     }
+
+public:
+    StripAsserts(bool entry_only)
+        : entry_only(entry_only) {
+    }
+};
+
+class ExtractEntryChecks : public IRMutator {
+    using IRMutator::visit;
+
+    Stmt visit(const ProducerConsumer *op) override {
+        return Evaluate::make(0);
+    }
+
+    Stmt visit(const Allocate *op) override {
+        return Evaluate::make(0);
+    }
 };
 
 }  // namespace
 
 Stmt strip_asserts(const Stmt &s) {
-    return StripAsserts().mutate(s);
+    return StripAsserts(false).mutate(s);
+}
+
+Stmt strip_entry_asserts(const Stmt &s) {
+    return StripAsserts(true).mutate(s);
+}
+
+Stmt extract_entry_checks(const Stmt &s) {
+    return ExtractEntryChecks().mutate(s);
 }
 
 }  // namespace Internal
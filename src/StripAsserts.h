@@ -2,7 +2,9 @@
 #define HALIDE_STRIP_ASSERTS_H
 
 /** \file
- * Defines the lowering pass that strips asserts when NoAsserts is set.
+ * Defines the lowering pass that strips asserts when NoAsserts is set,
+ * and the ones that split the checks at the entry of a pipeline from
+ * the rest of it when TrustedEntry is set.
  */
 
 #include "Expr.h"
@@ -12,6 +14,16 @@ namespace Internal {
 
 Stmt strip_asserts(const Stmt &s);
 
+/** Strip the asserts that check the arguments on entry to a pipeline,
+ * i.e. those outside of any producer or allocation, leaving the ones
+ * in its body (e.g. for failed allocations) and any whose condition has
+ * side effects. The body of <name>_unchecked. */
+Stmt strip_entry_asserts(const Stmt &s);
+
+/** Keep only the checks on entry to a pipeline, and the bounds query,
+ * dropping its producers and allocations. The body of <name>_check. */
+Stmt extract_entry_checks(const Stmt &s);
+
 }  // namespace Internal
 }  // namespace Halide
 
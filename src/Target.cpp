@@ -1,6 +1,9 @@
 #include <array>
+#include <fstream>
 #include <iostream>
+#include <sstream>
 #include <string>
+#include <thread>
 
 #include "Target.h"
 
@@ -48,6 +51,9 @@
 #ifndef HWCAP2_SVE2
 #define HWCAP2_SVE2 0
 #endif
+#ifndef HWCAP2_SME
+#define HWCAP2_SME 0
+#endif
 #endif
 
 namespace Halide {
@@ -229,6 +235,10 @@ Target calculate_host_target() {
     if (sysctl_is_set("hw.optional.arm.FEAT_FP16")) {
         initial_features.push_back(Target::ARMFp16);
     }
+
+    if (sysctl_is_set("hw.optional.arm.FEAT_SME")) {
+        initial_features.push_back(Target::ARMSME);
+    }
 #endif
 
 #ifdef __linux__
@@ -250,6 +260,10 @@ Target calculate_host_target() {
     if (hwcaps2 & HWCAP2_SVE2) {
         initial_features.push_back(Target::SVE2);
     }
+
+    if (hwcaps2 & HWCAP2_SME) {
+        initial_features.push_back(Target::ARMSME);
+    }
 #endif
 
 #ifdef _MSC_VER
@@ -472,6 +486,200 @@ int get_hvx_lower_bound(const Target &t) {
 
 }  // namespace
 
+namespace {
+
+#ifdef __linux__
+
+// Read the first line of a file in sysfs, or the empty string.
+std::string read_sysfs(const std::string &path) {
+    std::ifstream f(path);
+    std::string line;
+    std::getline(f, line);
+    return line;
+}
+
+// Parse a size in sysfs, e.g. "48K".
+uint64_t parse_sysfs_size(const std::string &s) {
+    char *end = nullptr;
+    uint64_t size = strtoull(s.c_str(), &end, 10);
+    if (*end == 'K') {
+        size <<= 10;
+    } else if (*end == 'M') {
+        size <<= 20;
+    } else if (*end == 'G') {
+        size <<= 30;
+    }
+    return size;
+}
+
+// Count the CPUs in a list in sysfs, e.g. "0-1,8-9".
+int count_sysfs_cpus(const std::string &s) {
+    int count = 0;
+    for (const std::string &range : Internal::split_string(s, ",")) {
+        if (range.empty()) {
+            continue;
+        }
+        auto dash = range.find('-');
+        if (dash == std::string::npos) {
+            count++;
+        } else {
+            count += std::atoi(range.c_str() + dash + 1) - std::atoi(range.c_str()) + 1;
+        }
+    }
+    return count;
+}
+
+#endif
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_IX86) || defined(_M_AMD64)
+
+// Fill in the cache sizes from the deterministic cache parameters of
+// cpuid, in leaf 4 on Intel and 0x8000001D on AMD.
+void detect_x86_caches(HostProperties &p) {
+    int info[4];
+    int leaf = 4;
+    if (get_vendor_signature() == VendorSignatures::AuthenticAMD) {
+        cpuid(info, 0x80000000, 0);
+        if ((unsigned)info[0] < 0x8000001D) {
+            return;
+        }
+        leaf = 0x8000001D;
+    } else {
+        cpuid(info, 0, 0);
+        if (info[0] < 4) {
+            return;
+        }
+    }
+    for (int i = 0; i < 16; i++) {
+        cpuid(info, leaf, i);
+        const int type = info[0] & 0x1f;
+        if (type == 0) {
+            break;
+        }
+        const int level = (info[0] >> 5) & 0x7;
+        const uint64_t ways = ((unsigned)info[1] >> 22) + 1;
+        const uint64_t partitions = (((unsigned)info[1] >> 12) & 0x3ff) + 1;
+        const uint64_t line_size = ((unsigned)info[1] & 0xfff) + 1;
+        const uint64_t sets = (uint64_t)(unsigned)info[2] + 1;
+        const uint64_t size = ways * partitions * line_size * sets;
+        if (level == 1 && type == 1) {
+            p.l1_cache_size = size;
+        } else if (level == 2 && type != 2) {
+            p.l2_cache_size = size;
+        }
+        if (type != 2) {
+            p.last_level_cache_size = std::max(p.last_level_cache_size, size);
+        }
+    }
+}
+
+#endif
+
+HostProperties calculate_host_properties() {
+    HostProperties p;
+    const int threads = (int)std::thread::hardware_concurrency();
+
+#if defined(__linux__)
+    p.threads_per_core = count_sysfs_cpus(read_sysfs("/sys/devices/system/cpu/cpu0/topology/thread_siblings_list"));
+    for (int i = 0; i < 16; i++) {
+        const std::string dir = "/sys/devices/system/cpu/cpu0/cache/index" + std::to_string(i) + "/";
+        const std::string level = read_sysfs(dir + "level");
+        if (level.empty()) {
+            break;
+        }
+        const std::string type = read_sysfs(dir + "type");
+        const uint64_t size = parse_sysfs_size(read_sysfs(dir + "size"));
+        if (type == "Instruction") {
+            continue;
+        }
+        if (level == "1") {
+            p.l1_cache_size = size;
+        } else if (level == "2") {
+            p.l2_cache_size = size;
+        }
+        p.last_level_cache_size = std::max(p.last_level_cache_size, size);
+    }
+#elif defined(__APPLE__)
+    // Apple silicon describes its performance cores separately.
+    p.cores = getsysctl<int>("hw.perflevel0.physicalcpu").value_or(0);
+    if (p.cores) {
+        p.threads_per_core = getsysctl<int>("hw.perflevel0.logicalcpu").value_or(p.cores) / p.cores;
+        p.l1_cache_size = getsysctl<uint64_t>("hw.perflevel0.l1dcachesize").value_or(0);
+        p.l2_cache_size = getsysctl<uint64_t>("hw.perflevel0.l2cachesize").value_or(0);
+        // The L2 is shared by a cluster of cores, and is the last level
+        // the cores can use alone.
+        p.last_level_cache_size = p.l2_cache_size;
+        // Every core counts for parallelism, though.
+        p.cores = getsysctl<int>("hw.physicalcpu").value_or(p.cores);
+    } else {
+        p.cores = getsysctl<int>("hw.physicalcpu").value_or(0);
+        if (p.cores) {
+            p.threads_per_core = getsysctl<int>("hw.logicalcpu").value_or(p.cores) / p.cores;
+        }
+        p.l1_cache_size = getsysctl<uint64_t>("hw.l1dcachesize").value_or(0);
+        p.l2_cache_size = getsysctl<uint64_t>("hw.l2cachesize").value_or(0);
+        p.last_level_cache_size = std::max(p.l2_cache_size, getsysctl<uint64_t>("hw.l3cachesize").value_or(0));
+    }
+#elif defined(_MSC_VER)
+    DWORD bytes = 0;
+    GetLogicalProcessorInformation(nullptr, &bytes);
+    std::vector<SYSTEM_LOGICAL_PROCESSOR_INFORMATION> info(bytes / sizeof(SYSTEM_LOGICAL_PROCESSOR_INFORMATION));
+    if (!info.empty() && GetLogicalProcessorInformation(info.data(), &bytes)) {
+        int logical = 0;
+        for (const auto &i : info) {
+            if (i.Relationship == RelationProcessorCore) {
+                p.cores++;
+                for (ULONG_PTR mask = i.ProcessorMask; mask; mask &= mask - 1) {
+                    logical++;
+                }
+            } else if (i.Relationship == RelationCache && i.Cache.Type != CacheInstruction) {
+                const uint64_t size = i.Cache.Size;
+                if (i.Cache.Level == 1) {
+                    p.l1_cache_size = size;
+                } else if (i.Cache.Level == 2) {
+                    p.l2_cache_size = size;
+                }
+                p.last_level_cache_size = std::max(p.last_level_cache_size, size);
+            }
+        }
+        if (p.cores) {
+            p.threads_per_core = logical / p.cores;
+        }
+    }
+#endif
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_IX86) || defined(_M_AMD64)
+    if (p.last_level_cache_size == 0) {
+        detect_x86_caches(p);
+    }
+#endif
+
+    if (p.threads_per_core <= 0) {
+        p.threads_per_core = 1;
+    }
+    if (p.cores <= 0 && threads > 0) {
+        p.cores = std::max(1, threads / p.threads_per_core);
+    }
+    return p;
+}
+
+}  // namespace
+
+std::string HostProperties::to_string() const {
+    std::ostringstream s;
+    s << "cores=" << cores
+      << " threads_per_core=" << threads_per_core
+      << " l1_cache_size=" << l1_cache_size
+      << " l2_cache_size=" << l2_cache_size
+      << " last_level_cache_size=" << last_level_cache_size;
+    return s.str();
+}
+
+const HostProperties &get_host_properties() {
+    static const HostProperties host_properties = calculate_host_properties();
+    return host_properties;
+}
+
 Target get_host_target() {
     // Calculating the host target isn't slow but it isn't free,
     // and it's pointless to recalculate it every time we (e.g.) parse
@@ -715,6 +923,23 @@ const std::map<std::string, Target::Feature> feature_name_map = {
     {"semihosting", Target::Semihosting},
     {"avx10_1", Target::AVX10_1},
     {"x86apx", Target::X86APX},
+    {"arm_sme", Target::ARMSME},
+    {"float16_compute", Target::Float16Compute},
+    {"auto_prefetch", Target::AutoPrefetch},
+    {"profile_light", Target::ProfileLight},
+    {"track_allocations", Target::TrackAllocations},
+    {"arena_allocations", Target::ArenaAllocations},
+    {"auto_rfactor", Target::AutoRFactor},
+    {"specialization_dispatch", Target::SpecializationDispatch},
+    {"wasm_relaxed_simd", Target::WasmRelaxedSimd},
+    {"hvx_auto_vtcm", Target::HVXAutoVTCM},
+    {"strip_unused_runtime", Target::StripUnusedRuntime},
+    {"llvm_fast_compile", Target::LLVMFastCompile},
+    {"auto_storage_order", Target::AutoStorageOrder},
+    {"jit_interp", Target::JITInterp},
+    {"trusted_entry", Target::TrustedEntry},
+    {"loop_interchange", Target::LoopInterchange},
+    {"device_resident", Target::DeviceResident},
     // NOTE: When adding features to this map, be sure to update PyEnums.cpp as well.
 };
 
@@ -959,6 +1184,7 @@ void Target::validate_features() const {
         do_check_bad(*this, {
                                 ARMDotProd,
                                 ARMFp16,
+                                ARMSME,
                                 ARMv7s,
                                 ARMv81a,
                                 NoNEON,
@@ -969,6 +1195,7 @@ void Target::validate_features() const {
                                 VSX,
                                 WasmBulkMemory,
                                 WasmMvpOnly,
+                                WasmRelaxedSimd,
                                 WasmSimd128,
                                 WasmThreads,
                             });
@@ -991,6 +1218,7 @@ void Target::validate_features() const {
                                 VSX,
                                 WasmBulkMemory,
                                 WasmMvpOnly,
+                                WasmRelaxedSimd,
                                 WasmSimd128,
                                 WasmThreads,
                             });
@@ -998,6 +1226,7 @@ void Target::validate_features() const {
         do_check_bad(*this, {
                                 ARMDotProd,
                                 ARMFp16,
+                                ARMSME,
                                 ARMv7s,
                                 ARMv81a,
                                 AVX,
@@ -1017,6 +1246,7 @@ void Target::validate_features() const {
                                 HVX_v65,
                                 HVX_v66,
                                 HVX_v68,
+                                HVXAutoVTCM,
                                 NoNEON,
                                 POWER_ARCH_2_07,
                                 RVV,
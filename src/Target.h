@@ -179,6 +179,23 @@ struct Target {
         Semihosting = halide_target_feature_semihosting,
         AVX10_1 = halide_target_feature_avx10_1,
         X86APX = halide_target_feature_x86_apx,
+        ARMSME = halide_target_feature_arm_sme,
+        Float16Compute = halide_target_feature_float16_compute,
+        AutoPrefetch = halide_target_feature_auto_prefetch,
+        ProfileLight = halide_target_feature_profile_light,
+        TrackAllocations = halide_target_feature_track_allocations,
+        ArenaAllocations = halide_target_feature_arena_allocations,
+        AutoRFactor = halide_target_feature_auto_rfactor,
+        SpecializationDispatch = halide_target_feature_specialization_dispatch,
+        WasmRelaxedSimd = halide_target_feature_wasm_relaxed_simd,
+        HVXAutoVTCM = halide_target_feature_hvx_auto_vtcm,
+        StripUnusedRuntime = halide_target_feature_strip_unused_runtime,
+        LLVMFastCompile = halide_target_feature_llvm_fast_compile,
+        AutoStorageOrder = halide_target_feature_auto_storage_order,
+        JITInterp = halide_target_feature_jit_interp,
+        TrustedEntry = halide_target_feature_trusted_entry,
+        LoopInterchange = halide_target_feature_loop_interchange,
+        DeviceResident = halide_target_feature_device_resident,
         FeatureEnd = halide_target_feature_end
     };
     Target() = default;
@@ -380,6 +397,33 @@ private:
 /** Return the target corresponding to the host machine. */
 Target get_host_target();
 
+/** The cores and caches of the host machine, as detected from sysfs on
+ * Linux, sysctl on macOS, the processor information on Windows, and
+ * cpuid on x86 where none of those say. Used as the defaults of the
+ * autoscheduler parameters that describe the machine. Zero means
+ * unknown. */
+struct HostProperties {
+    /** The number of physical cores. */
+    int cores = 0;
+    /** The number of hardware threads per core, i.e. more than one
+     * with SMT. */
+    int threads_per_core = 0;
+    /** The sizes in bytes of the L1 data cache and the L2 cache of one
+     * core, and of the last level of cache. */
+    // @{
+    uint64_t l1_cache_size = 0;
+    uint64_t l2_cache_size = 0;
+    uint64_t last_level_cache_size = 0;
+    // @}
+
+    /** E.g. "cores=8 threads_per_core=2 l1_cache_size=49152 ..." */
+    std::string to_string() const;
+};
+
+/** Return the properties of the host machine. They're detected on the
+ * first call, and cached. */
+const HostProperties &get_host_properties();
+
 /** Return the target that Halide will use. If HL_TARGET is set it
  * uses that. Otherwise calls \ref get_host_target */
 Target get_target_from_environment();
@@ -0,0 +1,176 @@
+#include "TargetFeatureSpecializations.h"
+
+#include <map>
+#include <utility>
+
+#include "Argument.h"
+#include "Closure.h"
+#include "IRMutator.h"
+#include "IROperator.h"
+#include "Module.h"
+#include "Target.h"
+#include "Util.h"
+
+namespace Halide {
+namespace Internal {
+
+namespace {
+
+LoweredArgument make_scalar_arg(const std::string &name, const Type &type) {
+    return LoweredArgument(name, Argument::Kind::InputScalar, type, 0, ArgumentEstimates());
+}
+
+class OutlineTargetFeatureSpecializations : public IRMutator {
+    using IRMutator::visit;
+
+    const std::string &function_name;
+    const Target &base_target;
+
+    // The target the code being mutated will be compiled for. This has
+    // more features than the base target inside specializations.
+    Target target;
+
+    // The name of the variable holding the result of the runtime check
+    // for each target.
+    std::map<std::string, std::string> checks;
+
+    Expr can_use(const Target &t) {
+        std::string &name = checks[t.to_string()];
+        if (name.empty()) {
+            name = unique_name("can_use_target_features");
+        }
+        return Variable::make(Int(32), name) != 0;
+    }
+
+    // The features of t that the base target doesn't have.
+    std::string extra_features(const Target &t) const {
+        std::string result;
+        for (int i = 0; i < Target::FeatureEnd; i++) {
+            Target::Feature f = (Target::Feature)i;
+            if (t.has_feature(f) && !base_target.has_feature(f)) {
+                if (!result.empty()) {
+                    result += "-";
+                }
+                result += Target::feature_to_name(f);
+            }
+        }
+        return result;
+    }
+
+    // Checks that aren't the condition of a specialization (e.g. those
+    // folded into the conditions of skip_stages) just use the runtime
+    // check.
+    Expr visit(const Call *op) override {
+        if (!op->is_intrinsic(Call::can_use_target_features)) {
+            return IRMutator::visit(op);
+        }
+        const StringImm *features = op->args[0].as<StringImm>();
+        internal_assert(features);
+        Target specialized(target.to_string() + "-" + features->value);
+        if (specialized == target) {
+            return const_true();
+        }
+        return can_use(specialized);
+    }
+
+    Stmt visit(const IfThenElse *op) override {
+        const Call *c = op->condition.as<Call>();
+        if (!c || !c->is_intrinsic(Call::can_use_target_features)) {
+            return IRMutator::visit(op);
+        }
+        const StringImm *features = c->args[0].as<StringImm>();
+        internal_assert(features);
+
+        // Parsing the features as part of a Target string also checks
+        // that they make sense for the target architecture.
+        Target specialized(target.to_string() + "-" + features->value);
+
+        Stmt else_case = mutate(op->else_case);
+        Stmt then_case;
+        {
+            ScopedValue<Target> old_target(target, specialized);
+            then_case = mutate(op->then_case);
+        }
+
+        if (specialized == target) {
+            // The code is already being compiled with these features.
+            return then_case;
+        }
+
+        Closure closure;
+        closure.include(then_case);
+        // The same name can appear as a var and a buffer. Remove the var name in this case.
+        for (const auto &b : closure.buffers) {
+            closure.vars.erase(b.first);
+        }
+
+        const std::string closure_name = unique_name("specialization_closure");
+        const std::string closure_arg_name = unique_name("closure_arg");
+        Expr closure_struct_allocation = closure.pack_into_struct();
+        Expr closure_arg = Variable::make(closure_struct_allocation.type(), closure_arg_name);
+
+        std::string suffix = replace_all(features->value, "-", "_");
+        const std::string new_function_name = c_print_name(unique_name(function_name + "." + suffix), false);
+        std::vector<LoweredArgument> args = {make_scalar_arg("__user_context", type_of<void *>()),
+                                             make_scalar_arg(closure_arg_name, type_of<uint8_t *>())};
+        LoweredFunc func{new_function_name, args, closure.unpack_from_struct(closure_arg, then_case),
+                         LinkageType::Internal, NameMangling::C};
+        func.target_features = extra_features(specialized);
+        outlined.emplace_back(std::move(func));
+
+        Expr user_context = Call::make(type_of<void *>(), Call::get_user_context, {}, Call::PureIntrinsic);
+        Expr closure_struct = Cast::make(type_of<uint8_t *>(), Variable::make(Handle(), closure_name));
+        Expr call = Call::make(Int(32), new_function_name, {user_context, closure_struct}, Call::Extern);
+
+        const std::string result_name = unique_name("specialization_result");
+        Expr result = Variable::make(Int(32), result_name);
+        Stmt stmt = AssertStmt::make(result == 0, result);
+        stmt = LetStmt::make(result_name, call, stmt);
+        stmt = LetStmt::make(closure_name, closure_struct_allocation, stmt);
+
+        return IfThenElse::make(can_use(specialized), stmt, else_case);
+    }
+
+public:
+    OutlineTargetFeatureSpecializations(const std::string &name, const Target &t,
+                                        std::vector<LoweredFunc> &outlined)
+        : function_name(name), base_target(t), target(t), outlined(outlined) {
+    }
+
+    std::vector<LoweredFunc> &outlined;
+
+    // Compute the runtime checks at the top of the pipeline.
+    Stmt define_checks(Stmt s) const {
+        constexpr int kFeaturesWordCount = (Target::FeatureEnd + 63) / (sizeof(uint64_t) * 8);
+        for (const auto &it : checks) {
+            Target t(it.first);
+            uint64_t words[kFeaturesWordCount] = {0};
+            for (int i = 0; i < Target::FeatureEnd; i++) {
+                if (t.has_feature((Target::Feature)i)) {
+                    words[i >> 6] |= ((uint64_t)1) << (i & 63);
+                }
+            }
+            std::vector<Expr> features;
+            for (uint64_t w : words) {
+                features.emplace_back(UIntImm::make(UInt(64), w));
+            }
+            Expr check = Call::make(Int(32), "halide_can_use_target_features",
+                                    {kFeaturesWordCount,
+                                     Call::make(type_of<uint64_t *>(), Call::make_struct, features, Call::Intrinsic)},
+                                    Call::Extern);
+            s = LetStmt::make(it.second, check, s);
+        }
+        return s;
+    }
+};
+
+}  // namespace
+
+Stmt outline_target_feature_specializations(const Stmt &s, std::vector<LoweredFunc> &outlined,
+                                            const std::string &name, const Target &t) {
+    OutlineTargetFeatureSpecializations outliner(name, t, outlined);
+    return outliner.define_checks(outliner.mutate(s));
+}
+
+}  // namespace Internal
+}  // namespace Halide
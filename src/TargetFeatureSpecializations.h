@@ -0,0 +1,36 @@
+#ifndef HALIDE_TARGET_FEATURE_SPECIALIZATIONS_H
+#define HALIDE_TARGET_FEATURE_SPECIALIZATIONS_H
+
+/** \file
+ * Defines the lowering pass that moves the loop nests of
+ * Stage::specialize_target_features into their own functions.
+ */
+
+#include <string>
+#include <vector>
+
+#include "Expr.h"
+
+namespace Halide {
+
+struct Target;
+
+namespace Internal {
+
+struct LoweredFunc;
+
+/** Outline the loop nests specialized with
+ * Stage::specialize_target_features into internal functions that are
+ * compiled with the extra features, and call them when
+ * halide_can_use_target_features() says the CPU supports those
+ * features. The check for each set of features is done once, at the
+ * top of the pipeline. Specializations for features the target already
+ * has are used unconditionally. The new functions are appended to
+ * outlined. */
+Stmt outline_target_feature_specializations(const Stmt &s, std::vector<LoweredFunc> &outlined,
+                                            const std::string &name, const Target &t);
+
+}  // namespace Internal
+}  // namespace Halide
+
+#endif
@@ -61,6 +61,8 @@ public:
     // The funcs that will have any tracing info emitted (not just trace tags),
     // and the Type(s) of their elements.
     map<string, vector<Type>> funcs_touched;
+    // The Funcs with sampled tracing for which we found the loop to sample.
+    set<string> sampled_loops_found;
 
     InjectTracing(const map<string, Function> &e, const Target &t)
         : env(e),
@@ -72,6 +74,16 @@ public:
     }
 
 private:
+    // True in the sampled iterations of the enclosing loops, if any.
+    Expr sampled;
+
+    Expr guard_with_sampling(Expr trace) const {
+        if (sampled.defined()) {
+            trace = Call::make(trace.type(), Call::if_then_else, {sampled, trace}, Call::PureIntrinsic);
+        }
+        return trace;
+    }
+
     void add_trace_tags(const string &name, const vector<string> &t) {
         if (!t.empty() && !trace_tags_added.count(name)) {
             trace_tags.emplace_back(name, t);
@@ -155,7 +167,7 @@ private:
             builder.event = halide_trace_load;
             builder.parent_id = trace_parent;
             builder.value_index = op->value_index;
-            Expr trace = builder.build();
+            Expr trace = guard_with_sampling(builder.build());
 
             expr = Let::make(value_var_name, op,
                              Call::make(op->type, Call::return_second,
@@ -201,6 +213,7 @@ private:
                     trace = Call::make(trace.type(), Call::if_then_else,
                                        {op->predicate, trace}, Call::PureIntrinsic);
                 }
+                trace = guard_with_sampling(trace);
 
                 traces[i] = Let::make(value_var_name, values[i],
                                       Call::make(t, Call::return_second,
@@ -228,6 +241,47 @@ private:
         return stmt;
     }
 
+    Stmt visit(const For *op) override {
+        // The loops of a Func's stages are called <func>.s<stage>.<...>.<var>
+        const string func_name = op->name.substr(0, op->name.find('.'));
+        auto it = env.find(func_name);
+        if (it == env.end() || it->second.trace_sampling_n() == 0 ||
+            !starts_with(op->name, func_name + ".s") ||
+            !ends_with(op->name, "." + it->second.trace_sampling_var())) {
+            return IRMutator::visit(op);
+        }
+        const Function &f = it->second;
+        user_assert(op->for_type != ForType::Vectorized)
+            << "Can't sample the tracing of " << f.name() << " in the loop over "
+            << f.trace_sampling_var() << ", because it's vectorized.\n";
+        sampled_loops_found.insert(f.name());
+
+        Expr loop_var = Variable::make(Int(32), op->name);
+        Expr n = f.trace_sampling_n();
+        Expr condition;
+        switch (f.trace_sampling()) {
+        case TraceSampling::EveryNth:
+            condition = (loop_var - op->min) % n == 0;
+            break;
+        case TraceSampling::FirstN:
+            condition = loop_var - op->min < n;
+            break;
+        case TraceSampling::Random: {
+            // A multiplicative hash, with the high bits folded down.
+            Expr hash = cast<uint32_t>(loop_var) * make_const(UInt(32), 2654435761u);
+            hash = hash ^ (hash >> 16);
+            condition = hash % cast<uint32_t>(n) == 0;
+            break;
+        }
+        }
+
+        Expr old_sampled = sampled;
+        sampled = old_sampled.defined() ? (old_sampled && condition) : condition;
+        Stmt stmt = IRMutator::visit(op);
+        sampled = old_sampled;
+        return stmt;
+    }
+
     Stmt visit(const Realize *op) override {
         Stmt stmt = IRMutator::visit(op);
         op = stmt.as<Realize>();
@@ -359,6 +413,14 @@ Stmt inject_tracing(Stmt s, const string &pipeline_name, bool trace_pipeline,
     // Inject tracing calls
     s = tracing.mutate(s);
 
+    for (const auto &p : env) {
+        const Function &f = p.second;
+        if (f.trace_sampling_n() && !tracing.sampled_loops_found.count(f.name())) {
+            user_warning << "Func " << f.name() << " samples its tracing in the loop over "
+                         << f.trace_sampling_var() << ", but it has no such loop.\n";
+        }
+    }
+
     // Strip off the dummy realize blocks
     s = RemoveRealizeOverOutput(outputs).mutate(s);
 
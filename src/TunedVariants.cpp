@@ -0,0 +1,120 @@
+#include "TunedVariants.h"
+
+#include <map>
+#include <utility>
+
+#include "ExprUsesVar.h"
+#include "IRMutator.h"
+#include "IROperator.h"
+#include "Util.h"
+
+namespace Halide {
+namespace Internal {
+
+namespace {
+
+class LowerTunedVariants : public IRMutator {
+    using IRMutator::visit;
+
+    struct Site {
+        // The name the runtime knows the variants by.
+        std::string name;
+        // The variables holding the chosen variant, and whether the
+        // variants are still being tried.
+        std::string variant, tuning;
+        int num_variants;
+    };
+
+    const std::string &pipeline_name;
+
+    // By the name of the Func.
+    std::map<std::string, Site> sites;
+
+    Site &get_site(const std::string &func, int num_variants) {
+        auto it = sites.find(func);
+        if (it == sites.end()) {
+            Site s;
+            s.name = pipeline_name + "." + func;
+            s.variant = unique_name(func + ".tuned_variant");
+            s.tuning = unique_name(func + ".tuning_variants");
+            s.num_variants = num_variants;
+            it = sites.emplace(func, std::move(s)).first;
+        }
+        user_assert(it->second.num_variants == num_variants)
+            << "The stages of " << func << " are specialized with specialize_tuned for "
+            << it->second.num_variants << " and " << num_variants << " variants. "
+            << "They must all have the same number of variants.\n";
+        return it->second;
+    }
+
+    Expr visit(const Call *op) override {
+        if (!op->is_intrinsic(Call::use_tuned_variant)) {
+            return IRMutator::visit(op);
+        }
+        const StringImm *func = op->args[0].as<StringImm>();
+        auto variant = as_const_int(op->args[1]);
+        auto num_variants = as_const_int(op->args[2]);
+        internal_assert(func && variant && num_variants);
+        const Site &site = get_site(func->value, (int)*num_variants);
+        return Variable::make(Int(32), site.variant) == (int)*variant;
+    }
+
+    Stmt visit(const ProducerConsumer *op) override {
+        Stmt body = mutate(op->body);
+        auto it = sites.find(op->name);
+        if (!op->is_producer || it == sites.end()) {
+            return body.same_as(op->body) ? op : ProducerConsumer::make(op->name, op->is_producer, body);
+        }
+        const Site &site = it->second;
+
+        // Time the producer, including waiting for the kernels it
+        // launched to finish, while the variants are being tried.
+        const std::string start_name = unique_name(op->name + ".tuning_start_time");
+        Expr now = Call::make(Int(64), "halide_current_time_ns", {}, Call::Extern);
+        Expr report = Call::make(Int(32), "halide_report_size_variant_time",
+                                 {site.name, 0, Variable::make(Int(32), site.variant),
+                                  now - Variable::make(Int(64), start_name)},
+                                 Call::Extern);
+        Stmt done = Evaluate::make(report);
+        for (const std::string &buffer : {op->name + ".buffer", op->name + ".0.buffer"}) {
+            if (stmt_uses_var(body, buffer)) {
+                Expr sync = Call::make(Int(32), "halide_device_sync",
+                                       {Variable::make(type_of<halide_buffer_t *>(), buffer)}, Call::Extern);
+                done = Block::make(Evaluate::make(sync), done);
+                break;
+            }
+        }
+        body = Block::make(body, IfThenElse::make(Variable::make(Bool(), site.tuning), done));
+        body = LetStmt::make(start_name, now, body);
+        return ProducerConsumer::make(op->name, op->is_producer, body);
+    }
+
+public:
+    LowerTunedVariants(const std::string &pipeline_name)
+        : pipeline_name(pipeline_name) {
+    }
+
+    // Choose the variants at the top of the pipeline, so that bounds
+    // inference and the producers agree on them.
+    Stmt define_choices(Stmt s) const {
+        for (const auto &it : sites) {
+            const Site &site = it.second;
+            Expr chosen = Call::make(Int(32), "halide_get_size_variant", {site.name, 0}, Call::Extern);
+            s = LetStmt::make(site.tuning, chosen < 0, s);
+            Expr choose = Call::make(Int(32), "halide_choose_size_variant",
+                                     {site.name, 0, site.num_variants}, Call::Extern);
+            s = LetStmt::make(site.variant, choose, s);
+        }
+        return s;
+    }
+};
+
+}  // namespace
+
+Stmt lower_tuned_variants(const Stmt &s, const std::string &pipeline_name) {
+    LowerTunedVariants lowerer(pipeline_name);
+    return lowerer.define_choices(lowerer.mutate(s));
+}
+
+}  // namespace Internal
+}  // namespace Halide
@@ -0,0 +1,29 @@
+#ifndef HALIDE_TUNED_VARIANTS_H
+#define HALIDE_TUNED_VARIANTS_H
+
+/** \file
+ * Defines the lowering pass that picks between the variants of a Func
+ * made with Stage::specialize_tuned at runtime.
+ */
+
+#include <string>
+
+#include "Expr.h"
+
+namespace Halide {
+namespace Internal {
+
+/** Replace the conditions of the specializations made with
+ * Stage::specialize_tuned by a test of the variant chosen by
+ * halide_choose_size_variant(), which is called for each tuned Func
+ * once, at the top of the pipeline. While the variants of a Func are
+ * still being tried, the time its producer takes is reported with
+ * halide_report_size_variant_time(), after waiting for its device
+ * buffer (if any) to be ready, so that the runtime can settle on the
+ * fastest one. */
+Stmt lower_tuned_variants(const Stmt &s, const std::string &pipeline_name);
+
+}  // namespace Internal
+}  // namespace Halide
+
+#endif
@@ -16,8 +16,11 @@ class UnifyDuplicateLets : public IRMutator {
     using IRMutator::visit;
 
     // Map from Exprs to a Variable in the let name that first introduced that
-    // Expr.
-    map<Expr, Expr, IRDeepCompare> scope;
+    // Expr. Every subexpression gets looked up in here, and the large
+    // unrolled expressions this sees are DAGs, so compare them as graphs:
+    // a tree comparison revisits shared subexpressions once per path to
+    // them.
+    map<Expr, Expr, IRGraphDeepCompare> scope;
 
     // Map from Vars to the Expr they should be replaced with.
     map<string, Expr> rewrites;
@@ -28,6 +31,12 @@ public:
     Expr mutate(const Expr &e) override {
         Expr new_e = IRMutator::mutate(e);
 
+        if (scope.empty() || new_e.as<Variable>() || new_e.as<IntImm>()) {
+            // Let values that are Vars or IntImms are rewritten instead
+            // of entering the scope, so these can't be in it.
+            return new_e;
+        }
+
         if (auto iter = scope.find(new_e);
             iter != scope.end()) {
             return iter->second;
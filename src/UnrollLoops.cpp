@@ -3,6 +3,7 @@
 #include "IROperator.h"
 #include "Simplify.h"
 #include "Substitute.h"
+#include "Target.h"
 #include "UniquifyVariableNames.h"
 
 namespace Halide {
@@ -51,6 +52,31 @@ class UnrollLoops : public IRMutator {
 
 }  // namespace
 
+int unroll_and_jam_factor(const Target &t, int registers_per_iteration) {
+    int registers = 16;
+    switch (t.arch) {
+    case Target::X86:
+        registers = t.has_feature(Target::AVX512) ? 32 : (t.bits == 64 ? 16 : 8);
+        break;
+    case Target::ARM:
+        registers = t.bits == 64 ? 32 : 16;
+        break;
+    case Target::Hexagon:
+    case Target::POWERPC:
+    case Target::RISCV:
+        registers = 32;
+        break;
+    default:
+        break;
+    }
+    const int available = registers - registers / 4;
+    int factor = 1;
+    while (factor < 8 && 2 * factor * std::max(registers_per_iteration, 1) <= available) {
+        factor *= 2;
+    }
+    return factor;
+}
+
 Stmt unroll_loops(const Stmt &s) {
     Stmt stmt = UnrollLoops().mutate(s);
     // Unrolling duplicates variable names. Other passes assume variable names are unique.
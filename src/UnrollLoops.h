@@ -8,6 +8,9 @@
 #include "Expr.h"
 
 namespace Halide {
+
+struct Target;
+
 namespace Internal {
 
 /** Take a statement with for loops marked for unrolling, and convert
@@ -15,6 +18,14 @@ namespace Internal {
  * the loop. */
 Stmt unroll_loops(const Stmt &);
 
+/** Pick how many iterations of an outer loop Stage::unroll_and_jam
+ * should jam into the loops inside it, given how many vector registers
+ * one iteration keeps live across them (e.g. its accumulators). The
+ * result is the largest power of two, up to 8, for which the jammed
+ * iterations fit in about three quarters of the target's vector
+ * registers, leaving the rest for operands. */
+int unroll_and_jam_factor(const Target &t, int registers_per_iteration);
+
 }  // namespace Internal
 }  // namespace Halide
 
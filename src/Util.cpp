@@ -20,7 +20,8 @@
 #include <io.h>
 #else
 #include <cstdlib>
-#include <sys/mman.h>  // For mmap
+#include <sys/mman.h>      // For mmap
+#include <sys/resource.h>  // For getrusage
 #include <unistd.h>
 #endif
 #include <sys/stat.h>
@@ -156,6 +157,24 @@ string running_program_name() {
 #endif
 }
 
+uint64_t get_peak_memory_usage() {
+#ifdef _WIN32
+    return 0;
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0;
+    }
+#ifdef __APPLE__
+    // macOS reports bytes...
+    return (uint64_t)usage.ru_maxrss;
+#else
+    // ...everything else reports kilobytes.
+    return (uint64_t)usage.ru_maxrss * 1024;
+#endif
+#endif
+}
+
 namespace {
 // We use 64K of memory to store unique counters for the purpose of
 // making names unique. Using less memory increases the likelihood of
@@ -149,6 +149,10 @@ std::string get_env_variable(char const *env_var_name);
  * If program name cannot be retrieved, function returns an empty string. */
 std::string running_program_name();
 
+/** Get the peak resident memory of the current process so far, in
+ * bytes. Platform-specific. Returns zero if it cannot be retrieved. */
+uint64_t get_peak_memory_usage();
+
 /** Generate a unique name starting with the given prefix. It's unique
  * relative to all other strings returned by unique_name in this
  * process.
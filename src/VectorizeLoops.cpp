@@ -13,6 +13,7 @@
 #include "Simplify.h"
 #include "Solve.h"
 #include "Substitute.h"
+#include "Target.h"
 #include "VectorizeLoops.h"
 
 namespace Halide {
@@ -501,6 +502,61 @@ class VectorSubs : public IRMutator {
     // version of them if we scalarize inner code.
     vector<pair<string, Expr>> containing_lets;
 
+    // Whether to vectorize atomic scatter-adds to arbitrary indices by
+    // combining the lanes that hit the same index. This is worth it
+    // when the alternative is a serial loop of atomic operations (in
+    // a parallel loop, for types with an atomic add), or when the
+    // target has efficient gathers and scatters (outside of one).
+    bool in_thread, fast_scatter;
+
+    bool combine_conflicting_lanes(const Type &t) const {
+        return in_thread ? t.is_int_or_uint() : fast_scatter;
+    }
+
+    // Vectorize the atomic update f[index] = f[index] + value, where
+    // index is an arbitrary vector: combine the values of the lanes
+    // with equal indices, and update each index only from the last
+    // lane that has it, so that the lanes of the store don't
+    // conflict. This is what AVX-512's vpconflictd is for; expressed
+    // with compares of the index to each of its lanes, the backend
+    // can use that or masked compares on other targets.
+    Stmt combine_conflicting_adds(const Store *store, const Load *load,
+                                  const Expr &index, const Expr &value) {
+        const int lanes = index.type().lanes();
+        internal_assert(value.type().lanes() == lanes);
+
+        string index_name = unique_name('t');
+        string value_name = unique_name('t');
+        string is_last_name = unique_name('t');
+        Expr index_var = Variable::make(index.type(), index_name);
+        Expr value_var = Variable::make(value.type(), value_name);
+        Expr is_last_var = Variable::make(Bool(lanes), is_last_name);
+
+        Expr lane = Ramp::make(0, 1, lanes);
+        Expr total = make_zero(value.type());
+        Expr is_last = const_true(lanes);
+        for (int j = 0; j < lanes; j++) {
+            Expr index_j = Broadcast::make(Shuffle::make_extract_element(index_var, j), lanes);
+            Expr value_j = Broadcast::make(Shuffle::make_extract_element(value_var, j), lanes);
+            Expr same_index = index_var == index_j;
+            total = total + select(same_index, value_j, make_zero(value.type()));
+            if (j > 0) {
+                is_last = is_last && !(same_index && lane < j);
+            }
+        }
+
+        // Only the last lane with each index loads and stores it, so
+        // the update is a predicated atomic add of the combined value.
+        Expr old = Load::make(load->type.with_lanes(lanes), load->name, index_var,
+                              load->image, load->param, is_last_var, ModulusRemainder{});
+        Stmt s = Store::make(store->name, old + total, index_var, store->param,
+                             is_last_var, ModulusRemainder{});
+        s = LetStmt::make(is_last_name, simplify(is_last), s);
+        s = LetStmt::make(value_name, value, s);
+        s = LetStmt::make(index_name, index, s);
+        return s;
+    }
+
     // Widen an expression to the given number of lanes.
     Expr widen(Expr e, int lanes) {
         if (e.type().lanes() == lanes) {
@@ -1175,9 +1231,32 @@ class VectorSubs : public IRMutator {
                 std::swap(a, b);
             }
 
+            const Load *load_a = a.as<Load>();
+
+            // f[g(x)] += y, where g(x) is an arbitrary vector.
+            if (reduce_op == VectorReduce::Add &&
+                load_a &&
+                load_a->name == store->name &&
+                is_const_one(load_a->predicate) &&
+                is_const_one(store->predicate) &&
+                b.type() == load_a->type &&
+                combine_conflicting_lanes(load_a->type) &&
+                !expr_uses_var(b, store->name)) {
+                Expr store_index = mutate(store->index);
+                Expr load_index = mutate(load_a->index);
+                InterleavedRamp ir;
+                const int lanes = store_index.type().lanes();
+                if (lanes > 1 &&
+                    lanes <= 16 &&
+                    !is_interleaved_ramp(store_index, vector_scope, &ir) &&
+                    equal(store_index, load_index)) {
+                    Stmt s = combine_conflicting_adds(store, load_a, store_index, widen(mutate(b), lanes));
+                    return Atomic::make(op->producer_name, op->mutex_name, s);
+                }
+            }
+
             // We require b to be a var, because it should have been lifted.
             const Variable *var_b = b.as<Variable>();
-            const Load *load_a = a.as<Load>();
 
             if (!var_b ||
                 !scope.contains(var_b->name) ||
@@ -1395,7 +1474,8 @@ class VectorSubs : public IRMutator {
     }
 
 public:
-    VectorSubs(const VectorizedVar &vv) {
+    VectorSubs(const VectorizedVar &vv, bool in_thread, bool fast_scatter)
+        : in_thread(in_thread), fast_scatter(fast_scatter) {
         vectorized_vars.push_back(vv);
         update_replacements();
     }
@@ -1576,7 +1656,18 @@ public:
 class VectorizeLoops : public IRMutator {
     using IRMutator::visit;
 
+    // Targets with fast gathers and scatters
+    const bool fast_scatter;
+
+    // Are we inside a parallel loop, where atomic nodes are real.
+    bool in_thread = false;
+
+    // Are we inside a GPU kernel.
+    bool in_gpu = false;
+
     Stmt visit(const For *for_loop) override {
+        ScopedValue<bool> old_in_thread(in_thread, in_thread || is_parallel(for_loop->for_type));
+        ScopedValue<bool> old_in_gpu(in_gpu, in_gpu || is_gpu(for_loop->for_type));
         Stmt stmt;
         if (for_loop->for_type == ForType::Vectorized) {
             const IntImm *extent = for_loop->extent.as<IntImm>();
@@ -1588,13 +1679,18 @@ class VectorizeLoops : public IRMutator {
             }
 
             VectorizedVar vectorized_var = {for_loop->name, for_loop->min, (int)extent->value};
-            stmt = VectorSubs(vectorized_var).mutate(for_loop->body);
+            stmt = VectorSubs(vectorized_var, in_thread && !in_gpu, fast_scatter && !in_gpu).mutate(for_loop->body);
         } else {
             stmt = IRMutator::visit(for_loop);
         }
 
         return stmt;
     }
+
+public:
+    VectorizeLoops(const Target &target)
+        : fast_scatter(target.arch == Target::X86 && target.has_feature(Target::AVX512_Skylake)) {
+    }
 };
 
 /** Check if all stores in a Stmt are to names in a given scope. Used
@@ -1654,17 +1750,17 @@ class RemoveUnnecessaryAtomics : public IRMutator {
     }
 };
 
-Stmt vectorize_statement(const Stmt &stmt) {
-    return VectorizeLoops().mutate(stmt);
+Stmt vectorize_statement(const Stmt &stmt, const Target &target) {
+    return VectorizeLoops(target).mutate(stmt);
 }
 
 }  // namespace
-Stmt vectorize_loops(const Stmt &stmt, const map<string, Function> &env) {
+Stmt vectorize_loops(const Stmt &stmt, const map<string, Function> &env, const Target &target) {
     // Limit the scope of atomic nodes to just the necessary stuff.
     // TODO: Should this be an earlier pass? It's probably a good idea
     // for non-vectorizing stuff too.
     Stmt s = LiftVectorizableExprsOutOfAllAtomicNodes(env).mutate(stmt);
-    s = vectorize_statement(s);
+    s = vectorize_statement(s, target);
     s = RemoveUnnecessaryAtomics().mutate(s);
     return s;
 }
@@ -18,9 +18,10 @@ namespace Internal {
 
 /** Take a statement with for loops marked for vectorization, and turn
  * them into single statements that operate on vectors. The loops in
- * question must have constant extent.
+ * question must have constant extent. The target decides how atomic
+ * scatters to arbitrary indices are vectorized.
  */
-Stmt vectorize_loops(const Stmt &s, const std::map<std::string, Function> &env);
+Stmt vectorize_loops(const Stmt &s, const std::map<std::string, Function> &env, const Target &target);
 
 }  // namespace Internal
 }  // namespace Halide
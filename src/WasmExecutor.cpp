@@ -1,10 +1,14 @@
 #include "WasmExecutor.h"
 
+#include <chrono>
 #include <cmath>
 #include <csignal>
 #include <cstdlib>
+#include <cstring>
+#include <deque>
 #include <mutex>
 #include <sstream>
+#include <string_view>
 #include <unordered_map>
 #include <vector>
 
@@ -21,6 +25,7 @@
 #include "LLVM_Output.h"
 #include "LLVM_Runtime_Linker.h"
 #include "Target.h"
+#include "Util.h"
 
 #if WITH_WABT
 #include "wabt/binary-reader.h"
@@ -1091,6 +1096,19 @@ WABT_HOST_CALLBACK(halide_error) {
     return wabt::Result::Ok;
 }
 
+WABT_HOST_CALLBACK(halide_start_clock) {
+    results[0] = wabt::interp::Value::Make((int32_t)0);
+    return wabt::Result::Ok;
+}
+
+WABT_HOST_CALLBACK(halide_current_time_ns) {
+    const int64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                           std::chrono::steady_clock::now().time_since_epoch())
+                           .count();
+    results[0] = wabt::interp::Value::Make(ns);
+    return wabt::Result::Ok;
+}
+
 WABT_HOST_CALLBACK(malloc) {
     WabtContext &wabt_context = get_wabt_context(thread);
 
@@ -1288,6 +1306,9 @@ wabt::Features calc_features(const Target &target) {
     if (target.has_feature(Target::WasmSimd128)) {
         f.enable_simd();
     }
+    if (target.has_feature(Target::WasmRelaxedSimd)) {
+        f.enable_relaxed_simd();
+    }
     return f;
 }
 #endif  // WITH_WABT
@@ -1296,6 +1317,62 @@ wabt::Features calc_features(const Target &target) {
 v8::Local<v8::String> NewLocalString(v8::Isolate *isolate, const char *s) {
     return v8::String::NewFromUtf8(isolate, s).ToLocalChecked();
 }
+
+// Compiling wasm to native code is most of the cost of a V8 JIT compile,
+// and tests often JIT the same wasm many times, so keep the native code
+// of recently compiled wire bytes around. It is shared by all isolates.
+constexpr size_t kMaxCachedWasmModules = 256;
+
+MaybeLocal<WasmModuleObject> compile_wasm_module(Isolate *isolate, const std::vector<char> &wasm) {
+    static std::mutex cache_lock;
+    static std::deque<std::pair<size_t, CompiledWasmModule>> cache;
+
+    const size_t hash = std::hash<std::string_view>()(std::string_view(wasm.data(), wasm.size()));
+    {
+        std::lock_guard<std::mutex> lock(cache_lock);
+        for (const auto &it : cache) {
+            if (it.first != hash) {
+                continue;
+            }
+            MemorySpan<const uint8_t> bytes = it.second.GetWireBytesRef();
+            if (bytes.size() == wasm.size() && memcmp(bytes.data(), wasm.data(), wasm.size()) == 0) {
+                wdebug(1) << "Reusing compiled wasm module\n";
+                return WasmModuleObject::FromCompiledModule(isolate, it.second);
+            }
+        }
+    }
+
+    MaybeLocal<WasmModuleObject> maybe_compiled = WasmModuleObject::Compile(
+        isolate,
+        /* wire_bytes */ {(const uint8_t *)wasm.data(), wasm.size()});
+
+    Local<WasmModuleObject> compiled;
+    if (maybe_compiled.ToLocal(&compiled)) {
+        std::lock_guard<std::mutex> lock(cache_lock);
+        if (cache.size() >= kMaxCachedWasmModules) {
+            cache.pop_front();
+        }
+        cache.emplace_back(hash, compiled->GetCompiledModule());
+    }
+    return maybe_compiled;
+}
+
+// The V8 flags that select the tiers wasm code runs in, from
+// HL_WASM_V8_TIER. By default, V8 starts with its baseline compiler
+// (Liftoff) and recompiles hot functions with its optimizing one
+// (TurboFan).
+std::vector<std::string> wasm_tier_flags() {
+    const std::string tier = get_env_variable("HL_WASM_V8_TIER");
+    if (tier.empty() || tier == "tiered") {
+        return {};
+    } else if (tier == "liftoff") {
+        return {"--liftoff-only"};
+    } else if (tier == "turbofan") {
+        return {"--no-liftoff"};
+    }
+    user_error << "HL_WASM_V8_TIER must be one of tiered, liftoff or turbofan, not \"" << tier << "\"\n";
+    return {};
+}
 // ------------------------------
 
 template<typename T>
@@ -1774,6 +1851,25 @@ void wasm_jit_halide_error_callback(const v8::FunctionCallbackInfo<v8::Value> &a
     }
 }
 
+void wasm_jit_halide_start_clock_callback(const v8::FunctionCallbackInfo<v8::Value> &args) {
+    Isolate *isolate = args.GetIsolate();
+    Local<Context> context = isolate->GetCurrentContext();
+    HandleScope scope(isolate);
+
+    args.GetReturnValue().Set(load_scalar<int32_t>(context, 0));
+}
+
+void wasm_jit_halide_current_time_ns_callback(const v8::FunctionCallbackInfo<v8::Value> &args) {
+    Isolate *isolate = args.GetIsolate();
+    HandleScope scope(isolate);
+
+    const int64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                           std::chrono::steady_clock::now().time_since_epoch())
+                           .count();
+    // load_scalar() doesn't support 64-bit values yet.
+    args.GetReturnValue().Set(v8::BigInt::New(isolate, ns));
+}
+
 void wasm_jit_halide_trace_helper_callback(const v8::FunctionCallbackInfo<v8::Value> &args) {
     internal_assert(args.Length() == 12);
     Isolate *isolate = args.GetIsolate();
@@ -2168,8 +2264,10 @@ const HostCallbackMap &get_host_callback_map() {
         DEFINE_CALLBACK(free)
         DEFINE_CALLBACK(fwrite)
         DEFINE_CALLBACK(getenv)
+        DEFINE_CALLBACK(halide_current_time_ns)
         DEFINE_CALLBACK(halide_error)
         DEFINE_CALLBACK(halide_print)
+        DEFINE_CALLBACK(halide_start_clock)
         DEFINE_CALLBACK(halide_trace_helper)
         DEFINE_CALLBACK(malloc)
         DEFINE_CALLBACK(memcmp)
@@ -2402,6 +2500,7 @@ WasmModuleContents::WasmModuleContents(
             // Note that we currently enable all features that *might* be used
             // (eg we enable simd even though we might not use it) as we may well end
             // using different Halide Targets across our lifespan.
+            "--experimental-wasm-relaxed-simd",
 
             // Sometimes useful for debugging purposes:
             // "--print_all_exceptions=true",
@@ -2412,6 +2511,9 @@ WasmModuleContents::WasmModuleContents(
             // "--wasm-interpret-all",
             // "--trace-wasm-memory",
         };
+        for (const auto &f : wasm_tier_flags()) {
+            flags.push_back(f);
+        }
         for (const auto &f : flags) {
             V8::SetFlagsFromString(f.c_str(), f.size());
         }
@@ -2445,9 +2547,7 @@ WasmModuleContents::WasmModuleContents(
 
     std::vector<char> final_wasm = compile_to_wasm(halide_module, fn_name);
 
-    MaybeLocal<WasmModuleObject> maybe_compiled = WasmModuleObject::Compile(
-        isolate,
-        /* wire_bytes */ {(const uint8_t *)final_wasm.data(), final_wasm.size()});
+    MaybeLocal<WasmModuleObject> maybe_compiled = compile_wasm_module(isolate, final_wasm);
 
     Local<WasmModuleObject> compiled;
     if (!maybe_compiled.ToLocal(&compiled)) {
@@ -0,0 +1,128 @@
+#include "WindowReduction.h"
+
+#include <utility>
+
+#include "Error.h"
+#include "IROperator.h"
+
+namespace Halide {
+
+using std::string;
+using std::vector;
+
+WindowReduction WindowReduction::make(const Func &f, int dim, int radius, const string &name,
+                                      const std::function<Expr(const Expr &, const Expr &)> &op,
+                                      bool idempotent) {
+    user_assert(f.defined()) << "Can't take a window reduction of undefined Func " << f.name() << ".\n";
+    user_assert(f.outputs() == 1)
+        << "Can't take a window reduction of Func " << f.name() << ", which has a Tuple value.\n";
+    vector<Var> args = f.args();
+    user_assert(dim >= 0 && dim < (int)args.size())
+        << "Dimension " << dim << " is out of range for Func " << f.name()
+        << ", which has " << args.size() << " dimensions.\n";
+    user_assert(radius >= 0) << "The radius of a window reduction can't be negative.\n";
+
+    const int w = 2 * radius + 1;
+
+    // The prefix and suffix passes are indexed by the position within
+    // a block, then the block, then the other dimensions of f.
+    Var xi(name + "_xi"), xo(name + "_xo");
+    auto block = [&](const Expr &i, const Expr &b) {
+        vector<Expr> result = {i, b};
+        for (int d = 0; d < (int)args.size(); d++) {
+            if (d != dim) {
+                result.emplace_back(args[d]);
+            }
+        }
+        return result;
+    };
+    auto at = [&](const Expr &x) {
+        vector<Expr> result(args.begin(), args.end());
+        result[dim] = x;
+        return result;
+    };
+
+    WindowReduction r;
+    r.dim_ = dim;
+    r.prefix_ = Func(name + "_prefix");
+    r.suffix_ = Func(name + "_suffix");
+    r.prefix_(block(xi, xo)) = f(at(xo * w + xi));
+    r.suffix_(block(xi, xo)) = f(at(xo * w + xi));
+    if (w > 1) {
+        r.r_ = RDom(1, w - 1, name + "_r");
+        r.prefix_(block(r.r_, xo)) = op(r.prefix_(block(r.r_ - 1, xo)), r.prefix_(block(r.r_, xo)));
+        // The suffix runs backwards, from the end of the block.
+        Expr i = w - 1 - r.r_;
+        r.suffix_(block(i, xo)) = op(r.suffix_(block(i, xo)), r.suffix_(block(i + 1, xo)));
+    }
+
+    // A window from s to e crosses at most one block boundary, so the
+    // suffix at s and the prefix at e cover it, and nothing else.
+    // Except when s starts a block: then both cover all of it, which is
+    // fine for min and max, but a sum is the suffix alone.
+    Expr s = args[dim] - radius, e = args[dim] + radius;
+    Expr value = op(r.suffix_(block(s % w, s / w)), r.prefix_(block(e % w, e / w)));
+    if (!idempotent) {
+        value = select(s % w == 0, r.suffix_(block(s % w, s / w)), value);
+    }
+    r.result_ = Func(name);
+    r.result_(args) = value;
+    return r;
+}
+
+WindowReduction WindowReduction::minimum(const Func &f, int dim, int radius, const string &name) {
+    return make(f, dim, radius, name, [](const Expr &a, const Expr &b) { return min(a, b); }, true);
+}
+
+WindowReduction WindowReduction::maximum(const Func &f, int dim, int radius, const string &name) {
+    return make(f, dim, radius, name, [](const Expr &a, const Expr &b) { return max(a, b); }, true);
+}
+
+WindowReduction WindowReduction::sum(const Func &f, int dim, int radius, const string &name) {
+    return make(f, dim, radius, name, [](const Expr &a, const Expr &b) { return a + b; }, false);
+}
+
+WindowReduction &WindowReduction::schedule(const Target &target, const LoopLevel &level, int vector_dim) {
+    user_assert(result_.defined()) << "Can't schedule an undefined window reduction.\n";
+    vector<Var> args = prefix_.args();
+    user_assert(vector_dim >= -1 && vector_dim < (int)args.size() - 1 && vector_dim != dim_)
+        << "Can't vectorize the passes of " << result_.name() << " across dimension " << vector_dim
+        << ", which is out of range or the one being filtered.\n";
+
+    // The passes' own args are the position within a block, the block,
+    // and the others in order.
+    Var xi = args[0];
+    Var v = vector_dim < 0 ? args[1] : args[vector_dim < dim_ ? vector_dim + 2 : vector_dim + 1];
+    vector<Var> storage = {v};
+    for (const Var &a : args) {
+        if (!a.same_as(v)) {
+            storage.push_back(a);
+        }
+    }
+
+    for (Func f : {prefix_, suffix_}) {
+        f.compute_at(level).reorder_storage(storage);
+        vector<Stage> stages = {f};
+        vector<VarOrRVar> inner = {xi};
+        if (f.has_update_definition()) {
+            stages.push_back(f.update());
+            inner.emplace_back(r_.x);
+        }
+        for (size_t i = 0; i < stages.size(); i++) {
+            Var vo(v.name() + "_vo"), vi(v.name() + "_vi");
+            if (target.has_gpu_feature()) {
+                stages[i].gpu_tile(v, vo, vi, 64, TailStrategy::GuardWithIf);
+            } else {
+                const int vector_size = target.natural_vector_size(f.type());
+                // Keep the lanes innermost, with the scan along the
+                // block outside of them.
+                stages[i].split(v, vo, vi, vector_size, TailStrategy::GuardWithIf)
+                    .reorder(vi, inner[i])
+                    .vectorize(vi);
+            }
+        }
+    }
+    return *this;
+}
+
+}  // namespace Halide
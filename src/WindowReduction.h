@@ -0,0 +1,105 @@
+#ifndef HALIDE_WINDOW_REDUCTION_H
+#define HALIDE_WINDOW_REDUCTION_H
+
+/** \file
+ * Sliding-window minimums, maximums and sums that take constant work
+ * per element, whatever the size of the window.
+ */
+
+#include <functional>
+#include <string>
+
+#include "Func.h"
+#include "RDom.h"
+#include "Target.h"
+
+namespace Halide {
+
+/** The reduction of a Func over a window of 2 * radius + 1 elements
+ * along one of its dimensions, centered on each element, computed with
+ * the van Herk/Gil-Werman algorithm. The dimension is cut into blocks
+ * as long as the window. A prefix pass reduces each block from its
+ * start up to each element, and a suffix pass from each element to the
+ * end of the block. A window straddles at most one block boundary, so
+ * each result is the suffix at its first element combined with the
+ * prefix at its last: two passes and one combine per element, instead
+ * of one step per element of the window.
+ *
+ * The passes are Funcs with update definitions, indexed by the position
+ * within a block and then the block, followed by the other dimensions
+ * of the Func. They can't be inlined, so they should be scheduled,
+ * e.g. with schedule(). For example, a 2D max filter of radius 64, as
+ * a vertical pass and then a horizontal one:
+ \code
+ Func clamped = BoundaryConditions::repeat_edge(input);
+ WindowReduction vert = WindowReduction::maximum(clamped, 1, 64);
+ WindowReduction horiz = WindowReduction::maximum(vert, 0, 64);
+ Func output = horiz;
+ Var y = output.args()[1];
+ output.compute_root();
+ vert.schedule(target, LoopLevel::root(), 0);
+ horiz.schedule(target, LoopLevel(output, y));
+ \endcode
+ */
+class WindowReduction {
+    Func prefix_, suffix_, result_;
+    // The reduction the passes are updated over, along a block.
+    RDom r_;
+    int dim_ = 0;
+
+    static WindowReduction make(const Func &f, int dim, int radius, const std::string &name,
+                                const std::function<Expr(const Expr &, const Expr &)> &op,
+                                bool idempotent);
+
+public:
+    WindowReduction() = default;
+
+    /** The minimum, maximum or sum of f over the window from x - radius
+     * to x + radius in dimension dim, where x is the coordinate there.
+     * f must be defined everywhere the windows need it, e.g. by using a
+     * boundary condition. Sums are the suffix and the prefix added
+     * together, so sums of floats are only as exact as a sum over one
+     * block. */
+    // @{
+    static WindowReduction minimum(const Func &f, int dim, int radius,
+                                   const std::string &name = "window_min");
+    static WindowReduction maximum(const Func &f, int dim, int radius,
+                                   const std::string &name = "window_max");
+    static WindowReduction sum(const Func &f, int dim, int radius,
+                               const std::string &name = "window_sum");
+    // @}
+
+    /** The result, with the same pure arguments as the Func it was made
+     * from. */
+    // @{
+    Func result() const {
+        return result_;
+    }
+    operator Func() const {
+        return result_;
+    }
+    // @}
+
+    /** The prefix and suffix passes. */
+    // @{
+    Func prefix() const {
+        return prefix_;
+    }
+    Func suffix() const {
+        return suffix_;
+    }
+    // @}
+
+    /** Compute the prefix and suffix passes at the given loop level,
+     * vectorized across the given dimension of the Func the reduction
+     * was made from. The default, -1, vectorizes them across blocks
+     * instead, with the blocks stored innermost, which works whichever
+     * dimension is filtered. The result itself is left to the caller.
+     * Returns a reference to this reduction. */
+    WindowReduction &schedule(const Target &target, const LoopLevel &level = LoopLevel::root(),
+                              int vector_dim = -1);
+};
+
+}  // namespace Halide
+
+#endif
@@ -17,6 +17,7 @@
   LoopNest::compute_features   Recursively walks over a loop nest tree, computing our featurization using Halide's analysis tools.
   LoopNest::apply              Actually apply a computed schedule to a Halide pipeline
   State::generate_children     Generates successor states to a state in the beam search
+  replay_cached_schedule       Rebuilds the state found by an earlier search from the schedule cache
 
   Environment variables used (directly or indirectly):
 
@@ -45,6 +46,7 @@
 #include <algorithm>
 #include <chrono>
 #include <fstream>
+#include <future>
 #include <iostream>
 #include <queue>
 #include <random>
@@ -66,8 +68,10 @@
 #include "NetworkSize.h"
 #include "ParamParser.h"
 #include "PerfectHashMap.h"
+#include "ScheduleCache.h"
 #include "State.h"
 #include "Timer.h"
+#include "halide_thread_pool.h"
 
 #ifdef _WIN32
 #include <io.h>
@@ -216,6 +220,49 @@ public:
     }
 };
 
+// A CostModel that records the schedules enqueued into it, so that they
+// can be passed on to the real cost model later, in a fixed order. Used
+// when expanding several states in parallel.
+class DeferredCostModel : public CostModel {
+public:
+    struct Entry {
+        StageMapOfScheduleFeatures schedule_feats;
+        double *cost_ptr;
+    };
+    std::vector<Entry> queue;
+
+    void set_pipeline_features(const FunctionDAG &dag,
+                               const Adams2019Params &params) override {
+        internal_error << "DeferredCostModel has no pipeline features\n";
+    }
+
+    void enqueue(const FunctionDAG &dag,
+                 const StageMapOfScheduleFeatures &schedule_feats,
+                 double *cost_ptr) override {
+        queue.push_back({schedule_feats, cost_ptr});
+    }
+
+    void evaluate_costs() override {
+        internal_error << "DeferredCostModel cannot evaluate costs\n";
+    }
+
+    void reset() override {
+        queue.clear();
+    }
+};
+
+// The result of expanding one state of the beam on a worker thread.
+struct Expansion {
+    // The children of the state, in the order they were generated.
+    vector<IntrusivePtr<State>> children;
+
+    // For each child, the number of entries in cost_model.queue that
+    // were enqueued before it was.
+    vector<size_t> num_enqueued_before;
+
+    DeferredCostModel cost_model;
+};
+
 // Configure a cost model to process a specific pipeline.
 void configure_pipeline_features(const FunctionDAG &dag,
                                  const Adams2019Params &params,
@@ -234,7 +281,8 @@ IntrusivePtr<State> optimal_schedule_pass(FunctionDAG &dag,
                                           int num_passes,
                                           ProgressBar &tick,
                                           std::unordered_set<uint64_t> &permitted_hashes,
-                                          Cache *cache) {
+                                          Cache *cache,
+                                          Tools::ThreadPool<void> *thread_pool) {
 
     if (cost_model) {
         configure_pipeline_features(dag, params, cost_model);
@@ -292,7 +340,8 @@ IntrusivePtr<State> optimal_schedule_pass(FunctionDAG &dag,
                                              num_passes,
                                              tick,
                                              permitted_hashes,
-                                             cache);
+                                             cache,
+                                             thread_pool);
             } else {
                 internal_error << "Ran out of legal states with beam size " << params.beam_size << "\n";
             }
@@ -302,8 +351,10 @@ IntrusivePtr<State> optimal_schedule_pass(FunctionDAG &dag,
             aslog(1) << "*** Warning: Huge number of states generated (" << pending.size() << ").\n";
         }
 
-        expanded = 0;
-        while (expanded < params.beam_size && !pending.empty()) {
+        // Choose the states to expand. This uses the random number
+        // generator, so it is always done on this thread.
+        vector<IntrusivePtr<State>> to_expand;
+        while ((int)to_expand.size() < params.beam_size && !pending.empty()) {
 
             IntrusivePtr<State> state{pending.pop()};
 
@@ -380,13 +431,68 @@ IntrusivePtr<State> optimal_schedule_pass(FunctionDAG &dag,
                 return best;
             }
 
-            state->generate_children(dag, params, cost_model, enqueue_new_children, cache);
-            expanded++;
+            to_expand.emplace_back(std::move(state));
         }
 
         // Drop the other states unconsidered.
         pending.clear();
 
+        expanded = 0;
+        vector<PendingBlocks> pending_blocks(to_expand.size());
+        if (thread_pool && to_expand.size() > 1) {
+            // Expand the states in parallel. The children of each one
+            // are added to the queue (and the cost model) below, in the
+            // order the states were chosen, so the search proceeds
+            // exactly as if they had been expanded one at a time.
+            vector<Expansion> expansions(to_expand.size());
+            vector<std::future<void>> futures;
+            for (size_t i = 0; i < to_expand.size(); i++) {
+                futures.emplace_back(thread_pool->async([&, i]() {
+                    Expansion &e = expansions[i];
+                    std::function<void(IntrusivePtr<State> &&)> accept_child =
+                        [&](IntrusivePtr<State> &&s) {
+                            e.num_enqueued_before.push_back(e.cost_model.queue.size());
+                            e.children.emplace_back(std::move(s));
+                        };
+                    to_expand[i]->generate_children(dag, params, cost_model ? &e.cost_model : nullptr,
+                                                    accept_child, cache, &pending_blocks[i]);
+                }));
+            }
+            // Wait for all of them before rethrowing any error, as
+            // they refer to the expansions.
+            for (auto &f : futures) {
+                f.wait();
+            }
+            for (auto &f : futures) {
+                f.get();
+            }
+
+            for (auto &e : expansions) {
+                size_t enqueued = 0;
+                for (size_t i = 0; i < e.children.size(); i++) {
+                    for (; enqueued < e.num_enqueued_before[i]; enqueued++) {
+                        const auto &entry = e.cost_model.queue[enqueued];
+                        cost_model->enqueue(dag, entry.schedule_feats, entry.cost_ptr);
+                    }
+                    enqueue_new_children(std::move(e.children[i]));
+                }
+                // Every state enqueued into the cost model is a child.
+                internal_assert(enqueued == e.cost_model.queue.size());
+                expanded++;
+            }
+        } else {
+            for (const auto &state : to_expand) {
+                state->generate_children(dag, params, cost_model, enqueue_new_children, cache, &pending_blocks[expanded]);
+                expanded++;
+            }
+        }
+
+        // Only now update the block cache, so that it was the same for
+        // all the states expanded above.
+        for (const auto &p : pending_blocks) {
+            cache->memoize_blocks(p);
+        }
+
         if (cost_model) {
             // Now evaluate all the costs and re-sort them in the priority queue
             cost_model->evaluate_costs();
@@ -440,6 +546,16 @@ IntrusivePtr<State> optimal_schedule(FunctionDAG &dag,
     // Set up cache with options and size.
     Cache cache(options, dag.nodes.size());
 
+    // Set up the threads used to expand states, if there's more than one.
+    std::unique_ptr<Tools::ThreadPool<void>> thread_pool;
+    int search_threads = params.search_threads;
+    if (search_threads <= 0) {
+        search_threads = (int)Tools::ThreadPool<void>::num_processors_online();
+    }
+    if (search_threads > 1) {
+        thread_pool = std::make_unique<Tools::ThreadPool<void>>(search_threads);
+    }
+
     // If the beam size is one, it's pointless doing multiple passes.
     int num_passes = (params.beam_size == 1) ? 1 : 5;
 
@@ -464,7 +580,7 @@ IntrusivePtr<State> optimal_schedule(FunctionDAG &dag,
         Timer timer;
 
         auto pass = optimal_schedule_pass(dag, outputs, params, cost_model,
-                                          rng, i, num_passes, tick, permitted_hashes, &cache);
+                                          rng, i, num_passes, tick, permitted_hashes, &cache, thread_pool.get());
 
         std::chrono::duration<double> total_time = timer.elapsed();
         auto milli = std::chrono::duration_cast<std::chrono::milliseconds>(total_time).count();
@@ -500,6 +616,63 @@ IntrusivePtr<State> optimal_schedule(FunctionDAG &dag,
     return best;
 }
 
+// Rebuild the state found by an earlier search of this pipeline, if the
+// schedule cache has it, by following the decisions it made from the
+// initial state. Returns nullptr if there is no usable entry.
+IntrusivePtr<State> replay_cached_schedule(const FunctionDAG &dag,
+                                           const Adams2019Params &params,
+                                           uint64_t cache_key,
+                                           const CachingOptions &options) {
+    CachedSchedule cached;
+    if (!load_cached_schedule(params.schedule_cache_dir, cache_key, &cached)) {
+        return nullptr;
+    }
+
+    IntrusivePtr<State> state{new State};
+    state->root = new LoopNest;
+
+    Cache cache(options, dag.nodes.size());
+
+    // The costs of the children are never evaluated; we already have
+    // the cost of the state we're looking for.
+    DeferredCostModel cost_model;
+
+    for (uint64_t h : cached.decisions) {
+        IntrusivePtr<State> next;
+        std::function<void(IntrusivePtr<State> &&)> accept_child =
+            [&](IntrusivePtr<State> &&s) {
+                if (!next.defined() && s->structural_hash(kCachedScheduleHashDepth) == h) {
+                    next = std::move(s);
+                }
+            };
+        PendingBlocks pending_blocks;
+        state->generate_children(dag, params, &cost_model, accept_child, &cache, &pending_blocks);
+        cost_model.reset();
+        if (!next.defined()) {
+            aslog(1) << "Schedule cache entry doesn't match the search space, ignoring it\n";
+            return nullptr;
+        }
+        state = next;
+    }
+
+    if (state->num_decisions_made != 2 * (int)dag.nodes.size()) {
+        return nullptr;
+    }
+
+    // Check we arrived at the same schedule.
+    std::ostringstream out;
+    state->save_featurization(dag, params, options, out);
+    const std::string featurization = out.str();
+    if (featurization.size() != cached.featurization.size() ||
+        memcmp(featurization.data(), cached.featurization.data(), featurization.size()) != 0) {
+        aslog(1) << "Schedule cache entry doesn't match the featurization, ignoring it\n";
+        return nullptr;
+    }
+
+    state->cost = cached.cost;
+    return state;
+}
+
 // The main entrypoint to generate a schedule for a pipeline.
 void generate_schedule(const std::vector<Function> &outputs,
                        const Target &target,
@@ -515,6 +688,9 @@ void generate_schedule(const std::vector<Function> &outputs,
     aslog(1) << "Adams2019.disable_memoized_features:" << params.disable_memoized_features << "\n";
     aslog(1) << "Adams2019.disable_memoized_blocks:" << params.disable_memoized_blocks << "\n";
     aslog(1) << "Adams2019.memory_limit:" << params.memory_limit << "\n";
+    aslog(1) << "Adams2019.search_threads:" << params.search_threads << "\n";
+    aslog(1) << "Adams2019.schedule_cache_dir:" << params.schedule_cache_dir << "\n";
+    aslog(1) << "Adams2019.fuse_outputs:" << params.fuse_outputs << "\n";
 
     // Start a timer
     HALIDE_TIC;
@@ -546,8 +722,24 @@ void generate_schedule(const std::vector<Function> &outputs,
     // Options generated from environment variables, decide whether or not to cache features and/or tilings.
     CachingOptions cache_options = CachingOptions::MakeOptionsFromParams(params);
 
-    // Run beam search
-    optimal = optimal_schedule(dag, outputs, params, cost_model.get(), rng, cache_options);
+    // Reuse the result of an earlier search if there is one.
+    const bool use_schedule_cache = !params.schedule_cache_dir.empty();
+    uint64_t cache_key = 0;
+    if (use_schedule_cache) {
+        cache_key = schedule_cache_key(dag, target, params);
+        optimal = replay_cached_schedule(dag, params, cache_key, cache_options);
+        if (optimal.defined()) {
+            aslog(1) << "Reusing the schedule found in " << params.schedule_cache_dir << "\n";
+            configure_pipeline_features(dag, params, cost_model.get());
+        }
+    }
+    const bool found_in_cache = optimal.defined();
+
+    if (!found_in_cache) {
+        // Run beam search
+        optimal = optimal_schedule(dag, outputs, params, cost_model.get(), rng, cache_options);
+    }
+    const double optimal_cost = optimal->cost;
 
     HALIDE_TOC;
 
@@ -567,13 +759,31 @@ void generate_schedule(const std::vector<Function> &outputs,
         optimal->dump(aslog(2).get_ostream());
     }
 
+    const bool save_to_cache = use_schedule_cache && !found_in_cache;
+    std::string featurization;
+    if (auto_scheduler_results || save_to_cache) {
+        std::ostringstream out;
+        optimal->save_featurization(dag, params, cache_options, out);
+        featurization = out.str();
+    }
+
     if (auto_scheduler_results) {
         auto_scheduler_results->schedule_source = optimal->schedule_source;
-        {
-            std::ostringstream out;
-            optimal->save_featurization(dag, params, cache_options, out);
-            auto_scheduler_results->featurization.resize(out.str().size());
-            memcpy(auto_scheduler_results->featurization.data(), out.str().data(), out.str().size());
+        auto_scheduler_results->featurization.resize(featurization.size());
+        memcpy(auto_scheduler_results->featurization.data(), featurization.data(), featurization.size());
+    }
+
+    if (save_to_cache) {
+        CachedSchedule cached;
+        cached.cost = optimal_cost;
+        for (const State *s = optimal.get(); s->parent.defined(); s = s->parent.get()) {
+            cached.decisions.push_back(s->structural_hash(kCachedScheduleHashDepth));
+        }
+        std::reverse(cached.decisions.begin(), cached.decisions.end());
+        cached.featurization.assign(featurization.begin(), featurization.end());
+        cached.schedule_source = optimal->schedule_source;
+        if (!save_cached_schedule(params.schedule_cache_dir, cache_key, cached)) {
+            aslog(1) << "Warning: Could not write to the schedule cache in " << params.schedule_cache_dir << "\n";
         }
     }
 }
@@ -587,9 +797,12 @@ struct Adams2019 {
             outputs.push_back(f.function());
         }
         Adams2019Params params;
+        // The defaults taken from the host, to record in the results.
+        std::map<std::string, std::string> host_defaults;
         {
             ParamParser parser(params_in.extra);
-            parser.parse("parallelism", &params.parallelism);
+            parser.parse_or_default("parallelism", &params.parallelism, host_properties_for(target).cores,
+                                    &host_defaults);
             parser.parse("beam_size", &params.beam_size);
             parser.parse("random_dropout", &params.random_dropout);
             parser.parse("random_dropout_seed", &params.random_dropout_seed);
@@ -598,10 +811,14 @@ struct Adams2019 {
             parser.parse("disable_memoized_features", &params.disable_memoized_features);
             parser.parse("disable_memoized_blocks", &params.disable_memoized_blocks);
             parser.parse("memory_limit", &params.memory_limit);
+            parser.parse("search_threads", &params.search_threads);
+            parser.parse("schedule_cache_dir", &params.schedule_cache_dir);
+            parser.parse("fuse_outputs", &params.fuse_outputs);
             parser.finish();
         }
         Autoscheduler::generate_schedule(outputs, target, params, results);
         results->autoscheduler_params = params_in;
+        results->autoscheduler_params.extra.insert(host_defaults.begin(), host_defaults.end());
     }
 };
 
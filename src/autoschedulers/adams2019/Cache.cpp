@@ -71,15 +71,16 @@ bool Cache::add_memoized_blocks(const State *state,
     return true;
 }
 
-void Cache::memoize_blocks(const FunctionDAG::Node *node, LoopNest *new_root) {
-    if (!options.cache_blocks) {
+void Cache::memoize_blocks(const PendingBlocks &pending) {
+    if (!options.cache_blocks || pending.roots.empty()) {
         return;
     }
 
+    const FunctionDAG::Node *node = pending.node;
     int vector_dim = -1;
     bool loop_nest_found = false;
 
-    for (auto &child : new_root->children) {
+    for (const auto &child : pending.roots[0]->children) {
         if (child->node == node && child->stage->index == 0) {
             vector_dim = child->vector_dim;
             loop_nest_found = true;
@@ -89,16 +90,23 @@ void Cache::memoize_blocks(const FunctionDAG::Node *node, LoopNest *new_root) {
 
     internal_assert(loop_nest_found) << "memoize_blocks did not find loop nest!\n";
 
-    auto &blocks = memoized_compute_root_blocks.get_or_create(node)[vector_dim];
-
-    for (auto &child : new_root->children) {
-        if (child->node == node) {
-            // Need const reference for copy.
-            const LoopNest *child_ptr = child.get();
-            LoopNest *new_block = new LoopNest;
-            new_block->copy_from_including_features(*child_ptr);
-            blocks.emplace_back(new_block);
-            cache_misses++;
+    auto &vector_dim_map = memoized_compute_root_blocks.get_or_create(node);
+    if (vector_dim_map.count(vector_dim)) {
+        // An earlier State in the same step generated these tilings too.
+        return;
+    }
+    auto &blocks = vector_dim_map[vector_dim];
+
+    for (const auto &new_root : pending.roots) {
+        for (const auto &child : new_root->children) {
+            if (child->node == node) {
+                // Need const reference for copy.
+                const LoopNest *child_ptr = child.get();
+                LoopNest *new_block = new LoopNest;
+                new_block->copy_from_including_features(*child_ptr);
+                blocks.emplace_back(new_block);
+                cache_misses++;
+            }
         }
     }
 }
@@ -8,6 +8,7 @@
 #include "Halide.h"
 #include "LoopNest.h"
 #include "PerfectHashMap.h"
+#include <atomic>
 
 namespace Halide {
 namespace Internal {
@@ -63,7 +64,8 @@ namespace Autoscheduler {
     then tilings are not generated again, and the cached tilings are used instead. See
     Cache::add_memoized_blocks below (and in Cache.cpp).
     Additionally, if a tiling has not been cached, and it is not pruned, then the tiling will be
-    cached using Cache::memoize_blocks (see below and in Cache.cpp).
+    collected in a PendingBlocks, and cached using Cache::memoize_blocks (see below and in Cache.cpp)
+    once all the States of the current step of beam search have been expanded.
 */
 
 struct State;
@@ -88,6 +90,15 @@ struct CachingOptions {
 // Node -> (vector_dim -> vector<tiled LoopNest>)
 using BlockCache = NodeMap<std::map<int, std::vector<IntrusivePtr<const LoopNest>>>>;
 
+// The tilings generated by one call to State::generate_children, to be
+// memoized once every State in the current step of beam search has been
+// expanded. The States of a step may be expanded in any order (and on
+// several threads), so the Cache is only modified between steps.
+struct PendingBlocks {
+    const FunctionDAG::Node *node = nullptr;
+    std::vector<IntrusivePtr<const LoopNest>> roots;
+};
+
 // Cache for memoizing possible tilings.
 // Tracks hit/miss statistics for both block caching
 // and for feature caching (self-contained by LoopNests).
@@ -95,8 +106,8 @@ struct Cache {
     CachingOptions options;
     BlockCache memoized_compute_root_blocks;
 
-    mutable size_t cache_hits = 0;
-    mutable size_t cache_misses = 0;
+    mutable std::atomic<size_t> cache_hits{0};
+    std::atomic<size_t> cache_misses{0};
 
     Cache() = delete;
     Cache(const CachingOptions &_options, size_t nodes_size)
@@ -119,8 +130,10 @@ struct Cache {
                              const Adams2019Params &params,
                              CostModel *cost_model) const;
 
-    // Generate tilings for a specific vector dimension and memoize them.
-    void memoize_blocks(const FunctionDAG::Node *node, LoopNest *new_root);
+    // Memoize the tilings for a specific vector dimension, unless tilings
+    // for it have been memoized already. Must not be called while States
+    // are being expanded.
+    void memoize_blocks(const PendingBlocks &pending);
 };
 
 }  // namespace Autoscheduler
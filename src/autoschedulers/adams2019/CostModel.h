@@ -17,7 +17,8 @@ namespace Autoscheduler {
 typedef PerfectHashMap<FunctionDAG::Node::Stage, ScheduleFeatures> StageMapOfScheduleFeatures;
 
 struct Adams2019Params {
-    /** Maximum level of parallelism available. */
+    /** Maximum level of parallelism available. Defaults to the number
+     * of cores of the host when compiling for it, and 16 otherwise. */
     int parallelism = 16;
 
     /** Beam size to use in the beam search. Defaults to 32. Use 1 to get a greedy search instead.
@@ -53,6 +54,19 @@ struct Adams2019Params {
     /** If >= 0, only consider schedules that allocate at most this much memory (measured in bytes).
      * Formerly HL_AUTOSCHEDULE_MEMORY_LIMIT */
     int64_t memory_limit = -1;
+
+    /** Number of threads used to expand the states of the beam search. If 0, use one per core.
+     * The schedule found does not depend on this. */
+    int search_threads = 1;
+
+    /** If set, a directory in which to keep the schedules found, keyed on a hash of the pipeline,
+     * its estimates, the target, and the parameters above. A later search for the same pipeline
+     * reuses the schedule stored there instead of searching again. */
+    std::string schedule_cache_dir;
+
+    /** If set to nonzero value: fuse the outermost loops of outputs that are computed from a common
+     * intermediate (with compute_with), when the schedule found gives them the same outermost loop. */
+    int fuse_outputs = 0;
 };
 
 }  // namespace Autoscheduler
@@ -31,6 +31,13 @@ using Halide::Internal::PipelineFeatures;
 using Halide::Internal::ScheduleFeatures;
 using Halide::Runtime::Buffer;
 
+// The queue of schedules to evaluate starts out with room for this many.
+constexpr int min_batch_size = 1024;
+
+// The queue grows beyond min_batch_size as long as the schedule features
+// fit in this many bytes.
+constexpr int64_t max_queue_bytes = 256 * 1024 * 1024;
+
 bool ends_with(const std::string &str, const std::string &suffix) {
     if (str.size() < suffix.size()) {
         return false;
@@ -143,20 +150,34 @@ void DefaultCostModel::enqueue(int ns, Runtime::Buffer<float> *schedule_feats, d
         << "schedule features has more stages (" << num_stages
         << ") than pipeline features (" << max_num_stages << ")\n";
 
-    const int batch_size = 1024;
     if (!schedule_feat_queue.data() ||
         schedule_feat_queue.dim(2).extent() < max_num_stages) {
         internal_assert(cursor == 0);
-        schedule_feat_queue = Runtime::Buffer<float>(batch_size, head2_w, max_num_stages);
-        if (!costs.data()) {
-            internal_assert(!cost_ptrs.data());
-            costs = Runtime::Buffer<float>(batch_size);
-            cost_ptrs = Runtime::Buffer<double *>(batch_size);
-        }
+        schedule_feat_queue = Runtime::Buffer<float>(min_batch_size, head2_w, max_num_stages);
+        costs = Runtime::Buffer<float>(min_batch_size);
+        cost_ptrs = Runtime::Buffer<double *>(min_batch_size);
     }
 
-    if (cursor == batch_size) {
-        evaluate_costs();
+    if (cursor == schedule_feat_queue.dim(0).extent()) {
+        // Grow the queue rather than evaluating a partial step of the
+        // search, as long as it fits in the memory budget. Larger
+        // batches amortize the overhead of each call to the cost model.
+        const int64_t bytes_per_schedule = (int64_t)sizeof(float) * head2_w * max_num_stages;
+        const int max_batch_size = (int)std::max<int64_t>(min_batch_size, max_queue_bytes / bytes_per_schedule);
+        if (cursor < max_batch_size) {
+            const int batch_size = std::min(cursor * 2, max_batch_size);
+            Runtime::Buffer<float> new_schedule_feat_queue(batch_size, head2_w, max_num_stages);
+            new_schedule_feat_queue.copy_from(schedule_feat_queue);
+            schedule_feat_queue = std::move(new_schedule_feat_queue);
+            Runtime::Buffer<double *> new_cost_ptrs(batch_size);
+            for (int i = 0; i < cursor; i++) {
+                new_cost_ptrs(i) = cost_ptrs(i);
+            }
+            cost_ptrs = std::move(new_cost_ptrs);
+            costs = Runtime::Buffer<float>(batch_size);
+        } else {
+            evaluate_costs();
+        }
     }
 
     *schedule_feats = schedule_feat_queue.sliced(0, cursor);
@@ -113,7 +113,10 @@ void LoopNest::copy_from(const LoopNest &n) {
     children = n.children;
     inlined = n.inlined;
     store_at = n.store_at;
-    bounds = n.bounds;
+    {
+        std::lock_guard<std::mutex> lock(n.mutex);
+        bounds = n.bounds;
+    }
     node = n.node;
     stage = n.stage;
     innermost = n.innermost;
@@ -309,6 +312,10 @@ void LoopNest::compute_features(const FunctionDAG &dag,
     }
 
     if (is_root()) {
+        // Features of children that weren't in their features cache,
+        // to be added to it once they are complete.
+        std::vector<std::pair<const LoopNest *, StageMap<ScheduleFeatures>>> new_cache_entries;
+
         // TODO: This block of code is repeated below. Refactor
         for (const auto &c : children) {
 
@@ -316,8 +323,10 @@ void LoopNest::compute_features(const FunctionDAG &dag,
 
             if (use_cached_features) {
                 // Checks if the features cache has seen this state before, and use the cached features if so.
-                if (c->features_cache.count(hash_of_producers) > 0) {
-                    const auto &entry = c->features_cache.at(hash_of_producers);
+                std::unique_lock<std::mutex> lock(c->mutex);
+                auto cached = c->features_cache.find(hash_of_producers);
+                if (cached != c->features_cache.end()) {
+                    const auto &entry = cached->second;
 
                     for (auto it = entry.begin(); it != entry.end(); it++) {
                         const auto *stage_ptr = it.key();
@@ -325,6 +334,7 @@ void LoopNest::compute_features(const FunctionDAG &dag,
 
                         features->insert(stage_ptr, feat);
                     }
+                    lock.unlock();
 
                     // 'working_set_here' is required below for computing the
                     // root-level features so we compute the value that it
@@ -341,8 +351,10 @@ void LoopNest::compute_features(const FunctionDAG &dag,
 
             if (use_cached_features) {
                 // Cache these features for future reference.
-                c->features_cache[hash_of_producers].make_large(dag.nodes[0].stages[0].max_id);
-                c->memoize_features(c->features_cache[hash_of_producers], features);
+                new_cache_entries.emplace_back(c.get(), StageMap<ScheduleFeatures>());
+                auto &entry = new_cache_entries.back().second;
+                entry.make_large(dag.nodes[0].stages[0].max_id);
+                c->memoize_features(entry, features);
             }
         }
 
@@ -416,7 +428,8 @@ void LoopNest::compute_features(const FunctionDAG &dag,
         }
 
         if (use_cached_features) {
-            for (const auto &c : children) {
+            for (auto &it : new_cache_entries) {
+                const LoopNest *c = it.first;
                 uint64_t hash_of_producers = sites.get(c->stage).hash_of_producers_stored_at_root;
 
                 // When computing feat.points_computed_minimum above, the order
@@ -425,9 +438,12 @@ void LoopNest::compute_features(const FunctionDAG &dag,
                 // may not have been computed when it is accessed as a memoized
                 // feature. We memoize 'points_computed_minimum' here to ensure
                 // its value is always available
-                if (c->features_cache.count(hash_of_producers) > 0) {
-                    c->memoize_points_computed_minimum(c->features_cache[hash_of_producers], features);
-                }
+                c->memoize_points_computed_minimum(it.second, features);
+
+                // Only now that the entry is complete can other threads
+                // see it. If one got there first, its entry is the same.
+                std::lock_guard<std::mutex> lock(c->mutex);
+                c->features_cache.emplace(hash_of_producers, std::move(it.second));
             }
             recompute_inlined_features(sites, features);
         }
@@ -1000,6 +1016,7 @@ void LoopNest::compute_features(const FunctionDAG &dag,
         if (use_cached_features) {
             const auto &block = sites.get(stage).task;
             uint64_t hash_of_producers = sites.get(block->stage).hash_of_producers_stored_at_root;
+            std::lock_guard<std::mutex> lock(block->mutex);
             auto &intermediate_map = block->feature_intermediates_cache[hash_of_producers].get_or_create(&(f->stages[0]));
             auto &intermediate = intermediate_map.get_or_create(stage);
 
@@ -1014,12 +1031,15 @@ void LoopNest::compute_features(const FunctionDAG &dag,
 // Get the region required of a Func at this site, from which we
 // know what region would be computed if it were scheduled here,
 // and what its loop nest would be.
-const Bound &LoopNest::get_bounds(const FunctionDAG::Node *f) const {
-    if (bounds.contains(f)) {
-        const Bound &b = bounds.get(f);
-        // Expensive validation for debugging
-        // b->validate();
-        return b;
+Bound LoopNest::get_bounds(const FunctionDAG::Node *f) const {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (bounds.contains(f)) {
+            const Bound &b = bounds.get(f);
+            // Expensive validation for debugging
+            // b->validate();
+            return b;
+        }
     }
     auto *bound = f->make_bound();
 
@@ -1070,7 +1090,9 @@ const Bound &LoopNest::get_bounds(const FunctionDAG::Node *f) const {
         f->loop_nest_for_region(i, &(bound->region_computed(0)), &(bound->loops(i, 0)));
     }
 
-    const Bound &b = set_bounds(f, bound);
+    // If another thread got here first, this replaces its (identical)
+    // bounds.
+    Bound b = set_bounds(f, bound);
     // Validation is expensive, turn if off by default.
     // b->validate();
     return b;
@@ -1365,7 +1387,10 @@ IntrusivePtr<const LoopNest> LoopNest::parallelize_in_tiles(const Adams2019Param
     inner->innermost = innermost;
     inner->children = children;
     inner->inlined = inlined;
-    inner->bounds = bounds;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        inner->bounds = bounds;
+    }
     inner->store_at = store_at;
 
     auto *b = inner->get_bounds(node)->make_copy();
@@ -1539,7 +1564,10 @@ vector<IntrusivePtr<const LoopNest>> LoopNest::compute_in_tiles(const FunctionDA
             inner->innermost = innermost;
             inner->children = children;
             inner->inlined = inlined;
-            inner->bounds = bounds;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                inner->bounds = bounds;
+            }
             inner->store_at = store_at;
 
             {
@@ -1949,8 +1977,6 @@ void LoopNest::copy_from_including_features(const LoopNest &n) {
     size = n.size;
     children = n.children;
     inlined = n.inlined;
-    store_at = n.store_at;
-    bounds = n.bounds;
     node = n.node;
     stage = n.stage;
     innermost = n.innermost;
@@ -1958,6 +1984,9 @@ void LoopNest::copy_from_including_features(const LoopNest &n) {
     parallel = n.parallel;
     vector_dim = n.vector_dim;
     vectorized_loop_index = n.vectorized_loop_index;
+
+    std::lock_guard<std::mutex> lock(n.mutex);
+    bounds = n.bounds;
     features_cache = n.features_cache;
     feature_intermediates_cache = n.feature_intermediates_cache;
 }
@@ -2033,9 +2062,13 @@ void LoopNest::recompute_inlined_features(const StageMap<Sites> &sites, StageMap
         internal_assert(sites.contains(block->stage));
         uint64_t hash_of_producers = sites.get(block->stage).hash_of_producers_stored_at_root;
 
-        internal_assert(block->feature_intermediates_cache.count(hash_of_producers) > 0);
-        auto &intermediate_map = block->feature_intermediates_cache[hash_of_producers].get(&(f->stages[0]));
-        auto &intermediate = intermediate_map.get(stage);
+        FeatureIntermediates intermediate;
+        {
+            std::lock_guard<std::mutex> lock(block->mutex);
+            internal_assert(block->feature_intermediates_cache.count(hash_of_producers) > 0);
+            const auto &intermediate_map = block->feature_intermediates_cache[hash_of_producers].get(&(f->stages[0]));
+            intermediate = intermediate_map.get(stage);
+        }
 
         auto &inlined_feat = features->get(&(f->stages[0]));
         inlined_feat.inlined_calls += intermediate.inlined_calls;
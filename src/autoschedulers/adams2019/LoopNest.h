@@ -9,6 +9,7 @@
 #include "FunctionDAG.h"
 #include "PerfectHashMap.h"
 #include <map>
+#include <mutex>
 #include <set>
 #include <utility>
 #include <vector>
@@ -53,6 +54,11 @@ struct LoopNest {
     // little boxes to the left of the loop nest tree figures.
     mutable NodeMap<Bound> bounds;
 
+    // Guards the caches that are filled in lazily on a LoopNest that
+    // may be shared between states being expanded on different
+    // threads: bounds, features_cache and feature_intermediates_cache.
+    mutable std::mutex mutex;
+
     // The Func this loop nest belongs to
     const FunctionDAG::Node *node = nullptr;
 
@@ -145,14 +151,16 @@ struct LoopNest {
     }
 
     // Set the region required of a Func at this site.
-    const Bound &set_bounds(const FunctionDAG::Node *f, BoundContents *b) const {
+    Bound set_bounds(const FunctionDAG::Node *f, BoundContents *b) const {
+        std::lock_guard<std::mutex> lock(mutex);
         return bounds.emplace(f, b);
     }
 
     // Get the region required of a Func at this site, from which we
     // know what region would be computed if it were scheduled here,
-    // and what its loop nest would be.
-    const Bound &get_bounds(const FunctionDAG::Node *f) const;
+    // and what its loop nest would be. Returned by value, as the
+    // cache may be added to by another thread.
+    Bound get_bounds(const FunctionDAG::Node *f) const;
 
     // Recursively print a loop nest representation to stderr
     void dump(std::ostream &os, string prefix, const LoopNest *parent) const;
@@ -0,0 +1,209 @@
+#include "ScheduleCache.h"
+
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include <sstream>
+
+#include "Featurization.h"
+
+namespace Halide {
+namespace Internal {
+namespace Autoscheduler {
+
+namespace {
+
+constexpr uint32_t kSignature = 0x68736331;  // 'hsc1'
+
+// 64-bit FNV-1a, which unlike std::hash is the same everywhere.
+struct Hasher {
+    uint64_t h = 0xcbf29ce484222325ULL;
+
+    void add(const void *data, size_t size) {
+        const uint8_t *bytes = (const uint8_t *)data;
+        for (size_t i = 0; i < size; i++) {
+            h ^= bytes[i];
+            h *= 0x100000001b3ULL;
+        }
+    }
+
+    void add(const std::string &s) {
+        add(s.data(), s.size());
+        add((uint64_t)s.size());
+    }
+
+    void add(int64_t x) {
+        add(&x, sizeof(x));
+    }
+
+    void add(uint64_t x) {
+        add(&x, sizeof(x));
+    }
+};
+
+std::string entry_path(const std::string &dir, uint64_t key) {
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx", (unsigned long long)key);
+    return dir + "/" + name + ".schedule_cache";
+}
+
+}  // namespace
+
+/*
+    Structure of a .schedule_cache file:
+
+    uint32 signature                    always 0x68736331 ('hsc1')
+    uint64 key
+    float64 cost
+    uint32 decision-count
+        uint64x(decision-count)         structural hash
+    uint64 featurization-size
+        uint8x(featurization-size)      featurization
+    uint64 schedule-source-size
+        char8x(schedule-source-size)    schedule source
+
+    (all values little-endian)
+*/
+
+uint64_t schedule_cache_key(const FunctionDAG &dag, const Target &target, const Adams2019Params &params) {
+    Hasher hasher;
+
+    hasher.add((int64_t)PipelineFeatures::version());
+    hasher.add((int64_t)ScheduleFeatures::version());
+    hasher.add(target.to_string());
+
+    // The dump covers the structure of the DAG, the loop bounds (which
+    // have the estimates applied), and the pipeline features. The
+    // estimates of the outputs are kept separately.
+    std::ostringstream dag_dump;
+    dag.dump(dag_dump);
+    hasher.add(dag_dump.str());
+    for (const auto &n : dag.nodes) {
+        for (const auto &s : n.estimated_region_required) {
+            hasher.add(s.min());
+            hasher.add(s.max());
+        }
+    }
+
+    // Everything that changes the result of the search. (The
+    // search_threads and caching parameters don't.)
+    hasher.add((int64_t)params.parallelism);
+    hasher.add((int64_t)params.beam_size);
+    hasher.add((int64_t)params.random_dropout);
+    hasher.add((int64_t)params.random_dropout_seed);
+    hasher.add(params.weights_path);
+    hasher.add((int64_t)params.disable_subtiling);
+    hasher.add(params.memory_limit);
+    hasher.add(get_env_variable("HL_NUM_PASSES"));
+    hasher.add(get_env_variable("HL_RANDOMIZE_WEIGHTS"));
+
+    return hasher.h;
+}
+
+bool load_cached_schedule(const std::string &dir, uint64_t key, CachedSchedule *schedule) {
+    std::ifstream i(entry_path(dir, key), std::ios_base::binary);
+    if (i.fail()) {
+        return false;
+    }
+
+    uint32_t signature;
+    i.read((char *)&signature, sizeof(signature));
+    if (i.fail() || signature != kSignature) {
+        return false;
+    }
+
+    // Guard against a collision of the file names.
+    uint64_t stored_key;
+    i.read((char *)&stored_key, sizeof(stored_key));
+    if (i.fail() || stored_key != key) {
+        return false;
+    }
+
+    i.read((char *)&schedule->cost, sizeof(schedule->cost));
+    if (i.fail()) {
+        return false;
+    }
+
+    uint32_t decision_count;
+    i.read((char *)&decision_count, sizeof(decision_count));
+    if (i.fail()) {
+        return false;
+    }
+    schedule->decisions.resize(decision_count);
+    i.read((char *)schedule->decisions.data(), decision_count * sizeof(uint64_t));
+    if (i.fail()) {
+        return false;
+    }
+
+    uint64_t featurization_size;
+    i.read((char *)&featurization_size, sizeof(featurization_size));
+    if (i.fail()) {
+        return false;
+    }
+    schedule->featurization.resize(featurization_size);
+    i.read((char *)schedule->featurization.data(), featurization_size);
+    if (i.fail()) {
+        return false;
+    }
+
+    uint64_t source_size;
+    i.read((char *)&source_size, sizeof(source_size));
+    if (i.fail()) {
+        return false;
+    }
+    schedule->schedule_source.resize(source_size);
+    i.read(&schedule->schedule_source[0], source_size);
+    if (i.fail()) {
+        return false;
+    }
+
+    return true;
+}
+
+bool save_cached_schedule(const std::string &dir, uint64_t key, const CachedSchedule &schedule) {
+    // Write to a temporary file and then rename it into place, so that
+    // generators running concurrently never see a partial entry.
+    const std::string path = entry_path(dir, key);
+    std::ostringstream tmp_path;
+    tmp_path << path << "." << std::hex << std::random_device()() << ".tmp";
+
+    {
+        std::ofstream o(tmp_path.str(), std::ios_base::binary | std::ios_base::trunc);
+        if (o.fail()) {
+            return false;
+        }
+
+        const uint32_t signature = kSignature;
+        o.write((const char *)&signature, sizeof(signature));
+        o.write((const char *)&key, sizeof(key));
+        o.write((const char *)&schedule.cost, sizeof(schedule.cost));
+
+        const uint32_t decision_count = (uint32_t)schedule.decisions.size();
+        o.write((const char *)&decision_count, sizeof(decision_count));
+        o.write((const char *)schedule.decisions.data(), decision_count * sizeof(uint64_t));
+
+        const uint64_t featurization_size = schedule.featurization.size();
+        o.write((const char *)&featurization_size, sizeof(featurization_size));
+        o.write((const char *)schedule.featurization.data(), featurization_size);
+
+        const uint64_t source_size = schedule.schedule_source.size();
+        o.write((const char *)&source_size, sizeof(source_size));
+        o.write(schedule.schedule_source.data(), source_size);
+
+        if (o.fail()) {
+            o.close();
+            std::remove(tmp_path.str().c_str());
+            return false;
+        }
+    }
+
+    if (std::rename(tmp_path.str().c_str(), path.c_str()) != 0) {
+        std::remove(tmp_path.str().c_str());
+        return false;
+    }
+    return true;
+}
+
+}  // namespace Autoscheduler
+}  // namespace Internal
+}  // namespace Halide
@@ -0,0 +1,66 @@
+#ifndef SCHEDULE_CACHE_H
+#define SCHEDULE_CACHE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "CostModel.h"
+#include "FunctionDAG.h"
+#include "Halide.h"
+
+namespace Halide {
+namespace Internal {
+namespace Autoscheduler {
+
+/*
+  A cache of the schedules found by the search, kept in a directory on disk
+  (Adams2019Params::schedule_cache_dir) so that runs on an unchanged pipeline
+  don't need to search again.
+
+  Entries are keyed on a hash of the FunctionDAG, which includes the
+  estimates, along with the target and the parameters that affect the
+  search. A schedule is stored as the structural hash of each State on the
+  path from the initial State to the best one, so that it can be rebuilt by
+  regenerating the children of each State along the path, which is far
+  cheaper than a search. The featurization is stored as well, to check that
+  the rebuilt State is the one that was found, as is the schedule source
+  for reference.
+*/
+
+// The depth passed to State::structural_hash for the decisions. Deep
+// enough to cover every loop of the loop nest.
+constexpr int kCachedScheduleHashDepth = 1000;
+
+struct CachedSchedule {
+    // Cost of the State found, as evaluated by the cost model.
+    double cost = 0;
+
+    // The structural hashes of the States on the path from the initial
+    // State (exclusive) to the one found (inclusive).
+    std::vector<uint64_t> decisions;
+
+    // The featurization of the State found, as saved by
+    // State::save_featurization.
+    std::vector<uint8_t> featurization;
+
+    // The schedule source generated for the State found.
+    std::string schedule_source;
+};
+
+// Compute the key of the cache entry for a pipeline.
+uint64_t schedule_cache_key(const FunctionDAG &dag, const Target &target, const Adams2019Params &params);
+
+// Load the cache entry with the given key. Returns false if there
+// isn't a valid one.
+bool load_cached_schedule(const std::string &dir, uint64_t key, CachedSchedule *schedule);
+
+// Store the cache entry with the given key, replacing any existing
+// one. Returns false if it couldn't be written.
+bool save_cached_schedule(const std::string &dir, uint64_t key, const CachedSchedule &schedule);
+
+}  // namespace Autoscheduler
+}  // namespace Internal
+}  // namespace Halide
+
+#endif  // SCHEDULE_CACHE_H
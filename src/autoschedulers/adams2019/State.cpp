@@ -203,7 +203,8 @@ void State::generate_children(const FunctionDAG &dag,
                               const Adams2019Params &params,
                               CostModel *cost_model,
                               std::function<void(IntrusivePtr<State> &&)> &accept_child,
-                              Cache *cache) const {
+                              const Cache *cache,
+                              PendingBlocks *pending_blocks) const {
 
     internal_assert(root.defined() && root->is_root()) << "generate_children needs defined root\n";
 
@@ -512,8 +513,10 @@ void State::generate_children(const FunctionDAG &dag,
                 if (child->calculate_cost(dag, params, cost_model, cache->options)) {
                     num_children++;
                     accept_child(std::move(child));
-                    // Will early return if block caching is not enabled.
-                    cache->memoize_blocks(node, new_root);
+                    if (cache->options.cache_blocks) {
+                        pending_blocks->node = node;
+                        pending_blocks->roots.emplace_back(new_root);
+                    }
                 }
             }
         }
@@ -584,6 +587,16 @@ void State::apply_schedule(const FunctionDAG &dag, const Adams2019Params &params
         }
     }
 
+    // The outermost loop of each output, for fusing outputs with compute_with.
+    struct OutermostLoop {
+        const FunctionDAG::Node::Stage *stage;
+        LoopNest::StageScheduleState *schedule;
+        VarOrRVar var;
+        int64_t extent;
+        bool parallel;
+    };
+    vector<OutermostLoop> output_loops;
+
     for (auto &[stage_ptr, schedule] : state_map) {
         if (stage_ptr->node->is_input) {
             continue;
@@ -650,6 +663,25 @@ void State::apply_schedule(const FunctionDAG &dag, const Adams2019Params &params
             }
         }
 
+        if (params.fuse_outputs && stage_ptr->node->is_output && stage_ptr->node->stages.size() == 1) {
+            if (can_fuse && !parallel_vars.empty()) {
+                int64_t extent = 1;
+                for (const auto &func_var : schedule->vars) {
+                    if (func_var.exists && func_var.parallel) {
+                        extent *= func_var.extent;
+                    }
+                }
+                output_loops.push_back({stage_ptr, schedule.get(), parallel_vars.back(), extent, true});
+            } else if (parallel_vars.empty()) {
+                for (const auto &func_var : reverse_view(schedule->vars)) {
+                    if (func_var.exists) {
+                        output_loops.push_back({stage_ptr, schedule.get(), func_var.var, func_var.extent, false});
+                        break;
+                    }
+                }
+            }
+        }
+
         // Reorder the vector dimension innermost
         if (stage_ptr->index == 0 && schedule->vector_dim > 0) {
             vector<Var> storage_vars = Func(stage_ptr->node->func).args();
@@ -668,8 +700,52 @@ void State::apply_schedule(const FunctionDAG &dag, const Adams2019Params &params
             schedule->schedule_source << ")";
             Func(stage_ptr->node->func).reorder_storage(storage_vars);
         }
+    }
+
+    // Fuse the outermost loops of outputs computed from a common
+    // intermediate, so that each tile of the intermediate is used by all
+    // of them while it is still in cache, instead of the intermediate
+    // being traversed once per output. Halide requires the fused loops to
+    // match exactly.
+    vector<bool> fused(output_loops.size(), false);
+    for (size_t i = 0; i < output_loops.size(); i++) {
+        const OutermostLoop &child = output_loops[i];
+        for (size_t j = 0; j < i; j++) {
+            const OutermostLoop &parent = output_loops[j];
+            if (fused[j] ||
+                parent.var.name() != child.var.name() ||
+                parent.var.is_rvar || child.var.is_rvar ||
+                parent.extent != child.extent ||
+                parent.parallel != child.parallel ||
+                child.stage->downstream_of(*parent.stage->node) ||
+                parent.stage->downstream_of(*child.stage->node)) {
+                continue;
+            }
+            bool common_intermediate = false;
+            for (const auto &n : dag.nodes) {
+                if (!n.is_input &&
+                    child.stage->downstream_of(n) &&
+                    parent.stage->downstream_of(n)) {
+                    common_intermediate = true;
+                    break;
+                }
+            }
+            if (!common_intermediate) {
+                continue;
+            }
+            child.schedule->schedule_source << "\n    .compute_with(" << parent.stage->name
+                                            << ", " << parent.var.name() << ")";
+            Stage(child.stage->stage).compute_with(parent.stage->stage, parent.var);
+            fused[i] = true;
+            break;
+        }
+    }
 
-        // Dump the schedule source string
+    // Dump the schedule source strings
+    for (auto &[stage_ptr, schedule] : state_map) {
+        if (stage_ptr->node->is_input) {
+            continue;
+        }
         src << stage_ptr->name
             << schedule->schedule_source.str()
             << ";\n";
@@ -686,7 +762,7 @@ void State::apply_schedule(const FunctionDAG &dag, const Adams2019Params &params
 }
 
 // Keep track of how many times we evaluated a state.
-int State::cost_calculations = 0;
+std::atomic<int> State::cost_calculations{0};
 
 }  // namespace Autoscheduler
 }  // namespace Internal
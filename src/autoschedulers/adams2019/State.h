@@ -9,6 +9,7 @@
 #include "Halide.h"
 #include "LoopNest.h"
 #include "PerfectHashMap.h"
+#include <atomic>
 #include <map>
 #include <utility>
 
@@ -37,7 +38,7 @@ struct State {
 
     // The number of times a cost is enqueued into the cost model,
     // for all states.
-    static int cost_calculations;
+    static std::atomic<int> cost_calculations;
 
     State() = default;
     State(const State &) = delete;
@@ -77,12 +78,16 @@ struct State {
 
     // Generate the successor states to this state.
     // If they are not pruned by `calculate_cost()`,
-    // then calls `accept_child()` on them.
+    // then calls `accept_child()` on them. Newly generated
+    // tilings that should be memoized are added to `pending_blocks`,
+    // rather than to `cache`, so this may be called for several
+    // states at once.
     void generate_children(const FunctionDAG &dag,
                            const Adams2019Params &params,
                            CostModel *cost_model,
                            std::function<void(IntrusivePtr<State> &&)> &accept_child,
-                           Cache *cache) const;
+                           const Cache *cache,
+                           PendingBlocks *pending_blocks) const;
 
     // Dumps cost, the `root` LoopNest, and then `schedule_source` to `os`.
     void dump(std::ostream &os) const;
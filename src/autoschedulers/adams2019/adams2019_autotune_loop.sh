@@ -3,6 +3,21 @@
 # Build the generator to autotune. This script will be autotuning the
 # autoscheduler's cost model training pipeline, which is large enough
 # to be interesting.
+#
+# Compilation and benchmarking can be farmed out to other machines by
+# listing ssh destinations in HL_AUTOTUNE_COMPILE_WORKERS and
+# HL_AUTOTUNE_BENCHMARK_WORKERS (space-separated). Each entry runs one job
+# at a time, so list a host more than once to run several compilations
+# on it at once. The workers must see the samples directory, the
+# generator, the autoscheduler and the Halide distribution at the same
+# paths as this machine (e.g. via a shared filesystem). Benchmark workers
+# should all be of the machine type being trained for.
+#
+# Set HL_AUTOTUNE_PERF_COUNTERS=1 to also record hardware performance
+# counters (LLC misses, branch misses, etc) in the bench.txt of each
+# sample, for pipelines where runtime alone says little about why one
+# schedule beats another. This requires Linux, and perf_event_paranoid
+# set low enough to allow it.
 if [ $# -lt 6 -o $# -gt 8 ]; then
   echo "Usage: $0 /path/to/some.generator generatorname halide_target weights_file autoschedule_bin_dir halide_distrib_path samples_out_path [generator_args_sets]"
   exit
@@ -35,6 +50,14 @@ if [ ${#GENERATOR_ARGS_SETS_ARRAY[@]} -eq 0 ]; then
     GENERATOR_ARGS_SETS_ARRAY=( '' )
 fi
 
+COMPILE_WORKERS=${HL_AUTOTUNE_COMPILE_WORKERS:-}
+BENCHMARK_WORKERS=${HL_AUTOTUNE_BENCHMARK_WORKERS:-}
+
+PERF_COUNTERS_FLAG=
+if [ "${HL_AUTOTUNE_PERF_COUNTERS:-0}" = "1" ]; then
+    PERF_COUNTERS_FLAG=--perf_counters
+fi
+
 COMPILATION_TIMEOUT=600s
 BENCHMARKING_TIMEOUT=60s
 
@@ -66,7 +89,7 @@ else
 fi
 
 # A batch of this many samples is built in parallel, and then
-# benchmarked serially.
+# benchmarked serially (or in parallel across the benchmark workers).
 BATCH_SIZE=32
 
 TIMEOUT_CMD="timeout"
@@ -79,10 +102,17 @@ if [ $(uname -s) = "Darwin" ] && ! which $TIMEOUT_CMD 2>&1 >/dev/null; then
     fi
 fi
 
+HASH_CMD="sha1sum"
+if ! which $HASH_CMD 2>&1 >/dev/null; then
+    # OSX has shasum instead
+    HASH_CMD="shasum"
+fi
+
 PLUGIN_EXT=so
 
-# Build a single featurization of the pipeline with a random schedule
-make_featurization() {
+# Write the script that builds a single featurization of the pipeline
+# with a random schedule
+make_featurization_job() {
     D=${1}
     SEED=${2}
     FNAME=${3}
@@ -99,48 +129,57 @@ make_featurization() {
         dropout=1  # 1% chance of operating entirely greedily
         beam=1
     fi
-    ${TIMEOUT_CMD} -k ${COMPILATION_TIMEOUT} ${COMPILATION_TIMEOUT} \
-        ${GENERATOR} \
-        -g ${PIPELINE} \
-        -f ${FNAME} \
-        -o ${D} \
-        -e stmt,assembly,static_library,c_header,registration,schedule,featurization \
-        target=${HL_TARGET} \
-        ${EXTRA_GENERATOR_ARGS} \
-        -p ${AUTOSCHED_BIN}/libautoschedule_adams2019.${PLUGIN_EXT} \
-        autoscheduler=Adams2019 \
-        autoscheduler.parallelism=32 \
-        autoscheduler.beam_size=${beam} \
-        autoscheduler.random_dropout=${dropout} \
-        autoscheduler.random_dropout_seed=${SEED} \
-        autoscheduler.weights_path=${WEIGHTS} \
-            2> ${D}/compile_log.txt || echo "Compilation failed or timed out for ${D}"
-
-
-    # We don't need image I/O for this purpose,
-    # so leave out libpng and libjpeg
-    c++ \
-        -std=c++17 \
-        -I ${HALIDE_DISTRIB_PATH}/include \
-        ${HALIDE_DISTRIB_PATH}/tools/RunGenMain.cpp \
-        ${D}/*.registration.cpp \
-        ${D}/*.a \
-        -o ${D}/bench \
-        -DHALIDE_NO_PNG -DHALIDE_NO_JPEG \
-        -ldl -lpthread
+    cat > ${D}/compile.sh <<EOF
+${TIMEOUT_CMD} -k ${COMPILATION_TIMEOUT} ${COMPILATION_TIMEOUT} \\
+    ${GENERATOR} \\
+    -g ${PIPELINE} \\
+    -f ${FNAME} \\
+    -o ${D} \\
+    -e stmt,assembly,static_library,c_header,registration,schedule,featurization \\
+    target=${HL_TARGET} \\
+    ${EXTRA_GENERATOR_ARGS} \\
+    -p ${AUTOSCHED_BIN}/libautoschedule_adams2019.${PLUGIN_EXT} \\
+    autoscheduler=Adams2019 \\
+    autoscheduler.parallelism=32 \\
+    autoscheduler.beam_size=${beam} \\
+    autoscheduler.random_dropout=${dropout} \\
+    autoscheduler.random_dropout_seed=${SEED} \\
+    autoscheduler.weights_path=${WEIGHTS} \\
+        2> ${D}/compile_log.txt || echo "Compilation failed or timed out for ${D}"
+
+
+# We don't need image I/O for this purpose,
+# so leave out libpng and libjpeg
+c++ \\
+    -std=c++17 \\
+    -I ${HALIDE_DISTRIB_PATH}/include \\
+    ${HALIDE_DISTRIB_PATH}/tools/RunGenMain.cpp \\
+    ${D}/*.registration.cpp \\
+    ${D}/*.a \\
+    -o ${D}/bench \\
+    -DHALIDE_NO_PNG -DHALIDE_NO_JPEG \\
+    -ldl -lpthread
+EOF
 }
 
-# Benchmark one of the random samples
-benchmark_sample() {
-    sleep 1 # Give CPU clocks a chance to spin back up if we're thermally throttling
+# Write the script that benchmarks one of the random samples
+benchmark_sample_job() {
     D=${1}
-    HL_NUM_THREADS=32 \
-        ${TIMEOUT_CMD} -k ${BENCHMARKING_TIMEOUT} ${BENCHMARKING_TIMEOUT} \
-        ${D}/bench \
-        --estimate_all \
-        --benchmarks=all \
-            | tee ${D}/bench.txt || echo "Benchmarking failed or timed out for ${D}"
+    cat > ${D}/benchmark.sh <<EOF
+sleep 1 # Give CPU clocks a chance to spin back up if we're thermally throttling
+HL_NUM_THREADS=32 \\
+    ${TIMEOUT_CMD} -k ${BENCHMARKING_TIMEOUT} ${BENCHMARKING_TIMEOUT} \\
+    ${D}/bench \\
+    --estimate_all \\
+    --benchmarks=all \\
+    ${PERF_COUNTERS_FLAG} \\
+        | tee ${D}/bench.txt || echo "Benchmarking failed or timed out for ${D}"
+EOF
+}
 
+# Turn the featurization of a benchmarked sample into a training sample
+make_sample() {
+    D=${1}
     # Add the runtime, pipeline id, and schedule id to the feature file
     R=$(cut -d' ' -f8 < ${D}/bench.txt)
     P=$3
@@ -149,6 +188,51 @@ benchmark_sample() {
     ${AUTOSCHED_BIN}/featurization_to_sample ${D}/${FNAME}.featurization $R $P $S ${D}/${FNAME}.sample || echo "featurization_to_sample failed for ${D} (probably because benchmarking failed)"
 }
 
+# A hash of the schedule chosen for a sample, ignoring the comments and
+# the function name, which differ between samples regardless
+schedule_hash() {
+    D=${1}
+    FNAME=${2}
+    grep -v '^//' ${D}/${FNAME}.schedule.h | sed -e "s/${FNAME}/PIPELINE/g" | ${HASH_CMD} | cut -d' ' -f1
+}
+
+# The pid of the job running on each worker
+declare -a WORKER_PIDS=()
+
+# Run a job script in the background on the next free worker in the
+# (space-separated) list given, or here if the list is empty, with at
+# most the given number of jobs running at once
+run_job() {
+    local WORKERS=(${1})
+    local SCRIPT=${2}
+    local MAX_LOCAL_JOBS=${3}
+    if [ ${#WORKERS[@]} -eq 0 ]; then
+        while [[ $(jobs -r | wc -l) -ge ${MAX_LOCAL_JOBS} ]]; do
+            sleep 1
+        done
+        bash ${SCRIPT} &
+        return
+    fi
+    while [[ 1 ]]; do
+        for ((W=0;W<${#WORKERS[@]};W++)); do
+            PID=${WORKER_PIDS[W]:-}
+            if [ -z "${PID}" ] || ! kill -0 ${PID} 2>/dev/null; then
+                ssh -n -o BatchMode=yes ${WORKERS[W]} "cd $(pwd) && bash ${SCRIPT}" \
+                    || echo "Job ${SCRIPT} failed on worker ${WORKERS[W]}" &
+                WORKER_PIDS[W]=$!
+                return
+            fi
+        done
+        sleep 1
+    done
+}
+
+# Wait for all the jobs started by run_job to finish
+wait_for_jobs() {
+    wait
+    WORKER_PIDS=()
+}
+
 # Don't clobber existing samples
 FIRST=$(ls -d ${SAMPLES}/batch_* 2>/dev/null | sed -e "s|.*/batch_||;s|_.*||" | sort -n | tail -n1)
 
@@ -159,6 +243,19 @@ else
 fi
 echo Local number of cores detected as ${LOCAL_CORES}
 
+if [ ! -z "${COMPILE_WORKERS}" ]; then
+    echo Compiling on workers: ${COMPILE_WORKERS}
+fi
+if [ ! -z "${BENCHMARK_WORKERS}" ]; then
+    echo Benchmarking on workers: ${BENCHMARK_WORKERS}
+fi
+
+# The hash of every schedule benchmarked so far, along with the sample
+# it came from, so that samples that repeat a schedule aren't benchmarked
+# (and then trained on) again
+BENCHMARKED_SCHEDULES=${SAMPLES}/benchmarked_schedules.txt
+touch ${BENCHMARKED_SCHEDULES}
+
 NUM_BATCHES=1
 
 for ((BATCH_ID=$((FIRST+1));BATCH_ID<$((FIRST+1+NUM_BATCHES));BATCH_ID++)); do
@@ -185,28 +282,40 @@ for ((BATCH_ID=$((FIRST+1));BATCH_ID<$((FIRST+1+NUM_BATCHES));BATCH_ID++)); do
         # don't get swamped and timeout unnecessarily
         echo -n Compiling ${BATCH_SIZE} samples
         for ((SAMPLE_ID=0;SAMPLE_ID<${BATCH_SIZE};SAMPLE_ID++)); do
-            while [[ 1 ]]; do
-                RUNNING=$(jobs -r | wc -l)
-                if [[ RUNNING -ge LOCAL_CORES ]]; then
-                    sleep 1
-                else
-                    break
-                fi
-            done
-
             S=$(printf "%04d%04d" $BATCH_ID $SAMPLE_ID)
             FNAME=$(printf "%s_batch_%04d_sample_%04d" ${PIPELINE} $BATCH_ID $SAMPLE_ID)
-            make_featurization "${DIR}/${SAMPLE_ID}" $S $FNAME "$EXTRA_GENERATOR_ARGS" &
+            make_featurization_job "${DIR}/${SAMPLE_ID}" $S $FNAME "$EXTRA_GENERATOR_ARGS"
+            run_job "${COMPILE_WORKERS}" "${DIR}/${SAMPLE_ID}/compile.sh" ${LOCAL_CORES}
             echo -n .
         done
-        wait
+        wait_for_jobs
         echo  done.
 
-        # benchmark them serially using rungen
+        # benchmark them using rungen, serially unless there are benchmark
+        # workers, skipping any schedule that has been benchmarked before
+        for ((SAMPLE_ID=0;SAMPLE_ID<${BATCH_SIZE};SAMPLE_ID++)); do
+            FNAME=$(printf "%s_batch_%04d_sample_%04d" ${PIPELINE} $BATCH_ID $SAMPLE_ID)
+            D=${DIR}/${SAMPLE_ID}
+            if [[ -f ${D}/${FNAME}.schedule.h ]]; then
+                H=$(schedule_hash ${D} ${FNAME})
+                PREVIOUS=$(grep "^${H} " ${BENCHMARKED_SCHEDULES} | head -n1 | cut -d' ' -f2)
+                if [ ! -z "${PREVIOUS}" ]; then
+                    echo "Skipping ${D}, which has the same schedule as ${PREVIOUS}"
+                    continue
+                fi
+                echo "${H} ${D}" >> ${BENCHMARKED_SCHEDULES}
+            fi
+            benchmark_sample_job ${D}
+            run_job "${BENCHMARK_WORKERS}" "${D}/benchmark.sh" 1
+        done
+        wait_for_jobs
+
         for ((SAMPLE_ID=0;SAMPLE_ID<${BATCH_SIZE};SAMPLE_ID++)); do
             S=$(printf "%04d%04d" $BATCH_ID $SAMPLE_ID)
             FNAME=$(printf "%s_batch_%04d_sample_%04d" ${PIPELINE} $BATCH_ID $SAMPLE_ID)
-            benchmark_sample "${DIR}/${SAMPLE_ID}" $S $EXTRA_ARGS_IDX $FNAME
+            if [[ -f ${DIR}/${SAMPLE_ID}/bench.txt ]]; then
+                make_sample "${DIR}/${SAMPLE_ID}" $S $EXTRA_ARGS_IDX $FNAME
+            fi
         done
 
         # retrain model weights on all samples seen so far
@@ -9,6 +9,18 @@ namespace Halide {
 namespace Internal {
 namespace Autoscheduler {
 
+// The properties of the host machine, if the code is for the host's CPU,
+// so they can be the defaults of the parameters that describe the
+// machine. Otherwise all zero.
+inline HostProperties host_properties_for(const Target &target) {
+    const Target host = get_host_target();
+    if (target.os == host.os && target.arch == host.arch && target.bits == host.bits &&
+        !target.has_gpu_feature()) {
+        return get_host_properties();
+    }
+    return HostProperties();
+}
+
 class ParamParser {
     std::map<std::string, std::string> extra;
 
@@ -51,6 +63,25 @@ public:
         return true;
     }
 
+    // Like parse(), but if the given key is not present, set *value to
+    // the given default instead, unless it is zero (i.e. unknown), and
+    // record the value used in *used. This is for defaults that come
+    // from the machine, so the schedule records what it was made for.
+    template<typename T>
+    bool parse_or_default(const std::string &key, T *value, T default_value,
+                          std::map<std::string, std::string> *used) {
+        if (parse(key, value)) {
+            return true;
+        }
+        if (default_value != T{}) {
+            *value = default_value;
+            std::ostringstream oss;
+            oss << default_value;
+            (*used)[key] = oss.str();
+        }
+        return false;
+    }
+
     void finish() {
         if (!extra.empty()) {
             std::ostringstream oss;
@@ -6,7 +6,13 @@ using namespace Halide;
 // Any extra arguments are assumed to be features that should be stripped from
 // the target (as a convenience for use in Makefiles, where string manipulation
 // can be painful).
+// With --properties, print the cores and cache sizes of the host instead,
+// as used for the defaults of the autoscheduler parameters.
 int main(int argc, char **argv) {
+    if (argc > 1 && !strcmp(argv[1], "--properties")) {
+        printf("%s\n", get_host_properties().to_string().c_str());
+        return 0;
+    }
     Target t = get_host_target();
     for (int i = 1; i < argc; ++i) {
         auto f = Target::feature_from_name(argv[i]);
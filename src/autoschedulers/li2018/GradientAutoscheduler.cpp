@@ -10,8 +10,15 @@ namespace Autoscheduler {
 namespace {
 
 struct GradientAutoschedulerParams {
-    /** Maximum level of parallelism available. */
+    /** Maximum level of parallelism available. Defaults to the number
+     * of cores of the host when compiling for it, and 16 otherwise. */
     int parallelism = 16;
+
+    /** How to parallelize associative reductions without enough parallelism
+     * in their pure vars: "auto" chooses between rfactor, atomics and
+     * leaving them serial with a cost model, "rfactor" always uses rfactor
+     * when the pure domain is small, and "atomic" never uses it. */
+    std::string reduction_strategy = "auto";
 };
 
 std::map<std::string, Box> inference_bounds(const std::vector<Function> &functions,
@@ -138,7 +145,7 @@ void parallelize_vars_and_rvars_gpu(
     if (gpu_threads.empty()) {
         // If we can't find any GPU threads, parallelize RVars to find more parallelism
         for (int i = 0; i < (int)rvars.size(); i++) {
-            if (!r_gpu_threads.empty() && rvar_bounds[i] > split_size) {
+            if (r_gpu_threads.empty() && rvar_bounds[i] > split_size) {
                 RVar outer, inner;
                 func_or_stage.split(rvars[i],
                                     outer,
@@ -319,7 +326,7 @@ void parallelize_vars_and_rvars_gpu(
         }
         if (!r_gpu_threads.empty()) {
             func_or_stage.gpu_threads(RVar(r_gpu_threads));
-            schedule_source << "    .r_gpu_threads(" << r_gpu_threads << ")\n";
+            schedule_source << "    .gpu_threads(" << r_gpu_threads << ")\n";
         }
     } else {
         // Not enough parallelism, use a single GPU thread
@@ -571,6 +578,83 @@ void parallelize_vars_and_rvars(
     }
 }
 
+// A rough model of the time taken by an associative update definition,
+// in units of the time taken by one of its iterations, used to choose
+// whether to parallelize its RVars with rfactor or atomics.
+class ReductionCostModel {
+    // The number of threads that can run at once.
+    double threads;
+    // The number of lanes each CPU thread computes at once.
+    double vector_size;
+    // The cost of an atomic update relative to a plain one.
+    double atomic_cost;
+    // The cost of writing out and reading back one element of an rfactor
+    // intermediate.
+    double memory_cost;
+    bool is_gpu;
+
+    double loop_time(double iterations, double parallel_iterations, bool vectorized) const {
+        double t = iterations / std::max(1.0, std::min(parallel_iterations, threads));
+        return vectorized ? t / vector_size : t;
+    }
+
+public:
+    ReductionCostModel(const GradientAutoschedulerParams &params, int natural_vector_size, bool is_gpu)
+        : threads(is_gpu ? 10 * 70 * 32 : params.parallelism),
+          vector_size(is_gpu ? 1 : natural_vector_size),
+          atomic_cost(is_gpu ? 2 : 8),
+          memory_cost(is_gpu ? 4 : 2),
+          is_gpu(is_gpu) {
+    }
+
+    // Parallelize over the pure vars only, and run the RVars serially.
+    double serial(double pure_size, double rdomain_size) const {
+        return loop_time(pure_size * rdomain_size, pure_size, pure_size >= vector_size);
+    }
+
+    // Parallelize over the RVars too, with atomic updates of the
+    // locations written to.
+    double atomic(double pure_size, double num_locations, double rdomain_size) const {
+        const double iterations = pure_size * rdomain_size;
+        const bool vectorized = pure_size * rdomain_size >= vector_size;
+        const double compute = loop_time(iterations, iterations, vectorized);
+        // A vectorized RVar is reduced within the vector first, so there's
+        // one atomic update per vector.
+        const double updates = vectorized ? iterations / vector_size : iterations;
+        // Atomic updates of the same location are serialized, but a GPU
+        // combines those from the same warp.
+        const double locations = is_gpu ? num_locations * 32 : num_locations;
+        const double concurrent = std::max(1.0, std::min({iterations, threads, locations}));
+        return compute + updates * atomic_cost / concurrent;
+    }
+
+    // rfactor the RVars into factored_size outer ones, issue parallel
+    // partial reductions over the inner ones, and then reduce the
+    // intermediate over the outer ones.
+    double rfactor(double pure_size, double num_locations, double rdomain_size, double factored_size) const {
+        const double partial = loop_time(pure_size * rdomain_size, factored_size, factored_size >= vector_size);
+        const double memory = 2 * num_locations * factored_size * memory_cost / std::min(factored_size, threads);
+        const double merge = std::min(serial(pure_size, factored_size),
+                                      atomic(pure_size, num_locations, factored_size));
+        return partial + memory + merge;
+    }
+};
+
+// The size to split an RVar with the given extent by before rfactoring
+// the outer RVar, or 0 if it shouldn't be split. The default is a split
+// into about sqrt(extent) RVars of about sqrt(extent) iterations each,
+// and the factor scales the number of iterations.
+int rfactor_split_size(int extent, float factor) {
+    if (extent < 8) {
+        return 0;
+    }
+    // Let split_size = 8 * n where n is an integer and
+    // split_size > sqrt(extent) * factor
+    float target = std::sqrt(extent) * factor;
+    int split_size = int(std::ceil(target / 8.f)) * 8;
+    return split_size < extent ? split_size : 0;
+}
+
 void apply_schedule(const GradientAutoschedulerParams &params,
                     const Target &target,
                     Func func,
@@ -596,10 +680,6 @@ void apply_schedule(const GradientAutoschedulerParams &params,
                 schedule_source);
         }
     } else {
-        // If the pure domain is smaller than some thresholds,
-        // we try to apply rfactor to increase parallelism:
-        bool checked_associative = false;
-        bool is_associative = false;
         int domain_size = 1;
         for (int b : var_bounds) {
             domain_size *= b;
@@ -609,125 +689,10 @@ void apply_schedule(const GradientAutoschedulerParams &params,
         std::vector<int> rvar_bounds = get_rvar_bounds(reduction_vars);
         std::vector<RVar> rvars;
         rvars.reserve(reduction_vars.size());
-        for (const ReductionVariable &r : reduction_vars) {
-            rvars.emplace_back(r.var);
-        }
-        // Define the thresholds for the pure domain.
-        // For CPU we want at least params.parallelism number of elements
-        // to launch threads. For GPU we want to launch at least 64 GPU blocks.
-        // We don't use a larger domain size for GPU since we can also use atomic
-        // to increase parallelism and atomics are faster on GPU.
-        // These numbers can be better tuned (issue 4346).
-        const int cpu_max_domain_size = 8 * params.parallelism;
-        constexpr int gpu_max_domain_size = 4096;
-        int max_domain_size = is_gpu ? gpu_max_domain_size : cpu_max_domain_size;
-        if (domain_size < max_domain_size) {
-            if (!rvars.empty()) {
-                // Check associativity
-                std::vector<Expr> values =
-                    func.update_values(update_id).as_vector();
-                const auto &prover_result =
-                    prove_associativity(func.name(),
-                                        func.update_args(update_id),
-                                        values);
-                // Cache the associative check for later use.
-                checked_associative = true;
-                is_associative = prover_result.associative();
-                if (is_associative) {
-                    schedule_source << func.name() << ".update(" << update_id << ")\n";
-                    // Generate a list of tiled RVars
-                    std::vector<RVar> outer_rvars, inner_rvars;
-                    std::vector<int> outer_rvar_sizes, inner_rvar_sizes;
-                    for (int i = 0; i < (int)rvars.size(); i++) {
-                        if (rvar_bounds[i] >= 8) {
-                            // Let split_size = 8 * n where n is an integer and
-                            // split_size > sqrt(rvar_bounds)
-                            float target = std::sqrt(rvar_bounds[i]);
-                            int split_size = int(std::ceil(target / 8.f)) * 8;
-                            // Split the rvar
-                            RVar outer, inner;
-                            func.update(update_id)
-                                .split(rvars[i], outer, inner, split_size,
-                                       TailStrategy::GuardWithIf);
-                            schedule_source << "    .split("
-                                            << rvars[i].name() << ","
-                                            << outer.name() << ","
-                                            << inner.name() << ","
-                                            << split_size << ","
-                                            << TailStrategy::GuardWithIf << ")\n";
-                            outer_rvars.push_back(outer);
-                            inner_rvars.push_back(inner);
-                            int outer_size = rvar_bounds[i] % split_size == 0 ? split_size : split_size + 1;
-                            outer_rvar_sizes.push_back(outer_size);
-                            inner_rvar_sizes.push_back(split_size);
-                        } else {
-                            inner_rvars.push_back(rvars[i]);
-                            inner_rvar_sizes.push_back(rvar_bounds[i]);
-                        }
-                    }
-                    schedule_source << ";\n";
-                    if (!outer_rvars.empty() && !inner_rvars.empty()) {
-                        // Rfactor all the outer RVars.
-                        std::vector<std::pair<RVar, Var>> preserved;
-                        std::vector<Var> interim_vars;
-                        preserved.reserve(outer_rvars.size());
-                        interim_vars.reserve(outer_rvars.size());
-                        for (const RVar &r : outer_rvars) {
-                            Var v;
-                            preserved.emplace_back(r, v);
-                            interim_vars.push_back(v);
-                        }
-
-                        Var factored;
-                        Func interim =
-                            func.update(update_id)
-                                .rfactor(preserved)
-                                .compute_root();
-                        schedule_source << interim.name() << " = "
-                                        << func.name() << ".update(" << update_id << ")\n";
-                        schedule_source << "    .rfactor({";
-                        for (int i = 0; i < (int)preserved.size(); i++) {
-                            schedule_source << "{" << preserved[i].first.name() << ","
-                                            << preserved[i].second.name() << "}";
-                            if (i != (int)preserved.size() - 1) {
-                                schedule_source << ",";
-                            }
-                        }
-                        schedule_source << "})\n";
-                        schedule_source << "    .compute_root()\n";
-
-                        parallelize_vars_and_rvars(
-                            params,
-                            interim,
-                            natural_vector_size(target, interim.values()[0].type()),
-                            true,
-                            interim_vars,
-                            outer_rvar_sizes,
-                            {},
-                            {},
-                            TailStrategy::ShiftInwards,
-                            is_gpu,
-                            schedule_source);
-                        schedule_source << ";\n";
-                        schedule_source << interim.name() << ".update()\n";
-                        parallelize_vars_and_rvars(
-                            params,
-                            interim.update(0),
-                            natural_vector_size(target, interim.values()[0].type()),
-                            false,
-                            interim_vars,
-                            outer_rvar_sizes,
-                            inner_rvars,
-                            inner_rvar_sizes,
-                            TailStrategy::GuardWithIf,
-                            is_gpu,
-                            schedule_source);
-                        // Update rvars
-                        rvars = outer_rvars;
-                        rvar_bounds = outer_rvar_sizes;
-                    }
-                }
-            }
+        double rdomain_size = 1;
+        for (int i = 0; i < (int)reduction_vars.size(); i++) {
+            rvars.emplace_back(reduction_vars[i].var);
+            rdomain_size *= rvar_bounds[i];
         }
         // Gather pure variables
         std::vector<Expr> update_args = func.update_args(update_id);
@@ -748,6 +713,16 @@ void apply_schedule(const GradientAutoschedulerParams &params,
                 parallelism *= pure_arg_bounds.back();
             }
         }
+
+        // Define the thresholds for the pure domain.
+        // For CPU we want at least params.parallelism number of elements
+        // to launch threads. For GPU we want to launch at least 64 GPU blocks.
+        // We don't use a larger domain size for GPU since we can also use atomic
+        // to increase parallelism and atomics are faster on GPU.
+        // These numbers can be better tuned (issue 4346).
+        const int cpu_max_domain_size = 8 * params.parallelism;
+        constexpr int gpu_max_domain_size = 4096;
+        int max_domain_size = is_gpu ? gpu_max_domain_size : cpu_max_domain_size;
         // For CPU we want at least (8 * cores) * 16 parallelism
         // for vectorization + threading.
         // For GPU we want at least 10 * (num SMs) * 32 parallelism
@@ -757,64 +732,187 @@ void apply_schedule(const GradientAutoschedulerParams &params,
         int gpu_min_parallelism = 10 * 70 * 32;
         int min_parallelism =
             is_gpu ? gpu_min_parallelism : cpu_min_parallelism;
-        if (parallelism >= min_parallelism) {
+
+        // We can only parallelize RVars of associative updates.
+        bool is_associative = false;
+        if (!rvars.empty() &&
+            (domain_size < max_domain_size || parallelism < min_parallelism)) {
+            std::vector<Expr> values =
+                func.update_values(update_id).as_vector();
+            const auto &prover_result =
+                prove_associativity(func.name(),
+                                    func.update_args(update_id),
+                                    values);
+            is_associative = prover_result.associative();
+        }
+
+        // Choose whether to rfactor the RVars (and how much by), and
+        // whether to parallelize the RVars left with atomics.
+        const int vector_size = natural_vector_size(target, func.values()[0].type());
+        float rfactor_split_factor = 0.f;
+        bool use_atomics = false;
+        if (is_associative) {
+            if (params.reduction_strategy == "auto") {
+                const ReductionCostModel model(params, vector_size, is_gpu);
+                double best_cost = model.serial(parallelism, rdomain_size);
+                double atomic_cost = model.atomic(parallelism, domain_size, rdomain_size);
+                if (atomic_cost < best_cost) {
+                    best_cost = atomic_cost;
+                    use_atomics = true;
+                }
+                for (float factor : {0.25f, 0.5f, 1.f, 2.f, 4.f}) {
+                    double factored_size = 1;
+                    bool any_split = false;
+                    for (int b : rvar_bounds) {
+                        int split_size = rfactor_split_size(b, factor);
+                        if (split_size > 0) {
+                            factored_size *= (b + split_size - 1) / split_size;
+                            any_split = true;
+                        }
+                    }
+                    if (!any_split) {
+                        continue;
+                    }
+                    double cost = model.rfactor(parallelism, domain_size, rdomain_size, factored_size);
+                    debug(1) << "[gradient_autoscheduler] " << func.name() << ".update(" << update_id << "): "
+                             << "rfactor by " << factored_size << " costs " << cost << " vs " << best_cost << "\n";
+                    if (cost < best_cost) {
+                        best_cost = cost;
+                        rfactor_split_factor = factor;
+                        use_atomics = model.atomic(parallelism, domain_size, factored_size) <
+                                      model.serial(parallelism, factored_size);
+                    }
+                }
+            } else {
+                // If the pure domain is smaller than some thresholds,
+                // we try to apply rfactor to increase parallelism, and
+                // if there's still not enough parallelism we use atomics.
+                if (params.reduction_strategy == "rfactor" && domain_size < max_domain_size) {
+                    rfactor_split_factor = 1.f;
+                }
+                use_atomics = parallelism < min_parallelism;
+            }
+        }
+
+        if (rfactor_split_factor > 0) {
             schedule_source << func.name() << ".update(" << update_id << ")\n";
-            parallelize_vars_and_rvars(
-                params,
-                func.update(update_id),
-                natural_vector_size(target, func.values()[0].type()),
-                false,  // is_pure_def
-                pure_args,
-                pure_arg_bounds,
-                {},  // rvars
-                {},  // rvar_bounds
-                TailStrategy::GuardWithIf,
-                is_gpu,
-                schedule_source);
-        } else {
-            // Not enough parallelism. Find parallelism from RDoms.
-            if (!checked_associative) {
-                // We can only do this for associative RDoms.
-                std::vector<Expr> values =
-                    func.update_values(update_id).as_vector();
-                const auto &prover_result =
-                    prove_associativity(func.name(),
-                                        func.update_args(update_id),
-                                        values);
-                checked_associative = true;
-                is_associative = prover_result.associative();
+            // Generate a list of tiled RVars
+            std::vector<RVar> outer_rvars, inner_rvars;
+            std::vector<int> outer_rvar_sizes, inner_rvar_sizes;
+            for (int i = 0; i < (int)rvars.size(); i++) {
+                int split_size = rfactor_split_size(rvar_bounds[i], rfactor_split_factor);
+                if (split_size > 0) {
+                    // Split the rvar
+                    RVar outer, inner;
+                    func.update(update_id)
+                        .split(rvars[i], outer, inner, split_size,
+                               TailStrategy::GuardWithIf);
+                    schedule_source << "    .split("
+                                    << rvars[i].name() << ","
+                                    << outer.name() << ","
+                                    << inner.name() << ","
+                                    << split_size << ","
+                                    << TailStrategy::GuardWithIf << ")\n";
+                    outer_rvars.push_back(outer);
+                    inner_rvars.push_back(inner);
+                    outer_rvar_sizes.push_back((rvar_bounds[i] + split_size - 1) / split_size);
+                    inner_rvar_sizes.push_back(split_size);
+                } else {
+                    inner_rvars.push_back(rvars[i]);
+                    inner_rvar_sizes.push_back(rvar_bounds[i]);
+                }
             }
-            if (is_associative) {
-                schedule_source << func.name() << ".update(" << update_id << ")\n";
+            schedule_source << ";\n";
+            if (!outer_rvars.empty() && !inner_rvars.empty()) {
+                // Rfactor all the outer RVars.
+                std::vector<std::pair<RVar, Var>> preserved;
+                std::vector<Var> interim_vars;
+                preserved.reserve(outer_rvars.size());
+                interim_vars.reserve(outer_rvars.size());
+                for (const RVar &r : outer_rvars) {
+                    Var v;
+                    preserved.emplace_back(r, v);
+                    interim_vars.push_back(v);
+                }
+
+                Func interim =
+                    func.update(update_id)
+                        .rfactor(preserved)
+                        .compute_root();
+                schedule_source << interim.name() << " = "
+                                << func.name() << ".update(" << update_id << ")\n";
+                schedule_source << "    .rfactor({";
+                for (int i = 0; i < (int)preserved.size(); i++) {
+                    schedule_source << "{" << preserved[i].first.name() << ","
+                                    << preserved[i].second.name() << "}";
+                    if (i != (int)preserved.size() - 1) {
+                        schedule_source << ",";
+                    }
+                }
+                schedule_source << "})\n";
+                schedule_source << "    .compute_root()\n";
+
                 parallelize_vars_and_rvars(
                     params,
-                    func.update(update_id),
-                    natural_vector_size(target, func.values()[0].type()),
-                    false,  // is_pure_def
-                    pure_args,
-                    pure_arg_bounds,
-                    rvars,
-                    rvar_bounds,
-                    TailStrategy::GuardWithIf,
+                    interim,
+                    natural_vector_size(target, interim.values()[0].type()),
+                    true,
+                    interim_vars,
+                    outer_rvar_sizes,
+                    {},
+                    {},
+                    TailStrategy::ShiftInwards,
                     is_gpu,
                     schedule_source);
-            } else {
-                // Fall back to pure var parallelization
-                schedule_source << func.name() << ".update(" << update_id << ")\n";
+                schedule_source << ";\n";
+                schedule_source << interim.name() << ".update()\n";
                 parallelize_vars_and_rvars(
                     params,
-                    func.update(update_id),
-                    natural_vector_size(target, func.values()[0].type()),
-                    false,  // is_pure_def
-                    pure_args,
-                    pure_arg_bounds,
-                    {},  // rvars
-                    {},  // rvar_bounds
+                    interim.update(0),
+                    natural_vector_size(target, interim.values()[0].type()),
+                    false,
+                    interim_vars,
+                    outer_rvar_sizes,
+                    inner_rvars,
+                    inner_rvar_sizes,
                     TailStrategy::GuardWithIf,
                     is_gpu,
                     schedule_source);
+                // Update rvars
+                rvars = outer_rvars;
+                rvar_bounds = outer_rvar_sizes;
             }
         }
+
+        schedule_source << func.name() << ".update(" << update_id << ")\n";
+        if (use_atomics) {
+            // Not enough parallelism. Find parallelism from RDoms.
+            parallelize_vars_and_rvars(
+                params,
+                func.update(update_id),
+                vector_size,
+                false,  // is_pure_def
+                pure_args,
+                pure_arg_bounds,
+                rvars,
+                rvar_bounds,
+                TailStrategy::GuardWithIf,
+                is_gpu,
+                schedule_source);
+        } else {
+            parallelize_vars_and_rvars(
+                params,
+                func.update(update_id),
+                vector_size,
+                false,  // is_pure_def
+                pure_args,
+                pure_arg_bounds,
+                {},  // rvars
+                {},  // rvar_bounds
+                TailStrategy::GuardWithIf,
+                is_gpu,
+                schedule_source);
+        }
     }
     schedule_source << ";\n";
 }
@@ -936,13 +1034,23 @@ struct Li2018 {
             outputs.push_back(f.function());
         }
         GradientAutoschedulerParams params;
+        // The defaults taken from the host, to record in the results.
+        std::map<std::string, std::string> host_defaults;
         {
             ParamParser parser(params_in.extra);
-            parser.parse("parallelism", &params.parallelism);
+            parser.parse_or_default("parallelism", &params.parallelism, host_properties_for(target).cores,
+                                    &host_defaults);
+            parser.parse("reduction_strategy", &params.reduction_strategy);
             parser.finish();
         }
+        user_assert(params.reduction_strategy == "auto" ||
+                    params.reduction_strategy == "rfactor" ||
+                    params.reduction_strategy == "atomic")
+            << "reduction_strategy must be one of auto, rfactor or atomic, but is "
+            << params.reduction_strategy << "\n";
         generate_schedule(outputs, target, params, results);
         results->autoscheduler_params = params_in;
+        results->autoscheduler_params.extra.insert(host_defaults.begin(), host_defaults.end());
     }
 };
 
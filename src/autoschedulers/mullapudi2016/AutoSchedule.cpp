@@ -1,13 +1,18 @@
 #include "HalidePlugin.h"
 
 #include <algorithm>
+#include <cmath>
+#include <future>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <regex>
 #include <set>
 #include <utility>
 
 #include "Halide.h"
 #include "ParamParser.h"
+#include "halide_thread_pool.h"
 
 namespace Halide {
 namespace Internal {
@@ -23,17 +28,56 @@ using std::vector;
 namespace {
 
 struct ArchParams {
-    /** Maximum level of parallelism avalaible. */
+    /** Maximum level of parallelism avalaible. Like the cache sizes, it
+     * defaults to that of the host when compiling for it. */
     int parallelism = 16;
 
     /** Size of the last-level cache (in bytes). */
     uint64_t last_level_cache_size = 16 * 1024 * 1024;
 
+    /** Sizes of the L1 and L2 data caches (in bytes). When both are set, loads
+     * with a footprint that fits in one of them are modeled as cheaper than
+     * ones that only fit in the last-level cache. Zero (the default when not
+     * compiling for the host) models last-level cache alone. */
+    uint64_t l1_cache_size = 0;
+    uint64_t l2_cache_size = 0;
+
     /** Indicates how much more expensive is the cost of a load compared to
      * the cost of an arithmetic operation at last level cache. */
     float balance = 40;
+
+    /** Number of threads used to evaluate the grouping choices. Zero means
+     * one per core. This doesn't change the schedule found. */
+    int search_threads = 0;
 };
 
+// Return how much more expensive a load is than an arithmetic operation, given
+// the memory footprint of the loads. Without the sizes of L1 and L2, the cost
+// grows linearly with the footprint up to 'balance' at the size of the
+// last-level cache. With them, loads that fit in L1 are as cheap as arithmetic,
+// and the cost grows linearly from there to sqrt(balance) (the geometric mean
+// of the costs of L1 and last-level cache loads) at the size of L2, and then
+// to 'balance' at the size of the last-level cache.
+Expr load_cost_factor(const Expr &footprint, const ArchParams &arch_params) {
+    const float llc_size = (float)arch_params.last_level_cache_size;
+    if (arch_params.l1_cache_size == 0 || arch_params.l2_cache_size == 0) {
+        // Linear dropoff
+        float load_slope = arch_params.balance / llc_size;
+        return cast<int64_t>(min(1 + footprint * load_slope, arch_params.balance));
+    }
+
+    const float l1_size = (float)arch_params.l1_cache_size;
+    const float l2_size = (float)arch_params.l2_cache_size;
+    const float l2_factor = std::sqrt(arch_params.balance);
+
+    Expr f = cast<float>(footprint);
+    Expr l2_cost = 1 + (f - l1_size) * ((l2_factor - 1) / (l2_size - l1_size));
+    Expr llc_cost = l2_factor + (f - l2_size) * ((arch_params.balance - l2_factor) / (llc_size - l2_size));
+    return cast<int64_t>(select(f <= l1_size, 1.0f,
+                                f <= l2_size, l2_cost,
+                                min(llc_cost, arch_params.balance)));
+}
+
 // Substitute parameter estimates into the exprs describing the box bounds.
 void substitute_estimates_box(Box &box) {
     box.used = substitute_var_estimates(box.used);
@@ -202,8 +246,11 @@ struct DependenceAnalysis {
         }
     };
     // Cache for bounds queries (bound queries with the same parameters are
-    // common during the grouping process).
+    // common during the grouping process). Guarded by 'cache_mutex', as the
+    // grouping choices are evaluated in parallel. (The mutex is held by
+    // pointer to keep DependenceAnalysis movable.)
     map<RegionsRequiredQuery, vector<RegionsRequired>> regions_required_cache;
+    std::unique_ptr<std::mutex> cache_mutex = std::make_unique<std::mutex>();
 
     DependenceAnalysis(const map<string, Function> &env, const vector<string> &order,
                        const FuncValueBounds &func_val_bounds)
@@ -400,13 +447,16 @@ DependenceAnalysis::regions_required(const Function &f, int stage_num,
 
     // Check the cache if we've already computed this previously.
     RegionsRequiredQuery query(f.name(), stage_num, prods, only_regions_computed);
-    const auto &iter = regions_required_cache.find(query);
-    if (iter != regions_required_cache.end()) {
-        const auto &it = std::find_if(iter->second.begin(), iter->second.end(),
-                                      [&bounds](const RegionsRequired &r) { return (r.bounds == bounds); });
-        if (it != iter->second.end()) {
-            internal_assert((iter->first == query) && (it->bounds == bounds));
-            return it->regions;
+    {
+        std::lock_guard<std::mutex> lock(*cache_mutex);
+        const auto &iter = regions_required_cache.find(query);
+        if (iter != regions_required_cache.end()) {
+            const auto &it = std::find_if(iter->second.begin(), iter->second.end(),
+                                          [&bounds](const RegionsRequired &r) { return (r.bounds == bounds); });
+            if (it != iter->second.end()) {
+                internal_assert((iter->first == query) && (it->bounds == bounds));
+                return it->regions;
+            }
         }
     }
 
@@ -600,7 +650,12 @@ DependenceAnalysis::regions_required(const Function &f, int stage_num,
         concrete_regions[f_reg.first] = concrete_box;
     }
 
-    regions_required_cache[query].emplace_back(bounds, concrete_regions);
+    {
+        // Another thread may have computed the same query in the meantime,
+        // in which case there are now two identical entries. That's harmless.
+        std::lock_guard<std::mutex> lock(*cache_mutex);
+        regions_required_cache[query].emplace_back(bounds, concrete_regions);
+    }
     return concrete_regions;
 }
 
@@ -1096,6 +1151,8 @@ struct Partitioner {
     RegionCosts &costs;
     // Output functions of the pipeline.
     const vector<Function> &outputs;
+    // Threads used to evaluate the grouping choices, if there's more than one.
+    std::unique_ptr<Tools::ThreadPool<void>> thread_pool;
 
     Partitioner(const map<string, Box> &_pipeline_bounds,
                 const ArchParams &_arch_params,
@@ -1344,6 +1401,14 @@ Partitioner::Partitioner(const map<string, Box> &_pipeline_bounds,
                          RegionCosts &_costs)
     : pipeline_bounds(_pipeline_bounds), arch_params(_arch_params),
       dep_analysis(_dep_analysis), costs(_costs), outputs(_outputs) {
+    int search_threads = arch_params.search_threads;
+    if (search_threads <= 0) {
+        search_threads = (int)Tools::ThreadPool<void>::num_processors_online();
+    }
+    if (search_threads > 1) {
+        thread_pool = std::make_unique<Tools::ThreadPool<void>>(search_threads);
+    }
+
     // Place each stage of a function in its own group. Each stage is
     // a node in the pipeline graph.
     for (const auto &f : dep_analysis.env) {
@@ -1451,6 +1516,49 @@ map<string, Expr> Partitioner::evaluate_reuse(const FStage &stg,
 vector<pair<Partitioner::GroupingChoice, Partitioner::GroupConfig>>
 Partitioner::choose_candidate_grouping(const vector<pair<string, string>> &cands,
                                        Partitioner::Level level) {
+    // Evaluate the choices that haven't been evaluated before. They are
+    // independent of each other, so they can be evaluated in parallel. The
+    // results are added to the cache in order, so the grouping found is the
+    // same however many threads there are.
+    vector<GroupingChoice> to_evaluate;
+    set<GroupingChoice> seen;
+    for (const auto &p : cands) {
+        const Function &prod_f = get_element(dep_analysis.env, p.first);
+        FStage prod(prod_f, prod_f.updates().size());
+        for (const FStage &c : get_element(children, prod)) {
+            GroupingChoice cand_choice(prod_f.name(), c);
+            if (!grouping_cache.count(cand_choice) && seen.insert(cand_choice).second) {
+                to_evaluate.push_back(cand_choice);
+            }
+        }
+    }
+
+    vector<GroupConfig> configs(to_evaluate.size());
+    if (thread_pool && to_evaluate.size() > 1) {
+        vector<std::future<void>> futures;
+        for (size_t i = 0; i < to_evaluate.size(); i++) {
+            futures.emplace_back(thread_pool->async([&, i]() {
+                configs[i] = evaluate_choice(to_evaluate[i], level);
+            }));
+        }
+        // Wait for all of them before rethrowing any error, as they
+        // refer to 'configs'.
+        for (auto &f : futures) {
+            f.wait();
+        }
+        for (auto &f : futures) {
+            f.get();
+        }
+    } else {
+        for (size_t i = 0; i < to_evaluate.size(); i++) {
+            configs[i] = evaluate_choice(to_evaluate[i], level);
+        }
+    }
+    for (size_t i = 0; i < to_evaluate.size(); i++) {
+        // Cache the result of the evaluation for the pair
+        grouping_cache.emplace(to_evaluate[i], configs[i]);
+    }
+
     vector<pair<GroupingChoice, GroupConfig>> best_grouping;
     Expr best_benefit = make_zero(Int(64));
     for (const auto &p : cands) {
@@ -1463,20 +1571,8 @@ Partitioner::choose_candidate_grouping(const vector<pair<string, string>> &cands
         FStage prod(prod_f, final_stage);
 
         for (const FStage &c : get_element(children, prod)) {
-            GroupConfig best_config;
             GroupingChoice cand_choice(prod_f.name(), c);
-
-            // Check if the candidate has been evaluated for grouping before
-            const auto &iter = grouping_cache.find(cand_choice);
-            if (iter != grouping_cache.end()) {
-                best_config = iter->second;
-            } else {
-                best_config = evaluate_choice(cand_choice, level);
-                // Cache the result of the evaluation for the pair
-                grouping_cache.emplace(cand_choice, best_config);
-            }
-
-            grouping.emplace_back(cand_choice, best_config);
+            grouping.emplace_back(cand_choice, get_element(grouping_cache, cand_choice));
         }
 
         bool no_redundant_work = false;
@@ -1978,18 +2074,17 @@ Partitioner::GroupAnalysis Partitioner::analyze_group(const Group &g, bool show_
     // TODO: Use smooth step curve from Jon to better model cache behavior,
     // where each step corresponds to different cache level.
     //
-    // The current cost model drops off linearly. Larger memory footprint is
-    // penalized more than smaller memory footprint (since smaller one can fit
-    // more in the cache). The cost is clamped at 'balance', which is roughly at
-    // memory footprint equal to or larger than the last level cache size.
+    // The current cost model drops off piecewise linearly (see
+    // load_cost_factor). Larger memory footprint is penalized more than
+    // smaller memory footprint (since smaller one can fit more in the
+    // cache). The cost is clamped at 'balance', which is roughly at memory
+    // footprint equal to or larger than the last level cache size.
 
     // If 'model_reuse' is set, the cost model should take into account memory
     // reuse within the tile, e.g. matrix multiply reuses inputs multiple times.
     // TODO: Implement a better reuse model.
     bool model_reuse = false;
 
-    // Linear dropoff
-    float load_slope = arch_params.balance / arch_params.last_level_cache_size;
     for (const auto &f_load : group_load_costs) {
         internal_assert(g.inlined.find(f_load.first) == g.inlined.end())
             << "Intermediates of inlined pure function \"" << f_load.first
@@ -2031,8 +2126,7 @@ Partitioner::GroupAnalysis Partitioner::analyze_group(const Group &g, bool show_
             }
 
             if (model_reuse) {
-                Expr initial_factor =
-                    cast<int64_t>(min(1 + initial_footprint * load_slope, arch_params.balance));
+                Expr initial_factor = load_cost_factor(initial_footprint, arch_params);
                 per_tile_cost.memory += initial_factor * footprint;
             } else {
                 footprint = initial_footprint;
@@ -2043,7 +2137,7 @@ Partitioner::GroupAnalysis Partitioner::analyze_group(const Group &g, bool show_
             }
         }
 
-        Expr cost_factor = cast<int64_t>(min(1 + footprint * load_slope, arch_params.balance));
+        Expr cost_factor = load_cost_factor(footprint, arch_params);
         per_tile_cost.memory += cost_factor * f_load.second;
     }
 
@@ -3434,14 +3528,39 @@ struct Mullapudi2016 {
 
         ArchParams arch_params;
         {
+            // Parameters that aren't set default to those of the host,
+            // when compiling for it. The values used are recorded in
+            // the results.
+            const HostProperties host = host_properties_for(target);
+            auto *used = &results.autoscheduler_params.extra;
             ParamParser parser(params_in.extra);
-            parser.parse("parallelism", &arch_params.parallelism);
-            parser.parse("last_level_cache_size", &arch_params.last_level_cache_size);
+            parser.parse_or_default("parallelism", &arch_params.parallelism, host.cores, used);
+            const bool llc_given = parser.parse_or_default("last_level_cache_size", &arch_params.last_level_cache_size,
+                                                           host.last_level_cache_size, used);
+            const bool use_host_l1_l2 = !llc_given &&
+                                        host.l1_cache_size > 0 &&
+                                        host.l1_cache_size < host.l2_cache_size &&
+                                        host.l2_cache_size < host.last_level_cache_size;
+            const bool l1_given = parser.parse("l1_cache_size", &arch_params.l1_cache_size);
+            const bool l2_given = parser.parse("l2_cache_size", &arch_params.l2_cache_size);
+            if (use_host_l1_l2 && !l1_given && !l2_given) {
+                arch_params.l1_cache_size = host.l1_cache_size;
+                arch_params.l2_cache_size = host.l2_cache_size;
+                (*used)["l1_cache_size"] = std::to_string(host.l1_cache_size);
+                (*used)["l2_cache_size"] = std::to_string(host.l2_cache_size);
+            }
             parser.parse("balance", &arch_params.balance);
+            parser.parse("search_threads", &arch_params.search_threads);
             parser.finish();
         }
+        if (arch_params.l1_cache_size != 0 || arch_params.l2_cache_size != 0) {
+            user_assert(arch_params.l1_cache_size > 0 &&
+                        arch_params.l1_cache_size < arch_params.l2_cache_size &&
+                        arch_params.l2_cache_size < arch_params.last_level_cache_size)
+                << "Mullapudi2016: l1_cache_size and l2_cache_size must be set together, "
+                << "with l1_cache_size < l2_cache_size < last_level_cache_size.\n";
+        }
         results.schedule_source = generate_schedules(pipeline_outputs, target, arch_params);
-        results.autoscheduler_params = params_in;
         // this autoscheduler has no featurization
         *outputs = std::move(results);
     }
@@ -22,6 +22,10 @@
 #include <TargetConditionals.h>
 #endif
 
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
 #if defined(__has_feature)
 #if __has_feature(memory_sanitizer)
 #include <sanitizer/msan_interface.h>
@@ -175,6 +179,131 @@ struct AllocationHeader {
     }
 };
 
+namespace Internal {
+
+// The header of host memory that a Buffer took ownership of with
+// take_ownership_of_host. The AllocationHeader must come first, as
+// Buffer only knows about that part.
+struct ForeignAllocationHeader {
+    AllocationHeader header;
+    void (*release_fn)(void *);
+    void *context;
+};
+
+inline void release_foreign_allocation(void *ptr) {
+    ForeignAllocationHeader *a = (ForeignAllocationHeader *)ptr;
+    a->release_fn(a->context);
+    free(a);
+}
+
+}  // namespace Internal
+
+/** How huge_page_allocate chooses which allocations get huge pages. */
+struct HugePagePolicy {
+    /** Allocations smaller than this many bytes are made with malloc. */
+    static inline size_t min_bytes = 2 * 1024 * 1024;
+
+    /** Whether to ask for pages from the kernel's pool of explicit huge
+     * pages (MAP_HUGETLB) first. That fails, falling back to
+     * transparent huge pages, unless the pool has been configured with
+     * enough pages. */
+    static inline bool explicit_huge_pages = false;
+};
+
+namespace Internal {
+
+// The header of an allocation made by huge_page_allocate.
+struct HugePageAllocationHeader {
+    // The start and length of the mapping, or null if it was made with
+    // malloc.
+    void *mapping;
+    size_t length;
+};
+
+constexpr size_t huge_page_header_bytes = alignof(std::max_align_t) < sizeof(HugePageAllocationHeader) ?
+                                              sizeof(HugePageAllocationHeader) :
+                                              alignof(std::max_align_t);
+
+}  // namespace Internal
+
+/** Allocation functions for Buffer::allocate, Buffer::copy,
+ * Buffer::set_default_allocate_fn, etc, that back allocations of at
+ * least HugePagePolicy::min_bytes with huge pages, which reduces TLB
+ * misses when walking large images in column order. The memory is
+ * mapped at a 2MB boundary and marked with madvise(MADV_HUGEPAGE). Only
+ * implemented on Linux; elsewhere these are malloc and free. For
+ * allocations made by Halide pipelines, see
+ * halide_use_huge_page_allocator in HalideRuntime.h. */
+// @{
+inline void *huge_page_allocate(size_t size) {
+    using Internal::huge_page_header_bytes;
+    using Internal::HugePageAllocationHeader;
+    char *ptr = nullptr;
+    HugePageAllocationHeader header = {nullptr, 0};
+#ifdef __linux__
+    if (size >= HugePagePolicy::min_bytes) {
+        constexpr size_t huge_page_size = 2 * 1024 * 1024;
+        const size_t length = (size + huge_page_header_bytes + huge_page_size - 1) & ~(huge_page_size - 1);
+        void *mapping = MAP_FAILED;
+#ifdef MAP_HUGETLB
+        if (HugePagePolicy::explicit_huge_pages) {
+            mapping = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        }
+#endif
+        if (mapping == MAP_FAILED) {
+            // Over-allocate, and trim the mapping to start at a huge page
+            // boundary, which the kernel needs to back it with huge
+            // pages.
+            char *p = (char *)mmap(nullptr, length + huge_page_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (p != MAP_FAILED) {
+                char *aligned = (char *)(((uintptr_t)p + huge_page_size - 1) & ~(uintptr_t)(huge_page_size - 1));
+                if (aligned != p) {
+                    munmap(p, aligned - p);
+                }
+                munmap(aligned + length, (p + length + huge_page_size) - (aligned + length));
+                mapping = aligned;
+#ifdef MADV_HUGEPAGE
+                // If transparent huge pages are disabled, this fails, and the
+                // memory is still usable with normal pages.
+                (void)madvise(mapping, length, MADV_HUGEPAGE);
+#endif
+            }
+        }
+        if (mapping != MAP_FAILED) {
+            ptr = (char *)mapping;
+            header = {mapping, length};
+        }
+    }
+#endif
+    if (!ptr) {
+        ptr = (char *)malloc(size + huge_page_header_bytes);
+        if (!ptr) {
+            return nullptr;
+        }
+    }
+    memcpy(ptr, &header, sizeof(header));
+    return ptr + huge_page_header_bytes;
+}
+
+inline void huge_page_deallocate(void *ptr) {
+    using Internal::huge_page_header_bytes;
+    using Internal::HugePageAllocationHeader;
+    if (!ptr) {
+        return;
+    }
+    char *block = (char *)ptr - huge_page_header_bytes;
+    HugePageAllocationHeader header;
+    memcpy(&header, block, sizeof(header));
+#ifdef __linux__
+    if (header.mapping) {
+        munmap(header.mapping, header.length);
+        return;
+    }
+#endif
+    free(block);
+}
+// @}
+
 /** This indicates how to deallocate the device for a Halide::Runtime::Buffer. */
 enum struct BufferDeviceOwnership : int {
     Allocated,               ///> halide_device_free will be called when device ref count goes to zero
@@ -954,6 +1083,21 @@ public:
         buf.host = (uint8_t *)align_up((uintptr_t)unaligned_ptr);
     }
 
+    /** Take ownership of the host memory this Buffer refers to, which
+     * was allocated by something other than this class, such as a
+     * memory-mapped file. release_fn is called with context once the
+     * last Buffer sharing the memory drops its reference to it. The
+     * Buffer must not already own its host memory. */
+    void take_ownership_of_host(void (*release_fn)(void *), void *context) {
+        assert(!owns_host_memory() && "Buffer already owns its host memory");
+        void *storage = malloc(sizeof(Internal::ForeignAllocationHeader));
+        Internal::ForeignAllocationHeader *a = (Internal::ForeignAllocationHeader *)storage;
+        new (&a->header) AllocationHeader(Internal::release_foreign_allocation);
+        a->release_fn = release_fn;
+        a->context = context;
+        alloc = &a->header;
+    }
+
     /** Drop reference to any owned host or device memory, possibly
      * freeing it, if this buffer held the last reference to
      * it. Retains the shape of the buffer. Does nothing if this
@@ -1431,6 +1575,13 @@ public:
             src.crop(i, min_coord, max_coord - min_coord + 1);
         }
 
+        // If the buffers are dense in the innermost dimension (after
+        // flattening), copy whole spans of it at a time with memcpy.
+        if (d > 0 && Buffer<>::copy_dense(dst.raw_buffer(), src.raw_buffer())) {
+            set_host_dirty();
+            return;
+        }
+
         // If T is void, we need to do runtime dispatch to an
         // appropriately-typed lambda. We're copying, so we only care
         // about the element size. (If not, this should optimize away
@@ -2005,6 +2156,57 @@ public:
                                                    allocate_fn, deallocate_fn);
     }
 
+    /** Make a buffer of the given size, laid out the way a pipeline
+     * prefers for one of its buffer arguments, as described by the
+     * pipeline's metadata (see halide_filter_argument_t). It is stored
+     * in the preferred layout (buffers with an unknown or other layout
+     * are planar), and its host pointer has the required alignment.
+     * If the metadata asks for padding, the first dimension is
+     * allocated rounded up to that many elements, so each row starts
+     * aligned, and then cropped back to the requested size. */
+    static Buffer<T, Dims, InClassDimStorage> make_for_argument(const halide_filter_argument_t &arg,
+                                                                const std::vector<int> &sizes) {
+        assert(arg.kind != halide_argument_kind_input_scalar);
+        assert((int)sizes.size() == arg.dimensions);
+        const halide_type_t t = T_is_void ? arg.type : static_halide_type();
+        const int dims = (int)sizes.size();
+
+        std::vector<int> storage_order(dims);
+        for (int i = 0; i < dims; i++) {
+            storage_order[i] = i;
+        }
+        if (arg.layout == halide_buffer_layout_interleaved) {
+            std::rotate(storage_order.begin(), storage_order.end() - 1, storage_order.end());
+        }
+
+        std::vector<int> alloc_sizes = sizes;
+        int align_elems = 1;
+        if (arg.padding > 0 && dims > 0) {
+            // Allocations are only aligned to
+            // HALIDE_RUNTIME_BUFFER_ALLOCATION_ALIGNMENT, so allocate
+            // enough extra elements to align the start of the buffer
+            // within the first row.
+            if (arg.host_alignment > HALIDE_RUNTIME_BUFFER_ALLOCATION_ALIGNMENT &&
+                arg.host_alignment % t.bytes() == 0) {
+                align_elems = arg.host_alignment / t.bytes();
+            }
+            const int padded = sizes[0] + align_elems - 1;
+            alloc_sizes[0] = ((padded + arg.padding - 1) / arg.padding) * arg.padding;
+        }
+
+        Buffer<T, Dims, InClassDimStorage> im(t, alloc_sizes, storage_order);
+        if (arg.padding > 0 && dims > 0) {
+            int offset = 0;
+            if (align_elems > 1 && im.data()) {
+                const uintptr_t misalignment = (uintptr_t)im.data() % arg.host_alignment;
+                offset = misalignment ? (int)((arg.host_alignment - misalignment) / t.bytes()) : 0;
+            }
+            im.crop(0, offset, sizes[0]);
+            im.translate(0, -offset);
+        }
+        return im;
+    }
+
 private:
     static Buffer<> make_with_shape_of_helper(halide_type_t dst_type,
                                               int dimensions,
@@ -2179,6 +2381,16 @@ public:
 
     Buffer<T, Dims, InClassDimStorage> &fill(not_void_T val) {
         set_host_dirty();
+        // If every byte of the value is the same (e.g. zero), and the
+        // buffer is dense in its innermost dimension, use memset.
+        const uint8_t *val_bytes = (const uint8_t *)&val;
+        bool uniform_bytes = true;
+        for (size_t i = 1; i < sizeof(val); i++) {
+            uniform_bytes &= (val_bytes[i] == val_bytes[0]);
+        }
+        if (uniform_bytes && dimensions() > 0 && Buffer<>::set_dense(&buf, val_bytes[0])) {
+            return *this;
+        }
         for_each_value([=](T &v) { v = val; });
         return *this;
     }
@@ -2296,6 +2508,66 @@ private:
         return {d, innermost_strides_are_one};
     }
 
+    // Spans of the innermost dimension shorter than this are faster to
+    // copy element-by-element than with a call to memcpy/memset.
+    static constexpr std::ptrdiff_t min_dense_span_bytes = 64;
+
+    HALIDE_NEVER_INLINE static void copy_dense_helper(int d, const for_each_value_task_dim<2> *t, std::ptrdiff_t elem_size,
+                                                      uint8_t *dst, const uint8_t *src) {
+        if (d == 0) {
+            memcpy(dst, src, t[0].extent * elem_size);
+        } else {
+            for (std::ptrdiff_t i = t[d].extent; i != 0; i--) {
+                copy_dense_helper(d - 1, t, elem_size, dst, src);
+                dst += t[d].stride[0] * elem_size;
+                src += t[d].stride[1] * elem_size;
+            }
+        }
+    }
+
+    HALIDE_NEVER_INLINE static void set_dense_helper(int d, const for_each_value_task_dim<1> *t, std::ptrdiff_t elem_size,
+                                                     uint8_t *dst, uint8_t value) {
+        if (d == 0) {
+            memset(dst, value, t[0].extent * elem_size);
+        } else {
+            for (std::ptrdiff_t i = t[d].extent; i != 0; i--) {
+                set_dense_helper(d - 1, t, elem_size, dst, value);
+                dst += t[d].stride[0] * elem_size;
+            }
+        }
+    }
+
+    // Copy src to dst, which have the same shape and element size,
+    // with a memcpy per span of the innermost dimension. Returns
+    // false without doing anything if that dimension isn't dense in
+    // both buffers, or its spans are too short to be worth it.
+    HALIDE_NEVER_INLINE static bool copy_dense(const halide_buffer_t *dst, const halide_buffer_t *src) {
+        const size_t alloc_size = dst->dimensions * sizeof(for_each_value_task_dim<2>);
+        for_each_value_task_dim<2> *t = (for_each_value_task_dim<2> *)HALIDE_ALLOCA(alloc_size);
+        const halide_buffer_t *buffers[] = {dst, src};
+        auto [new_dims, innermost_strides_are_one] = for_each_value_prep(t, buffers);
+        const std::ptrdiff_t elem_size = dst->type.bytes();
+        if (!innermost_strides_are_one || t[0].extent * elem_size < min_dense_span_bytes) {
+            return false;
+        }
+        copy_dense_helper(new_dims - 1, t, elem_size, dst->host, src->host);
+        return true;
+    }
+
+    // Set every byte of the values in dst to value, as copy_dense does.
+    HALIDE_NEVER_INLINE static bool set_dense(const halide_buffer_t *dst, uint8_t value) {
+        const size_t alloc_size = dst->dimensions * sizeof(for_each_value_task_dim<1>);
+        for_each_value_task_dim<1> *t = (for_each_value_task_dim<1> *)HALIDE_ALLOCA(alloc_size);
+        const halide_buffer_t *buffers[] = {dst};
+        auto [new_dims, innermost_strides_are_one] = for_each_value_prep(t, buffers);
+        const std::ptrdiff_t elem_size = dst->type.bytes();
+        if (!innermost_strides_are_one || t[0].extent * elem_size < min_dense_span_bytes) {
+            return false;
+        }
+        set_dense_helper(new_dims - 1, t, elem_size, dst->host, value);
+        return true;
+    }
+
     template<typename Fn, typename... Args, int N = sizeof...(Args) + 1>
     void for_each_value_impl(Fn &&f, Args &&...other_buffers) const {
         if (dimensions() > 0) {
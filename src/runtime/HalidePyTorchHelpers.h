@@ -7,6 +7,7 @@
  * is included in each generated op by the PyTorch CodeGen.
  */
 
+#include <climits>
 #include <exception>
 #include <iostream>
 #include <sstream>
@@ -37,6 +38,22 @@ inline std::vector<int> get_dims(const at::Tensor tensor) {
     return dims;
 }
 
+// The shape of a tensor, including its strides, so that tensors that
+// aren't contiguous (e.g. channels-last) can be wrapped without a copy.
+inline std::vector<halide_dimension_t> get_shape(const at::Tensor &tensor) {
+    int ndims = tensor.ndimension();
+    std::vector<halide_dimension_t> shape(ndims);
+    // PyTorch dim order is reverse of Halide
+    for (int dim = 0; dim < ndims; ++dim) {
+        int64_t extent = tensor.size(ndims - 1 - dim);
+        int64_t stride = tensor.stride(ndims - 1 - dim);
+        AT_ASSERTM(extent <= INT32_MAX && stride >= INT32_MIN && stride <= INT32_MAX,
+                   "tensor is too large to wrap in a Halide buffer");
+        shape[dim] = halide_dimension_t(0, (int32_t)extent, (int32_t)stride);
+    }
+    return shape;
+}
+
 template<class scalar_t>
 inline void check_type(at::Tensor &tensor) {
     AT_ERROR("Scalar type ", tensor.scalar_type(), " not handled by Halide's PyTorch wrapper");
@@ -83,19 +100,18 @@ AT_FORALL_SCALAR_TYPES_WITH_COMPLEX(HL_PT_DEFINE_TYPECHECK);
 template<class scalar_t>
 inline Buffer<scalar_t> wrap(at::Tensor &tensor) {
     check_type<scalar_t>(tensor);
-    std::vector<int> dims = get_dims(tensor);
 #if HL_PYTORCH_API_VERSION >= 13
     scalar_t *pData = tensor.data_ptr<scalar_t>();
 #else
     scalar_t *pData = tensor.data<scalar_t>();
 #endif
-    return Buffer<scalar_t>(pData, dims);
+    std::vector<halide_dimension_t> shape = get_shape(tensor);
+    return Buffer<scalar_t>(pData, (int)shape.size(), shape.data());
 }
 
 template<class scalar_t>
 inline Buffer<scalar_t> wrap_cuda(at::Tensor &tensor) {
     check_type<scalar_t>(tensor);
-    std::vector<int> dims = get_dims(tensor);
 #if HL_PYTORCH_API_VERSION >= 13
     scalar_t *pData = tensor.data_ptr<scalar_t>();
 #else
@@ -103,7 +119,10 @@ inline Buffer<scalar_t> wrap_cuda(at::Tensor &tensor) {
 #endif
     AT_ASSERTM(tensor.is_cuda(), "expected input tensor to be on a CUDA device.");
 
-    Buffer<scalar_t> buffer(dims);
+    // The buffer has no host memory: the pipeline should only use it on
+    // the device.
+    std::vector<halide_dimension_t> shape = get_shape(tensor);
+    Buffer<scalar_t> buffer((scalar_t *)nullptr, (int)shape.size(), shape.data());
 
     const halide_device_interface_t *cuda_interface = halide_cuda_device_interface();
     int err = buffer.device_wrap_native(cuda_interface, (uint64_t)pData);
@@ -233,6 +233,18 @@ extern int halide_do_par_for(void *user_context,
 extern void halide_shutdown_thread_pool(void);
 //@}
 
+/** Call an argv-style pipeline entry point (as made for each
+ * pipeline, named with an "_argv" suffix) batch_size times, with the
+ * groups of argc arguments at argvs, argvs + argc, and so on, as the
+ * iterations of a single halide_do_par_for. If has_user_context is
+ * true, the first argument of every call is a pointer to a user
+ * context, and the first call's is passed to halide_do_par_for. Returns
+ * zero if all the calls return zero, or the return value of one of
+ * them otherwise. Generated pipelines with metadata have a wrapper of
+ * this, named with a "_batch" suffix. */
+extern int halide_do_batch_argv(int (*argv_fn)(void **), int batch_size, int argc,
+                                void **argvs, bool has_user_context);
+
 /** Set a custom method for performing a parallel for loop. Returns
  * the old do_par_for handler. */
 typedef int (*halide_do_par_for_t)(void *, halide_task_t, int, int, uint8_t *);
@@ -407,6 +419,144 @@ extern int halide_get_num_threads();
 extern int halide_set_num_threads(int n);
 // @}
 
+/** Enable or disable work stealing in the default implementation of
+ * halide_do_par_for. When enabled, the iterations of each parallel
+ * loop are divided up front into one range per thread, and threads
+ * that run out of work steal half of the remaining iterations of
+ * another thread's range, instead of all threads claiming iterations
+ * one at a time from a single shared queue. This reduces contention on
+ * the thread pool lock for loops with many small iterations. The
+ * initial setting comes from the HL_THREAD_POOL_WORK_STEALING
+ * environment variable (off by default). Returns the old setting. Has
+ * no effect on platforms without a thread pool, or when a custom
+ * halide_do_par_for is in use. */
+extern bool halide_set_thread_pool_work_stealing(bool enable);
+
+/** Make the default thread pool aware of the host's NUMA topology. When
+ * enabled, worker threads are pinned round-robin to the NUMA nodes as
+ * they are created, and parallel loops are run with work stealing with
+ * the iteration space divided into one contiguous block per node, so
+ * each part of a loop's domain is consistently processed by threads on
+ * the same node. Buffers first touched by a parallel loop therefore
+ * tend to be reread from local memory by subsequent parallel loops over
+ * the same domain. The initial setting comes from the
+ * HL_THREAD_POOL_NUMA environment variable (off by default). Threads
+ * that already exist are not re-pinned when this changes. Returns the
+ * old setting. Currently only Linux reports more than one node. */
+extern bool halide_set_thread_pool_numa_aware(bool enable);
+
+/** How idle threads of the default thread pool wait for more work
+ * before going to sleep on a condition variable. Spinning hides the
+ * latency of waking threads when parallel loops run back to back, at
+ * the cost of CPU time and power. */
+typedef enum halide_thread_pool_spin_t {
+    /** Spin for a few yields. */
+    halide_thread_pool_spin_default = 0,
+    /** Spin for a little longer than the recent time between parallel
+     * loops starting, up to spin_us microseconds (1000 if zero), and
+     * don't spin at all if they start less often than that. Suits
+     * latency-sensitive callers running many small pipelines. */
+    halide_thread_pool_spin_adaptive = 1,
+    /** Keep threads hot by spinning for spin_us microseconds. */
+    halide_thread_pool_spin_hot = 2,
+    /** Never spin, to save power. Suits batch jobs. */
+    halide_thread_pool_spin_never = 3,
+} halide_thread_pool_spin_t;
+
+/** Set how idle threads of the default thread pool spin before they
+ * sleep, and spin_us, the time in microseconds that the hot and
+ * adaptive policies use. The initial setting comes from the
+ * HL_THREAD_POOL_SPIN environment variable, which may be "adaptive",
+ * "never", or a number of microseconds to keep threads hot for, and is
+ * the default otherwise. Threads already spinning or asleep finish
+ * doing so with the old setting. Returns the old policy. Has no effect
+ * on platforms without a thread pool, or when a custom
+ * halide_do_par_for is in use. */
+extern halide_thread_pool_spin_t halide_set_thread_pool_spin_policy(halide_thread_pool_spin_t policy, int spin_us);
+
+/** How the threads of the default thread pool claim the iterations of
+ * parallel loops. */
+typedef enum halide_thread_pool_chunking_t {
+    /** Claim one iteration (one task, for loops split with a task size
+     * by Stage::parallel) at a time. */
+    halide_thread_pool_chunking_static = 0,
+    /** Claim a share of the iterations left, which shrinks as the loop
+     * drains. This takes the thread pool lock less often than static
+     * chunking for loops with many cheap iterations, while still
+     * balancing the load at the end of the loop. */
+    halide_thread_pool_chunking_guided = 1,
+    /** Like guided chunking, but also claim no more iterations than
+     * take about 50us, given the time the loop's iterations have taken
+     * so far. Suits loops whose iterations vary in cost. */
+    halide_thread_pool_chunking_adaptive = 2,
+} halide_thread_pool_chunking_t;
+
+/** Set how the threads of the default thread pool claim the iterations
+ * of parallel loops. Chunking runs several iterations of a loop on a
+ * thread in a row, so it applies to the iterations of parallel loops
+ * that don't wait on async producers. For loops with uneven
+ * iteration costs, parallelize them without a task size, and let
+ * guided or adaptive chunking group the iterations, instead of fixing
+ * the tasks up front. The initial setting comes from the
+ * HL_THREAD_POOL_CHUNKING environment variable, which may be "guided"
+ * or "adaptive", and is static otherwise. Returns the old setting. Has
+ * no effect on platforms without a thread pool, when a custom
+ * halide_do_par_for is in use, or on loops that use work stealing (see
+ * halide_set_thread_pool_work_stealing). */
+extern halide_thread_pool_chunking_t halide_set_thread_pool_chunking(halide_thread_pool_chunking_t chunking);
+
+/** When the default thread pool creates its worker threads. */
+typedef enum halide_thread_pool_creation_t {
+    /** Create all the threads the first time a parallel loop runs. */
+    halide_thread_pool_create_eager = 0,
+    /** Create threads as parallel loops need them, up to the number
+     * set by halide_set_num_threads: a loop with n tasks makes sure
+     * there are threads for them. Suits short-lived processes that
+     * rarely run wide parallel loops. */
+    halide_thread_pool_create_on_demand = 1,
+} halide_thread_pool_creation_t;
+
+/** Set when the default thread pool creates its worker threads. The
+ * initial setting comes from the HL_THREAD_POOL_CREATION environment
+ * variable, which may be "on_demand", and is eager otherwise. Threads
+ * that already exist are kept. Returns the old setting. Has no effect
+ * on platforms without a thread pool, or when a custom
+ * halide_do_par_for is in use. */
+extern halide_thread_pool_creation_t halide_set_thread_pool_creation_policy(halide_thread_pool_creation_t policy);
+
+/** Create all the worker threads of the default thread pool now, up to
+ * the number set by halide_set_num_threads, rather than when parallel
+ * loops first need them. Servers can call this at startup so that no
+ * request pays for creating threads. Returns an error code, which is
+ * zero on success. Has no effect on platforms without a thread pool. */
+extern int halide_thread_pool_prewarm(void *user_context);
+
+/** Limit the share of the default thread pool that the pipelines run
+ * with the given user_context get, so that one pipeline can't starve
+ * others running at the same time. At most max_threads threads
+ * (including the calling thread) work on their parallel loops at
+ * once, or any number if it's zero. When threads pick the next task
+ * to work on, they prefer the runnable tasks of pipelines with the
+ * highest priority, so a pipeline of higher priority takes threads
+ * over from others as their current tasks finish. Pipelines without
+ * settings have priority zero. Tasks that need several threads at
+ * once to make progress, such as those of async producers, are not
+ * limited. Setting both to zero returns the user_context to the
+ * defaults; don't do that while its pipelines are running. For JIT
+ * code, pass the JITUserContext given to Pipeline::realize. Returns
+ * an error if too many user_contexts have settings. Has no effect on
+ * platforms without a thread pool, or when a custom halide_do_par_for
+ * is in use. */
+extern int halide_set_thread_pool_qos(void *user_context, int max_threads, int priority);
+
+/** Pin the calling thread to the cpus of the given NUMA node. Combined
+ * with halide_set_thread_pool_numa_aware, this can be used to keep a
+ * pipeline invocation and the memory it allocates on one node: the
+ * parts of parallel loops run by the calling thread are taken from
+ * that node's block first. Returns an error code on failure, including
+ * when the node does not exist. */
+extern int halide_pin_current_thread_to_numa_node(int node);
+
 /** Halide calls these functions to allocate and free memory. To
  * replace in AOT code, use the halide_set_custom_malloc and
  * halide_set_custom_free, or (on platforms that support weak
@@ -435,6 +585,61 @@ extern halide_malloc_t halide_set_custom_malloc(halide_malloc_t user_malloc);
 extern halide_free_t halide_set_custom_free(halide_free_t user_free);
 //@}
 
+/** An allocator that can be used in place of halide_default_malloc
+ * and halide_default_free. Allocations of up to 32KB are rounded up
+ * to one of a set of sizes, and blocks of each size are carved out of
+ * slabs and cached per thread, so the common pattern of the same
+ * allocations being made and freed in every iteration of a parallel
+ * loop neither calls malloc nor takes a lock. Larger allocations go to
+ * halide_default_malloc. The memory it caches is never returned to the
+ * system. Only available on platforms that use pthreads. */
+//@{
+extern void *halide_caching_malloc(void *user_context, size_t x);
+extern void halide_caching_free(void *user_context, void *ptr);
+//@}
+
+/** Make halide_malloc and halide_free use halide_caching_malloc and
+ * halide_caching_free. Memory allocated by one allocator can't be freed
+ * by the other, so call this before running any pipeline. In
+ * JIT-compiled code, use Halide::Internal::JITSharedRuntime::use_caching_allocator. */
+extern void halide_use_caching_allocator();
+
+/** Pipelines compiled with Target::ArenaAllocations get the memory
+ * for their heap allocations from these, in one block (an arena) per
+ * nest of allocations, which is carved up at fixed offsets. The
+ * default implementations call halide_malloc and halide_free. Override
+ * them (on platforms that support weak linking) to supply memory from
+ * elsewhere, e.g. a buffer that's already pinned, chosen using the
+ * user_context. The memory must be aligned as halide_malloc's is. */
+//@{
+extern void *halide_arena_malloc(void *user_context, uint64_t size);
+extern void halide_arena_free(void *user_context, void *ptr);
+//@}
+
+/** An allocator that can be used in place of the current one for
+ * halide_malloc and halide_free, and backs large allocations with huge
+ * pages, to reduce TLB misses when walking large buffers, e.g. in
+ * column order. Allocations are mapped at a huge page boundary and
+ * marked with madvise(MADV_HUGEPAGE). Allocations of less than 2MB, or
+ * the threshold given to halide_use_huge_page_allocator, are passed on.
+ * Only implemented on Linux; elsewhere these are halide_default_malloc
+ * and halide_default_free. */
+//@{
+extern void *halide_huge_page_malloc(void *user_context, size_t x);
+extern void halide_huge_page_free(void *user_context, void *ptr);
+//@}
+
+/** Make halide_malloc and halide_free use halide_huge_page_malloc and
+ * halide_huge_page_free for allocations of at least min_bytes, and the
+ * allocator set before the call for smaller ones. If
+ * explicit_huge_pages is true, ask for pages from the kernel's pool of
+ * explicit huge pages (MAP_HUGETLB) first, which fails unless the pool
+ * has been configured with enough pages. Memory allocated before the
+ * call can't be freed after it, so call this before running any
+ * pipeline. Returns halide_error_code_unimplemented on platforms other
+ * than Linux. */
+extern int halide_use_huge_page_allocator(size_t min_bytes, bool explicit_huge_pages);
+
 /** Halide calls these functions to interact with the underlying
  * system runtime functions. To replace in AOT code on platforms that
  * support weak linking, define these functions yourself, or use
@@ -468,6 +673,24 @@ extern halide_get_library_symbol_t halide_set_custom_get_library_symbol(halide_g
 extern int32_t halide_debug_to_file(void *user_context, const char *filename,
                                     struct halide_buffer_t *buf);
 
+/** Make halide_debug_to_file return as soon as it has copied the
+ * buffer, and leave writing the file to a background thread, so that
+ * dumping large intermediates doesn't stall the pipeline. The files
+ * are written in the order of the calls. Calls wait while more than
+ * max_pending_megabytes of copies are waiting to be written, and a
+ * value of zero or less turns this off again, after waiting for the
+ * pending writes. Setting the environment variable
+ * HL_DEBUG_TO_FILE_ASYNC to a number of megabytes does the same. If a
+ * background write fails, the next call to halide_debug_to_file or
+ * halide_debug_to_file_flush returns the error. */
+extern void halide_set_debug_to_file_async(int max_pending_megabytes);
+
+/** Wait for the files queued by halide_debug_to_file in async mode to
+ * be written. Returns the error of the first write to fail since
+ * errors were last reported, if any. Pending writes are also finished
+ * when the program exits. */
+extern int halide_debug_to_file_flush(void *user_context);
+
 /** Types in the halide type system. They can be ints, unsigned ints,
  * or floats (of various bit-widths), or a handle (which is always 64-bits).
  * Note that the int/uint/float values do not imply a specific bit width
@@ -637,8 +860,9 @@ struct halide_trace_event_t {
  * implementation either prints events via halide_print, or if
  * HL_TRACE_FILE is defined, dumps the trace to that file in a
  * sequence of trace packets. The header for a trace packet is defined
- * below. If the trace is going to be large, you may want to make the
- * file a named pipe, and then read from that pipe into gzip.
+ * below. If the trace is going to be large, set HL_TRACE_COMPRESS=1 to
+ * compress the packets in blocks (see halide_trace_block_header_t), or
+ * make the file a named pipe, and then read from that pipe into gzip.
  *
  * halide_trace returns a unique ID which will be passed to future
  * events that "belong" to the earlier event as the parent id. The
@@ -750,6 +974,32 @@ struct halide_trace_packet_t {
 #endif
 };
 
+/** The value of halide_trace_block_header_t::magic. */
+#define HALIDE_TRACE_BLOCK_MAGIC 0x4b4c5448u
+
+/** If HL_TRACE_COMPRESS is set to 1, the default trace implementation
+ * writes the trace packets in blocks, each with this header followed by
+ * the packets compressed in the LZ4 block format. Blocks and uncompressed
+ * packets may be mixed in one file (e.g. because it was appended to by
+ * several runs). A packet never starts with the magic number, as it's
+ * far larger than any packet, so that tells the two apart. A reader can
+ * index the blocks by skipping from one header to the next without
+ * decompressing them. */
+struct halide_trace_block_header_t {
+    /** Always HALIDE_TRACE_BLOCK_MAGIC. */
+    uint32_t magic;
+
+    /** The size of the compressed packets following this header. If it's
+     * equal to uncompressed_size, the packets are stored uncompressed. */
+    uint32_t compressed_size;
+
+    /** The total size of the packets in the block. */
+    uint32_t uncompressed_size;
+
+    /** The number of packets in the block. */
+    uint32_t num_packets;
+};
+
 /** Set the file descriptor that Halide should write binary trace
  * events to. If called with 0 as the argument, Halide outputs trace
  * information to stdout in a human-readable format. If never called,
@@ -955,6 +1205,38 @@ extern int halide_get_gpu_device(void *user_context);
  */
 extern void halide_memoization_cache_set_size(int64_t size);
 
+/** Give the memoized Funcs of one pipeline their own cache budget, in
+ *  bytes, instead of sharing the one set by
+ *  halide_memoization_cache_set_size. If func_name is non-null, the
+ *  budget only covers the memoized Func with that name, and takes
+ *  precedence over a budget for the whole pipeline. Setting the
+ *  budget of an existing site again changes its size; a size of zero
+ *  means the default size. Entries stored before a budget is created
+ *  stay charged to the budget they were stored under. At most 15
+ *  sites may be given budgets, and names must be shorter than 64
+ *  characters; returns an error code otherwise.
+ */
+extern int halide_memoization_cache_set_site_size(const char *pipeline_name, const char *func_name, int64_t size);
+
+/** The policies the default memoization cache can use to choose which
+ *  entry to evict when a budget is exceeded. */
+typedef enum halide_memoization_cache_eviction_policy_t {
+    /** Evict the least recently used entry. This is the default. */
+    halide_memoization_cache_evict_lru = 0,
+    /** GreedyDual-Size: weigh the time an entry took to compute
+     *  against its size, so that entries which are cheap to recompute
+     *  per byte are evicted first, while ageing out entries that are
+     *  no longer used. */
+    halide_memoization_cache_evict_greedy_dual_size = 1,
+} halide_memoization_cache_eviction_policy_t;
+
+/** Set the eviction policy of the default memoization cache. The
+ *  recompute cost used by halide_memoization_cache_evict_greedy_dual_size
+ *  is the time between a cache miss and the store of its result, so it
+ *  is only known for entries computed after the policy is selected.
+ */
+extern int halide_memoization_cache_set_eviction_policy(halide_memoization_cache_eviction_policy_t policy);
+
 /** Given a cache key for a memoized result, currently constructed
  *  from the Func name and top-level Func name plus the arguments of
  *  the computation, determine if the result is in the cache and
@@ -1021,11 +1303,42 @@ extern void halide_memoization_cache_evict(void *user_context, uint64_t eviction
  */
 extern void halide_memoization_cache_release(void *user_context, void *host);
 
+/** Compute a hash of the type, shape and contents of a buffer, which
+ * is independent of the strides and address of its allocation. Funcs
+ * memoized with hash_buffer_contents use this as the cache key for the
+ * buffers they read. If the buffer is dirty on a device, it is copied
+ * to the host first. If that fails, a new value that won't match any
+ * earlier one is returned. */
+extern uint64_t halide_memoization_hash_buffer(void *user_context, struct halide_buffer_t *buf);
+
 /** Free all memory and resources associated with the memoization cache.
  * Must be called at a time when no other threads are accessing the cache.
  */
 extern void halide_memoization_cache_cleanup(void);
 
+/** Statistics for one shard of the default memoization cache. The
+ * cache is split into shards by key hash, each with its own lock and
+ * LRU list. */
+struct halide_memoization_cache_stats_t {
+    /** The number of lookups that found an entry, and that didn't. */
+    uint64_t hits, misses;
+    /** The number of entries evicted to keep the cache within the sizes
+     * set by halide_memoization_cache_set_size and
+     * halide_memoization_cache_set_site_size. Does not count entries
+     * removed by halide_memoization_cache_evict. */
+    uint64_t evictions;
+    /** The number of bytes and entries currently stored. */
+    int64_t bytes;
+    int32_t entries;
+};
+
+/** Get the number of shards the default memoization cache uses. */
+extern int halide_memoization_cache_shard_count(void);
+
+/** Get the statistics for one shard of the default memoization
+ * cache. Returns an error code if the shard index is out of range. */
+extern int halide_memoization_cache_get_stats(int shard, struct halide_memoization_cache_stats_t *stats);
+
 /** Verify that a given range of memory has been initialized; only used when Target::MSAN is enabled.
  *
  * The default implementation simply calls the LLVM-provided __msan_check_mem_is_initialized() function.
@@ -1463,6 +1776,23 @@ typedef enum halide_target_feature_t {
     halide_target_feature_semihosting,            ///< Used together with Target::NoOS for the baremetal target built with semihosting library and run with semihosting mode where minimum I/O communication with a host PC is available.
     halide_target_feature_avx10_1,                ///< Intel AVX10 version 1 support. vector_bits is used to indicate width.
     halide_target_feature_x86_apx,                ///< Intel x86 APX support. Covers initial set of features released as APX: egpr,push2pop2,ppx,ndd .
+    halide_target_feature_arm_sme,                ///< Enable ARM Scalable Matrix Extension (outer-product instructions in streaming mode)
+    halide_target_feature_float16_compute,        ///< Compute float32 arithmetic on float16 values in float16 where the hardware supports it.
+    halide_target_feature_auto_prefetch,          ///< Automatically prefetch strided reads in innermost loops.
+    halide_target_feature_profile_light,          ///< Alternative to halide_target_feature_profile that only times Funcs computed at root, cheaply enough to leave on in production.
+    halide_target_feature_track_allocations,      ///< Record every allocation and free of each Func, and report the peak memory use of each pipeline.
+    halide_target_feature_arena_allocations,      ///< Carve nested heap allocations out of a single allocation per arena, made by halide_arena_malloc.
+    halide_target_feature_auto_rfactor,           ///< Parallelize and vectorize large unscheduled reductions with rfactor.
+    halide_target_feature_specialization_dispatch, ///< Select among the specializations of each stage with one index computed from all their conditions.
+    halide_target_feature_wasm_relaxed_simd,      ///< Enable the WebAssembly relaxed-SIMD instructions (relaxed madd, swizzle and dot products). Requires wasm_simd128.
+    halide_target_feature_hvx_auto_vtcm,          ///< Store reused, fixed-size intermediates of HVX code in VTCM when they fit. Requires hvx_v65 or later.
+    halide_target_feature_strip_unused_runtime,   ///< Only keep the parts of the runtime an AOT pipeline uses. Public halide_ functions it doesn't call are dropped too.
+    halide_target_feature_llvm_fast_compile,      ///< Trade the speed of the generated code for compile time: run a minimal LLVM pass pipeline, and select instructions with FastISel. Overrides halide_target_feature_enable_llvm_loop_opt. (Ignored for non-LLVM targets.)
+    halide_target_feature_auto_storage_order,     ///< Pick the storage order (e.g. planar or interleaved) of intermediate Funcs whose storage order isn't scheduled, from the dimensions their vectorized loops access densely.
+    halide_target_feature_jit_interp,             ///< Run JIT-compiled pipelines by interpreting their lowered IR instead of compiling it with LLVM. Only useful for JIT compilation.
+    halide_target_feature_trusted_entry,          ///< Also generate <name>_check, which only validates the arguments, and <name>_unchecked, which runs the pipeline without validating them again.
+    halide_target_feature_loop_interchange,       ///< Reorder the loops of unscheduled pure definitions so that the innermost one walks memory densely.
+    halide_target_feature_device_resident,        ///< Check the dirty bits of inputs and outputs inline, and only call into the runtime to copy them when they're stale. For pipelines chained on a device.
     halide_target_feature_end                     ///< A sentinel. Every target is considered to have this feature, and setting this feature does nothing.
 } halide_target_feature_t;
 
@@ -1505,6 +1835,43 @@ extern halide_can_use_target_features_t halide_set_custom_can_use_target_feature
  */
 extern int halide_default_can_use_target_features(int count, const uint64_t *features);
 
+/** Returns 1 if the scalable vector registers (e.g. ARM SVE) of the current
+ * CPU are exactly vector_bits wide, and 0 otherwise (including when the width
+ * cannot be determined). compile_multitarget uses this to choose between
+ * sub-targets that differ only in vector_bits, since code compiled for one
+ * scalable vector width cannot run on hardware with another. */
+extern int halide_can_use_target_vector_bits(int vector_bits);
+
+/** Pipelines generated with the size_variants GeneratorParam contain
+ * several variants, each autoscheduled with the estimates scaled by a
+ * different factor. Each call is put in the bucket of the variant whose
+ * estimated output size is closest to the actual one, and the first
+ * calls in each bucket try each of the variants in turn (several times)
+ * to find the fastest one for that bucket, which is then used for all
+ * subsequent calls.
+ *
+ * halide_choose_size_variant is called by the pipeline to pick the
+ * variant to run for a call in the given bucket, and
+ * halide_report_size_variant_time to report how long it took. They may
+ * be overridden to implement other policies.
+ *
+ * The variants of Funcs scheduled with Stage::specialize_tuned are
+ * chosen the same way, with one bucket, under the name of the pipeline
+ * and the Func joined by a '.'.
+ */
+// @{
+extern int halide_choose_size_variant(void *user_context, const char *name, int bucket, int num_variants);
+extern int halide_report_size_variant_time(void *user_context, const char *name, int bucket, int variant, int64_t time_ns);
+// @}
+
+/** Return the variant chosen for the given bucket of the named pipeline,
+ * or -1 if the variants are still being tried. */
+extern int halide_get_size_variant(void *user_context, const char *name, int bucket);
+
+/** Forget which variants have been chosen, so that they are tried again,
+ * e.g. after the hardware or the workload changes. */
+extern void halide_reset_size_variants(void *user_context);
+
 typedef struct halide_dimension_t {
 #if (__cplusplus >= 201103L || _MSVC_LANG >= 201103L)
     int32_t min = 0, extent = 0, stride = 0;
@@ -1770,6 +2137,32 @@ struct halide_filter_argument_t_v0 {
     const struct halide_scalar_value_t *def, *min, *max;
 };
 
+/**
+ * Obsolete version of halide_filter_argument_t; only present in
+ * code that wrote halide_filter_metadata_t version 1.
+ */
+struct halide_filter_argument_t_v1 {
+    const char *name;
+    int32_t kind;
+    int32_t dimensions;
+    struct halide_type_t type;
+    const struct halide_scalar_value_t *scalar_def, *scalar_min, *scalar_max, *scalar_estimate;
+    int64_t const *const *buffer_estimates;
+};
+
+/** The storage layout a pipeline prefers for a buffer argument. */
+enum halide_buffer_layout_t {
+    /** The schedule doesn't constrain any dimension to be dense. */
+    halide_buffer_layout_unknown = 0,
+    /** The first dimension is dense (stride one), e.g. planar images. */
+    halide_buffer_layout_planar = 1,
+    /** The last dimension is dense, e.g. the channels of interleaved
+     * images, and the others are stored in order after it. */
+    halide_buffer_layout_interleaved = 2,
+    /** Some other dimension is dense. */
+    halide_buffer_layout_other = 3
+};
+
 /**
  * halide_filter_argument_t is essentially a plain-C-struct equivalent to
  * Halide::Argument; most user code will never need to create one.
@@ -1789,14 +2182,26 @@ struct halide_filter_argument_t {
     // estimates for each dimension of the buffer. (Note that any of the pointers
     // may be null as well.)
     int64_t const *const *buffer_estimates;
+    // The rest describe the buffers the pipeline runs fastest on, and are
+    // always zero for scalar arguments. host_alignment is the alignment,
+    // in bytes, the pipeline requires of the host pointer. layout is
+    // actually halide_buffer_layout_t, and comes from the stride
+    // constraints the schedule placed on the buffer. For planar buffers
+    // with no other stride constraints, padding is the number of elements
+    // the first dimension is best padded to a multiple of, so that each
+    // row starts aligned to the vector width; otherwise it is zero.
+    int32_t host_alignment;
+    int32_t layout;
+    int32_t padding;
+    int32_t reserved;
 };
 
 struct halide_filter_metadata_t {
 #ifdef __cplusplus
-    static const int32_t VERSION = 1;
+    static const int32_t VERSION = 2;
 #endif
 
-    /** version of this metadata; currently always 1. */
+    /** version of this metadata; currently always 2. */
     int32_t version;
 
     /** The number of entries in the arguments field. This is always >= 1. */
@@ -1855,6 +2260,18 @@ struct HALIDE_ATTRIBUTE_ALIGN(8) halide_profiler_func_stats {
     /** The average number of thread pool worker threads active while computing this Func. */
     uint64_t active_threads_numerator, active_threads_denominator;
 
+    /** The number of cycles, instructions and last-level cache misses
+     * counted by the hardware performance counters while computing this
+     * Func, summed over threads. Only counted when the environment
+     * variable HL_PROFILER_PERF_COUNTERS is set to 1, and the OS lets the
+     * process read the counters (currently Linux on x86 only). */
+    uint64_t cycles, instructions, llc_misses;
+
+    /** The time taken by the GPU kernels launched while computing this
+     * Func (in nanoseconds), as measured by device timestamps. Currently
+     * only measured for CUDA. */
+    uint64_t gpu_time;
+
     /** The name of this Func. A global constant string. */
     const char *name;
 
@@ -1959,6 +2376,22 @@ struct HALIDE_ATTRIBUTE_ALIGN(8) halide_profiler_instance_state {
     /** Whether or not this instance should count towards pipeline
      * statistics. */
     int should_collect_statistics;
+
+    /** Whether the threads running this instance should report when they
+     * switch Func, or start or stop working on it, to
+     * halide_profiler_thread_event. Set when the profiler timeline (see
+     * halide_profiler_write_timeline) or performance counters are
+     * enabled. */
+    int thread_events;
+};
+
+/** The kinds of event reported to halide_profiler_thread_event: a thread
+ * switching to computing a different Func, and a thread starting or
+ * stopping work on a pipeline (e.g. a parallel task). */
+enum halide_profiler_thread_event_kind {
+    halide_profiler_event_func = 0,
+    halide_profiler_event_active = 1,
+    halide_profiler_event_idle = 2,
 };
 
 /** The global state of the profiler. */
@@ -2026,6 +2459,24 @@ extern void halide_profiler_shutdown(void);
  * reset. Also happens at process exit. */
 extern void halide_profiler_report(void *user_context);
 
+/** If the environment variable HL_PROFILER_TIMELINE is set to the name of a
+ * file when the first profiled pipeline runs, each thread records when it
+ * works on each Func into a ring buffer of HL_PROFILER_TIMELINE_EVENTS
+ * (default 16384) events, and the buffers are written to that file as a
+ * Chrome trace (which Perfetto can also load) at process exit. This writes
+ * them to the given file now instead. Returns an error if any profiled
+ * pipeline is running. */
+extern int halide_profiler_write_timeline(void *user_context, const char *file_name);
+
+/** Record an event in the profiler timeline of the calling thread, and
+ * bill its performance counters to the Func it was working on. Called by
+ * profiled pipelines when either is enabled. */
+extern int halide_profiler_thread_event(struct halide_profiler_instance_state *instance, int kind, int func);
+
+/** Add the device time taken by the GPU kernels launched by a Func to
+ * its stats. Called by profiled pipelines after each GPU loop. */
+extern int halide_profiler_gpu_time(struct halide_profiler_instance_state *instance, int func_id, uint64_t time);
+
 /** These routines are called to temporarily disable and then reenable
  * the profiler. */
 //@{
@@ -2033,6 +2484,194 @@ extern void halide_profiler_lock(struct halide_profiler_state *);
 extern void halide_profiler_unlock(struct halide_profiler_state *);
 //@}
 
+/** Per-Func statistics gathered by the light profiler
+ * (Target::ProfileLight). Only Funcs computed at root are timed. */
+struct halide_profiler_light_func_stats {
+    /** The time spent computing this Func, in ticks of the cycle counter
+     * (see halide_profiler_light_seconds_per_tick), and the number of
+     * times it was computed. Updated atomically. */
+    uint64_t ticks, count;
+
+    /** The name of this Func. */
+    const char *name;
+};
+
+/** Per-pipeline statistics gathered by the light profiler. These are
+ * never freed, so they can be read while pipelines are running. */
+struct halide_profiler_light_pipeline_stats {
+    /** The time spent running this pipeline, in ticks, and the number of
+     * times it was run. Bounds queries aren't counted. Updated
+     * atomically. */
+    uint64_t ticks, runs;
+
+    /** The name of this pipeline. */
+    const char *name;
+
+    /** An array containing the stats of each Func in this pipeline. */
+    struct halide_profiler_light_func_stats *funcs;
+
+    /** The next pipeline_stats pointer. It's a void * because types
+     * in the Halide runtime may not currently be recursive. */
+    void *next;
+
+    /** The number of funcs in this pipeline. */
+    int num_funcs;
+};
+
+/** Find or create the light profiler stats for a pipeline. Called at the
+ * start of each run of a pipeline compiled with Target::ProfileLight,
+ * with the current value of the cycle counter. Doesn't take any locks
+ * once the pipeline is registered. Returns null if out of memory, in which
+ * case the run isn't profiled. */
+extern struct halide_profiler_light_pipeline_stats *
+halide_profiler_light_pipeline_start(void *user_context, const char *pipeline_name,
+                                     int num_funcs, const char **func_names, uint64_t ticks);
+
+/** Add the time taken by one computation of a Func to its stats. */
+extern int halide_profiler_light_record_func(struct halide_profiler_light_pipeline_stats *p,
+                                             int func_id, uint64_t ticks);
+
+/** Add the time taken by one run of a pipeline to its stats. */
+extern int halide_profiler_light_pipeline_end(struct halide_profiler_light_pipeline_stats *p,
+                                              uint64_t ticks);
+
+/** Get the list of the stats of all pipelines run with the light
+ * profiler. */
+extern struct halide_profiler_light_pipeline_stats *halide_profiler_light_get_pipelines(void);
+
+/** The length of a tick of the cycle counter the light profiler uses, as
+ * calibrated against halide_current_time_ns while pipelines run. Returns
+ * zero until pipelines have run for long enough to calibrate it. */
+extern double halide_profiler_light_seconds_per_tick(void);
+
+/** Write the light profiler stats to buf in the Prometheus text format,
+ * as the counters halide_pipeline_seconds_total, halide_pipeline_runs_total,
+ * halide_func_seconds_total and halide_func_runs_total. Like snprintf,
+ * writes at most size bytes including the terminating null, and returns
+ * the length of the full text. */
+extern int halide_profiler_light_format_metrics(void *user_context, char *buf, int size);
+
+/** Zero the light profiler stats. Pipelines running concurrently may
+ * still add to them. */
+extern void halide_profiler_light_reset(void);
+
+/** The kinds of memory tracked by Target::TrackAllocations. */
+typedef enum halide_allocation_kind_t {
+    halide_allocation_kind_heap = 0,
+    halide_allocation_kind_stack = 1,
+    halide_allocation_kind_device = 2,
+} halide_allocation_kind_t;
+
+/** The stats of one allocation site of a pipeline compiled with
+ * Target::TrackAllocations: the storage of one Func, of one kind. */
+struct halide_allocation_site_stats {
+    /** The name of the Func (or other buffer) allocated. */
+    const char *name;
+
+    /** A scheduling change that might make the storage smaller or
+     * shorter-lived, chosen at compile time from where it's stored. */
+    const char *hint;
+
+    /** A halide_allocation_kind_t. */
+    int kind;
+
+    /** The number of times it was allocated. */
+    uint64_t count;
+
+    /** The most bytes of it live at once, over all runs. */
+    uint64_t peak_bytes;
+
+    /** The bytes of it that were live at the peak of the pipeline (see
+     * halide_allocation_pipeline_stats::peak_bytes). */
+    uint64_t bytes_at_peak;
+};
+
+/** An allocation (positive bytes) or free (negative bytes) in the run of
+ * a pipeline that reached its peak memory use. */
+struct halide_allocation_event {
+    /** Nanoseconds since the start of the run. */
+    uint64_t time_ns;
+
+    /** The bytes allocated, or minus the bytes freed. */
+    int64_t bytes;
+
+    /** The bytes live after this event, over all sites. */
+    uint64_t live_bytes;
+
+    /** The index of the site in halide_allocation_pipeline_stats::sites. */
+    int site;
+};
+
+/** The allocation stats of a pipeline compiled with
+ * Target::TrackAllocations. These are never freed. */
+struct halide_allocation_pipeline_stats {
+    /** The name of this pipeline. */
+    const char *name;
+
+    /** The number of runs tracked (bounds queries aren't counted). */
+    uint64_t runs;
+
+    /** The most bytes live at once in any run. */
+    uint64_t peak_bytes;
+
+    /** The allocation sites of this pipeline. */
+    struct halide_allocation_site_stats *sites;
+
+    /** The events of the run that reached peak_bytes, up to and including
+     * the one that reached it. If the run had too many events to keep,
+     * this only has the latest ones. */
+    struct halide_allocation_event *peak_timeline;
+
+    /** The next pipeline_stats pointer. It's a void * because types
+     * in the Halide runtime may not currently be recursive. */
+    void *next;
+
+    /** The number of sites, and of events in peak_timeline. */
+    int num_sites, peak_timeline_length;
+};
+
+/** Start tracking a run of a pipeline compiled with
+ * Target::TrackAllocations, registering its stats if this is its first
+ * run. Returns the state of the run, which the other calls take, or null
+ * if out of memory, in which case the run isn't tracked. The run ends
+ * with halide_allocation_tracker_pipeline_end, which the pipeline
+ * registers as a destructor of the state. */
+extern void *halide_allocation_tracker_pipeline_start(void *user_context, const char *pipeline_name,
+                                                      int num_sites, const char **site_names,
+                                                      const char **site_hints, const int *site_kinds);
+
+/** Record an allocation, or a free, by a pipeline. */
+// @{
+extern int halide_allocation_tracker_allocate(void *user_context, void *run, int site, uint64_t bytes);
+extern int halide_allocation_tracker_free(void *user_context, void *run, int site, uint64_t bytes);
+// @}
+
+/** Record a device allocation, or free, of a buffer by a pipeline. The
+ * size is that of the buffer. A buffer already allocated isn't counted
+ * again. */
+// @{
+extern int halide_allocation_tracker_device_malloc(void *user_context, void *run, int site,
+                                                   struct halide_buffer_t *buf);
+extern int halide_allocation_tracker_device_free(void *user_context, void *run,
+                                                 struct halide_buffer_t *buf);
+// @}
+
+/** End a run, and merge its stats into its pipeline's. */
+extern void halide_allocation_tracker_pipeline_end(void *user_context, void *run);
+
+/** Get the list of the allocation stats of all pipelines tracked. */
+extern struct halide_allocation_pipeline_stats *halide_allocation_tracker_get_pipelines(void);
+
+/** Print the peak memory use of each pipeline tracked: what was live at
+ * the peak, with a hint of how to shrink each part of it, and the
+ * allocations and frees that led up to it. This is done at exit if any
+ * pipelines were tracked. */
+extern void halide_allocation_tracker_report(void *user_context);
+
+/** Zero the allocation stats of all pipelines tracked. Must not be
+ * called while any are running. */
+extern void halide_allocation_tracker_reset(void);
+
 /// \name "Float16" functions
 /// These functions operate of bits (``uint16_t``) representing a half
 /// precision floating point number (IEEE-754 2008 binary16).
@@ -62,11 +62,92 @@ extern int halide_cuda_detach_device_ptr(void *user_context, struct halide_buffe
 extern uintptr_t halide_cuda_get_device_ptr(void *user_context, struct halide_buffer_t *buf);
 
 /** Release any currently-unused device allocations back to the cuda
- * driver. See halide_reuse_device_allocations. */
+ * driver, along with any idle pinned staging memory. See
+ * halide_reuse_device_allocations. */
 extern int halide_cuda_release_unused_device_allocations(void *user_context);
 
+/** Allocate and free page-locked host memory with cuMemHostAlloc. Copies
+ * between the device and buffers whose host field points into such an
+ * allocation are issued asynchronously on the stream returned by
+ * halide_cuda_get_stream. A copy from the host must therefore not be
+ * followed by writes to the host memory until the stream has reached
+ * it, e.g. via halide_device_sync. A copy to the host is complete when
+ * it returns. Copies from ordinary host memory are staged through a
+ * pool of pinned memory managed by the runtime and are safe to
+ * overwrite as soon as the copy returns. To back a Halide::Runtime::Buffer
+ * with pinned memory, wrap these in the allocate_fn/deallocate_fn
+ * passed to Buffer::allocate. */
+// @{
+extern void *halide_cuda_host_malloc(void *user_context, size_t size);
+extern void halide_cuda_host_free(void *user_context, void *ptr);
+// @}
+
+/** Turn stream-ordered device allocation on or off. It is off by
+ * default. While it is on, device allocations come from a memory pool
+ * owned by the runtime via cuMemAllocFromPoolAsync. They are returned
+ * to the pool with cuMemFreeAsync on the stream from
+ * halide_cuda_get_stream, so freed memory is recycled in stream order
+ * without synchronizing the device and without the free list used by
+ * halide_reuse_device_allocations. The pool keeps its memory until it
+ * is trimmed with halide_cuda_trim_device_memory_pool or
+ * halide_cuda_release_unused_device_allocations. Fails if the CUDA
+ * driver does not support memory pools. */
+extern int halide_cuda_set_stream_ordered_allocation(void *user_context, bool enabled);
+
+/** Release unused memory held by the current context's pool back to
+ * the driver, keeping at least bytes_to_keep bytes reserved. */
+extern int halide_cuda_trim_device_memory_pool(void *user_context, size_t bytes_to_keep);
+
+/** Report the memory reserved from the driver by the current context's
+ * pool and the memory in use by allocations from it, along with the
+ * high-water mark of each. All are zero if no pool has been created. */
+extern int halide_cuda_get_device_memory_pool_stats(void *user_context,
+                                                    uint64_t *reserved, uint64_t *reserved_high,
+                                                    uint64_t *used, uint64_t *used_high);
+
+/** Spread kernel launches over up to num_streams streams (at most 8),
+ * so that kernels which share no device allocations can run at the
+ * same time. The first stream is the one returned by
+ * halide_cuda_get_stream; the others are created by the runtime. A
+ * kernel waits, via events, for earlier kernels that touched any of
+ * the same allocations, and for everything queued on the first stream
+ * before it. The first stream waits for all the others again before
+ * any copy, sync or free, and at the end of each pipeline, so results
+ * are ordered on it as usual. The default of 1 issues every kernel on
+ * the first stream. Ignored while graph replay is enabled. */
+extern int halide_cuda_set_concurrent_streams(void *user_context, int num_streams);
+
+/** Turn CUDA graph replay on or off. It is off by default. While it is
+ * on, kernel launches are queued instead of being issued, until the
+ * next copy, device sync, or release of device memory to the driver
+ * made through this runtime. The first time a queue of launches is
+ * seen it is issued launch-by-launch and captured into a CUDA
+ * graph. Later queues with exactly the same kernels, launch
+ * dimensions and arguments (which include buffer device pointers and
+ * shapes) are replayed from that graph with a single launch. Errors
+ * from queued kernels are reported by the call that flushes them.
+ * Code that touches Halide-owned device memory without going through
+ * this runtime must call halide_device_sync first. Fails if the CUDA
+ * driver does not support graphs. Turning replay off issues anything
+ * still queued. */
+extern int halide_cuda_set_graph_replay(void *user_context, bool enabled);
+
+/** Report how many launch sequences have been captured into graphs,
+ * and how many times a captured graph has been replayed. */
+extern int halide_cuda_get_graph_replay_stats(void *user_context, uint64_t *captures, uint64_t *replays);
+
 // These typedefs treat both a CUcontext and a CUstream as a void *,
 // to avoid dependencies on cuda headers.
+/** Time the kernels launched between these calls with device events,
+ * for the profiler. halide_cuda_kernel_timer_start returns null if
+ * timing isn't possible, and halide_cuda_kernel_timer_end waits for the
+ * kernels, frees the timer and returns the device time they took in
+ * nanoseconds (or zero if that can't be measured). */
+// @{
+extern void *halide_cuda_kernel_timer_start(void *user_context);
+extern uint64_t halide_cuda_kernel_timer_end(void *user_context, void *timer);
+// @}
+
 typedef int (*halide_cuda_acquire_context_t)(void *,   // user_context
                                              void **,  // cuda context out parameter
                                              bool);    // should create a context if none exist
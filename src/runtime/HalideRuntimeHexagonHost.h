@@ -45,6 +45,21 @@ extern int halide_hexagon_wrap_device_handle(void *user_context, struct halide_b
  * on return. */
 extern int halide_hexagon_detach_device_handle(void *user_context, struct halide_buffer_t *buf);
 
+/** Register a buffer that was allocated with a file descriptor (an ION
+ * or DMA-BUF allocation, e.g. made by a camera HAL) with FastRPC, so
+ * that it stays mapped on Hexagon across pipeline calls, instead of
+ * being mapped on each call. ptr and size are the host mapping of the
+ * buffer. Registrations are keyed on fd and reference counted:
+ * registering an fd that is already registered just increments its
+ * count. Buffers allocated by the Hexagon runtime itself are always
+ * registered, so this is only useful for buffers wrapped with
+ * halide_hexagon_wrap_device_handle. The fd must stay open until it is
+ * unregistered. */
+// @{
+extern int halide_hexagon_register_ion_buffer(void *user_context, void *ptr, uint64_t size, int fd);
+extern int halide_hexagon_unregister_ion_buffer(void *user_context, int fd);
+// @}
+
 /** Return the underlying device handle for a halide_buffer_t. If there is
  * no device memory (dev field is NULL), this returns 0. */
 extern void *halide_hexagon_get_device_handle(void *user_context, struct halide_buffer_t *buf);
@@ -65,6 +80,21 @@ extern int halide_hexagon_power_hvx_off(void *user_context);
 extern void halide_hexagon_power_hvx_off_as_destructor(void *user_context, void * /* obj */);
 // @}
 
+/** Batch the Hexagon pipeline calls made with this user_context
+ * between halide_hexagon_begin_batch and halide_hexagon_end_batch, and
+ * run them on the device in one remote call. Each call to an offloaded
+ * pipeline returns as soon as it has been recorded; the recorded calls
+ * run, in order, when the batch ends, or earlier if the host accesses
+ * Hexagon buffer memory through the runtime (e.g. copy_to_host,
+ * copy_to_device or device_free). An error from a recorded call is
+ * returned by whichever of these runs it. Don't read or write the
+ * host memory of zero-copy buffers used in the batch directly until it
+ * ends. Only one batch may be active at a time. */
+// @{
+extern int halide_hexagon_begin_batch(void *user_context);
+extern int halide_hexagon_end_batch(void *user_context);
+// @}
+
 /** Power modes for Hexagon. */
 typedef enum halide_hexagon_power_mode_t {
     halide_hexagon_power_low = 0,
@@ -79,6 +79,22 @@ extern void halide_opencl_set_build_options(const char *n);
  * halide_opencl_set_build_options. */
 extern const char *halide_opencl_get_build_options(void *user_context);
 
+/** Set the directory in which OpenCL program binaries are cached
+ * between runs. The argument is copied internally. Binaries are keyed
+ * on the device, driver version, build options and kernel source, so
+ * a stale entry is never used. If never called, Halide uses the
+ * environment variable HL_OCL_PROGRAM_CACHE_DIR. An empty path
+ * disables the cache. */
+extern void halide_opencl_set_program_cache_dir(const char *n);
+
+/** Halide calls this to get the directory used to cache OpenCL program
+ * binaries. Implement this yourself to use a different directory per
+ * user_context. The default implementation returns the value set by
+ * halide_opencl_set_program_cache_dir, or the environment variable
+ * HL_OCL_PROGRAM_CACHE_DIR. The result is valid until the next call to
+ * halide_opencl_set_program_cache_dir. */
+extern const char *halide_opencl_get_program_cache_dir(void *user_context);
+
 /** Set the underlying cl_mem for a halide_buffer_t. This memory should be
  * allocated using clCreateBuffer or similar and must have an extent
  * large enough to cover that specified by the halide_buffer_t extent
@@ -114,6 +114,16 @@ extern void halide_vulkan_set_allocation_callbacks(const struct VkAllocationCall
 // -- may return nullptr ... which indicates the default Vulkan runtime implementation is being used)
 extern const struct VkAllocationCallbacks *halide_vulkan_get_allocation_callbacks(void *user_context);
 
+// Merge the unused space within each block of device memory, and release any blocks that become empty
+extern int halide_vulkan_defragment_device_memory(void *user_context);
+
+// Query the utilization of the device memory managed by the Vulkan runtime (any output may be nullptr)
+// -- fragmentation can be estimated as 1 - (largest_available / available_bytes)
+extern int halide_vulkan_get_device_memory_stats(void *user_context,
+                                                 uint64_t *block_count, uint64_t *block_bytes,
+                                                 uint64_t *reserved_bytes, uint64_t *available_bytes,
+                                                 uint64_t *largest_available);
+
 // Access methods to assign/retrieve required layer names for the context
 extern void halide_vulkan_set_layer_names(const char *n);
 extern const char *halide_vulkan_get_layer_names(void *user_context);
@@ -130,6 +140,11 @@ extern const char *halide_vulkan_get_device_type(void *user_context);
 extern void halide_vulkan_set_build_options(const char *n);
 extern const char *halide_vulkan_get_build_options(void *user_context);
 
+// Access methods to assign/retrieve the file used to persist the compiled pipeline cache between
+// processes (empty disables persistence, default is the value of HL_VK_PIPELINE_CACHE)
+extern void halide_vulkan_set_pipeline_cache_path(const char *n);
+extern const char *halide_vulkan_get_pipeline_cache_path(void *user_context);
+
 #ifdef __cplusplus
 }  // End extern "C"
 #endif
@@ -200,3 +200,11 @@ define weak_odr <vscale x 8 x half> @fast_inverse_sqrt_f16nx8(<vscale x 8 x half
        %result = fmul <vscale x 8 x half> %approx, %correction
        ret <vscale x 8 x half> %result
 }
+
+; The cycle counter read by pipelines compiled with the light profiler. The
+; virtual counter is readable from user space, unlike the cycle counter that
+; llvm.readcyclecounter reads.
+define weak_odr i64 @halide_profiler_light_ticks() nounwind alwaysinline {
+       %ticks = tail call i64 asm sideeffect "mrs $0, cntvct_el0", "=r"()
+       ret i64 %ticks
+}
@@ -8,6 +8,7 @@ namespace Internal {
 #if LINUX
 
 extern "C" unsigned long getauxval(unsigned long type);
+extern "C" int prctl(int option, ...);
 
 #define AT_HWCAP 16
 #define AT_HWCAP2 26
@@ -18,6 +19,11 @@ extern "C" unsigned long getauxval(unsigned long type);
 #define HWCAP_ASIMDDP (1 << 20)
 #define HWCAP_SVE (1 << 22)
 #define HWCAP2_SVE2 (1 << 1)
+#define HWCAP2_SME (1 << 23)
+
+// https://github.com/torvalds/linux/blob/master/include/uapi/linux/prctl.h
+#define PR_SVE_GET_VL 51
+#define PR_SVE_VL_LEN_MASK 0xffff
 
 namespace {
 
@@ -35,11 +41,22 @@ void set_platform_features(CpuFeatures &features) {
 
     if (hwcaps & HWCAP_SVE) {
         features.set_available(halide_target_feature_sve);
+
+        // The kernel reports the vector length in bytes; asking it avoids
+        // executing an SVE instruction just to read it.
+        int vl = prctl(PR_SVE_GET_VL);
+        if (vl > 0) {
+            features.scalable_vector_bits = (uint64_t)(vl & PR_SVE_VL_LEN_MASK) * 8;
+        }
     }
 
     if (hwcaps2 & HWCAP2_SVE2) {
         features.set_available(halide_target_feature_sve2);
     }
+
+    if (hwcaps2 & HWCAP2_SME) {
+        features.set_available(halide_target_feature_arm_sme);
+    }
 }
 
 }  // namespace
@@ -64,6 +81,10 @@ void set_platform_features(CpuFeatures &features) {
     if (sysctl_is_set("hw.optional.arm.FEAT_FP16")) {
         features.set_available(halide_target_feature_arm_fp16);
     }
+
+    if (sysctl_is_set("hw.optional.arm.FEAT_SME")) {
+        features.set_available(halide_target_feature_arm_sme);
+    }
 }
 
 }  // namespace
@@ -118,6 +139,7 @@ WEAK CpuFeatures halide_get_cpu_features() {
     CpuFeatures features;
     features.set_known(halide_target_feature_arm_dot_prod);
     features.set_known(halide_target_feature_arm_fp16);
+    features.set_known(halide_target_feature_arm_sme);
     features.set_known(halide_target_feature_armv7s);
     features.set_known(halide_target_feature_no_neon);
     features.set_known(halide_target_feature_sve);
@@ -0,0 +1,446 @@
+#include "HalideRuntime.h"
+#include "printer.h"
+#include "runtime_atomics.h"
+#include "runtime_internal.h"
+#include "scoped_mutex_lock.h"
+
+// Pipelines compiled with Target::TrackAllocations call into here at
+// every allocation and free of a Func's storage. Each run keeps the
+// timeline of its allocations, and the timeline of the run that reached
+// the highest peak is kept in its pipeline's stats, so the report can
+// show what was live at the peak and what led up to it.
+
+namespace Halide {
+namespace Runtime {
+namespace Internal {
+
+// The stats of all registered pipelines. They're never freed.
+WEAK halide_allocation_pipeline_stats *tracked_pipelines = nullptr;
+
+// Guards registration, and merging runs into the stats.
+WEAK halide_mutex tracker_lock = {{0}};
+
+WEAK bool tracker_clock_started = false;
+
+// The most events a run keeps. Beyond this, the oldest are dropped.
+constexpr int kMaxTrackedEvents = 1 << 20;
+
+struct TrackedDeviceAllocation {
+    halide_buffer_t *buf;
+    int site;
+    uint64_t bytes;
+};
+
+// A growable array of trivially copyable values, in memory from malloc.
+template<typename T>
+struct TrackerVector {
+    T *data = nullptr;
+    int size = 0, capacity = 0;
+
+    bool push_back(const T &value) {
+        if (size == capacity) {
+            int new_capacity = capacity ? capacity * 2 : 256;
+            T *new_data = (T *)malloc(new_capacity * sizeof(T));
+            if (!new_data) {
+                return false;
+            }
+            if (data) {
+                memcpy(new_data, data, size * sizeof(T));
+                free(data);
+            }
+            data = new_data;
+            capacity = new_capacity;
+        }
+        data[size++] = value;
+        return true;
+    }
+
+    void release() {
+        free(data);
+        data = nullptr;
+        size = capacity = 0;
+    }
+};
+
+struct TrackedRun {
+    halide_allocation_pipeline_stats *stats;
+    halide_mutex lock;
+    uint64_t start_ns;
+    uint64_t live_bytes, peak_bytes;
+
+    // The events, as a ring buffer once there are kMaxTrackedEvents of
+    // them. first_event is the index of the oldest.
+    TrackerVector<halide_allocation_event> events;
+    int first_event;
+    // The number of events recorded when the peak was reached.
+    uint64_t num_events, peak_num_events;
+
+    TrackerVector<TrackedDeviceAllocation> device_allocations;
+
+    // Per site: the live bytes, the most live at once, and the count.
+    uint64_t *site_live, *site_peak, *site_count;
+};
+
+WEAK halide_allocation_pipeline_stats *find_tracked_pipeline(const char *pipeline_name, int num_sites) {
+    for (halide_allocation_pipeline_stats *p = tracked_pipelines; p;
+         p = (halide_allocation_pipeline_stats *)(p->next)) {
+        // The name isn't compared by pointer, because JIT-compiled
+        // pipelines may be released and others compiled at the same
+        // address.
+        if (p->num_sites == num_sites && strcmp(p->name, pipeline_name) == 0) {
+            return p;
+        }
+    }
+    return nullptr;
+}
+
+WEAK halide_allocation_pipeline_stats *register_tracked_pipeline(const char *pipeline_name, int num_sites,
+                                                                 const char **site_names, const char **site_hints,
+                                                                 const int *site_kinds) {
+    // Copy the names, which may belong to JIT-compiled code that's
+    // released before the stats are read. Allocate everything in one
+    // block.
+    size_t size = sizeof(halide_allocation_pipeline_stats) +
+                  num_sites * sizeof(halide_allocation_site_stats) +
+                  strlen(pipeline_name) + 1;
+    for (int i = 0; i < num_sites; i++) {
+        size += strlen(site_names[i]) + strlen(site_hints[i]) + 2;
+    }
+    halide_allocation_pipeline_stats *p = (halide_allocation_pipeline_stats *)malloc(size);
+    if (!p) {
+        return nullptr;
+    }
+    memset(p, 0, size);
+    p->sites = (halide_allocation_site_stats *)(p + 1);
+    p->num_sites = num_sites;
+    char *names = (char *)(p->sites + num_sites);
+    const auto copy_name = [&](const char *name) {
+        size_t len = strlen(name) + 1;
+        memcpy(names, name, len);
+        const char *result = names;
+        names += len;
+        return result;
+    };
+    p->name = copy_name(pipeline_name);
+    for (int i = 0; i < num_sites; i++) {
+        p->sites[i].name = copy_name(site_names[i]);
+        p->sites[i].hint = copy_name(site_hints[i]);
+        p->sites[i].kind = site_kinds[i];
+    }
+    p->next = tracked_pipelines;
+    tracked_pipelines = p;
+    return p;
+}
+
+WEAK void record_allocation_event(void *user_context, TrackedRun *run, int site, int64_t bytes) {
+    using namespace Halide::Runtime::Internal::Synchronization;
+    ScopedMutexLock lock(&run->lock);
+    run->live_bytes += bytes;
+    run->site_live[site] += bytes;
+    if (bytes > 0) {
+        run->site_count[site]++;
+        run->site_peak[site] = max(run->site_peak[site], run->site_live[site]);
+    }
+
+    halide_allocation_event e;
+    e.time_ns = (uint64_t)halide_current_time_ns(user_context) - run->start_ns;
+    e.bytes = bytes;
+    e.live_bytes = run->live_bytes;
+    e.site = site;
+    if (run->events.size < kMaxTrackedEvents) {
+        // If this runs out of memory, the event is dropped, but the live
+        // bytes are still right.
+        run->events.push_back(e);
+    } else {
+        run->events.data[run->first_event] = e;
+        run->first_event = (run->first_event + 1) % kMaxTrackedEvents;
+    }
+    run->num_events++;
+
+    if (run->live_bytes > run->peak_bytes) {
+        run->peak_bytes = run->live_bytes;
+        run->peak_num_events = run->num_events;
+    }
+}
+
+// Keep the events of the run up to its peak (as many of them as it kept)
+// as the pipeline's peak timeline, and find what was live at the peak.
+WEAK void keep_peak_timeline(TrackedRun *run) {
+    halide_allocation_pipeline_stats *p = run->stats;
+    free(p->peak_timeline);
+    p->peak_timeline = nullptr;
+    p->peak_timeline_length = 0;
+    p->peak_bytes = run->peak_bytes;
+
+    // The events after the peak, and any dropped before it, are skipped.
+    const uint64_t kept = run->events.size;
+    const uint64_t dropped = run->num_events - kept;
+    const uint64_t after_peak = run->num_events - run->peak_num_events;
+    const int length = after_peak < kept ? (int)(kept - after_peak) : 0;
+    if (length > 0) {
+        p->peak_timeline = (halide_allocation_event *)malloc(length * sizeof(halide_allocation_event));
+    }
+    if (p->peak_timeline) {
+        for (int i = 0; i < length; i++) {
+            p->peak_timeline[i] = run->events.data[(run->first_event + i) % kMaxTrackedEvents];
+        }
+        p->peak_timeline_length = length;
+    }
+
+    // The bytes live at the peak are those live at the end of the kept
+    // timeline, which are only known exactly if nothing was dropped.
+    for (int i = 0; i < p->num_sites; i++) {
+        p->sites[i].bytes_at_peak = 0;
+    }
+    if (dropped == 0) {
+        for (int i = 0; i < p->peak_timeline_length; i++) {
+            const halide_allocation_event &e = p->peak_timeline[i];
+            p->sites[e.site].bytes_at_peak += e.bytes;
+        }
+    }
+}
+
+WEAK const char *allocation_kind_name(int kind) {
+    switch (kind) {
+    case halide_allocation_kind_heap:
+        return "heap";
+    case halide_allocation_kind_stack:
+        return "stack";
+    case halide_allocation_kind_device:
+        return "device";
+    default:
+        return "unknown";
+    }
+}
+
+WEAK void allocation_tracker_report_unlocked(void *user_context) {
+    StringStreamPrinter<1024> sstr(user_context);
+
+    for (halide_allocation_pipeline_stats *p = tracked_pipelines; p;
+         p = (halide_allocation_pipeline_stats *)(p->next)) {
+        if (!p->runs) {
+            continue;
+        }
+        sstr.clear();
+        sstr << p->name << "\n"
+             << " runs: " << p->runs << "  peak live memory: " << p->peak_bytes << " bytes\n";
+        halide_print(user_context, sstr.str());
+
+        // The sites live at the peak, largest first.
+        int *order = (int *)__builtin_alloca(p->num_sites * sizeof(int));
+        int num_live = 0;
+        for (int i = 0; i < p->num_sites; i++) {
+            const uint64_t b = p->sites[i].bytes_at_peak;
+            if (!b) {
+                continue;
+            }
+            int j = num_live++;
+            for (; j > 0 && p->sites[order[j - 1]].bytes_at_peak < b; j--) {
+                order[j] = order[j - 1];
+            }
+            order[j] = i;
+        }
+        if (num_live) {
+            halide_print(user_context, " live at the peak:\n");
+        }
+        for (int i = 0; i < num_live; i++) {
+            const halide_allocation_site_stats &site = p->sites[order[i]];
+            sstr.clear();
+            sstr << "  " << site.name << " (" << allocation_kind_name(site.kind) << "): "
+                 << site.bytes_at_peak << " bytes"
+                 << "  allocations: " << site.count
+                 << "  peak: " << site.peak_bytes << " bytes\n";
+            if (*site.hint) {
+                sstr << "    hint: " << site.hint << "\n";
+            }
+            halide_print(user_context, sstr.str());
+        }
+
+        // The events just before the peak are the ones that matter.
+        const int kMaxPrinted = 32;
+        const int first = p->peak_timeline_length > kMaxPrinted ? p->peak_timeline_length - kMaxPrinted : 0;
+        if (p->peak_timeline_length) {
+            sstr.clear();
+            sstr << " timeline up to the peak";
+            if (first > 0) {
+                sstr << " (last " << kMaxPrinted << " of " << p->peak_timeline_length << " events)";
+            }
+            sstr << ":\n";
+            halide_print(user_context, sstr.str());
+        }
+        for (int i = first; i < p->peak_timeline_length; i++) {
+            const halide_allocation_event &e = p->peak_timeline[i];
+            sstr.clear();
+            sstr << "  " << e.time_ns / 1000000.0 << " ms: "
+                 << (e.bytes > 0 ? "+" : "") << e.bytes << " bytes "
+                 << p->sites[e.site].name << " (" << allocation_kind_name(p->sites[e.site].kind) << ")"
+                 << "  live: " << e.live_bytes << "\n";
+            halide_print(user_context, sstr.str());
+        }
+    }
+}
+
+}  // namespace Internal
+}  // namespace Runtime
+}  // namespace Halide
+
+using namespace Halide::Runtime::Internal;
+
+extern "C" {
+
+WEAK void *halide_allocation_tracker_pipeline_start(void *user_context, const char *pipeline_name,
+                                                    int num_sites, const char **site_names,
+                                                    const char **site_hints, const int *site_kinds) {
+    halide_allocation_pipeline_stats *p;
+    {
+        ScopedMutexLock lock(&tracker_lock);
+        if (!tracker_clock_started) {
+            halide_start_clock(user_context);
+            tracker_clock_started = true;
+        }
+        p = find_tracked_pipeline(pipeline_name, num_sites);
+        if (!p) {
+            p = register_tracked_pipeline(pipeline_name, num_sites, site_names, site_hints, site_kinds);
+        }
+    }
+    if (!p) {
+        return nullptr;
+    }
+
+    // The per-site counters follow the run state.
+    const size_t size = sizeof(TrackedRun) + 3 * num_sites * sizeof(uint64_t);
+    TrackedRun *run = (TrackedRun *)malloc(size);
+    if (!run) {
+        return nullptr;
+    }
+    memset(run, 0, size);
+    run->stats = p;
+    run->site_live = (uint64_t *)(run + 1);
+    run->site_peak = run->site_live + num_sites;
+    run->site_count = run->site_peak + num_sites;
+    run->start_ns = (uint64_t)halide_current_time_ns(user_context);
+    return run;
+}
+
+WEAK int halide_allocation_tracker_allocate(void *user_context, void *run, int site, uint64_t bytes) {
+    if (run && bytes) {
+        record_allocation_event(user_context, (TrackedRun *)run, site, (int64_t)bytes);
+    }
+    return 0;
+}
+
+WEAK int halide_allocation_tracker_free(void *user_context, void *run, int site, uint64_t bytes) {
+    if (run && bytes) {
+        record_allocation_event(user_context, (TrackedRun *)run, site, -(int64_t)bytes);
+    }
+    return 0;
+}
+
+WEAK int halide_allocation_tracker_device_malloc(void *user_context, void *run, int site, halide_buffer_t *buf) {
+    TrackedRun *r = (TrackedRun *)run;
+    if (!r || !buf || !buf->device) {
+        return 0;
+    }
+    const uint64_t bytes = buf->size_in_bytes();
+    {
+        ScopedMutexLock lock(&r->lock);
+        for (int i = 0; i < r->device_allocations.size; i++) {
+            if (r->device_allocations.data[i].buf == buf) {
+                return 0;
+            }
+        }
+        if (!r->device_allocations.push_back({buf, site, bytes})) {
+            return 0;
+        }
+    }
+    record_allocation_event(user_context, r, site, (int64_t)bytes);
+    return 0;
+}
+
+WEAK int halide_allocation_tracker_device_free(void *user_context, void *run, halide_buffer_t *buf) {
+    TrackedRun *r = (TrackedRun *)run;
+    if (!r) {
+        return 0;
+    }
+    TrackedDeviceAllocation a = {nullptr, 0, 0};
+    {
+        ScopedMutexLock lock(&r->lock);
+        for (int i = 0; i < r->device_allocations.size; i++) {
+            if (r->device_allocations.data[i].buf == buf) {
+                a = r->device_allocations.data[i];
+                r->device_allocations.data[i] = r->device_allocations.data[--r->device_allocations.size];
+                break;
+            }
+        }
+    }
+    if (a.buf) {
+        record_allocation_event(user_context, r, a.site, -(int64_t)a.bytes);
+    }
+    return 0;
+}
+
+WEAK void halide_allocation_tracker_pipeline_end(void *user_context, void *run) {
+    TrackedRun *r = (TrackedRun *)run;
+    if (!r) {
+        return;
+    }
+    {
+        ScopedMutexLock lock(&tracker_lock);
+        halide_allocation_pipeline_stats *p = r->stats;
+        for (int i = 0; i < p->num_sites; i++) {
+            p->sites[i].count += r->site_count[i];
+            p->sites[i].peak_bytes = max(p->sites[i].peak_bytes, r->site_peak[i]);
+        }
+        if (p->runs == 0 || r->peak_bytes > p->peak_bytes) {
+            keep_peak_timeline(r);
+        }
+        p->runs++;
+    }
+    r->events.release();
+    r->device_allocations.release();
+    free(r);
+}
+
+WEAK halide_allocation_pipeline_stats *halide_allocation_tracker_get_pipelines() {
+    ScopedMutexLock lock(&tracker_lock);
+    return tracked_pipelines;
+}
+
+WEAK void halide_allocation_tracker_report(void *user_context) {
+    ScopedMutexLock lock(&tracker_lock);
+    allocation_tracker_report_unlocked(user_context);
+}
+
+WEAK void halide_allocation_tracker_reset() {
+    ScopedMutexLock lock(&tracker_lock);
+    for (halide_allocation_pipeline_stats *p = tracked_pipelines; p;
+         p = (halide_allocation_pipeline_stats *)(p->next)) {
+        free(p->peak_timeline);
+        p->peak_timeline = nullptr;
+        p->peak_timeline_length = 0;
+        p->runs = 0;
+        p->peak_bytes = 0;
+        for (int i = 0; i < p->num_sites; i++) {
+            p->sites[i].count = 0;
+            p->sites[i].peak_bytes = 0;
+            p->sites[i].bytes_at_peak = 0;
+        }
+    }
+}
+
+#ifndef WINDOWS
+__attribute__((destructor))
+#endif
+WEAK void
+halide_allocation_tracker_shutdown() {
+    // Only report if any pipeline was tracked. No lock is taken, as no
+    // pipelines should be running at exit.
+    for (halide_allocation_pipeline_stats *p = tracked_pipelines; p;
+         p = (halide_allocation_pipeline_stats *)(p->next)) {
+        if (p->runs) {
+            allocation_tracker_report_unlocked(nullptr);
+            return;
+        }
+    }
+}
+}
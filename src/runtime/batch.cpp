@@ -0,0 +1,37 @@
+#include "HalideRuntime.h"
+
+namespace Halide {
+namespace Runtime {
+namespace Internal {
+
+struct BatchClosure {
+    int (*argv_fn)(void **);
+    int argc;
+    void **argvs;
+};
+
+WEAK int batch_task(void *user_context, int idx, uint8_t *closure) {
+    const BatchClosure *c = (const BatchClosure *)closure;
+    return c->argv_fn(c->argvs + (size_t)idx * c->argc);
+}
+
+}  // namespace Internal
+}  // namespace Runtime
+}  // namespace Halide
+
+using namespace Halide::Runtime::Internal;
+
+extern "C" {
+
+WEAK int halide_do_batch_argv(int (*argv_fn)(void **), int batch_size, int argc,
+                              void **argvs, bool has_user_context) {
+    if (batch_size <= 0) {
+        return halide_error_code_success;
+    }
+    // The thread pool runs the calls on behalf of the first of them.
+    void *user_context = has_user_context ? *(void **)argvs[0] : nullptr;
+    BatchClosure closure = {argv_fn, argc, argvs};
+    return halide_do_par_for(user_context, batch_task, 0, batch_size, (uint8_t *)&closure);
+}
+
+}  // extern "C"
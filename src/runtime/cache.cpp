@@ -1,6 +1,7 @@
 #include "HalideRuntime.h"
 #include "device_buffer_utils.h"
 #include "printer.h"
+#include "runtime_atomics.h"
 #include "scoped_mutex_lock.h"
 
 namespace Halide {
@@ -84,6 +85,12 @@ struct CacheEntry {
     halide_buffer_t *buf;
     uint64_t eviction_key;
     bool has_eviction_key;
+    // The budget this entry is charged to; see CachePartition.
+    int32_t partition;
+    // Nanoseconds it took to compute the entry, and its priority under
+    // the GreedyDual-Size policy. Only maintained under that policy.
+    uint64_t cost_ns;
+    uint64_t priority;
 
     bool init(const uint8_t *cache_key, size_t cache_key_size,
               uint32_t key_hash,
@@ -97,6 +104,9 @@ struct CacheEntry {
 struct CacheBlockHeader {
     CacheEntry *entry;
     uint32_t hash;
+    // Filled in on a cache miss, for the matching store.
+    int32_t partition;
+    uint64_t miss_time_ns;
 };
 
 // Each host block has extra space to store a header just before the
@@ -174,6 +184,9 @@ WEAK bool CacheEntry::init(const uint8_t *cache_key, size_t cache_key_size,
 
     has_eviction_key = has_eviction_key_arg;
     eviction_key = eviction_key_arg;
+    partition = 0;
+    cost_ns = 0;
+    priority = 0;
     return true;
 }
 
@@ -188,42 +201,216 @@ WEAK void CacheEntry::destroy() {
     halide_free(nullptr, metadata_storage);
 }
 
-WEAK uint32_t djb_hash(const uint8_t *key, size_t key_size) {
-    uint32_t h = 5381;
-    for (size_t i = 0; i < key_size; i++) {
-        h = (h << 5) + h + key[i];
+// A multiply-xorshift hash that consumes the key a 64-bit word at a
+// time. Cache keys include the names and values of everything the
+// memoized Func depends on, so they are frequently hundreds of bytes
+// long, and hashing a byte at a time shows up in profiles.
+WEAK uint32_t cache_key_hash(const uint8_t *key, size_t key_size) {
+    const uint64_t m = 0x9e3779b97f4a7c15ULL;
+    uint64_t h = (uint64_t)key_size * m;
+    size_t i = 0;
+    for (; i + sizeof(uint64_t) <= key_size; i += sizeof(uint64_t)) {
+        uint64_t w;
+        memcpy(&w, key + i, sizeof(w));
+        h = (h ^ w) * m;
+        h ^= h >> 32;
+    }
+    uint64_t tail = 0;
+    for (size_t j = 0; i + j < key_size; j++) {
+        tail |= (uint64_t)key[i + j] << (8 * j);
     }
-    return h;
+    h = (h ^ tail) * m;
+    h ^= h >> 29;
+    h *= m;
+    h ^= h >> 32;
+    return (uint32_t)h;
 }
 
-WEAK halide_mutex memoization_lock = {{0}};
+// The cache is split into shards by key hash. Each shard has its own
+// lock, hash table and LRU list, so concurrent lookups of different
+// keys rarely contend. Size limits apply across all shards: totals
+// are tracked atomically, and a store that pushes one over its limit
+// evicts from its own shard first and then from the others, one shard
+// lock at a time.
+const size_t kCacheShardBits = 4;
+const size_t kNumCacheShards = 1 << kCacheShardBits;
+const size_t kHashTableSize = 64;
+
+struct CacheShard {
+    halide_mutex lock;
+    CacheEntry *entries[kHashTableSize];
+    CacheEntry *most_recently_used;
+    CacheEntry *least_recently_used;
+
+    // Bytes and entries stored in this shard.
+    int64_t size;
+    int32_t entry_count;
+
+    // Counters reported by halide_memoization_cache_get_stats.
+    uint64_t hits, misses, evictions;
+};
 
-const size_t kHashTableSize = 256;
+WEAK CacheShard cache_shards[kNumCacheShards];
 
-WEAK CacheEntry *cache_entries[kHashTableSize];
+ALWAYS_INLINE CacheShard &shard_for_hash(uint32_t h) {
+    return cache_shards[h & (kNumCacheShards - 1)];
+}
 
-WEAK CacheEntry *most_recently_used = nullptr;
-WEAK CacheEntry *least_recently_used = nullptr;
+ALWAYS_INLINE uint32_t bucket_for_hash(uint32_t h) {
+    return (h >> kCacheShardBits) % kHashTableSize;
+}
 
 const uint64_t kDefaultCacheSize = 1 << 20;
-WEAK int64_t max_cache_size = kDefaultCacheSize;
-WEAK int64_t current_cache_size = 0;
+
+// Entries are charged against a budget, or partition. Partition 0 is
+// the cache-wide budget set by halide_memoization_cache_set_size; the
+// others are created by halide_memoization_cache_set_site_size and
+// hold the entries of one pipeline, or of one memoized Func in a
+// pipeline. Partitions are never removed once created, so their
+// names only need the lock while a new one is being added.
+const int kMaxCachePartitions = 16;
+const int kMaxCacheSiteName = 64;
+
+struct CachePartition {
+    char pipeline_name[kMaxCacheSiteName];
+    // Empty if the budget covers every memoized Func in the pipeline.
+    char func_name[kMaxCacheSiteName];
+    // Only accessed atomically.
+    int64_t max_size;
+    int64_t current_size;
+    // The GreedyDual-Size inflation value: the priority of the last
+    // entry evicted. Only accessed atomically.
+    uint64_t inflation;
+};
+
+WEAK CachePartition cache_partitions[kMaxCachePartitions] = {{{0}, {0}, kDefaultCacheSize, 0, 0}};
+// Only accessed atomically.
+WEAK int cache_partition_count = 1;
+WEAK halide_mutex cache_partitions_lock;
+
+// Holds a halide_memoization_cache_eviction_policy_t. Only accessed atomically.
+WEAK int cache_eviction_policy = halide_memoization_cache_evict_lru;
+
+ALWAYS_INLINE bool using_greedy_dual_size() {
+    int policy;
+    Synchronization::atomic_load_relaxed(&cache_eviction_policy, &policy);
+    return policy == halide_memoization_cache_evict_greedy_dual_size;
+}
+
+ALWAYS_INLINE bool partition_over_budget(int32_t partition) {
+    int64_t current, max;
+    Synchronization::atomic_load_relaxed(&cache_partitions[partition].current_size, &current);
+    Synchronization::atomic_load_relaxed(&cache_partitions[partition].max_size, &max);
+    return current > max;
+}
+
+ALWAYS_INLINE void adjust_cache_size(CacheShard &shard, int32_t partition, int64_t delta) {
+    shard.size += delta;
+    Synchronization::atomic_fetch_add_sequentially_consistent(&cache_partitions[partition].current_size, delta);
+}
+
+WEAK int64_t entry_size_in_bytes(const CacheEntry *entry) {
+    int64_t bytes = 0;
+    for (uint32_t i = 0; i < entry->tuple_count; i++) {
+        bytes += entry->buf[i].size_in_bytes();
+    }
+    return bytes;
+}
+
+// The GreedyDual-Size priority of an entry: the inflation value of its
+// partition, plus the entry's recompute cost per byte. Entries that
+// were cheap to compute for their size are evicted first, and the
+// inflation value (the priority of the last entry evicted) ages out
+// entries that stop being used.
+WEAK uint64_t greedy_dual_size_priority(const CacheEntry *entry) {
+    int64_t bytes = entry_size_in_bytes(entry);
+    if (bytes < 1) {
+        bytes = 1;
+    }
+    // Cost is in 1/65536ths of a nanosecond per byte. Clamp the cost
+    // so the shift can't overflow (2^47 ns is more than a day).
+    uint64_t cost = entry->cost_ns < (1ULL << 47) ? entry->cost_ns : (1ULL << 47);
+    uint64_t inflation;
+    Synchronization::atomic_load_relaxed(&cache_partitions[entry->partition].inflation, &inflation);
+    return inflation + (cost << 16) / (uint64_t)bytes;
+}
+
+WEAK bool names_equal(const char *a, const char *b, size_t b_len) {
+    return strncmp(a, b, b_len) == 0 && a[b_len] == '\0';
+}
+
+// Parse a "<length>:<name>" field of a cache site name, as written by
+// the Memoization lowering pass. Returns nullptr if malformed.
+WEAK const char *parse_site_name_field(const char *p, const char **name, size_t *len) {
+    size_t n = 0;
+    if (*p < '0' || *p > '9') {
+        return nullptr;
+    }
+    while (*p >= '0' && *p <= '9') {
+        n = n * 10 + (*p++ - '0');
+    }
+    if (*p++ != ':') {
+        return nullptr;
+    }
+    *name = p;
+    *len = n;
+    for (size_t i = 0; i < n; i++) {
+        if (p[i] == '\0') {
+            return nullptr;
+        }
+    }
+    return p + n;
+}
+
+// Find the partition a cache key is charged to. Keys generated by
+// Halide start with a pointer to a string naming the pipeline and the
+// memoized Func. A budget for the Func wins over one for its whole
+// pipeline.
+WEAK int32_t partition_for_key(const uint8_t *cache_key, int32_t size) {
+    int count;
+    Synchronization::atomic_load_acquire(&cache_partition_count, &count);
+    if (count == 1 || size < (int32_t)sizeof(const char *)) {
+        return 0;
+    }
+
+    const char *site;
+    memcpy(&site, cache_key, sizeof(site));
+    const char *pipeline, *func;
+    size_t pipeline_len, func_len;
+    const char *p = parse_site_name_field(site, &pipeline, &pipeline_len);
+    if (p == nullptr || parse_site_name_field(p, &func, &func_len) == nullptr) {
+        return 0;
+    }
+
+    int32_t result = 0;
+    for (int i = 1; i < count; i++) {
+        const CachePartition &partition = cache_partitions[i];
+        if (!names_equal(partition.pipeline_name, pipeline, pipeline_len)) {
+            continue;
+        }
+        if (partition.func_name[0] == '\0') {
+            if (result == 0) {
+                result = i;
+            }
+        } else if (names_equal(partition.func_name, func, func_len)) {
+            return i;
+        }
+    }
+    return result;
+}
 
 #if CACHE_DEBUGGING
-WEAK void validate_cache() {
-    print(nullptr) << "validating cache, "
-                   << "current size " << current_cache_size
-                   << " of maximum " << max_cache_size << "\n";
+WEAK void validate_shard(const CacheShard &shard) {
     int entries_in_hash_table = 0;
     for (size_t i = 0; i < kHashTableSize; i++) {
-        CacheEntry *entry = cache_entries[i];
+        CacheEntry *entry = shard.entries[i];
         while (entry != nullptr) {
             entries_in_hash_table++;
-            if (entry->more_recent == nullptr && entry != most_recently_used) {
+            if (entry->more_recent == nullptr && entry != shard.most_recently_used) {
                 halide_print(nullptr, "cache invalid case 1\n");
                 __builtin_trap();
             }
-            if (entry->less_recent == nullptr && entry != least_recently_used) {
+            if (entry->less_recent == nullptr && entry != shard.least_recently_used) {
                 halide_print(nullptr, "cache invalid case 2\n");
                 __builtin_trap();
             }
@@ -231,18 +418,20 @@ WEAK void validate_cache() {
         }
     }
     int entries_from_mru = 0;
-    CacheEntry *mru_chain = most_recently_used;
+    CacheEntry *mru_chain = shard.most_recently_used;
     while (mru_chain != nullptr) {
         entries_from_mru++;
         mru_chain = mru_chain->less_recent;
     }
     int entries_from_lru = 0;
-    CacheEntry *lru_chain = least_recently_used;
+    CacheEntry *lru_chain = shard.least_recently_used;
     while (lru_chain != nullptr) {
         entries_from_lru++;
         lru_chain = lru_chain->more_recent;
     }
-    print(nullptr) << "hash entries " << entries_in_hash_table
+    print(nullptr) << "validating cache shard " << (int)(&shard - cache_shards)
+                   << ", size " << shard.size
+                   << ", hash entries " << entries_in_hash_table
                    << ", mru entries " << entries_from_mru
                    << ", lru entries " << entries_from_lru << "\n";
     if (entries_in_hash_table != entries_from_mru) {
@@ -253,69 +442,253 @@ WEAK void validate_cache() {
         halide_print(nullptr, "cache invalid case 4\n");
         __builtin_trap();
     }
-    if (current_cache_size < 0) {
+    if (entries_in_hash_table != shard.entry_count) {
+        halide_print(nullptr, "cache invalid case 5\n");
+        __builtin_trap();
+    }
+    if (shard.size < 0) {
         halide_print(nullptr, "cache size is negative\n");
         __builtin_trap();
     }
 }
 #endif
 
-WEAK void prune_cache() {
+WEAK void link_as_most_recent(CacheShard &shard, CacheEntry *entry) {
+    entry->more_recent = nullptr;
+    entry->less_recent = shard.most_recently_used;
+    if (shard.most_recently_used != nullptr) {
+        shard.most_recently_used->more_recent = entry;
+    }
+    shard.most_recently_used = entry;
+    if (shard.least_recently_used == nullptr) {
+        shard.least_recently_used = entry;
+    }
+}
+
+WEAK void unlink_from_lru(CacheShard &shard, CacheEntry *entry) {
+    if (entry->more_recent != nullptr) {
+        entry->more_recent->less_recent = entry->less_recent;
+    } else {
+        halide_abort_if_false(nullptr, shard.most_recently_used == entry);
+        shard.most_recently_used = entry->less_recent;
+    }
+    if (entry->less_recent != nullptr) {
+        entry->less_recent->more_recent = entry->more_recent;
+    } else {
+        halide_abort_if_false(nullptr, shard.least_recently_used == entry);
+        shard.least_recently_used = entry->more_recent;
+    }
+    entry->more_recent = nullptr;
+    entry->less_recent = nullptr;
+}
+
+// Unlink an entry that has already been removed from the hash table
+// from the LRU list, and free it. The shard must be locked.
+WEAK void destroy_entry_already_locked(void *user_context, CacheShard &shard, CacheEntry *entry) {
+    unlink_from_lru(shard, entry);
+    adjust_cache_size(shard, entry->partition, -entry_size_in_bytes(entry));
+    shard.entry_count--;
+    entry->destroy();
+    halide_free(user_context, entry);
+}
+
+WEAK void evict_entry_already_locked(CacheShard &shard, CacheEntry *entry) {
+    CacheEntry **prev_ptr = &shard.entries[bucket_for_hash(entry->hash)];
+    while (*prev_ptr != nullptr && *prev_ptr != entry) {
+        prev_ptr = &(*prev_ptr)->next;
+    }
+    halide_abort_if_false(nullptr, *prev_ptr != nullptr);
+    *prev_ptr = entry->next;
+
+    destroy_entry_already_locked(nullptr, shard, entry);
+    shard.evictions++;
+}
+
+// Evict unused entries of the given partition from the least recently
+// used end of a shard until the partition is within budget. The shard
+// must be locked.
+WEAK void prune_shard_already_locked(CacheShard &shard, int32_t partition) {
 #if CACHE_DEBUGGING
-    validate_cache();
+    validate_shard(shard);
 #endif
-    CacheEntry *prune_candidate = least_recently_used;
-    while (current_cache_size > max_cache_size &&
-           prune_candidate != nullptr) {
+    CacheEntry *prune_candidate = shard.least_recently_used;
+    while (prune_candidate != nullptr && partition_over_budget(partition)) {
         CacheEntry *more_recent = prune_candidate->more_recent;
+        if (prune_candidate->partition == partition &&
+            prune_candidate->in_use_count == 0) {
+            evict_entry_already_locked(shard, prune_candidate);
+        }
+        prune_candidate = more_recent;
+    }
+#if CACHE_DEBUGGING
+    validate_shard(shard);
+#endif
+}
 
-        if (prune_candidate->in_use_count == 0) {
-            uint32_t h = prune_candidate->hash;
-            uint32_t index = h % kHashTableSize;
-
-            // Remove from hash table
-            CacheEntry *prev_hash_entry = cache_entries[index];
-            if (prev_hash_entry == prune_candidate) {
-                cache_entries[index] = prune_candidate->next;
-            } else {
-                while (prev_hash_entry != nullptr && prev_hash_entry->next != prune_candidate) {
-                    prev_hash_entry = prev_hash_entry->next;
-                }
-                halide_abort_if_false(nullptr, prev_hash_entry != nullptr);
-                prev_hash_entry->next = prune_candidate->next;
-            }
+// Find the unused entry of the given partition with the lowest
+// GreedyDual-Size priority in a shard. Scanning from the least
+// recently used end breaks ties in LRU order. The shard must be
+// locked.
+WEAK CacheEntry *lowest_priority_entry_already_locked(CacheShard &shard, int32_t partition) {
+    CacheEntry *result = nullptr;
+    for (CacheEntry *e = shard.least_recently_used; e != nullptr; e = e->more_recent) {
+        if (e->partition == partition && e->in_use_count == 0 &&
+            (result == nullptr || e->priority < result->priority)) {
+            result = e;
+        }
+    }
+    return result;
+}
 
-            // Remove from less recent chain.
-            if (least_recently_used == prune_candidate) {
-                least_recently_used = more_recent;
-            }
-            if (more_recent != nullptr) {
-                more_recent->less_recent = prune_candidate->less_recent;
+// Under GreedyDual-Size, evict the lowest priority entry across all
+// shards until the partition is within budget. Each eviction scans
+// the shards one lock at a time to find the victim, then relocks its
+// shard to evict it, so it may race with other threads and evict the
+// next lowest entry instead, which is harmless.
+WEAK void prune_cache_greedy_dual_size(int32_t partition) {
+    while (partition_over_budget(partition)) {
+        CacheShard *victim_shard = nullptr;
+        uint64_t victim_priority = 0;
+        for (CacheShard &shard : cache_shards) {
+            ScopedMutexLock lock(&shard.lock);
+            CacheEntry *e = lowest_priority_entry_already_locked(shard, partition);
+            if (e != nullptr && (victim_shard == nullptr || e->priority < victim_priority)) {
+                victim_shard = &shard;
+                victim_priority = e->priority;
             }
+        }
+        if (victim_shard == nullptr) {
+            return;
+        }
 
-            // Remove from more recent chain.
-            if (most_recently_used == prune_candidate) {
-                most_recently_used = prune_candidate->less_recent;
-            }
-            if (prune_candidate->less_recent != nullptr) {
-                prune_candidate->less_recent = more_recent;
+        ScopedMutexLock lock(&victim_shard->lock);
+        CacheEntry *victim = lowest_priority_entry_already_locked(*victim_shard, partition);
+        if (victim != nullptr) {
+            uint64_t *inflation = &cache_partitions[partition].inflation;
+            uint64_t old_inflation;
+            Synchronization::atomic_load_relaxed(inflation, &old_inflation);
+            while (old_inflation < victim->priority &&
+                   !Synchronization::atomic_cas_weak_relacq_relaxed(inflation, &old_inflation, &victim->priority)) {
             }
+            evict_entry_already_locked(*victim_shard, victim);
+        }
+#if CACHE_DEBUGGING
+        validate_shard(*victim_shard);
+#endif
+    }
+}
+
+// Prune shards until the partition is within budget, starting at the
+// given one under LRU eviction. No shard locks may be held by the
+// caller.
+// Hashes of buffer contents for Funcs memoized with
+// hash_buffer_contents. The data goes through four independent lanes
+// of xxHash64-style rounds, 32 bytes at a time, which the compiler can
+// keep in vector registers. Data is consumed in order of the buffer's
+// coordinates, with a partial block carried over between contiguous
+// spans, so the hash doesn't depend on the strides or the address of
+// the allocation.
+struct ContentHasher {
+    static constexpr uint64_t p1 = 0x9e3779b185ebca87ULL;
+    static constexpr uint64_t p2 = 0xc2b2ae3d27d4eb4fULL;
+    static constexpr uint64_t p3 = 0x165667b19e3779f9ULL;
+
+    uint64_t lanes[4] = {p1 + p2, p2, 0, 0 - p1};
+    uint8_t pending[32];
+    size_t pending_size = 0;
+    uint64_t total_size = 0;
+
+    ALWAYS_INLINE static uint64_t round(uint64_t acc, uint64_t w) {
+        acc += w * p2;
+        acc = (acc << 31) | (acc >> 33);
+        return acc * p1;
+    }
 
-            // Decrease cache used amount.
-            for (uint32_t i = 0; i < prune_candidate->tuple_count; i++) {
-                current_cache_size -= prune_candidate->buf[i].size_in_bytes();
+    ALWAYS_INLINE void consume_block(const uint8_t *p) {
+        for (int i = 0; i < 4; i++) {
+            uint64_t w;
+            memcpy(&w, p + i * sizeof(uint64_t), sizeof(w));
+            lanes[i] = round(lanes[i], w);
+        }
+    }
+
+    void update(const uint8_t *p, size_t size) {
+        total_size += size;
+        if (pending_size) {
+            size_t n = sizeof(pending) - pending_size;
+            n = n < size ? n : size;
+            memcpy(pending + pending_size, p, n);
+            pending_size += n;
+            p += n;
+            size -= n;
+            if (pending_size < sizeof(pending)) {
+                return;
             }
+            consume_block(pending);
+            pending_size = 0;
+        }
+        for (; size >= sizeof(pending); size -= sizeof(pending), p += sizeof(pending)) {
+            consume_block(p);
+        }
+        memcpy(pending, p, size);
+        pending_size = size;
+    }
+
+    void update(uint64_t w) {
+        update((const uint8_t *)&w, sizeof(w));
+    }
 
-            // Deallocate the entry.
-            prune_candidate->destroy();
-            halide_free(nullptr, prune_candidate);
+    uint64_t finish() {
+        // Zero-pad the last partial block. The total size tells apart
+        // data that only differs in trailing zeros.
+        memset(pending + pending_size, 0, sizeof(pending) - pending_size);
+        consume_block(pending);
+        uint64_t h = total_size * p3;
+        for (uint64_t lane : lanes) {
+            h = (h ^ lane) * p1;
+            h ^= h >> 29;
         }
+        h ^= h >> 33;
+        h *= p2;
+        h ^= h >> 29;
+        h *= p3;
+        h ^= h >> 32;
+        return h;
+    }
+};
 
-        prune_candidate = more_recent;
+// Counts copies to host that failed while hashing buffer contents.
+WEAK uint64_t hash_copy_failures = 0;
+
+// Feed the elements of buf with coordinates in dimensions >= d fixed by
+// host to the hasher. dense_dims is the number of innermost dimensions
+// which are contiguous in memory.
+WEAK void hash_buffer_contents(ContentHasher &hasher, const halide_buffer_t *buf,
+                               int d, int dense_dims, const uint8_t *host) {
+    if (d < dense_dims) {
+        size_t size = buf->type.bytes();
+        for (int i = 0; i < dense_dims; i++) {
+            size *= buf->dim[i].extent;
+        }
+        hasher.update(host, size);
+        return;
+    }
+    const int64_t stride_bytes = (int64_t)buf->dim[d].stride * buf->type.bytes();
+    for (int i = 0; i < buf->dim[d].extent; i++) {
+        hash_buffer_contents(hasher, buf, d - 1, dense_dims, host + i * stride_bytes);
+    }
+}
+
+WEAK void prune_cache(size_t first_shard, int32_t partition) {
+    if (using_greedy_dual_size()) {
+        prune_cache_greedy_dual_size(partition);
+        return;
+    }
+    for (size_t i = 0; i < kNumCacheShards && partition_over_budget(partition); i++) {
+        CacheShard &shard = cache_shards[(first_shard + i) % kNumCacheShards];
+        ScopedMutexLock lock(&shard.lock);
+        prune_shard_already_locked(shard, partition);
     }
-#if CACHE_DEBUGGING
-    validate_cache();
-#endif
 }
 
 }  // namespace Internal
@@ -329,78 +702,131 @@ WEAK void halide_memoization_cache_set_size(int64_t size) {
         size = kDefaultCacheSize;
     }
 
-    ScopedMutexLock lock(&memoization_lock);
+    Synchronization::atomic_store_sequentially_consistent(&cache_partitions[0].max_size, &size);
+    prune_cache(0, 0);
+}
 
-    max_cache_size = size;
-    prune_cache();
+WEAK int halide_memoization_cache_set_site_size(const char *pipeline_name, const char *func_name, int64_t size) {
+    if (pipeline_name == nullptr || strlen(pipeline_name) >= (size_t)kMaxCacheSiteName ||
+        (func_name != nullptr && strlen(func_name) >= (size_t)kMaxCacheSiteName)) {
+        return halide_error_code_generic_error;
+    }
+    if (func_name == nullptr) {
+        func_name = "";
+    }
+    if (size == 0) {
+        size = kDefaultCacheSize;
+    }
+
+    int32_t partition = 0;
+    {
+        ScopedMutexLock lock(&cache_partitions_lock);
+        int count = cache_partition_count;
+        for (int i = 1; i < count; i++) {
+            if (strcmp(cache_partitions[i].pipeline_name, pipeline_name) == 0 &&
+                strcmp(cache_partitions[i].func_name, func_name) == 0) {
+                partition = i;
+                break;
+            }
+        }
+        if (partition == 0) {
+            if (count == kMaxCachePartitions) {
+                return halide_error_code_generic_error;
+            }
+            // Set up the new partition before publishing it.
+            partition = count;
+            CachePartition &p = cache_partitions[partition];
+            strncpy(p.pipeline_name, pipeline_name, kMaxCacheSiteName);
+            strncpy(p.func_name, func_name, kMaxCacheSiteName);
+            p.current_size = 0;
+            count++;
+            Synchronization::atomic_store_release(&cache_partition_count, &count);
+        }
+        Synchronization::atomic_store_sequentially_consistent(&cache_partitions[partition].max_size, &size);
+    }
+
+    prune_cache(0, partition);
+    return halide_error_code_success;
+}
+
+WEAK int halide_memoization_cache_set_eviction_policy(halide_memoization_cache_eviction_policy_t policy) {
+    if (policy != halide_memoization_cache_evict_lru &&
+        policy != halide_memoization_cache_evict_greedy_dual_size) {
+        return halide_error_code_generic_error;
+    }
+    if (policy == halide_memoization_cache_evict_greedy_dual_size) {
+        // Recompute costs are measured with halide_current_time_ns.
+        halide_start_clock(nullptr);
+    }
+    int p = policy;
+    Synchronization::atomic_store_sequentially_consistent(&cache_eviction_policy, &p);
+    return halide_error_code_success;
 }
 
 WEAK int halide_memoization_cache_lookup(void *user_context, const uint8_t *cache_key, int32_t size,
                                          halide_buffer_t *computed_bounds, int32_t tuple_count, halide_buffer_t **tuple_buffers) {
-    uint32_t h = djb_hash(cache_key, size);
-    uint32_t index = h % kHashTableSize;
+    uint32_t h = cache_key_hash(cache_key, size);
+    CacheShard &shard = shard_for_hash(h);
 
-    ScopedMutexLock lock(&memoization_lock);
+    {
+        ScopedMutexLock lock(&shard.lock);
 
 #if CACHE_DEBUGGING
-    debug_print_key(user_context, "halide_memoization_cache_lookup", cache_key, size);
+        debug_print_key(user_context, "halide_memoization_cache_lookup", cache_key, size);
 
-    debug_print_buffer(user_context, "computed_bounds", *computed_bounds);
+        debug_print_buffer(user_context, "computed_bounds", *computed_bounds);
 
-    {
-        for (int32_t i = 0; i < tuple_count; i++) {
-            halide_buffer_t *buf = tuple_buffers[i];
-            debug_print_buffer(user_context, "Allocation bounds", *buf);
+        {
+            for (int32_t i = 0; i < tuple_count; i++) {
+                halide_buffer_t *buf = tuple_buffers[i];
+                debug_print_buffer(user_context, "Allocation bounds", *buf);
+            }
         }
-    }
 #endif
 
-    CacheEntry *entry = cache_entries[index];
-    while (entry != nullptr) {
-        if (entry->hash == h && entry->key_size == (size_t)size &&
-            keys_equal(entry->key, cache_key, size) &&
-            buffer_has_shape(computed_bounds, entry->computed_bounds) &&
-            entry->tuple_count == (uint32_t)tuple_count) {
-
-            // Check all the tuple buffers have the same bounds (they should).
-            bool all_bounds_equal = true;
-            for (int32_t i = 0; all_bounds_equal && i < tuple_count; i++) {
-                all_bounds_equal = buffer_has_shape(tuple_buffers[i], entry->buf[i].dim);
-            }
+        CacheEntry *entry = shard.entries[bucket_for_hash(h)];
+        while (entry != nullptr) {
+            if (entry->hash == h && entry->key_size == (size_t)size &&
+                keys_equal(entry->key, cache_key, size) &&
+                buffer_has_shape(computed_bounds, entry->computed_bounds) &&
+                entry->tuple_count == (uint32_t)tuple_count) {
 
-            if (all_bounds_equal) {
-                if (entry != most_recently_used) {
-                    halide_abort_if_false(user_context, entry->more_recent != nullptr);
-                    if (entry->less_recent != nullptr) {
-                        entry->less_recent->more_recent = entry->more_recent;
-                    } else {
-                        halide_abort_if_false(user_context, least_recently_used == entry);
-                        least_recently_used = entry->more_recent;
-                    }
-                    halide_abort_if_false(user_context, entry->more_recent != nullptr);
-                    entry->more_recent->less_recent = entry->less_recent;
+                // Check all the tuple buffers have the same bounds (they should).
+                bool all_bounds_equal = true;
+                for (int32_t i = 0; all_bounds_equal && i < tuple_count; i++) {
+                    all_bounds_equal = buffer_has_shape(tuple_buffers[i], entry->buf[i].dim);
+                }
 
-                    entry->more_recent = nullptr;
-                    entry->less_recent = most_recently_used;
-                    if (most_recently_used != nullptr) {
-                        most_recently_used->more_recent = entry;
+                if (all_bounds_equal) {
+                    if (entry != shard.most_recently_used) {
+                        unlink_from_lru(shard, entry);
+                        link_as_most_recent(shard, entry);
                     }
-                    most_recently_used = entry;
-                }
 
-                for (int32_t i = 0; i < tuple_count; i++) {
-                    halide_buffer_t *buf = tuple_buffers[i];
-                    *buf = entry->buf[i];
-                }
+                    for (int32_t i = 0; i < tuple_count; i++) {
+                        halide_buffer_t *buf = tuple_buffers[i];
+                        *buf = entry->buf[i];
+                    }
 
-                entry->in_use_count += tuple_count;
+                    entry->in_use_count += tuple_count;
+                    if (using_greedy_dual_size()) {
+                        entry->priority = greedy_dual_size_priority(entry);
+                    }
+                    shard.hits++;
 
-                return 0;
+                    return 0;
+                }
             }
+            entry = entry->next;
         }
-        entry = entry->next;
+
+        shard.misses++;
     }
 
+    // Allocate the storage for the caller to compute into without
+    // holding the shard lock.
+    int32_t partition = partition_for_key(cache_key, size);
+    uint64_t miss_time_ns = using_greedy_dual_size() ? halide_current_time_ns(user_context) : 0;
     for (int32_t i = 0; i < tuple_count; i++) {
         halide_buffer_t *buf = tuple_buffers[i];
 
@@ -416,12 +842,10 @@ WEAK int halide_memoization_cache_lookup(void *user_context, const uint8_t *cach
         CacheBlockHeader *header = get_pointer_to_header(buf->host);
         header->hash = h;
         header->entry = nullptr;
+        header->partition = partition;
+        header->miss_time_ns = miss_time_ns;
     }
 
-#if CACHE_DEBUGGING
-    validate_cache();
-#endif
-
     return 1;
 }
 
@@ -431,107 +855,121 @@ WEAK int halide_memoization_cache_store(void *user_context, const uint8_t *cache
                                         bool has_eviction_key, uint64_t eviction_key) {
     debug(user_context) << "halide_memoization_cache_store has_eviction_key: " << has_eviction_key << " eviction_key " << eviction_key << " .\n";
 
-    uint32_t h = get_pointer_to_header(tuple_buffers[0]->host)->hash;
-
-    uint32_t index = h % kHashTableSize;
+    const CacheBlockHeader *header = get_pointer_to_header(tuple_buffers[0]->host);
+    uint32_t h = header->hash;
+    int32_t partition = header->partition;
+    uint64_t cost_ns = 0;
+    if (header->miss_time_ns != 0 && using_greedy_dual_size()) {
+        cost_ns = halide_current_time_ns(user_context) - header->miss_time_ns;
+    }
+    CacheShard &shard = shard_for_hash(h);
+    uint32_t index = bucket_for_hash(h);
 
-    ScopedMutexLock lock(&memoization_lock);
+    {
+        ScopedMutexLock lock(&shard.lock);
 
 #if CACHE_DEBUGGING
-    debug_print_key(user_context, "halide_memoization_cache_store", cache_key, size);
+        debug_print_key(user_context, "halide_memoization_cache_store", cache_key, size);
 
-    debug_print_buffer(user_context, "computed_bounds", *computed_bounds);
+        debug_print_buffer(user_context, "computed_bounds", *computed_bounds);
 
-    {
-        for (int32_t i = 0; i < tuple_count; i++) {
-            halide_buffer_t *buf = tuple_buffers[i];
-            debug_print_buffer(user_context, "Allocation bounds", *buf);
+        {
+            for (int32_t i = 0; i < tuple_count; i++) {
+                halide_buffer_t *buf = tuple_buffers[i];
+                debug_print_buffer(user_context, "Allocation bounds", *buf);
+            }
         }
-    }
 #endif
 
-    CacheEntry *entry = cache_entries[index];
-    while (entry != nullptr) {
-        if (entry->hash == h && entry->key_size == (size_t)size &&
-            keys_equal(entry->key, cache_key, size) &&
-            buffer_has_shape(computed_bounds, entry->computed_bounds) &&
-            entry->tuple_count == (uint32_t)tuple_count) {
-
-            bool all_bounds_equal = true;
-            bool no_host_pointers_equal = true;
-            {
-                for (int32_t i = 0; all_bounds_equal && i < tuple_count; i++) {
-                    halide_buffer_t *buf = tuple_buffers[i];
-                    all_bounds_equal = buffer_has_shape(tuple_buffers[i], entry->buf[i].dim);
-                    if (entry->buf[i].host == buf->host) {
-                        no_host_pointers_equal = false;
+        CacheEntry *entry = shard.entries[index];
+        while (entry != nullptr) {
+            if (entry->hash == h && entry->key_size == (size_t)size &&
+                keys_equal(entry->key, cache_key, size) &&
+                buffer_has_shape(computed_bounds, entry->computed_bounds) &&
+                entry->tuple_count == (uint32_t)tuple_count) {
+
+                bool all_bounds_equal = true;
+                bool no_host_pointers_equal = true;
+                {
+                    for (int32_t i = 0; all_bounds_equal && i < tuple_count; i++) {
+                        halide_buffer_t *buf = tuple_buffers[i];
+                        all_bounds_equal = buffer_has_shape(tuple_buffers[i], entry->buf[i].dim);
+                        if (entry->buf[i].host == buf->host) {
+                            no_host_pointers_equal = false;
+                        }
                     }
                 }
-            }
-            if (all_bounds_equal) {
-                halide_abort_if_false(user_context, no_host_pointers_equal);
-                // This entry is still in use by the caller. Mark it as having no cache entry
-                // so halide_memoization_cache_release can free the buffer.
-                for (int32_t i = 0; i < tuple_count; i++) {
-                    get_pointer_to_header(tuple_buffers[i]->host)->entry = nullptr;
+                if (all_bounds_equal) {
+                    halide_abort_if_false(user_context, no_host_pointers_equal);
+                    // This entry is still in use by the caller. Mark it as having no cache entry
+                    // so halide_memoization_cache_release can free the buffer.
+                    for (int32_t i = 0; i < tuple_count; i++) {
+                        get_pointer_to_header(tuple_buffers[i]->host)->entry = nullptr;
+                    }
+                    return halide_error_code_success;
                 }
-                return halide_error_code_success;
             }
+            entry = entry->next;
         }
-        entry = entry->next;
-    }
 
-    uint64_t added_size = 0;
-    {
-        for (int32_t i = 0; i < tuple_count; i++) {
-            halide_buffer_t *buf = tuple_buffers[i];
-            added_size += buf->size_in_bytes();
+        int64_t added_size = 0;
+        {
+            for (int32_t i = 0; i < tuple_count; i++) {
+                halide_buffer_t *buf = tuple_buffers[i];
+                added_size += buf->size_in_bytes();
+            }
         }
-    }
-    current_cache_size += added_size;
-    prune_cache();
-
-    CacheEntry *new_entry = (CacheEntry *)halide_malloc(nullptr, sizeof(CacheEntry));
-    bool inited = false;
-    if (new_entry) {
-        inited = new_entry->init(cache_key, size, h, computed_bounds, tuple_count, tuple_buffers,
-                                 has_eviction_key, eviction_key);
-    }
-    if (!inited) {
-        current_cache_size -= added_size;
-
-        // This entry is still in use by the caller. Mark it as having no cache entry
-        // so halide_memoization_cache_release can free the buffer.
-        for (int32_t i = 0; i < tuple_count; i++) {
-            get_pointer_to_header(tuple_buffers[i]->host)->entry = nullptr;
+        adjust_cache_size(shard, partition, added_size);
+        // GreedyDual-Size needs to compare priorities across shards,
+        // so it only prunes below, once this shard is unlocked.
+        if (!using_greedy_dual_size()) {
+            prune_shard_already_locked(shard, partition);
         }
 
+        CacheEntry *new_entry = (CacheEntry *)halide_malloc(nullptr, sizeof(CacheEntry));
+        bool inited = false;
         if (new_entry) {
-            halide_free(user_context, new_entry);
+            inited = new_entry->init(cache_key, size, h, computed_bounds, tuple_count, tuple_buffers,
+                                     has_eviction_key, eviction_key);
         }
-        return halide_error_code_success;
-    }
+        if (!inited) {
+            adjust_cache_size(shard, partition, -added_size);
 
-    new_entry->next = cache_entries[index];
-    new_entry->less_recent = most_recently_used;
-    if (most_recently_used != nullptr) {
-        most_recently_used->more_recent = new_entry;
-    }
-    most_recently_used = new_entry;
-    if (least_recently_used == nullptr) {
-        least_recently_used = new_entry;
-    }
-    cache_entries[index] = new_entry;
+            // This entry is still in use by the caller. Mark it as having no cache entry
+            // so halide_memoization_cache_release can free the buffer.
+            for (int32_t i = 0; i < tuple_count; i++) {
+                get_pointer_to_header(tuple_buffers[i]->host)->entry = nullptr;
+            }
+
+            if (new_entry) {
+                halide_free(user_context, new_entry);
+            }
+            return halide_error_code_success;
+        }
 
-    new_entry->in_use_count = tuple_count;
+        new_entry->partition = partition;
+        new_entry->cost_ns = cost_ns;
+        new_entry->priority = greedy_dual_size_priority(new_entry);
+        new_entry->next = shard.entries[index];
+        link_as_most_recent(shard, new_entry);
+        shard.entries[index] = new_entry;
+        shard.entry_count++;
 
-    for (int32_t i = 0; i < tuple_count; i++) {
-        get_pointer_to_header(tuple_buffers[i]->host)->entry = new_entry;
-    }
+        new_entry->in_use_count = tuple_count;
+
+        for (int32_t i = 0; i < tuple_count; i++) {
+            get_pointer_to_header(tuple_buffers[i]->host)->entry = new_entry;
+        }
 
 #if CACHE_DEBUGGING
-    validate_cache();
+        validate_shard(shard);
 #endif
+    }
+
+    // If this shard couldn't free up enough space on its own, take it
+    // from the others.
+    prune_cache((&shard - cache_shards) + 1, partition);
+
     debug(user_context) << "Exiting halide_memoization_cache_store\n";
 
     return halide_error_code_success;
@@ -545,12 +983,13 @@ WEAK void halide_memoization_cache_release(void *user_context, void *host) {
     if (entry == nullptr) {
         halide_free(user_context, header);
     } else {
-        ScopedMutexLock lock(&memoization_lock);
+        CacheShard &shard = shard_for_hash(header->hash);
+        ScopedMutexLock lock(&shard.lock);
 
         halide_abort_if_false(user_context, entry->in_use_count > 0);
         entry->in_use_count--;
 #if CACHE_DEBUGGING
-        validate_cache();
+        validate_shard(shard);
 #endif
     }
 
@@ -559,54 +998,100 @@ WEAK void halide_memoization_cache_release(void *user_context, void *host) {
 
 WEAK void halide_memoization_cache_cleanup() {
     debug(nullptr) << "halide_memoization_cache_cleanup\n";
-    for (auto &entry_ref : cache_entries) {
-        CacheEntry *entry = entry_ref;
-        entry_ref = nullptr;
-        while (entry != nullptr) {
-            CacheEntry *next = entry->next;
-            entry->destroy();
-            halide_free(nullptr, entry);
-            entry = next;
+    for (CacheShard &shard : cache_shards) {
+        for (auto &entry_ref : shard.entries) {
+            CacheEntry *entry = entry_ref;
+            entry_ref = nullptr;
+            while (entry != nullptr) {
+                CacheEntry *next = entry->next;
+                entry->destroy();
+                halide_free(nullptr, entry);
+                entry = next;
+            }
         }
+        shard.most_recently_used = nullptr;
+        shard.least_recently_used = nullptr;
+        shard.size = 0;
+        shard.entry_count = 0;
+    }
+    int64_t zero = 0;
+    for (CachePartition &partition : cache_partitions) {
+        Synchronization::atomic_store_sequentially_consistent(&partition.current_size, &zero);
+        partition.inflation = 0;
     }
-    current_cache_size = 0;
-    most_recently_used = nullptr;
-    least_recently_used = nullptr;
 }
 
 WEAK void halide_memoization_cache_evict(void *user_context, uint64_t eviction_key) {
-    ScopedMutexLock lock(&memoization_lock);
+    for (CacheShard &shard : cache_shards) {
+        ScopedMutexLock lock(&shard.lock);
 
-    for (auto &entry_ref : cache_entries) {
-        CacheEntry *entry = entry_ref;
-        if (entry != nullptr) {
+        for (auto &entry_ref : shard.entries) {
             CacheEntry **prev = &entry_ref;
+            CacheEntry *entry = entry_ref;
             while (entry != nullptr) {
                 CacheEntry *next = entry->next;
                 if (entry->has_eviction_key && entry->eviction_key == eviction_key) {
                     *prev = next;
-                    if (entry->more_recent != nullptr) {
-                        entry->more_recent->less_recent = entry->less_recent;
-                    } else {
-                        most_recently_used = entry->less_recent;
-                    }
-                    if (entry->less_recent != nullptr) {
-                        entry->less_recent->more_recent = entry->more_recent;
-                    } else {
-                        least_recently_used = entry->more_recent;
-                    }
-                    entry->destroy();
-                    halide_free(user_context, entry);
+                    destroy_entry_already_locked(user_context, shard, entry);
                 } else {
                     prev = &entry->next;
                 }
                 entry = next;
             }
         }
-    }
 #if CACHE_DEBUGGING
-    validate_cache();
+        validate_shard(shard);
 #endif
+    }
+}
+
+WEAK uint64_t halide_memoization_hash_buffer(void *user_context, halide_buffer_t *buf) {
+    ContentHasher hasher;
+    hasher.update(((uint64_t)buf->type.code << 32) | ((uint64_t)buf->type.bits << 16) | buf->type.lanes);
+    hasher.update((uint64_t)buf->dimensions);
+    for (int i = 0; i < buf->dimensions; i++) {
+        hasher.update(((uint64_t)(uint32_t)buf->dim[i].min << 32) | (uint32_t)buf->dim[i].extent);
+    }
+
+    if (buf->device_dirty() && halide_copy_to_host(user_context, buf) != halide_error_code_success) {
+        // Make a key which won't match anything, so that the Func is
+        // computed. The error will come up again when it reads the
+        // buffer.
+        hasher.update(Synchronization::atomic_add_fetch_sequentially_consistent(&hash_copy_failures, (uint64_t)1));
+        return hasher.finish();
+    }
+
+    if (buf->host != nullptr && buf->number_of_elements() > 0) {
+        // Find the innermost dimensions that are dense in memory, so
+        // that they can be hashed as one span.
+        int dense_dims = 0;
+        int64_t dense_stride = 1;
+        while (dense_dims < buf->dimensions &&
+               buf->dim[dense_dims].stride == dense_stride) {
+            dense_stride *= buf->dim[dense_dims].extent;
+            dense_dims++;
+        }
+        hash_buffer_contents(hasher, buf, buf->dimensions - 1, dense_dims, buf->host);
+    }
+    return hasher.finish();
+}
+
+WEAK int halide_memoization_cache_shard_count() {
+    return (int)kNumCacheShards;
+}
+
+WEAK int halide_memoization_cache_get_stats(int shard_index, halide_memoization_cache_stats_t *stats) {
+    if (shard_index < 0 || shard_index >= (int)kNumCacheShards || stats == nullptr) {
+        return halide_error_code_generic_error;
+    }
+    CacheShard &shard = cache_shards[shard_index];
+    ScopedMutexLock lock(&shard.lock);
+    stats->hits = shard.hits;
+    stats->misses = shard.misses;
+    stats->evictions = shard.evictions;
+    stats->bytes = shard.size;
+    stats->entries = shard.entry_count;
+    return halide_error_code_success;
 }
 
 namespace {
@@ -12,6 +12,24 @@ WEAK uint64_t halide_cpu_features_storage[sizeof(CpuFeatures) / sizeof(uint64_t)
 WEAK bool halide_cpu_features_initialized = false;
 WEAK halide_mutex halide_cpu_features_initialized_lock;
 
+WEAK const CpuFeatures *get_cached_cpu_features() {
+    // cpu features should never change, so call once and cache.
+    // Note that since CpuFeatures has a (trivial) ctor, compilers may insert guards
+    // for threadsafe initialization (per C++11); this can fail at link time
+    // on some systems (MSVC) because our runtime is a special beast. We'll
+    // work around this by using a sentinel for the initialization flag and
+    // some horribleness with memcpy (which we can do since CpuFeatures is still POD).
+    ScopedMutexLock lock(&halide_cpu_features_initialized_lock);
+
+    static_assert(sizeof(halide_cpu_features_storage) == sizeof(CpuFeatures), "CpuFeatures Mismatch");
+    if (!halide_cpu_features_initialized) {
+        CpuFeatures tmp = halide_get_cpu_features();
+        memcpy(&halide_cpu_features_storage, &tmp, sizeof(tmp));
+        halide_cpu_features_initialized = true;
+    }
+    return reinterpret_cast<const CpuFeatures *>(&halide_cpu_features_storage[0]);
+}
+
 }  // namespace Internal
 }  // namespace Runtime
 }  // namespace Halide
@@ -29,22 +47,7 @@ WEAK int halide_can_use_target_features(int count, const uint64_t *features) {
 }
 
 WEAK int halide_default_can_use_target_features(int count, const uint64_t *features) {
-    // cpu features should never change, so call once and cache.
-    // Note that since CpuFeatures has a (trivial) ctor, compilers may insert guards
-    // for threadsafe initialization (per C++11); this can fail at link time
-    // on some systems (MSVC) because our runtime is a special beast. We'll
-    // work around this by using a sentinel for the initialization flag and
-    // some horribleness with memcpy (which we can do since CpuFeatures is still POD).
-    {
-        ScopedMutexLock lock(&halide_cpu_features_initialized_lock);
-
-        static_assert(sizeof(halide_cpu_features_storage) == sizeof(CpuFeatures), "CpuFeatures Mismatch");
-        if (!halide_cpu_features_initialized) {
-            CpuFeatures tmp = halide_get_cpu_features();
-            memcpy(&halide_cpu_features_storage, &tmp, sizeof(tmp));
-            halide_cpu_features_initialized = true;
-        }
-    }
+    const CpuFeatures *cpu_features = get_cached_cpu_features();
 
     if (count != CpuFeatures::kWordCount) {
         // This should not happen unless our runtime is out of sync with the rest of libHalide.
@@ -53,7 +56,6 @@ WEAK int halide_default_can_use_target_features(int count, const uint64_t *featu
 #endif
         halide_error(nullptr, "Internal error: wrong structure size passed to halide_can_use_target_features()\n");
     }
-    const CpuFeatures *cpu_features = reinterpret_cast<const CpuFeatures *>(&halide_cpu_features_storage[0]);
     for (int i = 0; i < CpuFeatures::kWordCount; ++i) {
         uint64_t m;
         if ((m = (features[i] & cpu_features->known[i])) != 0) {
@@ -65,4 +67,9 @@ WEAK int halide_default_can_use_target_features(int count, const uint64_t *featu
 
     return 1;
 }
+
+WEAK int halide_can_use_target_vector_bits(int vector_bits) {
+    const CpuFeatures *cpu_features = get_cached_cpu_features();
+    return (vector_bits > 0 && cpu_features->scalable_vector_bits == (uint64_t)vector_bits) ? 1 : 0;
+}
 }
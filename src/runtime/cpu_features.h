@@ -36,11 +36,13 @@ struct CpuFeatures {
             known[i] = 0;
             available[i] = 0;
         }
+        scalable_vector_bits = 0;
     }
 
     uint64_t known[kWordCount];      // mask of the CPU features we know how to detect
     uint64_t available[kWordCount];  // mask of the CPU features that are available
                                      // (always a subset of 'known')
+    uint64_t scalable_vector_bits;   // width of scalable vector registers (e.g. SVE), or 0 if unknown
 };
 
 extern WEAK CpuFeatures halide_get_cpu_features();
@@ -105,6 +105,7 @@ extern WEAK halide_device_interface_t cuda_device_interface;
 
 WEAK const char *get_cuda_error_name(CUresult error);
 WEAK int create_cuda_context(void *user_context, CUcontext *ctx);
+WEAK int create_device_context(void *user_context, int device, CUcontext *ctx);
 
 template<typename... Args>
 int error_cuda(void *user_context, CUresult cuda_error, const Args &...args) {
@@ -119,6 +120,18 @@ int error_cuda(void *user_context, CUresult cuda_error, const Args &...args) {
 CUcontext WEAK context = nullptr;
 // This lock protexts the above context variable.
 WEAK halide_mutex context_lock;
+// Whether the above context is the primary context of
+// primary_context_device, which we retained rather than created.
+WEAK bool context_is_primary = false;
+WEAK CUdevice primary_context_device;
+// The ordinal of the device of the above context.
+WEAK int context_device = -1;
+
+// Contexts for the other devices selected with halide_set_gpu_device,
+// as the loops made by Func::distribute do. These are created the first
+// time they're used, and are also protected by context_lock.
+#define MAX_DEVICE_CONTEXTS 16
+WEAK CUcontext device_contexts[MAX_DEVICE_CONTEXTS];
 
 // A free list, used when allocations are being cached.
 WEAK struct FreeListItem {
@@ -163,6 +176,29 @@ WEAK int halide_default_cuda_acquire_context(void *user_context, CUcontext *ctx,
     // in general if you call device_release while other Halide code
     // is running though.
     CUcontext local_val = context;
+    const int device = halide_get_gpu_device(user_context);
+    if (local_val != nullptr && device >= 0 && device != context_device) {
+        if (device >= MAX_DEVICE_CONTEXTS) {
+            error(user_context) << "CUDA: Can't use more than " << MAX_DEVICE_CONTEXTS
+                                << " devices at once (selected device " << device << ")\n";
+            return halide_error_code_gpu_device_error;
+        }
+        local_val = device_contexts[device];
+        if (local_val == nullptr && create) {
+            ScopedMutexLock spinlock(&context_lock);
+            local_val = device_contexts[device];
+            if (local_val == nullptr) {
+                if (auto result = create_device_context(user_context, device, &local_val);
+                    result != halide_error_code_success) {
+                    return result;
+                }
+                device_contexts[device] = local_val;
+            }
+        }
+        *ctx = local_val;
+        return halide_error_code_success;
+    }
+
     if (local_val == nullptr) {
         if (!create) {
             *ctx = nullptr;
@@ -377,6 +413,28 @@ WEAK int create_cuda_context(void *user_context, CUcontext *ctx) {
     }
 
     debug(user_context) << "    Got device " << dev << "\n";
+    // Contexts for other devices selected later don't replace this one
+    // (see create_device_context). This is only called with
+    // context_lock held.
+    context_device = device;
+
+    // The CUDA runtime API, and so most other libraries that use CUDA,
+    // use the primary context of the device. Memory allocated in one
+    // context can't be used in another, so sharing device buffers with
+    // those libraries requires using it too.
+    const char *use_primary = getenv("HL_CUDA_PRIMARY_CONTEXT");
+    if (use_primary && use_primary[0] == '1' && cuDevicePrimaryCtxRetain && cuDevicePrimaryCtxRelease_v2) {
+        debug(user_context) << "    cuDevicePrimaryCtxRetain " << dev << " -> ";
+        err = cuDevicePrimaryCtxRetain(ctx, dev);
+        if (err != CUDA_SUCCESS) {
+            return error_cuda(user_context, err, "cuDevicePrimaryCtxRetain failed");
+        }
+        debug(user_context) << *ctx << "\n";
+        // Retaining it doesn't make it current, so there's nothing to pop.
+        context_is_primary = true;
+        primary_context_device = dev;
+        return halide_error_code_success;
+    }
 
 // Dump device attributes
 #ifdef DEBUG_RUNTIME
@@ -500,6 +558,58 @@ WEAK int create_cuda_context(void *user_context, CUcontext *ctx) {
     return halide_error_code_success;
 }
 
+// Create a context for a device other than that of the main context,
+// and let it and the other contexts access each other's memory, so that
+// kernels on each device can use buffers allocated on the others. This
+// is only called with context_lock held.
+WEAK int create_device_context(void *user_context, int device, CUcontext *ctx) {
+    CUdevice dev;
+    CUresult err = cuDeviceGet(&dev, device);
+    if (err != CUDA_SUCCESS) {
+        return error_cuda(user_context, err, "Failed to get device ", device);
+    }
+
+    debug(user_context) << "    cuCtxCreate " << dev << " -> ";
+    err = cuCtxCreate(ctx, 0, dev);
+    if (err != CUDA_SUCCESS) {
+        return error_cuda(user_context, err, "cuCtxCreate failed");
+    }
+    debug(user_context) << *ctx << "\n";
+
+    // Creation pushed the new context, which is what
+    // cuCtxEnablePeerAccess acts on.
+    if (cuCtxEnablePeerAccess) {
+        for (int i = -1; i < MAX_DEVICE_CONTEXTS; i++) {
+            CUcontext peer = i < 0 ? context : device_contexts[i];
+            if (peer == nullptr) {
+                continue;
+            }
+            // Failure here isn't fatal: the devices may not support peer
+            // access, in which case pipelines that don't share buffers
+            // between them still work.
+            err = cuCtxEnablePeerAccess(peer, 0);
+            if (err == CUDA_SUCCESS || err == CUDA_ERROR_PEER_ACCESS_ALREADY_ENABLED) {
+                cuCtxPushCurrent(peer);
+                err = cuCtxEnablePeerAccess(*ctx, 0);
+                CUcontext dummy;
+                cuCtxPopCurrent(&dummy);
+            }
+            if (err != CUDA_SUCCESS && err != CUDA_ERROR_PEER_ACCESS_ALREADY_ENABLED) {
+                debug(user_context) << "    No peer access between " << *ctx << " and " << peer
+                                    << ": " << get_cuda_error_name(err) << "\n";
+            }
+        }
+    }
+
+    CUcontext dummy;
+    err = cuCtxPopCurrent(&dummy);
+    if (err != CUDA_SUCCESS) {
+        return error_cuda(user_context, err, "cuCtxPopCurrent failed");
+    }
+
+    return halide_error_code_success;
+}
+
 // This feature may be useful during CUDA backend or runtime
 // development. It does not seem to find many errors in general Halide
 // use and causes false positives in at least one environment, where
@@ -550,6 +660,841 @@ WEAK CUmodule compile_kernel(void *user_context, const char *ptx_src, int size)
     return loaded_module;
 }
 
+// State for halide_cuda_set_graph_replay. While replay is enabled,
+// halide_cuda_run appends its launches to pending_launches instead of
+// issuing them, and the queue is flushed before anything else touches
+// the device: a copy, a sync, or handing memory back to the driver. A
+// flushed queue is looked up in graph_cache by its exact launch
+// parameters. Those include every kernel argument, so buffer device
+// pointers and any shapes the kernels take are part of the key. A hit
+// is replayed with a single cuGraphLaunch. A miss is issued one launch
+// at a time and then captured, so that the next identical queue can be
+// replayed.
+struct KernelLaunch {
+    CUfunction f;
+    unsigned int dims[6];
+    unsigned int shared_mem_bytes;
+    size_t num_args;
+    // num_args argument sizes, followed by the argument values, each
+    // padded to a multiple of 8 bytes.
+    size_t data_size;
+    uint64_t *data;
+};
+
+struct LaunchSequence {
+    CUcontext ctx;
+    CUstream stream;
+    KernelLaunch *launches;
+    int size;
+    int capacity;
+    uint64_t hash;
+};
+
+struct CachedGraph {
+    LaunchSequence launches;
+    CUgraphExec exec;
+    CachedGraph *next;
+};
+
+WEAK bool graph_replay_enabled = false;
+WEAK LaunchSequence pending_launches = {};
+// Most recently used first.
+WEAK CachedGraph *graph_cache = nullptr;
+WEAK uint64_t graph_captures = 0;
+WEAK uint64_t graph_replays = 0;
+// Protects all of the above.
+WEAK halide_mutex graph_lock;
+
+// Graphs beyond this many are destroyed, least recently used first.
+const int max_cached_graphs = 16;
+// A pipeline that launches many kernels without ever copying or
+// syncing is flushed in chunks of this many launches.
+const int max_pending_launches = 1024;
+
+WEAK bool graphs_supported() {
+    return cuStreamSynchronize && cuStreamCreate && cuStreamDestroy_v2 &&
+           cuStreamBeginCapture_v2 && cuStreamEndCapture &&
+           cuGraphInstantiateWithFlags && cuGraphLaunch &&
+           cuGraphExecDestroy && cuGraphDestroy;
+}
+
+WEAK void clear_launch_sequence(LaunchSequence &s) {
+    for (int i = 0; i < s.size; i++) {
+        free(s.launches[i].data);
+    }
+    free(s.launches);
+    s = LaunchSequence{};
+}
+
+ALWAYS_INLINE uint64_t hash_combine(uint64_t h, uint64_t v) {
+    return (h ^ v) * 0x100000001b3ULL;
+}
+
+WEAK bool same_launch(const KernelLaunch &a, const KernelLaunch &b) {
+    return a.f == b.f &&
+           memcmp(a.dims, b.dims, sizeof(a.dims)) == 0 &&
+           a.shared_mem_bytes == b.shared_mem_bytes &&
+           a.num_args == b.num_args &&
+           a.data_size == b.data_size &&
+           memcmp(a.data, b.data, a.data_size) == 0;
+}
+
+WEAK bool same_sequence(const LaunchSequence &a, const LaunchSequence &b) {
+    if (a.hash != b.hash || a.ctx != b.ctx || a.stream != b.stream || a.size != b.size) {
+        return false;
+    }
+    for (int i = 0; i < a.size; i++) {
+        if (!same_launch(a.launches[i], b.launches[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+WEAK CUresult launch_kernel(const KernelLaunch &l, CUstream stream) {
+    void **params = (void **)malloc((l.num_args + 1) * sizeof(void *));
+    if (!params) {
+        return CUDA_ERROR_OUT_OF_MEMORY;
+    }
+    uint8_t *value = (uint8_t *)(l.data + l.num_args);
+    for (size_t i = 0; i < l.num_args; i++) {
+        params[i] = value;
+        value += (l.data[i] + 7) & ~(uint64_t)7;
+    }
+    params[l.num_args] = nullptr;
+    CUresult err = cuLaunchKernel(l.f,
+                                  l.dims[0], l.dims[1], l.dims[2],
+                                  l.dims[3], l.dims[4], l.dims[5],
+                                  l.shared_mem_bytes,
+                                  stream,
+                                  params,
+                                  nullptr);
+    free(params);
+    return err;
+}
+
+// Record the launches into a graph on a private stream. Nothing is
+// executed. Failure here is not an error; the sequence just doesn't
+// get cached.
+WEAK CUresult capture_graph(const LaunchSequence &s, CUgraphExec *exec) {
+    *exec = nullptr;
+    CUstream capture_stream = nullptr;
+    CUresult err = cuStreamCreate(&capture_stream, CU_STREAM_NON_BLOCKING);
+    if (err != CUDA_SUCCESS) {
+        return err;
+    }
+    err = cuStreamBeginCapture_v2(capture_stream, CU_STREAM_CAPTURE_MODE_THREAD_LOCAL);
+    if (err == CUDA_SUCCESS) {
+        for (int i = 0; err == CUDA_SUCCESS && i < s.size; i++) {
+            err = launch_kernel(s.launches[i], capture_stream);
+        }
+        // The capture must be ended even if a launch failed.
+        CUgraph graph = nullptr;
+        CUresult end_err = cuStreamEndCapture(capture_stream, &graph);
+        if (err == CUDA_SUCCESS) {
+            err = end_err;
+        }
+        if (err == CUDA_SUCCESS) {
+            err = cuGraphInstantiateWithFlags(exec, graph, 0);
+        }
+        if (graph) {
+            cuGraphDestroy(graph);
+        }
+    }
+    cuStreamDestroy_v2(capture_stream);
+    return err;
+}
+
+WEAK void destroy_cached_graph(CachedGraph *g) {
+    CUcontext old;
+    if (cuCtxPushCurrent(g->launches.ctx) == CUDA_SUCCESS) {
+        cuGraphExecDestroy(g->exec);
+        cuCtxPopCurrent(&old);
+    }
+    clear_launch_sequence(g->launches);
+    free(g);
+}
+
+// Issue everything in pending_launches. Must be called with graph_lock held.
+WEAK int flush_pending_launches_locked(void *user_context) {
+    LaunchSequence &s = pending_launches;
+    if (s.size == 0) {
+        return halide_error_code_success;
+    }
+
+    CUresult err = cuCtxPushCurrent(s.ctx);
+    if (err != CUDA_SUCCESS) {
+        clear_launch_sequence(s);
+        return error_cuda(user_context, err, "cuCtxPushCurrent failed");
+    }
+
+    int result = halide_error_code_success;
+    CachedGraph **prev = &graph_cache;
+    CachedGraph *g = graph_cache;
+    while (g && !same_sequence(g->launches, s)) {
+        prev = &g->next;
+        g = g->next;
+    }
+
+    if (g) {
+        debug(user_context) << "    cuGraphLaunch " << (void *)g->exec
+                            << " (" << s.size << " kernels)\n";
+        *prev = g->next;
+        g->next = graph_cache;
+        graph_cache = g;
+        graph_replays++;
+        result = error_cuda(user_context, cuGraphLaunch(g->exec, s.stream), "cuGraphLaunch failed");
+    } else {
+        for (int i = 0; result == halide_error_code_success && i < s.size; i++) {
+            result = error_cuda(user_context, launch_kernel(s.launches[i], s.stream), "cuLaunchKernel failed");
+        }
+        CUgraphExec exec = nullptr;
+        if (result == halide_error_code_success &&
+            capture_graph(s, &exec) == CUDA_SUCCESS) {
+            g = (CachedGraph *)malloc(sizeof(CachedGraph));
+            if (g) {
+                debug(user_context) << "    captured " << s.size << " kernels into graph " << (void *)exec << "\n";
+                g->launches = s;
+                g->exec = exec;
+                g->next = graph_cache;
+                graph_cache = g;
+                graph_captures++;
+                s = LaunchSequence{};
+
+                int depth = 0;
+                while (g && depth < max_cached_graphs - 1) {
+                    g = g->next;
+                    depth++;
+                }
+                if (g) {
+                    CachedGraph *to_destroy = g->next;
+                    g->next = nullptr;
+                    while (to_destroy) {
+                        CachedGraph *next = to_destroy->next;
+                        destroy_cached_graph(to_destroy);
+                        to_destroy = next;
+                    }
+                }
+            } else {
+                cuGraphExecDestroy(exec);
+            }
+        }
+    }
+    clear_launch_sequence(s);
+
+    CUcontext old;
+    cuCtxPopCurrent(&old);
+    return result;
+}
+
+WEAK int flush_pending_launches(void *user_context) {
+    // halide_cuda_set_graph_replay flushes when it disables replay, so
+    // nothing can be pending while replay is off.
+    if (!graph_replay_enabled) {
+        return halide_error_code_success;
+    }
+    ScopedMutexLock lock(&graph_lock);
+    return flush_pending_launches_locked(user_context);
+}
+
+// Queue a launch if replay is enabled. Sets *deferred to false if the
+// caller should issue the launch itself.
+WEAK int defer_launch(void *user_context, CUcontext ctx, CUstream stream, CUfunction f,
+                      const unsigned int dims[6], unsigned int shared_mem_bytes,
+                      size_t num_args, const size_t arg_sizes[], void *const args[],
+                      bool *deferred) {
+    *deferred = false;
+    ScopedMutexLock lock(&graph_lock);
+    if (!graph_replay_enabled) {
+        return halide_error_code_success;
+    }
+
+    LaunchSequence &s = pending_launches;
+    if (s.size > 0 && (s.ctx != ctx || s.stream != stream || s.size >= max_pending_launches)) {
+        if (auto result = flush_pending_launches_locked(user_context);
+            result != halide_error_code_success) {
+            return result;
+        }
+    }
+
+    if (s.size == s.capacity) {
+        int new_capacity = s.capacity ? s.capacity * 2 : 32;
+        KernelLaunch *launches = (KernelLaunch *)malloc(new_capacity * sizeof(KernelLaunch));
+        if (!launches) {
+            return halide_error_code_out_of_memory;
+        }
+        if (s.size) {
+            memcpy(launches, s.launches, s.size * sizeof(KernelLaunch));
+        }
+        free(s.launches);
+        s.launches = launches;
+        s.capacity = new_capacity;
+    }
+
+    size_t data_size = num_args * sizeof(uint64_t);
+    for (size_t i = 0; i < num_args; i++) {
+        data_size += (arg_sizes[i] + 7) & ~(size_t)7;
+    }
+    uint64_t *data = (uint64_t *)malloc(data_size);
+    if (!data) {
+        return halide_error_code_out_of_memory;
+    }
+    // Zero the padding so that memcmp sees equal launches as equal.
+    memset(data, 0, data_size);
+    uint8_t *value = (uint8_t *)(data + num_args);
+    for (size_t i = 0; i < num_args; i++) {
+        data[i] = arg_sizes[i];
+        memcpy(value, args[i], arg_sizes[i]);
+        value += (arg_sizes[i] + 7) & ~(size_t)7;
+    }
+
+    KernelLaunch &l = s.launches[s.size];
+    l.f = f;
+    memcpy(l.dims, dims, sizeof(l.dims));
+    l.shared_mem_bytes = shared_mem_bytes;
+    l.num_args = num_args;
+    l.data_size = data_size;
+    l.data = data;
+
+    uint64_t h = s.size ? s.hash : 0xcbf29ce484222325ULL;
+    h = hash_combine(h, (uint64_t)(uintptr_t)f);
+    for (unsigned int d : l.dims) {
+        h = hash_combine(h, d);
+    }
+    for (size_t i = 0; i < data_size / sizeof(uint64_t); i++) {
+        h = hash_combine(h, data[i]);
+    }
+    s.hash = h;
+    s.ctx = ctx;
+    s.stream = stream;
+    s.size++;
+
+    *deferred = true;
+    return halide_error_code_success;
+}
+
+// Destroy the cached graphs that belong to a context that is going away.
+WEAK void release_cached_graphs(CUcontext ctx) {
+    ScopedMutexLock lock(&graph_lock);
+    CachedGraph **prev = &graph_cache;
+    while (*prev) {
+        CachedGraph *g = *prev;
+        if (g->launches.ctx == ctx) {
+            *prev = g->next;
+            destroy_cached_graph(g);
+        } else {
+            prev = &g->next;
+        }
+    }
+}
+
+// Copies from pageable host memory go through a pool of pinned staging
+// blocks, so that the host only waits for its own memcpy rather than
+// for the stream to drain. Each block is carved up sequentially and
+// carries an event recorded after the last copy out of it; the block
+// is reused once that event has completed.
+struct StagingBlock {
+    CUcontext ctx;
+    uint8_t *host;
+    size_t used;
+    CUevent done;
+    StagingBlock *next;
+};
+
+WEAK StagingBlock *staging_blocks = nullptr;
+WEAK int staging_block_count = 0;
+// Protects the above.
+WEAK halide_mutex staging_lock;
+
+const size_t staging_block_size = 4 * 1024 * 1024;
+const int max_staging_blocks = 8;
+
+WEAK bool is_pinned_host_memory(const void *p) {
+    unsigned int flags;
+    return cuMemHostGetFlags(&flags, (void *)p) == CUDA_SUCCESS;
+}
+
+WEAK void destroy_staging_block(StagingBlock *b) {
+    cuEventDestroy(b->done);
+    cuMemFreeHost(b->host);
+    free(b);
+}
+
+// Find room for size bytes (at most staging_block_size) in a staging
+// block for the current context. Returns nullptr if no pinned memory
+// could be had, in which case the caller copies directly.
+WEAK StagingBlock *acquire_staging_block(void *user_context, CUcontext ctx, size_t size) {
+    StagingBlock *oldest = nullptr;
+    for (StagingBlock *b = staging_blocks; b; b = b->next) {
+        if (b->ctx != ctx) {
+            continue;
+        }
+        if (b->used + size <= staging_block_size) {
+            return b;
+        }
+        if (cuEventQuery(b->done) == CUDA_SUCCESS) {
+            b->used = 0;
+            return b;
+        }
+        oldest = b;
+    }
+
+    if (staging_block_count < max_staging_blocks) {
+        StagingBlock *b = (StagingBlock *)malloc(sizeof(StagingBlock));
+        if (!b) {
+            return nullptr;
+        }
+        void *host = nullptr;
+        CUresult err = cuMemHostAlloc(&host, staging_block_size, CU_MEMHOSTALLOC_PORTABLE);
+        if (err == CUDA_SUCCESS) {
+            err = cuEventCreate(&b->done, CU_EVENT_DISABLE_TIMING);
+            if (err != CUDA_SUCCESS) {
+                cuMemFreeHost(host);
+            }
+        }
+        if (err != CUDA_SUCCESS) {
+            debug(user_context) << "    could not allocate a pinned staging block: " << get_cuda_error_name(err) << "\n";
+            free(b);
+            return nullptr;
+        }
+        debug(user_context) << "    cuMemHostAlloc staging block " << host << "\n";
+        b->ctx = ctx;
+        b->host = (uint8_t *)host;
+        b->used = 0;
+        // The list is kept most recently allocated first, so the last
+        // block visited above is the one that has been in flight longest.
+        b->next = staging_blocks;
+        staging_blocks = b;
+        staging_block_count++;
+        return b;
+    }
+
+    if (oldest && cuEventSynchronize(oldest->done) == CUDA_SUCCESS) {
+        oldest->used = 0;
+        return oldest;
+    }
+    return nullptr;
+}
+
+// Copy size bytes from pageable host memory to the device via the
+// staging pool.
+WEAK CUresult staged_copy_to_device(void *user_context, CUcontext ctx, CUdeviceptr dst,
+                                    const uint8_t *src, size_t size, CUstream stream) {
+    ScopedMutexLock lock(&staging_lock);
+    while (size > 0) {
+        size_t n = size < staging_block_size ? size : staging_block_size;
+        StagingBlock *b = acquire_staging_block(user_context, ctx, n);
+        if (!b) {
+            return stream ? cuMemcpyHtoDAsync(dst, src, size, stream) : cuMemcpyHtoD(dst, src, size);
+        }
+        uint8_t *staged = b->host + b->used;
+        memcpy(staged, src, n);
+        CUresult err = cuMemcpyHtoDAsync(dst, staged, n, stream);
+        if (err == CUDA_SUCCESS) {
+            err = cuEventRecord(b->done, stream);
+        }
+        if (err != CUDA_SUCCESS) {
+            return err;
+        }
+        // Keep later copies 16-byte aligned.
+        b->used += (n + 15) & ~(size_t)15;
+        dst += n;
+        src += n;
+        size -= n;
+    }
+    return CUDA_SUCCESS;
+}
+
+// State for halide_cuda_set_stream_ordered_allocation. Each context
+// gets its own memory pool, so that its release threshold doesn't
+// affect anyone else's use of the device's default pool. Memory freed
+// with cuMemFreeAsync goes back into the pool in stream order and can
+// be handed out again by a later cuMemAllocFromPoolAsync on the same
+// stream without the host ever synchronizing.
+struct MemoryPool {
+    CUcontext ctx;
+    CUmemoryPool pool;
+    MemoryPool *next;
+};
+
+WEAK bool stream_ordered_allocation = false;
+WEAK MemoryPool *memory_pools = nullptr;
+// Protects memory_pools.
+WEAK halide_mutex memory_pool_lock;
+
+WEAK bool stream_ordered_allocation_supported() {
+    return cuStreamSynchronize && cuMemPoolCreate && cuMemPoolDestroy &&
+           cuMemPoolSetAttribute && cuMemPoolGetAttribute && cuMemPoolTrimTo &&
+           cuMemAllocFromPoolAsync && cuMemFreeAsync;
+}
+
+// Get the pool for the current context, optionally creating it.
+WEAK int get_memory_pool(void *user_context, CUcontext ctx, bool create, CUmemoryPool *pool) {
+    *pool = nullptr;
+    ScopedMutexLock lock(&memory_pool_lock);
+    for (MemoryPool *m = memory_pools; m; m = m->next) {
+        if (m->ctx == ctx) {
+            *pool = m->pool;
+            return halide_error_code_success;
+        }
+    }
+    if (!create) {
+        return halide_error_code_success;
+    }
+
+    CUdevice dev;
+    CUresult err = cuCtxGetDevice(&dev);
+    if (err != CUDA_SUCCESS) {
+        return error_cuda(user_context, err, "cuCtxGetDevice failed");
+    }
+
+    CUmemPoolProps props;
+    memset(&props, 0, sizeof(props));
+    props.allocType = CU_MEM_ALLOCATION_TYPE_PINNED;
+    props.location.type = CU_MEM_LOCATION_TYPE_DEVICE;
+    props.location.id = dev;
+    CUmemoryPool p = nullptr;
+    err = cuMemPoolCreate(&p, &props);
+    if (err != CUDA_SUCCESS) {
+        return error_cuda(user_context, err, "cuMemPoolCreate failed");
+    }
+
+    // By default a pool gives its memory back to the driver at every
+    // synchronization, which defeats the point. Keep it until trimmed.
+    uint64_t threshold = ~(uint64_t)0;
+    err = cuMemPoolSetAttribute(p, CU_MEMPOOL_ATTR_RELEASE_THRESHOLD, &threshold);
+    if (err != CUDA_SUCCESS) {
+        cuMemPoolDestroy(p);
+        return error_cuda(user_context, err, "cuMemPoolSetAttribute failed");
+    }
+
+    MemoryPool *m = (MemoryPool *)malloc(sizeof(MemoryPool));
+    if (!m) {
+        cuMemPoolDestroy(p);
+        return halide_error_code_out_of_memory;
+    }
+    debug(user_context) << "    cuMemPoolCreate -> " << (void *)p << "\n";
+    m->ctx = ctx;
+    m->pool = p;
+    m->next = memory_pools;
+    memory_pools = m;
+    *pool = p;
+    return halide_error_code_success;
+}
+
+// Whether an allocation came from a pool made by get_memory_pool.
+WEAK bool is_pool_allocation(CUdeviceptr ptr) {
+    if (memory_pools == nullptr) {
+        return false;
+    }
+    CUmemoryPool owner = nullptr;
+    if (cuPointerGetAttribute(&owner, CU_POINTER_ATTRIBUTE_MEMPOOL_HANDLE, ptr) != CUDA_SUCCESS ||
+        owner == nullptr) {
+        return false;
+    }
+    ScopedMutexLock lock(&memory_pool_lock);
+    for (MemoryPool *m = memory_pools; m; m = m->next) {
+        if (m->pool == owner) {
+            return true;
+        }
+    }
+    return false;
+}
+
+WEAK void release_memory_pool(CUcontext ctx) {
+    ScopedMutexLock lock(&memory_pool_lock);
+    MemoryPool **prev = &memory_pools;
+    while (*prev) {
+        MemoryPool *m = *prev;
+        if (m->ctx == ctx) {
+            *prev = m->next;
+            // Any allocations still outstanding keep the pool alive
+            // until they are freed.
+            cuMemPoolDestroy(m->pool);
+            free(m);
+        } else {
+            prev = &m->next;
+        }
+    }
+}
+
+// State for halide_cuda_set_concurrent_streams. Kernels are spread over
+// a set of streams per (context, stream from halide_cuda_get_stream)
+// pair, where index 0 is that stream itself. A kernel waits for the
+// last kernel to touch any of the same device allocations, tracked in
+// StreamSet::uses, so kernels that share no buffers can run at the same
+// time. Each launch on another stream first waits for everything
+// already queued on the base stream. Before anything else touches the
+// device (a copy, sync, free, or the end of the pipeline) the base
+// stream is made to wait for the other streams again.
+struct AllocationUse {
+    CUdeviceptr base;  // 0 if unused
+    CUevent event;     // recorded after the last kernel to use it
+    int stream;
+    uint64_t seq;
+};
+
+const int max_concurrent_streams = 8;
+const int max_tracked_allocations = 64;
+
+struct StreamSet {
+    CUcontext ctx;
+    CUstream streams[max_concurrent_streams];
+    CUevent fork;                               // recorded on streams[0]
+    CUevent joins[max_concurrent_streams];      // recorded on streams[i]
+    bool dirty[max_concurrent_streams];         // has unjoined work
+    int next;
+    AllocationUse uses[max_tracked_allocations];
+    StreamSet *next_set;
+};
+
+WEAK int concurrent_streams = 1;
+WEAK StreamSet *stream_sets = nullptr;
+WEAK uint64_t stream_use_seq = 0;
+// Protects the above.
+WEAK halide_mutex stream_set_lock;
+
+WEAK bool concurrent_streams_supported() {
+    return cuStreamSynchronize && cuStreamCreate && cuStreamDestroy_v2 &&
+           cuStreamWaitEvent && cuMemGetAddressRange_v2;
+}
+
+WEAK void destroy_stream_set(StreamSet *set) {
+    for (int i = 0; i < max_concurrent_streams; i++) {
+        if (i > 0 && set->streams[i]) {
+            cuStreamDestroy_v2(set->streams[i]);
+        }
+        if (set->joins[i]) {
+            cuEventDestroy(set->joins[i]);
+        }
+    }
+    for (auto &use : set->uses) {
+        if (use.event) {
+            cuEventDestroy(use.event);
+        }
+    }
+    if (set->fork) {
+        cuEventDestroy(set->fork);
+    }
+    free(set);
+}
+
+// Must be called with stream_set_lock held and set->ctx current.
+WEAK CUresult join_stream_set(StreamSet *set) {
+    CUresult err = CUDA_SUCCESS;
+    for (int i = 1; i < max_concurrent_streams && err == CUDA_SUCCESS; i++) {
+        if (set->dirty[i]) {
+            err = cuEventRecord(set->joins[i], set->streams[i]);
+            if (err == CUDA_SUCCESS) {
+                err = cuStreamWaitEvent(set->streams[0], set->joins[i], 0);
+            }
+            set->dirty[i] = false;
+        }
+    }
+    // Everything tracked is now ordered before the base stream.
+    for (auto &use : set->uses) {
+        use.base = 0;
+    }
+    return err;
+}
+
+// Order all work on the concurrent streams for this context before
+// anything subsequently queued on the base streams.
+WEAK int join_concurrent_streams(void *user_context, CUcontext ctx) {
+    if (stream_sets == nullptr) {
+        return halide_error_code_success;
+    }
+    ScopedMutexLock lock(&stream_set_lock);
+    for (StreamSet *set = stream_sets; set; set = set->next_set) {
+        if (set->ctx == ctx) {
+            CUresult err = join_stream_set(set);
+            if (err != CUDA_SUCCESS) {
+                return error_cuda(user_context, err, "joining concurrent streams failed");
+            }
+        }
+    }
+    return halide_error_code_success;
+}
+
+// Must be called with stream_set_lock held.
+WEAK int get_stream_set(void *user_context, CUcontext ctx, CUstream base, StreamSet **result) {
+    for (StreamSet *set = stream_sets; set; set = set->next_set) {
+        if (set->ctx == ctx && set->streams[0] == base) {
+            *result = set;
+            return halide_error_code_success;
+        }
+    }
+
+    StreamSet *set = (StreamSet *)malloc(sizeof(StreamSet));
+    if (!set) {
+        return halide_error_code_out_of_memory;
+    }
+    memset(set, 0, sizeof(StreamSet));
+    set->ctx = ctx;
+    set->streams[0] = base;
+    CUresult err = cuEventCreate(&set->fork, CU_EVENT_DISABLE_TIMING);
+    for (int i = 0; i < max_concurrent_streams && err == CUDA_SUCCESS; i++) {
+        err = cuEventCreate(&set->joins[i], CU_EVENT_DISABLE_TIMING);
+        if (err == CUDA_SUCCESS && i > 0) {
+            err = cuStreamCreate(&set->streams[i], CU_STREAM_NON_BLOCKING);
+        }
+    }
+    for (int i = 0; i < max_tracked_allocations && err == CUDA_SUCCESS; i++) {
+        err = cuEventCreate(&set->uses[i].event, CU_EVENT_DISABLE_TIMING);
+    }
+    if (err != CUDA_SUCCESS) {
+        destroy_stream_set(set);
+        return error_cuda(user_context, err, "creating concurrent streams failed");
+    }
+    set->next_set = stream_sets;
+    stream_sets = set;
+    *result = set;
+    return halide_error_code_success;
+}
+
+// Pick a stream for a kernel using the given device pointers and make
+// it wait for the kernel's dependencies. The caller must record the
+// launch with finish_concurrent_launch.
+WEAK int begin_concurrent_launch(void *user_context, CUcontext ctx, CUstream base,
+                                 const CUdeviceptr *ptrs, CUdeviceptr *bases, size_t count,
+                                 StreamSet **set_out, int *stream_out) {
+    StreamSet *set;
+    if (auto result = get_stream_set(user_context, ctx, base, &set);
+        result != halide_error_code_success) {
+        return result;
+    }
+
+    // Run on the stream of the most recent dependency, or on the next
+    // stream in turn if the kernel depends on nothing tracked.
+    AllocationUse *deps[max_tracked_allocations];
+    int num_deps = 0;
+    int chosen = -1;
+    uint64_t latest = 0;
+    for (size_t i = 0; i < count; i++) {
+        bases[i] = 0;
+        if (!ptrs[i]) {
+            continue;
+        }
+        size_t size;
+        CUresult err = cuMemGetAddressRange_v2(&bases[i], &size, ptrs[i]);
+        if (err != CUDA_SUCCESS) {
+            return error_cuda(user_context, err, "cuMemGetAddressRange failed");
+        }
+        for (auto &use : set->uses) {
+            if (use.base == bases[i]) {
+                if (num_deps < max_tracked_allocations) {
+                    deps[num_deps++] = &use;
+                }
+                if (use.seq > latest) {
+                    latest = use.seq;
+                    chosen = use.stream;
+                }
+                break;
+            }
+        }
+    }
+    if (chosen < 0) {
+        chosen = set->next;
+        set->next = (set->next + 1) % concurrent_streams;
+    }
+
+    CUstream stream = set->streams[chosen];
+    CUresult err = CUDA_SUCCESS;
+    if (chosen != 0) {
+        err = cuEventRecord(set->fork, set->streams[0]);
+        if (err == CUDA_SUCCESS) {
+            err = cuStreamWaitEvent(stream, set->fork, 0);
+        }
+    }
+    for (int i = 0; i < num_deps && err == CUDA_SUCCESS; i++) {
+        if (deps[i]->stream != chosen) {
+            err = cuStreamWaitEvent(stream, deps[i]->event, 0);
+        }
+    }
+    if (err != CUDA_SUCCESS) {
+        return error_cuda(user_context, err, "ordering concurrent streams failed");
+    }
+
+    *set_out = set;
+    *stream_out = chosen;
+    return halide_error_code_success;
+}
+
+WEAK int finish_concurrent_launch(void *user_context, StreamSet *set, int chosen,
+                                  const CUdeviceptr *bases, size_t count) {
+    CUstream stream = set->streams[chosen];
+    for (size_t i = 0; i < count; i++) {
+        if (!bases[i]) {
+            continue;
+        }
+        AllocationUse *use = nullptr, *oldest = &set->uses[0];
+        for (auto &u : set->uses) {
+            if (u.base == bases[i] || (!use && u.base == 0)) {
+                use = &u;
+                if (u.base == bases[i]) {
+                    break;
+                }
+            }
+            if (u.seq < oldest->seq) {
+                oldest = &u;
+            }
+        }
+        if (!use) {
+            // Out of slots. Forgetting an allocation is safe once the
+            // base stream waits for its last use, since later launches
+            // on other streams wait for the base stream.
+            use = oldest;
+            CUresult err = cuStreamWaitEvent(set->streams[0], use->event, 0);
+            if (err != CUDA_SUCCESS) {
+                return error_cuda(user_context, err, "cuStreamWaitEvent failed");
+            }
+        }
+        CUresult err = cuEventRecord(use->event, stream);
+        if (err != CUDA_SUCCESS) {
+            return error_cuda(user_context, err, "cuEventRecord failed");
+        }
+        use->base = bases[i];
+        use->stream = chosen;
+        use->seq = ++stream_use_seq;
+    }
+    if (chosen != 0) {
+        set->dirty[chosen] = true;
+    }
+    return halide_error_code_success;
+}
+
+WEAK void release_stream_sets(CUcontext ctx) {
+    ScopedMutexLock lock(&stream_set_lock);
+    StreamSet **prev = &stream_sets;
+    while (*prev) {
+        StreamSet *set = *prev;
+        if (set->ctx == ctx) {
+            *prev = set->next_set;
+            destroy_stream_set(set);
+        } else {
+            prev = &set->next_set;
+        }
+    }
+}
+
+// Free the staging blocks for a context (or all contexts, if ctx is
+// nullptr) that no copy is still reading from.
+WEAK void release_staging_blocks(CUcontext ctx, bool wait) {
+    ScopedMutexLock lock(&staging_lock);
+    StagingBlock **prev = &staging_blocks;
+    while (*prev) {
+        StagingBlock *b = *prev;
+        if ((ctx == nullptr || b->ctx == ctx) &&
+            (wait ? cuEventSynchronize(b->done) : cuEventQuery(b->done)) == CUDA_SUCCESS) {
+            *prev = b->next;
+            destroy_staging_block(b);
+            staging_block_count--;
+        } else {
+            prev = &b->next;
+        }
+    }
+}
+
 }  // namespace Cuda
 }  // namespace Internal
 }  // namespace Runtime
@@ -589,17 +1534,37 @@ WEAK int halide_cuda_initialize_kernels(void *user_context, void **state_ptr, co
 WEAK void halide_cuda_finalize_kernels(void *user_context, void *state_ptr) {
     Context ctx(user_context);
     if (ctx.error() == halide_error_code_success) {
+        // This runs at the end of every pipeline: leave its results
+        // ordered on the stream the caller knows about.
+        (void)join_concurrent_streams(user_context, ctx.context);
         compilation_cache.release_hold(user_context, ctx.context, state_ptr);
     }
 }
 
 WEAK int halide_cuda_release_unused_device_allocations(void *user_context) {
+    if (cuInit) {
+        release_staging_blocks(nullptr, false);
+
+        // Hand back whatever the memory pools aren't currently using.
+        ScopedMutexLock lock(&memory_pool_lock);
+        for (MemoryPool *m = memory_pools; m; m = m->next) {
+            cuMemPoolTrimTo(m->pool, 0);
+        }
+    }
+
     FreeListItem *to_free;
     {
         ScopedMutexLock lock(&free_list_lock);
         to_free = free_list;
         free_list = nullptr;
     }
+    if (to_free) {
+        // Queued kernels may still use these allocations.
+        if (auto result = flush_pending_launches(user_context);
+            result != halide_error_code_success) {
+            return result;
+        }
+    }
     while (to_free) {
         debug(user_context) << "    cuMemFree " << (void *)(to_free->ptr) << "\n";
         cuMemFree(to_free->ptr);
@@ -664,8 +1629,28 @@ WEAK int halide_cuda_device_free(void *user_context, halide_buffer_t *buf) {
         return result;
     }
 
+    // Kernels on other streams may still be using this allocation.
+    result = join_concurrent_streams(user_context, ctx.context);
+    if (result) {
+        return result;
+    }
+
     CUresult err = CUDA_SUCCESS;
-    if (halide_can_reuse_device_allocations(user_context)) {
+    if (is_pool_allocation(dev_ptr)) {
+        // Queued kernels are issued after anything we put on the
+        // stream now, so they must go first.
+        result = flush_pending_launches(user_context);
+        if (result) {
+            return result;
+        }
+        CUstream stream = nullptr;
+        result = halide_cuda_get_stream(user_context, ctx.context, &stream);
+        if (result) {
+            return result;
+        }
+        debug(user_context) << "    cuMemFreeAsync " << (void *)(dev_ptr) << "\n";
+        err = cuMemFreeAsync(dev_ptr, stream);
+    } else if (halide_can_reuse_device_allocations(user_context)) {
         debug(user_context) << "    caching allocation for later use: " << (void *)(dev_ptr) << "\n";
 
         FreeListItem *item = (FreeListItem *)malloc(sizeof(FreeListItem));
@@ -691,6 +1676,10 @@ WEAK int halide_cuda_device_free(void *user_context, halide_buffer_t *buf) {
             free_list = item;
         }
     } else {
+        result = flush_pending_launches(user_context);
+        if (result) {
+            return result;
+        }
         debug(user_context) << "    cuMemFree " << (void *)(dev_ptr) << "\n";
         err = cuMemFree(dev_ptr);
         // If cuMemFree fails, it isn't likely to succeed later, so just drop
@@ -739,6 +1728,15 @@ WEAK int halide_cuda_device_release(void *user_context) {
             return error_cuda(user_context, err);
         }
 
+        // Issue any queued launches and drop this context's graphs,
+        // ignoring errors.
+        (void)flush_pending_launches(user_context);
+        release_cached_graphs(ctx);
+        release_staging_blocks(ctx, true);
+        release_memory_pool(ctx);
+        (void)join_concurrent_streams(user_context, ctx);
+        release_stream_sets(ctx);
+
         // Dump the contents of the free list, ignoring errors.
         (void)halide_cuda_release_unused_device_allocations(user_context);
 
@@ -752,7 +1750,40 @@ WEAK int halide_cuda_device_release(void *user_context) {
         {
             ScopedMutexLock spinlock(&context_lock);
 
+            // The contexts for the other devices are always ours, and
+            // are released along with the main one.
             if (ctx == context) {
+                for (int i = 0; i < MAX_DEVICE_CONTEXTS; i++) {
+                    CUcontext device_ctx = device_contexts[i];
+                    if (device_ctx == nullptr) {
+                        continue;
+                    }
+                    if (cuCtxPushCurrent(device_ctx) == CUDA_SUCCESS) {
+                        (void)flush_pending_launches(user_context);
+                        release_cached_graphs(device_ctx);
+                        release_staging_blocks(device_ctx, true);
+                        release_memory_pool(device_ctx);
+                        (void)join_concurrent_streams(user_context, device_ctx);
+                        release_stream_sets(device_ctx);
+                        compilation_cache.delete_context(user_context, device_ctx, cuModuleUnload);
+                        cuCtxPopCurrent(&old_ctx);
+                    }
+                    debug(user_context) << "    cuCtxDestroy " << device_ctx << "\n";
+                    (void)cuCtxDestroy(device_ctx);
+                    device_contexts[i] = nullptr;
+                }
+                context_device = -1;
+            }
+
+            if (ctx == context && context_is_primary) {
+                debug(user_context) << "    cuDevicePrimaryCtxRelease " << primary_context_device << "\n";
+                err = cuDevicePrimaryCtxRelease_v2(primary_context_device);
+                if (err != CUDA_SUCCESS && err != CUDA_ERROR_DEINITIALIZED) {
+                    return error_cuda(user_context, err);
+                }
+                context = nullptr;
+                context_is_primary = false;
+            } else if (ctx == context) {
                 debug(user_context) << "    cuCtxDestroy " << context << "\n";
                 err = cuProfilerStop();
                 err = cuCtxDestroy(context);
@@ -800,7 +1831,9 @@ WEAK int halide_cuda_device_malloc(void *user_context, halide_buffer_t *buf) {
 
     CUdeviceptr p = 0;
     FreeListItem *to_free = nullptr;
-    if (halide_can_reuse_device_allocations(user_context)) {
+    if (stream_ordered_allocation) {
+        // The memory pool does its own recycling.
+    } else if (halide_can_reuse_device_allocations(user_context)) {
         CUstream stream = nullptr;
         if (cuStreamSynchronize != nullptr) {
             auto result = halide_cuda_get_stream(user_context, ctx.context, &stream);
@@ -851,6 +1884,12 @@ WEAK int halide_cuda_device_malloc(void *user_context, halide_buffer_t *buf) {
         }
     }
 
+    if (to_free) {
+        if (auto result = flush_pending_launches(user_context);
+            result != halide_error_code_success) {
+            return result;
+        }
+    }
     while (to_free) {
         FreeListItem *next = to_free->next;
         cuMemFree(to_free->ptr);
@@ -858,6 +1897,33 @@ WEAK int halide_cuda_device_malloc(void *user_context, halide_buffer_t *buf) {
         to_free = next;
     }
 
+    if (!p && stream_ordered_allocation) {
+        CUstream stream = nullptr;
+        CUmemoryPool pool = nullptr;
+        if (auto result = halide_cuda_get_stream(user_context, ctx.context, &stream);
+            result != halide_error_code_success) {
+            return result;
+        }
+        if (auto result = get_memory_pool(user_context, ctx.context, true, &pool);
+            result != halide_error_code_success) {
+            return result;
+        }
+
+        debug(user_context) << "    cuMemAllocFromPoolAsync " << (uint64_t)size << " -> ";
+        CUresult err = cuMemAllocFromPoolAsync(&p, size, pool, stream);
+        if (err == CUDA_ERROR_OUT_OF_MEMORY) {
+            auto result = halide_cuda_release_unused_device_allocations(user_context);
+            if (result) {
+                return result;
+            }
+            err = cuMemAllocFromPoolAsync(&p, size, pool, stream);
+        }
+        if (err != CUDA_SUCCESS) {
+            return error_cuda(user_context, err, "cuMemAllocFromPoolAsync failed");
+        }
+        debug(user_context) << (void *)p << "\n";
+    }
+
     if (!p) {
         debug(user_context) << "    cuMemAlloc " << (uint64_t)size << " -> ";
 
@@ -893,7 +1959,7 @@ WEAK int halide_cuda_device_malloc(void *user_context, halide_buffer_t *buf) {
 namespace {
 WEAK int cuda_do_multidimensional_copy(void *user_context, const device_copy &c,
                                        uint64_t src, uint64_t dst, int d, bool from_host, bool to_host,
-                                       CUstream stream) {
+                                       CUcontext ctx, CUstream stream, bool host_is_pinned) {
     if (d > MAX_COPY_DIMS) {
         error(user_context) << "Buffer has too many dimensions to copy to/from GPU\n";
         return halide_error_code_bad_dimensions;
@@ -906,7 +1972,7 @@ WEAK int cuda_do_multidimensional_copy(void *user_context, const device_copy &c,
         if (!from_host && to_host) {
             debug(user_context) << "cuMemcpyDtoH(" << (void *)dst << ", " << (void *)src << ", " << c.chunk_size << ")\n";
             copy_name = "cuMemcpyDtoH";
-            if (stream) {
+            if (stream || host_is_pinned) {
                 err = cuMemcpyDtoHAsync((void *)dst, (CUdeviceptr)src, c.chunk_size, stream);
             } else {
                 err = cuMemcpyDtoH((void *)dst, (CUdeviceptr)src, c.chunk_size);
@@ -914,10 +1980,10 @@ WEAK int cuda_do_multidimensional_copy(void *user_context, const device_copy &c,
         } else if (from_host && !to_host) {
             debug(user_context) << "cuMemcpyHtoD(" << (void *)dst << ", " << (void *)src << ", " << c.chunk_size << ")\n";
             copy_name = "cuMemcpyHtoD";
-            if (stream) {
+            if (host_is_pinned) {
                 err = cuMemcpyHtoDAsync((CUdeviceptr)dst, (void *)src, c.chunk_size, stream);
             } else {
-                err = cuMemcpyHtoD((CUdeviceptr)dst, (void *)src, c.chunk_size);
+                err = staged_copy_to_device(user_context, ctx, (CUdeviceptr)dst, (const uint8_t *)src, c.chunk_size, stream);
             }
         } else if (!from_host && !to_host) {
             debug(user_context) << "cuMemcpyDtoD(" << (void *)dst << ", " << (void *)src << ", " << c.chunk_size << ")\n";
@@ -940,7 +2006,7 @@ WEAK int cuda_do_multidimensional_copy(void *user_context, const device_copy &c,
     } else {
         ssize_t src_off = 0, dst_off = 0;
         for (int i = 0; i < (int)c.extent[d - 1]; i++) {
-            auto result = cuda_do_multidimensional_copy(user_context, c, src + src_off, dst + dst_off, d - 1, from_host, to_host, stream);
+            auto result = cuda_do_multidimensional_copy(user_context, c, src + src_off, dst + dst_off, d - 1, from_host, to_host, ctx, stream, host_is_pinned);
             dst_off += c.dst_stride_bytes[d - 1];
             src_off += c.src_stride_bytes[d - 1];
             if (result) {
@@ -1010,11 +2076,36 @@ WEAK int halide_cuda_buffer_copy(void *user_context, struct halide_buffer_t *src
             }
         }
 
-        auto result = cuda_do_multidimensional_copy(user_context, c, c.src + c.src_begin, c.dst, dst->dimensions, from_host, to_host, stream);
+        if (auto result = flush_pending_launches(user_context);
+            result != halide_error_code_success) {
+            return result;
+        }
+        if (auto result = join_concurrent_streams(user_context, ctx.context);
+            result != halide_error_code_success) {
+            return result;
+        }
+
+        // Copies to and from pinned host memory are asynchronous; the
+        // host side of anything else is handled by the driver or the
+        // staging pool.
+        bool host_is_pinned = false;
+        if (from_host != to_host) {
+            host_is_pinned = is_pinned_host_memory(from_host ? (void *)(c.src + c.src_begin) : (void *)c.dst);
+        }
+
+        auto result = cuda_do_multidimensional_copy(user_context, c, c.src + c.src_begin, c.dst, dst->dimensions, from_host, to_host, ctx.context, stream, host_is_pinned);
         if (result) {
             return result;
         }
 
+        if (to_host && host_is_pinned) {
+            // The host data must be valid when we return.
+            CUresult err = stream ? cuStreamSynchronize(stream) : cuCtxSynchronize();
+            if (err != CUDA_SUCCESS) {
+                return error_cuda(user_context, err, "synchronizing after copy to pinned host memory failed");
+            }
+        }
+
 #ifdef DEBUG_RUNTIME
         uint64_t t_after = halide_current_time_ns(user_context);
         debug(user_context) << "    Time: " << (t_after - t_before) / 1.0e6 << " ms\n";
@@ -1090,6 +2181,15 @@ WEAK int halide_cuda_device_sync(void *user_context, struct halide_buffer_t *) {
     uint64_t t_before = halide_current_time_ns(user_context);
 #endif
 
+    if (auto result = flush_pending_launches(user_context);
+        result != halide_error_code_success) {
+        return result;
+    }
+    if (auto result = join_concurrent_streams(user_context, ctx.context);
+        result != halide_error_code_success) {
+        return result;
+    }
+
     CUresult err;
     if (cuStreamSynchronize != nullptr) {
         CUstream stream;
@@ -1192,6 +2292,54 @@ WEAK int halide_cuda_run(void *user_context,
         }
     }
 
+    if (concurrent_streams > 1 && !graph_replay_enabled) {
+        CUdeviceptr *ptrs = (CUdeviceptr *)malloc((2 * num_args + 1) * sizeof(CUdeviceptr));
+        if (!ptrs) {
+            free(dev_handles);
+            free(translated_args);
+            return halide_error_code_out_of_memory;
+        }
+        CUdeviceptr *bases = ptrs + num_args;
+        for (size_t i = 0; i < num_args; i++) {
+            ptrs[i] = arg_is_buffer[i] ? (CUdeviceptr)dev_handles[i] : 0;
+        }
+
+        ScopedMutexLock lock(&stream_set_lock);
+        StreamSet *set = nullptr;
+        int chosen = 0;
+        auto result = begin_concurrent_launch(user_context, ctx.context, stream, ptrs, bases, num_args, &set, &chosen);
+        if (result == halide_error_code_success) {
+            err = cuLaunchKernel(f,
+                                 blocksX, blocksY, blocksZ,
+                                 threadsX, threadsY, threadsZ,
+                                 shared_mem_bytes,
+                                 set->streams[chosen],
+                                 translated_args,
+                                 nullptr);
+            result = error_cuda(user_context, err, "cuLaunchKernel failed");
+        }
+        if (result == halide_error_code_success) {
+            result = finish_concurrent_launch(user_context, set, chosen, bases, num_args);
+        }
+        free(ptrs);
+        free(dev_handles);
+        free(translated_args);
+        return result;
+    }
+
+    if (graph_replay_enabled) {
+        const unsigned int dims[6] = {(unsigned int)blocksX, (unsigned int)blocksY, (unsigned int)blocksZ,
+                                      (unsigned int)threadsX, (unsigned int)threadsY, (unsigned int)threadsZ};
+        bool deferred = false;
+        auto result = defer_launch(user_context, ctx.context, stream, f, dims, shared_mem_bytes,
+                                   num_args, arg_sizes, translated_args, &deferred);
+        if (result != halide_error_code_success || deferred) {
+            free(dev_handles);
+            free(translated_args);
+            return result;
+        }
+    }
+
     err = cuLaunchKernel(f,
                          blocksX, blocksY, blocksZ,
                          threadsX, threadsY, threadsZ,
@@ -1216,6 +2364,74 @@ WEAK int halide_cuda_run(void *user_context,
     return halide_error_code_success;
 }
 
+WEAK void *halide_cuda_kernel_timer_start(void *user_context) {
+    Context ctx(user_context);
+    if (ctx.error()) {
+        return nullptr;
+    }
+
+    // Time on the stream that halide_cuda_run uses. Kernels run on
+    // other concurrent streams wait for work already on it.
+    CUstream stream = nullptr;
+    if (cuStreamSynchronize != nullptr &&
+        halide_cuda_get_stream(user_context, ctx.context, &stream) != halide_error_code_success) {
+        return nullptr;
+    }
+
+    CUevent *events = (CUevent *)malloc(2 * sizeof(CUevent));
+    if (!events) {
+        return nullptr;
+    }
+    if (cuEventCreate(&events[0], 0) != CUDA_SUCCESS) {
+        free(events);
+        return nullptr;
+    }
+    if (cuEventCreate(&events[1], 0) != CUDA_SUCCESS) {
+        cuEventDestroy(events[0]);
+        free(events);
+        return nullptr;
+    }
+    if (cuEventRecord(events[0], stream) != CUDA_SUCCESS) {
+        cuEventDestroy(events[0]);
+        cuEventDestroy(events[1]);
+        free(events);
+        return nullptr;
+    }
+    return events;
+}
+
+WEAK uint64_t halide_cuda_kernel_timer_end(void *user_context, void *timer) {
+    if (!timer) {
+        return 0;
+    }
+    Context ctx(user_context);
+    if (ctx.error()) {
+        // The events can't be destroyed without the context.
+        return 0;
+    }
+
+    // Kernels may be deferred to a graph or run on other streams, so
+    // launch and join them before recording the end.
+    CUevent *events = (CUevent *)timer;
+    uint64_t elapsed_ns = 0;
+    CUstream stream = nullptr;
+    if (flush_pending_launches(user_context) == halide_error_code_success &&
+        join_concurrent_streams(user_context, ctx.context) == halide_error_code_success &&
+        (cuStreamSynchronize == nullptr ||
+         halide_cuda_get_stream(user_context, ctx.context, &stream) == halide_error_code_success) &&
+        cuEventRecord(events[1], stream) == CUDA_SUCCESS &&
+        cuEventSynchronize(events[1]) == CUDA_SUCCESS) {
+        float ms = 0;
+        if (cuEventElapsedTime(&ms, events[0], events[1]) == CUDA_SUCCESS && ms > 0) {
+            elapsed_ns = (uint64_t)(ms * 1e6f);
+        }
+    }
+    cuEventDestroy(events[0]);
+    cuEventDestroy(events[1]);
+    free(events);
+    return elapsed_ns;
+}
+
 WEAK int halide_cuda_device_and_host_malloc(void *user_context, struct halide_buffer_t *buf) {
     return halide_default_device_and_host_malloc(user_context, buf, &cuda_device_interface);
 }
@@ -1264,6 +2480,164 @@ WEAK uintptr_t halide_cuda_get_device_ptr(void *user_context, struct halide_buff
     return (uintptr_t)buf->device;
 }
 
+WEAK void *halide_cuda_host_malloc(void *user_context, size_t size) {
+    debug(user_context)
+        << "CUDA: halide_cuda_host_malloc (user_context: " << user_context
+        << ", size: " << (uint64_t)size << ")\n";
+
+    Context ctx(user_context);
+    if (ctx.error()) {
+        return nullptr;
+    }
+
+    void *p = nullptr;
+    CUresult err = cuMemHostAlloc(&p, size, CU_MEMHOSTALLOC_PORTABLE);
+    if (err != CUDA_SUCCESS) {
+        error_cuda(user_context, err, "cuMemHostAlloc failed");
+        return nullptr;
+    }
+    debug(user_context) << "    cuMemHostAlloc -> " << p << "\n";
+    return p;
+}
+
+WEAK void halide_cuda_host_free(void *user_context, void *ptr) {
+    debug(user_context)
+        << "CUDA: halide_cuda_host_free (user_context: " << user_context
+        << ", ptr: " << ptr << ")\n";
+
+    if (ptr == nullptr) {
+        return;
+    }
+    Context ctx(user_context);
+    if (ctx.error() == halide_error_code_success) {
+        cuMemFreeHost(ptr);
+    }
+}
+
+WEAK int halide_cuda_set_stream_ordered_allocation(void *user_context, bool enabled) {
+    debug(user_context)
+        << "CUDA: halide_cuda_set_stream_ordered_allocation (user_context: " << user_context
+        << ", enabled: " << enabled << ")\n";
+
+    Context ctx(user_context);
+    if (ctx.error()) {
+        return ctx.error();
+    }
+
+    if (enabled && !stream_ordered_allocation_supported()) {
+        error(user_context) << "CUDA: halide_cuda_set_stream_ordered_allocation: "
+                            << "the CUDA driver does not support memory pools\n";
+        return halide_error_code_generic_error;
+    }
+    stream_ordered_allocation = enabled;
+    return halide_error_code_success;
+}
+
+WEAK int halide_cuda_trim_device_memory_pool(void *user_context, size_t bytes_to_keep) {
+    debug(user_context)
+        << "CUDA: halide_cuda_trim_device_memory_pool (user_context: " << user_context
+        << ", bytes_to_keep: " << (uint64_t)bytes_to_keep << ")\n";
+
+    Context ctx(user_context);
+    if (ctx.error()) {
+        return ctx.error();
+    }
+
+    CUmemoryPool pool;
+    if (auto result = get_memory_pool(user_context, ctx.context, false, &pool);
+        result != halide_error_code_success || pool == nullptr) {
+        return result;
+    }
+    return error_cuda(user_context, cuMemPoolTrimTo(pool, bytes_to_keep), "cuMemPoolTrimTo failed");
+}
+
+WEAK int halide_cuda_get_device_memory_pool_stats(void *user_context,
+                                                  uint64_t *reserved, uint64_t *reserved_high,
+                                                  uint64_t *used, uint64_t *used_high) {
+    *reserved = *reserved_high = *used = *used_high = 0;
+
+    Context ctx(user_context);
+    if (ctx.error()) {
+        return ctx.error();
+    }
+
+    CUmemoryPool pool;
+    if (auto result = get_memory_pool(user_context, ctx.context, false, &pool);
+        result != halide_error_code_success || pool == nullptr) {
+        return result;
+    }
+
+    const CUmemPool_attribute attrs[] = {CU_MEMPOOL_ATTR_RESERVED_MEM_CURRENT,
+                                         CU_MEMPOOL_ATTR_RESERVED_MEM_HIGH,
+                                         CU_MEMPOOL_ATTR_USED_MEM_CURRENT,
+                                         CU_MEMPOOL_ATTR_USED_MEM_HIGH};
+    uint64_t *values[] = {reserved, reserved_high, used, used_high};
+    for (int i = 0; i < 4; i++) {
+        CUresult err = cuMemPoolGetAttribute(pool, attrs[i], values[i]);
+        if (err != CUDA_SUCCESS) {
+            return error_cuda(user_context, err, "cuMemPoolGetAttribute failed");
+        }
+    }
+    return halide_error_code_success;
+}
+
+WEAK int halide_cuda_set_concurrent_streams(void *user_context, int num_streams) {
+    debug(user_context)
+        << "CUDA: halide_cuda_set_concurrent_streams (user_context: " << user_context
+        << ", num_streams: " << num_streams << ")\n";
+
+    Context ctx(user_context);
+    if (ctx.error()) {
+        return ctx.error();
+    }
+
+    if (num_streams > 1 && !concurrent_streams_supported()) {
+        error(user_context) << "CUDA: halide_cuda_set_concurrent_streams: "
+                            << "the CUDA driver does not support stream events\n";
+        return halide_error_code_generic_error;
+    }
+    if (num_streams < 1) {
+        num_streams = 1;
+    } else if (num_streams > max_concurrent_streams) {
+        num_streams = max_concurrent_streams;
+    }
+
+    auto result = join_concurrent_streams(user_context, ctx.context);
+    ScopedMutexLock lock(&stream_set_lock);
+    concurrent_streams = num_streams;
+    for (StreamSet *set = stream_sets; set; set = set->next_set) {
+        set->next = 0;
+    }
+    return result;
+}
+
+WEAK int halide_cuda_set_graph_replay(void *user_context, bool enabled) {
+    debug(user_context)
+        << "CUDA: halide_cuda_set_graph_replay (user_context: " << user_context
+        << ", enabled: " << enabled << ")\n";
+
+    Context ctx(user_context);
+    if (ctx.error()) {
+        return ctx.error();
+    }
+
+    if (enabled && !graphs_supported()) {
+        error(user_context) << "CUDA: halide_cuda_set_graph_replay: the CUDA driver does not support graphs\n";
+        return halide_error_code_generic_error;
+    }
+
+    ScopedMutexLock lock(&graph_lock);
+    graph_replay_enabled = enabled;
+    return flush_pending_launches_locked(user_context);
+}
+
+WEAK int halide_cuda_get_graph_replay_stats(void *user_context, uint64_t *captures, uint64_t *replays) {
+    ScopedMutexLock lock(&graph_lock);
+    *captures = graph_captures;
+    *replays = graph_replays;
+    return halide_error_code_success;
+}
+
 WEAK const halide_device_interface_t *halide_cuda_device_interface() {
     return &cuda_device_interface;
 }
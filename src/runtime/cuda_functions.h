@@ -26,7 +26,11 @@ CUDA_FN_3020(CUresult, cuCtxCreate, cuCtxCreate_v2, (CUcontext * pctx, unsigned
 CUDA_FN_4000(CUresult, cuCtxDestroy, cuCtxDestroy_v2, (CUcontext pctx));
 CUDA_FN(CUresult, cuProfilerStop, ());
 CUDA_FN(CUresult, cuCtxGetApiVersion, (CUcontext ctx, unsigned int *version));
+CUDA_FN_OPTIONAL(CUresult, cuDevicePrimaryCtxRetain, (CUcontext * pctx, CUdevice dev));
+CUDA_FN_OPTIONAL(CUresult, cuDevicePrimaryCtxRelease_v2, (CUdevice dev));
 CUDA_FN(CUresult, cuCtxGetDevice, (CUdevice *));
+// Only used for the contexts of the other devices selected by Func::distribute.
+CUDA_FN_OPTIONAL(CUresult, cuCtxEnablePeerAccess, (CUcontext peerContext, unsigned int Flags));
 CUDA_FN(CUresult, cuModuleLoadData, (CUmodule * module, const void *image));
 CUDA_FN(CUresult, cuModuleLoadDataEx, (CUmodule * module, const void *image, unsigned int numOptions, CUjit_option *options, void **optionValues));
 CUDA_FN(CUresult, cuModuleUnload, (CUmodule module));
@@ -50,8 +54,42 @@ CUDA_FN_4000(CUresult, cuCtxPopCurrent, cuCtxPopCurrent_v2, (CUcontext * pctx));
 
 CUDA_FN(CUresult, cuPointerGetAttribute, (void *result, int query, CUdeviceptr ptr));
 
+CUDA_FN(CUresult, cuMemHostAlloc, (void **pp, size_t bytesize, unsigned int Flags));
+CUDA_FN(CUresult, cuMemFreeHost, (void *p));
+CUDA_FN(CUresult, cuMemHostGetFlags, (unsigned int *pFlags, void *p));
+
+CUDA_FN(CUresult, cuEventCreate, (CUevent * phEvent, unsigned int Flags));
+CUDA_FN_4000(CUresult, cuEventDestroy, cuEventDestroy_v2, (CUevent hEvent));
+CUDA_FN(CUresult, cuEventRecord, (CUevent hEvent, CUstream hStream));
+CUDA_FN(CUresult, cuEventQuery, (CUevent hEvent));
+CUDA_FN(CUresult, cuEventSynchronize, (CUevent hEvent));
+CUDA_FN(CUresult, cuEventElapsedTime, (float *pMilliseconds, CUevent hStart, CUevent hEnd));
+
 CUDA_FN_OPTIONAL(CUresult, cuStreamSynchronize, (CUstream hStream));
 
+// Only used for CUDA graph replay (see halide_cuda_set_graph_replay).
+CUDA_FN_OPTIONAL(CUresult, cuStreamCreate, (CUstream * phStream, unsigned int Flags));
+CUDA_FN_OPTIONAL(CUresult, cuStreamDestroy_v2, (CUstream hStream));
+CUDA_FN_OPTIONAL(CUresult, cuStreamBeginCapture_v2, (CUstream hStream, CUstreamCaptureMode mode));
+CUDA_FN_OPTIONAL(CUresult, cuStreamEndCapture, (CUstream hStream, CUgraph *phGraph));
+CUDA_FN_OPTIONAL(CUresult, cuGraphInstantiateWithFlags, (CUgraphExec * phGraphExec, CUgraph hGraph, unsigned long long flags));
+CUDA_FN_OPTIONAL(CUresult, cuGraphLaunch, (CUgraphExec hGraphExec, CUstream hStream));
+CUDA_FN_OPTIONAL(CUresult, cuGraphExecDestroy, (CUgraphExec hGraphExec));
+CUDA_FN_OPTIONAL(CUresult, cuGraphDestroy, (CUgraph hGraph));
+
+// Only used for stream-ordered allocation (see halide_cuda_set_stream_ordered_allocation).
+CUDA_FN_OPTIONAL(CUresult, cuMemPoolCreate, (CUmemoryPool * pool, const CUmemPoolProps *poolProps));
+CUDA_FN_OPTIONAL(CUresult, cuMemPoolDestroy, (CUmemoryPool pool));
+CUDA_FN_OPTIONAL(CUresult, cuMemPoolSetAttribute, (CUmemoryPool pool, CUmemPool_attribute attr, void *value));
+CUDA_FN_OPTIONAL(CUresult, cuMemPoolGetAttribute, (CUmemoryPool pool, CUmemPool_attribute attr, void *value));
+CUDA_FN_OPTIONAL(CUresult, cuMemPoolTrimTo, (CUmemoryPool pool, size_t minBytesToKeep));
+CUDA_FN_OPTIONAL(CUresult, cuMemAllocFromPoolAsync, (CUdeviceptr * dptr, size_t bytesize, CUmemoryPool pool, CUstream hStream));
+CUDA_FN_OPTIONAL(CUresult, cuMemFreeAsync, (CUdeviceptr dptr, CUstream hStream));
+
+// Only used for concurrent streams (see halide_cuda_set_concurrent_streams).
+CUDA_FN_OPTIONAL(CUresult, cuStreamWaitEvent, (CUstream hStream, CUevent hEvent, unsigned int Flags));
+CUDA_FN_OPTIONAL(CUresult, cuMemGetAddressRange_v2, (CUdeviceptr * pbase, size_t *psize, CUdeviceptr dptr));
+
 #undef CUDA_FN
 #undef CUDA_FN_OPTIONAL
 #undef CUDA_FN_3020
@@ -278,6 +278,7 @@ D3D12TYPENAME(ID3D12Resource)
 D3D12TYPENAME(ID3D12PipelineState)
 D3D12TYPENAME(ID3D12RootSignature)
 D3D12TYPENAME(ID3D12DescriptorHeap)
+D3D12TYPENAME(ID3D12Heap)
 D3D12TYPENAME(ID3D12Fence)
 D3D12TYPENAME(ID3D12QueryHeap)
 // d3dcommon.h
@@ -475,6 +476,7 @@ UUIDOF(ID3D12Resource)
 UUIDOF(ID3D12PipelineState)
 UUIDOF(ID3D12RootSignature)
 UUIDOF(ID3D12DescriptorHeap)
+UUIDOF(ID3D12Heap)
 UUIDOF(ID3D12Fence)
 UUIDOF(ID3D12QueryHeap)
 
@@ -564,6 +566,11 @@ struct d3d12_buffer {
 
     uint64_t signal;
 
+    // if the resource is placed in one of the pooled device heaps:
+    struct d3d12_heap *heap;
+    UINT heap_page;
+    UINT heap_pages;
+
     operator bool() const {
         return resource != nullptr;
     }
@@ -667,6 +674,7 @@ WEAK volatile uint64_t queue_last_signal /*__attribute__((aligned(8)))*/ = 0;
 WEAK ID3D12RootSignature *rootSignature = nullptr;
 WEAK d3d12_buffer upload = {};    // staging buffer to transfer data to the device
 WEAK d3d12_buffer readback = {};  // staging buffer to retrieve data from the device
+WEAK size_t upload_cursor = 0;    // where the next upload goes in the 'upload' staging buffer
 
 WEAK HANDLE hFenceEvent = nullptr;
 
@@ -692,6 +700,7 @@ WEAK d3d12_frame frame_pool[MaxFrames] = {};
 WEAK uint64_t frame_selector = 0;
 
 WEAK void wait_until_completed(d3d12_compute_command_list *cmdList);
+WEAK void wait_until_signaled(uint64_t signal);
 WEAK d3d12_command_list *new_compute_command_list(d3d12_device *device, d3d12_command_allocator *allocator);
 WEAK d3d12_binder *new_descriptor_binder(d3d12_device *device);
 WEAK void commit_command_list(d3d12_compute_command_list *cmdList);
@@ -812,10 +821,22 @@ WEAK void release_d3d12_object<d3d12_binder>(d3d12_binder *binder) {
     d3d12_free(binder);
 }
 
+WEAK void release_heap_pages(d3d12_buffer *buffer);
+
 template<>
 WEAK void release_d3d12_object<d3d12_buffer>(d3d12_buffer *buffer) {
     TRACELOG;
-    Release_ID3D12Object(buffer->resource);
+    if (buffer->heap != nullptr) {
+        // crops share the placed resource (and its heap pages) with the buffer
+        // they were made from, so only give the pages back to the heap once the
+        // last reference to the resource is gone:
+        TRACEPRINT(d3d12typename(buffer->resource) << " @ " << buffer->resource << "\n");
+        if (buffer->resource->Release() == 0) {
+            release_heap_pages(buffer);
+        }
+    } else {
+        Release_ID3D12Object(buffer->resource);
+    }
     if (buffer->host_mirror != nullptr) {
         d3d12_free(buffer->host_mirror);
     }
@@ -1265,7 +1286,8 @@ WEAK void dispatch_threadgroups(d3d12_compute_command_list *cmdList,
     (*cmdList)->Dispatch(blocks_x, blocks_y, blocks_z);
 }
 
-WEAK d3d12_buffer new_buffer_resource(d3d12_device *device, size_t length, D3D12_HEAP_TYPE heaptype) {
+WEAK d3d12_buffer new_buffer_resource(d3d12_device *device, size_t length, D3D12_HEAP_TYPE heaptype,
+                                      ID3D12Heap *heap = nullptr, UINT64 heap_offset = 0) {
     TRACELOG;
 
     D3D12_RESOURCE_DESC desc = {};
@@ -1319,8 +1341,14 @@ WEAK d3d12_buffer new_buffer_resource(d3d12_device *device, size_t length, D3D12
 
     d3d12_buffer buffer = {};
     ID3D12Resource *resource = nullptr;
-    // A commited resource manages its own private heap:
-    HRESULT result = (*device)->CreateCommittedResource(pHeapProperties, HeapFlags, pDesc, InitialResourceState, pOptimizedClearValue, IID_PPV_ARGS(&resource));
+    HRESULT result = S_OK;
+    if (heap != nullptr) {
+        // A placed resource lives at the given offset of an existing heap:
+        result = (*device)->CreatePlacedResource(heap, heap_offset, pDesc, InitialResourceState, pOptimizedClearValue, IID_PPV_ARGS(&resource));
+    } else {
+        // A commited resource manages its own private heap:
+        result = (*device)->CreateCommittedResource(pHeapProperties, HeapFlags, pDesc, InitialResourceState, pOptimizedClearValue, IID_PPV_ARGS(&resource));
+    }
     if (D3DErrorCheck(result, resource, nullptr, "Unable to create the Direct3D 12 buffer")) {
         return buffer;
     }
@@ -1339,12 +1367,137 @@ WEAK d3d12_buffer new_buffer_resource(d3d12_device *device, size_t length, D3D12
     return buffer;
 }
 
+// Creating a committed resource also creates an implicit heap for it, which is
+// expensive (and, for small buffers, wasteful); instead, device buffers are
+// placed in a pool of large heaps, and only buffers that are too large for them
+// get committed resources. Each heap is split in pages of 64KB, the mandatory
+// placement alignment of buffers, and each buffer takes a contiguous run of them.
+static constexpr UINT64 HeapPageSize = 64 * 1024;
+static constexpr UINT HeapPages = 1024;  // 64MB heaps
+static constexpr UINT MaxPagesPerPlacedBuffer = HeapPages / 4;
+static constexpr int MaxHeaps = 16;
+
+struct d3d12_heap {
+    ID3D12Heap *heap;
+    uint64_t used_pages[HeapPages / 64];
+};
+
+WEAK d3d12_heap heap_pool[MaxHeaps] = {};
+WEAK halide_mutex heap_pool_lock;
+
+WEAK void mark_heap_pages(d3d12_heap *heap, UINT first, UINT count, bool used) {
+    for (UINT page = first; page < first + count; page++) {
+        uint64_t bit = (uint64_t)1 << (page % 64);
+        if (used) {
+            heap->used_pages[page / 64] |= bit;
+        } else {
+            heap->used_pages[page / 64] &= ~bit;
+        }
+    }
+}
+
+// first-fit search for a run of 'count' free pages in the heap:
+WEAK bool find_free_heap_pages(const d3d12_heap *heap, UINT count, UINT *first) {
+    UINT run = 0;
+    for (UINT page = 0; page < HeapPages; page++) {
+        bool used = (heap->used_pages[page / 64] >> (page % 64)) & 1;
+        run = used ? 0 : (run + 1);
+        if (run == count) {
+            *first = page + 1 - count;
+            return true;
+        }
+    }
+    return false;
+}
+
+WEAK ID3D12Heap *new_device_heap(d3d12_device *device) {
+    TRACELOG;
+
+    D3D12_HEAP_DESC desc = {};
+    {
+        desc.SizeInBytes = HeapPageSize * HeapPages;
+        desc.Properties.Type = D3D12_HEAP_TYPE_DEFAULT;
+        desc.Properties.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
+        desc.Properties.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
+        desc.Properties.CreationNodeMask = 0;
+        desc.Properties.VisibleNodeMask = 0;
+        desc.Alignment = HeapPageSize;
+        desc.Flags = D3D12_HEAP_FLAG_ALLOW_ONLY_BUFFERS;
+    }
+
+    ID3D12Heap *heap = nullptr;
+    HRESULT result = (*device)->CreateHeap(&desc, IID_PPV_ARGS(&heap));
+    if (D3DErrorCheck(result, heap, nullptr, "Unable to create Direct3D 12 heap")) {
+        return nullptr;
+    }
+    return heap;
+}
+
+WEAK d3d12_buffer new_placed_device_buffer(d3d12_device *device, size_t length) {
+    TRACELOG;
+
+    d3d12_buffer buffer = {};
+
+    UINT num_pages = (UINT)((length + HeapPageSize - 1) / HeapPageSize);
+    if (num_pages > MaxPagesPerPlacedBuffer) {
+        TRACEPRINT("buffer is too large to be placed in the heap pool.\n");
+        return buffer;
+    }
+
+    ScopedMutexLock lock(&heap_pool_lock);
+
+    for (auto &heap : heap_pool) {
+        if (heap.heap == nullptr) {
+            heap.heap = new_device_heap(device);
+            if (heap.heap == nullptr) {
+                break;
+            }
+            memset(heap.used_pages, 0, sizeof(heap.used_pages));
+        }
+        UINT first_page = 0;
+        if (!find_free_heap_pages(&heap, num_pages, &first_page)) {
+            continue;
+        }
+        buffer = new_buffer_resource(device, length, D3D12_HEAP_TYPE_DEFAULT,
+                                     heap.heap, first_page * HeapPageSize);
+        if (buffer) {
+            TRACEPRINT("placed " << (uintptr_t)length << " bytes at page " << first_page << " of heap " << heap.heap << "\n");
+            mark_heap_pages(&heap, first_page, num_pages, true);
+            buffer.heap = &heap;
+            buffer.heap_page = first_page;
+            buffer.heap_pages = num_pages;
+        }
+        break;
+    }
+
+    return buffer;
+}
+
+WEAK void release_heap_pages(d3d12_buffer *buffer) {
+    TRACELOG;
+    ScopedMutexLock lock(&heap_pool_lock);
+    mark_heap_pages(buffer->heap, buffer->heap_page, buffer->heap_pages, false);
+    buffer->heap = nullptr;
+}
+
+WEAK void release_heap_pool() {
+    TRACELOG;
+    ScopedMutexLock lock(&heap_pool_lock);
+    for (auto &heap : heap_pool) {
+        Release_ID3D12Object(heap.heap);
+        heap.heap = nullptr;
+    }
+}
+
 WEAK d3d12_buffer new_device_buffer(d3d12_device *device, size_t length) {
     TRACELOG;
     // an upload heap would have been handy here since they are accessible both by CPU and GPU;
     // however, they are only good for streaming (write once, read once, discard, rinse and repeat) vertex and constant buffer data; for unordered-access views,
     // upload heaps are not allowed.
-    d3d12_buffer buffer = new_buffer_resource(device, length, D3D12_HEAP_TYPE_DEFAULT);
+    d3d12_buffer buffer = new_placed_device_buffer(device, length);
+    if (!buffer) {
+        buffer = new_buffer_resource(device, length, D3D12_HEAP_TYPE_DEFAULT);
+    }
     buffer.type = d3d12_buffer::ReadWrite;
     return buffer;
 }
@@ -1485,7 +1638,8 @@ WEAK size_t suballocate(d3d12_device *device, d3d12_buffer *staging, size_t num_
         size_t old_capacity = staging->sizeInBytes;
         size_t new_capacity = 2 * (old_capacity + num_bytes);
         TRACEPRINT("not enough storage: growing from " << (uintptr_t)old_capacity << " bytes to " << (uintptr_t)new_capacity << " bytes.\n");
-        // release the old storage
+        // release the old storage (once the device is done with it)
+        wait_until_signaled(staging->signal);
         use_count = __atomic_sub_fetch(&staging->ref_count, 1, __ATOMIC_SEQ_CST);
         halide_abort_if_false(user_context, (use_count == 0));
         release_d3d12_object(staging);
@@ -1494,6 +1648,7 @@ WEAK size_t suballocate(d3d12_device *device, d3d12_buffer *staging, size_t num_
         case d3d12_buffer::Upload:
             halide_abort_if_false(user_context, (staging == &upload));
             *staging = new_upload_buffer(device, new_capacity);
+            upload_cursor = 0;
             break;
         case d3d12_buffer::ReadBack:
             halide_abort_if_false(user_context, (staging == &readback));
@@ -1511,7 +1666,21 @@ WEAK size_t suballocate(d3d12_device *device, d3d12_buffer *staging, size_t num_
     uint64_t use_count = __atomic_add_fetch(&staging->ref_count, 1, __ATOMIC_SEQ_CST);
     // but for now we must ensure that there are no pending transfers on this buffer already
     halide_abort_if_false(user_context, (use_count == 1));
-    size_t byte_offset = 0;  // always zero, for now
+    size_t byte_offset = 0;
+    if (staging->type == d3d12_buffer::Upload) {
+        // uploads don't wait for the device to consume the staging memory: they
+        // are laid out one after the other, using the staging buffer as a ring,
+        // and the host only waits for the device when wrapping around to memory
+        // that earlier uploads may still be reading from
+        if (upload_cursor + num_bytes > staging->sizeInBytes) {
+            TRACEPRINT("upload staging buffer wrapped around: waiting on signal #" << staging->signal << "\n");
+            wait_until_signaled(staging->signal);
+            upload_cursor = 0;
+        }
+        byte_offset = upload_cursor;
+        // keep uploads aligned to 256 bytes, like constant buffers
+        upload_cursor = (upload_cursor + num_bytes + 255) & ~255;
+    }
     return byte_offset;
 }
 
@@ -2278,7 +2447,16 @@ WEAK void d3d12compute_device_sync_internal(d3d12_device *device, d3d12_buffer *
         d3d12_compute_command_list *blitCmdList = frame->cmd_list;
         synchronize_host_and_device_buffer_contents(blitCmdList, dev_buffer);
         enqueue_frame(frame);
-        wait_until_completed(frame);
+        d3d12_buffer *staging_buffer = dev_buffer->xfer->staging;
+        if (staging_buffer->type == d3d12_buffer::Upload) {
+            // no need to wait for uploads: the queue executes them in order with
+            // any later work on the buffer, and the fence signal tracks when the
+            // staging memory can be reused (see 'suballocate()')
+            staging_buffer->signal = frame->fence_signal;
+            dev_buffer->signal = frame->fence_signal;
+        } else {
+            wait_until_completed(frame);
+        }
     }
 
     if (dev_buffer->xfer != nullptr) {
@@ -2823,6 +3001,8 @@ WEAK int halide_d3d12compute_device_release(void *user_context) {
 
         // Release the device itself, if we created it.
         if (acquired_device == device) {
+            release_heap_pool();
+            upload_cursor = 0;
             release_object(&upload);
             release_object(&readback);
             d3d12_buffer empty = {};
@@ -3391,6 +3571,11 @@ WEAK int d3d12compute_device_crop_from_offset(void *user_context,
     // for some reason, 'dst->number_of_elements()' is always returning 1
     // later on when 'set_input()' is called...
     new_handle->elements = old_handle->elements - offset;
+    // the crop holds a reference to the (placed) resource, so it also needs to
+    // be able to give its heap pages back when it is the last one to let go:
+    new_handle->heap = old_handle->heap;
+    new_handle->heap_page = old_handle->heap_page;
+    new_handle->heap_pages = old_handle->heap_pages;
 
     TRACEPRINT(
         "--- "
@@ -0,0 +1,21 @@
+#include "HalideRuntime.h"
+#include "printer.h"
+
+// For platforms where we don't know how to ask for huge pages, the
+// huge page allocator is the default one.
+
+extern "C" {
+
+WEAK void *halide_huge_page_malloc(void *user_context, size_t x) {
+    return halide_default_malloc(user_context, x);
+}
+
+WEAK void halide_huge_page_free(void *user_context, void *ptr) {
+    halide_default_free(user_context, ptr);
+}
+
+WEAK int halide_use_huge_page_allocator(size_t min_bytes, bool explicit_huge_pages) {
+    error(nullptr) << "halide_use_huge_page_allocator: Huge pages are not supported on this platform.";
+    return halide_error_code_unimplemented;
+}
+}
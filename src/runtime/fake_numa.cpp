@@ -0,0 +1,24 @@
+#include "HalideRuntime.h"
+#include "printer.h"
+
+// For platforms where we don't know how to query the NUMA topology,
+// treat the host as a single node.
+
+extern "C" {
+
+WEAK int halide_host_numa_node_count() {
+    return 1;
+}
+
+WEAK int halide_current_numa_node() {
+    return 0;
+}
+
+WEAK int halide_pin_current_thread_to_numa_node(int node) {
+    if (node != 0) {
+        error(nullptr) << "halide_pin_current_thread_to_numa_node: NUMA pinning is not supported on this platform.";
+        return halide_error_code_unimplemented;
+    }
+    return halide_error_code_success;
+}
+}
@@ -0,0 +1,16 @@
+#include "HalideRuntime.h"
+#include "runtime_internal.h"
+
+// For platforms where we don't know how to read the hardware performance
+// counters, there aren't any.
+
+extern "C" {
+
+WEAK int halide_open_perf_counters() {
+    return -1;
+}
+
+WEAK bool halide_read_perf_counters(int handle, uint64_t *counts) {
+    return false;
+}
+}
@@ -122,6 +122,38 @@ WEAK int halide_set_num_threads(int n) {
     return 1;
 }
 
+WEAK int halide_get_num_threads() {
+    return 1;
+}
+
+WEAK bool halide_set_thread_pool_work_stealing(bool enable) {
+    return false;
+}
+
+WEAK bool halide_set_thread_pool_numa_aware(bool enable) {
+    return false;
+}
+
+WEAK halide_thread_pool_spin_t halide_set_thread_pool_spin_policy(halide_thread_pool_spin_t policy, int spin_us) {
+    return halide_thread_pool_spin_default;
+}
+
+WEAK halide_thread_pool_chunking_t halide_set_thread_pool_chunking(halide_thread_pool_chunking_t chunking) {
+    return halide_thread_pool_chunking_static;
+}
+
+WEAK halide_thread_pool_creation_t halide_set_thread_pool_creation_policy(halide_thread_pool_creation_t policy) {
+    return halide_thread_pool_create_eager;
+}
+
+WEAK int halide_thread_pool_prewarm(void *user_context) {
+    return halide_error_code_success;
+}
+
+WEAK int halide_set_thread_pool_qos(void *user_context, int max_threads, int priority) {
+    return halide_error_code_success;
+}
+
 WEAK halide_do_task_t halide_set_custom_do_task(halide_do_task_t f) {
     halide_do_task_t result = custom_do_task;
     custom_do_task = f;
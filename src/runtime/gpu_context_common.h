@@ -3,6 +3,7 @@
 
 #include "HalideRuntime.h"
 #include "printer.h"
+#include "runtime_atomics.h"
 #include "scoped_mutex_lock.h"
 
 namespace Halide {
@@ -17,13 +18,25 @@ class GPUCompilationCache {
         uintptr_t use_count{0};
     };
 
+    // Held for everything except lookup. lookup reads the table without
+    // it, seqlock style: writers make table_version odd while they
+    // modify the table, and a lookup that saw an odd version, or a
+    // version that changed while it was probing, tries again. Tables
+    // replaced by a resize stay allocated (in retired_tables) until
+    // release_all, so a lookup racing with a resize never reads freed
+    // memory. Tables only grow, so this at most doubles their footprint.
     halide_mutex mutex;
+    uintptr_t table_version{0};
 
     static constexpr float kLoadFactor{.5f};
     static constexpr int kInitialTableBits{7};
-    int log2_compilations_size{0};  // number of bits in index into compilations table.
+    // Number of bits in index into compilations table. Written after
+    // compilations when the table grows, so a lookup that reads this
+    // first never indexes past the end of the table it then reads.
+    int log2_compilations_size{0};
     CachedCompilation *compilations{nullptr};
     int count{0};
+    CachedCompilation *retired_tables[sizeof(uintptr_t) * 8]{};
 
     static constexpr uintptr_t kInvalidId{0};
     static constexpr uintptr_t kDeletedId{1};
@@ -41,6 +54,17 @@ class GPUCompilationCache {
         }
     }
 
+    ALWAYS_INLINE void begin_write() {
+        uintptr_t v = table_version + 1;
+        Halide::Runtime::Internal::Synchronization::atomic_store_relaxed(&table_version, &v);
+        Halide::Runtime::Internal::Synchronization::atomic_thread_fence_sequentially_consistent();
+    }
+
+    ALWAYS_INLINE void end_write() {
+        uintptr_t v = table_version + 1;
+        Halide::Runtime::Internal::Synchronization::atomic_store_release(&table_version, &v);
+    }
+
     HALIDE_MUST_USE_RESULT bool insert(const CachedCompilation &entry) {
         if (log2_compilations_size == 0) {
             if (!resize_table(kInitialTableBits)) {
@@ -94,7 +118,8 @@ class GPUCompilationCache {
     HALIDE_MUST_USE_RESULT bool resize_table(int size_bits) {
         if (size_bits != log2_compilations_size) {
             int new_size = (1 << size_bits);
-            int old_size = (1 << log2_compilations_size);
+            int old_size_bits = log2_compilations_size;
+            int old_size = (1 << old_size_bits);
             CachedCompilation *new_table = (CachedCompilation *)malloc(new_size * sizeof(CachedCompilation));
             if (new_table == nullptr) {
                 // signal error.
@@ -103,7 +128,7 @@ class GPUCompilationCache {
             memset(new_table, 0, new_size * sizeof(CachedCompilation));
             CachedCompilation *old_table = compilations;
             compilations = new_table;
-            log2_compilations_size = size_bits;
+            Halide::Runtime::Internal::Synchronization::atomic_store_release(&log2_compilations_size, &size_bits);
 
             if (count > 0) {  // Mainly to catch empty initial table case
                 for (int32_t i = 0; i < old_size; i++) {
@@ -115,19 +140,32 @@ class GPUCompilationCache {
                     }
                 }
             }
-            free(old_table);
+            if (old_table) {
+                retired_tables[old_size_bits] = old_table;
+            }
         }
         return true;
     }
 
+    void free_tables() {
+        for (auto &t : retired_tables) {
+            free(t);
+            t = nullptr;
+        }
+        free(compilations);
+        compilations = nullptr;
+        log2_compilations_size = 0;
+    }
+
     template<typename FreeModuleT>
     void release_context_already_locked(void *user_context, bool all, ContextT context, FreeModuleT &f) {
         if (count == 0) {
             return;
         }
 
+        begin_write();
         for (int i = 0; i < (1 << log2_compilations_size); i++) {
-            if (compilations[i].kernel_id > kInvalidId &&
+            if (compilations[i].kernel_id > kDeletedId &&
                 (all || (compilations[i].context == context)) &&
                 compilations[i].use_count == 0) {
                 debug(user_context) << "Releasing cached compilation: " << compilations[i].module_state
@@ -139,13 +177,63 @@ class GPUCompilationCache {
                 count--;
             }
         }
+        end_write();
+    }
+
+    // Probe the table without taking the mutex. Returns false if a
+    // writer got in the way, in which case *found is meaningless.
+    HALIDE_MUST_USE_RESULT bool try_lookup_unlocked(ContextT context, uintptr_t id,
+                                                    ModuleStateT &module_state, bool *found) {
+        using namespace Halide::Runtime::Internal::Synchronization;
+
+        uintptr_t version_before;
+        atomic_load_acquire(&table_version, &version_before);
+        if (version_before & 1) {
+            return false;
+        }
+
+        int bits;
+        atomic_load_acquire(&log2_compilations_size, &bits);
+        CachedCompilation *table;
+        atomic_load_relaxed(&compilations, &table);
+
+        *found = false;
+        if (bits != 0) {
+            uintptr_t index = kernel_hash(context, id, bits);
+            for (int i = 0; i < (1 << bits); i++) {
+                const CachedCompilation &entry = table[(index + i) & ((1 << bits) - 1)];
+                uintptr_t kernel_id = entry.kernel_id;
+                if (kernel_id == kInvalidId) {
+                    break;
+                }
+                if (entry.context == context && kernel_id == id) {
+                    module_state = entry.module_state;
+                    *found = true;
+                    break;
+                }
+            }
+        }
+
+        atomic_thread_fence_acquire();
+        uintptr_t version_after;
+        atomic_load_relaxed(&table_version, &version_after);
+        return version_before == version_after;
     }
 
 public:
     HALIDE_MUST_USE_RESULT bool lookup(ContextT context, void *state_ptr, ModuleStateT &module_state) {
-        ScopedMutexLock lock_guard(&mutex);
-
         uintptr_t id = (uintptr_t)state_ptr;
+
+        // This is on every kernel launch, and the table almost never
+        // changes once a pipeline has run, so try without the lock first.
+        for (int attempt = 0; attempt < 4; attempt++) {
+            bool found;
+            if (try_lookup_unlocked(context, id, module_state, &found)) {
+                return found;
+            }
+        }
+
+        ScopedMutexLock lock_guard(&mutex);
         ModuleStateT *mod_ptr;
         if (find_internal(context, id, mod_ptr, 0)) {
             module_state = *mod_ptr;
@@ -175,9 +263,9 @@ public:
         release_context_already_locked(user_context, true, nullptr, f);
         // Some items may have been in use, so can't free.
         if (count == 0) {
-            free(compilations);
-            compilations = nullptr;
-            log2_compilations_size = 0;
+            begin_write();
+            free_tables();
+            end_write();
         }
     }
 
@@ -211,7 +299,10 @@ public:
             return false;
         }
 
-        if (!insert({context, compiled_module, *id_ptr, 1})) {
+        begin_write();
+        bool inserted = insert({context, compiled_module, *id_ptr, 1});
+        end_write();
+        if (!inserted) {
             return false;
         }
         result = compiled_module;
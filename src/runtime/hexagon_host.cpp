@@ -32,6 +32,10 @@ typedef int (*remote_get_symbol_fn)(halide_hexagon_handle_t, const char *, int,
 typedef int (*remote_run_fn)(halide_hexagon_handle_t, int,
                              const remote_buffer *, int, const remote_buffer *, int,
                              remote_buffer *, int);
+typedef int (*remote_run_batch_fn)(const halide_hexagon_handle_t *, int, const halide_hexagon_handle_t *, int,
+                                   const int *, int, const remote_buffer *, int,
+                                   const int *, int, remote_buffer *, int,
+                                   const int *, int, const uint64_t *, int);
 typedef int (*remote_release_library_fn)(halide_hexagon_handle_t);
 typedef int (*remote_poll_log_fn)(char *, int, int *);
 typedef void (*remote_poll_profiler_state_fn)(int *, int *);
@@ -44,10 +48,13 @@ typedef int (*remote_thread_priority_fn)(int);
 typedef void (*host_malloc_init_fn)();
 typedef void *(*host_malloc_fn)(size_t);
 typedef void (*host_free_fn)(void *);
+typedef int (*host_register_buf_fn)(void *, size_t, int);
+typedef int (*host_unregister_buf_fn)(int);
 
 WEAK remote_load_library_fn remote_load_library = nullptr;
 WEAK remote_get_symbol_fn remote_get_symbol = nullptr;
 WEAK remote_run_fn remote_run = nullptr;
+WEAK remote_run_batch_fn remote_run_batch = nullptr;
 WEAK remote_release_library_fn remote_release_library = nullptr;
 WEAK remote_poll_log_fn remote_poll_log = nullptr;
 WEAK remote_poll_profiler_state_fn remote_poll_profiler_state = nullptr;
@@ -62,6 +69,8 @@ WEAK host_malloc_init_fn host_malloc_init = nullptr;
 WEAK host_malloc_init_fn host_malloc_deinit = nullptr;
 WEAK host_malloc_fn host_malloc = nullptr;
 WEAK host_free_fn host_free = nullptr;
+WEAK host_register_buf_fn host_register_buf = nullptr;
+WEAK host_unregister_buf_fn host_unregister_buf = nullptr;
 
 // This checks if there are any log messages available on the remote
 // side. It should be called after every remote call.
@@ -200,6 +209,13 @@ WEAK int init_hexagon_runtime(void *user_context) {
     get_optional_symbol(user_context, host_lib, "halide_hexagon_remote_poll_profiler_state", remote_poll_profiler_state);
     get_optional_symbol(user_context, host_lib, "halide_hexagon_remote_profiler_set_current_func", remote_profiler_set_current_func);
 
+    // Older (and simulator) host libraries don't have these; batches
+    // are then run one call at a time, and registering buffers does
+    // nothing.
+    get_optional_symbol(user_context, host_lib, "halide_hexagon_remote_run_batch", remote_run_batch);
+    get_optional_symbol(user_context, host_lib, "halide_hexagon_host_register_buf", host_register_buf);
+    get_optional_symbol(user_context, host_lib, "halide_hexagon_host_unregister_buf", host_unregister_buf);
+
     // If these are unavailable, then the runtime always powers HVX on and so these are not necessary.
     get_optional_symbol(user_context, host_lib, "halide_hexagon_remote_power_hvx_on", remote_power_hvx_on);
     get_optional_symbol(user_context, host_lib, "halide_hexagon_remote_power_hvx_off", remote_power_hvx_off);
@@ -223,6 +239,222 @@ struct module_state {
 WEAK module_state *state_list = nullptr;
 WEAK halide_hexagon_handle_t shared_runtime = 0;
 
+// A growable array, used to record the calls of a batch. The storage
+// is kept from one batch to the next.
+template<typename T>
+struct batch_vector {
+    T *data;
+    int size;
+    int capacity;
+
+    bool append(const T *values, int count) {
+        if (size + count > capacity) {
+            int new_capacity = capacity ? capacity * 2 : 16;
+            while (new_capacity < size + count) {
+                new_capacity *= 2;
+            }
+            T *new_data = (T *)malloc(new_capacity * sizeof(T));
+            if (!new_data) {
+                return false;
+            }
+            if (size) {
+                memcpy(new_data, data, size * sizeof(T));
+            }
+            free(data);
+            data = new_data;
+            capacity = new_capacity;
+        }
+        if (count) {
+            memcpy(data + size, values, count * sizeof(T));
+        }
+        size += count;
+        return true;
+    }
+
+    void release() {
+        free(data);
+        data = nullptr;
+        size = capacity = 0;
+    }
+};
+
+// The calls recorded by halide_hexagon_run while a batch is active,
+// with their arguments concatenated as halide_hexagon_remote_run_batch
+// takes them. Scalars are copied, because the arguments they point to
+// don't outlive the call; each is stored zero-extended to 64 bits,
+// along with its size.
+struct batch_state {
+    void *user_context;
+    bool active;
+    batch_vector<halide_hexagon_handle_t> modules, symbols;
+    batch_vector<int> input_buffer_counts, output_buffer_counts, scalar_counts;
+    batch_vector<remote_buffer> input_buffers, output_buffers;
+    batch_vector<uint64_t> scalars;
+    batch_vector<int> scalar_sizes;
+
+    int call_count() const {
+        return modules.size;
+    }
+
+    void clear() {
+        modules.size = symbols.size = 0;
+        input_buffer_counts.size = output_buffer_counts.size = scalar_counts.size = 0;
+        input_buffers.size = output_buffers.size = 0;
+        scalars.size = scalar_sizes.size = 0;
+    }
+
+    void release() {
+        modules.release();
+        symbols.release();
+        input_buffer_counts.release();
+        output_buffer_counts.release();
+        scalar_counts.release();
+        input_buffers.release();
+        output_buffers.release();
+        scalars.release();
+        scalar_sizes.release();
+    }
+};
+WEAK batch_state batch = {};
+WEAK halide_mutex batch_lock = {{0}};
+
+// Run the calls recorded in the batch, and clear it. Must be called
+// with batch_lock held.
+WEAK int run_batched_calls(void *user_context) {
+    const int count = batch.call_count();
+    if (count == 0) {
+        return halide_error_code_success;
+    }
+
+    debug(user_context) << "    running " << count << " batched Hexagon calls\n";
+
+#ifdef DEBUG_RUNTIME
+    uint64_t t_before = halide_current_time_ns(user_context);
+#endif
+
+    int err = 0;
+    if (remote_run_batch) {
+        debug(user_context) << "    halide_hexagon_remote_run_batch -> ";
+        err = remote_run_batch(batch.modules.data, count, batch.symbols.data, count,
+                               batch.input_buffer_counts.data, count,
+                               batch.input_buffers.data, batch.input_buffers.size,
+                               batch.output_buffer_counts.data, count,
+                               batch.output_buffers.data, batch.output_buffers.size,
+                               batch.scalar_counts.data, count,
+                               batch.scalars.data, batch.scalars.size);
+        poll_log(user_context);
+        debug(user_context) << "        " << err << "\n";
+    } else {
+        // The host library can't run a batch, so make the calls one at
+        // a time.
+        remote_buffer *input_buffers = batch.input_buffers.data;
+        remote_buffer *output_buffers = batch.output_buffers.data;
+        int scalar_index = 0;
+        for (int i = 0; i < count && err == 0; i++) {
+            const int scalar_count = batch.scalar_counts.data[i];
+            remote_buffer *input_scalars =
+                (remote_buffer *)__builtin_alloca(scalar_count * sizeof(remote_buffer));
+            for (int j = 0; j < scalar_count; j++, scalar_index++) {
+                input_scalars[j].data = (unsigned char *)&batch.scalars.data[scalar_index];
+                input_scalars[j].dataLen = batch.scalar_sizes.data[scalar_index];
+            }
+            debug(user_context) << "    halide_hexagon_remote_run -> ";
+            err = remote_run(batch.modules.data[i], batch.symbols.data[i],
+                             input_buffers, batch.input_buffer_counts.data[i],
+                             output_buffers, batch.output_buffer_counts.data[i],
+                             input_scalars, scalar_count);
+            poll_log(user_context);
+            debug(user_context) << "        " << err << "\n";
+            input_buffers += batch.input_buffer_counts.data[i];
+            output_buffers += batch.output_buffer_counts.data[i];
+        }
+    }
+    batch.clear();
+
+#ifdef DEBUG_RUNTIME
+    uint64_t t_after = halide_current_time_ns(user_context);
+    debug(user_context) << "    Time: " << (t_after - t_before) / 1.0e6 << " ms\n";
+#endif
+
+    if (err) {
+        error(user_context) << "Hexagon pipeline failed.";
+        return halide_error_code_generic_error;
+    }
+    return halide_error_code_success;
+}
+
+// Run any batched calls before the host accesses Hexagon buffer
+// memory, so that it sees their results (and they see its writes).
+WEAK int flush_batched_calls(void *user_context) {
+    ScopedMutexLock lock(&batch_lock);
+    return run_batched_calls(user_context);
+}
+
+// If a batch is active for user_context, record a call in it, and
+// return true.
+WEAK bool batch_call(void *user_context, halide_hexagon_handle_t module, halide_hexagon_handle_t function,
+                     const remote_buffer *input_buffers, int input_buffer_count,
+                     const remote_buffer *output_buffers, int output_buffer_count,
+                     const remote_buffer *input_scalars, int input_scalar_count,
+                     int *result) {
+    ScopedMutexLock lock(&batch_lock);
+    if (!batch.active || batch.user_context != user_context) {
+        return false;
+    }
+
+    for (int i = 0; i < input_scalar_count; i++) {
+        if (input_scalars[i].dataLen > (int)sizeof(uint64_t)) {
+            // The remote side can't take this as a scalar; run the
+            // batch so far, and let the caller make this call on its
+            // own.
+            int err = run_batched_calls(user_context);
+            if (err) {
+                *result = err;
+                return true;
+            }
+            return false;
+        }
+    }
+
+    const int scalars_before = batch.scalars.size;
+    bool ok = true;
+    for (int i = 0; ok && i < input_scalar_count; i++) {
+        uint64_t value = 0;
+        memcpy(&value, input_scalars[i].data, input_scalars[i].dataLen);
+        ok = batch.scalars.append(&value, 1) &&
+             batch.scalar_sizes.append(&input_scalars[i].dataLen, 1);
+    }
+    ok = ok &&
+         batch.input_buffers.append(input_buffers, input_buffer_count) &&
+         batch.output_buffers.append(output_buffers, output_buffer_count) &&
+         batch.input_buffer_counts.append(&input_buffer_count, 1) &&
+         batch.output_buffer_counts.append(&output_buffer_count, 1) &&
+         batch.scalar_counts.append(&input_scalar_count, 1) &&
+         batch.symbols.append(&function, 1) &&
+         batch.modules.append(&module, 1);
+    if (!ok) {
+        // Drop the partially recorded call, and fail.
+        const int n = batch.call_count();
+        batch.symbols.size = batch.input_buffer_counts.size = n;
+        batch.output_buffer_counts.size = batch.scalar_counts.size = n;
+        int inputs = 0, outputs = 0;
+        for (int i = 0; i < n; i++) {
+            inputs += batch.input_buffer_counts.data[i];
+            outputs += batch.output_buffer_counts.data[i];
+        }
+        batch.input_buffers.size = inputs;
+        batch.output_buffers.size = outputs;
+        batch.scalars.size = batch.scalar_sizes.size = scalars_before;
+        error(user_context) << "Hexagon: out of memory recording batched call.";
+        *result = halide_error_code_out_of_memory;
+        return true;
+    }
+
+    debug(user_context) << "    batched as call " << batch.call_count() - 1 << "\n";
+    *result = halide_error_code_success;
+    return true;
+}
+
 #ifdef DEBUG_RUNTIME
 
 // In debug builds, we write shared objects to the current directory (without
@@ -469,6 +701,15 @@ WEAK int halide_hexagon_run(void *user_context,
         return halide_error_code_generic_error;
     }
 
+    int batched_result = 0;
+    if (batch_call(user_context, module, *function,
+                   input_buffers, input_buffer_count,
+                   output_buffers, output_buffer_count,
+                   input_scalars, input_scalar_count,
+                   &batched_result)) {
+        return batched_result;
+    }
+
 #ifdef DEBUG_RUNTIME
     uint64_t t_before = halide_current_time_ns(user_context);
 #endif
@@ -524,6 +765,15 @@ WEAK int halide_hexagon_device_release(void *user_context) {
     debug(user_context)
         << "Hexagon: halide_hexagon_device_release (user_context: " << user_context << ")\n";
 
+    // Run any batched calls while their modules are still loaded.
+    int batch_result = 0;
+    {
+        ScopedMutexLock lock(&batch_lock);
+        batch_result = run_batched_calls(user_context);
+        batch.active = false;
+        batch.release();
+    }
+
     ScopedMutexLock lock(&thread_lock);
 
     // Release all of the remote side modules.
@@ -550,6 +800,76 @@ WEAK int halide_hexagon_device_release(void *user_context) {
         shared_runtime = 0;
     }
 
+    return batch_result;
+}
+
+WEAK int halide_hexagon_begin_batch(void *user_context) {
+    debug(user_context)
+        << "Hexagon: halide_hexagon_begin_batch (user_context: " << user_context << ")\n";
+
+    ScopedMutexLock lock(&batch_lock);
+    if (batch.active) {
+        error(user_context) << "Hexagon: a batch is already active.";
+        return halide_error_code_generic_error;
+    }
+    batch.active = true;
+    batch.user_context = user_context;
+    return halide_error_code_success;
+}
+
+WEAK int halide_hexagon_end_batch(void *user_context) {
+    debug(user_context)
+        << "Hexagon: halide_hexagon_end_batch (user_context: " << user_context << ")\n";
+
+    ScopedMutexLock lock(&batch_lock);
+    if (!batch.active || batch.user_context != user_context) {
+        error(user_context) << "Hexagon: no batch is active for this user_context.";
+        return halide_error_code_generic_error;
+    }
+    batch.active = false;
+    batch.user_context = nullptr;
+    return run_batched_calls(user_context);
+}
+
+WEAK int halide_hexagon_register_ion_buffer(void *user_context, void *ptr, uint64_t size, int fd) {
+    auto result = init_hexagon_runtime(user_context);
+    if (result) {
+        return result;
+    }
+
+    debug(user_context)
+        << "Hexagon: halide_hexagon_register_ion_buffer (user_context: " << user_context
+        << ", ptr: " << ptr << ", size: " << size << ", fd: " << fd << ")\n";
+
+    if (!host_register_buf) {
+        // The host library doesn't support this; buffers are then
+        // mapped on each call, as usual.
+        return halide_error_code_success;
+    }
+    if (host_register_buf(ptr, size, fd) != 0) {
+        error(user_context) << "Hexagon: failed to register buffer with fd " << fd << ".";
+        return halide_error_code_generic_error;
+    }
+    return halide_error_code_success;
+}
+
+WEAK int halide_hexagon_unregister_ion_buffer(void *user_context, int fd) {
+    debug(user_context)
+        << "Hexagon: halide_hexagon_unregister_ion_buffer (user_context: " << user_context
+        << ", fd: " << fd << ")\n";
+
+    if (!host_unregister_buf) {
+        return halide_error_code_success;
+    }
+    // A batched call may still use the buffer.
+    auto result = flush_batched_calls(user_context);
+    if (result) {
+        return result;
+    }
+    if (host_unregister_buf(fd) != 0) {
+        error(user_context) << "Hexagon: failed to unregister buffer with fd " << fd << ".";
+        return halide_error_code_generic_error;
+    }
     return halide_error_code_success;
 }
 
@@ -645,6 +965,11 @@ WEAK int halide_hexagon_device_free(void *user_context, halide_buffer_t *buf) {
         << "Hexagon: halide_hexagon_device_free (user_context: " << user_context
         << ", buf: " << buf << ")\n";
 
+    auto result = flush_batched_calls(user_context);
+    if (result) {
+        return result;
+    }
+
 #ifdef DEBUG_RUNTIME
     uint64_t t_before = halide_current_time_ns(user_context);
 #endif
@@ -686,6 +1011,11 @@ WEAK int halide_hexagon_copy_to_device(void *user_context, halide_buffer_t *buf)
         << "Hexagon: halide_hexagon_copy_to_device (user_context: " << user_context
         << ", buf: " << buf << ")\n";
 
+    result = flush_batched_calls(user_context);
+    if (result) {
+        return result;
+    }
+
 #ifdef DEBUG_RUNTIME
     uint64_t t_before = halide_current_time_ns(user_context);
 #endif
@@ -710,6 +1040,11 @@ WEAK int halide_hexagon_copy_to_host(void *user_context, struct halide_buffer_t
         << "Hexagon: halide_hexagon_copy_to_host (user_context: " << user_context
         << ", buf: " << buf << ")\n";
 
+    auto result = flush_batched_calls(user_context);
+    if (result) {
+        return result;
+    }
+
 #ifdef DEBUG_RUNTIME
     uint64_t t_before = halide_current_time_ns(user_context);
 #endif
@@ -760,6 +1095,10 @@ WEAK int halide_hexagon_detach_device_handle(void *user_context, struct halide_b
         return halide_error_code_success;
     }
     halide_abort_if_false(user_context, buf->device_interface == &hexagon_device_interface);
+    auto result = flush_batched_calls(user_context);
+    if (result) {
+        return result;
+    }
     ion_device_handle *handle = uint64_to_ptr<ion_device_handle>(buf->device);
     free(handle);
 
@@ -830,6 +1169,11 @@ WEAK int halide_hexagon_buffer_copy(void *user_context, struct halide_buffer_t *
     halide_abort_if_false(user_context, from_host || src->device);
     halide_abort_if_false(user_context, to_host || dst->device);
 
+    auto result = flush_batched_calls(user_context);
+    if (result) {
+        return result;
+    }
+
 #ifdef DEBUG_RUNTIME
     uint64_t t_before = halide_current_time_ns(user_context);
 #endif
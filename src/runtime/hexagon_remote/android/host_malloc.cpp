@@ -171,6 +171,23 @@ pthread_mutex_t allocations_mutex = PTHREAD_MUTEX_INITIALIZER;
 
 int ion_fd = -1;
 
+// Buffers allocated elsewhere (e.g. by a camera HAL) that have been
+// registered with FastRPC, so that they stay mapped on the DSP across
+// calls. Keyed on the buffer's fd, and reference counted, so that
+// registering the same buffer again (e.g. once per frame) is cheap.
+struct registration_record {
+    registration_record *next;
+    int buf_fd;
+    void *buf;
+    size_t size;
+    int ref_count;
+};
+
+registration_record registrations = {
+    NULL,
+};
+pthread_mutex_t registrations_mutex = PTHREAD_MUTEX_INITIALIZER;
+
 }  // namespace
 
 extern "C" {
@@ -415,4 +432,69 @@ void halide_hexagon_host_free(void *ptr) {
     free(rec);
 }
 
+int halide_hexagon_host_register_buf(void *buf, size_t size, int fd) {
+    if (fd < 0) {
+        return -1;
+    }
+
+    pthread_mutex_lock(&registrations_mutex);
+    registration_record *rec = registrations.next;
+    while (rec && rec->buf_fd != fd) {
+        rec = rec->next;
+    }
+    if (rec) {
+        if (rec->buf != buf || rec->size != size) {
+            pthread_mutex_unlock(&registrations_mutex);
+            __android_log_print(ANDROID_LOG_ERROR, "halide", "fd %d is already registered with a different mapping", fd);
+            return -1;
+        }
+        rec->ref_count++;
+        pthread_mutex_unlock(&registrations_mutex);
+        return 0;
+    }
+
+    rec = (registration_record *)malloc(sizeof(registration_record));
+    if (!rec) {
+        pthread_mutex_unlock(&registrations_mutex);
+        __android_log_print(ANDROID_LOG_ERROR, "halide", "malloc failed");
+        return -1;
+    }
+    rec->buf_fd = fd;
+    rec->buf = buf;
+    rec->size = size;
+    rec->ref_count = 1;
+    rec->next = registrations.next;
+    registrations.next = rec;
+
+    if (remote_register_buf) {
+        remote_register_buf(buf, size, fd);
+    }
+    pthread_mutex_unlock(&registrations_mutex);
+    return 0;
+}
+
+int halide_hexagon_host_unregister_buf(int fd) {
+    pthread_mutex_lock(&registrations_mutex);
+    registration_record *prev = &registrations;
+    registration_record *rec = prev->next;
+    while (rec && rec->buf_fd != fd) {
+        prev = rec;
+        rec = rec->next;
+    }
+    if (!rec) {
+        pthread_mutex_unlock(&registrations_mutex);
+        __android_log_print(ANDROID_LOG_WARN, "halide", "fd %d is not registered", fd);
+        return -1;
+    }
+    if (--rec->ref_count == 0) {
+        prev->next = rec->next;
+        if (remote_register_buf) {
+            remote_register_buf(rec->buf, rec->size, -1);
+        }
+        free(rec);
+    }
+    pthread_mutex_unlock(&registrations_mutex);
+    return 0;
+}
+
 }  // extern "C"
@@ -340,10 +340,13 @@ int halide_hexagon_runtime_set_thread_priority(int priority) {
     return 0;
 }
 
-int halide_hexagon_remote_run_v2(handle_t module_ptr, handle_t function,
-                                 const buffer *input_buffersPtrs, int input_buffersLen,
-                                 buffer *output_buffersPtrs, int output_buffersLen,
-                                 const scalar_t *scalars, int scalarsLen) {
+namespace {
+
+// Run a pipeline with HVX already powered on.
+int run_pipeline(handle_t function,
+                 const buffer *input_buffersPtrs, int input_buffersLen,
+                 buffer *output_buffersPtrs, int output_buffersLen,
+                 const scalar_t *scalars, int scalarsLen) {
     // Get a pointer to the argv version of the pipeline.
     typedef int (*pipeline_argv_t)(void **);
     pipeline_argv_t pipeline = reinterpret_cast<pipeline_argv_t>(function);
@@ -390,27 +393,83 @@ int halide_hexagon_remote_run_v2(handle_t module_ptr, handle_t function,
         *next_arg = const_cast<scalar_t *>(&scalars[i]);
     }
 
+    // Call the pipeline and return the result.
+    int result = pipeline(args);
+
+    if (allocated_on_heap) {
+        free(buffers);
+        free(args);
+    }
+
+    return result;
+}
+
+}  // namespace
+
+int halide_hexagon_remote_run_v2(handle_t module_ptr, handle_t function,
+                                 const buffer *input_buffersPtrs, int input_buffersLen,
+                                 buffer *output_buffersPtrs, int output_buffersLen,
+                                 const scalar_t *scalars, int scalarsLen) {
     // Prior to running the pipeline, power HVX on (if it was not already on).
     int result = halide_hexagon_remote_power_hvx_on();
     if (result != 0) {
-        if (allocated_on_heap) {
-            free(buffers);
-            free(args);
-        }
         return result;
     }
 
-    // Call the pipeline and return the result.
-    result = pipeline(args);
+    result = run_pipeline(function,
+                          input_buffersPtrs, input_buffersLen,
+                          output_buffersPtrs, output_buffersLen,
+                          scalars, scalarsLen);
 
     // Power HVX off.
     halide_hexagon_remote_power_hvx_off();
 
-    if (allocated_on_heap) {
-        free(buffers);
-        free(args);
+    return result;
+}
+
+int halide_hexagon_remote_run_batch(const handle_t *modules, int modulesLen,
+                                    const handle_t *symbols, int symbolsLen,
+                                    const int *input_buffer_counts, int input_buffer_countsLen,
+                                    const buffer *input_buffersPtrs, int input_buffersLen,
+                                    const int *output_buffer_counts, int output_buffer_countsLen,
+                                    buffer *output_buffersPtrs, int output_buffersLen,
+                                    const int *scalar_counts, int scalar_countsLen,
+                                    const scalar_t *scalars, int scalarsLen) {
+    const int count = modulesLen;
+    if (symbolsLen != count || input_buffer_countsLen != count ||
+        output_buffer_countsLen != count || scalar_countsLen != count) {
+        log_printf("halide_hexagon_remote_run_batch: mismatched call counts\n");
+        return -1;
     }
 
+    // Power HVX on once for the whole batch.
+    int result = halide_hexagon_remote_power_hvx_on();
+    if (result != 0) {
+        return result;
+    }
+
+    for (int i = 0; i < count && result == 0; i++) {
+        if (input_buffer_counts[i] > input_buffersLen ||
+            output_buffer_counts[i] > output_buffersLen ||
+            scalar_counts[i] > scalarsLen) {
+            log_printf("halide_hexagon_remote_run_batch: call %d has too many arguments\n", i);
+            result = -1;
+            break;
+        }
+        result = run_pipeline(symbols[i],
+                              input_buffersPtrs, input_buffer_counts[i],
+                              output_buffersPtrs, output_buffer_counts[i],
+                              scalars, scalar_counts[i]);
+        input_buffersPtrs += input_buffer_counts[i];
+        input_buffersLen -= input_buffer_counts[i];
+        output_buffersPtrs += output_buffer_counts[i];
+        output_buffersLen -= output_buffer_counts[i];
+        scalars += scalar_counts[i];
+        scalarsLen -= scalar_counts[i];
+    }
+
+    halide_hexagon_remote_power_hvx_off();
+
     return result;
 }
 
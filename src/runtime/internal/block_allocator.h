@@ -60,6 +60,7 @@ public:
     int reclaim(void *user_context, MemoryRegion *region);          //< free the region and consolidate
     int retain(void *user_context, MemoryRegion *region);           //< retain the region and increase the usage count
     bool collect(void *user_context);                               //< returns true if any blocks were removed
+    bool defragment(void *user_context);                            //< merges all unused space within blocks, returns true if any blocks were removed
     int release(void *user_context);
     int destroy(void *user_context);
 
@@ -69,6 +70,7 @@ public:
     const Config &default_config() const;
     size_t block_count() const;
     size_t pool_size() const;
+    MemoryStats current_stats(void *user_context) const;
 
 private:
     // Linked-list for storing the block resources
@@ -107,6 +109,9 @@ private:
     // Invokes the deallocation callback to free memory for the memory block
     int free_memory_block(void *user_context, BlockResource *block);
 
+    // Returns true if the pool size or block count constraints prevent creating another block
+    bool has_reached_pool_limits() const;
+
     // Returns a constrained size for the requested size based on config parameters
     size_t constrain_requested_size(size_t size) const;
 
@@ -180,7 +185,12 @@ MemoryRegion *BlockAllocator::reserve(void *user_context, const MemoryRequest &r
     if (result == nullptr) {
 
         // Unable to reserve region in an existing block ... create a new block and try again.
-        block_entry = create_block_entry(user_context, request);
+        if (has_reached_pool_limits() && defragment(user_context)) {
+            // Out of room for a new block ... but defragmenting released some empty blocks
+            block_entry = reserve_block_entry(user_context, request);
+        } else {
+            block_entry = create_block_entry(user_context, request);
+        }
         if (block_entry == nullptr) {
             error(user_context) << "BlockAllocator: Out of memory! Failed to allocate empty block of size ("
                                 << (int32_t)(request.size) << " bytes)\n";
@@ -265,6 +275,24 @@ bool BlockAllocator::collect(void *user_context) {
     return result;
 }
 
+bool BlockAllocator::defragment(void *user_context) {
+    bool result = false;
+    BlockEntry *block_entry = block_list.back();
+    while (block_entry != nullptr) {
+        BlockEntry *prev_entry = block_entry->prev_ptr;
+        const BlockResource *block = static_cast<BlockResource *>(block_entry->value);
+        if (block->allocator != nullptr) {
+            block->allocator->defragment(user_context);
+        }
+        if ((block->allocator == nullptr) || (block->reserved == 0)) {
+            destroy_block_entry(user_context, block_entry);
+            result = true;
+        }
+        block_entry = prev_entry;
+    }
+    return result;
+}
+
 int BlockAllocator::release(void *user_context) {
     BlockEntry *block_entry = block_list.back();
     while (block_entry != nullptr) {
@@ -352,30 +380,38 @@ bool BlockAllocator::is_block_suitable_for_request(void *user_context, const Blo
 
 BlockAllocator::BlockEntry *
 BlockAllocator::find_block_entry(void *user_context, const MemoryRequest &request) {
+    // Prefer the fullest suitable block, so that allocations get packed together and
+    // lightly used blocks are left to drain (and be collected) rather than fragmenting
+    BlockEntry *best_entry = nullptr;
+    size_t best_available = 0;
     BlockEntry *block_entry = block_list.back();
     while (block_entry != nullptr) {
         BlockEntry *prev_entry = block_entry->prev_ptr;
         const BlockResource *block = static_cast<BlockResource *>(block_entry->value);
         if (is_block_suitable_for_request(user_context, block, request)) {
-#ifdef DEBUG_RUNTIME_INTERNAL
-            debug(user_context) << "BlockAllocator: found suitable block ("
-                                << "user_context=" << (void *)(user_context) << " "
-                                << "block_resource=" << (void *)block << " "
-                                << "block_size=" << (uint32_t)block->memory.size << " "
-                                << "block_reserved=" << (uint32_t)block->reserved << " "
-                                << "request_size=" << (uint32_t)request.size << " "
-                                << "request_dedicated=" << (request.dedicated ? "true" : "false") << " "
-                                << "request_usage=" << halide_memory_usage_name(request.properties.usage) << " "
-                                << "request_caching=" << halide_memory_caching_name(request.properties.caching) << " "
-                                << "request_visibility=" << halide_memory_visibility_name(request.properties.visibility) << ")";
-#endif
-            return block_entry;
+            size_t available = (block->memory.size - block->reserved);
+            if ((best_entry == nullptr) || (available < best_available)) {
+                best_entry = block_entry;
+                best_available = available;
+            }
         }
         block_entry = prev_entry;
     }
 
-    if (block_entry == nullptr) {
 #ifdef DEBUG_RUNTIME_INTERNAL
+    if (best_entry != nullptr) {
+        const BlockResource *block = static_cast<BlockResource *>(best_entry->value);
+        debug(user_context) << "BlockAllocator: found suitable block ("
+                            << "user_context=" << (void *)(user_context) << " "
+                            << "block_resource=" << (void *)block << " "
+                            << "block_size=" << (uint32_t)block->memory.size << " "
+                            << "block_reserved=" << (uint32_t)block->reserved << " "
+                            << "request_size=" << (uint32_t)request.size << " "
+                            << "request_dedicated=" << (request.dedicated ? "true" : "false") << " "
+                            << "request_usage=" << halide_memory_usage_name(request.properties.usage) << " "
+                            << "request_caching=" << halide_memory_caching_name(request.properties.caching) << " "
+                            << "request_visibility=" << halide_memory_visibility_name(request.properties.visibility) << ")";
+    } else {
         debug(user_context) << "BlockAllocator: couldn't find suitable block! ("
                             << "user_context=" << (void *)(user_context) << " "
                             << "request_size=" << (uint32_t)request.size << " "
@@ -383,9 +419,9 @@ BlockAllocator::find_block_entry(void *user_context, const MemoryRequest &reques
                             << "request_usage=" << halide_memory_usage_name(request.properties.usage) << " "
                             << "request_caching=" << halide_memory_caching_name(request.properties.caching) << " "
                             << "request_visibility=" << halide_memory_visibility_name(request.properties.visibility) << ")";
-#endif
     }
-    return block_entry;
+#endif
+    return best_entry;
 }
 
 BlockAllocator::BlockEntry *
@@ -399,6 +435,12 @@ BlockAllocator::reserve_block_entry(void *user_context, const MemoryRequest &req
                         << "requested_visibility=" << halide_memory_visibility_name(request.properties.visibility) << ")";
 #endif
     BlockEntry *block_entry = find_block_entry(user_context, request);
+    if ((block_entry == nullptr) && has_reached_pool_limits()) {
+        // Out of room for a new block ... drop any empty ones and look again
+        if (defragment(user_context)) {
+            block_entry = find_block_entry(user_context, request);
+        }
+    }
     if (block_entry == nullptr) {
 #ifdef DEBUG_RUNTIME_INTERNAL
         debug(user_context) << "BlockAllocator: creating block ... ! ("
@@ -604,6 +646,16 @@ int BlockAllocator::conform(void *user_context, MemoryRequest *request) const {
     return 0;
 }
 
+bool BlockAllocator::has_reached_pool_limits() const {
+    if (config.maximum_pool_size && (pool_size() >= config.maximum_pool_size)) {
+        return true;
+    }
+    if (config.maximum_block_count && (block_count() >= config.maximum_block_count)) {
+        return true;
+    }
+    return false;
+}
+
 bool BlockAllocator::is_compatible_block(const BlockResource *block, const MemoryProperties &properties) const {
     if (properties.caching != MemoryCaching::DefaultCaching) {
         if (properties.caching != block->memory.properties.caching) {
@@ -643,6 +695,18 @@ size_t BlockAllocator::block_count() const {
     return block_list.size();
 }
 
+MemoryStats BlockAllocator::current_stats(void *user_context) const {
+    MemoryStats stats;
+    BlockEntry const *block_entry = nullptr;
+    for (block_entry = block_list.front(); block_entry != nullptr; block_entry = block_entry->next_ptr) {
+        const BlockResource *block = static_cast<BlockResource *>(block_entry->value);
+        if ((block != nullptr) && (block->allocator != nullptr)) {
+            block->allocator->accumulate_stats(user_context, &stats);
+        }
+    }
+    return stats;
+}
+
 size_t BlockAllocator::pool_size() const {
     size_t total_size = 0;
     BlockEntry const *block_entry = nullptr;
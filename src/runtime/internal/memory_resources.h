@@ -95,6 +95,18 @@ struct MemoryRequest {
     MemoryProperties properties;  //< properties for the allocated region
 };
 
+// Client-facing struct for reporting the utilization of allocated blocks
+// -- fragmentation can be estimated as 1 - (largest_available / available)
+struct MemoryStats {
+    size_t block_count = 0;        //< number of blocks allocated
+    size_t block_bytes = 0;        //< total size of all allocated blocks (in bytes)
+    size_t region_count = 0;       //< number of regions in use
+    size_t reserved_bytes = 0;     //< number of bytes reserved by regions in use
+    size_t available_count = 0;    //< number of contiguous free spans across all blocks
+    size_t available_bytes = 0;    //< number of free bytes across all blocks
+    size_t largest_available = 0;  //< size of the largest contiguous free span (in bytes)
+};
+
 class RegionAllocator;
 struct BlockRegion;
 
@@ -51,12 +51,16 @@ public:
     int reclaim(void *user_context, MemoryRegion *memory_region);   //< free the region and consolidate
     int retain(void *user_context, MemoryRegion *memory_region);    //< retain the region and increase usage count
     bool collect(void *user_context);                               //< returns true if any blocks were removed
+    bool defragment(void *user_context);                            //< frees all unused regions and merges their space, returns true if any regions were removed
     int release(void *user_context);
     int destroy(void *user_context);
 
     // Returns the currently managed block resource
     BlockResource *block_resource() const;
 
+    // Adds the utilization of the managed block to the given stats
+    void accumulate_stats(void *user_context, MemoryStats *stats) const;
+
 private:
     // Initializes a new instance
     int initialize(void *user_context, BlockResource *block, const MemoryAllocators &ma);
@@ -768,6 +772,28 @@ bool RegionAllocator::collect(void *user_context) {
     return has_collected;
 }
 
+bool RegionAllocator::defragment(void *user_context) {
+#ifdef DEBUG_RUNTIME_INTERNAL
+    debug(user_context) << "RegionAllocator: Defragmenting block regions ("
+                        << "user_context=" << (void *)(user_context) << ") ...";
+#endif
+
+    // Regions that were released are kept around (with their handles) for reuse, which
+    // leaves isolated holes that collect() won't merge. Drop the handles of all unused
+    // regions first, so that every run of free space can be coalesced into one region.
+    BlockRegion *block_region = block->regions;
+    while (block_region != nullptr) {
+        if (is_available(block_region) && (block_region->memory.handle != nullptr)) {
+            free_block_region(user_context, block_region);
+        }
+        if (is_last_block_region(user_context, block_region)) {
+            break;
+        }
+        block_region = block_region->next_ptr;
+    }
+    return collect(user_context);
+}
+
 int RegionAllocator::destroy(void *user_context) {
 #ifdef DEBUG_RUNTIME_INTERNAL
     debug(user_context) << "RegionAllocator: Destroying all block regions ("
@@ -833,6 +859,39 @@ BlockResource *RegionAllocator::block_resource() const {
     return block;
 }
 
+void RegionAllocator::accumulate_stats(void *user_context, MemoryStats *stats) const {
+    if ((block == nullptr) || (stats == nullptr)) {
+        return;
+    }
+    stats->block_count++;
+    stats->block_bytes += block->memory.size;
+
+    // Neighbouring free regions that haven't been coalesced yet still form one contiguous span
+    size_t span = 0;
+    for (BlockRegion const *region = block->regions; region != nullptr; region = region->next_ptr) {
+        if (is_available(region)) {
+            span += region->memory.size;
+        } else {
+            stats->region_count++;
+            stats->reserved_bytes += region->memory.size;
+            if (span > 0) {
+                stats->available_count++;
+                stats->available_bytes += span;
+                stats->largest_available = max(stats->largest_available, span);
+            }
+            span = 0;
+        }
+        if (is_last_block_region(user_context, region)) {
+            break;
+        }
+    }
+    if (span > 0) {
+        stats->available_count++;
+        stats->available_bytes += span;
+        stats->largest_available = max(stats->largest_available, span);
+    }
+}
+
 // --
 
 }  // namespace Internal
@@ -0,0 +1,146 @@
+#include "HalideRuntime.h"
+#include "printer.h"
+#include "runtime_internal.h"
+
+extern "C" {
+
+extern void *mmap(void *addr, size_t length, int prot, int flags, int fd, long offset);
+extern int munmap(void *addr, size_t length);
+extern int madvise(void *addr, size_t length, int advice);
+
+}  // extern "C"
+
+namespace Halide {
+namespace Runtime {
+namespace Internal {
+namespace HugePages {
+
+// These match the values on every Linux architecture Halide runtimes
+// are built for.
+constexpr int PROT_READ_WRITE = 0x3;
+constexpr int MAP_PRIVATE = 0x02;
+constexpr int MAP_ANONYMOUS = 0x20;
+constexpr int MAP_HUGETLB = 0x40000;
+constexpr int MADV_HUGEPAGE = 14;
+
+ALWAYS_INLINE bool map_failed(void *p) {
+    return p == (void *)-1;
+}
+
+constexpr size_t kHugePageSize = 2 * 1024 * 1024;
+
+// Every allocation is preceded by a header of the malloc alignment,
+// which says where it came from.
+struct AllocationHeader {
+    // The start and length of the mapping it's in, or null and zero if
+    // it was made by the allocator installed before this one.
+    void *mapping;
+    size_t mapping_length;
+};
+
+WEAK size_t huge_page_min_bytes = kHugePageSize;
+WEAK bool use_explicit_huge_pages = false;
+
+// The allocator allocations smaller than huge_page_min_bytes are
+// passed on to.
+WEAK halide_malloc_t small_malloc = nullptr;
+WEAK halide_free_t small_free = nullptr;
+
+ALWAYS_INLINE AllocationHeader *header_of(void *ptr) {
+    return (AllocationHeader *)((char *)ptr - ::halide_internal_malloc_alignment());
+}
+
+// Map length bytes (a multiple of the huge page size), starting at a
+// huge page boundary, and ask for them to be backed by huge pages.
+WEAK void *map_huge_pages(size_t length) {
+    if (use_explicit_huge_pages) {
+        void *p = mmap(nullptr, length, PROT_READ_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (!map_failed(p)) {
+            return p;
+        }
+        // The pool of explicit huge pages is empty or unconfigured, so
+        // fall back to transparent ones.
+    }
+
+    // Over-allocate so that the range can be trimmed to start at a huge
+    // page boundary, which is required for the kernel to back it with
+    // huge pages.
+    char *p = (char *)mmap(nullptr, length + kHugePageSize, PROT_READ_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (map_failed(p)) {
+        return nullptr;
+    }
+    char *aligned = (char *)align_up((uintptr_t)p, kHugePageSize);
+    if (aligned != p) {
+        munmap(p, aligned - p);
+    }
+    char *end = p + length + kHugePageSize;
+    if (end != aligned + length) {
+        munmap(aligned + length, end - (aligned + length));
+    }
+    // If transparent huge pages are disabled, this fails, and the
+    // memory is still usable with normal pages.
+    (void)madvise(aligned, length, MADV_HUGEPAGE);
+    return aligned;
+}
+
+}  // namespace HugePages
+}  // namespace Internal
+}  // namespace Runtime
+}  // namespace Halide
+
+using namespace Halide::Runtime::Internal::HugePages;
+
+extern "C" {
+
+WEAK void *halide_huge_page_malloc(void *user_context, size_t x) {
+    const size_t alignment = ::halide_internal_malloc_alignment();
+    if (x < huge_page_min_bytes) {
+        halide_malloc_t fn = small_malloc ? small_malloc : halide_default_malloc;
+        char *block = (char *)fn(user_context, x + alignment);
+        if (!block) {
+            return nullptr;
+        }
+        char *ptr = block + alignment;
+        header_of(ptr)->mapping = nullptr;
+        header_of(ptr)->mapping_length = 0;
+        return ptr;
+    }
+
+    // Leave room for the header, and for reads a little past the end.
+    const size_t length = align_up(x + 2 * alignment, kHugePageSize);
+    char *mapping = (char *)map_huge_pages(length);
+    if (!mapping) {
+        return nullptr;
+    }
+    char *ptr = mapping + alignment;
+    header_of(ptr)->mapping = mapping;
+    header_of(ptr)->mapping_length = length;
+    return ptr;
+}
+
+WEAK void halide_huge_page_free(void *user_context, void *ptr) {
+    if (!ptr) {
+        return;
+    }
+    AllocationHeader *header = header_of(ptr);
+    if (header->mapping) {
+        munmap(header->mapping, header->mapping_length);
+    } else {
+        halide_free_t fn = small_free ? small_free : halide_default_free;
+        fn(user_context, header);
+    }
+}
+
+WEAK int halide_use_huge_page_allocator(size_t min_bytes, bool explicit_huge_pages) {
+    huge_page_min_bytes = min_bytes;
+    use_explicit_huge_pages = explicit_huge_pages;
+    halide_malloc_t old_malloc = halide_set_custom_malloc(halide_huge_page_malloc);
+    halide_free_t old_free = halide_set_custom_free(halide_huge_page_free);
+    if (old_malloc != halide_huge_page_malloc) {
+        small_malloc = old_malloc;
+        small_free = old_free;
+    }
+    return halide_error_code_success;
+}
+
+}  // extern "C"
@@ -0,0 +1,131 @@
+#include "HalideRuntime.h"
+#include "printer.h"
+#include "runtime_internal.h"
+#include "scoped_spin_lock.h"
+
+extern "C" {
+
+extern int sched_setaffinity(int pid, size_t cpusetsize, const void *mask);
+extern int sched_getcpu();
+}
+
+namespace Halide {
+namespace Runtime {
+namespace Internal {
+
+// Matches the size of glibc's cpu_set_t.
+constexpr int max_numa_cpus = 1024;
+constexpr int max_numa_nodes = 64;
+
+struct numa_topology_t {
+    // A bitmask of the cpus that belong to each node, in the layout
+    // sched_setaffinity expects.
+    uint64_t node_cpus[max_numa_nodes][max_numa_cpus / 64];
+
+    // The node each cpu belongs to.
+    int8_t cpu_node[max_numa_cpus];
+
+    int num_nodes;
+    bool initialized;
+};
+
+WEAK numa_topology_t numa_topology = {};
+WEAK ScopedSpinLock::AtomicFlag numa_topology_lock = 0;
+
+WEAK bool read_small_file(const char *path, char *buf, size_t size) {
+    void *f = halide_fopen(path, "r");
+    if (!f) {
+        return false;
+    }
+    size_t n = fread(buf, 1, size - 1, f);
+    fclose(f);
+    buf[n] = 0;
+    return n > 0;
+}
+
+// Parse a sysfs cpu list like "0-15,32-47" into a bitmask.
+WEAK void parse_cpu_list(const char *s, uint64_t *mask) {
+    while (*s) {
+        if (*s < '0' || *s > '9') {
+            s++;
+            continue;
+        }
+        int lo = 0;
+        while (*s >= '0' && *s <= '9') {
+            lo = lo * 10 + (*s++ - '0');
+        }
+        int hi = lo;
+        if (*s == '-') {
+            s++;
+            hi = 0;
+            while (*s >= '0' && *s <= '9') {
+                hi = hi * 10 + (*s++ - '0');
+            }
+        }
+        for (int c = lo; c <= hi && c < max_numa_cpus; c++) {
+            mask[c / 64] |= (uint64_t)1 << (c % 64);
+        }
+    }
+}
+
+WEAK void init_numa_topology() {
+    ScopedSpinLock lock(&numa_topology_lock);
+    if (numa_topology.initialized) {
+        return;
+    }
+
+    // Treat the machine as a single node unless sysfs says otherwise.
+    numa_topology.num_nodes = 1;
+    for (int n = 0; n < max_numa_nodes; n++) {
+        StackStringStreamPrinter<64> path(nullptr);
+        path << "/sys/devices/system/node/node" << n << "/cpulist";
+        char buf[1024];
+        if (!read_small_file(path.str(), buf, sizeof(buf))) {
+            break;
+        }
+        parse_cpu_list(buf, numa_topology.node_cpus[n]);
+        for (int c = 0; c < max_numa_cpus; c++) {
+            if (numa_topology.node_cpus[n][c / 64] & ((uint64_t)1 << (c % 64))) {
+                numa_topology.cpu_node[c] = (int8_t)n;
+            }
+        }
+        numa_topology.num_nodes = n + 1;
+    }
+    numa_topology.initialized = true;
+}
+
+}  // namespace Internal
+}  // namespace Runtime
+}  // namespace Halide
+
+using namespace Halide::Runtime::Internal;
+
+extern "C" {
+
+WEAK int halide_host_numa_node_count() {
+    init_numa_topology();
+    return numa_topology.num_nodes;
+}
+
+WEAK int halide_current_numa_node() {
+    init_numa_topology();
+    int cpu = sched_getcpu();
+    if (cpu < 0 || cpu >= max_numa_cpus) {
+        return 0;
+    }
+    return numa_topology.cpu_node[cpu];
+}
+
+WEAK int halide_pin_current_thread_to_numa_node(int node) {
+    init_numa_topology();
+    if (node < 0 || node >= numa_topology.num_nodes) {
+        error(nullptr) << "halide_pin_current_thread_to_numa_node: node " << node
+                       << " is out of range; the host has " << numa_topology.num_nodes << " NUMA nodes.";
+        return halide_error_code_generic_error;
+    }
+    if (sched_setaffinity(0, sizeof(numa_topology.node_cpus[node]), numa_topology.node_cpus[node]) != 0) {
+        return halide_error_code_generic_error;
+    }
+    return halide_error_code_success;
+}
+}
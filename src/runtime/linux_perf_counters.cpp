@@ -0,0 +1,110 @@
+#include "HalideRuntime.h"
+#include "runtime_internal.h"
+
+// Reads the hardware performance counters with perf_event_open. They're
+// only available if /proc/sys/kernel/perf_event_paranoid allows it.
+
+// The syscall number of perf_event_open varies across platforms:
+// -- i386 is 336
+// -- x64 is 298
+
+#ifndef SYS_PERF_EVENT_OPEN
+
+#ifdef BITS_64
+#define SYS_PERF_EVENT_OPEN 298
+#endif
+
+#ifdef BITS_32
+#define SYS_PERF_EVENT_OPEN 336
+#endif
+
+#endif
+
+extern "C" {
+
+extern int syscall(int num, ...);
+extern ssize_t read(int fd, void *buf, size_t count);
+}
+
+namespace Halide {
+namespace Runtime {
+namespace Internal {
+
+// The first version of struct perf_event_attr, which the kernel still
+// accepts.
+struct perf_event_attr_v0 {
+    uint32_t type;
+    uint32_t size;
+    uint64_t config;
+    uint64_t sample_period;
+    uint64_t sample_type;
+    uint64_t read_format;
+    uint64_t flags;
+    uint32_t wakeup_events;
+    uint32_t bp_type;
+    uint64_t bp_addr;
+};
+
+static_assert(sizeof(perf_event_attr_v0) == 64);
+
+constexpr uint32_t kPerfTypeHardware = 0;
+constexpr uint64_t kPerfCountHwCpuCycles = 0;
+constexpr uint64_t kPerfCountHwInstructions = 1;
+constexpr uint64_t kPerfCountHwCacheMisses = 3;
+constexpr uint64_t kPerfFormatGroup = 1 << 3;
+constexpr uint64_t kPerfFlagExcludeKernel = 1 << 5;
+constexpr uint64_t kPerfFlagExcludeHv = 1 << 6;
+
+WEAK int open_perf_counter(uint64_t config, int group_fd) {
+    perf_event_attr_v0 attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.type = kPerfTypeHardware;
+    attr.size = sizeof(attr);
+    attr.config = config;
+    attr.read_format = kPerfFormatGroup;
+    // Count user space only, so that the default paranoia level allows it.
+    attr.flags = kPerfFlagExcludeKernel | kPerfFlagExcludeHv;
+    // The calling thread, on any cpu.
+    return syscall(SYS_PERF_EVENT_OPEN, &attr, 0, -1, group_fd, 0);
+}
+
+}  // namespace Internal
+}  // namespace Runtime
+}  // namespace Halide
+
+using namespace Halide::Runtime::Internal;
+
+extern "C" {
+
+WEAK int halide_open_perf_counters() {
+    // Open the counters as a group with the cycles counter as leader, so
+    // that they can all be read at once.
+    const uint64_t configs[halide_perf_counter_count] = {
+        kPerfCountHwCpuCycles,
+        kPerfCountHwInstructions,
+        kPerfCountHwCacheMisses,
+    };
+    int fds[halide_perf_counter_count];
+    for (int i = 0; i < halide_perf_counter_count; i++) {
+        fds[i] = open_perf_counter(configs[i], i == 0 ? -1 : fds[0]);
+        if (fds[i] < 0) {
+            for (int j = i - 1; j >= 0; j--) {
+                close(fds[j]);
+            }
+            return -1;
+        }
+    }
+    return fds[0];
+}
+
+WEAK bool halide_read_perf_counters(int handle, uint64_t *counts) {
+    // A group is read as the number of counters followed by their values.
+    uint64_t values[halide_perf_counter_count + 1];
+    if (read(handle, values, sizeof(values)) != (ssize_t)sizeof(values) ||
+        values[0] != halide_perf_counter_count) {
+        return false;
+    }
+    memcpy(counts, values + 1, halide_perf_counter_count * sizeof(uint64_t));
+    return true;
+}
+}
@@ -216,6 +216,14 @@ WEAK void set_input_buffer(mtl_compute_command_encoder *encoder, mtl_buffer *inp
               input_buffer, (size_t)offset, index);
 }
 
+WEAK void set_input_buffers(mtl_compute_command_encoder *encoder, mtl_buffer *const *input_buffers, const size_t *offsets, NSRange range) {
+    typedef void (*set_buffers_method)(objc_id encoder, objc_sel sel,
+                                       mtl_buffer *const *input_buffers, const size_t *offsets, NSRange range);
+    set_buffers_method method = (set_buffers_method)&objc_msgSend;
+    (*method)(encoder, sel_getUid("setBuffers:offsets:withRange:"),
+              input_buffers, offsets, range);
+}
+
 WEAK void set_input_buffer_from_bytes(mtl_compute_command_encoder *encoder, uint8_t *input_buffer, uint32_t length, uint32_t index) {
     typedef void (*set_bytes_method)(objc_id encoder, objc_sel sel,
                                      void *input_buffer, size_t length, size_t index);
@@ -297,6 +305,75 @@ WEAK Halide::Internal::GPUCompilationCache<mtl_device *, mtl_library *> compilat
 WEAK bool metal_api_supports_set_bytes;
 WEAK mtl_device *metal_api_checked_device;
 
+// Compute pipeline states are expensive to build, so keep the most
+// recently used ones around, keyed by library and entry point name. All
+// accesses happen while the Metal context (and hence thread_lock) is held.
+struct pipeline_state_cache_entry {
+    mtl_library *library;
+    char *entry_name;
+    mtl_compute_pipeline_state *pipeline_state;
+};
+
+static constexpr int pipeline_state_cache_size = 64;
+WEAK pipeline_state_cache_entry pipeline_state_cache[pipeline_state_cache_size];
+WEAK int pipeline_state_cache_next_victim;
+
+WEAK void release_pipeline_state_cache_entry(pipeline_state_cache_entry &entry) {
+    if (entry.pipeline_state != nullptr) {
+        release_ns_object(entry.pipeline_state);
+    }
+    free(entry.entry_name);
+    entry.library = nullptr;
+    entry.entry_name = nullptr;
+    entry.pipeline_state = nullptr;
+}
+
+WEAK mtl_compute_pipeline_state *find_cached_pipeline_state(mtl_library *library, const char *entry_name) {
+    for (auto &entry : pipeline_state_cache) {
+        if (entry.library == library && strcmp(entry.entry_name, entry_name) == 0) {
+            return entry.pipeline_state;
+        }
+    }
+    return nullptr;
+}
+
+WEAK void cache_pipeline_state(mtl_library *library, const char *entry_name, mtl_compute_pipeline_state *pipeline_state) {
+    size_t name_len = strlen(entry_name);
+    char *name_copy = (char *)malloc(name_len + 1);
+    if (name_copy == nullptr) {
+        return;
+    }
+    memcpy(name_copy, entry_name, name_len + 1);
+
+    pipeline_state_cache_entry *slot = nullptr;
+    for (auto &entry : pipeline_state_cache) {
+        if (entry.library == nullptr) {
+            slot = &entry;
+            break;
+        }
+    }
+    if (slot == nullptr) {
+        slot = &pipeline_state_cache[pipeline_state_cache_next_victim];
+        pipeline_state_cache_next_victim = (pipeline_state_cache_next_victim + 1) % pipeline_state_cache_size;
+        release_pipeline_state_cache_entry(*slot);
+    }
+    retain_ns_object(pipeline_state);
+    slot->library = library;
+    slot->entry_name = name_copy;
+    slot->pipeline_state = pipeline_state;
+}
+
+// Used in place of release_ns_object when dropping libraries from the
+// compilation cache, so that no cached pipeline outlives its library.
+WEAK void release_library(mtl_library *library) {
+    for (auto &entry : pipeline_state_cache) {
+        if (entry.library == library) {
+            release_pipeline_state_cache_entry(entry);
+        }
+    }
+    release_ns_object(library);
+}
+
 namespace {
 void do_device_to_device_copy(void *user_context, mtl_blit_command_encoder *encoder,
                               const device_copy &c, uint64_t src_offset, uint64_t dst_offset, int d) {
@@ -749,7 +826,7 @@ WEAK int halide_metal_device_release(void *user_context) {
         halide_metal_device_sync_internal(queue, nullptr);
 
         debug(user_context) << "Calling delete context on device " << acquired_device << "\n";
-        compilation_cache.delete_context(user_context, acquired_device, release_ns_object);
+        compilation_cache.delete_context(user_context, acquired_device, release_library);
 
         // Release the device itself, if we created it.
         if (acquired_device == device) {
@@ -882,16 +959,22 @@ WEAK int halide_metal_run(void *user_context,
         return halide_error_code_generic_error;
     }
 
-    mtl_function *function = new_function_with_name(library, entry_name, strlen(entry_name));
-    if (function == nullptr) {
-        error(user_context) << "Metal: Could not get function " << entry_name << "from Metal library.";
-        return halide_error_code_generic_error;
-    }
+    mtl_compute_pipeline_state *pipeline_state = find_cached_pipeline_state(library, entry_name);
+    if (pipeline_state != nullptr) {
+        retain_ns_object(pipeline_state);
+    } else {
+        mtl_function *function = new_function_with_name(library, entry_name, strlen(entry_name));
+        if (function == nullptr) {
+            error(user_context) << "Metal: Could not get function " << entry_name << "from Metal library.";
+            return halide_error_code_generic_error;
+        }
 
-    mtl_compute_pipeline_state *pipeline_state = new_compute_pipeline_state_with_function(metal_context.device, function);
-    if (pipeline_state == nullptr) {
-        error(user_context) << "Metal: Could not allocate pipeline state.";
-        return halide_error_code_generic_error;
+        pipeline_state = new_compute_pipeline_state_with_function(metal_context.device, function);
+        if (pipeline_state == nullptr) {
+            error(user_context) << "Metal: Could not allocate pipeline state.";
+            return halide_error_code_generic_error;
+        }
+        cache_pipeline_state(library, entry_name, pipeline_state);
     }
 
 #ifdef DEBUG_RUNTIME
@@ -983,13 +1066,30 @@ WEAK int halide_metal_run(void *user_context,
         buffer_index++;
     }
 
+    // Bind the device buffers with as few calls into the encoder as possible
+    const int max_buffers_per_call = 31;  // size of the Metal buffer argument table
+    mtl_buffer *input_buffers[max_buffers_per_call];
+    size_t input_offsets[max_buffers_per_call];
+    size_t input_count = 0;
     for (int i = 0; i < num_kernel_args; i++) {
         if (arg_is_buffer[i]) {
             device_handle *handle = (device_handle *)((halide_buffer_t *)args[i])->device;
-            set_input_buffer(encoder, handle->buf, handle->offset, buffer_index);
-            buffer_index++;
+            input_buffers[input_count] = handle->buf;
+            input_offsets[input_count] = (size_t)handle->offset;
+            input_count++;
+            if (input_count == max_buffers_per_call) {
+                set_input_buffers(encoder, input_buffers, input_offsets, {(size_t)buffer_index, input_count});
+                buffer_index += input_count;
+                input_count = 0;
+            }
         }
     }
+    if (input_count == 1) {
+        set_input_buffer(encoder, input_buffers[0], input_offsets[0], buffer_index);
+    } else if (input_count > 1) {
+        set_input_buffers(encoder, input_buffers, input_offsets, {(size_t)buffer_index, input_count});
+    }
+    buffer_index += input_count;
 
     // Round shared memory size up to a multiple of 16, as required by setThreadgroupMemoryLength.
     shared_mem_bytes = (shared_mem_bytes + 0xF) & ~0xF;
@@ -1017,8 +1117,8 @@ WEAK int halide_metal_run(void *user_context,
 
     // We deliberately don't release the function here; this was causing
     // crashes on Mojave (issues #3395 and #3408).
-    // We're still releasing the pipeline state object, as that seems to not
-    // cause zombied objects.
+    // We're still releasing our reference to the pipeline state object, as
+    // that seems to not cause zombied objects. The cache keeps its own.
     release_ns_object(pipeline_state);
 
 #ifdef DEBUG_RUNTIME
@@ -1283,7 +1383,7 @@ WEAK const struct halide_device_interface_t *halide_metal_device_interface() {
 
 namespace {
 WEAK __attribute__((destructor)) void halide_metal_cleanup() {
-    compilation_cache.release_all(nullptr, release_ns_object);
+    compilation_cache.release_all(nullptr, release_library);
     (void)halide_metal_device_release(nullptr);  // ignore errors
 }
 }  // namespace
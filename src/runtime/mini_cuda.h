@@ -25,6 +25,9 @@ typedef struct CUfunc_st *CUfunction; /**< CUDA function */
 typedef struct CUstream_st *CUstream; /**< CUDA stream */
 typedef struct CUevent_st *CUevent;   /**< CUDA event */
 typedef struct CUarray_st *CUarray;
+typedef struct CUgraph_st *CUgraph;         /**< CUDA graph */
+typedef struct CUgraphExec_st *CUgraphExec; /**< CUDA executable graph */
+typedef struct CUmemPoolHandle_st *CUmemoryPool; /**< CUDA memory pool */
 
 typedef enum CUjit_option_enum {
     CU_JIT_MAX_REGISTERS = 0,
@@ -229,7 +232,54 @@ typedef struct CUDA_MEMCPY3D_st {
     size_t Depth;        /**< Depth of 3D memory copy */
 } CUDA_MEMCPY3D;
 
+typedef enum CUstreamCaptureMode_enum {
+    CU_STREAM_CAPTURE_MODE_GLOBAL = 0,
+    CU_STREAM_CAPTURE_MODE_THREAD_LOCAL = 1,
+    CU_STREAM_CAPTURE_MODE_RELAXED = 2
+} CUstreamCaptureMode;
+
+typedef enum CUmemPool_attribute_enum {
+    CU_MEMPOOL_ATTR_REUSE_FOLLOW_EVENT_DEPENDENCIES = 1,
+    CU_MEMPOOL_ATTR_REUSE_ALLOW_OPPORTUNISTIC = 2,
+    CU_MEMPOOL_ATTR_REUSE_ALLOW_INTERNAL_DEPENDENCIES = 3,
+    CU_MEMPOOL_ATTR_RELEASE_THRESHOLD = 4,
+    CU_MEMPOOL_ATTR_RESERVED_MEM_CURRENT = 5,
+    CU_MEMPOOL_ATTR_RESERVED_MEM_HIGH = 6,
+    CU_MEMPOOL_ATTR_USED_MEM_CURRENT = 7,
+    CU_MEMPOOL_ATTR_USED_MEM_HIGH = 8
+} CUmemPool_attribute;
+
+typedef enum CUmemAllocationType_enum {
+    CU_MEM_ALLOCATION_TYPE_INVALID = 0,
+    CU_MEM_ALLOCATION_TYPE_PINNED = 1
+} CUmemAllocationType;
+
+typedef enum CUmemLocationType_enum {
+    CU_MEM_LOCATION_TYPE_INVALID = 0,
+    CU_MEM_LOCATION_TYPE_DEVICE = 1
+} CUmemLocationType;
+
+typedef struct CUmemLocation_st {
+    CUmemLocationType type;
+    int id;
+} CUmemLocation;
+
+typedef struct CUmemPoolProps_st {
+    CUmemAllocationType allocType;
+    int handleTypes; /**< CUmemAllocationHandleType; 0 for none */
+    CUmemLocation location;
+    void *win32SecurityAttributes;
+    unsigned char reserved[64]; /**< Later fields live here; must be zero */
+} CUmemPoolProps;
+
 #define CU_POINTER_ATTRIBUTE_CONTEXT 1
+#define CU_POINTER_ATTRIBUTE_MEMPOOL_HANDLE 19
+
+#define CU_STREAM_NON_BLOCKING 0x1
+
+#define CU_MEMHOSTALLOC_PORTABLE 0x01
+
+#define CU_EVENT_DISABLE_TIMING 0x2
 
 }  // namespace Cuda
 }  // namespace Internal
@@ -5660,6 +5660,103 @@ interface ID3D12DescriptorHeap {
 
 #endif /* __ID3D12DescriptorHeap_INTERFACE_DEFINED__ */
 
+#ifndef __ID3D12Heap_INTERFACE_DEFINED__
+#define __ID3D12Heap_INTERFACE_DEFINED__
+
+/* interface ID3D12Heap */
+/* [unique][local][object][uuid] */
+
+EXTERN_C const IID IID_ID3D12Heap;
+
+#if defined(__cplusplus) && !defined(CINTERFACE)
+
+MIDL_INTERFACE("6b3b2502-6e51-45b3-90ee-9884265e8df3")
+ID3D12Heap : public ID3D12Pageable{
+    public :
+        virtual D3D12_HEAP_DESC STDMETHODCALLTYPE GetDesc(void) = 0;
+};
+
+#else /* C style interface */
+
+typedef struct ID3D12HeapVtbl {
+    BEGIN_INTERFACE
+
+    HRESULT(STDMETHODCALLTYPE *QueryInterface)
+    (
+        ID3D12Heap *This,
+        REFIID riid,
+        _COM_Outptr_ void **ppvObject);
+
+    ULONG(STDMETHODCALLTYPE *AddRef)
+    (
+        ID3D12Heap *This);
+
+    ULONG(STDMETHODCALLTYPE *Release)
+    (
+        ID3D12Heap *This);
+
+    HRESULT(STDMETHODCALLTYPE *GetPrivateData)
+    (
+        ID3D12Heap *This,
+        _In_ REFGUID guid,
+        _Inout_ UINT *pDataSize,
+        _Out_writes_bytes_opt_(*pDataSize) void *pData);
+
+    HRESULT(STDMETHODCALLTYPE *SetPrivateData)
+    (
+        ID3D12Heap *This,
+        _In_ REFGUID guid,
+        _In_ UINT DataSize,
+        _In_reads_bytes_opt_(DataSize) const void *pData);
+
+    HRESULT(STDMETHODCALLTYPE *SetPrivateDataInterface)
+    (
+        ID3D12Heap *This,
+        _In_ REFGUID guid,
+        _In_opt_ const IUnknown *pData);
+
+    HRESULT(STDMETHODCALLTYPE *SetName)
+    (
+        ID3D12Heap *This,
+        _In_z_ LPCWSTR Name);
+
+    HRESULT(STDMETHODCALLTYPE *GetDevice)
+    (
+        ID3D12Heap *This,
+        REFIID riid,
+        _COM_Outptr_opt_ void **ppvDevice);
+
+    D3D12_HEAP_DESC *(STDMETHODCALLTYPE *GetDesc)(
+        ID3D12Heap *This,
+        D3D12_HEAP_DESC *RetVal);
+
+    END_INTERFACE
+} ID3D12HeapVtbl;
+
+interface ID3D12Heap {
+    CONST_VTBL struct ID3D12HeapVtbl *lpVtbl;
+};
+
+#ifdef COBJMACROS
+
+#define ID3D12Heap_QueryInterface(This, riid, ppvObject) \
+    ((This)->lpVtbl->QueryInterface(This, riid, ppvObject))
+
+#define ID3D12Heap_AddRef(This) \
+    ((This)->lpVtbl->AddRef(This))
+
+#define ID3D12Heap_Release(This) \
+    ((This)->lpVtbl->Release(This))
+
+#define ID3D12Heap_GetDesc(This, RetVal) \
+    ((This)->lpVtbl->GetDesc(This, RetVal))
+
+#endif /* COBJMACROS */
+
+#endif /* C style interface */
+
+#endif /* __ID3D12Heap_INTERFACE_DEFINED__ */
+
 #ifndef __ID3D12QueryHeap_INTERFACE_DEFINED__
 #define __ID3D12QueryHeap_INTERFACE_DEFINED__
 
@@ -103,6 +103,10 @@ WEAK char build_options[1024];
 WEAK ScopedSpinLock::AtomicFlag build_options_lock = 0;
 WEAK bool build_options_initialized = false;
 
+WEAK char program_cache_dir[1024];
+WEAK ScopedSpinLock::AtomicFlag program_cache_dir_lock = 0;
+WEAK bool program_cache_dir_initialized = false;
+
 template<typename... Args>
 halide_error_code_t error_opencl(void *user_context, cl_int cl_error, const Args &...args) {
     if (cl_error == CL_SUCCESS) {
@@ -179,6 +183,25 @@ const char *halide_opencl_get_build_options_internal(void *user_context) {
     }
     return build_options;
 }
+
+void halide_opencl_set_program_cache_dir_internal(const char *n) {
+    if (n) {
+        size_t buffer_size = sizeof(program_cache_dir) / sizeof(program_cache_dir[0]);
+        strncpy(program_cache_dir, n, buffer_size);
+        program_cache_dir[buffer_size - 1] = 0;
+    } else {
+        program_cache_dir[0] = 0;
+    }
+    program_cache_dir_initialized = true;
+}
+
+const char *halide_opencl_get_program_cache_dir_internal(void *user_context) {
+    if (!program_cache_dir_initialized) {
+        const char *name = getenv("HL_OCL_PROGRAM_CACHE_DIR");
+        halide_opencl_set_program_cache_dir_internal(name);
+    }
+    return program_cache_dir;
+}
 }  // namespace
 
 extern "C" {
@@ -213,6 +236,16 @@ WEAK const char *halide_opencl_get_build_options(void *user_context) {
     return halide_opencl_get_build_options_internal(user_context);
 }
 
+WEAK void halide_opencl_set_program_cache_dir(const char *n) {
+    ScopedSpinLock lock(&program_cache_dir_lock);
+    halide_opencl_set_program_cache_dir_internal(n);
+}
+
+WEAK const char *halide_opencl_get_program_cache_dir(void *user_context) {
+    ScopedSpinLock lock(&program_cache_dir_lock);
+    return halide_opencl_get_program_cache_dir_internal(user_context);
+}
+
 // The default implementation of halide_acquire_cl_context uses the global
 // pointers above, and serializes access with a spin lock.
 // Overriding implementations of acquire/release must implement the following
@@ -566,6 +599,121 @@ WEAK int create_opencl_context(void *user_context, cl_context *ctx, cl_command_q
     return halide_error_code_success;
 }
 
+// Program binaries cached on disk start with this header. The key is a
+// hash of everything that affects the generated binary.
+struct program_cache_header {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t key;
+    uint64_t binary_size;
+};
+
+static constexpr uint32_t program_cache_magic = 0x4c43484c;  // "HLCL"
+static constexpr uint32_t program_cache_version = 1;
+
+WEAK uint64_t program_cache_hash(uint64_t hash, const void *data, size_t size) {
+    // 64-bit FNV-1a
+    const uint8_t *bytes = (const uint8_t *)data;
+    for (size_t i = 0; i < size; i++) {
+        hash = (hash ^ bytes[i]) * 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+WEAK uint64_t program_cache_key(void *user_context, cl_device_id dev, const char *options, const char *src, int size) {
+    uint64_t key = 0xcbf29ce484222325ULL;
+    const cl_device_info infos[] = {CL_DEVICE_VENDOR, CL_DEVICE_NAME, CL_DEVICE_VERSION, CL_DRIVER_VERSION};
+    for (cl_device_info info : infos) {
+        char value[256];
+        size_t value_size = 0;
+        if (clGetDeviceInfo(dev, info, sizeof(value), value, &value_size) != CL_SUCCESS) {
+            value_size = 0;
+        }
+        key = program_cache_hash(key, value, value_size < sizeof(value) ? value_size : sizeof(value));
+    }
+    key = program_cache_hash(key, options, strlen(options) + 1);
+    key = program_cache_hash(key, src, size);
+    return key;
+}
+
+WEAK cl_program load_cached_program(void *user_context, cl_context ctx, cl_device_id dev,
+                                    const char *path, uint64_t key, const char *options) {
+    void *f = halide_fopen(path, "rb");
+    if (!f) {
+        return nullptr;
+    }
+
+    program_cache_header header;
+    unsigned char *binary = nullptr;
+    if (fread(&header, sizeof(header), 1, f) == 1 &&
+        header.magic == program_cache_magic &&
+        header.version == program_cache_version &&
+        header.key == key &&
+        header.binary_size > 0) {
+        binary = (unsigned char *)malloc(header.binary_size);
+        if (binary && fread(binary, 1, header.binary_size, f) != header.binary_size) {
+            free(binary);
+            binary = nullptr;
+        }
+    }
+    fclose(f);
+    if (!binary) {
+        debug(user_context) << "    ignoring stale or truncated program cache " << path << "\n";
+        return nullptr;
+    }
+
+    cl_int err = CL_SUCCESS, binary_status = CL_SUCCESS;
+    size_t binary_size = header.binary_size;
+    const unsigned char *binaries[] = {binary};
+    debug(user_context) << "    clCreateProgramWithBinary (" << path << ") -> ";
+    cl_program program = clCreateProgramWithBinary(ctx, 1, &dev, &binary_size, binaries, &binary_status, &err);
+    free(binary);
+    if (err != CL_SUCCESS || binary_status != CL_SUCCESS) {
+        debug(user_context) << get_opencl_error_name(err != CL_SUCCESS ? err : binary_status) << "\n";
+        if (program) {
+            clReleaseProgram(program);
+        }
+        return nullptr;
+    }
+    debug(user_context) << (void *)program << "\n";
+
+    // Programs created from binaries still have to be built, but the
+    // driver skips compiling the source.
+    err = clBuildProgram(program, 1, &dev, options, nullptr, nullptr);
+    if (err != CL_SUCCESS) {
+        debug(user_context) << "    clBuildProgram of cached binary failed: " << get_opencl_error_name(err) << "\n";
+        clReleaseProgram(program);
+        return nullptr;
+    }
+    return program;
+}
+
+WEAK void save_cached_program(void *user_context, cl_program program, const char *path, uint64_t key) {
+    size_t binary_size = 0;
+    cl_int err = clGetProgramInfo(program, CL_PROGRAM_BINARY_SIZES, sizeof(binary_size), &binary_size, nullptr);
+    if (err != CL_SUCCESS || binary_size == 0) {
+        return;
+    }
+
+    unsigned char *binary = (unsigned char *)malloc(binary_size);
+    if (!binary) {
+        return;
+    }
+    unsigned char *binaries[] = {binary};
+    err = clGetProgramInfo(program, CL_PROGRAM_BINARIES, sizeof(binaries), binaries, nullptr);
+    if (err == CL_SUCCESS) {
+        void *f = halide_fopen(path, "wb");
+        if (f) {
+            program_cache_header header = {program_cache_magic, program_cache_version, key, binary_size};
+            bool ok = fwrite(&header, sizeof(header), 1, f) == 1 &&
+                      fwrite(binary, 1, binary_size, f) == binary_size;
+            fclose(f);
+            debug(user_context) << "    " << (ok ? "saved" : "failed to save") << " program cache " << path << "\n";
+        }
+    }
+    free(binary);
+}
+
 WEAK cl_program compile_kernel(void *user_context, cl_context ctx, const char *src, int size) {
     cl_int err = 0;
     cl_device_id dev;
@@ -604,6 +752,19 @@ WEAK cl_program compile_kernel(void *user_context, cl_context ctx, const char *s
     const char *extra_options = halide_opencl_get_build_options(user_context);
     options << " " << extra_options;
 
+    // Try to skip compiling the source by using a binary from an earlier run.
+    stringstream cache_path(user_context);
+    uint64_t cache_key = 0;
+    const char *cache_dir = halide_opencl_get_program_cache_dir(user_context);
+    if (cache_dir && *cache_dir) {
+        cache_key = program_cache_key(user_context, dev, options.str(), src, size);
+        cache_path << cache_dir << "/halide_opencl_" << cache_key << ".bin";
+        cl_program program = load_cached_program(user_context, ctx, dev, cache_path.str(), cache_key, options.str());
+        if (program) {
+            return program;
+        }
+    }
+
     const char *sources[] = {src};
     debug(user_context) << "    clCreateProgramWithSource -> ";
     cl_program program = clCreateProgramWithSource(ctx, 1, &sources[0], nullptr, &err);
@@ -651,6 +812,10 @@ WEAK cl_program compile_kernel(void *user_context, cl_context ctx, const char *s
         return nullptr;
     }
 
+    if (cache_dir && *cache_dir) {
+        save_cached_program(user_context, program, cache_path.str(), cache_key);
+    }
+
     return program;
 }
 
@@ -1644,7 +1809,7 @@ WEAK int halide_opencl_image_device_malloc(void *user_context, halide_buffer_t *
     }
     desc.image_width = buf->dim[0].extent;
     desc.image_height = buf->dimensions >= 2 ? buf->dim[1].extent : 1;
-    desc.image_depth = buf->dimensions >= 3 ? buf->dim[1].extent : 1;
+    desc.image_depth = buf->dimensions >= 3 ? buf->dim[2].extent : 1;
     desc.image_array_size = 1;
     desc.image_row_pitch = 0;
     desc.image_slice_pitch = 0;
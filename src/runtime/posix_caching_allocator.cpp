@@ -0,0 +1,270 @@
+#include "HalideRuntime.h"
+#include "runtime_atomics.h"
+#include "runtime_internal.h"
+#include "scoped_mutex_lock.h"
+
+extern "C" {
+
+typedef unsigned int pthread_key_t;
+
+extern int pthread_key_create(pthread_key_t *key, void (*destructor)(void *));
+extern int pthread_setspecific(pthread_key_t key, const void *value);
+extern void *pthread_getspecific(pthread_key_t key);
+
+}  // extern "C"
+
+namespace Halide {
+namespace Runtime {
+namespace Internal {
+namespace CachingAllocator {
+
+// Allocations of up to kMaxCachedSize bytes are rounded up to one of
+// kNumSizeClasses sizes: 64, 128, 192 and 256 bytes, and then four per
+// power of two. Larger allocations go straight to halide_default_malloc.
+constexpr int kNumSizeClasses = 32;
+constexpr size_t kMaxCachedSize = 32 * 1024;
+
+// The size class stored in the header of an allocation that isn't from
+// a slab.
+constexpr uint32_t kUncachedSizeClass = 0xffffffff;
+
+// Each thread caches up to this many bytes of free blocks of each size
+// class, and at least kMinCachedBlocks of them. The excess is returned to
+// a free list shared by all threads.
+constexpr size_t kMaxThreadCacheBytes = 256 * 1024;
+constexpr int kMinCachedBlocks = 4;
+
+// The blocks of a size class are carved out of slabs of at least this
+// many bytes.
+constexpr size_t kMinSlabSize = 64 * 1024;
+
+ALWAYS_INLINE int size_class_of(size_t size) {
+    if (size <= 64) {
+        return 0;
+    } else if (size <= 256) {
+        return (int)((size - 1) / 64);
+    }
+    // size is in (2^g, 2^(g+1)], which is split into four classes.
+    const int g = 63 - __builtin_clzll((uint64_t)(size - 1));
+    const size_t step = (size_t)1 << (g - 2);
+    const int m = (int)((size - ((size_t)1 << g) + step - 1) / step);
+    return 4 + (g - 8) * 4 + (m - 1);
+}
+
+ALWAYS_INLINE size_t size_of_class(int c) {
+    if (c < 4) {
+        return (size_t)(c + 1) * 64;
+    }
+    const int g = (c - 4) / 4 + 8;
+    const int m = (c - 4) % 4 + 1;
+    return ((size_t)1 << g) + m * ((size_t)1 << (g - 2));
+}
+
+ALWAYS_INLINE int max_cached_blocks(int c) {
+    return max(kMinCachedBlocks, (int)(kMaxThreadCacheBytes / size_of_class(c)));
+}
+
+// Every allocation is preceded by a header of the malloc alignment,
+// which is what halide_default_malloc pads allocations by too. The size
+// class is stored in its last four bytes.
+ALWAYS_INLINE uint32_t &size_class_header(void *ptr) {
+    return ((uint32_t *)ptr)[-1];
+}
+
+// Free blocks are kept in intrusive lists, linked through their
+// payloads.
+struct FreeBlock {
+    FreeBlock *next;
+};
+
+struct FreeList {
+    FreeBlock *head;
+    int count;
+
+    ALWAYS_INLINE void push(FreeBlock *b) {
+        b->next = head;
+        head = b;
+        count++;
+    }
+
+    ALWAYS_INLINE FreeBlock *pop() {
+        FreeBlock *b = head;
+        if (b) {
+            head = b->next;
+            count--;
+        }
+        return b;
+    }
+
+    // Move up to n blocks from the front of this list to the front of
+    // dst.
+    ALWAYS_INLINE void move_to(FreeList *dst, int n) {
+        while (n-- > 0 && head) {
+            dst->push(pop());
+        }
+    }
+};
+
+struct ThreadCache {
+    FreeList lists[kNumSizeClasses];
+};
+
+struct SharedList {
+    halide_mutex lock;
+    FreeList list;
+};
+
+WEAK SharedList shared_lists[kNumSizeClasses];
+
+WEAK halide_mutex thread_cache_key_lock;
+WEAK pthread_key_t thread_cache_key;
+// Zero until the key is created, then one, or minus one if creating it
+// failed, in which case every thread uses the shared lists directly.
+WEAK int thread_cache_key_state = 0;
+
+WEAK void release_thread_cache(void *arg) {
+    ThreadCache *cache = (ThreadCache *)arg;
+    for (int c = 0; c < kNumSizeClasses; c++) {
+        if (cache->lists[c].head) {
+            ScopedMutexLock lock(&shared_lists[c].lock);
+            cache->lists[c].move_to(&shared_lists[c].list, cache->lists[c].count);
+        }
+    }
+    free(cache);
+}
+
+WEAK ThreadCache *get_thread_cache() {
+    using namespace Synchronization;
+
+    int state;
+    atomic_load_acquire(&thread_cache_key_state, &state);
+    if (state == 0) {
+        ScopedMutexLock lock(&thread_cache_key_lock);
+        if (thread_cache_key_state == 0) {
+            int result = pthread_key_create(&thread_cache_key, release_thread_cache) == 0 ? 1 : -1;
+            atomic_store_release(&thread_cache_key_state, &result);
+        }
+        state = thread_cache_key_state;
+    }
+    if (state < 0) {
+        return nullptr;
+    }
+
+    ThreadCache *cache = (ThreadCache *)pthread_getspecific(thread_cache_key);
+    if (!cache) {
+        cache = (ThreadCache *)malloc(sizeof(ThreadCache));
+        if (!cache) {
+            return nullptr;
+        }
+        memset(cache, 0, sizeof(ThreadCache));
+        if (pthread_setspecific(thread_cache_key, cache) != 0) {
+            free(cache);
+            return nullptr;
+        }
+    }
+    return cache;
+}
+
+// Carve a new slab into blocks of size class c, and add them to dst. The
+// caller must hold the lock of dst if it's shared. Slabs are never freed.
+WEAK bool add_slab(void *user_context, int c, FreeList *dst) {
+    const size_t alignment = ::halide_internal_malloc_alignment();
+    const size_t stride = alignment + align_up(size_of_class(c), alignment);
+    const int num_blocks = max(kMinCachedBlocks, (int)(kMinSlabSize / stride));
+    // Pad the end so that it's safe to read a little past the last block.
+    char *slab = (char *)halide_default_malloc(user_context, num_blocks * stride + alignment);
+    if (!slab) {
+        return false;
+    }
+    for (int i = num_blocks - 1; i >= 0; i--) {
+        char *ptr = slab + i * stride + alignment;
+        size_class_header(ptr) = (uint32_t)c;
+        dst->push((FreeBlock *)ptr);
+    }
+    return true;
+}
+
+}  // namespace CachingAllocator
+}  // namespace Internal
+}  // namespace Runtime
+}  // namespace Halide
+
+using namespace Halide::Runtime::Internal::CachingAllocator;
+
+extern "C" {
+
+WEAK void *halide_caching_malloc(void *user_context, size_t x) {
+    if (x > kMaxCachedSize) {
+        const size_t alignment = ::halide_internal_malloc_alignment();
+        char *block = (char *)halide_default_malloc(user_context, x + alignment);
+        if (!block) {
+            return nullptr;
+        }
+        char *ptr = block + alignment;
+        size_class_header(ptr) = kUncachedSizeClass;
+        return ptr;
+    }
+
+    const int c = size_class_of(x);
+    ThreadCache *cache = get_thread_cache();
+    if (!cache) {
+        SharedList &shared = shared_lists[c];
+        ScopedMutexLock lock(&shared.lock);
+        if (!shared.list.head && !add_slab(user_context, c, &shared.list)) {
+            return nullptr;
+        }
+        return shared.list.pop();
+    }
+
+    FreeList &list = cache->lists[c];
+    if (!list.head) {
+        // Take a batch of blocks from the shared list, or from a new slab
+        // if it's empty.
+        SharedList &shared = shared_lists[c];
+        ScopedMutexLock lock(&shared.lock);
+        shared.list.move_to(&list, max_cached_blocks(c) / 2);
+        if (!list.head && !add_slab(user_context, c, &list)) {
+            return nullptr;
+        }
+    }
+    return list.pop();
+}
+
+WEAK void halide_caching_free(void *user_context, void *ptr) {
+    if (!ptr) {
+        return;
+    }
+    const uint32_t c = size_class_header(ptr);
+    if (c == kUncachedSizeClass) {
+        const size_t alignment = ::halide_internal_malloc_alignment();
+        halide_default_free(user_context, (char *)ptr - alignment);
+        return;
+    }
+    halide_debug_assert(user_context, c < (uint32_t)kNumSizeClasses);
+
+    ThreadCache *cache = get_thread_cache();
+    if (!cache) {
+        SharedList &shared = shared_lists[c];
+        ScopedMutexLock lock(&shared.lock);
+        shared.list.push((FreeBlock *)ptr);
+        return;
+    }
+
+    FreeList &list = cache->lists[c];
+    list.push((FreeBlock *)ptr);
+    const int max_blocks = max_cached_blocks(c);
+    if (list.count > max_blocks) {
+        // Give half of them back, so that a thread that frees what
+        // others allocated doesn't hoard blocks.
+        SharedList &shared = shared_lists[c];
+        ScopedMutexLock lock(&shared.lock);
+        list.move_to(&shared.list, max_blocks / 2);
+    }
+}
+
+WEAK void halide_use_caching_allocator() {
+    halide_set_custom_malloc(halide_caching_malloc);
+    halide_set_custom_free(halide_caching_free);
+}
+
+}  // extern "C"
@@ -23,6 +23,16 @@ WEAK halide_profiler_state *halide_profiler_get_state() {
     return &s;
 }
 
+#ifdef WINDOWS
+#ifdef BITS_64
+extern "C" unsigned long GetCurrentThreadId();
+#else
+extern "C" __stdcall unsigned long GetCurrentThreadId();
+#endif
+#else
+extern "C" long pthread_self();
+#endif
+
 #if TIMER_PROFILING
 extern "C" void halide_start_timer_chain();
 extern "C" void halide_disable_timer_interrupt();
@@ -107,6 +117,10 @@ WEAK halide_profiler_pipeline_stats *find_or_create_pipeline(const char *pipelin
         p->funcs[i].stack_peak = 0;
         p->funcs[i].active_threads_numerator = 0;
         p->funcs[i].active_threads_denominator = 0;
+        p->funcs[i].cycles = 0;
+        p->funcs[i].instructions = 0;
+        p->funcs[i].llc_misses = 0;
+        p->funcs[i].gpu_time = 0;
     }
     s->pipelines = p;
     return p;
@@ -174,6 +188,207 @@ WEAK void sampling_profiler_thread(void *) {
     halide_mutex_unlock(&s->lock);
 }
 
+// The timeline mode, enabled by setting HL_PROFILER_TIMELINE to the name of
+// a file, records when each thread starts and stops working on a pipeline,
+// and when it switches Func, in a ring buffer per thread. The buffers are
+// written out as a Chrome trace (which Perfetto can also read) at shutdown.
+struct TimelineEvent {
+    uint64_t time;
+    halide_profiler_pipeline_stats *pipeline;
+    int func;
+    int kind;
+};
+
+// What the profiler tracks per thread, for the timeline and the
+// performance counters. Only the owning thread writes to it while
+// pipelines are running.
+struct ProfilerThread {
+    // The id of the thread that owns this state, or zero if it's unused.
+    uintptr_t owner;
+    // The number of events ever recorded. Only the last timeline_capacity
+    // are kept.
+    uint64_t count;
+    TimelineEvent *events;
+
+    // The handle of the thread's performance counters, or -1 if they
+    // couldn't be opened.
+    int perf_counters;
+    // Whether the thread is working on a pipeline.
+    bool active;
+    // The Func the thread is working on, which counts are billed to, or
+    // null if it's idle.
+    halide_profiler_func_stats *perf_func;
+    // The counts at the last event.
+    uint64_t perf_counts[halide_perf_counter_count];
+};
+
+constexpr int kMaxProfilerThreads = 256;
+
+WEAK ProfilerThread profiler_threads[kMaxProfilerThreads];
+// The number of events kept per thread, or zero if not recording.
+WEAK uint64_t timeline_capacity = 0;
+WEAK const char *timeline_file_name = nullptr;
+WEAK bool thread_events_initialized = false;
+// The number of events dropped because the buffers ran out.
+WEAK uint64_t timeline_dropped = 0;
+// Whether to count cycles, instructions and cache misses per Func. Set by
+// HL_PROFILER_PERF_COUNTERS=1.
+WEAK bool count_perf_events = false;
+
+// Must be called with the profiler lock held.
+WEAK void init_thread_events() {
+    if (thread_events_initialized) {
+        return;
+    }
+    thread_events_initialized = true;
+    timeline_file_name = getenv("HL_PROFILER_TIMELINE");
+    if (timeline_file_name && *timeline_file_name) {
+        const char *events_str = getenv("HL_PROFILER_TIMELINE_EVENTS");
+        int events = events_str ? atoi(events_str) : 0;
+        timeline_capacity = events > 0 ? events : 16384;
+    }
+    const char *perf_str = getenv("HL_PROFILER_PERF_COUNTERS");
+    count_perf_events = perf_str && atoi(perf_str) != 0;
+}
+
+ALWAYS_INLINE uintptr_t current_thread_id() {
+#ifdef WINDOWS
+    return (uintptr_t)GetCurrentThreadId() + 1;
+#else
+    return (uintptr_t)pthread_self();
+#endif
+}
+
+// Find or claim the buffer of the calling thread, without taking a lock.
+WEAK ProfilerThread *find_profiler_thread() {
+    using namespace Halide::Runtime::Internal::Synchronization;
+
+    uintptr_t id = current_thread_id();
+    uintptr_t h = (id ^ (id >> 12)) * 0x9e3779b1;
+    for (int i = 0; i < kMaxProfilerThreads; i++) {
+        ProfilerThread *t = profiler_threads + ((h + i) % kMaxProfilerThreads);
+        uintptr_t owner;
+        atomic_load_acquire(&t->owner, &owner);
+        if (owner == id) {
+            return t;
+        } else if (owner == 0) {
+            uintptr_t expected = 0;
+            if (atomic_cas_strong_sequentially_consistent(&t->owner, &expected, &id)) {
+                t->count = 0;
+                t->events = nullptr;
+                if (timeline_capacity > 0) {
+                    t->events = (TimelineEvent *)malloc(timeline_capacity * sizeof(TimelineEvent));
+                }
+                t->perf_counters = count_perf_events ? halide_open_perf_counters() : -1;
+                t->active = false;
+                t->perf_func = nullptr;
+                if (t->perf_counters >= 0 && !halide_read_perf_counters(t->perf_counters, t->perf_counts)) {
+                    t->perf_counters = -1;
+                }
+                return t;
+            }
+        }
+    }
+    return nullptr;
+}
+
+WEAK void write_timestamp(PrinterBase &out, uint64_t ns) {
+    // Chrome traces are in microseconds.
+    uint64_t frac = ns % 1000;
+    out << ns / 1000 << (frac < 100 ? (frac < 10 ? ".00" : ".0") : ".") << frac;
+}
+
+// Must be called when no pipelines are running.
+WEAK int write_timeline_unlocked(void *user_context, const char *file_name) {
+    void *f = halide_fopen(file_name, "w");
+    if (!f) {
+        error(user_context) << "Could not open profiler timeline file " << file_name;
+        return halide_error_code_generic_error;
+    }
+
+    StringStreamPrinter<4096> out(user_context);
+    bool first = true;
+    bool ok = true;
+    const auto flush = [&](bool force) {
+        if (force || out.size() > 3072) {
+            ok = ok && fwrite(out.str(), 1, out.size(), f) == out.size();
+            out.clear();
+        }
+    };
+    const auto emit_slice = [&](const char *name, const char *category, uint64_t start, uint64_t end, int tid) {
+        out << (first ? "\n" : ",\n")
+            << "{\"name\":\"" << name << "\",\"cat\":\"" << category << "\",\"ph\":\"X\",\"ts\":";
+        write_timestamp(out, start);
+        out << ",\"dur\":";
+        write_timestamp(out, end - start);
+        out << ",\"pid\":0,\"tid\":" << tid << "}";
+        first = false;
+        flush(false);
+    };
+
+    out << "{\"traceEvents\":[";
+    int tid = 0;
+    for (ProfilerThread &t : profiler_threads) {
+        if (!t.owner || !t.events || !t.count) {
+            continue;
+        }
+        out << (first ? "\n" : ",\n")
+            << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << tid
+            << ",\"args\":{\"name\":\"thread " << tid << "\"}}";
+        first = false;
+
+        // The Func slices are nested inside the slices in which the thread
+        // was working on a pipeline. Func switches while the thread is idle
+        // are ignored.
+        bool active = true;
+        const TimelineEvent *func_start = nullptr;
+        const TimelineEvent *task_start = nullptr;
+        uint64_t begin = t.count > timeline_capacity ? t.count - timeline_capacity : 0;
+        for (uint64_t i = begin; i < t.count; i++) {
+            const TimelineEvent *e = t.events + (i % timeline_capacity);
+            if (func_start) {
+                if (func_start->func >= 0 && func_start->func < func_start->pipeline->num_funcs) {
+                    emit_slice(func_start->pipeline->funcs[func_start->func].name, "func",
+                               func_start->time, e->time, tid);
+                }
+                func_start = nullptr;
+            }
+            if (e->kind == halide_profiler_event_func) {
+                if (active) {
+                    func_start = e;
+                }
+            } else if (e->kind == halide_profiler_event_active) {
+                active = true;
+                task_start = e;
+            } else {
+                if (task_start) {
+                    emit_slice(task_start->pipeline->name, "task", task_start->time, e->time, tid);
+                    task_start = nullptr;
+                }
+                active = false;
+            }
+        }
+        tid++;
+    }
+    out << "\n],\"otherData\":{\"dropped_events\":" << timeline_dropped << "}}\n";
+    flush(true);
+    ok = (fclose(f) == 0) && ok;
+    if (!ok) {
+        error(user_context) << "Could not write profiler timeline file " << file_name;
+        return halide_error_code_generic_error;
+    }
+    return 0;
+}
+
+// Must be called when no pipelines are running.
+WEAK void reset_timeline_unlocked() {
+    // The events refer to the pipeline stats, so they go too.
+    for (ProfilerThread &t : profiler_threads) {
+        t.count = 0;
+    }
+    timeline_dropped = 0;
+}
+
 }  // namespace Internal
 }  // namespace Runtime
 }  // namespace Halide
@@ -263,6 +478,9 @@ WEAK int halide_profiler_instance_start(void *user_context,
         // Tell the instance the pipeline to which it belongs.
         instance->pipeline_stats = p;
 
+        init_thread_events();
+        instance->thread_events = timeline_capacity > 0 || count_perf_events;
+
         if (!s->sampling_thread) {
 #if TIMER_PROFILING
             halide_start_clock(user_context);
@@ -327,6 +545,10 @@ WEAK int halide_profiler_instance_end(void *user_context, halide_profiler_instan
             func->stack_peak = max(func->stack_peak, instance_func->stack_peak);
             func->memory_peak = max(func->memory_peak, instance_func->memory_peak);
             func->memory_total += instance_func->memory_total;
+            func->cycles += instance_func->cycles;
+            func->instructions += instance_func->instructions;
+            func->llc_misses += instance_func->llc_misses;
+            func->gpu_time += instance_func->gpu_time;
         }
     }
 
@@ -338,6 +560,62 @@ WEAK int halide_profiler_instance_end(void *user_context, halide_profiler_instan
     return 0;
 }
 
+WEAK int halide_profiler_thread_event(halide_profiler_instance_state *instance, int kind, int func) {
+    using namespace Halide::Runtime::Internal::Synchronization;
+
+    uint64_t time = halide_current_time_ns(nullptr);
+    ProfilerThread *t = find_profiler_thread();
+    if (!t) {
+        atomic_fetch_add_sequentially_consistent(&timeline_dropped, (uint64_t)1);
+        return 0;
+    }
+
+    if (t->perf_counters >= 0) {
+        // Bill the counts since the last event to the Func the thread was
+        // working on. Func switches while idle don't count.
+        uint64_t counts[halide_perf_counter_count];
+        if (halide_read_perf_counters(t->perf_counters, counts)) {
+            if (halide_profiler_func_stats *f = t->perf_func) {
+                atomic_add_fetch_sequentially_consistent(&f->cycles, counts[halide_perf_counter_cycles] - t->perf_counts[halide_perf_counter_cycles]);
+                atomic_add_fetch_sequentially_consistent(&f->instructions, counts[halide_perf_counter_instructions] - t->perf_counts[halide_perf_counter_instructions]);
+                atomic_add_fetch_sequentially_consistent(&f->llc_misses, counts[halide_perf_counter_llc_misses] - t->perf_counts[halide_perf_counter_llc_misses]);
+            }
+            memcpy(t->perf_counts, counts, sizeof(counts));
+        }
+    }
+    if (kind == halide_profiler_event_func) {
+        if (t->active && func >= 0 && func < instance->pipeline_stats->num_funcs) {
+            t->perf_func = instance->funcs + func;
+        }
+    } else {
+        // The Func is set right after a thread becomes active.
+        t->active = kind == halide_profiler_event_active;
+        t->perf_func = nullptr;
+    }
+
+    if (t->events) {
+        TimelineEvent *e = t->events + (t->count % timeline_capacity);
+        e->time = time;
+        e->pipeline = instance->pipeline_stats;
+        e->func = func;
+        e->kind = kind;
+    } else if (timeline_capacity > 0) {
+        atomic_fetch_add_sequentially_consistent(&timeline_dropped, (uint64_t)1);
+    }
+    t->count++;
+    return 0;
+}
+
+WEAK int halide_profiler_write_timeline(void *user_context, const char *file_name) {
+    halide_profiler_state *s = halide_profiler_get_state();
+    LockProfiler lock(s);
+    if (s->instances) {
+        error(user_context) << "Can't write the profiler timeline while pipelines are running";
+        return halide_error_code_generic_error;
+    }
+    return write_timeline_unlocked(user_context, file_name);
+}
+
 WEAK void halide_profiler_stack_peak_update(void *user_context,
                                             halide_profiler_instance_state *instance,
                                             uint64_t *f_values) {
@@ -355,6 +633,15 @@ WEAK void halide_profiler_stack_peak_update(void *user_context,
     }
 }
 
+WEAK int halide_profiler_gpu_time(halide_profiler_instance_state *instance, int func_id, uint64_t time) {
+    using namespace Halide::Runtime::Internal::Synchronization;
+
+    if (time > 0 && func_id >= 0 && func_id < instance->pipeline_stats->num_funcs) {
+        atomic_add_fetch_sequentially_consistent(&instance->funcs[func_id].gpu_time, time);
+    }
+    return 0;
+}
+
 WEAK void halide_profiler_memory_allocate(void *user_context,
                                           halide_profiler_instance_state *instance,
                                           int func_id,
@@ -631,6 +918,20 @@ WEAK void halide_profiler_report_unlocked(void *user_context, halide_profiler_st
                 if (fs->stack_peak > 0) {
                     sstr << " stack: " << fs->stack_peak;
                 }
+                if (fs->gpu_time > 0) {
+                    sstr << " gpu: " << fs->gpu_time / 1000000.0f;
+                    sstr.erase(3);
+                    sstr << "ms";
+                }
+                if (fs->cycles > 0) {
+                    // Each cache miss moves a 64-byte line.
+                    float ipc = (float)fs->instructions / fs->cycles;
+                    float bytes_per_cycle = 64.0f * fs->llc_misses / fs->cycles;
+                    sstr << " ipc: " << ipc;
+                    sstr.erase(4);
+                    sstr << " bytes/cycle: " << bytes_per_cycle;
+                    sstr.erase(4);
+                }
                 sstr << "\n";
 
                 halide_print(user_context, sstr.str());
@@ -701,6 +1002,7 @@ WEAK void halide_profiler_report(void *user_context) {
 }
 
 WEAK void halide_profiler_reset_unlocked(halide_profiler_state *s) {
+    reset_timeline_unlocked();
     while (s->pipelines) {
         halide_profiler_pipeline_stats *p = s->pipelines;
         s->pipelines = (halide_profiler_pipeline_stats *)(p->next);
@@ -755,6 +1057,9 @@ halide_profiler_shutdown() {
     // Print results. No need to lock anything because we just shut
     // down the thread.
     halide_profiler_report_unlocked(nullptr, s);
+    if (timeline_capacity > 0) {
+        (void)write_timeline_unlocked(nullptr, timeline_file_name);
+    }
 
     halide_profiler_reset_unlocked(s);
 }
@@ -777,6 +1082,9 @@ WEAK void halide_windows_profiler_shutdown() {
     // Print results. Avoid locking as it will cause problems and
     // nothing should be running.
     halide_profiler_report_unlocked(nullptr, s);
+    if (timeline_capacity > 0) {
+        (void)write_timeline_unlocked(nullptr, timeline_file_name);
+    }
 }
 #endif
 }  // namespace
@@ -4,6 +4,11 @@
 extern "C" {
 
 WEAK_INLINE int halide_profiler_set_current_func(halide_profiler_instance_state *instance, int func, int *sampling_token) {
+    if (instance->thread_events) {
+        // Every thread records its own switches, whether or not it holds
+        // the sampling token.
+        halide_profiler_thread_event(instance, halide_profiler_event_func, func);
+    }
     if (sampling_token == nullptr || *sampling_token == 0) {
 
         // Use empty volatile asm blocks to prevent code motion. Otherwise
@@ -51,12 +56,18 @@ WEAK_INLINE int halide_profiler_init_sampling_token(int32_t *sampling_token, int
 WEAK_INLINE int halide_profiler_incr_active_threads(halide_profiler_instance_state *instance) {
     using namespace Halide::Runtime::Internal::Synchronization;
 
+    if (instance->thread_events) {
+        halide_profiler_thread_event(instance, halide_profiler_event_active, 0);
+    }
     return atomic_fetch_add_sequentially_consistent(&(instance->active_threads), 1);
 }
 
 WEAK_INLINE int halide_profiler_decr_active_threads(halide_profiler_instance_state *instance) {
     using namespace Halide::Runtime::Internal::Synchronization;
 
+    if (instance->thread_events) {
+        halide_profiler_thread_event(instance, halide_profiler_event_idle, 0);
+    }
     return atomic_fetch_sub_sequentially_consistent(&(instance->active_threads), 1);
 }
 }
@@ -0,0 +1,240 @@
+#include "HalideRuntime.h"
+#include "runtime_atomics.h"
+#include "runtime_internal.h"
+#include "scoped_mutex_lock.h"
+
+// The light profiler only times the Funcs computed at root, which are
+// computed by the thread that called the pipeline, with a cycle counter
+// read inline with the generated code. Nothing here takes a lock once a
+// pipeline is registered, so it's cheap enough to leave on in production.
+
+namespace Halide {
+namespace Runtime {
+namespace Internal {
+
+// The stats of all registered pipelines. They're never freed or
+// modified once published, apart from the counters, so they can be
+// traversed without a lock.
+WEAK halide_profiler_light_pipeline_stats *light_pipelines = nullptr;
+
+// Guards registration and calibration.
+WEAK halide_mutex light_lock = {{0}};
+
+// The cycle counter is calibrated against halide_current_time_ns by the
+// first and the latest of the samples taken.
+WEAK uint64_t light_first_ticks = 0, light_first_ns = 0;
+WEAK uint64_t light_latest_ticks = 0, light_latest_ns = 0;
+WEAK bool light_clock_started = false;
+
+// The number of ticks between calibration samples. It's a few
+// milliseconds of most cycle counters (and 16ms of the fallback, which
+// counts nanoseconds), so halide_current_time_ns is rarely called.
+constexpr uint64_t kLightCalibrationInterval = (uint64_t)1 << 24;
+
+WEAK void light_calibrate(void *user_context, uint64_t ticks) {
+    using namespace Halide::Runtime::Internal::Synchronization;
+    ScopedMutexLock lock(&light_lock);
+    if (!light_clock_started) {
+        // The ticks may have been read from halide_current_time_ns
+        // before the clock was started, so they can't be used.
+        halide_start_clock(user_context);
+        light_clock_started = true;
+        return;
+    }
+    uint64_t ns = (uint64_t)halide_current_time_ns(user_context);
+    if (light_first_ticks == 0) {
+        light_first_ticks = ticks;
+        light_first_ns = ns;
+    }
+    atomic_store_relaxed(&light_latest_ns, &ns);
+    atomic_store_relaxed(&light_latest_ticks, &ticks);
+}
+
+WEAK halide_profiler_light_pipeline_stats *find_light_pipeline(const char *pipeline_name, int num_funcs) {
+    using namespace Halide::Runtime::Internal::Synchronization;
+    halide_profiler_light_pipeline_stats *p;
+    atomic_load_acquire(&light_pipelines, &p);
+    for (; p; p = (halide_profiler_light_pipeline_stats *)(p->next)) {
+        // The name isn't compared by pointer, because JIT-compiled
+        // pipelines may be released and others compiled at the same
+        // address.
+        if (p->num_funcs == num_funcs && strcmp(p->name, pipeline_name) == 0) {
+            return p;
+        }
+    }
+    return nullptr;
+}
+
+WEAK halide_profiler_light_pipeline_stats *register_light_pipeline(const char *pipeline_name, int num_funcs, const char **func_names) {
+    using namespace Halide::Runtime::Internal::Synchronization;
+    ScopedMutexLock lock(&light_lock);
+    halide_profiler_light_pipeline_stats *p = find_light_pipeline(pipeline_name, num_funcs);
+    if (p) {
+        return p;
+    }
+
+    // Copy the names, which may belong to JIT-compiled code that's
+    // released before the stats are read. Allocate everything in one
+    // block.
+    size_t size = sizeof(halide_profiler_light_pipeline_stats) +
+                  num_funcs * sizeof(halide_profiler_light_func_stats) +
+                  strlen(pipeline_name) + 1;
+    for (int i = 0; i < num_funcs; i++) {
+        size += strlen(func_names[i]) + 1;
+    }
+    p = (halide_profiler_light_pipeline_stats *)malloc(size);
+    if (!p) {
+        return nullptr;
+    }
+    memset(p, 0, size);
+    p->funcs = (halide_profiler_light_func_stats *)(p + 1);
+    p->num_funcs = num_funcs;
+    char *names = (char *)(p->funcs + num_funcs);
+    const auto copy_name = [&](const char *name) {
+        size_t len = strlen(name) + 1;
+        memcpy(names, name, len);
+        const char *result = names;
+        names += len;
+        return result;
+    };
+    p->name = copy_name(pipeline_name);
+    for (int i = 0; i < num_funcs; i++) {
+        p->funcs[i].name = copy_name(func_names[i]);
+    }
+
+    p->next = light_pipelines;
+    atomic_store_release(&light_pipelines, &p);
+    return p;
+}
+
+}  // namespace Internal
+}  // namespace Runtime
+}  // namespace Halide
+
+using namespace Halide::Runtime::Internal;
+
+extern "C" {
+
+WEAK halide_profiler_light_pipeline_stats *
+halide_profiler_light_pipeline_start(void *user_context, const char *pipeline_name,
+                                     int num_funcs, const char **func_names, uint64_t ticks) {
+    using namespace Halide::Runtime::Internal::Synchronization;
+    uint64_t latest_ticks;
+    atomic_load_relaxed(&light_latest_ticks, &latest_ticks);
+    if (latest_ticks == 0 || ticks - latest_ticks > kLightCalibrationInterval) {
+        light_calibrate(user_context, ticks);
+    }
+
+    halide_profiler_light_pipeline_stats *p = find_light_pipeline(pipeline_name, num_funcs);
+    if (!p) {
+        p = register_light_pipeline(pipeline_name, num_funcs, func_names);
+    }
+    return p;
+}
+
+WEAK int halide_profiler_light_record_func(halide_profiler_light_pipeline_stats *p, int func_id, uint64_t ticks) {
+    using namespace Halide::Runtime::Internal::Synchronization;
+    if (p) {
+        halide_profiler_light_func_stats *f = p->funcs + func_id;
+        atomic_fetch_add_sequentially_consistent(&f->ticks, ticks);
+        atomic_fetch_add_sequentially_consistent(&f->count, (uint64_t)1);
+    }
+    return 0;
+}
+
+WEAK int halide_profiler_light_pipeline_end(halide_profiler_light_pipeline_stats *p, uint64_t ticks) {
+    using namespace Halide::Runtime::Internal::Synchronization;
+    if (p) {
+        atomic_fetch_add_sequentially_consistent(&p->ticks, ticks);
+        atomic_fetch_add_sequentially_consistent(&p->runs, (uint64_t)1);
+    }
+    return 0;
+}
+
+WEAK halide_profiler_light_pipeline_stats *halide_profiler_light_get_pipelines() {
+    using namespace Halide::Runtime::Internal::Synchronization;
+    halide_profiler_light_pipeline_stats *p;
+    atomic_load_acquire(&light_pipelines, &p);
+    return p;
+}
+
+WEAK double halide_profiler_light_seconds_per_tick() {
+    ScopedMutexLock lock(&light_lock);
+    if (light_latest_ticks <= light_first_ticks || light_latest_ns <= light_first_ns) {
+        return 0;
+    }
+    return (double)(light_latest_ns - light_first_ns) /
+           (double)(light_latest_ticks - light_first_ticks) * 1e-9;
+}
+
+WEAK int halide_profiler_light_format_metrics(void *user_context, char *buf, int size) {
+    using namespace Halide::Runtime::Internal::Synchronization;
+    const double seconds_per_tick = halide_profiler_light_seconds_per_tick();
+
+    // Each sample is formatted into a line buffer, and as much of it as
+    // fits is copied to buf.
+    int length = 0;
+    char line[1024];
+    char *end = line + sizeof(line);
+    const auto append = [&](const char *text) {
+        for (const char *c = text; *c; c++, length++) {
+            if (length + 1 < size) {
+                buf[length] = *c;
+            }
+        }
+    };
+
+    // The samples of each metric have to be together.
+    const char *metrics[] = {"halide_pipeline_seconds_total", "halide_pipeline_runs_total",
+                             "halide_func_seconds_total", "halide_func_runs_total"};
+    for (int m = 0; m < 4; m++) {
+        const bool per_func = m >= 2, is_time = (m % 2) == 0;
+        char *dst = halide_string_to_string(line, end, "# TYPE ");
+        dst = halide_string_to_string(dst, end, metrics[m]);
+        halide_string_to_string(dst, end, " counter\n");
+        append(line);
+        for (halide_profiler_light_pipeline_stats *p = halide_profiler_light_get_pipelines(); p;
+             p = (halide_profiler_light_pipeline_stats *)(p->next)) {
+            for (int i = per_func ? 0 : -1; i < (per_func ? p->num_funcs : 0); i++) {
+                uint64_t *counter = per_func ? (is_time ? &p->funcs[i].ticks : &p->funcs[i].count) :
+                                               (is_time ? &p->ticks : &p->runs);
+                uint64_t value;
+                atomic_load_relaxed(counter, &value);
+                dst = halide_string_to_string(line, end, metrics[m]);
+                dst = halide_string_to_string(dst, end, "{pipeline=\"");
+                dst = halide_string_to_string(dst, end, p->name);
+                if (per_func) {
+                    dst = halide_string_to_string(dst, end, "\",func=\"");
+                    dst = halide_string_to_string(dst, end, p->funcs[i].name);
+                }
+                dst = halide_string_to_string(dst, end, "\"} ");
+                if (is_time) {
+                    dst = halide_double_to_string(dst, end, value * seconds_per_tick, 0);
+                } else {
+                    dst = halide_uint64_to_string(dst, end, value, 1);
+                }
+                halide_string_to_string(dst, end, "\n");
+                append(line);
+            }
+        }
+    }
+    if (size > 0) {
+        buf[length < size ? length : size - 1] = 0;
+    }
+    return length;
+}
+
+WEAK void halide_profiler_light_reset() {
+    using namespace Halide::Runtime::Internal::Synchronization;
+    uint64_t zero = 0;
+    for (halide_profiler_light_pipeline_stats *p = halide_profiler_light_get_pipelines(); p;
+         p = (halide_profiler_light_pipeline_stats *)(p->next)) {
+        atomic_store_relaxed(&p->ticks, &zero);
+        atomic_store_relaxed(&p->runs, &zero);
+        for (int i = 0; i < p->num_funcs; i++) {
+            atomic_store_relaxed(&p->funcs[i].ticks, &zero);
+            atomic_store_relaxed(&p->funcs[i].count, &zero);
+        }
+    }
+}
+}
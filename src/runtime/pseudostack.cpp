@@ -31,3 +31,21 @@ WEAK_INLINE __attribute__((used)) void pseudostack_free(void *user_context, void
     slot->cumulative_size = 0;
 }
 }
+
+extern "C" {
+
+WEAK void *halide_arena_malloc(void *user_context, uint64_t size) {
+    if (size > (uint64_t)(size_t)-1) {
+        return nullptr;
+    }
+    return halide_malloc(user_context, (size_t)size);
+}
+
+WEAK void halide_arena_free(void *user_context, void *ptr) {
+    halide_free(user_context, ptr);
+}
+
+// The destructor of the allocations carved out of an arena.
+WEAK void halide_arena_nop_free(void *user_context, void *obj) {
+}
+}
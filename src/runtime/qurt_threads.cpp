@@ -134,4 +134,6 @@ struct thread_parker {
 
 #include "synchronization_common.h"
 
+// There's no clock module for QuRT.
+#define HALIDE_THREAD_POOL_HAS_CLOCK 0
 #include "thread_pool_common.h"
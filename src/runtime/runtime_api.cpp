@@ -22,9 +22,24 @@
 extern "C" void halide_unused_force_include_types();
 
 extern "C" __attribute__((used)) void *halide_runtime_api_functions[] = {
+    (void *)&halide_allocation_tracker_allocate,
+    (void *)&halide_allocation_tracker_device_free,
+    (void *)&halide_allocation_tracker_device_malloc,
+    (void *)&halide_allocation_tracker_free,
+    (void *)&halide_allocation_tracker_get_pipelines,
+    (void *)&halide_allocation_tracker_pipeline_end,
+    (void *)&halide_allocation_tracker_pipeline_start,
+    (void *)&halide_allocation_tracker_report,
+    (void *)&halide_allocation_tracker_reset,
+    (void *)&halide_arena_free,
+    (void *)&halide_arena_malloc,
     (void *)&halide_buffer_copy,
     (void *)&halide_buffer_to_string,
+    (void *)&halide_caching_free,
+    (void *)&halide_caching_malloc,
     (void *)&halide_can_use_target_features,
+    (void *)&halide_can_use_target_vector_bits,
+    (void *)&halide_choose_size_variant,
     (void *)&halide_cond_broadcast,
     (void *)&halide_cond_signal,
     (void *)&halide_cond_wait,
@@ -32,13 +47,24 @@ extern "C" __attribute__((used)) void *halide_runtime_api_functions[] = {
     (void *)&halide_copy_to_host,
     (void *)&halide_cuda_detach_device_ptr,
     (void *)&halide_cuda_device_interface,
+    (void *)&halide_cuda_get_device_memory_pool_stats,
     (void *)&halide_cuda_get_device_ptr,
+    (void *)&halide_cuda_get_graph_replay_stats,
+    (void *)&halide_cuda_host_free,
+    (void *)&halide_cuda_host_malloc,
     (void *)&halide_cuda_initialize_kernels,
     (void *)&halide_cuda_finalize_kernels,
+    (void *)&halide_cuda_kernel_timer_end,
+    (void *)&halide_cuda_kernel_timer_start,
     (void *)&halide_cuda_run,
+    (void *)&halide_cuda_set_concurrent_streams,
+    (void *)&halide_cuda_set_graph_replay,
+    (void *)&halide_cuda_set_stream_ordered_allocation,
+    (void *)&halide_cuda_trim_device_memory_pool,
     (void *)&halide_cuda_wrap_device_ptr,
     (void *)&halide_current_time_ns,
     (void *)&halide_debug_to_file,
+    (void *)&halide_debug_to_file_flush,
     (void *)&halide_default_can_use_target_features,
     (void *)&halide_device_and_host_free,
     (void *)&halide_device_and_host_free_as_destructor,
@@ -51,6 +77,7 @@ extern "C" __attribute__((used)) void *halide_runtime_api_functions[] = {
     (void *)&halide_device_sync,
     (void *)&halide_device_sync_global,
     (void *)&halide_disable_timer_interrupt,
+    (void *)&halide_do_batch_argv,
     (void *)&halide_do_par_for,
     (void *)&halide_do_parallel_tasks,
     (void *)&halide_do_task,
@@ -97,11 +124,14 @@ extern "C" __attribute__((used)) void *halide_runtime_api_functions[] = {
     (void *)&halide_get_gpu_device,
     (void *)&halide_get_library_symbol,
     (void *)&halide_get_num_threads,
+    (void *)&halide_get_size_variant,
     (void *)&halide_get_symbol,
     (void *)&halide_get_trace_file,
+    (void *)&halide_hexagon_begin_batch,
     (void *)&halide_hexagon_detach_device_handle,
     (void *)&halide_hexagon_device_interface,
     (void *)&halide_hexagon_device_release,
+    (void *)&halide_hexagon_end_batch,
     (void *)&halide_hexagon_get_device_handle,
     (void *)&halide_hexagon_get_device_size,
     (void *)&halide_hexagon_get_module_state,
@@ -110,21 +140,30 @@ extern "C" __attribute__((used)) void *halide_runtime_api_functions[] = {
     (void *)&halide_hexagon_power_hvx_off,
     (void *)&halide_hexagon_power_hvx_off_as_destructor,
     (void *)&halide_hexagon_power_hvx_on,
+    (void *)&halide_hexagon_register_ion_buffer,
     (void *)&halide_hexagon_run,
     (void *)&halide_hexagon_set_performance,
     (void *)&halide_hexagon_set_performance_mode,
     (void *)&halide_hexagon_set_thread_priority,
+    (void *)&halide_hexagon_unregister_ion_buffer,
     (void *)&halide_hexagon_wrap_device_handle,
+    (void *)&halide_huge_page_free,
+    (void *)&halide_huge_page_malloc,
     (void *)&halide_int64_to_string,
     (void *)&halide_join_thread,
     (void *)&halide_load_library,
     (void *)&halide_malloc,
     (void *)&halide_memoization_cache_cleanup,
     (void *)&halide_memoization_cache_evict,
+    (void *)&halide_memoization_cache_get_stats,
     (void *)&halide_memoization_cache_lookup,
     (void *)&halide_memoization_cache_release,
+    (void *)&halide_memoization_cache_set_eviction_policy,
+    (void *)&halide_memoization_cache_set_site_size,
     (void *)&halide_memoization_cache_set_size,
+    (void *)&halide_memoization_cache_shard_count,
     (void *)&halide_memoization_cache_store,
+    (void *)&halide_memoization_hash_buffer,
     (void *)&halide_metal_acquire_context,
     (void *)&halide_metal_detach_buffer,
     (void *)&halide_metal_device_interface,
@@ -152,6 +191,7 @@ extern "C" __attribute__((used)) void *halide_runtime_api_functions[] = {
     (void *)&halide_opencl_get_build_options,
     (void *)&halide_opencl_get_device_type,
     (void *)&halide_opencl_get_platform_name,
+    (void *)&halide_opencl_get_program_cache_dir,
     (void *)&halide_opencl_get_crop_offset,
     (void *)&halide_opencl_image_device_interface,
     (void *)&halide_opencl_image_wrap_cl_mem,
@@ -161,22 +201,36 @@ extern "C" __attribute__((used)) void *halide_runtime_api_functions[] = {
     (void *)&halide_opencl_set_build_options,
     (void *)&halide_opencl_set_device_type,
     (void *)&halide_opencl_set_platform_name,
+    (void *)&halide_opencl_set_program_cache_dir,
     (void *)&halide_opencl_wrap_cl_mem,
+    (void *)&halide_pin_current_thread_to_numa_node,
     (void *)&halide_pointer_to_string,
     (void *)&halide_print,
     (void *)&halide_profiler_get_pipeline_state,
     (void *)&halide_profiler_get_state,
+    (void *)&halide_profiler_gpu_time,
     (void *)&halide_profiler_instance_start,
     (void *)&halide_profiler_instance_end,
+    (void *)&halide_profiler_light_format_metrics,
+    (void *)&halide_profiler_light_get_pipelines,
+    (void *)&halide_profiler_light_pipeline_end,
+    (void *)&halide_profiler_light_pipeline_start,
+    (void *)&halide_profiler_light_record_func,
+    (void *)&halide_profiler_light_reset,
+    (void *)&halide_profiler_light_seconds_per_tick,
     (void *)&halide_profiler_memory_allocate,
     (void *)&halide_profiler_memory_free,
     (void *)&halide_profiler_report,
     (void *)&halide_profiler_reset,
     (void *)&halide_profiler_stack_peak_update,
+    (void *)&halide_profiler_thread_event,
+    (void *)&halide_profiler_write_timeline,
     (void *)&halide_qurt_hvx_lock,
     (void *)&halide_qurt_hvx_unlock,
     (void *)&halide_qurt_hvx_unlock_as_destructor,
     (void *)&halide_release_jit_module,
+    (void *)&halide_report_size_variant_time,
+    (void *)&halide_reset_size_variants,
     (void *)&halide_semaphore_init,
     (void *)&halide_semaphore_release,
     (void *)&halide_semaphore_try_acquire,
@@ -191,9 +245,16 @@ extern "C" __attribute__((used)) void *halide_runtime_api_functions[] = {
     (void *)&halide_set_custom_malloc,
     (void *)&halide_set_custom_print,
     (void *)&halide_set_custom_trace,
+    (void *)&halide_set_debug_to_file_async,
     (void *)&halide_set_error_handler,
     (void *)&halide_set_gpu_device,
     (void *)&halide_set_num_threads,
+    (void *)&halide_set_thread_pool_chunking,
+    (void *)&halide_set_thread_pool_creation_policy,
+    (void *)&halide_set_thread_pool_numa_aware,
+    (void *)&halide_set_thread_pool_qos,
+    (void *)&halide_set_thread_pool_spin_policy,
+    (void *)&halide_set_thread_pool_work_stealing,
     (void *)&halide_set_trace_file,
     (void *)&halide_shutdown_thread_pool,
     (void *)&halide_shutdown_trace,
@@ -202,9 +263,12 @@ extern "C" __attribute__((used)) void *halide_runtime_api_functions[] = {
     (void *)&halide_start_clock,
     (void *)&halide_start_timer_chain,
     (void *)&halide_string_to_string,
+    (void *)&halide_thread_pool_prewarm,
     (void *)&halide_trace,
     (void *)&halide_trace_helper,
     (void *)&halide_uint64_to_string,
+    (void *)&halide_use_caching_allocator,
+    (void *)&halide_use_huge_page_allocator,
     (void *)&halide_use_jit_module,
     (void *)&halide_d3d12compute_acquire_context,
     (void *)&halide_d3d12compute_device_interface,
@@ -119,6 +119,7 @@ WEAK_INLINE void *halide_fopen(const char *filename, const char *type);
 int fileno(void *);
 int fclose(void *);
 int close(int);
+size_t fread(void *, size_t, size_t, void *);
 size_t fwrite(const void *, size_t, size_t, void *);
 ssize_t write(int fd, const void *buf, size_t bytes);
 int remove(const char *pathname);
@@ -129,6 +130,22 @@ void abort();
 // Below are prototypes for various functions called by generated code
 // and parts of the runtime but not exposed to users:
 
+// The hardware performance counters the profiler can count per Func.
+enum halide_perf_counter_t {
+    halide_perf_counter_cycles = 0,
+    halide_perf_counter_instructions = 1,
+    halide_perf_counter_llc_misses = 2,
+    halide_perf_counter_count = 3,
+};
+
+// Open the hardware performance counters above for the calling thread.
+// Returns a handle to read them with, or -1 if they're unavailable.
+WEAK int halide_open_perf_counters();
+
+// Read the counters opened by halide_open_perf_counters into
+// counts[halide_perf_counter_count]. Returns false on failure.
+WEAK bool halide_read_perf_counters(int handle, uint64_t *counts);
+
 // Similar to strncpy, but with various non-string arguments. Writes
 // arg to dst. Does not write to pointer end or beyond. Returns
 // pointer to one beyond the last character written so that calls can
@@ -157,6 +174,7 @@ WEAK void halide_sleep_us(void *user_context, int us);
 WEAK void halide_device_free_as_destructor(void *user_context, void *obj);
 WEAK void halide_device_and_host_free_as_destructor(void *user_context, void *obj);
 WEAK void halide_device_host_nop_free(void *user_context, void *obj);
+WEAK void halide_arena_nop_free(void *user_context, void *obj);
 
 struct halide_profiler_instance_state;
 WEAK void halide_profiler_stack_peak_update(void *user_context,
@@ -183,6 +201,8 @@ WEAK void halide_disable_timer_interrupt();
 WEAK void halide_enable_timer_interrupt();
 
 WEAK int halide_host_cpu_count();
+WEAK int halide_host_numa_node_count();
+WEAK int halide_current_numa_node();
 
 WEAK int halide_device_and_host_malloc(void *user_context, struct halide_buffer_t *buf,
                                        const struct halide_device_interface_t *device_interface);
@@ -0,0 +1,170 @@
+#include "HalideRuntime.h"
+#include "printer.h"
+#include "runtime_internal.h"
+#include "scoped_mutex_lock.h"
+
+namespace Halide {
+namespace Runtime {
+namespace Internal {
+
+// The number of times each variant is run for a bucket before the
+// fastest one is chosen.
+constexpr int kSizeVariantTrials = 3;
+
+// What has been learned about the variants of one pipeline.
+struct SizeVariantState {
+    SizeVariantState *next;
+    // A copy of the name of the pipeline, as the state can outlive it
+    // (e.g. when JIT-compiled code is released).
+    const char *name;
+    int num_variants;
+    // Per bucket: the variant chosen, or -1 while they're still being tried.
+    int *chosen;
+    // Per bucket and variant: the number of runs started and finished,
+    // and the fastest time taken by a finished run.
+    int *started;
+    int *finished;
+    int64_t *best_time;
+};
+
+WEAK SizeVariantState *size_variant_states = nullptr;
+WEAK halide_mutex size_variant_states_lock;
+
+// Must be called with size_variant_states_lock held.
+WEAK SizeVariantState *find_size_variant_state(void *user_context, const char *name, int num_variants) {
+    for (SizeVariantState *s = size_variant_states; s; s = s->next) {
+        if (strcmp(s->name, name) == 0 && s->num_variants == num_variants) {
+            return s;
+        }
+    }
+
+    // The buckets correspond to the variants, so there are as many of
+    // each. Allocate everything in one block.
+    const size_t n = num_variants;
+    const size_t name_size = strlen(name) + 1;
+    const size_t size = sizeof(SizeVariantState) + n * n * sizeof(int64_t) + (n + 2 * n * n) * sizeof(int) + name_size;
+    SizeVariantState *s = (SizeVariantState *)halide_malloc(user_context, size);
+    if (!s) {
+        return nullptr;
+    }
+    memset(s, 0, size);
+    s->num_variants = num_variants;
+    s->best_time = (int64_t *)(s + 1);
+    s->chosen = (int *)(s->best_time + n * n);
+    s->started = s->chosen + n;
+    s->finished = s->started + n * n;
+    char *name_copy = (char *)(s->finished + n * n);
+    memcpy(name_copy, name, name_size);
+    s->name = name_copy;
+    for (size_t i = 0; i < n; i++) {
+        s->chosen[i] = -1;
+    }
+
+    // The wrapper times the variants with halide_current_time_ns.
+    halide_start_clock(user_context);
+
+    s->next = size_variant_states;
+    size_variant_states = s;
+    return s;
+}
+
+}  // namespace Internal
+}  // namespace Runtime
+}  // namespace Halide
+
+using namespace Halide::Runtime::Internal;
+
+extern "C" {
+
+WEAK int halide_choose_size_variant(void *user_context, const char *name, int bucket, int num_variants) {
+    if (bucket < 0 || bucket >= num_variants) {
+        return 0;
+    }
+
+    ScopedMutexLock lock(&size_variant_states_lock);
+    SizeVariantState *s = find_size_variant_state(user_context, name, num_variants);
+    if (!s) {
+        // Without the state, just use the variant for this bucket.
+        return bucket;
+    }
+    if (s->chosen[bucket] >= 0) {
+        return s->chosen[bucket];
+    }
+
+    // Try the variant that was autoscheduled for this bucket first, and
+    // then the others in turn. Concurrent calls try different variants.
+    int *started = s->started + bucket * num_variants;
+    int best = bucket;
+    for (int i = 1; i < num_variants; i++) {
+        int v = (bucket + i) % num_variants;
+        if (started[v] < started[best]) {
+            best = v;
+        }
+    }
+    started[best]++;
+    return best;
+}
+
+WEAK int halide_report_size_variant_time(void *user_context, const char *name, int bucket, int variant, int64_t time_ns) {
+    if (bucket < 0 || variant < 0) {
+        return 0;
+    }
+
+    ScopedMutexLock lock(&size_variant_states_lock);
+    SizeVariantState *s = nullptr;
+    for (SizeVariantState *it = size_variant_states; it; it = it->next) {
+        if (strcmp(it->name, name) == 0) {
+            s = it;
+            break;
+        }
+    }
+    if (!s || bucket >= s->num_variants || variant >= s->num_variants || s->chosen[bucket] >= 0) {
+        return 0;
+    }
+
+    const int n = s->num_variants;
+    int *finished = s->finished + bucket * n;
+    int64_t *best_time = s->best_time + bucket * n;
+    if (finished[variant] == 0 || time_ns < best_time[variant]) {
+        best_time[variant] = time_ns;
+    }
+    finished[variant]++;
+
+    // Once every variant has been run enough times, stick with the
+    // fastest. Taking the fastest run of each makes this robust to the
+    // first runs being slow (e.g. due to cold caches).
+    int best = -1;
+    for (int v = 0; v < n; v++) {
+        if (finished[v] < kSizeVariantTrials) {
+            return 0;
+        }
+        if (best < 0 || best_time[v] < best_time[best]) {
+            best = v;
+        }
+    }
+    s->chosen[bucket] = best;
+#ifdef DEBUG_RUNTIME
+    debug(user_context) << "Size variant " << best << " chosen for bucket " << bucket << " of " << name << "\n";
+#endif
+    return 0;
+}
+
+WEAK void halide_reset_size_variants(void *user_context) {
+    ScopedMutexLock lock(&size_variant_states_lock);
+    while (size_variant_states) {
+        SizeVariantState *s = size_variant_states;
+        size_variant_states = s->next;
+        halide_free(user_context, s);
+    }
+}
+
+WEAK int halide_get_size_variant(void *user_context, const char *name, int bucket) {
+    ScopedMutexLock lock(&size_variant_states_lock);
+    for (SizeVariantState *s = size_variant_states; s; s = s->next) {
+        if (strcmp(s->name, name) == 0) {
+            return (bucket >= 0 && bucket < s->num_variants) ? s->chosen[bucket] : -1;
+        }
+    }
+    return -1;
+}
+}
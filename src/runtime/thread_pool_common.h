@@ -26,25 +26,56 @@ int gettid() {
 
 #endif
 
+// Platforms without a clock module define this to 0 before including
+// this file. Timed spinning then counts yields of roughly a
+// microsecond each instead.
+#ifndef HALIDE_THREAD_POOL_HAS_CLOCK
+#define HALIDE_THREAD_POOL_HAS_CLOCK 1
+#endif
+
 namespace Halide {
 namespace Runtime {
 namespace Internal {
 
+ALWAYS_INLINE int64_t spin_clock_ns() {
+#if HALIDE_THREAD_POOL_HAS_CLOCK
+    return halide_current_time_ns(nullptr);
+#else
+    return 0;
+#endif
+}
+
+// Whether a thread that has spun for the given number of yields, starting
+// at the given time, should keep spinning. A negative budget means the
+// default of 40 yields.
+ALWAYS_INLINE bool keep_spinning(int spins, int64_t start_ns, int64_t budget_ns) {
+    if (budget_ns < 0) {
+        return spins < 40;
+    }
+#if HALIDE_THREAD_POOL_HAS_CLOCK
+    return budget_ns > 0 && spin_clock_ns() - start_ns < budget_ns;
+#else
+    return spins < budget_ns / 1000;
+#endif
+}
+
 // A condition variable, augmented with a bit of spinning on an atomic counter
 // before going to sleep for real. This helps reduce overhead at the end of a
 // parallel for loop when idle worker threads are waiting for other threads to
-// finish so that the next parallel for loop can begin.
+// finish so that the next parallel for loop can begin. How long to spin for
+// is given in nanoseconds (see work_queue_t::spin_budget_ns).
 struct halide_cond_with_spinning {
     halide_cond cond;
     uintptr_t counter;
 
-    void wait(halide_mutex *mutex) {
+    void wait(halide_mutex *mutex, int64_t spin_budget_ns) {
         // First spin for a bit, checking the counter for another thread to bump
         // it.
         uintptr_t initial;
         Synchronization::atomic_load_relaxed(&counter, &initial);
         halide_mutex_unlock(mutex);
-        for (int spin = 0; spin < 40; spin++) {
+        const int64_t start_ns = spin_budget_ns > 0 ? spin_clock_ns() : 0;
+        for (int spin = 0; keep_spinning(spin, start_ns, spin_budget_ns); spin++) {
             halide_thread_yield();
             uintptr_t current;
             Synchronization::atomic_load_relaxed(&counter, &current);
@@ -81,6 +112,60 @@ struct halide_cond_with_spinning {
     // wakes all spinning waiters.
 };
 
+struct halide_semaphore_impl_t {
+    int value;
+    // Nonzero if a job has failed to acquire this semaphore since the last
+    // release, so that the release needs to wake threads up. Releases made
+    // while nobody waits then don't need the work queue's lock.
+    int waiters;
+};
+
+// Try to acquire a semaphore for a job. If that fails, mark the semaphore
+// as waited on first, so that the release that makes the job runnable
+// wakes up the threads looking for work.
+ALWAYS_INLINE bool semaphore_try_acquire_or_wait(halide_semaphore_t *s, int n) {
+    if (halide_default_semaphore_try_acquire(s, n)) {
+        return true;
+    }
+    halide_semaphore_impl_t *sem = (halide_semaphore_impl_t *)s;
+    Synchronization::atomic_fetch_or_sequentially_consistent(&sem->waiters, 1);
+    // Try again, in case of a release between the first attempt and
+    // marking it. Releases after this will see the mark.
+    Synchronization::atomic_thread_fence_sequentially_consistent();
+    return halide_default_semaphore_try_acquire(s, n);
+}
+
+// The share of the thread pool given to the pipelines run with a
+// given user_context (see halide_set_thread_pool_qos). Protected by
+// the work queue mutex.
+struct thread_pool_qos {
+    bool in_use;
+    void *user_context;
+    // The most threads that may run tasks of these pipelines at once, or
+    // zero for no limit.
+    int max_threads;
+    // Runnable jobs of higher priority are run first.
+    int priority;
+    // The number of threads running tasks of these pipelines.
+    int active_threads;
+};
+
+#define MAX_THREAD_POOL_QOS 64
+
+WEAK thread_pool_qos thread_pool_qos_table[MAX_THREAD_POOL_QOS];
+
+// One more than the index of the last entry of the table in use.
+WEAK int thread_pool_qos_count = 0;
+
+WEAK thread_pool_qos *find_thread_pool_qos(void *user_context) {
+    for (int i = 0; i < thread_pool_qos_count; i++) {
+        if (thread_pool_qos_table[i].in_use && thread_pool_qos_table[i].user_context == user_context) {
+            return &thread_pool_qos_table[i];
+        }
+    }
+    return nullptr;
+}
+
 struct work {
     halide_parallel_task_t task;
 
@@ -95,6 +180,11 @@ struct work {
     int threads_reserved;
 
     void *user_context;
+    // The thread pool share of the user_context, if one was set.
+    thread_pool_qos *qos;
+    // For adaptive chunking, a moving average of the time an
+    // iteration takes, in nanoseconds, or zero if none has run yet.
+    int64_t mean_iteration_ns;
     int active_workers;
     int exit_status;
     int next_semaphore;
@@ -103,8 +193,8 @@ struct work {
 
     ALWAYS_INLINE bool make_runnable() {
         for (; next_semaphore < task.num_semaphores; next_semaphore++) {
-            if (!halide_default_semaphore_try_acquire(task.semaphores[next_semaphore].semaphore,
-                                                      task.semaphores[next_semaphore].count)) {
+            if (!semaphore_try_acquire_or_wait(task.semaphores[next_semaphore].semaphore,
+                                               task.semaphores[next_semaphore].count)) {
                 // Note that we don't release the semaphores already
                 // acquired. We never have two consumers contending
                 // over the same semaphore, so it's not helpful to do
@@ -120,6 +210,18 @@ struct work {
     ALWAYS_INLINE bool running() const {
         return task.extent || active_workers;
     }
+
+    ALWAYS_INLINE int priority() const {
+        return qos ? qos->priority : 0;
+    }
+
+    // Whether the user_context already has as many threads working for
+    // it as it may. Jobs that need several threads to make progress
+    // aren't limited, as that could deadlock them.
+    ALWAYS_INLINE bool at_thread_limit() const {
+        return qos && qos->max_threads > 0 && task.min_threads == 0 &&
+               qos->active_threads >= qos->max_threads;
+    }
 };
 
 ALWAYS_INLINE int clamp_num_threads(int threads) {
@@ -143,6 +245,57 @@ WEAK int default_desired_num_threads() {
                halide_host_cpu_count();
 }
 
+WEAK bool default_work_stealing() {
+    const char *str = getenv("HL_THREAD_POOL_WORK_STEALING");
+    return str && atoi(str) != 0;
+}
+
+WEAK bool default_numa_aware() {
+    const char *str = getenv("HL_THREAD_POOL_NUMA");
+    return str && atoi(str) != 0;
+}
+
+WEAK halide_thread_pool_chunking_t default_chunking() {
+    const char *str = getenv("HL_THREAD_POOL_CHUNKING");
+    if (str && !strcmp(str, "guided")) {
+        return halide_thread_pool_chunking_guided;
+    } else if (str && !strcmp(str, "adaptive")) {
+        return halide_thread_pool_chunking_adaptive;
+    } else {
+        return halide_thread_pool_chunking_static;
+    }
+}
+
+WEAK halide_thread_pool_spin_t default_spin_policy(int *spin_us) {
+    const char *str = getenv("HL_THREAD_POOL_SPIN");
+    *spin_us = 0;
+    if (!str || !*str) {
+        return halide_thread_pool_spin_default;
+    } else if (!strcmp(str, "adaptive")) {
+        return halide_thread_pool_spin_adaptive;
+    } else if (!strcmp(str, "never")) {
+        return halide_thread_pool_spin_never;
+    } else {
+        *spin_us = atoi(str);
+        return halide_thread_pool_spin_hot;
+    }
+}
+
+WEAK halide_thread_pool_creation_t default_creation_policy() {
+    const char *str = getenv("HL_THREAD_POOL_CREATION");
+    if (str && !strcmp(str, "on_demand")) {
+        return halide_thread_pool_create_on_demand;
+    } else {
+        return halide_thread_pool_create_eager;
+    }
+}
+
+// The most adaptive spinning spins for, if not given.
+constexpr int default_max_adaptive_spin_us = 1000;
+
+// How long adaptive chunking aims for each chunk of iterations to take.
+constexpr int64_t adaptive_chunk_ns = 50000;
+
 // The work queue and thread pool is weak, so one big work queue is shared by all halide functions
 struct work_queue_t {
     // all fields are protected by this mutex.
@@ -151,6 +304,34 @@ struct work_queue_t {
     // The desired number threads doing work (HL_NUM_THREADS).
     int desired_threads_working;
 
+    // Whether halide_default_do_par_for uses the work-stealing
+    // scheduler (HL_THREAD_POOL_WORK_STEALING). Zero means it hasn't
+    // been decided yet, positive means enabled, negative means
+    // disabled.
+    int work_stealing;
+
+    // Whether worker threads are pinned to NUMA nodes and parallel
+    // loops are divided up by node (HL_THREAD_POOL_NUMA). Same
+    // encoding as work_stealing.
+    int numa_aware;
+
+    // How idle threads spin before they sleep (HL_THREAD_POOL_SPIN),
+    // as a halide_thread_pool_spin_t plus one, or zero if it hasn't
+    // been decided yet. spin_us is how long hot threads spin for, or
+    // the most adaptive spinning spins for.
+    int spin_policy;
+    int spin_us;
+
+    // How threads claim the iterations of parallel loops
+    // (HL_THREAD_POOL_CHUNKING), as a halide_thread_pool_chunking_t
+    // plus one, or zero if it hasn't been decided yet.
+    int chunking;
+
+    // When worker threads are created (HL_THREAD_POOL_CREATION), as a
+    // halide_thread_pool_creation_t plus one, or zero if it hasn't
+    // been decided yet.
+    int creation_policy;
+
     // All fields after this must be zero in the initial state. See assert_zeroed
     // Field serves both to mark the offset in struct and as layout padding.
     int zero_marker;
@@ -191,13 +372,44 @@ struct work_queue_t {
     // to prevent deadlock due to oversubscription of threads.
     int threads_reserved;
 
+    // The number of NUMA nodes worker threads are spread across. Zero
+    // if NUMA awareness is disabled.
+    int numa_nodes;
+
+    // For adaptive spinning: when work was last enqueued, and a moving
+    // average of the time between enqueues, in nanoseconds.
+    int64_t last_enqueue_ns, mean_enqueue_gap_ns;
+
+    // How long a thread that's about to sleep should spin for first, in
+    // nanoseconds, or -1 for the default of a few yields. Adaptive
+    // spinning spins for a little longer than work has recently taken to
+    // arrive, so back-to-back parallel loops find their workers awake,
+    // and doesn't spin when work arrives too rarely for that to pay.
+    ALWAYS_INLINE int64_t spin_budget_ns() const {
+        switch (spin_policy - 1) {
+        case halide_thread_pool_spin_never:
+            return 0;
+        case halide_thread_pool_spin_hot:
+            return (int64_t)spin_us * 1000;
+        case halide_thread_pool_spin_adaptive: {
+            if (!mean_enqueue_gap_ns) {
+                return -1;
+            }
+            const int64_t max_ns = (int64_t)(spin_us > 0 ? spin_us : default_max_adaptive_spin_us) * 1000;
+            return mean_enqueue_gap_ns <= max_ns ? min(2 * mean_enqueue_gap_ns, max_ns) : 0;
+        }
+        default:
+            return -1;
+        }
+    }
+
     ALWAYS_INLINE bool running() const {
         return !shutdown;
     }
 
     // Used to check initial state is correct.
     ALWAYS_INLINE void assert_zeroed() const {
-        // Assert that all fields except the mutex and desired threads count are zeroed.
+        // Assert that all fields except the mutex and the settings above are zeroed.
         const char *bytes = ((const char *)&this->zero_marker);
         const char *limit = ((const char *)this) + sizeof(work_queue_t);
         while (bytes < limit && *bytes == 0) {
@@ -209,7 +421,7 @@ struct work_queue_t {
     // Return the work queue to initial state. Must be called while locked
     // and queue will remain locked.
     ALWAYS_INLINE void reset() {
-        // Ensure all fields except the mutex and desired hreads count are zeroed.
+        // Ensure all fields except the mutex and the settings above are zeroed.
         char *bytes = ((char *)&this->zero_marker);
         char *limit = ((char *)this) + sizeof(work_queue_t);
         memset(bytes, 0, limit - bytes);
@@ -218,6 +430,41 @@ struct work_queue_t {
 
 WEAK work_queue_t work_queue = {};
 
+// The number of iterations of job the next thread to work on it
+// should claim. Must be called while locked. Static chunking claims one
+// at a time. Guided chunking claims a share of what is left, which
+// shrinks as the loop drains, so threads rarely take the lock while
+// the load still balances at the end. Adaptive chunking claims enough
+// iterations for about adaptive_chunk_ns of work, given the time
+// iterations have taken so far, and no more than guided chunking
+// would. Only parallel loops that don't wait on semaphores or need
+// more than one thread are chunked.
+ALWAYS_INLINE int chunk_size(const work *job) {
+    const int policy = work_queue.chunking - 1;
+    if (policy == halide_thread_pool_chunking_static ||
+        job->task.serial || job->task.num_semaphores || job->task.min_threads) {
+        return 1;
+    }
+    int threads = work_queue.threads_created + 1;
+    if (job->qos && job->qos->max_threads > 0 && job->qos->max_threads < threads) {
+        threads = job->qos->max_threads;
+    }
+    int chunk = max(job->task.extent / (2 * threads), 1);
+#if HALIDE_THREAD_POOL_HAS_CLOCK
+    if (policy == halide_thread_pool_chunking_adaptive) {
+        if (!job->mean_iteration_ns) {
+            // Time one iteration first.
+            return 1;
+        }
+        const int64_t for_time = adaptive_chunk_ns / job->mean_iteration_ns;
+        if (for_time < chunk) {
+            chunk = max((int)for_time, 1);
+        }
+    }
+#endif
+    return chunk;
+}
+
 #if EXTENDED_DEBUG
 
 WEAK void print_job(work *job, const char *indent, const char *prefix = nullptr) {
@@ -253,6 +500,47 @@ WEAK void dump_job_state() {
 
 WEAK void worker_thread(void *);
 
+// Whether the thread running owned_job (or a worker thread, if it is
+// nullptr) may work on job, semaphores aside.
+WEAK bool can_run_job(work *job, work *owned_job) {
+    // Only schedule tasks with enough free worker threads
+    // around to complete. They may get stolen later, but only
+    // by tasks which can themselves use them to complete
+    // work, so forward progress is made.
+    work *parent_job = job->parent_job;
+
+    int threads_available;
+    if (parent_job == nullptr) {
+        // The + 1 is because work_queue.threads_created does not include the main thread.
+        threads_available = (work_queue.threads_created + 1) - work_queue.threads_reserved;
+    } else {
+        if (parent_job->active_workers == 0) {
+            threads_available = parent_job->task.min_threads - parent_job->threads_reserved;
+        } else {
+            threads_available = parent_job->active_workers * parent_job->task.min_threads - parent_job->threads_reserved;
+        }
+    }
+    bool enough_threads = threads_available >= job->task.min_threads;
+
+    if (!enough_threads) {
+        log_message("Not enough threads for job " << job->task.name << " available: " << threads_available << " min_threads: " << job->task.min_threads);
+    }
+    bool can_use_this_thread_stack = !owned_job || (job->siblings == owned_job->siblings) || job->task.min_threads == 0;
+    if (!can_use_this_thread_stack) {
+        log_message("Cannot run job " << job->task.name << " on this thread.");
+    }
+    bool can_add_worker = (!job->task.serial || (job->active_workers == 0));
+    if (!can_add_worker) {
+        log_message("Cannot add worker to job " << job->task.name);
+    }
+    bool under_thread_limit = !job->at_thread_limit();
+    if (!under_thread_limit) {
+        log_message("Thread limit reached for job " << job->task.name);
+    }
+
+    return enough_threads && can_use_this_thread_stack && can_add_worker && under_thread_limit;
+}
+
 WEAK void worker_thread_already_locked(work *owned_job) {
     while (owned_job ? owned_job->running() : !work_queue.shutdown) {
         work *job = work_queue.jobs;
@@ -281,51 +569,39 @@ WEAK void worker_thread_already_locked(work *owned_job) {
 
         dump_job_state();
 
-        // Find a job to run, prefering things near the top of the stack.
-        while (job) {
-            print_job(job, "", "Considering job ");
-            // Only schedule tasks with enough free worker threads
-            // around to complete. They may get stolen later, but only
-            // by tasks which can themselves use them to complete
-            // work, so forward progress is made.
-            bool enough_threads;
-
-            work *parent_job = job->parent_job;
-
-            int threads_available;
-            if (parent_job == nullptr) {
-                // The + 1 is because work_queue.threads_created does not include the main thread.
-                threads_available = (work_queue.threads_created + 1) - work_queue.threads_reserved;
-            } else {
-                if (parent_job->active_workers == 0) {
-                    threads_available = parent_job->task.min_threads - parent_job->threads_reserved;
-                } else {
-                    threads_available = parent_job->active_workers * parent_job->task.min_threads - parent_job->threads_reserved;
+        // Find a job to run, prefering jobs of higher priority, then
+        // things near the top of the stack. At first only the jobs of
+        // the highest priority that could run are considered, but if
+        // they are all waiting on semaphores, the others are too.
+        bool by_priority = false;
+        int priority = 0;
+        if (thread_pool_qos_count) {
+            for (work *j = job; j; j = j->next_job) {
+                if (can_run_job(j, owned_job) && (!by_priority || j->priority() > priority)) {
+                    by_priority = true;
+                    priority = j->priority();
                 }
             }
-            enough_threads = threads_available >= job->task.min_threads;
-
-            if (!enough_threads) {
-                log_message("Not enough threads for job " << job->task.name << " available: " << threads_available << " min_threads: " << job->task.min_threads);
-            }
-            bool can_use_this_thread_stack = !owned_job || (job->siblings == owned_job->siblings) || job->task.min_threads == 0;
-            if (!can_use_this_thread_stack) {
-                log_message("Cannot run job " << job->task.name << " on this thread.");
-            }
-            bool can_add_worker = (!job->task.serial || (job->active_workers == 0));
-            if (!can_add_worker) {
-                log_message("Cannot add worker to job " << job->task.name);
-            }
-
-            if (enough_threads && can_use_this_thread_stack && can_add_worker) {
-                if (job->make_runnable()) {
-                    break;
-                } else {
-                    log_message("Cannot acquire semaphores for " << job->task.name);
+        }
+        while (true) {
+            while (job) {
+                print_job(job, "", "Considering job ");
+                if (can_run_job(job, owned_job) && (!by_priority || job->priority() == priority)) {
+                    if (job->make_runnable()) {
+                        break;
+                    } else {
+                        log_message("Cannot acquire semaphores for " << job->task.name);
+                    }
                 }
+                prev_ptr = &(job->next_job);
+                job = job->next_job;
+            }
+            if (job || !by_priority) {
+                break;
             }
-            prev_ptr = &(job->next_job);
-            job = job->next_job;
+            by_priority = false;
+            job = work_queue.jobs;
+            prev_ptr = &work_queue.jobs;
         }
 
         if (!job) {
@@ -333,7 +609,7 @@ WEAK void worker_thread_already_locked(work *owned_job) {
             if (owned_job) {
                 work_queue.owners_sleeping++;
                 owned_job->owner_is_sleeping = true;
-                work_queue.wake_owners.wait(&work_queue.mutex);
+                work_queue.wake_owners.wait(&work_queue.mutex, work_queue.spin_budget_ns());
                 owned_job->owner_is_sleeping = false;
                 work_queue.owners_sleeping--;
             } else {
@@ -341,10 +617,10 @@ WEAK void worker_thread_already_locked(work *owned_job) {
                 if (work_queue.a_team_size > work_queue.target_a_team_size) {
                     // Transition to B team
                     work_queue.a_team_size--;
-                    work_queue.wake_b_team.wait(&work_queue.mutex);
+                    work_queue.wake_b_team.wait(&work_queue.mutex, work_queue.spin_budget_ns());
                     work_queue.a_team_size++;
                 } else {
-                    work_queue.wake_a_team.wait(&work_queue.mutex);
+                    work_queue.wake_a_team.wait(&work_queue.mutex, work_queue.spin_budget_ns());
                 }
                 work_queue.workers_sleeping--;
             }
@@ -357,6 +633,9 @@ WEAK void worker_thread_already_locked(work *owned_job) {
         // are aware that this job is still in progress even
         // though there are no outstanding tasks for it.
         job->active_workers++;
+        if (job->qos) {
+            job->qos->active_threads++;
+        }
 
         if (job->parent_job == nullptr) {
             work_queue.threads_reserved += job->task.min_threads;
@@ -406,10 +685,11 @@ WEAK void worker_thread_already_locked(work *owned_job) {
                 work_queue.jobs = job;
             }
         } else {
-            // Claim a task from it.
+            // Claim some tasks from it.
+            const int iters = chunk_size(job);
             work myjob = *job;
-            job->task.min++;
-            job->task.extent--;
+            job->task.min += iters;
+            job->task.extent -= iters;
 
             // If there were no more tasks pending for this job, remove it
             // from the stack.
@@ -417,17 +697,26 @@ WEAK void worker_thread_already_locked(work *owned_job) {
                 *prev_ptr = job->next_job;
             }
 
-            // Release the lock and do the task.
+            // Release the lock and do the tasks.
             halide_mutex_unlock(&work_queue.mutex);
+            const bool timed = work_queue.chunking - 1 == halide_thread_pool_chunking_adaptive;
+            const int64_t start_ns = timed ? spin_clock_ns() : 0;
             if (myjob.task_fn) {
-                result = halide_do_task(myjob.user_context, myjob.task_fn,
-                                        myjob.task.min, myjob.task.closure);
+                for (int i = 0; i < iters && result == halide_error_code_success; i++) {
+                    result = halide_do_task(myjob.user_context, myjob.task_fn,
+                                            myjob.task.min + i, myjob.task.closure);
+                }
             } else {
                 result = halide_do_loop_task(myjob.user_context, myjob.task.fn,
-                                             myjob.task.min, 1,
+                                             myjob.task.min, iters,
                                              myjob.task.closure, job);
             }
+            const int64_t iteration_ns = timed ? max((spin_clock_ns() - start_ns) / iters, (int64_t)1) : 0;
             halide_mutex_lock(&work_queue.mutex);
+            if (timed) {
+                job->mean_iteration_ns =
+                    job->mean_iteration_ns ? (3 * job->mean_iteration_ns + iteration_ns) / 4 : iteration_ns;
+            }
         }
 
         if (result != halide_error_code_success) {
@@ -460,6 +749,9 @@ WEAK void worker_thread_already_locked(work *owned_job) {
 
         // We are no longer active on this job
         job->active_workers--;
+        if (job->qos) {
+            job->qos->active_threads--;
+        }
 
         log_message("Done working on job " << job->task.name);
 
@@ -477,7 +769,14 @@ WEAK void worker_thread(void *arg) {
     halide_mutex_unlock(&work_queue.mutex);
 }
 
-WEAK void enqueue_work_already_locked(int num_jobs, work *jobs, work *task_parent) {
+// Entry point for worker threads of a NUMA-aware thread pool. The
+// argument is the node to pin the thread to.
+WEAK void numa_worker_thread(void *arg) {
+    halide_pin_current_thread_to_numa_node((int)(intptr_t)arg);
+    worker_thread(nullptr);
+}
+
+WEAK void initialize_work_queue_already_locked() {
     if (!work_queue.initialized) {
         work_queue.assert_zeroed();
 
@@ -488,8 +787,61 @@ WEAK void enqueue_work_already_locked(int num_jobs, work *jobs, work *task_paren
             work_queue.desired_threads_working = default_desired_num_threads();
         }
         work_queue.desired_threads_working = clamp_num_threads(work_queue.desired_threads_working);
+        if (!work_queue.work_stealing) {
+            work_queue.work_stealing = default_work_stealing() ? 1 : -1;
+        }
+        if (!work_queue.numa_aware) {
+            work_queue.numa_aware = default_numa_aware() ? 1 : -1;
+        }
+        if (work_queue.numa_aware > 0) {
+            work_queue.numa_nodes = halide_host_numa_node_count();
+        }
+        if (!work_queue.spin_policy) {
+            work_queue.spin_policy = default_spin_policy(&work_queue.spin_us) + 1;
+        }
+        if (!work_queue.chunking) {
+            work_queue.chunking = default_chunking() + 1;
+        }
+        if (!work_queue.creation_policy) {
+            work_queue.creation_policy = default_creation_policy() + 1;
+        }
+#if HALIDE_THREAD_POOL_HAS_CLOCK
+        if (work_queue.spin_policy - 1 == halide_thread_pool_spin_hot ||
+            work_queue.spin_policy - 1 == halide_thread_pool_spin_adaptive ||
+            work_queue.chunking - 1 == halide_thread_pool_chunking_adaptive) {
+            halide_start_clock(nullptr);
+        }
+#endif
         work_queue.initialized = true;
     }
+}
+
+WEAK void spawn_worker_thread_already_locked() {
+    work_queue.a_team_size++;
+    if (work_queue.numa_nodes > 1) {
+        // Deal the workers out to the nodes round-robin. The
+        // main thread counts as the first thread on node zero.
+        intptr_t node = (work_queue.threads_created + 1) % work_queue.numa_nodes;
+        work_queue.threads[work_queue.threads_created++] =
+            halide_spawn_thread(numa_worker_thread, (void *)node);
+    } else {
+        work_queue.threads[work_queue.threads_created++] =
+            halide_spawn_thread(worker_thread, nullptr);
+    }
+}
+
+WEAK void enqueue_work_already_locked(int num_jobs, work *jobs, work *task_parent) {
+    initialize_work_queue_already_locked();
+
+    if (work_queue.spin_policy - 1 == halide_thread_pool_spin_adaptive) {
+        const int64_t now = spin_clock_ns();
+        if (work_queue.last_enqueue_ns) {
+            const int64_t gap = now - work_queue.last_enqueue_ns;
+            work_queue.mean_enqueue_gap_ns =
+                work_queue.mean_enqueue_gap_ns ? (3 * work_queue.mean_enqueue_gap_ns + gap) / 4 : gap;
+        }
+        work_queue.last_enqueue_ns = now;
+    }
 
     // Gather some information about the work.
 
@@ -541,14 +893,13 @@ WEAK void enqueue_work_already_locked(int num_jobs, work *jobs, work *task_paren
         }
 
         // Spawn more threads if necessary.
+        const bool eager = work_queue.creation_policy - 1 == halide_thread_pool_create_eager;
         while (work_queue.threads_created < MAX_THREADS &&
-               ((work_queue.threads_created < work_queue.desired_threads_working - 1) ||
+               ((eager && work_queue.threads_created < work_queue.desired_threads_working - 1) ||
                 (work_queue.threads_created + 1) - work_queue.threads_reserved < min_threads)) {
             // We might need to make some new threads, if work_queue.desired_threads_working has
             // increased, or if there aren't enough threads to complete this new task.
-            work_queue.a_team_size++;
-            work_queue.threads[work_queue.threads_created++] =
-                halide_spawn_thread(worker_thread, nullptr);
+            spawn_worker_thread_already_locked();
         }
         log_message("enqueue_work_already_locked top level job " << jobs[0].task.name << " with min_threads " << min_threads << " work_queue.threads_created " << work_queue.threads_created << " work_queue.threads_reserved " << work_queue.threads_reserved);
         if (job_has_acquires || job_may_block) {
@@ -564,6 +915,18 @@ WEAK void enqueue_work_already_locked(int num_jobs, work *jobs, work *task_paren
         }
     }
 
+    if (work_queue.creation_policy - 1 == halide_thread_pool_create_on_demand) {
+        // Make sure there's a thread for each of the new tasks beyond
+        // the one this thread will run, up to the desired number. This
+        // is safe for nested jobs too, as extra threads only ever add
+        // to the threads available.
+        int wanted = min(workers_to_wake, work_queue.desired_threads_working - 1);
+        while (work_queue.threads_created < MAX_THREADS &&
+               work_queue.threads_created < wanted) {
+            spawn_worker_thread_already_locked();
+        }
+    }
+
     // Push the jobs onto the stack.
     for (int i = num_jobs - 1; i >= 0; i--) {
         // We could bubble it downwards based on some heuristics, but
@@ -572,6 +935,8 @@ WEAK void enqueue_work_already_locked(int num_jobs, work *jobs, work *task_paren
         jobs[i].siblings = &jobs[0];
         jobs[i].sibling_count = num_jobs;
         jobs[i].threads_reserved = 0;
+        jobs[i].qos = thread_pool_qos_count ? find_thread_pool_qos(jobs[i].user_context) : nullptr;
+        jobs[i].mean_iteration_ns = 0;
         work_queue.jobs = jobs + i;
     }
 
@@ -605,6 +970,175 @@ WEAK void enqueue_work_already_locked(int num_jobs, work *jobs, work *task_paren
     }
 }
 
+// Work-stealing support for halide_default_do_par_for. Instead of
+// enqueuing one job and having every thread claim its iterations one
+// at a time under the work queue mutex, the iteration space is divided
+// up front into one contiguous range per participating thread. A
+// participant takes iterations off the front of its own range, and once
+// that is exhausted it steals the back half of some other participant's
+// range. Stealing half at a time splits big ranges recursively, so the
+// load balances itself while the work queue mutex is only touched a
+// handful of times per loop rather than once per iteration.
+//
+// When the thread pool is NUMA-aware, the ranges are also assigned to
+// NUMA nodes in contiguous blocks, so a given part of the iteration
+// space of a loop is consistently run on the same node. Pages first
+// touched by one parallel loop are therefore mostly read back by
+// threads on the same node in later loops over the same domain.
+// Participants pick a range belonging to the node they are running on,
+// and prefer to steal from ranges on the same node.
+struct work_stealing_range {
+    // [begin, end) relative to the loop min, packed as (end << 32) |
+    // begin so that the whole range can be updated with a single
+    // compare-and-swap.
+    uint64_t packed;
+    // Whether some participant has taken this range as its own. Only
+    // accessed atomically, and only used by NUMA-aware loops.
+    int claimed;
+    // Keep each range on its own cache line to avoid false sharing
+    // between the owner and thieves of neighboring ranges.
+    uint8_t padding[64 - sizeof(uint64_t) - sizeof(int)];
+};
+
+struct work_stealing_loop {
+    halide_task_t fn;
+    int min;
+    uint8_t *closure;
+    int num_ranges;
+    work_stealing_range *ranges;
+    // One for loops that are not NUMA-aware.
+    int num_nodes;
+    // Only accessed atomically. Set by the first failing iteration to
+    // ask the other participants to stop early.
+    int exit_status;
+};
+
+ALWAYS_INLINE uint64_t pack_range(uint32_t begin, uint32_t end) {
+    return ((uint64_t)end << 32) | begin;
+}
+
+// Claim the first iteration of a range. Called by the owner of the range.
+ALWAYS_INLINE bool take_from_front(work_stealing_range *r, uint32_t *iter) {
+    uint64_t expected;
+    Synchronization::atomic_load_acquire(&r->packed, &expected);
+    while (true) {
+        uint32_t begin = (uint32_t)expected, end = (uint32_t)(expected >> 32);
+        if (begin >= end) {
+            return false;
+        }
+        uint64_t desired = pack_range(begin + 1, end);
+        if (Synchronization::atomic_cas_weak_relacq_relaxed(&r->packed, &expected, &desired)) {
+            *iter = begin;
+            return true;
+        }
+    }
+}
+
+// Steal the back half of a range (or all of it if it only has one
+// iteration left). Called by participants that have run out of work.
+ALWAYS_INLINE bool steal_back_half(work_stealing_range *r, uint32_t *begin_out, uint32_t *end_out) {
+    uint64_t expected;
+    Synchronization::atomic_load_acquire(&r->packed, &expected);
+    while (true) {
+        uint32_t begin = (uint32_t)expected, end = (uint32_t)(expected >> 32);
+        if (begin >= end) {
+            return false;
+        }
+        uint32_t mid = begin + (end - begin) / 2;
+        uint64_t desired = pack_range(begin, mid);
+        if (Synchronization::atomic_cas_weak_relacq_relaxed(&r->packed, &expected, &desired)) {
+            *begin_out = mid;
+            *end_out = end;
+            return true;
+        }
+    }
+}
+
+ALWAYS_INLINE int range_node(const work_stealing_loop *loop, int r) {
+    return (int)(((int64_t)r * loop->num_nodes) / loop->num_ranges);
+}
+
+// Pick an unclaimed range to own, preferring ones assigned to the
+// given node. There is exactly one participant per range, so this
+// always succeeds.
+WEAK int claim_range(work_stealing_loop *loop, int node) {
+    // The first range assigned to the node.
+    int first = (int)(((int64_t)node * loop->num_ranges + loop->num_nodes - 1) / loop->num_nodes);
+    for (int i = 0; i < loop->num_ranges; i++) {
+        int r = (first + i) % loop->num_ranges;
+        int expected = 0, desired = 1;
+        if (Synchronization::atomic_cas_strong_sequentially_consistent(&loop->ranges[r].claimed, &expected, &desired)) {
+            return r;
+        }
+    }
+    halide_abort_if_false(nullptr, false && "Logic error: no unclaimed range for work-stealing participant.\n");
+    return 0;
+}
+
+// The body run by each participant of a work-stealing loop. This is
+// enqueued as an ordinary halide_task_t job with one task per range.
+WEAK int work_stealing_participant(void *user_context, int idx, uint8_t *closure) {
+    work_stealing_loop *loop = (work_stealing_loop *)closure;
+    if (loop->num_nodes > 1) {
+        int node = halide_current_numa_node();
+        if (node >= loop->num_nodes) {
+            node %= loop->num_nodes;
+        }
+        idx = claim_range(loop, node);
+    }
+    work_stealing_range *mine = loop->ranges + idx;
+    const int my_node = range_node(loop, idx);
+    int exit_status = halide_error_code_success;
+    while (true) {
+        uint32_t iter;
+        if (!take_from_front(mine, &iter)) {
+            // Our own range is empty. Try to steal from the others,
+            // starting with our neighbor so that thieves spread
+            // out. The first pass only considers ranges on our own
+            // NUMA node, the second pass the rest.
+            bool stole = false;
+            for (int i = 1; i < loop->num_ranges * 2 && !stole; i++) {
+                int v = (idx + i) % loop->num_ranges;
+                bool first_pass = i < loop->num_ranges;
+                if (v == idx || first_pass != (range_node(loop, v) == my_node)) {
+                    continue;
+                }
+                work_stealing_range *victim = loop->ranges + v;
+                uint32_t begin, end;
+                if (steal_back_half(victim, &begin, &end)) {
+                    iter = begin;
+                    if (begin + 1 < end) {
+                        // Our range is empty and can't be claimed
+                        // by anyone else, so a plain store suffices
+                        // to publish the remainder for other thieves.
+                        uint64_t rest = pack_range(begin + 1, end);
+                        Synchronization::atomic_store_release(&mine->packed, &rest);
+                    }
+                    stole = true;
+                }
+            }
+            if (!stole) {
+                // Every iteration is either done or held by a live
+                // participant that will run it.
+                break;
+            }
+        }
+
+        Synchronization::atomic_load_relaxed(&loop->exit_status, &exit_status);
+        if (exit_status != halide_error_code_success) {
+            break;
+        }
+
+        int result = halide_do_task(user_context, loop->fn, loop->min + (int)iter, loop->closure);
+        if (result != halide_error_code_success) {
+            Synchronization::atomic_store_relaxed(&loop->exit_status, &result);
+            exit_status = result;
+            break;
+        }
+    }
+    return exit_status;
+}
+
 WEAK halide_do_task_t custom_do_task = halide_default_do_task;
 WEAK halide_do_loop_task_t custom_do_loop_task = halide_default_do_loop_task;
 WEAK halide_do_par_for_t custom_do_par_for = halide_default_do_par_for;
@@ -664,6 +1198,45 @@ WEAK int halide_default_do_par_for(void *user_context, halide_task_t f,
     job.sibling_count = 0;
     job.parent_job = nullptr;
     halide_mutex_lock(&work_queue.mutex);
+    initialize_work_queue_already_locked();
+
+    work_stealing_loop loop;
+    if ((work_queue.work_stealing > 0 || work_queue.numa_nodes > 1) && size > 1) {
+        // Replace the job with one task per participating thread, each
+        // of which works through its own range and then steals from
+        // the others. NUMA-aware thread pools always do this, because
+        // it's how loop iterations get assigned to nodes.
+        int num_ranges = work_queue.desired_threads_working;
+        const thread_pool_qos *qos = thread_pool_qos_count ? find_thread_pool_qos(user_context) : nullptr;
+        if (qos && qos->max_threads > 0 && num_ranges > qos->max_threads) {
+            num_ranges = qos->max_threads;
+        }
+        if (num_ranges > size) {
+            num_ranges = size;
+        }
+        int num_nodes = work_queue.numa_nodes > 1 ? work_queue.numa_nodes : 1;
+        if (num_nodes > num_ranges) {
+            num_nodes = num_ranges;
+        }
+        loop.fn = f;
+        loop.min = min;
+        loop.closure = closure;
+        loop.num_ranges = num_ranges;
+        loop.ranges = (work_stealing_range *)__builtin_alloca(sizeof(work_stealing_range) * num_ranges);
+        loop.num_nodes = num_nodes;
+        loop.exit_status = halide_error_code_success;
+        for (int i = 0; i < num_ranges; i++) {
+            uint32_t begin = (uint32_t)(((int64_t)size * i) / num_ranges);
+            uint32_t end = (uint32_t)(((int64_t)size * (i + 1)) / num_ranges);
+            loop.ranges[i].packed = pack_range(begin, end);
+            loop.ranges[i].claimed = 0;
+        }
+        job.task.min = 0;
+        job.task.extent = num_ranges;
+        job.task.closure = (uint8_t *)&loop;
+        job.task_fn = work_stealing_participant;
+    }
+
     enqueue_work_already_locked(1, &job, nullptr);
     worker_thread_already_locked(&job);
     halide_mutex_unlock(&work_queue.mutex);
@@ -727,11 +1300,134 @@ WEAK int halide_set_num_threads(int n) {
     return old;
 }
 
+WEAK bool halide_set_thread_pool_work_stealing(bool enable) {
+    halide_mutex_lock(&work_queue.mutex);
+    bool old = work_queue.work_stealing ? work_queue.work_stealing > 0 : default_work_stealing();
+    work_queue.work_stealing = enable ? 1 : -1;
+    halide_mutex_unlock(&work_queue.mutex);
+    return old;
+}
+
+WEAK bool halide_set_thread_pool_numa_aware(bool enable) {
+    halide_mutex_lock(&work_queue.mutex);
+    bool old = work_queue.numa_aware ? work_queue.numa_aware > 0 : default_numa_aware();
+    work_queue.numa_aware = enable ? 1 : -1;
+    if (work_queue.initialized) {
+        // Threads that already exist stay where they are, but new
+        // threads and new loops respect the setting.
+        work_queue.numa_nodes = enable ? halide_host_numa_node_count() : 0;
+    }
+    halide_mutex_unlock(&work_queue.mutex);
+    return old;
+}
+
+WEAK halide_thread_pool_spin_t halide_set_thread_pool_spin_policy(halide_thread_pool_spin_t policy, int spin_us) {
+    halide_mutex_lock(&work_queue.mutex);
+    int old_spin_us = 0;
+    halide_thread_pool_spin_t old = work_queue.spin_policy ?
+                                        (halide_thread_pool_spin_t)(work_queue.spin_policy - 1) :
+                                        default_spin_policy(&old_spin_us);
+    work_queue.spin_policy = policy + 1;
+    work_queue.spin_us = spin_us > 0 ? spin_us : 0;
+    work_queue.mean_enqueue_gap_ns = 0;
+    work_queue.last_enqueue_ns = 0;
+#if HALIDE_THREAD_POOL_HAS_CLOCK
+    if (policy == halide_thread_pool_spin_hot || policy == halide_thread_pool_spin_adaptive) {
+        halide_start_clock(nullptr);
+    }
+#endif
+    halide_mutex_unlock(&work_queue.mutex);
+    return old;
+}
+
+WEAK halide_thread_pool_chunking_t halide_set_thread_pool_chunking(halide_thread_pool_chunking_t chunking) {
+    halide_mutex_lock(&work_queue.mutex);
+    halide_thread_pool_chunking_t old = work_queue.chunking ?
+                                            (halide_thread_pool_chunking_t)(work_queue.chunking - 1) :
+                                            default_chunking();
+    work_queue.chunking = chunking + 1;
+#if HALIDE_THREAD_POOL_HAS_CLOCK
+    if (chunking == halide_thread_pool_chunking_adaptive) {
+        halide_start_clock(nullptr);
+    }
+#endif
+    halide_mutex_unlock(&work_queue.mutex);
+    return old;
+}
+
+WEAK halide_thread_pool_creation_t halide_set_thread_pool_creation_policy(halide_thread_pool_creation_t policy) {
+    halide_mutex_lock(&work_queue.mutex);
+    halide_thread_pool_creation_t old = work_queue.creation_policy ?
+                                            (halide_thread_pool_creation_t)(work_queue.creation_policy - 1) :
+                                            default_creation_policy();
+    work_queue.creation_policy = policy + 1;
+    halide_mutex_unlock(&work_queue.mutex);
+    return old;
+}
+
+WEAK int halide_thread_pool_prewarm(void *user_context) {
+    halide_mutex_lock(&work_queue.mutex);
+    initialize_work_queue_already_locked();
+    while (work_queue.threads_created < MAX_THREADS &&
+           work_queue.threads_created < work_queue.desired_threads_working - 1) {
+        spawn_worker_thread_already_locked();
+    }
+    halide_mutex_unlock(&work_queue.mutex);
+    return halide_error_code_success;
+}
+
+WEAK int halide_set_thread_pool_qos(void *user_context, int max_threads, int priority) {
+    if (max_threads < 0) {
+        halide_error(user_context, "halide_set_thread_pool_qos: max_threads must be >= 0.");
+        return halide_error_code_generic_error;
+    }
+    int result = halide_error_code_success;
+    halide_mutex_lock(&work_queue.mutex);
+    thread_pool_qos *qos = find_thread_pool_qos(user_context);
+    if (max_threads == 0 && priority == 0) {
+        // Back to the defaults. Entries are never moved, as jobs may
+        // point to them.
+        if (qos) {
+            qos->in_use = false;
+            qos->max_threads = 0;
+            qos->priority = 0;
+            while (thread_pool_qos_count && !thread_pool_qos_table[thread_pool_qos_count - 1].in_use) {
+                thread_pool_qos_count--;
+            }
+        }
+    } else {
+        for (int i = 0; !qos && i < MAX_THREAD_POOL_QOS; i++) {
+            thread_pool_qos *entry = &thread_pool_qos_table[i];
+            if (!entry->in_use && entry->active_threads == 0) {
+                qos = entry;
+                if (i >= thread_pool_qos_count) {
+                    thread_pool_qos_count = i + 1;
+                }
+            }
+        }
+        if (qos) {
+            qos->in_use = true;
+            qos->user_context = user_context;
+            qos->max_threads = max_threads;
+            qos->priority = priority;
+        } else {
+            result = halide_error_code_generic_error;
+        }
+    }
+    halide_mutex_unlock(&work_queue.mutex);
+    if (result != halide_error_code_success) {
+        halide_error(user_context, "halide_set_thread_pool_qos: too many user_contexts have settings.");
+    }
+    return result;
+}
+
 WEAK int halide_get_num_threads() {
     halide_mutex_lock(&work_queue.mutex);
     int n = work_queue.desired_threads_working;
     halide_mutex_unlock(&work_queue.mutex);
-    return n;
+    // If the thread pool hasn't started yet, report the number of threads
+    // it will start with.
+    return n ? n : clamp_num_threads(default_desired_num_threads());
 }
 
 WEAK void halide_shutdown_thread_pool() {
@@ -756,21 +1452,22 @@ WEAK void halide_shutdown_thread_pool() {
     }
 }
 
-struct halide_semaphore_impl_t {
-    int value;
-};
-
 WEAK int halide_default_semaphore_init(halide_semaphore_t *s, int n) {
     halide_semaphore_impl_t *sem = (halide_semaphore_impl_t *)s;
+    int zero = 0;
+    Halide::Runtime::Internal::Synchronization::atomic_store_release(&sem->waiters, &zero);
     Halide::Runtime::Internal::Synchronization::atomic_store_release(&sem->value, &n);
     return n;
 }
 
 WEAK int halide_default_semaphore_release(halide_semaphore_t *s, int n) {
     halide_semaphore_impl_t *sem = (halide_semaphore_impl_t *)s;
-    int old_val = Halide::Runtime::Internal::Synchronization::atomic_fetch_add_acquire_release(&sem->value, n);
-    // TODO(abadams|zvookin): Is this correct if an acquire can be for say count of 2 and the releases are 1 each?
-    if (old_val == 0 && n != 0) {  // Don't wake if nothing released.
+    int old_val = Halide::Runtime::Internal::Synchronization::atomic_fetch_add_sequentially_consistent(&sem->value, n);
+    // Only take the lock if a job is blocked on this semaphore. Jobs
+    // acquiring more than one at a time mark it again each time they fail,
+    // so every release that might make them runnable wakes them.
+    if (n != 0 &&
+        Halide::Runtime::Internal::Synchronization::atomic_fetch_and_sequentially_consistent(&sem->waiters, 0) != 0) {
         // We may have just made a job runnable
         halide_mutex_lock(&work_queue.mutex);
         work_queue.wake_a_team.broadcast();
@@ -1,6 +1,7 @@
 #include "HalideRuntime.h"
 #include "printer.h"
 #include "runtime_atomics.h"
+#include "scoped_mutex_lock.h"
 #include "scoped_spin_lock.h"
 
 extern "C" {
@@ -89,11 +90,96 @@ public:
 
 const static int buffer_size = 1024 * 1024;
 
+// The scratch space used to compress a full trace buffer into a block.
+struct TraceCompressor {
+    // The last position at which each hash of four bytes was seen.
+    uint32_t table[1 << 12];
+    uint8_t out[sizeof(halide_trace_block_header_t) + buffer_size];
+};
+
+ALWAYS_INLINE uint32_t load_u32(const uint8_t *p) {
+    uint32_t result;
+    memcpy(&result, p, sizeof(result));
+    return result;
+}
+
+// Compress size bytes of src into dst in the LZ4 block format, with a
+// greedy single-probe match finder, which is plenty for trace packets
+// (they repeat the same headers and Func names over and over). Returns
+// the compressed size, or zero if it wouldn't be smaller than capacity.
+WEAK uint32_t lz4_compress(const uint8_t *src, uint32_t size, uint8_t *dst, uint32_t capacity, uint32_t *table) {
+    // The format requires the last five bytes to be literals, and the
+    // last match to start at least twelve bytes before the end.
+    const uint32_t last_literals = 5, match_start_limit = 12;
+    uint32_t out = 0, anchor = 0, pos = 0;
+
+    const auto put_length = [&](uint32_t n) {
+        for (; n >= 255; n -= 255) {
+            dst[out++] = 255;
+        }
+        dst[out++] = (uint8_t)n;
+    };
+
+    // Emit the literals since the anchor, followed by a match if
+    // match_length is nonzero. Returns false if dst is too small.
+    const auto put_sequence = [&](uint32_t literals, uint32_t offset, uint32_t match_length) {
+        const uint32_t worst_case = 1 + literals / 255 + 1 + literals + 2 + match_length / 255 + 1;
+        if (out + worst_case > capacity) {
+            return false;
+        }
+        const uint32_t m = match_length ? match_length - 4 : 0;
+        dst[out++] = (uint8_t)(((literals < 15 ? literals : 15) << 4) | (m < 15 ? m : 15));
+        if (literals >= 15) {
+            put_length(literals - 15);
+        }
+        memcpy(dst + out, src + anchor, literals);
+        out += literals;
+        if (match_length) {
+            dst[out++] = (uint8_t)(offset & 0xff);
+            dst[out++] = (uint8_t)(offset >> 8);
+            if (m >= 15) {
+                put_length(m - 15);
+            }
+        }
+        return true;
+    };
+
+    if (size >= match_start_limit) {
+        memset(table, 0, sizeof(uint32_t) << 12);
+        while (pos + match_start_limit <= size) {
+            const uint32_t sequence = load_u32(src + pos);
+            const uint32_t hash = (sequence * 2654435761u) >> 20;
+            const uint32_t candidate = table[hash];
+            table[hash] = pos;
+            if (candidate >= pos || pos - candidate > 65535 || load_u32(src + candidate) != sequence) {
+                // Skip ahead faster the longer it's been since the last
+                // match, so incompressible data doesn't take too long.
+                pos += 1 + ((pos - anchor) >> 6);
+                continue;
+            }
+            uint32_t length = 4;
+            while (pos + length + last_literals < size && src[candidate + length] == src[pos + length]) {
+                length++;
+            }
+            if (!put_sequence(pos - anchor, pos - candidate, length)) {
+                return 0;
+            }
+            pos += length;
+            anchor = pos;
+        }
+    }
+    if (!put_sequence(size - anchor, 0, 0) || out >= capacity) {
+        return 0;
+    }
+    return out;
+}
+
 class TraceBuffer {
     SharedExclusiveSpinLock lock;
     uint32_t cursor = 0, overage = 0;
     uint8_t buf[buffer_size];
 
+public:
     // Attempt to atomically acquire space in the buffer to write a
     // packet. Returns nullptr if the buffer was full.
     ALWAYS_INLINE halide_trace_packet_t *try_acquire_packet(void *user_context, uint32_t size) {
@@ -115,15 +201,33 @@ class TraceBuffer {
         }
     }
 
-public:
     // Wait for all writers to finish with their packets, stall any
-    // new writers, and flush the buffer to the fd.
-    ALWAYS_INLINE void flush(void *user_context, int fd) {
+    // new writers, and flush the buffer to the fd. If compressor is
+    // non-null, the packets are written as a compressed block.
+    ALWAYS_INLINE void flush(void *user_context, int fd, TraceCompressor *compressor) {
         lock.acquire_exclusive();
         bool success = true;
         if (cursor) {
             cursor -= overage;
-            success = (cursor == (uint32_t)write(fd, buf, cursor));
+            if (compressor) {
+                halide_trace_block_header_t *header = (halide_trace_block_header_t *)compressor->out;
+                uint8_t *payload = (uint8_t *)(header + 1);
+                header->magic = HALIDE_TRACE_BLOCK_MAGIC;
+                header->uncompressed_size = cursor;
+                header->num_packets = 0;
+                for (uint32_t i = 0; i < cursor; i += ((halide_trace_packet_t *)(buf + i))->size) {
+                    header->num_packets++;
+                }
+                header->compressed_size = lz4_compress(buf, cursor, payload, cursor, compressor->table);
+                if (header->compressed_size == 0) {
+                    header->compressed_size = cursor;
+                    memcpy(payload, buf, cursor);
+                }
+                uint32_t block_size = sizeof(*header) + header->compressed_size;
+                success = (block_size == (uint32_t)write(fd, compressor->out, block_size));
+            } else {
+                success = (cursor == (uint32_t)write(fd, buf, cursor));
+            }
             cursor = 0;
             overage = 0;
         }
@@ -131,20 +235,6 @@ public:
         halide_abort_if_false(user_context, success && "Could not write to trace file");
     }
 
-    // Acquire and return a packet's worth of space in the trace
-    // buffer, flushing the trace buffer to the given fd to make space
-    // if necessary. The region acquired is protected from other
-    // threads writing or reading to it, so it must be released before
-    // a flush can occur.
-    ALWAYS_INLINE halide_trace_packet_t *acquire_packet(void *user_context, int fd, uint32_t size) {
-        halide_trace_packet_t *packet = nullptr;
-        while (!(packet = try_acquire_packet(user_context, size))) {
-            // Couldn't acquire space to write a packet. Flush and try again.
-            flush(user_context, fd);
-        }
-        return packet;
-    }
-
     // Release a packet, allowing it to be written out with flush
     ALWAYS_INLINE void release_packet(halide_trace_packet_t *) {
         using namespace Halide::Runtime::Internal::Synchronization;
@@ -163,12 +253,55 @@ public:
     TraceBuffer() = default;
 };
 
+// Packets are written to one of two buffers. When it fills up, the
+// other takes its place while it's flushed, so that writers aren't
+// stalled while it's compressed and written out.
+WEAK TraceBuffer *halide_trace_buffers[2] = {nullptr, nullptr};
 WEAK TraceBuffer *halide_trace_buffer = nullptr;
+// Held while a buffer is flushed, so the blocks are written in order.
+WEAK halide_mutex halide_trace_flush_lock = {{0}};
+// Non-null if HL_TRACE_COMPRESS=1.
+WEAK TraceCompressor *halide_trace_compressor = nullptr;
 WEAK int halide_trace_file = -1;  // -1 indicates uninitialized
 WEAK ScopedSpinLock::AtomicFlag halide_trace_file_lock = 0;
 WEAK bool halide_trace_file_initialized = false;
 WEAK void *halide_trace_file_internally_opened = nullptr;
 
+// Swap in the other buffer for the given full one, if it's still the one
+// being written to, and flush it.
+WEAK void flush_trace_buffer(void *user_context, int fd, TraceBuffer *full) {
+    using namespace Halide::Runtime::Internal::Synchronization;
+
+    ScopedMutexLock lock(&halide_trace_flush_lock);
+    TraceBuffer *current;
+    atomic_load_acquire(&halide_trace_buffer, &current);
+    if (current != full) {
+        // Another thread already flushed it.
+        return;
+    }
+    // The other buffer was flushed when it was last swapped out.
+    TraceBuffer *other = full == halide_trace_buffers[0] ? halide_trace_buffers[1] : halide_trace_buffers[0];
+    atomic_store_release(&halide_trace_buffer, &other);
+    full->flush(user_context, fd, halide_trace_compressor);
+}
+
+// Acquire and return a packet's worth of space in the current trace
+// buffer, flushing it to the given fd to make space if necessary. The
+// region acquired is protected from other threads writing or reading
+// to it, so it must be released before a flush can occur.
+WEAK halide_trace_packet_t *acquire_trace_packet(void *user_context, int fd, uint32_t size, TraceBuffer **buffer) {
+    using namespace Halide::Runtime::Internal::Synchronization;
+
+    while (true) {
+        atomic_load_acquire(&halide_trace_buffer, buffer);
+        if (halide_trace_packet_t *packet = (*buffer)->try_acquire_packet(user_context, size)) {
+            return packet;
+        }
+        // Couldn't acquire space to write a packet. Flush and try again.
+        flush_trace_buffer(user_context, fd, *buffer);
+    }
+}
+
 }  // namespace Internal
 }  // namespace Runtime
 }  // namespace Halide
@@ -195,7 +328,8 @@ WEAK int32_t halide_default_trace(void *user_context, const halide_trace_event_t
         uint32_t total_size = (total_size_without_padding + 3) & ~3;
 
         // Claim some space to write to in the trace buffer
-        halide_trace_packet_t *packet = halide_trace_buffer->acquire_packet(user_context, fd, total_size);
+        TraceBuffer *buffer;
+        halide_trace_packet_t *packet = acquire_trace_packet(user_context, fd, total_size, &buffer);
 
         if (total_size > 4096) {
             print(nullptr) << total_size << "\n";
@@ -219,12 +353,12 @@ WEAK int32_t halide_default_trace(void *user_context, const halide_trace_event_t
         memcpy((void *)packet->trace_tag(), e->trace_tag ? e->trace_tag : "", trace_tag_bytes);
 
         // Release it
-        halide_trace_buffer->release_packet(packet);
+        buffer->release_packet(packet);
 
         // We should also flush the trace buffer if we hit an event
         // that might be the end of the trace.
         if (e->event == halide_trace_end_pipeline) {
-            halide_trace_buffer->flush(user_context, fd);
+            flush_trace_buffer(user_context, fd, buffer);
         }
 
     } else {
@@ -372,8 +506,16 @@ WEAK int halide_get_trace_file(void *user_context) {
             halide_set_trace_file(fileno(file));
             halide_trace_file_internally_opened = file;
             if (!halide_trace_buffer) {
-                halide_trace_buffer = (TraceBuffer *)malloc(sizeof(TraceBuffer));
-                halide_trace_buffer->init();
+                for (TraceBuffer *&b : halide_trace_buffers) {
+                    b = (TraceBuffer *)malloc(sizeof(TraceBuffer));
+                    halide_abort_if_false(user_context, b && "Failed to allocate trace buffer\n");
+                    b->init();
+                }
+                halide_trace_buffer = halide_trace_buffers[0];
+                const char *compress = getenv("HL_TRACE_COMPRESS");
+                if (compress && compress[0] == '1') {
+                    halide_trace_compressor = (TraceCompressor *)malloc(sizeof(TraceCompressor));
+                }
             }
         } else {
             halide_set_trace_file(0);
@@ -392,9 +534,13 @@ WEAK int halide_shutdown_trace() {
         halide_trace_file = 0;
         halide_trace_file_initialized = false;
         halide_trace_file_internally_opened = nullptr;
-        if (halide_trace_buffer) {
-            free(halide_trace_buffer);
+        for (TraceBuffer *&b : halide_trace_buffers) {
+            free(b);
+            b = nullptr;
         }
+        halide_trace_buffer = nullptr;
+        free(halide_trace_compressor);
+        halide_trace_compressor = nullptr;
         if (ret != 0) {
             return halide_error_code_trace_failed;
         }
@@ -181,6 +181,7 @@ WEAK void halide_vulkan_finalize_kernels(void *user_context, void *state_ptr) {
     VulkanContext ctx(user_context);
     if (ctx.error == halide_error_code_success) {
         compilation_cache.release_hold(user_context, ctx.device, state_ptr);
+        vk_save_pipeline_cache(user_context, ctx.allocator);
     }
 
 #ifdef DEBUG_RUNTIME
@@ -381,6 +382,12 @@ WEAK int halide_vulkan_copy_to_device(void *user_context, halide_buffer_t *halid
         error(user_context) << "Vulkan: Missing host/device pointers for halide buffer!\n";
         return halide_error_code_internal_error;
     }
+    // Zero-copy buffers are coherent and their host pointer aliases the device memory
+    if (vk_is_zero_copy_memory(reinterpret_cast<MemoryRegion *>(halide_buffer->device)->properties)) {
+        debug(user_context) << "    no copy needed for zero-copy buffer\n";
+        return halide_error_code_success;
+    }
+
     device_copy copy_helper = make_host_to_device_copy(halide_buffer);
 
     // We construct a staging buffer to copy into from host memory.  Then,
@@ -568,6 +575,13 @@ WEAK int halide_vulkan_copy_to_host(void *user_context, halide_buffer_t *halide_
         return halide_error_code_internal_error;
     }
 
+    // Zero-copy buffers are coherent and every dispatch waits for the queue to go idle,
+    // so the host already sees the results
+    if (vk_is_zero_copy_memory(reinterpret_cast<MemoryRegion *>(halide_buffer->device)->properties)) {
+        debug(user_context) << "    no copy needed for zero-copy buffer\n";
+        return halide_error_code_success;
+    }
+
     device_copy copy_helper = make_device_to_host_copy(halide_buffer);
 
     // This is the inverse of copy_to_device: we create a staging buffer, copy into
@@ -1122,12 +1136,12 @@ WEAK int halide_vulkan_run(void *user_context,
     //    2b. Create a pipeline layout
     //    2c. Create a compute pipeline
     //    --- Apply specializations to pipeline for shared memory or workgroup sizes
-    //    2d. Create a descriptor set
+    //    2d. Create a descriptor pool
     //    --- The above can be cached between invocations ---
     // 3. Set bindings for buffers and args in the descriptor set
     //    3a. Create the buffer for the scalar params
     //    3b. Copy args into uniform buffer
-    //    3c. Update buffer bindings for descriptor set
+    //    3c. Acquire a descriptor set for the buffer bindings (re-using a previously written one if they match)
     // 4. Create a command buffer from the command pool
     // 5. Fill the command buffer with a dispatch call
     //    7a. Bind the compute pipeline
@@ -1220,28 +1234,22 @@ WEAK int halide_vulkan_run(void *user_context,
         return error_code;
     }
 
-    // 2d. Create a descriptor set
-    if (entry_point_binding->descriptor_set == VK_NULL_HANDLE) {
+    // 2d. Create a descriptor pool
+    if (entry_point_binding->descriptor_pool == VK_NULL_HANDLE) {
 
         // Construct a descriptor pool
         //
         // NOTE: while this could be re-used across multiple pipelines, we only know the storage requirements of this kernel's
-        //       inputs and outputs ... so create a pool specific to the number of buffers known at this time
+        //       inputs and outputs ... so create a pool specific to the number of buffers known at this time, with room
+        //       for a few descriptor sets so dispatches with differing buffers don't have to rewrite a single set
 
         uint32_t uniform_buffer_count = entry_point_binding->uniform_buffer_count;
         uint32_t storage_buffer_count = entry_point_binding->storage_buffer_count;
-        error_code = vk_create_descriptor_pool(user_context, ctx.allocator, uniform_buffer_count, storage_buffer_count, &(entry_point_binding->descriptor_pool));
+        error_code = vk_create_descriptor_pool(user_context, ctx.allocator, vk_descriptor_set_pool_size, uniform_buffer_count, storage_buffer_count, &(entry_point_binding->descriptor_pool));
         if (error_code != halide_error_code_success) {
             error(user_context) << "Vulkan: Unable to create shader module ... failed to create descriptor pool!\n";
             return error_code;
         }
-
-        // Create the descriptor set
-        error_code = vk_create_descriptor_set(user_context, ctx.allocator, shader_module->descriptor_set_layouts[entry_point_index], entry_point_binding->descriptor_pool, &(entry_point_binding->descriptor_set));
-        if (error_code != halide_error_code_success) {
-            error(user_context) << "Vulkan: Unable to create shader module ... failed to create descriptor set!\n";
-            return error_code;
-        }
     }
 
     // 3a. Create a buffer for the scalar parameters
@@ -1272,8 +1280,19 @@ WEAK int halide_vulkan_run(void *user_context,
         }
     }
 
-    // 3c. Update buffer bindings for descriptor set
-    error_code = vk_update_descriptor_set(user_context, ctx.allocator, args_buffer, entry_point_binding->uniform_buffer_count, entry_point_binding->storage_buffer_count, arg_sizes, args, arg_is_buffer, entry_point_binding->descriptor_set);
+    // 3c. Gather the buffer bindings and acquire a descriptor set written with them
+    BlockStorage::Config dbi_config;
+    dbi_config.minimum_capacity = entry_point_binding->uniform_buffer_count + entry_point_binding->storage_buffer_count;
+    dbi_config.entry_size = sizeof(VkDescriptorBufferInfo);
+    BlockStorage descriptor_buffer_info(user_context, dbi_config);
+    error_code = vk_get_descriptor_buffer_info(user_context, ctx.allocator, args_buffer, arg_sizes, args, arg_is_buffer, descriptor_buffer_info);
+    if (error_code != halide_error_code_success) {
+        error(user_context) << "Vulkan: Failed to gather descriptor buffer bindings!\n";
+        return error_code;
+    }
+
+    VkDescriptorSet descriptor_set = VK_NULL_HANDLE;
+    error_code = vk_acquire_descriptor_set(user_context, ctx.allocator, entry_point_binding, shader_module->descriptor_set_layouts[entry_point_index], args_buffer != nullptr, descriptor_buffer_info, &descriptor_set);
     if (error_code != halide_error_code_success) {
         error(user_context) << "Vulkan: Failed to update descriptor set!\n";
         return error_code;
@@ -1291,7 +1310,7 @@ WEAK int halide_vulkan_run(void *user_context,
                                                            ctx.device, cmds.command_buffer,
                                                            entry_point_binding->compute_pipeline,
                                                            shader_module->pipeline_layout,
-                                                           entry_point_binding->descriptor_set,
+                                                           descriptor_set,
                                                            entry_point_index,
                                                            blocksX, blocksY, blocksZ);
     if (error_code != halide_error_code_success) {
@@ -1328,10 +1347,93 @@ WEAK int halide_vulkan_run(void *user_context,
 }
 
 WEAK int halide_vulkan_device_and_host_malloc(void *user_context, struct halide_buffer_t *buf) {
+    debug(user_context)
+        << "halide_vulkan_device_and_host_malloc (user_context: " << user_context
+        << ", buf: " << buf << ")\n";
+
+    if ((buf->device == 0) && (buf->host == nullptr)) {
+        VulkanContext ctx(user_context);
+        if (ctx.error != halide_error_code_success) {
+            error(user_context) << "Vulkan: Failed to acquire context!\n";
+            return ctx.error;
+        }
+
+        // On devices with unified memory, allocate host-visible device-local memory and keep it
+        // mapped, so the host and device pointers alias and copies between them become no-ops
+        if (vk_supports_zero_copy_memory(user_context, ctx.allocator)) {
+            size_t size = buf->size_in_bytes();
+            if (size == 0) {
+                error(user_context) << "Vulkan: Failed to allocate buffer of size 0!\n";
+                return halide_error_code_device_malloc_failed;
+            }
+
+            MemoryRequest request = {0};
+            request.size = size;
+            request.dedicated = true;
+            request.properties.usage = MemoryUsage::TransferSrcDst;
+            request.properties.caching = MemoryCaching::CachedCoherent;
+            request.properties.visibility = MemoryVisibility::DeviceToHost;
+
+            MemoryRegion *device_region = ctx.allocator->reserve(user_context, request);
+            if ((device_region == nullptr) || (device_region->handle == nullptr)) {
+                error(user_context) << "Vulkan: Failed to allocate zero-copy device memory!\n";
+                return halide_error_code_device_malloc_failed;
+            }
+
+            uint8_t *host_ptr = (uint8_t *)ctx.allocator->map(user_context, device_region);
+            if (host_ptr == nullptr) {
+                ctx.allocator->reclaim(user_context, device_region);
+                error(user_context) << "Vulkan: Failed to map zero-copy device memory!\n";
+                return halide_error_code_internal_error;
+            }
+
+            buf->host = host_ptr;
+            buf->device = (uint64_t)device_region;
+            buf->device_interface = &vulkan_device_interface;
+            buf->device_interface->impl->use_module();
+
+#ifdef DEBUG_RUNTIME
+            debug(user_context)
+                << "    allocated zero-copy device region=" << (void *)device_region << "\n"
+                << "    mapped to host=" << (void *)host_ptr << "\n"
+                << "    for halide buffer " << buf << "\n";
+#endif
+            return halide_error_code_success;
+        }
+    }
+
     return halide_default_device_and_host_malloc(user_context, buf, &vulkan_device_interface);
 }
 
 WEAK int halide_vulkan_device_and_host_free(void *user_context, struct halide_buffer_t *buf) {
+    debug(user_context)
+        << "halide_vulkan_device_and_host_free (user_context: " << user_context
+        << ", buf: " << buf << ")\n";
+
+    MemoryRegion *device_region = reinterpret_cast<MemoryRegion *>(buf->device);
+    if ((device_region != nullptr) && device_region->is_owner && vk_is_zero_copy_memory(device_region->properties)) {
+        {
+            VulkanContext ctx(user_context);
+            if (ctx.error != halide_error_code_success) {
+                error(user_context) << "Vulkan: Failed to acquire context!\n";
+                return ctx.error;
+            }
+
+            int error_code = ctx.allocator->unmap(user_context, device_region);
+            if (error_code != halide_error_code_success) {
+                error(user_context) << "Vulkan: Failed to unmap zero-copy device memory!\n";
+                return error_code;
+            }
+        }
+
+        // the host pointer aliases the device memory, so it goes away with it
+        int error_code = halide_vulkan_device_free(user_context, buf);
+        buf->host = nullptr;
+        buf->set_host_dirty(false);
+        buf->set_device_dirty(false);
+        return error_code;
+    }
+
     return halide_default_device_and_host_free(user_context, buf, &vulkan_device_interface);
 }
 
@@ -1355,6 +1457,7 @@ WEAK int halide_vulkan_detach_vk_buffer(void *user_context, halide_buffer_t *buf
         error(user_context) << "Vulkan: Unable to detach buffer ... invalid device interface!\n";
         return halide_error_code_incompatible_device_interface;
     }
+    Synchronization::atomic_fetch_add_acquire_release(&device_buffer_generation, uint64_t(1));
     buf->device = 0;
     buf->device_interface->impl->release_module();
     buf->device_interface = nullptr;
@@ -1393,6 +1496,56 @@ WEAK int halide_vulkan_release_unused_device_allocations(void *user_context) {
     return halide_error_code_success;
 }
 
+WEAK int halide_vulkan_defragment_device_memory(void *user_context) {
+    debug(user_context)
+        << "halide_vulkan_defragment_device_memory (user_context: " << user_context
+        << ")\n";
+
+    VulkanContext ctx(user_context);
+    if (ctx.error != halide_error_code_success) {
+        error(user_context) << "Vulkan: Failed to acquire context!\n";
+        return ctx.error;
+    }
+
+    // merge unused space within each block and release any that become empty
+    if (ctx.allocator) {
+        ctx.allocator->defragment(user_context);
+    }
+    return halide_error_code_success;
+}
+
+WEAK int halide_vulkan_get_device_memory_stats(void *user_context,
+                                               uint64_t *block_count, uint64_t *block_bytes,
+                                               uint64_t *reserved_bytes, uint64_t *available_bytes,
+                                               uint64_t *largest_available) {
+    VulkanContext ctx(user_context);
+    if (ctx.error != halide_error_code_success) {
+        error(user_context) << "Vulkan: Failed to acquire context!\n";
+        return ctx.error;
+    }
+
+    MemoryStats stats;
+    if (ctx.allocator) {
+        stats = ctx.allocator->current_stats(user_context);
+    }
+    if (block_count) {
+        *block_count = stats.block_count;
+    }
+    if (block_bytes) {
+        *block_bytes = stats.block_bytes;
+    }
+    if (reserved_bytes) {
+        *reserved_bytes = stats.reserved_bytes;
+    }
+    if (available_bytes) {
+        *available_bytes = stats.available_bytes;
+    }
+    if (largest_available) {
+        *largest_available = stats.largest_available;
+    }
+    return halide_error_code_success;
+}
+
 namespace {
 
 WEAK __attribute__((constructor)) void register_vulkan_allocation_pool() {
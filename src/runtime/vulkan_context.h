@@ -546,6 +546,7 @@ int vk_destroy_context(void *user_context, VulkanMemoryAllocator *allocator,
 
     if (allocator != nullptr) {
         vk_destroy_shader_modules(user_context, allocator);
+        vk_destroy_pipeline_cache(user_context, allocator);
         vk_destroy_memory_allocator(user_context, allocator);
         vk_destroy_debug_utils_messenger(user_context, instance, allocator, messenger);
     }
@@ -32,6 +32,10 @@ WEAK char alloc_config[1024];
 WEAK ScopedSpinLock::AtomicFlag alloc_config_lock = 0;
 WEAK bool alloc_config_initialized = false;
 
+WEAK char pipeline_cache_path[1024];
+WEAK ScopedSpinLock::AtomicFlag pipeline_cache_path_lock = 0;
+WEAK bool pipeline_cache_path_initialized = false;
+
 // --------------------------------------------------------------------------
 namespace {
 
@@ -128,6 +132,24 @@ const char *vk_get_alloc_config_internal(void *user_context) {
     return alloc_config;
 }
 
+void vk_set_pipeline_cache_path_internal(const char *n) {
+    if (n) {
+        size_t buffer_size = sizeof(pipeline_cache_path) / sizeof(pipeline_cache_path[0]);
+        StringUtils::copy_up_to(pipeline_cache_path, n, buffer_size);
+    } else {
+        pipeline_cache_path[0] = 0;
+    }
+    pipeline_cache_path_initialized = true;
+}
+
+const char *vk_get_pipeline_cache_path_internal(void *user_context) {
+    if (!pipeline_cache_path_initialized) {
+        const char *name = getenv("HL_VK_PIPELINE_CACHE");
+        vk_set_pipeline_cache_path_internal(name);
+    }
+    return pipeline_cache_path;
+}
+
 // --------------------------------------------------------------------------
 
 uint32_t vk_get_requested_layers(void *user_context, StringTable &layer_table) {
@@ -333,6 +355,16 @@ WEAK const char *halide_vulkan_get_alloc_config(void *user_context) {
     return vk_get_alloc_config_internal(user_context);
 }
 
+WEAK void halide_vulkan_set_pipeline_cache_path(const char *n) {
+    ScopedSpinLock lock(&pipeline_cache_path_lock);
+    vk_set_pipeline_cache_path_internal(n);
+}
+
+WEAK const char *halide_vulkan_get_pipeline_cache_path(void *user_context) {
+    ScopedSpinLock lock(&pipeline_cache_path_lock);
+    return vk_get_pipeline_cache_path_internal(user_context);
+}
+
 // --------------------------------------------------------------------------
 
 }  // extern "C"
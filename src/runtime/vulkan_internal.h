@@ -46,6 +46,8 @@ int vk_clear_device_buffer(void *user_context,
                            VkCommandBuffer command_buffer,
                            VkQueue command_queue,
                            VkBuffer device_buffer);
+bool vk_supports_zero_copy_memory(void *user_context, VulkanMemoryAllocator *allocator);
+
 // --------------------------------------------------------------------------
 // Context
 // --------------------------------------------------------------------------
@@ -144,6 +146,7 @@ int vk_destroy_scalar_uniform_buffer(void *user_context, VulkanMemoryAllocator *
 // -- Descriptor Pool
 int vk_create_descriptor_pool(void *user_context,
                               VulkanMemoryAllocator *allocator,
+                              uint32_t max_descriptor_sets,
                               uint32_t uniform_buffer_count,
                               uint32_t storage_buffer_count,
                               VkDescriptorPool *descriptor_pool);
@@ -175,16 +178,29 @@ int vk_create_descriptor_set(void *user_context,
                              VkDescriptorPool descriptor_pool,
                              VkDescriptorSet *descriptor_set);
 
+int vk_get_descriptor_buffer_info(void *user_context,
+                                  VulkanMemoryAllocator *allocator,
+                                  VkBuffer *scalar_args_buffer,
+                                  size_t arg_sizes[],
+                                  void *args[],
+                                  int8_t arg_is_buffer[],
+                                  BlockStorage &descriptor_buffer_info);
+
 int vk_update_descriptor_set(void *user_context,
                              VulkanMemoryAllocator *allocator,
-                             VkBuffer *scalar_args_buffer,
-                             size_t uniform_buffer_count,
-                             size_t storage_buffer_count,
-                             size_t arg_sizes[],
-                             void *args[],
-                             int8_t arg_is_buffer[],
+                             bool has_scalar_args_buffer,
+                             const VkDescriptorBufferInfo *buffer_info,
+                             uint32_t buffer_info_count,
                              VkDescriptorSet descriptor_set);
 
+int vk_acquire_descriptor_set(void *user_context,
+                              VulkanMemoryAllocator *allocator,
+                              VulkanShaderBinding *shader_binding,
+                              VkDescriptorSetLayout descriptor_set_layout,
+                              bool has_scalar_args_buffer,
+                              const BlockStorage &descriptor_buffer_info,
+                              VkDescriptorSet *descriptor_set);
+
 // -- Pipeline Layout
 int vk_create_pipeline_layout(void *user_context,
                               VulkanMemoryAllocator *allocator,
@@ -195,6 +211,11 @@ int vk_create_pipeline_layout(void *user_context,
 int vk_destroy_pipeline_layout(void *user_context,
                                VulkanMemoryAllocator *allocator,
                                VkPipelineLayout pipeline_layout);
+// -- Pipeline Cache
+VkPipelineCache vk_acquire_pipeline_cache(void *user_context, VulkanMemoryAllocator *allocator);
+int vk_save_pipeline_cache(void *user_context, VulkanMemoryAllocator *allocator);
+int vk_destroy_pipeline_cache(void *user_context, VulkanMemoryAllocator *allocator);
+
 // -- Compute Pipeline
 int vk_create_compute_pipeline(void *user_context,
                                VulkanMemoryAllocator *allocator,
@@ -19,6 +19,18 @@ namespace Vulkan {
 WEAK ScopedSpinLock::AtomicFlag custom_allocation_callbacks_lock = 0;
 WEAK const VkAllocationCallbacks *custom_allocation_callbacks = nullptr;  // nullptr => use Vulkan runtime implementation
 
+// Bumped whenever a device buffer goes away, since its handle may be reused by a new buffer
+// and any descriptor sets written with it can no longer be trusted
+WEAK uint64_t device_buffer_generation = 0;
+
+// Zero-copy buffers (see halide_vulkan_device_and_host_malloc) are the only allocations made with
+// these properties, so a region carrying them is always a dedicated, persistently mapped device buffer
+WEAK bool vk_is_zero_copy_memory(const MemoryProperties &properties) {
+    return (properties.visibility == MemoryVisibility::DeviceToHost) &&
+           (properties.caching == MemoryCaching::CachedCoherent) &&
+           (properties.usage == MemoryUsage::TransferSrcDst);
+}
+
 // --------------------------------------------------------------------------
 
 // Runtime configuration parameters to adjust the behaviour of the block allocator
@@ -28,6 +40,8 @@ struct VulkanMemoryConfig {
     size_t maximum_block_size = 0;         //< Specified in bytes. Zero means no constraint
     size_t maximum_block_count = 0;        //< Maximum number of blocks to allocate. Zero means no constraint
     size_t nearest_multiple = 32;          //< Always round up the requested region sizes to the given integer value. Zero means no constraint
+    size_t device_block_size = 0;          //< Minimum block size for device local memory. Zero means use minimum_block_size
+    size_t staging_block_size = 0;         //< Minimum block size for host visible (staging) memory. Zero means use minimum_block_size
 };
 WEAK VulkanMemoryConfig memory_allocator_config;
 
@@ -64,6 +78,7 @@ public:
     int reclaim(void *user_context, MemoryRegion *region);    //< free the region and consolidate
     int retain(void *user_context, MemoryRegion *region);     //< retain the region and increase its use count
     bool collect(void *user_context);                         //< returns true if any blocks were removed
+    bool defragment(void *user_context);                      //< returns true if any blocks were removed
     int release(void *user_context);
     int destroy(void *user_context);
 
@@ -102,6 +117,8 @@ public:
     size_t bytes_allocated_for_regions() const;
     size_t regions_allocated() const;
 
+    MemoryStats current_stats(void *user_context) const;
+
 private:
     static constexpr uint32_t invalid_memory_heap = uint32_t(-1);
     static constexpr uint32_t invalid_usage_flags = uint32_t(-1);
@@ -115,6 +132,8 @@ private:
 
     uint32_t select_memory_usage(void *user_context, MemoryProperties properties) const;
 
+    size_t minimum_block_size_for_memory_properties(void *user_context, MemoryProperties properties) const;
+
     uint32_t preferred_flags_for_memory_properties(void *user_context, MemoryProperties properties) const;
     uint32_t required_flags_for_memory_properties(void *user_context, MemoryProperties properties) const;
 
@@ -208,7 +227,7 @@ int VulkanMemoryAllocator::initialize(void *user_context,
     block_allocator_config.maximum_pool_size = cfg.maximum_pool_size;
     block_allocator_config.maximum_block_count = cfg.maximum_block_count;
     block_allocator_config.maximum_block_size = cfg.maximum_block_size;
-    block_allocator_config.minimum_block_size = cfg.minimum_block_size;
+    block_allocator_config.minimum_block_size = 0;  // applied per memory type in conform_block_request()
     block_allocator_config.nearest_multiple = cfg.nearest_multiple;
     block_allocator = BlockAllocator::create(user_context, block_allocator_config, allocators);
     if (block_allocator == nullptr) {
@@ -512,6 +531,17 @@ bool VulkanMemoryAllocator::collect(void *user_context) {
     return block_allocator->collect(this);
 }
 
+bool VulkanMemoryAllocator::defragment(void *user_context) {
+#if defined(HL_VK_DEBUG_MEM)
+    debug(nullptr) << "VulkanMemoryAllocator: Defragmenting unused memory ("
+                   << "user_context=" << user_context << ") ... \n";
+#endif
+    if ((device == nullptr) || (physical_device == nullptr) || (block_allocator == nullptr)) {
+        return false;
+    }
+    return block_allocator->defragment(this);
+}
+
 int VulkanMemoryAllocator::release(void *user_context) {
 #if defined(HL_VK_DEBUG_MEM)
     debug(nullptr) << "VulkanMemoryAllocator: Releasing block allocator ("
@@ -604,6 +634,13 @@ int VulkanMemoryAllocator::conform_block_request(void *instance_ptr, MemoryReque
         return halide_error_code_internal_error;
     }
 
+    // Grow the block to the minimum size configured for this type of memory
+    size_t minimum_size = request->dedicated ? instance->config.minimum_block_size : instance->minimum_block_size_for_memory_properties(user_context, request->properties);
+    if (instance->config.maximum_block_size) {
+        minimum_size = min(minimum_size, instance->config.maximum_block_size);
+    }
+    request->size = max(request->size, minimum_size);
+
     VkMemoryRequirements memory_requirements = {0};
     uint32_t usage_flags = instance->select_memory_usage(user_context, request->properties);
     int error_code = instance->lookup_requirements(user_context, request->size, usage_flags, &memory_requirements);
@@ -849,6 +886,32 @@ size_t VulkanMemoryAllocator::bytes_allocated_for_blocks() const {
     return block_byte_count;
 }
 
+MemoryStats VulkanMemoryAllocator::current_stats(void *user_context) const {
+    if (block_allocator == nullptr) {
+        return MemoryStats();
+    }
+    return block_allocator->current_stats(user_context);
+}
+
+size_t VulkanMemoryAllocator::minimum_block_size_for_memory_properties(void *user_context, MemoryProperties properties) const {
+    size_t block_size = 0;
+    switch (properties.visibility) {
+    case MemoryVisibility::HostOnly:
+    case MemoryVisibility::HostToDevice:
+    case MemoryVisibility::DeviceToHost:
+        block_size = config.staging_block_size;
+        break;
+    case MemoryVisibility::DeviceOnly:
+    case MemoryVisibility::DefaultVisibility:
+        block_size = config.device_block_size;
+        break;
+    case MemoryVisibility::InvalidVisibility:
+    default:
+        break;
+    };
+    return block_size ? block_size : config.minimum_block_size;
+}
+
 uint32_t VulkanMemoryAllocator::required_flags_for_memory_properties(
     void *user_context, MemoryProperties properties) const {
 
@@ -1252,6 +1315,9 @@ int VulkanMemoryAllocator::deallocate_region(void *instance_ptr, MemoryRegion *r
 #ifdef DEBUG_RUNTIME
     debug(nullptr) << "vkDestroyBuffer: Destroyed buffer for device region (" << (uint64_t)region->size << " bytes) ...\n";
 #endif
+    if ((region->properties.visibility == MemoryVisibility::DeviceOnly) || vk_is_zero_copy_memory(region->properties)) {
+        Synchronization::atomic_fetch_add_acquire_release(&device_buffer_generation, uint64_t(1));
+    }
     halide_error_code_t error_code = halide_error_code_success;
     region->handle = nullptr;
     if (instance->region_count > 0) {
@@ -1362,9 +1428,10 @@ VulkanMemoryAllocator *vk_create_memory_allocator(void *user_context,
     // Parse the allocation config string (if specified).
     //
     // `HL_VK_ALLOC_CONFIG=N:N:N` will tell Halide to configure the Vulkan memory
-    // allocator use the given constraints specified as three integer values
-    // separated by a `:` or `;`. These values correspond to `minimum_block_size`,
-    // `maximum_block_size` and `maximum_block_count`.
+    // allocator use the given constraints specified as integer values
+    // separated by a `:` or `;`. These values correspond to `maximum_pool_size`,
+    // `minimum_block_size`, `maximum_block_size`, `maximum_block_count`,
+    // `nearest_multiple`, `device_block_size` and `staging_block_size`.
     //
     const char *alloc_config = vk_get_alloc_config_internal(user_context);
     if (!StringUtils::is_empty(alloc_config)) {
@@ -1390,6 +1457,14 @@ VulkanMemoryAllocator *vk_create_memory_allocator(void *user_context,
             config.nearest_multiple = atoi(alloc_config_values[4]);
             print(user_context) << "Vulkan: Configuring allocator with " << (uint32_t)config.nearest_multiple << " for nearest multiple\n";
         }
+        if (alloc_config_values.size() > 5) {
+            config.device_block_size = atoi(alloc_config_values[5]) * 1024 * 1024;
+            print(user_context) << "Vulkan: Configuring allocator with " << (uint32_t)config.device_block_size << " for device block size (in bytes)\n";
+        }
+        if (alloc_config_values.size() > 6) {
+            config.staging_block_size = atoi(alloc_config_values[6]) * 1024 * 1024;
+            print(user_context) << "Vulkan: Configuring allocator with " << (uint32_t)config.staging_block_size << " for staging block size (in bytes)\n";
+        }
     }
 
     return VulkanMemoryAllocator::create(user_context,
@@ -1478,6 +1553,28 @@ int vk_clear_device_buffer(void *user_context,
     return halide_error_code_success;
 }
 
+bool vk_supports_zero_copy_memory(void *user_context, VulkanMemoryAllocator *allocator) {
+    if ((allocator == nullptr) || (allocator->current_physical_device() == nullptr)) {
+        return false;
+    }
+
+    // Only worthwhile when device local memory can also be mapped (and read back efficiently) by the
+    // host, which is typically the case for integrated GPUs with unified memory
+    const uint32_t zero_copy_flags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT |
+                                     VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                                     VK_MEMORY_PROPERTY_HOST_COHERENT_BIT |
+                                     VK_MEMORY_PROPERTY_HOST_CACHED_BIT;
+
+    VkPhysicalDeviceMemoryProperties memory_properties;
+    vkGetPhysicalDeviceMemoryProperties(allocator->current_physical_device(), &memory_properties);
+    for (uint32_t i = 0; i < memory_properties.memoryTypeCount; ++i) {
+        if ((memory_properties.memoryTypes[i].propertyFlags & zero_copy_flags) == zero_copy_flags) {
+            return true;
+        }
+    }
+    return false;
+}
+
 // --------------------------------------------------------------------------
 
 }  // namespace
@@ -39,13 +39,34 @@ struct VulkanSharedMemoryAllocation {
     const char *variable_name = nullptr;
 };
 
+// Number of descriptor sets pooled for each entry point
+static constexpr uint32_t vk_descriptor_set_pool_size = 4;
+
+// Pooled descriptor set, along with the buffer bindings it was last written with
+struct VulkanDescriptorSetEntry {
+    VkDescriptorSet descriptor_set = VK_NULL_HANDLE;
+    VkDescriptorBufferInfo *buffer_info = nullptr;  // one entry per binding
+    uint32_t buffer_info_count = 0;
+    uint64_t buffer_generation = 0;  // value of device_buffer_generation when written
+    uint64_t last_used = 0;
+};
+
+// Specialization constants that were used to create a compute pipeline
+struct VulkanPipelineSpecialization {
+    uint32_t constant_count = 0;
+    uint32_t constant_ids[4] = {0, 0, 0, 0};
+    uint32_t constant_values[4] = {0, 0, 0, 0};
+};
+
 // Entry point metadata for shader modules
 struct VulkanShaderBinding {
     const char *entry_point_name = nullptr;
     VulkanDispatchData dispatch_data = {};
     VkDescriptorPool descriptor_pool = VK_NULL_HANDLE;
-    VkDescriptorSet descriptor_set = VK_NULL_HANDLE;
+    VulkanDescriptorSetEntry descriptor_sets[vk_descriptor_set_pool_size];
+    uint64_t descriptor_set_usage = 0;
     VkPipeline compute_pipeline = VK_NULL_HANDLE;
+    VulkanPipelineSpecialization pipeline_specialization = {};
     uint32_t uniform_buffer_count = 0;
     uint32_t storage_buffer_count = 0;
     uint32_t specialization_constants_count = 0;
@@ -74,6 +95,13 @@ struct VulkanCompilationCacheEntry {
 
 WEAK Halide::Internal::GPUCompilationCache<VkDevice, VulkanCompilationCacheEntry *> compilation_cache;
 
+// Pipeline cache shared by every compute pipeline created on the device (loaded from and
+// saved to halide_vulkan_get_pipeline_cache_path(), if one is set)
+WEAK VkPipelineCache pipeline_cache = VK_NULL_HANDLE;
+WEAK VkDevice pipeline_cache_device = VK_NULL_HANDLE;
+WEAK bool pipeline_cache_modified = false;
+WEAK size_t pipeline_cache_saved_size = 0;
+
 // --------------------------------------------------------------------------
 
 namespace {  // internalize
@@ -316,6 +344,7 @@ uint32_t vk_count_bindings_for_descriptor_set(void *user_context,
 
 int vk_create_descriptor_pool(void *user_context,
                               VulkanMemoryAllocator *allocator,
+                              uint32_t max_descriptor_sets,
                               uint32_t uniform_buffer_count,
                               uint32_t storage_buffer_count,
                               VkDescriptorPool *descriptor_pool) {
@@ -323,6 +352,7 @@ int vk_create_descriptor_pool(void *user_context,
     debug(user_context)
         << " vk_create_descriptor_pool (user_context: " << user_context << ", "
         << "allocator: " << (void *)allocator << ", "
+        << "max_descriptor_sets: " << (uint32_t)max_descriptor_sets << ", "
         << "uniform_buffer_count: " << (uint32_t)uniform_buffer_count << ", "
         << "storage_buffer_count: " << (uint32_t)storage_buffer_count << ")\n";
 #endif
@@ -339,16 +369,16 @@ int vk_create_descriptor_pool(void *user_context,
     // First binding is reserved for passing scalar parameters as a uniform buffer
     if (uniform_buffer_count > 0) {
         VkDescriptorPoolSize uniform_buffer_size = {
-            VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,  // descriptor type
-            uniform_buffer_count                // all kernel args are packed into uniform buffers
+            VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,          // descriptor type
+            uniform_buffer_count * max_descriptor_sets  // all kernel args are packed into uniform buffers
         };
         pool_sizes.append(user_context, &uniform_buffer_size);
     }
 
     if (storage_buffer_count > 0) {
         VkDescriptorPoolSize storage_buffer_size = {
-            VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,  // descriptor type
-            storage_buffer_count                // all halide buffers are passed as storage buffers
+            VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,          // descriptor type
+            storage_buffer_count * max_descriptor_sets  // all halide buffers are passed as storage buffers
         };
         pool_sizes.append(user_context, &storage_buffer_size);
     }
@@ -357,7 +387,7 @@ int vk_create_descriptor_pool(void *user_context,
         VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,   // struct type
         nullptr,                                         // point to struct extending this
         0,                                               // flags
-        1,                                               // this pool will only be used for creating one descriptor set!
+        max_descriptor_sets,                             // maximum number of descriptor sets allocated from this pool
         (uint32_t)pool_sizes.size(),                     // pool size count
         (const VkDescriptorPoolSize *)pool_sizes.data()  // ptr to descriptr pool sizes
     };
@@ -524,41 +554,25 @@ int vk_create_descriptor_set(void *user_context,
     return halide_error_code_success;
 }
 
-int vk_update_descriptor_set(void *user_context,
-                             VulkanMemoryAllocator *allocator,
-                             VkBuffer *scalar_args_buffer,
-                             size_t uniform_buffer_count,
-                             size_t storage_buffer_count,
-                             size_t arg_sizes[],
-                             void *args[],
-                             int8_t arg_is_buffer[],
-                             VkDescriptorSet descriptor_set) {
+int vk_get_descriptor_buffer_info(void *user_context,
+                                  VulkanMemoryAllocator *allocator,
+                                  VkBuffer *scalar_args_buffer,
+                                  size_t arg_sizes[],
+                                  void *args[],
+                                  int8_t arg_is_buffer[],
+                                  BlockStorage &descriptor_buffer_info) {
 #ifdef DEBUG_RUNTIME
     debug(user_context)
-        << " vk_update_descriptor_set (user_context: " << user_context << ", "
+        << " vk_get_descriptor_buffer_info (user_context: " << user_context << ", "
         << "allocator: " << (void *)allocator << ", "
-        << "scalar_args_buffer: " << (void *)scalar_args_buffer << ", "
-        << "uniform_buffer_count: " << (uint32_t)uniform_buffer_count << ", "
-        << "storage_buffer_count: " << (uint32_t)storage_buffer_count << ", "
-        << "descriptor_set: " << (void *)descriptor_set << ")\n";
+        << "scalar_args_buffer: " << (void *)scalar_args_buffer << ")\n";
 #endif
     if (allocator == nullptr) {
-        error(user_context) << "Vulkan: Failed to create descriptor set ... invalid allocator pointer!\n";
+        error(user_context) << "Vulkan: Failed to gather descriptor buffer info ... invalid allocator pointer!\n";
         return halide_error_code_generic_error;
     }
 
-    BlockStorage::Config dbi_config;
-    dbi_config.minimum_capacity = storage_buffer_count + uniform_buffer_count;
-    dbi_config.entry_size = sizeof(VkDescriptorBufferInfo);
-    BlockStorage descriptor_buffer_info(user_context, dbi_config);
-
-    BlockStorage::Config wds_config;
-    wds_config.minimum_capacity = storage_buffer_count + uniform_buffer_count;
-    wds_config.entry_size = sizeof(VkWriteDescriptorSet);
-    BlockStorage write_descriptor_set(user_context, wds_config);
-
     // First binding will be the scalar args buffer (if needed) passed as a UNIFORM BUFFER
-    VkDescriptorBufferInfo *scalar_args_entry = nullptr;
     if (scalar_args_buffer != nullptr) {
         VkDescriptorBufferInfo scalar_args_descriptor_buffer_info = {
             *scalar_args_buffer,  // the buffer
@@ -566,27 +580,13 @@ int vk_update_descriptor_set(void *user_context,
             VK_WHOLE_SIZE         // range
         };
         descriptor_buffer_info.append(user_context, &scalar_args_descriptor_buffer_info);
-        scalar_args_entry = (VkDescriptorBufferInfo *)descriptor_buffer_info.back();
 
 #ifdef DEBUG_RUNTIME
-        debug(user_context) << "  [" << (uint32_t)write_descriptor_set.size() << "] UNIFORM_BUFFER : "
+        debug(user_context) << "  [" << (uint32_t)(descriptor_buffer_info.size() - 1) << "] UNIFORM_BUFFER : "
                             << "buffer=" << (void *)scalar_args_buffer << " "
                             << "offset=" << (uint32_t)(0) << " "
                             << "size=VK_WHOLE_SIZE\n";
 #endif
-        VkWriteDescriptorSet uniform_buffer_write_descriptor_set = {
-            VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,  // struct type
-            nullptr,                                 // pointer to struct extending this
-            descriptor_set,                          // descriptor set to update
-            0,                                       // binding slot
-            0,                                       // array elem
-            1,                                       // num to update
-            VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,       // descriptor type
-            nullptr,                                 // for images
-            scalar_args_entry,                       // info for buffer
-            nullptr                                  // for texel buffers
-        };
-        write_descriptor_set.append(user_context, &uniform_buffer_write_descriptor_set);
     }
 
     // Add all the other device buffers as STORAGE BUFFERs
@@ -613,37 +613,146 @@ int vk_update_descriptor_set(void *user_context,
                 range_size       // range size
             };
             descriptor_buffer_info.append(user_context, &device_buffer_info);
-            VkDescriptorBufferInfo *device_buffer_entry = (VkDescriptorBufferInfo *)descriptor_buffer_info.back();
 
 #ifdef DEBUG_RUNTIME
-            debug(user_context) << "  [" << (uint32_t)write_descriptor_set.size() << "] STORAGE_BUFFER : "
+            debug(user_context) << "  [" << (uint32_t)(descriptor_buffer_info.size() - 1) << "] STORAGE_BUFFER : "
                                 << "region=" << (void *)device_region << " "
                                 << "buffer=" << (void *)device_buffer << " "
                                 << "offset=" << (uint32_t)(range_offset) << " "
                                 << "size=" << (uint32_t)(range_size) << "\n";
 #endif
-
-            VkWriteDescriptorSet storage_buffer_write_descriptor_set = {
-                VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,  // struct type
-                nullptr,                                 // pointer to struct extending this
-                descriptor_set,                          // descriptor set to update
-                (uint32_t)write_descriptor_set.size(),   // binding slot
-                0,                                       // array elem
-                1,                                       // num to update
-                VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,       // descriptor type
-                nullptr,                                 // for images
-                device_buffer_entry,                     // info for buffer
-                nullptr                                  // for texel buffers
-            };
-            write_descriptor_set.append(user_context, &storage_buffer_write_descriptor_set);
         }
     }
+    return halide_error_code_success;
+}
+
+int vk_update_descriptor_set(void *user_context,
+                             VulkanMemoryAllocator *allocator,
+                             bool has_scalar_args_buffer,
+                             const VkDescriptorBufferInfo *buffer_info,
+                             uint32_t buffer_info_count,
+                             VkDescriptorSet descriptor_set) {
+#ifdef DEBUG_RUNTIME
+    debug(user_context)
+        << " vk_update_descriptor_set (user_context: " << user_context << ", "
+        << "allocator: " << (void *)allocator << ", "
+        << "has_scalar_args_buffer: " << (has_scalar_args_buffer ? "true" : "false") << ", "
+        << "buffer_info_count: " << (uint32_t)buffer_info_count << ", "
+        << "descriptor_set: " << (void *)descriptor_set << ")\n";
+#endif
+    if (allocator == nullptr) {
+        error(user_context) << "Vulkan: Failed to create descriptor set ... invalid allocator pointer!\n";
+        return halide_error_code_generic_error;
+    }
+
+    BlockStorage::Config wds_config;
+    wds_config.minimum_capacity = buffer_info_count;
+    wds_config.entry_size = sizeof(VkWriteDescriptorSet);
+    BlockStorage write_descriptor_set(user_context, wds_config);
+
+    // First binding will be the scalar args buffer (if needed) passed as a UNIFORM BUFFER,
+    // followed by all the other device buffers as STORAGE BUFFERs
+    for (uint32_t n = 0; n < buffer_info_count; n++) {
+        bool is_uniform_buffer = has_scalar_args_buffer && (n == 0);
+        VkWriteDescriptorSet buffer_write_descriptor_set = {
+            VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,  // struct type
+            nullptr,                                 // pointer to struct extending this
+            descriptor_set,                          // descriptor set to update
+            n,                                       // binding slot
+            0,                                       // array elem
+            1,                                       // num to update
+            is_uniform_buffer ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+            nullptr,           // for images
+            buffer_info + n,   // info for buffer
+            nullptr            // for texel buffers
+        };
+        write_descriptor_set.append(user_context, &buffer_write_descriptor_set);
+    }
 
     // issue the update call to populate the descriptor set
     vkUpdateDescriptorSets(allocator->current_device(), (uint32_t)write_descriptor_set.size(), (const VkWriteDescriptorSet *)write_descriptor_set.data(), 0, nullptr);
     return halide_error_code_success;
 }
 
+int vk_acquire_descriptor_set(void *user_context,
+                              VulkanMemoryAllocator *allocator,
+                              VulkanShaderBinding *shader_binding,
+                              VkDescriptorSetLayout descriptor_set_layout,
+                              bool has_scalar_args_buffer,
+                              const BlockStorage &descriptor_buffer_info,
+                              VkDescriptorSet *descriptor_set) {
+#ifdef DEBUG_RUNTIME
+    debug(user_context)
+        << " vk_acquire_descriptor_set (user_context: " << user_context << ", "
+        << "allocator: " << (void *)allocator << ", "
+        << "shader_binding: " << (void *)shader_binding << ", "
+        << "descriptor_set_layout: " << (void *)descriptor_set_layout << ")\n";
+#endif
+    if (allocator == nullptr) {
+        error(user_context) << "Vulkan: Failed to acquire descriptor set ... invalid allocator pointer!\n";
+        return halide_error_code_generic_error;
+    }
+
+    const VkDescriptorBufferInfo *buffer_info = (const VkDescriptorBufferInfo *)descriptor_buffer_info.data();
+    uint32_t buffer_info_count = (uint32_t)descriptor_buffer_info.size();
+    size_t buffer_info_bytes = buffer_info_count * sizeof(VkDescriptorBufferInfo);
+    uint32_t bindings_capacity = shader_binding->uniform_buffer_count + shader_binding->storage_buffer_count;
+    if (buffer_info_count > bindings_capacity) {
+        error(user_context) << "Vulkan: Failed to acquire descriptor set ... too many buffer bindings for entry point!\n";
+        return halide_error_code_internal_error;
+    }
+
+    // Reuse a set that was already written with exactly these bindings, otherwise
+    // rewrite the least recently used one (allocating it from the pool if needed)
+    uint64_t generation = Synchronization::atomic_fetch_add_acquire_release(&device_buffer_generation, uint64_t(0));
+    VulkanDescriptorSetEntry *selected = nullptr;
+    for (uint32_t n = 0; n < vk_descriptor_set_pool_size; n++) {
+        VulkanDescriptorSetEntry *entry = &(shader_binding->descriptor_sets[n]);
+        if ((entry->descriptor_set != VK_NULL_HANDLE) &&
+            (entry->buffer_generation == generation) &&
+            (entry->buffer_info_count == buffer_info_count) &&
+            (memcmp(entry->buffer_info, buffer_info, buffer_info_bytes) == 0)) {
+            entry->last_used = ++shader_binding->descriptor_set_usage;
+            *descriptor_set = entry->descriptor_set;
+            return halide_error_code_success;
+        }
+        if ((selected == nullptr) ||
+            ((selected->descriptor_set != VK_NULL_HANDLE) && (entry->last_used < selected->last_used))) {
+            selected = entry;
+        }
+    }
+
+    if (selected->buffer_info == nullptr) {
+        VkSystemAllocationScope alloc_scope = VkSystemAllocationScope::VK_SYSTEM_ALLOCATION_SCOPE_OBJECT;
+        selected->buffer_info = (VkDescriptorBufferInfo *)vk_host_malloc(user_context, bindings_capacity * sizeof(VkDescriptorBufferInfo), 0, alloc_scope, allocator->callbacks());
+        if (selected->buffer_info == nullptr) {
+            error(user_context) << "Vulkan: Failed to acquire descriptor set ... out of memory!\n";
+            return halide_error_code_out_of_memory;
+        }
+    }
+
+    if (selected->descriptor_set == VK_NULL_HANDLE) {
+        int error_code = vk_create_descriptor_set(user_context, allocator, descriptor_set_layout, shader_binding->descriptor_pool, &(selected->descriptor_set));
+        if (error_code != halide_error_code_success) {
+            error(user_context) << "Vulkan: Failed to acquire descriptor set ... unable to create descriptor set!\n";
+            return error_code;
+        }
+    }
+
+    int error_code = vk_update_descriptor_set(user_context, allocator, has_scalar_args_buffer, buffer_info, buffer_info_count, selected->descriptor_set);
+    if (error_code != halide_error_code_success) {
+        error(user_context) << "Vulkan: Failed to acquire descriptor set ... unable to update descriptor set!\n";
+        return error_code;
+    }
+
+    memcpy(selected->buffer_info, buffer_info, buffer_info_bytes);
+    selected->buffer_info_count = buffer_info_count;
+    selected->buffer_generation = generation;
+    selected->last_used = ++shader_binding->descriptor_set_usage;
+    *descriptor_set = selected->descriptor_set;
+    return halide_error_code_success;
+}
+
 // --
 
 size_t vk_estimate_scalar_uniform_buffer_size(void *user_context,
@@ -876,11 +985,12 @@ int vk_create_compute_pipeline(void *user_context,
             0                 // base pipeline index for derived pipeline
         };
 
-    VkResult result = vkCreateComputePipelines(allocator->current_device(), VK_NULL_HANDLE, 1, &compute_pipeline_info, allocator->callbacks(), compute_pipeline);
+    VkResult result = vkCreateComputePipelines(allocator->current_device(), vk_acquire_pipeline_cache(user_context, allocator), 1, &compute_pipeline_info, allocator->callbacks(), compute_pipeline);
     if (result != VK_SUCCESS) {
         error(user_context) << "Vulkan: Failed to create compute pipeline! vkCreateComputePipelines returned " << vk_get_error_name(result) << "\n";
         return halide_error_code_generic_error;
     }
+    pipeline_cache_modified = true;
 
     return halide_error_code_success;
 }
@@ -1046,6 +1156,21 @@ int vk_setup_compute_pipeline(void *user_context,
         specialization_info.pMapEntries = specialization_map_entries;
         specialization_info.pData = dispatch_constant_values;
 
+        // Re-use the pipeline if it was already specialized with the same constants
+        VulkanPipelineSpecialization pipeline_specialization{};
+        pipeline_specialization.constant_count = dispatch_constant_count;
+        for (uint32_t dc = 0; dc < dispatch_constant_count; dc++) {
+            pipeline_specialization.constant_ids[dc] = dispatch_constant_ids[dc];
+            pipeline_specialization.constant_values[dc] = dispatch_constant_values[dc];
+        }
+        if (shader_bindings->compute_pipeline &&
+            (memcmp(&pipeline_specialization, &(shader_bindings->pipeline_specialization), sizeof(VulkanPipelineSpecialization)) == 0)) {
+#ifdef DEBUG_RUNTIME
+            debug(user_context) << "  re-using specialized compute pipeline " << (void *)shader_bindings->compute_pipeline << "\n";
+#endif
+            return halide_error_code_success;
+        }
+
         // Recreate the pipeline with the requested shared memory allocation
         if (shader_bindings->compute_pipeline) {
             int error_code = vk_destroy_compute_pipeline(user_context, allocator, shader_bindings->compute_pipeline);
@@ -1061,10 +1186,20 @@ int vk_setup_compute_pipeline(void *user_context,
             error(user_context) << "Vulkan: Failed to create compute pipeline!\n";
             return error_code;
         }
+        shader_bindings->pipeline_specialization = pipeline_specialization;
 
     } else {
 
-        // Construct and re-use the fixed pipeline
+        // Construct and re-use the fixed pipeline (dropping any previously specialized one)
+        if (shader_bindings->compute_pipeline && shader_bindings->pipeline_specialization.constant_count) {
+            int error_code = vk_destroy_compute_pipeline(user_context, allocator, shader_bindings->compute_pipeline);
+            if (error_code != halide_error_code_success) {
+                error(user_context) << "Vulkan: Failed to destroy compute pipeline!\n";
+                return halide_error_code_generic_error;
+            }
+            shader_bindings->compute_pipeline = VK_NULL_HANDLE;
+            memset(&(shader_bindings->pipeline_specialization), 0, sizeof(VulkanPipelineSpecialization));
+        }
         if (shader_bindings->compute_pipeline == VK_NULL_HANDLE) {
             int error_code = vk_create_compute_pipeline(user_context, allocator, entry_point_name, shader_module, pipeline_layout, nullptr, &(shader_bindings->compute_pipeline));
             if (error_code != halide_error_code_success) {
@@ -1630,6 +1765,15 @@ void vk_destroy_compiled_shader_module(VulkanCompiledShaderModule *shader_module
                 vk_destroy_scalar_uniform_buffer(user_context, allocator, shader_module->shader_bindings[n].args_region);
                 shader_module->shader_bindings[n].args_region = nullptr;
             }
+            // descriptor sets are released along with their pool
+            for (uint32_t ds = 0; ds < vk_descriptor_set_pool_size; ds++) {
+                VulkanDescriptorSetEntry *entry = &(shader_module->shader_bindings[n].descriptor_sets[ds]);
+                if (entry->buffer_info) {
+                    vk_host_free(user_context, entry->buffer_info, allocator->callbacks());
+                    entry->buffer_info = nullptr;
+                }
+                entry->descriptor_set = VK_NULL_HANDLE;
+            }
             if (shader_module->shader_bindings[n].descriptor_pool) {
                 vk_destroy_descriptor_pool(user_context, allocator, shader_module->shader_bindings[n].descriptor_pool);
                 shader_module->shader_bindings[n].descriptor_pool = VK_NULL_HANDLE;
@@ -1706,6 +1850,155 @@ int vk_destroy_shader_modules(void *user_context, VulkanMemoryAllocator *allocat
 
 // --------------------------------------------------------------------------
 
+VkPipelineCache vk_acquire_pipeline_cache(void *user_context, VulkanMemoryAllocator *allocator) {
+    if (allocator == nullptr) {
+        return VK_NULL_HANDLE;
+    }
+
+    VkDevice device = allocator->current_device();
+    if ((pipeline_cache != VK_NULL_HANDLE) && (pipeline_cache_device == device)) {
+        return pipeline_cache;
+    }
+
+#ifdef DEBUG_RUNTIME
+    debug(user_context)
+        << " vk_acquire_pipeline_cache (user_context: " << user_context << ", "
+        << "allocator: " << (void *)allocator << ", "
+        << "device: " << (void *)device << ")\n";
+#endif
+
+    // Load any previously saved data (ignoring anything written by a different device or driver)
+    BlockStorage::Config data_config;
+    data_config.entry_size = sizeof(uint8_t);
+    data_config.minimum_capacity = 64 * 1024;
+    BlockStorage cache_data(user_context, data_config);
+
+    const char *path = vk_get_pipeline_cache_path_internal(user_context);
+    void *file = ((path != nullptr) && (*path != '\0')) ? halide_fopen(path, "rb") : nullptr;
+    if (file != nullptr) {
+        uint8_t chunk[4096];
+        size_t bytes_read = 0;
+        while ((bytes_read = fread(chunk, 1, sizeof(chunk), file)) > 0) {
+            cache_data.append(user_context, chunk, bytes_read);
+        }
+        fclose(file);
+
+        const size_t header_size = 16 + VK_UUID_SIZE;
+        bool valid = false;
+        if (cache_data.size() >= header_size) {
+            const uint8_t *header = (const uint8_t *)cache_data.data();
+            uint32_t header_fields[4];
+            memcpy(header_fields, header, sizeof(header_fields));
+
+            VkPhysicalDeviceProperties device_properties = {};
+            vkGetPhysicalDeviceProperties(allocator->current_physical_device(), &device_properties);
+            valid = (header_fields[0] >= header_size) &&
+                    (header_fields[1] == VK_PIPELINE_CACHE_HEADER_VERSION_ONE) &&
+                    (header_fields[2] == device_properties.vendorID) &&
+                    (header_fields[3] == device_properties.deviceID) &&
+                    (memcmp(header + 16, device_properties.pipelineCacheUUID, VK_UUID_SIZE) == 0);
+        }
+        if (!valid) {
+            debug(user_context) << "Vulkan: Ignoring incompatible pipeline cache '" << path << "'\n";
+            cache_data.clear(user_context);
+        }
+    }
+
+    VkPipelineCacheCreateInfo pipeline_cache_info = {
+        VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO,  // struct type
+        nullptr,                                       // pointer to struct extending this
+        0,                                             // flags
+        cache_data.size(),                             // initial data size
+        cache_data.size() ? cache_data.data() : nullptr  // initial data
+    };
+
+    VkPipelineCache created_cache = VK_NULL_HANDLE;
+    VkResult result = vkCreatePipelineCache(device, &pipeline_cache_info, allocator->callbacks(), &created_cache);
+    if (result != VK_SUCCESS) {
+        // pipelines can still be created without a cache
+        debug(user_context) << "Vulkan: vkCreatePipelineCache returned " << vk_get_error_name(result) << "\n";
+        return VK_NULL_HANDLE;
+    }
+
+    pipeline_cache = created_cache;
+    pipeline_cache_device = device;
+    pipeline_cache_modified = false;
+    pipeline_cache_saved_size = cache_data.size();
+    return pipeline_cache;
+}
+
+int vk_save_pipeline_cache(void *user_context, VulkanMemoryAllocator *allocator) {
+    if ((allocator == nullptr) || (pipeline_cache == VK_NULL_HANDLE) || !pipeline_cache_modified) {
+        return halide_error_code_success;
+    }
+
+    const char *path = vk_get_pipeline_cache_path_internal(user_context);
+    if ((path == nullptr) || (*path == '\0')) {
+        return halide_error_code_success;
+    }
+
+#ifdef DEBUG_RUNTIME
+    debug(user_context)
+        << " vk_save_pipeline_cache (user_context: " << user_context << ", "
+        << "allocator: " << (void *)allocator << ", "
+        << "path: '" << path << "')\n";
+#endif
+
+    // Only rewrite the file if the driver has added to what was loaded or last saved
+    size_t data_size = 0;
+    VkResult result = vkGetPipelineCacheData(pipeline_cache_device, pipeline_cache, &data_size, nullptr);
+    if ((result != VK_SUCCESS) || (data_size <= pipeline_cache_saved_size)) {
+        pipeline_cache_modified = false;
+        return halide_error_code_success;
+    }
+
+    VkSystemAllocationScope alloc_scope = VkSystemAllocationScope::VK_SYSTEM_ALLOCATION_SCOPE_COMMAND;
+    void *data = vk_host_malloc(user_context, data_size, 0, alloc_scope, allocator->callbacks());
+    if (data == nullptr) {
+        error(user_context) << "Vulkan: Failed to save pipeline cache ... out of memory!\n";
+        return halide_error_code_out_of_memory;
+    }
+
+    int error_code = halide_error_code_success;
+    result = vkGetPipelineCacheData(pipeline_cache_device, pipeline_cache, &data_size, data);
+    if (result == VK_SUCCESS) {
+        void *file = halide_fopen(path, "wb");
+        if ((file != nullptr) && (fwrite(data, 1, data_size, file) == data_size)) {
+            pipeline_cache_saved_size = data_size;
+            pipeline_cache_modified = false;
+        } else {
+            error(user_context) << "Vulkan: Failed to write pipeline cache to '" << path << "'\n";
+            error_code = halide_error_code_generic_error;
+        }
+        if (file != nullptr) {
+            fclose(file);
+        }
+    } else {
+        error(user_context) << "Vulkan: vkGetPipelineCacheData returned " << vk_get_error_name(result) << "\n";
+        error_code = halide_error_code_generic_error;
+    }
+
+    vk_host_free(user_context, data, allocator->callbacks());
+    return error_code;
+}
+
+int vk_destroy_pipeline_cache(void *user_context, VulkanMemoryAllocator *allocator) {
+    if ((allocator == nullptr) || (pipeline_cache == VK_NULL_HANDLE) ||
+        (pipeline_cache_device != allocator->current_device())) {
+        return halide_error_code_success;
+    }
+
+    int error_code = vk_save_pipeline_cache(user_context, allocator);
+    vkDestroyPipelineCache(pipeline_cache_device, pipeline_cache, allocator->callbacks());
+    pipeline_cache = VK_NULL_HANDLE;
+    pipeline_cache_device = VK_NULL_HANDLE;
+    pipeline_cache_modified = false;
+    pipeline_cache_saved_size = 0;
+    return error_code;
+}
+
+// --------------------------------------------------------------------------
+
 int vk_do_multidimensional_copy(void *user_context, VkCommandBuffer command_buffer,
                                 const device_copy &c, uint64_t src_offset, uint64_t dst_offset,
                                 int d, bool from_host, bool to_host) {
@@ -31,6 +31,23 @@ volatile ScopedSpinLock::AtomicFlag WEAK context_lock = 0;
 // A staging buffer used for host<->device copies.
 WEAK WGPUBuffer global_staging_buffer = nullptr;
 
+// Device-to-host copies are pipelined through a ring of staging buffers, the
+// first of which is the context's staging buffer. The rest are created on
+// demand for the device they were created for.
+constexpr int kStagingRingSize = 4;
+WEAK WGPUBuffer staging_ring[kStagingRingSize] = {};
+WEAK WGPUDevice staging_ring_device = nullptr;
+
+// Dispatches and device-side copies are recorded into a single command encoder
+// and submitted together, either when a pipeline finishes with its kernels, or
+// when the host needs to observe the results. Submitting is expensive
+// (particularly in the browser), so this keeps it to about once per pipeline.
+// These are only accessed while holding the context lock.
+constexpr int kMaxPendingCommands = 64;
+WEAK WGPUCommandEncoder pending_encoder = nullptr;
+WEAK WGPUDevice pending_device = nullptr;
+WEAK int pending_commands = 0;
+
 // A flag to signify that the WebGPU device was lost.
 bool device_was_lost = false;
 
@@ -321,6 +338,49 @@ size_t round_up_to_multiple_of_4(size_t x) {
     return (x + 3) & ~0x3;
 }
 
+// Submit the commands recorded so far, if any. Errors are reported to the
+// caller's ErrorScope.
+void submit_pending_commands() {
+    if (pending_encoder == nullptr) {
+        return;
+    }
+    WGPUQueue queue = wgpuDeviceGetQueue(pending_device);
+    WGPUCommandBuffer commands =
+        wgpuCommandEncoderFinish(pending_encoder, nullptr);
+    wgpuQueueSubmit(queue, 1, &commands);
+    wgpuCommandBufferRelease(commands);
+    wgpuCommandEncoderRelease(pending_encoder);
+    wgpuQueueRelease(queue);
+
+    pending_encoder = nullptr;
+    pending_device = nullptr;
+    pending_commands = 0;
+}
+
+// Get the command encoder to record commands for the given device into.
+WGPUCommandEncoder get_pending_encoder(WGPUDevice device) {
+    if (pending_encoder != nullptr && pending_device != device) {
+        submit_pending_commands();
+    }
+    if (pending_encoder == nullptr) {
+        pending_encoder = wgpuDeviceCreateCommandEncoder(device, nullptr);
+        pending_device = device;
+    }
+    return pending_encoder;
+}
+
+void release_staging_ring() {
+    // The first entry is owned by the context.
+    for (int i = 1; i < kStagingRingSize; i++) {
+        if (staging_ring[i]) {
+            wgpuBufferRelease(staging_ring[i]);
+            staging_ring[i] = nullptr;
+        }
+    }
+    staging_ring[0] = nullptr;
+    staging_ring_device = nullptr;
+}
+
 }  // namespace
 
 WEAK int create_webgpu_context(void *user_context) {
@@ -461,6 +521,8 @@ WEAK int halide_webgpu_device_sync(void *user_context, halide_buffer_t *) {
 
     ErrorScope error_scope(user_context, context.device);
 
+    submit_pending_commands();
+
     // Wait for all work on the queue to finish.
     struct WorkDoneResult {
         volatile ScopedSpinLock::AtomicFlag complete = false;
@@ -516,6 +578,13 @@ WEAK int halide_webgpu_device_release(void *user_context) {
         shader_cache.delete_context(user_context, device,
                                     wgpuShaderModuleRelease);
 
+        if (pending_device == device) {
+            submit_pending_commands();
+        }
+        if (staging_ring_device == device) {
+            release_staging_ring();
+        }
+
         // Release the device/adapter/instance/staging_buffer, if we created them.
         if (device == global_device) {
             if (staging_buffer) {
@@ -551,67 +620,138 @@ WEAK int halide_webgpu_device_and_host_free(void *user_context,
 
 namespace {
 
+// Get the staging buffers to use for device-to-host copies, creating any that
+// don't exist yet. Returns the number of staging buffers in the ring.
+int get_staging_ring(WgpuContext *context, WGPUBuffer **ring) {
+    if (staging_ring_device != context->device ||
+        staging_ring[0] != context->staging_buffer) {
+        release_staging_ring();
+        staging_ring[0] = context->staging_buffer;
+        staging_ring_device = context->device;
+    }
+
+    int count = 1;
+    while (count < kStagingRingSize) {
+        if (staging_ring[count] == nullptr) {
+            WGPUBufferDescriptor desc{};
+            desc.nextInChain = nullptr;
+            desc.label = nullptr;
+            desc.usage = WGPUBufferUsage_CopyDst | WGPUBufferUsage_MapRead;
+            desc.size = wgpuBufferGetSize(context->staging_buffer);
+            desc.mappedAtCreation = false;
+            staging_ring[count] = wgpuDeviceCreateBuffer(context->device, &desc);
+            if (staging_ring[count] == nullptr) {
+                // Make do with the ones we have.
+                break;
+            }
+        }
+        count++;
+    }
+    *ring = staging_ring;
+    return count;
+}
+
 // Copy `size` bytes of data from buffer `src` to a host pointer `dst`.
 int do_copy_to_host(void *user_context, WgpuContext *context, uint8_t *dst,
                     WGPUBuffer src, int64_t src_offset, int64_t size) {
-    // Copy chunks via the staging buffer.
+    // This needs to observe the results of any commands recorded so far.
+    submit_pending_commands();
+
+    // Copy chunks via the staging buffers, filling all of them with a single
+    // submit and then mapping them together, so that we only wait for the
+    // device once per trip around the ring.
+    WGPUBuffer *ring;
+    int ring_size = get_staging_ring(context, &ring);
     int64_t staging_buffer_size = wgpuBufferGetSize(context->staging_buffer);
-    for (int64_t offset = 0; offset < size; offset += staging_buffer_size) {
-        int64_t num_bytes = staging_buffer_size;
-        if (offset + num_bytes > size) {
-            num_bytes = size - offset;
-        }
 
-        // Copy this chunk to the staging buffer.
+    struct BufferMapResult {
+        volatile ScopedSpinLock::AtomicFlag map_complete;
+        volatile WGPUBufferMapAsyncStatus map_status;
+    };
+    BufferMapResult results[kStagingRingSize];
+    int64_t chunk_bytes[kStagingRingSize];
+
+    for (int64_t offset = 0; offset < size;) {
+        // Copy the next chunks to the staging buffers.
         WGPUCommandEncoder encoder =
             wgpuDeviceCreateCommandEncoder(context->device, nullptr);
-        wgpuCommandEncoderCopyBufferToBuffer(encoder, src, src_offset + offset,
-                                             context->staging_buffer,
-                                             0, num_bytes);
+        int num_chunks = 0;
+        for (; num_chunks < ring_size && offset < size; num_chunks++) {
+            int64_t num_bytes = staging_buffer_size;
+            if (offset + num_bytes > size) {
+                num_bytes = size - offset;
+            }
+            wgpuCommandEncoderCopyBufferToBuffer(encoder, src,
+                                                 src_offset + offset,
+                                                 ring[num_chunks], 0,
+                                                 num_bytes);
+            chunk_bytes[num_chunks] = num_bytes;
+            offset += num_bytes;
+        }
         WGPUCommandBuffer command_buffer =
             wgpuCommandEncoderFinish(encoder, nullptr);
         wgpuQueueSubmit(context->queue, 1, &command_buffer);
+        wgpuCommandBufferRelease(command_buffer);
+        wgpuCommandEncoderRelease(encoder);
+
+        // Map the staging buffers for reading.
+        for (int i = 0; i < num_chunks; i++) {
+            __atomic_test_and_set(&results[i].map_complete, __ATOMIC_RELAXED);
+            wgpuBufferMapAsync(
+                ring[i], WGPUMapMode_Read, 0, chunk_bytes[i],
+                [](WGPUBufferMapAsyncStatus status, void *userdata) {
+                    BufferMapResult *result = (BufferMapResult *)userdata;
+                    result->map_status = status;
+                    __atomic_clear(&result->map_complete, __ATOMIC_RELEASE);
+                },
+                &results[i]);
+        }
 
-        struct BufferMapResult {
-            volatile ScopedSpinLock::AtomicFlag map_complete;
-            volatile WGPUBufferMapAsyncStatus map_status;
-        };
-        BufferMapResult result;
-
-        // Map the staging buffer for reading.
-        __atomic_test_and_set(&result.map_complete, __ATOMIC_RELAXED);
-        wgpuBufferMapAsync(
-            context->staging_buffer, WGPUMapMode_Read, 0, num_bytes,
-            [](WGPUBufferMapAsyncStatus status, void *userdata) {
-                BufferMapResult *result = (BufferMapResult *)userdata;
-                result->map_status = status;
-                __atomic_clear(&result->map_complete, __ATOMIC_RELEASE);
-            },
-            &result);
-
-        while (__atomic_test_and_set(&result.map_complete, __ATOMIC_ACQUIRE)) {
-            wgpuDeviceTick(context->device);
+        // Copy the data from the mapped staging buffers to the host allocation.
+        int64_t chunk_offset = offset;
+        for (int i = 0; i < num_chunks; i++) {
+            chunk_offset -= chunk_bytes[i];
         }
-        if (result.map_status != WGPUBufferMapAsyncStatus_Success) {
-            error(user_context) << "wgpuBufferMapAsync failed: "
-                                << result.map_status << "\n";
-            return halide_error_code_copy_to_host_failed;
+        int err = halide_error_code_success;
+        for (int i = 0; i < num_chunks; i++) {
+            while (__atomic_test_and_set(&results[i].map_complete, __ATOMIC_ACQUIRE)) {
+                wgpuDeviceTick(context->device);
+            }
+            if (results[i].map_status != WGPUBufferMapAsyncStatus_Success) {
+                error(user_context) << "wgpuBufferMapAsync failed: "
+                                    << results[i].map_status << "\n";
+                err = halide_error_code_copy_to_host_failed;
+            } else {
+                if (err == halide_error_code_success) {
+                    const void *src = wgpuBufferGetConstMappedRange(ring[i], 0,
+                                                                    chunk_bytes[i]);
+                    memcpy(dst + chunk_offset, src, chunk_bytes[i]);
+                }
+                wgpuBufferUnmap(ring[i]);
+            }
+            chunk_offset += chunk_bytes[i];
+        }
+        if (err != halide_error_code_success) {
+            return err;
         }
-
-        // Copy the data from the mapped staging buffer to the host allocation.
-        const void *src = wgpuBufferGetConstMappedRange(context->staging_buffer,
-                                                        0, num_bytes);
-        memcpy(dst + offset, src, num_bytes);
-        wgpuBufferUnmap(context->staging_buffer);
     }
 
     return halide_error_code_success;
 }
 
+// A host-visible buffer that host-to-device copies are packed into, created
+// mapped so that it can be filled directly and copied from without waiting.
+struct UploadBuffer {
+    WGPUBuffer buffer;
+    uint8_t *data;
+    uint64_t offset;
+};
+
 int do_multidimensional_copy(void *user_context, WgpuContext *context,
                              const device_copy &c,
                              int64_t src_idx, int64_t dst_idx,
-                             int d, bool from_host, bool to_host) {
+                             int d, bool from_host, bool to_host,
+                             UploadBuffer *upload) {
     if (d > MAX_COPY_DIMS) {
         error(user_context)
             << "Buffer has too many dimensions to copy to/from GPU\n";
@@ -634,24 +774,26 @@ int do_multidimensional_copy(void *user_context, WgpuContext *context,
                                   src->buffer, src_idx + src->offset,
                                   copy_size);
         } else if (from_host && !to_host) {
-            wgpuQueueWriteBuffer(context->queue, dst->buffer,
-                                 dst_idx + dst->offset,
-                                 (void *)(c.src + src_idx), copy_size);
+            // Pack the chunk into the upload buffer, and record a copy from
+            // there, in order with the other pending commands.
+            memcpy(upload->data + upload->offset,
+                   (void *)(c.src + src_idx), c.chunk_size);
+            wgpuCommandEncoderCopyBufferToBuffer(get_pending_encoder(context->device),
+                                                 upload->buffer,
+                                                 upload->offset,
+                                                 dst->buffer,
+                                                 dst_idx + dst->offset,
+                                                 copy_size);
+            upload->offset += copy_size;
+            pending_commands++;
         } else if (!from_host && !to_host) {
-            // Create a command encoder and encode a copy command.
-            WGPUCommandEncoder encoder =
-                wgpuDeviceCreateCommandEncoder(context->device, nullptr);
-            wgpuCommandEncoderCopyBufferToBuffer(encoder,
+            wgpuCommandEncoderCopyBufferToBuffer(get_pending_encoder(context->device),
                                                  src->buffer,
                                                  src_idx + src->offset,
                                                  dst->buffer,
                                                  dst_idx + dst->offset,
                                                  c.chunk_size);
-
-            // Submit the copy command.
-            WGPUCommandBuffer cmd = wgpuCommandEncoderFinish(encoder, nullptr);
-            wgpuQueueSubmit(context->queue, 1, &cmd);
-            wgpuCommandEncoderRelease(encoder);
+            pending_commands++;
         } else if ((c.dst + dst_idx) != (c.src + src_idx)) {
             // Could reach here if a user called directly into the
             // WebGPU API for a device->host copy on a source buffer
@@ -666,7 +808,8 @@ int do_multidimensional_copy(void *user_context, WgpuContext *context,
             int err = do_multidimensional_copy(user_context, context, c,
                                                src_idx + src_off,
                                                dst_idx + dst_off,
-                                               d - 1, from_host, to_host);
+                                               d - 1, from_host, to_host,
+                                               upload);
             dst_off += c.dst_stride_bytes[d - 1];
             src_off += c.src_stride_bytes[d - 1];
             if (err) {
@@ -719,9 +862,38 @@ WEAK int halide_webgpu_buffer_copy(void *user_context,
 
         ErrorScope error_scope(user_context, context.device);
 
+        // Create a mapped buffer to hold all of the chunks of a host-to-device
+        // copy, rather than writing each one to the queue separately.
+        UploadBuffer upload = {nullptr, nullptr, 0};
+        if (from_host && !to_host && dst->dimensions <= MAX_COPY_DIMS) {
+            uint64_t upload_size = round_up_to_multiple_of_4(c.chunk_size);
+            for (int i = 0; i < dst->dimensions; i++) {
+                upload_size *= c.extent[i];
+            }
+
+            WGPUBufferDescriptor desc{};
+            desc.nextInChain = nullptr;
+            desc.label = nullptr;
+            desc.usage = WGPUBufferUsage_CopySrc | WGPUBufferUsage_MapWrite;
+            desc.size = upload_size;
+            desc.mappedAtCreation = true;
+            upload.buffer = wgpuDeviceCreateBuffer(context.device, &desc);
+            upload.data =
+                (uint8_t *)wgpuBufferGetMappedRange(upload.buffer, 0, upload_size);
+        }
+
         err = do_multidimensional_copy(user_context, &context, c,
                                        c.src_begin, 0, dst->dimensions,
-                                       from_host, to_host);
+                                       from_host, to_host, &upload);
+
+        if (upload.buffer) {
+            // The pending commands keep the buffer alive until they are done.
+            wgpuBufferUnmap(upload.buffer);
+            wgpuBufferRelease(upload.buffer);
+        }
+        if (pending_commands >= kMaxPendingCommands) {
+            submit_pending_commands();
+        }
         if (err == halide_error_code_success) {
             err = error_scope.wait();
         }
@@ -870,6 +1042,12 @@ WEAK void halide_webgpu_finalize_kernels(void *user_context, void *state_ptr) {
 
     WgpuContext context(user_context);
     if (context.error_code == halide_error_code_success) {
+        // This is called when the pipeline that uses these kernels is done
+        // with them, so submit everything it recorded.
+        ErrorScope error_scope(user_context, context.device);
+        submit_pending_commands();
+        (void)error_scope.wait();  // errors have already been reported
+
         shader_cache.release_hold(user_context, context.device, state_ptr);
     }
 }
@@ -924,9 +1102,8 @@ WEAK int halide_webgpu_run(void *user_context,
     WGPUComputePipeline pipeline =
         wgpuDeviceCreateComputePipeline(context.device, &pipeline_desc);
 
-    // Set up a compute shader dispatch command.
-    WGPUCommandEncoder encoder =
-        wgpuDeviceCreateCommandEncoder(context.device, nullptr);
+    // Record a compute shader dispatch command with the other pending commands.
+    WGPUCommandEncoder encoder = get_pending_encoder(context.device);
     WGPUComputePassEncoder pass =
         wgpuCommandEncoderBeginComputePass(encoder, nullptr);
     wgpuComputePassEncoderSetPipeline(pass, pipeline);
@@ -1104,14 +1281,15 @@ WEAK int halide_webgpu_run(void *user_context,
 
     wgpuComputePassEncoderDispatchWorkgroups(pass, groupsX, groupsY, groupsZ);
     wgpuComputePassEncoderEnd(pass);
-
-    // Submit the compute command.
-    WGPUCommandBuffer commands = wgpuCommandEncoderFinish(encoder, nullptr);
-    wgpuQueueSubmit(context.queue, 1, &commands);
-
-    wgpuCommandEncoderRelease(encoder);
+    wgpuComputePassEncoderRelease(pass);
     wgpuComputePipelineRelease(pipeline);
 
+    // Submit long runs of dispatches as we go, so that the device isn't idle
+    // until the end of the pipeline.
+    if (++pending_commands >= kMaxPendingCommands) {
+        submit_pending_commands();
+    }
+
     return error_scope.wait();
 }
 
@@ -1,4 +1,5 @@
 #include "HalideRuntime.h"
+#include "scoped_mutex_lock.h"
 
 // We support four formats, npy, tiff, mat, and tmp.
 //
@@ -167,27 +168,12 @@ WEAK halide_type_to_dst_type_t debug_to_file_type_map[] = {  //
 }  // namespace Runtime
 }  // namespace Halide
 
-WEAK extern "C" int halide_debug_to_file(void *user_context, const char *filename, struct halide_buffer_t *buf) {
-
-    if (buf->is_bounds_query()) {
-        halide_error(user_context, "Bounds query buffer passed to halide_debug_to_file");
-        return halide_error_code_host_is_null;
-    }
-
-    if (buf->dimensions > 4) {
-        halide_error(user_context, "Can't debug_to_file a Func with more than four dimensions\n");
-        return halide_error_code_bad_dimensions;
-    }
-
-    if (auto result = halide_copy_to_host(user_context, buf); result != halide_error_code_success) {
-        // halide_error() has already been called
-        return result;
-    }
-
-    // Note: all calls to this function are wrapped in an assert that identifies
-    // the function that failed, so calling halide_error() anywhere after this is redundant
-    // and actually unhelpful.
+namespace Halide {
+namespace Runtime {
+namespace Internal {
 
+// Write a buffer on the host, of at most four dimensions, to a file.
+WEAK int write_debug_file(const char *filename, const halide_buffer_t *buf) {
     ScopedFile f(filename, "wb");
     if (!f.open()) {
         return halide_error_code_debug_to_file_failed;
@@ -495,3 +481,232 @@ WEAK extern "C" int halide_debug_to_file(void *user_context, const char *filenam
 
     return halide_error_code_success;
 }
+
+// In async mode, halide_debug_to_file makes a dense copy of the buffer
+// and queues it, and a background thread does the writes, in order.
+struct DebugFileJob {
+    DebugFileJob *next;
+    char *filename;
+    halide_buffer_t buf;
+    halide_dimension_t dim[4];
+    size_t bytes;
+};
+
+struct DebugFileQueue {
+    halide_mutex mutex;
+    // Signaled whenever a job is queued or finished, or on shutdown.
+    halide_cond cond;
+    DebugFileJob *head, *tail;
+    // The size of the copies that are queued or being written.
+    size_t pending_bytes;
+    int jobs_in_flight;
+    // The first error from a background write since it was last reported.
+    int error;
+    halide_thread *thread;
+    bool shutdown;
+};
+
+WEAK DebugFileQueue debug_file_queue;
+
+// 0 for off, or the most bytes of copies to let wait for the
+// background thread. -1 until the environment has been checked.
+WEAK int64_t debug_to_file_async_bytes = -1;
+
+WEAK void debug_file_writer(void *) {
+    DebugFileQueue &q = debug_file_queue;
+    ScopedMutexLock lock(&q.mutex);
+    while (true) {
+        while (!q.head && !q.shutdown) {
+            halide_cond_wait(&q.cond, &q.mutex);
+        }
+        if (!q.head) {
+            return;
+        }
+        DebugFileJob *job = q.head;
+        q.head = job->next;
+        if (!q.head) {
+            q.tail = nullptr;
+        }
+
+        halide_mutex_unlock(&q.mutex);
+        int result = write_debug_file(job->filename, &job->buf);
+        halide_mutex_lock(&q.mutex);
+
+        if (result != halide_error_code_success && q.error == halide_error_code_success) {
+            q.error = result;
+        }
+        q.pending_bytes -= job->bytes;
+        q.jobs_in_flight--;
+        free(job);
+        halide_cond_broadcast(&q.cond);
+    }
+}
+
+WEAK int64_t debug_to_file_async_limit() {
+    if (debug_to_file_async_bytes < 0) {
+        const char *env = getenv("HL_DEBUG_TO_FILE_ASYNC");
+        debug_to_file_async_bytes = env ? (int64_t)atoi(env) << 20 : 0;
+    }
+    return debug_to_file_async_bytes;
+}
+
+// Copy the buffer and queue it for the background thread. Returns false
+// if that's not possible, in which case it should be written directly.
+WEAK bool queue_debug_file(const char *filename, const halide_buffer_t *buf, int64_t limit) {
+    DebugFileQueue &q = debug_file_queue;
+    const size_t bytes = buf->size_in_bytes();
+    const size_t name_bytes = strlen(filename) + 1;
+
+    // Wait for room, unless this copy wouldn't fit even in an empty queue.
+    ScopedMutexLock lock(&q.mutex);
+    while (q.jobs_in_flight > 0 && q.pending_bytes + bytes > (uint64_t)limit) {
+        halide_cond_wait(&q.cond, &q.mutex);
+    }
+    if (!q.thread) {
+        q.thread = halide_spawn_thread(debug_file_writer, nullptr);
+        if (!q.thread) {
+            return false;
+        }
+    }
+
+    DebugFileJob *job = (DebugFileJob *)malloc(sizeof(DebugFileJob) + name_bytes + bytes);
+    if (!job) {
+        return false;
+    }
+    job->next = nullptr;
+    job->filename = (char *)(job + 1);
+    memcpy(job->filename, filename, name_bytes);
+    job->bytes = bytes;
+
+    // The copy is dense, with the same mins, type and flags.
+    job->buf = *buf;
+    job->buf.device = 0;
+    job->buf.device_interface = nullptr;
+    job->buf.dim = job->dim;
+    job->buf.host = (uint8_t *)job->filename + name_bytes;
+    int64_t stride = 1;
+    for (int i = 0; i < buf->dimensions; i++) {
+        job->dim[i] = buf->dim[i];
+        job->dim[i].stride = (int32_t)stride;
+        stride *= buf->dim[i].extent;
+    }
+
+    // Copy it a row at a time, if the rows are dense.
+    halide_dimension_t shape[4];
+    for (int i = 0; i < 4; i++) {
+        if (i < buf->dimensions) {
+            shape[i] = buf->dim[i];
+        } else {
+            shape[i] = {0, 1, 0, 0};
+        }
+    }
+    const int elem_bytes = buf->type.bytes();
+    const bool dense_rows = shape[0].stride == 1;
+    const int32_t row_elts = dense_rows ? shape[0].extent : 1;
+    uint8_t *dst = job->buf.host;
+    for (int32_t i3 = shape[3].min; i3 < shape[3].min + shape[3].extent; i3++) {
+        for (int32_t i2 = shape[2].min; i2 < shape[2].min + shape[2].extent; i2++) {
+            for (int32_t i1 = shape[1].min; i1 < shape[1].min + shape[1].extent; i1++) {
+                for (int32_t i0 = shape[0].min; i0 < shape[0].min + shape[0].extent; i0 += row_elts) {
+                    int idx[] = {i0, i1, i2, i3};
+                    memcpy(dst, buf->address_of(idx), row_elts * elem_bytes);
+                    dst += row_elts * elem_bytes;
+                }
+            }
+        }
+    }
+
+    if (q.tail) {
+        q.tail->next = job;
+    } else {
+        q.head = job;
+    }
+    q.tail = job;
+    q.pending_bytes += bytes;
+    q.jobs_in_flight++;
+    halide_cond_broadcast(&q.cond);
+    return true;
+}
+
+}  // namespace Internal
+}  // namespace Runtime
+}  // namespace Halide
+
+WEAK extern "C" int halide_debug_to_file(void *user_context, const char *filename, struct halide_buffer_t *buf) {
+
+    if (buf->is_bounds_query()) {
+        halide_error(user_context, "Bounds query buffer passed to halide_debug_to_file");
+        return halide_error_code_host_is_null;
+    }
+
+    if (buf->dimensions > 4) {
+        halide_error(user_context, "Can't debug_to_file a Func with more than four dimensions\n");
+        return halide_error_code_bad_dimensions;
+    }
+
+    if (auto result = halide_copy_to_host(user_context, buf); result != halide_error_code_success) {
+        // halide_error() has already been called
+        return result;
+    }
+
+    // Note: all calls to this function are wrapped in an assert that identifies
+    // the function that failed, so calling halide_error() anywhere after this is redundant
+    // and actually unhelpful.
+
+    if (int64_t limit = debug_to_file_async_limit(); limit > 0) {
+        // Report a failed background write from an earlier call.
+        {
+            ScopedMutexLock lock(&debug_file_queue.mutex);
+            if (int result = debug_file_queue.error; result != halide_error_code_success) {
+                debug_file_queue.error = halide_error_code_success;
+                return result;
+            }
+        }
+        if (queue_debug_file(filename, buf, limit)) {
+            return halide_error_code_success;
+        }
+    }
+
+    return write_debug_file(filename, buf);
+}
+
+WEAK extern "C" void halide_set_debug_to_file_async(int max_pending_megabytes) {
+    if (max_pending_megabytes <= 0) {
+        // Don't leave anything behind to be written later.
+        halide_debug_to_file_flush(nullptr);
+        debug_to_file_async_bytes = 0;
+    } else {
+        debug_to_file_async_bytes = (int64_t)max_pending_megabytes << 20;
+    }
+}
+
+WEAK extern "C" int halide_debug_to_file_flush(void *user_context) {
+    DebugFileQueue &q = debug_file_queue;
+    ScopedMutexLock lock(&q.mutex);
+    while (q.jobs_in_flight > 0) {
+        halide_cond_wait(&q.cond, &q.mutex);
+    }
+    int result = q.error;
+    q.error = halide_error_code_success;
+    return result;
+}
+
+namespace {
+
+WEAK __attribute__((destructor)) void halide_debug_to_file_cleanup() {
+    DebugFileQueue &q = debug_file_queue;
+    halide_thread *thread = nullptr;
+    {
+        // Let the background thread finish the writes, then stop it.
+        ScopedMutexLock lock(&q.mutex);
+        q.shutdown = true;
+        thread = q.thread;
+        q.thread = nullptr;
+        halide_cond_broadcast(&q.cond);
+    }
+    if (thread) {
+        halide_join_thread(thread);
+    }
+}
+
+}  // namespace
@@ -146,3 +146,11 @@ define weak_odr void @x64_cpuid_halide(i32* %info) nounwind uwtable {
   call void asm sideeffect inteldialect "xchg rbx, rsi\0A\09mov eax, dword ptr $$0 $0\0A\09mov ecx, dword ptr $$4 $0\0A\09cpuid\0A\09mov dword ptr $$0 $0, eax\0A\09mov dword ptr $$4 $0, ebx\0A\09mov dword ptr $$8 $0, ecx\0A\09mov dword ptr $$12 $0, edx\0A\09xchg rbx, rsi", "=*m,~{eax},~{ebx},~{ecx},~{edx},~{esi},~{dirflag},~{fpsr},~{flags}"(i32* elementtype(i32) %info)
   ret void
 }
+
+declare i64 @llvm.readcyclecounter()
+
+; The cycle counter read by pipelines compiled with the light profiler. This is rdtsc.
+define weak_odr i64 @halide_profiler_light_ticks() nounwind uwtable alwaysinline {
+  %ticks = tail call i64 @llvm.readcyclecounter()
+  ret i64 %ticks
+}
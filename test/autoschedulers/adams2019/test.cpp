@@ -35,9 +35,11 @@ bool test_caching(Pipeline &p1, Pipeline &p2, const Target &target) {
     params.extra["disable_memoized_blocks"] = "1";
     auto results_without_caching = p1.apply_autoscheduler(target, params);
 
-    // Turn on caching.
+    // Turn on caching, and expand states on several threads. Neither
+    // should change the schedule found.
     params.extra["disable_memoized_features"] = "0";
     params.extra["disable_memoized_blocks"] = "0";
+    params.extra["search_threads"] = "4";
     auto results_with_caching = p2.apply_autoscheduler(target, params);
 
     // Compare calculated features.
@@ -55,6 +57,24 @@ bool test_caching(Pipeline &p1, Pipeline &p2, const Target &target) {
     return true;
 }
 
+bool test_schedule_cache(Pipeline &p1, Pipeline &p2, const Target &target) {
+    AutoschedulerParams params(
+        "Adams2019",
+        {
+            {"parallelism", "32"},
+            {"weights_path", weights_path},
+            {"schedule_cache_dir", Internal::dir_make_temp()},
+        });
+
+    // The first search stores its result in the cache, and the second
+    // one should reuse it.
+    auto first = p1.apply_autoscheduler(target, params);
+    auto second = p2.apply_autoscheduler(target, params);
+
+    return first.schedule_source == second.schedule_source &&
+           first.featurization == second.featurization;
+}
+
 int main(int argc, char **argv) {
     if (argc != 3 || !strlen(argv[1]) || !strlen(argv[2])) {
         fprintf(stderr, "Usage: %s <autoscheduler-lib> <weights-path>\n", argv[0]);
@@ -902,6 +922,54 @@ int main(int argc, char **argv) {
         }
     }
 
+    // A stencil, scheduled twice with the schedule cache
+    if (true) {
+        Pipeline p1;
+        Pipeline p2;
+        for (int test_condition = 0; test_condition < 2; test_condition++) {
+            // The Funcs need the same names both times to hit the cache.
+            Func f("f"), g("g");
+            f(x, y) = (x + y) * (x + y);
+            g(x, y) = f(x - 1, y) + f(x + 1, y) + f(x, y - 1) + f(x, y + 1);
+
+            g.set_estimate(x, 0, 1000).set_estimate(y, 0, 1000);
+
+            if (test_condition) {
+                p2 = Pipeline(g);
+            } else {
+                p1 = Pipeline(g);
+            }
+        }
+
+        if (!test_schedule_cache(p1, p2, target)) {
+            std::cerr << "Schedule cache check failed on a stencil" << std::endl;
+            return 1;
+        }
+    }
+
+    // Two outputs of a shared intermediate, scheduled with their
+    // outermost loops fused where possible. The result must still lower.
+    if (true) {
+        Func f("f"), g1("g1"), g2("g2");
+        f(x, y) = (x + y) * (x + y);
+        g1(x, y) = f(x - 1, y) + f(x + 1, y);
+        g2(x, y) = f(x, y - 1) + f(x, y + 1);
+
+        g1.set_estimate(x, 0, 1000).set_estimate(y, 0, 1000);
+        g2.set_estimate(x, 0, 1000).set_estimate(y, 0, 1000);
+
+        Pipeline p({g1, g2});
+        AutoschedulerParams params(
+            "Adams2019",
+            {
+                {"parallelism", "32"},
+                {"weights_path", weights_path},
+                {"fuse_outputs", "1"},
+            });
+        p.apply_autoscheduler(target, params);
+        p.compile_to_module({}, "fused_outputs", target);
+    }
+
     std::cout << "adams2019 testing passed\n";
     return 0;
 }
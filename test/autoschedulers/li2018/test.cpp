@@ -133,6 +133,49 @@ int main(int argc, char **argv) {
         //           << result.schedule_source << "\n\n";
     }
 
+    {  // Scalar reduction. The cost model should choose to rfactor it.
+        Func in("in");
+        in(x, y) = cast<float>(x + y);
+        RDom r(0, 1000, 0, 1000);
+        Func sum("sum");
+        sum() = 0.f;
+        sum() += in(r.x, r.y);
+
+        AutoSchedulerResults result = Pipeline(sum).apply_autoscheduler(target, params);
+        if (result.schedule_source.find(".rfactor(") == std::string::npos) {
+            fprintf(stderr, "Expected the scalar reduction to be rfactored:\n%s\n",
+                    result.schedule_source.c_str());
+            return 1;
+        }
+    }
+
+    // Check that every reduction strategy produces a correct histogram.
+    for (const char *strategy : {"auto", "rfactor", "atomic"}) {
+        Func in("in");
+        in(x, y) = (x + y) % 10;
+        RDom r(0, 1000, 0, 1000);
+        Func hist("hist");
+        hist(x) = 0;
+        hist(clamp(in(r.x, r.y), 0, 9)) += 1;
+
+        hist.set_estimate(x, 0, 10);
+
+        Target jit_target = get_jit_target_from_environment();
+        AutoschedulerParams strategy_params = {"Li2018",
+                                               {{"parallelism", std::to_string(parallelism)},
+                                                {"reduction_strategy", strategy}}};
+        Pipeline p(hist);
+        p.apply_autoscheduler(jit_target, strategy_params);
+        Buffer<int> out = p.realize({10}, jit_target);
+        for (int i = 0; i < 10; i++) {
+            if (out(i) != 100000) {
+                fprintf(stderr, "hist(%d) = %d instead of 100000 with reduction_strategy=%s\n",
+                        i, out(i), strategy);
+                return 1;
+            }
+        }
+    }
+
     {  // Test for conjunction use of bound and estimates.
         Func in("in");
         in(x, y) = cast<float>(x + y);
@@ -0,0 +1,76 @@
+#include "Halide.h"
+
+using namespace Halide;
+
+Pipeline make_pipeline(Buffer<uint16_t> input) {
+    Var x("x"), y("y");
+
+    Func in = BoundaryConditions::repeat_edge(input);
+
+    Func blur_x("blur_x"), blur_y("blur_y"), sharpen("sharpen"), out("out");
+    blur_x(x, y) = (in(x - 1, y) + in(x, y) + in(x + 1, y)) / 3;
+    blur_y(x, y) = (blur_x(x, y - 1) + blur_x(x, y) + blur_x(x, y + 1)) / 3;
+    sharpen(x, y) = 2 * in(x, y) - blur_y(x, y);
+    out(x, y) = (sharpen(x - 1, y) + sharpen(x + 1, y) + blur_x(x, y)) / 3;
+
+    out.set_estimates({{0, 1536}, {0, 2560}});
+
+    return Pipeline(out);
+}
+
+int main(int argc, char **argv) {
+    if (get_jit_target_from_environment().arch == Target::WebAssembly) {
+        printf("[SKIP] Autoschedulers do not support WebAssembly.\n");
+        return 0;
+    }
+
+    if (argc != 2) {
+        fprintf(stderr, "Usage: %s <autoscheduler-lib>\n", argv[0]);
+        return 1;
+    }
+
+    load_plugin(argv[1]);
+
+    Buffer<uint16_t> input(1536, 2560);
+    input.fill(17);
+
+    Target target = get_jit_target_from_environment();
+
+    // The grouping found shouldn't depend on how many threads evaluate
+    // the grouping choices.
+    std::string schedule_source;
+    for (int threads : {1, 8}) {
+        Pipeline p = make_pipeline(input);
+        AutoschedulerParams params = {"Mullapudi2016", {{"search_threads", std::to_string(threads)}}};
+        AutoSchedulerResults results = p.apply_autoscheduler(target, params);
+        if (schedule_source.empty()) {
+            schedule_source = results.schedule_source;
+        } else if (results.schedule_source != schedule_source) {
+            fprintf(stderr, "Schedule found with %d threads differs from the one found with one thread:\n%s\nvs\n%s\n",
+                    threads, results.schedule_source.c_str(), schedule_source.c_str());
+            return 1;
+        }
+    }
+
+    // Check that modeling L1 and L2 as well produces a working schedule.
+    {
+        Pipeline p = make_pipeline(input);
+        AutoschedulerParams params = {"Mullapudi2016",
+                                      {{"l1_cache_size", "32768"},
+                                       {"l2_cache_size", "262144"},
+                                       {"last_level_cache_size", "16777216"}}};
+        p.apply_autoscheduler(target, params);
+        Buffer<uint16_t> out = p.realize({1536, 2560});
+        for (int y = 0; y < out.height(); y++) {
+            for (int x = 0; x < out.width(); x++) {
+                if (out(x, y) != 17) {
+                    fprintf(stderr, "out(%d, %d) = %d instead of 17\n", x, y, out(x, y));
+                    return 1;
+                }
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
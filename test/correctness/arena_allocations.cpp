@@ -0,0 +1,138 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+int mallocs = 0;
+size_t largest_malloc = 0;
+
+void *my_malloc(JITUserContext *user_context, size_t x) {
+    mallocs++;
+    largest_malloc = std::max(largest_malloc, x);
+    void *orig = malloc(x + 128);
+    void *ptr = (void *)((((size_t)orig + 128) >> 7) << 7);
+    ((void **)ptr)[-1] = orig;
+    return ptr;
+}
+
+void my_free(JITUserContext *user_context, void *ptr) {
+    free(((void **)ptr)[-1]);
+}
+
+// Realize a pipeline of two Funcs computed at root, and two per row of
+// tiles, and return the number of times it called halide_malloc.
+int run(const Target &t, bool parallel) {
+    Func f("f"), g("g"), h("h"), k("k"), out("out");
+    Var x("x"), y("y"), yo("yo"), yi("yi");
+    Param<int> p;
+
+    f(x, y) = x + y + p;
+    g(x, y) = f(x, y) * 2;
+    h(x, y) = g(x, y) - g(x + 1, y);
+    k(x, y) = h(x, y) + h(x, y + 1);
+    out(x, y) = k(x, y) * 3;
+
+    f.compute_root();
+    g.compute_root();
+    out.split(y, yo, yi, 16);
+    if (parallel) {
+        out.parallel(yo);
+    }
+    h.compute_at(out, yo);
+    k.compute_at(out, yo);
+
+    out.jit_handlers().custom_malloc = my_malloc;
+    out.jit_handlers().custom_free = my_free;
+
+    const int width = 1000, height = 100;
+    mallocs = 0;
+    p.set(3);
+    Buffer<int> result = out.realize({width, height}, t);
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            auto gv = [&](int x, int y) { return (x + y + 3) * 2; };
+            auto hv = [&](int x, int y) { return gv(x, y) - gv(x + 1, y); };
+            int correct = (hv(x, y) + hv(x, y + 1)) * 3;
+            if (result(x, y) != correct) {
+                printf("result(%d, %d) = %d instead of %d\n", x, y, result(x, y), correct);
+                exit(1);
+            }
+        }
+    }
+    return mallocs;
+}
+
+// Realize a chain of Funcs computed at root, each one the same size,
+// and return the size of the largest call to halide_malloc.
+size_t run_chain(const Target &t) {
+    const int width = 256, height = 256, length = 6;
+    Var x("x"), y("y");
+    std::vector<Func> chain;
+    chain.emplace_back("chain_0");
+    chain[0](x, y) = x + y;
+    for (int i = 1; i < length; i++) {
+        chain.emplace_back("chain_" + std::to_string(i));
+        chain[i](x, y) = chain[i - 1](x, y) + 1;
+        chain[i - 1].compute_root();
+    }
+    Func out("out");
+    out(x, y) = chain.back()(x, y) * 2;
+
+    out.jit_handlers().custom_malloc = my_malloc;
+    out.jit_handlers().custom_free = my_free;
+
+    largest_malloc = 0;
+    Buffer<int> result = out.realize({width, height}, t);
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            int correct = (x + y + length - 1) * 2;
+            if (result(x, y) != correct) {
+                printf("result(%d, %d) = %d instead of %d\n", x, y, result(x, y), correct);
+                exit(1);
+            }
+        }
+    }
+    return largest_malloc;
+}
+
+int main(int argc, char **argv) {
+    Target t = get_jit_target_from_environment();
+    if (t.arch == Target::WebAssembly) {
+        printf("[SKIP] WebAssembly JIT does not support custom allocators.\n");
+        return 0;
+    }
+    if (t.has_gpu_feature()) {
+        printf("[SKIP] Test requires heap allocations on the host.\n");
+        return 0;
+    }
+
+    int without_arenas = run(t, false);
+    int with_arenas = run(t.with_feature(Target::ArenaAllocations), false);
+    // f and g share an arena with h and k, whose allocations in every
+    // row of tiles reuse the same part of it.
+    if (with_arenas != 1) {
+        printf("%d calls to halide_malloc with arenas (%d without), instead of one\n",
+               with_arenas, without_arenas);
+        return 1;
+    }
+
+    // Each task of a parallel loop gets an arena of its own.
+    int parallel = run(t.with_feature(Target::ArenaAllocations), true);
+    if (parallel != 1 + 100 / 16 + 1) {
+        printf("%d calls to halide_malloc with arenas and parallel tiles\n", parallel);
+        return 1;
+    }
+
+    // Each Func in the chain is freed after the next one is computed, so
+    // only two are alive at once, and the rest reuse their memory.
+    const size_t func_size = 256 * 256 * sizeof(int);
+    size_t chain_size = run_chain(t.with_feature(Target::ArenaAllocations));
+    if (chain_size < func_size || chain_size > 2 * func_size + 1024) {
+        printf("Arena for the chain of Funcs is %d bytes, instead of two Funcs of %d bytes\n",
+               (int)chain_size, (int)func_size);
+        return 1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
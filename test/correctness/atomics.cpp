@@ -978,6 +978,57 @@ void test_hist_tuple_rfactor(const Backend &backend) {
     }
 }
 
+template<typename T>
+void test_hist_gpu_shared(const Backend &backend) {
+    int img_size = 10000;
+    int hist_size = 53;
+
+    Func im, hist;
+    Var x, u;
+    RDom r(0, img_size);
+
+    im(x) = (x * x) % hist_size;
+
+    hist(x) = cast<T>(0);
+    hist(im(r)) += cast<T>(1);
+
+    // Give each GPU block a private histogram in shared memory, which
+    // its threads update with shared-memory atomics. Then each block
+    // merges its histogram into the global one with one global atomic
+    // per bin, instead of one per element of im.
+    RVar ro, ri;
+    hist.compute_root();
+    hist.update().split(r, ro, ri, 256, TailStrategy::GuardWithIf);
+    Func partial = hist.update().rfactor(ro, u);
+
+    DeviceAPI device_api = backend == Backend::OpenCL ? DeviceAPI::OpenCL : DeviceAPI::CUDA;
+    hist.update()
+        .atomic()
+        .gpu_blocks(ro, device_api)
+        .gpu_threads(x, device_api);
+    partial.compute_at(hist, ro)
+        .store_in(MemoryType::GPUShared)
+        .gpu_threads(x, device_api);
+    partial.update()
+        .atomic()
+        .gpu_threads(ri, device_api);
+
+    Buffer<T> correct(hist_size);
+    correct.fill(T(0));
+    for (int i = 0; i < img_size; i++) {
+        int idx = (i * i) % hist_size;
+        correct(idx) = correct(idx) + T(1);
+    }
+
+    // Run 10 times to make sure race condition do happen
+    for (int iter = 0; iter < 10; iter++) {
+        Buffer<T> out = hist.realize({hist_size});
+        for (int i = 0; i < hist_size; i++) {
+            check(__LINE__, out(i), correct(i));
+        }
+    }
+}
+
 template<typename T>
 void test_all(const Backend &backend) {
     test_parallel_hist<T>(backend);
@@ -991,6 +1042,9 @@ void test_all(const Backend &backend) {
         test_hist_store_at<T>(backend);
     }
     test_hist_rfactor<T>(backend);
+    if (backend == Backend::OpenCL || backend == Backend::CUDA) {
+        test_hist_gpu_shared<T>(backend);
+    }
     if (backend == Backend::CPU) {
         // These require mutex locking which does not support vectorization and GPU
         test_parallel_hist_tuple<T>(backend);
@@ -0,0 +1,61 @@
+#include "Halide.h"
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    Target t = get_jit_target_from_environment().with_feature(Target::AutoRFactor);
+
+    // A sum over a large constant domain.
+    {
+        const int size = 1 << 20;
+        Buffer<int> in(size);
+        in.for_each_element([&](int x) { in(x) = x % 13; });
+
+        Func sum("sum");
+        RDom r(0, size);
+        sum() = 0;
+        sum() += in(r);
+
+        Buffer<int> out = sum.realize({}, t);
+
+        int correct = 0;
+        for (int i = 0; i < size; i++) {
+            correct += i % 13;
+        }
+        if (out() != correct) {
+            printf("sum() = %d instead of %d\n", out(), correct);
+            return 1;
+        }
+    }
+
+    // The max of each channel of an image whose size isn't known until
+    // it is run.
+    {
+        ImageParam im(Float(32), 3);
+        Func max_per_channel("max_per_channel");
+        Var c;
+        RDom r(0, im.dim(0).extent(), 0, im.dim(1).extent());
+        max_per_channel(c) = im.type().min();
+        max_per_channel(c) = max(max_per_channel(c), im(r.x, r.y, c));
+        max_per_channel.bound(c, 0, 3);
+
+        Buffer<float> in(517, 301, 3);
+        in.for_each_element([&](int x, int y, int c) {
+            in(x, y, c) = ((x * 7 + y * 13) % 101) + c * 200;
+        });
+        im.set(in);
+
+        Buffer<float> out = max_per_channel.realize({3}, t);
+
+        for (int c = 0; c < 3; c++) {
+            float correct = 100 + c * 200;
+            if (out(c) != correct) {
+                printf("max_per_channel(%d) = %f instead of %f\n", c, out(c), correct);
+                return 1;
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,90 @@
+#include "Halide.h"
+
+using namespace Halide;
+using namespace Halide::Internal;
+
+// Check whether the stores to a Func are dense vectors.
+class CheckStores : public IRMutator {
+    using IRMutator::visit;
+
+    Stmt visit(const Store *op) override {
+        if (op->name == name) {
+            const Ramp *r = op->index.as<Ramp>();
+            if (r && is_const_one(r->stride)) {
+                dense_stores++;
+            } else {
+                other_stores++;
+            }
+        }
+        return IRMutator::visit(op);
+    }
+
+    std::string name;
+
+public:
+    int dense_stores = 0, other_stores = 0;
+
+    explicit CheckStores(const std::string &name)
+        : name(name) {
+    }
+};
+
+int run_test(bool auto_storage_order) {
+    Target t = get_jit_target_from_environment();
+    if (auto_storage_order) {
+        t = t.with_feature(Target::AutoStorageOrder);
+    }
+
+    Buffer<uint8_t> in(64, 32, 4);
+    in.for_each_element([&](int x, int y, int c) {
+        in(x, y, c) = (uint8_t)(x * 3 + y * 5 + c * 7);
+    });
+
+    // An RGBA intermediate computed and consumed one pixel at a time,
+    // vectorized across the channels.
+    Func f("f"), g("g");
+    Var x("x"), y("y"), c("c");
+    f(x, y, c) = in(x, y, c) * 2;
+    g(x, y, c) = f(x, y, c) + f(x, y, 3 - c);
+
+    f.compute_root().bound(c, 0, 4).vectorize(c);
+    g.bound(c, 0, 4).vectorize(c);
+
+    CheckStores checker(f.name());
+    g.add_custom_lowering_pass(&checker, nullptr);
+    Buffer<uint8_t> out = g.realize({64, 32, 4}, t);
+
+    for (int y = 0; y < 32; y++) {
+        for (int x = 0; x < 64; x++) {
+            for (int c = 0; c < 4; c++) {
+                uint8_t correct = (uint8_t)(in(x, y, c) * 2 + in(x, y, 3 - c) * 2);
+                if (out(x, y, c) != correct) {
+                    printf("out(%d, %d, %d) = %d instead of %d\n", x, y, c, out(x, y, c), correct);
+                    return 1;
+                }
+            }
+        }
+    }
+
+    // With the feature, f should be stored interleaved, so that each
+    // pixel is one dense vector store.
+    if (auto_storage_order && (checker.dense_stores == 0 || checker.other_stores != 0)) {
+        printf("Expected only dense vector stores to f, got %d dense and %d other stores\n",
+               checker.dense_stores, checker.other_stores);
+        return 1;
+    }
+    if (!auto_storage_order && checker.dense_stores != 0) {
+        printf("Expected no dense vector stores to planar f, got %d\n", checker.dense_stores);
+        return 1;
+    }
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    if (run_test(false) || run_test(true)) {
+        return 1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -1417,6 +1417,74 @@ void test_random_float() {
     check(__LINE__, d_input(), o(0));
 }
 
+int blur_y_realizations = 0;
+int count_blur_y_realizations(JITUserContext *user_context, const halide_trace_event_t *e) {
+    if (e->event == halide_trace_begin_realization && std::string(e->func) == "blur_y") {
+        blur_y_realizations++;
+    }
+    return 0;
+}
+
+void test_checkpointing() {
+    Var x("x"), y("y");
+    Buffer<float> input(5, 5, "input");
+    for (int i = 0; i < input.width(); i++) {
+        for (int j = 0; j < input.height(); j++) {
+            input(i, j) = (i + 1) * (j + 2);
+        }
+    }
+    // Returns the gradient of the loss with respect to the input, and
+    // the number of times blur_y was realized computing it.
+    auto gradient = [&](bool mark_blurs, int64_t memory_budget) {
+        Func clamped("clamped");
+        clamped(x, y) = input(clamp(x, 0, input.width() - 1), clamp(y, 0, input.height() - 1));
+        Func blur_x("blur_x");
+        blur_x(x, y) = clamped(x, y) + clamped(x + 1, y) + clamped(x + 2, y);
+        Func blur_y("blur_y");
+        blur_y(x, y) = blur_x(x, y - 1) + blur_x(x, y) * blur_x(x, y + 1);
+        RDom r(0, 5, 0, 5);
+        Func loss("loss");
+        loss() += blur_y(r.x, r.y) * blur_y(r.x, r.y);
+
+        Checkpointing checkpointing;
+        if (mark_blurs) {
+            checkpointing.recompute = {blur_x, blur_y};
+        }
+        checkpointing.memory_budget = memory_budget;
+        Derivative d = propagate_adjoints(loss, checkpointing);
+        bool expect_recomputed = mark_blurs || memory_budget > 0;
+        _halide_user_assert(d.recomputed(blur_y).defined() == expect_recomputed)
+            << "Expected blur_y " << (expect_recomputed ? "" : "not ") << "to be recomputed\n";
+
+        // The forward pass stores blur_x and blur_y, which the gradient
+        // only reads if they aren't recomputed.
+        blur_x.compute_root();
+        blur_y.compute_root().trace_realizations();
+        Func d_input = d(input);
+        d_input.jit_handlers().custom_trace = count_blur_y_realizations;
+        blur_y_realizations = 0;
+        Buffer<float> result = d_input.realize({5, 5});
+        return std::make_pair(result, blur_y_realizations);
+    };
+
+    auto stored = gradient(false, 0);
+    _halide_user_assert(stored.second == 1)
+        << "Expected the gradient to read blur_y from the forward pass\n";
+
+    // Mark the blurs, or leave it to a budget too small for either of them.
+    for (bool mark_blurs : {true, false}) {
+        auto recomputed = gradient(mark_blurs, mark_blurs ? 0 : 1);
+        _halide_user_assert(recomputed.second == 0)
+            << "Expected the gradient to recompute blur_y\n";
+        for (int y = 0; y < 5; y++) {
+            for (int x = 0; x < 5; x++) {
+                float target = stored.first(x, y);
+                check(__LINE__, recomputed.first(x, y), target, std::fabs(target) * 1e-5f + 1e-3f);
+            }
+        }
+    }
+}
+
 int main(int argc, char **argv) {
     test_scalar<float>();
     test_scalar<double>();
@@ -1459,6 +1527,7 @@ int main(int argc, char **argv) {
     test_custom_adjoint_buffer();
     test_print();
     test_random_float();
+    test_checkpointing();
     printf("[autodiff] Success!\n");
     return 0;
 }
@@ -0,0 +1,113 @@
+#include "Halide.h"
+
+using namespace Halide;
+using namespace Halide::Internal;
+
+// Check that the vector loads of a buffer are all dense.
+class CheckDenseLoads : public IRMutator {
+    using IRMutator::visit;
+
+    Expr visit(const Load *op) override {
+        if (op->name == name && op->type.is_vector()) {
+            const Ramp *r = op->index.as<Ramp>();
+            if (!r || !is_const_one(r->stride)) {
+                other_loads++;
+            }
+        }
+        return IRMutator::visit(op);
+    }
+
+    std::string name;
+
+public:
+    int other_loads = 0;
+
+    explicit CheckDenseLoads(const std::string &name)
+        : name(name) {
+    }
+};
+
+// Pack values of the given number of bits, unpack them again, and check
+// that they survive, with and without vectorizing.
+int round_trip(int bits, Type t, bool vectorize) {
+    const int size = 256;
+    const int k = 8 / bits;
+    Buffer<int> values(size);
+    values.for_each_element([&](int x) {
+        int v = (x * 37 + 11) % (1 << bits);
+        if (t.is_int() && v >= (1 << (bits - 1))) {
+            v -= 1 << bits;
+        }
+        values(x) = v;
+    });
+
+    Var x("x");
+    Func input("input");
+    input(x) = values(x);
+    Func packed = pack_bits(input, bits);
+    if (vectorize) {
+        packed.vectorize(x, 16);
+    }
+    Buffer<uint8_t> packed_buf = packed.realize({size / k});
+    packed_buf.set_name("packed_buf");
+
+    Func bytes("bytes");
+    bytes(x) = packed_buf(x);
+    Func unpacked = unpack_bits(bytes, bits, t);
+    Func out("out");
+    out(x) = cast<int>(unpacked(x));
+
+    CheckDenseLoads checker(packed_buf.name());
+    if (vectorize) {
+        unpacked.compute_root();
+        schedule_unpacked_bits(unpacked, bits, 16);
+        out.add_custom_lowering_pass(&checker, nullptr);
+    }
+    Buffer<int> result = out.realize({size});
+
+    for (int x = 0; x < size; x++) {
+        if (result(x) != values(x)) {
+            printf("Round trip of %d-bit %s values: result(%d) = %d instead of %d\n",
+                   bits, (t.is_int() ? "signed" : "unsigned"), x, result(x), values(x));
+            return 1;
+        }
+    }
+    if (checker.other_loads) {
+        printf("Unpacking %d-bit values used %d loads that aren't dense\n", bits, checker.other_loads);
+        return 1;
+    }
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    for (bool vectorize : {false, true}) {
+        if (round_trip(4, Int(8), vectorize) ||
+            round_trip(4, UInt(8), vectorize) ||
+            round_trip(2, UInt(8), vectorize) ||
+            round_trip(1, UInt(8), vectorize)) {
+            return 1;
+        }
+    }
+
+    // Check the bit order of packed bytes, and unpacking to bools.
+    {
+        Buffer<uint8_t> mask_bits(2);
+        mask_bits(0) = 0x05;
+        mask_bits(1) = 0x80;
+        Var x("x");
+        Func bytes("bytes");
+        bytes(x) = mask_bits(x);
+        Func mask = unpack_bits(bytes, 1, Bool());
+        Buffer<bool> result = mask.realize({16});
+        for (int x = 0; x < 16; x++) {
+            bool correct = (x == 0 || x == 2 || x == 15);
+            if (result(x) != correct) {
+                printf("mask(%d) = %d instead of %d\n", x, result(x), correct);
+                return 1;
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
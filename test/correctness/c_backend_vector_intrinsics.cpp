@@ -0,0 +1,56 @@
+#include "Halide.h"
+#include "halide_test_dirs.h"
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+using namespace Halide;
+using namespace Halide::ConciseCasts;
+
+int main(int argc, char **argv) {
+    // The C++ backend should leave the arithmetic FindIntrinsics
+    // recognizes to the vector ops, which use target intrinsics for it,
+    // rather than lowering it.
+    ImageParam a(UInt(8), 1, "a"), b(UInt(8), 1, "b");
+    ImageParam c(Int(16), 1, "c"), d(Int(16), 1, "d");
+    Var x("x");
+
+    Func sat_add("sat_add"), sat_sub("sat_sub"), avg("avg"), avg_round("avg_round");
+    Func wide_mul("wide_mul"), round_shift("round_shift"), out("out");
+    sat_add(x) = u8_sat(u16(a(x)) + b(x));
+    sat_sub(x) = i16_sat(i32(c(x)) - d(x));
+    avg(x) = u8((u16(a(x)) + b(x)) / 2);
+    avg_round(x) = u8((u16(a(x)) + b(x) + 1) / 2);
+    wide_mul(x) = i32(c(x)) * d(x);
+    round_shift(x) = i16((i32(c(x)) + 8) >> 4);
+    out(x) = i32(sat_add(x)) + sat_sub(x) + avg(x) + avg_round(x) + wide_mul(x) + round_shift(x);
+
+    for (Func f : {sat_add, sat_sub, avg, avg_round, wide_mul, round_shift}) {
+        f.compute_root().vectorize(x, 16);
+    }
+
+    std::string result_file = Internal::get_test_tmp_dir() + "c_backend_vector_intrinsics.cpp";
+    Internal::ensure_no_file_exists(result_file);
+    out.compile_to_c(result_file, {a, b, c, d}, "c_backend_vector_intrinsics", get_host_target());
+    Internal::assert_file_exists(result_file);
+
+    std::ifstream in(result_file);
+    std::stringstream source;
+    source << in.rdbuf();
+
+    for (const char *op : {"uint8x16_t_ops::saturating_add(",
+                           "int16x16_t_ops::saturating_sub(",
+                           "uint8x16_t_ops::halving_add(",
+                           "uint8x16_t_ops::rounding_halving_add(",
+                           "int32x16_t_ops::widening_mul<int16_t>(",
+                           "int16x16_t_ops::rounding_shift_right("}) {
+        if (source.str().find(op) == std::string::npos) {
+            printf("Expected to find %s in the generated code\n", op);
+            return 1;
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
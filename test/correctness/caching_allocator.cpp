@@ -0,0 +1,46 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    if (get_jit_target_from_environment().arch == Target::WebAssembly) {
+        printf("[SKIP] WebAssembly JIT does not support custom allocators.\n");
+        return 0;
+    }
+
+    // Nothing has been allocated yet, so it's safe to switch.
+    Internal::JITSharedRuntime::use_caching_allocator();
+
+    // Heap allocations per parallel tile, of sizes spanning several size
+    // classes, and ones too large to be cached.
+    for (int tile : {3, 16, 100, 1000, 5000, 20000}) {
+        Func f, g, h;
+        Var x, xo, xi;
+        Param<int> p;
+
+        f(x) = x * 2 + p;
+        g(x) = f(x) + f(x + 1);
+        h(x) = g(x) * 3;
+
+        h.split(x, xo, xi, tile, TailStrategy::GuardWithIf).parallel(xo);
+        g.compute_at(h, xo);
+        f.compute_at(h, xo);
+
+        const int size = tile * 37 + 5;
+        for (int run = 0; run < 3; run++) {
+            p.set(run);
+            Buffer<int> out = h.realize({size});
+            for (int i = 0; i < size; i++) {
+                int correct = (i * 2 + run + (i + 1) * 2 + run) * 3;
+                if (out(i) != correct) {
+                    printf("out(%d) = %d instead of %d for tiles of %d\n", i, out(i), correct, tile);
+                    return 1;
+                }
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
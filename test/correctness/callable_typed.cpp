@@ -109,6 +109,59 @@ int main(int argc, char **argv) {
         }
     }
 
+    // Check that bind() checks the signature once and calls straight through
+    {
+        Param<float> p_gain;
+        ImageParam p_img(UInt(8), 3);
+
+        Var x("x"), y("y"), c("c");
+        Func f("f");
+
+        f(x, y, c) = cast<float>(p_img(x, y, c)) * p_gain;
+
+        auto bound = f.compile_to_callable({p_img, p_gain}, t)
+                         .bind<Buffer<uint8_t, 3>, float, Buffer<float, 3>>();
+
+        Buffer<uint8_t, 3> in(8, 8, 3);
+        in.fill(10);
+        for (int i = 0; i < 4; i++) {
+            Buffer<float, 3> out(8, 8, 3);
+            // Numeric arguments are converted to the bound types.
+            check(bound(in, i + 1, out));
+            assert(out.all_equal(10.0f * (i + 1)));
+
+            JITUserContext context;
+            check(bound(&context, in, 0.5f, out));
+            assert(out.all_equal(5.0f));
+        }
+    }
+
+    // Check that a batch of calls through a bound Callable works
+    {
+        Param<int> p_offset;
+        Var x("x"), y("y");
+        Func f("f");
+
+        f(x, y) = x + y * 64 + p_offset;
+
+        auto bound = f.compile_to_callable({p_offset}, t)
+                         .bind<int, Buffer<int32_t, 2>>();
+
+        std::vector<std::tuple<int, Buffer<int32_t, 2>>> items;
+        for (int i = 0; i < 100; i++) {
+            items.emplace_back(i * 1000, Buffer<int32_t, 2>(64, 64));
+        }
+        check(bound.call_batch(items));
+        for (int i = 0; i < 100; i++) {
+            const Buffer<int32_t, 2> &out = std::get<1>(items[i]);
+            out.for_each_element([&](int x, int y) {
+                assert(out(x, y) == x + y * 64 + i * 1000);
+            });
+        }
+
+        check(bound.call_batch({}));
+    }
+
     // Override Halide's malloc and free (except under wasm),
     // make sure that Callable freezes the values
     if (t.arch != Target::WebAssembly) {
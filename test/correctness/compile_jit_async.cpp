@@ -0,0 +1,79 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+int check(const Buffer<int> &im, int offset) {
+    for (int y = 0; y < im.height(); y++) {
+        for (int x = 0; x < im.width(); x++) {
+            int correct = 3 * (x + y) + 3 * offset;
+            if (im(x, y) != correct) {
+                printf("im(%d, %d) = %d instead of %d\n", x, y, im(x, y), correct);
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    Param<int> offset;
+    Func f, g;
+    Var x, y;
+    f(x, y) = x + y + offset;
+    g(x, y) = f(x - 1, y) + f(x, y) + f(x + 1, y);
+    f.compute_at(g, y).vectorize(x, 8);
+    g.vectorize(x, 8).parallel(y);
+
+    Pipeline p(g);
+
+    // Realize while the background compile may still be running. These
+    // calls run the unoptimized fallback until the optimized code is done.
+    offset.set(1);
+    std::shared_future<void> done = p.compile_jit_async();
+    for (int i = 0; i < 4; i++) {
+        Buffer<int> im = p.realize({64, 64});
+        if (check(im, 1)) {
+            return 1;
+        }
+    }
+
+    done.wait();
+    offset.set(2);
+    {
+        Buffer<int> im = p.realize({64, 64});
+        if (check(im, 2)) {
+            return 1;
+        }
+    }
+
+    // Asking again for the same target returns an already-ready future.
+    p.compile_jit_async().get();
+
+    // Without a fallback, realize waits for the background compile.
+    p.invalidate_cache();
+    done = p.compile_jit_async(get_jit_target_from_environment(), false);
+    offset.set(3);
+    {
+        Buffer<int> im = p.realize({64, 64});
+        if (check(im, 3)) {
+            return 1;
+        }
+    }
+    done.get();
+
+    // Dropping a compile that is still in flight is safe.
+    p.invalidate_cache();
+    p.compile_jit_async();
+    p.invalidate_cache();
+    offset.set(4);
+    {
+        Buffer<int> im = p.realize({64, 64});
+        if (check(im, 4)) {
+            return 1;
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,60 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+using namespace Halide::Internal;
+
+namespace {
+
+class PassRecorder : public JSONCompilerLogger {
+public:
+    const std::vector<LoweringPassStats> &passes() const {
+        return lowering_passes;
+    }
+};
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    Func f, g;
+    Var x, y;
+    f(x, y) = x + y;
+    g(x, y) = f(x - 1, y) + f(x + 1, y);
+    f.compute_at(g, y);
+    g.vectorize(x, 8);
+
+    set_compiler_logger(std::make_unique<PassRecorder>());
+    g.compile_to_module({}, "g", get_host_target());
+    std::unique_ptr<CompilerLogger> logger = set_compiler_logger(nullptr);
+    const auto &passes = static_cast<PassRecorder *>(logger.get())->passes();
+
+    if (passes.size() < 10) {
+        printf("Only %d lowering passes were recorded\n", (int)passes.size());
+        return 1;
+    }
+
+    // Each pass starts from the IR the previous one left behind.
+    uint64_t last_ir_nodes = 0;
+    for (const auto &p : passes) {
+        if (p.name.empty() || p.duration < 0 || p.ir_nodes_after == 0) {
+            printf("Bad stats for lowering pass \"%s\"\n", p.name.c_str());
+            return 1;
+        }
+        if (p.ir_nodes_before != last_ir_nodes) {
+            printf("Lowering pass \"%s\" started with %d nodes instead of %d\n",
+                   p.name.c_str(), (int)p.ir_nodes_before, (int)last_ir_nodes);
+            return 1;
+        }
+        last_ir_nodes = p.ir_nodes_after;
+    }
+
+    std::ostringstream json;
+    logger->emit_to_stream(json);
+    if (json.str().find("\"lowering_passes\"") == std::string::npos) {
+        printf("lowering_passes missing from JSON output:\n%s\n", json.str().c_str());
+        return 1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
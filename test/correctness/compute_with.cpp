@@ -2287,6 +2287,59 @@ int overlapping_updates_test() {
     return 0;
 }
 
+// Fuse an update over an RDom with a pure stage over a different domain,
+// at a var and at the RVar of the same depth.
+int update_over_rdom_with_pure_test() {
+    const int size = 128;
+
+    for (bool fuse_innermost : {false, true}) {
+        Buffer<int> f_im(size, size), g_im(size, size);
+        Buffer<int> f_im_ref(size, size), g_im_ref(size, size);
+
+        for (bool fused : {false, true}) {
+            Var x("x"), y("y");
+            RDom r(8, 64, 16, 32, "r");
+            Func f("f"), g("g");
+
+            f(x, y) = x + y;
+            g(x, y) = x - y;
+            g(r.x, r.y) += 2 * r.x * r.y;
+
+            f.compute_root();
+            g.compute_root();
+            if (fused) {
+                g.update(0).compute_with(f, fuse_innermost ? x : y);
+            }
+
+            f.bound(x, 0, size).bound(y, 0, size);
+            g.bound(x, 0, size).bound(y, 0, size);
+
+            Pipeline p({f, g});
+            if (fused) {
+                p.realize({f_im, g_im});
+            } else {
+                p.realize({f_im_ref, g_im_ref});
+            }
+        }
+
+        auto f_func = [f_im_ref](int x, int y) {
+            return f_im_ref(x, y);
+        };
+        if (check_image(f_im, f_func)) {
+            return 1;
+        }
+
+        auto g_func = [g_im_ref](int x, int y) {
+            return g_im_ref(x, y);
+        };
+        if (check_image(g_im, g_func)) {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
 }  // namespace
 
 int main(int argc, char **argv) {
@@ -2333,6 +2386,7 @@ int main(int argc, char **argv) {
         {"two compute at test", two_compute_at_test},
         {"overlapping updates test", overlapping_updates_test},
         {"child var dependent bounds test", child_var_dependent_bounds_test},
+        {"update over rdom with pure test", update_over_rdom_with_pure_test},
     };
 
     using Sharder = Halide::Internal::Test::Sharder;
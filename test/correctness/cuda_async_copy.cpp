@@ -0,0 +1,67 @@
+#include "Halide.h"
+
+#include <regex>
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    Target t = get_jit_target_from_environment();
+    if (!t.has_feature(Target::CUDACapability80)) {
+        printf("[SKIP] Cuda (with compute capability 8.0) is not enabled in target: %s\n",
+               t.to_string().c_str());
+        return 0;
+    }
+
+    const int size = 256;
+    Buffer<float> A(size, size), B(size, size);
+    A.for_each_element([&](int x, int y) { A(x, y) = (float)((x + y * 3) % 17); });
+    B.for_each_element([&](int x, int y) { B(x, y) = (float)((x * 5 + y) % 13); });
+
+    // A matrix multiply that stages tiles of its inputs in shared memory,
+    // which should be copied there with cp.async.
+    Func a, b, prod, out;
+    Var x, y, xi, yi;
+    a(x, y) = A(x, y);
+    b(x, y) = B(x, y);
+
+    RDom k(0, size);
+    prod(x, y) += a(k, y) * b(x, k);
+    out(x, y) = prod(x, y);
+
+    RVar ko, ki;
+    out.gpu_tile(x, y, xi, yi, 16, 16);
+    prod.compute_at(out, x).gpu_threads(x, y);
+    prod.update().split(k, ko, ki, 16).reorder(ki, x, y, ko).gpu_threads(x, y);
+    a.compute_at(prod, ko).store_in(MemoryType::GPUShared).gpu_threads(x, y);
+    b.compute_at(prod, ko).store_in(MemoryType::GPUShared).gpu_threads(x, y);
+
+    Buffer<float> result = out.realize({size, size}, t);
+    result.copy_to_host();
+
+    for (int y = 0; y < size; y++) {
+        for (int x = 0; x < size; x++) {
+            float correct = 0;
+            for (int r = 0; r < size; r++) {
+                correct += A(r, y) * B(x, r);
+            }
+            if (result(x, y) != correct) {
+                printf("result(%d, %d) = %f instead of %f\n", x, y, result(x, y), correct);
+                return 1;
+            }
+        }
+    }
+
+    // Check the copies were done with cp.async by grepping the compiled
+    // code (the PTX source is an embedded string).
+    Buffer<uint8_t> buf = out.compile_to_module(std::vector<Argument>(), "out", t).compile_to_buffer();
+    for (const char *pattern : {"cp[.]async[.]ca[.]shared[.]global", "cp[.]async[.]wait_all"}) {
+        std::basic_regex<char> regex(pattern);
+        if (!std::regex_search((const char *)buf.begin(), (const char *)buf.end(), regex)) {
+            printf("Did not find %s in compiled code. Rerun test with HL_DEBUG_CODEGEN=1 to debug\n", pattern);
+            return 1;
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
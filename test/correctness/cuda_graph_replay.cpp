@@ -0,0 +1,115 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    Target target = get_jit_target_from_environment();
+    if (!target.has_feature(Target::CUDA)) {
+        printf("[SKIP] CUDA not enabled.\n");
+        return 0;
+    }
+
+    // Force-initialize the cuda runtime module by running something
+    // trivial, then dig the graph replay API out of it.
+    evaluate_may_gpu<float>(Expr(0.f));
+
+    int (*halide_cuda_set_graph_replay)(void *, bool) = nullptr;
+    int (*halide_cuda_get_graph_replay_stats)(void *, uint64_t *, uint64_t *) = nullptr;
+    for (Internal::JITModule &m : Internal::JITSharedRuntime::get(nullptr, target, false)) {
+        auto set = m.find_symbol_by_name("halide_cuda_set_graph_replay");
+        auto stats = m.find_symbol_by_name("halide_cuda_get_graph_replay_stats");
+        if (set.address && stats.address) {
+            halide_cuda_set_graph_replay = (decltype(halide_cuda_set_graph_replay))set.address;
+            halide_cuda_get_graph_replay_stats = (decltype(halide_cuda_get_graph_replay_stats))stats.address;
+            break;
+        }
+    }
+    if (halide_cuda_set_graph_replay == nullptr) {
+        printf("Failed to find the graph replay API in the Halide cuda runtime\n");
+        return 1;
+    }
+
+    // A chain of small kernels, which is the case graph replay is for.
+    const int stages = 8;
+    Param<int> offset;
+    Var x, y, xi, yi;
+    std::vector<Func> fs(stages);
+    fs[0](x, y) = x + y + offset;
+    for (int i = 1; i < stages; i++) {
+        fs[i](x, y) = fs[i - 1](x, y) * 2 - i;
+    }
+    for (int i = 0; i < stages; i++) {
+        if (i > 0 && i < stages - 1) {
+            fs[i].compute_root();
+        }
+        fs[i].gpu_tile(x, y, xi, yi, 16, 16);
+    }
+    Func out = fs[stages - 1];
+    out.compile_jit(target);
+
+    auto correct = [&](int x, int y, int off) {
+        int v = x + y + off;
+        for (int i = 1; i < stages; i++) {
+            v = v * 2 - i;
+        }
+        return v;
+    };
+
+    auto check = [&](const Buffer<int> &im, int off) {
+        for (int y = 0; y < im.height(); y++) {
+            for (int x = 0; x < im.width(); x++) {
+                if (im(x, y) != correct(x, y, off)) {
+                    printf("im(%d, %d) = %d instead of %d\n", x, y, im(x, y), correct(x, y, off));
+                    return false;
+                }
+            }
+        }
+        return true;
+    };
+
+    if (halide_cuda_set_graph_replay(nullptr, true) != 0) {
+        printf("[SKIP] CUDA driver does not support graphs.\n");
+        return 0;
+    }
+
+    // Keep device allocations cached so that repeated realizations see
+    // the same buffer addresses.
+    halide_reuse_device_allocations(nullptr, true);
+
+    Buffer<int> im(64, 64);
+    for (int i = 0; i < 10; i++) {
+        // Changing a scalar argument changes the launch sequence; only
+        // repeats of an earlier value can be replayed.
+        int off = i % 2;
+        offset.set(off);
+        out.realize(im);
+        im.copy_to_host();
+        if (!check(im, off)) {
+            return 1;
+        }
+    }
+
+    uint64_t captures = 0, replays = 0;
+    halide_cuda_get_graph_replay_stats(nullptr, &captures, &replays);
+    if (captures == 0 || replays == 0) {
+        printf("Expected captured and replayed graphs: %d captures, %d replays\n",
+               (int)captures, (int)replays);
+        return 1;
+    }
+
+    // Turning replay off flushes anything queued; results must still
+    // be correct afterwards.
+    halide_cuda_set_graph_replay(nullptr, false);
+    offset.set(5);
+    out.realize(im);
+    im.copy_to_host();
+    if (!check(im, 5)) {
+        return 1;
+    }
+
+    halide_reuse_device_allocations(nullptr, false);
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,95 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    Target target = get_jit_target_from_environment();
+    if (!target.has_feature(Target::CUDA)) {
+        printf("[SKIP] CUDA not enabled.\n");
+        return 0;
+    }
+
+    // Force-initialize the cuda runtime module by running something
+    // trivial, then dig the memory pool API out of it.
+    evaluate_may_gpu<float>(Expr(0.f));
+
+    int (*set_stream_ordered_allocation)(void *, bool) = nullptr;
+    int (*trim_device_memory_pool)(void *, size_t) = nullptr;
+    int (*get_device_memory_pool_stats)(void *, uint64_t *, uint64_t *, uint64_t *, uint64_t *) = nullptr;
+    for (Internal::JITModule &m : Internal::JITSharedRuntime::get(nullptr, target, false)) {
+        auto set = m.find_symbol_by_name("halide_cuda_set_stream_ordered_allocation");
+        auto trim = m.find_symbol_by_name("halide_cuda_trim_device_memory_pool");
+        auto stats = m.find_symbol_by_name("halide_cuda_get_device_memory_pool_stats");
+        if (set.address && trim.address && stats.address) {
+            set_stream_ordered_allocation = (decltype(set_stream_ordered_allocation))set.address;
+            trim_device_memory_pool = (decltype(trim_device_memory_pool))trim.address;
+            get_device_memory_pool_stats = (decltype(get_device_memory_pool_stats))stats.address;
+            break;
+        }
+    }
+    if (set_stream_ordered_allocation == nullptr) {
+        printf("Failed to find the memory pool API in the Halide cuda runtime\n");
+        return 1;
+    }
+
+    // Allocated before the pool is in use, so that we can sync the
+    // stream without holding any pool memory.
+    Buffer<int> sync_buf(1);
+    sync_buf.device_malloc(get_device_interface_for_device_api(DeviceAPI::CUDA));
+
+    if (set_stream_ordered_allocation(nullptr, true) != 0) {
+        printf("[SKIP] CUDA driver does not support memory pools.\n");
+        return 0;
+    }
+
+    // Two GPU intermediates per realization, freed at the end of each.
+    Func f, g, h;
+    Var x, y, xi, yi;
+    f(x, y) = x + y;
+    g(x, y) = f(x, y) * 2;
+    h(x, y) = g(x, y) + 1;
+    f.compute_root().gpu_tile(x, y, xi, yi, 16, 16);
+    g.compute_root().gpu_tile(x, y, xi, yi, 16, 16);
+    h.gpu_tile(x, y, xi, yi, 16, 16);
+
+    const int w = 512, hh = 512;
+    for (int i = 0; i < 5; i++) {
+        Buffer<int> out = h.realize({w, hh});
+        out.copy_to_host();
+        for (int y = 0; y < hh; y++) {
+            for (int x = 0; x < w; x++) {
+                int correct = (x + y) * 2 + 1;
+                if (out(x, y) != correct) {
+                    printf("out(%d, %d) = %d instead of %d\n", x, y, out(x, y), correct);
+                    return 1;
+                }
+            }
+        }
+    }
+
+    uint64_t reserved, reserved_high, used, used_high;
+    get_device_memory_pool_stats(nullptr, &reserved, &reserved_high, &used, &used_high);
+    const uint64_t buffer_bytes = (uint64_t)w * hh * sizeof(int);
+    if (used_high < buffer_bytes || reserved_high < used_high) {
+        printf("Unexpected high-water marks: reserved %llu, used %llu\n",
+               (unsigned long long)reserved_high, (unsigned long long)used_high);
+        return 1;
+    }
+
+    // Everything has been freed once the stream catches up, so trimming
+    // should hand it all back.
+    sync_buf.device_sync();
+    trim_device_memory_pool(nullptr, 0);
+    get_device_memory_pool_stats(nullptr, &reserved, &reserved_high, &used, &used_high);
+    if (used != 0 || reserved != 0) {
+        printf("Pool still holds %llu bytes (%llu in use) after trimming\n",
+               (unsigned long long)reserved, (unsigned long long)used);
+        return 1;
+    }
+
+    set_stream_ordered_allocation(nullptr, false);
+
+    printf("Success!\n");
+    return 0;
+}
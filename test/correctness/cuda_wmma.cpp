@@ -0,0 +1,99 @@
+#include "Halide.h"
+
+#include <regex>
+
+using namespace Halide;
+
+// A matrix multiply of In tiles accumulated in Acc, computed with tensor
+// cores.
+template<typename Acc, typename In>
+bool test(const Target &t) {
+    const int size = 128;
+    Buffer<In> A(size, size), B(size, size);
+    A.for_each_element([&](int x, int y) { A(x, y) = (In)((x + y * 3) % 7); });
+    B.for_each_element([&](int x, int y) { B(x, y) = (In)((x * 5 + y) % 5); });
+
+    Var x("x"), y("y");
+    RDom r(0, size);
+    Func mm("mm"), out("out");
+    mm(x, y) = cast<Acc>(0);
+    mm(x, y) += cast<Acc>(A(r, y)) * cast<Acc>(B(x, r));
+    out(x, y) = mm(x, y);
+
+    Var xo("xo"), yo("yo"), xi("xi"), yi("yi");
+    RVar ro("ro"), ri("ri");
+    out.tile(x, y, xo, yo, xi, yi, 16, 16, TailStrategy::RoundUp)
+        .gpu_blocks(xo, yo)
+        .vectorize(xi)
+        .vectorize(yi);
+    mm.compute_at(out, xo)
+        .store_in(MemoryType::WMMAAccumulator)
+        .tile(x, y, xi, yi, 16, 16)
+        .vectorize(xi)
+        .vectorize(yi);
+    mm.update()
+        .tile(x, y, xi, yi, 16, 16)
+        .split(r, ro, ri, 16)
+        .reorder(ri, xi, yi, ro, x, y)
+        .atomic()
+        .vectorize(ri)
+        .vectorize(xi)
+        .vectorize(yi);
+
+    Buffer<Acc> result = out.realize({size, size}, t);
+    result.copy_to_host();
+
+    for (int y = 0; y < size; y++) {
+        for (int x = 0; x < size; x++) {
+            // The products and sums are small integers, so they're exact.
+            Acc correct = 0;
+            for (int k = 0; k < size; k++) {
+                correct += (Acc)A(k, y) * (Acc)B(x, k);
+            }
+            if (result(x, y) != correct) {
+                printf("result(%d, %d) = %f instead of %f\n",
+                       x, y, (double)result(x, y), (double)correct);
+                return false;
+            }
+        }
+    }
+
+    // Check tensor cores were used by grepping the compiled code (the
+    // PTX source is an embedded string).
+    Buffer<uint8_t> buf = out.compile_to_module(std::vector<Argument>(), "out", t).compile_to_buffer();
+    for (const char *pattern : {"wmma[.]load[.]a", "wmma[.]load[.]b", "wmma[.]mma", "wmma[.]store[.]d"}) {
+        std::basic_regex<char> regex(pattern);
+        if (!std::regex_search((const char *)buf.begin(), (const char *)buf.end(), regex)) {
+            printf("Did not find %s in compiled code. Rerun test with HL_DEBUG_CODEGEN=1 to debug\n", pattern);
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char **argv) {
+    Target t = get_jit_target_from_environment();
+    if (t.get_cuda_capability_lower_bound() < 70) {
+        printf("[SKIP] Cuda (with compute capability 7.0) is not enabled in target: %s\n",
+               t.to_string().c_str());
+        return 0;
+    }
+
+    if (!test<float, float16_t>(t)) {
+        return 1;
+    }
+    if (t.get_cuda_capability_lower_bound() >= 75) {
+        if (!test<int32_t, int8_t>(t) ||
+            !test<int32_t, uint8_t>(t)) {
+            return 1;
+        }
+    }
+    if (t.get_cuda_capability_lower_bound() >= 80) {
+        if (!test<float, bfloat16_t>(t)) {
+            return 1;
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -2,6 +2,13 @@
 
 using namespace Halide;
 
+std::string report;
+
+void capture_print(JITUserContext *, const char *msg) {
+    printf("%s", msg);
+    report += msg;
+}
+
 int run_test(Target t) {
     // Sliding window with the producer on the GPU and the consumer on
     // the CPU. This requires a copy inside the loop over which we are
@@ -26,7 +33,10 @@ int run_test(Target t) {
     f2.compute_root();
 
     // Make the buffer a little bigger so we actually can see the copy time.
-    Buffer<int> out = f2.realize({2000, 2000}, t);
+    Pipeline p(f2);
+    p.jit_handlers().custom_print = capture_print;
+    report.clear();
+    Buffer<int> out = p.realize({2000, 2000}, t);
     // Let's only verify a part of it...
     for (int y = 0; y < 100; y++) {
         for (int x = 0; x < 100; x++) {
@@ -38,6 +48,17 @@ int run_test(Target t) {
             }
         }
     }
+
+    // With CUDA, the time the kernel took on the device is reported.
+    if (t.has_feature(Target::CUDA) &&
+        (t.has_feature(Target::Profile) || t.has_feature(Target::ProfileByTimer))) {
+        size_t line = report.find("f1_on_gpu");
+        if (line == std::string::npos ||
+            report.find(" gpu: ", line) > report.find("\n", line)) {
+            printf("Expected the device time of f1_on_gpu in the report\n");
+            return 1;
+        }
+    }
     return 0;
 }
 
@@ -0,0 +1,94 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+using namespace Halide::Internal;
+
+// Count the copies between host and device that are wrapped in an
+// inline check of the dirty bits.
+class CountGuardedCopies : public IRMutator {
+    using IRMutator::visit;
+
+    Stmt visit(const IfThenElse *op) override {
+        const LetStmt *let = op->then_case.as<LetStmt>();
+        const Call *call = let ? let->value.as<Call>() : nullptr;
+        if (call && (call->name == "halide_copy_to_device" ||
+                     call->name == "halide_copy_to_host")) {
+            guarded++;
+        }
+        return IRMutator::visit(op);
+    }
+
+public:
+    int &guarded;
+
+    CountGuardedCopies(int &guarded)
+        : guarded(guarded) {
+    }
+};
+
+Pipeline make_stage(ImageParam in, int k, int &guarded) {
+    Func f;
+    Var x, y, xi, yi;
+    f(x, y) = in(x, y) * 2 + k;
+    f.gpu_tile(x, y, xi, yi, 8, 8);
+    f.add_custom_lowering_pass(new CountGuardedCopies(guarded));
+    return Pipeline(f);
+}
+
+int main(int argc, char **argv) {
+    Target target = get_jit_target_from_environment();
+    if (!target.has_gpu_feature()) {
+        printf("[SKIP] No GPU target enabled.\n");
+        return 0;
+    }
+
+    for (bool resident : {false, true}) {
+        Target t = resident ? target.with_feature(Target::DeviceResident) : target;
+
+        ImageParam in1(Int(32), 2), in2(Int(32), 2);
+        int guarded = 0;
+        Pipeline p1 = make_stage(in1, 1, guarded);
+        Pipeline p2 = make_stage(in2, 3, guarded);
+        p1.compile_jit(t);
+        p2.compile_jit(t);
+
+        if (resident ? (guarded == 0) : (guarded != 0)) {
+            printf("Found %d inline-checked copies with device_resident %s\n",
+                   guarded, resident ? "on" : "off");
+            return 1;
+        }
+
+        Buffer<int> input(64, 64);
+        input.for_each_element([&](int x, int y) { input(x, y) = x + y * 64; });
+        Buffer<int> mid(64, 64), out(64, 64);
+
+        // Run the chain a few times, with the intermediate staying on
+        // the device between the stages.
+        for (int i = 0; i < 3; i++) {
+            in1.set(input);
+            p1.realize(mid, t);
+            in2.set(mid);
+            p2.realize(out, t);
+        }
+
+        if (mid.raw_buffer()->host_dirty()) {
+            printf("The intermediate was marked dirty on the host\n");
+            return 1;
+        }
+
+        out.copy_to_host();
+        for (int y = 0; y < 64; y++) {
+            for (int x = 0; x < 64; x++) {
+                int correct = (input(x, y) * 2 + 1) * 2 + 3;
+                if (out(x, y) != correct) {
+                    printf("out(%d, %d) = %d instead of %d\n", x, y, out(x, y), correct);
+                    return 1;
+                }
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,82 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+int mallocs = 0;
+
+void *my_malloc(JITUserContext *user_context, size_t x) {
+    mallocs++;
+    void *orig = malloc(x + 128);
+    void *ptr = (void *)((((size_t)orig + 128) >> 7) << 7);
+    ((void **)ptr)[-1] = orig;
+    return ptr;
+}
+
+void my_free(JITUserContext *user_context, void *ptr) {
+    free(((void **)ptr)[-1]);
+}
+
+// Realize a consumer of a producer computed per row, whose size depends
+// on a Param, and return the number of times it called halide_malloc.
+int run(int radius_bound, MemoryType memory_type) {
+    Func f("f"), g("g");
+    Var x("x"), y("y");
+    Param<int> radius;
+
+    Expr r = radius_bound > 0 ? clamp(radius, 0, radius_bound) : radius;
+    f(x, y) = x * 3 + y;
+    g(x, y) = f(x, y) + f(x + r, y) + f(x + 2 * r, y);
+
+    f.compute_at(g, y).store_in(memory_type);
+    g.bound(x, 0, 16);
+
+    g.jit_handlers().custom_malloc = my_malloc;
+    g.jit_handlers().custom_free = my_free;
+
+    mallocs = 0;
+    radius.set(100);
+    Buffer<int> out = g.realize({16, 32});
+    for (int y = 0; y < 32; y++) {
+        for (int x = 0; x < 16; x++) {
+            int correct = (x * 3 + y) + ((x + 100) * 3 + y) + ((x + 200) * 3 + y);
+            if (out(x, y) != correct) {
+                printf("out(%d, %d) = %d instead of %d\n", x, y, out(x, y), correct);
+                exit(1);
+            }
+        }
+    }
+    return mallocs;
+}
+
+int main(int argc, char **argv) {
+    if (get_jit_target_from_environment().has_gpu_feature()) {
+        printf("[SKIP] This test counts host allocations.\n");
+        return 0;
+    }
+
+    // f's extent depends on the Param, but is at most 16 + 2 * 500
+    // ints, which fits on the stack.
+    int bounded = run(500, MemoryType::Auto);
+    if (bounded != 0) {
+        printf("A bounded allocation of dynamic size called halide_malloc %d times\n", bounded);
+        return 1;
+    }
+
+    // Without the bound, it has to go on the heap.
+    int unbounded = run(0, MemoryType::Auto);
+    if (unbounded == 0) {
+        printf("An unbounded allocation didn't call halide_malloc\n");
+        return 1;
+    }
+
+    // An explicit memory type is respected.
+    int heap = run(500, MemoryType::Heap);
+    if (heap == 0) {
+        printf("An allocation placed on the heap didn't call halide_malloc\n");
+        return 1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
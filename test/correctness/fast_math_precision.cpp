@@ -0,0 +1,136 @@
+#include "Halide.h"
+
+#include <cmath>
+
+using namespace Halide;
+
+namespace {
+
+// The error of a float result in units in the last place of the exact
+// result.
+double ulp_error(float actual, double exact) {
+    int e;
+    std::frexp(exact, &e);
+    double ulp = std::ldexp(1.0, std::max(e - 24, -149));
+    return std::abs(actual - exact) / ulp;
+}
+
+struct Case {
+    const char *name;
+    Expr (*fast)(const Expr &, ApproximationPrecision);
+    double (*ref)(double);
+    // The range over which to check absolute and ULP errors.
+    float abs_min, abs_max, ulp_min, ulp_max;
+};
+
+// Check that the approximation chosen for precision meets the bounds of
+// expected.
+int check(const Case &c, ApproximationPrecision precision, ApproximationPrecision expected) {
+    const int n = 100000;
+    Func f;
+    Var i;
+    Expr t = i / float(n - 1);
+    Expr abs_x = c.abs_min * (1 - t) + c.abs_max * t;
+    Expr ulp_x = c.ulp_min * (1 - t) + c.ulp_max * t;
+    f(i) = Tuple(abs_x, c.fast(abs_x, precision), ulp_x, c.fast(ulp_x, precision));
+    f.vectorize(i, 8);
+    Realization r = f.realize({n});
+    Buffer<float> abs_in = r[0], abs_out = r[1], ulp_in = r[2], ulp_out = r[3];
+
+    double max_abs = 0, max_ulp = 0;
+    for (int j = 0; j < n; j++) {
+        max_abs = std::max(max_abs, std::abs(abs_out(j) - c.ref(abs_in(j))));
+        max_ulp = std::max(max_ulp, ulp_error(ulp_out(j), c.ref(ulp_in(j))));
+    }
+
+    if (expected.max_absolute_error > 0 && max_abs > expected.max_absolute_error) {
+        printf("%s with absolute error bound %g has absolute error %g\n",
+               c.name, expected.max_absolute_error, max_abs);
+        return 1;
+    }
+    if (expected.max_ulp_error > 0 && max_ulp > expected.max_ulp_error) {
+        printf("%s with ULP error bound %d has ULP error %g\n",
+               c.name, expected.max_ulp_error, max_ulp);
+        return 1;
+    }
+    return 0;
+}
+
+int check(const Case &c, ApproximationPrecision precision) {
+    return check(c, precision, precision);
+}
+
+Expr fast_sin_f(const Expr &x, ApproximationPrecision p) {
+    return fast_sin(x, p);
+}
+Expr fast_cos_f(const Expr &x, ApproximationPrecision p) {
+    return fast_cos(x, p);
+}
+Expr fast_exp_f(const Expr &x, ApproximationPrecision p) {
+    return fast_exp(x, p);
+}
+Expr fast_log_f(const Expr &x, ApproximationPrecision p) {
+    return fast_log(x, p);
+}
+
+double sin_d(double x) {
+    return std::sin(x);
+}
+double cos_d(double x) {
+    return std::cos(x);
+}
+double exp_d(double x) {
+    return std::exp(x);
+}
+double log_d(double x) {
+    return std::log(x);
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    const Case cases[] = {
+        {"fast_sin", fast_sin_f, sin_d, -100.0f, 100.0f, -0.785f, 0.785f},
+        {"fast_cos", fast_cos_f, cos_d, -100.0f, 100.0f, -0.785f, 0.785f},
+        {"fast_exp", fast_exp_f, exp_d, -80.0f, 0.0f, -80.0f, 88.0f},
+        {"fast_log", fast_log_f, log_d, 0.37f, 2.7f, 0.01f, 100.0f},
+    };
+
+    for (const Case &c : cases) {
+        for (double bound : {1e-3, 1e-4, 1e-5, 1e-6, 2e-7}) {
+            if (check(c, ApproximationPrecision::absolute(bound))) {
+                return 1;
+            }
+        }
+        for (int bound : {1000, 100, 10, 3, 2}) {
+            if (check(c, ApproximationPrecision::ulp(bound))) {
+                return 1;
+            }
+        }
+    }
+
+    // Both bounds at once, and bounds no approximation meets, which
+    // give the most accurate one.
+    for (const Case &c : cases) {
+        ApproximationPrecision both;
+        both.max_ulp_error = 2;
+        both.max_absolute_error = 2e-7;
+        if (check(c, both) ||
+            check(c, ApproximationPrecision::ulp(1), both)) {
+            return 1;
+        }
+    }
+
+    // fast_log's special cases.
+    Func special;
+    Var x;
+    special(x) = fast_log(select(x == 0, -1.0f, 0.0f), ApproximationPrecision::ulp(2));
+    Buffer<float> s = special.realize({2});
+    if (!std::isnan(s(0)) || !(std::isinf(s(1)) && s(1) < 0)) {
+        printf("fast_log(-1) = %f and fast_log(0) = %f\n", s(0), s(1));
+        return 1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,124 @@
+#include "Halide.h"
+
+using namespace Halide;
+
+class CountFloat16Arithmetic : public Internal::IRMutator {
+public:
+    int f16_muls = 0, f32_adds = 0;
+
+private:
+    using Internal::IRMutator::visit;
+
+    Expr visit(const Internal::Mul *op) override {
+        if (op->type.element_of() == Float(16)) {
+            f16_muls++;
+        }
+        return Internal::IRMutator::visit(op);
+    }
+
+    Expr visit(const Internal::Add *op) override {
+        if (op->type.element_of() == Float(32)) {
+            f32_adds++;
+        }
+        return Internal::IRMutator::visit(op);
+    }
+};
+
+CountFloat16Arithmetic count_arithmetic(Func f, const std::vector<Argument> &args, const Target &t) {
+    CountFloat16Arithmetic counter;
+    f.add_custom_lowering_pass(&counter, []() {});
+    f.compile_to_module(args, "", t);
+    f.clear_custom_lowering_passes();
+    return counter;
+}
+
+int main(int argc, char **argv) {
+    ImageParam a(Float(16), 1, "a"), b(Float(16), 1, "b");
+    Var x("x");
+    RDom r(0, 16);
+
+    const Target arm("arm-64-linux-arm_fp16");
+    const Target arm_f16_compute = arm.with_feature(Target::Float16Compute);
+
+    // A float16 result computed from float16 inputs via float32 math.
+    {
+        Func f("f");
+        f(x) = cast<float16_t>(cast<float>(a(x)) * cast<float>(b(x)) + 1.0f);
+
+        // Not enabled, so the math stays in float32.
+        auto counts = count_arithmetic(f, {a, b}, arm);
+        if (counts.f16_muls != 0) {
+            printf("Float16 math without Target::Float16Compute\n");
+            return 1;
+        }
+
+        counts = count_arithmetic(f, {a, b}, arm_f16_compute);
+        if (counts.f16_muls != 1 || counts.f32_adds != 0) {
+            printf("Expected float16 math with Target::Float16Compute: %d float16 muls, %d float32 adds\n",
+                   counts.f16_muls, counts.f32_adds);
+            return 1;
+        }
+
+        // No native float16 arithmetic
+        counts = count_arithmetic(f, {a, b}, Target("x86-64-linux-avx2").with_feature(Target::Float16Compute));
+        if (counts.f16_muls != 0) {
+            printf("Float16 math on a target without native float16\n");
+            return 1;
+        }
+    }
+
+    // A dot product. The products can be computed in float16, but the
+    // accumulation must remain in float32.
+    {
+        Func f("f");
+        f() = 0.0f;
+        f() += float16_compute(cast<float>(a(r)) * cast<float>(b(r)), 1.0f / 1024);
+
+        auto counts = count_arithmetic(f, {a, b}, arm);
+        if (counts.f16_muls != 1 || counts.f32_adds != 1) {
+            printf("Expected float16 products and a float32 sum: %d float16 muls, %d float32 adds\n",
+                   counts.f16_muls, counts.f32_adds);
+            return 1;
+        }
+
+        // A tolerance tighter than a single rounding disables it.
+        Func g("g");
+        g() = 0.0f;
+        g() += float16_compute(cast<float>(a(r)) * cast<float>(b(r)), 1e-5f);
+        counts = count_arithmetic(g, {a, b}, arm_f16_compute);
+        if (counts.f16_muls != 0) {
+            printf("Float16 math despite a tight tolerance\n");
+            return 1;
+        }
+    }
+
+    // Check the results are still correct on the host, whether or not
+    // it has native float16.
+    {
+        Buffer<float16_t> a_buf(16), b_buf(16);
+        for (int i = 0; i < 16; i++) {
+            a_buf(i) = float16_t(i * 0.25f);
+            b_buf(i) = float16_t(1.0f - i * 0.125f);
+        }
+        a.set(a_buf);
+        b.set(b_buf);
+
+        Func f("f");
+        f() = 0.0f;
+        f() += float16_compute(cast<float>(a(r)) * cast<float>(b(r)), 1.0f / 1024);
+        Buffer<float> result = f.realize();
+
+        float correct = 0.0f;
+        for (int i = 0; i < 16; i++) {
+            correct += (float)a_buf(i) * (float)b_buf(i);
+        }
+        // 16 products, each within a float16 rounding.
+        if (std::abs(result() - correct) > 16 * 0.5f / 1024) {
+            printf("result = %f instead of %f\n", result(), correct);
+            return 1;
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
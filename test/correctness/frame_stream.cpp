@@ -0,0 +1,95 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+// Counts the points of the lookup table that get computed.
+int lut_evaluations = 0;
+extern "C" HALIDE_EXPORT_SYMBOL float count_lut(float x) {
+    lut_evaluations++;
+    return x;
+}
+HalideExtern_1(float, count_lut, float);
+
+int main(int argc, char **argv) {
+    ImageParam frame(UInt(8), 2, "frame"), prev(UInt(8), 2, "prev"), prev2(UInt(8), 2, "prev2");
+    Param<float> gain("gain");
+    Var x("x"), y("y"), i("i");
+
+    // A lookup table that only depends on a Param that doesn't change
+    // from frame to frame.
+    Func lut("lut");
+    lut(i) = count_lut(cast<float>(i) * gain);
+    lut.compute_root();
+
+    // An intermediate that changes every frame.
+    Func motion("motion");
+    motion(x, y) = cast<float>(prev(x, y)) - prev2(x, y);
+    motion.compute_root();
+
+    Func out("out");
+    out(x, y) = lut(frame(x, y)) + motion(x, y);
+
+    const int w = 32, h = 16, num_frames = 5;
+    FrameStream stream(Pipeline(out), {frame}, {{frame, {prev, prev2}}});
+
+    gain.set(2.0f);
+    std::vector<Buffer<uint8_t>> frames;
+    Buffer<uint8_t> in(w, h);
+    for (int f = 0; f < num_frames; f++) {
+        // Reuse the same input buffer for each frame, as a decoder
+        // would.
+        in.for_each_element([&](int x, int y) { in(x, y) = (uint8_t)(x + y * 3 + f * 7); });
+        frames.push_back(in.copy());
+        frame.set(in);
+        Buffer<float> result = stream.realize({w, h});
+
+        const Buffer<uint8_t> &p1 = frames[std::max(f - 1, 0)];
+        const Buffer<uint8_t> &p2 = frames[std::max(f - 2, 0)];
+        for (int yy = 0; yy < h; yy++) {
+            for (int xx = 0; xx < w; xx++) {
+                float correct = in(xx, yy) * 2.0f + p1(xx, yy) - p2(xx, yy);
+                if (result(xx, yy) != correct) {
+                    printf("Frame %d: result(%d, %d) = %f instead of %f\n",
+                           f, xx, yy, result(xx, yy), correct);
+                    return 1;
+                }
+            }
+        }
+    }
+
+    if (stream.frames() != num_frames) {
+        printf("Ran %d frames instead of %d\n", stream.frames(), num_frames);
+        return 1;
+    }
+
+    // The lookup table was computed for the first frame and reused.
+    if (lut_evaluations != 256) {
+        printf("Computed %d points of the lookup table instead of 256\n", lut_evaluations);
+        return 1;
+    }
+
+    // The memory of the intermediate is back in the stream's cache,
+    // ready for the next frame.
+    if (stream.cached_bytes() == 0) {
+        printf("No memory was cached across frames\n");
+        return 1;
+    }
+
+    // Changing a Param the lookup table depends on recomputes it.
+    gain.set(3.0f);
+    stream.realize({w, h});
+    if (lut_evaluations != 512) {
+        printf("Computed %d points of the lookup table instead of 512\n", lut_evaluations);
+        return 1;
+    }
+
+    stream.reset();
+    if (stream.frames() != 0 || stream.cached_bytes() != 0) {
+        printf("reset() didn't forget the past\n");
+        return 1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,80 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+using namespace Halide::Internal;
+
+class CountLoops : public IRMutator {
+    using IRMutator::visit;
+
+    Stmt visit(const For *op) override {
+        count++;
+        return IRMutator::visit(op);
+    }
+
+public:
+    int count = 0;
+};
+
+int main(int argc, char **argv) {
+    const int width = 64, height = 48;
+    Buffer<int> input(width, height);
+    input.for_each_element([&](int x, int y) {
+        input(x, y) = (x * 17 + y * 31) % 101 - 50;
+    });
+
+    int correct_sum = 0, correct_sum_sq = 0, correct_min = 1000, correct_max = -1000;
+    input.for_each_value([&](int v) {
+        correct_sum += v;
+        correct_sum_sq += v * v;
+        correct_min = std::min(correct_min, v);
+        correct_max = std::max(correct_max, v);
+    });
+
+    // Each statistic is its own reduction, over its own RDom of the
+    // same bounds.
+    RDom r1(input), r2(input), r3(input), r4(input);
+    Func sum("sum"), sum_sq("sum_sq"), mn("mn"), mx("mx");
+    sum() = 0;
+    sum() += input(r1.x, r1.y);
+    sum_sq() = 0;
+    sum_sq() += input(r2.x, r2.y) * input(r2.x, r2.y);
+    mn() = 1000;
+    mn() = min(mn(), input(r3.x, r3.y));
+    mx() = -1000;
+    mx() = max(mx(), input(r4.x, r4.y));
+
+    sum.compute_root();
+    sum_sq.compute_root();
+    mn.compute_root();
+    mx.compute_root();
+    sum.fuse_reductions({sum_sq, mn, mx});
+
+    Pipeline p({sum, sum_sq, mn, mx});
+    CountLoops *counter = new CountLoops;
+    p.add_custom_lowering_pass(counter);
+
+    Buffer<int> sum_buf = Buffer<int>::make_scalar();
+    Buffer<int> sum_sq_buf = Buffer<int>::make_scalar();
+    Buffer<int> min_buf = Buffer<int>::make_scalar();
+    Buffer<int> max_buf = Buffer<int>::make_scalar();
+    p.realize({sum_buf, sum_sq_buf, min_buf, max_buf});
+
+    // The four reductions should share one loop over y and one over x.
+    if (counter->count != 2) {
+        printf("Expected 2 loops, got %d\n", counter->count);
+        return 1;
+    }
+
+    if (sum_buf() != correct_sum || sum_sq_buf() != correct_sum_sq ||
+        min_buf() != correct_min || max_buf() != correct_max) {
+        printf("Got sum %d, sum of squares %d, min %d, max %d "
+               "instead of %d, %d, %d, %d\n",
+               sum_buf(), sum_sq_buf(), min_buf(), max_buf(),
+               correct_sum, correct_sum_sq, correct_min, correct_max);
+        return 1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,99 @@
+#include "Halide.h"
+#include "halide_test_dirs.h"
+
+#include <cstdio>
+
+using namespace Halide;
+
+namespace {
+
+class BuildCacheTest : public Generator<BuildCacheTest> {
+public:
+    GeneratorParam<int> offset{"offset", 1};
+
+    Input<Buffer<int, 1>> input{"input"};
+    Output<Buffer<int, 1>> output{"output"};
+
+    void generate() {
+        Var x;
+        output(x) = input(x) + offset;
+    }
+};
+
+}  // namespace
+
+HALIDE_REGISTER_GENERATOR(BuildCacheTest, build_cache_test)
+
+const std::string base_name = "halide_test_correctness_generator_build_cache";
+
+void run_generator(const std::string &offset, bool use_build_cache) {
+    Internal::ExecuteGeneratorArgs args;
+    args.output_dir = Internal::get_test_tmp_dir();
+    args.output_types = {OutputFileType::c_header, OutputFileType::object};
+    args.targets = {get_target_from_environment()};
+    args.generator_name = "build_cache_test";
+    args.file_base_name = base_name;
+    args.generator_params = {{"offset", offset}};
+    args.use_build_cache = use_build_cache;
+    Internal::execute_generator(args);
+}
+
+const std::string marker = "// Not written by the generator\n";
+
+// Add a marker to the header, so we can tell whether it was rewritten.
+void mark(const std::string &path) {
+    std::vector<char> contents = Internal::read_entire_file(path);
+    contents.insert(contents.end(), marker.begin(), marker.end());
+    Internal::write_entire_file(path, contents);
+}
+
+bool is_marked(const std::string &path) {
+    std::vector<char> contents = Internal::read_entire_file(path);
+    return std::string(contents.begin(), contents.end()).find(marker) != std::string::npos;
+}
+
+int main(int argc, char **argv) {
+    const std::string prefix = Internal::get_test_tmp_dir() + base_name;
+    const std::string header = prefix + ".h";
+    const std::string object = prefix + (get_host_target().os == Target::Windows ? ".obj" : ".o");
+    const std::string cache = prefix + ".generator_cache";
+    for (const auto &f : {header, object, cache}) {
+        Internal::ensure_no_file_exists(f);
+    }
+
+    run_generator("1", true);
+    for (const auto &f : {header, object, cache}) {
+        Internal::assert_file_exists(f);
+    }
+
+    // Running again with the same params shouldn't touch the outputs.
+    mark(header);
+    run_generator("1", true);
+    if (!is_marked(header)) {
+        printf("Outputs were regenerated, but nothing changed\n");
+        return 1;
+    }
+
+    // Changing a param changes the pipeline, so the outputs are regenerated.
+    run_generator("2", true);
+    if (is_marked(header)) {
+        printf("Outputs weren't regenerated after the pipeline changed\n");
+        return 1;
+    }
+
+    // A missing output is regenerated, even if nothing else changed.
+    Internal::file_unlink(object);
+    run_generator("2", true);
+    Internal::assert_file_exists(object);
+
+    // Without the cache, the outputs are always regenerated.
+    mark(header);
+    run_generator("2", false);
+    if (is_marked(header)) {
+        printf("Outputs weren't regenerated without the cache\n");
+        return 1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
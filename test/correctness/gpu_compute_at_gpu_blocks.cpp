@@ -0,0 +1,52 @@
+#include "Halide.h"
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    Target t = get_jit_target_from_environment();
+    if (!t.has_gpu_feature()) {
+        printf("[SKIP] No GPU target enabled.\n");
+        return 0;
+    }
+
+    // A chain of stencils, each of which would otherwise be a
+    // compute_root stage with its own kernel.
+    Func input("input"), blur_x("blur_x"), blur_y("blur_y"), out("out");
+    Var x("x"), y("y"), xi("xi"), yi("yi");
+
+    input(x, y) = x * 3 + y * 5;
+    blur_x(x, y) = input(x - 1, y) + input(x, y) + input(x + 1, y);
+    blur_y(x, y) = blur_x(x, y - 1) + blur_x(x, y) + blur_x(x, y + 1);
+    out(x, y) = blur_y(x, y) * 2;
+    // An update, to check that it gets threads of its own.
+    out(x, y) += 1;
+
+    out.gpu_tile(x, y, xi, yi, 16, 16);
+    out.update().gpu_tile(x, y, xi, yi, 16, 16);
+    input.compute_root();
+    blur_y.compute_at_gpu_blocks(out);
+    blur_x.compute_at_gpu_blocks(out);
+
+    Buffer<int> result = out.realize({64, 64});
+    result.copy_to_host();
+
+    for (int y = 0; y < result.height(); y++) {
+        for (int x = 0; x < result.width(); x++) {
+            int correct = 0;
+            for (int dy = -1; dy <= 1; dy++) {
+                for (int dx = -1; dx <= 1; dx++) {
+                    correct += (x + dx) * 3 + (y + dy) * 5;
+                }
+            }
+            correct = correct * 2 + 1;
+            if (result(x, y) != correct) {
+                printf("result(%d, %d) = %d instead of %d\n",
+                       x, y, result(x, y), correct);
+                return 1;
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,53 @@
+#include "Halide.h"
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    Target t = get_jit_target_from_environment();
+    if (!t.has_gpu_feature()) {
+        printf("[SKIP] No GPU target enabled.\n");
+        return 0;
+    }
+
+    // Most test machines have one GPU, so distribute across just the
+    // one device. This still selects the device and initializes the
+    // kernels in every iteration of the loop over strips.
+    const int num_devices = 1;
+
+    // A stencil over strips, with a compute_root producer that each
+    // strip reads the halo of, and a producer computed per strip.
+    Func input("input"), blur_x("blur_x"), out("out");
+    Var x("x"), y("y"), yo("yo"), ys("ys"), xo("xo"), xi("xi"), yt("yt"), yi("yi");
+
+    input(x, y) = x * 3 + y * 5;
+    blur_x(x, y) = input(x - 1, y) + input(x, y) + input(x + 1, y);
+    out(x, y) = blur_x(x, y - 1) + blur_x(x, y) + blur_x(x, y + 1);
+
+    input.compute_root().gpu_tile(x, y, xo, yo, xi, yi, 16, 16);
+    out.split(y, yo, ys, 32)
+        .distribute(yo, num_devices)
+        .gpu_tile(x, ys, xo, yt, xi, yi, 16, 16);
+    blur_x.compute_at(out, yo).gpu_tile(x, y, xo, yt, xi, yi, 16, 16);
+
+    Buffer<int> result = out.realize({100, 160});
+    result.copy_to_host();
+
+    for (int y = 0; y < result.height(); y++) {
+        for (int x = 0; x < result.width(); x++) {
+            int correct = 0;
+            for (int dy = -1; dy <= 1; dy++) {
+                for (int dx = -1; dx <= 1; dx++) {
+                    correct += (x + dx) * 3 + (y + dy) * 5;
+                }
+            }
+            if (result(x, y) != correct) {
+                printf("result(%d, %d) = %d instead of %d\n",
+                       x, y, result(x, y), correct);
+                return 1;
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
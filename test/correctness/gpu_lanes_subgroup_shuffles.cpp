@@ -0,0 +1,101 @@
+#include "Halide.h"
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    Target t = get_jit_target_from_environment();
+
+    if (!t.features_any_of({Target::Metal, Target::OpenCL, Target::Vulkan})) {
+        printf("[SKIP] A Metal, OpenCL or Vulkan target is required.\n");
+        return 0;
+    }
+    if (t.has_feature(Target::Vulkan) && !t.has_feature(Target::VulkanV13)) {
+        printf("[SKIP] Subgroup shuffles in Vulkan require vulkan_v13.\n");
+        return 0;
+    }
+
+    // Use warps of 16 lanes, which fit within the subgroups of most
+    // devices.
+    const int lanes = 16;
+
+    {
+        // A small convolution, which shuffles values down and up
+        Func f, g;
+        Var x, y;
+
+        f(x, y) = cast<uint8_t>(x + y);
+        g(x, y) = f(x - 1, y) + f(x + 1, y);
+
+        Var xo, xi, yi;
+        g
+            .gpu_tile(x, y, xi, yi, lanes, 2, TailStrategy::RoundUp)
+            .gpu_lanes(xi);
+
+        f.compute_root();
+
+        f
+            .in(g)
+            .compute_at(g, yi)
+            .split(x, xo, xi, lanes, TailStrategy::RoundUp)
+            .gpu_lanes(xi)
+            .unroll(xo);
+
+        Buffer<uint8_t> out = g.realize({64, 4});
+        for (int y = 0; y < out.height(); y++) {
+            for (int x = 0; x < out.width(); x++) {
+                uint8_t correct = 2 * (x + y);
+                uint8_t actual = out(x, y);
+                if (correct != actual) {
+                    printf("out(%d, %d) = %d instead of %d\n",
+                           x, y, actual, correct);
+                    return 1;
+                }
+            }
+        }
+    }
+
+    {
+        // An outer product, which shuffles values from arbitrary lanes
+        Func a, b, c;
+        Var x, y;
+        a(x) = cast<float>(x);
+        b(y) = cast<float>(y);
+        c(x, y) = a(x) + 100 * b(y);
+
+        a.compute_root();
+        b.compute_root();
+
+        Var xi, yi;
+        c
+            .tile(x, y, xi, yi, lanes, lanes, TailStrategy::RoundUp)
+            .gpu_blocks(x, y)
+            .gpu_lanes(xi);
+        a
+            .in(c)
+            .compute_at(c, x)
+            .gpu_lanes(x)
+            .store_in(MemoryType::Register);
+        b
+            .in(c)
+            .compute_at(c, x)
+            .gpu_lanes(y)
+            .store_in(MemoryType::Register);
+
+        Buffer<float> out = c.realize({32, 32});
+        for (int y = 0; y < out.height(); y++) {
+            for (int x = 0; x < out.width(); x++) {
+                float correct = x + 100 * y;
+                float actual = out(x, y);
+                // The floats are small integers, so they should be exact.
+                if (correct != actual) {
+                    printf("out(%d, %d) = %f instead of %f\n",
+                           x, y, actual, correct);
+                    return 1;
+                }
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,50 @@
+#include "Halide.h"
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    Target t = get_jit_target_from_environment();
+    if (!t.has_gpu_feature()) {
+        printf("[SKIP] No GPU target enabled.\n");
+        return 0;
+    }
+
+    // Two stencil stages computed per small tile by a few persistent
+    // blocks, in one kernel. The number of blocks doesn't divide the
+    // number of tiles.
+    Func input("input"), blur_x("blur_x"), out("out");
+    Var x("x"), y("y"), xo("xo"), yo("yo"), xi("xi"), yi("yi"), tile("tile"), block("block");
+
+    input(x, y) = x * 3 + y * 5;
+    blur_x(x, y) = input(x - 1, y) + input(x, y) + input(x + 1, y);
+    out(x, y) = blur_x(x, y - 1) + blur_x(x, y) + blur_x(x, y + 1);
+
+    out.tile(x, y, xo, yo, xi, yi, 8, 8)
+        .fuse(xo, yo, tile)
+        .gpu_persistent_blocks(tile, block, 7)
+        .gpu_threads(xi, yi);
+    input.compute_root();
+    blur_x.compute_at_gpu_blocks(out);
+
+    Buffer<int> result = out.realize({128, 96});
+    result.copy_to_host();
+
+    for (int y = 0; y < result.height(); y++) {
+        for (int x = 0; x < result.width(); x++) {
+            int correct = 0;
+            for (int dy = -1; dy <= 1; dy++) {
+                for (int dx = -1; dx <= 1; dx++) {
+                    correct += (x + dx) * 3 + (y + dy) * 5;
+                }
+            }
+            if (result(x, y) != correct) {
+                printf("result(%d, %d) = %d instead of %d\n",
+                       x, y, result(x, y), correct);
+                return 1;
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -329,6 +329,52 @@ int main(int argc, char **argv) {
         assert(b.all_equal(42));
     }
 
+    {
+        // Check copy_from() and fill() on buffers that are dense in
+        // their innermost dimension (which are copied/filled a whole
+        // span at a time), including crops of them, and on ones that
+        // aren't.
+        const int W = 100, H = 30, C = 3;
+        Buffer<int> planar(W, H, C);
+        planar.fill([](int x, int y, int c) { return x + y * 256 + c * 65536; });
+        Buffer<int> interleaved = Buffer<int>::make_interleaved(W, H, C);
+        interleaved.fill(0);
+
+        // planar -> planar crop, dense innermost dimension
+        Buffer<int> planar_copy(W, H, C);
+        planar_copy.fill(-1);
+        Buffer<int> window = planar_copy.cropped(0, 10, 80).cropped(1, 5, 20);
+        window.copy_from(planar);
+        planar_copy.for_each_element([&](int x, int y, int c) {
+            bool inside = x >= 10 && x < 90 && y >= 5 && y < 25;
+            int correct = inside ? planar(x, y, c) : -1;
+            if (planar_copy(x, y, c) != correct) {
+                printf("planar_copy(%d, %d, %d) = %d instead of %d\n",
+                       x, y, c, planar_copy(x, y, c), correct);
+                abort();
+            }
+        });
+
+        // planar -> interleaved, not dense in either order
+        interleaved.copy_from(planar);
+        interleaved.for_each_element([&](int x, int y, int c) {
+            if (interleaved(x, y, c) != planar(x, y, c)) {
+                printf("interleaved(%d, %d, %d) = %d instead of %d\n",
+                       x, y, c, interleaved(x, y, c), planar(x, y, c));
+                abort();
+            }
+        });
+
+        // fill with values with and without uniform bytes
+        window.fill(0);
+        assert(window.all_equal(0));
+        window.fill(-1);
+        assert(window.all_equal(-1));
+        window.fill(0x01020304);
+        assert(window.all_equal(0x01020304));
+        assert(planar_copy(0, 0, 0) == -1 && planar_copy(99, 29, 2) == -1);
+    }
+
     {
         // Check the fields get zero-initialized with the default constructor.
         uint8_t buf[sizeof(Halide::Runtime::Buffer<float>)];
@@ -0,0 +1,75 @@
+#include "Halide.h"
+
+using namespace Halide;
+
+// Check that pipelines compiled with hvx_auto_vtcm, which places reused
+// intermediates in VTCM, still compute the right thing, both when the
+// intermediate fits in the VTCM budget and when it doesn't.
+bool test(const Target &target, int strip_height) {
+    const int W = 1024;
+    const int H = 256;
+
+    Buffer<uint8_t> in(W + 2, H + 2);
+    in.for_each_element([&](int x, int y) {
+        in(x, y) = (uint8_t)(x * 7 + y * 13);
+    });
+
+    Var x, y, yo, yi;
+    Func input = BoundaryConditions::repeat_edge(in);
+    Func blur_x("blur_x"), blur_y("blur_y");
+    blur_x(x, y) = cast<uint16_t>(input(x, y)) + input(x + 1, y) + input(x + 2, y);
+    blur_y(x, y) = cast<uint8_t>((blur_x(x, y) + blur_x(x, y + 1) + blur_x(x, y + 2)) / 9);
+
+    const int vector_size = 128;
+    // Bound the output, so that the intermediate has a constant size.
+    blur_y
+        .bound(x, 0, W)
+        .bound(y, 0, H)
+        .hexagon()
+        .split(y, yo, yi, strip_height)
+        .parallel(yo)
+        .vectorize(x, vector_size);
+    blur_x
+        .compute_at(blur_y, yo)
+        .vectorize(x, vector_size / 2);
+
+    Buffer<uint8_t> out = blur_y.realize({W, H}, target);
+
+    for (int y = 0; y < H; y++) {
+        for (int x = 0; x < W; x++) {
+            int sum = 0;
+            for (int dy = 0; dy < 3; dy++) {
+                for (int dx = 0; dx < 3; dx++) {
+                    sum += in(std::min(x + dx, W + 1), std::min(y + dy, H + 1));
+                }
+            }
+            if (out(x, y) != sum / 9) {
+                printf("out(%d, %d) = %d instead of %d\n", x, y, out(x, y), sum / 9);
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+int main(int argc, char **argv) {
+    Target target = get_jit_target_from_environment();
+    if (!target.features_any_of({Target::HVX_v65, Target::HVX_v66, Target::HVX_v68})) {
+        printf("[SKIP] hexagon_auto_vtcm is only useful when targeting HVX v65 or later.\n");
+        return 0;
+    }
+    target = target.with_feature(Target::HVXAutoVTCM);
+
+    // The intermediate for each strip of 8 rows fits in the budget,
+    // even with a copy for each thread.
+    if (!test(target, 8)) {
+        return 1;
+    }
+    // The intermediate for each strip of 256 rows doesn't.
+    if (!test(target, 256)) {
+        return 1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,37 @@
+#include "Halide.h"
+#include <stdio.h>
+#include <thread>
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    const HostProperties &host = get_host_properties();
+    printf("Host: %s\n", host.to_string().c_str());
+
+    const int threads = (int)std::thread::hardware_concurrency();
+    if (host.cores < 1 || host.threads_per_core < 1) {
+        printf("Expected at least one core and one thread per core\n");
+        return 1;
+    }
+    if (threads > 0 && host.cores * host.threads_per_core > 4 * threads) {
+        printf("Detected more hardware threads than there are: %d\n", threads);
+        return 1;
+    }
+    if (host.l1_cache_size && host.l2_cache_size && host.l1_cache_size > host.l2_cache_size) {
+        printf("The L1 cache should be no larger than the L2 cache\n");
+        return 1;
+    }
+    if (host.last_level_cache_size && host.last_level_cache_size < host.l2_cache_size) {
+        printf("The last level of cache should be at least as large as the L2 cache\n");
+        return 1;
+    }
+
+    // The properties are detected once.
+    if (&get_host_properties() != &host) {
+        printf("Expected the host properties to be cached\n");
+        return 1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
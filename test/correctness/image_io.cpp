@@ -268,6 +268,91 @@ void test_mat_header() {
     }
 }
 
+void test_threaded_conversion() {
+    // Big enough to be converted in several bands.
+    Buffer<uint8_t> buf = Buffer<uint8_t>::make_interleaved(1024, 768, 3);
+    buf.for_each_element([&](int x, int y, int c) {
+        buf(x, y, c) = (uint8_t)(x * 3 + y * 5 + c * 7);
+    });
+
+    std::vector<std::string> formats = {"ppm"};
+#ifndef HALIDE_NO_PNG
+    formats.push_back("png");
+    Tools::ImageIOSettings::png_compression_level = 1;
+    Tools::ImageIOSettings::png_filters = PNG_FILTER_NONE;
+#endif
+    Tools::ImageIOSettings::num_threads = 4;
+    for (const std::string &format : formats) {
+        std::string filename = Internal::get_test_tmp_dir() + "test_threaded." + format;
+        Tools::save_image(buf, filename);
+        Buffer<uint8_t> reloaded = Tools::load_image(filename);
+        buf.for_each_element([&](int x, int y, int c) {
+            if (reloaded(x, y, c) != buf(x, y, c)) {
+                printf("test_threaded_conversion: mismatch at %d %d %d in %s\n", x, y, c, format.c_str());
+                exit(1);
+            }
+        });
+    }
+    Tools::ImageIOSettings::num_threads = 0;
+    Tools::ImageIOSettings::png_compression_level = -1;
+    Tools::ImageIOSettings::png_filters = -1;
+}
+
+template<typename T>
+void test_mapped_and_region(const std::string &format) {
+    Buffer<T> buf(37, 23, 3, 2);
+    buf.for_each_element([&](int x, int y, int c, int w) {
+        buf(x, y, c, w) = (T)(x + y * 37 + c * 37 * 23 + w * 7);
+    });
+
+    std::ostringstream o;
+    o << Internal::get_test_tmp_dir() << "test_mapped_" << halide_type_of<T>() << "." << format;
+    std::string filename = o.str();
+    Tools::save_image(buf, filename);
+
+    Buffer<T> mapped;
+    if (!Tools::load_mapped(filename, &mapped)) {
+        printf("load_mapped failed for %s\n", filename.c_str());
+        exit(1);
+    }
+    // Writes to the mapping mustn't reach the file.
+    mapped(0, 0, 0, 0) = (T)1;
+    Buffer<T> reloaded = Tools::load_image(filename);
+    mapped(0, 0, 0, 0) = buf(0, 0, 0, 0);
+
+    // Load a region that's contiguous in the first dimension only, and
+    // one that spans all of the first two dimensions.
+    Buffer<T> region, planes;
+    if (!Tools::load_region(filename, {{5, 20}, {3, 11}, {1, 2}}, &region) ||
+        !Tools::load_region(filename, {{0, 37}, {0, 23}, {1, 1}}, &planes)) {
+        printf("load_region failed for %s\n", filename.c_str());
+        exit(1);
+    }
+    if (region.dim(0).min() != 5 || region.dim(1).extent() != 11 || region.dim(3).extent() != 2) {
+        printf("load_region returned the wrong shape for %s\n", filename.c_str());
+        exit(1);
+    }
+
+    buf.for_each_element([&](int x, int y, int c, int w) {
+        if (mapped(x, y, c, w) != buf(x, y, c, w) || reloaded(x, y, c, w) != buf(x, y, c, w)) {
+            printf("load_mapped: mismatch at %d %d %d %d in %s\n", x, y, c, w, filename.c_str());
+            exit(1);
+        }
+    });
+    region.for_each_element([&](int x, int y, int c, int w) {
+        if (region(x, y, c, w) != buf(x, y, c, w)) {
+            printf("load_region: mismatch at %d %d %d %d in %s\n", x, y, c, w, filename.c_str());
+            exit(1);
+        }
+    });
+    planes.for_each_element([&](int x, int y, int c, int w) {
+        if (planes(x, y, c, w) != buf(x, y, c, w)) {
+            printf("load_region: mismatch at %d %d %d %d in %s\n", x, y, c, w, filename.c_str());
+            exit(1);
+        }
+    });
+}
+
 int main(int argc, char **argv) {
     do_test<int8_t>();
     do_test<int16_t>();
@@ -283,6 +368,12 @@ int main(int argc, char **argv) {
 #endif
     do_test<double>();
     test_mat_header();
+    test_threaded_conversion();
+    for (const char *format : {"npy", "tmp", "mat"}) {
+        test_mapped_and_region<uint8_t>(format);
+        test_mapped_and_region<float>(format);
+        test_mapped_and_region<double>(format);
+    }
     printf("Success!\n");
     return 0;
 }
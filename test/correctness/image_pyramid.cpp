@@ -0,0 +1,91 @@
+#include "Halide.h"
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    const int W = 128, H = 96, C = 3, J = 5;
+
+    Buffer<float> input(W, H, C);
+    input.for_each_value([](float &v) { v = (float)rand() / (float)RAND_MAX; });
+
+    Var x, y, c;
+    Func clamped = BoundaryConditions::repeat_edge(input);
+
+    Target target = get_jit_target_from_environment();
+
+    // Collapsing the Laplacian pyramid of a Gaussian pyramid should give
+    // back the original image.
+    {
+        ImagePyramid gaussian = ImagePyramid::gaussian(clamped, J);
+        ImagePyramid laplacian = gaussian.laplacian();
+        ImagePyramid collapsed = laplacian.collapse();
+        if (gaussian.size() != J || laplacian.size() != J || collapsed.size() != J) {
+            printf("Wrong number of levels\n");
+            return 1;
+        }
+
+        // Use a small threshold, so both the serial and parallel
+        // schedules get used.
+        gaussian.schedule(target, W, H, 1, 256);
+        collapsed.schedule(target, W, H, 1, 256);
+
+        Buffer<float> out = collapsed[0].realize({W, H, C}, target);
+        out.for_each_element([&](int x, int y, int c) {
+            if (std::abs(out(x, y, c) - input(x, y, c)) > 1e-5f) {
+                printf("collapsed(%d, %d, %d) = %f instead of %f\n",
+                       x, y, c, out(x, y, c), input(x, y, c));
+                exit(1);
+            }
+        });
+    }
+
+    // Check a level of the Gaussian pyramid against a reference.
+    {
+        ImagePyramid gaussian = ImagePyramid::gaussian(clamped, 2);
+        Buffer<float> out = gaussian[1].realize({W / 2, H / 2, C}, target);
+
+        auto in = [&](int x, int y, int c) {
+            return input(std::clamp(x, 0, W - 1), std::clamp(y, 0, H - 1), c);
+        };
+        const float k[] = {1, 3, 3, 1};
+        out.for_each_element([&](int x, int y, int c) {
+            float correct = 0;
+            for (int i = 0; i < 4; i++) {
+                for (int j = 0; j < 4; j++) {
+                    correct += k[i] * k[j] * in(2 * x - 1 + i, 2 * y - 1 + j, c);
+                }
+            }
+            correct /= 64;
+            if (std::abs(out(x, y, c) - correct) > 1e-5f) {
+                printf("gaussian[1](%d, %d, %d) = %f instead of %f\n",
+                       x, y, c, out(x, y, c), correct);
+                exit(1);
+            }
+        });
+    }
+
+    // Scale the levels of a Laplacian pyramid with map. Scaling all of
+    // them by the same amount scales the collapsed image.
+    {
+        ImagePyramid laplacian = ImagePyramid::gaussian(clamped, J).laplacian();
+        ImagePyramid scaled = laplacian.map([&](const Func &level, int j) {
+            Func f;
+            f(x, y, c) = level(x, y, c) * 2.0f;
+            return f;
+        });
+        ImagePyramid collapsed = scaled.collapse();
+        collapsed.schedule(target, W, H);
+
+        Buffer<float> out = collapsed[0].realize({W, H, C}, target);
+        out.for_each_element([&](int x, int y, int c) {
+            if (std::abs(out(x, y, c) - 2 * input(x, y, c)) > 1e-5f) {
+                printf("scaled(%d, %d, %d) = %f instead of %f\n",
+                       x, y, c, out(x, y, c), 2 * input(x, y, c));
+                exit(1);
+            }
+        });
+    }
+
+    printf("Success!\n");
+    return 0;
+}
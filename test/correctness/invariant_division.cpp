@@ -0,0 +1,128 @@
+#include "Halide.h"
+
+#include <limits>
+#include <random>
+
+using namespace Halide;
+using namespace Halide::Internal;
+
+// Count the divisions and modulos by the divisor left inside loops.
+class CountDivisions : public IRMutator {
+    using IRMutator::visit;
+
+    int loop_depth = 0;
+
+    bool is_divisor(const Expr &e) {
+        const Broadcast *b = e.as<Broadcast>();
+        const Variable *v = (b ? b->value : e).as<Variable>();
+        return v && v->name == divisor_name;
+    }
+
+    Stmt visit(const For *op) override {
+        loop_depth++;
+        Stmt s = IRMutator::visit(op);
+        loop_depth--;
+        return s;
+    }
+
+    Expr visit(const Div *op) override {
+        if (loop_depth > 0 && is_divisor(op->b)) {
+            count++;
+        }
+        return IRMutator::visit(op);
+    }
+
+    Expr visit(const Mod *op) override {
+        if (loop_depth > 0 && is_divisor(op->b)) {
+            count++;
+        }
+        return IRMutator::visit(op);
+    }
+
+public:
+    std::string divisor_name;
+    int count = 0;
+};
+
+template<typename T>
+bool test(int vector_width) {
+    const int size = 1024;
+    std::mt19937 rng(0);
+
+    // Numerators: the extremes of the type, small values, and random ones.
+    Buffer<T> input(size);
+    input.for_each_value([&](T &v) { v = (T)rng(); });
+    T specials[] = {0, 1, 2, 3, (T)-1, (T)-2,
+                    std::numeric_limits<T>::min(), (T)(std::numeric_limits<T>::min() + 1),
+                    std::numeric_limits<T>::max(), (T)(std::numeric_limits<T>::max() - 1)};
+    for (size_t i = 0; i < sizeof(specials) / sizeof(specials[0]); i++) {
+        input(i) = specials[i];
+        input(i + 16) = (T)(rng() % 64);
+    }
+
+    Param<T> divisor("divisor");
+    Func quotient("quotient"), remainder("remainder");
+    Var x;
+    quotient(x) = input(x) / divisor;
+    remainder(x) = input(x) % divisor;
+    if (vector_width > 1) {
+        quotient.vectorize(x, vector_width);
+        remainder.vectorize(x, vector_width);
+    }
+
+    CountDivisions counter;
+    counter.divisor_name = divisor.name();
+    quotient.add_custom_lowering_pass(&counter, []() {});
+    remainder.add_custom_lowering_pass(&counter, []() {});
+    quotient.compile_jit();
+    remainder.compile_jit();
+    if (counter.count != 0) {
+        printf("%d divisions by the divisor left in the loop, with vector width %d\n",
+               counter.count, vector_width);
+        return false;
+    }
+
+    std::vector<T> divisors(std::begin(specials), std::end(specials));
+    for (int i = 0; i < 32; i++) {
+        // Divisors of all magnitudes.
+        divisors.push_back((T)(rng() >> (rng() % (sizeof(T) * 8))));
+    }
+
+    for (T d : divisors) {
+        divisor.set(d);
+        Buffer<T> q = quotient.realize({size});
+        Buffer<T> r = remainder.realize({size});
+        for (int i = 0; i < size; i++) {
+            T correct_q = div_imp(input(i), d);
+            T correct_r = mod_imp(input(i), d);
+            if (q(i) != correct_q || r(i) != correct_r) {
+                printf("%s%d: %lld / %lld = %lld and %% = %lld instead of %lld and %lld\n",
+                       type_of<T>().is_int() ? "int" : "uint", type_of<T>().bits(),
+                       (long long)input(i), (long long)d, (long long)q(i), (long long)r(i),
+                       (long long)correct_q, (long long)correct_r);
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+template<typename T>
+bool test_all_widths() {
+    const int natural = get_jit_target_from_environment().natural_vector_size<T>();
+    return test<T>(1) && test<T>(natural) && test<T>(natural * 2);
+}
+
+int main(int argc, char **argv) {
+    if (!test_all_widths<int8_t>() ||
+        !test_all_widths<uint8_t>() ||
+        !test_all_widths<int16_t>() ||
+        !test_all_widths<uint16_t>() ||
+        !test_all_widths<int32_t>() ||
+        !test_all_widths<uint32_t>()) {
+        return 1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,111 @@
+#include "Halide.h"
+
+#ifndef _WIN32
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+using namespace Halide;
+
+#ifndef _WIN32
+namespace {
+
+// The inodes of the cached object files, sorted.
+std::vector<ino_t> cached_objects(const std::string &dir) {
+    std::vector<ino_t> result;
+    DIR *d = opendir(dir.c_str());
+    assert(d);
+    while (dirent *e = readdir(d)) {
+        std::string name = e->d_name;
+        if (Internal::ends_with(name, ".o")) {
+            struct stat s;
+            assert(stat((dir + "/" + name).c_str(), &s) == 0);
+            result.push_back(s.st_ino);
+        }
+    }
+    closedir(d);
+    std::sort(result.begin(), result.end());
+    return result;
+}
+
+// JIT compile and run a pipeline in a child process, so that each run
+// starts from the same state, like a fresh process would.
+void run_in_child(int k) {
+    pid_t pid = fork();
+    if (pid == 0) {
+        Func f("f");
+        Var x("x"), y("y");
+        f(x, y) = x * k + y;
+        f.vectorize(x, 8).parallel(y);
+        Buffer<int> result = f.realize({64, 64});
+        for (int y = 0; y < 64; y++) {
+            for (int x = 0; x < 64; x++) {
+                if (result(x, y) != x * k + y) {
+                    printf("result(%d, %d) = %d instead of %d\n", x, y, result(x, y), x * k + y);
+                    exit(1);
+                }
+            }
+        }
+        exit(0);
+    }
+    int status = 0;
+    waitpid(pid, &status, 0);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        printf("Child process failed\n");
+        exit(1);
+    }
+}
+
+}  // namespace
+#endif
+
+int main(int argc, char **argv) {
+#ifdef _WIN32
+    printf("[SKIP] Windows does not have a working setenv\n");
+#else
+    if (get_jit_target_from_environment().arch == Target::WebAssembly) {
+        printf("[SKIP] The WebAssembly JIT does not use the JIT cache.\n");
+        return 0;
+    }
+
+    std::string dir = Internal::dir_make_temp();
+    setenv("HL_JIT_CACHE_DIR", dir.c_str(), 1);
+
+    // The first run compiles and stores the pipeline.
+    run_in_child(3);
+    std::vector<ino_t> first = cached_objects(dir);
+    if (first.size() != 1) {
+        printf("Expected one cached object, got %d\n", (int)first.size());
+        return 1;
+    }
+
+    // The second run loads it instead of writing it again.
+    run_in_child(3);
+    if (cached_objects(dir) != first) {
+        printf("Second run didn't use the cached object\n");
+        return 1;
+    }
+
+    // A different pipeline gets a different entry.
+    run_in_child(5);
+    if (cached_objects(dir).size() != 2) {
+        printf("Expected two cached objects\n");
+        return 1;
+    }
+
+    DIR *d = opendir(dir.c_str());
+    while (dirent *e = readdir(d)) {
+        std::string name = e->d_name;
+        if (name != "." && name != "..") {
+            Internal::file_unlink(dir + "/" + name);
+        }
+    }
+    closedir(d);
+    Internal::dir_rmdir(dir);
+
+    printf("Success!\n");
+#endif
+    return 0;
+}
@@ -0,0 +1,110 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+namespace {
+
+std::string error_msg;
+void my_error(JITUserContext *ucon, const char *msg) {
+    error_msg = msg;
+}
+
+// Realize a Func once by JIT-compiling it and once by interpreting its
+// IR, and check the results match to within a tolerance.
+template<typename T>
+bool check(Func f, const std::vector<int> &sizes, const Target &target, double tolerance = 0) {
+    Buffer<T> compiled = f.realize(sizes, target);
+    Buffer<T> interpreted = f.realize(sizes, target.with_feature(Target::JITInterp));
+    bool ok = true;
+    compiled.for_each_element([&](const int *pos) {
+        const double a = compiled(pos), b = interpreted(pos);
+        if (ok && !(std::abs(a - b) <= tolerance)) {
+            printf("%s: compiled %f but interpreted %f at %d\n", f.name().c_str(), a, b, pos[0]);
+            ok = false;
+        }
+    });
+    return ok;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    Target target = get_jit_target_from_environment();
+    if (target.has_gpu_feature()) {
+        printf("[SKIP] The IR interpreter only runs pipelines on the host.\n");
+        return 0;
+    }
+
+    Var x, y;
+
+    Buffer<uint8_t> input(67, 45);
+    input.for_each_element([&](int x, int y) {
+        input(x, y) = (uint8_t)(x * 17 + y * 31);
+    });
+
+    {
+        // Pointwise integer arithmetic, with wrap-around and division
+        // rounding down.
+        Func f("pointwise");
+        Expr v = cast<int16_t>(input(x, y));
+        f(x, y) = cast<uint8_t>(v * 91 - (v / 3) + (v % 7) - (x - 20) / 6);
+        if (!check<uint8_t>(f, {67, 45}, target)) {
+            return 1;
+        }
+    }
+
+    {
+        // A vectorized, parallel blur with a boundary condition.
+        Func clamped = BoundaryConditions::repeat_edge(input);
+        Func blur_x("blur_x"), blur_y("blur_y");
+        blur_x(x, y) = (cast<uint16_t>(clamped(x - 1, y)) + clamped(x, y) + clamped(x + 1, y)) / 3;
+        blur_y(x, y) = cast<uint8_t>((blur_x(x, y - 1) + blur_x(x, y) + blur_x(x, y + 1)) / 3);
+        Var yo, yi;
+        blur_y.split(y, yo, yi, 8).parallel(yo).vectorize(x, 16);
+        blur_x.compute_at(blur_y, yo).vectorize(x, 8);
+        if (!check<uint8_t>(blur_y, {67, 45}, target)) {
+            return 1;
+        }
+    }
+
+    {
+        // A histogram: a reduction with a data-dependent store.
+        Func hist("hist");
+        RDom r(input);
+        hist(x) = 0;
+        hist(input(r.x, r.y) / 8) += 1;
+        if (!check<int>(hist, {32}, target)) {
+            return 1;
+        }
+    }
+
+    {
+        // Floating-point math, with a lerp and select.
+        Func f("float_math");
+        Expr v = input(x, y) / 255.0f;
+        f(x, y) = select(v > 0.5f, sqrt(v) * exp(-v), lerp(sin(v), cos(v), v)) + pow(v, 2.5f);
+        f.vectorize(x, 8);
+        if (!check<float>(f, {67, 45}, target, 1e-5)) {
+            return 1;
+        }
+    }
+
+    {
+        // Errors are reported through the usual handlers.
+        Func f("fails");
+        f(x) = require(x < 10, x, "x is too big:", x);
+        Callable c = f.compile_to_callable({}, target.with_feature(Target::JITInterp));
+        JITUserContext context;
+        context.handlers.custom_error = my_error;
+        Buffer<int> out(20);
+        int result = c(&context, out);
+        if (result == 0 || error_msg.find("x is too big") == std::string::npos) {
+            printf("Expected a failed requirement, got %d (%s)\n", result, error_msg.c_str());
+            return 1;
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,40 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    if (get_jit_target_from_environment().arch == Target::WebAssembly) {
+        printf("[SKIP] WebAssembly JIT does not use the shared runtime.\n");
+        return 0;
+    }
+
+    Var x;
+    Func f, g;
+    f(x) = x;
+    g(x) = x * 2;
+
+    Buffer<int> a = f.realize({10});
+    Buffer<int> b = g.realize({10});
+
+    // Both pipelines link against the same copy of the runtime, so
+    // sharing it saves at least one copy.
+    Internal::JITSharedRuntimeStats stats = Internal::JITSharedRuntime::stats();
+    printf("%d shared runtime modules of %d bytes, used by %d pipelines, saving %d bytes\n",
+           stats.runtime_modules, (int)stats.runtime_bytes, stats.pipelines, (int)stats.bytes_saved);
+    if (stats.runtime_modules < 1 || stats.runtime_bytes == 0) {
+        printf("The shared runtime should have been compiled\n");
+        return 1;
+    }
+    if (stats.pipelines < 2) {
+        printf("Expected at least two pipelines using the shared runtime\n");
+        return 1;
+    }
+    if (stats.bytes_saved < stats.runtime_bytes) {
+        printf("Expected to save at least one copy of the shared runtime\n");
+        return 1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
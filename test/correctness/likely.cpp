@@ -80,9 +80,9 @@ public:
     }
 };
 
-void count_partitions(Func g, int correct) {
+void count_partitions(Func g, int correct, const Target &t = get_target_from_environment()) {
     g.add_custom_lowering_pass(new CheckStoreCount(g.name(), correct));
-    g.compile_to_module(g.infer_arguments());
+    g.compile_to_module(g.infer_arguments(), "", t);
 }
 
 void count_sin_calls(Func g, int correct) {
@@ -313,6 +313,38 @@ int main(int argc, char **argv) {
         count_partitions(h, 3);
     }
 
+    // A min nested inside a max with likelies on both sides still
+    // gets found.
+    {
+        Func g;
+        Var x;
+        Param<int> p;
+        g(x) = max(likely(x), likely(p) + min(likely(x), 50));
+        count_partitions(g, 2);
+    }
+
+    // Block loops of GPU kernels get partitioned even if the kernel
+    // has thread barriers, as every thread of a block takes the same
+    // branch. The interior tiles don't need the clamps on the input.
+    Target gpu_target = get_jit_target_from_environment();
+    if (gpu_target.has_gpu_feature()) {
+        Func f, g, h;
+        Var x, y, xo, yo, xi, yi;
+
+        f(x, y) = x + y;
+        f.compute_root();
+
+        g(x, y) = BoundaryConditions::repeat_edge(f, {{0, 256}, {0, 256}})(x, y);
+        h(x, y) = g(x - 1, y) + g(x + 1, y) + g(x, y - 1) + g(x, y + 1);
+
+        h.bound(x, 0, 256).bound(y, 0, 256).gpu_tile(x, y, xo, yo, xi, yi, 16, 16);
+        g.compute_at(h, xo).gpu_threads(x, y);
+
+        // Top-middle-bottom rows of tiles, and the middle row is split
+        // into left-center-right.
+        count_partitions(h, 5, gpu_target);
+    }
+
     // The performance of this behavior is tested in
     // test/performance/boundary_conditions.cpp
 
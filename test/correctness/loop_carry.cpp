@@ -9,13 +9,33 @@ class LoopCarryWrapper : public IRMutator {
     using IRMutator::visit;
 
     int register_count_;
+    int row_count_;
     Stmt mutate(const Stmt &stmt) override {
-        return simplify(loop_carry(stmt, register_count_));
+        return simplify(loop_carry(stmt, register_count_, row_count_));
     }
 
 public:
-    LoopCarryWrapper(int register_count)
-        : register_count_(register_count) {
+    LoopCarryWrapper(int register_count, int row_count = 0)
+        : register_count_(register_count), row_count_(row_count) {
+    }
+};
+
+// Count the loads from a buffer.
+class CountLoads : public IRMutator {
+    using IRMutator::visit;
+
+    std::string name_;
+    Expr visit(const Load *op) override {
+        if (op->name == name_) {
+            count++;
+        }
+        return IRMutator::visit(op);
+    }
+
+public:
+    int count = 0;
+    CountLoads(const std::string &name)
+        : name_(name) {
     }
 };
 
@@ -59,6 +79,51 @@ int main(int argc, char **argv) {
 
     f.realize({size, size});
 
+    // Check that a 3x3 stencil carries rows of its input across
+    // iterations of the outer loop.
+    {
+        Buffer<int> in(size + 2, size + 2);
+        in.for_each_element([&](int x, int y) { in(x, y) = x * 3 + y * 7 + (x * y) % 5; });
+
+        Func blur;
+        Expr e = 0;
+        for (int dy = 0; dy < 3; dy++) {
+            for (int dx = 0; dx < 3; dx++) {
+                e += in(x + dx, y + dy);
+            }
+        }
+        blur(x, y) = e;
+        blur.bound(x, 0, size).bound(y, 0, size).vectorize(x, 8);
+
+        CountLoads count(in.name());
+        blur.add_custom_lowering_pass(new LoopCarryWrapper(8, 9));
+        blur.add_custom_lowering_pass(&count, []() {});
+        Buffer<int> out = blur.realize({size, size});
+
+        // Three column offsets, each carrying two rows. In the loop: one
+        // load for each column offset's leading row. Before it: two loads
+        // for rows of each column offset.
+        if (count.count != 9) {
+            printf("Expected 9 loads of the input after carrying rows, got %d\n", count.count);
+            return 1;
+        }
+
+        for (int y = 0; y < size; y++) {
+            for (int x = 0; x < size; x++) {
+                int correct = 0;
+                for (int dy = 0; dy < 3; dy++) {
+                    for (int dx = 0; dx < 3; dx++) {
+                        correct += in(x + dx, y + dy);
+                    }
+                }
+                if (out(x, y) != correct) {
+                    printf("out(%d, %d) = %d instead of %d\n", x, y, out(x, y), correct);
+                    return 1;
+                }
+            }
+        }
+    }
+
     printf("Success!\n");
     return 0;
 }
@@ -0,0 +1,88 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+using namespace Halide::Internal;
+
+// Record the order of the loops over a Func, outermost first.
+class RecordLoops : public IRMutator {
+    using IRMutator::visit;
+
+    Stmt visit(const For *op) override {
+        if (starts_with(op->name, prefix)) {
+            loops.push_back(op->name.substr(prefix.size()));
+        }
+        return IRMutator::visit(op);
+    }
+
+    std::string prefix;
+
+public:
+    std::vector<std::string> &loops;
+
+    RecordLoops(const std::string &func, std::vector<std::string> &loops)
+        : prefix(func + ".s0."), loops(loops) {
+    }
+};
+
+int check(bool schedule_g, bool enable, const std::vector<std::string> &expected) {
+    Func f("f"), g("g");
+    Var x("x"), y("y");
+
+    f(x, y) = x + y * 256;
+    g(x, y) = f(y, x) + f(y + 1, x);
+    f.compute_root();
+    if (schedule_g) {
+        g.reorder(x, y);
+    }
+
+    std::vector<std::string> loops;
+    g.add_custom_lowering_pass(new RecordLoops(g.name(), loops));
+
+    Target t = get_jit_target_from_environment();
+    if (enable) {
+        t = t.with_feature(Target::LoopInterchange);
+    }
+    Buffer<int> out = g.realize({64, 64}, t);
+
+    if (loops != expected) {
+        printf("Wrong loop order over g:");
+        for (const auto &l : loops) {
+            printf(" %s", l.c_str());
+        }
+        printf("\n");
+        return 1;
+    }
+
+    for (int yy = 0; yy < 64; yy++) {
+        for (int xx = 0; xx < 64; xx++) {
+            int correct = (yy + xx * 256) + (yy + 1 + xx * 256);
+            if (out(xx, yy) != correct) {
+                printf("out(%d, %d) = %d instead of %d\n", xx, yy, out(xx, yy), correct);
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    // Without the feature, y is the outer loop as usual.
+    if (check(false, false, {"y", "x"})) {
+        return 1;
+    }
+
+    // With it, y goes innermost, because that is the dimension f is
+    // read densely along.
+    if (check(false, true, {"x", "y"})) {
+        return 1;
+    }
+
+    // Scheduled Funcs keep their loop order.
+    if (check(true, true, {"y", "x"})) {
+        return 1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -1,8 +1,10 @@
 #include "Halide.h"
 #include "HalideRuntime.h"
 #include <assert.h>
+#include <chrono>
 #include <stdio.h>
 #include <stdlib.h>
+#include <thread>
 
 using namespace Halide;
 
@@ -28,6 +30,17 @@ extern "C" HALIDE_EXPORT_SYMBOL int count_calls_with_arg(uint8_t val, halide_buf
     return 0;
 }
 
+int slow_call_count = 0;
+
+extern "C" HALIDE_EXPORT_SYMBOL int slow_count_calls(halide_buffer_t *out) {
+    if (!out->is_bounds_query()) {
+        slow_call_count++;
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        Halide::Runtime::Buffer<uint8_t>(*out).fill(7);
+    }
+    return 0;
+}
+
 int call_count_with_arg_parallel[8];
 
 extern "C" HALIDE_EXPORT_SYMBOL int count_calls_with_arg_parallel(uint8_t val, halide_buffer_t *out) {
@@ -80,6 +93,18 @@ void record_error(JITUserContext *user_context, const char *msg) {
     error_occured = true;
 }
 
+halide_memoization_cache_stats_t total_cache_stats() {
+    halide_memoization_cache_stats_t total = {};
+    for (const auto &s : Internal::JITSharedRuntime::memoization_cache_stats()) {
+        total.hits += s.hits;
+        total.misses += s.misses;
+        total.evictions += s.evictions;
+        total.bytes += s.bytes;
+        total.entries += s.entries;
+    }
+    return total;
+}
+
 int main(int argc, char **argv) {
 
     {
@@ -93,12 +118,19 @@ int main(int argc, char **argv) {
         f_memoized.compute_root().memoize();
 
         Buffer<uint8_t> result1 = f.realize();
+        halide_memoization_cache_stats_t before = total_cache_stats();
         Buffer<uint8_t> result2 = f.realize();
+        halide_memoization_cache_stats_t after = total_cache_stats();
 
         assert(result1(0) == 42);
         assert(result2(0) == 42);
 
         assert(call_count == 1);
+
+        // The second realization should have been a hit, and stored nothing new.
+        assert(after.hits == before.hits + 1);
+        assert(after.misses == before.misses);
+        assert(after.entries == before.entries && after.entries >= 1);
     }
 
     {
@@ -530,6 +562,55 @@ int main(int argc, char **argv) {
         assert(result() == (461 % 256));
     }
 
+    {
+        // Test keying on the contents of a buffer input.
+        call_count = 0;
+        Func count_calls;
+        count_calls.define_extern("count_calls", {}, UInt(8), 2);
+
+        ImageParam input(UInt(8), 1);
+        Func f, g;
+        RDom r(input);
+
+        g() = count_calls(0, 0) + sum(input(r));
+        f() = g();
+        g.compute_root().memoize(EvictionKey(), true);
+
+        Buffer<uint8_t> in(10);
+        in.fill(1);
+        input.set(in);
+
+        Buffer<uint8_t> result = f.realize();
+        assert(result() == 52);
+        result = f.realize();
+        assert(result() == 52);
+        assert(call_count == 1);
+
+        // The same data in a new allocation, with a different stride,
+        // is a hit.
+        Buffer<uint8_t> in_strided(20);
+        in_strided.fill(1);
+        Buffer<uint8_t> in_copy(in_strided.data(), {{0, 10, 2}});
+        input.set(in_copy);
+        result = f.realize();
+        assert(result() == 52);
+        assert(call_count == 1);
+
+        // Changing the data in place is a miss.
+        in_copy(3) = 2;
+        result = f.realize();
+        assert(result() == 53);
+        assert(call_count == 2);
+
+        // And so is changing the shape.
+        Buffer<uint8_t> in_smaller(9);
+        in_smaller.fill(1);
+        input.set(in_smaller);
+        result = f.realize();
+        assert(result() == 51);
+        assert(call_count == 3);
+    }
+
     {
         Param<float> val;
 
@@ -747,6 +828,96 @@ int main(int argc, char **argv) {
 
         assert(call_count == 8);
     }
+
+    // Test per-site budgets: once a pipeline with large entries has a
+    // budget of its own, it no longer evicts another pipeline's entries.
+    {
+        call_count = 0;
+        call_count_with_arg = 0;
+        Var x, y;
+
+        Func count_calls;
+        count_calls.define_extern("count_calls", {}, UInt(8), 2);
+        Func small_memoized, small("small_site");
+        small_memoized(x, y) = count_calls(x, y);
+        small_memoized.compute_root().memoize();
+        small(x, y) = small_memoized(x, y);
+
+        Param<uint8_t> val;
+        Func count_calls_with_arg;
+        count_calls_with_arg.define_extern("count_calls_with_arg", {val}, UInt(8), 2);
+        Func big_memoized, big("big_site");
+        big_memoized(x, y) = count_calls_with_arg(x, y);
+        big_memoized.compute_root().memoize();
+        big(x, y) = big_memoized(x, y);
+
+        Buffer<uint8_t> result = small.realize({16, 16});
+        assert(result(0, 0) == 42);
+
+        Internal::JITSharedRuntime::memoization_cache_set_site_size("big_site", "", 2 * 512 * 512);
+        // Four times the default cache size.
+        for (int i = 0; i < 16; i++) {
+            val.set(i);
+            Buffer<uint8_t> big_result = big.realize({512, 512});
+            assert(big_result(0, 0) == i);
+        }
+        assert(call_count_with_arg == 16);
+
+        result = small.realize({16, 16});
+        assert(result(0, 0) == 42);
+        assert(call_count == 1);
+
+        // The most recent big entry is still cached.
+        val.set(15);
+        result = big.realize({512, 512});
+        assert(result(0, 0) == 15);
+        assert(call_count_with_arg == 16);
+    }
+
+    // Test cost-aware eviction: an entry that was slow to compute
+    // outlives a stream of cheap ones that would evict it under LRU.
+    {
+        Internal::JITSharedRuntime::memoization_cache_set_eviction_policy(halide_memoization_cache_evict_greedy_dual_size);
+        Internal::JITSharedRuntime::memoization_cache_set_size(16 * 1024);
+
+        slow_call_count = 0;
+        call_count_with_arg = 0;
+        Var x, y;
+
+        Func slow_count_calls;
+        slow_count_calls.define_extern("slow_count_calls", {}, UInt(8), 2);
+        Func expensive, expensive_out;
+        expensive(x, y) = slow_count_calls(x, y);
+        expensive.compute_root().memoize();
+        expensive_out(x, y) = expensive(x, y);
+
+        Param<uint8_t> val;
+        Func count_calls_with_arg;
+        count_calls_with_arg.define_extern("count_calls_with_arg", {val}, UInt(8), 2);
+        Func cheap, cheap_out;
+        cheap(x, y) = count_calls_with_arg(x, y);
+        cheap.compute_root().memoize();
+        cheap_out(x, y) = cheap(x, y);
+
+        Buffer<uint8_t> result = expensive_out.realize({32, 32});
+        assert(result(0, 0) == 7);
+
+        // 64 entries of 1k each.
+        for (int i = 0; i < 64; i++) {
+            val.set(i);
+            Buffer<uint8_t> cheap_result = cheap_out.realize({32, 32});
+            assert(cheap_result(0, 0) == i);
+        }
+        assert(call_count_with_arg == 64);
+
+        result = expensive_out.realize({32, 32});
+        assert(result(0, 0) == 7);
+        assert(slow_call_count == 1);
+
+        Internal::JITSharedRuntime::memoization_cache_set_eviction_policy(halide_memoization_cache_evict_lru);
+        Internal::JITSharedRuntime::memoization_cache_set_size(0);
+    }
+
     Internal::JITSharedRuntime::release_all();
 
     printf("Success!\n");
@@ -0,0 +1,87 @@
+#include "Halide.h"
+
+#include <regex>
+
+using namespace Halide;
+
+// A matrix multiply of T tiles, computed with SIMD-group matrices.
+template<typename T>
+bool test(const Target &t) {
+    const int size = 64;
+    Buffer<T> A(size, size), B(size, size);
+    A.for_each_element([&](int x, int y) { A(x, y) = (T)((x + y * 3) % 7); });
+    B.for_each_element([&](int x, int y) { B(x, y) = (T)((x * 5 + y) % 5); });
+
+    Var x("x"), y("y");
+    RDom r(0, size);
+    Func mm("mm"), out("out");
+    mm(x, y) = cast<T>(0);
+    mm(x, y) += A(r, y) * B(x, r);
+    out(x, y) = mm(x, y);
+
+    Var xo("xo"), yo("yo"), xi("xi"), yi("yi");
+    RVar ro("ro"), ri("ri");
+    out.tile(x, y, xo, yo, xi, yi, 8, 8, TailStrategy::RoundUp)
+        .gpu_blocks(xo, yo)
+        .vectorize(xi)
+        .vectorize(yi);
+    mm.compute_at(out, xo)
+        .store_in(MemoryType::SimdgroupMatrix)
+        .tile(x, y, xi, yi, 8, 8)
+        .vectorize(xi)
+        .vectorize(yi);
+    mm.update()
+        .tile(x, y, xi, yi, 8, 8)
+        .split(r, ro, ri, 8)
+        .reorder(ri, xi, yi, ro, x, y)
+        .atomic()
+        .vectorize(ri)
+        .vectorize(xi)
+        .vectorize(yi);
+
+    Buffer<T> result = out.realize({size, size}, t);
+    result.copy_to_host();
+
+    for (int y = 0; y < size; y++) {
+        for (int x = 0; x < size; x++) {
+            // The products and sums are small integers, so they're exact.
+            float correct = 0;
+            for (int k = 0; k < size; k++) {
+                correct += (float)A(k, y) * (float)B(x, k);
+            }
+            if ((float)result(x, y) != correct) {
+                printf("result(%d, %d) = %f instead of %f\n",
+                       x, y, (double)result(x, y), (double)correct);
+                return false;
+            }
+        }
+    }
+
+    // Check the matrix instructions were used by grepping the compiled
+    // code (the Metal source is an embedded string).
+    Buffer<uint8_t> buf = out.compile_to_module(std::vector<Argument>(), "out", t).compile_to_buffer();
+    for (const char *pattern : {"simdgroup_load", "simdgroup_multiply_accumulate", "simdgroup_store"}) {
+        std::basic_regex<char> regex(pattern);
+        if (!std::regex_search((const char *)buf.begin(), (const char *)buf.end(), regex)) {
+            printf("Did not find %s in compiled code. Rerun test with HL_DEBUG_CODEGEN=1 to debug\n", pattern);
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char **argv) {
+    Target t = get_jit_target_from_environment();
+    if (!t.has_feature(Target::Metal)) {
+        printf("[SKIP] Metal is not enabled in target: %s\n", t.to_string().c_str());
+        return 0;
+    }
+
+    if (!test<float>(t) ||
+        !test<float16_t>(t)) {
+        return 1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,96 @@
+#include "Halide.h"
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    // A cumulative sum, with a domain that isn't a multiple of the block size.
+    {
+        Func g("g"), f("f");
+        Var x;
+        g(x) = x % 7;
+
+        f(x) = 3;
+        RDom r(1, 1000);
+        f(r) = f(r - 1) + g(r);
+
+        f.update().parallel_scan(r, 64);
+        f.update().parallel(r, 64);
+        g.compute_root();
+
+        Buffer<int> out = f.realize({1001});
+
+        int correct = 3;
+        for (int i = 0; i < 1001; i++) {
+            if (i > 0) {
+                correct += i % 7;
+            }
+            if (out(i) != correct) {
+                printf("f(%d) = %d instead of %d\n", i, out(i), correct);
+                return 1;
+            }
+        }
+    }
+
+    // A running max down each column of an image.
+    {
+        Func g("g"), f("f");
+        Var x, y;
+        g(x, y) = (x * 17 + y * 31) % 101;
+
+        f(x, y) = g(x, y);
+        RDom r(1, 99);
+        f(x, r) = max(f(x, r - 1), g(x, r));
+
+        f.update().parallel_scan(r, 16).vectorize(x, 8);
+        f.update().parallel(r, 16);
+
+        Buffer<int> out = f.realize({32, 100});
+
+        for (int i = 0; i < 32; i++) {
+            int correct = 0;
+            for (int j = 0; j < 100; j++) {
+                correct = std::max(correct, (i * 17 + j * 31) % 101);
+                if (out(i, j) != correct) {
+                    printf("f(%d, %d) = %d instead of %d\n", i, j, out(i, j), correct);
+                    return 1;
+                }
+            }
+        }
+    }
+
+    // The running argmax of a sequence, as a Tuple. Ties go to the latest
+    // site.
+    {
+        Func g("g"), f("f");
+        Var x;
+        g(x) = (x * 37) % 23;
+
+        f(x) = Tuple(-1, -1);
+        RDom r(0, 200);
+        Expr prev_max = f(r - 1)[0], prev_arg = f(r - 1)[1];
+        f(r) = Tuple(max(prev_max, g(r)), select(g(r) < prev_max, prev_arg, r));
+
+        f.update().parallel_scan(r, 32);
+        f.update().parallel(r, 32);
+
+        Realization result = f.realize({200});
+        Buffer<int> out_max = result[0], out_arg = result[1];
+
+        int correct_max = -1, correct_arg = -1;
+        for (int i = 0; i < 200; i++) {
+            int gi = (i * 37) % 23;
+            if (gi >= correct_max) {
+                correct_max = gi;
+                correct_arg = i;
+            }
+            if (out_max(i) != correct_max || out_arg(i) != correct_arg) {
+                printf("f(%d) = (%d, %d) instead of (%d, %d)\n",
+                       i, out_max(i), out_arg(i), correct_max, correct_arg);
+                return 1;
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,145 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    Var x, y;
+
+    {
+        // Check the known-answer vectors of the reference
+        // implementation, Random123, with the counter and key in
+        // buffers so that nothing gets constant-folded.
+        const uint32_t counters[3][4] = {{0, 0, 0, 0},
+                                         {0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff},
+                                         {0x243f6a88, 0x85a308d3, 0x13198a2e, 0x03707344}};
+        const uint32_t keys[3][2] = {{0, 0},
+                                     {0xffffffff, 0xffffffff},
+                                     {0xa4093822, 0x299f31d0}};
+        const uint32_t correct[3][4] = {{0x6627e8d5, 0xe169c58d, 0xbc57ac4c, 0x9b00dbd8},
+                                        {0x408f276d, 0x41c83b0e, 0xa20bc7c6, 0x6d5451fd},
+                                        {0xd16cfe09, 0x94fdcceb, 0x5001e420, 0x24126ea1}};
+
+        Buffer<uint32_t> counter(4, 3), key(2, 3);
+        for (int i = 0; i < 3; i++) {
+            for (int j = 0; j < 4; j++) {
+                counter(j, i) = counters[i][j];
+            }
+            key(0, i) = keys[i][0];
+            key(1, i) = keys[i][1];
+        }
+
+        Func f;
+        Tuple bits = philox4x32({counter(0, y), counter(1, y), counter(2, y), counter(3, y)},
+                                {key(0, y), key(1, y)});
+        f(x, y) = mux(x, {bits[0], bits[1], bits[2], bits[3]});
+        Buffer<uint32_t> result = f.realize({4, 3});
+
+        for (int i = 0; i < 3; i++) {
+            for (int j = 0; j < 4; j++) {
+                if (result(j, i) != correct[i][j]) {
+                    printf("philox4x32 test vector %d, word %d: %08x instead of %08x\n",
+                           i, j, result(j, i), correct[i][j]);
+                    return 1;
+                }
+            }
+        }
+
+        // The same, constant-folded.
+        for (int i = 0; i < 3; i++) {
+            std::vector<Expr> c, k;
+            for (int j = 0; j < 4; j++) {
+                c.emplace_back(counters[i][j]);
+            }
+            k.emplace_back(keys[i][0]);
+            k.emplace_back(keys[i][1]);
+            Tuple bits = philox4x32(c, k);
+            for (int j = 0; j < 4; j++) {
+                uint32_t r = evaluate<uint32_t>(bits[j]);
+                if (r != correct[i][j]) {
+                    printf("Constant philox4x32 test vector %d, word %d: %08x instead of %08x\n",
+                           i, j, r, correct[i][j]);
+                    return 1;
+                }
+            }
+        }
+    }
+
+    {
+        // The noise must not depend on the schedule.
+        Param<int> seed;
+        seed.set(17);
+        Func serial, vectorized, tiled;
+        for (Func *f : {&serial, &vectorized, &tiled}) {
+            Tuple bits = philox4x32({x, y}, {seed});
+            (*f)(x, y) = Tuple(random_bits_to_float(bits[0]), bits[3]);
+        }
+        Var xo, yo, xi, yi;
+        vectorized.vectorize(x, 16).parallel(y);
+        Target target = get_jit_target_from_environment();
+        if (target.has_gpu_feature()) {
+            tiled.gpu_tile(x, y, xo, yo, xi, yi, 16, 16);
+        } else {
+            tiled.tile(x, y, xo, yo, xi, yi, 8, 8).vectorize(xi, 4).unroll(yi).parallel(yo);
+        }
+
+        const int W = 333, H = 177;
+        Realization a = serial.realize({W, H});
+        Realization b = vectorized.realize({W, H});
+        Realization c = tiled.realize({W, H}, target);
+        Buffer<float> af = a[0], bf = b[0], cf = c[0];
+        Buffer<uint32_t> au = a[1], bu = b[1], cu = c[1];
+        cf.copy_to_host();
+        cu.copy_to_host();
+        for (int j = 0; j < H; j++) {
+            for (int i = 0; i < W; i++) {
+                if (af(i, j) != bf(i, j) || af(i, j) != cf(i, j) ||
+                    au(i, j) != bu(i, j) || au(i, j) != cu(i, j)) {
+                    printf("Schedule-dependent noise at %d, %d: %f %f %f, %u %u %u\n",
+                           i, j, af(i, j), bf(i, j), cf(i, j), au(i, j), bu(i, j), cu(i, j));
+                    return 1;
+                }
+                if (!(af(i, j) >= 0.0f && af(i, j) < 1.0f)) {
+                    printf("random_bits_to_float out of range at %d, %d: %f\n", i, j, af(i, j));
+                    return 1;
+                }
+            }
+        }
+
+        // Check the statistics of the floats.
+        double mean = 0, variance = 0;
+        for (int j = 0; j < H; j++) {
+            for (int i = 0; i < W; i++) {
+                mean += af(i, j);
+            }
+        }
+        mean /= W * H;
+        for (int j = 0; j < H; j++) {
+            for (int i = 0; i < W; i++) {
+                variance += (af(i, j) - mean) * (af(i, j) - mean);
+            }
+        }
+        variance /= W * H - 1;
+        if (std::abs(mean - 0.5) > 0.01 || std::abs(variance - 1.0 / 12) > 0.01) {
+            printf("Bad statistics: mean %f, variance %f\n", mean, variance);
+            return 1;
+        }
+
+        // A different key gives different noise.
+        seed.set(18);
+        Buffer<uint32_t> other = serial.realize({W, H})[1];
+        int same = 0;
+        for (int j = 0; j < H; j++) {
+            for (int i = 0; i < W; i++) {
+                same += other(i, j) == au(i, j);
+            }
+        }
+        if (same > 2) {
+            printf("%d of the words were the same with a different key\n", same);
+            return 1;
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,94 @@
+#include "Halide.h"
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    if (get_jit_target_from_environment().arch == Target::WebAssembly) {
+        printf("[SKIP] WebAssembly does not support async() yet.\n");
+        return 0;
+    }
+
+    // Pipeline a producer across the tiles of its consumer.
+    {
+        Func producer("producer"), consumer("consumer");
+        Var x, y, xo, yo, xi, yi;
+
+        producer(x, y) = x + y;
+        consumer(x, y) = producer(x - 1, y - 1) + producer(x, y) + producer(x + 1, y + 1);
+
+        consumer
+            .compute_root()
+            .tile(x, y, xo, yo, xi, yi, 16, 16, TailStrategy::RoundUp);
+        producer.pipeline_across(consumer, xo);
+
+        Buffer<int> out = consumer.realize({128, 128});
+
+        out.for_each_element([&](int x, int y) {
+            int correct = 3 * (x + y);
+            if (out(x, y) != correct) {
+                printf("out(%d, %d) = %d instead of %d\n",
+                       x, y, out(x, y), correct);
+                exit(1);
+            }
+        });
+    }
+
+    // Pipeline a producer across rows of strips, with a deeper ring buffer
+    // and a consumer with an update.
+    {
+        Func producer("producer"), consumer("consumer");
+        Var x, y, yo, yi;
+
+        producer(x, y) = x * y;
+        consumer(x, y) = producer(x, y) + producer(x, y + 1);
+        consumer(x, y) += 1;
+
+        consumer
+            .compute_root()
+            .split(y, yo, yi, 8, TailStrategy::RoundUp);
+        consumer.update()
+            .split(y, yo, yi, 8, TailStrategy::RoundUp);
+        producer.pipeline_across(LoopLevel(consumer, yo), 3);
+
+        Buffer<int> out = consumer.realize({64, 64});
+
+        out.for_each_element([&](int x, int y) {
+            int correct = x * y + x * (y + 1) + 1;
+            if (out(x, y) != correct) {
+                printf("out(%d, %d) = %d instead of %d\n",
+                       x, y, out(x, y), correct);
+                exit(1);
+            }
+        });
+    }
+
+    // Two producers pipelined across the same loop.
+    {
+        Func producer1("producer1"), producer2("producer2"), consumer("consumer");
+        Var x, y, xo, yo, xi, yi;
+
+        producer1(x, y) = x + y;
+        producer2(x, y) = x * y;
+        consumer(x, y) = producer1(x - 1, y - 1) + producer2(x, y) + producer1(x + 1, y + 1);
+
+        consumer
+            .compute_root()
+            .tile(x, y, xo, yo, xi, yi, 16, 16, TailStrategy::RoundUp);
+        producer1.pipeline_across(consumer, xo);
+        producer2.pipeline_across(consumer, xo);
+
+        Buffer<int> out = consumer.realize({128, 128});
+
+        out.for_each_element([&](int x, int y) {
+            int correct = 2 * (x + y) + x * y;
+            if (out(x, y) != correct) {
+                printf("out(%d, %d) = %d instead of %d\n",
+                       x, y, out(x, y), correct);
+                exit(1);
+            }
+        });
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -469,6 +469,45 @@ int test12(const Target &t) {
     return 0;
 }
 
+int test13(const Target &t) {
+    if (t.has_feature(Target::HVX)) {
+        // Automatic prefetching is not done for Hexagon.
+        return 0;
+    }
+    const Target auto_prefetch = t.with_feature(Target::AutoPrefetch);
+
+    Func f("f"), g("g"), h("h");
+    Var x("x"), y("y");
+
+    f(x, y) = x + y;
+    // A transpose reads down a column of f in the innermost loop...
+    g(x, y) = f(y, x);
+    // ...but a copy reads along a row.
+    h(x, y) = f(x, y) + g(x, y);
+
+    f.compute_root();
+    g.compute_root();
+
+    Module m = h.compile_to_module({}, "", auto_prefetch);
+    CollectPrefetches collect;
+    m.functions()[0].body.accept(&collect);
+
+    vector<vector<Expr>> expected = {{Variable::make(Handle(), f.name()), wild<int>(), 1, get_stride(t, 4)}};
+    if (!check(expected, collect.prefetches)) {
+        return 1;
+    }
+
+    // Without the feature there are no prefetches.
+    m = h.compile_to_module({}, "", t);
+    CollectPrefetches collect_none;
+    m.functions()[0].body.accept(&collect_none);
+    expected.clear();
+    if (!check(expected, collect_none.prefetches)) {
+        return 1;
+    }
+    return 0;
+}
+
 }  // anonymous namespace
 
 int main(int argc, char **argv) {
@@ -476,7 +515,7 @@ int main(int argc, char **argv) {
     std::cout << "Testing target: " << t << "\n";
 
     using Fn = int (*)(const Target &t);
-    std::vector<Fn> tests = {test1, test2, test3, test4, test5, test6, test7, test8, test9, test10, test11, test12};
+    std::vector<Fn> tests = {test1, test2, test3, test4, test5, test6, test7, test8, test9, test10, test11, test12, test13};
 
     for (size_t i = 0; i < tests.size(); i++) {
         printf("Running prefetch test %d\n", (int)i + 1);
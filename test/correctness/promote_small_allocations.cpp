@@ -0,0 +1,125 @@
+#include "Halide.h"
+
+using namespace Halide;
+using namespace Halide::Internal;
+
+// Count the allocations of, and stores to, a Func.
+class CountAccesses : public IRMutator {
+    using IRMutator::visit;
+
+    Stmt visit(const Allocate *op) override {
+        if (op->name == name) {
+            allocs++;
+        }
+        return IRMutator::visit(op);
+    }
+
+    Stmt visit(const Store *op) override {
+        if (op->name == name) {
+            stores++;
+        }
+        return IRMutator::visit(op);
+    }
+
+    std::string name;
+
+public:
+    int allocs = 0, stores = 0;
+
+    explicit CountAccesses(const std::string &name)
+        : name(name) {
+    }
+};
+
+int main(int argc, char **argv) {
+    Buffer<int> in(67);
+    in.for_each_element([&](int x) { in(x) = x * 17 % 23; });
+
+    // A producer computed at the innermost, vectorized, loop of its
+    // consumer.
+    {
+        Func f("f"), g("g");
+        Var x("x"), xo("xo"), xi("xi");
+        f(x) = in(x) * 3 + 1;
+        g(x) = f(x) * f(x);
+
+        g.split(x, xo, xi, 8, TailStrategy::GuardWithIf).vectorize(xi);
+        f.compute_at(g, xi);
+
+        CountAccesses counter(f.name());
+        g.add_custom_lowering_pass(&counter, nullptr);
+        Buffer<int> out = g.realize({64});
+
+        for (int x = 0; x < 64; x++) {
+            int f_x = in(x) * 3 + 1;
+            if (out(x) != f_x * f_x) {
+                printf("out(%d) = %d instead of %d\n", x, out(x), f_x * f_x);
+                return 1;
+            }
+        }
+        if (counter.allocs != 0 || counter.stores != 0) {
+            printf("f should have been kept in registers, but has %d allocations and %d stores\n",
+                   counter.allocs, counter.stores);
+            return 1;
+        }
+    }
+
+    // A small stencil, with the producer unrolled.
+    {
+        Func f("f"), g("g");
+        Var x("x"), xo("xo"), xi("xi");
+        f(x) = in(x) - 5;
+        g(x) = f(x) + 2 * f(x + 1) + f(x + 2);
+
+        g.split(x, xo, xi, 8, TailStrategy::GuardWithIf).vectorize(xi);
+        f.compute_at(g, xi).unroll(x);
+
+        CountAccesses counter(f.name());
+        g.add_custom_lowering_pass(&counter, nullptr);
+        Buffer<int> out = g.realize({64});
+
+        for (int x = 0; x < 64; x++) {
+            int correct = (in(x) - 5) + 2 * (in(x + 1) - 5) + (in(x + 2) - 5);
+            if (out(x) != correct) {
+                printf("out(%d) = %d instead of %d\n", x, out(x), correct);
+                return 1;
+            }
+        }
+        if (counter.allocs != 0 || counter.stores != 0) {
+            printf("f should have been kept in registers, but has %d allocations and %d stores\n",
+                   counter.allocs, counter.stores);
+            return 1;
+        }
+    }
+
+    // A producer that is too large to keep in registers stays in memory.
+    {
+        Func f("f"), g("g");
+        Var x("x"), y("y");
+        f(x, y) = x + y;
+        g(x) = 0;
+        RDom r(0, 64, 0, 64);
+        g(x) += f(r.x, r.y) + x;
+
+        f.compute_at(g, x);
+
+        CountAccesses counter(f.name());
+        g.add_custom_lowering_pass(&counter, nullptr);
+        Buffer<int> out = g.realize({4});
+
+        for (int x = 0; x < 4; x++) {
+            int correct = 64 * 64 * (63 + x);
+            if (out(x) != correct) {
+                printf("out(%d) = %d instead of %d\n", x, out(x), correct);
+                return 1;
+            }
+        }
+        if (counter.allocs == 0) {
+            printf("f should have stayed in memory\n");
+            return 1;
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
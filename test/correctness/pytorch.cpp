@@ -126,6 +126,9 @@ int test1_argv(void **args);
 HALIDE_FUNCTION_ATTRS
 const struct halide_filter_metadata_t *test1_metadata();
 
+HALIDE_FUNCTION_ATTRS
+int test1_batch(int batch_size, void **argvs);
+
 #ifdef __cplusplus
 }  // extern "C"
 #endif
@@ -134,9 +137,6 @@ HALIDE_FUNCTION_ATTRS
 inline int test1_th_(float _alpha, int32_t _beta, at::Tensor &_buf) {
     void* __user_context = nullptr;
 
-    // Check tensors have contiguous memory and are on the correct device
-    HLPT_CHECK_CONTIGUOUS(_buf);
-
     // Wrap tensors in Halide buffers
     Halide::Runtime::Buffer<int32_t> _buf_buffer = Halide::PyTorch::wrap<int32_t>(_buf);
 
@@ -209,6 +209,9 @@ int test2_argv(void **args);
 HALIDE_FUNCTION_ATTRS
 const struct halide_filter_metadata_t *test2_metadata();
 
+HALIDE_FUNCTION_ATTRS
+int test2_batch(int batch_size, void **argvs);
+
 #ifdef __cplusplus
 }  // extern "C"
 #endif
@@ -227,8 +230,13 @@ inline int test2_th_(float _alpha, int32_t _beta, at::Tensor &_buf) {
     user_ctx.stream = &stream;
     void* __user_context = (void*) &user_ctx;
 
-    // Check tensors have contiguous memory and are on the correct device
-    HLPT_CHECK_CONTIGUOUS(_buf);
+    // Pool freed device allocations for reuse, since allocating and
+    // freeing CUDA memory synchronizes with the device.
+    static const bool reuse_device_allocations =
+        (halide_reuse_device_allocations(nullptr, true), true);
+    (void)reuse_device_allocations;
+
+    // Check tensors are on the correct device
     HLPT_CHECK_DEVICE(_buf, device_id);
 
     // Wrap tensors in Halide buffers
@@ -249,6 +257,45 @@ inline int test2_th_(float _alpha, int32_t _beta, at::Tensor &_buf) {
         compare_src(actual, expected);
     }
 
+    {
+        // A pipeline with the signature build_gradient_module gives the
+        // gradient of an op out(x) = f(input(x)) should get an autograd
+        // Function too.
+        ImageParam input(Float(32), 1, "input");
+        ImageParam d_out(Float(32), 1, "_grad_loss_for_out");
+        Func d_input("_grad_loss_out_wrt_input");
+        d_input(x) = d_out(x) * 2.0f * input(x);
+
+        Target t = Target("x86-64-linux");
+
+        std::string pytorch_out = Internal::get_test_tmp_dir() + "pytorch_test3.pytorch.h";
+        Internal::ensure_no_file_exists(pytorch_out);
+
+        std::vector<Argument> args{input, d_out};
+        d_input.compile_to({{OutputFileType::pytorch_wrapper, pytorch_out}}, args, "test3", t);
+
+        Internal::assert_file_exists(pytorch_out);
+        std::string actual = read_entire_file(pytorch_out);
+
+        for (const char *expected : {
+                 "template<int (*Forward)(at::Tensor &, at::Tensor &)>\n"
+                 "struct test3_autograd : public torch::autograd::Function<test3_autograd<Forward>> {\n",
+                 "static torch::autograd::variable_list forward(torch::autograd::AutogradContext *ctx, "
+                 "at::Tensor _input, at::Tensor _out) {\n",
+                 "int err = Forward(_input, _out);\n",
+                 "at::Tensor _grad_loss_for_out = grad_outputs[0];\n",
+                 "at::Tensor _grad_loss_out_wrt_input = at::empty_like(_input, _input.options().dtype<float>());\n",
+                 "int err = test3_th_(_input, _grad_loss_for_out, _grad_loss_out_wrt_input);\n",
+             }) {
+            if (actual.find(expected) == std::string::npos) {
+                std::cerr << "Expected to find:\n"
+                          << expected << "\nin:\n"
+                          << actual;
+                exit(1);
+            }
+        }
+    }
+
     printf("Success!\n");
     return 0;
 }
@@ -0,0 +1,75 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    ImageParam input(Int(32), 2, "input");
+    Var x, y;
+    Func blur;
+    RDom r(-1, 3, -1, 3);
+    blur(x, y) = sum(input(x + r.x, y + r.y));
+    blur.vectorize(x, 8).parallel(y);
+
+    const int width = 300, height = 200;
+    const int tile_width = 64, tile_height = 48;
+
+    // The input, which is never held in memory at once, is x + y * 1000.
+    int reads = 0;
+    auto read_input = [&](const std::string &name, Buffer<> &region) {
+        if (name != "input" || region.dim(0).extent() != tile_width + 2 || region.dim(1).extent() != tile_height + 2) {
+            printf("Unexpected read of %s [%d, %d] x [%d, %d]\n", name.c_str(),
+                   region.dim(0).min(), region.dim(0).extent(), region.dim(1).min(), region.dim(1).extent());
+            exit(1);
+        }
+        Buffer<int> typed = region;
+        typed.for_each_element([&](int i, int j) {
+            typed(i, j) = i + j * 1000;
+        });
+        reads++;
+    };
+
+    Buffer<int> output(width, height);
+    output.fill(-1);
+    int writes = 0;
+    auto write_output = [&](Realization &tile) {
+        Buffer<int> t = tile[0];
+        if (t.width() != tile_width || t.height() != tile_height) {
+            printf("Tile has the wrong size: %d x %d\n", t.width(), t.height());
+            exit(1);
+        }
+        t.for_each_element([&](int i, int j) {
+            output(i, j) = t(i, j);
+        });
+        writes++;
+    };
+
+    Pipeline p(blur);
+    p.realize_streaming({width, height}, {tile_width, tile_height}, read_input, write_output);
+
+    // The edge tiles are shifted inwards, so there are as many as
+    // there'd be with a partial tile at each edge.
+    const int tiles = ((width + tile_width - 1) / tile_width) * ((height + tile_height - 1) / tile_height);
+    if (reads != tiles || writes != tiles) {
+        printf("Expected %d tiles, got %d reads and %d writes\n", tiles, reads, writes);
+        return 1;
+    }
+
+    for (int j = 0; j < height; j++) {
+        for (int i = 0; i < width; i++) {
+            const int correct = 9 * (i + j * 1000);
+            if (output(i, j) != correct) {
+                printf("output(%d, %d) = %d instead of %d\n", i, j, output(i, j), correct);
+                return 1;
+            }
+        }
+    }
+
+    if (input.get().defined()) {
+        printf("The streamed input should be left unbound\n");
+        return 1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
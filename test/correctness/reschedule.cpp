@@ -1,5 +1,6 @@
 #include "Halide.h"
 #include <stdio.h>
+#include <string.h>
 
 using namespace Halide;
 
@@ -18,6 +19,16 @@ int my_trace(JITUserContext *user_context, const halide_trace_event_t *ev) {
     return 0;
 }
 
+int wrapper_stores = 0;
+
+// A trace that counts stores to the wrapper of f
+int wrapper_trace(JITUserContext *user_context, const halide_trace_event_t *ev) {
+    if (ev->event == halide_trace_store && strstr(ev->func, "_in_") != nullptr) {
+        wrapper_stores++;
+    }
+    return 0;
+}
+
 int main(int argc, char **argv) {
     Func f;
     Var x;
@@ -38,6 +49,38 @@ int main(int argc, char **argv) {
         return 1;
     }
 
+    // A wrapper added after the pipeline was first lowered must show up
+    // when it is lowered again.
+    {
+        Func f, g;
+        Var x;
+        f(x) = x;
+        g(x) = f(x) * 2;
+        Pipeline p(g);
+        p.jit_handlers().custom_trace = &wrapper_trace;
+
+        Buffer<int> result_1 = p.realize({10});
+        if (wrapper_stores != 0) {
+            printf("There should have been no stores to a wrapper\n");
+            return 1;
+        }
+
+        f.in(g).compute_root().trace_stores();
+        p.invalidate_cache();
+
+        Buffer<int> result_2 = p.realize({10});
+        if (wrapper_stores != 10) {
+            printf("There should have been 10 stores to the wrapper instead of %d\n", wrapper_stores);
+            return 1;
+        }
+        for (int i = 0; i < 10; i++) {
+            if (result_1(i) != i * 2 || result_2(i) != i * 2) {
+                printf("result(%d) = %d, %d instead of %d\n", i, result_1(i), result_2(i), i * 2);
+                return 1;
+            }
+        }
+    }
+
     printf("Success!\n");
     return 0;
 }
@@ -0,0 +1,69 @@
+#include "Halide.h"
+#include "halide_test_dirs.h"
+
+#include <cmath>
+#include <cstdio>
+#include <string>
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    Var x("x"), y("y");
+    Func a("a"), b("b"), c("c");
+    a(x, y) = cast<float>(x + y);
+    // c is inlined into b, so it's accounted for in b.
+    c(x, y) = a(x, y) * 2.0f;
+    b(x, y) = (c(x - 1, y) + c(x, y) + c(x + 1, y)) / 3.0f;
+    a.compute_root();
+    b.set_estimates({{0, 1000}, {0, 1000}});
+
+    std::vector<Internal::StageRoofline> stages = Internal::estimate_roofline({b.function()});
+    if (stages.size() != 2 || stages[0].func != "a" || stages[1].func != "b") {
+        printf("Expected the stages of a and b, in that order\n");
+        return 1;
+    }
+    const Internal::StageRoofline &sa = stages[0], &sb = stages[1];
+    if (sa.points != 1002 * 1000 || sb.points != 1000 * 1000) {
+        printf("Wrong numbers of points: %f %f\n", sa.points, sb.points);
+        return 1;
+    }
+    if (sa.bytes_loaded != 0 || sb.bytes_loaded != 1002 * 1000 * 4 || sb.bytes_stored != 1000 * 1000 * 4) {
+        printf("Wrong traffic estimates: %f %f %f\n", sa.bytes_loaded, sb.bytes_loaded, sb.bytes_stored);
+        return 1;
+    }
+    // b loads three values of a for each one it stores, but most of them
+    // are loaded more than once.
+    if (sb.bytes_accessed < 2 * sb.bytes_loaded || !(sb.arith > sa.arith) || !(sb.intensity() > 0)) {
+        printf("Wrong cost estimates: %f %f %f\n", sb.bytes_accessed, sb.arith, sa.arith);
+        return 1;
+    }
+
+    const std::string report =
+        "b\n"
+        " total time: 3.500000 ms  samples: 10  runs: 1  time per run: 3.500000 ms\n"
+        " heap allocations: 1  peak heap usage: 4008000 bytes\n"
+        "    [funcs]:           0.000ms   ( 0.0%)\n"
+        "    a:                 1.500ms   (42.8%)    threads: 1.000\n"
+        "    b:                 2.000ms   (57.1%)    threads: 1.000\n"
+        "    a (copy to device): 0.100ms  ( 2.8%)\n";
+    std::map<std::string, double> times = Internal::parse_profiler_func_times(report);
+    if (times.size() != 3 || std::abs(times["a"] - 1.5e-3) > 1e-9 || std::abs(times["b"] - 2e-3) > 1e-9) {
+        printf("Didn't parse the profiler report correctly\n");
+        return 1;
+    }
+
+    std::string filename = Internal::get_test_tmp_dir() + "roofline_report.html";
+    Internal::ensure_no_file_exists(filename);
+    Pipeline(b).compile_to_roofline_html(filename, report, 100e9, 20e9);
+    Internal::assert_file_exists(filename);
+    std::vector<char> contents = Internal::read_entire_file(filename);
+    std::string html(contents.begin(), contents.end());
+    if (html.find("<svg") == std::string::npos || html.find("<circle") == std::string::npos ||
+        html.find(">b.s0<") == std::string::npos) {
+        printf("The roofline report is missing the plot of b\n");
+        return 1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -285,6 +285,13 @@ public:
 
             check(arm32 ? "vhsub.s32" : "shsub", 2 * w, (i32_1 - i32_2) / 2);
 
+            // Gathers from tables of up to 256 bytes
+            if (!arm32) {
+                check("tbl", 8 * w, in_u8(i32(u8_1 % 64)));
+                check("tbx", 8 * w, in_u8(i32(u8_1)));
+                check("tbx", 8 * w, in_i8(i32(u8_1)));
+            }
+
             // VLD1     X       -       Load Single-Element Structures
             // dense loads with unknown alignments should use vld1 variants
             check(arm32 ? "vld1.8" : "ldr", 8 * w, in_i8(x + y));
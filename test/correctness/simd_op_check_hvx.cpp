@@ -655,6 +655,23 @@ public:
         check("vnormamt(v*.w)", hvx_width / 4, max(count_leading_zeros(i32_1), count_leading_zeros(~i32_1)));
         check("vpopcount(v*.h)", hvx_width / 2, popcount(u16_1));
 
+        if (isa_version >= 68) {
+            // Float arithmetic, computed in qfloat and converted back.
+            Expr f16_1 = in_f16(x), f16_2 = in_f16(x + 16), f16_3 = in_f16(x + 32);
+            check("vadd(v*.sf,v*.sf)", hvx_width / 4, f32_1 + f32_2);
+            check("vsub(v*.sf,v*.sf)", hvx_width / 4, f32_1 - f32_2);
+            check("vmpy(v*.sf,v*.sf)", hvx_width / 4, f32_1 * f32_2);
+            check("vadd(v*.qf32,v*.sf)", hvx_width / 4, f32_1 * f32_2 + f32_3);
+            check("vsub(v*.qf32,v*.sf)", hvx_width / 4, f32_1 * f32_2 - f32_3);
+            check("vfmax(v*.sf,v*.sf)", hvx_width / 4, max(f32_1, f32_2));
+            check("vfmin(v*.sf,v*.sf)", hvx_width / 4, min(f32_1, f32_2));
+            check("vadd(v*.hf,v*.hf)", hvx_width / 2, f16_1 + f16_2);
+            check("vmpy(v*.hf,v*.hf)", hvx_width / 2, f16_1 * f16_2);
+            check("vadd(v*.qf16,v*.hf)", hvx_width / 2, f16_1 * f16_2 + f16_3);
+            check("vfmax(v*.hf,v*.hf)", hvx_width / 2, max(f16_1, f16_2));
+            check("vfmin(v*.hf,v*.hf)", hvx_width / 2, min(f16_1, f16_2));
+        }
+
         check("v* = vdelta(v*, v*)", hvx_width, in_u8((x / 8) * 9 + x % 8));
         check("v* = vdelta(v*, v*)", hvx_width / 2, in_u16((x / 8) * 9 + x % 8));
         check("v* = vdelta(v*, v*)", hvx_width / 4, in_u32((x / 8) * 9 + x % 8));
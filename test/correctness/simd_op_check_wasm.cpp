@@ -16,6 +16,7 @@ public:
     SimdOpCheckWASM(Target t, int w = 768, int h = 128)
         : SimdOpCheckTest(t, w, h) {
         use_wasm_simd128 = target.has_feature(Target::WasmSimd128);
+        use_wasm_relaxed_simd = target.has_feature(Target::WasmRelaxedSimd);
         use_wasm_sign_ext = !target.has_feature(Target::WasmMvpOnly);
         use_wasm_sat_float_to_int = !target.has_feature(Target::WasmMvpOnly);
     }
@@ -98,14 +99,11 @@ public:
                 check("i8x16.shuffle", 8 * w, in_u16(2 * x));
                 check("i8x16.shuffle", 4 * w, in_u32(2 * x));
 
-                // Swizzling using variable indices
-                // (This fails to generate, but that's not entirely surprising -- I don't
-                // think we ever attempt to emit the most general-purpose swizzles in Halide
-                // code, so this may or may not be a defect.)
-                //
-                // TODO: this currently emits a bunch of extract_lane / replace_lane ops,
-                // so we should definitely try to do better.
+                // Swizzling using variable indices. General gathers still emit a
+                // bunch of extract_lane / replace_lane ops, but lookups into a
+                // table of at most 16 bytes become swizzles.
                 // check("v8x16.swizzle", 16*w, in_u8(in_u8(x+32)));
+                check(use_wasm_relaxed_simd ? "i8x16.relaxed_swizzle" : "i8x16.swizzle", 16 * w, in_u8(in_u8(x) & 15));
 
                 // Integer addition
                 check("i8x16.add", 16 * w, i8_1 + i8_2);
@@ -134,6 +132,19 @@ public:
                     }
                 }
 
+                if (use_wasm_relaxed_simd) {
+                    // Relaxed integer dot products (8 x 7 -> 16 and 32)
+                    RDom r2(0, 2), r4(0, 4);
+                    check("i16x8.relaxed_dot_i8x16_i7x16_s", 8 * w, sum(i16(in_i8(2 * x + r2)) * i16(in_u8(2 * x + r2 + 32) & 127)));
+                    check("i32x4.relaxed_dot_i8x16_i7x16_add_s", 4 * w, sum(i32(in_i8(4 * x + r4)) * i32(in_u8(4 * x + r4 + 32) & 127)));
+
+                    // Relaxed fused multiply-add
+                    check("f32x4.relaxed_madd", 4 * w, f32_1 * f32_2 + f32_3);
+                    check("f32x4.relaxed_nmadd", 4 * w, f32_3 - f32_1 * f32_2);
+                    check("f64x2.relaxed_madd", 2 * w, f64_1 * f64_2 + f64_3);
+                    check("f64x2.relaxed_nmadd", 2 * w, f64_3 - f64_1 * f64_2);
+                }
+
                 // Integer negation
                 check("i8x16.neg", 16 * w, -i8_1);
                 check("i16x8.neg", 8 * w, -i16_1);
@@ -531,6 +542,7 @@ public:
 
 private:
     bool use_wasm_simd128{false};
+    bool use_wasm_relaxed_simd{false};
     bool use_wasm_sat_float_to_int{false};
     bool use_wasm_sign_ext{false};
     const Var x{"x"}, y{"y"};
@@ -548,6 +560,7 @@ int main(int argc, char **argv) {
         {
             Target("wasm-32-wasmrt"),
             Target("wasm-32-wasmrt-wasm_simd128"),
+            Target("wasm-32-wasmrt-wasm_simd128-wasm_relaxed_simd"),
             Target("wasm-32-wasmrt-wasm_mvponly"),
         });
 }
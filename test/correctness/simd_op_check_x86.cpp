@@ -594,6 +594,14 @@ public:
 #endif
         }
         if (use_avx512) {
+            // Gathers from small tables
+            check("vpermw", 32, in_u16(i32(u8_1 % 32)));
+            check("vperm*2w", 32, in_u16(i32(u8_1 % 64)));
+            check("vpermd", 16, in_i32(i32(u8_1 % 16)));
+            if (target.has_feature(Target::AVX512_Cannonlake)) {
+                check("vpermb", 64, in_u8(i32(u8_1 % 64)));
+                check("vperm*2b", 64, in_u8(i32(u8_1)));
+            }
             check("vpabsq", 8, abs(i64_1));
             check("vpmaxuq", 8, max(u64_1, u64_2));
             check("vpminuq", 8, min(u64_1, u64_2));
@@ -627,6 +635,9 @@ public:
                 RDom r(0, 4);
                 check("vpdpbusd*zmm", 16, sum(i32(in_u8(4 * x + r)) * in_i8(4 * x + r + 32)));
                 check("vpdpbusd*zmm", 16, sum(i32(in_i8(4 * x + r)) * in_u8(4 * x + r + 32)));
+                // Matching signs get biased onto the mixed-sign instruction.
+                check("vpdpbusd*zmm", 16, sum(i32(in_i8(4 * x + r)) * in_i8(4 * x + r + 32)));
+                check("vpdpbusd*zmm", 16, sum(i32(in_u8(4 * x + r)) * in_u8(4 * x + r + 32)));
                 if (use_avx_vnni) {
                     check("vpdpbusd*ymm", 8, sum(i32(in_u8(4 * x + r)) * in_i8(4 * x + r + 32)));
                     check("vpdpbusd*ymm", 8, sum(i32(in_i8(4 * x + r)) * in_u8(4 * x + r + 32)));
@@ -634,6 +645,12 @@ public:
                     check("vpdpbusd*xmm", 4, sum(i32(in_i8(4 * x + r)) * in_u8(4 * x + r + 32)));
                 }
             }
+            {
+                // 8 bit, 8 and 16 element dot products
+                RDom r8(0, 8), r16(0, 16);
+                check("vpdpbusd*zmm", 16, sum(i32(in_u8(8 * x + r8)) * in_i8(8 * x + r8 + 32)));
+                check("vpdpbusd*zmm", 16, sum(i32(in_u8(16 * x + r16)) * in_i8(16 * x + r16 + 32)));
+            }
             {
                 // 16 bit, 2 element saturaing dot product
                 RDom r(0, 2);
@@ -268,6 +268,29 @@ int main(int argc, char **argv) {
         output.realize({100, 100});
     }
 
+    {
+        // Skip a producer on the tiles of its consumer that a coarse mask
+        // marks as unneeded. The condition varies per pixel of the
+        // consumer, but is constant over each tile.
+        Func mask("mask"), producer("producer"), consumer("consumer");
+        Var xo, yo, xi, yi;
+        mask(x, y) = (x + y) % 4 == 0;
+        producer(x, y) = call_counter(x + y, 0);
+        consumer(x, y) = select(mask(x / 16, y / 16), producer(x, y), 0);
+
+        consumer
+            .bound(x, 0, 128)
+            .bound(y, 0, 128)
+            .tile(x, y, xo, yo, xi, yi, 16, 16, TailStrategy::RoundUp);
+        mask.compute_root();
+        producer.compute_at(consumer, xo);
+
+        reset_counts();
+        consumer.realize({128, 128});
+        // 16 of the 8x8 tiles are active.
+        check_counts(16 * 16 * 16);
+    }
+
     printf("Success!\n");
     return 0;
 }
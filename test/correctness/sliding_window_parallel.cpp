@@ -0,0 +1,50 @@
+#include "Halide.h"
+#include <atomic>
+#include <stdio.h>
+
+using namespace Halide;
+
+std::atomic<int> count{0};
+extern "C" HALIDE_EXPORT_SYMBOL int call_counter(int x, int y) {
+    count++;
+    return x + y;
+}
+HalideExtern_2(int, call_counter, int, int);
+
+int main(int argc, char **argv) {
+    Var x, y;
+
+    // A producer stored outside a parallel loop over rows of its consumer
+    // should still slide over the rows of each strip of the loop.
+    for (int rows : {1000, 997, 3}) {
+        count = 0;
+        Func f, g;
+
+        f(x, y) = call_counter(x, y);
+        g(x, y) = f(x, y - 1) + f(x, y) + f(x, y + 1);
+
+        f.store_root().compute_at(g, y);
+        g.parallel(y);
+
+        const int width = 10;
+        Buffer<int> out = g.realize({width, rows});
+
+        out.for_each_element([&](int x, int y) {
+            int correct = 3 * (x + y);
+            if (out(x, y) != correct) {
+                printf("out(%d, %d) = %d instead of %d\n", x, y, out(x, y), correct);
+                exit(1);
+            }
+        });
+
+        // Without sliding, each row of g would compute three rows of f. With
+        // it, each strip computes two extra rows to warm up.
+        if (rows > 3 && count >= 3 * width * rows) {
+            printf("f was called %d times, so it didn't slide\n", count.load());
+            return 1;
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,72 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    const int W = 64, H = 48, N = 100;
+
+    // A list of points, some of them repeated, and a few outside the
+    // bounds of the image.
+    Buffer<int> coords(2, N);
+    for (int i = 0; i < N; i++) {
+        coords(0, i) = (i * 37) % (W + 8) - 4;
+        coords(1, i) = (i * 11) % H;
+    }
+
+    Buffer<int> correct_count(W, H);
+    correct_count.fill(0);
+    for (int i = 0; i < N; i++) {
+        int x = coords(0, i), y = coords(1, i);
+        if (x >= 0 && x < W) {
+            correct_count(x, y)++;
+        }
+    }
+
+    Var x("x"), y("y");
+
+    {
+        // Scatter: count how many times each pixel is listed.
+        SparseRDom p(coords, {{0, W}, {0, H}});
+        Func count("count");
+        count(x, y) = 0;
+        count(p[0], p[1]) += 1;
+
+        Buffer<int> out = count.realize({W, H});
+        out.for_each_element([&](int x, int y) {
+            if (out(x, y) != correct_count(x, y)) {
+                printf("count(%d, %d) = %d instead of %d\n",
+                       x, y, out(x, y), correct_count(x, y));
+                exit(1);
+            }
+        });
+    }
+
+    {
+        // Gather: sum an image at the listed points. Without the bounds
+        // of the SparseRDom, the access to the input would be unbounded.
+        Buffer<int> input(W, H);
+        input.for_each_element([&](int x, int y) { input(x, y) = x + y * W; });
+
+        ImageParam coords_param(Int(32), 2);
+        SparseRDom p(coords_param, {{0, W}, {0, H}});
+        Func total("total");
+        total() = 0;
+        total() += input(p[0], p[1]);
+
+        coords_param.set(coords);
+        Buffer<int> out = total.realize();
+
+        int correct = 0;
+        correct_count.for_each_element([&](int x, int y) {
+            correct += correct_count(x, y) * input(x, y);
+        });
+        if (out() != correct) {
+            printf("total() = %d instead of %d\n", out(), correct);
+            return 1;
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -708,6 +708,77 @@ int main(int argc, char **argv) {
         _halide_user_assert(vector_store_lanes == 32);
     }
 
+    {
+        Var x;
+        Param<int> p;
+
+        // Check that we prune specializations that can't be reached
+        // because the conditions of earlier ones are false.
+        Func f;
+        f(x) = x;
+        f.specialize(p > 10).vectorize(x, 32);  // will *not* be pruned
+        f.specialize(p > 20).vectorize(x, 16);  // implies p > 10, so will be pruned
+        f.specialize(p <= 10).vectorize(x, 8);  // will *not* be pruned, but is always taken if reached
+        f.specialize(p == 3).vectorize(x, 4);   // will be pruned
+
+        _halide_user_assert(f.function().definition().specializations().size() == 4);
+
+        std::map<std::string, Internal::Function> env;
+        env.insert({f.function().name(), f.function()});
+        simplify_specializations(env);
+
+        _halide_user_assert(f.function().definition().specializations().size() == 2);
+
+        f.jit_handlers().custom_trace = &my_trace;
+        f.trace_stores();
+
+        vector_store_lanes = 0;
+        p.set(30);
+        f.realize({100});
+        _halide_user_assert(vector_store_lanes == 32);
+
+        vector_store_lanes = 0;
+        p.set(3);
+        f.realize({100});
+        _halide_user_assert(vector_store_lanes == 8);
+    }
+
+    {
+        Var x;
+        Param<int> p;
+        Param<bool> q;
+
+        // Check that dispatching on the index of the first true condition
+        // picks the same specializations as testing them in order.
+        Target t = get_jit_target_from_environment().with_feature(Target::SpecializationDispatch);
+        Func f;
+        f(x) = x;
+        f.specialize(q).vectorize(x, 2);
+        f.specialize(p == 0).vectorize(x, 32);
+        f.specialize(p == 1).vectorize(x, 16);
+        f.specialize(p == 2).vectorize(x, 8);
+        f.specialize(p == 3).vectorize(x, 4);
+        f.jit_handlers().custom_trace = &my_trace;
+        f.trace_stores();
+
+        // The default schedule makes scalar stores.
+        const int expected_lanes[] = {32, 16, 8, 4, 0};
+        for (int i = 0; i < 5; i++) {
+            for (bool b : {false, true}) {
+                vector_store_lanes = 0;
+                p.set(i);
+                q.set(b);
+                f.realize({100}, t);
+                const int expected = b ? 2 : expected_lanes[i];
+                if (vector_store_lanes != expected) {
+                    printf("With p = %d and q = %d, stores had %d lanes instead of %d\n",
+                           i, (int)b, vector_store_lanes, expected);
+                    return 1;
+                }
+            }
+        }
+    }
+
     printf("Success!\n");
     return 0;
 }
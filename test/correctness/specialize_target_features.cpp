@@ -0,0 +1,106 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+// Count the functions outlined for a specialization, and check the
+// features they are compiled with.
+int count_specialized_functions(const Module &m, const std::string &features) {
+    int count = 0;
+    for (const auto &f : m.functions()) {
+        if (!f.target_features.empty()) {
+            if (f.target_features != features) {
+                printf("Function %s compiled with features %s instead of %s\n",
+                       f.name.c_str(), f.target_features.c_str(), features.c_str());
+                exit(1);
+            }
+            count++;
+        }
+    }
+    return count;
+}
+
+int main(int argc, char **argv) {
+    ImageParam in(Float(32), 1, "in");
+    Var x("x"), xo("xo"), xi("xi");
+
+    Func f("f");
+    f(x) = in(x) * 3.0f + in(x + 1);
+    f.vectorize(x, 4);
+    f.specialize_target_features({Target::FMA, Target::AVX2}).vectorize(x, 8);
+
+    // Retrieving the specialization doesn't depend on the order of the features.
+    f.specialize_target_features({Target::AVX2, Target::FMA}).vectorize(x, 8);
+
+    const Target sse("x86-64-linux-sse41");
+
+    {
+        Module m = f.compile_to_module({in}, "f", sse);
+        int count = count_specialized_functions(m, "avx2-fma");
+        if (count != 1) {
+            printf("Expected one specialized function, got %d\n", count);
+            return 1;
+        }
+    }
+
+    {
+        // No need to dispatch if the target already has the features.
+        Module m = f.compile_to_module({in}, "f", sse.with_feature(Target::AVX2).with_feature(Target::FMA));
+        int count = count_specialized_functions(m, "");
+        if (count != 0) {
+            printf("Expected no specialized functions, got %d\n", count);
+            return 1;
+        }
+    }
+
+    // Parallel loops inside the specialization are compiled with its features too.
+    Func g("g");
+    g(x) = in(x) * 2.0f;
+    g.split(x, xo, xi, 64).parallel(xo).vectorize(xi, 4);
+    g.specialize_target_features({Target::AVX2}).vectorize(xi, 8);
+    {
+        Module m = g.compile_to_module({in}, "g", sse);
+        int count = count_specialized_functions(m, "avx2");
+        if (count != 2) {
+            printf("Expected a specialized function and its parallel loop body, got %d\n", count);
+            return 1;
+        }
+    }
+
+    // Check the results, without the features in the target so that
+    // the version used depends on the CPU.
+    Target t = get_jit_target_from_environment();
+    if (t.arch == Target::X86) {
+        t = t.without_feature(Target::AVX512)
+                .without_feature(Target::AVX512_Skylake)
+                .without_feature(Target::AVX512_Cannonlake)
+                .without_feature(Target::AVX512_Zen4)
+                .without_feature(Target::AVX512_SapphireRapids)
+                .without_feature(Target::AVX10_1)
+                .without_feature(Target::AVX2)
+                .without_feature(Target::FMA);
+
+        const int size = 1024;
+        Buffer<float> in_buf(size + 1);
+        in_buf.for_each_element([&](int x) { in_buf(x) = (float)((x * 17) % 23); });
+        in.set(in_buf);
+
+        Buffer<float> f_out = f.realize({size}, t);
+        Buffer<float> g_out = g.realize({size}, t);
+        for (int x = 0; x < size; x++) {
+            float correct_f = in_buf(x) * 3.0f + in_buf(x + 1);
+            float correct_g = in_buf(x) * 2.0f;
+            if (f_out(x) != correct_f) {
+                printf("f(%d) = %f instead of %f\n", x, f_out(x), correct_f);
+                return 1;
+            }
+            if (g_out(x) != correct_g) {
+                printf("g(%d) = %f instead of %f\n", x, g_out(x), correct_g);
+                return 1;
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
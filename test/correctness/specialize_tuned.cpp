@@ -0,0 +1,91 @@
+#include "Halide.h"
+#include <cmath>
+#include <stdio.h>
+
+using namespace Halide;
+using namespace Halide::Internal;
+
+// Count the calls to the given extern function.
+class CountCalls : public IRVisitor {
+    using IRVisitor::visit;
+
+    void visit(const Call *op) override {
+        if (op->name == name) {
+            count++;
+        }
+        IRVisitor::visit(op);
+    }
+
+public:
+    std::string name;
+    int count = 0;
+    CountCalls(const std::string &name)
+        : name(name) {
+    }
+};
+
+int count_calls(const Module &m, const std::string &name) {
+    CountCalls counter(name);
+    for (const auto &f : m.functions()) {
+        f.body.accept(&counter);
+    }
+    return counter.count;
+}
+
+int main(int argc, char **argv) {
+    Target target = get_jit_target_from_environment();
+
+    const int W = 256, H = 64;
+    Buffer<float> input(W, H);
+    input.for_each_element([&](int x, int y) { input(x, y) = x * 0.5f + y; });
+
+    Var x("x"), y("y"), xo("xo"), yo("yo"), xi("xi"), yi("yi");
+
+    Func f("f"), g("g");
+    f(x, y) = input(x, y) * 2.0f + 1.0f;
+    g(x, y) = f(x, y) + f(x, y + 1);
+    g.bound(y, 0, H - 1);
+
+    if (target.has_gpu_feature()) {
+        f.compute_root().gpu_tile_variants(x, y, xo, yo, xi, yi, {{8, 8}, {16, 16}, {32, 8}});
+        g.gpu_tile(x, y, xo, yo, xi, yi, 16, 16);
+    } else {
+        f.compute_root()
+            .parallel(y)
+            .vectorize(x, 4);
+        // The variants use different tails, so they need different
+        // bounds for f.
+        f.specialize_tuned(0, 3).vectorize(x, 8, TailStrategy::RoundUp);
+        f.specialize_tuned(1, 3).vectorize(x, 16, TailStrategy::GuardWithIf);
+    }
+
+    // Each variant is chosen once at the top of the pipeline, and its
+    // producer is timed.
+    {
+        Module m = g.compile_to_module({}, "g", target);
+        int chooses = count_calls(m, "halide_choose_size_variant");
+        int reports = count_calls(m, "halide_report_size_variant_time");
+        if (chooses != 1 || reports != 1) {
+            printf("%d calls to halide_choose_size_variant and %d to "
+                   "halide_report_size_variant_time, instead of one each\n",
+                   chooses, reports);
+            return 1;
+        }
+    }
+
+    // The first runs try each variant a few times, and then settle on
+    // one. All of them must give the right answer.
+    for (int i = 0; i < 12; i++) {
+        Buffer<float> out = g.realize({W - 1, H - 1}, target);
+        out.for_each_element([&](int x, int y) {
+            float correct = (input(x, y) * 2.0f + 1.0f) + (input(x, y + 1) * 2.0f + 1.0f);
+            if (std::abs(out(x, y) - correct) > 1e-4f) {
+                printf("out(%d, %d) = %f instead of %f in run %d\n", x, y, out(x, y), correct, i);
+                exit(1);
+            }
+        });
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -187,6 +187,18 @@ int main(int argc, char **argv) {
         checker.check_not(f, 0);
     }
 
+    // Wider strides are still worth densifying if the whole span is only a
+    // few vectors, as it is for a short vector of bytes.
+    {
+        ImageParam buf_u8(UInt(8), 1, "buf_u8");
+        Func f;
+        Var x;
+        f(x) = buf_u8(8 * x);
+        f.vectorize(x, 4, TailStrategy::RoundUp);
+
+        checker.check(f, 2, "buf_u8");
+    }
+
     // Strided loads to external allocations are handled by doing a weird-sized
     // dense load and then shuffling.
     {
@@ -575,6 +575,39 @@ int main(int argc, char **argv) {
         Buffer<int> im = output.realize({64, 64});
     }
 
+    {
+        custom_malloc_sizes.clear();
+        Func f, g;
+        Param<int> p;
+        RDom r(0, p);
+
+        g(x, y) = x * y;
+        f(x, y) = sum(g(x, y + r));
+
+        // The size of the stencil isn't known at compile time, so the
+        // fold factor is computed at runtime, rounded up to a power of
+        // two.
+        g.compute_at(f, y).store_root();
+
+        p.set(5);
+        Buffer<int> im = f.realize({1000, 100});
+
+        size_t expected_size = 1000 * 8 * sizeof(int);
+        if (!check_expected_mallocs({expected_size})) {
+            return 1;
+        }
+
+        for (int y = 0; y < im.height(); y++) {
+            for (int x = 0; x < im.width(); x++) {
+                int correct = x * (5 * y + 10);
+                if (im(x, y) != correct) {
+                    printf("im(%d, %d) = %d instead of %d\n", x, y, im(x, y), correct);
+                    return 1;
+                }
+            }
+        }
+    }
+
     printf("Success!\n");
     return 0;
 }
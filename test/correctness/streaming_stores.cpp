@@ -0,0 +1,74 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+using namespace Halide::Internal;
+
+class CountStreamingStores : public IRMutator {
+    using IRMutator::visit;
+
+    Stmt visit(const Store *op) override {
+        if (Call::as_intrinsic(op->value, {Call::nontemporal_store})) {
+            streaming_stores.insert(op->name);
+        }
+        return IRMutator::visit(op);
+    }
+
+    Expr visit(const Call *op) override {
+        if (op->is_intrinsic(Call::store_fence)) {
+            fences++;
+        }
+        return IRMutator::visit(op);
+    }
+
+public:
+    std::set<std::string> streaming_stores;
+    int fences = 0;
+};
+
+int main(int argc, char **argv) {
+    Func f("f"), g("g"), h("h");
+    Var x("x"), y("y");
+
+    f(x, y) = x + y;
+    g(x, y) = f(x, y) * 2;
+    h(x, y) = g(x, y) + 1;
+
+    f.compute_root().vectorize(x, 8).parallel(y);
+    // A large intermediate that isn't read back any time soon
+    g.compute_root().store_in(MemoryType::Streaming).vectorize(x, 8).parallel(y);
+    // and a write-once output.
+    h.output_buffer().store_in(MemoryType::Streaming);
+    h.vectorize(x, 8).parallel(y);
+
+    CountStreamingStores counter;
+    h.add_custom_lowering_pass(&counter, []() {});
+
+    const int size = 256;
+    Buffer<int> out = h.realize({size, size});
+
+    if (counter.streaming_stores != std::set<std::string>{"g", "h"}) {
+        printf("Expected streaming stores to g and h only\n");
+        return 1;
+    }
+
+    // One fence at the end of each parallel task and one at the end of
+    // each producer.
+    if (counter.fences != 4) {
+        printf("Expected 4 fences instead of %d\n", counter.fences);
+        return 1;
+    }
+
+    for (int y = 0; y < size; y++) {
+        for (int x = 0; x < size; x++) {
+            int correct = (x + y) * 2 + 1;
+            if (out(x, y) != correct) {
+                printf("out(%d, %d) = %d instead of %d\n", x, y, out(x, y), correct);
+                return 1;
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
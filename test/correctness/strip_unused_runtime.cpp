@@ -0,0 +1,43 @@
+#include "Halide.h"
+#include "halide_test_dirs.h"
+
+#include <cstdio>
+
+using namespace Halide;
+
+uint64_t object_size(Target t, const std::string &name) {
+    Func f("f");
+    Var x, y;
+    f(x, y) = x + y;
+    f.parallel(y).vectorize(x, 8);
+
+    const std::string object = Internal::get_test_tmp_dir() + name + (t.os == Target::Windows ? ".obj" : ".o");
+    Internal::ensure_no_file_exists(object);
+    f.compile_to_object(object, {}, name, t);
+    Internal::assert_file_exists(object);
+    return Internal::file_stat(object).file_size;
+}
+
+int main(int argc, char **argv) {
+    Target t = get_target_from_environment().without_feature(Target::NoRuntime);
+    if (t.arch == Target::WebAssembly) {
+        printf("[SKIP] WebAssembly objects are linked differently.\n");
+        return 0;
+    }
+
+    uint64_t full = object_size(t, "strip_unused_runtime_full");
+    uint64_t stripped = object_size(t.with_feature(Target::StripUnusedRuntime),
+                                    "strip_unused_runtime_stripped");
+
+    // The pipeline uses the thread pool, but none of tracing, the
+    // memoization cache, or the profiler, so the object should shrink.
+    printf("Object size: %llu bytes with the full runtime, %llu with strip_unused_runtime\n",
+           (unsigned long long)full, (unsigned long long)stripped);
+    if (stripped >= full) {
+        printf("Stripping the runtime didn't make the object smaller\n");
+        return 1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,70 @@
+#include "Halide.h"
+#include <chrono>
+#include <mutex>
+#include <set>
+#include <stdio.h>
+#include <thread>
+
+using namespace Halide;
+
+std::mutex ids_mutex;
+std::set<std::thread::id> ids;
+
+extern "C" HALIDE_EXPORT_SYMBOL int record_thread(int x) {
+    {
+        std::lock_guard<std::mutex> lock(ids_mutex);
+        ids.insert(std::this_thread::get_id());
+    }
+    std::this_thread::sleep_for(std::chrono::microseconds(200));
+    return x;
+}
+HalideExtern_1(int, record_thread, int);
+
+void run(Func f, int size) {
+    Buffer<int> out = f.realize({size});
+    for (int x = 0; x < size; x++) {
+        if (out(x) != x) {
+            printf("out(%d) = %d instead of %d\n", x, out(x), x);
+            exit(1);
+        }
+    }
+}
+
+int main(int argc, char **argv) {
+    if (get_jit_target_from_environment().arch == Target::WebAssembly) {
+        printf("[SKIP] WebAssembly JIT does not support threads.\n");
+        return 0;
+    }
+
+    Func f;
+    Var x;
+    f(x) = record_thread(x);
+    f.parallel(x);
+    f.compile_jit();
+
+    Internal::JITSharedRuntime::set_num_threads(8);
+    Internal::JITSharedRuntime::set_thread_pool_creation_policy(halide_thread_pool_create_on_demand);
+
+    // A loop with two tasks only needs one worker besides the calling
+    // thread, so no more should have been created to run it.
+    for (int i = 0; i < 5; i++) {
+        run(f, 2);
+    }
+    if (ids.size() > 2) {
+        printf("%d threads ran a loop with two tasks\n", (int)ids.size());
+        return 1;
+    }
+
+    // Creating the rest of the threads up front leaves the pool working.
+    if (Internal::JITSharedRuntime::thread_pool_prewarm() != 0) {
+        printf("thread_pool_prewarm failed\n");
+        return 1;
+    }
+    run(f, 256);
+
+    Internal::JITSharedRuntime::set_thread_pool_creation_policy(halide_thread_pool_create_eager);
+    run(f, 256);
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,76 @@
+#include "Halide.h"
+#include <atomic>
+#include <chrono>
+#include <stdio.h>
+#include <thread>
+
+using namespace Halide;
+
+std::atomic<int> active{0}, max_active{0};
+
+extern "C" HALIDE_EXPORT_SYMBOL int track_concurrency(int x) {
+    int a = ++active;
+    int m = max_active;
+    while (a > m && !max_active.compare_exchange_weak(m, a)) {
+    }
+    std::this_thread::sleep_for(std::chrono::microseconds(200));
+    active--;
+    return x;
+}
+HalideExtern_1(int, track_concurrency, int);
+
+int run(Func f, JITUserContext *context) {
+    max_active = 0;
+    Buffer<int> out = f.realize(context, {256});
+    for (int x = 0; x < 256; x++) {
+        if (out(x) != x) {
+            printf("out(%d) = %d instead of %d\n", x, out(x), x);
+            exit(1);
+        }
+    }
+    return max_active;
+}
+
+int main(int argc, char **argv) {
+    if (get_jit_target_from_environment().arch == Target::WebAssembly) {
+        printf("[SKIP] WebAssembly JIT does not support threads.\n");
+        return 0;
+    }
+
+    Internal::JITSharedRuntime::set_num_threads(8);
+
+    Func f;
+    Var x;
+    f(x) = track_concurrency(x);
+    f.parallel(x);
+    f.compile_jit();
+
+    // Limit the pipelines run with this context to two threads.
+    JITUserContext capped;
+    if (Internal::JITSharedRuntime::set_thread_pool_qos(&capped, 2, 1) != 0) {
+        printf("set_thread_pool_qos failed\n");
+        return 1;
+    }
+    for (int i = 0; i < 5; i++) {
+        int m = run(f, &capped);
+        if (m > 2) {
+            printf("%d threads ran at once, instead of at most 2\n", m);
+            return 1;
+        }
+    }
+
+    // Other contexts aren't limited. (That they use more than two
+    // threads can't be relied on, so just check they still work.)
+    JITUserContext other;
+    run(f, &other);
+
+    // Return to the defaults.
+    if (Internal::JITSharedRuntime::set_thread_pool_qos(&capped, 0, 0) != 0) {
+        printf("set_thread_pool_qos failed\n");
+        return 1;
+    }
+    run(f, &capped);
+
+    printf("Success!\n");
+    return 0;
+}
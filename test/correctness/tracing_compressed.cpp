@@ -0,0 +1,160 @@
+#include "Halide.h"
+#include "halide_test_dirs.h"
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+using namespace Halide;
+
+namespace {
+
+// A minimal LZ4 block decoder, so this test is independent of the one in
+// util/HalideTraceUtils.cpp.
+bool decompress(const uint8_t *src, size_t src_size, std::vector<uint8_t> &dst) {
+    const uint8_t *end = src + src_size;
+    size_t out = 0;
+    const auto get_length = [&](size_t n) {
+        uint8_t b;
+        do {
+            b = *src++;
+            n += b;
+        } while (b == 255 && src < end);
+        return n;
+    };
+    while (src < end) {
+        uint8_t token = *src++;
+        size_t literals = token >> 4;
+        if (literals == 15) {
+            literals = get_length(literals);
+        }
+        if (out + literals > dst.size() || src + literals > end) {
+            return false;
+        }
+        memcpy(dst.data() + out, src, literals);
+        src += literals;
+        out += literals;
+        if (src == end) {
+            break;
+        }
+        size_t offset = src[0] | (src[1] << 8);
+        src += 2;
+        size_t length = token & 15;
+        if (length == 15) {
+            length = get_length(length);
+        }
+        length += 4;
+        if (offset == 0 || offset > out || out + length > dst.size()) {
+            return false;
+        }
+        for (size_t i = 0; i < length; i++, out++) {
+            dst[out] = dst[out - offset];
+        }
+    }
+    return out == dst.size();
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+#ifdef _WIN32
+    printf("[SKIP] Windows does not have a working setenv\n");
+#else
+    if (get_jit_target_from_environment().arch == Target::WebAssembly) {
+        printf("[SKIP] WebAssembly JIT does not support writing trace files.\n");
+        return 0;
+    }
+
+    std::string trace_file = Internal::get_test_tmp_dir() + "tracing_compressed.trace";
+    Internal::ensure_no_file_exists(trace_file);
+    setenv("HL_TRACE_FILE", trace_file.c_str(), 1);
+    setenv("HL_TRACE_COMPRESS", "1", 1);
+
+    // Enough stores to fill the trace buffer a few times over, so the
+    // buffers are swapped and several blocks are written.
+    const int size = 512;
+    Func f;
+    Var x, y;
+    f(x, y) = x + y * 3;
+    f.trace_stores();
+    f.bound(x, 0, size).bound(y, 0, size).parallel(y);
+    f.realize({size, size});
+
+    std::vector<char> file = Internal::read_entire_file(trace_file);
+    size_t cursor = 0, uncompressed = 0;
+    int blocks = 0, compressed_blocks = 0, stores = 0, pipelines = 0;
+    std::vector<bool> seen(size * size, false);
+    while (cursor < file.size()) {
+        halide_trace_block_header_t header;
+        if (cursor + sizeof(header) > file.size()) {
+            printf("Truncated block header at %d\n", (int)cursor);
+            return 1;
+        }
+        memcpy(&header, file.data() + cursor, sizeof(header));
+        if (header.magic != HALIDE_TRACE_BLOCK_MAGIC) {
+            printf("Expected a block at %d\n", (int)cursor);
+            return 1;
+        }
+        cursor += sizeof(header);
+        if (cursor + header.compressed_size > file.size()) {
+            printf("Truncated block at %d\n", (int)cursor);
+            return 1;
+        }
+
+        std::vector<uint8_t> packets(header.uncompressed_size);
+        const uint8_t *payload = (const uint8_t *)file.data() + cursor;
+        if (header.compressed_size == header.uncompressed_size) {
+            memcpy(packets.data(), payload, packets.size());
+        } else if (decompress(payload, header.compressed_size, packets)) {
+            compressed_blocks++;
+        } else {
+            printf("Could not decompress block %d\n", blocks);
+            return 1;
+        }
+        cursor += header.compressed_size;
+        uncompressed += header.uncompressed_size;
+        blocks++;
+
+        uint32_t num_packets = 0;
+        for (size_t i = 0; i < packets.size(); num_packets++) {
+            const halide_trace_packet_t *p = (const halide_trace_packet_t *)(packets.data() + i);
+            if (p->size < sizeof(halide_trace_packet_t) || i + p->size > packets.size()) {
+                printf("Bad packet size %d in block %d\n", (int)p->size, blocks);
+                return 1;
+            }
+            i += p->size;
+            if (p->event == halide_trace_begin_pipeline) {
+                pipelines++;
+            } else if (p->event == halide_trace_store) {
+                const int *c = p->coordinates();
+                int value;
+                memcpy(&value, p->value(), sizeof(value));
+                if (p->dimensions != 2 || c[0] < 0 || c[0] >= size || c[1] < 0 || c[1] >= size ||
+                    value != c[0] + c[1] * 3 || seen[c[0] + c[1] * size]) {
+                    printf("Bad store packet in block %d\n", blocks);
+                    return 1;
+                }
+                seen[c[0] + c[1] * size] = true;
+                stores++;
+            }
+        }
+        if (num_packets != header.num_packets) {
+            printf("Block %d has %d packets, but its header says %d\n", blocks, num_packets, header.num_packets);
+            return 1;
+        }
+    }
+
+    if (pipelines != 1 || stores != size * size) {
+        printf("Expected one pipeline and %d stores, got %d and %d\n", size * size, pipelines, stores);
+        return 1;
+    }
+    if (blocks < 2 || compressed_blocks == 0 || file.size() * 2 > uncompressed) {
+        printf("Expected several well-compressed blocks, got %d blocks (%d compressed) of %d bytes in %d bytes\n",
+               blocks, compressed_blocks, (int)uncompressed, (int)file.size());
+        return 1;
+    }
+
+    printf("Success!\n");
+#endif
+    return 0;
+}
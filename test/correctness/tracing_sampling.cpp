@@ -0,0 +1,106 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+namespace {
+
+// The rows stored to, and the number of loads and stores traced.
+std::vector<int> rows_stored;
+int loads = 0, stores = 0;
+
+int my_trace(JITUserContext *user_context, const halide_trace_event_t *e) {
+    if (e->event == halide_trace_store) {
+        for (int i = 0; i < e->type.lanes; i++) {
+            rows_stored[e->coordinates[e->type.lanes + i]]++;
+        }
+        stores++;
+    } else if (e->event == halide_trace_load) {
+        loads++;
+    }
+    return 0;
+}
+
+void run(Func f, int width, int height) {
+    rows_stored.assign(height, 0);
+    loads = stores = 0;
+    f.jit_handlers().custom_trace = &my_trace;
+    f.realize({width, height});
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    const int width = 8, height = 24;
+    Var x("x"), y("y"), yo("yo"), yi("yi");
+
+    {
+        // Trace every third tile of four rows.
+        Func g("g"), f("f");
+        g(x, y) = x + y;
+        f(x, y) = g(x, y) * 2;
+        g.compute_root().trace_loads();
+        f.trace_stores();
+        f.split(y, yo, yi, 4).sample_tracing(yo, TraceSampling::EveryNth, 3);
+        run(f, width, height);
+        for (int r = 0; r < height; r++) {
+            const int expected = (r / 4) % 3 == 0 ? width : 0;
+            if (rows_stored[r] != expected) {
+                printf("EveryNth: %d stores to row %d instead of %d\n", rows_stored[r], r, expected);
+                return 1;
+            }
+        }
+        if (loads != stores) {
+            printf("EveryNth: %d loads traced, but %d stores\n", loads, stores);
+            return 1;
+        }
+    }
+
+    {
+        // Trace only the first row of a vectorized Func.
+        Func f("f");
+        f(x, y) = x * y;
+        f.trace_stores();
+        f.vectorize(x, 4).parallel(y).sample_tracing(y, TraceSampling::FirstN, 1);
+        run(f, width, height);
+        for (int r = 0; r < height; r++) {
+            const int expected = r == 0 ? width : 0;
+            if (rows_stored[r] != expected) {
+                printf("FirstN: %d stores to row %d instead of %d\n", rows_stored[r], r, expected);
+                return 1;
+            }
+        }
+    }
+
+    {
+        // Trace a random quarter of rows, which should be the same rows
+        // each time.
+        Func f("f");
+        f(x, y) = x - y;
+        f.trace_stores();
+        f.sample_tracing(y, TraceSampling::Random, 4);
+        const int tall = 1024;
+        run(f, width, tall);
+        std::vector<int> first = rows_stored;
+        int sampled = 0;
+        for (int r = 0; r < tall; r++) {
+            if (first[r] != 0 && first[r] != width) {
+                printf("Random: row %d was only partly traced\n", r);
+                return 1;
+            }
+            sampled += first[r] != 0;
+        }
+        if (sampled < tall / 8 || sampled > tall / 2) {
+            printf("Random: %d of %d rows traced\n", sampled, tall);
+            return 1;
+        }
+        run(f, width, tall);
+        if (rows_stored != first) {
+            printf("Random: different rows traced on the second run\n");
+            return 1;
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,92 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+using namespace Halide::Internal;
+
+// Count the asserts on entry to a pipeline and those in its body, and the
+// producers.
+class CountAsserts : public IRVisitor {
+    using IRVisitor::visit;
+
+    int depth = 0;
+
+    void visit(const AssertStmt *op) override {
+        (depth ? inner : entry)++;
+        IRVisitor::visit(op);
+    }
+
+    void visit(const ProducerConsumer *op) override {
+        producers++;
+        depth++;
+        IRVisitor::visit(op);
+        depth--;
+    }
+
+    void visit(const Allocate *op) override {
+        depth++;
+        IRVisitor::visit(op);
+        depth--;
+    }
+
+public:
+    int entry = 0, inner = 0, producers = 0;
+};
+
+CountAsserts count(const Module &m, const std::string &name) {
+    CountAsserts c;
+    m.get_function_by_name(name).body.accept(&c);
+    printf("%s: %d entry asserts, %d inner asserts, %d producers\n",
+           name.c_str(), c.entry, c.inner, c.producers);
+    return c;
+}
+
+int main(int argc, char **argv) {
+    ImageParam input(Float(32), 2, "input");
+    Param<float> scale("scale");
+    Var x, y;
+
+    Func f("f"), g("g");
+    f(x, y) = input(x, y) * scale;
+    g(x, y) = f(x, y) + f(x + 1, y);
+    f.compute_root();
+    Var yo, yi;
+    g.split(y, yo, yi, 8).parallel(yo);
+
+    Target t = get_jit_target_from_environment().with_feature(Target::TrustedEntry);
+    Module m = g.compile_to_module({input, scale}, "g", t);
+
+    CountAsserts checked = count(m, "g");
+    CountAsserts check = count(m, "g_check");
+    CountAsserts unchecked = count(m, "g_unchecked");
+
+    if (checked.entry == 0 || checked.producers == 0) {
+        printf("Expected the pipeline to check its arguments\n");
+        return 1;
+    }
+    if (check.entry != checked.entry || check.inner != 0 || check.producers != 0) {
+        printf("g_check should only contain the entry checks of g\n");
+        return 1;
+    }
+    if (unchecked.entry != 0 || unchecked.inner != checked.inner ||
+        unchecked.producers != checked.producers) {
+        printf("g_unchecked should be g without its entry checks\n");
+        return 1;
+    }
+
+    // The checked entry point is unaffected.
+    Buffer<float> in(33, 17);
+    in.fill(1.0f);
+    input.set(in);
+    scale.set(2.0f);
+    Buffer<float> out = g.realize({32, 17}, t);
+    out.for_each_value([&](float v) {
+        if (v != 4.0f) {
+            printf("Expected 4, got %f\n", v);
+            exit(1);
+        }
+    });
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,96 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+namespace {
+
+int check_matmul(Func c, const Buffer<float> &a, const Buffer<float> &b, int size) {
+    Buffer<float> out = c.realize({size, size});
+    for (int y = 0; y < size; y++) {
+        for (int x = 0; x < size; x++) {
+            float correct = 0.0f;
+            for (int k = 0; k < size; k++) {
+                correct += a(k, y) * b(x, k);
+            }
+            if (std::abs(out(x, y) - correct) > 1e-3f * size) {
+                printf("%s(%d, %d) = %f instead of %f\n", c.name().c_str(), x, y, out(x, y), correct);
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    const int size = 37;
+    Buffer<float> a(size, size), b(size, size);
+    for (int y = 0; y < size; y++) {
+        for (int x = 0; x < size; x++) {
+            a(x, y) = (float)((x * 7 + y * 3) % 11) - 5;
+            b(x, y) = (float)((x * 5 + y * 13) % 9) - 4;
+        }
+    }
+
+    Target target = get_jit_target_from_environment();
+    Var x("x"), y("y"), xi("xi"), yi("yi");
+
+    // A register-blocked matrix multiply, with a fixed jam factor and
+    // one picked for the target.
+    for (bool automatic : {false, true}) {
+        Func c(automatic ? "c_auto" : "c_fixed");
+        RDom k(0, size);
+        c(x, y) = 0.0f;
+        c(x, y) += a(k, y) * b(x, k);
+        Stage s = c.update();
+        s.split(x, x, xi, 8).reorder(xi, k, x, y).vectorize(xi);
+        if (automatic) {
+            s.unroll_and_jam(y, yi, target);
+        } else {
+            s.unroll_and_jam(y, yi, 4);
+        }
+        if (check_matmul(c, a, b, size)) {
+            return 1;
+        }
+
+        // The jammed loop is inside the reduction, with only the
+        // vectorized loop inside it.
+        const std::vector<Internal::Dim> &dims = c.function().update(0).schedule().dims();
+        if (!Internal::ends_with(dims[0].var, ".xi") ||
+            !Internal::ends_with(dims[1].var, ".yi") ||
+            dims[1].for_type != Internal::ForType::Unrolled ||
+            dims[2].is_pure()) {
+            printf("Expected the loop over yi to be jammed into the loop over k\n");
+            return 1;
+        }
+    }
+
+    // Jamming a pure definition just unrolls and moves its loop inward.
+    {
+        Func f("f");
+        f(x, y) = x * 3 + y;
+        f.unroll_and_jam(y, yi, 3);
+        Buffer<int> out = f.realize({10, 10});
+        out.for_each_element([&](int x, int y) {
+            if (out(x, y) != x * 3 + y) {
+                printf("f(%d, %d) = %d instead of %d\n", x, y, out(x, y), x * 3 + y);
+                exit(1);
+            }
+        });
+    }
+
+    // The factor fits in the target's vector registers.
+    for (int regs : {1, 2, 4, 8, 64}) {
+        int factor = Internal::unroll_and_jam_factor(target, regs);
+        printf("%d registers per iteration: jam %d iterations\n", regs, factor);
+        if (factor < 1 || factor > 8 || (factor > 1 && factor * regs > 32)) {
+            printf("Bad jam factor\n");
+            return 1;
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
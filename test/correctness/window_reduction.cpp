@@ -0,0 +1,81 @@
+#include "Halide.h"
+#include <algorithm>
+#include <climits>
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    const int W = 173, H = 150;
+
+    Buffer<int> input(W, H);
+    input.for_each_value([](int &v) { v = rand() % 1000; });
+    Func clamped = BoundaryConditions::repeat_edge(input);
+
+    Target target = get_jit_target_from_environment();
+
+    for (int radius : {0, 3, 64}) {
+        for (int dim : {0, 1}) {
+            for (int op = 0; op < 3; op++) {
+                WindowReduction r;
+                if (op == 0) {
+                    r = WindowReduction::minimum(clamped, dim, radius);
+                } else if (op == 1) {
+                    r = WindowReduction::maximum(clamped, dim, radius);
+                } else {
+                    r = WindowReduction::sum(clamped, dim, radius);
+                }
+                // Vectorize across blocks, or across the other
+                // dimension, which is how it should be done along y.
+                r.schedule(target, LoopLevel::root(), dim == 0 ? -1 : 0);
+
+                Buffer<int> out = r.result().realize({W, H}, target);
+                out.for_each_element([&](int x, int y) {
+                    int correct = op == 0 ? INT_MAX : op == 1 ? INT_MIN : 0;
+                    for (int d = -radius; d <= radius; d++) {
+                        int v = dim == 0 ? input(std::clamp(x + d, 0, W - 1), y) :
+                                           input(x, std::clamp(y + d, 0, H - 1));
+                        correct = op == 0 ? std::min(correct, v) :
+                                  op == 1 ? std::max(correct, v) :
+                                            correct + v;
+                    }
+                    if (out(x, y) != correct) {
+                        printf("Window reduction %d of radius %d along dimension %d is %d at (%d, %d) instead of %d\n",
+                               op, radius, dim, out(x, y), x, y, correct);
+                        exit(1);
+                    }
+                });
+            }
+        }
+    }
+
+    // A 2D max filter, as a vertical pass and then a horizontal one.
+    {
+        const int radius = 20;
+        WindowReduction vert = WindowReduction::maximum(clamped, 1, radius);
+        WindowReduction horiz = WindowReduction::maximum(vert, 0, radius);
+        Func output = horiz;
+        Var y = output.args()[1];
+        if (!target.has_gpu_feature()) {
+            output.compute_root();
+            vert.schedule(target, LoopLevel::root(), 0);
+            horiz.schedule(target, LoopLevel(output, y));
+        }
+
+        Buffer<int> out = output.realize({W, H}, target);
+        out.for_each_element([&](int x, int y) {
+            int correct = INT_MIN;
+            for (int dy = -radius; dy <= radius; dy++) {
+                for (int dx = -radius; dx <= radius; dx++) {
+                    correct = std::max(correct, input(std::clamp(x + dx, 0, W - 1), std::clamp(y + dy, 0, H - 1)));
+                }
+            }
+            if (out(x, y) != correct) {
+                printf("2D max filter is %d at (%d, %d) instead of %d\n", out(x, y), x, y, correct);
+                exit(1);
+            }
+        });
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,92 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "HalideBuffer.h"
+#include "HalideRuntime.h"
+#include "allocation_tracker.h"
+
+using namespace Halide::Runtime;
+
+namespace {
+
+const halide_allocation_site_stats *find_site(const halide_allocation_pipeline_stats *p, const char *name) {
+    for (int i = 0; i < p->num_sites; i++) {
+        if (strcmp(p->sites[i].name, name) == 0) {
+            return &p->sites[i];
+        }
+    }
+    return nullptr;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    const int runs = 5, width = 256, height = 64;
+
+    Buffer<float, 2> input(width, height + 1);
+    input.fill(1.0f);
+    Buffer<float, 2> output(width, height);
+    for (int i = 0; i < runs; i++) {
+        int result = allocation_tracker(input, output);
+        if (result != 0) {
+            fprintf(stderr, "allocation_tracker failed: %d\n", result);
+            return 1;
+        }
+    }
+
+    // Bounds queries aren't counted as runs.
+    Buffer<float, 2> input_query(nullptr, 0, 0);
+    if (allocation_tracker(input_query, output) != 0) {
+        fprintf(stderr, "allocation_tracker bounds query failed\n");
+        return 1;
+    }
+
+    const halide_allocation_pipeline_stats *p = halide_allocation_tracker_get_pipelines();
+    while (p && strcmp(p->name, "allocation_tracker") != 0) {
+        p = (const halide_allocation_pipeline_stats *)p->next;
+    }
+    if (!p || p->runs != runs) {
+        fprintf(stderr, "Expected stats of %d runs of allocation_tracker\n", runs);
+        return 1;
+    }
+
+    const halide_allocation_site_stats *root = find_site(p, "tracked_root");
+    const halide_allocation_site_stats *tile = find_site(p, "tracked_tile");
+    const uint64_t root_bytes = width * (height + 1) * sizeof(float);
+    const uint64_t tile_bytes = width * 9 * sizeof(float);
+    if (!root || root->kind != halide_allocation_kind_heap || root->count != runs ||
+        root->peak_bytes != root_bytes || root->bytes_at_peak != root_bytes ||
+        !strstr(root->hint, "at root")) {
+        fprintf(stderr, "Bad stats for tracked_root\n");
+        return 1;
+    }
+    if (!tile || tile->count != runs * (height / 8) || tile->peak_bytes != tile_bytes ||
+        tile->bytes_at_peak != tile_bytes || !strstr(tile->hint, "output.s0.y.yo")) {
+        fprintf(stderr, "Bad stats for tracked_tile\n");
+        return 1;
+    }
+    if (p->peak_bytes != root_bytes + tile_bytes) {
+        fprintf(stderr, "Peak of %llu bytes instead of %llu\n",
+                (unsigned long long)p->peak_bytes, (unsigned long long)(root_bytes + tile_bytes));
+        return 1;
+    }
+
+    // The timeline ends at the peak: the first tile being allocated while
+    // tracked_root is live.
+    if (p->peak_timeline_length != 2 ||
+        p->peak_timeline[0].bytes != (int64_t)root_bytes ||
+        p->peak_timeline[1].live_bytes != p->peak_bytes) {
+        fprintf(stderr, "Bad peak timeline of %d events\n", p->peak_timeline_length);
+        return 1;
+    }
+
+    halide_allocation_tracker_report(nullptr);
+    halide_allocation_tracker_reset();
+    if (p->runs != 0 || p->peak_bytes != 0 || p->peak_timeline_length != 0) {
+        fprintf(stderr, "halide_allocation_tracker_reset didn't zero the stats\n");
+        return 1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
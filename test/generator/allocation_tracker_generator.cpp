@@ -0,0 +1,28 @@
+#include "Halide.h"
+
+namespace {
+
+class AllocationTracker : public Halide::Generator<AllocationTracker> {
+public:
+    Input<Buffer<float, 2>> input{"input"};
+    Output<Buffer<float, 2>> output{"output"};
+
+    void generate() {
+        Var x("x"), y("y"), yo("yo"), yi("yi");
+
+        Func tracked_root("tracked_root"), tracked_tile("tracked_tile");
+        tracked_root(x, y) = input(x, y) * 2.0f;
+        tracked_tile(x, y) = tracked_root(x, y) + 1.0f;
+        output(x, y) = tracked_tile(x, y) + tracked_tile(x, y + 1);
+
+        // tracked_root is live for the whole run, and tracked_tile is
+        // allocated once per tile of eight rows.
+        tracked_root.compute_root();
+        output.split(y, yo, yi, 8);
+        tracked_tile.compute_at(output, yo);
+    }
+};
+
+}  // namespace
+
+HALIDE_REGISTER_GENERATOR(AllocationTracker, allocation_tracker)
@@ -0,0 +1,92 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "HalideBuffer.h"
+#include "HalideRuntime.h"
+#include "debug_to_file_async.h"
+
+using namespace Halide::Runtime;
+
+namespace {
+
+const int W = 256, H = 64;
+
+// Check a .tmp file written by debug_to_file holds a W x H int32 image
+// with the value expected at each pixel.
+template<typename F>
+bool check_file(const char *file_name, F expected) {
+    FILE *f = fopen(file_name, "rb");
+    if (!f) {
+        fprintf(stderr, "Could not open %s\n", file_name);
+        return false;
+    }
+    int32_t header[5];
+    bool ok = fread(header, sizeof(header), 1, f) == 1;
+    // The extents of the four dimensions, and the type code of int32.
+    ok = ok && header[0] == W && header[1] == H && header[2] == 1 && header[3] == 1 && header[4] == 7;
+    if (!ok) {
+        fprintf(stderr, "Bad header in %s\n", file_name);
+    }
+    Buffer<int32_t, 2> contents(W, H);
+    ok = ok && fread(contents.data(), sizeof(int32_t), W * H, f) == (size_t)(W * H);
+    fclose(f);
+    if (!ok) {
+        return false;
+    }
+    for (int y = 0; y < H; y++) {
+        for (int x = 0; x < W; x++) {
+            if (contents(x, y) != expected(x, y)) {
+                fprintf(stderr, "%s(%d, %d) = %d instead of %d\n",
+                        file_name, x, y, contents(x, y), expected(x, y));
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    // Each run writes 128KB, so with 1MB pending at most, the pipelines
+    // have to wait for the writer some of the time.
+    halide_set_debug_to_file_async(1);
+
+    Buffer<int32_t, 2> output(W, H);
+    const int runs = 20;
+    for (int i = 0; i < runs; i++) {
+        int result = debug_to_file_async(i, output);
+        if (result != 0) {
+            fprintf(stderr, "debug_to_file_async failed: %d\n", result);
+            return 1;
+        }
+    }
+
+    int result = halide_debug_to_file_flush(nullptr);
+    if (result != 0) {
+        fprintf(stderr, "halide_debug_to_file_flush failed: %d\n", result);
+        return 1;
+    }
+
+    // The files are written in order, so they hold the images of the
+    // last run.
+    const int offset = runs - 1;
+    if (!check_file("debug_to_file_async_f.tmp", [&](int x, int y) { return x + y * 256 + offset; }) ||
+        !check_file("debug_to_file_async_g.tmp", [&](int x, int y) { return (x + y * 256 + offset) * 2; })) {
+        return 1;
+    }
+
+    // Turning the async mode off flushes, and later writes are synchronous.
+    halide_set_debug_to_file_async(0);
+    result = debug_to_file_async(100, output);
+    if (result != 0) {
+        fprintf(stderr, "debug_to_file_async failed: %d\n", result);
+        return 1;
+    }
+    if (!check_file("debug_to_file_async_f.tmp", [&](int x, int y) { return x + y * 256 + 100; })) {
+        return 1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,25 @@
+#include "Halide.h"
+
+namespace {
+
+class DebugToFileAsync : public Halide::Generator<DebugToFileAsync> {
+public:
+    Input<int> offset{"offset"};
+    Output<Buffer<int32_t, 2>> output{"output"};
+
+    void generate() {
+        Var x("x"), y("y");
+
+        Func f("f"), g("g");
+        f(x, y) = x + y * 256 + offset;
+        g(x, y) = f(x, y) * 2;
+        output(x, y) = g(x, y) + 1;
+
+        f.compute_root().debug_to_file("debug_to_file_async_f.tmp");
+        g.compute_root().debug_to_file("debug_to_file_async_g.tmp");
+    }
+};
+
+}  // namespace
+
+HALIDE_REGISTER_GENERATOR(DebugToFileAsync, debug_to_file_async)
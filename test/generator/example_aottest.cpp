@@ -35,6 +35,25 @@ int main(int argc, char **argv) {
     example(-1.234f, output);
     verify(output, compiletime_factor, -1.234f, channels);
 
+    // The _batch entry point makes many calls at once, each with its own
+    // group of argv-style arguments.
+    {
+        constexpr int kBatchSize = 4;
+        float factors[kBatchSize] = {1.0f, 2.0f, -0.5f, 7.25f};
+        Buffer<int32_t, 3> outputs[kBatchSize];
+        void *argvs[kBatchSize * 2];
+        for (int i = 0; i < kBatchSize; i++) {
+            outputs[i] = Buffer<int32_t, 3>(kSize, kSize, 3);
+            argvs[i * 2 + 0] = &factors[i];
+            argvs[i * 2 + 1] = outputs[i].raw_buffer();
+        }
+        int result = example_batch(kBatchSize, argvs);
+        assert(result == 0);
+        for (int i = 0; i < kBatchSize; i++) {
+            verify(outputs[i], compiletime_factor, factors[i], channels);
+        }
+    }
+
     printf("Success!\n");
     return 0;
 }
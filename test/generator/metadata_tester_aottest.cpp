@@ -5,6 +5,7 @@
 #include <iostream>
 #include <map>
 #include <string>
+#include <vector>
 
 #include "metadata_tester.function_info.h"
 #include "metadata_tester.h"
@@ -1339,6 +1340,33 @@ void check_metadata(const halide_filter_metadata_t &md, bool expect_ucon_at_0) {
         match_argument(expected[i], md.arguments[i]);
     }
 
+    // None of the buffers have stride constraints, beyond the default
+    // dense first dimension, so they all prefer planar layouts with
+    // padded rows.
+    for (int i = 0; i < md.num_arguments; ++i) {
+        const halide_filter_argument_t &a = md.arguments[i];
+        if (a.kind == halide_argument_kind_input_scalar) {
+            EXPECT_EQ(0, a.host_alignment);
+            EXPECT_EQ(halide_buffer_layout_unknown, a.layout);
+            EXPECT_EQ(0, a.padding);
+            continue;
+        }
+        EXPECT_EQ(a.type.bytes(), a.host_alignment);
+        EXPECT_EQ(a.dimensions > 0 ? halide_buffer_layout_planar : halide_buffer_layout_unknown, a.layout);
+        if (a.dimensions > 1) {
+            EXPECT_EQ(true, a.padding > 0);
+
+            std::vector<int> sizes(a.dimensions, 3);
+            sizes[0] = kSize + 1;
+            Buffer<> b = Buffer<>::make_for_argument(a, sizes);
+            EXPECT_EQ((int)a.type.bits, (int)b.type().bits);
+            EXPECT_EQ(kSize + 1, b.dim(0).extent());
+            EXPECT_EQ(0, b.dim(0).min());
+            EXPECT_EQ(1, b.dim(0).stride());
+            EXPECT_EQ(0, b.dim(1).stride() % a.padding);
+        }
+    }
+
     for (int i = 0; i < kExpectedArgumentCount; ++i) {
         delete kExpectedArguments[i].scalar_def;
         delete kExpectedArguments[i].scalar_min;
@@ -29,6 +29,13 @@ int main(int argc, char **argv) {
         return 1;
     }
 
+    std::string program_cache_dir = "/tmp/custom_program_cache";
+    halide_opencl_set_program_cache_dir(program_cache_dir.c_str());
+    if (program_cache_dir != halide_opencl_get_program_cache_dir(nullptr)) {
+        printf("Value returned from halide_opencl_get_program_cache_dir doesn't match\n");
+        return 1;
+    }
+
     printf("Success!\n");
 #else
     printf("[SKIP] Test requires OpenCL.\n");
@@ -0,0 +1,127 @@
+#include "HalideBuffer.h"
+#include "HalideRuntime.h"
+#include "halide_benchmark.h"
+#include "halide_parallel_runtime.h"
+
+#include <algorithm>
+#include <atomic>
+#include <stdio.h>
+#include <thread>
+#include <vector>
+
+#include "parallel_runtime_adapter.h"
+
+using namespace Halide::Runtime;
+using namespace Halide::Tools;
+
+namespace {
+
+// A stand-in for an application's scheduler, which starts threads for
+// each call, so that tasks really do run at the same time.
+class ThreadsExecutor : public ParallelExecutor {
+    int num_threads;
+
+public:
+    explicit ThreadsExecutor(int num_threads)
+        : num_threads(num_threads) {
+    }
+
+    int concurrency() const override {
+        return num_threads;
+    }
+
+    void parallel_for(int n, const std::function<void(int)> &f) override {
+        std::atomic<int> next{0};
+        auto worker = [&]() {
+            for (int i = next++; i < n; i = next++) {
+                f(i);
+            }
+        };
+        std::vector<std::thread> threads;
+        for (int i = 1; i < std::min(n, num_threads); i++) {
+            threads.emplace_back(worker);
+        }
+        worker();
+        for (std::thread &t : threads) {
+            t.join();
+        }
+    }
+};
+
+const int work = 20;
+
+bool check(const char *name, const Buffer<int, 3> &out) {
+    bool ok = true;
+    out.for_each_element([&](int x, int y, int z) {
+        int correct = 0;
+        for (int r = 0; r < work; r++) {
+            correct += (x + y * z + r) % 7 + (x + (y + 1) * z + r) % 7;
+        }
+        correct *= 2;
+        if (ok && out(x, y, z) != correct) {
+            printf("%s: out(%d, %d, %d) = %d instead of %d\n",
+                   name, x, y, z, out(x, y, z), correct);
+            ok = false;
+        }
+    });
+    return ok;
+}
+
+bool run(const char *name, ParallelExecutor *executor) {
+    if (executor) {
+        install_parallel_runtime(executor);
+    }
+
+    Buffer<int, 3> out(64, 64, 8);
+    int result = parallel_runtime_adapter(work, out);
+    bool ok = result == 0 && check(name, out);
+    if (result != 0) {
+        printf("%s: pipeline returned %d\n", name, result);
+    }
+
+    if (ok) {
+        double t = benchmark(5, 10, [&]() { parallel_runtime_adapter(work, out); });
+        printf("%-10s %8.3f ms, %d spare threads\n", name, t * 1e3,
+               executor ? parallel_runtime_spare_threads() : 0);
+    }
+
+    if (executor) {
+        uninstall_parallel_runtime();
+    }
+    return ok;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    const int num_threads = std::max((int)std::thread::hardware_concurrency(), 2);
+    halide_set_num_threads(num_threads);
+
+    bool ok = run("halide", nullptr);
+
+    // Everything on one thread, which must not deadlock.
+    SerialExecutor serial;
+    ok = ok && run("serial", &serial);
+
+    ThreadsExecutor threads(num_threads);
+    ok = ok && run("threads", &threads);
+
+#ifdef HALIDE_PARALLEL_RUNTIME_TBB
+    tbb::task_arena arena(num_threads);
+    TBBExecutor tbb_executor(arena);
+    ok = ok && run("tbb", &tbb_executor);
+#endif
+
+#ifdef HALIDE_PARALLEL_RUNTIME_OPENMP
+    omp_set_max_active_levels(4);
+    OpenMPExecutor omp_executor(num_threads);
+    ok = ok && run("openmp", &omp_executor);
+#endif
+
+    if (!ok) {
+        return 1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,37 @@
+#include "Halide.h"
+
+namespace {
+
+using namespace Halide;
+
+class ParallelRuntimeAdapter : public Generator<ParallelRuntimeAdapter> {
+public:
+    Input<int> work{"work"};
+    Output<Buffer<int, 3>> output{"output"};
+
+    void generate() {
+        // An async producer with parallel loops inside it, feeding a
+        // parallel consumer, inside a parallel loop: all of the kinds of
+        // parallelism the runtime has to schedule.
+        Var x, y, z, yo, yi;
+        Func producer("producer"), consumer("consumer");
+        RDom r(0, work);
+
+        producer(x, y, z) = sum((x + y * z + r) % 7);
+        consumer(x, y, z) = producer(x, y, z) + producer(x, y + 1, z);
+        output(x, y, z) = 2 * consumer(x, y, z);
+
+        output.parallel(z);
+        consumer.compute_at(output, z)
+            .split(y, yo, yi, 4)
+            .parallel(yi);
+        producer.store_at(output, z)
+            .compute_at(consumer, yo)
+            .parallel(y)
+            .async();
+    }
+};
+
+}  // namespace
+
+HALIDE_REGISTER_GENERATOR(ParallelRuntimeAdapter, parallel_runtime_adapter)
@@ -0,0 +1,106 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include "HalideBuffer.h"
+#include "HalideRuntime.h"
+#include "profiler_light.h"
+
+using namespace Halide::Runtime;
+
+namespace {
+
+const halide_profiler_light_func_stats *find_func(const halide_profiler_light_pipeline_stats *p, const char *name) {
+    for (int i = 0; i < p->num_funcs; i++) {
+        if (strcmp(p->funcs[i].name, name) == 0) {
+            return &p->funcs[i];
+        }
+    }
+    return nullptr;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    const int runs = 20;
+
+    Buffer<float, 2> input(256, 65);
+    input.fill(3.0f);
+    Buffer<float, 2> output(256, 64);
+    for (int i = 0; i < runs; i++) {
+        int result = profiler_light(input, output);
+        if (result != 0) {
+            fprintf(stderr, "profiler_light failed: %d\n", result);
+            return 1;
+        }
+    }
+    output.for_each_value([](float v) {
+        if (v != 4.0f) {
+            fprintf(stderr, "Output is %f instead of 4\n", v);
+            exit(1);
+        }
+    });
+
+    // Bounds queries aren't counted as runs.
+    Buffer<float, 2> input_query(nullptr, 0, 0);
+    int result = profiler_light(input_query, output);
+    if (result != 0) {
+        fprintf(stderr, "profiler_light bounds query failed: %d\n", result);
+        return 1;
+    }
+
+    const halide_profiler_light_pipeline_stats *p = halide_profiler_light_get_pipelines();
+    while (p && strcmp(p->name, "profiler_light") != 0) {
+        p = (const halide_profiler_light_pipeline_stats *)p->next;
+    }
+    if (!p) {
+        fprintf(stderr, "No light profiler stats for profiler_light\n");
+        return 1;
+    }
+    if (p->runs != runs || p->ticks == 0) {
+        fprintf(stderr, "Pipeline stats: %llu runs taking %llu ticks\n",
+                (unsigned long long)p->runs, (unsigned long long)p->ticks);
+        return 1;
+    }
+    if (find_func(p, "light_inlined")) {
+        fprintf(stderr, "light_inlined isn't computed at root, so shouldn't be timed\n");
+        return 1;
+    }
+    for (const char *name : {"light_producer", "output"}) {
+        const halide_profiler_light_func_stats *f = find_func(p, name);
+        if (!f || f->count != runs || f->ticks == 0 || f->ticks > p->ticks) {
+            fprintf(stderr, "Bad light profiler stats for %s\n", name);
+            return 1;
+        }
+    }
+
+    // Measure, then format, the metrics.
+    int length = halide_profiler_light_format_metrics(nullptr, nullptr, 0);
+    std::vector<char> metrics(length + 1);
+    if (halide_profiler_light_format_metrics(nullptr, metrics.data(), (int)metrics.size()) != length ||
+        (int)strlen(metrics.data()) != length) {
+        fprintf(stderr, "The length of the metrics changed\n");
+        return 1;
+    }
+    const std::string text(metrics.data());
+    for (const char *expected : {"# TYPE halide_pipeline_seconds_total counter\n",
+                                 "halide_pipeline_runs_total{pipeline=\"profiler_light\"} 20\n",
+                                 "halide_func_seconds_total{pipeline=\"profiler_light\",func=\"light_producer\"} ",
+                                 "halide_func_runs_total{pipeline=\"profiler_light\",func=\"output\"} 20\n"}) {
+        if (text.find(expected) == std::string::npos) {
+            fprintf(stderr, "Expected to find %s in the metrics:\n%s\n", expected, text.c_str());
+            return 1;
+        }
+    }
+
+    halide_profiler_light_reset();
+    if (p->runs != 0 || p->ticks != 0 || p->funcs[0].count != 0) {
+        fprintf(stderr, "halide_profiler_light_reset didn't zero the stats\n");
+        return 1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,27 @@
+#include "Halide.h"
+
+namespace {
+
+class ProfilerLight : public Halide::Generator<ProfilerLight> {
+public:
+    Input<Buffer<float, 2>> input{"input"};
+    Output<Buffer<float, 2>> output{"output"};
+
+    void generate() {
+        Var x("x"), y("y");
+
+        Func light_producer("light_producer"), light_inlined("light_inlined");
+        light_producer(x, y) = sqrt(input(x, y) + 1.0f);
+        light_inlined(x, y) = light_producer(x, y) + light_producer(x, y + 1);
+
+        output(x, y) = light_inlined(x, y);
+
+        // Only the Funcs computed at root are timed.
+        light_producer.compute_root().parallel(y);
+        output.parallel(y, 8);
+    }
+};
+
+}  // namespace
+
+HALIDE_REGISTER_GENERATOR(ProfilerLight, profiler_light)
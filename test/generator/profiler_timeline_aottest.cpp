@@ -0,0 +1,100 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+
+#include "HalideBuffer.h"
+#include "HalideRuntime.h"
+#include "profiler_timeline.h"
+
+using namespace Halide::Runtime;
+
+int main(int argc, char **argv) {
+    const char *file_name = "profiler_timeline.json";
+
+    // The timeline and the performance counters are enabled when the
+    // first profiled pipeline runs.
+#ifdef _WIN32
+    _putenv_s("HL_PROFILER_TIMELINE", file_name);
+    _putenv_s("HL_PROFILER_PERF_COUNTERS", "1");
+#else
+    setenv("HL_PROFILER_TIMELINE", file_name, 1);
+    setenv("HL_PROFILER_PERF_COUNTERS", "1", 1);
+#endif
+
+    Buffer<float, 2> input(256, 65);
+    input.fill(3.0f);
+    Buffer<float, 2> output(256, 64);
+    for (int i = 0; i < 10; i++) {
+        int result = profiler_timeline(input, output);
+        if (result != 0) {
+            fprintf(stderr, "profiler_timeline failed: %d\n", result);
+            return 1;
+        }
+    }
+    output.for_each_value([](float v) {
+        if (v != 4.0f) {
+            fprintf(stderr, "Output is %f instead of 4\n", v);
+            exit(1);
+        }
+    });
+
+    // The performance counters may not be available (e.g. in a VM), but
+    // any Func that used cycles must have retired instructions too.
+    halide_profiler_state *state = halide_profiler_get_state();
+    halide_profiler_lock(state);
+    const halide_profiler_pipeline_stats *stats = state->pipelines;
+    while (stats && strcmp(stats->name, "profiler_timeline") != 0) {
+        stats = (const halide_profiler_pipeline_stats *)stats->next;
+    }
+    if (!stats) {
+        halide_profiler_unlock(state);
+        fprintf(stderr, "No profiler state for profiler_timeline\n");
+        return 1;
+    }
+    for (int i = 0; i < stats->num_funcs; i++) {
+        const halide_profiler_func_stats &fs = stats->funcs[i];
+        if (fs.cycles > 0 && fs.instructions == 0) {
+            halide_profiler_unlock(state);
+            fprintf(stderr, "%s used %llu cycles but no instructions\n",
+                    fs.name, (unsigned long long)fs.cycles);
+            return 1;
+        }
+    }
+    halide_profiler_unlock(state);
+
+    int result = halide_profiler_write_timeline(nullptr, file_name);
+    if (result != 0) {
+        fprintf(stderr, "halide_profiler_write_timeline failed: %d\n", result);
+        return 1;
+    }
+
+    FILE *f = fopen(file_name, "r");
+    if (!f) {
+        fprintf(stderr, "Could not open %s\n", file_name);
+        return 1;
+    }
+    std::string trace;
+    char buf[4096];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0) {
+        trace.append(buf, n);
+    }
+    fclose(f);
+
+    // There should be slices for both Funcs, and for the tasks that
+    // computed them, each on a thread.
+    for (const char *expected : {"{\"traceEvents\":[",
+                                 "\"name\":\"timeline_producer\",\"cat\":\"func\",\"ph\":\"X\"",
+                                 "\"name\":\"output\",\"cat\":\"func\",\"ph\":\"X\"",
+                                 "\"name\":\"profiler_timeline\",\"cat\":\"task\",\"ph\":\"X\"",
+                                 "\"name\":\"thread_name\""}) {
+        if (trace.find(expected) == std::string::npos) {
+            fprintf(stderr, "Expected to find %s in the timeline:\n%s\n", expected, trace.c_str());
+            return 1;
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,27 @@
+#include "Halide.h"
+
+namespace {
+
+class ProfilerTimeline : public Halide::Generator<ProfilerTimeline> {
+public:
+    Input<Buffer<float, 2>> input{"input"};
+    Output<Buffer<float, 2>> output{"output"};
+
+    void generate() {
+        Var x("x"), y("y");
+
+        Func timeline_producer("timeline_producer");
+        timeline_producer(x, y) = sqrt(input(x, y) + 1.0f);
+
+        output(x, y) = timeline_producer(x, y) + timeline_producer(x, y + 1);
+
+        // Two parallel loops, so both the Funcs and the parallel tasks
+        // show up on several threads.
+        timeline_producer.compute_root().parallel(y);
+        output.parallel(y, 8);
+    }
+};
+
+}  // namespace
+
+HALIDE_REGISTER_GENERATOR(ProfilerTimeline, profiler_timeline)
@@ -0,0 +1,76 @@
+#include <stdio.h>
+
+#include "HalideBuffer.h"
+#include "HalideRuntime.h"
+#include "size_variants.h"
+
+using namespace Halide::Runtime;
+
+// Run the pipeline on a square image of the given size, and check the output.
+bool run(int size) {
+    Buffer<uint16_t, 2> input(size, size);
+    input.fill(17);
+    Buffer<uint16_t, 2> output(size, size);
+
+    int result = size_variants(input, output);
+    if (result != 0) {
+        fprintf(stderr, "size_variants failed on a %dx%d image: %d\n", size, size, result);
+        return false;
+    }
+    for (int y = 0; y < output.height(); y++) {
+        for (int x = 0; x < output.width(); x++) {
+            if (output(x, y) != 17) {
+                fprintf(stderr, "output(%d, %d) = %d instead of 17 on a %dx%d image\n",
+                        x, y, output(x, y), size, size);
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+int main(int argc, char **argv) {
+    // The variants are autoscheduled for 64x64, 256x256 and 1024x1024
+    // outputs, so these go in the first and last buckets.
+    const int sizes[] = {64, 1024};
+    const int buckets[] = {0, 2};
+
+    for (int b = 0; b < 2; b++) {
+        if (halide_get_size_variant(nullptr, "size_variants", buckets[b]) != -1) {
+            fprintf(stderr, "A variant was chosen for bucket %d before any runs\n", buckets[b]);
+            return 1;
+        }
+    }
+
+    // Each of the three variants is tried a few times for each bucket
+    // before the fastest is chosen.
+    for (int i = 0; i < 20; i++) {
+        for (int size : sizes) {
+            if (!run(size)) {
+                return 1;
+            }
+        }
+    }
+
+    for (int b = 0; b < 2; b++) {
+        int variant = halide_get_size_variant(nullptr, "size_variants", buckets[b]);
+        if (variant < 0 || variant > 2) {
+            fprintf(stderr, "No variant was chosen for bucket %d: %d\n", buckets[b], variant);
+            return 1;
+        }
+        printf("Variant %d chosen for %dx%d images\n", variant, sizes[b], sizes[b]);
+    }
+
+    // Once reset, the variants are tried again, and still give the right answer.
+    halide_reset_size_variants(nullptr);
+    if (halide_get_size_variant(nullptr, "size_variants", 0) != -1) {
+        fprintf(stderr, "halide_reset_size_variants didn't forget the chosen variants\n");
+        return 1;
+    }
+    if (!run(256)) {
+        return 1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,31 @@
+#include "Halide.h"
+
+namespace {
+
+class SizeVariants : public Halide::Generator<SizeVariants> {
+public:
+    Input<Buffer<uint16_t, 2>> input{"input"};
+    Output<Buffer<uint16_t, 2>> output{"output"};
+
+    void generate() {
+        Var x("x"), y("y");
+
+        Func in = Halide::BoundaryConditions::repeat_edge(input);
+
+        Func blur_x("blur_x");
+        blur_x(x, y) = (in(x - 1, y) + in(x, y) + in(x + 1, y)) / 3;
+        output(x, y) = (blur_x(x, y - 1) + blur_x(x, y) + blur_x(x, y + 1)) / 3;
+
+        // The size variants are autoscheduled with these scaled.
+        input.set_estimates({{0, 256}, {0, 256}});
+        output.set_estimates({{0, 256}, {0, 256}});
+
+        if (!using_autoscheduler()) {
+            output.vectorize(x, natural_vector_size<uint16_t>()).parallel(y);
+        }
+    }
+};
+
+}  // namespace
+
+HALIDE_REGISTER_GENERATOR(SizeVariants, size_variants)
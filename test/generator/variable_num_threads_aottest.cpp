@@ -16,6 +16,9 @@ using namespace Halide::Runtime;
 void mess_with_num_threads(void *) {
     while (!stop) {
         halide_set_num_threads((rand() % max_threads) + 1);
+        // Also flip between the default scheduler and work stealing,
+        // so that loops start under both.
+        halide_set_thread_pool_work_stealing((rand() % 2) != 0);
     }
 }
 
@@ -25,7 +28,8 @@ int main(int argc, char **argv) {
 
     // In one thread we'll run a job with lots of nested parallelism,
     // and in another we'll mess with the number of threads we want
-    // running. The intent is to hunt for deadlocks.
+    // running, and whether work stealing is enabled. The intent is to hunt
+    // for deadlocks.
 
     halide_thread *t = halide_spawn_thread(&mess_with_num_threads, nullptr);
 
@@ -0,0 +1,62 @@
+#include "Halide.h"
+#include <chrono>
+#include <cstdio>
+
+using namespace Halide;
+
+// A chain of 'depth' small stencils, with every fourth stage computed at
+// root and the rest computed at the rows of the next root stage, so that
+// bounds inference has many nested loop levels to reason about.
+Pipeline make_chain(int depth) {
+    ImageParam input(Float(32), 2, "input");
+    Var x("x"), y("y");
+
+    std::vector<Func> stages;
+    Func prev = BoundaryConditions::repeat_edge(input);
+    for (int i = 0; i < depth; i++) {
+        Func f("stage_" + std::to_string(i));
+        f(x, y) = (prev(x - 1, y) + prev(x, y) + prev(x + 1, y + (i % 3) - 1)) * 0.33f;
+        stages.push_back(f);
+        prev = f;
+    }
+
+    Func root;
+    for (int i = depth - 1; i >= 0; i--) {
+        if (i == depth - 1 || i % 4 == 0) {
+            stages[i].compute_root().vectorize(x, 8);
+            root = stages[i];
+        } else {
+            stages[i].compute_at(root, y).vectorize(x, 8);
+        }
+    }
+    return Pipeline(stages.back());
+}
+
+double compile_seconds(int depth) {
+    Pipeline p = make_chain(depth);
+    auto start = std::chrono::high_resolution_clock::now();
+    p.compile_to_module(p.infer_arguments(), "deep_pipeline", get_host_target());
+    auto end = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration<double>(end - start).count();
+}
+
+int main(int argc, char **argv) {
+    const int depths[] = {50, 100, 200, 500};
+    double per_stage[4];
+    for (int i = 0; i < 4; i++) {
+        const double t = compile_seconds(depths[i]);
+        per_stage[i] = t / depths[i];
+        printf("%d stages: compiled in %f s (%f ms per stage)\n", depths[i], t, per_stage[i] * 1e3);
+    }
+
+    // Compiling a deeper pipeline costs more per stage, as each stage's
+    // bounds get more complicated, but it shouldn't blow up.
+    if (per_stage[3] > per_stage[0] * 20) {
+        printf("Compile time per stage grew from %f ms to %f ms\n",
+               per_stage[0] * 1e3, per_stage[3] * 1e3);
+        return 1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
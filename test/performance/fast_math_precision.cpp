@@ -0,0 +1,144 @@
+#include "Halide.h"
+#include "halide_benchmark.h"
+
+#include <cmath>
+
+using namespace Halide;
+using namespace Halide::Tools;
+
+namespace {
+
+struct Function {
+    const char *name;
+    Expr (*exact)(Expr);
+    Expr (*fast)(const Expr &, ApproximationPrecision);
+    double (*ref)(double);
+    float min, max;
+    // Whether the exact version is a call to libm, rather than a
+    // polynomial approximation of its own.
+    bool is_libm_call;
+};
+
+Expr sin_e(Expr x) {
+    return sin(std::move(x));
+}
+Expr cos_e(Expr x) {
+    return cos(std::move(x));
+}
+Expr exp_e(Expr x) {
+    return exp(std::move(x));
+}
+Expr log_e(Expr x) {
+    return log(std::move(x));
+}
+
+Expr fast_sin_e(const Expr &x, ApproximationPrecision p) {
+    return fast_sin(x, p);
+}
+Expr fast_cos_e(const Expr &x, ApproximationPrecision p) {
+    return fast_cos(x, p);
+}
+Expr fast_exp_e(const Expr &x, ApproximationPrecision p) {
+    return fast_exp(x, p);
+}
+Expr fast_log_e(const Expr &x, ApproximationPrecision p) {
+    return fast_log(x, p);
+}
+
+double sin_d(double x) {
+    return std::sin(x);
+}
+double cos_d(double x) {
+    return std::cos(x);
+}
+double exp_d(double x) {
+    return std::exp(x);
+}
+double log_d(double x) {
+    return std::log(x);
+}
+
+// Time f over the range of fn, and find its largest absolute and
+// relative errors.
+void measure(const Function &fn, const std::function<Expr(Expr)> &f, const char *label, double *ns) {
+    const int n = 100000;
+    Func g;
+    Var x;
+    Expr t = x / float(n - 1);
+    Expr in = fn.min * (1 - t) + fn.max * t;
+    g(x) = f(in);
+    g.vectorize(x, 8);
+    g.compile_jit();
+
+    Buffer<float> out(n);
+    *ns = 1e9 * benchmark([&]() { g.realize(out); }) / n;
+
+    double max_abs = 0, max_rel = 0;
+    for (int i = 0; i < n; i++) {
+        const float t = i / float(n - 1);
+        const float x = fn.min * (1 - t) + fn.max * t;
+        const double exact = fn.ref(x);
+        const double err = std::abs(out(i) - exact);
+        max_abs = std::max(max_abs, err);
+        if (exact != 0) {
+            max_rel = std::max(max_rel, err / std::abs(exact));
+        }
+    }
+    printf("  %-24s %8.3f ns per element, max abs error %.3g, max rel error %.3g\n",
+           label, *ns, max_abs, max_rel);
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    Target target = get_jit_target_from_environment();
+
+    if (target.arch == Target::X86 &&
+        !target.has_feature(Target::SSE41)) {
+        printf("[SKIP] These intrinsics are known to be slow on x86 without sse 4.1.\n");
+        return 0;
+    }
+
+    if (target.arch == Target::WebAssembly) {
+        printf("[SKIP] Performance tests are meaningless and/or misleading under WebAssembly interpreter.\n");
+        return 0;
+    }
+
+    const Function functions[] = {
+        {"sin", sin_e, fast_sin_e, sin_d, -10.0f, 10.0f, true},
+        {"cos", cos_e, fast_cos_e, cos_d, -10.0f, 10.0f, true},
+        {"exp", exp_e, fast_exp_e, exp_d, -10.0f, 10.0f, false},
+        {"log", log_e, fast_log_e, log_d, 0.01f, 100.0f, false},
+    };
+
+    const std::pair<const char *, ApproximationPrecision> precisions[] = {
+        {"abs 1e-4", ApproximationPrecision::absolute(1e-4)},
+        {"abs 1e-6", ApproximationPrecision::absolute(1e-6)},
+        {"ulp 100", ApproximationPrecision::ulp(100)},
+        {"ulp 4", ApproximationPrecision::ulp(4)},
+        {"ulp 2", ApproximationPrecision::ulp(2)},
+    };
+
+    for (const Function &fn : functions) {
+        printf("%s:\n", fn.name);
+        double t_exact, t_fastest = 0;
+        measure(fn, fn.exact, fn.name, &t_exact);
+        for (const auto &p : precisions) {
+            double t;
+            measure(fn, [&](Expr x) { return fn.fast(x, p.second); }, p.first, &t);
+            if (p.second.max_absolute_error == 1e-4) {
+                t_fastest = t;
+            }
+        }
+
+        // The cheapest approximations should beat calls to libm by a
+        // wide margin.
+        if (fn.is_libm_call && t_fastest > t_exact) {
+            printf("fast_%s is not faster than %s\n", fn.name, fn.name);
+            return 1;
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
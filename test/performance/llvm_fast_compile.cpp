@@ -0,0 +1,88 @@
+#include "Halide.h"
+#include "halide_benchmark.h"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+
+using namespace Halide;
+using namespace Halide::Tools;
+
+// A chain of stencils, with every fourth stage computed at root and
+// vectorized, so there is plenty of code for LLVM to optimize.
+Pipeline make_chain(ImageParam input, int depth) {
+    Var x("x"), y("y");
+
+    std::vector<Func> stages;
+    Func prev = BoundaryConditions::repeat_edge(input);
+    for (int i = 0; i < depth; i++) {
+        Func f("stage_" + std::to_string(i));
+        f(x, y) = (prev(x - 1, y) + prev(x, y) * (0.5f + i * 0.01f) + prev(x + 1, y + (i % 3) - 1)) * 0.33f;
+        stages.push_back(f);
+        prev = f;
+    }
+
+    Func root;
+    for (int i = depth - 1; i >= 0; i--) {
+        if (i == depth - 1 || i % 4 == 0) {
+            stages[i].compute_root().vectorize(x, 8);
+            root = stages[i];
+        }
+    }
+    return Pipeline(stages.back());
+}
+
+int main(int argc, char **argv) {
+    Target host = get_jit_target_from_environment();
+    if (host.arch == Target::WebAssembly) {
+        printf("[SKIP] Performance tests are meaningless and/or misleading under WebAssembly interpreter.\n");
+        return 0;
+    }
+
+    const int w = 1024, h = 1024;
+    Buffer<float> in(w, h);
+    in.for_each_element([&](int x, int y) { in(x, y) = (float)((x * 7 + y * 13) % 256); });
+
+    struct Tier {
+        const char *name;
+        Target target;
+    } tiers[] = {
+        {"fast", host.with_feature(Target::LLVMFastCompile)},
+        {"default", host},
+        {"full", host.with_feature(Target::EnableLLVMLoopOpt)},
+    };
+
+    Buffer<float> reference;
+    for (const Tier &tier : tiers) {
+        ImageParam input(Float(32), 2, "input");
+        Pipeline p = make_chain(input, 64);
+        input.set(in);
+
+        auto start = std::chrono::high_resolution_clock::now();
+        p.compile_jit(tier.target);
+        auto end = std::chrono::high_resolution_clock::now();
+        const double compile_time = std::chrono::duration<double>(end - start).count();
+
+        Buffer<float> out(w, h);
+        const double run_time = benchmark([&]() { p.realize(out); });
+        printf("%-8s tier: compiled in %f s, runs in %f ms\n", tier.name, compile_time, run_time * 1e3);
+
+        if (!reference.defined()) {
+            reference = out;
+        } else {
+            // The tiers only differ in how LLVM optimizes, which may
+            // reassociate the float math.
+            for (int y = 0; y < h; y++) {
+                for (int x = 0; x < w; x++) {
+                    if (std::abs(out(x, y) - reference(x, y)) > 1e-3f * (1 + std::abs(reference(x, y)))) {
+                        printf("out(%d, %d) = %f instead of %f at the %s tier\n",
+                               x, y, out(x, y), reference(x, y), tier.name);
+                        return 1;
+                    }
+                }
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
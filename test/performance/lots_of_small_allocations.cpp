@@ -12,10 +12,10 @@ int main(int argc, char **argv) {
 
     Param<int> p;
 
-    const char *names[3] = {"heap", "pseudostack", "stack"};
+    const char *names[4] = {"heap", "pseudostack", "stack", "heap with the caching allocator"};
 
-    double t[3];
-    for (int i = 0; i < 3; i++) {
+    double t[4];
+    for (int i = 0; i < 4; i++) {
         Var x("x");
 
         Func in;
@@ -35,7 +35,7 @@ int main(int argc, char **argv) {
         chain.back().split(x, xo, xi, p, TailStrategy::RoundUp);
         for (size_t j = 0; j < chain.size() - 1; j++) {
             chain[j].compute_at(chain.back(), xo);
-            if (i != 0) {
+            if (i == 1 || i == 2) {
                 chain[j].store_in(MemoryType::Stack);
             }
             if (i == 2) {
@@ -61,6 +61,12 @@ int main(int argc, char **argv) {
         // pseudostack, not stack to register.
         p.set(200);
 
+        if (i == 3) {
+            // Nothing allocated by the default allocator is still live,
+            // so it's safe to switch.
+            Internal::JITSharedRuntime::use_caching_allocator();
+        }
+
         Buffer<int> out(16 * 1000 * 1000);
         t[i] = Halide::Tools::benchmark([&] { chain.back().realize(out); });
 
@@ -1,5 +1,6 @@
 #include "Halide.h"
 #include "halide_benchmark.h"
+#include <chrono>
 #include <cstdio>
 
 using namespace Halide;
@@ -51,6 +52,71 @@ int main(int argc, char **argv) {
     double speedup = serialTime / parallelTime;
     printf("Speedup: %f\n", speedup);
 
+    // Measure the latency of a small parallel pipeline run over and over
+    // with a short gap in between, as a latency-sensitive caller would,
+    // under each of the thread pool's spin policies.
+    {
+        Func small;
+        small(x, y) = cast<float>(x * y);
+        small.parallel(y);
+        Buffer<float> out = small.realize({64, 16});
+
+        struct {
+            const char *name;
+            halide_thread_pool_spin_t policy;
+            int spin_us;
+        } policies[] = {
+            {"default", halide_thread_pool_spin_default, 0},
+            {"adaptive", halide_thread_pool_spin_adaptive, 0},
+            {"hot for 1ms", halide_thread_pool_spin_hot, 1000},
+            {"never", halide_thread_pool_spin_never, 0},
+        };
+        for (const auto &p : policies) {
+            Internal::JITSharedRuntime::set_thread_pool_spin_policy(p.policy, p.spin_us);
+            const int iterations = 200;
+            double total = 0;
+            for (int i = 0; i < iterations; i++) {
+                // Wait 50us between calls, during which idle workers
+                // would go to sleep without spinning.
+                auto gap_end = std::chrono::high_resolution_clock::now() + std::chrono::microseconds(50);
+                while (std::chrono::high_resolution_clock::now() < gap_end) {
+                }
+                total += benchmark(1, 1, [&]() { small.realize(out); });
+            }
+            printf("Small pipeline with spin policy %s: %f us per call\n",
+                   p.name, total / iterations * 1e6);
+        }
+        Internal::JITSharedRuntime::set_thread_pool_spin_policy(halide_thread_pool_spin_default, 0);
+    }
+
+    // A parallel loop whose iterations get more expensive as it goes,
+    // under each of the ways threads can claim iterations.
+    {
+        Func uneven;
+        RDom r(0, H);
+        r.where(r < y);
+        uneven(x, y) = 0.0f;
+        uneven(x, y) += sqrt(cos(sin(cast<float>(x + r))));
+        uneven.compute_root().parallel(y);
+        uneven.update().parallel(y);
+        Buffer<float> out = uneven.realize({64, H});
+
+        struct {
+            const char *name;
+            halide_thread_pool_chunking_t chunking;
+        } chunkings[] = {
+            {"static", halide_thread_pool_chunking_static},
+            {"guided", halide_thread_pool_chunking_guided},
+            {"adaptive", halide_thread_pool_chunking_adaptive},
+        };
+        for (const auto &c : chunkings) {
+            Internal::JITSharedRuntime::set_thread_pool_chunking(c.chunking);
+            double t = benchmark([&]() { uneven.realize(out); });
+            printf("Uneven loop with %s chunking: %f ms\n", c.name, t * 1e3);
+        }
+        Internal::JITSharedRuntime::set_thread_pool_chunking(halide_thread_pool_chunking_static);
+    }
+
     if (speedup < 1.5) {
         fprintf(stderr, "WARNING: Parallel should be faster\n");
         return 0;
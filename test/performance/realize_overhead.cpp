@@ -99,6 +99,21 @@ int main(int argc, char **argv) {
         std::cout << "No argument Pipeline realize reusing Realization/Target with no_asserts and no_bounds_query time " << t * 1e6 << "us.\n";
     }
 
+    {
+        Func f;
+        Var x;
+        Param<int> in;
+
+        f(x) = x + in;
+        f.compile_jit();
+
+        in.set(0);
+
+        // The output bounds query is only done on the first of these calls.
+        double t = benchmark([&]() { f.realize({16}); });
+        std::cout << "One argument Func realize with sizes time " << t * 1e6 << "us.\n";
+    }
+
     {
         Func f;
         Param<int> in;
@@ -131,6 +146,51 @@ int main(int argc, char **argv) {
         std::cout << "One argument Pipeline realize reusing Realization/Target time " << t * 1e6 << "us.\n";
     }
 
+    {
+        Func f;
+        Param<int> in;
+
+        f() = in + 42;
+
+        auto c = f.compile_to_callable({in});
+        auto buf = Buffer<int32_t>::make_scalar();
+
+        double t = benchmark([&]() { c(0, buf); });
+        std::cout << "One argument Callable call time " << t * 1e6 << "us.\n";
+
+        auto std_fn = c.make_std_function<int, Buffer<int32_t>>();
+        t = benchmark([&]() { std_fn(0, buf); });
+        std::cout << "One argument Callable std::function call time " << t * 1e6 << "us.\n";
+
+        auto bound = c.bind<int, Buffer<int32_t>>();
+        t = benchmark([&]() { bound(0, buf); });
+        std::cout << "One argument bound Callable call time " << t * 1e6 << "us.\n";
+    }
+
+    {
+        Func f;
+        Var x, y;
+        Param<int> in;
+
+        f(x, y) = x + y + in;
+
+        auto bound = f.compile_to_callable({in}).bind<int, Buffer<int32_t, 2>>();
+        std::vector<std::tuple<int, Buffer<int32_t, 2>>> patches;
+        for (int i = 0; i < 1000; i++) {
+            patches.emplace_back(i, Buffer<int32_t, 2>(64, 64));
+        }
+
+        double t = benchmark([&]() {
+            for (const auto &p : patches) {
+                bound(std::get<0>(p), std::get<1>(p));
+            }
+        });
+        std::cout << "1000 64x64 patches, one bound Callable call each, time " << t * 1e6 << "us.\n";
+
+        t = benchmark([&]() { bound.call_batch(patches); });
+        std::cout << "1000 64x64 patches, one batched bound Callable call, time " << t * 1e6 << "us.\n";
+    }
+
     for (int i = 10; i < 100; i += 10) {
         Func f;
         std::vector<Param<int>> params(i);
@@ -0,0 +1,60 @@
+#include "Halide.h"
+#include "halide_benchmark.h"
+#include <cstdio>
+
+using namespace Halide;
+using namespace Halide::Internal;
+using namespace Halide::Tools;
+
+// Build the sort of index expressions a clamped stencil produces. Every
+// call makes fresh IR nodes, so only a structural cache can share work
+// between calls.
+std::vector<Expr> make_stencil_exprs() {
+    Expr x = Variable::make(Int(32), "x");
+    Expr y = Variable::make(Int(32), "y");
+    Expr w = Variable::make(Int(32), "w");
+    Expr h = Variable::make(Int(32), "h");
+    std::vector<Expr> exprs;
+    for (int dy = -2; dy <= 2; dy++) {
+        for (int dx = -2; dx <= 2; dx++) {
+            Expr cx = min(max(x + dx, 0), w - 1);
+            Expr cy = min(max(y + dy, 0), h - 1);
+            Expr idx = (cy * w + cx) - (min(max(y, 0), h - 1) * w + min(max(x, 0), w - 1));
+            exprs.push_back(select(x + dx < w, idx * 2 + (dx + dy) * 3, idx) - idx);
+        }
+    }
+    return exprs;
+}
+
+int main(int argc, char **argv) {
+    const int reps = 20;
+    const int exprs_per_rep = (int)make_stencil_exprs().size() * reps;
+
+    auto run = [&]() {
+        for (int r = 0; r < reps; r++) {
+            for (const Expr &e : make_stencil_exprs()) {
+                simplify(e);
+            }
+        }
+    };
+
+    double uncached = benchmark(run);
+
+    double cached, hit_rate;
+    {
+        ScopedSimplifierCache cache;
+        cached = benchmark(run);
+        hit_rate = (double)cache.hits() / (cache.hits() + cache.misses());
+    }
+
+    printf("Uncached: %f simplify calls per second\n", exprs_per_rep / uncached);
+    printf("Cached: %f simplify calls per second (%.1f%% hits)\n", exprs_per_rep / cached, hit_rate * 100);
+
+    if (cached > uncached) {
+        printf("Simplifier cache made simplification slower: %f vs %f\n", cached, uncached);
+        return 1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,83 @@
+#include "Halide.h"
+#include "halide_benchmark.h"
+
+#include <cstdio>
+
+using namespace Halide;
+using namespace Halide::Tools;
+
+// Strided vector loads lower in different ways depending on the stride,
+// the vector width, and the target: structure loads (ld2/ld3/ld4 on ARM),
+// a dense load followed by a shuffle, a hardware gather, or one scalar
+// load per lane. Check that each of these is no slower than not
+// vectorizing at all.
+
+template<typename T>
+bool test(const char *strategy, int stride, int vec) {
+    const int width = 1 << 16;
+    Buffer<T> input(width * stride + stride);
+    for (int i = 0; i < input.width(); i++) {
+        input(i) = (T)(i * 17);
+    }
+    Buffer<T> output(width);
+
+    Var x;
+    Func vectorized, scalar;
+    // Sum two loads at each site so that clusters of loads can share a
+    // dense load.
+    vectorized(x) = input(stride * x) + input(stride * x + stride - 1);
+    scalar(x) = input(stride * x) + input(stride * x + stride - 1);
+    vectorized.vectorize(x, vec);
+
+    vectorized.compile_jit();
+    scalar.compile_jit();
+
+    vectorized.realize(output);
+    for (int i = 0; i < width; i++) {
+        T correct = (T)(input(stride * i) + input(stride * i + stride - 1));
+        if (output(i) != correct) {
+            printf("output(%d) = %f instead of %f\n", i, (double)output(i), (double)correct);
+            return false;
+        }
+    }
+
+    double t_vectorized = benchmark([&]() { vectorized.realize(output); });
+    double t_scalar = benchmark([&]() { scalar.realize(output); });
+
+    printf("%-20s stride %2d x %2d lanes of %s: %f ms vectorized, %f ms scalar\n",
+           strategy, stride, vec, type_of<T>() == Float(32) ? "float" : "uint8",
+           t_vectorized * 1e3, t_scalar * 1e3);
+
+    // Leave some headroom for noise.
+    if (t_vectorized > 1.5 * t_scalar) {
+        printf("Vectorized strided load was slower than the scalar version\n");
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char **argv) {
+    Target target = get_jit_target_from_environment();
+    if (target.arch == Target::WebAssembly) {
+        printf("[SKIP] Performance tests are meaningless and/or misleading under WebAssembly interpreter.\n");
+        return 0;
+    }
+
+    // Strides smaller than the vector are structure loads or dense loads
+    // plus a shuffle.
+    if (!test<float>("structure load", 2, 8) ||
+        !test<float>("structure load", 3, 8) ||
+        !test<uint8_t>("structure load", 4, 16) ||
+        !test<float>("dense and shuffle", 7, 8) ||
+        // Wider strides on a short vector of bytes are still cheaper as a
+        // dense load.
+        !test<uint8_t>("short dense load", 8, 4) ||
+        // Beyond that it's a (hardware or scalarized) gather.
+        !test<float>("gather", 16, 8) ||
+        !test<float>("gather", 64, 8)) {
+        return 1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
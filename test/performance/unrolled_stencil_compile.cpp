@@ -0,0 +1,52 @@
+#include "Halide.h"
+#include <chrono>
+#include <cstdio>
+
+using namespace Halide;
+
+// A k x k weighted stencil with the reduction fully unrolled, which
+// gives lowering one very large expression per vector of output.
+Pipeline make_stencil(int k) {
+    ImageParam input(Float(32), 2, "input");
+    Var x("x"), y("y");
+    RDom r(0, k, 0, k);
+
+    Func clamped = BoundaryConditions::repeat_edge(input);
+    Func f("f");
+    f(x, y) = 0.0f;
+    f(x, y) += clamped(x + r.x, y + r.y) * (cast<float>(r.x * k + r.y) + 1.0f);
+    f.vectorize(x, 8);
+    f.update().unroll(r.x).unroll(r.y).vectorize(x, 8);
+
+    return Pipeline(f);
+}
+
+double compile_seconds(int k) {
+    Pipeline p = make_stencil(k);
+    auto start = std::chrono::high_resolution_clock::now();
+    p.compile_to_module(p.infer_arguments(), "unrolled_stencil", get_host_target());
+    auto end = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration<double>(end - start).count();
+}
+
+int main(int argc, char **argv) {
+    const int sizes[] = {5, 10, 20};
+    double per_tap[3];
+    for (int i = 0; i < 3; i++) {
+        const double t = compile_seconds(sizes[i]);
+        per_tap[i] = t / (sizes[i] * sizes[i]);
+        printf("%dx%d stencil: compiled in %f s (%f ms per tap)\n",
+               sizes[i], sizes[i], t, per_tap[i] * 1e3);
+    }
+
+    // The unrolled expression grows with the number of taps, and the
+    // time to lower it should grow about as fast.
+    if (per_tap[2] > per_tap[0] * 10) {
+        printf("Compile time per tap grew from %f ms to %f ms\n",
+               per_tap[0] * 1e3, per_tap[2] * 1e3);
+        return 1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
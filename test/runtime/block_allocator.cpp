@@ -571,6 +571,115 @@ int main(int argc, char **argv) {
         halide_abort_if_false(user_context, get_allocated_system_memory() == 0);
     }
 
+    // test block allocator defragmentation and stats
+    {
+        BlockAllocator::Config config = {0};
+        config.minimum_block_size = 1024;
+
+        // Use default conform allocation request callbacks
+        MemoryBlockAllocatorFns block_allocator = {allocate_block, deallocate_block, nullptr};
+        MemoryRegionAllocatorFns region_allocator = {allocate_region, deallocate_region, nullptr};
+        BlockAllocator::MemoryAllocators allocators = {system_allocator, block_allocator, region_allocator};
+        BlockAllocator *instance = BlockAllocator::create(user_context, config, allocators);
+
+        MemoryRequest request = {0};
+        request.size = 256;
+        request.alignment = sizeof(int);
+        request.properties.visibility = MemoryVisibility::DefaultVisibility;
+        request.properties.caching = MemoryCaching::DefaultCaching;
+        request.properties.usage = MemoryUsage::DefaultUsage;
+
+        MemoryRegion *r1 = instance->reserve(user_context, request);
+        MemoryRegion *r2 = instance->reserve(user_context, request);
+        MemoryRegion *r3 = instance->reserve(user_context, request);
+        MemoryRegion *r4 = instance->reserve(user_context, request);
+        HALIDE_CHECK(user_context, (r1 != nullptr) && (r2 != nullptr) && (r3 != nullptr) && (r4 != nullptr));
+
+        MemoryStats stats = instance->current_stats(user_context);
+        HALIDE_CHECK(user_context, stats.block_count == 1);
+        HALIDE_CHECK(user_context, stats.block_bytes == config.minimum_block_size);
+        HALIDE_CHECK(user_context, stats.region_count == 4);
+        HALIDE_CHECK(user_context, stats.reserved_bytes == config.minimum_block_size);
+        HALIDE_CHECK(user_context, stats.available_bytes == 0);
+
+        // release two regions that aren't neighbours, leaving two holes
+        instance->release(user_context, r1);
+        instance->release(user_context, r3);
+        stats = instance->current_stats(user_context);
+        HALIDE_CHECK(user_context, stats.region_count == 2);
+        HALIDE_CHECK(user_context, stats.available_count == 2);
+        HALIDE_CHECK(user_context, stats.available_bytes == 2 * request.size);
+        HALIDE_CHECK(user_context, stats.largest_available == request.size);
+
+        // neighbouring free regions count as one span, even before they've been coalesced
+        instance->release(user_context, r2);
+        stats = instance->current_stats(user_context);
+        HALIDE_CHECK(user_context, stats.available_count == 1);
+        HALIDE_CHECK(user_context, stats.largest_available == 3 * request.size);
+        HALIDE_CHECK(user_context, allocated_region_memory == 4 * request.size);
+
+        // defragmenting drops the cached regions, but keeps the block that's still in use
+        HALIDE_CHECK(user_context, false == instance->defragment(user_context));
+        HALIDE_CHECK(user_context, allocated_region_memory == request.size);
+        HALIDE_CHECK(user_context, instance->block_count() == 1);
+
+        MemoryRequest large_request = request;
+        large_request.size = 3 * request.size;
+        MemoryRegion *r5 = instance->reserve(user_context, large_request);
+        HALIDE_CHECK(user_context, r5 != nullptr);
+        HALIDE_CHECK(user_context, instance->block_count() == 1);
+
+        instance->release(user_context, r4);
+        instance->release(user_context, r5);
+        HALIDE_CHECK(user_context, true == instance->defragment(user_context));
+        HALIDE_CHECK(user_context, instance->block_count() == 0);
+        HALIDE_CHECK(user_context, allocated_block_memory == 0);
+        HALIDE_CHECK(user_context, allocated_region_memory == 0);
+
+        instance->destroy(user_context);
+        BlockAllocator::destroy(user_context, instance);
+        HALIDE_CHECK(user_context, get_allocated_system_memory() == 0);
+    }
+
+    // test block allocator defragments when the pool limits are reached
+    {
+        BlockAllocator::Config config = {0};
+        config.minimum_block_size = 1024;
+        config.maximum_block_count = 1;
+
+        // Use default conform allocation request callbacks
+        MemoryBlockAllocatorFns block_allocator = {allocate_block, deallocate_block, nullptr};
+        MemoryRegionAllocatorFns region_allocator = {allocate_region, deallocate_region, nullptr};
+        BlockAllocator::MemoryAllocators allocators = {system_allocator, block_allocator, region_allocator};
+        BlockAllocator *instance = BlockAllocator::create(user_context, config, allocators);
+
+        MemoryRequest request = {0};
+        request.size = config.minimum_block_size;
+        request.alignment = sizeof(int);
+        request.properties.visibility = MemoryVisibility::DefaultVisibility;
+        request.properties.caching = MemoryCaching::DefaultCaching;
+        request.properties.usage = MemoryUsage::DefaultUsage;
+
+        MemoryRegion *r1 = instance->reserve(user_context, request);
+        HALIDE_CHECK(user_context, r1 != nullptr);
+        instance->release(user_context, r1);
+
+        // the empty block is too small, and no more blocks are allowed ... so it must be replaced
+        request.size = 2 * config.minimum_block_size;
+        MemoryRegion *r2 = instance->reserve(user_context, request);
+        HALIDE_CHECK(user_context, r2 != nullptr);
+        HALIDE_CHECK(user_context, instance->block_count() == 1);
+        HALIDE_CHECK(user_context, allocated_block_memory == request.size);
+        instance->reclaim(user_context, r2);
+
+        instance->destroy(user_context);
+        HALIDE_CHECK(user_context, allocated_block_memory == 0);
+        HALIDE_CHECK(user_context, allocated_region_memory == 0);
+
+        BlockAllocator::destroy(user_context, instance);
+        HALIDE_CHECK(user_context, get_allocated_system_memory() == 0);
+    }
+
     print(user_context) << "Success!\n";
     return 0;
 }
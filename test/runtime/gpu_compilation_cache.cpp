@@ -0,0 +1,103 @@
+#include "HalideRuntime.h"
+
+#include "common.h"
+#include "printer.h"
+
+#include "gpu_context_common.h"
+
+using namespace Halide::Internal;
+
+extern "C" {
+
+// This test is single-threaded, so the cache's mutex can be trivial.
+void halide_mutex_lock(halide_mutex *mutex) {
+}
+
+void halide_mutex_unlock(halide_mutex *mutex) {
+}
+
+}  // extern "C"
+
+namespace {
+
+int compiles = 0;
+int frees = 0;
+
+void *compile_module(uintptr_t which) {
+    compiles++;
+    return (void *)(which * 16);
+}
+
+void free_module(void *) {
+    frees++;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    void *user_context = (void *)1;
+    GPUCompilationCache<void *, void *> cache;
+
+    // Enough kernels to grow the table several times, on two contexts.
+    const int num_kernels = 1000;
+    void *contexts[] = {(void *)0x1000, (void *)0x2000};
+    void *state[2][num_kernels] = {};
+    for (int c = 0; c < 2; c++) {
+        for (int i = 0; i < num_kernels; i++) {
+            void *module = nullptr;
+            HALIDE_CHECK(user_context, cache.kernel_state_setup(user_context, &state[c][i], contexts[c], module,
+                                                                compile_module, (uintptr_t)(c * num_kernels + i + 1)));
+            HALIDE_CHECK(user_context, module == (void *)((uintptr_t)(c * num_kernels + i + 1) * 16));
+        }
+    }
+    HALIDE_CHECK(user_context, compiles == 2 * num_kernels);
+
+    // Every kernel is found, on its own context only.
+    for (int c = 0; c < 2; c++) {
+        for (int i = 0; i < num_kernels; i++) {
+            void *module = nullptr;
+            HALIDE_CHECK(user_context, cache.lookup(contexts[c], state[c][i], module));
+            HALIDE_CHECK(user_context, module == (void *)((uintptr_t)(c * num_kernels + i + 1) * 16));
+        }
+    }
+    for (int i = 0; i < num_kernels; i++) {
+        void *module = nullptr;
+        HALIDE_CHECK(user_context, !cache.lookup((void *)0x3000, state[0][i], module));
+    }
+
+    // Setting up an existing kernel again doesn't recompile it.
+    {
+        void *module = nullptr;
+        HALIDE_CHECK(user_context, cache.kernel_state_setup(user_context, &state[0][0], contexts[0], module,
+                                                            compile_module, (uintptr_t)12345));
+        HALIDE_CHECK(user_context, compiles == 2 * num_kernels);
+        cache.release_hold(user_context, contexts[0], state[0][0]);
+    }
+
+    // Kernels still held by a pipeline survive deleting their context.
+    for (int i = 1; i < num_kernels; i++) {
+        cache.release_hold(user_context, contexts[0], state[0][i]);
+    }
+    cache.delete_context(user_context, contexts[0], free_module);
+    HALIDE_CHECK(user_context, frees == num_kernels - 1);
+    {
+        void *module = nullptr;
+        HALIDE_CHECK(user_context, cache.lookup(contexts[0], state[0][0], module));
+        HALIDE_CHECK(user_context, !cache.lookup(contexts[0], state[0][1], module));
+        HALIDE_CHECK(user_context, cache.lookup(contexts[1], state[1][1], module));
+    }
+
+    cache.release_hold(user_context, contexts[0], state[0][0]);
+    for (int i = 0; i < num_kernels; i++) {
+        cache.release_hold(user_context, contexts[1], state[1][i]);
+    }
+    cache.release_all(user_context, free_module);
+    HALIDE_CHECK(user_context, frees == 2 * num_kernels);
+    {
+        void *module = nullptr;
+        HALIDE_CHECK(user_context, !cache.lookup(contexts[1], state[1][0], module));
+    }
+
+    print(user_context) << "Success!\n";
+    return 0;
+}
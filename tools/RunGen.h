@@ -3,8 +3,11 @@
 #include "halide_benchmark.h"
 #include "halide_image_io.h"
 
+#include <cctype>
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
+#include <fstream>
 #include <iomanip>
 #include <iostream>
 #include <map>
@@ -17,6 +20,13 @@
 
 #include <vector>
 
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
 namespace Halide {
 namespace RunGen {
 
@@ -891,6 +901,100 @@ struct ArgData {
     }
 };
 
+// Hardware performance counters for this process and the threads it
+// creates while they are enabled, read via perf_event_open(). These are
+// only available on Linux, and only if the kernel allows it
+// (see /proc/sys/kernel/perf_event_paranoid); otherwise there are none.
+class PerfCounters {
+public:
+    PerfCounters() {
+#ifdef __linux__
+        const struct {
+            const char *name;
+            uint32_t type;
+            uint64_t config;
+        } events[] = {
+            {"instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+            {"cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+            {"llc_load_misses", PERF_TYPE_HW_CACHE,
+             PERF_COUNT_HW_CACHE_LL | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)},
+            {"branch_misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+        };
+        for (const auto &e : events) {
+            perf_event_attr attr;
+            memset(&attr, 0, sizeof(attr));
+            attr.size = sizeof(attr);
+            attr.type = e.type;
+            attr.config = e.config;
+            attr.disabled = 1;
+            attr.inherit = 1;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            int fd = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+            if (fd >= 0) {
+                counters.push_back({e.name, fd});
+            } else {
+                info() << "Perf counter " << e.name << " is not available";
+            }
+        }
+#endif
+    }
+
+    ~PerfCounters() {
+#ifdef __linux__
+        for (const auto &c : counters) {
+            ::close(c.fd);
+        }
+#endif
+    }
+
+    PerfCounters(const PerfCounters &) = delete;
+    PerfCounters &operator=(const PerfCounters &) = delete;
+
+    bool empty() const {
+        return counters.empty();
+    }
+
+    void enable() {
+#ifdef __linux__
+        for (const auto &c : counters) {
+            ioctl(c.fd, PERF_EVENT_IOC_RESET, 0);
+            ioctl(c.fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+#endif
+    }
+
+    void disable() {
+#ifdef __linux__
+        for (const auto &c : counters) {
+            ioctl(c.fd, PERF_EVENT_IOC_DISABLE, 0);
+        }
+#endif
+    }
+
+    // The counts since enable(). Note that the counts of the threads
+    // created since then are only included once those threads have exited.
+    std::vector<std::pair<std::string, uint64_t>> read_counts() const {
+        std::vector<std::pair<std::string, uint64_t>> counts;
+#ifdef __linux__
+        for (const auto &c : counters) {
+            uint64_t value = 0;
+            if (::read(c.fd, &value, sizeof(value)) == sizeof(value)) {
+                counts.emplace_back(c.name, value);
+            }
+        }
+#endif
+        return counts;
+    }
+
+private:
+    struct Counter {
+        std::string name;
+        int fd;
+    };
+    std::vector<Counter> counters;
+};
+
 class RunGen {
 public:
     using ArgvCall = int (*)(void **);
@@ -1311,6 +1415,142 @@ public:
                   << md->name << "  THROUGHPUT_MPIX_PER_SEC  " << (megapixels_out() / result.wall_time) << "\n"
                   << md->name << "  HALIDE_TARGET            " << md->target << "\n";
         }
+
+        if (perf_counters) {
+            report_perf_counters(filter_argv, result.iterations);
+        }
+    }
+
+    // Benchmark by timing each iteration separately, and report the
+    // median, p95 and p99 times with their confidence intervals, once for
+    // each thread count in num_threads (or just once, with the default
+    // thread count, if it's empty). If flush_cache_bytes is nonzero, that
+    // many bytes are written and read back before each iteration, to
+    // measure the filter running from a cold cache. If json_path is
+    // nonempty, the results are also written there as JSON.
+    void run_for_benchmark_statistics(double benchmark_min_time,
+                                      const std::vector<int> &num_threads,
+                                      size_t flush_cache_bytes,
+                                      const std::string &json_path) {
+        std::vector<void *> filter_argv = build_filter_argv();
+
+        const auto benchmark_inner = [this, &filter_argv]() {
+            // Ignore result since our halide_error() should catch everything.
+            (void)halide_argv_call(&filter_argv[0]);
+            this->device_sync_outputs();
+        };
+
+        // This only evicts the filter's data from the caches this thread
+        // shares with the others, and from its own private ones, but the
+        // last level cache is usually what matters.
+        std::vector<uint8_t> flush_buffer(flush_cache_bytes);
+        uint8_t flush_value = 0;
+        const auto flush_cache = [&]() {
+            uint32_t sum = 0;
+            flush_value++;
+            for (size_t i = 0; i < flush_buffer.size(); i += 64) {
+                flush_buffer[i] = flush_value;
+            }
+            for (size_t i = 0; i < flush_buffer.size(); i += 64) {
+                sum += flush_buffer[i];
+            }
+            volatile uint32_t sink = sum;
+            (void)sink;
+        };
+
+        Halide::Tools::BenchmarkConfig config;
+        config.min_time = benchmark_min_time;
+        config.max_time = benchmark_min_time * 4;
+
+        struct Run {
+            int num_threads;
+            Halide::Tools::BenchmarkStatistics stats;
+        };
+        std::vector<Run> runs;
+        std::vector<int> sweep = num_threads.empty() ? std::vector<int>{0} : num_threads;
+        const int default_num_threads = halide_get_num_threads();
+        uint64_t total_iterations = 0;
+        for (int n : sweep) {
+            halide_set_num_threads(n > 0 ? n : default_num_threads);
+            info() << "Benchmarking filter with " << (n > 0 ? n : default_num_threads) << " threads...";
+            // Run once untimed, so the thread pool is started and any
+            // device allocations are made before timing begins.
+            benchmark_inner();
+            std::vector<double> times =
+                Halide::Tools::benchmark_samples(benchmark_inner, config, kMinStatisticsSamples,
+                                                 flush_cache_bytes ? std::function<void()>(flush_cache) : nullptr);
+            total_iterations += times.size();
+            runs.push_back({n > 0 ? n : default_num_threads, Halide::Tools::benchmark_statistics(std::move(times))});
+        }
+        halide_set_num_threads(default_num_threads);
+
+        const char *cache = flush_cache_bytes ? "cold" : "warm";
+        for (const Run &r : runs) {
+            const auto &s = r.stats;
+            if (!parsable_output) {
+                out() << "Benchmark for " << md->name << " with " << r.num_threads << " threads and a " << cache << " cache"
+                      << " (over " << s.samples << " iterations, " << (s.confidence * 100) << "% confidence):\n"
+                      << "  median " << s.median << " sec/iter [" << s.median_low << ", " << s.median_high << "]\n"
+                      << "  p95    " << s.p95 << " sec/iter [" << s.p95_low << ", " << s.p95_high << "]\n"
+                      << "  p99    " << s.p99 << " sec/iter [" << s.p99_low << ", " << s.p99_high << "]\n"
+                      << "  best   " << s.min << " sec/iter, mean " << s.mean << " sec/iter\n"
+                      << "Median output throughput is " << (megapixels_out() / s.median) << " mpix/sec.\n";
+            } else {
+                const std::string prefix = std::string(md->name) + "  THREADS_" + std::to_string(r.num_threads) + "_";
+                out() << prefix << "SAMPLES                  " << s.samples << "\n"
+                      << prefix << "BEST_TIME_MSEC_PER_ITER  " << s.min * 1000 << "\n"
+                      << prefix << "MEAN_TIME_MSEC_PER_ITER  " << s.mean * 1000 << "\n"
+                      << prefix << "MEDIAN_MSEC_PER_ITER     " << s.median * 1000 << "\n"
+                      << prefix << "MEDIAN_CI_MSEC           " << s.median_low * 1000 << " " << s.median_high * 1000 << "\n"
+                      << prefix << "P95_MSEC_PER_ITER        " << s.p95 * 1000 << "\n"
+                      << prefix << "P95_CI_MSEC              " << s.p95_low * 1000 << " " << s.p95_high * 1000 << "\n"
+                      << prefix << "P99_MSEC_PER_ITER        " << s.p99 * 1000 << "\n"
+                      << prefix << "P99_CI_MSEC              " << s.p99_low * 1000 << " " << s.p99_high * 1000 << "\n"
+                      << prefix << "THROUGHPUT_MPIX_PER_SEC  " << (megapixels_out() / s.median) << "\n";
+            }
+        }
+        if (parsable_output) {
+            out() << md->name << "  CACHE                    " << cache << "\n"
+                  << md->name << "  HALIDE_TARGET            " << md->target << "\n";
+        }
+
+        if (!json_path.empty()) {
+            std::ofstream json(json_path);
+            if (!json) {
+                fail() << "Unable to open " << json_path << " for writing";
+            }
+            // Names and targets are identifiers, so they need no escaping.
+            json << std::setprecision(9)
+                 << "{\n"
+                 << "  \"name\": \"" << md->name << "\",\n"
+                 << "  \"target\": \"" << md->target << "\",\n"
+                 << "  \"cache\": \"" << cache << "\",\n"
+                 << "  \"flush_cache_bytes\": " << flush_cache_bytes << ",\n"
+                 << "  \"output_mpix\": " << megapixels_out() << ",\n"
+                 << "  \"runs\": [";
+            for (size_t i = 0; i < runs.size(); i++) {
+                const auto &s = runs[i].stats;
+                json << (i ? "," : "") << "\n    {\n"
+                     << "      \"num_threads\": " << runs[i].num_threads << ",\n"
+                     << "      \"samples\": " << s.samples << ",\n"
+                     << "      \"confidence\": " << s.confidence << ",\n"
+                     << "      \"best_sec\": " << s.min << ",\n"
+                     << "      \"mean_sec\": " << s.mean << ",\n"
+                     << "      \"median_sec\": " << s.median << ",\n"
+                     << "      \"median_ci_sec\": [" << s.median_low << ", " << s.median_high << "],\n"
+                     << "      \"p95_sec\": " << s.p95 << ",\n"
+                     << "      \"p95_ci_sec\": [" << s.p95_low << ", " << s.p95_high << "],\n"
+                     << "      \"p99_sec\": " << s.p99 << ",\n"
+                     << "      \"p99_ci_sec\": [" << s.p99_low << ", " << s.p99_high << "]\n"
+                     << "    }";
+            }
+            json << "\n  ]\n}\n";
+            info() << "Wrote benchmark results to " << json_path;
+        }
+
+        if (perf_counters) {
+            report_perf_counters(filter_argv, std::max<uint64_t>(1, total_iterations / runs.size()));
+        }
     }
 
     struct Output {
@@ -1391,11 +1631,56 @@ public:
         this->parsable_output = parsable_output;
     }
 
+    void set_perf_counters(bool perf_counters = true) {
+        this->perf_counters = perf_counters;
+    }
+
 private:
+    // The fewest iterations run_for_benchmark_statistics() times, so that
+    // there are enough samples for the p95 and p99 to mean something.
+    static constexpr uint64_t kMinStatisticsSamples = 100;
+
     static void rungen_ignore_error(void *user_context, const char *message) {
         // nothing
     }
 
+    // Run the filter some more times with the hardware performance
+    // counters enabled, and report the counts per iteration. This is done
+    // separately from the timing, so that it doesn't disturb it.
+    void report_perf_counters(std::vector<void *> &filter_argv, int iterations) {
+        PerfCounters counters;
+        if (counters.empty()) {
+            warn() << "No hardware performance counters are available.";
+            return;
+        }
+
+        // The threads of the thread pool only count if they are created
+        // while the counters are enabled, and their counts are only read
+        // once they exit, so use a fresh thread pool and shut it down
+        // again before reading.
+        halide_shutdown_thread_pool();
+        counters.enable();
+        for (int i = 0; i < iterations; i++) {
+            (void)halide_argv_call(&filter_argv[0]);
+            device_sync_outputs();
+        }
+        halide_shutdown_thread_pool();
+        counters.disable();
+
+        for (const auto &c : counters.read_counts()) {
+            const double per_iteration = (double)c.second / iterations;
+            if (!parsable_output) {
+                out() << "Perf counter " << c.first << ": " << per_iteration << " per iteration.\n";
+            } else {
+                std::string name = c.first;
+                for (char &ch : name) {
+                    ch = (char)toupper(ch);
+                }
+                out() << md->name << "  " << name << "_PER_ITER  " << per_iteration << "\n";
+            }
+        }
+    }
+
     std::map<std::string, ShapePromise> bounds_query_input_shapes() const {
         assert(!output_shapes.empty());
         std::vector<void *> filter_argv(args.size(), nullptr);
@@ -1464,6 +1749,7 @@ private:
     std::map<std::string, ArgData> args;
     std::map<std::string, Shape> output_shapes;
     bool parsable_output = false;
+    bool perf_counters = false;
 };
 
 }  // namespace RunGen
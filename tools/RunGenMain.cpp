@@ -142,6 +142,33 @@ Flags:
         Override the default minimum desired benchmarking time; ignored if
         --benchmarks is not also specified.
 
+    --benchmark_statistics:
+        Instead of the best time, time each iteration separately and report
+        the median, p95 and p99 times, each with a 95% confidence interval.
+        Implies --benchmarks=all. At least 100 iterations are timed, for at
+        least --benchmark_min_time.
+
+    --flush_cache=BYTES [default = 67108864]:
+        Write and read back a buffer of this many bytes before each timed
+        iteration, so the filter runs from a cold cache. Implies
+        --benchmark_statistics.
+
+    --num_threads=NUM,NUM,...:
+        Benchmark once with each of these numbers of threads (as set by
+        halide_set_num_threads()), to give a scaling curve. Implies
+        --benchmark_statistics.
+
+    --benchmark_json=FILENAME:
+        Also write the results of --benchmark_statistics to this file as
+        JSON. Implies --benchmark_statistics.
+
+    --perf_counters:
+        After benchmarking, run the filter for as many iterations again with
+        hardware performance counters enabled (instructions, cycles, LLC load
+        misses and branch misses), and report the counts per iteration.
+        Ignored if --benchmarks is not also specified. Only available on
+        Linux, and only if perf_event_paranoid allows it.
+
     --track_memory:
         Override Halide memory allocator to track high-water mark of memory
         allocation during run; note that this may slow down execution, so
@@ -397,8 +424,13 @@ int main(int argc, char **argv) {
     std::set<std::string> seen_args;
     bool benchmark = false;
     bool track_memory = false;
+    bool perf_counters = false;
     bool describe = false;
     double benchmark_min_time = BenchmarkConfig().min_time;
+    bool benchmark_statistics = false;
+    size_t flush_cache_bytes = 0;
+    std::vector<int> num_threads;
+    std::string benchmark_json;
     std::string default_input_buffers;
     std::string default_input_scalars;
     std::string benchmarks_flag_value;
@@ -457,6 +489,14 @@ int main(int argc, char **argv) {
                 if (!parse_scalar(flag_value, &track_memory)) {
                     fail() << "Invalid value for flag: " << flag_name;
                 }
+            } else if (flag_name == "perf_counters") {
+                if (flag_value.empty()) {
+                    flag_value = "true";
+                }
+                if (!parse_scalar(flag_value, &perf_counters)) {
+                    fail() << "Invalid value for flag: " << flag_name;
+                }
+                r.set_perf_counters(perf_counters);
             } else if (flag_name == "benchmarks") {
                 benchmarks_flag_value = flag_value;
                 benchmark = true;
@@ -464,6 +504,36 @@ int main(int argc, char **argv) {
                 if (!parse_scalar(flag_value, &benchmark_min_time)) {
                     fail() << "Invalid value for flag: " << flag_name;
                 }
+            } else if (flag_name == "benchmark_statistics") {
+                if (flag_value.empty()) {
+                    flag_value = "true";
+                }
+                if (!parse_scalar(flag_value, &benchmark_statistics)) {
+                    fail() << "Invalid value for flag: " << flag_name;
+                }
+            } else if (flag_name == "flush_cache") {
+                if (flag_value.empty()) {
+                    flag_value = "67108864";
+                }
+                if (!parse_scalar(flag_value, &flush_cache_bytes)) {
+                    fail() << "Invalid value for flag: " << flag_name;
+                }
+                benchmark_statistics = true;
+            } else if (flag_name == "num_threads") {
+                for (const auto &n : split_string(flag_value, ",")) {
+                    int threads;
+                    if (!parse_scalar(n, &threads) || threads <= 0) {
+                        fail() << "Invalid value for flag: " << flag_name;
+                    }
+                    num_threads.push_back(threads);
+                }
+                benchmark_statistics = true;
+            } else if (flag_name == "benchmark_json") {
+                if (flag_value.empty()) {
+                    fail() << "--benchmark_json requires a filename";
+                }
+                benchmark_json = flag_value;
+                benchmark_statistics = true;
             } else if (flag_name == "default_input_buffers") {
                 default_input_buffers = flag_value;
                 if (default_input_buffers.empty()) {
@@ -576,6 +646,10 @@ int main(int argc, char **argv) {
         return 0;
     }
 
+    if (benchmark_statistics) {
+        benchmark = true;
+    }
+
     // It's OK to omit output arguments when we are benchmarking or tracking memory.
     bool ok_to_omit_outputs = (benchmark || track_memory);
 
@@ -616,7 +690,11 @@ int main(int argc, char **argv) {
         if (benchmarks_flag_value != "all") {
             fail() << "The only valid value for --benchmarks is 'all'";
         }
-        r.run_for_benchmark(benchmark_min_time);
+        if (benchmark_statistics) {
+            r.run_for_benchmark_statistics(benchmark_min_time, num_threads, flush_cache_bytes, benchmark_json);
+        } else {
+            r.run_for_benchmark(benchmark_min_time);
+        }
     } else {
         r.run_for_output();
     }
@@ -4,8 +4,10 @@
 #include <algorithm>
 #include <cassert>
 #include <chrono>
+#include <cmath>
 #include <functional>
 #include <limits>
+#include <vector>
 
 #if defined(__EMSCRIPTEN__)
 #include <emscripten.h>
@@ -234,6 +236,108 @@ inline BenchmarkResult benchmark(const std::function<void()> &op, const Benchmar
     return result;
 }
 
+// Run the operation 'op' repeatedly, timing each iteration on its own,
+// until at least min_time has elapsed and at least min_samples iterations
+// have been timed; stop at max_time once min_samples have been taken. If
+// 'between' is given, it is run (untimed) before each iteration, e.g. to
+// flush the caches. Returns the time of each iteration, in seconds.
+//
+// Unlike benchmark(), which reports the best time, this is meant for
+// computing the distribution of times with benchmark_statistics(). As each
+// iteration is timed separately, it is only meaningful for operations that
+// are much slower than the clock's resolution.
+inline std::vector<double> benchmark_samples(const std::function<void()> &op,
+                                             const BenchmarkConfig &config = {},
+                                             uint64_t min_samples = 30,
+                                             const std::function<void()> &between = nullptr) {
+    const double min_time = std::max(10 * 1e-6, config.min_time);
+    const double max_time = std::max(config.min_time, config.max_time);
+
+    std::vector<double> times;
+    double total_time = 0;
+    while (times.size() < min_samples || (total_time < min_time && total_time < max_time)) {
+        if (between) {
+            between();
+        }
+        auto start = benchmark_now();
+        op();
+        auto end = benchmark_now();
+        times.push_back(benchmark_duration_seconds(start, end));
+        total_time += times.back();
+    }
+    return times;
+}
+
+struct BenchmarkStatistics {
+    // Number of iteration times the statistics are computed from.
+    uint64_t samples;
+
+    // Times per iteration (seconds).
+    double min, mean, median, p95, p99;
+
+    // Distribution-free confidence intervals for the median, p95 and p99,
+    // at the given confidence level. These come from the order statistics
+    // of the samples, so they make no assumption about the shape of the
+    // distribution; with too few samples for a tail percentile, the upper
+    // bound is just the largest time seen.
+    double confidence;
+    double median_low, median_high;
+    double p95_low, p95_high;
+    double p99_low, p99_high;
+};
+
+// Compute the statistics of a set of iteration times, as returned by
+// benchmark_samples().
+inline BenchmarkStatistics benchmark_statistics(std::vector<double> times, double confidence = 0.95) {
+    BenchmarkStatistics s{};
+    assert(!times.empty() && confidence > 0 && confidence < 1);
+    std::sort(times.begin(), times.end());
+    const double n = (double)times.size();
+
+    // The two-sided critical value of the standard normal distribution,
+    // found by bisection, to avoid hardcoding a few confidence levels.
+    double lo = 0, hi = 10;
+    for (int i = 0; i < 64; i++) {
+        const double z = (lo + hi) / 2;
+        if (std::erf(z / std::sqrt(2.0)) < confidence) {
+            lo = z;
+        } else {
+            hi = z;
+        }
+    }
+    const double z = (lo + hi) / 2;
+
+    const auto at = [&](double rank) {
+        rank = std::min(std::max(rank, 0.0), n - 1);
+        return times[(size_t)rank];
+    };
+    const auto quantile = [&](double q, double *low, double *high) {
+        // The rank of the q'th quantile in the samples is binomially
+        // distributed; use its normal approximation for the interval.
+        const double spread = z * std::sqrt(n * q * (1 - q));
+        *low = at(std::ceil(n * q - spread) - 1);
+        *high = at(std::ceil(n * q + spread) - 1);
+        // Interpolate between the samples either side of the quantile.
+        const double pos = q * (n - 1);
+        const size_t i = (size_t)pos;
+        const double frac = pos - i;
+        return i + 1 < times.size() ? times[i] * (1 - frac) + times[i + 1] * frac : times[i];
+    };
+
+    s.samples = times.size();
+    s.min = times[0];
+    double total = 0;
+    for (double t : times) {
+        total += t;
+    }
+    s.mean = total / n;
+    s.confidence = confidence;
+    s.median = quantile(0.5, &s.median_low, &s.median_high);
+    s.p95 = quantile(0.95, &s.p95_low, &s.p95_high);
+    s.p99 = quantile(0.99, &s.p99_low, &s.p99_high);
+    return s;
+}
+
 }  // namespace Tools
 }  // namespace Halide
 
@@ -0,0 +1,278 @@
+#ifndef HALIDE_DISTRIBUTED_H
+#define HALIDE_DISTRIBUTED_H
+
+#include <algorithm>
+#include <functional>
+#include <type_traits>
+#include <vector>
+
+#include "HalideBuffer.h"
+#include "HalideRuntime.h"
+
+#ifdef HALIDE_DISTRIBUTED_MPI
+#include <mpi.h>
+#endif
+
+/** \file
+ * Run an AOT-compiled pipeline over an image too large for one machine,
+ * split across the ranks of a distributed-memory job. Each rank holds a
+ * slab of the input, and computes the matching slab of the output: both
+ * are split along their last (outermost) dimension, in the same way.
+ *
+ * Bounds inference on the pipeline finds the rows of the input each rank
+ * needs from the others (the halo). run_distributed starts nonblocking
+ * transfers of the halos, computes the rows of its output that don't
+ * need them, then waits for the transfers and computes the rest.
+ *
+ * The transfers go through a Communicator, so any transport can be
+ * plugged in. Define HALIDE_DISTRIBUTED_MPI before including this header
+ * to get MPICommunicator, which uses MPI's nonblocking point-to-point
+ * calls.
+ */
+
+namespace Halide {
+namespace Tools {
+
+/** The transport run_distributed exchanges halos over. Transfers started
+ * by isend and irecv may still be in progress when they return, and must
+ * not touch their memory after wait_all returns. Each pair of ranks
+ * exchanges at most one message with a given tag in each direction
+ * between calls to wait_all. These return 0 on success. */
+class Communicator {
+public:
+    virtual ~Communicator() = default;
+
+    virtual int rank() const = 0;
+    virtual int size() const = 0;
+
+    virtual int isend(const void *data, size_t size, int dest, int tag) = 0;
+    virtual int irecv(void *data, size_t size, int src, int tag) = 0;
+
+    /** Wait for all the transfers started since the last call. */
+    virtual int wait_all() = 0;
+};
+
+#ifdef HALIDE_DISTRIBUTED_MPI
+
+class MPICommunicator : public Communicator {
+    MPI_Comm comm;
+    std::vector<MPI_Request> requests;
+
+public:
+    explicit MPICommunicator(MPI_Comm comm = MPI_COMM_WORLD)
+        : comm(comm) {
+    }
+
+    int rank() const override {
+        int r = 0;
+        MPI_Comm_rank(comm, &r);
+        return r;
+    }
+
+    int size() const override {
+        int s = 1;
+        MPI_Comm_size(comm, &s);
+        return s;
+    }
+
+    int isend(const void *data, size_t size, int dest, int tag) override {
+        requests.emplace_back();
+        return MPI_Isend(data, (int)size, MPI_BYTE, dest, tag, comm, &requests.back()) == MPI_SUCCESS ? 0 : -1;
+    }
+
+    int irecv(void *data, size_t size, int src, int tag) override {
+        requests.emplace_back();
+        return MPI_Irecv(data, (int)size, MPI_BYTE, src, tag, comm, &requests.back()) == MPI_SUCCESS ? 0 : -1;
+    }
+
+    int wait_all() override {
+        int result = MPI_Waitall((int)requests.size(), requests.data(), MPI_STATUSES_IGNORE);
+        requests.clear();
+        return result == MPI_SUCCESS ? 0 : -1;
+    }
+};
+
+#endif  // HALIDE_DISTRIBUTED_MPI
+
+/** A range of coordinates along the dimension the image is split in. */
+struct Slab {
+    int min = 0, extent = 0;
+};
+
+/** The rows of [global_min, global_min + global_extent) that a rank
+ * owns. The rows are split as evenly as possible, in order of rank. */
+inline Slab slab_for_rank(int global_min, int global_extent, int rank, int size) {
+    const int base = global_extent / size, remainder = global_extent % size;
+    Slab s;
+    s.min = global_min + rank * base + std::min(rank, remainder);
+    s.extent = base + (rank < remainder ? 1 : 0);
+    return s;
+}
+
+/** An AOT-compiled pipeline with one input and one output, e.g. a
+ * wrapper that calls the function a Generator produced. */
+using DistributedPipeline = std::function<int(halide_buffer_t *input, halide_buffer_t *output)>;
+
+namespace Internal {
+
+inline Slab intersect(const Slab &a, const Slab &b) {
+    Slab s;
+    s.min = std::max(a.min, b.min);
+    s.extent = std::max(std::min(a.min + a.extent, b.min + b.extent) - s.min, 0);
+    return s;
+}
+
+// Use a bounds query to find the rows of the input (of shape like
+// input, but with all of the split dimension) needed for the given rows
+// of the output, limited to the rows that exist.
+inline int required_rows(const DistributedPipeline &pipeline,
+                         const halide_buffer_t *input, const halide_buffer_t *output,
+                         const Slab &global, const Slab &output_rows, Slab *rows) {
+    std::vector<halide_dimension_t> in_dims(input->dim, input->dim + input->dimensions);
+    std::vector<halide_dimension_t> out_dims(output->dim, output->dim + output->dimensions);
+    in_dims.back().min = global.min;
+    in_dims.back().extent = global.extent;
+    out_dims.back().min = output_rows.min;
+    out_dims.back().extent = output_rows.extent;
+
+    halide_buffer_t in_query = {}, out_query = {};
+    in_query.type = input->type;
+    in_query.dimensions = input->dimensions;
+    in_query.dim = in_dims.data();
+    out_query.type = output->type;
+    out_query.dimensions = output->dimensions;
+    out_query.dim = out_dims.data();
+    if (int result = pipeline(&in_query, &out_query)) {
+        return result;
+    }
+
+    Slab required;
+    required.min = in_dims.back().min;
+    required.extent = in_dims.back().extent;
+    *rows = intersect(required, global);
+    return 0;
+}
+
+}  // namespace Internal
+
+/** Compute this rank's slab of the output of pipeline. input and output
+ * must cover exactly this rank's rows (see slab_for_rank) of the last
+ * dimension of the image, whose rows are [global_min, global_min +
+ * global_extent), and all of the other dimensions a rank needs. Every
+ * rank must call this at the same time, with the same pipeline.
+ *
+ * The pipeline shouldn't read rows of the input outside of the image:
+ * use a boundary condition there. Errors on one rank aren't reported to
+ * the others, which may then wait for transfers that never start. */
+template<typename TIn, int DIn, typename TOut, int DOut>
+int run_distributed(Communicator &comm, const DistributedPipeline &pipeline,
+                    const Runtime::Buffer<TIn, DIn> &input, Runtime::Buffer<TOut, DOut> &output,
+                    int global_min, int global_extent) {
+    const int me = comm.rank(), num_ranks = comm.size();
+    const int in_d = input.dimensions() - 1, out_d = output.dimensions() - 1;
+    const Slab global{global_min, global_extent};
+    const Slab mine = slab_for_rank(global_min, global_extent, me, num_ranks);
+    if (input.dim(in_d).min() != mine.min || input.dim(in_d).extent() != mine.extent ||
+        output.dim(out_d).min() != mine.min || output.dim(out_d).extent() != mine.extent) {
+        return halide_error_code_bad_dimensions;
+    }
+
+    // Find the rows each rank needs, including this one.
+    std::vector<Slab> required(num_ranks);
+    for (int r = 0; r < num_ranks; r++) {
+        const Slab rows = slab_for_rank(global_min, global_extent, r, num_ranks);
+        if (int result = Internal::required_rows(pipeline, input.raw_buffer(), output.raw_buffer(),
+                                                 global, rows, &required[r])) {
+            return result;
+        }
+    }
+
+    // The rows of the output computed before the halos arrive are those
+    // far enough from the edges of the slab to only need this rank's
+    // rows of the input. Check that, in case the pipeline isn't a
+    // stencil of the same shape everywhere.
+    Slab interior = mine;
+    const int below = std::max(mine.min - required[me].min, 0);
+    const int above = std::max(required[me].min + required[me].extent - (mine.min + mine.extent), 0);
+    interior.min += below;
+    interior.extent = std::max(interior.extent - below - above, 0);
+    if (interior.extent > 0) {
+        Slab rows;
+        if (int result = Internal::required_rows(pipeline, input.raw_buffer(), output.raw_buffer(),
+                                                 global, interior, &rows)) {
+            return result;
+        }
+        if (rows.min < mine.min || rows.min + rows.extent > mine.min + mine.extent) {
+            interior.extent = 0;
+        }
+    }
+    if (interior.extent == 0) {
+        interior.min = mine.min;
+    }
+
+    // A dense buffer for this rank's rows and its halo, so that the rows
+    // from each other rank are contiguous.
+    const int lo = std::min(required[me].min, mine.min);
+    const int hi = std::max(required[me].min + required[me].extent, mine.min + mine.extent);
+    std::vector<int> sizes(input.dimensions()), mins(input.dimensions());
+    for (int i = 0; i < input.dimensions(); i++) {
+        mins[i] = input.dim(i).min();
+        sizes[i] = input.dim(i).extent();
+    }
+    mins[in_d] = lo;
+    sizes[in_d] = hi - lo;
+    Runtime::Buffer<std::remove_const_t<TIn>, DIn> local(input.type(), sizes);
+    local.set_min(mins);
+    local.copy_from(input);
+
+    // Post the receives before the sends, and keep the data to send
+    // (copied, as input may not be dense) until the transfers are done.
+    std::vector<Runtime::Buffer<>> sent;
+    int result = 0;
+    for (int r = 0; r < num_ranks && result == 0; r++) {
+        if (r == me) {
+            continue;
+        }
+        const Slab rows = Internal::intersect(required[me], slab_for_rank(global_min, global_extent, r, num_ranks));
+        if (rows.extent > 0) {
+            auto halo = local.cropped(in_d, rows.min, rows.extent);
+            result = comm.irecv(halo.data(), halo.size_in_bytes(), r, 0);
+        }
+    }
+    for (int r = 0; r < num_ranks && result == 0; r++) {
+        if (r == me) {
+            continue;
+        }
+        const Slab rows = Internal::intersect(required[r], mine);
+        if (rows.extent > 0) {
+            sent.emplace_back(input.cropped(in_d, rows.min, rows.extent).copy());
+            result = comm.isend(sent.back().data(), sent.back().size_in_bytes(), r, 0);
+        }
+    }
+
+    if (result == 0 && interior.extent > 0) {
+        auto out_rows = output.cropped(out_d, interior.min, interior.extent);
+        result = pipeline(local.raw_buffer(), out_rows.raw_buffer());
+    }
+
+    // Wait even after an error, as the transfers still use this memory.
+    if (int wait_result = comm.wait_all(); result == 0) {
+        result = wait_result;
+    }
+
+    // Then the rows on either side of the interior.
+    const Slab edges[] = {{mine.min, interior.min - mine.min},
+                          {interior.min + interior.extent, mine.min + mine.extent - (interior.min + interior.extent)}};
+    for (const Slab &rows : edges) {
+        if (result == 0 && rows.extent > 0) {
+            auto out_rows = output.cropped(out_d, rows.min, rows.extent);
+            result = pipeline(local.raw_buffer(), out_rows.raw_buffer());
+        }
+    }
+    return result;
+}
+
+}  // namespace Tools
+}  // namespace Halide
+
+#endif  // HALIDE_DISTRIBUTED_H
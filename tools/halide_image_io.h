@@ -15,6 +15,7 @@
 #include <map>
 #include <set>
 #include <string>
+#include <thread>
 #include <vector>
 
 #ifndef HALIDE_NO_PNG
@@ -31,6 +32,17 @@
 #include "jpeglib.h"
 #endif
 
+#ifndef HALIDE_NO_MMAP
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#define HALIDE_NO_MMAP
+#endif
+#endif
+
 #include "HalideRuntime.h"  // for halide_type_t
 
 namespace Halide {
@@ -60,6 +72,25 @@ struct FormatInfo {
     }
 };
 
+// Knobs that trade off the speed of loading and saving against other
+// things. They apply to all subsequent calls.
+struct ImageIOSettings {
+    // The number of threads that convert pixels between the layout of
+    // a file and that of an image, for formats that store interleaved
+    // rows (png, jpg, pgm and ppm). Zero means one per core. Small
+    // images are always converted on the calling thread.
+    static inline int num_threads = 0;
+
+    // The zlib compression level save_png uses, from 0 (no compression,
+    // fastest) to 9 (smallest files, slowest). -1 is zlib's default.
+    static inline int png_compression_level = -1;
+
+    // The set of PNG_FILTER_* that save_png picks from for each row, or
+    // -1 for libpng's default. PNG_FILTER_NONE is by far the fastest,
+    // at the cost of compressing photographic images less well.
+    static inline int png_filters = -1;
+};
+
 namespace Internal {
 
 typedef bool (*CheckFunc)(bool condition, const char *msg);
@@ -809,59 +840,179 @@ struct FileOpener {
         return write_bytes(&data[0], sizeof(T) * N);
     }
 
+    // Seek to an absolute byte offset, which may be past 2GB.
+    bool seek(int64_t offset) {
+#ifdef _WIN32
+        return _fseeki64(f, offset, SEEK_SET) == 0;
+#else
+        return fseeko(f, (off_t)offset, SEEK_SET) == 0;
+#endif
+    }
+
+    int64_t tell() {
+#ifdef _WIN32
+        return _ftelli64(f);
+#else
+        return (int64_t)ftello(f);
+#endif
+    }
+
     FILE *const f;
 };
 
 constexpr int AnyDims = -1;
 
-// Read a row of ElemTypes from a byte buffer and copy them into a specific image row.
-// Multibyte elements are assumed to be big-endian.
-template<typename ElemType, typename ImageType>
-void read_big_endian_row(const uint8_t *src, int y, ImageType *im) {
-    auto im_typed = im->template as<ElemType, AnyDims>();
-    const int xmin = im_typed.dim(0).min();
-    const int xmax = im_typed.dim(0).max();
-    if (im_typed.dimensions() > 2) {
-        const int cmin = im_typed.dim(2).min();
-        const int cmax = im_typed.dim(2).max();
-        for (int x = xmin; x <= xmax; x++) {
-            for (int c = cmin; c <= cmax; c++) {
-                im_typed(x, y, c + cmin) = read_big_endian<ElemType>(src);
-                src += sizeof(ElemType);
+// Copy the interleaved, big-endian samples of an image row in src to
+// the planes of dst, which are c_stride elements apart. Loops with the
+// number of channels and the stride of x known are vectorized.
+template<typename ElemType, int channels>
+void deinterleave_row(const uint8_t *src, int width, ElemType *dst, int64_t x_stride, int64_t c_stride) {
+    for (int c = 0; c < channels; c++) {
+        const uint8_t *s = src + c * sizeof(ElemType);
+        ElemType *d = dst + c * c_stride;
+        if (x_stride == 1) {
+            for (int x = 0; x < width; x++) {
+                d[x] = read_big_endian<ElemType>(s + x * channels * sizeof(ElemType));
+            }
+        } else {
+            for (int x = 0; x < width; x++) {
+                d[x * x_stride] = read_big_endian<ElemType>(s + x * channels * sizeof(ElemType));
             }
         }
-    } else {
-        for (int x = xmin; x <= xmax; x++) {
-            im_typed(x, y) = read_big_endian<ElemType>(src);
-            src += sizeof(ElemType);
+    }
+}
+
+template<typename ElemType, int channels>
+void interleave_row(const ElemType *src, int width, int64_t x_stride, int64_t c_stride, uint8_t *dst) {
+    for (int c = 0; c < channels; c++) {
+        const ElemType *s = src + c * c_stride;
+        uint8_t *d = dst + c * sizeof(ElemType);
+        if (x_stride == 1) {
+            for (int x = 0; x < width; x++) {
+                write_big_endian<ElemType>(s[x], d + x * channels * sizeof(ElemType));
+            }
+        } else {
+            for (int x = 0; x < width; x++) {
+                write_big_endian<ElemType>(s[x * x_stride], d + x * channels * sizeof(ElemType));
+            }
         }
     }
 }
 
-// Copy a row from an image into a byte buffer.
-// Multibyte elements are written in big-endian layout.
-template<typename ElemType, typename ImageType>
-void write_big_endian_row(const ImageType &im, int y, uint8_t *dst) {
-    auto im_typed = im.template as<typename std::add_const<ElemType>::type, AnyDims>();
-    const int xmin = im_typed.dim(0).min();
-    const int xmax = im_typed.dim(0).max();
-    if (im_typed.dimensions() > 2) {
-        const int cmin = im_typed.dim(2).min();
-        const int cmax = im_typed.dim(2).max();
-        for (int x = xmin; x <= xmax; x++) {
-            for (int c = cmin; c <= cmax; c++) {
-                write_big_endian<ElemType>(im_typed(x, y, c), dst);
-                dst += sizeof(ElemType);
+template<typename ElemType>
+void deinterleave_row(const uint8_t *src, int width, int channels, ElemType *dst, int64_t x_stride, int64_t c_stride) {
+    switch (channels) {
+    case 1:
+        deinterleave_row<ElemType, 1>(src, width, dst, x_stride, c_stride);
+        break;
+    case 2:
+        deinterleave_row<ElemType, 2>(src, width, dst, x_stride, c_stride);
+        break;
+    case 3:
+        deinterleave_row<ElemType, 3>(src, width, dst, x_stride, c_stride);
+        break;
+    case 4:
+        deinterleave_row<ElemType, 4>(src, width, dst, x_stride, c_stride);
+        break;
+    default:
+        for (int x = 0; x < width; x++) {
+            for (int c = 0; c < channels; c++) {
+                dst[x * x_stride + c * c_stride] = read_big_endian<ElemType>(src);
+                src += sizeof(ElemType);
             }
         }
-    } else {
-        for (int x = xmin; x <= xmax; x++) {
-            write_big_endian<ElemType>(im_typed(x, y), dst);
-            dst += sizeof(ElemType);
+    }
+}
+
+template<typename ElemType>
+void interleave_row(const ElemType *src, int width, int channels, int64_t x_stride, int64_t c_stride, uint8_t *dst) {
+    switch (channels) {
+    case 1:
+        interleave_row<ElemType, 1>(src, width, x_stride, c_stride, dst);
+        break;
+    case 2:
+        interleave_row<ElemType, 2>(src, width, x_stride, c_stride, dst);
+        break;
+    case 3:
+        interleave_row<ElemType, 3>(src, width, x_stride, c_stride, dst);
+        break;
+    case 4:
+        interleave_row<ElemType, 4>(src, width, x_stride, c_stride, dst);
+        break;
+    default:
+        for (int x = 0; x < width; x++) {
+            for (int c = 0; c < channels; c++) {
+                write_big_endian<ElemType>(src[x * x_stride + c * c_stride], dst);
+                dst += sizeof(ElemType);
+            }
         }
     }
 }
 
+// Read rows [y_begin, y_end) of ElemTypes from a byte buffer, in which
+// they are row_bytes apart, and copy them into an image.
+// Multibyte elements are assumed to be big-endian.
+template<typename ElemType, typename ImageType>
+void read_big_endian_rows(const uint8_t *src, size_t row_bytes, int y_begin, int y_end, ImageType *im) {
+    auto im_typed = im->template as<ElemType, AnyDims>();
+    const int width = im_typed.dim(0).extent();
+    const int channels = im_typed.dimensions() > 2 ? im_typed.dim(2).extent() : 1;
+    const int64_t x_stride = im_typed.dim(0).stride();
+    const int64_t y_stride = im_typed.dim(1).stride();
+    const int64_t c_stride = im_typed.dimensions() > 2 ? im_typed.dim(2).stride() : 0;
+    ElemType *base = im_typed.data();
+    for (int y = y_begin; y < y_end; y++) {
+        ElemType *dst = base + (y - im_typed.dim(1).min()) * y_stride;
+        deinterleave_row<ElemType>(src, width, channels, dst, x_stride, c_stride);
+        src += row_bytes;
+    }
+}
+
+// Copy rows [y_begin, y_end) of an image into a byte buffer, row_bytes
+// apart. Multibyte elements are written in big-endian layout.
+template<typename ElemType, typename ImageType>
+void write_big_endian_rows(const ImageType &im, int y_begin, int y_end, size_t row_bytes, uint8_t *dst) {
+    auto im_typed = im.template as<typename std::add_const<ElemType>::type, AnyDims>();
+    const int width = im_typed.dim(0).extent();
+    const int channels = im_typed.dimensions() > 2 ? im_typed.dim(2).extent() : 1;
+    const int64_t x_stride = im_typed.dim(0).stride();
+    const int64_t y_stride = im_typed.dim(1).stride();
+    const int64_t c_stride = im_typed.dimensions() > 2 ? im_typed.dim(2).stride() : 0;
+    const ElemType *base = im_typed.data();
+    for (int y = y_begin; y < y_end; y++) {
+        const ElemType *src = base + (y - im_typed.dim(1).min()) * y_stride;
+        interleave_row<ElemType>(src, width, channels, x_stride, c_stride, dst);
+        dst += row_bytes;
+    }
+}
+
+// Call f(y_begin, y_end) on bands of the rows [ymin, ymax] of an image
+// with row_bytes bytes per row, using ImageIOSettings::num_threads
+// threads if there are enough bytes to make that worthwhile.
+template<typename F>
+void for_each_row_band(int ymin, int ymax, size_t row_bytes, const F &f) {
+    constexpr size_t min_band_bytes = 256 * 1024;
+    const int rows = ymax - ymin + 1;
+    int threads = ImageIOSettings::num_threads > 0 ?
+                      ImageIOSettings::num_threads :
+                      (int)std::thread::hardware_concurrency();
+    threads = (int)std::min<size_t>(std::max(threads, 1), (rows * row_bytes) / min_band_bytes);
+    threads = std::min(threads, rows);
+    if (threads <= 1) {
+        f(ymin, ymax + 1);
+        return;
+    }
+    const int band = (rows + threads - 1) / threads;
+    std::vector<std::thread> workers;
+    for (int y = ymin + band; y <= ymax; y += band) {
+        workers.emplace_back([&f, y, band, ymax]() { f(y, std::min(y + band, ymax + 1)); });
+    }
+    f(ymin, ymin + band);
+    for (auto &w : workers) {
+        w.join();
+    }
+}
+
 #ifndef HALIDE_NO_PNG
 
 template<typename ImageType, Internal::CheckFunc check = Internal::CheckReturn>
@@ -914,19 +1065,28 @@ bool load_png(const std::string &filename, ImageType *im) {
 
     *im = ImageType(im_type, im_dimensions);
 
+    png_set_interlace_handling(png_ptr);
     png_read_update_info(png_ptr, info_ptr);
 
     auto copy_to_image = bit_depth == 8 ?
-                             Internal::read_big_endian_row<uint8_t, ImageType> :
-                             Internal::read_big_endian_row<uint16_t, ImageType>;
+                             Internal::read_big_endian_rows<uint8_t, ImageType> :
+                             Internal::read_big_endian_rows<uint16_t, ImageType>;
+
+    // Decode the whole image, which libpng does serially, and then
+    // deinterleave it in parallel.
+    const size_t row_bytes = png_get_rowbytes(png_ptr, info_ptr);
+    std::vector<uint8_t> pixels(row_bytes * height);
+    std::vector<png_bytep> rows(height);
+    for (int y = 0; y < height; y++) {
+        rows[y] = pixels.data() + y * row_bytes;
+    }
+    png_read_image(png_ptr, rows.data());
 
-    std::vector<uint8_t> row(png_get_rowbytes(png_ptr, info_ptr));
     const int ymin = im->dim(1).min();
     const int ymax = im->dim(1).max();
-    for (int y = ymin; y <= ymax; ++y) {
-        png_read_row(png_ptr, row.data(), nullptr);
-        copy_to_image(row.data(), y, im);
-    }
+    Internal::for_each_row_band(ymin, ymax, row_bytes, [&](int y_begin, int y_end) {
+        copy_to_image(rows[y_begin - ymin], row_bytes, y_begin, y_end, im);
+    });
 
     png_destroy_read_struct(&png_ptr, &info_ptr, nullptr);
 
@@ -996,20 +1156,33 @@ bool save_png(ImageType &im, const std::string &filename) {
     png_set_IHDR(png_ptr, info_ptr, width, height,
                  bit_depth, color_type, PNG_INTERLACE_NONE,
                  PNG_COMPRESSION_TYPE_BASE, PNG_FILTER_TYPE_BASE);
+    if (ImageIOSettings::png_compression_level >= 0) {
+        png_set_compression_level(png_ptr, ImageIOSettings::png_compression_level);
+    }
+    if (ImageIOSettings::png_filters >= 0) {
+        png_set_filter(png_ptr, PNG_FILTER_TYPE_BASE, ImageIOSettings::png_filters);
+    }
 
     png_write_info(png_ptr, info_ptr);
 
     auto copy_from_image = bit_depth == 8 ?
-                               Internal::write_big_endian_row<uint8_t, ImageType> :
-                               Internal::write_big_endian_row<uint16_t, ImageType>;
+                               Internal::write_big_endian_rows<uint8_t, ImageType> :
+                               Internal::write_big_endian_rows<uint16_t, ImageType>;
 
-    std::vector<uint8_t> row(png_get_rowbytes(png_ptr, info_ptr));
+    // Interleave the whole image in parallel, and then encode it, which
+    // libpng does serially.
+    const size_t row_bytes = png_get_rowbytes(png_ptr, info_ptr);
+    std::vector<uint8_t> pixels(row_bytes * height);
+    std::vector<png_bytep> rows(height);
+    for (int y = 0; y < height; y++) {
+        rows[y] = pixels.data() + y * row_bytes;
+    }
     const int ymin = im.dim(1).min();
     const int ymax = im.dim(1).max();
-    for (int y = ymin; y <= ymax; ++y) {
-        copy_from_image(im, y, row.data());
-        png_write_row(png_ptr, row.data());
-    }
+    Internal::for_each_row_band(ymin, ymax, row_bytes, [&](int y_begin, int y_end) {
+        copy_from_image(im, y_begin, y_end, row_bytes, rows[y_begin - ymin]);
+    });
+    png_write_image(png_ptr, rows.data());
     png_write_end(png_ptr, nullptr);
     png_destroy_write_struct(&png_ptr, &info_ptr);
 
@@ -1073,18 +1246,19 @@ bool load_pnm(const std::string &filename, int channels, ImageType *im) {
     *im = ImageType(im_type, im_dimensions);
 
     auto copy_to_image = bit_depth == 8 ?
-                             Internal::read_big_endian_row<uint8_t, ImageType> :
-                             Internal::read_big_endian_row<uint16_t, ImageType>;
+                             Internal::read_big_endian_rows<uint8_t, ImageType> :
+                             Internal::read_big_endian_rows<uint16_t, ImageType>;
 
-    std::vector<uint8_t> row(width * channels * (bit_depth / 8));
+    const size_t row_bytes = width * channels * (bit_depth / 8);
+    std::vector<uint8_t> pixels(row_bytes * height);
+    if (!check(f.read_vector(&pixels), "Could not read data")) {
+        return false;
+    }
     const int ymin = im->dim(1).min();
     const int ymax = im->dim(1).max();
-    for (int y = ymin; y <= ymax; ++y) {
-        if (!check(f.read_vector(&row), "Could not read data")) {
-            return false;
-        }
-        copy_to_image(row.data(), y, im);
-    }
+    Internal::for_each_row_band(ymin, ymax, row_bytes, [&](int y_begin, int y_end) {
+        copy_to_image(pixels.data() + (y_begin - ymin) * row_bytes, row_bytes, y_begin, y_end, im);
+    });
 
     return true;
 }
@@ -1114,17 +1288,18 @@ bool save_pnm(ImageType &im, const int channels, const std::string &filename) {
     fprintf(f.f, "%s\n%d %d\n%d\n", hdr_fmt, width, height, (1 << bit_depth) - 1);
 
     auto copy_from_image = bit_depth == 8 ?
-                               Internal::write_big_endian_row<uint8_t, ImageType> :
-                               Internal::write_big_endian_row<uint16_t, ImageType>;
+                               Internal::write_big_endian_rows<uint8_t, ImageType> :
+                               Internal::write_big_endian_rows<uint16_t, ImageType>;
 
-    std::vector<uint8_t> row(width * channels * (bit_depth / 8));
+    const size_t row_bytes = width * channels * (bit_depth / 8);
+    std::vector<uint8_t> pixels(row_bytes * height);
     const int ymin = im.dim(1).min();
     const int ymax = im.dim(1).max();
-    for (int y = ymin; y <= ymax; ++y) {
-        copy_from_image(im, y, row.data());
-        if (!check(f.write_vector(row), "Could not write data")) {
-            return false;
-        }
+    Internal::for_each_row_band(ymin, ymax, row_bytes, [&](int y_begin, int y_end) {
+        copy_from_image(im, y_begin, y_end, row_bytes, pixels.data() + (y_begin - ymin) * row_bytes);
+    });
+    if (!check(f.write_vector(pixels), "Could not write data")) {
+        return false;
     }
 
     return true;
@@ -1166,6 +1341,16 @@ bool save_ppm(ImageType &im, const std::string &filename) {
     return Internal::save_pnm<ImageType, check>(im, 3, filename);
 }
 
+// The layout of an image stored uncompressed, as a single compact
+// planar array of elements after a header, as the .npy, .tmp and .mat
+// formats store them.
+struct RawImageHeader {
+    halide_type_t type;
+    std::vector<int> extents;
+    // The offset in the file of the first element.
+    int64_t payload_offset;
+};
+
 // -------------- .npy file format
 // Based on documentation at https://numpy.org/devdocs/reference/generated/numpy.lib.format.html
 // and elsewhere
@@ -1292,15 +1477,8 @@ bool buffer_is_compact_planar(ImageType &im) {
     return true;
 }
 
-template<typename ImageType, CheckFunc check = CheckReturn>
-bool load_npy(const std::string &filename, ImageType *im) {
-    static_assert(!ImageType::has_static_halide_type, "");
-
-    FileOpener f(filename, "rb");
-    if (!check(f.f != nullptr, "File could not be opened for reading")) {
-        return false;
-    }
-
+template<CheckFunc check = CheckReturn>
+bool read_npy_header(FileOpener &f, RawImageHeader *result) {
     char magic_and_version[8];
     if (!check(f.read_bytes(magic_and_version, 8), "Could not read .npy header")) {
         return false;
@@ -1352,7 +1530,27 @@ bool load_npy(const std::string &filename, ImageType *im) {
         return false;
     }
 
-    *im = ImageType(im_type, h.extents);
+    result->type = im_type;
+    result->extents = h.extents;
+    result->payload_offset = f.tell();
+    return true;
+}
+
+template<typename ImageType, CheckFunc check = CheckReturn>
+bool load_npy(const std::string &filename, ImageType *im) {
+    static_assert(!ImageType::has_static_halide_type, "");
+
+    FileOpener f(filename, "rb");
+    if (!check(f.f != nullptr, "File could not be opened for reading")) {
+        return false;
+    }
+
+    RawImageHeader h;
+    if (!read_npy_header<check>(f, &h)) {
+        return false;
+    }
+
+    *im = ImageType(h.type, h.extents);
 
     // This should never fail unless the default Buffer<> constructor behavior changes.
     if (!check(buffer_is_compact_planar(*im), "load_npy() requires compact planar images")) {
@@ -1507,16 +1705,21 @@ bool load_jpg(const std::string &filename, ImageType *im) {
     }
     *im = ImageType(im_type, im_dimensions);
 
-    auto copy_to_image = Internal::read_big_endian_row<uint8_t, ImageType>;
+    // Decode the whole image, which libjpeg does serially, and then
+    // deinterleave it in parallel.
+    const size_t row_bytes = width * channels;
+    std::vector<uint8_t> pixels(row_bytes * height);
+    while (cinfo.output_scanline < cinfo.output_height) {
+        uint8_t *src = pixels.data() + cinfo.output_scanline * row_bytes;
+        jpeg_read_scanlines(&cinfo, &src, 1);
+    }
 
-    std::vector<uint8_t> row(width * channels);
     const int ymin = im->dim(1).min();
     const int ymax = im->dim(1).max();
-    for (int y = ymin; y <= ymax; ++y) {
-        uint8_t *src = row.data();
-        jpeg_read_scanlines(&cinfo, &src, 1);
-        copy_to_image(row.data(), y, im);
-    }
+    Internal::for_each_row_band(ymin, ymax, row_bytes, [&](int y_begin, int y_end) {
+        Internal::read_big_endian_rows<uint8_t, ImageType>(pixels.data() + (y_begin - ymin) * row_bytes,
+                                                           row_bytes, y_begin, y_end, im);
+    });
 
     jpeg_finish_decompress(&cinfo);
     jpeg_destroy_decompress(&cinfo);
@@ -1568,14 +1771,16 @@ bool save_jpg(ImageType &im, const std::string &filename) {
     jpeg_set_quality(&cinfo, quality, TRUE);
     jpeg_start_compress(&cinfo, TRUE);
 
-    auto copy_from_image = Internal::write_big_endian_row<uint8_t, ImageType>;
-
-    std::vector<uint8_t> row(width * channels);
+    const size_t row_bytes = width * channels;
+    std::vector<uint8_t> pixels(row_bytes * height);
     const int ymin = im.dim(1).min();
     const int ymax = im.dim(1).max();
-    for (int y = ymin; y <= ymax; ++y) {
-        uint8_t *dst = row.data();
-        copy_from_image(im, y, dst);
+    Internal::for_each_row_band(ymin, ymax, row_bytes, [&](int y_begin, int y_end) {
+        Internal::write_big_endian_rows<uint8_t, ImageType>(im, y_begin, y_end, row_bytes,
+                                                            pixels.data() + (y_begin - ymin) * row_bytes);
+    });
+    while (cinfo.next_scanline < cinfo.image_height) {
+        uint8_t *dst = pixels.data() + cinfo.next_scanline * row_bytes;
         jpeg_write_scanlines(&cinfo, &dst, 1);
     }
 
@@ -1604,6 +1809,26 @@ inline const halide_type_t *tmp_code_to_halide_type() {
     return tmp_code_to_halide_type_;
 }
 
+// ".tmp" is a file format used by the ImageStack tool (see https://github.com/abadams/ImageStack)
+template<CheckFunc check = CheckReturn>
+bool read_tmp_header(FileOpener &f, RawImageHeader *result) {
+    int32_t header[5];
+    if (!check(f.read_array(header), "Count not read .tmp header")) {
+        return false;
+    }
+
+    if (!check(header[0] > 0 && header[1] > 0 && header[2] > 0 && header[3] > 0 &&
+                   header[4] >= 0 && header[4] < kNumTmpCodes,
+               "Bad header on .tmp file")) {
+        return false;
+    }
+
+    result->type = tmp_code_to_halide_type()[header[4]];
+    result->extents = {header[0], header[1], header[2], header[3]};
+    result->payload_offset = f.tell();
+    return true;
+}
+
 // ".tmp" is a file format used by the ImageStack tool (see https://github.com/abadams/ImageStack)
 template<typename ImageType, CheckFunc check = CheckReturn>
 bool load_tmp(const std::string &filename, ImageType *im) {
@@ -1614,20 +1839,12 @@ bool load_tmp(const std::string &filename, ImageType *im) {
         return false;
     }
 
-    int32_t header[5];
-    if (!check(f.read_array(header), "Count not read .tmp header")) {
-        return false;
-    }
-
-    if (!check(header[0] > 0 && header[1] > 0 && header[2] > 0 && header[3] > 0 &&
-                   header[4] >= 0 && header[4] < kNumTmpCodes,
-               "Bad header on .tmp file")) {
+    RawImageHeader h;
+    if (!read_tmp_header<check>(f, &h)) {
         return false;
     }
 
-    const halide_type_t im_type = tmp_code_to_halide_type()[header[4]];
-    std::vector<int> im_dimensions = {header[0], header[1], header[2], header[3]};
-    *im = ImageType(im_type, im_dimensions);
+    *im = ImageType(h.type, h.extents);
 
     // This should never fail unless the default Buffer<> constructor behavior changes.
     if (!check(buffer_is_compact_planar(*im), "load_tmp() requires compact planar images")) {
@@ -1733,15 +1950,8 @@ enum MatlabClassCode {
     mxUINT64_CLASS = 15
 };
 
-template<typename ImageType, CheckFunc check = CheckReturn>
-bool load_mat(const std::string &filename, ImageType *im) {
-    static_assert(!ImageType::has_static_halide_type, "");
-
-    FileOpener f(filename, "rb");
-    if (!check(f.f != nullptr, "File could not be opened for reading")) {
-        return false;
-    }
-
+template<CheckFunc check = CheckReturn>
+bool read_mat_header(FileOpener &f, RawImageHeader *result) {
     uint8_t header[128];
     if (!check(f.read_array(header), "Could not read .mat header\n")) {
         return false;
@@ -1846,7 +2056,27 @@ bool load_mat(const std::string &filename, ImageType *im) {
         return false;
     }
 
-    *im = ImageType(type, extents);
+    result->type = type;
+    result->extents = extents;
+    result->payload_offset = f.tell();
+    return true;
+}
+
+template<typename ImageType, CheckFunc check = CheckReturn>
+bool load_mat(const std::string &filename, ImageType *im) {
+    static_assert(!ImageType::has_static_halide_type, "");
+
+    FileOpener f(filename, "rb");
+    if (!check(f.f != nullptr, "File could not be opened for reading")) {
+        return false;
+    }
+
+    RawImageHeader h;
+    if (!read_mat_header<check>(f, &h)) {
+        return false;
+    }
+
+    *im = ImageType(h.type, h.extents);
 
     // This should never fail unless the default Buffer<> constructor behavior changes.
     if (!check(buffer_is_compact_planar(*im), "load_mat() requires compact planar images")) {
@@ -2414,6 +2644,39 @@ bool find_imageio(const std::string &filename, ImageIO<ImageType, check> *result
     return check(false, err.c_str());
 }
 
+// Read the header of an image in one of the formats that store it as a
+// raw array (.npy, .tmp and .mat), leaving f at the start of the payload.
+template<CheckFunc check>
+bool read_raw_image_header(const std::string &filename, FileOpener &f, RawImageHeader *result) {
+    const std::map<std::string, bool (*)(FileOpener &, RawImageHeader *)> m = {
+        {"npy", read_npy_header<check>},
+        {"tmp", read_tmp_header<check>},
+        {"mat", read_mat_header<check>},
+    };
+    std::string ext = get_lowercase_extension(filename);
+    auto it = m.find(ext);
+    if (!check(it != m.end(), "Only .npy, .tmp and .mat files can be mapped or loaded by region")) {
+        return false;
+    }
+    if (!check(f.f != nullptr, "File could not be opened for reading")) {
+        return false;
+    }
+    return it->second(f, result);
+}
+
+#ifndef HALIDE_NO_MMAP
+struct FileMapping {
+    void *addr;
+    size_t length;
+};
+
+inline void unmap_file(void *context) {
+    FileMapping *m = (FileMapping *)context;
+    munmap(m->addr, m->length);
+    delete m;
+}
+#endif
+
 template<typename ImageType>
 FormatInfo best_save_format(const ImageType &im, const std::set<FormatInfo> &info) {
     // A bit ad hoc, but will do for now:
@@ -2691,6 +2954,164 @@ bool save_query(const std::string &filename, std::set<FormatInfo> *info) {
     return true;
 }
 
+// Load a .npy, .tmp or .mat file by mapping it into memory, rather than
+// reading it. The Image aliases the mapped pages, and unmaps them when
+// the last reference to it goes away, so loading takes time independent
+// of the size of the file, and pages are only read from disk when they
+// are first touched. The mapping is private: writes to the Image are
+// not written back to the file. Other formats, and files in which the
+// elements aren't aligned (e.g. .tmp files of 64-bit elements), are
+// loaded with load() instead. Only Halide::Runtime::Buffer can own a
+// mapping, as it needs take_ownership_of_host(). Returns false upon
+// failure.
+template<typename ImageType, Internal::CheckFunc check = Internal::CheckReturn>
+bool load_mapped(const std::string &filename, ImageType *im) {
+#ifdef HALIDE_NO_MMAP
+    return load<ImageType, check>(filename, im);
+#else
+    const std::string ext = Internal::get_lowercase_extension(filename);
+    if (ext != "npy" && ext != "tmp" && ext != "mat") {
+        return load<ImageType, check>(filename, im);
+    }
+
+    Internal::RawImageHeader h;
+    {
+        Internal::FileOpener f(filename, "rb");
+        if (!Internal::read_raw_image_header<check>(filename, f, &h)) {
+            return false;
+        }
+    }
+    if (ImageType::has_static_halide_type) {
+        const halide_type_t expected_type = ImageType::static_halide_type();
+        if (!check(h.type == expected_type, "Image loaded did not match the expected type")) {
+            return false;
+        }
+    }
+
+    size_t payload_bytes = h.type.bytes();
+    for (int e : h.extents) {
+        payload_bytes *= (size_t)e;
+    }
+    if (payload_bytes == 0 || h.payload_offset % h.type.bytes() != 0) {
+        return load<ImageType, check>(filename, im);
+    }
+
+    const int fd = open(filename.c_str(), O_RDONLY);
+    if (!check(fd >= 0, "File could not be opened for reading")) {
+        return false;
+    }
+    struct stat st;
+    if (!check(fstat(fd, &st) == 0 && (int64_t)st.st_size >= h.payload_offset + (int64_t)payload_bytes,
+               "File is too short for the image its header describes")) {
+        close(fd);
+        return false;
+    }
+    const size_t length = (size_t)h.payload_offset + payload_bytes;
+    void *addr = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    // The mapping keeps the file open.
+    close(fd);
+    if (!check(addr != MAP_FAILED, "Could not map file")) {
+        return false;
+    }
+
+    using DynamicImageType = typename Internal::ImageTypeWithElemType<ImageType, void>::type;
+    DynamicImageType im_d(h.type, (uint8_t *)addr + h.payload_offset, h.extents);
+    im_d.take_ownership_of_host(Internal::unmap_file, new Internal::FileMapping{addr, length});
+    *im = im_d.template as<typename ImageType::ElemType, Internal::AnyDims>();
+    im->set_host_dirty();
+    return true;
+#endif
+}
+
+// Load only part of a .npy, .tmp or .mat file: the given (min, extent)
+// of each of its leading dimensions, and all of the others. Only the
+// bytes of the region are read, so that a large file can be processed
+// a tile at a time. The Image has the mins of the region.
+// Returns false upon failure.
+template<typename ImageType, Internal::CheckFunc check = Internal::CheckReturn>
+bool load_region(const std::string &filename, const std::vector<std::pair<int, int>> &region, ImageType *im) {
+    Internal::FileOpener f(filename, "rb");
+    Internal::RawImageHeader h;
+    if (!Internal::read_raw_image_header<check>(filename, f, &h)) {
+        return false;
+    }
+    if (ImageType::has_static_halide_type) {
+        const halide_type_t expected_type = ImageType::static_halide_type();
+        if (!check(h.type == expected_type, "Image loaded did not match the expected type")) {
+            return false;
+        }
+    }
+
+    const int dims = (int)h.extents.size();
+    if (!check(region.size() <= h.extents.size(), "Region has more dimensions than the image")) {
+        return false;
+    }
+    std::vector<int> mins(dims, 0), extents = h.extents;
+    for (size_t d = 0; d < region.size(); d++) {
+        if (!check(region[d].first >= 0 && region[d].second >= 0 &&
+                       (int64_t)region[d].first + region[d].second <= h.extents[d],
+                   "Region is outside the image")) {
+            return false;
+        }
+        mins[d] = region[d].first;
+        extents[d] = region[d].second;
+    }
+
+    using DynamicImageType = typename Internal::ImageTypeWithElemType<ImageType, void>::type;
+    DynamicImageType im_d(h.type, extents);
+    im_d.set_min(mins);
+    if (dims == 0 || im_d.number_of_elements() == 0) {
+        *im = im_d.template as<typename ImageType::ElemType, Internal::AnyDims>();
+        return true;
+    }
+
+    // The strides of the payload in the file, in elements.
+    std::vector<int64_t> file_strides(dims);
+    int64_t stride = 1;
+    for (int d = 0; d < dims; d++) {
+        file_strides[d] = stride;
+        stride *= h.extents[d];
+    }
+
+    // Dimensions the region spans all of are contiguous with the next
+    // one, so read them all at once.
+    int inner = 1;
+    int64_t span = extents[0];
+    while (inner < dims && extents[inner - 1] == h.extents[inner - 1]) {
+        span *= extents[inner];
+        inner++;
+    }
+
+    const size_t elem_size = h.type.bytes();
+    uint8_t *dst = (uint8_t *)im_d.data();
+    std::vector<int> pos(mins);
+    while (true) {
+        int64_t offset = 0;
+        for (int d = 0; d < dims; d++) {
+            offset += pos[d] * file_strides[d];
+        }
+        if (!check(f.seek(h.payload_offset + offset * (int64_t)elem_size) &&
+                       f.read_bytes(dst, span * elem_size),
+                   "Could not read region of payload")) {
+            return false;
+        }
+        dst += span * elem_size;
+
+        int d = inner;
+        while (d < dims && ++pos[d] == mins[d] + extents[d]) {
+            pos[d] = mins[d];
+            d++;
+        }
+        if (d == dims) {
+            break;
+        }
+    }
+
+    *im = im_d.template as<typename ImageType::ElemType, Internal::AnyDims>();
+    im->set_host_dirty();
+    return true;
+}
+
 // Fancy wrapper to call load() with CheckFail, inferring the return type;
 // this allows you to simply use
 //
@@ -2746,6 +3167,27 @@ private:
     const std::string filename;
 };
 
+// Like load_image, but with load_mapped().
+class load_mapped_image {
+public:
+    load_mapped_image(const std::string &f)
+        : filename(f) {
+    }
+
+    template<typename ImageType>
+    operator ImageType() {
+        using DynamicImageType = typename Internal::ImageTypeWithElemType<ImageType, void>::type;
+        DynamicImageType im_d;
+        Internal::CheckFail(load_mapped<DynamicImageType, Internal::CheckFail>(filename, &im_d), "load_mapped() failed");
+        Internal::CheckFail(ImageType::can_convert_from(im_d),
+                            "Type mismatch assigning the result of load_mapped_image.");
+        return im_d.template as<typename ImageType::ElemType, Internal::AnyDims>();
+    }
+
+private:
+    const std::string filename;
+};
+
 // Fancy wrapper to call save() with CheckFail; this allows you to simply use
 //
 //    save_image(im, "filename");
@@ -0,0 +1,469 @@
+#ifndef HALIDE_PARALLEL_RUNTIME_H
+#define HALIDE_PARALLEL_RUNTIME_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <vector>
+
+#include "HalideRuntime.h"
+
+#ifdef HALIDE_PARALLEL_RUNTIME_TBB
+#include <tbb/parallel_for.h>
+#include <tbb/task_arena.h>
+#endif
+
+#ifdef HALIDE_PARALLEL_RUNTIME_OPENMP
+#include <omp.h>
+#endif
+
+/** \file
+ * Run the parallel loops and async tasks of AOT-compiled pipelines on an
+ * application's own task scheduler, instead of Halide's thread pool, so
+ * that the two don't compete for the cores.
+ *
+ * install_parallel_runtime replaces the parallel runtime (see
+ * halide_set_custom_parallel_runtime) with one that runs work on a
+ * ParallelExecutor. It implements all of halide_do_parallel_tasks:
+ * iterations only start once their semaphores can be acquired, serial
+ * tasks run one iteration at a time, and threads waiting for a call to
+ * finish run other work that is ready meanwhile (including that of the
+ * tasks they wait on), rather than blocking an executor thread. A task
+ * that needs more than one thread (its min_threads) only starts once
+ * that many threads could run it; if the executor's threads are all
+ * busy, the runtime starts spare threads of its own to make up the
+ * difference, as Halide's thread pool would.
+ *
+ * Define HALIDE_PARALLEL_RUNTIME_TBB before including this header to get
+ * TBBExecutor, which runs on a tbb::task_arena, and
+ * HALIDE_PARALLEL_RUNTIME_OPENMP to get OpenMPExecutor. Note that OpenMP
+ * runs nested parallel regions on one thread unless told otherwise,
+ * e.g. with omp_set_max_active_levels.
+ *
+ \code
+ tbb::task_arena arena;
+ Halide::Tools::TBBExecutor executor(arena);
+ Halide::Tools::install_parallel_runtime(&executor);
+ my_pipeline(input, output);
+ Halide::Tools::uninstall_parallel_runtime();
+ \endcode
+ */
+
+namespace Halide {
+namespace Tools {
+
+/** A task scheduler that runs the work of Halide pipelines. */
+class ParallelExecutor {
+public:
+    virtual ~ParallelExecutor() = default;
+
+    /** The number of threads the executor runs work on. */
+    virtual int concurrency() const = 0;
+
+    /** Call f(i) for each i in [0, n), in any order and possibly on
+     * several threads at once, and return once all of the calls have.
+     * f may itself call parallel_for. */
+    virtual void parallel_for(int n, const std::function<void(int)> &f) = 0;
+};
+
+/** Runs everything on the calling thread, with spare threads only where
+ * a task needs them. Mostly useful for testing. */
+class SerialExecutor : public ParallelExecutor {
+public:
+    int concurrency() const override {
+        return 1;
+    }
+
+    void parallel_for(int n, const std::function<void(int)> &f) override {
+        for (int i = 0; i < n; i++) {
+            f(i);
+        }
+    }
+};
+
+#ifdef HALIDE_PARALLEL_RUNTIME_TBB
+
+class TBBExecutor : public ParallelExecutor {
+    tbb::task_arena &arena;
+
+public:
+    explicit TBBExecutor(tbb::task_arena &arena)
+        : arena(arena) {
+    }
+
+    int concurrency() const override {
+        return arena.max_concurrency();
+    }
+
+    void parallel_for(int n, const std::function<void(int)> &f) override {
+        arena.execute([&]() {
+            tbb::parallel_for(0, n, [&](int i) { f(i); }, tbb::simple_partitioner());
+        });
+    }
+};
+
+#endif  // HALIDE_PARALLEL_RUNTIME_TBB
+
+#ifdef HALIDE_PARALLEL_RUNTIME_OPENMP
+
+class OpenMPExecutor : public ParallelExecutor {
+    int num_threads;
+
+public:
+    /** Run on num_threads threads, or omp_get_max_threads() if it is zero. */
+    explicit OpenMPExecutor(int num_threads = 0)
+        : num_threads(num_threads > 0 ? num_threads : omp_get_max_threads()) {
+    }
+
+    int concurrency() const override {
+        return num_threads;
+    }
+
+    void parallel_for(int n, const std::function<void(int)> &f) override {
+#pragma omp parallel for num_threads(num_threads) schedule(dynamic, 1)
+        for (int i = 0; i < n; i++) {
+            f(i);
+        }
+    }
+};
+
+#endif  // HALIDE_PARALLEL_RUNTIME_OPENMP
+
+namespace Internal {
+
+struct ParallelTaskState {
+    const halide_parallel_task_t *task;
+    // The next iteration to start, and the end of the range.
+    int next, end;
+    // Whether an iteration of a serial task is running.
+    bool running;
+};
+
+// A call to halide_do_parallel_tasks.
+struct ParallelTaskGroup {
+    void *user_context;
+    void *task_parent;
+    std::vector<ParallelTaskState> tasks;
+    int unstarted = 0, in_progress = 0, result = 0;
+
+    bool done() const {
+        return unstarted == 0 && in_progress == 0;
+    }
+};
+
+class ParallelRuntime {
+    // All fields are protected by this mutex.
+    std::mutex mutex;
+
+    // Broadcast whenever an iteration finishes or a semaphore is released.
+    std::condition_variable wakeup;
+
+    // The calls to halide_do_parallel_tasks in progress, oldest first.
+    std::vector<ParallelTaskGroup *> groups;
+
+    // The number of threads running iterations, as opposed to waiting in
+    // help() for other work to be ready.
+    int busy = 0;
+
+    std::vector<std::thread> spares;
+    bool shutting_down = false;
+
+    // Halide's thread pool won't grow beyond this either.
+    static constexpr int max_spares = 256;
+
+    // The number of iterations running on this thread, one inside another.
+    static int &depth() {
+        static thread_local int d = 0;
+        return d;
+    }
+
+    static std::atomic<int> *counter(halide_semaphore_t *s) {
+        static_assert(sizeof(std::atomic<int>) <= sizeof(halide_semaphore_t),
+                      "halide_semaphore_t is too small");
+        return reinterpret_cast<std::atomic<int> *>(s->_private);
+    }
+
+    static bool acquire(halide_semaphore_t *s, int n) {
+        std::atomic<int> *c = counter(s);
+        int value = c->load();
+        while (value >= n) {
+            if (c->compare_exchange_weak(value, value - n)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Acquire the semaphores of the next call of a task, or none of them.
+    static bool acquire_all(const halide_parallel_task_t *task) {
+        for (int i = 0; i < task->num_semaphores; i++) {
+            const halide_semaphore_acquire_t &s = task->semaphores[i];
+            if (!acquire(s.semaphore, s.count)) {
+                for (int j = 0; j < i; j++) {
+                    counter(task->semaphores[j].semaphore)->fetch_add(task->semaphores[j].count);
+                }
+                return false;
+            }
+        }
+        return true;
+    }
+
+    int capacity() const {
+        return (executor ? executor->concurrency() : 1) + (int)spares.size();
+    }
+
+    ParallelTaskState *claim(ParallelTaskGroup *g) {
+        for (ParallelTaskState &t : g->tasks) {
+            if (t.next < t.end && !(t.task->serial && t.running) && acquire_all(t.task)) {
+                return &t;
+            }
+        }
+        return nullptr;
+    }
+
+    // Start spare threads until min_threads threads, including this one,
+    // could work on a task at once.
+    void reserve_threads(int min_threads) {
+        int idle = capacity() - busy;
+        while (idle < min_threads && (int)spares.size() < max_spares) {
+            spares.emplace_back([this]() { spare_thread(); });
+            idle++;
+        }
+    }
+
+    // Run one iteration (or chunk of iterations) of a task whose
+    // semaphores can be acquired, preferring those of the given group.
+    // Returns false if there is nothing to run.
+    bool run_one(ParallelTaskGroup *preferred, std::unique_lock<std::mutex> &lock) {
+        ParallelTaskGroup *g = preferred;
+        ParallelTaskState *t = g ? claim(g) : nullptr;
+        // Otherwise try the innermost calls first, as they are the ones
+        // the others wait on.
+        for (auto it = groups.rbegin(); !t && it != groups.rend(); it++) {
+            if (*it != preferred) {
+                g = *it;
+                t = claim(g);
+            }
+        }
+        if (!t) {
+            return false;
+        }
+
+        const halide_parallel_task_t *task = t->task;
+        int extent = 1;
+        if (!task->serial && task->num_semaphores == 0) {
+            extent = std::max((t->end - t->next) / (2 * capacity()), 1);
+        }
+        const int min = t->next;
+        t->next += extent;
+        t->running = true;
+        g->unstarted -= extent;
+        g->in_progress++;
+        reserve_threads(task->min_threads);
+        busy++;
+        depth()++;
+
+        lock.unlock();
+        int result = task->fn(g->user_context, min, extent, task->closure, g->task_parent);
+        lock.lock();
+
+        depth()--;
+        busy--;
+        t->running = false;
+        g->in_progress--;
+        if (result != 0 && g->result == 0) {
+            // Don't start anything else; the caller returns the error.
+            g->result = result;
+            for (ParallelTaskState &s : g->tasks) {
+                g->unstarted -= s.end - s.next;
+                s.next = s.end;
+            }
+        }
+        wakeup.notify_all();
+        return true;
+    }
+
+    // Run work until g is done. Helpers also give up once g has nothing
+    // running that could make the rest of it ready.
+    void help(ParallelTaskGroup *g, bool caller) {
+        std::unique_lock<std::mutex> lock(mutex);
+        // This thread no longer runs the iteration that called us, if any.
+        const bool nested = depth() > 0;
+        if (nested) {
+            busy--;
+        }
+        while (!g->done()) {
+            if (run_one(g, lock)) {
+                continue;
+            }
+            if (!caller && g->in_progress == 0) {
+                break;
+            }
+            wakeup.wait(lock);
+        }
+        if (nested) {
+            busy++;
+        }
+    }
+
+    void spare_thread() {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (!shutting_down) {
+            if (!run_one(nullptr, lock)) {
+                wakeup.wait(lock);
+            }
+        }
+    }
+
+public:
+    ParallelExecutor *executor = nullptr;
+
+    static ParallelRuntime &get() {
+        static ParallelRuntime runtime;
+        return runtime;
+    }
+
+    ~ParallelRuntime() {
+        stop_spares();
+    }
+
+    void stop_spares() {
+        std::vector<std::thread> threads;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            shutting_down = true;
+            threads.swap(spares);
+        }
+        wakeup.notify_all();
+        for (std::thread &t : threads) {
+            t.join();
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        shutting_down = false;
+    }
+
+    int num_spares() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return (int)spares.size();
+    }
+
+    static int semaphore_init(halide_semaphore_t *s, int n) {
+        new (s->_private) std::atomic<int>(n);
+        return n;
+    }
+
+    static int semaphore_release(halide_semaphore_t *s, int n) {
+        int value = counter(s)->fetch_add(n) + n;
+        // Taking the lock means no thread can be between looking for work
+        // and waiting, so none misses the wakeup.
+        ParallelRuntime &rt = get();
+        {
+            std::lock_guard<std::mutex> lock(rt.mutex);
+        }
+        rt.wakeup.notify_all();
+        return value;
+    }
+
+    static bool semaphore_try_acquire(halide_semaphore_t *s, int n) {
+        return acquire(s, n);
+    }
+
+    static int do_task(void *user_context, halide_task_t f, int idx, uint8_t *closure) {
+        return f(user_context, idx, closure);
+    }
+
+    static int do_loop_task(void *user_context, halide_loop_task_t f, int min, int extent,
+                            uint8_t *closure, void *task_parent) {
+        return f(user_context, min, extent, closure, task_parent);
+    }
+
+    static int do_par_for(void *user_context, halide_task_t f, int min, int size, uint8_t *closure) {
+        std::atomic<int> result{0};
+        get().executor->parallel_for(size, [&](int i) {
+            if (result.load() == 0) {
+                int r = f(user_context, min + i, closure);
+                int ok = 0;
+                if (r != 0) {
+                    result.compare_exchange_strong(ok, r);
+                }
+            }
+        });
+        return result;
+    }
+
+    static int do_parallel_tasks(void *user_context, int num_tasks,
+                                 halide_parallel_task_t *tasks, void *task_parent) {
+        ParallelRuntime &rt = get();
+        ParallelTaskGroup group;
+        group.user_context = user_context;
+        group.task_parent = task_parent;
+        // The number of iterations that could run at once.
+        int width = 0;
+        for (int i = 0; i < num_tasks; i++) {
+            const int extent = std::max(tasks[i].extent, 0);
+            group.tasks.push_back({&tasks[i], tasks[i].min, tasks[i].min + extent, false});
+            group.unstarted += extent;
+            width += tasks[i].serial ? std::min(extent, 1) : extent;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(rt.mutex);
+            rt.groups.push_back(&group);
+        }
+        const int helpers = std::min(width, rt.executor->concurrency()) - 1;
+        if (helpers > 0) {
+            rt.executor->parallel_for(helpers, [&](int) { rt.help(&group, false); });
+        }
+        rt.help(&group, true);
+        {
+            std::lock_guard<std::mutex> lock(rt.mutex);
+            rt.groups.erase(std::find(rt.groups.begin(), rt.groups.end(), &group));
+        }
+        return group.result;
+    }
+};
+
+}  // namespace Internal
+
+/** Run the parallel work of all pipelines on executor, which must outlive
+ * its use. Must not be called while any pipeline is running. */
+inline void install_parallel_runtime(ParallelExecutor *executor) {
+    using Internal::ParallelRuntime;
+    ParallelRuntime::get().executor = executor;
+    halide_set_custom_parallel_runtime(ParallelRuntime::do_par_for,
+                                       ParallelRuntime::do_task,
+                                       ParallelRuntime::do_loop_task,
+                                       ParallelRuntime::do_parallel_tasks,
+                                       ParallelRuntime::semaphore_init,
+                                       ParallelRuntime::semaphore_try_acquire,
+                                       ParallelRuntime::semaphore_release);
+}
+
+/** Go back to Halide's thread pool, and stop any spare threads. Must not
+ * be called while any pipeline is running. */
+inline void uninstall_parallel_runtime() {
+    halide_set_custom_parallel_runtime(halide_default_do_par_for,
+                                       halide_default_do_task,
+                                       halide_default_do_loop_task,
+                                       halide_default_do_parallel_tasks,
+                                       halide_default_semaphore_init,
+                                       halide_default_semaphore_try_acquire,
+                                       halide_default_semaphore_release);
+    Internal::ParallelRuntime::get().stop_spares();
+    Internal::ParallelRuntime::get().executor = nullptr;
+}
+
+/** The number of spare threads started for tasks that needed more threads
+ * than the executor had free. */
+inline int parallel_runtime_spare_threads() {
+    return Internal::ParallelRuntime::get().num_spares();
+}
+
+}  // namespace Tools
+}  // namespace Halide
+
+#endif  // HALIDE_PARALLEL_RUNTIME_H
@@ -274,7 +274,8 @@ void usage(char *const *argv) {
         "Funcs into individual image files in the current directory.\n"
         "To generate a suitable binary trace, use Func::trace_stores(), or the\n"
         "target features trace_stores and trace_realizations, and run with\n"
-        "HL_TRACE_FILE=<filename>.\n";
+        "HL_TRACE_FILE=<filename>. Traces compressed with HL_TRACE_COMPRESS=1\n"
+        "can be read too.\n";
     fprintf(stderr, "%s\n", usage.c_str());
     exit(1);
 }
@@ -316,7 +317,7 @@ int main(int argc, char *const *argv) {
         usage(argv);
     }
 
-    FILE *file_desc = fopen(buf_filename, "r");
+    FILE *file_desc = fopen(buf_filename, "rb");
     if (file_desc == nullptr) {
         fprintf(stderr, "[Error opening file: %s. Exiting.\n", argv[1]);
         exit(1);
@@ -325,13 +326,18 @@ int main(int argc, char *const *argv) {
     printf("[INFO] Starting parse of binary trace...\n");
     int packet_count = 0;
 
+    TraceReader reader(file_desc);
+    if (size_t num_blocks = reader.build_index()) {
+        printf("[INFO] Trace has %d compressed blocks.\n", (int)num_blocks);
+    }
+
     map<string, FuncInfo> func_info;
 
     printf("[INFO] First pass...\n");
 
     for (;;) {
         Packet p;
-        if (!p.read_from_filedesc(file_desc)) {
+        if (!reader.read(&p)) {
             printf("[INFO] Finished pass 1 after %d packets.\n", packet_count);
             break;
         }
@@ -353,7 +359,7 @@ int main(int argc, char *const *argv) {
     }
 
     packet_count = 0;
-    fseek(file_desc, 0, SEEK_SET);
+    reader.rewind();
     if (ferror(file_desc)) {
         fprintf(stderr, "Error: couldn't seek back to beginning of trace file. Aborting.\n");
         exit(1);
@@ -365,7 +371,7 @@ int main(int argc, char *const *argv) {
 
     for (;;) {
         Packet p;
-        if (!p.read_from_filedesc(file_desc)) {
+        if (!reader.read(&p)) {
             printf("[INFO] Finished pass 2 after %d packets.\n", packet_count);
             if (file_desc != nullptr) {
                 fclose(file_desc);
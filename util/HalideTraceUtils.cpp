@@ -46,6 +46,166 @@ bool Packet::read(void *d, size_t size, FILE *fdesc) {
     return true;
 }
 
+bool lz4_decompress(const uint8_t *src, size_t src_size, uint8_t *dst, size_t dst_size) {
+    const uint8_t *src_end = src + src_size;
+    size_t out = 0;
+    const auto get_length = [&](size_t *n) {
+        uint8_t b;
+        do {
+            if (src == src_end) {
+                return false;
+            }
+            b = *src++;
+            *n += b;
+        } while (b == 255);
+        return true;
+    };
+    while (src < src_end) {
+        const uint8_t token = *src++;
+        size_t literals = token >> 4;
+        if (literals == 15 && !get_length(&literals)) {
+            return false;
+        }
+        if (literals > (size_t)(src_end - src) || literals > dst_size - out) {
+            return false;
+        }
+        memcpy(dst + out, src, literals);
+        src += literals;
+        out += literals;
+        if (src == src_end) {
+            // The last sequence has no match.
+            break;
+        }
+        if (src_end - src < 2) {
+            return false;
+        }
+        const size_t offset = src[0] | (src[1] << 8);
+        src += 2;
+        size_t length = token & 15;
+        if (length == 15 && !get_length(&length)) {
+            return false;
+        }
+        length += 4;
+        if (offset == 0 || offset > out || length > dst_size - out) {
+            return false;
+        }
+        // The match may overlap the output, so copy it bytewise.
+        for (size_t i = 0; i < length; i++, out++) {
+            dst[out] = dst[out - offset];
+        }
+    }
+    return out == dst_size;
+}
+
+bool TraceReader::read(Packet *p) {
+    while (block_cursor >= block.size()) {
+        // Read the next plain packet or block.
+        uint32_t size;
+        if (!p->read(&size, sizeof(size), fdesc)) {
+            return false;
+        }
+        if (size != HALIDE_TRACE_BLOCK_MAGIC) {
+            memcpy((void *)p, &size, sizeof(size));
+            const size_t header_size = sizeof(halide_trace_packet_t);
+            if (size < header_size || !p->read((uint8_t *)p + sizeof(size), header_size - sizeof(size), fdesc)) {
+                fprintf(stderr, "Unexpected EOF mid-packet");
+                return false;
+            }
+            if (size - header_size > sizeof(p->payload)) {
+                fprintf(stderr, "Payload larger than %d bytes in trace stream (%d)\n", (int)sizeof(p->payload), (int)(size - header_size));
+                abort();
+            }
+            if (!p->read(p->payload, size - header_size, fdesc)) {
+                fprintf(stderr, "Unexpected EOF mid-packet");
+                return false;
+            }
+            return true;
+        }
+
+        halide_trace_block_header_t header;
+        header.magic = size;
+        if (!p->read((uint8_t *)&header + sizeof(size), sizeof(header) - sizeof(size), fdesc)) {
+            fprintf(stderr, "Unexpected EOF mid-block");
+            return false;
+        }
+        block.resize(header.uncompressed_size);
+        block_cursor = 0;
+        if (header.compressed_size == header.uncompressed_size) {
+            if (!p->read(block.data(), block.size(), fdesc)) {
+                fprintf(stderr, "Unexpected EOF mid-block");
+                return false;
+            }
+        } else {
+            compressed.resize(header.compressed_size);
+            if (!p->read(compressed.data(), compressed.size(), fdesc)) {
+                fprintf(stderr, "Unexpected EOF mid-block");
+                return false;
+            }
+            if (!lz4_decompress(compressed.data(), compressed.size(), block.data(), block.size())) {
+                fprintf(stderr, "Corrupt compressed block in trace stream\n");
+                exit(1);
+            }
+        }
+    }
+
+    const uint8_t *packet = block.data() + block_cursor;
+    uint32_t size;
+    memcpy(&size, packet, sizeof(size));
+    const size_t header_size = sizeof(halide_trace_packet_t);
+    if (size < header_size || size - header_size > sizeof(p->payload) || size > block.size() - block_cursor) {
+        fprintf(stderr, "Bad packet size in compressed trace block (%d)\n", (int)size);
+        exit(1);
+    }
+    memcpy((void *)p, packet, size);
+    block_cursor += size;
+    return true;
+}
+
+size_t TraceReader::build_index() {
+    const long start = ftell(fdesc);
+    index.clear();
+    fseek(fdesc, 0, SEEK_SET);
+    uint64_t packets = 0;
+    while (true) {
+        const long offset = ftell(fdesc);
+        halide_trace_block_header_t header;
+        if (fread(&header, sizeof(header.magic), 1, fdesc) != 1) {
+            break;
+        }
+        if (header.magic == HALIDE_TRACE_BLOCK_MAGIC) {
+            if (fread(&header.compressed_size, sizeof(header) - sizeof(header.magic), 1, fdesc) != 1) {
+                break;
+            }
+            index.push_back({offset, packets, header.num_packets});
+            packets += header.num_packets;
+            fseek(fdesc, header.compressed_size, SEEK_CUR);
+        } else if (header.magic < sizeof(halide_trace_packet_t)) {
+            fprintf(stderr, "Bad packet size in trace stream (%d)\n", (int)header.magic);
+            break;
+        } else {
+            // A plain packet, whose size is the word we just read.
+            packets++;
+            fseek(fdesc, (long)header.magic - (long)sizeof(header.magic), SEEK_CUR);
+        }
+    }
+    clearerr(fdesc);
+    fseek(fdesc, start, SEEK_SET);
+    return index.size();
+}
+
+void TraceReader::seek_to_block(size_t b) {
+    assert(b < index.size());
+    fseek(fdesc, index[b].offset, SEEK_SET);
+    block.clear();
+    block_cursor = 0;
+}
+
+void TraceReader::rewind() {
+    fseek(fdesc, 0, SEEK_SET);
+    block.clear();
+    block_cursor = 0;
+}
+
 void bad_type_error(halide_type_t type) {
     fprintf(stderr, "Can't convert packet with type: %d bits: %d\n", type.code, type.bits);
     exit(1);
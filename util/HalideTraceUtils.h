@@ -4,6 +4,7 @@
 #include "HalideRuntime.h"
 #include <cstdio>
 #include <cstring>
+#include <vector>
 
 namespace Halide {
 namespace Internal {
@@ -92,6 +93,55 @@ struct Packet : public halide_trace_packet_t {
 private:
     // Do a blocking read of some number of bytes from a unistd file descriptor.
     bool read(void *d, size_t size, FILE *fdesc);
+
+    friend class TraceReader;
+};
+
+// Decompress an LZ4 block of src_size bytes into exactly dst_size bytes
+// at dst. Returns false if the block is malformed.
+bool lz4_decompress(const uint8_t *src, size_t src_size, uint8_t *dst, size_t dst_size);
+
+// Reads the packets of a binary trace, which may be a mix of plain
+// packets and compressed blocks of them (see halide_trace_block_header_t).
+class TraceReader {
+public:
+    // Where a block starts in the file, and the packets in it.
+    struct BlockInfo {
+        long offset;
+        uint64_t first_packet;
+        uint32_t num_packets;
+    };
+
+    explicit TraceReader(FILE *fdesc)
+        : fdesc(fdesc) {
+    }
+
+    // Grab the next packet. Returns false when the end is reached.
+    bool read(Packet *p);
+
+    // Walk the block headers of the trace to find where each of them
+    // starts, without decompressing them. Seeks back to where it started,
+    // so the file must be seekable. Returns the number of blocks.
+    size_t build_index();
+
+    const std::vector<BlockInfo> &blocks() const {
+        return index;
+    }
+
+    // Continue reading from the start of a block found by build_index.
+    void seek_to_block(size_t b);
+
+    // Continue reading from the start of the trace.
+    void rewind();
+
+private:
+    FILE *fdesc;
+    std::vector<BlockInfo> index;
+    // The decompressed packets of the current block, and how far through
+    // them we are.
+    std::vector<uint8_t> block;
+    size_t block_cursor = 0;
+    std::vector<uint8_t> compressed;
 };
 
 }  // namespace Internal
@@ -24,6 +24,7 @@
 #endif
 
 #include "HalideRuntime.h"
+#include "HalideTraceUtils.h"
 #include "inconsolata.h"
 
 #include "halide_trace_config.h"
@@ -148,40 +149,6 @@ T get_value_as(const halide_trace_packet_t &p, int idx) {
     return value_as<double>(p.type, aligned_value);
 }
 
-struct PacketAndPayload : public halide_trace_packet_t {
-    uint8_t payload[4096];
-
-    static bool read_or_die(void *buf, size_t count) {
-        char *p = (char *)buf;
-        char *p_end = p + count;
-        while (p < p_end) {
-            int64_t bytes_read = ::read(STDIN_FILENO, p, p_end - p);
-            if (bytes_read == 0) {
-                return false;  // EOF
-            } else if (bytes_read < 0) {
-                fail() << "Unable to read packet";
-            }
-            p += bytes_read;
-        }
-        assert(p == p_end);
-        return true;
-    }
-
-    bool read() {
-        constexpr size_t header_size = sizeof(halide_trace_packet_t);
-        if (!read_or_die(this, header_size)) {
-            return false;  // EOF
-        }
-
-        const size_t payload_size = this->size - header_size;
-        if (payload_size > sizeof(this->payload) || !read_or_die(this->payload, payload_size)) {
-            // Shouldn't ever get EOF here
-            fail() << "Unable to read packet payload of size " << payload_size;
-        }
-        return true;
-    }
-};
-
 // -------------------------------------------------------------
 
 // A struct specifying how a single Func will get visualized.
@@ -1152,6 +1119,7 @@ int run(bool ignore_trace_tags, FlagProcessor flag_processor) {
     std::list<std::pair<Label, int>> labels_being_drawn;
     size_t end_counter = 0;
     size_t packet_clock = 0;
+    Internal::TraceReader reader(stdin);
     for (;;) {
         // Hold for some number of frames once the trace has finished.
         if (end_counter) {
@@ -1205,8 +1173,8 @@ int run(bool ignore_trace_tags, FlagProcessor flag_processor) {
         }
 
         // Read a tracing packet
-        PacketAndPayload p;
-        if (!p.read()) {
+        Internal::Packet p;
+        if (!reader.read(&p)) {
             end_counter++;
             continue;
         }